@@ -174,6 +174,8 @@ static void isAnsweringMachine(struct ast_channel *chan, const char *data)
 	int audioFrameCount = 0;
 	struct ast_frame *f = NULL;
 	struct ast_dsp *silenceDetector = NULL;
+	struct ast_dsp_vad_latest vad = { .pending = 0, };
+	int vad_id;
 	struct timeval amd_tvstart;
 	int dspsilence = 0, framelength = 0;
 	RAII_VAR(struct ast_format *, readFormat, NULL, ao2_cleanup);
@@ -297,6 +299,9 @@ static void isAnsweringMachine(struct ast_channel *chan, const char *data)
 	/* Set silence threshold to specified value */
 	ast_dsp_set_threshold(silenceDetector, silenceThreshold);
 
+	/* Share the measuring of the frames with other detectors on the channel */
+	vad_id = ast_dsp_vad_subscribe(chan, ast_dsp_vad_latest_cb, &vad);
+
 	/* Set our start time so we can tie the loop to real world time and not RTP updates */
 	amd_tvstart = ast_tvnow();
 
@@ -369,7 +374,7 @@ static void isAnsweringMachine(struct ast_channel *chan, const char *data)
 				dspsilence += framelength;
 			else {
 				dspsilence = 0;
-				ast_dsp_silence(silenceDetector, f, &dspsilence);
+				ast_dsp_silence_vad(silenceDetector, &vad, f, &dspsilence, NULL);
 			}
 
 			if (dspsilence > 0) {
@@ -485,6 +490,9 @@ static void isAnsweringMachine(struct ast_channel *chan, const char *data)
 		ast_log(LOG_WARNING, "AMD: Unable to restore read format on '%s'\n", ast_channel_name(chan));
 
 	/* Free the DSP used to detect silence */
+	if (vad_id >= 0) {
+		ast_dsp_vad_unsubscribe(chan, vad_id);
+	}
 	ast_dsp_free(silenceDetector);
 
 	/* If we were playing something to pass the time, stop it now. */
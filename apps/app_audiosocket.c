@@ -58,6 +58,17 @@
 			<parameter name="service" required="true">
 				<para>Service is the name or IP address and port number of the audio socket service to which this call should be connected.  This should be in the form host:port, such as myserver:9019 </para>
 			</parameter>
+			<parameter name="options">
+				<optionlist>
+					<option name="m">
+						<para>Share a single connection to the service with every other call connected to it with this option.  Each message is then wrapped in a message of kind <literal>0x20</literal> whose payload is the 16 byte UUID of the call, the kind of the wrapped message and its payload.  The end of a call is sent as a wrapped hangup message, and the service ends a call the same way.</para>
+					</option>
+					<option name="a">
+						<argument name="ms" required="true" />
+						<para>Send the audio of the call in chunks of at least <replaceable>ms</replaceable> milliseconds, rather than a message for each frame.</para>
+					</option>
+				</optionlist>
+			</parameter>
 		</syntax>
 		<description>
 			<para>Connects to the given TCP service, then transmits channel audio over that socket.  In turn, audio is received from the socket and sent to the channel.  Only audio frames will be transmitted.</para>
@@ -69,7 +80,22 @@
 
 static const char app[] = "AudioSocket";
 
-static int audiosocket_run(struct ast_channel *chan, const char *id, const int svc);
+enum {
+	OPT_MULTIPLEX = (1 << 0),
+	OPT_AGGREGATE = (1 << 1),
+};
+
+enum {
+	OPT_ARG_AGGREGATE,
+	OPT_ARG_ARRAY_SIZE
+};
+
+AST_APP_OPTIONS(audiosocket_options, BEGIN_OPTIONS
+	AST_APP_OPTION('m', OPT_MULTIPLEX),
+	AST_APP_OPTION_ARG('a', OPT_AGGREGATE, OPT_ARG_AGGREGATE),
+END_OPTIONS );
+
+static int audiosocket_run(struct ast_channel *chan, struct ast_audiosocket_session *session);
 
 static int audiosocket_exec(struct ast_channel *chan, const char *data)
 {
@@ -81,9 +107,13 @@ static int audiosocket_exec(struct ast_channel *chan, const char *data)
 	AST_DECLARE_APP_ARGS(args,
 		AST_APP_ARG(idStr);
 		AST_APP_ARG(server);
+		AST_APP_ARG(options);
 	);
 
-	int s = 0;
+	struct ast_audiosocket_session *session;
+	struct ast_flags opts = { 0, };
+	char *opt_args[OPT_ARG_ARRAY_SIZE];
+	unsigned int aggregate_ms = 0;
 	uuid_t uu;
 
 
@@ -100,7 +130,19 @@ static int audiosocket_exec(struct ast_channel *chan, const char *data)
 		ast_log(LOG_ERROR, "Failed to parse UUID '%s'\n", args.idStr);
 		return -1;
 	}
-	if ((s = ast_audiosocket_connect(args.server, chan)) < 0) {
+	if (!ast_strlen_zero(args.options)
+		&& ast_app_parse_options(audiosocket_options, &opts, opt_args, args.options)) {
+		ast_log(LOG_ERROR, "AudioSocket options '%s' parse error\n", args.options);
+		return -1;
+	}
+	if (ast_test_flag(&opts, OPT_AGGREGATE)
+		&& (ast_strlen_zero(opt_args[OPT_ARG_AGGREGATE])
+			|| sscanf(opt_args[OPT_ARG_AGGREGATE], "%30u", &aggregate_ms) != 1)) {
+		ast_log(LOG_ERROR, "Invalid AudioSocket aggregation '%s'\n", S_OR(opt_args[OPT_ARG_AGGREGATE], ""));
+		return -1;
+	}
+	if (!(session = ast_audiosocket_session_open(args.server, args.idStr, chan,
+		ast_test_flag(&opts, OPT_MULTIPLEX), aggregate_ms))) {
 		/* The res module will already output a log message, so another is not needed */
 		return -1;
 	}
@@ -112,7 +154,7 @@ static int audiosocket_exec(struct ast_channel *chan, const char *data)
 		ast_log(LOG_ERROR, "Failed to set write format to SLINEAR for channel %s\n", chanName);
 		ao2_ref(writeFormat, -1);
 		ao2_ref(readFormat, -1);
-		close(s);
+		ast_audiosocket_session_close(session);
 		return -1;
 	}
 	if (ast_set_read_format(chan, ast_format_slin)) {
@@ -126,11 +168,11 @@ static int audiosocket_exec(struct ast_channel *chan, const char *data)
 		}
 		ao2_ref(writeFormat, -1);
 		ao2_ref(readFormat, -1);
-		close(s);
+		ast_audiosocket_session_close(session);
 		return -1;
 	}
 
-	res = audiosocket_run(chan, args.idStr, s);
+	res = audiosocket_run(chan, session);
 	/* On non-zero return, report failure */
 	if (res) {
 		/* Restore previous formats and close the connection */
@@ -142,10 +184,10 @@ static int audiosocket_exec(struct ast_channel *chan, const char *data)
 		}
 		ao2_ref(writeFormat, -1);
 		ao2_ref(readFormat, -1);
-		close(s);
+		ast_audiosocket_session_close(session);
 		return res;
 	}
-	close(s);
+	ast_audiosocket_session_close(session);
 
 	if (ast_set_write_format(chan, writeFormat)) {
 		ast_log(LOG_ERROR, "Failed to restore write format for channel %s\n", chanName);
@@ -159,12 +201,13 @@ static int audiosocket_exec(struct ast_channel *chan, const char *data)
 	return 0;
 }
 
-static int audiosocket_run(struct ast_channel *chan, const char *id, int svc)
+static int audiosocket_run(struct ast_channel *chan, struct ast_audiosocket_session *session)
 {
 	const char *chanName;
 	struct ast_channel *targetChan;
 	int ms = 0;
 	int outfd = -1;
+	int svc;
 	struct ast_frame *f;
 
 	if (!chan || ast_channel_state(chan) != AST_STATE_UP) {
@@ -172,10 +215,11 @@ static int audiosocket_run(struct ast_channel *chan, const char *id, int svc)
 		return -1;
 	}
 
-	if (ast_audiosocket_init(svc, id)) {
+	if (ast_audiosocket_session_init(session)) {
 		ast_log(LOG_ERROR, "Failed to intialize AudioSocket\n");
 		return -1;
 	}
+	svc = ast_audiosocket_session_fd(session);
 
 	chanName = ast_channel_name(chan);
 
@@ -190,7 +234,7 @@ static int audiosocket_run(struct ast_channel *chan, const char *id, int svc)
 
 			if (f->frametype == AST_FRAME_VOICE) {
 				/* Send audio frame to audiosocket */
-				if (ast_audiosocket_send_frame(svc, f)) {
+				if (ast_audiosocket_session_send_frame(session, f)) {
 					ast_log(LOG_ERROR, "Failed to forward channel frame from %s to AudioSocket\n",
 						chanName);
 					ast_frfree(f);
@@ -201,7 +245,7 @@ static int audiosocket_run(struct ast_channel *chan, const char *id, int svc)
 		}
 
 		if (outfd >= 0) {
-			f = ast_audiosocket_receive_frame(svc);
+			f = ast_audiosocket_session_receive_frame(session);
 			if (!f) {
 				ast_log(LOG_ERROR, "Failed to receive frame from AudioSocket message for"
 					"channel %s\n", chanName);
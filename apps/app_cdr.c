@@ -86,6 +86,8 @@ STASIS_MESSAGE_TYPE_DEFN_LOCAL(appcdr_message_type);
 struct app_cdr_message_payload {
 	/*! The name of the channel to be manipulated */
 	const char *channel_name;
+	/*! The uniqueid of the channel to be manipulated */
+	const char *channel_uniqueid;
 	/*! Reset the CDR */
 	unsigned int reset:1;
 	/*! If reseting the CDR, keep the variables */
@@ -105,6 +107,8 @@ static void appcdr_callback(void *data, struct stasis_subscription *sub, struct
 		return;
 	}
 
+	ast_cdr_message_router_sync(payload->channel_uniqueid);
+
 	if (payload->reset) {
 		if (ast_cdr_reset(payload->channel_name, payload->keep_variables)) {
 			ast_log(AST_LOG_WARNING, "Failed to reset CDRs on channel %s\n", payload->channel_name);
@@ -151,6 +155,7 @@ static int resetcdr_exec(struct ast_channel *chan, const char *data)
 	}
 
 	payload->channel_name = ast_channel_name(chan);
+	payload->channel_uniqueid = ast_channel_uniqueid(chan);
 	payload->reset = 1;
 
 	if (ast_test_flag(&flags, AST_CDR_FLAG_KEEP_VARS)) {
@@ -890,7 +890,7 @@ struct confbridge_conference *conf_find_bridge(const char *conference_name)
  */
 static int conf_is_recording(struct confbridge_conference *conference)
 {
-	return conference->record_chan != NULL;
+	return conference->record_chan != NULL || conference->record_tap != NULL;
 }
 
 /*!
@@ -913,11 +913,17 @@ static int conf_stop_record(struct confbridge_conference *conference)
 		return -1;
 	}
 
-	/* Remove the recording channel from the conference bridge. */
-	chan = conference->record_chan;
-	conference->record_chan = NULL;
-	ast_queue_frame(chan, &f);
-	ast_channel_unref(chan);
+	if (conference->record_tap) {
+		/* Stop tapping the mix, the rest of the recording is written behind our back. */
+		conf_mix_recorder_stop(conference->bridge, conference->record_tap);
+		conference->record_tap = NULL;
+	} else {
+		/* Remove the recording channel from the conference bridge. */
+		chan = conference->record_chan;
+		conference->record_chan = NULL;
+		ast_queue_frame(chan, &f);
+		ast_channel_unref(chan);
+	}
 
 	ast_test_suite_event_notify("CONF_STOP_RECORD", "Message: stopped conference recording channel\r\nConference: %s", conference->b_profile.name);
 	send_stop_record_event(conference);
@@ -925,6 +931,43 @@ static int conf_stop_record(struct confbridge_conference *conference)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Start recording the conference from a tap on its mix
+ *
+ * \param conference The conference bridge to start recording
+ *
+ * \note Must be called with the conference locked
+ *
+ * \retval 0 success
+ * \retval non-zero failure
+ */
+static int conf_start_record_tap(struct confbridge_conference *conference)
+{
+	char *filename;
+	char *options;
+
+	/* The filename is followed by the MixMonitor options, which are not used here. */
+	set_rec_filename(conference, &conference->record_filename,
+		is_new_rec_file(conference->b_profile.rec_file, &conference->orig_rec_file));
+	filename = ast_strdupa(ast_str_buffer(conference->record_filename));
+	if ((options = strchr(filename, ','))) {
+		*options = '\0';
+	}
+
+	conference->record_tap = conf_mix_recorder_start(conference->bridge, filename,
+		ast_test_flag(&conference->b_profile, BRIDGE_OPT_RECORD_FILE_APPEND),
+		conference->b_profile.rec_command);
+	if (!conference->record_tap) {
+		return -1;
+	}
+
+	ast_test_suite_event_notify("CONF_START_RECORD", "Message: started conference recording tap\r\nConference: %s", conference->b_profile.name);
+	send_start_record_event(conference);
+
+	return 0;
+}
+
 /*!
  * \internal
  * \brief Start recording the conference
@@ -947,6 +990,12 @@ static int conf_start_record(struct confbridge_conference *conference)
 		return -1;
 	}
 
+	/* MixMonitor options need MixMonitor, so only a plain recording taps the mix. */
+	if (ast_test_flag(&conference->b_profile, BRIDGE_OPT_RECORD_MIX_TAP)
+		&& ast_strlen_zero(conference->b_profile.rec_options)) {
+		return conf_start_record_tap(conference);
+	}
+
 	mixmonapp = pbx_findapp("MixMonitor");
 	if (!mixmonapp) {
 		ast_log(LOG_WARNING, "Cannot record ConfBridge, MixMonitor app is not installed\n");
@@ -1288,6 +1337,11 @@ static void destroy_conference_bridge(void *obj)
 		}
 	}
 
+	if (conference->record_tap) {
+		conf_mix_recorder_stop(conference->bridge, conference->record_tap);
+		conference->record_tap = NULL;
+	}
+
 	/* Destroying a conference bridge is simple, all we have to do is destroy the bridging object */
 	if (conference->bridge) {
 		ast_bridge_destroy(conference->bridge, 0);
@@ -1829,6 +1883,8 @@ static struct confbridge_conference *join_conference_bridge(const char *conferen
 		ast_bridge_set_maximum_sample_rate(conference->bridge, conference->b_profile.maximum_sample_rate);
 		/* Set the internal mixing interval on the bridge from the bridge profile */
 		ast_bridge_set_mixing_interval(conference->bridge, conference->b_profile.mix_interval);
+		/* Set the maximum number of mixing threads on the bridge from the bridge profile */
+		ast_bridge_set_mixing_threads(conference->bridge, conference->b_profile.mixing_threads);
 		ast_bridge_set_binaural_active(conference->bridge, ast_test_flag(&conference->b_profile, BRIDGE_OPT_BINAURAL_ACTIVE));
 
 		if (ast_test_flag(&conference->b_profile, BRIDGE_OPT_VIDEO_SRC_FOLLOW_TALKER)) {
@@ -810,6 +810,8 @@ struct chanlist {
 	struct ast_party_connected_line connected;
 	/*! TRUE if an AST_CONTROL_CONNECTED_LINE update was saved to the connected element. */
 	unsigned int pending_connected_update:1;
+	/*! TRUE if the channel had input when the channels were last waited on. */
+	unsigned int ready:1;
 	struct ast_aoc_decoded *aoc_s_rate_list;
 	/*! The interface, tech, and number strings are stuffed here. */
 	char stuff[0];
@@ -1263,14 +1265,22 @@ static struct ast_channel *wait_for_answer(struct ast_channel *in,
 		struct chanlist *o;
 		int pos = 0; /* how many channels do we handle */
 		int numlines = prestart;
-		struct ast_channel *winner;
 		struct ast_channel *watchers[AST_MAX_WATCHERS];
+		struct chanlist *legs[AST_MAX_WATCHERS];
+		int ready[AST_MAX_WATCHERS];
+		int nready;
+		int in_ready = 0;
+		int idx;
 
+		legs[pos] = NULL;
 		watchers[pos++] = in;
 		AST_LIST_TRAVERSE(out_chans, o, node) {
+			o->ready = 0;
 			/* Keep track of important channels */
-			if (ast_test_flag64(o, DIAL_STILLGOING) && o->chan)
+			if (ast_test_flag64(o, DIAL_STILLGOING) && o->chan) {
+				legs[pos] = o;
 				watchers[pos++] = o->chan;
+			}
 			numlines++;
 		}
 		if (pos == 1) { /* only the input channel is available */
@@ -1291,7 +1301,18 @@ static struct ast_channel *wait_for_answer(struct ast_channel *in,
 			}
 			SCOPE_EXIT_RTN_VALUE(NULL, "%s: No outgoing channels available\n", ast_channel_name(in));
 		}
-		winner = ast_waitfor_n(watchers, pos, to_answer);
+		/*
+		 * Every channel with input is read after a single wait, rather
+		 * than waiting again for each when many outgoing channels ring.
+		 */
+		nready = ast_waitfor_n_ready(watchers, pos, to_answer, ready);
+		for (idx = 0; idx < nready; idx++) {
+			if (legs[ready[idx]]) {
+				legs[ready[idx]]->ready = 1;
+			} else {
+				in_ready = 1;
+			}
+		}
 		AST_LIST_TRAVERSE(out_chans, o, node) {
 			int res = 0;
 			struct ast_frame *f;
@@ -1340,9 +1361,10 @@ static struct ast_channel *wait_for_answer(struct ast_channel *in,
 				}
 				continue;
 			}
-			if (c != winner)
+			/* Once someone answered, the others are not listened to anymore */
+			if (!o->ready || peer)
 				continue;
-			/* here, o->chan == c == winner */
+			/* here, o->chan == c had input */
 			if (!ast_strlen_zero(ast_channel_call_forward(c))) {
 				pa->sentringing = 0;
 				if (!ignore_cc && (f = ast_read(c))) {
@@ -1382,7 +1404,7 @@ static struct ast_channel *wait_for_answer(struct ast_channel *in,
 				}
 				continue;
 			}
-			f = ast_read(winner);
+			f = ast_read(c);
 			if (!f) {
 				ast_channel_hangupcause_set(in, ast_channel_hangupcause(c));
 				ast_channel_publish_dial(in, c, NULL, ast_hangup_cause_to_dial_status(ast_channel_hangupcause(c)));
@@ -1760,7 +1782,7 @@ static struct ast_channel *wait_for_answer(struct ast_channel *in,
 			}
 			ast_frfree(f);
 		} /* end for */
-		if (winner == in) {
+		if (in_ready) {
 			struct ast_frame *f = ast_read(in);
 #if 0
 			if (f && (f->frametype != AST_FRAME_VOICE))
@@ -108,6 +108,8 @@ STASIS_MESSAGE_TYPE_DEFN_LOCAL(forkcdr_message_type);
 struct fork_cdr_message_payload {
 	/*! The name of the channel whose CDR will be forked */
 	const char *channel_name;
+	/*! The uniqueid of the channel whose CDR will be forked */
+	const char *channel_uniqueid;
 	/*! Option flags that control how the CDR will be forked */
 	struct ast_flags *flags;
 };
@@ -125,6 +127,8 @@ static void forkcdr_callback(void *data, struct stasis_subscription *sub, struct
 		return;
 	}
 
+	ast_cdr_message_router_sync(payload->channel_uniqueid);
+
 	if (ast_cdr_fork(payload->channel_name, payload->flags)) {
 		ast_log(AST_LOG_WARNING, "Failed to fork CDR for channel %s\n",
 			payload->channel_name);
@@ -169,6 +173,7 @@ static int forkcdr_exec(struct ast_channel *chan, const char *data)
 	}
 
 	payload->channel_name = ast_channel_name(chan);
+	payload->channel_uniqueid = ast_channel_uniqueid(chan);
 	payload->flags = &flags;
 	message = stasis_message_create(forkcdr_message_type(), payload);
 	if (!message) {
@@ -60,6 +60,9 @@
 #include "asterisk/mixmonitor.h"
 #include "asterisk/format_cache.h"
 #include "asterisk/beep.h"
+#include "asterisk/threadpool.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/sem.h"
 
 /*** DOCUMENTATION
 	<application name="MixMonitor" language="en_US">
@@ -381,6 +384,10 @@ struct mixmonitor {
 	unsigned int flags;
 	struct ast_autochan *autochan;
 	struct mixmonitor_ds *mixmonitor_ds;
+	/*! Writes the frames to the files on the writer threads, in order */
+	struct ast_taskprocessor *writer;
+	/*! Posted once the writer has written everything queued to it */
+	struct ast_sem writer_done;
 
 	/* the below string fields describe data used for creating voicemails from the recording */
 	AST_DECLARE_STRING_FIELDS(
@@ -467,8 +474,23 @@ struct mixmonitor_ds {
 	unsigned int samp_rate;
 	char *filename;
 	char *beep_id;
+
+	/*! Frames read from the audiohook but not written to the files yet */
+	int backlog;
 };
 
+/*! \brief Most threads writing recordings to their files */
+#define MIXMONITOR_WRITERS 16
+
+/*! \brief Threads shared by all the recordings to write them to their files */
+static struct ast_threadpool *mixmonitor_writers;
+
+/*! \brief Frames of all the recordings waiting to be written */
+static int mixmonitor_backlog;
+
+/*! \brief The most frames of all the recordings that have been waiting to be written */
+static int mixmonitor_backlog_max;
+
 /*!
  * \internal
  * \pre mixmonitor_ds must be locked before calling this function
@@ -715,6 +737,148 @@ static int mixmonitor_autochan_is_bridged(struct ast_autochan *autochan)
 	return is_bridged;
 }
 
+/*!
+ * \internal
+ * \brief Write the frames read from the audiohook to the files
+ */
+static void mixmonitor_write_frames(struct mixmonitor *mixmonitor, struct ast_frame *fr,
+	struct ast_frame *fr_read, struct ast_frame *fr_write)
+{
+	struct ast_filestream *fs;
+	struct ast_frame *cur;
+
+	ast_mutex_lock(&mixmonitor->mixmonitor_ds->lock);
+
+	if ((fs = mixmonitor->mixmonitor_ds->fs_read)) {
+		for (cur = fr_read; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+			ast_writestream(fs, cur);
+		}
+	}
+
+	if ((fs = mixmonitor->mixmonitor_ds->fs_write)) {
+		for (cur = fr_write; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+			ast_writestream(fs, cur);
+		}
+	}
+
+	if ((fs = mixmonitor->mixmonitor_ds->fs)) {
+		for (cur = fr; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+			ast_writestream(fs, cur);
+		}
+	}
+
+	ast_mutex_unlock(&mixmonitor->mixmonitor_ds->lock);
+}
+
+/*! \brief Frames queued to the writer of a recording */
+struct mixmonitor_write {
+	struct mixmonitor *mixmonitor;
+	struct ast_frame *fr;
+	struct ast_frame *fr_read;
+	struct ast_frame *fr_write;
+};
+
+static void mixmonitor_write_free(struct mixmonitor_write *queued)
+{
+	if (queued->fr) {
+		ast_frame_free(queued->fr, 0);
+	}
+	if (queued->fr_read) {
+		ast_frame_free(queued->fr_read, 0);
+	}
+	if (queued->fr_write) {
+		ast_frame_free(queued->fr_write, 0);
+	}
+	ast_free(queued);
+}
+
+static int mixmonitor_write_task(void *data)
+{
+	struct mixmonitor_write *queued = data;
+
+	mixmonitor_write_frames(queued->mixmonitor, queued->fr, queued->fr_read, queued->fr_write);
+
+	ast_atomic_fetch_sub(&queued->mixmonitor->mixmonitor_ds->backlog, 1, __ATOMIC_RELAXED);
+	ast_atomic_fetch_sub(&mixmonitor_backlog, 1, __ATOMIC_RELAXED);
+	mixmonitor_write_free(queued);
+	return 0;
+}
+
+static int mixmonitor_write_done_task(void *data)
+{
+	struct mixmonitor *mixmonitor = data;
+
+	ast_sem_post(&mixmonitor->writer_done);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Have the frames read from the audiohook written to the files
+ *
+ * The frames are queued to the writer threads so that a slow disk holds
+ * up neither reading the audiohook, which would overflow, nor the other
+ * recordings.  Without a writer they are written right away.
+ *
+ * \note Takes ownership of the frames.
+ */
+static void mixmonitor_queue_frames(struct mixmonitor *mixmonitor, struct ast_frame *fr,
+	struct ast_frame *fr_read, struct ast_frame *fr_write)
+{
+	struct mixmonitor_write *queued;
+	int backlog;
+
+	if (mixmonitor->writer && (queued = ast_malloc(sizeof(*queued)))) {
+		queued->mixmonitor = mixmonitor;
+		queued->fr = fr;
+		queued->fr_read = fr_read;
+		queued->fr_write = fr_write;
+
+		ast_atomic_fetch_add(&mixmonitor->mixmonitor_ds->backlog, 1, __ATOMIC_RELAXED);
+		backlog = ast_atomic_fetch_add(&mixmonitor_backlog, 1, __ATOMIC_RELAXED) + 1;
+		if (backlog > ast_atomic_load_n(&mixmonitor_backlog_max, __ATOMIC_RELAXED)) {
+			/* Racing threads may leave it slightly short, which is fine for a statistic */
+			ast_atomic_store_n(&mixmonitor_backlog_max, backlog, __ATOMIC_RELAXED);
+		}
+
+		if (!ast_taskprocessor_push(mixmonitor->writer, mixmonitor_write_task, queued)) {
+			return;
+		}
+		ast_atomic_fetch_sub(&mixmonitor->mixmonitor_ds->backlog, 1, __ATOMIC_RELAXED);
+		ast_atomic_fetch_sub(&mixmonitor_backlog, 1, __ATOMIC_RELAXED);
+		ast_free(queued);
+	}
+
+	mixmonitor_write_frames(mixmonitor, fr, fr_read, fr_write);
+	if (fr) {
+		ast_frame_free(fr, 0);
+	}
+	if (fr_read) {
+		ast_frame_free(fr_read, 0);
+	}
+	if (fr_write) {
+		ast_frame_free(fr_write, 0);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Wait for the writer to write everything queued to it, and get rid of it
+ */
+static void mixmonitor_writer_finish(struct mixmonitor *mixmonitor)
+{
+	if (!mixmonitor->writer) {
+		return;
+	}
+
+	if (!ast_taskprocessor_push(mixmonitor->writer, mixmonitor_write_done_task, mixmonitor)) {
+		ast_sem_wait(&mixmonitor->writer_done);
+	}
+	/* The writer runs whatever it was given before it goes away */
+	mixmonitor->writer = ast_taskprocessor_unreference(mixmonitor->writer);
+	ast_sem_destroy(&mixmonitor->writer_done);
+}
+
 static void *mixmonitor_thread(void *obj)
 {
 	struct mixmonitor *mixmonitor = obj;
@@ -750,6 +914,16 @@ static void *mixmonitor_thread(void *obj)
 
 	ast_mutex_unlock(&mixmonitor->mixmonitor_ds->lock);
 
+	if (mixmonitor_writers && !ast_sem_init(&mixmonitor->writer_done, 0, 0)) {
+		char writer_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+
+		ast_taskprocessor_build_name(writer_name, sizeof(writer_name), "mixmonitor");
+		mixmonitor->writer = ast_threadpool_serializer(writer_name, mixmonitor_writers);
+		if (!mixmonitor->writer) {
+			ast_sem_destroy(&mixmonitor->writer_done);
+		}
+	}
+
 	/* The audiohook must enter and exit the loop locked */
 	ast_audiohook_lock(&mixmonitor->audiohook);
 	while (mixmonitor->audiohook.status == AST_AUDIOHOOK_STATUS_RUNNING && !mixmonitor->mixmonitor_ds->fs_quit) {
@@ -773,43 +947,19 @@ static void *mixmonitor_thread(void *obj)
 
 		if (!ast_test_flag(mixmonitor, MUXFLAG_BRIDGED)
 			|| mixmonitor_autochan_is_bridged(mixmonitor->autochan)) {
-			ast_mutex_lock(&mixmonitor->mixmonitor_ds->lock);
-
 			/* Write out the frame(s) */
-			if ((*fs_read) && (fr_read)) {
-				struct ast_frame *cur;
-
-				for (cur = fr_read; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
-					ast_writestream(*fs_read, cur);
-				}
+			mixmonitor_queue_frames(mixmonitor, fr, fr_read, fr_write);
+		} else {
+			/* All done! free it. */
+			if (fr) {
+				ast_frame_free(fr, 0);
 			}
-
-			if ((*fs_write) && (fr_write)) {
-				struct ast_frame *cur;
-
-				for (cur = fr_write; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
-					ast_writestream(*fs_write, cur);
-				}
+			if (fr_read) {
+				ast_frame_free(fr_read, 0);
 			}
-
-			if ((*fs) && (fr)) {
-				struct ast_frame *cur;
-
-				for (cur = fr; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
-					ast_writestream(*fs, cur);
-				}
+			if (fr_write) {
+				ast_frame_free(fr_write, 0);
 			}
-			ast_mutex_unlock(&mixmonitor->mixmonitor_ds->lock);
-		}
-		/* All done! free it. */
-		if (fr) {
-			ast_frame_free(fr, 0);
-		}
-		if (fr_read) {
-			ast_frame_free(fr_read, 0);
-		}
-		if (fr_write) {
-			ast_frame_free(fr_write, 0);
 		}
 
 		fr = NULL;
@@ -829,6 +979,9 @@ static void *mixmonitor_thread(void *obj)
 
 	ast_autochan_destroy(mixmonitor->autochan);
 
+	/* Everything read has to be in the files before they are closed */
+	mixmonitor_writer_finish(mixmonitor);
+
 	/* Datastore cleanup.  close the filestream and wait for ds destruction */
 	ast_mutex_lock(&mixmonitor->mixmonitor_ds->lock);
 	mixmonitor_ds_close_fs(mixmonitor->mixmonitor_ds);
@@ -1407,7 +1560,7 @@ static char *handle_cli_mixmonitor(struct ast_cli_entry *e, int cmd, struct ast_
 	} else if (!strcasecmp(a->argv[1], "stop")){
 		stop_mixmonitor_exec(chan, (a->argc >= 4) ? a->argv[3] : "");
 	} else if (!strcasecmp(a->argv[1], "list")) {
-		ast_cli(a->fd, "MixMonitor ID\tFile\tReceive File\tTransmit File\n");
+		ast_cli(a->fd, "MixMonitor ID\tFile\tReceive File\tTransmit File\tBacklog\n");
 		ast_cli(a->fd, "=========================================================================\n");
 		ast_channel_lock(chan);
 		AST_LIST_TRAVERSE(ast_channel_datastores(chan), datastore, entry) {
@@ -1426,7 +1579,8 @@ static char *handle_cli_mixmonitor(struct ast_cli_entry *e, int cmd, struct ast_
 				if (mixmonitor_ds->fs_write) {
 					filename_write = mixmonitor_ds->fs_write->filename;
 				}
-				ast_cli(a->fd, "%p\t%s\t%s\t%s\n", mixmonitor_ds, filename, filename_read, filename_write);
+				ast_cli(a->fd, "%p\t%s\t%s\t%s\t%d\n", mixmonitor_ds, filename, filename_read, filename_write,
+					ast_atomic_load_n(&mixmonitor_ds->backlog, __ATOMIC_RELAXED));
 			}
 		}
 		ast_channel_unlock(chan);
@@ -1440,6 +1594,32 @@ static char *handle_cli_mixmonitor(struct ast_cli_entry *e, int cmd, struct ast_
 	return CLI_SUCCESS;
 }
 
+static char *handle_cli_mixmonitor_show_backlog(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "mixmonitor show backlog";
+		e->usage =
+			"Usage: mixmonitor show backlog\n"
+			"       Shows how many frames of all the recordings are waiting to be\n"
+			"       written to their files, and the most there have been.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_cli(a->fd, "Frames waiting to be written: %d\n",
+		ast_atomic_load_n(&mixmonitor_backlog, __ATOMIC_RELAXED));
+	ast_cli(a->fd, "Most frames waiting to be written: %d\n",
+		ast_atomic_load_n(&mixmonitor_backlog_max, __ATOMIC_RELAXED));
+
+	return CLI_SUCCESS;
+}
+
 /*! \brief  Mute / unmute  an individual MixMonitor by id */
 static int mute_mixmonitor_instance(struct ast_channel *chan, const char *data,
 									enum ast_audiohook_flags flag, int clearmute)
@@ -1741,7 +1921,8 @@ static struct ast_custom_function mixmonitor_function = {
 };
 
 static struct ast_cli_entry cli_mixmonitor[] = {
-	AST_CLI_DEFINE(handle_cli_mixmonitor, "Execute a MixMonitor command")
+	AST_CLI_DEFINE(handle_cli_mixmonitor, "Execute a MixMonitor command"),
+	AST_CLI_DEFINE(handle_cli_mixmonitor_show_backlog, "Show the frames of recordings waiting to be written"),
 };
 
 static int set_mixmonitor_methods(void)
@@ -1772,13 +1953,29 @@ static int unload_module(void)
 	res |= ast_custom_function_unregister(&mixmonitor_function);
 	res |= clear_mixmonitor_methods();
 
+	/* Every recording holds a reference to the module, so none is using the writers */
+	ast_threadpool_shutdown(mixmonitor_writers);
+	mixmonitor_writers = NULL;
+
 	return res;
 }
 
 static int load_module(void)
 {
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 60,
+		.auto_increment = 1,
+		.initial_size = 0,
+		.max_size = MIXMONITOR_WRITERS,
+	};
 	int res;
 
+	mixmonitor_writers = ast_threadpool_create("mixmonitor", NULL, &options);
+	if (!mixmonitor_writers) {
+		ast_log(LOG_WARNING, "Could not create the MixMonitor writer threads, writing recordings on their own threads\n");
+	}
+
 	ast_cli_register_multiple(cli_mixmonitor, ARRAY_LEN(cli_mixmonitor));
 	res = ast_register_application_xml(app, mixmonitor_exec);
 	res |= ast_register_application_xml(stop_app, stop_mixmonitor_exec);
@@ -108,6 +108,20 @@
 					<option name="n">
 						<para>Do not play announcement to caller (alters <literal>A(x)</literal> behavior)</para>
 					</option>
+					<option name="m">
+						<argument name="group" required="true" argsep="&amp;">
+							<para>The multicast groups to page, each in the format of
+							<literal>type/destination[/control]</literal> as for the
+							<literal>MulticastRTP</literal> channel.</para>
+						</argument>
+						<para>Page multicast groups as well as, or instead of, the devices.
+						The page is encoded once for each group and sent to all of its
+						phones as a single multicast RTP stream rather than a call to each
+						of them, so a page to hundreds of phones listening to a group
+						takes one channel.</para>
+						<para>Devices can be paged along with the groups.  Paged devices, and
+						groups, using the same codec share a single encoding of the page.</para>
+					</option>
 				</optionlist>
 			</parameter>
 			<parameter name="timeout">
@@ -121,6 +135,10 @@
 			and dumps them into a conference bridge as muted participants. The original
 			caller is dumped into the conference as a speaker and the room is
 			destroyed when the original caller leaves.</para>
+			<para>Example: Page a multicast group and a device which is not listening to it:</para>
+			<example title="Page a multicast group">
+			exten => 1234,1,Page(PJSIP/lobby,m(basic/239.0.0.1:5000))
+			</example>
 		</description>
 		<see-also>
 			<ref type="application">ConfBridge</ref>
@@ -139,13 +157,15 @@ enum page_opt_flags {
 	PAGE_NOCALLERANNOUNCE = (1 << 6),
 	PAGE_PREDIAL_CALLEE = (1 << 7),
 	PAGE_PREDIAL_CALLER = (1 << 8),
+	PAGE_MULTICAST = (1 << 9),
 };
 
 enum {
 	OPT_ARG_ANNOUNCE = 0,
 	OPT_ARG_PREDIAL_CALLEE = 1,
 	OPT_ARG_PREDIAL_CALLER = 2,
-	OPT_ARG_ARRAY_SIZE = 3,
+	OPT_ARG_MULTICAST = 3,
+	OPT_ARG_ARRAY_SIZE = 4,
 };
 
 AST_APP_OPTIONS(page_opts, {
@@ -158,10 +178,14 @@ AST_APP_OPTIONS(page_opts, {
 	AST_APP_OPTION('i', PAGE_IGNORE_FORWARDS),
 	AST_APP_OPTION_ARG('A', PAGE_ANNOUNCE, OPT_ARG_ANNOUNCE),
 	AST_APP_OPTION('n', PAGE_NOCALLERANNOUNCE),
+	AST_APP_OPTION_ARG('m', PAGE_MULTICAST, OPT_ARG_MULTICAST),
 });
 
 #define PAGE_BEEP "beep"
 
+/*! The channel technology multicast groups are paged with */
+#define PAGE_MULTICAST_TECH "MulticastRTP"
+
 /* We use this structure as a way to pass this to all dialed channels */
 struct page_options {
 	char *opts[OPT_ARG_ARRAY_SIZE];
@@ -241,6 +265,62 @@ static void page_state_callback(struct ast_dial *dial)
 	setup_profile_paged(chan, options);
 }
 
+/*!
+ * \internal
+ * \brief Start paging a destination into the page conference
+ *
+ * \param chan The channel paging.
+ * \param tech The technology of the destination.
+ * \param resource The resource of the destination.
+ * \param confbridgeopts The application run on the destination when it answers.
+ * \param predial_callee Gosub run on the destination before it is called, NULL if none.
+ * \param timeout How long the destination may take to answer in seconds, 0 for no limit.
+ * \param options The page options.
+ *
+ * \return The dial running asynchronously, NULL on error.
+ */
+static struct ast_dial *page_dial(struct ast_channel *chan, const char *tech, const char *resource,
+	const char *confbridgeopts, const char *predial_callee, int timeout, struct page_options *options)
+{
+	struct ast_dial *dial;
+
+	/* Create a dialing structure */
+	if (!(dial = ast_dial_create())) {
+		ast_log(LOG_WARNING, "Failed to create dialing structure.\n");
+		return NULL;
+	}
+
+	/* Append technology and resource */
+	if (ast_dial_append(dial, tech, resource, NULL) == -1) {
+		ast_log(LOG_ERROR, "Failed to add %s/%s to outbound dial\n", tech, resource);
+		ast_dial_destroy(dial);
+		return NULL;
+	}
+
+	/* Set ANSWER_EXEC as global option */
+	ast_dial_option_global_enable(dial, AST_DIAL_OPTION_ANSWER_EXEC, (void *) confbridgeopts);
+
+	if (predial_callee) {
+		ast_dial_option_global_enable(dial, AST_DIAL_OPTION_PREDIAL, (void *) predial_callee);
+	}
+
+	if (timeout) {
+		ast_dial_set_global_timeout(dial, timeout * 1000);
+	}
+
+	if (ast_test_flag(&options->flags, PAGE_IGNORE_FORWARDS)) {
+		ast_dial_option_global_enable(dial, AST_DIAL_OPTION_DISABLE_CALL_FORWARDING, NULL);
+	}
+
+	ast_dial_set_state_callback(dial, &page_state_callback);
+	ast_dial_set_user_data(dial, options);
+
+	/* Run this dial in async mode */
+	ast_dial_run(dial, chan, 1);
+
+	return dial;
+}
+
 static int page_exec(struct ast_channel *chan, const char *data)
 {
 	char *tech;
@@ -300,6 +380,17 @@ static int page_exec(struct ast_channel *chan, const char *data)
 		tmp++;
 	}
 
+	/* Each multicast group is a single channel */
+	if (ast_test_flag(&options.flags, PAGE_MULTICAST)
+		&& !ast_strlen_zero(options.opts[OPT_ARG_MULTICAST])) {
+		num_dials++;
+		for (tmp = options.opts[OPT_ARG_MULTICAST]; *tmp; tmp++) {
+			if (*tmp == '&') {
+				num_dials++;
+			}
+		}
+	}
+
 	if (!(dial_list = ast_calloc(num_dials, sizeof(struct ast_dial *)))) {
 		ast_log(LOG_ERROR, "Can't allocate %ld bytes for dial list\n", (long)(sizeof(struct ast_dial *) * num_dials));
 		return -1;
@@ -357,42 +448,28 @@ static int page_exec(struct ast_channel *chan, const char *data)
 
 		*resource++ = '\0';
 
-		/* Create a dialing structure */
-		if (!(dial = ast_dial_create())) {
-			ast_log(LOG_WARNING, "Failed to create dialing structure.\n");
-			continue;
-		}
-
-		/* Append technology and resource */
-		if (ast_dial_append(dial, tech, resource, NULL) == -1) {
-			ast_log(LOG_ERROR, "Failed to add %s/%s to outbound dial\n", tech, resource);
-			ast_dial_destroy(dial);
-			continue;
+		if ((dial = page_dial(chan, tech, resource, confbridgeopts, predial_callee, timeout, &options))) {
+			dial_list[pos++] = dial;
 		}
+	}
 
-		/* Set ANSWER_EXEC as global option */
-		ast_dial_option_global_enable(dial, AST_DIAL_OPTION_ANSWER_EXEC, confbridgeopts);
+	/* Page each multicast group through a single channel sending to all of its phones */
+	if (ast_test_flag(&options.flags, PAGE_MULTICAST)
+		&& !ast_strlen_zero(options.opts[OPT_ARG_MULTICAST])) {
+		char *groups = options.opts[OPT_ARG_MULTICAST];
 
-		if (predial_callee) {
-			ast_dial_option_global_enable(dial, AST_DIAL_OPTION_PREDIAL, predial_callee);
-		}
+		while ((resource = strsep(&groups, "&"))) {
+			struct ast_dial *dial;
 
-		if (timeout) {
-			ast_dial_set_global_timeout(dial, timeout * 1000);
-		}
+			resource = ast_strip(resource);
+			if (ast_strlen_zero(resource)) {
+				continue;
+			}
 
-		if (ast_test_flag(&options.flags, PAGE_IGNORE_FORWARDS)) {
-			ast_dial_option_global_enable(dial, AST_DIAL_OPTION_DISABLE_CALL_FORWARDING, NULL);
+			if ((dial = page_dial(chan, PAGE_MULTICAST_TECH, resource, confbridgeopts, NULL, 0, &options))) {
+				dial_list[pos++] = dial;
+			}
 		}
-
-		ast_dial_set_state_callback(dial, &page_state_callback);
-		ast_dial_set_user_data(dial, &options);
-
-		/* Run this dial in async mode */
-		ast_dial_run(dial, chan, 1);
-
-		/* Put in our dialing array */
-		dial_list[pos++] = dial;
 	}
 
 	ast_free(predial_callee);
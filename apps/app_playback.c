@@ -35,6 +35,7 @@
 #include "asterisk/pbx.h"
 #include "asterisk/module.h"
 #include "asterisk/app.h"
+#include "asterisk/media_cache.h"
 /* This file provides config-file based 'say' functions, and implements
  * some CLI commands.
  */
@@ -499,6 +500,19 @@ static int playback_exec(struct ast_channel *chan, const char *data)
 		char *front;
 
 		ast_stopstream(chan);
+
+		/* Fetch the later remote files while the first ones play */
+		if (!option_say && strstr(back, "://")) {
+			char *prefetch = ast_strdupa(back);
+			int i;
+
+			for (i = 0; (front = ast_strsep(&prefetch, '&', AST_STRSEP_STRIP | AST_STRSEP_TRIM)); i++) {
+				if (i && strstr(front, "://")) {
+					ast_media_cache_prefetch(front);
+				}
+			}
+		}
+
 		while (!res && (front = ast_strsep(&back, '&', AST_STRSEP_STRIP | AST_STRSEP_TRIM))) {
 			if (option_say)
 				res = say_full(chan, front, "", ast_channel_language(chan), NULL, -1, -1);
@@ -73,6 +73,7 @@
 #include <ctype.h>
 
 #include "asterisk/lock.h"
+#include "asterisk/alertpipe.h"
 #include "asterisk/file.h"
 #include "asterisk/channel.h"
 #include "asterisk/pbx.h"
@@ -1035,6 +1036,23 @@
 			<para>Reset the statistics for a queue.</para>
 		</description>
 	</manager>
+	<manager name="QueueRealtimeFlush" language="en_US">
+		<synopsis>
+			Flush the cached realtime configuration of queues.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+			<parameter name="Queue">
+				<para>The name of the queue to flush. If no queue name is specified, then all queues are flushed.</para>
+			</parameter>
+		</syntax>
+		<description>
+			<para>Makes the next call to the queue load it and its members from
+			realtime again, even if <literal>realtime_cache_ttl</literal> in
+			<filename>queues.conf</filename> has not expired yet.  Meant to be
+			sent by whatever changes the realtime tables.</para>
+		</description>
+	</manager>
 	<manager name="QueueChangePriorityCaller" language="en_US">
 		<synopsis>
 			Change priority of a caller on queue.
@@ -1616,6 +1634,9 @@ static int log_membername_as_agent;
 /*! \brief queues.conf [general] option */
 static int force_longest_waiting_caller;
 
+/*! \brief queues.conf [general] option */
+static int realtime_cache_ttl;
+
 /*! \brief name of the ringinuse field in the realtime database */
 static char *realtime_ringinuse_field;
 
@@ -1721,6 +1742,7 @@ struct queue_ent {
 	AST_LIST_HEAD_NOLOCK(,penalty_rule) qe_rules; /*!< Local copy of the queue's penalty rules */
 	struct penalty_rule *pr;               /*!< Pointer to the next penalty rule to implement */
 	struct queue_ent *next;                /*!< The next queue entry */
+	int wake_pipe[2];                      /*!< Alerted when it may have become our turn */
 };
 
 struct member {
@@ -1749,6 +1771,7 @@ struct member {
 	unsigned int delme:1;                /*!< Flag to delete entry on reload */
 	char rt_uniqueid[80];                /*!< Unique id of realtime member entry */
 	unsigned int ringinuse:1;            /*!< Flag to ring queue members even if their status is 'inuse' */
+	unsigned int ready:1;                /*!< In the queue's index of members that can take a call */
 };
 
 enum empty_conditions {
@@ -1883,7 +1906,10 @@ struct call_queue {
 	int autofill;                       /*!< Ignore the head call status and ring an available agent */
 
 	struct ao2_container *members;      /*!< Head of the list of members */
+	struct ao2_container *ready_members; /*!< Members whose state lets them take a call, wrapup aside */
 	struct queue_ent *head;             /*!< Head of the list of callers */
+	struct timeval rt_loaded;           /*!< When the queue was last loaded from realtime */
+	struct timeval rt_members_loaded;   /*!< When the members were last loaded from realtime */
 	AST_LIST_ENTRY(call_queue) list;    /*!< Next call queue */
 	AST_LIST_HEAD_NOLOCK(, penalty_rule) rules; /*!< The list of penalty rules to invoke */
 };
@@ -1901,6 +1927,8 @@ static struct ao2_container *queues;
 static void update_realtime_members(struct call_queue *q);
 static struct member *interface_exists(struct call_queue *q, const char *interface);
 static int set_member_paused(const char *queuename, const char *interface, const char *reason, int paused);
+static void member_ready_update(struct call_queue *q, struct member *mem, int in_queue);
+static int num_available_members(struct call_queue *q);
 static int update_queue(struct call_queue *q, struct member *member, int callcompletedinsl, time_t starttime);
 
 static struct member *find_member_by_queuename_and_interface(const char *queuename, const char *interface);
@@ -2582,6 +2610,7 @@ static void update_status(struct call_queue *q, struct member *m, const int stat
 		}
 
 		m->status = status;
+		member_ready_update(q, m, 1);
 
 		/* Remove the member from the pending members pool only when the status changes.
 		 * This is not done unconditionally because we can occasionally see multiple
@@ -2597,14 +2626,13 @@ static void update_status(struct call_queue *q, struct member *m, const int stat
 
 /*!
  * \internal
- * \brief Determine if a queue member is available
- * \retval 1 if the member is available
- * \retval 0 if the member is not available
+ * \brief Determine if the state of a queue member lets it take a call, wrapup time aside
+ * \retval 1 if the member is ready
+ * \retval 0 if the member is not ready
  */
-static int is_member_available(struct call_queue *q, struct member *mem)
+static int is_member_ready(struct member *mem)
 {
-	int available = 0;
-	int wrapuptime;
+	int ready = 0;
 
 	switch (mem->status) {
 		case AST_DEVICE_INVALID:
@@ -2622,11 +2650,92 @@ static int is_member_available(struct call_queue *q, struct member *mem)
 		case AST_DEVICE_NOT_INUSE:
 		case AST_DEVICE_UNKNOWN:
 			if (!mem->paused) {
-				available = 1;
+				ready = 1;
 			}
 			break;
 	}
 
+	return ready;
+}
+
+/*!
+ * \internal
+ * \brief Wake the waiting callers whose turn may have come
+ *
+ * Rather than leaving them to find out when they next check, which they
+ * do every RECHECK seconds, each of the callers that the available
+ * members could serve is woken up.
+ *
+ * \note Must not be called with the members container of the queue locked
+ * unless the queue itself is locked.
+ */
+static void queue_wake_callers(struct call_queue *q)
+{
+	struct queue_ent *qe;
+	int avl;
+	int idx = 0;
+
+	ao2_lock(q);
+	if (q->head) {
+		avl = num_available_members(q);
+		for (qe = q->head; qe && idx < avl; qe = qe->next) {
+			if (qe->pending) {
+				continue;
+			}
+			idx++;
+			if (ast_alertpipe_writable(qe->wake_pipe)) {
+				ast_alertpipe_write(qe->wake_pipe);
+			}
+		}
+	}
+	ao2_unlock(q);
+}
+
+/*!
+ * \internal
+ * \brief Put a member in the queue's index of ready members, or take it out
+ *
+ * Callers waiting in a queue count the available members every second, so
+ * the index spares them going through the members that are paused, busy
+ * or unreachable.  It has to be updated whenever the status, pause or
+ * ringinuse of a member in the queue changes.  The callers a member that
+ * became ready could serve are woken up.
+ *
+ * \param q The queue
+ * \param mem The member
+ * \param in_queue Whether the member is in the queue at all
+ */
+static void member_ready_update(struct call_queue *q, struct member *mem, int in_queue)
+{
+	int ready = in_queue && is_member_ready(mem);
+	int became_ready = 0;
+
+	ao2_lock(q->ready_members);
+	if (ready && !mem->ready) {
+		ao2_link_flags(q->ready_members, mem, OBJ_NOLOCK);
+		became_ready = 1;
+	} else if (!ready && mem->ready) {
+		ao2_unlink_flags(q->ready_members, mem, OBJ_NOLOCK);
+	}
+	mem->ready = ready;
+	ao2_unlock(q->ready_members);
+
+	if (became_ready) {
+		queue_wake_callers(q);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Determine if a queue member is available
+ * \retval 1 if the member is available
+ * \retval 0 if the member is not available
+ */
+static int is_member_available(struct call_queue *q, struct member *mem)
+{
+	int available = is_member_ready(mem);
+	int wrapuptime;
+
 	/* Let wrapuptimes override device state availability */
 	wrapuptime = get_wrapuptime(q, mem);
 	if (mem->lastcall && wrapuptime && (time(NULL) - wrapuptime < mem->lastcall)) {
@@ -2645,7 +2754,6 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 	char interface[80], *slash_pos;
 	int found = 0;			/* Found this member in any queue */
 	int found_member;		/* Found this member in this queue */
-	int avail = 0;			/* Found an available member in this queue */
 
 	if (ast_device_state_message_type() != stasis_message_type(msg)) {
 		return;
@@ -2661,31 +2769,20 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 	while ((q = ao2_t_iterator_next(&qiter, "Iterate over queues"))) {
 		ao2_lock(q);
 
-		avail = 0;
 		found_member = 0;
 		miter = ao2_iterator_init(q->members, 0);
 		for (; (m = ao2_iterator_next(&miter)); ao2_ref(m, -1)) {
-			if (!found_member) {
-				ast_copy_string(interface, m->state_interface, sizeof(interface));
+			ast_copy_string(interface, m->state_interface, sizeof(interface));
 
-				if ((slash_pos = strchr(interface, '/'))) {
-					if (!strncasecmp(interface, "Local/", 6) && (slash_pos = strchr(slash_pos + 1, '/'))) {
-						*slash_pos = '\0';
-					}
-				}
-
-				if (!strcasecmp(interface, dev_state->device)) {
-					found_member = 1;
-					update_status(q, m, dev_state->state);
+			if ((slash_pos = strchr(interface, '/'))) {
+				if (!strncasecmp(interface, "Local/", 6) && (slash_pos = strchr(slash_pos + 1, '/'))) {
+					*slash_pos = '\0';
 				}
 			}
 
-			/* check every member until we find one NOT_INUSE */
-			if (!avail) {
-				avail = is_member_available(q, m);
-			}
-			if (avail && found_member) {
-				/* early exit as we've found an available member and the member of interest */
+			if (!strcasecmp(interface, dev_state->device)) {
+				found_member = 1;
+				update_status(q, m, dev_state->state);
 				ao2_ref(m, -1);
 				break;
 			}
@@ -2693,7 +2790,7 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 
 		if (found_member) {
 			found = 1;
-			if (avail) {
+			if (num_available_members(q)) {
 				ast_devstate_changed(AST_DEVICE_NOT_INUSE, AST_DEVSTATE_CACHABLE, "Queue:%s_avail", q->name);
 			} else {
 				ast_devstate_changed(AST_DEVICE_INUSE, AST_DEVSTATE_CACHABLE, "Queue:%s_avail", q->name);
@@ -3001,6 +3098,10 @@ static void init_queue(struct call_queue *q)
 				member_hash_fn, NULL, member_cmp_fn);
 		}
 	}
+	if (!q->ready_members) {
+		q->ready_members = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, 37,
+			member_hash_fn, NULL, member_cmp_fn);
+	}
 	q->found = 1;
 
 	ast_string_field_set(q, moh, "");
@@ -3546,6 +3647,7 @@ static void member_add_to_queue(struct call_queue *queue, struct member *mem)
 	ast_devstate_changed(mem->paused ? QUEUE_PAUSED_DEVSTATE : QUEUE_UNPAUSED_DEVSTATE,
 		AST_DEVSTATE_CACHABLE, "Queue:%s_pause_%s", queue->name, mem->interface);
 	ao2_unlock(queue->members);
+	member_ready_update(queue, mem, 1);
 }
 
 /*! \internal
@@ -3561,6 +3663,7 @@ static void member_remove_from_queue(struct call_queue *queue, struct member *me
 	ast_devstate_changed(QUEUE_UNKNOWN_PAUSED_DEVSTATE, AST_DEVSTATE_CACHABLE, "Queue:%s_pause_%s", queue->name, mem->interface);
 	queue_member_follower_removal(queue, mem);
 	ao2_unlink(queue->members, mem);
+	member_ready_update(queue, mem, 0);
 	ao2_unlock(queue->members);
 }
 
@@ -3655,6 +3758,7 @@ static void rt_handle_member_record(struct call_queue *q, char *category, struct
 			m->penalty = penalty;
 			m->ringinuse = ringinuse;
 			m->wrapuptime = wrapuptime;
+			member_ready_update(q, m, 1);
 			if (realtime_reason_paused) {
 				ast_copy_string(m->reason_paused, S_OR(reason_paused, ""), sizeof(m->reason_paused));
 			}
@@ -3717,6 +3821,7 @@ static void destroy_queue(void *obj)
 		}
 	}
 	ao2_ref(q->members, -1);
+	ao2_cleanup(q->ready_members);
 }
 
 static struct call_queue *alloc_queue(const char *queuename)
@@ -3876,6 +3981,18 @@ static struct call_queue *find_queue_by_name_rt(const char *queuename, struct as
 	return q;
 }
 
+/*!
+ * \internal
+ * \brief Whether something loaded from realtime at the given time may still be used
+ *
+ * \note The queue must be locked.
+ */
+static int realtime_cache_fresh(const struct timeval *loaded)
+{
+	return realtime_cache_ttl > 0 && !ast_tvzero(*loaded)
+		&& ast_tvdiff_ms(ast_tvnow(), *loaded) < realtime_cache_ttl * 1000;
+}
+
 /*!
  * note  */
 
@@ -3895,10 +4012,21 @@ static struct call_queue *find_load_queue_rt_friendly(const char *queuename)
 		.name = queuename,
 	};
 	int prev_weight = 0;
+	int fresh = 0;
 
 	/* Find the queue in the in-core list first. */
 	q = ao2_t_find(queues, &tmpq, OBJ_POINTER, "Look for queue in memory first");
 
+	if (q && q->realtime) {
+		/* Spare the database if the queue was loaded recently enough */
+		ao2_lock(q);
+		fresh = realtime_cache_fresh(&q->rt_loaded);
+		ao2_unlock(q);
+		if (fresh) {
+			return q;
+		}
+	}
+
 	if (!q || q->realtime) {
 		/*! \note Load from realtime before taking the "queues" container lock, to avoid blocking all
 		   queue operations while waiting for the DB.
@@ -3928,6 +4056,9 @@ static struct call_queue *find_load_queue_rt_friendly(const char *queuename)
 
 		/* update the use_weight value if the queue's has gained or lost a weight */
 		if (q) {
+			ao2_lock(q);
+			q->rt_loaded = q->rt_members_loaded = ast_tvnow();
+			ao2_unlock(q);
 			if (!q->weight && prev_weight) {
 				ast_atomic_fetchadd_int(&use_weight, -1);
 			}
@@ -3998,6 +4129,18 @@ static void update_realtime_members(struct call_queue *q)
 	struct member *m;
 	char *category = NULL;
 	struct ao2_iterator mem_iter;
+	int fresh;
+
+	ao2_lock(q);
+	fresh = realtime_cache_fresh(&q->rt_members_loaded);
+	if (!fresh) {
+		/* Set now so callers arriving meanwhile do not query the database as well */
+		q->rt_members_loaded = ast_tvnow();
+	}
+	ao2_unlock(q);
+	if (fresh) {
+		return;
+	}
 
 	if (!(member_config = ast_load_realtime_multientry("queue_members", "interface LIKE", "%", "queue_name", q->name , SENTINEL))) {
 		/* This queue doesn't have realtime members. If the queue still has any realtime
@@ -4412,6 +4555,8 @@ static void leave_queue(struct queue_ent *qe)
 			prev = current;
 		}
 	}
+	/* The callers after us moved up, which may have made it their turn */
+	queue_wake_callers(q);
 	ao2_unlock(q);
 
 	/*If the queue is a realtime queue, check to see if it's still defined in real time*/
@@ -4507,7 +4652,8 @@ static int num_available_members(struct call_queue *q)
 	int avl = 0;
 	struct ao2_iterator mem_iter;
 
-	mem_iter = ao2_iterator_init(q->members, 0);
+	/* Only members whose state lets them take a call can be available */
+	mem_iter = ao2_iterator_init(q->ready_members, 0);
 	while ((mem = ao2_iterator_next(&mem_iter))) {
 
 		avl += is_member_available(q, mem);
@@ -5941,9 +6087,14 @@ static int wait_our_turn(struct queue_ent *qe, int ringing, enum queue_result *r
 			break;
 		}
 
-		/* Wait a second before checking again */
-		if ((res = ast_waitfordigit(qe->chan, RECHECK * 1000))) {
-			if (res > 0 && !valid_exit(qe, res)) {
+		/* Wait a second before checking again, or until it may have become our turn */
+		if ((res = ast_waitfordigit_full(qe->chan, RECHECK * 1000, NULL, -1,
+				ast_alertpipe_readfd(qe->wake_pipe)))) {
+			if (res == 1) {
+				/* Woken up by queue_wake_callers() */
+				ast_alertpipe_flush(qe->wake_pipe);
+				res = 0;
+			} else if (res > 0 && !valid_exit(qe, res)) {
 				res = 0;
 			} else {
 				break;
@@ -7799,6 +7950,7 @@ static void set_queue_member_pause(struct call_queue *q, struct member *mem, con
 	}
 
 	mem->paused = paused;
+	member_ready_update(q, mem, 1);
 	if (paused) {
 		time(&mem->lastpause); /* update last pause field */
 	}
@@ -7948,6 +8100,7 @@ static void set_queue_member_ringinuse(struct call_queue *q, struct member *mem,
 	}
 
 	mem->ringinuse = ringinuse;
+	member_ready_update(q, mem, 1);
 
 	ast_queue_log(q->name, "NONE", mem->interface, "RINGINUSE", "%d", ringinuse);
 	queue_publish_member_blob(queue_member_ringinuse_type(), queue_member_blob_create(q, mem));
@@ -8671,9 +8824,13 @@ static int queue_exec(struct ast_channel *chan, const char *data)
 	qe.last_periodic_announce_time = time(NULL);
 	qe.last_periodic_announce_sound = 0;
 	qe.valid_digits = 0;
+	/* Without the pipe the caller only finds out it is its turn when it checks */
+	ast_alertpipe_clear(qe.wake_pipe);
+	ast_alertpipe_init(qe.wake_pipe);
 	if (join_queue(args.queuename, &qe, &reason, position)) {
 		ast_log(LOG_WARNING, "Unable to join queue '%s'\n", args.queuename);
 		set_queue_result(chan, reason);
+		ast_alertpipe_close(qe.wake_pipe);
 		return 0;
 	}
 	ast_assert(qe.parent != NULL);
@@ -8894,6 +9051,7 @@ stop:
 	set_queue_variables(qe.parent, qe.chan);
 
 	leave_queue(&qe);
+	ast_alertpipe_close(qe.wake_pipe);
 	if (reason != QUEUE_UNKNOWN)
 		set_queue_result(chan, reason);
 
@@ -9568,6 +9726,7 @@ static void queue_reset_global_params(void)
 	negative_penalty_invalid = 0;
 	log_membername_as_agent = 0;
 	force_longest_waiting_caller = 0;
+	realtime_cache_ttl = 0;
 }
 
 /*! Set the global queue parameters as defined in the "general" section of queues.conf */
@@ -9596,6 +9755,12 @@ static void queue_set_global_params(struct ast_config *cfg)
 	if ((general_val = ast_variable_retrieve(cfg, "general", "force_longest_waiting_caller"))) {
 		force_longest_waiting_caller = ast_true(general_val);
 	}
+	if ((general_val = ast_variable_retrieve(cfg, "general", "realtime_cache_ttl"))) {
+		if (sscanf(general_val, "%30d", &realtime_cache_ttl) != 1 || realtime_cache_ttl < 0) {
+			ast_log(LOG_WARNING, "Invalid realtime_cache_ttl '%s', not caching realtime queues\n", general_val);
+			realtime_cache_ttl = 0;
+		}
+	}
 }
 
 /*! \brief reload information pertaining to a single member
@@ -9704,6 +9869,8 @@ static void reload_single_member(const char *memberdata, struct call_queue *q)
 			ao2_link(q->members, newm);
 			ao2_unlink(q->members, cur);
 			ao2_unlock(q->members);
+			member_ready_update(q, newm, 1);
+			member_ready_update(q, cur, 0);
 		} else {
 			/* Otherwise we need to add using the function that will apply a round robin queue position manually. */
 			member_add_to_queue(q, newm);
@@ -9729,11 +9896,14 @@ static int mark_member_dead(void *obj, void *arg, int flags)
 static int kill_dead_members(void *obj, void *arg, int flags)
 {
 	struct member *member = obj;
+	struct call_queue *q = arg;
 
 	if (!member->delme) {
 		member->status = get_queue_member_status(member);
+		member_ready_update(q, member, 1);
 		return 0;
 	} else {
+		member_ready_update(q, member, 0);
 		return CMP_MATCH;
 	}
 }
@@ -9839,6 +10009,7 @@ static void reload_single_queue(struct ast_config *cfg, struct ast_flags *mask,
 		while ((member = ao2_iterator_next(&mem_iter))) {
 			if (member->dynamic) {
 				member->ringinuse = q->ringinuse;
+				member_ready_update(q, member, 1);
 			}
 			ao2_ref(member, -1);
 		}
@@ -9962,6 +10133,30 @@ static int reload_queues(int reload, struct ast_flags *mask, const char *queuena
  * the statistics for all queues
  * \retval 0 always
  */
+/*!
+ * \internal
+ * \brief Make queues load their realtime configuration again the next time they are used
+ *
+ * \param queuename The queue to flush, or all of them if empty
+ */
+static void realtime_cache_flush(const char *queuename)
+{
+	struct call_queue *q;
+	struct ao2_iterator queue_iter;
+
+	queue_iter = ao2_iterator_init(queues, 0);
+	while ((q = ao2_t_iterator_next(&queue_iter, "Iterate through queues"))) {
+		ao2_lock(q);
+		if (ast_strlen_zero(queuename) || !strcasecmp(q->name, queuename)) {
+			q->rt_loaded = ast_tv(0, 0);
+			q->rt_members_loaded = ast_tv(0, 0);
+		}
+		ao2_unlock(q);
+		queue_t_unref(q, "Done with iterator");
+	}
+	ao2_iterator_destroy(&queue_iter);
+}
+
 static int clear_stats(const char *queuename)
 {
 	struct call_queue *q;
@@ -10004,6 +10199,7 @@ static int reload_handler(int reload, struct ast_flags *mask, const char *queuen
 	}
 	if (ast_test_flag(mask, (QUEUE_RELOAD_PARAMETERS | QUEUE_RELOAD_MEMBER))) {
 		res |= reload_queues(reload, mask, queuename);
+		realtime_cache_flush(queuename);
 	}
 	return res;
 }
@@ -10804,6 +11000,13 @@ static int manager_queue_reset(struct mansession *s, const struct message *m)
 	return 0;
 }
 
+static int manager_queue_realtime_flush(struct mansession *s, const struct message *m)
+{
+	realtime_cache_flush(astman_get_header(m, "Queue"));
+	astman_send_ack(s, m, "Queue realtime cache flushed");
+	return 0;
+}
+
 static char *complete_queue_add_member(const char *line, const char *word, int pos, int state)
 {
 	/* 0 - queue; 1 - add; 2 - member; 3 - <interface>; 4 - to; 5 - <queue>; 6 - penalty; 7 - <penalty>; 8 - as; 9 - <membername> */
@@ -11709,6 +11912,7 @@ static int unload_module(void)
 	ast_manager_unregister("QueuePenalty");
 	ast_manager_unregister("QueueReload");
 	ast_manager_unregister("QueueReset");
+	ast_manager_unregister("QueueRealtimeFlush");
 	ast_manager_unregister("QueueMemberRingInUse");
 	ast_manager_unregister("QueueChangePriorityCaller");
 	ast_manager_unregister("QueueWithdrawCaller");
@@ -11830,6 +12034,7 @@ static int load_module(void)
 	err |= ast_manager_register_xml("QueueRule", 0, manager_queue_rule_show);
 	err |= ast_manager_register_xml("QueueReload", 0, manager_queue_reload);
 	err |= ast_manager_register_xml("QueueReset", 0, manager_queue_reset);
+	err |= ast_manager_register_xml("QueueRealtimeFlush", 0, manager_queue_realtime_flush);
 	err |= ast_manager_register_xml("QueueChangePriorityCaller", 0,  manager_change_priority_caller_on_queue);
 	err |= ast_manager_register_xml("QueueWithdrawCaller", 0,  manager_request_withdraw_caller_from_queue);
 	err |= ast_custom_function_register(&queuevar_function);
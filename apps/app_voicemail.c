@@ -6041,6 +6041,38 @@ static int copy_message(struct ast_channel *chan, struct ast_vm_user *vmu, int i
 #endif
 #if !(defined(IMAP_STORAGE) || defined(ODBC_STORAGE))
 
+/*!
+ * \brief The messages found in a mailbox folder
+ *
+ * Kept until the modification time of the folder changes, so MWI polls and
+ * VM_INFO lookups of a folder that has not changed cost a stat() rather
+ * than a scan of the folder.
+ */
+struct vm_folder_count {
+	/*! The modification time of the folder when it was scanned */
+	struct timespec mtime;
+	/*! The number of messages */
+	int count;
+	/*! Set if there are any message files at all, even of a message being recorded */
+	int any;
+	/*! The path of the folder */
+	char dir[0];
+};
+
+#define FOLDER_COUNT_BUCKETS 511
+static struct ao2_container *folder_counts;
+AO2_STRING_FIELD_HASH_FN(vm_folder_count, dir);
+AO2_STRING_FIELD_CMP_FN(vm_folder_count, dir);
+
+static struct timespec folder_mtime(const struct stat *st)
+{
+#if defined(__APPLE__)
+	return st->st_mtimespec;
+#else
+	return st->st_mtim;
+#endif
+}
+
 static int messagecount(const char *mailbox_id, const char *folder)
 {
 	char *context;
@@ -6059,7 +6091,11 @@ static int __has_voicemail(const char *context, const char *mailbox, const char
 	DIR *dir;
 	struct dirent *de;
 	char fn[256];
+	struct stat st;
+	struct timespec mtime;
+	struct vm_folder_count *counted;
 	int ret = 0;
+	int any = 0;
 	struct alias_mailbox_mapping *mapping;
 	char *c;
 	char *m;
@@ -6089,15 +6125,27 @@ static int __has_voicemail(const char *context, const char *mailbox, const char
 
 	snprintf(fn, sizeof(fn), "%s%s/%s/%s", VM_SPOOL_DIR, c, m, folder);
 
+	if (stat(fn, &st)) {
+		return 0;
+	}
+	mtime = folder_mtime(&st);
+
+	if (folder_counts && (counted = ao2_find(folder_counts, fn, OBJ_SEARCH_KEY))) {
+		if (counted->mtime.tv_sec == mtime.tv_sec && counted->mtime.tv_nsec == mtime.tv_nsec) {
+			ret = shortcircuit ? counted->any : counted->count;
+			ao2_ref(counted, -1);
+			return ret;
+		}
+		ao2_ref(counted, -1);
+	}
+
 	if (!(dir = opendir(fn)))
 		return 0;
 
 	while ((de = readdir(dir))) {
 		if (!strncasecmp(de->d_name, "msg", 3)) {
-			if (shortcircuit) {
-				ret = 1;
-				break;
-			} else if (!strncasecmp(de->d_name + 8, "txt", 3)) {
+			any = 1;
+			if (!strncasecmp(de->d_name + 8, "txt", 3)) {
 				ret++;
 			}
 		}
@@ -6105,7 +6153,26 @@ static int __has_voicemail(const char *context, const char *mailbox, const char
 
 	closedir(dir);
 
-	return ret;
+	/*
+	 * A folder changed within the resolution of its modification time may
+	 * change again without the time changing, so it is only remembered
+	 * once it has been left alone for a while.
+	 */
+	if (folder_counts && st.st_mtime + 1 < time(NULL)
+		&& (counted = ao2_alloc_options(sizeof(*counted) + strlen(fn) + 1, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK))) {
+		counted->mtime = mtime;
+		counted->count = ret;
+		counted->any = any;
+		strcpy(counted->dir, fn); /* Safe */
+
+		ao2_lock(folder_counts);
+		ao2_find(folder_counts, fn, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+		ao2_link_flags(folder_counts, counted, OBJ_NOLOCK);
+		ao2_unlock(folder_counts);
+		ao2_ref(counted, -1);
+	}
+
+	return shortcircuit ? any : ret;
 }
 
 /*!
@@ -15789,6 +15856,10 @@ static int unload_module(void)
 		stop_poll_thread();
 
 	mwi_subscription_tps = ast_taskprocessor_unreference(mwi_subscription_tps);
+#if !(defined(IMAP_STORAGE) || defined(ODBC_STORAGE))
+	ao2_cleanup(folder_counts);
+	folder_counts = NULL;
+#endif
 	ast_unload_realtime("voicemail");
 	ast_unload_realtime("voicemail_data");
 
@@ -15870,6 +15941,12 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+#if !(defined(IMAP_STORAGE) || defined(ODBC_STORAGE))
+	/* Without it folders are scanned every time they are counted */
+	folder_counts = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, FOLDER_COUNT_BUCKETS,
+		vm_folder_count_hash_fn, NULL, vm_folder_count_cmp_fn);
+#endif
+
 	/* compute the location of the voicemail spool directory */
 	snprintf(VM_SPOOL_DIR, sizeof(VM_SPOOL_DIR), "%s/voicemail/", ast_config_AST_SPOOL_DIR);
 
@@ -135,21 +135,26 @@ struct wait_type {
 	const char *name;
 	const char *status;
 	int stop_on_frame_timeout;
-	int (*func)(struct ast_dsp *, struct ast_frame *, int *);
+	int (*func)(struct ast_dsp *, struct ast_dsp_vad_latest *, struct ast_frame *, int *);
 };
 
+static int waitfor_silence(struct ast_dsp *dsp, struct ast_dsp_vad_latest *latest, struct ast_frame *f, int *totalsilence)
+{
+	return ast_dsp_silence_vad(dsp, latest, f, totalsilence, NULL);
+}
+
 static const struct wait_type wait_for_silence = {
 	.name = "silence",
 	.status = "SILENCE",
 	.stop_on_frame_timeout = 1,
-	.func = ast_dsp_silence,
+	.func = waitfor_silence,
 };
 
 static const struct wait_type wait_for_noise = {
 	.name = "noise",
 	.status = "NOISE",
 	.stop_on_frame_timeout = 0,
-	.func = ast_dsp_noise,
+	.func = ast_dsp_noise_vad,
 };
 
 static int do_waiting(struct ast_channel *chan, int timereqd, time_t waitstart, int timeout, const struct wait_type *wait_for)
@@ -157,6 +162,8 @@ static int do_waiting(struct ast_channel *chan, int timereqd, time_t waitstart,
 	RAII_VAR(struct ast_format *, rfmt, NULL, ao2_cleanup);
 	int res;
 	struct ast_dsp *sildet;
+	struct ast_dsp_vad_latest vad = { .pending = 0, };
+	int vad_id;
 
 	rfmt = ao2_bump(ast_channel_readformat(chan));
 	if ((res = ast_set_read_format(chan, ast_format_slin)) < 0) {
@@ -171,6 +178,9 @@ static int do_waiting(struct ast_channel *chan, int timereqd, time_t waitstart,
 	}
 	ast_dsp_set_threshold(sildet, ast_dsp_get_threshold_from_settings(THRESHOLD_SILENCE));
 
+	/* Frames are measured here if the channel's shared analysis is unavailable */
+	vad_id = ast_dsp_vad_subscribe(chan, ast_dsp_vad_latest_cb, &vad);
+
 	for (;;) {
 		int dsptime = 0;
 
@@ -195,7 +205,7 @@ static int do_waiting(struct ast_channel *chan, int timereqd, time_t waitstart,
 				break;
 			}
 			if (f->frametype == AST_FRAME_VOICE) {
-				wait_for->func(sildet, f, &dsptime);
+				wait_for->func(sildet, &vad, f, &dsptime);
 			}
 			ast_frfree(f);
 		}
@@ -222,6 +232,9 @@ static int do_waiting(struct ast_channel *chan, int timereqd, time_t waitstart,
 		ast_log(LOG_WARNING, "Unable to restore format %s to channel '%s'\n", ast_format_get_name(rfmt), ast_channel_name(chan));
 	}
 
+	if (vad_id >= 0) {
+		ast_dsp_vad_unsubscribe(chan, vad_id);
+	}
 	ast_dsp_free(sildet);
 	return res;
 }
@@ -319,6 +319,18 @@
 						or 80.
 					</para></description>
 				</configOption>
+				<configOption name="mixing_threads" default="1">
+					<synopsis>Sets the maximum number of threads used to mix the bridge</synopsis>
+					<description><para>
+						Sets the maximum number of threads used to mix audio for the bridge.
+						By default a single thread mixes the whole conference, which limits
+						a very large conference to one CPU core.  When set higher, conferences
+						with many participants split the participants across up to this many
+						threads for each mixing interval.  Small conferences continue to use a
+						single thread.  This option has no effect when binaural_active is
+						enabled.
+					</para></description>
+				</configOption>
 				<configOption name="binaural_active">
 					<synopsis>If true binaural conferencing with stereo audio is active</synopsis>
 					<description><para>
@@ -367,6 +379,20 @@
 						a <replaceable>record_file</replaceable> but not overwrite existing recordings.
 					</para></description>
 				</configOption>
+				<configOption name="record_mix_tap" default="no">
+					<synopsis>Record the conference from the mix rather than with a recorder channel</synopsis>
+					<description><para>
+						When set to yes, the conference is recorded by taking the mix of the whole
+						conference straight from the mixing bridge and writing it to the
+						<replaceable>record_file</replaceable> from a thread of its own, rather than
+						by having a recorder channel join the conference and run <literal>MixMonitor</literal>.
+						This saves the recorder channel's own mix, translation and audiohooks.
+						<replaceable>record_file_append</replaceable> and <replaceable>record_command</replaceable>
+						are honored, but <replaceable>record_options</replaceable> are MixMonitor's own, so
+						a conference with <replaceable>record_options</replaceable> is still recorded by
+						a recorder channel.
+					</para></description>
+				</configOption>
 				<configOption name="record_options" default="">
 					<synopsis>Pass additional options to MixMonitor when recording</synopsis>
 					<description><para>
@@ -1744,6 +1770,8 @@ static char *handle_cli_confbridge_show_bridge_profile(struct ast_cli_entry *e,
 		ast_cli(a->fd,"Mixing Interval:      Default 20ms\n");
 	}
 
+	ast_cli(a->fd,"Mixing Threads:       %u\n", b_profile.mixing_threads);
+
 	ast_cli(a->fd,"Record Conference:    %s\n",
 		b_profile.flags & BRIDGE_OPT_RECORD_CONFERENCE ?
 		"yes" : "no");
@@ -1756,6 +1784,10 @@ static char *handle_cli_confbridge_show_bridge_profile(struct ast_cli_entry *e,
 		b_profile.flags & BRIDGE_OPT_RECORD_FILE_TIMESTAMP ?
 		"yes" : "no");
 
+	ast_cli(a->fd,"Record Mix Tap:       %s\n",
+		b_profile.flags & BRIDGE_OPT_RECORD_MIX_TAP ?
+		"yes" : "no");
+
 	ast_cli(a->fd,"Record File:          %s\n",
 		ast_strlen_zero(b_profile.rec_file) ? "Auto Generated" :
 		b_profile.rec_file);
@@ -2465,10 +2497,12 @@ int conf_load_config(void)
 	aco_option_register(&cfg_info, "binaural_active", ACO_EXACT, bridge_types, "no", OPT_BOOLFLAG_T, 1, FLDSET(struct bridge_profile, flags), BRIDGE_OPT_BINAURAL_ACTIVE);
 	aco_option_register_custom(&cfg_info, "maximum_sample_rate", ACO_EXACT, bridge_types, "none", sample_rate_handler, 0);
 	aco_option_register_custom(&cfg_info, "mixing_interval", ACO_EXACT, bridge_types, "20", mix_interval_handler, 0);
+	aco_option_register(&cfg_info, "mixing_threads", ACO_EXACT, bridge_types, "1", OPT_UINT_T, 0, FLDSET(struct bridge_profile, mixing_threads));
 	aco_option_register(&cfg_info, "record_conference", ACO_EXACT, bridge_types, "no", OPT_BOOLFLAG_T, 1, FLDSET(struct bridge_profile, flags), BRIDGE_OPT_RECORD_CONFERENCE);
 	aco_option_register_custom(&cfg_info, "video_mode", ACO_EXACT, bridge_types, NULL, video_mode_handler, 0);
 	aco_option_register(&cfg_info, "record_file_append", ACO_EXACT, bridge_types, "yes", OPT_BOOLFLAG_T, 1, FLDSET(struct bridge_profile, flags), BRIDGE_OPT_RECORD_FILE_APPEND);
 	aco_option_register(&cfg_info, "record_file_timestamp", ACO_EXACT, bridge_types, "yes", OPT_BOOLFLAG_T, 1, FLDSET(struct bridge_profile, flags), BRIDGE_OPT_RECORD_FILE_TIMESTAMP);
+	aco_option_register(&cfg_info, "record_mix_tap", ACO_EXACT, bridge_types, "no", OPT_BOOLFLAG_T, 1, FLDSET(struct bridge_profile, flags), BRIDGE_OPT_RECORD_MIX_TAP);
 	aco_option_register(&cfg_info, "max_members", ACO_EXACT, bridge_types, "0", OPT_UINT_T, 0, FLDSET(struct bridge_profile, max_members));
 	aco_option_register(&cfg_info, "record_file", ACO_EXACT, bridge_types, NULL, OPT_CHAR_ARRAY_T, 0, CHARFLDSET(struct bridge_profile, rec_file));
 	aco_option_register(&cfg_info, "record_options", ACO_EXACT, bridge_types, NULL, OPT_CHAR_ARRAY_T, 0, CHARFLDSET(struct bridge_profile, rec_options));
@@ -0,0 +1,244 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief ConfBridge recording from a tap on the conference mix
+ *
+ * Rather than having a recorder channel join the conference and run
+ * MixMonitor on it, the mix of the whole conference is taken straight
+ * from the mixing technology.  The mixing thread only copies each mix
+ * onto a queue, a thread of the recording writes them to the file.
+ */
+
+#include "asterisk.h"
+
+#include <fcntl.h>
+
+#include "asterisk/bridge.h"
+#include "asterisk/file.h"
+#include "asterisk/frame.h"
+#include "asterisk/lock.h"
+#include "asterisk/paths.h"
+#include "asterisk/pbx.h"
+#include "asterisk/utils.h"
+#include "include/confbridge.h"
+
+/*! The most mixes queued for the writer, 10 seconds of 20ms mixes */
+#define MIX_RECORDER_MAX_QUEUE 500
+
+struct conf_mix_recorder {
+	/*! Protects frames, queued and stop */
+	ast_mutex_t lock;
+	/*! Signalled when frames are queued or the recording stops */
+	ast_cond_t cond;
+	/*! The mixes waiting to be written */
+	AST_LIST_HEAD_NOLOCK(, ast_frame) frames;
+	/*! How many mixes are waiting */
+	unsigned int queued;
+	/*! How many mixes were dropped, the writer falling behind */
+	unsigned int dropped;
+	/*! Set when the recording stops */
+	unsigned int stop:1;
+	/*! The file written, only used by the writer */
+	struct ast_filestream *fs;
+	/*! Run once the file is closed, NULL if nothing is */
+	char *command;
+};
+
+static void mix_recorder_destroy(void *obj)
+{
+	struct conf_mix_recorder *recorder = obj;
+	struct ast_frame *frame;
+
+	while ((frame = AST_LIST_REMOVE_HEAD(&recorder->frames, frame_list))) {
+		ast_frfree(frame);
+	}
+	if (recorder->fs) {
+		ast_closestream(recorder->fs);
+	}
+	ast_free(recorder->command);
+	ast_cond_destroy(&recorder->cond);
+	ast_mutex_destroy(&recorder->lock);
+}
+
+/*! \brief Queue a mix of the conference for the writer, called by the mixing thread */
+static void mix_recorder_tap(struct ast_frame *frame, void *data)
+{
+	struct conf_mix_recorder *recorder = data;
+	struct ast_frame *dup;
+
+	dup = ast_frdup(frame);
+	if (!dup) {
+		return;
+	}
+
+	ast_mutex_lock(&recorder->lock);
+	if (recorder->stop || recorder->queued >= MIX_RECORDER_MAX_QUEUE) {
+		recorder->dropped++;
+		ast_mutex_unlock(&recorder->lock);
+		ast_frfree(dup);
+		return;
+	}
+	AST_LIST_INSERT_TAIL(&recorder->frames, dup, frame_list);
+	if (!recorder->queued++) {
+		ast_cond_signal(&recorder->cond);
+	}
+	ast_mutex_unlock(&recorder->lock);
+}
+
+/*! \brief Thread which writes the queued mixes to the file until the recording stops */
+static void *mix_recorder_thread(void *data)
+{
+	struct conf_mix_recorder *recorder = data;
+	AST_LIST_HEAD_NOLOCK(, ast_frame) frames = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
+	struct ast_frame *frame;
+	int stop = 0;
+
+	while (!stop) {
+		ast_mutex_lock(&recorder->lock);
+		while (!recorder->stop && AST_LIST_EMPTY(&recorder->frames)) {
+			ast_cond_wait(&recorder->cond, &recorder->lock);
+		}
+		AST_LIST_APPEND_LIST(&frames, &recorder->frames, frame_list);
+		recorder->queued = 0;
+		stop = recorder->stop;
+		ast_mutex_unlock(&recorder->lock);
+
+		while ((frame = AST_LIST_REMOVE_HEAD(&frames, frame_list))) {
+			ast_writestream(recorder->fs, frame);
+			ast_frfree(frame);
+		}
+	}
+
+	ast_closestream(recorder->fs);
+	recorder->fs = NULL;
+
+	if (recorder->dropped) {
+		ast_log(LOG_WARNING, "Conference recording dropped %u mixes, writing the file fell behind\n",
+			recorder->dropped);
+	}
+
+	if (recorder->command) {
+		ast_verb(2, "Executing [%s]\n", recorder->command);
+		ast_safe_system(recorder->command);
+	}
+
+	ao2_ref(recorder, -1);
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Open the file a recording is written to
+ *
+ * Like MixMonitor, a relative name is in the monitor directory and the
+ * extension of the name chooses the format, raw if there is none.
+ */
+static struct ast_filestream *mix_recorder_open(const char *filename, int append)
+{
+	struct ast_filestream *fs;
+	char *name;
+	char *ext;
+	char *slash;
+
+	if (*filename == '/') {
+		name = ast_strdupa(filename);
+	} else {
+		name = ast_alloca(strlen(ast_config_AST_MONITOR_DIR) + strlen(filename) + 2);
+		sprintf(name, "%s/%s", ast_config_AST_MONITOR_DIR, filename);
+	}
+
+	slash = strrchr(name, '/');
+	*slash = '\0';
+	ast_mkdir(name, 0777);
+	*slash = '/';
+
+	if ((ext = strrchr(name, '.')) && ext > slash) {
+		*ext++ = '\0';
+	} else {
+		ext = "raw";
+	}
+
+	fs = ast_writefile(name, ext, NULL, O_CREAT | O_WRONLY | (append ? O_APPEND : O_TRUNC), 0, AST_FILE_MODE);
+	if (!fs) {
+		ast_log(LOG_ERROR, "Cannot open %s.%s\n", name, ext);
+	}
+
+	return fs;
+}
+
+struct conf_mix_recorder *conf_mix_recorder_start(struct ast_bridge *bridge, const char *filename,
+	int append, const char *command)
+{
+	struct conf_mix_recorder *recorder;
+	pthread_t thread;
+
+	recorder = ao2_alloc_options(sizeof(*recorder), mix_recorder_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!recorder) {
+		return NULL;
+	}
+	ast_mutex_init(&recorder->lock);
+	ast_cond_init(&recorder->cond, NULL);
+
+	recorder->fs = mix_recorder_open(filename, append);
+	if (!recorder->fs) {
+		ao2_ref(recorder, -1);
+		return NULL;
+	}
+
+	if (!ast_strlen_zero(command)) {
+		char substituted[1024];
+		char *unescaped = ast_strdupa(command);
+		char *pos;
+
+		/* As MixMonitor does, ^{X} is unescaped to ${X} */
+		for (pos = unescaped; *pos; pos++) {
+			if (*pos == '^' && *(pos + 1) == '{') {
+				*pos = '$';
+			}
+		}
+		pbx_substitute_variables_helper(NULL, unescaped, substituted, sizeof(substituted) - 1);
+		recorder->command = ast_strdup(substituted);
+	}
+
+	/* The writer holds a reference until it is done with the file */
+	ao2_ref(recorder, +1);
+	if (ast_pthread_create_detached_background(&thread, NULL, mix_recorder_thread, recorder)) {
+		ast_log(LOG_ERROR, "Cannot start the conference recording writer\n");
+		ao2_ref(recorder, -2);
+		return NULL;
+	}
+
+	ast_bridge_set_mix_tap(bridge, mix_recorder_tap, recorder);
+
+	return recorder;
+}
+
+void conf_mix_recorder_stop(struct ast_bridge *bridge, struct conf_mix_recorder *recorder)
+{
+	if (bridge) {
+		ast_bridge_set_mix_tap(bridge, NULL, NULL);
+	}
+
+	/* The writer finishes the mixes already queued and closes the file */
+	ast_mutex_lock(&recorder->lock);
+	recorder->stop = 1;
+	ast_cond_signal(&recorder->cond);
+	ast_mutex_unlock(&recorder->lock);
+
+	ao2_ref(recorder, -1);
+}
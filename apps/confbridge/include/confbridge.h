@@ -91,6 +91,7 @@ enum bridge_profile_flags {
 	BRIDGE_OPT_REMB_BEHAVIOR_LOWEST_ALL = (1 << 13), /*!< The lowest estimated maximum bitrate from all receivers is sent to each sender */
 	BRIDGE_OPT_REMB_BEHAVIOR_HIGHEST_ALL = (1 << 14), /*!< The highest estimated maximum bitrate from all receivers is sent to each sender */
 	BRIDGE_OPT_REMB_BEHAVIOR_FORCE = (1 << 15), /*!< Force the REMB estimated bitrate to that specifiec in remb_estimated_bitrate */
+	BRIDGE_OPT_RECORD_MIX_TAP = (1 << 16), /*!< Record the conference from a tap on the mix rather than a recorder channel */
 };
 
 enum conf_menu_action_id {
@@ -235,6 +236,7 @@ struct bridge_profile {
 	unsigned int internal_sample_rate; /*!< The internal sample rate of the bridge. 0 when set to auto adjust mode. */
 	unsigned int maximum_sample_rate; /*!< The maximum sample rate of the bridge. 0 when set to no maximum. */
 	unsigned int mix_interval;  /*!< The internal mixing interval used by the bridge. When set to 0 the bridgewill use a default interval. */
+	unsigned int mixing_threads; /*!< The maximum number of threads used to mix the bridge. */
 	struct bridge_profile_sounds *sounds;
 	char regcontext[AST_MAX_CONTEXT];
 	unsigned int video_update_discard; /*!< Amount of time after sending a video update request that subsequent requests should be discarded */
@@ -255,6 +257,7 @@ struct confbridge_conference {
 	unsigned int muted:1;                                             /*!< Is this conference bridge muted? */
 	struct ast_channel *playback_chan;                                /*!< Channel used for playback into the conference bridge */
 	struct ast_channel *record_chan;                                  /*!< Channel used for recording the conference */
+	struct conf_mix_recorder *record_tap;                             /*!< Recording of the conference mix, when there is no record_chan */
 	struct ast_str *record_filename;                                  /*!< Recording filename. */
 	struct ast_str *orig_rec_file;                                    /*!< Previous b_profile.rec_file. */
 	AST_LIST_HEAD_NOLOCK(, confbridge_user) active_list;              /*!< List of users participating in the conference bridge */
@@ -664,6 +667,31 @@ int manager_confbridge_init(void);
  */
 void manager_confbridge_shutdown(void);
 
+/*!
+ * \brief Start recording the mix of a conference bridge
+ *
+ * \param bridge The bridge mixing the conference
+ * \param filename The file to record to, in the monitor directory unless
+ * absolute, the extension choosing the format
+ * \param append Whether to append to the file rather than replace it
+ * \param command Run once the recording is written, or NULL
+ *
+ * \return The recording, NULL on failure
+ */
+struct conf_mix_recorder *conf_mix_recorder_start(struct ast_bridge *bridge, const char *filename,
+	int append, const char *command);
+
+/*!
+ * \brief Stop recording the mix of a conference bridge
+ *
+ * \param bridge The bridge mixing the conference, or NULL if it is gone
+ * \param recorder The recording, whose reference is released
+ *
+ * \note The mixes already taken are still written, and the command run,
+ * after this returns.
+ */
+void conf_mix_recorder_stop(struct ast_bridge *bridge, struct conf_mix_recorder *recorder);
+
 /*!
  * \brief Get ConfBridge record channel technology struct.
  * \since 12.0.0
@@ -47,6 +47,7 @@
 #include "asterisk/frame.h"
 #include "asterisk/musiconhold.h"
 #include "asterisk/format_cache.h"
+#include "asterisk/vector.h"
 
 enum holding_roles {
 	HOLDING_ROLE_PARTICIPANT,
@@ -61,9 +62,13 @@ enum idle_modes {
 	IDLE_MODE_HOLD,
 };
 
+struct holding_moh_source;
+
 /*! \brief Structure which contains per-channel role information */
 struct holding_channel {
 	struct ast_silence_generator *silence_generator;
+	/*! The shared music on hold the participant hears, NULL if it has its own */
+	struct holding_moh_source *moh_source;
 	enum holding_roles role;
 	enum idle_modes idle_mode;
 	/*! TRUE if the entertainment is started. */
@@ -138,6 +143,251 @@ static void participant_idle_mode_setup(struct ast_bridge_channel *bridge_channe
 	}
 }
 
+/*!
+ * \brief Music on hold shared by the participants hearing the same class in the same format
+ *
+ * Rather than every participant running a music on hold generator of its
+ * own, a channel of the source runs one and every frame it writes is
+ * queued, sharing the payload, to all the participants listening.
+ */
+struct holding_moh_source {
+	/*! The channel running the music on hold generator */
+	struct ast_channel *chan;
+	/*! The format the music is written in */
+	struct ast_format *format;
+	/*! The participants listening, protected by the source lock */
+	AST_VECTOR(, struct ast_bridge_channel *) listeners;
+	/*! The music on hold class */
+	char moh_class[0];
+};
+
+/*! The running shared sources, protected by moh_sources_lock */
+static AST_VECTOR(, struct holding_moh_source *) moh_sources;
+AST_MUTEX_DEFINE_STATIC(moh_sources_lock);
+
+static void moh_source_destroy(void *obj)
+{
+	struct holding_moh_source *source = obj;
+
+	ast_channel_cleanup(source->chan);
+	ao2_cleanup(source->format);
+	AST_VECTOR_FREE(&source->listeners);
+}
+
+/*! \brief Queue the music written by the generator of a source to its listeners */
+static int moh_source_write(struct ast_channel *chan, struct ast_frame *frame)
+{
+	struct holding_moh_source *source = ast_channel_tech_pvt(chan);
+	struct ast_frame *shared = NULL;
+	int idx;
+
+	if (!source || frame->frametype != AST_FRAME_VOICE) {
+		return 0;
+	}
+
+	ao2_lock(source);
+	if (AST_VECTOR_SIZE(&source->listeners) > 1) {
+		shared = ast_frdup_shared(frame);
+	}
+	for (idx = 0; idx < AST_VECTOR_SIZE(&source->listeners); ++idx) {
+		ast_bridge_channel_queue_frame(AST_VECTOR_GET(&source->listeners, idx), shared ?: frame);
+	}
+	ao2_unlock(source);
+	ast_frfree(shared);
+
+	return 0;
+}
+
+static const struct ast_channel_tech moh_source_tech = {
+	.type = "HoldingMOH",
+	.description = "Holding bridge shared music on hold",
+	.write = moh_source_write,
+};
+
+/*! \brief Thread driving the music on hold generator of a source until it is hung up */
+static void *moh_source_thread(void *data)
+{
+	struct holding_moh_source *source = data;
+	struct ast_channel *chan = source->chan;
+	struct ast_frame *frame;
+
+	/* The generator is run from the channel timer when the channel is read */
+	while (ast_waitfor(chan, -1) >= 0 && (frame = ast_read(chan))) {
+		ast_frfree(frame);
+	}
+
+	ast_moh_stop(chan);
+	ast_channel_lock(chan);
+	ast_channel_tech_pvt_set(chan, NULL);
+	ast_channel_unlock(chan);
+
+	ao2_ref(source, -1);
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Start a source of music on hold of a class in a format
+ *
+ * \return The source on success, with a reference for the caller.
+ * \retval NULL on error.
+ */
+static struct holding_moh_source *moh_source_alloc(const char *moh_class, struct ast_format *format)
+{
+	struct holding_moh_source *source;
+	struct ast_format_cap *caps;
+	pthread_t thread;
+
+	source = ao2_alloc(sizeof(*source) + strlen(moh_class) + 1, moh_source_destroy);
+	if (!source) {
+		return NULL;
+	}
+	strcpy(source->moh_class, moh_class); /* Safe */
+	source->format = ao2_bump(format);
+	if (AST_VECTOR_INIT(&source->listeners, 8)) {
+		ao2_ref(source, -1);
+		return NULL;
+	}
+
+	caps = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+	if (!caps || ast_format_cap_append(caps, format, 0)) {
+		ao2_cleanup(caps);
+		ao2_ref(source, -1);
+		return NULL;
+	}
+
+	source->chan = ast_channel_alloc(0, AST_STATE_UP, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0,
+		"HoldingMOH/%s-%s", moh_class, ast_format_get_name(format));
+	if (!source->chan) {
+		ao2_ref(caps, -1);
+		ao2_ref(source, -1);
+		return NULL;
+	}
+	ast_channel_tech_set(source->chan, &moh_source_tech);
+	ast_channel_tech_pvt_set(source->chan, source);
+	ast_channel_nativeformats_set(source->chan, caps);
+	ao2_ref(caps, -1);
+	ast_channel_set_writeformat(source->chan, format);
+	ast_channel_set_rawwriteformat(source->chan, format);
+	ast_channel_set_readformat(source->chan, format);
+	ast_channel_set_rawreadformat(source->chan, format);
+	ast_channel_unlock(source->chan);
+	/* The source holds its own reference, the thread the one hung up */
+	ast_channel_ref(source->chan);
+
+	if (ast_moh_start(source->chan, moh_class, NULL)) {
+		ast_hangup(source->chan);
+		ao2_ref(source, -1);
+		return NULL;
+	}
+
+	ao2_ref(source, +1);
+	if (ast_pthread_create_detached_background(&thread, NULL, moh_source_thread, source)) {
+		ast_moh_stop(source->chan);
+		ast_hangup(source->chan);
+		ao2_ref(source, -2);
+		return NULL;
+	}
+
+	return source;
+}
+
+/*!
+ * \internal
+ * \brief Have a participant listen to the shared music on hold of a class
+ *
+ * The music is shared with the participants hearing the class in the same
+ * format the participant is written in, so it is written as it is queued.
+ *
+ * \return The source listened to, with a reference for the participant.
+ * \retval NULL if the participant could not listen.
+ */
+static struct holding_moh_source *moh_source_join(struct ast_bridge_channel *bridge_channel,
+	const char *moh_class)
+{
+	struct holding_moh_source *source = NULL;
+	struct ast_format *format;
+	int idx;
+
+	if (ast_strlen_zero(moh_class)) {
+		moh_class = ast_channel_musicclass(bridge_channel->chan);
+	}
+	if (ast_strlen_zero(moh_class)) {
+		moh_class = "default";
+	}
+
+	ast_channel_lock(bridge_channel->chan);
+	format = ao2_bump(ast_channel_writeformat(bridge_channel->chan));
+	ast_channel_unlock(bridge_channel->chan);
+
+	ast_mutex_lock(&moh_sources_lock);
+	for (idx = 0; idx < AST_VECTOR_SIZE(&moh_sources); ++idx) {
+		struct holding_moh_source *cur = AST_VECTOR_GET(&moh_sources, idx);
+
+		if (!strcmp(cur->moh_class, moh_class)
+			&& ast_format_cmp(cur->format, format) == AST_FORMAT_CMP_EQUAL) {
+			source = ao2_bump(cur);
+			break;
+		}
+	}
+	if (!source) {
+		source = moh_source_alloc(moh_class, format);
+		if (source && AST_VECTOR_APPEND(&moh_sources, source)) {
+			ast_softhangup(source->chan, AST_SOFTHANGUP_EXPLICIT);
+			ao2_ref(source, -1);
+			source = NULL;
+		}
+		if (source) {
+			/* The vector holds the reference of the allocation */
+			ao2_ref(source, +1);
+		}
+	}
+	if (source) {
+		ao2_lock(source);
+		if (AST_VECTOR_APPEND(&source->listeners, bridge_channel)) {
+			ao2_unlock(source);
+			ao2_ref(source, -1);
+			source = NULL;
+		} else {
+			ao2_ref(bridge_channel, +1);
+			ao2_unlock(source);
+		}
+	}
+	ast_mutex_unlock(&moh_sources_lock);
+
+	ao2_ref(format, -1);
+	return source;
+}
+
+/*!
+ * \internal
+ * \brief Stop a participant listening to shared music on hold
+ *
+ * The source stops when its last listener leaves.
+ */
+static void moh_source_leave(struct ast_bridge_channel *bridge_channel, struct holding_moh_source *source)
+{
+	int stop;
+
+	ast_mutex_lock(&moh_sources_lock);
+	ao2_lock(source);
+	if (!AST_VECTOR_REMOVE_ELEM_UNORDERED(&source->listeners, bridge_channel, AST_VECTOR_ELEM_CLEANUP_NOOP)) {
+		ao2_ref(bridge_channel, -1);
+	}
+	stop = !AST_VECTOR_SIZE(&source->listeners);
+	ao2_unlock(source);
+	if (stop) {
+		AST_VECTOR_REMOVE_ELEM_UNORDERED(&moh_sources, source, ao2_cleanup);
+	}
+	ast_mutex_unlock(&moh_sources_lock);
+
+	/* Not under the source lock, the generator writes with the channel locked */
+	if (stop) {
+		ast_softhangup(source->chan, AST_SOFTHANGUP_EXPLICIT);
+	}
+	ao2_ref(source, -1);
+}
+
 static void participant_entertainment_stop(struct ast_bridge_channel *bridge_channel)
 {
 	struct holding_channel *hc = bridge_channel->tech_pvt;
@@ -152,7 +402,12 @@ static void participant_entertainment_stop(struct ast_bridge_channel *bridge_cha
 
 	switch (hc->idle_mode) {
 	case IDLE_MODE_MOH:
-		ast_moh_stop(bridge_channel->chan);
+		if (hc->moh_source) {
+			moh_source_leave(bridge_channel, hc->moh_source);
+			hc->moh_source = NULL;
+		} else {
+			ast_moh_stop(bridge_channel->chan);
+		}
 		break;
 	case IDLE_MODE_RINGING:
 		ast_indicate(bridge_channel->chan, -1);
@@ -201,6 +456,14 @@ static void participant_entertainment_start(struct ast_bridge_channel *bridge_ch
 	switch(hc->idle_mode) {
 	case IDLE_MODE_MOH:
 		moh_class = ast_bridge_channel_get_role_option(bridge_channel, "holding_participant", "moh_class");
+		if (ast_true(ast_bridge_channel_get_role_option(bridge_channel, "holding_participant", "moh_shared"))) {
+			hc->moh_source = moh_source_join(bridge_channel, moh_class);
+			if (hc->moh_source) {
+				break;
+			}
+			ast_debug(1, "Bridge %s: Could not share music on hold with %s, starting its own\n",
+				bridge_channel->bridge->uniqueid, ast_channel_name(bridge_channel->chan));
+		}
 		if (ast_moh_start(bridge_channel->chan, moh_class, NULL)) {
 			ast_log(LOG_WARNING, "Failed to start moh, starting silence generator instead\n");
 			hc->idle_mode = IDLE_MODE_SILENCE;
@@ -427,11 +690,15 @@ static void deferred_action(struct ast_bridge_channel *bridge_channel, const voi
 static int unload_module(void)
 {
 	ast_bridge_technology_unregister(&holding_bridge);
+	AST_VECTOR_FREE(&moh_sources);
 	return 0;
 }
 
 static int load_module(void)
 {
+	if (AST_VECTOR_INIT(&moh_sources, 8)) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
 	if (ast_bridge_technology_register(&holding_bridge)) {
 		unload_module();
 		return AST_MODULE_LOAD_DECLINE;
@@ -277,6 +277,47 @@ static enum ast_rtp_glue_result rtp_glue_get_current_combined_result(struct ast_
 	return combined_result;
 }
 
+/*!
+ * \internal
+ * \brief Tell the RTP engine of an instance whether it is locally bridged
+ *
+ * The engine may have the packets of a locally bridged instance forwarded
+ * by a thread of its own, waking the channel through another file
+ * descriptor, so the channel is pointed at whatever the instance uses now.
+ *
+ * \param chan The channel of the instance, locked
+ * \param instance The instance
+ * \param peer The instance it is bridged with, NULL when the bridge ends
+ */
+static void native_rtp_local_bridge(struct ast_channel *chan, struct ast_rtp_instance *instance,
+	struct ast_rtp_instance *peer)
+{
+	struct ast_rtp_engine *engine = ast_rtp_instance_get_engine(instance);
+	int old_fd;
+	int new_fd;
+	int i;
+
+	if (!engine->local_bridge) {
+		return;
+	}
+
+	old_fd = ast_rtp_instance_fd(instance, 0);
+	engine->local_bridge(instance, peer);
+	new_fd = ast_rtp_instance_fd(instance, 0);
+	if (old_fd == new_fd || old_fd < 0) {
+		return;
+	}
+
+	for (i = 0; i < ast_channel_fd_count(chan); ++i) {
+		if (ast_channel_fd(chan, i) == old_fd) {
+			ast_channel_set_fd(chan, i, new_fd);
+		}
+	}
+
+	/* Have the channel thread wait on the new file descriptor */
+	ast_queue_frame(chan, &ast_null_frame);
+}
+
 /*!
  * \internal
  * \brief Start native RTP bridging of two channels
@@ -338,12 +379,8 @@ static void native_rtp_bridge_start(struct ast_bridge *bridge, struct ast_channe
 
 	switch (native_type) {
 	case AST_RTP_GLUE_RESULT_LOCAL:
-		if (ast_rtp_instance_get_engine(glue0->audio.instance)->local_bridge) {
-			ast_rtp_instance_get_engine(glue0->audio.instance)->local_bridge(glue0->audio.instance, glue1->audio.instance);
-		}
-		if (ast_rtp_instance_get_engine(glue1->audio.instance)->local_bridge) {
-			ast_rtp_instance_get_engine(glue1->audio.instance)->local_bridge(glue1->audio.instance, glue0->audio.instance);
-		}
+		native_rtp_local_bridge(bc0->chan, glue0->audio.instance, glue1->audio.instance);
+		native_rtp_local_bridge(bc1->chan, glue1->audio.instance, glue0->audio.instance);
 		ast_rtp_instance_set_bridged(glue0->audio.instance, glue1->audio.instance);
 		ast_rtp_instance_set_bridged(glue1->audio.instance, glue0->audio.instance);
 		ast_verb(4, "Locally RTP bridged '%s' and '%s' in stack\n",
@@ -491,12 +528,8 @@ static void native_rtp_bridge_stop(struct ast_bridge *bridge, struct ast_channel
 
 	switch (glue0->result) {
 	case AST_RTP_GLUE_RESULT_LOCAL:
-		if (ast_rtp_instance_get_engine(glue0->audio.instance)->local_bridge) {
-			ast_rtp_instance_get_engine(glue0->audio.instance)->local_bridge(glue0->audio.instance, NULL);
-		}
-		if (ast_rtp_instance_get_engine(glue1->audio.instance)->local_bridge) {
-			ast_rtp_instance_get_engine(glue1->audio.instance)->local_bridge(glue1->audio.instance, NULL);
-		}
+		native_rtp_local_bridge(bc0->chan, glue0->audio.instance, NULL);
+		native_rtp_local_bridge(bc1->chan, glue1->audio.instance, NULL);
 		ast_rtp_instance_set_bridged(glue0->audio.instance, NULL);
 		ast_rtp_instance_set_bridged(glue1->audio.instance, NULL);
 		break;
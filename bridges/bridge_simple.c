@@ -40,6 +40,7 @@
 #include "asterisk/module.h"
 #include "asterisk/channel.h"
 #include "asterisk/bridge.h"
+#include "asterisk/bridge_channel.h"
 #include "asterisk/bridge_technology.h"
 #include "asterisk/frame.h"
 #include "asterisk/stream.h"
@@ -194,11 +195,90 @@ static int simple_bridge_join(struct ast_bridge *bridge, struct ast_bridge_chann
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Write a media frame straight to the channel of the other party
+ *
+ * Queuing a frame for the other party copies it and wakes the thread of
+ * that party just to write it.  When nothing of that party needs to see
+ * the frame first, and nothing is queued for it that the frame would
+ * overtake, the frame is written to its channel here instead.
+ *
+ * \note The bridge is locked.
+ *
+ * \retval 0 if the frame was written, or discarded as the queue would have
+ * \retval -1 if the frame has to be queued
+ */
+static int simple_bridge_write_direct(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel, struct ast_frame *frame)
+{
+	struct ast_bridge_channel *peer;
+	struct ast_channel *chan;
+	int num = -1;
+
+	if ((frame->frametype != AST_FRAME_VOICE && frame->frametype != AST_FRAME_VIDEO)
+		|| !bridge_channel || bridge->num_channels != 2) {
+		return -1;
+	}
+
+	peer = AST_LIST_FIRST(&bridge->channels);
+	if (peer == bridge_channel) {
+		peer = AST_LIST_LAST(&bridge->channels);
+	}
+	if (peer == bridge_channel) {
+		return -1;
+	}
+
+	ast_bridge_channel_lock(peer);
+	if (peer->state != BRIDGE_CHANNEL_STATE_WAIT
+		|| peer->suspended
+		|| peer->dtmf_hook_state.collected[0]
+		|| !AST_LIST_EMPTY(&peer->wr_queue)) {
+		ast_bridge_channel_unlock(peer);
+		return -1;
+	}
+
+	if (frame->stream_num > -1) {
+		if (frame->stream_num < (int)AST_VECTOR_SIZE(&peer->stream_map.to_channel)) {
+			num = AST_VECTOR_GET(&peer->stream_map.to_channel, frame->stream_num);
+		}
+		if (num == -1) {
+			/* We don't have a mapped stream so just discard this frame. */
+			ast_bridge_channel_unlock(peer);
+			return 0;
+		}
+	}
+
+	/*
+	 * Don't wait for the channel.  Holding it before letting go of the bridge
+	 * channel keeps anything queued from now on behind this frame.
+	 */
+	chan = peer->chan;
+	if (ast_channel_trylock(chan)) {
+		ast_bridge_channel_unlock(peer);
+		return -1;
+	}
+	ast_bridge_channel_unlock(peer);
+
+	if (ast_channel_has_audio_frame_or_monitor(chan)) {
+		ast_channel_unlock(chan);
+		return -1;
+	}
+
+	ast_write_stream(chan, num, frame);
+	ast_channel_unlock(chan);
+
+	return 0;
+}
+
 static int simple_bridge_write(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel, struct ast_frame *frame)
 {
 	const struct ast_control_t38_parameters *t38_parameters;
 	int defer = 0;
 
+	if (!simple_bridge_write_direct(bridge, bridge_channel, frame)) {
+		return 0;
+	}
+
 	if (!ast_bridge_queue_everyone_else(bridge, bridge_channel, frame)) {
 		/* This frame was successfully queued so no need to defer */
 		return 0;
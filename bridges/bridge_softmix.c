@@ -35,6 +35,8 @@
 
 #include <math.h>
 
+#include "asterisk/affinity.h"
+#include "asterisk/latency.h"
 #include "asterisk/stream.h"
 #include "asterisk/test.h"
 #include "asterisk/vector.h"
@@ -56,6 +58,9 @@
 /*! \brief Number of mixing iterations to perform between gathering statistics. */
 #define SOFTMIX_STAT_INTERVAL 100
 
+/*! \brief Minimum number of channels each mixing thread must have to share the mixing. */
+#define SOFTMIX_MIN_CHANNELS_PER_THREAD 50
+
 /*!
  * \brief Default time in ms of silence necessary to declare talking stopped by the bridge.
  *
@@ -68,6 +73,9 @@
 /*! Default minimum average magnitude threshold to determine talking by the DSP. */
 #define DEFAULT_SOFTMIX_TALKING_THRESHOLD 160
 
+/*! How far mixing passes run past the mixing interval */
+static struct ast_latency_histogram *mixing_overrun_latency;
+
 #define SOFTBRIDGE_VIDEO_DEST_PREFIX "softbridge_dest"
 #define SOFTBRIDGE_VIDEO_DEST_LEN strlen(SOFTBRIDGE_VIDEO_DEST_PREFIX)
 #define SOFTBRIDGE_VIDEO_DEST_SEPARATOR '_'
@@ -106,6 +114,10 @@ struct softmix_translate_helper_entry {
 	struct ast_format *dst_format; /*!< The destination format for this helper */
 	struct ast_trans_pvt *trans_pvt; /*!< the translator for this slot. */
 	struct ast_frame *out_frame; /*!< The output frame from the last translation */
+	/*! Listeners sent the same frame during the current mixing interval */
+	AST_VECTOR(, struct ast_bridge_channel *) listeners;
+	/*! The frame whose payload the listeners share */
+	struct ast_frame *listener_frame;
 	AST_LIST_ENTRY(softmix_translate_helper_entry) entry;
 };
 
@@ -137,6 +149,8 @@ static void *softmix_translate_helper_free_entry(struct softmix_translate_helper
 	if (entry->out_frame) {
 		ast_frfree(entry->out_frame);
 	}
+	ast_frfree(entry->listener_frame);
+	AST_VECTOR_FREE(&entry->listeners);
 	ast_free(entry);
 	return NULL;
 }
@@ -205,13 +219,10 @@ static void softmix_process_write_audio(struct softmix_translate_helper *trans_h
 	struct softmix_channel *sc, unsigned int default_sample_size)
 {
 	struct softmix_translate_helper_entry *entry = NULL;
-	int i;
 
 	/* If we provided any audio then take it out while in slinear format. */
 	if (sc->have_audio && !sc->binaural) {
-		for (i = 0; i < sc->write_frame.samples; i++) {
-			ast_slinear_saturated_subtract(&sc->final_buf[i], &sc->our_buf[i]);
-		}
+		ast_slinear_saturated_subtract_buf(sc->final_buf, sc->our_buf, sc->write_frame.samples);
 		/* check to see if any entries exist for the format. if not we'll want
 		   to remove it during cleanup */
 		AST_LIST_TRAVERSE(&trans_helper->entries, entry, entry) {
@@ -284,6 +295,8 @@ static void softmix_translate_helper_cleanup(struct softmix_translate_helper *tr
 			ast_frfree(entry->out_frame);
 			entry->out_frame = NULL;
 		}
+		ast_frfree(entry->listener_frame);
+		entry->listener_frame = NULL;
 
 		/* nothing is optimized for a single path reference, so there is
 		   no reason to continue to hold onto the codec */
@@ -748,6 +761,9 @@ static int softmix_bridge_join(struct ast_bridge *bridge, struct ast_bridge_chan
 	/* Can't forget the lock */
 	ast_mutex_init(&sc->lock);
 
+	/* Share the measuring of the frames read with other detectors on the channel */
+	sc->vad_id = ast_dsp_vad_subscribe(bridge_channel->chan, ast_dsp_vad_latest_cb, &sc->vad);
+
 	/* Can't forget to record our pvt structure within the bridged channel structure */
 	bridge_channel->tech_pvt = sc;
 
@@ -837,6 +853,10 @@ static void softmix_bridge_leave(struct ast_bridge *bridge, struct ast_bridge_ch
 
 	bridge_channel->tech_pvt = NULL;
 
+	if (sc->vad_id >= 0) {
+		ast_dsp_vad_unsubscribe(bridge_channel->chan, sc->vad_id);
+	}
+
 	ast_stream_topology_free(sc->topology);
 
 	ao2_cleanup(sc->remb_collector);
@@ -976,7 +996,7 @@ static void softmix_bridge_write_voice(struct ast_bridge *bridge, struct ast_bri
 
 	/* The channel will be leaving soon if there is no dsp. */
 	if (sc->dsp) {
-		silent = ast_dsp_silence_with_energy(sc->dsp, frame, &totalsilence, &cur_energy);
+		silent = ast_dsp_silence_vad(sc->dsp, &sc->vad, frame, &totalsilence, &cur_energy);
 	}
 
 	if (bridge->softmix.video_mode.mode == AST_BRIDGE_VIDEO_MODE_TALKER_SRC) {
@@ -1743,6 +1763,377 @@ static int softmix_mixing_array_grow(struct softmix_mixing_array *mixing_array,
 	return 0;
 }
 
+/*! \brief A channel the mix is written to during a mixing interval */
+struct softmix_write {
+	struct ast_bridge_channel *bridge_channel;
+	/*! Frame shared with the other listeners using the same write format, NULL to mix for this channel alone */
+	struct ast_frame *frame;
+};
+
+AST_VECTOR(softmix_writes, struct softmix_write);
+
+/*!
+ * \internal
+ * \brief Determine how the mix is written to each channel this mixing interval.
+ *
+ * \details Listeners, the channels that did not contribute any audio, all
+ * hear the same mix.  They are grouped by write format so the mix is
+ * translated once per format and the one frame, with a shared payload, is
+ * written to every listener in the group.  Talkers, binaural channels, and listeners that are alone
+ * with their format still have a frame made for them individually.
+ *
+ * \param bridge The bridge being mixed
+ * \param trans_helper Translation paths for the listener groups
+ * \param writes Filled with the channels to write to
+ * \param mix_frame The complete mix of all channels
+ */
+static void softmix_writes_build(struct ast_bridge *bridge,
+	struct softmix_translate_helper *trans_helper, struct softmix_writes *writes,
+	struct ast_frame *mix_frame)
+{
+	struct ast_bridge_channel *bridge_channel;
+	struct softmix_translate_helper_entry *entry;
+	struct softmix_write write = { NULL, };
+	size_t i;
+
+	AST_VECTOR_RESET(writes, AST_VECTOR_ELEM_CLEANUP_NOOP);
+
+	AST_LIST_TRAVERSE(&bridge->channels, bridge_channel, entry) {
+		struct softmix_channel *sc = bridge_channel->tech_pvt;
+		struct ast_format *raw_write_fmt;
+
+		if (!sc || bridge_channel->suspended) {
+			/* This channel failed to join successfully or is suspended. */
+			continue;
+		}
+
+		if (!sc->have_audio && !sc->binaural) {
+			raw_write_fmt = ast_channel_rawwriteformat(bridge_channel->chan);
+			AST_LIST_TRAVERSE(&trans_helper->entries, entry, entry) {
+				if (ast_format_cmp(entry->dst_format, raw_write_fmt) == AST_FORMAT_CMP_EQUAL) {
+					break;
+				}
+			}
+			if (!entry && (entry = softmix_translate_helper_entry_alloc(raw_write_fmt))) {
+				/* Only the listeners actually given the group's frame are counted below. */
+				entry->num_times_requested = 0;
+				AST_LIST_INSERT_HEAD(&trans_helper->entries, entry, entry);
+			}
+			if (entry && !AST_VECTOR_APPEND(&entry->listeners, bridge_channel)) {
+				continue;
+			}
+		}
+
+		write.bridge_channel = bridge_channel;
+		if (AST_VECTOR_APPEND(writes, write)) {
+			ast_log(LOG_WARNING, "Bridge %s: Failed to queue mixed audio for channel %s\n",
+				bridge->uniqueid, ast_channel_name(bridge_channel->chan));
+		}
+	}
+
+	AST_LIST_TRAVERSE(&trans_helper->entries, entry, entry) {
+		struct ast_frame *frame = NULL;
+
+		if (!AST_VECTOR_SIZE(&entry->listeners)) {
+			continue;
+		}
+
+		/* A lone listener is no cheaper to handle as a group. */
+		if (AST_VECTOR_SIZE(&entry->listeners) > 1) {
+			if (ast_format_cmp(entry->dst_format, mix_frame->subclass.format) == AST_FORMAT_CMP_EQUAL) {
+				frame = mix_frame;
+			} else {
+				if (!entry->trans_pvt) {
+					entry->trans_pvt = ast_translator_build_path(entry->dst_format, trans_helper->slin_src);
+				}
+				if (entry->trans_pvt && !entry->out_frame) {
+					entry->out_frame = ast_translate(entry->trans_pvt, mix_frame, 0);
+				}
+				if (entry->out_frame && entry->out_frame->frametype == AST_FRAME_VOICE) {
+					entry->out_frame->stream_num = mix_frame->stream_num;
+					frame = entry->out_frame;
+				}
+			}
+			if (frame) {
+				/* Queued to each listener by reference rather than copied */
+				if ((entry->listener_frame = ast_frdup_shared(frame))) {
+					frame = entry->listener_frame;
+				}
+				entry->num_times_requested += AST_VECTOR_SIZE(&entry->listeners);
+			}
+		}
+
+		for (i = 0; i < AST_VECTOR_SIZE(&entry->listeners); ++i) {
+			write.bridge_channel = AST_VECTOR_GET(&entry->listeners, i);
+			write.frame = frame;
+			if (AST_VECTOR_APPEND(writes, write)) {
+				ast_log(LOG_WARNING, "Bridge %s: Failed to queue mixed audio for channel %s\n",
+					bridge->uniqueid, ast_channel_name(write.bridge_channel->chan));
+			}
+		}
+		write.frame = NULL;
+		AST_VECTOR_RESET(&entry->listeners, AST_VECTOR_ELEM_CLEANUP_NOOP);
+	}
+}
+
+/*! \brief The work performed by each mixing thread during a mixing interval */
+enum softmix_mixing_phase {
+	/*! Sum a share of the mixing array into the thread's partial mix */
+	SOFTMIX_MIXING_PHASE_MIX,
+	/*! Write the complete mix out to a share of the channels */
+	SOFTMIX_MIXING_PHASE_WRITE,
+};
+
+struct softmix_mixing_workers;
+
+/*! \brief Per-thread data used when mixing is shared by multiple threads */
+struct softmix_mixing_worker {
+	/*! The helper thread.  Worker 0 is the bridge mixing thread itself. */
+	pthread_t thread;
+	/*! Which share of the work this worker performs */
+	unsigned int index;
+	/*! Translation paths for the channels this worker writes to */
+	struct softmix_translate_helper trans_helper;
+	/*! Partial mix of this worker's share of the mixing array */
+	int16_t buf[MAX_DATALEN];
+	struct softmix_mixing_workers *workers;
+};
+
+/*!
+ * \brief Threads sharing the mixing of a large bridge
+ *
+ * \note The fields describing the current phase are only changed by the
+ * bridge mixing thread while none of the helper threads are running.
+ */
+struct softmix_mixing_workers {
+	ast_mutex_t lock;
+	/*! Signaled when a phase is started or the helper threads must stop */
+	ast_cond_t cond;
+	/*! Signaled when the last helper thread finishes a phase */
+	ast_cond_t done;
+	/*! Incremented each time a phase is started */
+	unsigned int generation;
+	/*! Number of helper threads that have not finished the current phase */
+	unsigned int pending;
+	/*! TRUE if the helper threads should exit */
+	unsigned int stop;
+	/*! Callid of the bridge for the helper threads */
+	ast_callid callid;
+	/*! Number of workers sharing the current phase */
+	unsigned int num_active;
+	enum softmix_mixing_phase phase;
+	struct softmix_mixing_array *mixing_array;
+	/*! Channels to write to this mixing interval */
+	struct softmix_writes *writes;
+	struct ast_format *cur_slin;
+	unsigned int softmix_samples;
+	unsigned int softmix_datalen;
+	unsigned int default_sample_size;
+	/*! The complete mix of all channels */
+	int16_t *buf;
+	/*! Number of usable workers */
+	unsigned int num_workers;
+	struct softmix_mixing_worker worker[0];
+};
+
+/*!
+ * \internal
+ * \brief Perform a worker's share of the current mixing phase.
+ */
+static void softmix_mixing_worker_run(struct softmix_mixing_workers *workers,
+	struct softmix_mixing_worker *worker)
+{
+	unsigned int count;
+	unsigned int start;
+	unsigned int end;
+	unsigned int i;
+
+	count = workers->phase == SOFTMIX_MIXING_PHASE_MIX
+		? workers->mixing_array->used_entries : AST_VECTOR_SIZE(workers->writes);
+	start = (unsigned long) count * worker->index / workers->num_active;
+	end = (unsigned long) count * (worker->index + 1) / workers->num_active;
+
+	if (workers->phase == SOFTMIX_MIXING_PHASE_MIX) {
+		memset(worker->buf, 0, workers->softmix_datalen);
+		for (i = start; i < end; ++i) {
+			ast_slinear_saturated_add_buf(worker->buf, workers->mixing_array->buffers[i],
+				workers->softmix_samples);
+		}
+		return;
+	}
+
+	for (i = start; i < end; ++i) {
+		struct softmix_write *write = AST_VECTOR_GET_ADDR(workers->writes, i);
+		struct ast_bridge_channel *bridge_channel = write->bridge_channel;
+		struct softmix_channel *sc = bridge_channel->tech_pvt;
+
+		if (write->frame) {
+			ast_bridge_channel_queue_frame(bridge_channel, write->frame);
+			continue;
+		}
+
+		ast_mutex_lock(&sc->lock);
+
+		/* Make SLINEAR write frame from the complete mix */
+		ao2_t_replace(sc->write_frame.subclass.format, workers->cur_slin,
+			"Replace softmix channel slin format");
+		sc->write_frame.datalen = workers->softmix_datalen;
+		sc->write_frame.samples = workers->softmix_samples;
+		memcpy(sc->final_buf, workers->buf, workers->softmix_datalen);
+		/* process the softmix channel's new write audio */
+		softmix_process_write_audio(&worker->trans_helper,
+				ast_channel_rawwriteformat(bridge_channel->chan), sc,
+				workers->default_sample_size);
+
+		ast_mutex_unlock(&sc->lock);
+
+		/* A frame is now ready for the channel. */
+		ast_bridge_channel_queue_frame(bridge_channel, &sc->write_frame);
+	}
+}
+
+static void *softmix_mixing_worker_thread(void *data)
+{
+	struct softmix_mixing_worker *worker = data;
+	struct softmix_mixing_workers *workers = worker->workers;
+	unsigned int generation = 0;
+
+	ast_thread_affinity_apply(AST_THREAD_AFFINITY_MEDIA, -1);
+
+	if (workers->callid) {
+		ast_callid_threadassoc_add(workers->callid);
+	}
+
+	ast_mutex_lock(&workers->lock);
+	for (;;) {
+		while (!workers->stop && workers->generation == generation) {
+			ast_cond_wait(&workers->cond, &workers->lock);
+		}
+		if (workers->stop) {
+			break;
+		}
+		generation = workers->generation;
+		if (worker->index >= workers->num_active) {
+			continue;
+		}
+
+		ast_mutex_unlock(&workers->lock);
+		softmix_mixing_worker_run(workers, worker);
+		ast_mutex_lock(&workers->lock);
+
+		if (!--workers->pending) {
+			ast_cond_signal(&workers->done);
+		}
+	}
+	ast_mutex_unlock(&workers->lock);
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Run a mixing phase on all active workers and wait for it to complete.
+ *
+ * \note The calling bridge mixing thread performs the share of worker 0.
+ */
+static void softmix_mixing_workers_run(struct softmix_mixing_workers *workers,
+	enum softmix_mixing_phase phase)
+{
+	ast_mutex_lock(&workers->lock);
+	workers->phase = phase;
+	workers->pending = workers->num_active - 1;
+	++workers->generation;
+	ast_cond_broadcast(&workers->cond);
+	ast_mutex_unlock(&workers->lock);
+
+	softmix_mixing_worker_run(workers, &workers->worker[0]);
+
+	ast_mutex_lock(&workers->lock);
+	while (workers->pending) {
+		ast_cond_wait(&workers->done, &workers->lock);
+	}
+	ast_mutex_unlock(&workers->lock);
+}
+
+static void softmix_mixing_workers_destroy(struct softmix_mixing_workers *workers)
+{
+	unsigned int i;
+
+	if (!workers) {
+		return;
+	}
+
+	ast_mutex_lock(&workers->lock);
+	workers->stop = 1;
+	ast_cond_broadcast(&workers->cond);
+	ast_mutex_unlock(&workers->lock);
+
+	for (i = 0; i < workers->num_workers; ++i) {
+		if (workers->worker[i].thread != AST_PTHREADT_NULL) {
+			pthread_join(workers->worker[i].thread, NULL);
+		}
+		softmix_translate_helper_destroy(&workers->worker[i].trans_helper);
+	}
+
+	ast_mutex_destroy(&workers->lock);
+	ast_cond_destroy(&workers->cond);
+	ast_cond_destroy(&workers->done);
+	ast_free(workers);
+}
+
+/*!
+ * \internal
+ * \brief Create the threads used to share the mixing of a bridge.
+ *
+ * \param bridge The bridge being mixed
+ * \param num_workers Total number of workers including the bridge mixing thread
+ * \param sample_rate The bridge's internal sample rate
+ *
+ * \retval NULL on failure
+ */
+static struct softmix_mixing_workers *softmix_mixing_workers_create(struct ast_bridge *bridge,
+	unsigned int num_workers, unsigned int sample_rate)
+{
+	struct softmix_mixing_workers *workers;
+	unsigned int i;
+
+	workers = ast_calloc(1, sizeof(*workers) + num_workers * sizeof(workers->worker[0]));
+	if (!workers) {
+		return NULL;
+	}
+
+	ast_mutex_init(&workers->lock);
+	ast_cond_init(&workers->cond, NULL);
+	ast_cond_init(&workers->done, NULL);
+	workers->callid = bridge->callid;
+
+	for (i = 0; i < num_workers; ++i) {
+		struct softmix_mixing_worker *worker = &workers->worker[i];
+
+		worker->index = i;
+		worker->workers = workers;
+		worker->thread = AST_PTHREADT_NULL;
+		softmix_translate_helper_init(&worker->trans_helper, sample_rate);
+
+		if (i && ast_pthread_create(&worker->thread, NULL, softmix_mixing_worker_thread, worker)) {
+			worker->thread = AST_PTHREADT_NULL;
+			ast_log(LOG_WARNING, "Bridge %s: Unable to create mixing thread, using %u threads\n",
+				bridge->uniqueid, i);
+			break;
+		}
+		workers->num_workers = i + 1;
+	}
+
+	if (workers->num_workers < 2) {
+		softmix_mixing_workers_destroy(workers);
+		return NULL;
+	}
+
+	ast_debug(1, "Bridge %s: mixing with up to %u threads\n", bridge->uniqueid, workers->num_workers);
+
+	return workers;
+}
+
 /*!
  * \brief Mixing loop.
  *
@@ -1756,6 +2147,8 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 	struct softmix_bridge_data *softmix_data = bridge->tech_pvt;
 	struct ast_timer *timer;
 	struct softmix_translate_helper trans_helper;
+	struct softmix_mixing_workers *workers = NULL;
+	struct softmix_writes writes;
 	int16_t buf[MAX_DATALEN];
 #ifdef BINAURAL_RENDERING
 	int16_t bin_buf[MAX_DATALEN];
@@ -1765,7 +2158,6 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 	int timingfd;
 	int update_all_rates = 0; /* set this when the internal sample rate has changed */
 	unsigned int idx;
-	unsigned int x;
 	int res = -1;
 
 	timer = softmix_data->timer;
@@ -1773,12 +2165,21 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 	softmix_translate_helper_init(&trans_helper, softmix_data->internal_rate);
 	ast_timer_set_rate(timer, (1000 / softmix_data->internal_mixing_interval));
 
+	/* The vector grows as needed so a failed allocation here is not fatal. */
+	AST_VECTOR_INIT(&writes, bridge->num_channels + 10);
+
 	/* Give the mixing array room to grow, memory is cheap but allocations are expensive. */
 	if (softmix_mixing_array_init(&mixing_array, bridge->num_channels + 10,
 			bridge->softmix.binaural_active)) {
 		goto softmix_cleanup;
 	}
 
+	/* Binaural rendering keeps per-source state so it is always mixed by this thread alone. */
+	if (bridge->softmix.mixing_threads > 1 && !bridge->softmix.binaural_active) {
+		workers = softmix_mixing_workers_create(bridge, bridge->softmix.mixing_threads,
+			softmix_data->internal_rate);
+	}
+
 	/*
 	 * XXX Softmix needs to use channel roles to determine who gets
 	 * what audio mixed.
@@ -1789,7 +2190,13 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 		struct ast_format *cur_slin = ast_format_cache_get_slin_by_rate(softmix_data->internal_rate);
 		unsigned int softmix_samples = SOFTMIX_SAMPLES(softmix_data->internal_rate, softmix_data->internal_mixing_interval);
 		unsigned int softmix_datalen = SOFTMIX_DATALEN(softmix_data->internal_rate, softmix_data->internal_mixing_interval);
+		struct ast_frame mix_frame = {
+			.frametype = AST_FRAME_VOICE,
+			.data.ptr = buf,
+		};
 		int remb_update = 0;
+		unsigned int num_threads = 1;
+		uint64_t pass_start = ast_latency_start();
 
 		if (softmix_datalen > MAX_DATALEN) {
 			/* This should NEVER happen, but if it does we need to know about it. Almost
@@ -1823,6 +2230,25 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 		/* If the sample rate has changed, update the translator helper */
 		if (update_all_rates) {
 			softmix_translate_helper_change_rate(&trans_helper, softmix_data->internal_rate);
+			for (idx = 0; workers && idx < workers->num_workers; ++idx) {
+				softmix_translate_helper_change_rate(&workers->worker[idx].trans_helper,
+					softmix_data->internal_rate);
+			}
+		}
+
+		/* Only share the mixing when every thread has enough channels to be worth it. */
+		if (workers) {
+			num_threads = MIN(workers->num_workers, bridge->num_channels / SOFTMIX_MIN_CHANNELS_PER_THREAD);
+			if (num_threads > 1) {
+				workers->num_active = num_threads;
+				workers->mixing_array = &mixing_array;
+				workers->cur_slin = cur_slin;
+				workers->softmix_samples = softmix_samples;
+				workers->softmix_datalen = softmix_datalen;
+				workers->default_sample_size = softmix_data->default_sample_size;
+				workers->buf = buf;
+				workers->writes = &writes;
+			}
 		}
 
 #ifdef BINAURAL_RENDERING
@@ -1878,10 +2304,17 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 		}
 
 		/* mix it like crazy (non binaural channels)*/
-		memset(buf, 0, softmix_datalen);
-		for (idx = 0; idx < mixing_array.used_entries; ++idx) {
-			for (x = 0; x < softmix_samples; ++x) {
-				ast_slinear_saturated_add(buf + x, mixing_array.buffers[idx] + x);
+		if (num_threads > 1) {
+			/* Each thread sums its share, then the partial mixes are combined. */
+			softmix_mixing_workers_run(workers, SOFTMIX_MIXING_PHASE_MIX);
+			memcpy(buf, workers->worker[0].buf, softmix_datalen);
+			for (idx = 1; idx < num_threads; ++idx) {
+				ast_slinear_saturated_add_buf(buf, workers->worker[idx].buf, softmix_samples);
+			}
+		} else {
+			memset(buf, 0, softmix_datalen);
+			for (idx = 0; idx < mixing_array.used_entries; ++idx) {
+				ast_slinear_saturated_add_buf(buf, mixing_array.buffers[idx], softmix_samples);
 			}
 		}
 
@@ -1890,14 +2323,28 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 #endif
 
 		/* Next step go through removing the channel's own audio and creating a good frame... */
-		AST_LIST_TRAVERSE(&bridge->channels, bridge_channel, entry) {
-			struct softmix_channel *sc = bridge_channel->tech_pvt;
-
-			if (!sc || bridge_channel->suspended) {
-				/* This channel failed to join successfully or is suspended. */
+		mix_frame.subclass.format = cur_slin;
+		mix_frame.datalen = softmix_datalen;
+		mix_frame.samples = softmix_samples;
+		if (bridge->softmix.mix_tap) {
+			bridge->softmix.mix_tap(&mix_frame, bridge->softmix.mix_tap_data);
+		}
+		softmix_writes_build(bridge, &trans_helper, &writes, &mix_frame);
+		if (num_threads > 1) {
+			softmix_mixing_workers_run(workers, SOFTMIX_MIXING_PHASE_WRITE);
+		}
+		for (idx = 0; num_threads == 1 && idx < AST_VECTOR_SIZE(&writes); ++idx) {
+			struct softmix_write *write = AST_VECTOR_GET_ADDR(&writes, idx);
+			struct softmix_channel *sc;
+
+			bridge_channel = write->bridge_channel;
+			if (write->frame) {
+				/* The listener gets the frame shared by its group. */
+				ast_bridge_channel_queue_frame(bridge_channel, write->frame);
 				continue;
 			}
 
+			sc = bridge_channel->tech_pvt;
 			ast_mutex_lock(&sc->lock);
 
 			/* Make SLINEAR write frame from local buffer */
@@ -1924,13 +2371,15 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 
 			/* A frame is now ready for the channel. */
 			ast_bridge_channel_queue_frame(bridge_channel, &sc->write_frame);
-
-			if (remb_update) {
-				remb_send_report(bridge_channel, softmix_data, sc);
-			}
 		}
 
 		if (remb_update) {
+			AST_LIST_TRAVERSE(&bridge->channels, bridge_channel, entry) {
+				if (!bridge_channel->tech_pvt || bridge_channel->suspended) {
+					continue;
+				}
+				remb_send_report(bridge_channel, softmix_data, bridge_channel->tech_pvt);
+			}
 			/* In case we are doing bridge level REMB reset the bitrate so we start fresh */
 			softmix_data->bitrate = 0;
 		}
@@ -1946,6 +2395,17 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 		ast_bridge_unlock(bridge);
 		/* cleanup any translation frame data from the previous mixing iteration. */
 		softmix_translate_helper_cleanup(&trans_helper);
+		for (idx = 0; workers && idx < workers->num_workers; ++idx) {
+			softmix_translate_helper_cleanup(&workers->worker[idx].trans_helper);
+		}
+		/* Passes within their interval count as no overrun at all */
+		if (pass_start) {
+			uint64_t elapsed = ast_latency_now() - pass_start;
+			uint64_t interval = softmix_data->internal_mixing_interval * UINT64_C(1000000);
+
+			ast_latency_record(mixing_overrun_latency, elapsed > interval ? elapsed - interval : 0);
+		}
+
 		/* Wait for the timing source to tell us to wake up and get things done */
 		ast_waitfor_n_fd(&timingfd, 1, &timeout, NULL);
 		if (ast_timer_ack(timer, 1) < 0) {
@@ -1968,6 +2428,8 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 	res = 0;
 
 softmix_cleanup:
+	softmix_mixing_workers_destroy(workers);
+	AST_VECTOR_FREE(&writes);
 	softmix_translate_helper_destroy(&trans_helper);
 	softmix_mixing_array_destroy(&mixing_array, bridge->softmix.binaural_active);
 	return res;
@@ -1987,6 +2449,8 @@ static void *softmix_mixing_thread(void *data)
 	struct softmix_bridge_data *softmix_data = data;
 	struct ast_bridge *bridge = softmix_data->bridge;
 
+	ast_thread_affinity_apply(AST_THREAD_AFFINITY_MEDIA, -1);
+
 	ast_bridge_lock(bridge);
 	if (bridge->callid) {
 		ast_callid_threadassoc_add(bridge->callid);
@@ -2882,6 +3346,9 @@ static int unload_module(void)
 
 static int load_module(void)
 {
+	mixing_overrun_latency = ast_latency_histogram_get("bridge_softmix_overrun",
+		"Time conference mixing passes run past the mixing interval");
+
 	if (ast_bridge_technology_register(&softmix_bridge)) {
 		unload_module();
 		return AST_MODULE_LOAD_DECLINE;
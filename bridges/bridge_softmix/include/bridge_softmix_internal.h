@@ -52,6 +52,7 @@
 #include "asterisk/translate.h"
 #include "asterisk/rtp_engine.h"
 #include "asterisk/vector.h"
+#include "asterisk/dsp.h"
 
 #ifdef BINAURAL_RENDERING
 #include <fftw3.h>
@@ -140,6 +141,15 @@ struct softmix_channel {
 	struct ast_format *read_slin_format;
 	/*! DSP for detecting silence */
 	struct ast_dsp *dsp;
+	/*! Subscription to the channel's shared voice activity analysis, -1 if none */
+	int vad_id;
+	/*!
+	 * \brief Voice activity of the last frame read from the channel
+	 *
+	 * \note Only the bridge channel thread, which reads the channel and
+	 * writes its frames into the bridge, uses it, so it is not locked.
+	 */
+	struct ast_dsp_vad_latest vad;
 	/*!
 	 * \brief TRUE if a channel is talking.
 	 *
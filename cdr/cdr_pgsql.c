@@ -76,6 +76,8 @@ static int maxsize = 512, maxsize2 = 512;
 static time_t connect_time = 0;
 static int totalrecords = 0;
 static int records;
+/*! TRUE while the records of a batch are inserted in one transaction */
+static int in_batch;
 
 static char *handle_cdr_pgsql_status(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a);
 static struct ast_cli_entry cdr_pgsql_status_cli[] = {
@@ -405,6 +407,11 @@ static int pgsql_log(struct ast_cdr *cdr)
 
 		ast_debug(3, "Inserting a CDR record: [%s]\n", ast_str_buffer(sql));
 
+		if (in_batch && PQstatus(conn) != CONNECTION_OK) {
+			/* Reconnecting would lose the transaction of the batch */
+			goto ast_log_cleanup;
+		}
+
 		/* Test to be sure we're still connected... */
 		/* If we're connected, and connection is working, good. */
 		/* Otherwise, attempt reconnect.  If it fails... sorry... */
@@ -429,7 +436,11 @@ static int pgsql_log(struct ast_cdr *cdr)
 			}
 		}
 		result = PQexec(conn, ast_str_buffer(sql));
-		if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+		if (PQresultStatus(result) != PGRES_COMMAND_OK && in_batch) {
+			/* The batch is rolled back and its records inserted one by one */
+			ast_debug(1, "Failed to insert call detail record in a batch: %s\n",
+				PQresultErrorMessage(result));
+		} else if (PQresultStatus(result) != PGRES_COMMAND_OK) {
 			pgerror = PQresultErrorMessage(result);
 			ast_log(LOG_ERROR, "Failed to insert call detail record into database!\n");
 			ast_log(LOG_ERROR, "Reason: %s\n", pgerror);
@@ -478,6 +489,59 @@ ast_log_cleanup:
 	return res;
 }
 
+/*! \brief Run a statement without results, such as BEGIN or COMMIT */
+static int pgsql_command(const char *command)
+{
+	PGresult *result;
+	int res;
+
+	result = PQexec(conn, command);
+	res = PQresultStatus(result) == PGRES_COMMAND_OK ? 0 : -1;
+	PQclear(result);
+
+	return res;
+}
+
+static int pgsql_log_batch(struct ast_cdr **cdrs, size_t count)
+{
+	size_t inserted = 0;
+	int res = 0;
+	size_t i;
+
+	ast_mutex_lock(&pgsql_lock);
+
+	/* Committing once is much cheaper than committing every record */
+	if (connected && PQstatus(conn) == CONNECTION_OK && !pgsql_command("BEGIN")) {
+		in_batch = 1;
+		for (; inserted < count; inserted++) {
+			if (pgsql_log(cdrs[inserted])) {
+				break;
+			}
+		}
+		in_batch = 0;
+
+		if (inserted == count && !pgsql_command("COMMIT")) {
+			ast_mutex_unlock(&pgsql_lock);
+			return 0;
+		}
+
+		ast_log(LOG_WARNING, "Failed to insert %zu call detail records at once, inserting them one by one\n",
+			count);
+		if (conn && PQstatus(conn) == CONNECTION_OK) {
+			pgsql_command("ROLLBACK");
+		}
+		totalrecords -= inserted;
+		records -= inserted;
+	}
+
+	for (i = 0; i < count; i++) {
+		res |= pgsql_log(cdrs[i]);
+	}
+
+	ast_mutex_unlock(&pgsql_lock);
+	return res;
+}
+
 /* This function should be called without holding the pgsql_columns lock */
 static void empty_columns(void)
 {
@@ -787,7 +851,7 @@ static int load_module(void)
 	if (config_module(0)) {
 		return AST_MODULE_LOAD_DECLINE;
 	}
-	return ast_cdr_register(name, ast_module_info->description, pgsql_log)
+	return ast_cdr_register_batch(name, ast_module_info->description, pgsql_log, pgsql_log_batch)
 		? AST_MODULE_LOAD_DECLINE : 0;
 }
 
@@ -172,6 +172,8 @@ static void custom_log(struct ast_event *event)
 
 static int unload_module(void)
 {
+	/* Unregistering hands us the events queued for us */
+	ast_cel_backend_unregister(CUSTOM_BACKEND_NAME);
 
 	if (AST_RWLIST_WRLOCK(&sinks)) {
 		ast_log(LOG_ERROR, "Unable to lock sink list.  Unload failed.\n");
@@ -180,7 +182,6 @@ static int unload_module(void)
 
 	free_config();
 	AST_RWLIST_UNLOCK(&sinks);
-	ast_cel_backend_unregister(CUSTOM_BACKEND_NAME);
 	return 0;
 }
 
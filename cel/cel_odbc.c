@@ -82,6 +82,8 @@ struct tables {
 	char *table;
 	unsigned int usegmtime:1;
 	unsigned int allowleapsec:1;
+	/*! The most rows to insert with one statement */
+	unsigned int batchrows;
 	AST_LIST_HEAD_NOLOCK(odbc_columns, columns) columns;
 	AST_RWLIST_ENTRY(tables) list;
 };
@@ -187,6 +189,13 @@ static int load_config(void)
 			tableptr->allowleapsec = ast_true(tmp);
 		}
 
+		tableptr->batchrows = 1;
+		if (!ast_strlen_zero(tmp = ast_variable_retrieve(cfg, catg, "batchrows"))
+			&& (sscanf(tmp, "%30u", &tableptr->batchrows) != 1 || !tableptr->batchrows)) {
+			ast_log(LOG_WARNING, "Invalid batchrows '%s' in '%s'.  Inserting one row at a time.\n", tmp, catg);
+			tableptr->batchrows = 1;
+		}
+
 		ast_verb(3, "Found CEL table %s@%s.\n", tableptr->table, tableptr->connection);
 
 		/* Check for filters first */
@@ -342,230 +351,280 @@ static SQLHSTMT generic_prepare(struct odbc_obj *obj, void *data)
 	return stmt;
 }
 
-#define LENGTHEN_BUF(size, var_sql)														\
-			do {																\
-				/* Lengthen buffer, if necessary */								\
-				if (ast_str_strlen(var_sql) + size + 1 > ast_str_size(var_sql)) {		\
-					if (ast_str_make_space(&var_sql, ((ast_str_size(var_sql) + size + 1) / 512 + 1) * 512) != 0) { \
-						ast_log(LOG_ERROR, "Unable to allocate sufficient memory.  Insert CEL '%s:%s' failed.\n", tableptr->connection, tableptr->table); \
-						ast_free(sql);											\
-						ast_free(sql2);											\
-						AST_RWLIST_UNLOCK(&odbc_tables);						\
-						return;													\
-					}															\
-				}																\
-			} while (0)
-
-#define LENGTHEN_BUF1(size) \
-	LENGTHEN_BUF(size, sql);
-
-#define LENGTHEN_BUF2(size) \
-	LENGTHEN_BUF(size, sql2);
-
-static void odbc_log(struct ast_event *event)
+/*!
+ * \internal
+ * \brief Build the row of a table for an event
+ *
+ * \param tableptr The table
+ * \param obj The connection to the database of the table
+ * \param event The event
+ * \param sql Set to the columns of the row
+ * \param sql2 Set to the values of the row, in parentheses
+ *
+ * \retval 0 on success
+ * \retval -1 if the event is filtered out of the table or cannot be read
+ */
+static int odbc_build_row(struct tables *tableptr, struct odbc_obj *obj, struct ast_event *event,
+	struct ast_str **sql, struct ast_str **sql2)
 {
-	struct tables *tableptr;
 	struct columns *entry;
-	struct odbc_obj *obj;
-	struct ast_str *sql = ast_str_create(maxsize), *sql2 = ast_str_create(maxsize2);
 	char *tmp;
 	char colbuf[1024], *colptr;
-	SQLHSTMT stmt = NULL;
-	SQLLEN rows = 0;
+	char *separator = "";
 	struct ast_cel_event_record record = {
 		.version = AST_CEL_EVENT_RECORD_VERSION,
 	};
 
 	if (ast_cel_fill_record(event, &record)) {
-		return;
-	}
-
-	if (!sql || !sql2) {
-		if (sql)
-			ast_free(sql);
-		if (sql2)
-			ast_free(sql2);
-		return;
+		return -1;
 	}
 
-	if (AST_RWLIST_RDLOCK(&odbc_tables)) {
-		ast_log(LOG_ERROR, "Unable to lock table list.  Insert CEL(s) failed.\n");
-		ast_free(sql);
-		ast_free(sql2);
-		return;
-	}
+	ast_str_reset(*sql);
+	ast_str_set(sql2, 0, "(");
 
-	AST_LIST_TRAVERSE(&odbc_tables, tableptr, list) {
-		char *separator = "";
-		ast_str_set(&sql, 0, "INSERT INTO %s (", tableptr->table);
-		ast_str_set(&sql2, 0, " VALUES (");
+	AST_LIST_TRAVERSE(&(tableptr->columns), entry, list) {
+		int datefield = 0;
+		int unknown = 0;
+		if (strcasecmp(entry->celname, "eventtime") == 0) {
+			datefield = 1;
+		}
 
-		/* No need to check the connection now; we'll handle any failure in prepare_and_execute */
-		if (!(obj = ast_odbc_request_obj(tableptr->connection, 0))) {
-			ast_log(LOG_WARNING, "Unable to retrieve database handle for '%s:%s'.  CEL failed: %s\n", tableptr->connection, tableptr->table, ast_str_buffer(sql));
-			continue;
+		/* Check if we have a similarly named variable */
+		if (entry->staticvalue) {
+			colptr = ast_strdupa(entry->staticvalue);
+		} else if (datefield) {
+			struct timeval date_tv = record.event_time;
+			struct ast_tm tm = { 0, };
+			ast_localtime(&date_tv, &tm, tableptr->usegmtime ? "UTC" : NULL);
+			/* SQL server 2008 added datetime2 and datetimeoffset data types, that
+			   are reported to SQLColumns() as SQL_WVARCHAR, according to "Enhanced
+			   Date/Time Type Behavior with Previous SQL Server Versions (ODBC)".
+			   Here we format the event time with fraction seconds, so these new
+			   column types will be set to high-precision event time. However, 'date'
+			   and 'time' columns, also newly introduced, reported as SQL_WVARCHAR
+			   too, and insertion of the value formatted here into these will fail.
+			   This should be ok, however, as nobody is going to store just event
+			   date or just time for CDR purposes.
+			 */
+			ast_strftime(colbuf, sizeof(colbuf), "%Y-%m-%d %H:%M:%S.%6q", &tm);
+			colptr = colbuf;
+		} else {
+			if (strcmp(entry->celname, "userdeftype") == 0) {
+				ast_copy_string(colbuf, record.user_defined_name, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "cid_name") == 0) {
+				ast_copy_string(colbuf, record.caller_id_name, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "cid_num") == 0) {
+				ast_copy_string(colbuf, record.caller_id_num, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "cid_ani") == 0) {
+				ast_copy_string(colbuf, record.caller_id_ani, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "cid_rdnis") == 0) {
+				ast_copy_string(colbuf, record.caller_id_rdnis, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "cid_dnid") == 0) {
+				ast_copy_string(colbuf, record.caller_id_dnid, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "exten") == 0) {
+				ast_copy_string(colbuf, record.extension, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "context") == 0) {
+				ast_copy_string(colbuf, record.context, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "channame") == 0) {
+				ast_copy_string(colbuf, record.channel_name, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "appname") == 0) {
+				ast_copy_string(colbuf, record.application_name, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "appdata") == 0) {
+				ast_copy_string(colbuf, record.application_data, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "accountcode") == 0) {
+				ast_copy_string(colbuf, record.account_code, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "peeraccount") == 0) {
+				ast_copy_string(colbuf, record.peer_account, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "uniqueid") == 0) {
+				ast_copy_string(colbuf, record.unique_id, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "linkedid") == 0) {
+				ast_copy_string(colbuf, record.linked_id, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "userfield") == 0) {
+				ast_copy_string(colbuf, record.user_field, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "peer") == 0) {
+				ast_copy_string(colbuf, record.peer, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "amaflags") == 0) {
+				snprintf(colbuf, sizeof(colbuf), "%u", record.amaflag);
+			} else if (strcmp(entry->celname, "extra") == 0) {
+				ast_copy_string(colbuf, record.extra, sizeof(colbuf));
+			} else if (strcmp(entry->celname, "eventtype") == 0) {
+				snprintf(colbuf, sizeof(colbuf), "%u", record.event_type);
+			} else {
+				colbuf[0] = 0;
+				unknown = 1;
+			}
+			colptr = colbuf;
 		}
 
-		AST_LIST_TRAVERSE(&(tableptr->columns), entry, list) {
-			int datefield = 0;
-			int unknown = 0;
-			if (strcasecmp(entry->celname, "eventtime") == 0) {
-				datefield = 1;
+		if (colptr && !unknown) {
+			/* Check first if the column filters this entry.  Note that this
+			 * is very specifically NOT ast_strlen_zero(), because the filter
+			 * could legitimately specify that the field is blank, which is
+			 * different from the field being unspecified (NULL). */
+			if (entry->filtervalue && strcasecmp(colptr, entry->filtervalue) != 0) {
+				ast_verb(4, "CEL column '%s' with value '%s' does not match filter of"
+					" '%s'.  Cancelling this CEL.\n",
+					entry->celname, colptr, entry->filtervalue);
+				return -1;
 			}
 
-			/* Check if we have a similarly named variable */
-			if (entry->staticvalue) {
-				colptr = ast_strdupa(entry->staticvalue);
-			} else if (datefield) {
-				struct timeval date_tv = record.event_time;
-				struct ast_tm tm = { 0, };
-				ast_localtime(&date_tv, &tm, tableptr->usegmtime ? "UTC" : NULL);
-				/* SQL server 2008 added datetime2 and datetimeoffset data types, that
-				   are reported to SQLColumns() as SQL_WVARCHAR, according to "Enhanced
-				   Date/Time Type Behavior with Previous SQL Server Versions (ODBC)".
-				   Here we format the event time with fraction seconds, so these new
-				   column types will be set to high-precision event time. However, 'date'
-				   and 'time' columns, also newly introduced, reported as SQL_WVARCHAR
-				   too, and insertion of the value formatted here into these will fail.
-				   This should be ok, however, as nobody is going to store just event
-				   date or just time for CDR purposes.
+			/* Only a filter? */
+			if (ast_strlen_zero(entry->name))
+				continue;
+
+
+			switch (entry->type) {
+			case SQL_CHAR:
+			case SQL_VARCHAR:
+			case SQL_LONGVARCHAR:
+#ifdef HAVE_ODBC_WCHAR
+			case SQL_WCHAR:
+			case SQL_WVARCHAR:
+			case SQL_WLONGVARCHAR:
+#endif
+			case SQL_BINARY:
+			case SQL_VARBINARY:
+			case SQL_LONGVARBINARY:
+			case SQL_GUID:
+				/* For these two field names, get the rendered form, instead of the raw
+				 * form (but only when we're dealing with a character-based field).
 				 */
-				ast_strftime(colbuf, sizeof(colbuf), "%Y-%m-%d %H:%M:%S.%6q", &tm);
-				colptr = colbuf;
-			} else {
-				if (strcmp(entry->celname, "userdeftype") == 0) {
-					ast_copy_string(colbuf, record.user_defined_name, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "cid_name") == 0) {
-					ast_copy_string(colbuf, record.caller_id_name, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "cid_num") == 0) {
-					ast_copy_string(colbuf, record.caller_id_num, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "cid_ani") == 0) {
-					ast_copy_string(colbuf, record.caller_id_ani, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "cid_rdnis") == 0) {
-					ast_copy_string(colbuf, record.caller_id_rdnis, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "cid_dnid") == 0) {
-					ast_copy_string(colbuf, record.caller_id_dnid, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "exten") == 0) {
-					ast_copy_string(colbuf, record.extension, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "context") == 0) {
-					ast_copy_string(colbuf, record.context, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "channame") == 0) {
-					ast_copy_string(colbuf, record.channel_name, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "appname") == 0) {
-					ast_copy_string(colbuf, record.application_name, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "appdata") == 0) {
-					ast_copy_string(colbuf, record.application_data, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "accountcode") == 0) {
-					ast_copy_string(colbuf, record.account_code, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "peeraccount") == 0) {
-					ast_copy_string(colbuf, record.peer_account, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "uniqueid") == 0) {
-					ast_copy_string(colbuf, record.unique_id, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "linkedid") == 0) {
-					ast_copy_string(colbuf, record.linked_id, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "userfield") == 0) {
-					ast_copy_string(colbuf, record.user_field, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "peer") == 0) {
-					ast_copy_string(colbuf, record.peer, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "amaflags") == 0) {
-					snprintf(colbuf, sizeof(colbuf), "%u", record.amaflag);
-				} else if (strcmp(entry->celname, "extra") == 0) {
-					ast_copy_string(colbuf, record.extra, sizeof(colbuf));
-				} else if (strcmp(entry->celname, "eventtype") == 0) {
-					snprintf(colbuf, sizeof(colbuf), "%u", record.event_type);
-				} else {
-					colbuf[0] = 0;
-					unknown = 1;
-				}
-				colptr = colbuf;
-			}
+				if (strcasecmp(entry->name, "eventtype") == 0) {
+					const char *event_name;
 
-			if (colptr && !unknown) {
-				/* Check first if the column filters this entry.  Note that this
-				 * is very specifically NOT ast_strlen_zero(), because the filter
-				 * could legitimately specify that the field is blank, which is
-				 * different from the field being unspecified (NULL). */
-				if (entry->filtervalue && strcasecmp(colptr, entry->filtervalue) != 0) {
-					ast_verb(4, "CEL column '%s' with value '%s' does not match filter of"
-						" '%s'.  Cancelling this CEL.\n",
-						entry->celname, colptr, entry->filtervalue);
-					goto early_release;
+					event_name = (!cel_show_user_def
+						&& record.event_type == AST_CEL_USER_DEFINED)
+						? record.user_defined_name : record.event_name;
+					snprintf(colbuf, sizeof(colbuf), "%s", event_name);
 				}
 
-				/* Only a filter? */
-				if (ast_strlen_zero(entry->name))
-					continue;
+				/* Truncate too-long fields */
+				if (entry->type != SQL_GUID) {
+					if (strlen(colptr) > entry->octetlen) {
+						colptr[entry->octetlen] = '\0';
+					}
+				}
 
-				LENGTHEN_BUF1(strlen(entry->name));
+				ast_str_append(sql, 0, "%s%s", separator, entry->name);
 
-				switch (entry->type) {
-				case SQL_CHAR:
-				case SQL_VARCHAR:
-				case SQL_LONGVARCHAR:
-#ifdef HAVE_ODBC_WCHAR
-				case SQL_WCHAR:
-				case SQL_WVARCHAR:
-				case SQL_WLONGVARCHAR:
-#endif
-				case SQL_BINARY:
-				case SQL_VARBINARY:
-				case SQL_LONGVARBINARY:
-				case SQL_GUID:
-					/* For these two field names, get the rendered form, instead of the raw
-					 * form (but only when we're dealing with a character-based field).
-					 */
-					if (strcasecmp(entry->name, "eventtype") == 0) {
-						const char *event_name;
-
-						event_name = (!cel_show_user_def
-							&& record.event_type == AST_CEL_USER_DEFINED)
-							? record.user_defined_name : record.event_name;
-						snprintf(colbuf, sizeof(colbuf), "%s", event_name);
+				/* Encode value, with escaping */
+				ast_str_append(sql2, 0, "%s'", separator);
+				for (tmp = colptr; *tmp; tmp++) {
+					if (*tmp == '\'') {
+						ast_str_append(sql2, 0, "''");
+					} else if (*tmp == '\\' && ast_odbc_backslash_is_escape(obj)) {
+						ast_str_append(sql2, 0, "\\\\");
+					} else {
+						ast_str_append(sql2, 0, "%c", *tmp);
 					}
+				}
+				ast_str_append(sql2, 0, "'");
+				break;
+			case SQL_TYPE_DATE:
+				if (ast_strlen_zero(colptr)) {
+					continue;
+				} else {
+					int year = 0, month = 0, day = 0;
+					if (strcasecmp(entry->name, "eventdate") == 0) {
+						struct ast_tm tm;
+						ast_localtime(&record.event_time, &tm, tableptr->usegmtime ? "UTC" : NULL);
+						year = tm.tm_year + 1900;
+						month = tm.tm_mon + 1;
+						day = tm.tm_mday;
+					} else {
+						if (sscanf(colptr, "%4d-%2d-%2d", &year, &month, &day) != 3 || year <= 0 ||
+							month <= 0 || month > 12 || day < 0 || day > 31 ||
+							((month == 4 || month == 6 || month == 9 || month == 11) && day == 31) ||
+							(month == 2 && year % 400 == 0 && day > 29) ||
+							(month == 2 && year % 100 == 0 && day > 28) ||
+							(month == 2 && year % 4 == 0 && day > 29) ||
+							(month == 2 && year % 4 != 0 && day > 28)) {
+							ast_log(LOG_WARNING, "CEL variable %s is not a valid date ('%s').\n", entry->name, colptr);
+							continue;
+						}
 
-					/* Truncate too-long fields */
-					if (entry->type != SQL_GUID) {
-						if (strlen(colptr) > entry->octetlen) {
-							colptr[entry->octetlen] = '\0';
+						if (year > 0 && year < 100) {
+							year += 2000;
 						}
 					}
 
-					ast_str_append(&sql, 0, "%s%s", separator, entry->name);
-					LENGTHEN_BUF2(strlen(colptr));
+					ast_str_append(sql, 0, "%s%s", separator, entry->name);
+					ast_str_append(sql2, 0, "%s{d '%04d-%02d-%02d'}", separator, year, month, day);
+				}
+				break;
+			case SQL_TYPE_TIME:
+				if (ast_strlen_zero(colptr)) {
+					continue;
+				} else {
+					int hour = 0, minute = 0, second = 0;
+					if (strcasecmp(entry->name, "eventdate") == 0) {
+						struct ast_tm tm;
+						ast_localtime(&record.event_time, &tm, tableptr->usegmtime ? "UTC" : NULL);
+						hour = tm.tm_hour;
+						minute = tm.tm_min;
+						second = (tableptr->allowleapsec || tm.tm_sec < 60) ? tm.tm_sec : 59;
+					} else {
+						int count = sscanf(colptr, "%2d:%2d:%2d", &hour, &minute, &second);
 
-					/* Encode value, with escaping */
-					ast_str_append(&sql2, 0, "%s'", separator);
-					for (tmp = colptr; *tmp; tmp++) {
-						if (*tmp == '\'') {
-							ast_str_append(&sql2, 0, "''");
-						} else if (*tmp == '\\' && ast_odbc_backslash_is_escape(obj)) {
-							ast_str_append(&sql2, 0, "\\\\");
-						} else {
-							ast_str_append(&sql2, 0, "%c", *tmp);
+						if ((count != 2 && count != 3) || hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > (tableptr->allowleapsec ? 60 : 59)) {
+							ast_log(LOG_WARNING, "CEL variable %s is not a valid time ('%s').\n", entry->name, colptr);
+							continue;
 						}
 					}
-					ast_str_append(&sql2, 0, "'");
-					break;
-				case SQL_TYPE_DATE:
-					if (ast_strlen_zero(colptr)) {
-						continue;
+
+					ast_str_append(sql, 0, "%s%s", separator, entry->name);
+					ast_str_append(sql2, 0, "%s{t '%02d:%02d:%02d'}", separator, hour, minute, second);
+				}
+				break;
+			case SQL_TYPE_TIMESTAMP:
+			case SQL_TIMESTAMP:
+			case SQL_DATETIME:
+				if (ast_strlen_zero(colptr)) {
+					continue;
+				} else {
+					if (datefield) {
+						/*
+						 * We've already properly formatted the timestamp so there's no need
+						 * to parse it and re-format it.
+						 */
+						ast_str_append(sql, 0, "%s%s", separator, entry->name);
+						ast_str_append(sql2, 0, "%s{ts '%s'}", separator, colptr);
 					} else {
-						int year = 0, month = 0, day = 0;
+						int year = 0, month = 0, day = 0, hour = 0, minute = 0;
+						/* MUST use double for microsecond precision */
+						double second = 0.0;
 						if (strcasecmp(entry->name, "eventdate") == 0) {
+							/*
+							 * There doesn't seem to be any reference to 'eventdate' anywhere
+							 * other than in this module.  It should be considered for removal
+							 * at a later date.
+							 */
 							struct ast_tm tm;
 							ast_localtime(&record.event_time, &tm, tableptr->usegmtime ? "UTC" : NULL);
 							year = tm.tm_year + 1900;
 							month = tm.tm_mon + 1;
 							day = tm.tm_mday;
+							hour = tm.tm_hour;
+							minute = tm.tm_min;
+							second = (tableptr->allowleapsec || tm.tm_sec < 60) ? tm.tm_sec : 59;
+							second += (tm.tm_usec / 1000000.0);
 						} else {
-							if (sscanf(colptr, "%4d-%2d-%2d", &year, &month, &day) != 3 || year <= 0 ||
+							/*
+							 * If we're here, the data to be inserted MAY be a timestamp
+							 * but the column is.  We parse as much as we can.
+							 */
+							int count = sscanf(colptr, "%4d-%2d-%2d %2d:%2d:%lf", &year, &month, &day, &hour, &minute, &second);
+
+							if ((count != 3 && count != 5 && count != 6) || year <= 0 ||
 								month <= 0 || month > 12 || day < 0 || day > 31 ||
 								((month == 4 || month == 6 || month == 9 || month == 11) && day == 31) ||
 								(month == 2 && year % 400 == 0 && day > 29) ||
 								(month == 2 && year % 100 == 0 && day > 28) ||
 								(month == 2 && year % 4 == 0 && day > 29) ||
-								(month == 2 && year % 4 != 0 && day > 28)) {
-								ast_log(LOG_WARNING, "CEL variable %s is not a valid date ('%s').\n", entry->name, colptr);
+								(month == 2 && year % 4 != 0 && day > 28) ||
+								hour > 23 || minute > 59 || ((int)floor(second)) > (tableptr->allowleapsec ? 60 : 59) ||
+								hour < 0 || minute < 0 || ((int)floor(second)) < 0) {
+								ast_log(LOG_WARNING, "CEL variable %s is not a valid timestamp ('%s').\n", entry->name, colptr);
 								continue;
 							}
 
@@ -574,221 +633,188 @@ static void odbc_log(struct ast_event *event)
 							}
 						}
 
-						ast_str_append(&sql, 0, "%s%s", separator, entry->name);
-						LENGTHEN_BUF2(17);
-						ast_str_append(&sql2, 0, "%s{d '%04d-%02d-%02d'}", separator, year, month, day);
+						ast_str_append(sql, 0, "%s%s", separator, entry->name);
+						ast_str_append(sql2, 0, "%s{ts '%04d-%02d-%02d %02d:%02d:%09.6lf'}", separator, year, month, day, hour, minute, second);
 					}
-					break;
-				case SQL_TYPE_TIME:
-					if (ast_strlen_zero(colptr)) {
+				}
+				break;
+			case SQL_INTEGER:
+				{
+					int integer = 0;
+					if (sscanf(colptr, "%30d", &integer) != 1) {
+						ast_log(LOG_WARNING, "CEL variable %s is not an integer.\n", entry->name);
 						continue;
-					} else {
-						int hour = 0, minute = 0, second = 0;
-						if (strcasecmp(entry->name, "eventdate") == 0) {
-							struct ast_tm tm;
-							ast_localtime(&record.event_time, &tm, tableptr->usegmtime ? "UTC" : NULL);
-							hour = tm.tm_hour;
-							minute = tm.tm_min;
-							second = (tableptr->allowleapsec || tm.tm_sec < 60) ? tm.tm_sec : 59;
-						} else {
-							int count = sscanf(colptr, "%2d:%2d:%2d", &hour, &minute, &second);
-
-							if ((count != 2 && count != 3) || hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > (tableptr->allowleapsec ? 60 : 59)) {
-								ast_log(LOG_WARNING, "CEL variable %s is not a valid time ('%s').\n", entry->name, colptr);
-								continue;
-							}
-						}
-
-						ast_str_append(&sql, 0, "%s%s", separator, entry->name);
-						LENGTHEN_BUF2(15);
-						ast_str_append(&sql2, 0, "%s{t '%02d:%02d:%02d'}", separator, hour, minute, second);
 					}
-					break;
-				case SQL_TYPE_TIMESTAMP:
-				case SQL_TIMESTAMP:
-				case SQL_DATETIME:
-					if (ast_strlen_zero(colptr)) {
-						continue;
-					} else {
-						if (datefield) {
-							/*
-							 * We've already properly formatted the timestamp so there's no need
-							 * to parse it and re-format it.
-							 */
-							ast_str_append(&sql, 0, "%s%s", separator, entry->name);
-							LENGTHEN_BUF2(27);
-							ast_str_append(&sql2, 0, "%s{ts '%s'}", separator, colptr);
-						} else {
-							int year = 0, month = 0, day = 0, hour = 0, minute = 0;
-							/* MUST use double for microsecond precision */
-							double second = 0.0;
-							if (strcasecmp(entry->name, "eventdate") == 0) {
-								/*
-								 * There doesn't seem to be any reference to 'eventdate' anywhere
-								 * other than in this module.  It should be considered for removal
-								 * at a later date.
-								 */
-								struct ast_tm tm;
-								ast_localtime(&record.event_time, &tm, tableptr->usegmtime ? "UTC" : NULL);
-								year = tm.tm_year + 1900;
-								month = tm.tm_mon + 1;
-								day = tm.tm_mday;
-								hour = tm.tm_hour;
-								minute = tm.tm_min;
-								second = (tableptr->allowleapsec || tm.tm_sec < 60) ? tm.tm_sec : 59;
-								second += (tm.tm_usec / 1000000.0);
-							} else {
-								/*
-								 * If we're here, the data to be inserted MAY be a timestamp
-								 * but the column is.  We parse as much as we can.
-								 */
-								int count = sscanf(colptr, "%4d-%2d-%2d %2d:%2d:%lf", &year, &month, &day, &hour, &minute, &second);
-
-								if ((count != 3 && count != 5 && count != 6) || year <= 0 ||
-									month <= 0 || month > 12 || day < 0 || day > 31 ||
-									((month == 4 || month == 6 || month == 9 || month == 11) && day == 31) ||
-									(month == 2 && year % 400 == 0 && day > 29) ||
-									(month == 2 && year % 100 == 0 && day > 28) ||
-									(month == 2 && year % 4 == 0 && day > 29) ||
-									(month == 2 && year % 4 != 0 && day > 28) ||
-									hour > 23 || minute > 59 || ((int)floor(second)) > (tableptr->allowleapsec ? 60 : 59) ||
-									hour < 0 || minute < 0 || ((int)floor(second)) < 0) {
-									ast_log(LOG_WARNING, "CEL variable %s is not a valid timestamp ('%s').\n", entry->name, colptr);
-									continue;
-								}
-
-								if (year > 0 && year < 100) {
-									year += 2000;
-								}
-							}
 
-							ast_str_append(&sql, 0, "%s%s", separator, entry->name);
-							LENGTHEN_BUF2(27);
-							ast_str_append(&sql2, 0, "%s{ts '%04d-%02d-%02d %02d:%02d:%09.6lf'}", separator, year, month, day, hour, minute, second);
-						}
+					ast_str_append(sql, 0, "%s%s", separator, entry->name);
+					ast_str_append(sql2, 0, "%s%d", separator, integer);
+				}
+				break;
+			case SQL_BIGINT:
+				{
+					long long integer = 0;
+					int ret;
+					if ((ret = sscanf(colptr, "%30lld", &integer)) != 1) {
+						ast_log(LOG_WARNING, "CEL variable %s is not an integer. (%d - '%s')\n", entry->name, ret, colptr);
+						continue;
 					}
-					break;
-				case SQL_INTEGER:
-					{
-						int integer = 0;
-						if (sscanf(colptr, "%30d", &integer) != 1) {
-							ast_log(LOG_WARNING, "CEL variable %s is not an integer.\n", entry->name);
-							continue;
-						}
 
-						ast_str_append(&sql, 0, "%s%s", separator, entry->name);
-						LENGTHEN_BUF2(12);
-						ast_str_append(&sql2, 0, "%s%d", separator, integer);
-					}
-					break;
-				case SQL_BIGINT:
-					{
-						long long integer = 0;
-						int ret;
-						if ((ret = sscanf(colptr, "%30lld", &integer)) != 1) {
-							ast_log(LOG_WARNING, "CEL variable %s is not an integer. (%d - '%s')\n", entry->name, ret, colptr);
-							continue;
-						}
-
-						ast_str_append(&sql, 0, "%s%s", separator, entry->name);
-						LENGTHEN_BUF2(24);
-						ast_str_append(&sql2, 0, "%s%lld", separator, integer);
+					ast_str_append(sql, 0, "%s%s", separator, entry->name);
+					ast_str_append(sql2, 0, "%s%lld", separator, integer);
+				}
+				break;
+			case SQL_SMALLINT:
+				{
+					short integer = 0;
+					if (sscanf(colptr, "%30hd", &integer) != 1) {
+						ast_log(LOG_WARNING, "CEL variable %s is not an integer.\n", entry->name);
+						continue;
 					}
-					break;
-				case SQL_SMALLINT:
-					{
-						short integer = 0;
-						if (sscanf(colptr, "%30hd", &integer) != 1) {
-							ast_log(LOG_WARNING, "CEL variable %s is not an integer.\n", entry->name);
-							continue;
-						}
 
-						ast_str_append(&sql, 0, "%s%s", separator, entry->name);
-						LENGTHEN_BUF2(7);
-						ast_str_append(&sql2, 0, "%s%d", separator, integer);
+					ast_str_append(sql, 0, "%s%s", separator, entry->name);
+					ast_str_append(sql2, 0, "%s%d", separator, integer);
+				}
+				break;
+			case SQL_TINYINT:
+				{
+					signed char integer = 0;
+					if (sscanf(colptr, "%30hhd", &integer) != 1) {
+						ast_log(LOG_WARNING, "CEL variable %s is not an integer.\n", entry->name);
+						continue;
 					}
-					break;
-				case SQL_TINYINT:
-					{
-						signed char integer = 0;
-						if (sscanf(colptr, "%30hhd", &integer) != 1) {
-							ast_log(LOG_WARNING, "CEL variable %s is not an integer.\n", entry->name);
-							continue;
-						}
 
-						ast_str_append(&sql, 0, "%s%s", separator, entry->name);
-						LENGTHEN_BUF2(4);
-						ast_str_append(&sql2, 0, "%s%d", separator, integer);
+					ast_str_append(sql, 0, "%s%s", separator, entry->name);
+					ast_str_append(sql2, 0, "%s%d", separator, integer);
+				}
+				break;
+			case SQL_BIT:
+				{
+					signed char integer = 0;
+					if (sscanf(colptr, "%30hhd", &integer) != 1) {
+						ast_log(LOG_WARNING, "CEL variable %s is not an integer.\n", entry->name);
+						continue;
 					}
-					break;
-				case SQL_BIT:
-					{
-						signed char integer = 0;
-						if (sscanf(colptr, "%30hhd", &integer) != 1) {
-							ast_log(LOG_WARNING, "CEL variable %s is not an integer.\n", entry->name);
-							continue;
-						}
-						if (integer != 0)
-							integer = 1;
+					if (integer != 0)
+						integer = 1;
 
-						ast_str_append(&sql, 0, "%s%s", separator, entry->name);
-						LENGTHEN_BUF2(2);
-						ast_str_append(&sql2, 0, "%s%d", separator, integer);
+					ast_str_append(sql, 0, "%s%s", separator, entry->name);
+					ast_str_append(sql2, 0, "%s%d", separator, integer);
+				}
+				break;
+			case SQL_NUMERIC:
+			case SQL_DECIMAL:
+				{
+					double number = 0.0;
+					if (sscanf(colptr, "%30lf", &number) != 1) {
+						ast_log(LOG_WARNING, "CEL variable %s is not an numeric type.\n", entry->name);
+						continue;
 					}
-					break;
-				case SQL_NUMERIC:
-				case SQL_DECIMAL:
-					{
-						double number = 0.0;
-						if (sscanf(colptr, "%30lf", &number) != 1) {
-							ast_log(LOG_WARNING, "CEL variable %s is not an numeric type.\n", entry->name);
-							continue;
-						}
 
-						ast_str_append(&sql, 0, "%s%s", separator, entry->name);
-						LENGTHEN_BUF2(entry->decimals + 2);
-						ast_str_append(&sql2, 0, "%s%*.*lf", separator, entry->decimals, entry->radix, number);
+					ast_str_append(sql, 0, "%s%s", separator, entry->name);
+					ast_str_append(sql2, 0, "%s%*.*lf", separator, entry->decimals, entry->radix, number);
+				}
+				break;
+			case SQL_FLOAT:
+			case SQL_REAL:
+			case SQL_DOUBLE:
+				{
+					double number = 0.0;
+					if (sscanf(colptr, "%30lf", &number) != 1) {
+						ast_log(LOG_WARNING, "CEL variable %s is not an numeric type.\n", entry->name);
+						continue;
 					}
-					break;
-				case SQL_FLOAT:
-				case SQL_REAL:
-				case SQL_DOUBLE:
-					{
-						double number = 0.0;
-						if (sscanf(colptr, "%30lf", &number) != 1) {
-							ast_log(LOG_WARNING, "CEL variable %s is not an numeric type.\n", entry->name);
-							continue;
-						}
 
-						ast_str_append(&sql, 0, "%s%s", separator, entry->name);
-						LENGTHEN_BUF2(entry->decimals);
-						ast_str_append(&sql2, 0, "%s%lf", separator, number);
-					}
-					break;
-				default:
-					ast_log(LOG_WARNING, "Column type %d (field '%s:%s:%s') is unsupported at this time.\n", entry->type, tableptr->connection, tableptr->table, entry->name);
-					continue;
+					ast_str_append(sql, 0, "%s%s", separator, entry->name);
+					ast_str_append(sql2, 0, "%s%lf", separator, number);
 				}
-				separator = ", ";
+				break;
+			default:
+				ast_log(LOG_WARNING, "Column type %d (field '%s:%s:%s') is unsupported at this time.\n", entry->type, tableptr->connection, tableptr->table, entry->name);
+				continue;
 			}
+			separator = ", ";
 		}
+	}
+
+	ast_str_append(sql2, 0, ")");
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Execute an insert of rows into a table
+ */
+static void odbc_insert(struct tables *tableptr, struct odbc_obj *obj, struct ast_str *statement,
+	unsigned int count)
+{
+	SQLHSTMT stmt;
+	SQLLEN rows = 0;
+
+	ast_debug(3, "Executing SQL statement: [%s]\n", ast_str_buffer(statement));
+	stmt = ast_odbc_prepare_and_execute(obj, generic_prepare, ast_str_buffer(statement));
+	if (stmt) {
+		SQLRowCount(stmt, &rows);
+		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+	}
+	if (rows == 0) {
+		ast_log(LOG_WARNING, "Insert failed on '%s:%s'.  %u CEL(s) failed: %s\n",
+			tableptr->connection, tableptr->table, count, ast_str_buffer(statement));
+	}
+}
+
+static void odbc_log_batch(struct ast_event **events, size_t count)
+{
+	struct tables *tableptr;
+	struct odbc_obj *obj;
+	struct ast_str *sql = ast_str_create(maxsize), *sql2 = ast_str_create(maxsize2);
+	struct ast_str *columns = ast_str_create(maxsize);
+	struct ast_str *statement = ast_str_create(maxsize + maxsize2);
+	unsigned int rows;
+	size_t i;
+
+	if (!sql || !sql2 || !columns || !statement) {
+		goto cleanup;
+	}
 
-		/* Concatenate the two constructed buffers */
-		LENGTHEN_BUF1(ast_str_strlen(sql2));
-		ast_str_append(&sql, 0, ")");
-		ast_str_append(&sql2, 0, ")");
-		ast_str_append(&sql, 0, "%s", ast_str_buffer(sql2));
-
-		ast_debug(3, "Executing SQL statement: [%s]\n", ast_str_buffer(sql));
-		stmt = ast_odbc_prepare_and_execute(obj, generic_prepare, ast_str_buffer(sql));
-		if (stmt) {
-			SQLRowCount(stmt, &rows);
-			SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+	if (AST_RWLIST_RDLOCK(&odbc_tables)) {
+		ast_log(LOG_ERROR, "Unable to lock table list.  Insert CEL(s) failed.\n");
+		goto cleanup;
+	}
+
+	AST_LIST_TRAVERSE(&odbc_tables, tableptr, list) {
+		/* No need to check the connection now; we'll handle any failure in prepare_and_execute */
+		if (!(obj = ast_odbc_request_obj(tableptr->connection, 0))) {
+			ast_log(LOG_WARNING, "Unable to retrieve database handle for '%s:%s'.  %zu CEL(s) failed.\n",
+				tableptr->connection, tableptr->table, count);
+			continue;
+		}
+
+		rows = 0;
+		for (i = 0; i < count; i++) {
+			if (odbc_build_row(tableptr, obj, events[i], &sql, &sql2)) {
+				continue;
+			}
+
+			/* Rows filling the same columns are inserted with one statement */
+			if (rows && rows < tableptr->batchrows
+				&& !strcmp(ast_str_buffer(columns), ast_str_buffer(sql))) {
+				ast_str_append(&statement, 0, ", %s", ast_str_buffer(sql2));
+				rows++;
+				continue;
+			}
+			if (rows) {
+				odbc_insert(tableptr, obj, statement, rows);
+			}
+			ast_str_set(&columns, 0, "%s", ast_str_buffer(sql));
+			ast_str_set(&statement, 0, "INSERT INTO %s (%s) VALUES %s",
+				tableptr->table, ast_str_buffer(sql), ast_str_buffer(sql2));
+			rows = 1;
 		}
-		if (rows == 0) {
-			ast_log(LOG_WARNING, "Insert failed on '%s:%s'.  CEL failed: %s\n", tableptr->connection, tableptr->table, ast_str_buffer(sql));
+		if (rows) {
+			odbc_insert(tableptr, obj, statement, rows);
 		}
-early_release:
+
 		ast_odbc_release_obj(obj);
 	}
 	AST_RWLIST_UNLOCK(&odbc_tables);
@@ -801,18 +827,28 @@ early_release:
 		maxsize2 = ast_str_strlen(sql2);
 	}
 
+cleanup:
 	ast_free(sql);
 	ast_free(sql2);
+	ast_free(columns);
+	ast_free(statement);
+}
+
+static void odbc_log(struct ast_event *event)
+{
+	odbc_log_batch(&event, 1);
 }
 
 static int unload_module(void)
 {
+	/* Unregistering hands us the events queued for us */
+	ast_cel_backend_unregister(ODBC_BACKEND_NAME);
+
 	if (AST_RWLIST_WRLOCK(&odbc_tables)) {
 		ast_log(LOG_ERROR, "Unable to lock column list.  Unload failed.\n");
 		return -1;
 	}
 
-	ast_cel_backend_unregister(ODBC_BACKEND_NAME);
 	free_config();
 	AST_RWLIST_UNLOCK(&odbc_tables);
 	AST_RWLIST_HEAD_DESTROY(&odbc_tables);
@@ -830,7 +866,7 @@ static int load_module(void)
 	}
 	load_config();
 	AST_RWLIST_UNLOCK(&odbc_tables);
-	if (ast_cel_backend_register(ODBC_BACKEND_NAME, odbc_log)) {
+	if (ast_cel_backend_register_batch(ODBC_BACKEND_NAME, odbc_log, odbc_log_batch)) {
 		ast_log(LOG_ERROR, "Unable to subscribe to CEL events\n");
 		free_config();
 		return AST_MODULE_LOAD_DECLINE;
@@ -94,25 +94,6 @@ struct columns {
 
 static AST_RWLIST_HEAD_STATIC(psql_columns, columns);
 
-#define LENGTHEN_BUF(size, var_sql) \
-	do { \
-		/* Lengthen buffer, if necessary */ \
-		if (ast_str_strlen(var_sql) + size + 1 > ast_str_size(var_sql)) { \
-			if (ast_str_make_space(&var_sql, ((ast_str_size(var_sql) + size + 3) / 512 + 1) * 512) != 0) { \
-				ast_log(LOG_ERROR, "Unable to allocate sufficient memory.  Insert CEL '%s:%s' failed.\n", pghostname, table); \
-				ast_free(sql); \
-				ast_free(sql2); \
-				AST_RWLIST_UNLOCK(&psql_columns); \
-				return; \
-			} \
-		} \
-	} while (0)
-
-#define LENGTHEN_BUF1(size) \
-	LENGTHEN_BUF(size, sql);
-#define LENGTHEN_BUF2(size) \
-	LENGTHEN_BUF(size, sql2);
-
 static void pgsql_reconnect(void)
 {
 	struct ast_str *conn_info = ast_str_create(128);
@@ -142,23 +123,173 @@ static void pgsql_reconnect(void)
 }
 
 
-static void pgsql_log(struct ast_event *event)
+/*!
+ * \internal
+ * \brief Append the values of the row for an event to an insert
+ *
+ * \note Called with pgsql_lock and the column list locked, and connected
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int pgsql_append_row(struct ast_str **sql2, struct ast_event *event, char **escapebuf, size_t *bufsize)
 {
 	struct ast_tm tm;
-	char timestr[128];
-	char *pgerror;
+	struct columns *cur;
+	char buf[257];
+	const char *value;
+	int first = 1;
 	struct ast_cel_event_record record = {
 		.version = AST_CEL_EVENT_RECORD_VERSION,
 	};
 
 	if (ast_cel_fill_record(event, &record)) {
-		return;
+		return -1;
 	}
 
-	ast_mutex_lock(&pgsql_lock);
+	ast_str_append(sql2, 0, "%s(", ast_str_strlen(*sql2) ? "," : "");
+
+#define SEP (first ? "" : ",")
+
+	AST_RWLIST_TRAVERSE(&psql_columns, cur, list) {
+		if (strcmp(cur->name, "eventtime") == 0) {
+			if (strncmp(cur->type, "int", 3) == 0) {
+				ast_str_append(sql2, 0, "%s%ld", SEP, (long) record.event_time.tv_sec);
+			} else if (strncmp(cur->type, "float", 5) == 0) {
+				ast_str_append(sql2, 0, "%s%f",
+					SEP,
+					(double) record.event_time.tv_sec +
+					(double) record.event_time.tv_usec / 1000000.0);
+			} else {
+				/* char, hopefully */
+				ast_localtime(&record.event_time, &tm, usegmtime ? "GMT" : NULL);
+				ast_strftime(buf, sizeof(buf), DATE_FORMAT, &tm);
+				ast_str_append(sql2, 0, "%s'%s'", SEP, buf);
+			}
+		} else if (strcmp(cur->name, "eventtype") == 0) {
+			if (cur->type[0] == 'i') {
+				/* Get integer, no need to escape anything */
+				ast_str_append(sql2, 0, "%s%d", SEP, (int) record.event_type);
+			} else if (strncmp(cur->type, "float", 5) == 0) {
+				ast_str_append(sql2, 0, "%s%f", SEP, (double) record.event_type);
+			} else {
+				/* Char field, probably */
+				const char *event_name;
+
+				event_name = (!cel_show_user_def
+					&& record.event_type == AST_CEL_USER_DEFINED)
+					? record.user_defined_name : record.event_name;
+				ast_str_append(sql2, 0, "%s'%s'", SEP, event_name);
+			}
+		} else if (strcmp(cur->name, "amaflags") == 0) {
+			if (strncmp(cur->type, "int", 3) == 0) {
+				/* Integer, no need to escape anything */
+				ast_str_append(sql2, 0, "%s%u", SEP, record.amaflag);
+			} else {
+				/* Although this is a char field, there are no special characters in the values for these fields */
+				ast_str_append(sql2, 0, "%s'%u'", SEP, record.amaflag);
+			}
+		} else {
+			/* Arbitrary field, could be anything */
+			if (strcmp(cur->name, "userdeftype") == 0) {
+				value = record.user_defined_name;
+			} else if (strcmp(cur->name, "cid_name") == 0) {
+				value = record.caller_id_name;
+			} else if (strcmp(cur->name, "cid_num") == 0) {
+				value = record.caller_id_num;
+			} else if (strcmp(cur->name, "cid_ani") == 0) {
+				value = record.caller_id_ani;
+			} else if (strcmp(cur->name, "cid_rdnis") == 0) {
+				value = record.caller_id_rdnis;
+			} else if (strcmp(cur->name, "cid_dnid") == 0) {
+				value = record.caller_id_dnid;
+			} else if (strcmp(cur->name, "exten") == 0) {
+				value = record.extension;
+			} else if (strcmp(cur->name, "context") == 0) {
+				value = record.context;
+			} else if (strcmp(cur->name, "channame") == 0) {
+				value = record.channel_name;
+			} else if (strcmp(cur->name, "appname") == 0) {
+				value = record.application_name;
+			} else if (strcmp(cur->name, "appdata") == 0) {
+				value = record.application_data;
+			} else if (strcmp(cur->name, "accountcode") == 0) {
+				value = record.account_code;
+			} else if (strcmp(cur->name, "peeraccount") == 0) {
+				value = record.peer_account;
+			} else if (strcmp(cur->name, "uniqueid") == 0) {
+				value = record.unique_id;
+			} else if (strcmp(cur->name, "linkedid") == 0) {
+				value = record.linked_id;
+			} else if (strcmp(cur->name, "userfield") == 0) {
+				value = record.user_field;
+			} else if (strcmp(cur->name, "peer") == 0) {
+				value = record.peer;
+			} else if (strcmp(cur->name, "extra") == 0) {
+				value = record.extra;
+			} else {
+				value = NULL;
+			}
 
-	ast_localtime(&record.event_time, &tm, usegmtime ? "GMT" : NULL);
-	ast_strftime(timestr, sizeof(timestr), DATE_FORMAT, &tm);
+			if (value == NULL) {
+				ast_str_append(sql2, 0, "%sDEFAULT", SEP);
+			} else if (strncmp(cur->type, "int", 3) == 0) {
+				long long whatever;
+				if (value && sscanf(value, "%30lld", &whatever) == 1) {
+					ast_str_append(sql2, 0, "%s%lld", SEP, whatever);
+				} else {
+					ast_str_append(sql2, 0, "%s0", SEP);
+				}
+			} else if (strncmp(cur->type, "float", 5) == 0) {
+				long double whatever;
+				if (value && sscanf(value, "%30Lf", &whatever) == 1) {
+					ast_str_append(sql2, 0, "%s%30Lf", SEP, whatever);
+				} else {
+					ast_str_append(sql2, 0, "%s0", SEP);
+				}
+				/* XXX Might want to handle dates, times, and other misc fields here XXX */
+			} else {
+				size_t required_size = strlen(value) * 2 + 1;
+
+				/* If our argument size exceeds our buffer, grow it,
+				 * as PQescapeStringConn() expects the buffer to be
+				 * adequitely sized and does *NOT* do size checking.
+				 */
+				if (required_size > *bufsize) {
+					char *tmpbuf = ast_realloc(*escapebuf, required_size);
+
+					if (!tmpbuf) {
+						return -1;
+					}
+
+					*escapebuf = tmpbuf;
+					*bufsize = required_size;
+				}
+				PQescapeStringConn(conn, *escapebuf, value, strlen(value), NULL);
+				ast_str_append(sql2, 0, "%s'%s'", SEP, *escapebuf);
+			}
+		}
+		first = 0;
+	}
+
+	ast_str_append(sql2, 0, ")");
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Insert events with one statement
+ *
+ * \retval 0 on success
+ * \retval -1 if the events were not inserted
+ */
+static int pgsql_insert(struct ast_event **events, size_t count)
+{
+	char *pgerror;
+	int res = -1;
+
+	ast_mutex_lock(&pgsql_lock);
 
 	if ((!connected) && pghostname && pgdbuser && pgpassword && pgdbname) {
 		pgsql_reconnect();
@@ -175,11 +306,10 @@ static void pgsql_log(struct ast_event *event)
 	if (connected) {
 		struct columns *cur;
 		struct ast_str *sql = ast_str_create(maxsize), *sql2 = ast_str_create(maxsize2);
-		char buf[257];
 		char *escapebuf = NULL;
-		const char *value;
 		int first = 1;
 		size_t bufsize = 513;
+		size_t i;
 
 		escapebuf = ast_malloc(bufsize);
 		if (!escapebuf || !sql || !sql2) {
@@ -187,157 +317,27 @@ static void pgsql_log(struct ast_event *event)
 		}
 
 		ast_str_set(&sql, 0, "INSERT INTO %s (", table);
-		ast_str_set(&sql2, 0, " VALUES (");
-
-#define SEP (first ? "" : ",")
 
 		AST_RWLIST_RDLOCK(&psql_columns);
 		AST_RWLIST_TRAVERSE(&psql_columns, cur, list) {
-			LENGTHEN_BUF1(strlen(cur->name) + 2);
 			ast_str_append(&sql, 0, "%s\"%s\"", SEP, cur->name);
+			first = 0;
+		}
+		for (i = 0; i < count; i++) {
+			size_t len = ast_str_strlen(sql2);
 
-			if (strcmp(cur->name, "eventtime") == 0) {
-				if (strncmp(cur->type, "int", 3) == 0) {
-					LENGTHEN_BUF2(13);
-					ast_str_append(&sql2, 0, "%s%ld", SEP, (long) record.event_time.tv_sec);
-				} else if (strncmp(cur->type, "float", 5) == 0) {
-					LENGTHEN_BUF2(31);
-					ast_str_append(&sql2, 0, "%s%f",
-						SEP,
-						(double) record.event_time.tv_sec +
-						(double) record.event_time.tv_usec / 1000000.0);
-				} else {
-					/* char, hopefully */
-					LENGTHEN_BUF2(31);
-					ast_localtime(&record.event_time, &tm, usegmtime ? "GMT" : NULL);
-					ast_strftime(buf, sizeof(buf), DATE_FORMAT, &tm);
-					ast_str_append(&sql2, 0, "%s'%s'", SEP, buf);
-				}
-			} else if (strcmp(cur->name, "eventtype") == 0) {
-				if (cur->type[0] == 'i') {
-					/* Get integer, no need to escape anything */
-					LENGTHEN_BUF2(5);
-					ast_str_append(&sql2, 0, "%s%d", SEP, (int) record.event_type);
-				} else if (strncmp(cur->type, "float", 5) == 0) {
-					LENGTHEN_BUF2(31);
-					ast_str_append(&sql2, 0, "%s%f", SEP, (double) record.event_type);
-				} else {
-					/* Char field, probably */
-					const char *event_name;
-
-					event_name = (!cel_show_user_def
-						&& record.event_type == AST_CEL_USER_DEFINED)
-						? record.user_defined_name : record.event_name;
-					LENGTHEN_BUF2(strlen(event_name) + 1);
-					ast_str_append(&sql2, 0, "%s'%s'", SEP, event_name);
-				}
-			} else if (strcmp(cur->name, "amaflags") == 0) {
-				if (strncmp(cur->type, "int", 3) == 0) {
-					/* Integer, no need to escape anything */
-					LENGTHEN_BUF2(13);
-					ast_str_append(&sql2, 0, "%s%u", SEP, record.amaflag);
-				} else {
-					/* Although this is a char field, there are no special characters in the values for these fields */
-					LENGTHEN_BUF2(31);
-					ast_str_append(&sql2, 0, "%s'%u'", SEP, record.amaflag);
-				}
-			} else {
-				/* Arbitrary field, could be anything */
-				if (strcmp(cur->name, "userdeftype") == 0) {
-					value = record.user_defined_name;
-				} else if (strcmp(cur->name, "cid_name") == 0) {
-					value = record.caller_id_name;
-				} else if (strcmp(cur->name, "cid_num") == 0) {
-					value = record.caller_id_num;
-				} else if (strcmp(cur->name, "cid_ani") == 0) {
-					value = record.caller_id_ani;
-				} else if (strcmp(cur->name, "cid_rdnis") == 0) {
-					value = record.caller_id_rdnis;
-				} else if (strcmp(cur->name, "cid_dnid") == 0) {
-					value = record.caller_id_dnid;
-				} else if (strcmp(cur->name, "exten") == 0) {
-					value = record.extension;
-				} else if (strcmp(cur->name, "context") == 0) {
-					value = record.context;
-				} else if (strcmp(cur->name, "channame") == 0) {
-					value = record.channel_name;
-				} else if (strcmp(cur->name, "appname") == 0) {
-					value = record.application_name;
-				} else if (strcmp(cur->name, "appdata") == 0) {
-					value = record.application_data;
-				} else if (strcmp(cur->name, "accountcode") == 0) {
-					value = record.account_code;
-				} else if (strcmp(cur->name, "peeraccount") == 0) {
-					value = record.peer_account;
-				} else if (strcmp(cur->name, "uniqueid") == 0) {
-					value = record.unique_id;
-				} else if (strcmp(cur->name, "linkedid") == 0) {
-					value = record.linked_id;
-				} else if (strcmp(cur->name, "userfield") == 0) {
-					value = record.user_field;
-				} else if (strcmp(cur->name, "peer") == 0) {
-					value = record.peer;
-				} else if (strcmp(cur->name, "extra") == 0) {
-					value = record.extra;
-				} else {
-					value = NULL;
-				}
-
-				if (value == NULL) {
-					ast_str_append(&sql2, 0, "%sDEFAULT", SEP);
-				} else if (strncmp(cur->type, "int", 3) == 0) {
-					long long whatever;
-					if (value && sscanf(value, "%30lld", &whatever) == 1) {
-						LENGTHEN_BUF2(26);
-						ast_str_append(&sql2, 0, "%s%lld", SEP, whatever);
-					} else {
-						LENGTHEN_BUF2(2);
-						ast_str_append(&sql2, 0, "%s0", SEP);
-					}
-				} else if (strncmp(cur->type, "float", 5) == 0) {
-					long double whatever;
-					if (value && sscanf(value, "%30Lf", &whatever) == 1) {
-						LENGTHEN_BUF2(51);
-						ast_str_append(&sql2, 0, "%s%30Lf", SEP, whatever);
-					} else {
-						LENGTHEN_BUF2(2);
-						ast_str_append(&sql2, 0, "%s0", SEP);
-					}
-					/* XXX Might want to handle dates, times, and other misc fields here XXX */
-				} else {
-					if (value) {
-						size_t required_size = strlen(value) * 2 + 1;
-
-						/* If our argument size exceeds our buffer, grow it,
-						 * as PQescapeStringConn() expects the buffer to be
-						 * adequitely sized and does *NOT* do size checking.
-						 */
-						if (required_size > bufsize) {
-							char *tmpbuf = ast_realloc(escapebuf, required_size);
-
-							if (!tmpbuf) {
-								AST_RWLIST_UNLOCK(&psql_columns);
-								goto ast_log_cleanup;
-							}
-
-							escapebuf = tmpbuf;
-							bufsize = required_size;
-						}
-						PQescapeStringConn(conn, escapebuf, value, strlen(value), NULL);
-					} else {
-						escapebuf[0] = '\0';
-					}
-					LENGTHEN_BUF2(strlen(escapebuf) + 3);
-					ast_str_append(&sql2, 0, "%s'%s'", SEP, escapebuf);
-				}
+			/* A record that cannot be built is left out of the insert */
+			if (pgsql_append_row(&sql2, events[i], &escapebuf, &bufsize)) {
+				ast_str_truncate(sql2, len);
 			}
-			first = 0;
 		}
 		AST_RWLIST_UNLOCK(&psql_columns);
-		LENGTHEN_BUF1(ast_str_strlen(sql2) + 2);
-		ast_str_append(&sql, 0, ")%s)", ast_str_buffer(sql2));
+		if (!ast_str_strlen(sql2)) {
+			goto ast_log_cleanup;
+		}
+		ast_str_append(&sql, 0, ") VALUES %s", ast_str_buffer(sql2));
 
-		ast_debug(3, "Inserting a CEL record: [%s].\n", ast_str_buffer(sql));
+		ast_debug(3, "Inserting %zu CEL record(s): [%s].\n", count, ast_str_buffer(sql));
 		/* Test to be sure we're still connected... */
 		/* If we're connected, and connection is working, good. */
 		/* Otherwise, attempt reconnect.  If it fails... sorry... */
@@ -375,8 +375,12 @@ static void pgsql_log(struct ast_event *event)
 					pgerror = PQresultErrorMessage(result);
 					ast_log(LOG_ERROR, "HARD ERROR!  Attempted reconnection failed.  DROPPING CALL RECORD!\n");
 					ast_log(LOG_ERROR, "Reason: %s\n", pgerror);
+				} else {
+					res = 0;
 				}
 			}
+		} else {
+			res = 0;
 		}
 		PQclear(result);
 
@@ -395,6 +399,28 @@ ast_log_cleanup:
 	}
 
 	ast_mutex_unlock(&pgsql_lock);
+
+	return res;
+}
+
+static void pgsql_log(struct ast_event *event)
+{
+	pgsql_insert(&event, 1);
+}
+
+static void pgsql_log_batch(struct ast_event **events, size_t count)
+{
+	size_t i;
+
+	if (!pgsql_insert(events, count) || count == 1 || !connected) {
+		return;
+	}
+
+	/* Do not let one bad record take the others down with it */
+	ast_log(LOG_NOTICE, "Inserting the %zu CEL records one at a time\n", count);
+	for (i = 0; i < count; i++) {
+		pgsql_insert(&events[i], 1);
+	}
 }
 
 static int my_unload_module(void)
@@ -681,7 +707,7 @@ static int my_load_module(int reload)
 	process_my_load_module(cfg);
 	ast_config_destroy(cfg);
 
-	if (ast_cel_backend_register(PGSQL_BACKEND_NAME, pgsql_log)) {
+	if (ast_cel_backend_register_batch(PGSQL_BACKEND_NAME, pgsql_log, pgsql_log_batch)) {
 		ast_log(LOG_WARNING, "Unable to subscribe to CEL events for pgsql\n");
 		return AST_MODULE_LOAD_DECLINE;
 	}
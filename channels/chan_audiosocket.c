@@ -42,10 +42,8 @@
 #include "asterisk/causes.h"
 #include "asterisk/format_cache.h"
 
-#define FD_OUTPUT 1	/* A fd of -1 means an error, 0 is stdin */
-
 struct audiosocket_instance {
-	int svc;	/* The file descriptor for the AudioSocket instance */
+	struct ast_audiosocket_session *session;	/* The session of the AudioSocket instance */
 	char id[38];	/* The UUID identifying this AudioSocket instance */
 } audiosocket_instance;
 
@@ -76,10 +74,10 @@ static struct ast_frame *audiosocket_read(struct ast_channel *ast)
 
 	/* The channel should always be present from the API */
 	instance = ast_channel_tech_pvt(ast);
-	if (instance == NULL || instance->svc < FD_OUTPUT) {
+	if (instance == NULL || !instance->session) {
 		return NULL;
 	}
-	return ast_audiosocket_receive_frame(instance->svc);
+	return ast_audiosocket_session_receive_frame(instance->session);
 }
 
 /*! \brief Function called when we should write a frame to the channel */
@@ -89,10 +87,10 @@ static int audiosocket_write(struct ast_channel *ast, struct ast_frame *f)
 
 	/* The channel should always be present from the API */
 	instance = ast_channel_tech_pvt(ast);
-	if (instance == NULL || instance->svc < 1) {
+	if (instance == NULL || !instance->session) {
 		return -1;
 	}
-	return ast_audiosocket_send_frame(instance->svc, f);
+	return ast_audiosocket_session_send_frame(instance->session, f);
 }
 
 /*! \brief Function called when we should actually call the destination */
@@ -102,7 +100,7 @@ static int audiosocket_call(struct ast_channel *ast, const char *dest, int timeo
 
 	ast_queue_control(ast, AST_CONTROL_ANSWER);
 
-	return ast_audiosocket_init(instance->svc, instance->id);
+	return ast_audiosocket_session_init(instance->session);
 }
 
 /*! \brief Function called when we should hang the channel up */
@@ -112,8 +110,8 @@ static int audiosocket_hangup(struct ast_channel *ast)
 
 	/* The channel should always be present from the API */
 	instance = ast_channel_tech_pvt(ast);
-	if (instance != NULL && instance->svc > 0) {
-		close(instance->svc);
+	if (instance != NULL) {
+		ast_audiosocket_session_close(instance->session);
 	}
 
 	ast_channel_tech_pvt_set(ast, NULL);
@@ -124,15 +122,20 @@ static int audiosocket_hangup(struct ast_channel *ast)
 
 enum {
 	OPT_AUDIOSOCKET_CODEC = (1 << 0),
+	OPT_AUDIOSOCKET_MULTIPLEX = (1 << 1),
+	OPT_AUDIOSOCKET_AGGREGATE = (1 << 2),
 };
 
 enum {
 	OPT_ARG_AUDIOSOCKET_CODEC = (1 << 0),
+	OPT_ARG_AUDIOSOCKET_AGGREGATE,
 	OPT_ARG_ARRAY_SIZE
 };
 
 AST_APP_OPTIONS(audiosocket_options, BEGIN_OPTIONS
 	AST_APP_OPTION_ARG('c', OPT_AUDIOSOCKET_CODEC, OPT_ARG_AUDIOSOCKET_CODEC),
+	AST_APP_OPTION('m', OPT_AUDIOSOCKET_MULTIPLEX),
+	AST_APP_OPTION_ARG('a', OPT_AUDIOSOCKET_AGGREGATE, OPT_ARG_AUDIOSOCKET_AGGREGATE),
 END_OPTIONS );
 
 /*! \brief Function called when we should prepare to call the unicast destination */
@@ -147,7 +150,7 @@ static struct ast_channel *audiosocket_request(const char *type,
 	struct ast_format_cap *caps = NULL;
 	struct ast_format *fmt = NULL;
 	uuid_t uu;
-	int fd = -1;
+	unsigned int aggregate_ms = 0;
 	AST_DECLARE_APP_ARGS(args,
 		AST_APP_ARG(destination);
 		AST_APP_ARG(idStr);
@@ -190,6 +193,14 @@ static struct ast_channel *audiosocket_request(const char *type,
 		goto failure;
 	}
 
+	if (ast_test_flag(&opts, OPT_AUDIOSOCKET_AGGREGATE)
+		&& (ast_strlen_zero(opt_args[OPT_ARG_AUDIOSOCKET_AGGREGATE])
+			|| sscanf(opt_args[OPT_ARG_AUDIOSOCKET_AGGREGATE], "%30u", &aggregate_ms) != 1)) {
+		ast_log(LOG_ERROR, "Invalid aggregation '%s' for AudioSocket connection to '%s'\n",
+			S_OR(opt_args[OPT_ARG_AUDIOSOCKET_AGGREGATE], ""), args.destination);
+		goto failure;
+	}
+
 	if (ast_test_flag(&opts, OPT_AUDIOSOCKET_CODEC)
 		&& !ast_strlen_zero(opt_args[OPT_ARG_AUDIOSOCKET_CODEC])) {
 		fmt = ast_format_cache_get(opt_args[OPT_ARG_AUDIOSOCKET_CODEC]);
@@ -219,17 +230,18 @@ static struct ast_channel *audiosocket_request(const char *type,
 	}
 	ast_copy_string(instance->id, args.idStr, sizeof(instance->id));
 
-	if ((fd = ast_audiosocket_connect(args.destination, NULL)) < 0) {
+	instance->session = ast_audiosocket_session_open(args.destination, args.idStr, NULL,
+		ast_test_flag(&opts, OPT_AUDIOSOCKET_MULTIPLEX), aggregate_ms);
+	if (!instance->session) {
 		goto failure;
 	}
-	instance->svc = fd;
 
 	chan = ast_channel_alloc(1, AST_STATE_DOWN, "", "", "", "", "", assignedids,
 		requestor, 0, "AudioSocket/%s-%s", args.destination, args.idStr);
 	if (!chan) {
 		goto failure;
 	}
-	ast_channel_set_fd(chan, 0, fd);
+	ast_channel_set_fd(chan, 0, ast_audiosocket_session_fd(instance->session));
 
 	ast_channel_tech_set(chan, &audiosocket_channel_tech);
 
@@ -256,10 +268,8 @@ failure:
 	ao2_cleanup(fmt);
 	ao2_cleanup(caps);
 	if (instance != NULL) {
+		ast_audiosocket_session_close(instance->session);
 		ast_free(instance);
-		if (fd >= 0) {
-			close(fd);
-		}
 	}
 
 	return NULL;
@@ -481,7 +481,18 @@ static int iax2_authmethods = 0;
 
 static struct ast_flags64 globalflags = { 0 };
 
-static pthread_t netthreadid = AST_PTHREADT_NULL;
+/*! The most threads that may receive from the network */
+#define MAX_NETWORK_THREADS 32
+
+/*!
+ * The threads receiving from the network.  Each has a socket of its own
+ * for every address bound, all sharing the address, and the first one
+ * also drives the trunk timer.
+ */
+static int iaxnetworkthreads = 1;
+static pthread_t netthreadids[MAX_NETWORK_THREADS];
+/*! The I/O context of each network thread, the first of which is io */
+static struct io_context *netios[MAX_NETWORK_THREADS];
 
 enum iax2_state {
 	IAX_STATE_STARTED =			(1 << 0),
@@ -650,14 +661,33 @@ struct iax2_trunk_peer {
 	unsigned char *trunkdata;
 	unsigned int trunkdatalen;
 	unsigned int trunkdataalloc;
+	/*! Trunk data being sent, traded with trunkdata when the trunk timer fires */
+	unsigned char *txdata;
+	unsigned int txdataalloc;
 	int trunkmaxmtu;
 	int trunkerror;
 	int calls;
 	AST_LIST_ENTRY(iax2_trunk_peer) list;
+	/*! The entry in the bucket of tpeer_buckets for the address */
+	AST_LIST_ENTRY(iax2_trunk_peer) bucket_list;
 };
 
 static AST_LIST_HEAD_STATIC(tpeers, iax2_trunk_peer);
 
+/*! Trunk peers by address, guarded by the tpeers lock, so each frame queued finds its peer at once */
+#define TPEER_BUCKETS 127
+static AST_LIST_HEAD_NOLOCK(tpeer_bucket, iax2_trunk_peer) tpeer_buckets[TPEER_BUCKETS];
+
+#define TPEER_BUCKET(addr) (&tpeer_buckets[(unsigned int) ast_sockaddr_hash(addr) % TPEER_BUCKETS])
+
+#ifdef MSG_WAITFORONE
+/*! The frames of all trunks are sent with sendmmsg() when the trunk timer fires */
+#define USE_TRUNK_BATCH
+#endif
+
+/*! The most trunk frames sent by one system call */
+#define TRUNK_BATCH_SIZE 64
+
 enum iax_reg_state {
 	REG_STATE_UNREGISTERED = 0,
 	REG_STATE_REGSENT,
@@ -6328,7 +6358,7 @@ static struct iax2_trunk_peer *find_tpeer(struct ast_sockaddr *addr, int fd)
 	/* Finds and locks trunk peer */
 	AST_LIST_LOCK(&tpeers);
 
-	AST_LIST_TRAVERSE(&tpeers, tpeer, list) {
+	AST_LIST_TRAVERSE(TPEER_BUCKET(addr), tpeer, bucket_list) {
 		if (!ast_sockaddr_cmp(&tpeer->addr, addr)) {
 			ast_mutex_lock(&tpeer->lock);
 			break;
@@ -6349,6 +6379,7 @@ static struct iax2_trunk_peer *find_tpeer(struct ast_sockaddr *addr, int fd)
 #endif
 			ast_debug(1, "Created trunk peer for '%s'\n", ast_sockaddr_stringify(&tpeer->addr));
 			AST_LIST_INSERT_TAIL(&tpeers, tpeer, list);
+			AST_LIST_INSERT_HEAD(TPEER_BUCKET(&tpeer->addr), tpeer, bucket_list);
 		}
 	}
 
@@ -9548,40 +9579,54 @@ static int iax2_poke_peer_s(const void *data)
 	return 0;
 }
 
-static int send_trunk(struct iax2_trunk_peer *tpeer, struct timeval *now)
+/*!
+ * \brief Fill in the headers of the trunk frame queued for a trunk peer
+ *
+ * \return the frame, NULL if nothing is queued
+ */
+static struct iax_frame *build_trunk(struct iax2_trunk_peer *tpeer, struct timeval *now)
 {
-	int res = 0;
 	struct iax_frame *fr;
 	struct ast_iax2_meta_hdr *meta;
 	struct ast_iax2_meta_trunk_hdr *mth;
-	int calls = 0;
+
+	if (!tpeer->trunkdatalen) {
+		return NULL;
+	}
 
 	/* Point to frame */
 	fr = (struct iax_frame *)tpeer->trunkdata;
 	/* Point to meta data */
 	meta = (struct ast_iax2_meta_hdr *)fr->afdata;
 	mth = (struct ast_iax2_meta_trunk_hdr *)meta->data;
-	if (tpeer->trunkdatalen) {
-		/* We're actually sending a frame, so fill the meta trunk header and meta header */
-		meta->zeros = 0;
-		meta->metacmd = IAX_META_TRUNK;
-		if (ast_test_flag64(&globalflags, IAX_TRUNKTIMESTAMPS))
-			meta->cmddata = IAX_META_TRUNK_MINI;
-		else
-			meta->cmddata = IAX_META_TRUNK_SUPERMINI;
-		mth->ts = htonl(calc_txpeerstamp(tpeer, trunkfreq, now));
-		/* And the rest of the ast_iax2 header */
-		fr->direction = DIRECTION_OUTGRESS;
-		fr->retrans = -1;
-		fr->transfer = 0;
-		/* Any appropriate call will do */
-		fr->data = fr->afdata;
-		fr->datalen = tpeer->trunkdatalen + sizeof(struct ast_iax2_meta_hdr) + sizeof(struct ast_iax2_meta_trunk_hdr);
+	/* We're actually sending a frame, so fill the meta trunk header and meta header */
+	meta->zeros = 0;
+	meta->metacmd = IAX_META_TRUNK;
+	if (ast_test_flag64(&globalflags, IAX_TRUNKTIMESTAMPS))
+		meta->cmddata = IAX_META_TRUNK_MINI;
+	else
+		meta->cmddata = IAX_META_TRUNK_SUPERMINI;
+	mth->ts = htonl(calc_txpeerstamp(tpeer, trunkfreq, now));
+	/* And the rest of the ast_iax2 header */
+	fr->direction = DIRECTION_OUTGRESS;
+	fr->retrans = -1;
+	fr->transfer = 0;
+	/* Any appropriate call will do */
+	fr->data = fr->afdata;
+	fr->datalen = tpeer->trunkdatalen + sizeof(struct ast_iax2_meta_hdr) + sizeof(struct ast_iax2_meta_trunk_hdr);
+
+	return fr;
+}
+
+static int send_trunk(struct iax2_trunk_peer *tpeer, struct timeval *now)
+{
+	int res = 0;
+	struct iax_frame *fr;
+	int calls = 0;
+
+	if ((fr = build_trunk(tpeer, now))) {
 		res = transmit_trunk(fr, &tpeer->addr, tpeer->sockfd);
 		calls = tpeer->calls;
-#if 0
-		ast_debug(1, "Trunking %d call chunks in %d bytes to %s:%d, ts=%d\n", calls, fr->datalen, ast_inet_ntoa(tpeer->addr.sin_addr), ntohs(tpeer->addr.sin_port), ntohl(mth->ts));
-#endif
 		/* Reset transmit trunk side data */
 		tpeer->trunkdatalen = 0;
 		tpeer->calls = 0;
@@ -9591,6 +9636,79 @@ static int send_trunk(struct iax2_trunk_peer *tpeer, struct timeval *now)
 	return calls;
 }
 
+#ifdef USE_TRUNK_BATCH
+/*! \brief The trunk frames sent at once when the trunk timer fires */
+struct trunk_batch {
+	int sockfd;
+	unsigned int count;
+	struct mmsghdr msgs[TRUNK_BATCH_SIZE];
+	struct iovec iov[TRUNK_BATCH_SIZE];
+};
+
+static void trunk_batch_flush(struct trunk_batch *batch)
+{
+	unsigned int sent = 0;
+	int res;
+
+	while (sent < batch->count) {
+		res = sendmmsg(batch->sockfd, batch->msgs + sent, batch->count - sent, 0);
+		if (res <= 0) {
+			ast_debug(1, "Received error: %s\n", strerror(errno));
+			handle_error();
+			break;
+		}
+		sent += res;
+	}
+	batch->count = 0;
+}
+
+/*!
+ * \brief Queue the trunk frame of a trunk peer on the batch
+ *
+ * The filled trunk data is traded for the spare buffer of the peer, so
+ * frames can be queued for the next interval while this one is sent.
+ *
+ * \note The batch must be flushed before the peer is next sent from.
+ */
+static int batch_trunk(struct trunk_batch *batch, struct iax2_trunk_peer *tpeer, struct timeval *now)
+{
+	struct iax_frame *fr;
+	unsigned char *data;
+	unsigned int alloc;
+	int calls;
+
+	if (!(fr = build_trunk(tpeer, now))) {
+		return 0;
+	}
+
+	if (batch->count && (batch->count == TRUNK_BATCH_SIZE || batch->sockfd != tpeer->sockfd)) {
+		trunk_batch_flush(batch);
+	}
+	batch->sockfd = tpeer->sockfd;
+	batch->iov[batch->count].iov_base = fr->data;
+	batch->iov[batch->count].iov_len = fr->datalen;
+	memset(&batch->msgs[batch->count], 0, sizeof(batch->msgs[0]));
+	batch->msgs[batch->count].msg_hdr.msg_name = &tpeer->addr.ss;
+	batch->msgs[batch->count].msg_hdr.msg_namelen = tpeer->addr.len;
+	batch->msgs[batch->count].msg_hdr.msg_iov = &batch->iov[batch->count];
+	batch->msgs[batch->count].msg_hdr.msg_iovlen = 1;
+	batch->count++;
+
+	data = tpeer->txdata;
+	alloc = tpeer->txdataalloc;
+	tpeer->txdata = tpeer->trunkdata;
+	tpeer->txdataalloc = tpeer->trunkdataalloc;
+	tpeer->trunkdata = data;
+	tpeer->trunkdataalloc = alloc;
+
+	calls = tpeer->calls;
+	tpeer->trunkdatalen = 0;
+	tpeer->calls = 0;
+
+	return calls;
+}
+#endif
+
 static inline int iax2_trunk_expired(struct iax2_trunk_peer *tpeer, struct timeval *now)
 {
 	/* Drop when trunk is about 5 seconds idle */
@@ -9604,6 +9722,10 @@ static int timing_read(int *id, int fd, short events, void *cbdata)
 	int res, processed = 0, totalcalls = 0;
 	struct iax2_trunk_peer *tpeer = NULL, *drop = NULL;
 	struct timeval now = ast_tvnow();
+#ifdef USE_TRUNK_BATCH
+	/* Only ever used by the one network thread driving the trunk timer */
+	static struct trunk_batch batch;
+#endif
 
 	if (iaxtrunkdebug) {
 		ast_verbose("Beginning trunk processing. Trunk queue ceiling is %d bytes per host\n", trunkmaxsize);
@@ -9628,9 +9750,14 @@ static int timing_read(int *id, int fd, short events, void *cbdata)
 			/* Take it out of the list, but don't free it yet, because it
 			   could be in use */
 			AST_LIST_REMOVE_CURRENT(list);
+			AST_LIST_REMOVE(TPEER_BUCKET(&tpeer->addr), tpeer, bucket_list);
 			drop = tpeer;
 		} else {
+#ifdef USE_TRUNK_BATCH
+			res = batch_trunk(&batch, tpeer, &now);
+#else
 			res = send_trunk(tpeer, &now);
+#endif
 			trunk_timed++;
 			if (iaxtrunkdebug) {
 				ast_verbose(" - Trunk peer (%s) has %d call chunk%s in transit, %u bytes backlogged and has hit a high water mark of %u bytes\n",
@@ -9648,6 +9775,11 @@ static int timing_read(int *id, int fd, short events, void *cbdata)
 	AST_LIST_TRAVERSE_SAFE_END;
 	AST_LIST_UNLOCK(&tpeers);
 
+#ifdef USE_TRUNK_BATCH
+	/* Peers are only freed below, so what the batch points to is still there */
+	trunk_batch_flush(&batch);
+#endif
+
 	if (drop) {
 		ast_mutex_lock(&drop->lock);
 		/*  Once we have this lock, we're sure nobody else is using it or could use it once we release it,
@@ -9657,6 +9789,8 @@ static int timing_read(int *id, int fd, short events, void *cbdata)
 			ast_free(drop->trunkdata);
 			drop->trunkdata = NULL;
 		}
+		ast_free(drop->txdata);
+		drop->txdata = NULL;
 		ast_mutex_unlock(&drop->lock);
 		ast_mutex_destroy(&drop->lock);
 		ast_free(drop);
@@ -12740,11 +12874,12 @@ static struct ast_channel *iax2_request(const char *type, struct ast_format_cap
 	return c;
 }
 
-static void *network_thread(void *ignore)
+static void *network_thread(void *data)
 {
+	struct io_context *ioc = data;
 	int res;
 
-	if (timer) {
+	if (timer && ioc == io) {
 		ast_io_add(io, ast_timer_fd(timer), timing_read, AST_IO_IN | AST_IO_PRI, NULL);
 	}
 
@@ -12753,7 +12888,7 @@ static void *network_thread(void *ignore)
 		/* Wake up once a second just in case SIGURG was sent while
 		 * we weren't in poll(), to make sure we don't hang when trying
 		 * to unload. */
-		res = ast_io_wait(io, 1000);
+		res = ast_io_wait(ioc, 1000);
 		/* Timeout(=0), and EINTR is not a thread exit condition. We do
 		 * not want to exit the thread loop on these conditions. */
 		if (res < 0 && errno != -EINTR) {
@@ -12804,9 +12939,12 @@ static int start_network_thread(void)
 			AST_LIST_UNLOCK(&idle_list);
 		}
 	}
-	if (ast_pthread_create_background(&netthreadid, NULL, network_thread, NULL)) {
-		ast_log(LOG_ERROR, "Failed to create new thread!\n");
-		return -1;
+	for (x = 0; x < iaxnetworkthreads; x++) {
+		if (ast_pthread_create_background(&netthreadids[x], NULL, network_thread, netios[x])) {
+			ast_log(LOG_ERROR, "Failed to create new thread!\n");
+			netthreadids[x] = AST_PTHREADT_NULL;
+			return -1;
+		}
 	}
 	ast_verb(2, "%d helper threads started\n", threadcount);
 	return 0;
@@ -13643,6 +13781,70 @@ static void set_config_destroy(void)
 }
 
 /*! \brief Load configuration */
+/*!
+ * \brief Bind a socket to an address for every network thread
+ *
+ * \return the socket of the first network thread, NULL on failure
+ */
+static struct ast_netsock *iax2_bindaddr(struct ast_sockaddr *addr)
+{
+	struct ast_netsock *ns;
+	struct ast_netsock *shard;
+	int x;
+
+	if (iaxnetworkthreads < 2) {
+		return ast_netsock_bindaddr(netsock, io, addr, qos.tos, qos.cos, socket_read, NULL);
+	}
+
+	if (!(ns = ast_netsock_bindaddr_shared(netsock, io, addr, qos.tos, qos.cos, socket_read, NULL))) {
+		return NULL;
+	}
+	for (x = 1; x < iaxnetworkthreads; x++) {
+		if (!(shard = ast_netsock_bindaddr_shared(netsock, netios[x], addr, qos.tos, qos.cos, socket_read, NULL))) {
+			ast_log(LOG_WARNING, "Network thread %d will not receive on %s\n", x + 1, ast_sockaddr_stringify(addr));
+			continue;
+		}
+		ast_netsock_unref(shard);
+	}
+
+	return ns;
+}
+
+/*!
+ * \brief Set up the network threads asked for before any address is bound
+ */
+static void network_threads_config(struct ast_config *cfg)
+{
+	const char *value = ast_variable_retrieve(cfg, "general", "iaxnetworkthreads");
+	int x;
+
+	if (!value) {
+		return;
+	}
+	iaxnetworkthreads = atoi(value);
+	if (iaxnetworkthreads < 1) {
+		ast_log(LOG_NOTICE, "iaxnetworkthreads must be at least 1.\n");
+		iaxnetworkthreads = 1;
+	} else if (iaxnetworkthreads > MAX_NETWORK_THREADS) {
+		ast_log(LOG_NOTICE, "Limiting iaxnetworkthreads to %d\n", MAX_NETWORK_THREADS);
+		iaxnetworkthreads = MAX_NETWORK_THREADS;
+	}
+#ifndef SO_REUSEPORT
+	if (iaxnetworkthreads > 1) {
+		ast_log(LOG_NOTICE, "Sockets cannot share addresses on this system, using one network thread.\n");
+		iaxnetworkthreads = 1;
+	}
+#endif
+
+	for (x = 1; x < iaxnetworkthreads; x++) {
+		if (!(netios[x] = io_context_create())) {
+			ast_log(LOG_WARNING, "Failed to create I/O context, using %d network threads\n", x);
+			iaxnetworkthreads = x;
+			break;
+		}
+	}
+}
+
 static int set_config(const char *config_file, int reload, int forced)
 {
 	struct ast_config *cfg, *ucfg;
@@ -13729,6 +13931,10 @@ static int set_config(const char *config_file, int reload, int forced)
 
 	v = ast_variable_browse(cfg, "general");
 
+	if (!reload) {
+		network_threads_config(cfg);
+	}
+
 	/* Seed initial tos value */
 	tosval = ast_variable_retrieve(cfg, "general", "tos");
 	if (tosval) {
@@ -13766,6 +13972,10 @@ static int set_config(const char *config_file, int reload, int forced)
 					iaxthreadcount = 256;
 				}
 			}
+		} else if (!strcasecmp(v->name, "iaxnetworkthreads")) {
+			if (reload && atoi(v->value) != iaxnetworkthreads) {
+				ast_log(LOG_NOTICE, "Ignoring any changes to iaxnetworkthreads during reload\n");
+			}
 		} else if (!strcasecmp(v->name, "iaxmaxthreadcount")) {
 			if (reload) {
 				AST_LIST_LOCK(&dynamic_list);
@@ -13819,7 +14029,7 @@ static int set_config(const char *config_file, int reload, int forced)
 						ast_sockaddr_set_port(&bindaddr, portno);
 					}
 
-					if (!(ns = ast_netsock_bindaddr(netsock, io, &bindaddr, qos.tos, qos.cos, socket_read, NULL))) {
+					if (!(ns = iax2_bindaddr(&bindaddr))) {
 						ast_log(LOG_WARNING, "Unable to apply binding to '%s' at line %d\n", v->value, v->lineno);
 					} else {
 						ast_verb(2, "Binding IAX2 to address %s\n", ast_sockaddr_stringify(&bindaddr));
@@ -14050,7 +14260,7 @@ static int set_config(const char *config_file, int reload, int forced)
 
 		ast_sockaddr_set_port(&bindaddr, portno);
 
-		if (!(ns = ast_netsock_bindaddr(netsock, io, &bindaddr, qos.tos, qos.cos, socket_read, NULL))) {
+		if (!(ns = iax2_bindaddr(&bindaddr))) {
 			ast_log(LOG_ERROR, "Unable to create network socket: %s\n", strerror(errno));
 		} else {
 			ast_verb(2, "Binding IAX2 to default address %s\n", ast_sockaddr_stringify(&bindaddr));
@@ -14776,10 +14986,13 @@ static int __unload_module(void)
 	ast_unregister_switch(&iax2_switch);
 	ast_channel_unregister(&iax2_tech);
 
-	if (netthreadid != AST_PTHREADT_NULL) {
-		pthread_cancel(netthreadid);
-		pthread_kill(netthreadid, SIGURG);
-		pthread_join(netthreadid, NULL);
+	for (x = 0; x < MAX_NETWORK_THREADS; x++) {
+		if (netthreadids[x] != AST_PTHREADT_NULL) {
+			pthread_cancel(netthreadids[x]);
+			pthread_kill(netthreadids[x], SIGURG);
+			pthread_join(netthreadids[x], NULL);
+			netthreadids[x] = AST_PTHREADT_NULL;
+		}
 	}
 
 	for (x = 0; x < ARRAY_LEN(iaxs); x++) {
@@ -14795,6 +15008,13 @@ static int __unload_module(void)
 
 	ast_netsock_release(netsock);
 	ast_netsock_release(outsock);
+	for (x = 1; x < MAX_NETWORK_THREADS; x++) {
+		if (netios[x]) {
+			io_context_destroy(netios[x]);
+			netios[x] = NULL;
+		}
+	}
+	iaxnetworkthreads = 1;
 	for (x = 0; x < ARRAY_LEN(iaxs); x++) {
 		if (iaxs[x]) {
 			iax2_destroy(x);
@@ -15006,6 +15226,10 @@ static int load_module(void)
 
 	memset(iaxs, 0, sizeof(iaxs));
 
+	for (x = 0; x < MAX_NETWORK_THREADS; x++) {
+		netthreadids[x] = AST_PTHREADT_NULL;
+	}
+
 	for (x = 0; x < ARRAY_LEN(iaxsl); x++) {
 		ast_mutex_init(&iaxsl[x]);
 	}
@@ -15033,6 +15257,7 @@ static int load_module(void)
 		sched = NULL;
 		return AST_MODULE_LOAD_DECLINE;
 	}
+	netios[0] = io;
 
 	if (!(netsock = ast_netsock_list_alloc())) {
 		ast_log(LOG_ERROR, "Failed to create netsock list\n");
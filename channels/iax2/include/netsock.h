@@ -48,6 +48,17 @@ struct ast_netsock *ast_netsock_bind(struct ast_netsock_list *list, struct io_co
 struct ast_netsock *ast_netsock_bindaddr(struct ast_netsock_list *list, struct io_context *ioc,
 					 struct ast_sockaddr *bindaddr, int tos, int cos, ast_io_cb callback, void *data);
 
+/*!
+ * \brief Bind a socket to an address shared by other sockets bound the same way
+ *
+ * The kernel spreads the datagrams received among the sockets sharing the
+ * address, those from any one source going to the same socket.
+ *
+ * \return the socket, NULL on failure or if sockets cannot share addresses
+ */
+struct ast_netsock *ast_netsock_bindaddr_shared(struct ast_netsock_list *list, struct io_context *ioc,
+					 struct ast_sockaddr *bindaddr, int tos, int cos, ast_io_cb callback, void *data);
+
 int ast_netsock_release(struct ast_netsock_list *list);
 
 struct ast_netsock *ast_netsock_find(struct ast_netsock_list *list,
@@ -106,7 +106,7 @@ struct ast_netsock *ast_netsock_find(struct ast_netsock_list *list, struct ast_s
 	return sock;
 }
 
-struct ast_netsock *ast_netsock_bindaddr(struct ast_netsock_list *list, struct io_context *ioc, struct ast_sockaddr *bindaddr, int tos, int cos, ast_io_cb callback, void *data)
+static struct ast_netsock *netsock_bindaddr(struct ast_netsock_list *list, struct io_context *ioc, struct ast_sockaddr *bindaddr, int tos, int cos, ast_io_cb callback, void *data, int shared)
 {
 	int netsocket = -1;
 	int *ioref;
@@ -124,6 +124,11 @@ struct ast_netsock *ast_netsock_bindaddr(struct ast_netsock_list *list, struct i
 	if (setsockopt(netsocket, SOL_SOCKET, SO_REUSEADDR, (char *)&reuseFlag, sizeof reuseFlag) < 0) {
 		ast_log(LOG_WARNING, "Error setting SO_REUSEADDR on sockfd '%d'\n", netsocket);
 	}
+#ifdef SO_REUSEPORT
+	if (shared && setsockopt(netsocket, SOL_SOCKET, SO_REUSEPORT, (char *)&reuseFlag, sizeof reuseFlag) < 0) {
+		ast_log(LOG_WARNING, "Error setting SO_REUSEPORT on sockfd '%d'\n", netsocket);
+	}
+#endif
 	if (ast_bind(netsocket, bindaddr)) {
 		ast_log(LOG_ERROR,
 			"Unable to bind to %s: %s\n",
@@ -159,6 +164,20 @@ struct ast_netsock *ast_netsock_bindaddr(struct ast_netsock_list *list, struct i
 	return ns;
 }
 
+struct ast_netsock *ast_netsock_bindaddr(struct ast_netsock_list *list, struct io_context *ioc, struct ast_sockaddr *bindaddr, int tos, int cos, ast_io_cb callback, void *data)
+{
+	return netsock_bindaddr(list, ioc, bindaddr, tos, cos, callback, data, 0);
+}
+
+struct ast_netsock *ast_netsock_bindaddr_shared(struct ast_netsock_list *list, struct io_context *ioc, struct ast_sockaddr *bindaddr, int tos, int cos, ast_io_cb callback, void *data)
+{
+#ifdef SO_REUSEPORT
+	return netsock_bindaddr(list, ioc, bindaddr, tos, cos, callback, data, 1);
+#else
+	return NULL;
+#endif
+}
+
 int ast_netsock_set_qos(int sockfd, int tos, int cos, const char *desc)
 {
 	return ast_set_qos(sockfd, tos, cos, desc);
@@ -49,6 +49,7 @@
 #define BUF_SHIFT	5
 
 #include "g722/g722.h"
+#include "g722/g722_simd.h"
 
 /* Sample frame data */
 #include "asterisk/slin.h"
@@ -100,6 +101,12 @@ static int g722tolin16_new(struct ast_trans_pvt *pvt)
 	return 0;
 }
 
+/*! \brief return a g722 translator to its initial state so it can be reused */
+static void g722_reset(struct ast_trans_pvt *pvt)
+{
+	pvt->t->newpvt(pvt);
+}
+
 static int g722tolin_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 {
 	struct g722_decoder_pvt *tmp = pvt->pvt;
@@ -148,6 +155,7 @@ static struct ast_translator g722tolin = {
 	},
 	.format = "slin",
 	.newpvt = g722tolin_new,	/* same for both directions */
+	.reset = g722_reset,
 	.framein = g722tolin_framein,
 	.sample = g722_sample,
 	.desc_size = sizeof(struct g722_decoder_pvt),
@@ -169,6 +177,7 @@ static struct ast_translator lintog722 = {
 	},
 	.format = "g722",
 	.newpvt = lintog722_new,	/* same for both directions */
+	.reset = g722_reset,
 	.framein = lintog722_framein,
 	.sample = slin8_sample,
 	.desc_size = sizeof(struct g722_encoder_pvt),
@@ -190,6 +199,7 @@ static struct ast_translator g722tolin16 = {
 	},
 	.format = "slin16",
 	.newpvt = g722tolin16_new,	/* same for both directions */
+	.reset = g722_reset,
 	.framein = g722tolin_framein,
 	.sample = g722_sample,
 	.desc_size = sizeof(struct g722_decoder_pvt),
@@ -211,6 +221,7 @@ static struct ast_translator lin16tog722 = {
 	},
 	.format = "g722",
 	.newpvt = lin16tog722_new,	/* same for both directions */
+	.reset = g722_reset,
 	.framein = lintog722_framein,
 	.sample = slin16_sample,
 	.desc_size = sizeof(struct g722_encoder_pvt),
@@ -234,6 +245,9 @@ static int load_module(void)
 {
 	int res = 0;
 
+	g722_simd_select();
+	ast_debug(1, "Using %s G.722 filters and quantizer\n", g722_simd_implementation());
+
 	res |= ast_register_translator(&g722tolin);
 	res |= ast_register_translator(&lintog722);
 	res |= ast_register_translator(&g722tolin16);
@@ -22,6 +22,13 @@
  *
  * \brief Resample slinear audio
  *
+ * Rates which are a multiple of each other by factors of 2 and 3, such as
+ * 8kHz and 16kHz or 48kHz, are converted by a cascade of polyphase filters
+ * of one factor each.  Their filters are Nyquist filters, half band for a
+ * factor of 2, so a sample of every output phase of an interpolator is
+ * a copy of an input sample and the taps of every other phase are few.
+ * Other rates are converted by the speex resampler.
+ *
  * \ingroup codecs
  */
 
@@ -29,15 +36,96 @@
 	<support_level>core</support_level>
  ***/
 
+/* Needed for the intrinsics headers */
+#define ASTMM_LIBC ASTMM_IGNORE
 #include "asterisk.h"
 #include "speex/speex_resampler.h"
+#include "speex/resample_simd.h"
+
+#include <math.h>
 
 #include "asterisk/module.h"
+#include "asterisk/config.h"
 #include "asterisk/translate.h"
 #include "asterisk/slin.h"
 
 #define OUTBUF_SAMPLES   11520
 
+/*! The largest ratio of rates, 8kHz to 192kHz */
+#define RESAMPLE_MAX_RATIO 24
+/*! The most stages of a cascade, 2, 2, 2 and 3 for the largest ratio */
+#define RESAMPLE_MAX_STAGES 4
+/*! How many input samples go through the stages at a time */
+#define RESAMPLE_CHUNK 32
+/*! The largest factor of a stage */
+#define RESAMPLE_MAX_FACTOR 3
+/*! The most input samples on each side of an output sample of the highest quality */
+#define RESAMPLE_MAX_HALF 16
+/*! The most samples a stage filters for an output sample, when decimating */
+#define RESAMPLE_MAX_WINDOW (2 * RESAMPLE_MAX_HALF * RESAMPLE_MAX_FACTOR)
+/*! The coefficients of the filters are in Q14, which keeps the sums of products in 32 bits */
+#define RESAMPLE_COEFF_SHIFT 14
+
+enum resample_quality {
+	RESAMPLE_QUALITY_LOW,
+	RESAMPLE_QUALITY_MEDIUM,
+	RESAMPLE_QUALITY_HIGH,
+};
+
+static const struct resample_tier {
+	/*! The name of the tier in codecs.conf */
+	const char *name;
+	/*! The quality of the speex resampler */
+	int speex_quality;
+	/*! How many input samples on each side of an output sample the filters of a stage use */
+	int half;
+	/*! The beta of the Kaiser window of the filters of a stage */
+	double beta;
+} resample_tiers[] = {
+	[RESAMPLE_QUALITY_LOW] = { "low", 3, 4, 5.0, },
+	[RESAMPLE_QUALITY_MEDIUM] = { "medium", 5, 12, 7.0, },
+	[RESAMPLE_QUALITY_HIGH] = { "high", 8, 16, 8.0, },
+};
+
+/*! \brief The filters of a stage of a factor and quality */
+struct resample_filter {
+	/*! The taps of each output phase when interpolating, applied to the oldest input first */
+	int16_t up[RESAMPLE_MAX_FACTOR][2 * RESAMPLE_MAX_HALF];
+	/*! The taps when decimating, applied to the oldest input first */
+	int16_t down[RESAMPLE_MAX_WINDOW];
+};
+
+/*! The filters of factors 2 and 3 of each tier, made on load */
+static struct resample_filter resample_filters[ARRAY_LEN(resample_tiers)][2];
+
+/*! \brief A stage of a cascade, interpolating or decimating by a factor */
+struct resample_stage {
+	const struct resample_filter *filter;
+	unsigned int factor;
+	unsigned int half;
+	unsigned int up;
+	/*! How many input samples the filters are applied to */
+	unsigned int window;
+	/*! Where the next input sample is put in the history */
+	unsigned int pos;
+	/*! Input samples since the last output sample, when decimating */
+	unsigned int count;
+	/*! The last window input samples, twice so the window is always contiguous */
+	int16_t history[2 * RESAMPLE_MAX_WINDOW];
+};
+
+struct resample_pvt {
+	/*! The speex resampler, NULL if the stages are used */
+	SpeexResamplerState *speex;
+	unsigned int stages;
+	struct resample_stage stage[RESAMPLE_MAX_STAGES];
+};
+
+/*! The quality of the resamplers made from now on */
+static enum resample_quality resample_quality = RESAMPLE_QUALITY_MEDIUM;
+/*! Non-zero if rates which are multiples of each other are converted by stages */
+static int resample_integer_ratios = 1;
+
 static struct ast_translator *translators;
 static int trans_size;
 static struct ast_codec codec_list[] = {
@@ -88,39 +176,284 @@ static struct ast_codec codec_list[] = {
 	},
 };
 
+/*! \brief The zeroth order modified Bessel function of the first kind, for the Kaiser window */
+static double bessel_i0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	int k;
+
+	for (k = 1; k < 32; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+
+	return sum;
+}
+
+/*!
+ * \internal
+ * \brief A tap of the windowed sinc Nyquist filter of a factor
+ *
+ * \param t The distance from the center of the filter, in samples of the higher rate
+ *
+ * The cut off is the Nyquist frequency of the lower rate, so the taps at
+ * multiples of the factor from the center are zero.
+ */
+static double resample_tap(int t, unsigned int factor, const struct resample_tier *tier)
+{
+	double span = tier->half * factor;
+	double x = t / (double) factor;
+	double ratio = t / span;
+	double sinc;
+
+	if (fabs(ratio) >= 1.0) {
+		return 0.0;
+	}
+
+	sinc = t ? sin(M_PI * x) / (M_PI * x) : 1.0;
+	return sinc * bessel_i0(tier->beta * sqrt(1.0 - ratio * ratio)) / bessel_i0(tier->beta);
+}
+
+/*!
+ * \internal
+ * \brief Quantize taps so they sum to exactly 1, for no change of level at DC
+ */
+static void resample_quantize(const double *taps, int16_t *out, unsigned int count)
+{
+	double sum = 0.0;
+	int total = 0;
+	unsigned int largest = 0;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		sum += taps[i];
+	}
+	for (i = 0; i < count; i++) {
+		out[i] = lrint(taps[i] / sum * (1 << RESAMPLE_COEFF_SHIFT));
+		total += out[i];
+		if (abs(out[i]) > abs(out[largest])) {
+			largest = i;
+		}
+	}
+	out[largest] += (1 << RESAMPLE_COEFF_SHIFT) - total;
+}
+
+static void resample_filter_make(struct resample_filter *filter, unsigned int factor,
+	const struct resample_tier *tier)
+{
+	double taps[RESAMPLE_MAX_WINDOW];
+	int half = tier->half;
+	int phase;
+	int i;
+
+	/* The output of a phase is between the inputs half - 1 and half of the window */
+	for (phase = 0; phase < factor; phase++) {
+		for (i = 0; i < 2 * half; i++) {
+			taps[i] = resample_tap((half - 1 - i) * (int) factor + phase, factor, tier);
+		}
+		resample_quantize(taps, filter->up[phase], 2 * half);
+	}
+
+	/* The output is at the input half * factor of the window */
+	for (i = 0; i < 2 * half * factor; i++) {
+		taps[i] = resample_tap(i - half * (int) factor, factor, tier);
+	}
+	resample_quantize(taps, filter->down, 2 * half * factor);
+}
+
+static void resample_filters_make(void)
+{
+	int tier;
+
+	for (tier = 0; tier < ARRAY_LEN(resample_tiers); tier++) {
+		resample_filter_make(&resample_filters[tier][0], 2, &resample_tiers[tier]);
+		resample_filter_make(&resample_filters[tier][1], 3, &resample_tiers[tier]);
+	}
+}
+
+static void resample_stage_init(struct resample_stage *stage, unsigned int factor, int up,
+	enum resample_quality quality)
+{
+	stage->filter = &resample_filters[quality][factor == 2 ? 0 : 1];
+	stage->factor = factor;
+	stage->half = resample_tiers[quality].half;
+	stage->up = up;
+	stage->window = up ? 2 * stage->half : 2 * stage->half * factor;
+}
+
+/*!
+ * \internal
+ * \brief Plan the stages converting between two rates
+ *
+ * \retval 0 the rates are a multiple of each other by factors of 2 and 3
+ * \retval -1 they are not
+ */
+static int resample_stages_plan(struct resample_pvt *rp, unsigned int src, unsigned int dst,
+	enum resample_quality quality)
+{
+	unsigned int up = dst > src;
+	unsigned int ratio;
+	unsigned int twos = 0;
+	unsigned int threes = 0;
+	unsigned int i;
+
+	if (up ? dst % src : src % dst) {
+		return -1;
+	}
+
+	for (ratio = up ? dst / src : src / dst; ratio % 2 == 0; ratio /= 2) {
+		twos++;
+	}
+	for (; ratio % 3 == 0; ratio /= 3) {
+		threes++;
+	}
+	if (ratio != 1 || twos + threes > RESAMPLE_MAX_STAGES
+		|| (up ? dst / src : src / dst) > RESAMPLE_MAX_RATIO) {
+		return -1;
+	}
+
+	/* The half band stages are at the lowest rates, whichever way the conversion goes */
+	rp->stages = twos + threes;
+	for (i = 0; i < rp->stages; i++) {
+		unsigned int factor = (up ? i < twos : i >= threes) ? 2 : 3;
+
+		resample_stage_init(&rp->stage[i], factor, up, quality);
+	}
+
+	return 0;
+}
+
+/*! \brief A sum of products of samples and taps, as a sample */
+static inline int16_t resample_sample(int32_t sum)
+{
+	sum = (sum + (1 << (RESAMPLE_COEFF_SHIFT - 1))) >> RESAMPLE_COEFF_SHIFT;
+
+	return sum > 32767 ? 32767 : sum < -32768 ? -32768 : sum;
+}
+
+/*!
+ * \internal
+ * \brief Run samples through a stage
+ *
+ * \return The number of samples put out, count times the factor at most
+ */
+static unsigned int resample_stage_run(struct resample_stage *stage, const int16_t *in,
+	unsigned int count, int16_t *out)
+{
+	const int16_t *window;
+	unsigned int produced = 0;
+	unsigned int phase;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		stage->history[stage->pos] = in[i];
+		stage->history[stage->pos + stage->window] = in[i];
+		if (++stage->pos == stage->window) {
+			stage->pos = 0;
+		}
+		window = stage->history + stage->pos;
+
+		if (stage->up) {
+			/* The first phase is a copy of an input sample */
+			out[produced++] = window[stage->half - 1];
+			for (phase = 1; phase < stage->factor; phase++) {
+				out[produced++] = resample_sample(
+					resample_dot16(window, stage->filter->up[phase], stage->window));
+			}
+		} else if (++stage->count == stage->factor) {
+			stage->count = 0;
+			out[produced++] = resample_sample(
+				resample_dot16(window, stage->filter->down, stage->window));
+		}
+	}
+
+	return produced;
+}
+
 static int resamp_new(struct ast_trans_pvt *pvt)
 {
+	struct resample_pvt *rp = pvt->pvt;
+	unsigned int src = pvt->t->src_codec.sample_rate;
+	unsigned int dst = pvt->t->dst_codec.sample_rate;
+	enum resample_quality quality = resample_quality;
 	int err;
 
-	if (!(pvt->pvt = speex_resampler_init(1, pvt->t->src_codec.sample_rate, pvt->t->dst_codec.sample_rate, 5, &err))) {
-		return -1;
+	if (!resample_integer_ratios || resample_stages_plan(rp, src, dst, quality)) {
+		rp->stages = 0;
+		if (!(rp->speex = speex_resampler_init(1, src, dst, resample_tiers[quality].speex_quality, &err))) {
+			return -1;
+		}
 	}
 
 	ast_assert(pvt->f.subclass.format == NULL);
-	pvt->f.subclass.format = ao2_bump(ast_format_cache_get_slin_by_rate(pvt->t->dst_codec.sample_rate));
+	pvt->f.subclass.format = ao2_bump(ast_format_cache_get_slin_by_rate(dst));
 
 	return 0;
 }
 
 static void resamp_destroy(struct ast_trans_pvt *pvt)
 {
-	SpeexResamplerState *resamp_pvt = pvt->pvt;
+	struct resample_pvt *rp = pvt->pvt;
 
-	speex_resampler_destroy(resamp_pvt);
+	if (rp->speex) {
+		speex_resampler_destroy(rp->speex);
+	}
+}
+
+static void resamp_reset(struct ast_trans_pvt *pvt)
+{
+	struct resample_pvt *rp = pvt->pvt;
+	unsigned int i;
+
+	if (rp->speex) {
+		speex_resampler_reset_mem(rp->speex);
+	}
+	for (i = 0; i < rp->stages; i++) {
+		memset(rp->stage[i].history, 0, sizeof(rp->stage[i].history));
+		rp->stage[i].pos = 0;
+		rp->stage[i].count = 0;
+	}
 }
 
 static int resamp_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 {
-	SpeexResamplerState *resamp_pvt = pvt->pvt;
+	struct resample_pvt *rp = pvt->pvt;
 	unsigned int out_samples = OUTBUF_SAMPLES - pvt->samples;
 	unsigned int in_samples;
+	unsigned int i;
 
 	if (!f->datalen) {
 		return -1;
 	}
 	in_samples = f->datalen / 2;
 
-	speex_resampler_process_int(resamp_pvt,
+	if (!rp->speex) {
+		const int16_t *in = f->data.ptr;
+		int16_t buf[2][RESAMPLE_CHUNK * RESAMPLE_MAX_RATIO];
+		unsigned int count;
+		unsigned int stage;
+
+		/* In chunks, each going through every stage before the next */
+		for (i = 0; i < in_samples; i += count) {
+			const int16_t *samples = in + i;
+
+			count = MIN(RESAMPLE_CHUNK, in_samples - i);
+			out_samples = count;
+			for (stage = 0; stage < rp->stages; stage++) {
+				out_samples = resample_stage_run(&rp->stage[stage], samples, out_samples, buf[stage % 2]);
+				samples = buf[stage % 2];
+			}
+
+			out_samples = MIN(out_samples, OUTBUF_SAMPLES - pvt->samples);
+			memcpy(pvt->outbuf.i16 + pvt->samples, samples, out_samples * sizeof(int16_t));
+			pvt->samples += out_samples;
+			pvt->datalen += out_samples * 2;
+		}
+		return 0;
+	}
+
+	speex_resampler_process_int(rp->speex,
 		0,
 		f->data.ptr,
 		&in_samples,
@@ -133,6 +466,53 @@ static int resamp_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 	return 0;
 }
 
+static int parse_config(int reload)
+{
+	struct ast_flags config_flags = { reload ? CONFIG_FLAG_FILEUNCHANGED : 0 };
+	struct ast_config *cfg = ast_config_load("codecs.conf", config_flags);
+	struct ast_variable *var;
+	enum resample_quality quality = RESAMPLE_QUALITY_MEDIUM;
+	int integer_ratios = 1;
+	int tier;
+
+	if (cfg == CONFIG_STATUS_FILEUNCHANGED || cfg == CONFIG_STATUS_FILEINVALID) {
+		return 0;
+	}
+
+	if (cfg) {
+		for (var = ast_variable_browse(cfg, "resample"); var; var = var->next) {
+			if (!strcasecmp(var->name, "quality")) {
+				for (tier = 0; tier < ARRAY_LEN(resample_tiers); tier++) {
+					if (!strcasecmp(var->value, resample_tiers[tier].name)) {
+						quality = tier;
+						break;
+					}
+				}
+				if (tier == ARRAY_LEN(resample_tiers)) {
+					ast_log(LOG_ERROR, "Resampling quality must be low, medium or high, not '%s'\n",
+						var->value);
+				}
+			} else if (!strcasecmp(var->name, "integer_ratios")) {
+				integer_ratios = ast_true(var->value);
+			}
+		}
+		ast_config_destroy(cfg);
+	}
+
+	resample_quality = quality;
+	resample_integer_ratios = integer_ratios;
+	ast_verb(5, "Resampling at %s quality, %s using %s filters\n", resample_tiers[quality].name,
+		integer_ratios ? "integer ratios" : "no integer ratios", RESAMPLE_SIMD);
+
+	return 0;
+}
+
+static int reload(void)
+{
+	parse_config(1);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
 static int unload_module(void)
 {
 	int res = 0;
@@ -151,6 +531,9 @@ static int load_module(void)
 	int res = 0;
 	int x, y, idx = 0;
 
+	resample_filters_make();
+	parse_config(0);
+
 	trans_size = ARRAY_LEN(codec_list) * (ARRAY_LEN(codec_list) - 1);
 	if (!(translators = ast_calloc(1, sizeof(struct ast_translator) * trans_size))) {
 		return AST_MODULE_LOAD_DECLINE;
@@ -163,8 +546,9 @@ static int load_module(void)
 			}
 			translators[idx].newpvt = resamp_new;
 			translators[idx].destroy = resamp_destroy;
+			translators[idx].reset = resamp_reset;
 			translators[idx].framein = resamp_framein;
-			translators[idx].desc_size = 0;
+			translators[idx].desc_size = sizeof(struct resample_pvt);
 			translators[idx].buffer_samples = OUTBUF_SAMPLES;
 			translators[idx].buf_size = (OUTBUF_SAMPLES * sizeof(int16_t));
 			memcpy(&translators[idx].src_codec, &codec_list[x], sizeof(struct ast_codec));
@@ -186,4 +570,9 @@ static int load_module(void)
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
-AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "SLIN Resampling Codec");
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_DEFAULT, "SLIN Resampling Codec",
+	.support_level = AST_MODULE_SUPPORT_CORE,
+	.load = load_module,
+	.unload = unload_module,
+	.reload = reload,
+);
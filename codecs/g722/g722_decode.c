@@ -36,6 +36,7 @@
 #endif
 
 #include "g722.h"
+#include "g722_simd.h"
 
 #if !defined(FALSE)
 #define FALSE 0
@@ -235,10 +236,6 @@ int g722_decode(g722_decode_state_t *s, int16_t amp[], const uint8_t g722_data[]
            1688,   1360,   1040,    728,
             432,    136,   -432,   -136
     };
-    static const int qmf_coeffs[12] =
-    {
-           3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11,
-    };
 
     int dlowt;
     int rlow;
@@ -380,13 +377,7 @@ int g722_decode(g722_decode_state_t *s, int16_t amp[], const uint8_t g722_data[]
                 s->x[22] = rlow + rhigh;
                 s->x[23] = rlow - rhigh;
 
-                xout1 = 0;
-                xout2 = 0;
-                for (i = 0;  i < 12;  i++)
-                {
-                    xout2 += s->x[2*i]*qmf_coeffs[i];
-                    xout1 += s->x[2*i + 1]*qmf_coeffs[11 - i];
-                }
+                g722_qmf(s->x, &xout2, &xout1);
                 amp[outlen++] = (int16_t) (xout1 >> 11);
                 amp[outlen++] = (int16_t) (xout2 >> 11);
             }
@@ -38,6 +38,7 @@
 #endif
 
 #include "g722.h"
+#include "g722_simd.h"
 
 #if !defined(FALSE)
 #define FALSE 0
@@ -184,13 +185,6 @@ int g722_encode_release(g722_encode_state_t *s)
 
 int g722_encode(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[], int len)
 {
-    static const int q6[32] =
-    {
-           0,   35,   72,  110,  150,  190,  233,  276,
-         323,  370,  422,  473,  530,  587,  650,  714,
-         786,  858,  940, 1023, 1121, 1219, 1339, 1458,
-        1612, 1765, 1980, 2195, 2557, 2919,    0,    0
-    };
     static const int iln[32] =
     {
          0, 63, 62, 31, 30, 29, 28, 27,
@@ -232,10 +226,6 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[]
     {
         -7408,  -1616,   7408,   1616
     };
-    static const int qmf_coeffs[12] =
-    {
-           3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11,
-    };
     static const int ihn[3] = {0, 1, 0};
     static const int ihp[3] = {0, 3, 2};
     static const int wh[3] = {0, -214, 798};
@@ -291,13 +281,7 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[]
                 s->x[23] = amp[j++];
 
                 /* Discard every other QMF output */
-                sumeven = 0;
-                sumodd = 0;
-                for (i = 0;  i < 12;  i++)
-                {
-                    sumodd += s->x[2*i]*qmf_coeffs[i];
-                    sumeven += s->x[2*i + 1]*qmf_coeffs[11 - i];
-                }
+                g722_qmf(s->x, &sumodd, &sumeven);
                 xlow = (sumeven + sumodd) >> 14;
                 xhigh = (sumeven - sumodd) >> 14;
             }
@@ -308,12 +292,7 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[]
         /* Block 1L, QUANTL */
         wd = (el >= 0)  ?  el  :  -(el + 1);
 
-        for (i = 1;  i < 30;  i++)
-        {
-            wd1 = (q6[i]*s->band[0].det) >> 12;
-            if (wd < wd1)
-                break;
-        }
+        i = g722_quantl(wd, s->band[0].det);
         ilow = (el < 0)  ?  iln[i]  :  ilp[i];
 
         /* Block 2L, INVQAL */
@@ -0,0 +1,210 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Vector implementations of the hot loops of the G.722 codec
+ *
+ * The band split and band join filters are 24 tap dot products run for
+ * every pair of samples, and the lower band quantizer searches 29 decision
+ * levels for every sample.  Both are done in integer arithmetic, so the
+ * vector versions give exactly the same results as the scalar ones.  The
+ * ADPCM predictors of each band depend on the previous sample and stay
+ * scalar.
+ */
+
+#include <stdint.h>
+
+#include "g722_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define G722_SIMD_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define G722_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+static const int qmf_coeffs[12] =
+{
+       3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11,
+};
+
+/*! The QMF coefficients in the order the history is multiplied by them,
+    qmf_coeffs[i] and qmf_coeffs[11 - i] for each pair of entries. */
+static const int qmf_coeffs_interleaved[24] =
+{
+       3,  -11,  -11,   53,   12, -156,   32,  362,
+    -210, -805,  951, 3876, 3876,  951, -805, -210,
+     362,   32, -156,   12,   53,  -11,  -11,    3,
+};
+
+/*! The lower band decision levels, q6[1] to q6[29] of the encoder, padded
+    with levels of 0 that every wd is at or above. */
+static const int quantl_levels[32] =
+{
+      35,   72,  110,  150,  190,  233,  276,  323,
+     370,  422,  473,  530,  587,  650,  714,  786,
+     858,  940, 1023, 1121, 1219, 1339, 1458, 1612,
+    1765, 1980, 2195, 2557, 2919,    0,    0,    0,
+};
+
+static void g722_qmf_scalar(const int x[24], int *even_taps, int *odd_taps)
+{
+    int even;
+    int odd;
+    int i;
+
+    even = 0;
+    odd = 0;
+    for (i = 0;  i < 12;  i++)
+    {
+        even += x[2*i]*qmf_coeffs[i];
+        odd += x[2*i + 1]*qmf_coeffs[11 - i];
+    }
+    *even_taps = even;
+    *odd_taps = odd;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int g722_quantl_scalar(int wd, int det)
+{
+    int i;
+
+    for (i = 0;  i < 29;  i++)
+    {
+        if (wd < ((quantl_levels[i]*det) >> 12))
+            break;
+    }
+    return i + 1;
+}
+/*- End of function --------------------------------------------------------*/
+
+#ifdef G722_SIMD_X86
+__attribute__((target("avx2")))
+static void g722_qmf_avx2(const int x[24], int *even_taps, int *odd_taps)
+{
+    __m256i sum;
+    __m128i half;
+
+    sum = _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *) x),
+        _mm256_loadu_si256((const __m256i *) qmf_coeffs_interleaved));
+    sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *) (x + 8)),
+        _mm256_loadu_si256((const __m256i *) (qmf_coeffs_interleaved + 8))));
+    sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *) (x + 16)),
+        _mm256_loadu_si256((const __m256i *) (qmf_coeffs_interleaved + 16))));
+
+    /* The even lanes hold products of the even entries, the odd lanes of the odd ones */
+    half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_unpackhi_epi64(half, half));
+    *even_taps = _mm_cvtsi128_si32(half);
+    *odd_taps = _mm_extract_epi32(half, 1);
+}
+/*- End of function --------------------------------------------------------*/
+
+__attribute__((target("avx2")))
+static int g722_quantl_avx2(int wd, int det)
+{
+    const __m256i wdv = _mm256_set1_epi32(wd);
+    const __m256i detv = _mm256_set1_epi32(det);
+    unsigned int above;
+    int i;
+
+    /* The scaled levels only ever increase, so the one wanted follows
+       every level wd is at or above */
+    above = 0;
+    for (i = 0;  i < 32;  i += 8)
+    {
+        __m256i level;
+
+        level = _mm256_srai_epi32(_mm256_mullo_epi32(
+            _mm256_loadu_si256((const __m256i *) (quantl_levels + i)), detv), 12);
+        above |= (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(
+            _mm256_cmpgt_epi32(level, wdv))) << i;
+    }
+    return 1 + __builtin_popcount(~above & 0x1FFFFFFF);
+}
+/*- End of function --------------------------------------------------------*/
+#endif
+
+#ifdef G722_SIMD_NEON
+static void g722_qmf_neon(const int x[24], int *even_taps, int *odd_taps)
+{
+    int32x4_t sum;
+    int32x2_t half;
+    int i;
+
+    sum = vmulq_s32(vld1q_s32(x), vld1q_s32(qmf_coeffs_interleaved));
+    for (i = 4;  i < 24;  i += 4)
+        sum = vmlaq_s32(sum, vld1q_s32(x + i), vld1q_s32(qmf_coeffs_interleaved + i));
+
+    half = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+    *even_taps = vget_lane_s32(half, 0);
+    *odd_taps = vget_lane_s32(half, 1);
+}
+/*- End of function --------------------------------------------------------*/
+
+static int g722_quantl_neon(int wd, int det)
+{
+    const int32x4_t wdv = vdupq_n_s32(wd);
+    int32x4_t count;
+    int32x2_t half;
+    int i;
+
+    /* Count the levels wd is at or above, the padding included */
+    count = vdupq_n_s32(0);
+    for (i = 0;  i < 32;  i += 4)
+    {
+        int32x4_t level;
+
+        level = vshrq_n_s32(vmulq_n_s32(vld1q_s32(quantl_levels + i), det), 12);
+        count = vsubq_s32(count, vreinterpretq_s32_u32(vcleq_s32(level, wdv)));
+    }
+    half = vadd_s32(vget_low_s32(count), vget_high_s32(count));
+    half = vpadd_s32(half, half);
+    return 1 + vget_lane_s32(half, 0) - 3;
+}
+/*- End of function --------------------------------------------------------*/
+#endif
+
+g722_qmf_fn g722_qmf = g722_qmf_scalar;
+g722_quantl_fn g722_quantl = g722_quantl_scalar;
+static const char *g722_simd_name = "scalar";
+
+void g722_simd_select(void)
+{
+#ifdef G722_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        g722_simd_name = "avx2";
+        g722_qmf = g722_qmf_avx2;
+        g722_quantl = g722_quantl_avx2;
+    }
+#elif defined(G722_SIMD_NEON)
+    g722_simd_name = "neon";
+    g722_qmf = g722_qmf_neon;
+    g722_quantl = g722_quantl_neon;
+#endif
+}
+/*- End of function --------------------------------------------------------*/
+
+const char *g722_simd_implementation(void)
+{
+    return g722_simd_name;
+}
+/*- End of function --------------------------------------------------------*/
+/*- End of file ------------------------------------------------------------*/
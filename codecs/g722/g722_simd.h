@@ -0,0 +1,53 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Vector implementations of the hot loops of the G.722 codec
+ */
+
+#if !defined(_G722_SIMD_H_)
+#define _G722_SIMD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Sum the products of the QMF history with the QMF coefficients. The even
+    entries of the history are multiplied by the coefficients in order and
+    summed into even_taps, the odd ones by the coefficients in reverse order
+    and summed into odd_taps. */
+typedef void (*g722_qmf_fn)(const int x[24], int *even_taps, int *odd_taps);
+
+/*! Block 1L, QUANTL: find the first of the 29 lower band decision levels,
+    scaled by det, that wd is below. Returns 1 to 30, 30 if there is none. */
+typedef int (*g722_quantl_fn)(int wd, int det);
+
+extern g722_qmf_fn g722_qmf;
+extern g722_quantl_fn g722_quantl;
+
+/*! Use the best implementations the CPU supports */
+void g722_simd_select(void);
+
+/*! The name of the implementations in use */
+const char *g722_simd_implementation(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/*- End of file ------------------------------------------------------------*/
@@ -16,6 +16,12 @@
 #ifdef K6OPT
 #include "k6opt.h"
 #endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+	&& !defined(K6OPT) && !defined(USE_FLOAT_MUL)
+#define LTP_SEARCH_X86
+#include <immintrin.h>
+#endif
 /*
  *  4.2.11 .. 4.2.12 LONG TERM PREDICTOR (LTP) SECTION
  */
@@ -155,6 +161,136 @@ static void Cut_Calculation_of_the_LTP_parameters P5((st, d,dp,bc_out,Nc_out),
 
 #endif 	/* LTP_CUT */
 
+#ifndef K6OPT
+
+/*
+ *  Search for the maximum cross-correlation of wt[0..39] with
+ *  dp[-lambda..39-lambda] for lambda 40..120, returning it and the lag.
+ *
+ *  wt is scaled down so that |wt[k]| < 512, so every product fits in
+ *  25 bits and the sum of 40 of them in 31: the vector versions sum in
+ *  32 bits and give exactly the same results.
+ */
+static longword Max_cross_correlation P3((wt,dp,Nc_out),
+	const word	* wt,		/* [0..39]	IN	*/
+	const word	* dp,		/* [-120..-1]	IN	*/
+	word		* Nc_out	/* 		OUT	*/
+)
+{
+	register int lambda;
+	longword	L_max;
+	word		Nc;
+
+	L_max = 0;
+	Nc    = 40;	/* index for the maximum cross-correlation */
+
+	for (lambda = 40; lambda <= 120; lambda++) {
+
+# undef STEP
+#		define STEP(k) 	(longword)wt[k] * dp[k - lambda]
+
+		register longword L_result;
+
+		L_result  = STEP(0)  ; L_result += STEP(1) ;
+		L_result += STEP(2)  ; L_result += STEP(3) ;
+		L_result += STEP(4)  ; L_result += STEP(5)  ;
+		L_result += STEP(6)  ; L_result += STEP(7)  ;
+		L_result += STEP(8)  ; L_result += STEP(9)  ;
+		L_result += STEP(10) ; L_result += STEP(11) ;
+		L_result += STEP(12) ; L_result += STEP(13) ;
+		L_result += STEP(14) ; L_result += STEP(15) ;
+		L_result += STEP(16) ; L_result += STEP(17) ;
+		L_result += STEP(18) ; L_result += STEP(19) ;
+		L_result += STEP(20) ; L_result += STEP(21) ;
+		L_result += STEP(22) ; L_result += STEP(23) ;
+		L_result += STEP(24) ; L_result += STEP(25) ;
+		L_result += STEP(26) ; L_result += STEP(27) ;
+		L_result += STEP(28) ; L_result += STEP(29) ;
+		L_result += STEP(30) ; L_result += STEP(31) ;
+		L_result += STEP(32) ; L_result += STEP(33) ;
+		L_result += STEP(34) ; L_result += STEP(35) ;
+		L_result += STEP(36) ; L_result += STEP(37) ;
+		L_result += STEP(38) ; L_result += STEP(39) ;
+
+		if (L_result > L_max) {
+
+			Nc    = lambda;
+			L_max = L_result;
+		}
+	}
+
+	*Nc_out = Nc;
+	return L_max;
+}
+
+#ifdef LTP_SEARCH_X86
+__attribute__((target("avx2")))
+static longword Max_cross_correlation_avx2 P3((wt,dp,Nc_out),
+	const word	* wt,		/* [0..39]	IN	*/
+	const word	* dp,		/* [-120..-1]	IN	*/
+	word		* Nc_out	/* 		OUT	*/
+)
+{
+	const __m256i	wt0 = _mm256_loadu_si256((const __m256i *)wt);
+	const __m256i	wt1 = _mm256_loadu_si256((const __m256i *)(wt + 16));
+	const __m128i	wt2 = _mm_loadu_si128((const __m128i *)(wt + 32));
+	register int lambda;
+	longword	L_max;
+	word		Nc;
+
+	L_max = 0;
+	Nc    = 40;	/* index for the maximum cross-correlation */
+
+	for (lambda = 40; lambda <= 120; lambda++) {
+
+		const word	* dpl = dp - lambda;
+		__m256i		sum;
+		__m128i		half;
+		longword	L_result;
+
+		sum  = _mm256_add_epi32(
+			_mm256_madd_epi16(wt0, _mm256_loadu_si256((const __m256i *)dpl)),
+			_mm256_madd_epi16(wt1, _mm256_loadu_si256((const __m256i *)(dpl + 16))));
+		half = _mm_add_epi32(_mm256_castsi256_si128(sum),
+			_mm256_extracti128_si256(sum, 1));
+		half = _mm_add_epi32(half,
+			_mm_madd_epi16(wt2, _mm_loadu_si128((const __m128i *)(dpl + 32))));
+		half = _mm_add_epi32(half, _mm_unpackhi_epi64(half, half));
+		half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 1));
+		L_result = _mm_cvtsi128_si32(half);
+
+		if (L_result > L_max) {
+
+			Nc    = lambda;
+			L_max = L_result;
+		}
+	}
+
+	*Nc_out = Nc;
+	return L_max;
+}
+
+static longword (*Max_cross_correlation_best)
+	P((const word *, const word *, word *)) = Max_cross_correlation;
+
+/*
+ *  Pick the search when the library is loaded, before any encoder
+ *  can run.
+ */
+__attribute__((constructor))
+static void Max_cross_correlation_select P0()
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		Max_cross_correlation_best = Max_cross_correlation_avx2;
+	}
+}
+#else
+#define Max_cross_correlation_best Max_cross_correlation
+#endif	/* LTP_SEARCH_X86 */
+
+#endif	/* K6OPT */
+
 static void Calculation_of_the_LTP_parameters P4((d,dp,bc_out,Nc_out),
 	register word	* d,		/* [0..39]	IN	*/
 	register word	* dp,		/* [-120..-1]	IN	*/
@@ -163,9 +299,6 @@ static void Calculation_of_the_LTP_parameters P4((d,dp,bc_out,Nc_out),
 )
 {
 	register int  	k;
-#ifndef K6OPT
-	register int lambda;
-#endif
 	word		Nc, bc;
 	word		wt[40];
 
@@ -205,43 +338,7 @@ static void Calculation_of_the_LTP_parameters P4((d,dp,bc_out,Nc_out),
 # ifdef K6OPT
 	L_max = k6maxcc(wt,dp,&Nc);
 #	else
-	L_max = 0;
-	Nc    = 40;	/* index for the maximum cross-correlation */
-
-	for (lambda = 40; lambda <= 120; lambda++) {
-
-# undef STEP
-#		define STEP(k) 	(longword)wt[k] * dp[k - lambda]
-
-		register longword L_result;
-
-		L_result  = STEP(0)  ; L_result += STEP(1) ;
-		L_result += STEP(2)  ; L_result += STEP(3) ;
-		L_result += STEP(4)  ; L_result += STEP(5)  ;
-		L_result += STEP(6)  ; L_result += STEP(7)  ;
-		L_result += STEP(8)  ; L_result += STEP(9)  ;
-		L_result += STEP(10) ; L_result += STEP(11) ;
-		L_result += STEP(12) ; L_result += STEP(13) ;
-		L_result += STEP(14) ; L_result += STEP(15) ;
-		L_result += STEP(16) ; L_result += STEP(17) ;
-		L_result += STEP(18) ; L_result += STEP(19) ;
-		L_result += STEP(20) ; L_result += STEP(21) ;
-		L_result += STEP(22) ; L_result += STEP(23) ;
-		L_result += STEP(24) ; L_result += STEP(25) ;
-		L_result += STEP(26) ; L_result += STEP(27) ;
-		L_result += STEP(28) ; L_result += STEP(29) ;
-		L_result += STEP(30) ; L_result += STEP(31) ;
-		L_result += STEP(32) ; L_result += STEP(33) ;
-		L_result += STEP(34) ; L_result += STEP(35) ;
-		L_result += STEP(36) ; L_result += STEP(37) ;
-		L_result += STEP(38) ; L_result += STEP(39) ;
-
-		if (L_result > L_max) {
-
-			Nc    = lambda;
-			L_max = L_result;
-		}
-	}
+	L_max = Max_cross_correlation_best(wt,dp,&Nc);
 #	endif
 	*Nc_out = Nc;
 
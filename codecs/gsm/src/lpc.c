@@ -18,6 +18,13 @@
 #include "k6opt.h"
 #endif
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+	&& !defined(K6OPT) && !defined(USE_FLOAT_MUL)
+#define AUTOCORRELATION_X86
+#include <string.h>
+#include <immintrin.h>
+#endif
+
 #undef	P
 
 /*
@@ -26,6 +33,57 @@
 
 /* 4.2.4 */
 
+#ifdef AUTOCORRELATION_X86
+
+/*
+ *  Once scaled, |s[k]| <= 2048, so the sum of 160 products fits in
+ *  30 bits: summing in 32 bits gives exactly the same results as the
+ *  STEP()s below.
+ */
+__attribute__((target("avx2")))
+static void Autocorrelation_products_avx2 P2((s, L_ACF),
+	const word * s,		/* [0..159]	IN	*/
+	longword * L_ACF)	/* [0..8]	OUT	*/
+{
+	word		padded[8 + 160];	/* s[-8..159], s[-8..-1] = 0 */
+	register int	k, i;
+
+	memset(padded, 0, 8 * sizeof(*padded));
+	memcpy(padded + 8, s, 160 * sizeof(*s));
+
+	for (k = 0; k <= 8; k++) {
+
+		__m256i	sum = _mm256_setzero_si256();
+		__m128i	half;
+
+		for (i = 0; i <= 159; i += 16) {
+			sum = _mm256_add_epi32(sum, _mm256_madd_epi16(
+				_mm256_loadu_si256((const __m256i *)(s + i)),
+				_mm256_loadu_si256((const __m256i *)(padded + 8 + i - k))));
+		}
+		half = _mm_add_epi32(_mm256_castsi256_si128(sum),
+			_mm256_extracti128_si256(sum, 1));
+		half = _mm_add_epi32(half, _mm_unpackhi_epi64(half, half));
+		half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 1));
+
+		L_ACF[k] = (longword)_mm_cvtsi128_si32(half) << 1;
+	}
+}
+
+static int Autocorrelation_use_avx2;
+
+/*
+ *  Decide when the library is loaded, before any encoder can run.
+ */
+__attribute__((constructor))
+static void Autocorrelation_select P0()
+{
+	__builtin_cpu_init();
+	Autocorrelation_use_avx2 = __builtin_cpu_supports("avx2");
+}
+
+#endif	/* AUTOCORRELATION_X86 */
+
 
 static void Autocorrelation P2((s, L_ACF),
 	word     * s,		/* [0..159]	IN/OUT  */
@@ -110,6 +168,10 @@ static void Autocorrelation P2((s, L_ACF),
 	/*  Compute the L_ACF[..].
 	 */
 #ifndef K6OPT
+# ifdef	AUTOCORRELATION_X86
+	if (Autocorrelation_use_avx2) Autocorrelation_products_avx2(s, L_ACF);
+	else
+# endif
 	{
 # ifdef	USE_FLOAT_MUL
 		register float * sp = float_s;
@@ -104,6 +104,15 @@ static void speex_free (void *ptr) {free(ptr);}
 #include "resample_neon.h"
 #endif
 
+#if defined(FIXED_POINT) && !defined(OVERRIDE_INNER_PRODUCT_SINGLE)
+#include "resample_simd.h"
+#define OVERRIDE_INNER_PRODUCT_SINGLE
+static inline spx_word32_t inner_product_single(const spx_word16_t *a, const spx_word16_t *b, unsigned int len)
+{
+   return SATURATE32PSHR(resample_dot16(a, b, len), 15, 32767);
+}
+#endif
+
 /* Number of elements to allocate on the stack */
 #ifdef VAR_ARRAYS
 #define FIXED_STACK_ALLOC 8192
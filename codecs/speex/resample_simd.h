@@ -0,0 +1,80 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Vector dot product of 16 bit samples for the fixed point resamplers
+ *
+ * The speex resampler is built in fixed point, which its own SSE and NEON
+ * versions do not support, so its inner product is done here.  Products
+ * are summed in 32 bits as the scalar version does, so the results are
+ * exactly the same.  SSE2 is part of every x86_64 CPU and NEON of every
+ * aarch64 one, so no check of the CPU is needed.
+ */
+
+#ifndef RESAMPLE_SIMD_H
+#define RESAMPLE_SIMD_H
+
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#define RESAMPLE_SIMD "sse2"
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RESAMPLE_SIMD "neon"
+#include <arm_neon.h>
+#else
+#define RESAMPLE_SIMD "scalar"
+#endif
+
+/*! Sum the products of two arrays of 16 bit samples */
+static inline int32_t resample_dot16(const int16_t *a, const int16_t *b, unsigned int len)
+{
+   unsigned int i = 0;
+   int32_t sum = 0;
+
+#if defined(__SSE2__)
+   __m128i acc = _mm_setzero_si128();
+
+   for (; i + 8 <= len; i += 8)
+   {
+      acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (a + i)),
+         _mm_loadu_si128((const __m128i *) (b + i))));
+   }
+   acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+   acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+   sum = _mm_cvtsi128_si32(acc);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+   int32x4_t acc = vdupq_n_s32(0);
+   int32x2_t half;
+
+   for (; i + 8 <= len; i += 8)
+   {
+      acc = vmlal_s16(acc, vld1_s16(a + i), vld1_s16(b + i));
+      acc = vmlal_s16(acc, vld1_s16(a + i + 4), vld1_s16(b + i + 4));
+   }
+   half = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+   sum = vget_lane_s32(vpadd_s32(half, half), 0);
+#endif
+
+   for (; i < len; i++)
+   {
+      sum += (int32_t) a[i] * b[i];
+   }
+   return sum;
+}
+
+#endif
@@ -0,0 +1,39 @@
+"""Add defer_contact_refresh to ps_globals
+
+Revision ID: 3d7f1a9c5e24
+Revises: c27e4f8a3b61
+Create Date: 2026-10-15 14:22:51.617304
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = '3d7f1a9c5e24'
+down_revision = 'c27e4f8a3b61'
+
+from alembic import op
+import sqlalchemy as sa
+from sqlalchemy.dialects.postgresql import ENUM
+
+AST_BOOL_NAME = 'ast_bool_values'
+# We'll just ignore the n/y and f/t abbreviations as Asterisk does not write
+# those aliases.
+AST_BOOL_VALUES = [ '0', '1',
+                    'off', 'on',
+                    'false', 'true',
+                    'no', 'yes' ]
+
+
+def upgrade():
+    ############################# Enums ##############################
+
+    # ast_bool_values has already been created, so use postgres enum object
+    # type to get around "already created" issue - works okay with mysql
+    ast_bool_values = ENUM(*AST_BOOL_VALUES, name=AST_BOOL_NAME, create_type=False)
+
+    op.add_column('ps_globals', sa.Column('defer_contact_refresh', ast_bool_values))
+
+
+def downgrade():
+    if op.get_context().bind.dialect.name == 'mssql':
+        op.drop_constraint('ck_ps_globals_defer_contact_refresh_ast_bool_values', 'ps_globals')
+    op.drop_column('ps_globals', 'defer_contact_refresh')
@@ -0,0 +1,22 @@
+"""Add udp_receive_threads to ps_transports
+
+Revision ID: 5a3c0f2e9b17
+Revises: bd9c5159c7ea
+Create Date: 2026-10-15 09:12:44.513020
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = '5a3c0f2e9b17'
+down_revision = 'bd9c5159c7ea'
+
+from alembic import op
+import sqlalchemy as sa
+
+
+def upgrade():
+    op.add_column('ps_transports', sa.Column('udp_receive_threads', sa.Integer))
+
+
+def downgrade():
+    op.drop_column('ps_transports', 'udp_receive_threads')
@@ -0,0 +1,39 @@
+"""Add pool_outbound_session_serializers to ps_globals
+
+Revision ID: 5f0d2b8e7a39
+Revises: e4a9c3b6d812
+Create Date: 2026-10-15 16:21:45.092318
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = '5f0d2b8e7a39'
+down_revision = 'e4a9c3b6d812'
+
+from alembic import op
+import sqlalchemy as sa
+from sqlalchemy.dialects.postgresql import ENUM
+
+AST_BOOL_NAME = 'ast_bool_values'
+# We'll just ignore the n/y and f/t abbreviations as Asterisk does not write
+# those aliases.
+AST_BOOL_VALUES = [ '0', '1',
+                    'off', 'on',
+                    'false', 'true',
+                    'no', 'yes' ]
+
+
+def upgrade():
+    ############################# Enums ##############################
+
+    # ast_bool_values has already been created, so use postgres enum object
+    # type to get around "already created" issue - works okay with mysql
+    ast_bool_values = ENUM(*AST_BOOL_VALUES, name=AST_BOOL_NAME, create_type=False)
+
+    op.add_column('ps_globals', sa.Column('pool_outbound_session_serializers', ast_bool_values))
+
+
+def downgrade():
+    if op.get_context().bind.dialect.name == 'mssql':
+        op.drop_constraint('ck_ps_globals_pool_outbound_session_serializers_ast_bool_values', 'ps_globals')
+    op.drop_column('ps_globals', 'pool_outbound_session_serializers')
@@ -0,0 +1,24 @@
+"""Add outbound_registration_serializers to ps_globals and refresh_jitter to ps_registrations
+
+Revision ID: 7c3e9a1d4b26
+Revises: 5f0d2b8e7a39
+Create Date: 2026-10-15 19:02:37.518204
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = '7c3e9a1d4b26'
+down_revision = '5f0d2b8e7a39'
+
+from alembic import op
+import sqlalchemy as sa
+
+
+def upgrade():
+    op.add_column('ps_globals', sa.Column('outbound_registration_serializers', sa.Integer))
+    op.add_column('ps_registrations', sa.Column('refresh_jitter', sa.Integer))
+
+
+def downgrade():
+    op.drop_column('ps_registrations', 'refresh_jitter')
+    op.drop_column('ps_globals', 'outbound_registration_serializers')
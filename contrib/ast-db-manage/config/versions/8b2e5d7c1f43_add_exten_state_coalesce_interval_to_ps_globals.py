@@ -0,0 +1,22 @@
+"""Add exten_state_coalesce_interval to ps_globals
+
+Revision ID: 8b2e5d7c1f43
+Revises: 3d7f1a9c5e24
+Create Date: 2026-10-15 15:08:33.904127
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = '8b2e5d7c1f43'
+down_revision = '3d7f1a9c5e24'
+
+from alembic import op
+import sqlalchemy as sa
+
+
+def upgrade():
+    op.add_column('ps_globals', sa.Column('exten_state_coalesce_interval', sa.Integer))
+
+
+def downgrade():
+    op.drop_column('ps_globals', 'exten_state_coalesce_interval')
@@ -0,0 +1,22 @@
+"""Add endpoint_identifier_cache_ttl to ps_globals
+
+Revision ID: 9e1b6c4d2a85
+Revises: 5a3c0f2e9b17
+Create Date: 2026-10-15 10:41:07.283115
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = '9e1b6c4d2a85'
+down_revision = '5a3c0f2e9b17'
+
+from alembic import op
+import sqlalchemy as sa
+
+
+def upgrade():
+    op.add_column('ps_globals', sa.Column('endpoint_identifier_cache_ttl', sa.Integer))
+
+
+def downgrade():
+    op.drop_column('ps_globals', 'endpoint_identifier_cache_ttl')
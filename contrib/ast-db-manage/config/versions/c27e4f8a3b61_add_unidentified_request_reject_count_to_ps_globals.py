@@ -0,0 +1,22 @@
+"""Add unidentified_request_reject_count to ps_globals
+
+Revision ID: c27e4f8a3b61
+Revises: 9e1b6c4d2a85
+Create Date: 2026-10-15 11:58:32.904417
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = 'c27e4f8a3b61'
+down_revision = '9e1b6c4d2a85'
+
+from alembic import op
+import sqlalchemy as sa
+
+
+def upgrade():
+    op.add_column('ps_globals', sa.Column('unidentified_request_reject_count', sa.Integer))
+
+
+def downgrade():
+    op.drop_column('ps_globals', 'unidentified_request_reject_count')
@@ -0,0 +1,22 @@
+"""Add subscription_persistence_write_delay to ps_globals
+
+Revision ID: e4a9c3b6d812
+Revises: 8b2e5d7c1f43
+Create Date: 2026-10-15 15:47:12.518640
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = 'e4a9c3b6d812'
+down_revision = '8b2e5d7c1f43'
+
+from alembic import op
+import sqlalchemy as sa
+
+
+def upgrade():
+    op.add_column('ps_globals', sa.Column('subscription_persistence_write_delay', sa.Integer))
+
+
+def downgrade():
+    op.drop_column('ps_globals', 'subscription_persistence_write_delay')
@@ -0,0 +1,27 @@
+/*
+ * defaults.h
+ * Automatically generated from build options,
+ * only used in main/asterisk.c
+ */
+#define DEFAULT_CONFIG_FILE "/etc/asterisk/asterisk.conf"
+
+#define DEFAULT_CACHE_DIR  "/var/cache/asterisk"
+#define DEFAULT_CONFIG_DIR "/etc/asterisk"
+#define DEFAULT_MODULE_DIR "/usr/lib/asterisk/modules"
+#define DEFAULT_AGI_DIR    "/var/lib/asterisk/agi-bin"
+#define DEFAULT_LOG_DIR    "/var/log/asterisk"
+
+#define DEFAULT_RUN_DIR    "/var/run/asterisk"
+#define DEFAULT_SOCKET     "/var/run/asterisk/asterisk.ctl"
+#define DEFAULT_PID        "/var/run/asterisk/asterisk.pid"
+
+#define DEFAULT_VAR_DIR    "/var/lib/asterisk"
+#define DEFAULT_DB         "/var/lib/asterisk/astdb"
+
+#define DEFAULT_DATA_DIR   "/var/lib/asterisk"
+#define DEFAULT_KEY_DIR    "/var/lib/asterisk/keys"
+
+#define DEFAULT_SPOOL_DIR  "/var/spool/asterisk"
+#define DEFAULT_TMP_DIR    "/var/spool/asterisk/tmp"
+
+#define DEFAULT_SBIN_DIR   "/usr/sbin"
@@ -81,16 +81,9 @@ static struct ast_frame *pcm_read(struct ast_filestream *s, int *whennext)
 	size_t res;
 
 	/* Send a frame from the file to the appropriate channel */
-	AST_FRAME_SET_BUFFER(&s->fr, s->buf, AST_FRIENDLY_OFFSET, BUF_SIZE);
-	if ((res = fread(s->fr.data.ptr, 1, s->fr.datalen, s->f)) < 1) {
-		if (res) {
-			ast_log(LOG_WARNING, "Short read of %s data (expected %d bytes, read %zu): %s\n",
-					ast_format_get_name(s->fr.subclass.format), s->fr.datalen, res,
-					strerror(errno));
-		}
+	if ((res = ast_filestream_read(s, BUF_SIZE)) < 1) {
 		return NULL;
 	}
-	s->fr.datalen = res;
 	*whennext = s->fr.samples = res;
 	return &s->fr;
 }
@@ -100,17 +93,17 @@ static int pcm_seek(struct ast_filestream *fs, off_t sample_offset, int whence)
 	off_t cur, max, offset = 0;
  	int ret = -1;	/* assume error */
 
-	if ((cur = ftello(fs->f)) < 0) {
+	if ((cur = ast_filestream_tell_bytes(fs)) < 0) {
 		ast_log(AST_LOG_WARNING, "Unable to determine current position in pcm filestream %p: %s\n", fs, strerror(errno));
 		return -1;
 	}
 
-	if (fseeko(fs->f, 0, SEEK_END) < 0) {
+	if (ast_filestream_seek_bytes(fs, 0, SEEK_END) < 0) {
 		ast_log(AST_LOG_WARNING, "Unable to seek to end of pcm filestream %p: %s\n", fs, strerror(errno));
 		return -1;
 	}
 
-	if ((max = ftello(fs->f)) < 0) {
+	if ((max = ast_filestream_tell_bytes(fs)) < 0) {
 		ast_log(AST_LOG_WARNING, "Unable to determine max position in pcm filestream %p: %s\n", fs, strerror(errno));
 		return -1;
 	}
@@ -151,7 +144,7 @@ static int pcm_seek(struct ast_filestream *fs, off_t sample_offset, int whence)
 			ast_log(LOG_WARNING, "offset too large %ld, truncating to %ld\n", (long) offset, (long) max);
 			offset = max;
 		}
-		ret = fseeko(fs->f, offset, SEEK_SET);
+		ret = ast_filestream_seek_bytes(fs, offset, SEEK_SET);
 	}
 	return ret;
 }
@@ -174,7 +167,7 @@ static int pcm_trunc(struct ast_filestream *fs)
 
 static off_t pcm_tell(struct ast_filestream *fs)
 {
-	return ftello(fs->f);
+	return ast_filestream_tell_bytes(fs);
 }
 
 static int pcm_write(struct ast_filestream *fs, struct ast_frame *f)
@@ -412,17 +405,17 @@ static int au_seek(struct ast_filestream *fs, off_t sample_offset, int whence)
 
 	min = desc->hdr_size;
 
-	if ((cur = ftello(fs->f)) < 0) {
+	if ((cur = ast_filestream_tell_bytes(fs)) < 0) {
 		ast_log(AST_LOG_WARNING, "Unable to determine current position in au filestream %p: %s\n", fs, strerror(errno));
 		return -1;
 	}
 
-	if (fseeko(fs->f, 0, SEEK_END) < 0) {
+	if (ast_filestream_seek_bytes(fs, 0, SEEK_END) < 0) {
 		ast_log(AST_LOG_WARNING, "Unable to seek to end of au filestream %p: %s\n", fs, strerror(errno));
 		return -1;
 	}
 
-	if ((max = ftello(fs->f)) < 0) {
+	if ((max = ast_filestream_tell_bytes(fs)) < 0) {
 		ast_log(AST_LOG_WARNING, "Unable to determine max position in au filestream %p: %s\n", fs, strerror(errno));
 		return -1;
 	}
@@ -441,7 +434,7 @@ static int au_seek(struct ast_filestream *fs, off_t sample_offset, int whence)
 	/* always protect the header space. */
 	offset = (offset < min) ? min : offset;
 
-	return fseeko(fs->f, offset, SEEK_SET);
+	return ast_filestream_seek_bytes(fs, offset, SEEK_SET);
 }
 
 static int au_trunc(struct ast_filestream *fs)
@@ -467,7 +460,7 @@ static int au_trunc(struct ast_filestream *fs)
 static off_t au_tell(struct ast_filestream *fs)
 {
 	struct au_desc *desc = fs->_private;
-	off_t offset = ftello(fs->f);
+	off_t offset = ast_filestream_tell_bytes(fs);
 	return offset - desc->hdr_size;
 }
 
@@ -497,6 +490,7 @@ static struct ast_format_def alaw_f = {
 	.tell = pcm_tell,
 	.read = pcm_read,
 	.buf_size = BUF_SIZE + AST_FRIENDLY_OFFSET,
+	.mappable = 1,
 #ifdef REALTIME_WRITE
 	.open = pcma_open,
 	.rewrite = pcma_rewrite,
@@ -514,6 +508,7 @@ static struct ast_format_def pcm_f = {
 	.tell = pcm_tell,
 	.read = pcm_read,
 	.buf_size = BUF_SIZE + AST_FRIENDLY_OFFSET,
+	.mappable = 1,
 };
 
 static struct ast_format_def g722_f = {
@@ -37,17 +37,10 @@ static struct ast_frame *generic_read(struct ast_filestream *s, int *whennext, u
 	size_t res;
 
 	/* Send a frame from the file to the appropriate channel */
-	AST_FRAME_SET_BUFFER(&s->fr, s->buf, AST_FRIENDLY_OFFSET, buf_size);
-	if ((res = fread(s->fr.data.ptr, 1, s->fr.datalen, s->f)) < 1) {
-		if (res) {
-			ast_log(LOG_WARNING, "Short read of %s data (expected %d bytes, read %zu): %s\n",
-					ast_format_get_name(s->fr.subclass.format), s->fr.datalen, res,
-					strerror(errno));
-		}
+	if ((res = ast_filestream_read(s, buf_size)) < 1) {
 		return NULL;
 	}
 	*whennext = s->fr.samples = res/2;
-	s->fr.datalen = res;
 	return &s->fr;
 }
 
@@ -73,17 +66,17 @@ static int slinear_seek(struct ast_filestream *fs, off_t sample_offset, int when
 
 	sample_offset <<= 1;
 
-	if ((cur = ftello(fs->f)) < 0) {
+	if ((cur = ast_filestream_tell_bytes(fs)) < 0) {
 		ast_log(AST_LOG_WARNING, "Unable to determine current position in sln filestream %p: %s\n", fs, strerror(errno));
 		return -1;
 	}
 
-	if (fseeko(fs->f, 0, SEEK_END) < 0) {
+	if (ast_filestream_seek_bytes(fs, 0, SEEK_END) < 0) {
 		ast_log(AST_LOG_WARNING, "Unable to seek to end of sln filestream %p: %s\n", fs, strerror(errno));
 		return -1;
 	}
 
-	if ((max = ftello(fs->f)) < 0) {
+	if ((max = ast_filestream_tell_bytes(fs)) < 0) {
 		ast_log(AST_LOG_WARNING, "Unable to determine max position in sln filestream %p: %s\n", fs, strerror(errno));
 		return -1;
 	}
@@ -99,7 +92,7 @@ static int slinear_seek(struct ast_filestream *fs, off_t sample_offset, int when
 	}
 	/* always protect against seeking past begining. */
 	offset = (offset < min)?min:offset;
-	return fseeko(fs->f, offset, SEEK_SET);
+	return ast_filestream_seek_bytes(fs, offset, SEEK_SET);
 }
 
 static int slinear_trunc(struct ast_filestream *fs)
@@ -121,7 +114,7 @@ static int slinear_trunc(struct ast_filestream *fs)
 
 static off_t slinear_tell(struct ast_filestream *fs)
 {
-	return ftello(fs->f) / 2;
+	return ast_filestream_tell_bytes(fs) / 2;
 }
 
 static struct ast_frame *slinear_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 320);}
@@ -134,6 +127,7 @@ static struct ast_format_def slin_f = {
 	.tell = slinear_tell,
 	.read = slinear_read,
 	.buf_size = 320 + AST_FRIENDLY_OFFSET,
+	.mappable = 1,
 };
 
 static struct ast_frame *slinear12_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 480);}
@@ -146,6 +140,7 @@ static struct ast_format_def slin12_f = {
 	.tell = slinear_tell,
 	.read = slinear12_read,
 	.buf_size = 480 + AST_FRIENDLY_OFFSET,
+	.mappable = 1,
 };
 
 static struct ast_frame *slinear16_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 640);}
@@ -158,6 +153,7 @@ static struct ast_format_def slin16_f = {
 	.tell = slinear_tell,
 	.read = slinear16_read,
 	.buf_size = 640 + AST_FRIENDLY_OFFSET,
+	.mappable = 1,
 };
 
 static struct ast_frame *slinear24_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 960);}
@@ -170,6 +166,7 @@ static struct ast_format_def slin24_f = {
 	.tell = slinear_tell,
 	.read = slinear24_read,
 	.buf_size = 960 + AST_FRIENDLY_OFFSET,
+	.mappable = 1,
 };
 
 static struct ast_frame *slinear32_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 1280);}
@@ -182,6 +179,7 @@ static struct ast_format_def slin32_f = {
 	.tell = slinear_tell,
 	.read = slinear32_read,
 	.buf_size = 1280 + AST_FRIENDLY_OFFSET,
+	.mappable = 1,
 };
 
 static struct ast_frame *slinear44_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 1764);}
@@ -194,6 +192,7 @@ static struct ast_format_def slin44_f = {
 	.tell = slinear_tell,
 	.read = slinear44_read,
 	.buf_size = 1764 + AST_FRIENDLY_OFFSET,
+	.mappable = 1,
 };
 
 static struct ast_frame *slinear48_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 1920);}
@@ -206,6 +205,7 @@ static struct ast_format_def slin48_f = {
 	.tell = slinear_tell,
 	.read = slinear48_read,
 	.buf_size = 1920 + AST_FRIENDLY_OFFSET,
+	.mappable = 1,
 };
 
 static struct ast_frame *slinear96_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 3840);}
@@ -218,6 +218,7 @@ static struct ast_format_def slin96_f = {
 	.tell = slinear_tell,
 	.read = slinear96_read,
 	.buf_size = 3840 + AST_FRIENDLY_OFFSET,
+	.mappable = 1,
 };
 
 static struct ast_frame *slinear192_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 7680);}
@@ -230,6 +231,7 @@ static struct ast_format_def slin192_f = {
 	.tell = slinear_tell,
 	.read = slinear192_read,
 	.buf_size = 7680 + AST_FRIENDLY_OFFSET,
+	.mappable = 1,
 };
 
 static struct ast_format_def *slin_list[] = {
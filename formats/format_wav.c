@@ -382,24 +382,17 @@ static struct ast_frame *wav_read(struct ast_filestream *s, int *whennext)
 
 	bytes = (fs->hz == 16000 ? (WAV_BUF_SIZE * 2) : WAV_BUF_SIZE);
 
-	here = ftello(s->f);
+	here = ast_filestream_tell_bytes(s);
 	if (fs->maxlen - here < bytes)		/* truncate if necessary */
 		bytes = fs->maxlen - here;
 	if (bytes <= 0) {
 		return NULL;
 	}
 /* 	ast_debug(1, "here: %d, maxlen: %d, bytes: %d\n", here, s->maxlen, bytes); */
-	AST_FRAME_SET_BUFFER(&s->fr, s->buf, AST_FRIENDLY_OFFSET, bytes);
 
-	if ((res = fread(s->fr.data.ptr, 1, s->fr.datalen, s->f)) == 0) {
-		if (res) {
-			ast_log(LOG_WARNING, "Short read of %s data (expected %d bytes, read %zu): %s\n",
-					ast_format_get_name(s->fr.subclass.format), s->fr.datalen, res,
-					strerror(errno));
-		}
+	if ((res = ast_filestream_read(s, bytes)) == 0) {
 		return NULL;
 	}
-	s->fr.datalen = res;
 	s->fr.samples = samples = res / 2;
 
 #if __BYTE_ORDER == __BIG_ENDIAN
@@ -456,17 +449,17 @@ static int wav_seek(struct ast_filestream *fs, off_t sample_offset, int whence)
 
 	samples = sample_offset * 2; /* SLINEAR is 16 bits mono, so sample_offset * 2 = bytes */
 
-	if ((cur = ftello(fs->f)) < 0) {
+	if ((cur = ast_filestream_tell_bytes(fs)) < 0) {
 		ast_log(AST_LOG_WARNING, "Unable to determine current position in wav filestream %p: %s\n", fs, strerror(errno));
 		return -1;
 	}
 
-	if (fseeko(fs->f, 0, SEEK_END) < 0) {
+	if (ast_filestream_seek_bytes(fs, 0, SEEK_END) < 0) {
 		ast_log(AST_LOG_WARNING, "Unable to seek to end of wav filestream %p: %s\n", fs, strerror(errno));
 		return -1;
 	}
 
-	if ((max = ftello(fs->f)) < 0) {
+	if ((max = ast_filestream_tell_bytes(fs)) < 0) {
 		ast_log(AST_LOG_WARNING, "Unable to determine max position in wav filestream %p: %s\n", fs, strerror(errno));
 		return -1;
 	}
@@ -483,7 +476,7 @@ static int wav_seek(struct ast_filestream *fs, off_t sample_offset, int whence)
 	}
 	/* always protect the header space. */
 	offset = (offset < min)?min:offset;
-	return fseeko(fs->f, offset, SEEK_SET);
+	return ast_filestream_seek_bytes(fs, offset, SEEK_SET);
 }
 
 static int wav_trunc(struct ast_filestream *fs)
@@ -509,7 +502,7 @@ static int wav_trunc(struct ast_filestream *fs)
 static off_t wav_tell(struct ast_filestream *fs)
 {
 	off_t offset;
-	offset = ftello(fs->f);
+	offset = ast_filestream_tell_bytes(fs);
 	/* subtract header size to get samples, then divide by 2 for 16 bit samples */
 	return (offset - 44)/2;
 }
@@ -527,6 +520,10 @@ static struct ast_format_def wav16_f = {
 	.read = wav_read,
 	.close = wav_close,
 	.buf_size = (WAV_BUF_SIZE * 2) + AST_FRIENDLY_OFFSET,
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	/* Big endian hosts swap the samples in place as they are read */
+	.mappable = 1,
+#endif
 	.desc_size = sizeof(struct wav_desc),
 };
 
@@ -543,6 +540,10 @@ static struct ast_format_def wav_f = {
 	.read = wav_read,
 	.close = wav_close,
 	.buf_size = WAV_BUF_SIZE + AST_FRIENDLY_OFFSET,
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	/* Big endian hosts swap the samples in place as they are read */
+	.mappable = 1,
+#endif
 	.desc_size = sizeof(struct wav_desc),
 };
 
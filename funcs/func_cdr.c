@@ -267,6 +267,7 @@ static void cdr_read_callback(void *data, struct stasis_subscription *sub, struc
 	ast_assert(payload != NULL);
 	output = payload->data;
 	ast_assert(output != NULL);
+	ast_cdr_message_router_sync(ast_channel_uniqueid(payload->chan));
 
 	if (ast_strlen_zero(payload->arguments)) {
 		ast_log(AST_LOG_WARNING, "%s requires a variable (%s(variable[,option]))\n)",
@@ -373,6 +374,7 @@ static void cdr_write_callback(void *data, struct stasis_subscription *sub, stru
 	if (!payload) {
 		return;
 	}
+	ast_cdr_message_router_sync(ast_channel_uniqueid(payload->chan));
 	if (ast_strlen_zero(payload->arguments)
 		|| !payload->value) {
 		/* Sanity check.  cdr_write() could never send these bad messages */
@@ -416,6 +418,7 @@ static void cdr_prop_write_callback(void *data, struct stasis_subscription *sub,
 	if (!payload) {
 		return;
 	}
+	ast_cdr_message_router_sync(ast_channel_uniqueid(payload->chan));
 
 	if (ast_strlen_zero(payload->arguments)) {
 		ast_log(AST_LOG_WARNING, "%s requires a variable (%s(variable)=value)\n)",
@@ -190,12 +190,20 @@
 					<enum name="failurecodes">
 						<para>A comma separated list of HTTP response codes to be treated as errors</para>
 					</enum>
+					<enum name="async">
+						<para>If the channel hangs up before the response arrives, abandon
+						the transfer and return at once, rather than waiting for the response
+						or the timeout (boolean).</para>
+					</enum>
 				</enumlist>
 			</parameter>
 		</syntax>
 		<description>
 			<para>Options may be set globally or per channel.  Per-channel
 			settings will override global settings. Only HTTP headers are added instead of overriding</para>
+			<para>Connections, DNS lookups and TLS sessions are shared by every
+			CURL() call, whichever options they use, so that keep-alive
+			connections to a server are reused by other channels.</para>
 		</description>
 		<see-also>
 			<ref type="function">CURL</ref>
@@ -211,6 +219,13 @@
 
 #define CURLOPT_SPECIAL_FAILURE_CODE 999
 
+#define CURLOPT_SPECIAL_ASYNC ((CURLoption) -499)
+
+#if CURLVERSION_ATLEAST(7,68,0)
+/*! \brief curl_multi_poll() and curl_multi_wakeup() are needed by async transfers */
+#define HAVE_CURL_ASYNC
+#endif
+
 static void curlds_free(void *data);
 
 static const struct ast_datastore_info curl_info = {
@@ -326,6 +341,9 @@ static int parse_curlopt_key(const char *name, CURLoption *key, enum optiontype
 	} else if (!strcasecmp(name, "failurecodes")) {
 		*key = CURLOPT_SPECIAL_FAILURE_CODE;
 		*ot = OT_STRING;
+	} else if (!strcasecmp(name, "async")) {
+		*key = CURLOPT_SPECIAL_ASYNC;
+		*ot = OT_BOOLEAN;
 	} else {
 		return -1;
 	}
@@ -623,6 +641,13 @@ static int curl_instance_init(void *data)
 	curl_easy_setopt(*curl, CURLOPT_TIMEOUT, 180);
 	curl_easy_setopt(*curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
 	curl_easy_setopt(*curl, CURLOPT_USERAGENT, AST_CURL_USER_AGENT);
+#if CURLVERSION_ATLEAST(7,47,0)
+	/* HTTP/2 where the server offers it, so transfers can share a connection */
+	curl_easy_setopt(*curl, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_2TLS);
+#endif
+#if CURLVERSION_ATLEAST(7,43,0)
+	curl_easy_setopt(*curl, CURLOPT_PIPEWAIT, 1L);
+#endif
 
 	return 0;
 }
@@ -639,6 +664,266 @@ static void curl_instance_cleanup(void *data)
 AST_THREADSTORAGE_CUSTOM(curl_instance, curl_instance_init, curl_instance_cleanup);
 AST_THREADSTORAGE(thread_escapebuf);
 
+/*!
+ * \brief DNS lookups and TLS sessions shared by every transfer
+ *
+ * Connections are not shared, as libcurl does not support using them
+ * from several threads at once.  They are kept by the multi handle of
+ * the transfer thread instead.
+ */
+static CURLSH *curl_share;
+static ast_mutex_t curl_share_locks[CURL_LOCK_DATA_LAST];
+
+static void curl_share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+	if (data < ARRAY_LEN(curl_share_locks)) {
+		ast_mutex_lock(&curl_share_locks[data]);
+	}
+}
+
+static void curl_share_unlock(CURL *handle, curl_lock_data data, void *userptr)
+{
+	if (data < ARRAY_LEN(curl_share_locks)) {
+		ast_mutex_unlock(&curl_share_locks[data]);
+	}
+}
+
+static int curl_share_create(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(curl_share_locks); i++) {
+		ast_mutex_init(&curl_share_locks[i]);
+	}
+
+	if (!(curl_share = curl_share_init())) {
+		return -1;
+	}
+	curl_share_setopt(curl_share, CURLSHOPT_LOCKFUNC, curl_share_lock);
+	curl_share_setopt(curl_share, CURLSHOPT_UNLOCKFUNC, curl_share_unlock);
+	curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+	return 0;
+}
+
+static void curl_share_destroy(void)
+{
+	int i;
+
+	/* Transfers detach from the share when they finish, so nothing is using it */
+	if (curl_share && curl_share_cleanup(curl_share) != CURLSHE_OK) {
+		ast_log(LOG_WARNING, "cURL share handle is still in use, leaking it\n");
+		return;
+	}
+	curl_share = NULL;
+
+	for (i = 0; i < ARRAY_LEN(curl_share_locks); i++) {
+		ast_mutex_destroy(&curl_share_locks[i]);
+	}
+}
+
+#ifdef HAVE_CURL_ASYNC
+/*! \brief A transfer handed to the transfer thread */
+struct curl_async_transfer {
+	/*! \brief The transfer, owned by the thread until done is set */
+	CURL *curl;
+	/*! \brief How the transfer went */
+	CURLcode result;
+	/*! \brief The thread has added the transfer to the multi handle */
+	unsigned int added:1;
+	/*! \brief The channel hung up, so the transfer is to be abandoned */
+	unsigned int cancel:1;
+	/*! \brief The thread is done with the transfer */
+	unsigned int done:1;
+	AST_LIST_ENTRY(curl_async_transfer) list;
+};
+
+/*! \brief The transfer thread, whose multi handle keeps the connections, and the transfers waiting for it */
+static struct {
+	CURLM *multi;
+	pthread_t thread;
+	int stop;
+	ast_mutex_t lock;
+	ast_cond_t cond;
+	/*! \brief Transfers to add, or to abandon when cancel is set */
+	AST_LIST_HEAD_NOLOCK(, curl_async_transfer) queue;
+} curl_async = {
+	.thread = AST_PTHREADT_NULL,
+};
+
+static void curl_async_finish(struct curl_async_transfer *transfer, CURLcode result)
+{
+	curl_multi_remove_handle(curl_async.multi, transfer->curl);
+	transfer->result = result;
+	transfer->done = 1;
+	ast_cond_broadcast(&curl_async.cond);
+}
+
+static void *curl_async_thread(void *data)
+{
+	struct curl_async_transfer *transfer;
+	CURLMsg *msg;
+	int running;
+	int left;
+
+	for (;;) {
+		ast_mutex_lock(&curl_async.lock);
+		if (curl_async.stop) {
+			ast_mutex_unlock(&curl_async.lock);
+			break;
+		}
+		while ((transfer = AST_LIST_REMOVE_HEAD(&curl_async.queue, list))) {
+			if (transfer->cancel) {
+				curl_async_finish(transfer, CURLE_ABORTED_BY_CALLBACK);
+				continue;
+			}
+			curl_easy_setopt(transfer->curl, CURLOPT_PRIVATE, transfer);
+			if (curl_multi_add_handle(curl_async.multi, transfer->curl) != CURLM_OK) {
+				curl_async_finish(transfer, CURLE_FAILED_INIT);
+				continue;
+			}
+			transfer->added = 1;
+		}
+		ast_mutex_unlock(&curl_async.lock);
+
+		curl_multi_perform(curl_async.multi, &running);
+
+		while ((msg = curl_multi_info_read(curl_async.multi, &left))) {
+			if (msg->msg != CURLMSG_DONE) {
+				continue;
+			}
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &transfer);
+			ast_mutex_lock(&curl_async.lock);
+			if (transfer->cancel) {
+				/* Finished before it could be abandoned */
+				AST_LIST_REMOVE(&curl_async.queue, transfer, list);
+			}
+			curl_async_finish(transfer, msg->data.result);
+			ast_mutex_unlock(&curl_async.lock);
+		}
+
+		curl_multi_poll(curl_async.multi, NULL, 0, 1000, NULL);
+	}
+
+	return NULL;
+}
+
+static int curl_async_start(void)
+{
+	ast_mutex_init(&curl_async.lock);
+	ast_cond_init(&curl_async.cond, NULL);
+
+	if (!(curl_async.multi = curl_multi_init())) {
+		return -1;
+	}
+	curl_multi_setopt(curl_async.multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+	if (ast_pthread_create_background(&curl_async.thread, NULL, curl_async_thread, NULL)) {
+		curl_async.thread = AST_PTHREADT_NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void curl_async_stop(void)
+{
+	if (curl_async.thread != AST_PTHREADT_NULL) {
+		ast_mutex_lock(&curl_async.lock);
+		curl_async.stop = 1;
+		ast_mutex_unlock(&curl_async.lock);
+		curl_multi_wakeup(curl_async.multi);
+		pthread_join(curl_async.thread, NULL);
+		curl_async.thread = AST_PTHREADT_NULL;
+	}
+	if (curl_async.multi) {
+		curl_multi_cleanup(curl_async.multi);
+		curl_async.multi = NULL;
+	}
+	ast_mutex_destroy(&curl_async.lock);
+	ast_cond_destroy(&curl_async.cond);
+}
+
+/*!
+ * \internal
+ * \brief Run a transfer on the transfer thread
+ *
+ * Waits for the transfer to finish, or for the channel to hang up, in
+ * which case the transfer is abandoned.  Without a channel it always
+ * waits for the transfer to finish.
+ */
+static CURLcode curl_async_perform(struct ast_channel *chan, CURL *curl)
+{
+	struct curl_async_transfer transfer = { .curl = curl, };
+
+	ast_mutex_lock(&curl_async.lock);
+	AST_LIST_INSERT_TAIL(&curl_async.queue, &transfer, list);
+	curl_multi_wakeup(curl_async.multi);
+
+	while (!transfer.done) {
+		struct timeval tv;
+		struct timespec ts;
+
+		if (!chan) {
+			ast_cond_wait(&curl_async.cond, &curl_async.lock);
+			continue;
+		}
+
+		if (!transfer.cancel && ast_check_hangup_locked(chan)) {
+			ast_debug(3, "%s: Hung up, abandoning CURL transfer\n", ast_channel_name(chan));
+			transfer.cancel = 1;
+			if (!transfer.added) {
+				/* Still queued to be added, so nothing to undo */
+				AST_LIST_REMOVE(&curl_async.queue, &transfer, list);
+				transfer.result = CURLE_ABORTED_BY_CALLBACK;
+				break;
+			}
+			AST_LIST_INSERT_TAIL(&curl_async.queue, &transfer, list);
+			curl_multi_wakeup(curl_async.multi);
+		}
+
+		tv = ast_tvadd(ast_tvnow(), ast_samp2tv(100, 1000));
+		ts.tv_sec = tv.tv_sec;
+		ts.tv_nsec = tv.tv_usec * 1000;
+		ast_cond_timedwait(&curl_async.cond, &curl_async.lock, &ts);
+	}
+	ast_mutex_unlock(&curl_async.lock);
+
+	return transfer.result;
+}
+#endif
+
+/*!
+ * \internal
+ * \brief Run a transfer
+ *
+ * Transfers run on the transfer thread when it is running, so they reuse
+ * the connections of its multi handle, and HTTP/2 requests to the same
+ * host are multiplexed over one connection.
+ *
+ * \param chan The channel the transfer is for, may be NULL
+ * \param curl The transfer
+ * \param async Whether to abandon the transfer if the channel hangs up
+ */
+static CURLcode curl_perform(struct ast_channel *chan, CURL *curl, int async)
+{
+	CURLcode res;
+
+	curl_easy_setopt(curl, CURLOPT_SHARE, curl_share);
+#ifdef HAVE_CURL_ASYNC
+	if (curl_async.thread != AST_PTHREADT_NULL) {
+		res = curl_async_perform(async ? chan : NULL, curl);
+	} else
+#endif
+	{
+		res = curl_easy_perform(curl);
+	}
+	curl_easy_setopt(curl, CURLOPT_SHARE, NULL);
+
+	return res;
+}
+
 /*!
  * \brief Check for potential HTTP injection risk.
  *
@@ -683,6 +968,7 @@ static int acf_curl_helper(struct ast_channel *chan, struct curl_args *args)
 	struct curl_slist *headers = NULL;
 	struct ast_datastore *store = NULL;
 	int hashcompat = 0;
+	int async = 0;
 	AST_LIST_HEAD(global_curl_info, curl_settings) *list = NULL;
 	char curl_errbuf[CURL_ERROR_SIZE + 1]; /* add one to be safe */
 
@@ -709,6 +995,8 @@ static int acf_curl_helper(struct ast_channel *chan, struct curl_args *args)
 	AST_LIST_TRAVERSE(&global_curl_info, cur, list) {
 		if (cur->key == CURLOPT_SPECIAL_HASHCOMPAT) {
 			hashcompat = (long) cur->value;
+		} else if (cur->key == CURLOPT_SPECIAL_ASYNC) {
+			async = (long) cur->value;
 		} else if (cur->key == CURLOPT_HTTPHEADER) {
 			headers = curl_slist_append(headers, (char*) cur->value);
 		} else if (cur->key == CURLOPT_SPECIAL_FAILURE_CODE) {
@@ -732,6 +1020,8 @@ static int acf_curl_helper(struct ast_channel *chan, struct curl_args *args)
 			AST_LIST_TRAVERSE(list, cur, list) {
 				if (cur->key == CURLOPT_SPECIAL_HASHCOMPAT) {
 					hashcompat = (long) cur->value;
+				} else if (cur->key == CURLOPT_SPECIAL_ASYNC) {
+					async = (long) cur->value;
 				} else if (cur->key == CURLOPT_HTTPHEADER) {
 					headers = curl_slist_append(headers, (char*) cur->value);
 				} else if (cur->key == CURLOPT_SPECIAL_FAILURE_CODE) {
@@ -763,7 +1053,7 @@ static int acf_curl_helper(struct ast_channel *chan, struct curl_args *args)
 	curl_errbuf[0] = curl_errbuf[CURL_ERROR_SIZE] = '\0';
 	curl_easy_setopt(*curl, CURLOPT_ERRORBUFFER, curl_errbuf);
 
-	if (curl_easy_perform(*curl) != 0) {
+	if (curl_perform(chan, *curl, async) != CURLE_OK) {
 		ast_log(LOG_WARNING, "%s ('%s')\n", curl_errbuf, args->url);
 	}
 
@@ -972,6 +1262,11 @@ static int unload_module(void)
 
 	AST_TEST_UNREGISTER(vulnerable_url);
 
+#ifdef HAVE_CURL_ASYNC
+	curl_async_stop();
+#endif
+	curl_share_destroy();
+
 	return res;
 }
 
@@ -979,6 +1274,17 @@ static int load_module(void)
 {
 	int res;
 
+	if (curl_share_create()) {
+		ast_log(LOG_ERROR, "Unable to create the cURL connection cache\n");
+		curl_share_destroy();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+#ifdef HAVE_CURL_ASYNC
+	if (curl_async_start()) {
+		ast_log(LOG_WARNING, "Unable to start the cURL transfer thread, transfers will not share connections\n");
+	}
+#endif
+
 	res = ast_custom_function_register_escalating(&acf_curl, AST_CFE_WRITE);
 	res |= ast_custom_function_register(&acf_curlopt);
 
@@ -54,6 +54,11 @@
 					<option name="adaptive">
 						<para>Set an adaptive jitterbuffer on the channel.</para>
 					</option>
+					<option name="stretch">
+						<para>Set an adaptive jitterbuffer on the channel which, for signed linear,
+						u-law and a-law audio, shrinks and grows by time stretching the audio
+						rather than by dropping and interpolating whole frames.</para>
+					</option>
 					<option name="disabled">
 						<para>Remove a previously set jitterbuffer from the channel.</para>
 					</option>
@@ -74,7 +79,7 @@
 			<para><replaceable>resync_threshold</replaceable>: The length in milliseconds over
 			which a timestamp difference will result in resyncing the jitterbuffer.
 			Defaults to 1000ms.</para>
-			<para>target_extra: This option only affects the adaptive jitterbuffer. It represents
+			<para>target_extra: This option only affects the adaptive and stretch jitterbuffers. It represents
 			the amount time in milliseconds by which the new jitter buffer will pad its size.
 			Defaults to 40ms.</para>
 			<para>sync_video: This option enables video synchronization with the audio stream. It can be
@@ -128,6 +133,7 @@ static int jb_helper(struct ast_channel *chan, const char *cmd, char *data, cons
 	if (!ast_strlen_zero(data)) {
 		if (strcasecmp(data, "fixed") &&
 				strcasecmp(data, "adaptive") &&
+				strcasecmp(data, "stretch") &&
 				strcasecmp(data, "disabled")) {
 			ast_log(LOG_WARNING, "Unknown Jitterbuffer type %s. Failed to create jitterbuffer.\n", data);
 			return -1;
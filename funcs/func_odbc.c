@@ -44,6 +44,7 @@
 #include "asterisk/res_odbc_transaction.h"
 #include "asterisk/app.h"
 #include "asterisk/cli.h"
+#include "asterisk/manager.h"
 #include "asterisk/strings.h"
 
 /*** DOCUMENTATION
@@ -113,6 +114,24 @@
 			</example>
 		</description>
 	</function>
+	<manager name="ODBCCacheFlush" language="en_US">
+		<synopsis>
+			Flush the cached results of func_odbc functions.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+			<parameter name="Function">
+				<para>The name of the function to flush the results of, such as
+				<literal>ODBC_PRESENCE</literal>.  If not given, the results of every
+				function are flushed.</para>
+			</parameter>
+		</syntax>
+		<description>
+			<para>Forgets the results of reads cached because of the
+			<literal>cache_ttl</literal> option in <filename>func_odbc.conf</filename>,
+			so the next reads go to the database.</para>
+		</description>
+	</manager>
  ***/
 
 static char *config = "func_odbc.conf";
@@ -139,6 +158,39 @@ struct acf_odbc_query {
 	int rowlimit;
 	int minargs;
 	struct ast_custom_function *acf;
+	/*! Results of readsql, if they are cached */
+	struct odbc_cache *cache;
+};
+
+/*! Default maximum number of results cached for a function */
+#define DEFAULT_CACHE_MAX 1000
+
+/*! Results of reads, keyed by the SQL they ran */
+struct odbc_cache {
+	/*! Seconds a result is cached for */
+	int ttl;
+	/*! Seconds a read that found no rows is cached for */
+	int negative_ttl;
+	/*! Most results cached at once */
+	int max;
+	struct ao2_container *entries;
+	/*! Entries, oldest first, so they can be evicted in order */
+	AST_LIST_HEAD_NOLOCK(, odbc_cache_entry) order;
+};
+
+/*! A cached result of a read */
+struct odbc_cache_entry {
+	AST_LIST_ENTRY(odbc_cache_entry) list;
+	struct timeval expires;
+	/*! ODBCSTATUS of the read, SUCCESS or NODATA */
+	const char *status;
+	/*! ODBCROWS of the read */
+	int rows;
+	/*! What the read returned */
+	char *result;
+	/*! The column names of the result */
+	char *fields;
+	char sql[0];
 };
 
 static void odbc_datastore_free(void *data);
@@ -434,6 +486,159 @@ static AST_RWLIST_HEAD_STATIC(queries, acf_odbc_query);
 
 static int resultcount = 0;
 
+AO2_STRING_FIELD_HASH_FN(odbc_cache_entry, sql);
+AO2_STRING_FIELD_CMP_FN(odbc_cache_entry, sql);
+
+static void odbc_cache_destructor(void *obj)
+{
+	struct odbc_cache *cache = obj;
+
+	ao2_cleanup(cache->entries);
+}
+
+static struct odbc_cache *odbc_cache_alloc(int ttl, int negative_ttl, int max)
+{
+	struct odbc_cache *cache;
+
+	cache = ao2_alloc(sizeof(*cache), odbc_cache_destructor);
+	if (!cache) {
+		return NULL;
+	}
+
+	/* Protected by the lock of the cache, along with the order they were added in */
+	cache->entries = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, 61,
+		odbc_cache_entry_hash_fn, NULL, odbc_cache_entry_cmp_fn);
+	if (!cache->entries) {
+		ao2_ref(cache, -1);
+		return NULL;
+	}
+	cache->ttl = ttl;
+	cache->negative_ttl = negative_ttl;
+	cache->max = max;
+
+	return cache;
+}
+
+/*!
+ * \internal
+ * \brief Find the cached result of a read
+ *
+ * \return The result, which must be unreferenced
+ * \retval NULL if the SQL has no result cached, or it expired
+ */
+static struct odbc_cache_entry *odbc_cache_find(struct odbc_cache *cache, const char *sql)
+{
+	struct odbc_cache_entry *entry;
+
+	ao2_lock(cache);
+	entry = ao2_find(cache->entries, sql, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (entry && ast_tvcmp(entry->expires, ast_tvnow()) <= 0) {
+		AST_LIST_REMOVE(&cache->order, entry, list);
+		ao2_unlink_flags(cache->entries, entry, OBJ_NOLOCK);
+		ao2_ref(entry, -1);
+		entry = NULL;
+	}
+	ao2_unlock(cache);
+
+	return entry;
+}
+
+/*!
+ * \internal
+ * \brief Cache the result of a read, evicting the oldest results if the cache is full
+ */
+static void odbc_cache_store(struct odbc_cache *cache, const char *sql, const char *status,
+	int rows, const char *result, const char *fields)
+{
+	struct odbc_cache_entry *entry;
+	struct odbc_cache_entry *old;
+	size_t sql_len = strlen(sql) + 1;
+	size_t result_len = strlen(result) + 1;
+	int ttl = rows ? cache->ttl : cache->negative_ttl;
+
+	if (ttl <= 0) {
+		return;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + sql_len + result_len + strlen(fields) + 1, NULL,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	entry->expires = ast_tvadd(ast_tvnow(), ast_samp2tv(ttl, 1));
+	entry->status = status;
+	entry->rows = rows;
+	strcpy(entry->sql, sql); /* Safe */
+	entry->result = entry->sql + sql_len;
+	strcpy(entry->result, result); /* Safe */
+	entry->fields = entry->result + result_len;
+	strcpy(entry->fields, fields); /* Safe */
+
+	ao2_lock(cache);
+	if ((old = ao2_find(cache->entries, sql, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NOLOCK))) {
+		AST_LIST_REMOVE(&cache->order, old, list);
+		ao2_ref(old, -1);
+	}
+	while (ao2_container_count(cache->entries) >= cache->max
+		&& (old = AST_LIST_REMOVE_HEAD(&cache->order, list))) {
+		ao2_unlink_flags(cache->entries, old, OBJ_NOLOCK);
+	}
+	ao2_link_flags(cache->entries, entry, OBJ_NOLOCK);
+	AST_LIST_INSERT_TAIL(&cache->order, entry, list);
+	ao2_unlock(cache);
+
+	ao2_ref(entry, -1);
+}
+
+/*!
+ * \internal
+ * \brief Forget every result of a cache
+ *
+ * \return How many results were forgotten
+ */
+static int odbc_cache_flush(struct odbc_cache *cache)
+{
+	int count;
+
+	ao2_lock(cache);
+	count = ao2_container_count(cache->entries);
+	AST_LIST_HEAD_INIT_NOLOCK(&cache->order);
+	ao2_callback(cache->entries, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA | OBJ_NOLOCK, NULL, NULL);
+	ao2_unlock(cache);
+
+	return count;
+}
+
+/*!
+ * \internal
+ * \brief Flush the caches of every function, or of a named one
+ *
+ * \param name The name of the function, NULL for all of them
+ *
+ * \return How many results were forgotten
+ * \retval -1 if there is no such function
+ */
+static int odbc_caches_flush(const char *name)
+{
+	struct acf_odbc_query *query;
+	int count = 0;
+	int found = 0;
+
+	AST_RWLIST_RDLOCK(&queries);
+	AST_RWLIST_TRAVERSE(&queries, query, list) {
+		if (name && strcmp(query->acf->name, name)) {
+			continue;
+		}
+		found = 1;
+		if (query->cache) {
+			count += odbc_cache_flush(query->cache);
+		}
+	}
+	AST_RWLIST_UNLOCK(&queries);
+
+	return !name || found ? count : -1;
+}
+
 AST_THREADSTORAGE(sql_buf);
 AST_THREADSTORAGE(sql2_buf);
 AST_THREADSTORAGE(coldata_buf);
@@ -716,6 +921,11 @@ static int acf_odbc_write(struct ast_channel *chan, const char *cmd, char *s, co
 		}
 	}
 
+	/* What was written may be what reads of the function have cached */
+	if (query->cache && strcmp(status, "FAILURE")) {
+		odbc_cache_flush(query->cache);
+	}
+
 	AST_RWLIST_UNLOCK(&queries);
 
 	/* Output the affected rows, for all cases.  In the event of failure, we
@@ -758,6 +968,8 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 	struct ast_str *sql = ast_str_thread_get(&sql_buf, 16);
 	const char *status = "FAILURE";
 	struct dsn *dsn = NULL;
+	RAII_VAR(struct odbc_cache *, cache, NULL, ao2_cleanup);
+	struct odbc_cache_entry *cached;
 
 	if (!sql || !colnames) {
 		if (chan) {
@@ -826,6 +1038,23 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 		}
 	}
 
+	if ((cache = ao2_bump(query->cache)) && (cached = odbc_cache_find(cache, ast_str_buffer(sql)))) {
+		AST_RWLIST_UNLOCK(&queries);
+		ast_debug(3, "Using cached result of %s [%s]\n", cmd, ast_str_buffer(sql));
+		ast_copy_string(buf, cached->result, len);
+		if (!bogus_chan) {
+			snprintf(rowcount, sizeof(rowcount), "%d", cached->rows);
+			pbx_builtin_setvar_helper(chan, "ODBCROWS", rowcount);
+			pbx_builtin_setvar_helper(chan, "ODBCSTATUS", cached->status);
+			if (cached->rows) {
+				pbx_builtin_setvar_helper(chan, "~ODBCFIELDS~", cached->fields);
+			}
+			ast_autoservice_stop(chan);
+		}
+		ao2_ref(cached, -1);
+		return 0;
+	}
+
 	/* Save these flags, so we can release the lock */
 	escapecommas = ast_test_flag(query, OPT_ESCAPECOMMAS);
 	if (!bogus_chan && ast_test_flag(query, OPT_MULTIROW)) {
@@ -900,6 +1129,9 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 	if (colcount <= 0) {
 		ast_verb(4, "Returned %d columns [%s]\n", colcount, ast_str_buffer(sql));
 		buf[0] = '\0';
+		if (cache) {
+			odbc_cache_store(cache, ast_str_buffer(sql), "NODATA", 0, "", "");
+		}
 		SQLCloseCursor(stmt);
 		SQLFreeHandle (SQL_HANDLE_STMT, stmt);
 		release_obj_or_dsn (&obj, &dsn);
@@ -921,6 +1153,9 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 			buf[0] = '\0';
 			ast_copy_string(rowcount, "0", sizeof(rowcount));
 			status = "NODATA";
+			if (cache) {
+				odbc_cache_store(cache, ast_str_buffer(sql), "NODATA", 0, "", "");
+			}
 		} else {
 			ast_log(LOG_WARNING, "Error %d in FETCH [%s]\n", res, ast_str_buffer(sql));
 			status = "FETCHERROR";
@@ -1064,6 +1299,9 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 	}
 
 end_acf_read:
+	if (cache && y == 1 && !strcmp(status, "SUCCESS")) {
+		odbc_cache_store(cache, ast_str_buffer(sql), "SUCCESS", 1, buf, ast_str_buffer(colnames));
+	}
 	if (!bogus_chan) {
 		snprintf(rowcount, sizeof(rowcount), "%d", y);
 		pbx_builtin_setvar_helper(chan, "ODBCROWS", rowcount);
@@ -1229,6 +1467,7 @@ static int free_acf_query(struct acf_odbc_query *query)
 		ast_free(query->sql_read);
 		ast_free(query->sql_write);
 		ast_free(query->sql_insert);
+		ao2_cleanup(query->cache);
 		ast_free(query);
 	}
 	return 0;
@@ -1350,6 +1589,35 @@ static int init_acf_query(struct ast_config *cfg, char *catg, struct acf_odbc_qu
 		sscanf(tmp, "%30d", &((*query)->minargs));
 	}
 
+	if ((tmp = ast_variable_retrieve(cfg, catg, "cache_ttl"))) {
+		int ttl = 0;
+		int negative_ttl;
+		int max = DEFAULT_CACHE_MAX;
+
+		sscanf(tmp, "%30d", &ttl);
+		negative_ttl = ttl;
+		if ((tmp = ast_variable_retrieve(cfg, catg, "cache_negative_ttl"))) {
+			sscanf(tmp, "%30d", &negative_ttl);
+		}
+		if ((tmp = ast_variable_retrieve(cfg, catg, "cache_max"))) {
+			sscanf(tmp, "%30d", &max);
+		}
+
+		if (ttl <= 0 && negative_ttl <= 0) {
+			/* Caching is disabled */
+		} else if (!(*query)->sql_read) {
+			ast_log(LOG_WARNING, "Function %s has no readsql to cache the results of\n", catg);
+		} else if (ast_test_flag((*query), OPT_MULTIROW) || (*query)->rowlimit > 1) {
+			ast_log(LOG_WARNING, "Results of %s are not cached, only single row reads can be\n", catg);
+		} else if (max > 0) {
+			if (!((*query)->cache = odbc_cache_alloc(ttl, negative_ttl, max))) {
+				free_acf_query(*query);
+				*query = NULL;
+				return ENOMEM;
+			}
+		}
+	}
+
 	(*query)->acf = ast_calloc(1, sizeof(struct ast_custom_function));
 	if (!(*query)->acf) {
 		free_acf_query(*query);
@@ -1823,11 +2091,75 @@ static char *cli_odbc_write(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 	return CLI_SUCCESS;
 }
 
+static char *cli_odbc_cache_flush(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct acf_odbc_query *query;
+	int count;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "odbc cache flush";
+		e->usage =
+			"Usage: odbc cache flush [<name>]\n"
+			"       Forgets the cached results of the ODBC function <name>, or of\n"
+			"       every ODBC function, so the next reads go to the database.\n";
+		return NULL;
+	case CLI_GENERATE:
+		if (a->pos == 3) {
+			int wordlen = strlen(a->word), which = 0;
+			/* Complete function name */
+			AST_RWLIST_RDLOCK(&queries);
+			AST_RWLIST_TRAVERSE(&queries, query, list) {
+				if (query->cache && !strncasecmp(query->acf->name, a->word, wordlen)) {
+					if (++which > a->n) {
+						char *res = ast_strdup(query->acf->name);
+						AST_RWLIST_UNLOCK(&queries);
+						return res;
+					}
+				}
+			}
+			AST_RWLIST_UNLOCK(&queries);
+		}
+		return NULL;
+	}
+
+	if (a->argc < 3 || a->argc > 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	count = odbc_caches_flush(a->argc == 4 ? a->argv[3] : NULL);
+	if (count < 0) {
+		ast_cli(a->fd, "No such query '%s'\n", a->argv[3]);
+		return CLI_FAILURE;
+	}
+	ast_cli(a->fd, "Flushed %d cached result%s.\n", count, ESS(count));
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_func_odbc[] = {
 	AST_CLI_DEFINE(cli_odbc_write, "Test setting a func_odbc function"),
 	AST_CLI_DEFINE(cli_odbc_read, "Test reading a func_odbc function"),
+	AST_CLI_DEFINE(cli_odbc_cache_flush, "Flush the cached results of func_odbc functions"),
 };
 
+static int manager_odbc_cache_flush(struct mansession *s, const struct message *m)
+{
+	const char *function = astman_get_header(m, "Function");
+	int count;
+	char msg[64];
+
+	count = odbc_caches_flush(S_OR(function, NULL));
+	if (count < 0) {
+		astman_send_error(s, m, "No such function");
+		return 0;
+	}
+	snprintf(msg, sizeof(msg), "Flushed %d cached result%s", count, ESS(count));
+	astman_send_ack(s, m, msg);
+
+	return 0;
+}
+
 static int load_module(void)
 {
 	int res = 0;
@@ -1893,6 +2225,7 @@ static int load_module(void)
 	res |= ast_custom_function_register(&escape_function);
 	res |= ast_custom_function_register(&escape_backslashes_function);
 	ast_cli_register_multiple(cli_func_odbc, ARRAY_LEN(cli_func_odbc));
+	res |= ast_manager_register_xml("ODBCCacheFlush", EVENT_FLAG_SYSTEM, manager_odbc_cache_flush);
 
 	AST_RWLIST_UNLOCK(&queries);
 	return res;
@@ -1915,6 +2248,7 @@ static int unload_module(void)
 	res |= ast_custom_function_unregister(&fetch_function);
 	res |= ast_unregister_application(app_odbcfinish);
 	ast_cli_unregister_multiple(cli_func_odbc, ARRAY_LEN(cli_func_odbc));
+	ast_manager_unregister("ODBCCacheFlush");
 
 	/* Allow any threads waiting for this lock to pass (avoids a race) */
 	AST_RWLIST_UNLOCK(&queries);
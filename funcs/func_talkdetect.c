@@ -36,7 +36,6 @@
 #include "asterisk/pbx.h"
 #include "asterisk/app.h"
 #include "asterisk/dsp.h"
-#include "asterisk/audiohook.h"
 #include "asterisk/stasis.h"
 #include "asterisk/stasis_channels.h"
 
@@ -123,7 +122,9 @@
 				in the order in which they are placed on the channel. As such,
 				it typically makes sense to place functions that modify the voice
 				media data prior to placing the TALK_DETECT function, as this will
-				yield better results.</para>
+				yield better results. The audiohook is shared with the other talk
+				and silence detection on the channel, such as in a conference, and
+				is placed by whichever of them starts first.</para>
 			</note>
 			<example title="Denoise and then perform talk detection">
 			same => n,Set(DENOISE(rx)=on)    ; Denoise received audio
@@ -137,8 +138,8 @@
 
 /*! \brief Private data structure used with the function's datastore */
 struct talk_detect_params {
-	/*! The audiohook for the function */
-	struct ast_audiohook audiohook;
+	/*! Our subscription to the channel's voice activity analysis */
+	int vad_id;
 	/*! Our threshold above which we consider someone talking */
 	int dsp_talking_threshold;
 	/*! How long we'll wait before we decide someone is silent */
@@ -155,8 +156,6 @@ struct talk_detect_params {
 static void datastore_destroy_cb(void *data) {
 	struct talk_detect_params *td_params = data;
 
-	ast_audiohook_destroy(&td_params->audiohook);
-
 	if (td_params->dsp) {
 		ast_dsp_free(td_params->dsp);
 	}
@@ -169,41 +168,20 @@ static const struct ast_datastore_info talk_detect_datastore = {
 	.destroy = datastore_destroy_cb
 };
 
-/*! \internal \brief An audiohook modification callback
+/*! \internal \brief A voice activity callback
  *
  * This processes the read side of a channel's voice data to see if
  * they are talking
- *
- * \note We don't actually modify the audio, so this function always
- * returns a 'failure' indicating that it didn't modify the data
  */
-static int talk_detect_audiohook_cb(struct ast_audiohook *audiohook, struct ast_channel *chan, struct ast_frame *frame, enum ast_audiohook_direction direction)
+static void talk_detect_vad_cb(struct ast_channel *chan, const struct ast_dsp_vad_result *result, void *data)
 {
 	int total_silence;
 	int is_talking;
 	int update_talking = 0;
-	struct ast_datastore *datastore;
-	struct talk_detect_params *td_params;
+	struct talk_detect_params *td_params = data;
 	struct stasis_message *message;
 
-	if (audiohook->status == AST_AUDIOHOOK_STATUS_DONE) {
-		return 1;
-	}
-
-	if (direction != AST_AUDIOHOOK_DIRECTION_READ) {
-		return 1;
-	}
-
-	if (frame->frametype != AST_FRAME_VOICE) {
-		return 1;
-	}
-
-	if (!(datastore = ast_channel_datastore_find(chan, &talk_detect_datastore, NULL))) {
-		return 1;
-	}
-	td_params = datastore->data;
-
-	is_talking = !ast_dsp_silence(td_params->dsp, frame, &total_silence);
+	is_talking = !ast_dsp_vad_silence(td_params->dsp, result, &total_silence);
 	if (is_talking) {
 		if (!td_params->talking) {
 			update_talking = 1;
@@ -226,7 +204,7 @@ static int talk_detect_audiohook_cb(struct ast_audiohook *audiohook, struct ast_
 
 			blob = ast_json_pack("{s: I}", "duration", (ast_json_int_t)diff_ms);
 			if (!blob) {
-				return 1;
+				return;
 			}
 		}
 
@@ -242,8 +220,6 @@ static int talk_detect_audiohook_cb(struct ast_audiohook *audiohook, struct ast_
 
 		ast_json_unref(blob);
 	}
-
-	return 1;
 }
 
 /*! \internal \brief Disable talk detection on the channel */
@@ -261,11 +237,7 @@ static int remove_talk_detect(struct ast_channel *chan)
 	}
 	td_params = datastore->data;
 
-	if (ast_audiohook_remove(chan, &td_params->audiohook)) {
-		ast_log(AST_LOG_WARNING, "Failed to remove TALK_DETECT audiohook from channel %s\n",
-		        ast_channel_name(chan));
-		return -1;
-	}
+	ast_dsp_vad_unsubscribe(chan, td_params->vad_id);
 
 	if (ast_channel_datastore_remove(chan, datastore)) {
 		ast_log(AST_LOG_WARNING, "Failed to remove TALK_DETECT datastore from channel %s\n",
@@ -297,13 +269,6 @@ static int set_talk_detect(struct ast_channel *chan, int dsp_silence_threshold,
 			return -1;
 		}
 
-		ast_audiohook_init(&td_params->audiohook,
-		                   AST_AUDIOHOOK_TYPE_MANIPULATE,
-		                   "TALK_DETECT",
-		                   AST_AUDIOHOOK_MANIPULATE_ALL_RATES);
-		td_params->audiohook.manipulate_callback = talk_detect_audiohook_cb;
-		ast_set_flag(&td_params->audiohook, AST_AUDIOHOOK_TRIGGER_READ);
-
 		td_params->dsp = ast_dsp_new_with_rate(ast_format_get_sample_rate(ast_channel_rawreadformat(chan)));
 		if (!td_params->dsp) {
 			ast_datastore_free(datastore);
@@ -312,8 +277,12 @@ static int set_talk_detect(struct ast_channel *chan, int dsp_silence_threshold,
 		}
 		datastore->data = td_params;
 
+		td_params->vad_id = ast_dsp_vad_subscribe(chan, talk_detect_vad_cb, td_params);
+		if (td_params->vad_id < 0) {
+			ast_datastore_free(datastore);
+			return -1;
+		}
 		ast_channel_datastore_add(chan, datastore);
-		ast_audiohook_attach(chan, &td_params->audiohook);
 	} else {
 		/* Talk detection already enabled; update existing settings */
 		td_params = datastore->data;
@@ -49,6 +49,9 @@ int ast_file_init(void);		/*!< Provided by file.c */
 void ast_autoservice_init(void);	/*!< Provided by autoservice.c */
 int ast_tps_init(void); 		/*!< Provided by taskprocessor.c */
 int ast_timing_init(void);		/*!< Provided by timing.c */
+int ast_slinear_init(void);		/*!< Provided by slinear.c */
+int ast_stretch_jb_init(void);		/*!< Provided by stretchjitterbuf.c */
+int ast_frame_init(void);		/*!< Provided by frame.c */
 void ast_stun_init(void);               /*!< Provided by stun.c */
 int ast_ssl_init(void);                 /*!< Provided by ssl.c */
 int ast_pj_init(void);                 /*!< Provided by libasteriskpj.c */
@@ -123,4 +126,54 @@ int ast_parking_stasis_init(void);
  */
 int ast_endpoint_init(void);
 
+/*!
+ * \brief Initialize startup profiling. Provided by startup_profile.c
+ * \retval 0 on success.
+ */
+int ast_startup_profile_init(void);
+
+/*!
+ * \brief Whether startup is being profiled. Provided by startup_profile.c
+ *
+ * \retval non-zero if startup_profile is enabled and Asterisk is not fully booted yet.
+ */
+int ast_startup_profile_active(void);
+
+/*!
+ * \brief Record something that took time during startup. Provided by startup_profile.c
+ *
+ * Does nothing unless ast_startup_profile_active().  It ended now.
+ *
+ * \param category What kind of thing it was, must be a string literal
+ * \param name What it was
+ * \param start When it started
+ */
+void ast_startup_profile_record(const char *category, const char *name, struct timeval start);
+
+/*!
+ * \brief Initialize latency histograms. Provided by latency.c
+ * \retval 0 on success.
+ */
+int ast_latency_init(void);
+
+/*!
+ * \brief Initialize lock contention reporting. Provided by lock_contention.c
+ * \retval 0 on success.
+ */
+int ast_lock_contention_init(void);
+
+/*!
+ * \brief Set the CPUs a class of threads runs on from asterisk.conf. Provided by affinity.c
+ * \param option media_cpus or signaling_cpus
+ * \param value A list of CPUs such as 0-3,8 or NUMA nodes such as node0
+ * \retval -1 if the option is not one of those.
+ */
+int ast_thread_affinity_set_option(const char *option, const char *value);
+
+/*!
+ * \brief Initialize the dial batch scheduler. Provided by dial.c
+ * \retval 0 on success.
+ */
+int ast_dial_init(void);
+
 #endif /* _ASTERISK__PRIVATE_H */
@@ -51,6 +51,7 @@ enum {
 enum ast_jb_type {
 	AST_JB_FIXED,
 	AST_JB_ADAPTIVE,
+	AST_JB_STRETCH,
 };
 
 /*! Abstract return codes */
@@ -64,10 +64,14 @@ struct ast_ha {
  * \note These shouldn't be used directly by ACL consumers. Consumers should handle
  *       ACLs via ast_acl_list structs.
  */
+struct ast_ha_table;
+
 struct ast_acl {
 	struct ast_ha *acl;             /*!< Rules contained by the ACL */
 	int is_realtime;                /*!< If raised, this named ACL was retrieved from realtime storage */
 	int is_invalid;                 /*!< If raised, this is an invalid ACL which will automatically reject everything. */
+	struct ast_ha_table *table;     /*!< The rules compiled by ast_ha_compile(), built when the ACL is first applied */
+	unsigned int compiled:1;        /*!< If raised, compiling the rules has been tried since they last changed */
 	char name[ACL_NAME_LENGTH];     /*!< If this was retrieved from the named ACL subsystem, this is the name of the ACL. */
 	AST_LIST_ENTRY(ast_acl) list;
 };
@@ -215,6 +219,37 @@ int ast_acl_list_is_empty(struct ast_acl_list *acl_list);
  */
 enum ast_acl_sense ast_apply_ha(const struct ast_ha *ha, const struct ast_sockaddr *addr);
 
+/*!
+ * \brief Compile a set of rules for faster application
+ *
+ * \details
+ * The rules are turned into sorted address ranges that do not overlap,
+ * each with the sense ast_apply_ha() would give the addresses in it, so
+ * applying them is a binary search rather than a walk over every rule.
+ *
+ * \param ha The head of the list of host access rules to compile
+ * \return The compiled rules, to be freed with ast_ha_table_free()
+ * \retval NULL if a rule is limited to a port or has a netmask that is not
+ * a prefix, in which case ast_apply_ha() must be used, or on error
+ */
+struct ast_ha_table *ast_ha_compile(const struct ast_ha *ha);
+
+/*!
+ * \brief Apply a set of compiled rules to a given IP address
+ *
+ * \param table The compiled rules
+ * \param addr An ast_sockaddr whose address is considered when matching rules
+ * \return The same as ast_apply_ha() on the rules the table was compiled from
+ */
+enum ast_acl_sense ast_ha_table_apply(const struct ast_ha_table *table, const struct ast_sockaddr *addr);
+
+/*!
+ * \brief Free a set of compiled rules
+ *
+ * \param table The compiled rules, may be NULL
+ */
+void ast_ha_table_free(struct ast_ha_table *table);
+
 /*!
  * \brief Apply a set of rules to a given IP address
  *
@@ -0,0 +1,83 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Thread CPU affinity
+ *
+ * CPUs can be set aside in asterisk.conf for classes of threads, so media
+ * threads and signaling threads each stay on their own CPUs, or on the CPUs
+ * of one NUMA node.  Linux allocates memory on the node of the CPU which
+ * first touches it, so a thread kept on the CPUs of a node also gets the
+ * memory it allocates from that node.
+ */
+
+#ifndef _ASTERISK_AFFINITY_H
+#define _ASTERISK_AFFINITY_H
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+/*! \brief The classes of threads CPUs can be set aside for */
+enum ast_thread_affinity_class {
+	/*! RTP media workers, FAX DSP workers and conference mixing threads, media_cpus in asterisk.conf */
+	AST_THREAD_AFFINITY_MEDIA,
+	/*! Threadpool and taskprocessor threads and the PJSIP threads, signaling_cpus in asterisk.conf */
+	AST_THREAD_AFFINITY_SIGNALING,
+};
+
+/*!
+ * \brief Get the CPU a worker of a pool is pinned to
+ *
+ * The workers of a pool are spread over the CPUs set aside for their class,
+ * or over every CPU online if none are.
+ *
+ * \param thread_class The class of the pool
+ * \param index Which worker of the pool
+ *
+ * \retval -1 if CPU affinity is not supported on this platform
+ * \return the CPU
+ */
+int ast_thread_affinity_cpu(enum ast_thread_affinity_class thread_class, unsigned int index);
+
+/*!
+ * \brief Keep the calling thread on the CPUs set aside for its class
+ *
+ * \param thread_class The class of the thread
+ * \param index Which worker of a pool the thread is, to pin it to the single
+ *        CPU ast_thread_affinity_cpu() gives, or -1 to let it run on any
+ *        CPU set aside for its class
+ *
+ * \retval 0 on success, or if there is nothing to do
+ * \retval -1 on failure
+ */
+int ast_thread_affinity_apply(enum ast_thread_affinity_class thread_class, int index);
+
+/*!
+ * \brief Describe the CPUs set aside for a class of threads
+ *
+ * \param thread_class The class
+ *
+ * \return the CPUs as set in asterisk.conf, "(any)" if none are
+ */
+const char *ast_thread_affinity_describe(enum ast_thread_affinity_class thread_class);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif /* _ASTERISK_AFFINITY_H */
@@ -71,6 +71,20 @@ ast_alert_status_t ast_alertpipe_read(int alert_pipe[2]);
  */
 ssize_t ast_alertpipe_write(int alert_pipe[2]);
 
+/*!
+ * \brief Write several events to an alert pipe at once
+ *
+ * The same as calling ast_alertpipe_write() \a count times, but with
+ * a single write when the alert pipe is an eventfd.
+ *
+ * \param alert_pipe a two-element array containing the alert pipe's file descriptors
+ * \param count the number of events to write
+ *
+ * \retval 0 Success
+ * \retval 1 Failure
+ */
+ssize_t ast_alertpipe_write_count(int alert_pipe[2], unsigned int count);
+
 /*!
  * \brief Consume all alerts written to the alert pipe
  * \since 13.16.0
@@ -92,6 +92,8 @@ struct stasis_rest_handlers {
 struct ast_ari_response {
 	/*! Response message */
 	struct ast_json *message;
+	/*! Response message already encoded, sent instead of message if set */
+	struct ast_str *body;
 	/*! \\r\\n seperated response headers */
 	struct ast_str *headers;
 	/*! HTTP response code.
@@ -185,6 +187,9 @@ struct ast_json *ast_ari_websocket_session_read(
 /*!
  * \brief Send a message to an ARI WebSocket.
  *
+ * If another thread is writing to the WebSocket, the message is queued
+ * for it to write and this returns right away.
+ *
  * \param session Session to write to.
  * \param message Message to send.
  * \retval 0 on success.
@@ -244,6 +249,19 @@ __attribute__((format(printf, 4, 5)));
 void ast_ari_response_ok(struct ast_ari_response *response,
 			     struct ast_json *message);
 
+/*!
+ * \brief Fill in an \c OK (200) \a ast_ari_response with an encoded message.
+ *
+ * For large responses written with an \ref ast_json_writer, which only
+ * writes compact JSON, so only when ast_ari_json_format() is
+ * \ref AST_JSON_COMPACT.
+ *
+ * \param response Response to fill in.
+ * \param body JSON text of the response.  It is freed with the response.
+ */
+void ast_ari_response_ok_body(struct ast_ari_response *response,
+			     struct ast_str *body);
+
 /*!
  * \brief Fill in a <tt>No Content</tt> (204) \a ast_ari_response.
  */
@@ -68,6 +68,44 @@ int __ast_repl_asprintf(const char *file, int lineno, const char *func, char **s
 int __ast_repl_vasprintf(char **strp, const char *format, va_list ap, const char *file, int lineno, const char *func)
 	__attribute__((format(printf, 2, 0)));
 
+/*!
+ * \brief What is allocated by the code of one source file
+ *
+ * \see ast_mm_accounting_foreach()
+ */
+struct ast_mm_account {
+	/*! \brief The name of the source file, without its directory */
+	const char *file;
+	/*! \brief How many allocations are outstanding */
+	int64_t allocations;
+	/*! \brief How many bytes they were asked for */
+	int64_t bytes;
+};
+
+/*!
+ * \brief Callback for ast_mm_accounting_foreach()
+ *
+ * \param account What a source file has allocated, only valid during the callback
+ * \param data The data passed to ast_mm_accounting_foreach()
+ */
+typedef void (*ast_mm_account_cb)(const struct ast_mm_account *account, void *data);
+
+/*!
+ * \brief Report the memory allocations outstanding by the source file which made them
+ *
+ * Only Asterisk built with MALLOC_ACCOUNTING counts them.  Every allocation
+ * made by the ast_malloc() family, astobj2 objects included, is counted
+ * against the source file it was made from.  The files are reported with
+ * the most bytes first.
+ *
+ * \param callback Called for each source file with allocations outstanding
+ * \param data Passed to the callback
+ *
+ * \retval -1 if allocations are not counted
+ * \return the number of source files reported
+ */
+int ast_mm_accounting_foreach(ast_mm_account_cb callback, void *data);
+
 /*!
  * \brief ASTMM_LIBC can be defined to control the meaning of standard allocators.
  *
@@ -376,6 +376,22 @@ enum ao2_alloc_opts {
 	AO2_ALLOC_OPT_LOCK_OBJ = AO2_ALLOC_OPT_LOCK_MASK,
 	/*! The ao2 object will not record any REF_DEBUG entries */
 	AO2_ALLOC_OPT_NO_REF_DEBUG = (1 << 2),
+	/*!
+	 * \brief The recursive mutex of the ao2 object is a small lock that spins briefly before sleeping.
+	 *
+	 * Meant for objects locked very often for very short periods.  A
+	 * thread finding the object locked spins for a moment, as it is
+	 * likely to be unlocked soon, rather than sleeping straight away.
+	 * The lock is also much smaller than a mutex.
+	 *
+	 * \note Only used along with AO2_ALLOC_OPT_LOCK_MUTEX.  The object
+	 * gets a plain mutex where the lock is not available, and when
+	 * DEBUG_THREADS is defined so its locking can be tracked.
+	 *
+	 * \note ao2_object_get_lockaddr() returns NULL for such an object,
+	 * so it cannot be waited on with a condition.
+	 */
+	AO2_ALLOC_OPT_LOCK_ADAPTIVE = (1 << 3),
 };
 
 /*!
@@ -491,6 +507,33 @@ unsigned int ao2_options_get(void *obj);
 
 int __ao2_ref(void *o, int delta, const char *tag, const char *file, int line, const char *func);
 
+/*!
+ * \brief Make an object immortal, no longer counting its references
+ *
+ * Every reference taken or released is an atomic write to the object,
+ * which bounces its cache line between the CPUs of the threads using it.
+ * References to an immortal object are not counted, so objects used by
+ * every thread all the time, such as the cached formats, are only read.
+ *
+ * \param obj AO2 object which is never to be destroyed.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ *
+ * \warning This cannot be undone.  The references released afterwards
+ *          were never counted, so the object is never destroyed and its
+ *          destructor never runs, not even at shutdown.  It is only for
+ *          objects which live as long as Asterisk does.
+ *
+ * \note Objects with a weak proxy cannot be made immortal.
+ */
+#define ao2_make_immortal(obj) \
+	__ao2_make_immortal((obj), NULL, __FILE__, __LINE__, __PRETTY_FUNCTION__)
+#define ao2_t_make_immortal(obj, tag) \
+	__ao2_make_immortal((obj), (tag), __FILE__, __LINE__, __PRETTY_FUNCTION__)
+
+int __ao2_make_immortal(void *obj, const char *tag, const char *file, int line, const char *func);
+
 /*!
  * \since 12.4.0
  * \brief Replace one object reference with another cleaning up the original.
@@ -1209,6 +1252,28 @@ enum ao2_container_opts {
 	 * ao2_sort_fn.
 	 */
 	AO2_CONTAINER_ALLOC_OPT_DUPS_REPLACE = (3 << 1),
+
+	/*!
+	 * \brief Give each range of hash buckets its own lock.
+	 *
+	 * \details Searches by object or key, links and unlinks only
+	 * lock the shard holding the key, and hold the container lock
+	 * for reading.  Finds and links of keys in different shards can
+	 * then run concurrently.  Traversals of the whole container and
+	 * iterators lock every shard.
+	 *
+	 * \note Only hash containers allocated with
+	 * AO2_ALLOC_OPT_LOCK_RWLOCK are sharded.  The option is ignored
+	 * by other containers.
+	 *
+	 * \note Holding the container read lock does not stop other
+	 * threads linking or unlinking objects.  Use ao2_lock() to
+	 * exclude all other users of the container.
+	 *
+	 * \note Callbacks run on a sharded container must not search
+	 * or modify the same container.
+	 */
+	AO2_CONTAINER_ALLOC_OPT_SHARDED = (1 << 3),
 };
 
 /*!
@@ -1356,6 +1421,42 @@ struct ao2_container *__ao2_container_alloc_rbtree(unsigned int ao2_options, uns
 	ao2_sort_fn *sort_fn, ao2_callback_fn *cmp_fn,
 	const char *tag, const char *file, int line, const char *func) attribute_warn_unused_result;
 
+/*!
+ * \brief Allocate and initialize an open addressing hash container.
+ *
+ * \details
+ * The container stores its objects in a single array of slots that
+ * holds each object's hash value next to it.  Searches by object or
+ * key probe adjacent slots and only compare objects with a matching
+ * hash, which keeps lookups in large containers cache friendly.  The
+ * array grows as objects are linked.
+ *
+ * Iterators and traversals that are not searching by object or key
+ * visit the objects in the order they were linked.
+ *
+ * \param ao2_options Container ao2 object options (See enum ao2_alloc_opts)
+ * \param container_options Container behaviour options (See enum ao2_container_opts)
+ * \param n_expected Number of objects the container is initially sized for
+ * \param hash_fn Pointer to a function computing a hash value. (NULL if everything has the same hash.)
+ * \param sort_fn Pointer to a sort function used to recognize duplicates and
+ *        filter searches. (NULL to not recognize duplicates.)  The container is not sorted.
+ * \param cmp_fn Pointer to a compare function used by ao2_find. (NULL to match everything)
+ *
+ * \return A pointer to a struct container.
+ *
+ * \note Destructor is set implicitly.
+ */
+#define ao2_container_alloc_open_hash(ao2_options, container_options, n_expected, hash_fn, sort_fn, cmp_fn) \
+	__ao2_container_alloc_open_hash((ao2_options), (container_options), (n_expected), (hash_fn), (sort_fn), (cmp_fn), NULL,  __FILE__, __LINE__, __PRETTY_FUNCTION__)
+
+#define ao2_t_container_alloc_open_hash(ao2_options, container_options, n_expected, hash_fn, sort_fn, cmp_fn, tag) \
+	__ao2_container_alloc_open_hash((ao2_options), (container_options), (n_expected), (hash_fn), (sort_fn), (cmp_fn), (tag),  __FILE__, __LINE__, __PRETTY_FUNCTION__)
+
+struct ao2_container *__ao2_container_alloc_open_hash(unsigned int ao2_options,
+	unsigned int container_options, unsigned int n_expected, ao2_hash_fn *hash_fn,
+	ao2_sort_fn *sort_fn, ao2_callback_fn *cmp_fn,
+	const char *tag, const char *file, int line, const char *func) attribute_warn_unused_result;
+
 /*! \brief
  * Returns the number of elements in a container.
  */
@@ -1425,6 +1526,96 @@ int ao2_container_dup_weakproxy_objs(struct ao2_container *dest, struct ao2_cont
 struct ao2_container *__ao2_container_clone(struct ao2_container *orig, enum search_flags flags,
 	const char *tag, const char *file, int line, const char *func) attribute_warn_unused_result;
 
+/*!
+ * \brief Read-copy-update holder for a read-mostly ao2 container.
+ *
+ * \details
+ * The holder publishes immutable snapshots of a container.  Readers
+ * search the current snapshot without taking any lock, and writers
+ * build a new snapshot and publish it in one atomic step.  A replaced
+ * snapshot is released once every reader that could have seen it has
+ * finished with it.
+ *
+ * Snapshots should be allocated with AO2_ALLOC_OPT_LOCK_NOLOCK and
+ * must not be modified once published.  Writers serialize with each
+ * other by holding ao2_lock() on the holder while they copy, modify
+ * and publish the container.
+ *
+ * Example usage:
+ * \code
+ * ao2_lock(rcu);
+ * current = ao2_rcu_container_ref(rcu);
+ * copy = ao2_container_clone(current, 0);
+ * ao2_link(copy, obj);
+ * ao2_rcu_container_publish(rcu, copy);
+ * ao2_unlock(rcu);
+ * \endcode
+ */
+struct ao2_rcu_container;
+
+/*!
+ * \brief Allocate a read-copy-update container holder.
+ *
+ * \param initial First snapshot to publish.  Can be NULL.
+ *
+ * \note The holder takes its own reference to the snapshot.
+ *
+ * \return The holder, an ao2 object.
+ * \retval NULL on allocation failure.
+ */
+struct ao2_rcu_container *ao2_rcu_container_alloc(struct ao2_container *initial);
+
+/*!
+ * \brief Publish a new snapshot, replacing the current one.
+ *
+ * \param rcu The holder.
+ * \param snapshot Snapshot to publish.  Can be NULL.
+ *
+ * \note The holder takes its own reference to the snapshot.  This
+ * waits for readers of the replaced snapshot to finish, so it must not
+ * be called from an ao2_rcu_callback() callback on the same holder.
+ */
+void ao2_rcu_container_publish(struct ao2_rcu_container *rcu, struct ao2_container *snapshot);
+
+/*!
+ * \brief Get a reference to the current snapshot.
+ *
+ * \param rcu The holder.
+ *
+ * \return Reference to the current snapshot.
+ * \retval NULL if no snapshot has been published.
+ */
+struct ao2_container *ao2_rcu_container_ref(struct ao2_rcu_container *rcu) attribute_warn_unused_result;
+
+/*!
+ * \brief ao2_callback() on the current snapshot without locking.
+ *
+ * \param rcu The holder.
+ * \param flags search_flags to control the search.  OBJ_UNLINK is not
+ *        allowed since snapshots are immutable.
+ * \param cb_fn Comparison function.
+ * \param arg Argument passed to cb_fn.
+ *
+ * \note The callback runs while the snapshot is being read and must
+ * not publish to the same holder.
+ *
+ * \return Same as ao2_callback().
+ */
+void *ao2_rcu_callback(struct ao2_rcu_container *rcu, enum search_flags flags,
+	ao2_callback_fn *cb_fn, void *arg);
+
+/*!
+ * \brief ao2_find() on the current snapshot without locking.
+ *
+ * \param rcu The holder.
+ * \param arg Object or key to search for.
+ * \param flags search_flags to control the search.  OBJ_UNLINK is not
+ *        allowed since snapshots are immutable.
+ *
+ * \return Same as ao2_find().
+ */
+void *ao2_rcu_find(struct ao2_rcu_container *rcu, const void *arg, enum search_flags flags) attribute_warn_unused_result;
+
 /*!
  * \brief Print output.
  * \since 12.0.0
@@ -274,6 +274,18 @@ struct ast_bridge_methods {
 };
 
 /*! Softmix technology parameters. */
+/*!
+ * \brief Callback given every mix of all of the audio of a bridge
+ *
+ * \param frame The mix, signed linear at the mixing rate of the bridge
+ * \param data The data given when the tap was set
+ *
+ * \note Called by the mixing technology with the bridge locked, so it must
+ * hand the frame off rather than block.  The frame is only valid for the
+ * call.
+ */
+typedef void (*ast_bridge_mix_tap_fn)(struct ast_frame *frame, void *data);
+
 struct ast_bridge_softmix {
 	/*! The video mode softmix is using */
 	struct ast_bridge_video_mode video_mode;
@@ -304,6 +316,16 @@ struct ast_bridge_softmix {
 	 * \note If this value is 0, there is no maximum sample rate.
 	 */
 	unsigned int maximum_sample_rate;
+	/*!
+	 * \brief The maximum number of threads softmix may use to mix channels.
+	 *
+	 * \note If this value is 0 or 1, all mixing is done by a single thread.
+	 */
+	unsigned int mixing_threads;
+	/*! Given every mix of all of the audio, NULL if nothing taps the mix */
+	ast_bridge_mix_tap_fn mix_tap;
+	/*! The ao2 object given to mix_tap, the bridge holding a reference */
+	void *mix_tap_data;
 };
 
 AST_LIST_HEAD_NOLOCK(ast_bridge_channels_list, ast_bridge_channel);
@@ -974,6 +996,32 @@ void ast_bridge_set_maximum_sample_rate(struct ast_bridge *bridge, unsigned int
  */
 void ast_bridge_set_mixing_interval(struct ast_bridge *bridge, unsigned int mixing_interval);
 
+/*!
+ * \brief Adjust the maximum number of threads used to mix a bridge
+ * during multimix mode.
+ *
+ * \param bridge Bridge to change the number of mixing threads on.
+ * \param mixing_threads The maximum number of threads.  If 0 or 1 is set
+ * the bridge tech mixes using a single thread.
+ *
+ * \note The bridge tech only uses additional threads when a bridge has
+ * enough channels to make it worthwhile.
+ */
+void ast_bridge_set_mixing_threads(struct ast_bridge *bridge, unsigned int mixing_threads);
+
+/*!
+ * \brief Tap the mix of all of the audio of a multimix bridge
+ *
+ * \param bridge Bridge to tap.
+ * \param tap Given every mix, or NULL to stop tapping the mix.
+ * \param data ao2 object given to tap, the bridge holding a reference
+ * to it until the tap is replaced or the bridge is destroyed.
+ *
+ * \note Any earlier tap is replaced.  Once this returns the earlier tap
+ * is not called again.
+ */
+void ast_bridge_set_mix_tap(struct ast_bridge *bridge, ast_bridge_mix_tap_fn tap, void *data);
+
 /*!
  * \brief Activates the use of binaural signals in a conference bridge.
  *
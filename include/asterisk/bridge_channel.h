@@ -149,6 +149,8 @@ struct ast_bridge_channel {
 	AST_LIST_HEAD_NOLOCK(, ast_frame) deferred_queue;
 	/*! Pipe to alert thread when frames are put into the wr_queue. */
 	int alert_pipe[2];
+	/*! TRUE if alert_pipe is signaled for frames in the wr_queue. (Protected by bridge_channel lock) */
+	unsigned int wr_alerted:1;
 	/*!
 	 * \brief The bridge channel thread activity.
 	 *
@@ -403,6 +405,21 @@ void ast_bridge_channel_update_accountcodes(struct ast_bridge_channel *joining,
  */
 int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr);
 
+/*!
+ * \brief Write several frames to the specified bridge_channel.
+ *
+ * \details The bridge channel is locked and its thread woken once for
+ * all of them, rather than once for each frame.
+ *
+ * \param bridge_channel Channel to queue the frames.
+ * \param frames Frames to write, in order.
+ * \param count Number of frames.
+ *
+ * \retval 0 on success.
+ * \retval -1 if any of the frames could not be queued.
+ */
+int ast_bridge_channel_queue_frames(struct ast_bridge_channel *bridge_channel, struct ast_frame **frames, size_t count);
+
 /*!
  * \brief Queue a control frame onto the bridge channel with data.
  * \since 12.0.0
@@ -271,6 +271,7 @@ struct ast_cdr_config {
 		unsigned int size;				/*!< Size to trigger a batch */
 		struct ast_flags settings;		/*!< Settings for batches */
 	} batch_settings;
+	unsigned int backend_queue_size;	/*!< Most CDRs waiting for a backend, 0 to post them in place */
 };
 
 /*!
@@ -460,6 +461,17 @@ int ast_cdr_serialize_variables(const char *channel_name, struct ast_str **buf,
  */
 typedef int (*ast_cdrbe)(struct ast_cdr *cdr);
 
+/*!
+ * \brief CDR backend callback for several records at once
+ *
+ * \param cdrs The records, in the order they were posted
+ * \param count The number of records
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+typedef int (*ast_cdrbe_batch)(struct ast_cdr **cdrs, size_t count);
+
 /*! \brief Return TRUE if CDR subsystem is enabled */
 int ast_cdr_is_enabled(void);
 
@@ -485,6 +497,22 @@ struct stasis_message_router;
  */
 struct stasis_message_router *ast_cdr_message_router(void);
 
+/*!
+ * \brief Wait for the CDR engine to process the messages about a channel
+ *
+ * The CDR engine processes the messages of unrelated calls in parallel
+ * after routing them.  A handler added to the message router that reads
+ * or changes the CDRs of a channel must call this first for them to
+ * reflect the messages published before its own.
+ *
+ * \note This may only be called by a handler of the router returned by
+ * \ref ast_cdr_message_router.
+ *
+ * \param uniqueid The uniqueid of the channel, or NULL to wait for the
+ * messages about every channel
+ */
+void ast_cdr_message_router_sync(const char *uniqueid);
+
 /*!
  * \brief Duplicate a public CDR
  * \param cdr the record to duplicate
@@ -511,6 +539,22 @@ void ast_cdr_free(struct ast_cdr *cdr);
  */
 int ast_cdr_register(const char *name, const char *desc, ast_cdrbe be);
 
+/*!
+ * \brief Register a CDR handling engine that can store several records at once
+ * \param name name associated with the particular CDR handler
+ * \param desc description of the CDR handler
+ * \param be function pointer to a CDR handler
+ * \param be_batch function pointer to a handler of several CDRs
+ *
+ * Like ast_cdr_register(), except that when several records are waiting
+ * in the queue of the backend they are handed to \a be_batch together,
+ * so a database can insert them in one transaction.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error
+ */
+int ast_cdr_register_batch(const char *name, const char *desc, ast_cdrbe be, ast_cdrbe_batch be_batch);
+
 /*!
  * \brief Unregister a CDR handling engine
  * \param name name of CDR handler to unregister
@@ -226,6 +226,8 @@ struct ast_cel_general_config {
 	);
 	int enable;			/*!< Whether CEL is enabled */
 	int64_t events;			/*!< The events to be logged */
+	unsigned int batch_size;	/*!< The events to queue for a backend before posting them, 0 to post synchronously */
+	unsigned int batch_time;	/*!< The longest time events are queued for a backend, in milliseconds */
 	/*! The apps for which to log app start and end events. This is
 	 * ast_str_container_alloc()ed and filled with ao2-allocated
 	 * char* which are all-lowercase application names. */
@@ -309,6 +311,14 @@ struct ast_event *ast_cel_create_event_with_time(struct ast_channel_snapshot *sn
 /*typedef int (*ast_cel_backend_cb)(struct ast_cel_event_record *cel);*/
 typedef void (*ast_cel_backend_cb)(struct ast_event *event);
 
+/*!
+ * \brief CEL backend callback for several events at once
+ *
+ * \param events The events, oldest first
+ * \param count The number of events
+ */
+typedef void (*ast_cel_backend_batch_cb)(struct ast_event **events, size_t count);
+
 /*!
  * \brief Register a CEL backend
  *
@@ -321,6 +331,24 @@ typedef void (*ast_cel_backend_cb)(struct ast_event *event);
  */
 int ast_cel_backend_register(const char *name, ast_cel_backend_cb backend_callback);
 
+/*!
+ * \brief Register a CEL backend that can store several events at once
+ *
+ * \param name Name of backend to register
+ * \param backend_callback Callback to register
+ * \param batch_callback Callback for several events at once
+ *
+ * Like ast_cel_backend_register(), except that the events queued for
+ * the backend are handed to \a batch_callback together, up to the
+ * configured batch size at a time, so a database can insert them with
+ * one statement.
+ *
+ * \retval zero on success
+ * \retval non-zero on failure
+ */
+int ast_cel_backend_register_batch(const char *name, ast_cel_backend_cb backend_callback,
+	ast_cel_backend_batch_cb batch_callback);
+
 /*!
  * \brief Unregister a CEL backend
  *
@@ -1291,6 +1291,11 @@ struct ast_channel *__ast_dummy_channel_alloc(const char *file, int line, const
  *        freeing the memory associated with the frame(s) being passed if
  *        necessary.
  *
+ * \note Frames linked together through their frame_list entries are all
+ * queued with the channel locked once and a single wake up of the
+ * channel, so producers with several frames at hand should queue them
+ * together rather than one at a time.
+ *
  * \retval 0 success
  * \retval non-zero failure
  */
@@ -2010,6 +2015,24 @@ struct ast_channel *ast_waitfor_nandfds(struct ast_channel **c, int n,
  */
 struct ast_channel *ast_waitfor_n(struct ast_channel **chan, int n, int *ms);
 
+/*!
+ * \brief Waits for input on a group of channels, finding all with input
+ *
+ * Like ast_waitfor_n(), but rather than one channel with input, every
+ * channel with input when the wait ends is found.  Each of them is ready
+ * to be read, so a thread waiting on many channels can read them all
+ * after a single wait rather than waiting again for each.
+ *
+ * \param chan an array of pointers to channels
+ * \param n number of channels that are to be waited upon
+ * \param ms time "ms" is modified in-place, if applicable.  Set to -1 on error.
+ * \param ready array of at least n entries, filled with the index in chan
+ *        of each channel with input
+ *
+ * \return The number of channels with input, 0 if none has any
+ */
+int ast_waitfor_n_ready(struct ast_channel **chan, int n, int *ms, int *ready);
+
 /*!
  * \brief Waits for input on an fd
  * \note This version works on fd's only.  Be careful with it.
@@ -4167,6 +4190,16 @@ struct ast_pbx *ast_channel_pbx(const struct ast_channel *chan);
 void ast_channel_pbx_set(struct ast_channel *chan, struct ast_pbx *value);
 struct ast_sched_context *ast_channel_sched(const struct ast_channel *chan);
 void ast_channel_sched_set(struct ast_channel *chan, struct ast_sched_context *value);
+/*!
+ * \brief Get the scheduler context of a channel, creating it on first use
+ *
+ * Channels are created without a scheduler context as most never
+ * schedule anything on it.  ast_channel_sched() returns NULL until
+ * this is called.
+ *
+ * \retval NULL if the context could not be created
+ */
+struct ast_sched_context *ast_channel_sched_create(struct ast_channel *chan);
 struct ast_timer *ast_channel_timer(const struct ast_channel *chan);
 void ast_channel_timer_set(struct ast_channel *chan, struct ast_timer *value);
 struct ast_tone_zone *ast_channel_zone(const struct ast_channel *chan);
@@ -4251,6 +4284,10 @@ struct ast_hangup_handler_list *ast_channel_hangup_handlers(struct ast_channel *
 struct ast_datastore_list *ast_channel_datastores(struct ast_channel *chan);
 struct ast_autochan_list *ast_channel_autochans(struct ast_channel *chan);
 struct ast_readq_list *ast_channel_readq(struct ast_channel *chan);
+/* Read queue frame counts, kept by channel.c */
+unsigned int ast_channel_internal_readq_frames(const struct ast_channel *chan);
+unsigned int ast_channel_internal_readq_voice_frames(const struct ast_channel *chan);
+void ast_channel_internal_readq_frames_set(struct ast_channel *chan, unsigned int frames, unsigned int voice_frames);
 
 /* Typedef accessors */
 ast_group_t ast_channel_callgroup(const struct ast_channel *chan);
@@ -4270,6 +4307,7 @@ void ast_channel_named_pickupgroups_set(struct ast_channel *chan, struct ast_nam
 
 /* Alertpipe accessors--the "internal" functions for channel.c use only */
 int ast_channel_alert_write(struct ast_channel *chan);
+int ast_channel_internal_alert_write_count(struct ast_channel *chan, unsigned int count);
 int ast_channel_alert_writable(struct ast_channel *chan);
 ast_alert_status_t ast_channel_internal_alert_flush(struct ast_channel *chan);
 ast_alert_status_t ast_channel_internal_alert_read(struct ast_channel *chan);
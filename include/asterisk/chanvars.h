@@ -28,6 +28,8 @@
 struct ast_var_t {
 	AST_LIST_ENTRY(ast_var_t) entries;
 	char *value;
+	/*! Hash of the name, see ast_var_name_hash() */
+	unsigned int hash;
 	char name[0];
 };
 
@@ -44,6 +46,25 @@ const char *ast_var_name(const struct ast_var_t *var);
 const char *ast_var_full_name(const struct ast_var_t *var);
 const char *ast_var_value(const struct ast_var_t *var);
 char *ast_var_find(const struct varshead *head, const char *name);
+
+/*!
+ * \brief Hash a variable name, leaving out the inheritance underscores
+ *
+ * Variables keep the hash of their name, so lookups only compare the
+ * names of variables whose hash matches.  Lookups still walk the list,
+ * the hash only makes each step cheaper.
+ */
+unsigned int ast_var_name_hash(const char *name);
+
+/*!
+ * \brief Find a variable by its name without the inheritance underscores
+ *
+ * The list is walked in order, so the first variable found is the one
+ * which shadows any others of the same name.
+ *
+ * \return The first variable in the list with that name, NULL if there is none
+ */
+struct ast_var_t *ast_var_find_by_name(const struct varshead *head, const char *name);
 struct varshead *ast_var_list_clone(struct varshead *head);
 
 #define AST_VAR_LIST_TRAVERSE(head, var) AST_LIST_TRAVERSE(head, var, entries)
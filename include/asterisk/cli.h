@@ -371,6 +371,61 @@ char *ast_complete_channels(const char *line, const char *word, int pos, int sta
  */
 void ast_cli_print_timestr_fromseconds(int fd, int seconds, const char *prefix);
 
+struct ao2_container;
+
+/*!
+ * \brief One page of the objects in a container, for list commands
+ *
+ * The objects are taken from the container with a single pass under its
+ * lock and then sorted, so the container is not locked while the page is
+ * formatted and written out.  A page starts after a key, the cursor, which
+ * is the key of the last object on the page before it.
+ */
+struct ast_cli_page {
+	/*! The objects on the page in key order, each with a reference */
+	void **objects;
+	/*! How many objects are on the page */
+	size_t count;
+	/*! How many objects follow the page */
+	size_t remaining;
+};
+
+/*!
+ * \brief Take a page of the objects in a container
+ *
+ * \param page The page to fill in, release it with ast_cli_page_release()
+ * \param container The objects to take the page from
+ * \param key Gives the key of an object, what the page is sorted by
+ * \param after Only objects with a key after this are taken, NULL for all
+ * \param limit The most objects on the page, 0 for no limit
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+int ast_cli_page_take(struct ast_cli_page *page, struct ao2_container *container,
+	const char *(*key)(const void *obj), const char *after, size_t limit);
+
+/*!
+ * \brief Release the objects of a page taken by ast_cli_page_take()
+ */
+void ast_cli_page_release(struct ast_cli_page *page);
+
+/*!
+ * \brief Parse the paging arguments of a list command
+ *
+ * Arguments from \a pos on may be "limit <n>" and "after <key>", in either
+ * order.  Both are left alone if they are not given.
+ *
+ * \param a The arguments of the command
+ * \param pos Where the paging arguments start
+ * \param[out] limit The limit given
+ * \param[out] after The key given
+ *
+ * \retval 0 on success
+ * \retval -1 if the arguments are not paging arguments
+ */
+int ast_cli_page_args(struct ast_cli_args *a, int pos, size_t *limit, const char **after);
+
 /*!
  * \brief Allow a CLI command to be executed while Asterisk is shutting down.
  *
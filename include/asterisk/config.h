@@ -478,6 +478,21 @@ struct ast_variable *ast_load_realtime_all(const char *family, ...) attribute_se
  */
 int ast_unload_realtime(const char *family);
 
+/*!
+ * \brief Forget the cached realtime lookups of a family
+ *
+ * \param family The family, or NULL for every family
+ *
+ * \details
+ * Lookups of the families in the [realtime_cache] section of extconfig.conf
+ * are cached, and identical lookups in flight at the same time share one
+ * query to the backend.  Updating, storing or destroying realtime entries of
+ * a family through the realtime API forgets its cached lookups, but anything
+ * changing the backend directly has to call this for them to be seen before
+ * they expire.
+ */
+void ast_realtime_cache_invalidate(const char *family);
+
 /*!
  * \brief Inform realtime what fields that may be stored
  * \since 1.6.1
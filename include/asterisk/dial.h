@@ -226,6 +226,33 @@ void ast_dial_set_timeout(struct ast_dial *dial, int num, int timeout);
  */
 const char *ast_hangup_cause_to_dial_status(int hangup_cause);
 
+/*!
+ * \brief Callback for ast_dial_batch_start(), run once for each item of a batch
+ * \param data The data passed to ast_dial_batch_start()
+ * \param index Which item of the batch to originate, from 0
+ */
+typedef void (*ast_dial_batch_cb)(void *data, size_t index);
+
+/*!
+ * \brief Originate a batch of calls, at most a number of them per second
+ *
+ * The callback is run for each item of the batch in order, in threads of
+ * a pool shared by every batch, with the items spread evenly so that no
+ * more than \a cps of them are started a second.  Items not started yet
+ * when Asterisk shuts down are never run, so whatever they would have used
+ * must be released by the destructor of \a data.
+ *
+ * \param data An ao2 object passed to the callback, a reference is held until
+ *        every item has been run
+ * \param count How many items the batch has
+ * \param cps How many items to start a second, 0 for all of them at once
+ * \param callback Run for each item
+ *
+ * \retval 0 on success, the callback will be run \a count times
+ * \retval -1 on failure, the callback will not be run
+ */
+int ast_dial_batch_start(void *data, size_t count, unsigned int cps, ast_dial_batch_cb callback);
+
 #if defined(__cplusplus) || defined(c_plusplus)
 }
 #endif
@@ -323,4 +323,44 @@ int dns_parse_string(char *cur, uint8_t *size, char **val);
  */
 struct ast_dns_query *dns_query_alloc(const char *name, int rr_type, int rr_class, ast_dns_resolve_callback callback, void *data);
 
+/*!
+ * \brief Start resolution of a DNS query, from the cache if its resolver allows it
+ *
+ * \param query The DNS query
+ *
+ * \retval 0 success, the query's callback will be invoked when it completes
+ * \retval -1 failure
+ */
+int dns_cache_resolve(struct ast_dns_query *query);
+
+/*!
+ * \brief Cancel resolution of a DNS query started with dns_cache_resolve()
+ *
+ * \param query The DNS query
+ *
+ * \retval 0 success, the query's callback will not be invoked
+ * \retval -1 failure
+ */
+int dns_cache_cancel(struct ast_dns_query *query);
+
+/*!
+ * \brief Forget the answers cached from a resolver
+ *
+ * \param resolver The resolver
+ */
+void dns_cache_flush(struct ast_dns_resolver *resolver);
+
+/*!
+ * \brief Initialize the DNS cache
+ *
+ * \retval 0 success
+ * \retval -1 failure
+ */
+int dns_cache_init(void);
+
+/*!
+ * \brief Shut down the DNS cache
+ */
+void dns_cache_shutdown(void);
+
 #endif /* _ASTERISK_DNS_INTERNAL_H */
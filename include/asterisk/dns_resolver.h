@@ -47,6 +47,15 @@ struct ast_dns_resolver {
     /*! \brief Cancel resolution of a DNS query */
     int (*cancel)(struct ast_dns_query *query);
 
+    /*!
+     * \brief Whether the core caches answers from this resolver
+     *
+     * \note Set this for resolvers that do not cache answers themselves. Queries
+     *       for what is already being resolved then wait for that answer rather
+     *       than being passed to the resolver.
+     */
+    unsigned int cache;
+
     /*! \brief Linked list information */
     AST_RWLIST_ENTRY(ast_dns_resolver) next;
 };
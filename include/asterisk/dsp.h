@@ -145,6 +145,111 @@ int ast_dsp_silence_with_energy(struct ast_dsp *dsp, struct ast_frame *f, int *t
  */
 int ast_dsp_noise(struct ast_dsp *dsp, struct ast_frame *f, int *totalnoise);
 
+/*!
+ * \brief Voice activity of a frame read from a channel
+ *
+ * The shared voice activity analysis of a channel measures the energy of
+ * each voice frame read from it once, whatever the number of subscribers.
+ */
+struct ast_dsp_vad_result {
+	/*! Average absolute sample value of the frame, as ast_dsp_silence_with_energy() reports */
+	int energy;
+	/*! Number of samples in the frame */
+	int samples;
+	/*! Sample rate of the frame */
+	unsigned int sample_rate;
+};
+
+/*!
+ * \brief Callback receiving the voice activity of each frame read from a channel
+ *
+ * \note Called with the channel locked while the frame is being read.  The
+ * callback must not subscribe or unsubscribe.
+ */
+typedef void (*ast_dsp_vad_cb)(struct ast_channel *chan, const struct ast_dsp_vad_result *result, void *data);
+
+/*!
+ * \brief Subscribe to the shared voice activity analysis of a channel
+ *
+ * The first subscriber places an audiohook on the channel that measures
+ * the read voice frames for every subscriber.  The last one to unsubscribe
+ * removes it.
+ *
+ * \param chan The channel
+ * \param callback Called with the voice activity of each frame read
+ * \param data Passed to the callback
+ *
+ * \return The subscription identifier on success
+ * \retval -1 on failure
+ */
+int ast_dsp_vad_subscribe(struct ast_channel *chan, ast_dsp_vad_cb callback, void *data);
+
+/*!
+ * \brief Unsubscribe from the shared voice activity analysis of a channel
+ *
+ * \param chan The channel
+ * \param id The identifier ast_dsp_vad_subscribe() returned
+ */
+void ast_dsp_vad_unsubscribe(struct ast_channel *chan, int id);
+
+/*!
+ * \brief Process the voice activity of a frame for silence.
+ *
+ * Works like ast_dsp_silence() without measuring the frame again.
+ *
+ * \param dsp DSP processing audio media.
+ * \param result Voice activity of the frame.
+ * \param totalsilence Variable to set to the total accumulated silence in ms
+ * seen by the DSP since the last noise.
+ *
+ * \return Non-zero if the frame is silence.
+ */
+int ast_dsp_vad_silence(struct ast_dsp *dsp, const struct ast_dsp_vad_result *result, int *totalsilence);
+
+/*!
+ * \brief The latest voice activity of a channel read in a loop
+ *
+ * For consumers that read a channel themselves: subscribe with
+ * ast_dsp_vad_latest_cb() and this structure, then check each voice
+ * frame read with ast_dsp_silence_vad() or ast_dsp_noise_vad().
+ */
+struct ast_dsp_vad_latest {
+	/*! Voice activity of the last frame analyzed */
+	struct ast_dsp_vad_result result;
+	/*! Non-zero if the result has not been used yet */
+	int pending;
+};
+
+/*! \brief Subscription callback storing the result in a struct ast_dsp_vad_latest */
+void ast_dsp_vad_latest_cb(struct ast_channel *chan, const struct ast_dsp_vad_result *result, void *data);
+
+/*!
+ * \brief Process an audio frame for silence, using the shared analysis if it has one
+ *
+ * Works like ast_dsp_silence_with_energy(), except that the pending result
+ * of the shared analysis is used instead of measuring the frame when it
+ * covers as much audio.  The frame is measured otherwise.
+ *
+ * \param dsp DSP processing audio media.
+ * \param latest The latest voice activity of the channel the frame was read from.
+ * \param f Audio frame to process.
+ * \param totalsilence Variable to set to the total accumulated silence in ms
+ * seen by the DSP since the last noise.
+ * \param frames_energy Variable to set to the average energy of the samples in the frame.
+ *
+ * \return Non-zero if the frame is silence.
+ */
+int ast_dsp_silence_vad(struct ast_dsp *dsp, struct ast_dsp_vad_latest *latest, struct ast_frame *f, int *totalsilence, int *frames_energy);
+
+/*!
+ * \brief Process an audio frame for noise, using the shared analysis if it has one
+ *
+ * \see ast_dsp_silence_vad()
+ *
+ * \return Non-zero if the frame is silence.
+ */
+int ast_dsp_noise_vad(struct ast_dsp *dsp, struct ast_dsp_vad_latest *latest, struct ast_frame *f, int *totalnoise);
+
 /*! \brief Return non-zero if historically this should be a busy, request that
   ast_dsp_silence has already been called */
 int ast_dsp_busydetect(struct ast_dsp *dsp);
@@ -197,4 +302,9 @@ int ast_dsp_get_tcount(struct ast_dsp *dsp);
  */
 int ast_dsp_get_threshold_from_settings(enum threshold which);
 
+/*!
+ * \brief Get the name of the goertzel implementation the tone detectors use
+ */
+const char *ast_dsp_goertzel_implementation(void);
+
 #endif /* _ASTERISK_DSP_H */
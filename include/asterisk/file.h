@@ -288,6 +288,19 @@ int ast_waitstream_full(struct ast_channel *c, const char *breakon, int audiofd,
  */
 struct ast_filestream *ast_readfile(const char *filename, const char *type, const char *comment, int flags, int check, mode_t mode);
 
+/*!
+ * \brief Opens a sound file for reading in whichever format it exists in
+ * \param filename the name of the file to read from, without extension
+ * \param preflang the preferred language, NULL for none
+ *
+ * Finds the file as ast_openstream() does, but not for a channel, so the
+ * frames read are in the format of the file, the best one it exists in.
+ *
+ * \return a struct ast_filestream on success.
+ * \retval NULL on failure.
+ */
+struct ast_filestream *ast_readfile_any(const char *filename, const char *preflang);
+
 /*!
  * \brief Starts writing a file
  * \param filename the name of the file to write to
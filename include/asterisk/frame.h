@@ -235,6 +235,10 @@ extern struct ast_frame ast_null_frame;
 #define AST_MALLOCD_DATA	(1 << 1)
 /*! Need the source be free'd? (haha!) */
 #define AST_MALLOCD_SRC		(1 << 2)
+/*! Is the data a reference counted payload shared with other frames? */
+#define AST_MALLOCD_SHARED	(1 << 3)
+/*! Was the malloc'd data allocated by the frame cache? (only set along with AST_MALLOCD_DATA) */
+#define AST_MALLOCD_DATA_CACHED	(1 << 4)
 
 /* MODEM subclasses */
 /*! T.38 Fax-over-IP */
@@ -590,6 +594,82 @@ struct ast_frame *__ast_frisolate(struct ast_frame *fr, const char *file, int li
 #define ast_frdup(fr) __ast_frdup(fr, __FILE__, __LINE__, __PRETTY_FUNCTION__)
 struct ast_frame *__ast_frdup(const struct ast_frame *fr, const char *file, int line, const char *func);
 
+/*! \brief Copies a frame into one whose payload can be shared
+ * \param fr frame to copy
+ * Duplicates a frame, placing the data in a reference counted payload.
+ * Frames made from the copy with ast_frshare() reference the same payload
+ * rather than copying it.  Use this when the same frame is about to be
+ * handed to several consumers.
+ * \return Returns a frame on success, NULL on error
+ * \note A shared payload must not be modified.  Anything that changes the
+ * data of a frame it did not create must call ast_frame_make_writable()
+ * first.
+ */
+#define ast_frdup_shared(fr) __ast_frdup_shared(fr, __FILE__, __LINE__, __PRETTY_FUNCTION__)
+struct ast_frame *__ast_frdup_shared(const struct ast_frame *fr, const char *file, int line, const char *func);
+
+/*! \brief Copies a frame, sharing its payload when possible
+ * \param fr frame to copy
+ * If the data of the frame is a shared payload only the frame header is
+ * copied and the new frame references the same payload.  Otherwise this is
+ * the same as ast_frdup().
+ * \return Returns a frame on success, NULL on error
+ */
+#define ast_frshare(fr) __ast_frshare(fr, __FILE__, __LINE__, __PRETTY_FUNCTION__)
+struct ast_frame *__ast_frshare(const struct ast_frame *fr, const char *file, int line, const char *func);
+
+/*! \brief Determine if the data of a frame is also used by other frames
+ * \param fr frame to check
+ * \retval 0 if the data may be modified
+ * \retval non-zero if the data is shared with other frames
+ */
+int ast_frame_is_shared(const struct ast_frame *fr);
+
+/*! \brief Makes the data of a frame safe to modify
+ * \param fr frame to act upon
+ * If the data of the frame is shared with other frames it is replaced by
+ * a private copy.
+ * \retval 0 on success
+ * \retval -1 on error, the frame is left unchanged
+ */
+int ast_frame_make_writable(struct ast_frame *fr);
+
+/*! \brief Number of size classes in each per-thread frame cache */
+#define AST_FRAME_CACHE_CLASSES 5
+
+/*! \brief Statistics of one size class of the per-thread frame caches */
+struct ast_frame_cache_class_stats {
+	/*! Bytes allocated for each object in the size class */
+	size_t size;
+	/*! Allocations taken from a cache */
+	uint64_t hits;
+	/*! Allocations made because the cache was empty */
+	uint64_t misses;
+	/*! Frees made because the cache was full */
+	uint64_t overflows;
+	/*! Objects currently cached */
+	uint64_t cached;
+};
+
+/*! \brief Statistics of the per-thread frame caches of all threads */
+struct ast_frame_cache_stats {
+	/*! Frame headers, including any data allocated along with them */
+	struct ast_frame_cache_class_stats frames[AST_FRAME_CACHE_CLASSES];
+	/*! Data buffers malloc'd separately from their frame */
+	struct ast_frame_cache_class_stats data[AST_FRAME_CACHE_CLASSES];
+	/*! Number of threads with a frame cache */
+	unsigned int threads;
+};
+
+/*!
+ * \brief Get the statistics of the per-thread frame caches
+ *
+ * \param[out] stats Filled with the totals of all threads, including ones
+ * that have exited.  The statistics are all zero if Asterisk was built
+ * without the frame cache.
+ */
+void ast_frame_cache_stats_get(struct ast_frame_cache_stats *stats);
+
 void ast_swapcopy_samples(void *dst, const void *src, int samples);
 
 /* Helpers for byteswapping native samples to/from
@@ -203,6 +203,48 @@ void ast_http_send(struct ast_tcptls_session_instance *ser, enum ast_http_method
 	int status_code, const char *status_title, struct ast_str *http_header,
 	struct ast_str *out, int fd, unsigned int static_content);
 
+/*!
+ * \brief Start a response whose body is sent in chunks as it is produced
+ *
+ * Use this instead of ast_http_send() when the body is too large to build
+ * up in memory first.  The body follows with ast_http_send_chunk() and is
+ * ended by ast_http_send_chunked_end().
+ *
+ * \param ser TCP/TLS session object
+ * \param method GET/POST/HEAD
+ * \param status_code HTTP response code (200/401/403/404/500)
+ * \param status_title English equivalent to the status_code parameter
+ * \param http_header An ast_str object containing all headers, freed by this function
+ * \param static_content Zero if the content is dynamically generated and should not be cached; nonzero otherwise
+ *
+ * \retval 0 The body is to follow
+ * \retval -1 No body is to follow, because the request was a HEAD or the
+ *            connection failed.  The response is complete.
+ */
+int ast_http_send_chunked_start(struct ast_tcptls_session_instance *ser,
+	enum ast_http_method method, int status_code, const char *status_title,
+	struct ast_str *http_header, unsigned int static_content);
+
+/*!
+ * \brief Send part of the body of a response started by ast_http_send_chunked_start()
+ *
+ * \param ser TCP/TLS session object
+ * \param data The part of the body
+ * \param len The length of the part, which may be 0
+ *
+ * \retval 0 Success
+ * \retval -1 The connection failed.  Nothing more should be sent but
+ *            ast_http_send_chunked_end() must still be called.
+ */
+int ast_http_send_chunk(struct ast_tcptls_session_instance *ser, const char *data, size_t len);
+
+/*!
+ * \brief End the body of a response started by ast_http_send_chunked_start()
+ *
+ * \param ser TCP/TLS session object
+ */
+void ast_http_send_chunked_end(struct ast_tcptls_session_instance *ser);
+
 /*!
  * \brief Creates and sends a formatted http response message.
  * \param ser                   TCP/TLS session object
@@ -141,6 +141,16 @@ int ast_iostream_get_fd(struct ast_iostream *stream);
  */
 int ast_iostream_wait_for_input(struct ast_iostream *stream, int timeout);
 
+/*!
+ * \brief Get the number of bytes read from the file descriptor but not consumed
+ *
+ * \param stream A pointer to an iostream
+ *
+ * \return The number of bytes that can be read without waiting for the
+ * file descriptor, including those buffered inside OpenSSL
+ */
+size_t ast_iostream_get_buffered(struct ast_iostream *stream);
+
 /*!
  * \brief Make an iostream non-blocking.
  *
@@ -217,6 +227,25 @@ ssize_t ast_iostream_discard(struct ast_iostream *stream, size_t count);
  */
 ssize_t ast_iostream_write(struct ast_iostream *stream, const void *buffer, size_t count);
 
+struct iovec;
+
+/*!
+ * \brief Write data from several buffers to an iostream.
+ *
+ * Works like ast_iostream_write() on the buffers one after the other, but
+ * writes them with as few system calls as possible when the iostream is
+ * not encrypted.
+ *
+ * \param stream A pointer to an iostream
+ * \param iov The buffers to write.
+ * \param iovcnt The number of buffers, at most 16.
+ *
+ * \return Upon successful completion, returns the number of bytes actually
+ *         written to the iostream. Otherwise, returns \c -1 and may set
+ *         \c errno to indicate the error.
+ */
+ssize_t ast_iostream_writev(struct ast_iostream *stream, const struct iovec *iov, int iovcnt);
+
 /*!
  * \brief Write a formatted string to an iostream.
  *
@@ -877,6 +877,139 @@ int ast_json_dump_file_format(struct ast_json *root, FILE *output, enum ast_json
  */
 int ast_json_dump_new_file_format(struct ast_json *root, const char *path, enum ast_json_encoding_format format);
 
+/*!
+ * \brief How deep the objects and arrays written by an \ref ast_json_writer may nest
+ */
+#define AST_JSON_WRITER_MAX_DEPTH 32
+
+/*!
+ * \brief Writes compact JSON text straight into an \ref ast_str.
+ *
+ * Building a tree of \ref ast_json values only to encode it allocates every
+ * value of the tree.  Code that encodes the same kinds of objects over and
+ * over can instead write them with a writer, into a buffer it reuses.  The
+ * text written is what ast_json_dump_str() would have encoded for the same
+ * values.
+ *
+ * Writing stops at the first error, such as a string that is not UTF-8,
+ * running out of memory, or a value written where it does not belong, and
+ * ast_json_writer_finish() reports it.
+ */
+struct ast_json_writer {
+	/*! \brief The buffer the text is appended to */
+	struct ast_str **buf;
+	/*! \brief How many objects and arrays are open */
+	unsigned int depth;
+	/*! \brief Bit n is set if the container open at depth n + 1 is an object */
+	unsigned int objects;
+	/*! \brief Bit n is set if the container open at depth n + 1 has a member */
+	unsigned int members;
+	/*! \brief A key was written and its value has not been yet */
+	unsigned int key:1;
+	/*! \brief A complete value has been written at the top level */
+	unsigned int done:1;
+	/*! \brief Writing failed */
+	unsigned int error:1;
+};
+
+/*!
+ * \brief Start writing a JSON value.
+ *
+ * \param writer The writer.
+ * \param buf The buffer to append the text to.  It is grown as needed.
+ */
+void ast_json_writer_init(struct ast_json_writer *writer, struct ast_str **buf);
+
+/*!
+ * \brief Check that a complete JSON value was written.
+ *
+ * \param writer The writer.
+ * \retval 0 if a complete value was written.
+ * \retval -1 on error.  The contents of the buffer are undefined.
+ */
+int ast_json_writer_finish(struct ast_json_writer *writer);
+
+/*!
+ * \brief Start an object.
+ * \param writer The writer.
+ */
+void ast_json_writer_object_start(struct ast_json_writer *writer);
+
+/*!
+ * \brief End the object started last.
+ * \param writer The writer.
+ */
+void ast_json_writer_object_end(struct ast_json_writer *writer);
+
+/*!
+ * \brief Start an array.
+ * \param writer The writer.
+ */
+void ast_json_writer_array_start(struct ast_json_writer *writer);
+
+/*!
+ * \brief End the array started last.
+ * \param writer The writer.
+ */
+void ast_json_writer_array_end(struct ast_json_writer *writer);
+
+/*!
+ * \brief Write the key of the next member of an object.
+ * \param writer The writer.
+ * \param key The key, UTF-8 encoded.
+ */
+void ast_json_writer_key(struct ast_json_writer *writer, const char *key);
+
+/*!
+ * \brief Write a string.
+ * \param writer The writer.
+ * \param value The string, UTF-8 encoded.  Written as null if \c NULL.
+ */
+void ast_json_writer_string(struct ast_json_writer *writer, const char *value);
+
+/*!
+ * \brief Write an integer.
+ * \param writer The writer.
+ * \param value The integer.
+ */
+void ast_json_writer_integer(struct ast_json_writer *writer, intmax_t value);
+
+/*!
+ * \brief Write true or false.
+ * \param writer The writer.
+ * \param value Non-zero for true.
+ */
+void ast_json_writer_boolean(struct ast_json_writer *writer, int value);
+
+/*!
+ * \brief Write null.
+ * \param writer The writer.
+ */
+void ast_json_writer_null(struct ast_json_writer *writer);
+
+/*!
+ * \brief Write a timeval the way ast_json_timeval() encodes it.
+ * \param writer The writer.
+ * \param tv The timeval.
+ * \param zone Text string of a standard system zoneinfo file.  If NULL, the system localtime will be used.
+ */
+void ast_json_writer_timeval(struct ast_json_writer *writer, const struct timeval tv, const char *zone);
+
+/*!
+ * \brief Write a JSON value that has already been built.
+ * \param writer The writer.
+ * \param value The value.  It is an error if it is \c NULL.
+ */
+void ast_json_writer_json(struct ast_json_writer *writer, struct ast_json *value);
+
+/*!
+ * \brief Write a member of an object whose value is a string.
+ * \param writer The writer.
+ * \param key The key, UTF-8 encoded.
+ * \param value The string, UTF-8 encoded.  Written as null if \c NULL.
+ */
+void ast_json_writer_member_string(struct ast_json_writer *writer, const char *key, const char *value);
+
 #define AST_JSON_ERROR_TEXT_LENGTH    160
 #define AST_JSON_ERROR_SOURCE_LENGTH   80
 
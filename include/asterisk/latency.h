@@ -0,0 +1,169 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Latency histograms
+ *
+ * Hot paths measure how long something took with ast_latency_start() and
+ * ast_latency_end().  Nothing is measured unless latency_histograms is
+ * enabled in asterisk.conf, and when it is a measurement costs two reads
+ * of the monotonic clock and two relaxed atomic additions.
+ *
+ * Latencies are counted in buckets whose width grows with the latency,
+ * each power of two of nanoseconds being split into 8, so any latency is
+ * known to within 12.5%.  Each histogram is split into shards that
+ * threads are spread over, so that threads measuring the same thing do
+ * not contend for the same cache lines.
+ */
+
+#ifndef _ASTERISK_LATENCY_H
+#define _ASTERISK_LATENCY_H
+
+#include <time.h>
+
+#include "asterisk/options.h"
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+/*! \brief The number of buckets of a latency histogram */
+#define AST_LATENCY_BUCKETS 312
+
+/*! \brief A latency histogram */
+struct ast_latency_histogram;
+
+/*! \brief The counts of a latency histogram, summed over its shards */
+struct ast_latency_snapshot {
+	/*! \brief The name of the histogram */
+	const char *name;
+	/*! \brief What the histogram measures */
+	const char *description;
+	/*! \brief How many latencies were recorded */
+	uint64_t count;
+	/*! \brief The sum of the latencies, in nanoseconds */
+	uint64_t sum;
+	/*! \brief How many latencies fell in each bucket */
+	uint64_t buckets[AST_LATENCY_BUCKETS];
+};
+
+/*!
+ * \brief Get a latency histogram, creating it if it does not exist yet
+ *
+ * Histograms live until Asterisk shuts down, so a module can keep what
+ * this returns for as long as it is loaded and get the same histogram
+ * back when it is loaded again.
+ *
+ * \param name The name of the histogram
+ * \param description What the histogram measures
+ *
+ * \return The histogram
+ * \retval NULL on failure
+ */
+struct ast_latency_histogram *ast_latency_histogram_get(const char *name, const char *description);
+
+/*!
+ * \brief The monotonic clock, in nanoseconds
+ */
+static force_inline uint64_t ast_latency_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*!
+ * \brief Start measuring a latency
+ *
+ * \retval 0 if latency histograms are disabled
+ * \return When the latency started otherwise, to pass to ast_latency_end()
+ */
+static force_inline uint64_t ast_latency_start(void)
+{
+	return ast_option_latency_histograms ? ast_latency_now() : 0;
+}
+
+/*!
+ * \brief Record a latency
+ *
+ * \param histogram The histogram to record it in, may be NULL
+ * \param ns The latency, in nanoseconds
+ */
+void ast_latency_record(struct ast_latency_histogram *histogram, uint64_t ns);
+
+/*!
+ * \brief Record the latency since ast_latency_start()
+ *
+ * Does nothing if latency histograms were disabled when it was started.
+ *
+ * \param histogram The histogram to record it in, may be NULL
+ * \param start What ast_latency_start() returned
+ */
+static force_inline void ast_latency_end(struct ast_latency_histogram *histogram, uint64_t start)
+{
+	if (start) {
+		ast_latency_record(histogram, ast_latency_now() - start);
+	}
+}
+
+/*!
+ * \brief Count the latencies of a snapshot at or below a bound
+ *
+ * \note Latencies are only known to within their bucket, so those in the
+ * bucket the bound falls in are counted if the bucket starts at or below
+ * it.
+ *
+ * \param snapshot The snapshot
+ * \param ns The bound, in nanoseconds
+ *
+ * \return The number of latencies
+ */
+uint64_t ast_latency_snapshot_count_le(const struct ast_latency_snapshot *snapshot, uint64_t ns);
+
+/*!
+ * \brief Find a percentile of the latencies of a snapshot
+ *
+ * \param snapshot The snapshot
+ * \param percentile The percentile, from 0 to 100
+ *
+ * \return The highest latency of the bucket the percentile falls in, in nanoseconds
+ * \retval 0 if the snapshot is empty
+ */
+uint64_t ast_latency_snapshot_percentile(const struct ast_latency_snapshot *snapshot, double percentile);
+
+/*!
+ * \brief Callback for ast_latency_histograms_snapshot()
+ *
+ * \param snapshot A snapshot of a histogram, only valid during the callback
+ * \param data The data passed to ast_latency_histograms_snapshot()
+ */
+typedef void (*ast_latency_snapshot_cb)(const struct ast_latency_snapshot *snapshot, void *data);
+
+/*!
+ * \brief Take a snapshot of every latency histogram, in the order they were created
+ *
+ * \param callback Called with each snapshot
+ * \param data Passed to the callback
+ */
+void ast_latency_histograms_snapshot(ast_latency_snapshot_cb callback, void *data);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif /* _ASTERISK_LATENCY_H */
@@ -642,6 +642,57 @@ static void  __attribute__((destructor)) fini_##rwlock(void) \
 #define pthread_create __use_ast_pthread_create_instead__
 #endif
 
+/*!
+ * \brief How long, in microseconds, taking a lock must block for to be recorded
+ *
+ * 0 disables recording contention.  Set from lock_contention_threshold in
+ * asterisk.conf.
+ */
+extern unsigned int ast_lock_contention_threshold;
+
+/*!
+ * \brief Where locks were contended
+ */
+struct ast_lock_contention {
+	/*! \brief The file the lock was taken in */
+	const char *file;
+	/*! \brief The line the lock was taken on */
+	int line;
+	/*! \brief The function the lock was taken in */
+	const char *func;
+	/*! \brief The name of the lock */
+	const char *name;
+	/*! \brief How many times taking the lock here blocked for longer than the threshold */
+	uint64_t count;
+	/*! \brief How long those times blocked for in total, in ns */
+	uint64_t total;
+	/*! \brief The longest one of those times blocked for, in ns */
+	uint64_t max;
+};
+
+/*!
+ * \brief Callback for ast_lock_contention_foreach()
+ *
+ * \param contention Where a lock was contended, only valid during the callback
+ * \param data The data passed to ast_lock_contention_foreach()
+ */
+typedef void (*ast_lock_contention_cb)(const struct ast_lock_contention *contention, void *data);
+
+/*!
+ * \brief Get where locks were contended, from where they blocked longest in total
+ *
+ * \param callback Called for each place a lock was contended
+ * \param data Passed to the callback
+ *
+ * \return The number of contentions that were not recorded for lack of room
+ */
+uint64_t ast_lock_contention_foreach(ast_lock_contention_cb callback, void *data);
+
+/*!
+ * \brief Forget where locks were contended
+ */
+void ast_lock_contention_reset(void);
+
 /*!
  * \brief Support for atomic instructions.
  *
@@ -685,6 +736,11 @@ static void  __attribute__((destructor)) fini_##rwlock(void) \
 #define ast_atomic_fetch_xor(ptr, val, memorder)  __atomic_fetch_xor((ptr), (val), (memorder))
 #define ast_atomic_xor_fetch(ptr, val, memorder)  __atomic_xor_fetch((ptr), (val), (memorder))
 
+/*! Atomic load, store and exchange */
+#define ast_atomic_load_n(ptr, memorder)              __atomic_load_n((ptr), (memorder))
+#define ast_atomic_store_n(ptr, val, memorder)        __atomic_store_n((ptr), (val), (memorder))
+#define ast_atomic_exchange_n(ptr, val, memorder)     __atomic_exchange_n((ptr), (val), (memorder))
+
 #if 0
 /* Atomic compare and swap
  *
@@ -718,6 +774,19 @@ static void  __attribute__((destructor)) fini_##rwlock(void) \
 #define ast_atomic_fetch_xor(ptr, val, memorder)  __sync_fetch_and_xor((ptr), (val))
 #define ast_atomic_xor_fetch(ptr, val, memorder)  __sync_xor_and_fetch((ptr), (val))
 
+/*!
+ * Atomic load, store and exchange
+ *
+ * \note __sync_lock_test_and_set() is only an acquire barrier so a full
+ *       barrier is issued first to match the __atomic sequentially
+ *       consistent behavior.
+ */
+#define ast_atomic_load_n(ptr, memorder)  __sync_fetch_and_add((ptr), 0)
+#define ast_atomic_store_n(ptr, val, memorder) \
+	({ __sync_synchronize(); (void) __sync_lock_test_and_set((ptr), (val)); })
+#define ast_atomic_exchange_n(ptr, val, memorder) \
+	({ __sync_synchronize(); __sync_lock_test_and_set((ptr), (val)); })
+
 #if 0
 /* Atomic compare and swap
  *
@@ -0,0 +1,129 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Layout of the files written by binary log channels
+ *
+ * A binary log channel writes to a ring of files of a fixed size.  Each
+ * file starts with a header followed by records, each aligned to
+ * AST_LOG_BINARY_ALIGNMENT bytes.  Only the first \c used bytes after the
+ * header hold records; the rest is left over from the previous time the
+ * file was written.  Numbers are in the byte order of the host that
+ * wrote the file.
+ *
+ * Level names and message locations are written once per file, the first
+ * time a message refers to them, so every file can be decoded on its own.
+ * The files of a ring are put in order by the sequence in their headers.
+ *
+ * utils/astlogdecode turns the files back into text.
+ */
+
+#ifndef _ASTERISK_LOGGER_BINARY_H
+#define _ASTERISK_LOGGER_BINARY_H
+
+#include <stdint.h>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+#define AST_LOG_BINARY_MAGIC "AstBLog"
+#define AST_LOG_BINARY_VERSION 1
+
+/*! \brief Records start at multiples of this many bytes */
+#define AST_LOG_BINARY_ALIGNMENT 8
+#define AST_LOG_BINARY_ALIGN(length) \
+	(((length) + AST_LOG_BINARY_ALIGNMENT - 1) & ~(AST_LOG_BINARY_ALIGNMENT - 1))
+
+/*! \brief The start of every file */
+struct ast_log_binary_header {
+	/*! AST_LOG_BINARY_MAGIC, NUL terminated */
+	char magic[8];
+	/*! AST_LOG_BINARY_VERSION */
+	uint32_t version;
+	/*! Where the records start */
+	uint32_t header_size;
+	/*! Incremented every time the writer moves on to another file of the ring */
+	uint64_t sequence;
+	/*! The size of the file */
+	uint32_t size;
+	/*! How many bytes of records follow the header */
+	uint32_t used;
+};
+
+enum ast_log_binary_record_type {
+	/*! struct ast_log_binary_level */
+	AST_LOG_BINARY_LEVEL = 1,
+	/*! struct ast_log_binary_location */
+	AST_LOG_BINARY_LOCATION,
+	/*! struct ast_log_binary_message */
+	AST_LOG_BINARY_MESSAGE,
+};
+
+/*! \brief The start of every record */
+struct ast_log_binary_record {
+	/*! The length of the record, padding included */
+	uint32_t length;
+	/*! enum ast_log_binary_record_type */
+	uint32_t type;
+};
+
+/*! \brief The name of a log level */
+struct ast_log_binary_level {
+	struct ast_log_binary_record record;
+	uint32_t level;
+	uint32_t name_length;
+	/*! The name, not NUL terminated */
+	char name[0];
+};
+
+/*! \brief Where in the source messages were logged */
+struct ast_log_binary_location {
+	struct ast_log_binary_record record;
+	/*! Messages refer to the location by this id, unique within the file */
+	uint32_t id;
+	int32_t line;
+	uint32_t file_length;
+	uint32_t function_length;
+	/*! The file name followed by the function name, neither NUL terminated */
+	char strings[0];
+};
+
+/*! \brief A log message */
+struct ast_log_binary_message {
+	struct ast_log_binary_record record;
+	/*! When the message was logged, in microseconds since the epoch */
+	uint64_t time;
+	/*! The id of the location that logged the message */
+	uint32_t location;
+	/*! The thread that logged the message */
+	int32_t lwp;
+	/*! The call id, 0 if none */
+	uint32_t callid;
+	uint32_t level;
+	/*! The verbosity of verbose messages */
+	int32_t sublevel;
+	uint32_t message_length;
+	/*! The message, not NUL terminated */
+	char message[0];
+};
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif /* _ASTERISK_LOGGER_BINARY_H */
@@ -181,6 +181,8 @@ struct manager_action {
 	 * function and unregistering the AMI action object.
 	 */
 	unsigned int registered:1;
+	/*! TRUE if the XML documentation is built when first shown. */
+	unsigned int docs_pending:1;
 };
 
 /*! \brief External routines may register/unregister manager callbacks this way
@@ -350,6 +352,23 @@ void astman_send_list_complete_start(struct mansession *s, const struct message
  */
 void astman_send_list_complete_end(struct mansession *s);
 
+/*!
+ * \brief Get the page of a list an action asks for
+ *
+ * \param s - AMI session control struct.
+ * \param m - AMI action request that started the list.
+ * \param[out] limit - The most items to list, from the Limit header, 0 for all.
+ * \param[out] after - List the items after this key, from the After header,
+ * NULL if there is none.
+ *
+ * \note A paged list should add a Remaining header, with how many items
+ * follow the page, to its list completion event.
+ *
+ * \retval 0 on success
+ * \retval -1 if the Limit header is not a number, an error has been sent
+ */
+int astman_get_list_page(struct mansession *s, const struct message *m, size_t *limit, const char **after);
+
 /*!
  * \brief Enable/disable the inclusion of 'dangerous' configurations outside
  * of the ast_config_AST_CONFIG_DIR
@@ -78,6 +78,22 @@ int ast_media_cache_exists(const char *uri);
 int ast_media_cache_retrieve(const char *uri, const char *preferred_file_name,
 	char *file_path, size_t len);
 
+/*!
+ * \brief Start retrieving an item into the cache in the background
+ *
+ * \param uri The unique URI for the media item
+ *
+ * \retval 0 The retrieval was queued
+ * \retval -1 The retrieval could not be queued
+ *
+ * \details
+ * Use this when an item is known to be played soon, such as the later
+ * files of a list being played, so it is fetched while the earlier ones
+ * play.  A later ast_media_cache_retrieve() of the same URI waits for the
+ * retrieval in progress rather than fetching the item again.
+ */
+int ast_media_cache_prefetch(const char *uri);
+
 /*!
  * \brief Retrieve metadata from an item in the cache
  *
@@ -91,6 +91,13 @@ struct ast_format_def {
 	int desc_size;			/*!< size of private descriptor, if any */
 
 	struct ast_module *module;
+
+	/*!
+	 * Set if the handler reads and seeks only with ast_filestream_read(),
+	 * ast_filestream_tell_bytes() and ast_filestream_seek_bytes(), and never
+	 * modifies the data read, so files it plays may be memory mapped.
+	 */
+	unsigned int mappable:1;
 };
 
 /*! \brief
@@ -124,6 +131,13 @@ struct ast_filestream {
 	void *_private;	/*!< pointer to private buffer */
 	const char *orig_chan_name;
 	char *write_buffer;
+	/*! The prompt cache entry f reads from, if the file came from the cache */
+	void *cached;
+	/*! The file mapped into memory, read in place of f, if the format is mappable */
+	const char *map;
+	size_t map_size;
+	/*! The position in map of the next read */
+	off_t map_pos;
 };
 
 /*!
@@ -144,6 +158,31 @@ int __ast_format_def_register(const struct ast_format_def *f, struct ast_module
  */
 int ast_format_def_unregister(const char *name);
 
+/*!
+ * \brief Read the next bytes of a file into the frame of its stream
+ * \param fs the stream read from
+ * \param len the number of bytes wanted
+ *
+ * Points fs->fr at the bytes read, setting its data, offset and datalen.
+ * When the file is mapped the frame refers to the mapped file rather than
+ * to a copy in fs->buf, so the data must not be modified.
+ *
+ * \return the number of bytes read, 0 at the end of the file
+ */
+size_t ast_filestream_read(struct ast_filestream *fs, size_t len);
+
+/*!
+ * \brief The position in bytes of the next read from a file, like ftello()
+ */
+off_t ast_filestream_tell_bytes(struct ast_filestream *fs);
+
+/*!
+ * \brief Move the position of the next read from a file, like fseeko()
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+int ast_filestream_seek_bytes(struct ast_filestream *fs, off_t offset, int whence);
+
 #if defined(__cplusplus) || defined(c_plusplus)
 }
 #endif
@@ -92,6 +92,25 @@ struct ast_named_lock *__ast_named_lock_get(const char *filename, int lineno, co
  */
 #define ast_named_lock_put(lock) ao2_cleanup(lock)
 
+/*!
+ * \brief Get a named lock handle shared with other names
+ *
+ * Like ast_named_lock_get, but the lock is one of a fixed table of locks
+ * which all names are hashed over.  Getting it neither allocates anything
+ * nor searches a container, but other names share the lock.  Only use it
+ * where holding the lock of an unrelated name too is harmless, which is
+ * the case where no more than one name of the keyspace is locked at once.
+ *
+ * \param lock_type One of ast_named_lock_type
+ * \param keyspace
+ * \param key
+ * \retval A pointer to an ast_named_lock structure, put away by ast_named_lock_put
+ *
+ * \note Every caller locking a name must get its lock the same way.
+ */
+struct ast_named_lock *ast_named_lock_get_striped(enum ast_named_lock_type lock_type,
+	const char *keyspace, const char *key);
+
 /*!
  * @}
  */
@@ -698,6 +698,16 @@ int ast_connect(int sockfd, const struct ast_sockaddr *addr);
  */
 int ast_getsockname(int sockfd, struct ast_sockaddr *addr);
 
+/*!
+ * \brief
+ * Wrapper around getpeername(2) that uses struct ast_sockaddr.
+ *
+ * \details
+ * For parameter and return information, see the man page for
+ * getpeername(2).
+ */
+int ast_getpeername(int sockfd, struct ast_sockaddr *addr);
+
 /*!
  * \since 1.8
  *
@@ -191,6 +191,19 @@ extern int option_debug;		/*!< Debugging */
 extern int option_trace;		/*!< Debugging */
 extern int ast_option_maxcalls;		/*!< Maximum number of simultaneous channels */
 extern unsigned int option_dtmfminduration;	/*!< Minimum duration of DTMF (channel.c) in ms */
+extern unsigned int ast_option_frame_cache_size;	/*!< Frames cached per size class by each thread (frame.c) */
+extern unsigned int ast_option_astdb_read_connections;	/*!< Read-only astdb connections, 0 for none (db.c) */
+extern char ast_option_astdb_cached_families[256];	/*!< Comma separated astdb families held in memory (db.c) */
+extern unsigned int ast_option_astdb_cache_size;	/*!< Kilobytes the cached astdb families may use (db.c) */
+extern unsigned int ast_option_prompt_cache_size;	/*!< Kilobytes of prompt files held in memory, 0 for none (file.c) */
+extern int ast_option_prompt_compile;	/*!< Encode sound files in the formats channels use (file.c) */
+extern int ast_option_map_sound_files;	/*!< Read raw sound files through memory maps (file.c) */
+extern unsigned int ast_option_mwi_coalesce;	/*!< Milliseconds MWI states of a mailbox are coalesced over, 0 for none (mwi.c) */
+extern unsigned int ast_option_security_event_window;	/*!< Seconds security events from one address are aggregated over, 0 for none (security_events.c) */
+extern unsigned int ast_option_security_event_sample;	/*!< Publish every this many aggregated security events, 0 for none (security_events.c) */
+extern int ast_option_startup_profile;	/*!< Record how long each part of startup takes (startup_profile.c) */
+extern int ast_option_latency_histograms;	/*!< Record internal latencies in histograms (latency.c) */
+extern int ast_option_align_timers;	/*!< Make periodic timers of the same rate expire together (res_timing_timerfd.c) */
 extern double ast_option_maxload;
 #if defined(HAVE_SYSINFO)
 extern long option_minmemfree;		/*!< Minimum amount of free system memory - stop accepting calls if free memory falls below this watermark */
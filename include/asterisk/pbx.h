@@ -148,6 +148,8 @@ struct ast_custom_function {
 					 * 'dangerous', and should not be run directly
 					 * from external interfaces (AMI, ARI, etc.)
 					 * \since 12 */
+	unsigned int docs_pending:1;    /*!< The XML documentation is built when
+					 * first shown */
 
 	AST_RWLIST_ENTRY(ast_custom_function) acflist;
 };
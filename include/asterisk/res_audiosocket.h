@@ -84,4 +84,88 @@ const int ast_audiosocket_send_frame(const int svc, const struct ast_frame *f);
  */
 struct ast_frame *ast_audiosocket_receive_frame(const int svc);
 
+/*!
+ * \brief An AudioSocket call
+ *
+ * A call either has a connection of its own, or shares a multiplexed
+ * connection with the other multiplexed calls to the same server.  Every
+ * message on a multiplexed connection is wrapped in a message of kind 0x20
+ * whose payload is the 16 byte UUID of the call, the kind of the wrapped
+ * message and its payload.  Only the thread of the connection reads it,
+ * queuing the frames of each call for the session of the call.
+ */
+struct ast_audiosocket_session;
+
+/*!
+ * \brief Connect a call to an AudioSocket server
+ *
+ * \param server The server address, including port.
+ * \param id The UUID of the call.
+ * \param chan An optional channel which will be put into autoservice during
+ * the connection period.  If there is no channel to be autoserviced, pass NULL
+ * instead.
+ * \param multiplex Non-zero to share a connection with the other multiplexed
+ * calls to the server.
+ * \param aggregate_ms Send the audio of the call in chunks of at least this
+ * many milliseconds, 0 to send each frame as it comes.
+ *
+ * \return The session of the call, to close with ast_audiosocket_session_close()
+ * \retval NULL on error
+ */
+struct ast_audiosocket_session *ast_audiosocket_session_open(const char *server, const char *id,
+	struct ast_channel *chan, int multiplex, unsigned int aggregate_ms);
+
+/*!
+ * \brief Get the file descriptor that is readable when a call has something to receive
+ *
+ * \param session The session of the call.
+ *
+ * \return The file descriptor
+ */
+int ast_audiosocket_session_fd(struct ast_audiosocket_session *session);
+
+/*!
+ * \brief Send the initial message of a call to its AudioSocket server
+ *
+ * \param session The session of the call.
+ *
+ * \retval 0 on success
+ * \retval -1 on error
+ */
+int ast_audiosocket_session_init(struct ast_audiosocket_session *session);
+
+/*!
+ * \brief Send an Asterisk audio frame of a call to its AudioSocket server
+ *
+ * The frame may be held back to be sent along with the next ones, if the
+ * session aggregates audio.
+ *
+ * \param session The session of the call.
+ * \param f The Asterisk audio frame to send.
+ *
+ * \retval 0 on success
+ * \retval -1 on error
+ */
+int ast_audiosocket_session_send_frame(struct ast_audiosocket_session *session, const struct ast_frame *f);
+
+/*!
+ * \brief Receive an Asterisk frame of a call from its AudioSocket server
+ *
+ * This returned object is a pointer to an Asterisk frame which must be
+ * manually freed by the caller.
+ *
+ * \param session The session of the call.
+ *
+ * \retval A \ref ast_frame on success
+ * \retval NULL on error, or once the server ended the call
+ */
+struct ast_frame *ast_audiosocket_session_receive_frame(struct ast_audiosocket_session *session);
+
+/*!
+ * \brief End a call and close its session
+ *
+ * \param session The session of the call, may be NULL.
+ */
+void ast_audiosocket_session_close(struct ast_audiosocket_session *session);
+
 #endif /* _ASTERISK_RES_AUDIOSOCKET_H */
@@ -42,6 +42,8 @@ enum {
 	RES_ODBC_CONNECTED = (1 << 2),
 };
 
+struct odbc_cached_stmt;
+
 /*! \brief ODBC container */
 struct odbc_obj {
 	SQLHDBC  con;                   /*!< ODBC Connection Handle */
@@ -52,6 +54,8 @@ struct odbc_obj {
 	int lineno;
 #endif
 	char *sql_text;					/*!< The SQL text currently executing */
+	AST_LIST_HEAD_NOLOCK(, odbc_cached_stmt) statements; /*!< Prepared statements kept for reuse, most recently used first */
+	unsigned int statement_cnt;		/*!< The number of prepared statements kept */
 	AST_LIST_ENTRY(odbc_obj) list;
 };
 
@@ -170,6 +174,34 @@ SQLHSTMT ast_odbc_prepare_and_execute(struct odbc_obj *obj, SQLHSTMT (*prepare_c
  */
 int ast_odbc_prepare(struct odbc_obj *obj, SQLHSTMT *stmt, const char *sql);
 
+/*!
+ * \brief Get a statement with a SQL query prepared, reusing one prepared before if possible
+ * \since 22.0.0
+ *
+ * When the class of the connection keeps prepared statements, a statement
+ * prepared with the same query on the connection and since released with
+ * ast_odbc_release_stmt() is returned without preparing the query again.
+ *
+ * \param obj The ODBC object
+ * \param sql The SQL query
+ * \return a prepared statement handle, which must be released with ast_odbc_release_stmt()
+ * \retval NULL on error
+ */
+SQLHSTMT ast_odbc_prepare_cached(struct odbc_obj *obj, const char *sql);
+
+/*!
+ * \brief Release a statement handle
+ * \since 22.0.0
+ *
+ * A statement from ast_odbc_prepare_cached() that the connection keeps has
+ * its cursor closed and its parameters and columns unbound, any other
+ * statement is freed.
+ *
+ * \param obj The ODBC object the statement was allocated on
+ * \param stmt The statement
+ */
+void ast_odbc_release_stmt(struct odbc_obj *obj, SQLHSTMT stmt);
+
 /*! \brief Execute a unprepared SQL query.
  * \param obj The ODBC object
  * \param stmt The statement
@@ -197,6 +197,18 @@ struct ast_sip_transport_state {
 	 * If true, fail if server certificate cannot verify (TLS only)
 	 */
 	int verify_server;
+	/*!
+	 * Number of TLS handshakes completed on incoming connections (TLS only)
+	 */
+	int tls_handshakes_incoming;
+	/*!
+	 * Number of TLS handshakes completed on outgoing connections (TLS only)
+	 */
+	int tls_handshakes_outgoing;
+	/*!
+	 * Number of outgoing TLS connections whose server failed verification (TLS only)
+	 */
+	int tls_verify_failures;
 #ifdef HAVE_PJSIP_TLS_TRANSPORT_RESTART
 	/*!
 	 * The stats information for the certificate file, if configured
@@ -207,6 +219,10 @@ struct ast_sip_transport_state {
 	 */
 	struct stat privkey_file_stat;
 #endif
+	/*!
+	 * Additional SO_REUSEPORT sockets receiving for the transport (UDP only)
+	 */
+	struct ast_sip_udp_receivers *udp_receivers;
 };
 
 #define ast_sip_transport_is_nonlocal(transport_state, addr) \
@@ -307,6 +323,8 @@ struct ast_sip_transport {
 	int tcp_keepalive_interval_time;
 	/*! The maximum number of keepalive probes TCP should send before dropping the connection */
 	int tcp_keepalive_probe_count;
+	/*! Number of SO_REUSEPORT sockets, each with its own thread, receiving UDP traffic */
+	unsigned int udp_receive_threads;
 };
 
 #define SIP_SORCERY_DOMAIN_ALIAS_TYPE "domain_alias"
@@ -594,11 +612,15 @@ struct ast_sip_auth {
 		AST_STRING_FIELD(oauth_clientid);
 		/*! Secret to use for OAuth authentication */
 		AST_STRING_FIELD(oauth_secret);
+		/*! Realm the precomputed ha1 is for, empty if there is none */
+		AST_STRING_FIELD(ha1_realm);
 	);
 	/*! The time period (in seconds) that a nonce may be reused */
 	unsigned int nonce_lifetime;
 	/*! Used to determine what to use when authenticating */
 	enum ast_sip_auth_type type;
+	/*! MD5 of user:realm:pass for userpass auth, precomputed for ha1_realm */
+	char ha1[PJSIP_MD5STRLEN + 1];
 };
 
 AST_VECTOR(ast_sip_auth_vector, const char *);
@@ -1911,6 +1933,18 @@ struct ast_taskprocessor *ast_sip_create_serializer_group(const char *name, stru
  */
 struct ast_taskprocessor *ast_sip_get_distributor_serializer(pjsip_rx_data *rdata);
 
+/*!
+ * \brief Determine the distributor serializer for a dialog started by Asterisk.
+ *
+ * Dialogs with the same Call-ID always get the same serializer.
+ *
+ * \param call_id The Call-ID of the dialog.
+ *
+ * \retval Calculated distributor serializer on success.
+ * \retval NULL on error.
+ */
+struct ast_taskprocessor *ast_sip_get_distributor_serializer_by_call_id(const pj_str_t *call_id);
+
 /*!
  * \brief Set a serializer on a SIP dialog so requests and responses are automatically serialized
  *
@@ -3430,6 +3464,46 @@ unsigned int ast_sip_get_keep_alive_interval(void);
  */
 unsigned int ast_sip_get_contact_expiration_check_interval(void);
 
+/*!
+ * \brief Retrieve the global setting 'defer_contact_refresh'.
+ *
+ * \retval non-zero if refreshes of contacts that change only their expiration
+ *         are written to sorcery by the expiration check rather than right away.
+ */
+unsigned int ast_sip_get_defer_contact_refresh(void);
+
+/*!
+ * \brief Retrieve the global setting 'exten_state_coalesce_interval'.
+ *
+ * \return Milliseconds extension and presence state changes are gathered
+ *         before the subscribers to them are notified, 0 to notify right away.
+ */
+unsigned int ast_sip_get_exten_state_coalesce_interval(void);
+
+/*!
+ * \brief Retrieve the global setting 'subscription_persistence_write_delay'.
+ *
+ * \return Milliseconds updates of subscription persistence are gathered
+ *         before being written, 0 to write them right away.
+ */
+unsigned int ast_sip_get_subscription_persistence_write_delay(void);
+
+/*!
+ * \brief Retrieve the global setting 'pool_outbound_session_serializers'.
+ *
+ * \retval non-zero if outbound sessions use the distributor serializers
+ *         rather than a serializer of their own.
+ */
+unsigned int ast_sip_get_pool_outbound_session_serializers(void);
+
+/*!
+ * \brief Retrieve the global setting 'outbound_registration_serializers'.
+ *
+ * \return The number of serializers outbound registrations are hashed onto
+ * \retval 0 if each outbound registration has a serializer of its own.
+ */
+unsigned int ast_sip_get_outbound_registration_serializers(void);
+
 /*!
  * \brief Retrieve the system setting 'disable multi domain'.
  * \since 13.9.0
@@ -3803,6 +3877,15 @@ int ast_sip_update_from(pjsip_tx_data *tdata, char *from);
 void ast_sip_get_unidentified_request_thresholds(unsigned int *count, unsigned int *period,
 	unsigned int *prune_interval);
 
+/*!
+ * \brief Retrieve the global setting 'unidentified_request_reject_count'.
+ *
+ * \return The number of unidentified requests from a source IP address within
+ *         unidentified_request_period seconds after which its requests are
+ *         rejected without identifying an endpoint, 0 if they never are.
+ */
+unsigned int ast_sip_get_unidentified_request_reject_count(void);
+
 /*!
  * \brief Get the transport name from an endpoint or request uri
  * \since 13.15.0
@@ -4185,6 +4268,14 @@ struct pjsip_param *ast_sip_pjsip_uri_get_other_param(pjsip_uri *uri, const pj_s
  */
 unsigned int ast_sip_get_all_codecs_on_empty_reinvite(void);
 
+/*!
+ * \brief Retrieve the global setting 'endpoint_identifier_cache_ttl'.
+ *
+ * \return Milliseconds the endpoint identified for a request's source and
+ *         From is reused for other requests, 0 if it is not.
+ */
+unsigned int ast_sip_get_endpoint_identifier_cache_ttl(void);
+
 
 /*!
  * \brief Convert SIP hangup causes to Asterisk hangup causes
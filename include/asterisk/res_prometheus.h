@@ -70,6 +70,8 @@ struct prometheus_general_config {
 	unsigned int enabled;
 	/*! \brief Whether or not core metrics are enabled */
 	unsigned int core_metrics_enabled;
+	/*! \brief How long, in milliseconds, to reuse what a callback output before calling it again */
+	unsigned int min_refresh_interval;
 	AST_DECLARE_STRING_FIELDS(
 		/*! \brief The HTTP URI we register ourselves to */
 		AST_STRING_FIELD(uri);
@@ -115,9 +117,8 @@ struct prometheus_metrics_provider {
  * \brief Prometheus metric type
  *
  * \note
- * Clearly, at some point, we should support summaries and histograms.
- * As an initial implementation, counters / gauges give us quite a
- * bit of functionality.
+ * Summaries are not supported. Histograms are better suited to the
+ * latencies they would be used for anyway, as they can be aggregated.
  */
 enum prometheus_metric_type {
 	/*!
@@ -128,6 +129,12 @@ enum prometheus_metric_type {
 	 * \brief A metric whose value can bounce around like a jackrabbit
 	 */
 	PROMETHEUS_METRIC_GAUGE,
+	/*!
+	 * \brief A metric that counts observations into buckets
+	 *
+	 * The \c value of a histogram is unused. See \c prometheus_histogram_create.
+	 */
+	PROMETHEUS_METRIC_HISTOGRAM,
 };
 
 /*!
@@ -160,6 +167,30 @@ struct prometheus_label {
 	char value[PROMETHEUS_MAX_LABEL_LENGTH];
 };
 
+/*!
+ * \brief The observations of a histogram metric
+ */
+struct prometheus_histogram {
+	/*!
+	 * \brief How many buckets there are, not counting the +Inf bucket
+	 */
+	size_t bucket_count;
+	/*!
+	 * \brief The upper bounds of the buckets, in increasing order
+	 */
+	const double *bounds;
+	/*!
+	 * \brief How many observations fell into each bucket and no lower one
+	 *
+	 * There are \c bucket_count + 1 of them, the last for the +Inf bucket.
+	 */
+	uint64_t *counts;
+	/*!
+	 * \brief The sum of every observation
+	 */
+	double sum;
+};
+
 /*!
  * \brief An actual, honest to god, metric.
  *
@@ -231,6 +262,10 @@ struct prometheus_metric {
 	 * callback function. Otherwise, leave it \c NULL.
 	 */
 	void (* get_metric_value)(struct prometheus_metric *metric);
+	/*!
+	 * \brief The observations, if this is a histogram
+	 */
+	struct prometheus_histogram *histogram;
 	/*!
 	 * \brief A list of children metrics
 	 *
@@ -354,6 +389,41 @@ struct prometheus_metric *prometheus_counter_create(const char *name,
 struct prometheus_metric *prometheus_gauge_create(const char *name,
 	const char *help);
 
+/*!
+ * \brief Create a malloc'd histogram metric
+ *
+ * \note The metric must be registered after creation
+ *
+ * Example Usage:
+ * \code
+ *	static const double latency_bounds[] = { 0.005, 0.01, 0.05, 0.1, 0.5, 1 };
+ *
+ *	metric = prometheus_histogram_create("test_latency_seconds", "A test latency",
+ *		latency_bounds, ARRAY_LEN(latency_bounds));
+ *	prometheus_histogram_observe(metric, 0.02);
+ * \endcode
+ *
+ * \param name The name of the metric
+ * \param help Help text for the metric
+ * \param bounds The upper bounds of the buckets, in increasing order. This must be static.
+ * \param bucket_count How many bounds there are
+ *
+ * \retval prometheus_metric on success
+ * \retval NULL on error
+ */
+struct prometheus_metric *prometheus_histogram_create(const char *name,
+	const char *help, const double *bounds, size_t bucket_count);
+
+/*!
+ * \brief Count an observation in a histogram metric
+ *
+ * \note This locks the metric
+ *
+ * \param metric The histogram
+ * \param value What was observed
+ */
+void prometheus_histogram_observe(struct prometheus_metric *metric, double value);
+
 /*!
  * \brief Convert a metric (and its children) into Prometheus compatible text
  *
@@ -363,6 +433,20 @@ struct prometheus_metric *prometheus_gauge_create(const char *name,
 void prometheus_metric_to_string(struct prometheus_metric *metric,
 	struct ast_str **output);
 
+/*!
+ * \brief Convert just the value of a metric into Prometheus compatible text
+ *
+ * Unlike \c prometheus_metric_to_string, neither the help and type of the
+ * metric nor its children are output. Callbacks that output a lot of
+ * metrics of the same name can use this to output each one as they go,
+ * rather than building up a list of children first.
+ *
+ * \param metric The metric to convert to a string
+ * \param[out] output The \c ast_str string to populate with the metric
+ */
+void prometheus_metric_sample_to_string(struct prometheus_metric *metric,
+	struct ast_str **output);
+
 /*!
  * \brief Defines a callback that will be invoked when the HTTP route is called
  *
@@ -412,6 +496,19 @@ struct prometheus_callback {
 	void (* callback_fn)(struct ast_str **output);
 };
 
+/*!
+ * \brief Hand what a callback has output so far to the Prometheus server
+ *
+ * Scrapes are written to the HTTP connection as they are produced.
+ * Callbacks that output a lot of metrics should call this every so often
+ * so that their output need not all be held in memory at once. Once
+ * enough has built up it is sent and \c output emptied; otherwise, or
+ * if the output is not going to a Prometheus server, nothing happens.
+ *
+ * \param[out] output The string passed to the callback
+ */
+void prometheus_callback_output_flush(struct ast_str **output);
+
 /*!
  * Register a metric for collection
  *
@@ -745,6 +745,8 @@ struct ast_rtp_engine {
 #endif
 	/*! Callback to enable an RTP extension (returns non-zero if supported) */
 	int (*extension_enable)(struct ast_rtp_instance *instance, enum ast_rtp_extension extension);
+	/*! Callback for sampling all statistics without locking the instance, not always required */
+	int (*sample_stats)(struct ast_rtp_instance *instance, struct ast_rtp_instance_stats *stats);
 	/*! Linked list information */
 	AST_RWLIST_ENTRY(ast_rtp_engine) entry;
 };
@@ -2316,6 +2318,47 @@ int ast_rtp_red_buffer(struct ast_rtp_instance *instance, struct ast_frame *fram
  */
 int ast_rtp_instance_get_stats(struct ast_rtp_instance *instance, struct ast_rtp_instance_stats *stats, enum ast_rtp_instance_stat stat);
 
+/*!
+ * \brief Sample all statistics of an RTP instance without waiting on its media
+ *
+ * \param instance Instance to get statistics on
+ * \param stats Structure to put results into
+ *
+ * \retval 0 success
+ * \retval -1 failure
+ *
+ * Unlike ast_rtp_instance_get_stats this does not lock the instance if the
+ * engine supports it, so it is meant for periodic polling.  Packet and octet
+ * counts are current, the statistics derived from RTCP are as of the last
+ * report sent or received.  Engines that can not sample fall back to
+ * ast_rtp_instance_get_stats.
+ */
+int ast_rtp_instance_sample_stats(struct ast_rtp_instance *instance, struct ast_rtp_instance_stats *stats);
+
+/*!
+ * \brief Callback for ast_rtp_instance_sample_stats_all
+ *
+ * \param instance The RTP instance
+ * \param stats The sampled statistics of the instance
+ * \param data The data passed to ast_rtp_instance_sample_stats_all
+ *
+ * \retval 0 continue with the next instance
+ * \retval non-zero stop
+ */
+typedef int (*ast_rtp_instance_stats_cb)(struct ast_rtp_instance *instance,
+	const struct ast_rtp_instance_stats *stats, void *data);
+
+/*!
+ * \brief Sample the statistics of every RTP instance
+ *
+ * \param cb Called with the statistics of each instance that has them
+ * \param data Passed to the callback
+ *
+ * The instances are sampled with ast_rtp_instance_sample_stats, outside of
+ * any lock, so this is cheap enough for scraping by monitoring systems.
+ */
+void ast_rtp_instance_sample_stats_all(ast_rtp_instance_stats_cb cb, void *data);
+
 /*!
  * \brief Set standard statistics from an RTP instance on a channel
  *
@@ -2952,6 +2995,8 @@ struct ast_json *ast_rtp_convert_stats_json(const struct ast_rtp_instance_stats
  * \brief Retrieve statistics about an RTP instance in json format
  * \param instance
  * \return json object of stats
+ *
+ * \note The statistics are sampled with ast_rtp_instance_sample_stats.
  */
 struct ast_json *ast_rtp_instance_get_stats_all_json(struct ast_rtp_instance *instance);
 
@@ -152,14 +152,48 @@ extern "C" {
 #define AST_SCHED_REPLACE_UNREF(id, sched, when, callback, data, unrefcall, addfailcall, refcall) \
 	AST_SCHED_REPLACE_VARIABLE_UNREF(id, sched, when, callback, data, 0, unrefcall, addfailcall, refcall)
 
+/*!
+ * \brief Scheduler context queue implementations
+ */
+enum ast_sched_queue {
+	/*!
+	 * \brief Binary heap ordered by expiration time
+	 *
+	 * Adding and running entries is O(log n).  Entries expiring
+	 * at the same time run in the order they were added.
+	 */
+	AST_SCHED_QUEUE_HEAP = 0,
+	/*!
+	 * \brief Hierarchical timing wheel with millisecond resolution
+	 *
+	 * Adding and deleting entries is O(1).  Suited to contexts
+	 * that add and cancel large numbers of short timers.  Entries
+	 * expiring in the same millisecond run in the order they
+	 * were queued, which may differ from the order they were added.
+	 */
+	AST_SCHED_QUEUE_WHEEL,
+};
+
 /*!
  * \brief Create a scheduler context
  *
+ * \note The context uses the \ref AST_SCHED_QUEUE_HEAP queue.
+ *
  * \retval NULL on failure
  * \return a malloc'd sched_context structure
  */
 struct ast_sched_context *ast_sched_context_create(void);
 
+/*!
+ * \brief Create a scheduler context using a specific queue implementation
+ *
+ * \param queue Queue implementation the context should use
+ *
+ * \retval NULL on failure
+ * \return a malloc'd sched_context structure
+ */
+struct ast_sched_context *ast_sched_context_create_with_queue(enum ast_sched_queue queue);
+
 /*!
  * \brief destroys a schedule context
  *
@@ -327,7 +361,7 @@ int ast_sched_del_nonrunning(struct ast_sched_context *con, int id) attribute_wa
  * it needs to be run.  This value is perfect for passing to the poll
  * call.
  *
- * \param con context to act upon
+ * \param con context to act upon, may be NULL
  *
  * \retval -1 if there is nothing there are no scheduled events
  * (and thus the poll should not timeout)
@@ -340,7 +374,7 @@ int ast_sched_wait(struct ast_sched_context *con) attribute_warn_unused_result;
  * Run the queue, executing all callbacks which need to be performed
  * at this time.
  *
- * \param con Scheduling context to run
+ * \param con Scheduling context to run, may be NULL
  *
  * \return the number of events processed.
  */
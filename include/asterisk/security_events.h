@@ -77,6 +77,24 @@ struct stasis_topic *ast_security_topic(void);
  */
 struct stasis_message_type *ast_security_event_type(void);
 
+/*!
+ * \brief A \ref stasis_message_type for summaries of aggregated security events
+ *
+ * When security_event_window is set in asterisk.conf, events of one type
+ * from one remote address are aggregated over the window, and only some of
+ * them are published.  When a window closes with events not published, a
+ * summary of them is.
+ *
+ * \retval NULL on error
+ * \return \ref stasis_message_type for security event summaries
+ *
+ * \note Messages of this type are issued on the \ref ast_security_topic
+ *       \ref stasis_topic.  Their data is an \ref ast_json_payload with the
+ *       SecurityEvent name, Service, RemoteAddress, Count, Suppressed and
+ *       Window.
+ */
+struct stasis_message_type *ast_security_event_summary_type(void);
+
 /*!
  * \brief initializes stasis topic/event types for \ref ast_security_topic and \ref ast_security_event_type
  * \since 12
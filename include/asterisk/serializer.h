@@ -74,6 +74,23 @@ const char *ast_serializer_pool_name(const struct ast_serializer_pool *pool);
  */
 struct ast_taskprocessor *ast_serializer_pool_get(struct ast_serializer_pool *pool);
 
+/*!
+ * \brief Retrieve the serializer a hash value maps to.
+ *
+ * Unlike ast_serializer_pool_get() the choice does not depend on queue
+ * sizes so the same hash always yields the same serializer.  This lets
+ * many mostly idle users share a few serializers while work for any one
+ * of them stays ordered.
+ *
+ * \param pool The pool object
+ * \param hash Hash value identifying the user of the serializer
+ *
+ * \return A serializer/taskprocessor (not reffed)
+ * \retval NULL if the pool is empty
+ */
+struct ast_taskprocessor *ast_serializer_pool_get_by_hash(struct ast_serializer_pool *pool,
+	unsigned int hash);
+
 /*!
  * \brief Set taskprocessor alert levels for the serializers in the pool.
  *
@@ -30,14 +30,14 @@
 extern "C" {
 #endif
 
-#define AST_SLINFACTORY_MAX_HOLD 1280
+/*! \brief The fewest samples the ring of a slinfactory holds once it has been fed */
+#define AST_SLINFACTORY_MIN_RING 1024
 
 struct ast_slinfactory {
-	AST_LIST_HEAD_NOLOCK(, ast_frame) queue; /*!< A list of unaltered frames */
 	struct ast_trans_pvt *trans;             /*!< Translation path that converts fed frames into signed linear */
-	short hold[AST_SLINFACTORY_MAX_HOLD];    /*!< Hold for audio that no longer belongs to a frame (ie: if only some samples were taken from a frame) */
-	short *offset;                           /*!< Offset into the hold where audio begins */
-	size_t holdlen;                          /*!< Number of samples currently in the hold */
+	short *ring;                             /*!< Ring of the audio fed in and not read yet, an ao2 object frames read may share */
+	size_t ring_size;                        /*!< Number of samples the ring can hold, a power of two */
+	size_t head;                             /*!< Where in the ring the audio to read next begins */
 	unsigned int size;                       /*!< Number of samples currently in the factory */
 	struct ast_format *format;               /*!< Current format the translation path is converting from */
 	struct ast_format *output_format;        /*!< The output format desired */
@@ -78,7 +78,10 @@ void ast_slinfactory_destroy(struct ast_slinfactory *sf);
  * \param sf The slinfactory to feed into
  * \param f Frame containing audio to feed in
  *
- * \return Number of frames currently in factory
+ * The audio is copied into the factory, which grows to hold it if it has
+ * to, so frames are neither kept nor allocated for it.
+ *
+ * \return Number of samples that were in the factory before the audio was fed
  */
 int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f);
 
@@ -93,6 +96,23 @@ int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f);
  */
 int ast_slinfactory_read(struct ast_slinfactory *sf, short *buf, size_t samples);
 
+/*!
+ * \brief Read samples from a slinfactory as a frame
+ *
+ * \param sf The slinfactory to read from
+ * \param samples Number of samples wanted
+ *
+ * Unless the samples wrap around the end of the ring they are in, the
+ * frame shares the ring rather than having them copied.  The factory
+ * moves its audio to a new ring if it is fed while such frames remain.
+ *
+ * \note The frame is shared, see ast_frame_make_writable().
+ *
+ * \return A frame of exactly the number of samples wanted, or NULL if
+ * there are not that many
+ */
+struct ast_frame *ast_slinfactory_read_frame(struct ast_slinfactory *sf, size_t samples);
+
 /*!
  * \brief Retrieve number of samples currently in a slinfactory
  *
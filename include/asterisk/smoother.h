@@ -71,6 +71,17 @@ void ast_smoother_reset(struct ast_smoother *s, int bytes);
 void ast_smoother_reconfigure(struct ast_smoother *s, int bytes);
 
 int __ast_smoother_feed(struct ast_smoother *s, struct ast_frame *f, int swap);
+
+/*!
+ * \brief Get the next frame of the expected size from a smoother
+ * \param s the smoother to read from
+ *
+ * \note The frame points at the audio inside the smoother, and the offset
+ * of the frame in front of it is free to write a header to.  It is only
+ * valid until the smoother is next fed or read from.
+ *
+ * \return the frame, or NULL if there is not enough audio for one
+ */
 struct ast_frame *ast_smoother_read(struct ast_smoother *s);
 #define ast_smoother_feed(s,f) __ast_smoother_feed(s, f, 0)
 #if __BYTE_ORDER == __LITTLE_ENDIAN
@@ -451,6 +451,9 @@ const struct timeval *stasis_message_timestamp(const struct stasis_message *msg)
  * May return \c NULL, to indicate no representation. The returned object should
  * be ast_json_unref()'ed.
  *
+ * The representation is built once per message and sanitizer.  Every
+ * caller gets its own copy that it may modify.
+ *
  * \param msg Message to convert to JSON string.
  * \param sanitize Snapshot sanitization callback.
  *
@@ -465,11 +468,35 @@ struct ast_json *stasis_message_to_json(struct stasis_message *msg, struct stasi
  * May return \c NULL, to indicate no representation. The returned object should
  * be ao2_cleanup()'ed.
  *
+ * The representation is built once per message and shared by all callers,
+ * so it must not be modified.
+ *
  * \param msg Message to convert to AMI.
  * \retval NULL if AMI format is not supported.
  */
 struct ast_manager_event_blob *stasis_message_to_ami(struct stasis_message *msg);
 
+/*!
+ * \brief Hit and miss counts of the memoized message representations.
+ */
+struct stasis_message_formatter_statistics {
+	/*! JSON representations served from the message */
+	int json_hits;
+	/*! JSON representations built */
+	int json_misses;
+	/*! AMI representations served from the message */
+	int ami_hits;
+	/*! AMI representations built */
+	int ami_misses;
+};
+
+/*!
+ * \brief Get the hit and miss counts of the memoized message representations.
+ *
+ * \param[out] statistics Filled in with the current counts.
+ */
+void stasis_message_formatter_statistics_get(struct stasis_message_formatter_statistics *statistics);
+
 /*!
  * \brief Determine if the given message can be converted to AMI.
  *
@@ -601,6 +628,23 @@ void stasis_publish(struct stasis_topic *topic, struct stasis_message *message);
  */
 void stasis_publish_sync(struct stasis_subscription *sub, struct stasis_message *message);
 
+/*!
+ * \brief Publish a batch of messages to a topic's subscribers.
+ * \param topic Topic.
+ * \param messages Messages to publish, in order.
+ * \param count Number of messages.
+ *
+ * This call is asynchronous like \ref stasis_publish.  Each subscriber
+ * receives the messages it accepts as a single task on its mailbox,
+ * instead of one task per message.  Subscribers with a batch callback
+ * set by \ref stasis_subscription_set_batch_callback get the messages in
+ * one call; other subscribers get their regular callback once per message.
+ *
+ * \note The caller keeps its references to the messages.
+ */
+void stasis_publish_batch(struct stasis_topic *topic, struct stasis_message **messages,
+	size_t count);
+
 /*!
  * \brief Callback function type for Stasis subscriptions.
  * \param data Data field provided with subscription.
@@ -610,6 +654,18 @@ void stasis_publish_sync(struct stasis_subscription *sub, struct stasis_message
  */
 typedef void (*stasis_subscription_cb)(void *data, struct stasis_subscription *sub, struct stasis_message *message);
 
+/*!
+ * \brief Callback function type for batches delivered to Stasis subscriptions.
+ * \param data Data field provided with subscription.
+ * \param sub Subscription published on.
+ * \param messages Published messages, in publish order.
+ * \param count Number of messages.
+ *
+ * \note The callback does not own the references to the messages.
+ */
+typedef void (*stasis_subscription_batch_cb)(void *data, struct stasis_subscription *sub,
+	struct stasis_message **messages, size_t count);
+
 /*!
  * \brief Stasis subscription callback function that does nothing.
  *
@@ -679,6 +735,41 @@ struct stasis_subscription *__stasis_subscribe_pool(struct stasis_topic *topic,
 	stasis_subscription_cb callback, void *data, const char *file, int lineno, const char *func);
 #define stasis_subscribe_pool(topic, callback, data) __stasis_subscribe_pool(topic, callback, data, __FILE__, __LINE__, __PRETTY_FUNCTION__)
 
+/*!
+ * \brief Create a subscription whose callbacks occur on a shared serializer
+ *
+ * In addition to being AO2 managed memory (requiring an ao2_cleanup() to free
+ * up this reference), the subscription must be explicitly unsubscribed from its
+ * topic using stasis_unsubscribe().
+ *
+ * Like \ref stasis_subscribe_pool, the callbacks run on the Stasis threadpool
+ * and are serialized.  Rather than having a taskprocessor of its own, the
+ * subscription is hashed onto one of a fixed number of serializers shared with
+ * other such subscriptions (see the \c serializer_pool_size option in
+ * stasis.conf).  This suits large numbers of mostly idle subscriptions.
+ *
+ * \param topic Topic to subscribe to.
+ * \param callback Callback function for subscription messages.
+ * \param data Data to be passed to the callback, in addition to the message.
+ * \param file, lineno, func
+ * \return New \ref stasis_subscription object.
+ * \retval NULL on error.
+ *
+ * \note A slow callback delays the other subscriptions sharing its serializer.
+ * A callback must not join a subscription that may share its serializer, such
+ * as with stasis_unsubscribe_and_join().
+ *
+ * \note stasis_subscription_set_congestion_limits() fails for these
+ * subscriptions since the serializer is shared.
+ *
+ * \note This callback will receive a callback with a message indicating it
+ * has been subscribed. This occurs immediately before accepted message
+ * types can be set and the callback must expect to receive it.
+ */
+struct stasis_subscription *__stasis_subscribe_pool_hashed(struct stasis_topic *topic,
+	stasis_subscription_cb callback, void *data, const char *file, int lineno, const char *func);
+#define stasis_subscribe_pool_hashed(topic, callback, data) __stasis_subscribe_pool_hashed(topic, callback, data, __FILE__, __LINE__, __PRETTY_FUNCTION__)
+
 /*!
  * \brief Indicate to a subscription that we are interested in a message type.
  *
@@ -786,6 +877,88 @@ struct stasis_subscription *stasis_unsubscribe(
 int stasis_subscription_set_congestion_limits(struct stasis_subscription *subscription,
 	long low_water, long high_water);
 
+/*!
+ * \brief Set the callback used for batches published with \ref stasis_publish_batch.
+ *
+ * \param subscription Subscription to modify.
+ * \param callback Batch callback, or NULL to invoke the regular callback
+ *        once per message of a batch.
+ *
+ * \note The final message of the subscription is always delivered to the
+ * regular callback.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int stasis_subscription_set_batch_callback(struct stasis_subscription *subscription,
+	stasis_subscription_batch_cb callback);
+
+/*!
+ * \brief What to do with queued messages when a subscriber falls behind.
+ */
+enum stasis_subscription_overload_policy {
+	/*! Queue every message, there is no limit */
+	STASIS_SUBSCRIPTION_OVERLOAD_NONE = 0,
+	/*! Discard the oldest queued message to make room */
+	STASIS_SUBSCRIPTION_OVERLOAD_DROP_OLDEST,
+	/*!
+	 * Replace a queued message of the same type about the same entity.
+	 * Messages that don't coalesce discard the oldest when the queue is full.
+	 */
+	STASIS_SUBSCRIPTION_OVERLOAD_COALESCE,
+	/*! Discard every other queued message, leaving an even sample of the backlog */
+	STASIS_SUBSCRIPTION_OVERLOAD_SAMPLE,
+};
+
+/*!
+ * \brief Bound the messages queued for a subscription.
+ *
+ * Once a policy is set, messages for the subscription wait in a queue of its
+ * own and the policy decides what gives when \a max_queued messages are
+ * waiting.  Publishing never blocks on a slow subscriber.
+ *
+ * \param subscription Subscription to modify. It must have a mailbox.
+ * \param policy What to do when the queue is full.
+ * \param max_queued Number of messages that may wait. Ignored for
+ *        \ref STASIS_SUBSCRIPTION_OVERLOAD_NONE.
+ * \param id_fn Returns the entity a message is about. Required for
+ *        \ref STASIS_SUBSCRIPTION_OVERLOAD_COALESCE, ignored otherwise.
+ *        Messages it returns NULL for are never coalesced.
+ *
+ * \note The final message of the subscription, and messages published with
+ * \ref stasis_publish_sync, are never discarded.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int stasis_subscription_set_overload_policy(struct stasis_subscription *subscription,
+	enum stasis_subscription_overload_policy policy, size_t max_queued,
+	const char *(*id_fn)(struct stasis_message *message));
+
+/*!
+ * \brief Counts kept for a subscription with an overload policy.
+ */
+struct stasis_subscription_overload_statistics {
+	/*! Messages discarded by the policy */
+	unsigned int dropped;
+	/*! Messages replaced by a newer message about the same entity */
+	unsigned int coalesced;
+	/*! Messages currently waiting */
+	size_t queued;
+};
+
+/*!
+ * \brief Get the overload counts of a subscription.
+ *
+ * \param subscription Subscription to query.
+ * \param[out] statistics Filled in with the current counts.
+ *
+ * \retval 0 on success.
+ * \retval -1 if no overload policy was ever set on the subscription.
+ */
+int stasis_subscription_overload_statistics_get(struct stasis_subscription *subscription,
+	struct stasis_subscription_overload_statistics *statistics);
+
 /*!
  * \brief Block until the last message is processed on a subscription.
  *
@@ -455,6 +455,16 @@ int stasis_app_control_is_done(
  */
 void stasis_app_control_flush_queue(struct stasis_app_control *control);
 
+/*!
+ * \brief Returns the application controlling the channel of this control
+ *
+ * \param control Control object.
+ *
+ * \return The application, which may change when the channel is moved (must be ao2_cleanup()'d)
+ * \retval NULL if there is none.
+ */
+struct stasis_app *stasis_app_control_get_app(struct stasis_app_control *control);
+
 /*!
  * \brief Returns the uniqueid of the channel associated with this control
  *
@@ -804,6 +814,49 @@ int stasis_app_control_add_channel_to_bridge(
 int stasis_app_control_remove_channel_from_bridge(
 	struct stasis_app_control *control, struct ast_bridge *bridge);
 
+/*!
+ * \brief Callback for when a command queued on a control has completed
+ *
+ * Called from the thread controlling the channel, or from the queueing
+ * thread if the command could not be run.
+ *
+ * \param control Control the command was queued on
+ * \param result The result of the command, zero on success
+ * \param data The data given when the command was queued
+ */
+typedef void (*stasis_app_command_done_cb)(struct stasis_app_control *control,
+	int result, void *data);
+
+/*!
+ * \brief Add a channel to the bridge without waiting for it to be added.
+ *
+ * \param control Control whose channel should be added to the bridge
+ * \param bridge Pointer to the bridge
+ * \param done_fn Called once the channel has been added, or failed to be
+ * \param done_data ao2 object passed to done_fn, a reference is held until then
+ *
+ * \retval zero if the command was queued, done_fn will be called
+ * \retval non-zero on failure, done_fn will not be called
+ */
+int stasis_app_control_add_channel_to_bridge_async(
+	struct stasis_app_control *control, struct ast_bridge *bridge,
+	stasis_app_command_done_cb done_fn, void *done_data);
+
+/*!
+ * \brief Remove a channel from the bridge without waiting for it to be removed.
+ *
+ * \param control Control whose channel should be removed from the bridge
+ * \param bridge Pointer to the bridge
+ * \param done_fn Called once the channel has been removed, or failed to be
+ * \param done_data ao2 object passed to done_fn, a reference is held until then
+ *
+ * \retval zero if the command was queued, done_fn will be called
+ * \retval non-zero on failure, done_fn will not be called
+ */
+int stasis_app_control_remove_channel_from_bridge_async(
+	struct stasis_app_control *control, struct ast_bridge *bridge,
+	stasis_app_command_done_cb done_fn, void *done_data);
+
 /*!
  * \brief Initialize bridge features into a channel control
  *
@@ -230,6 +230,21 @@ void ast_bridge_publish_leave(struct ast_bridge *bridge, struct ast_channel *cha
 struct ast_json *ast_bridge_snapshot_to_json(const struct ast_bridge_snapshot *snapshot,
 	const struct stasis_message_sanitizer *sanitize);
 
+/*!
+ * \brief Write the JSON object of a \ref ast_bridge_snapshot.
+ *
+ * Writes what ast_bridge_snapshot_to_json() would build, without building it.
+ *
+ * \param snapshot The bridge snapshot to write
+ * \param sanitize The message sanitizer to use on the snapshot
+ * \param writer The writer to write it with
+ *
+ * \retval 0 if it was written, or writing it failed
+ * \retval -1 if there is no snapshot.  Nothing is written.
+ */
+int ast_bridge_snapshot_to_json_writer(const struct ast_bridge_snapshot *snapshot,
+	const struct stasis_message_sanitizer *sanitize, struct ast_json_writer *writer);
+
 /*!
  * \brief Pair showing a bridge snapshot and a specific channel snapshot belonging to the bridge
  */
@@ -49,6 +49,36 @@ enum ast_channel_snapshot_segment_invalidation {
 	AST_CHANNEL_SNAPSHOT_INVALIDATE_BASE = (1 << 7),
 };
 
+/*!
+ * \brief Parts of a channel snapshot that differ between the old and new
+ * snapshot of an update.
+ *
+ * The segment values match \ref ast_channel_snapshot_segment_invalidation.
+ */
+enum ast_channel_snapshot_update_change {
+	/*! The bridge segment changed */
+	AST_CHANNEL_SNAPSHOT_CHANGED_BRIDGE = AST_CHANNEL_SNAPSHOT_INVALIDATE_BRIDGE,
+	/*! The dialplan segment changed */
+	AST_CHANNEL_SNAPSHOT_CHANGED_DIALPLAN = AST_CHANNEL_SNAPSHOT_INVALIDATE_DIALPLAN,
+	/*! The connected segment changed */
+	AST_CHANNEL_SNAPSHOT_CHANGED_CONNECTED = AST_CHANNEL_SNAPSHOT_INVALIDATE_CONNECTED,
+	/*! The caller segment changed */
+	AST_CHANNEL_SNAPSHOT_CHANGED_CALLER = AST_CHANNEL_SNAPSHOT_INVALIDATE_CALLER,
+	/*! The hangup segment changed */
+	AST_CHANNEL_SNAPSHOT_CHANGED_HANGUP = AST_CHANNEL_SNAPSHOT_INVALIDATE_HANGUP,
+	/*! The peer segment changed */
+	AST_CHANNEL_SNAPSHOT_CHANGED_PEER = AST_CHANNEL_SNAPSHOT_INVALIDATE_PEER,
+	/*! The base segment changed */
+	AST_CHANNEL_SNAPSHOT_CHANGED_BASE = AST_CHANNEL_SNAPSHOT_INVALIDATE_BASE,
+	/*! The state, AMA flags, channel flags or softhangup flags changed */
+	AST_CHANNEL_SNAPSHOT_CHANGED_STATE = (1 << 8),
+	/*! The manager or ARI variables changed */
+	AST_CHANNEL_SNAPSHOT_CHANGED_VARS = (1 << 9),
+};
+
+/*! \brief Every \ref ast_channel_snapshot_update_change bit */
+#define AST_CHANNEL_SNAPSHOT_CHANGED_ALL ((1 << 10) - 2)
+
 /*!
  * \since 17
  * \brief Structure containing bridge information for a channel snapshot.
@@ -174,6 +204,8 @@ struct ast_channel_snapshot {
 struct ast_channel_snapshot_update {
 	struct ast_channel_snapshot *old_snapshot; /*!< The old channel snapshot */
 	struct ast_channel_snapshot *new_snapshot; /*!< The new channel snapshot */
+	/*! \ref ast_channel_snapshot_update_change bits, all of them without an old snapshot */
+	unsigned int changed;
 };
 
 /*!
@@ -707,6 +739,21 @@ void ast_channel_publish_dial_forward(struct ast_channel *caller,
 struct ast_json *ast_channel_snapshot_to_json(const struct ast_channel_snapshot *snapshot,
 	const struct stasis_message_sanitizer *sanitize);
 
+/*!
+ * \brief Write the JSON object of a \ref ast_channel_snapshot.
+ *
+ * Writes what ast_channel_snapshot_to_json() would build, without building it.
+ *
+ * \param snapshot The snapshot to write
+ * \param sanitize The message sanitizer to use on the snapshot
+ * \param writer The writer to write it with
+ *
+ * \retval 0 if it was written, or writing it failed
+ * \retval -1 if there is no snapshot or the sanitizer hides it.  Nothing is written.
+ */
+int ast_channel_snapshot_to_json_writer(const struct ast_channel_snapshot *snapshot,
+	const struct stasis_message_sanitizer *sanitize, struct ast_json_writer *writer);
+
 /*!
  * \brief Compares the context, exten and priority of two snapshots.
  * \since 12
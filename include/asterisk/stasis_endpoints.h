@@ -65,6 +65,27 @@ struct ast_endpoint_snapshot {
 	char *channel_ids[];
 };
 
+/*!
+ * \brief A channel added to or removed from an endpoint.
+ *
+ * Each change to the channels of an endpoint is published as one of these
+ * on its topic.  A \ref ast_endpoint_snapshot with all the changes made is
+ * published after them, once for any number of changes made in a row, so
+ * that the whole list of channels is not copied for every change.
+ */
+struct ast_endpoint_channel_update {
+	/*! unique id of the endpoint */
+	const char *id;
+	/*! unique id of the channel */
+	const char *channel_id;
+	/*! Non-zero if the channel was added, zero if it was removed */
+	int added;
+	/*! Number of channels on the endpoint after the change */
+	int num_channels;
+	/*! Storage for the ids */
+	char data[0];
+};
+
 /*!
  * \brief Blob of data associated with an endpoint.
  *
@@ -129,6 +150,11 @@ struct stasis_message_type *ast_endpoint_contact_state_type(void);
  */
 struct stasis_message_type *ast_endpoint_snapshot_type(void);
 
+/*!
+ * \brief Message type for \ref ast_endpoint_channel_update.
+ */
+struct stasis_message_type *ast_endpoint_channel_update_type(void);
+
 /*!
  * \brief Create a snapshot of an endpoint
  * \param endpoint Endpoint to snap a shot of.
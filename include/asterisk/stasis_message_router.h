@@ -284,4 +284,31 @@ void stasis_message_router_set_formatters_default(struct stasis_message_router *
 void stasis_message_router_accept_formatters(struct stasis_message_router *router,
 	enum stasis_subscription_message_formatters formatters);
 
+/*!
+ * \brief Have the router's default route get messages of a type
+ *
+ * The type is accepted by the underlying subscription, as with a route
+ * of its own.  Along with \ref stasis_message_router_accept_formatters
+ * this decides which messages without a route are received at all.
+ *
+ * \param router Router to accept the message type for.
+ * \param message_type The type of message to accept.
+ */
+void stasis_message_router_accept_message_type(struct stasis_message_router *router,
+	struct stasis_message_type *message_type);
+
+/*!
+ * \brief Stop the router's default route getting messages of a type
+ *
+ * Undoes \ref stasis_message_router_accept_message_type.  Messages of
+ * the type may still be received if accepted by their formatters.
+ *
+ * \note Must not be used for a message type with a route of its own.
+ *
+ * \param router Router to decline the message type for.
+ * \param message_type The type of message to decline.
+ */
+void stasis_message_router_decline_message_type(struct stasis_message_router *router,
+	struct stasis_message_type *message_type);
+
 #endif /* _ASTERISK_STASIS_MESSAGE_ROUTER_H */
@@ -227,7 +227,8 @@ AST_VECTOR(ast_string_field_vector, const char **);
 struct ast_string_field_mgr {
 	ast_string_field last_alloc;			/*!< the last field allocated */
 	struct ast_string_field_pool *embedded_pool;	/*!< pointer to the embedded pool, if any */
-	struct ast_string_field_vector string_fields;	/*!< field vector for compare and copy */
+	size_t declared_fields;				/*!< how many fields are declared in front of the manager */
+	struct ast_string_field_vector string_fields;	/*!< extended field vector for compare and copy */
 };
 
 /*!
@@ -385,6 +386,101 @@ int __ast_string_field_free_memory(struct ast_string_field_mgr *mgr,
 	struct ast_string_field_pool **pool_head, enum ast_stringfield_cleanup_type cleanup_type,
 	const char *file, int lineno, const char *func);
 
+/*!
+ * \brief Initialize a field pool and fields, the pool following the structure
+ *
+ * \param x Pointer to a structure containing fields, allocated with room for
+ *          AST_STRING_FIELD_EMBEDDED_SIZE(size) bytes after it
+ * \param size Amount of storage in the pool
+ *
+ * Like ast_calloc_with_stringfields, this saves allocating the pool apart
+ * from the structure, but the structure can be allocated any way, such as
+ * an ao2 object.  Setting fields only allocates more pools if the values
+ * do not fit in the embedded one.
+ *
+ * \code
+ * snapshot = ao2_alloc_options(sizeof(*snapshot) + AST_STRING_FIELD_EMBEDDED_SIZE(size), ...);
+ * ast_string_field_init_embedded(snapshot, size);
+ * \endcode
+ *
+ * \retval zero on success
+ * \retval non-zero on failure
+ */
+#define ast_string_field_init_embedded(x, size) \
+({ \
+	int __res__ = -1; \
+	if (((void *)(x)) != (void *)NULL) { \
+		__res__ = __ast_string_field_init_embedded(&(x)->__field_mgr, &(x)->__field_mgr_pool, \
+			(char *)(x) + sizeof(*(x)), (size)); \
+	} \
+	__res__ ; \
+})
+
+/*!
+ * \brief The room to allocate after a structure for ast_string_field_init_embedded
+ *
+ * \param size Amount of storage in the pool
+ */
+#define AST_STRING_FIELD_EMBEDDED_SIZE(size) (sizeof(struct ast_string_field_pool) + (size))
+
+/*!
+ * \brief The pool storage needed to set a field to a string of the given length
+ *
+ * \param len The length of the string, without its terminator
+ */
+#define AST_STRING_FIELD_ROOM(len) ast_make_room_for((len) + 1, ast_string_field_allocation)
+
+/*!
+ * \internal
+ * \brief internal version of ast_string_field_init_embedded
+ */
+int __ast_string_field_init_embedded(struct ast_string_field_mgr *mgr,
+	struct ast_string_field_pool **pool_head, void *space, size_t size);
+
+/*!
+ * \brief Get the interned copy of a string
+ *
+ * Interned strings are kept once, for as long as Asterisk runs, and can
+ * be set to the fields of any structure without using its pool.  This
+ * is for the few values many objects have, such as context, application
+ * and technology names, and not for the values only one object has.
+ *
+ * \param str The string to intern
+ *
+ * \return The interned string
+ * \retval NULL if too many strings are interned already, or on error
+ */
+const char *ast_string_field_intern(const char *str);
+
+/*!
+ * \brief Set a field to an interned string value
+ *
+ * \param x Pointer to a structure containing fields
+ * \param field Name of the field to set
+ * \param data String value to be interned and set to the field
+ *
+ * The value is copied into the pool as ast_string_field_set does when it
+ * cannot be interned.
+ *
+ * \retval zero on success
+ * \retval non-zero on error
+ */
+#define ast_string_field_set_interned(x, field, data) \
+({ \
+	int __res__ = -1; \
+	if (((void *)(x)) != (void *)NULL) { \
+		const char *__interned__ = ast_string_field_intern(data); \
+		if (__interned__) { \
+			__ast_string_field_release_active((x)->__field_mgr_pool, (x)->field); \
+			*(ast_string_field *) &(x)->field = __interned__; \
+			__res__ = 0; \
+		} else { \
+			__res__ = ast_string_field_set(x, field, data); \
+		} \
+	} \
+	__res__; \
+})
+
 /*!
  * \brief Initialize an extended string field
  * \since 13.9.0
@@ -611,13 +707,13 @@ void __ast_string_field_release_active(struct ast_string_field_pool *pool_head,
 ({ \
 	int __res__ = -1; \
 	if (((void *)(instance1)) != (void *)NULL && ((void *)(instance2)) != (void *)NULL) { \
-		__res__ = __ast_string_fields_cmp(&(instance1)->__field_mgr.string_fields, \
-			&(instance2)->__field_mgr.string_fields); \
+		__res__ = __ast_string_fields_cmp(&(instance1)->__field_mgr, \
+			&(instance2)->__field_mgr); \
 	} \
 	__res__; \
 })
 
-int __ast_string_fields_cmp(struct ast_string_field_vector *left, struct ast_string_field_vector *right);
+int __ast_string_fields_cmp(struct ast_string_field_mgr *left, struct ast_string_field_mgr *right);
 
 /*!
   \brief Copy all string fields from one instance to another of the same structure
@@ -375,4 +375,44 @@ unsigned int ast_taskprocessor_get_subsystem_alert(const char *subsystem);
  */
 int ast_taskprocessor_alert_set_levels(struct ast_taskprocessor *tps, long low_water, long high_water);
 
+/*!
+ * \brief Statistics of a taskprocessor
+ */
+struct ast_taskprocessor_stats {
+	/*! \brief The name of the taskprocessor */
+	const char *name;
+	/*! \brief How many tasks were executed */
+	unsigned long processed;
+	/*! \brief How many tasks are queued */
+	long queued;
+	/*! \brief The most tasks that were queued at once */
+	unsigned long max_depth;
+	/*! \brief Moving average of the time tasks waited in the queue, in ns */
+	uint64_t wait_avg;
+	/*! \brief Moving average of the time tasks took to execute, in ns */
+	uint64_t exec_avg;
+	/*! \brief The longest time a task recently took to execute, in ns */
+	uint64_t slowest;
+	/*! \brief The function of the task that recently took the longest */
+	void *slowest_task;
+};
+
+/*!
+ * \brief Callback for ast_taskprocessor_stats_foreach()
+ *
+ * \param stats The statistics of a taskprocessor, only valid during the callback
+ * \param data The data passed to ast_taskprocessor_stats_foreach()
+ */
+typedef void (*ast_taskprocessor_stats_cb)(const struct ast_taskprocessor_stats *stats, void *data);
+
+/*!
+ * \brief Get the statistics of every taskprocessor
+ *
+ * \note No lock is held while the callback runs.
+ *
+ * \param callback Called with the statistics of each taskprocessor
+ * \param data Passed to the callback
+ */
+void ast_taskprocessor_stats_foreach(ast_taskprocessor_stats_cb callback, void *data);
+
 #endif /* __AST_TASKPROCESSOR_H__ */
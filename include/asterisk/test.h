@@ -112,6 +112,54 @@
    'test generate results xml' will generate a test report in xml format
    'test generate results txt' will generate a test report in txt format
 \endcode
+
+\section BenchAPIUsage How to Use the Benchmark API
+
+   Benchmarks time an operation many times over, to compare its speed between
+   versions rather than to check its results.  A benchmark is described by a
+   struct ast_bench_info with a callback doing the operation once, and optional
+   callbacks setting up and tearing down what it works on.
+
+\code
+   static void *find_setup(void)
+   {
+       return a container with the objects to find;
+   }
+
+   static void find_run(void *data)
+   {
+       ao2_cleanup(ao2_find(data, "key", OBJ_SEARCH_KEY));
+   }
+
+   static void find_teardown(void *data)
+   {
+       ao2_cleanup(data);
+   }
+
+   static struct ast_bench_info find_bench = {
+       .name = "find",
+       .category = "/main/astobj2/",
+       .summary = "Find an object in a hash container",
+       .setup = find_setup,
+       .run = find_run,
+       .teardown = find_teardown,
+   };
+
+   AST_BENCH_REGISTER(&find_bench);
+\endcode
+
+   The operation is run a number of times to warm up first, then timed over the
+   iterations.  Each iteration times a batch of operations, so even operations
+   shorter than reading the clock are measured.  The minimum, mean, median,
+   90th and 99th percentile and maximum nanoseconds per operation are reported.
+
+\code
+   'test bench show registered'             shows every registered benchmark
+   'test bench run all'                     runs every registered benchmark
+   'test bench run category [category]'     runs the benchmarks of a category
+   'test bench run ... iterations 1000'     times 1000 iterations instead
+   'test bench run ... json'                reports the results as JSON
+\endcode
 */
 
 /*! Macros used for defining and registering a test */
@@ -120,12 +168,16 @@
 #define AST_TEST_DEFINE(hdr) static enum ast_test_result_state hdr(struct ast_test_info *info, enum ast_test_command cmd, struct ast_test *test)
 #define AST_TEST_REGISTER(cb) ast_test_register(cb)
 #define AST_TEST_UNREGISTER(cb) ast_test_unregister(cb)
+#define AST_BENCH_REGISTER(info) ast_bench_register(info)
+#define AST_BENCH_UNREGISTER(info) ast_bench_unregister(info)
 
 #else
 
 #define AST_TEST_DEFINE(hdr) static enum ast_test_result_state attribute_unused hdr(struct ast_test_info *info, enum ast_test_command cmd, struct ast_test *test)
 #define AST_TEST_REGISTER(cb)
 #define AST_TEST_UNREGISTER(cb)
+#define AST_BENCH_REGISTER(info)
+#define AST_BENCH_UNREGISTER(info)
 #define ast_test_status_update(a,b,c...)
 #define ast_test_debug(test, fmt, ...)	ast_cli		/* Dummy function that should not be called. */
 
@@ -356,6 +408,57 @@ int ast_test_register_init(const char *category, ast_test_init_cb_t *cb);
  */
 int ast_test_register_cleanup(const char *category, ast_test_cleanup_cb_t *cb);
 
+/*!
+ * \brief Describes a benchmark
+ */
+struct ast_bench_info {
+	/*! \brief name of benchmark, unique to category */
+	const char *name;
+	/*! \brief benchmark category, with leading and trailing slashes like test categories */
+	const char *category;
+	/*! \brief Short summary of the benchmark, without a newline */
+	const char *summary;
+	/*!
+	 * \brief Set up what the operation works on, before the warm up
+	 *
+	 * \return The data passed to run and teardown
+	 * \retval NULL on failure, failing the benchmark
+	 *
+	 * \note Optional.  The data passed is NULL if there is no setup.
+	 */
+	void *(*setup)(void);
+	/*! \brief Do the operation benchmarked once */
+	void (*run)(void *data);
+	/*! \brief Tear down what the operation worked on, optional */
+	void (*teardown)(void *data);
+	/*! \brief Iterations timed, 10000 if zero */
+	unsigned int iterations;
+	/*! \brief Operations in each timed iteration, 1 if zero */
+	unsigned int batch;
+	/*! \brief Iterations run before timing, a tenth of the iterations if zero */
+	unsigned int warmup;
+};
+
+/*!
+ * \brief Register a benchmark
+ *
+ * \param info The benchmark, which must stay valid until unregistered
+ *
+ * \retval 0 success
+ * \retval -1 failure
+ */
+int ast_bench_register(const struct ast_bench_info *info);
+
+/*!
+ * \brief Unregister a benchmark
+ *
+ * \param info The benchmark registered
+ *
+ * \retval 0 success
+ * \retval -1 failure
+ */
+int ast_bench_unregister(const struct ast_bench_info *info);
+
 
 /*!
  * \brief Unit test debug output.
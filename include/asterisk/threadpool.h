@@ -122,6 +122,22 @@ struct ast_threadpool_options {
 	 * a thread completes
 	 */
 	void (*thread_end)(void);
+	/*!
+	 * \brief Use per-worker task queues with work stealing
+	 *
+	 * Normally every worker thread takes tasks from the pool's single
+	 * task queue.  When this is non-zero tasks are instead spread across
+	 * a task queue per CPU.  Each worker has a home queue and steals
+	 * from the others when its own is empty.  Tasks pushed by a worker
+	 * of the pool are kept on that worker's home queue.
+	 *
+	 * \note Tasks are not executed in FIFO order across the pool in this
+	 * mode.  Serializers are unaffected since they have their own queue.
+	 *
+	 * \note The listener's task_pushed callback is only called when the
+	 * pool may need to activate idle threads or grow, not for every task.
+	 */
+	int work_stealing;
 };
 
 /*!
@@ -167,6 +167,11 @@ struct ast_translator {
 	                                       /*!< cleanup private data, if needed
 	                                        *   (often unnecessary). */
 
+	void (*reset)(struct ast_trans_pvt *pvt);
+	                                       /*!< Return private data to the state
+	                                        *   newpvt left it in, so the pvt can
+	                                        *   be pooled and reused. */
+
 	struct ast_frame * (*sample)(void);    /*!< Generate an example frame */
 
 	/*!\brief size of outbuf, in samples. Leave it 0 if you want the framein
@@ -309,6 +314,9 @@ int ast_translator_best_choice(struct ast_format_cap *dst_cap,
  * \param src source source format
  * \return ast_trans_pvt on success
  * \retval NULL on failure
+ *
+ * \note Paths are taken from a pool of idle paths for the same source and
+ * destination formats when one is available.
  * */
 struct ast_trans_pvt *ast_translator_build_path(struct ast_format *dest, struct ast_format *source);
 
@@ -316,6 +324,9 @@ struct ast_trans_pvt *ast_translator_build_path(struct ast_format *dest, struct
  * \brief Frees a translator path
  * Frees the given translator path structure
  * \param tr translator path to get rid of
+ *
+ * \note If every translator in the path can be reset the path is returned
+ * to the pool to be used again by ast_translator_build_path().
  */
 void ast_translator_free_path(struct ast_trans_pvt *tr);
 
@@ -333,6 +344,22 @@ void ast_translator_free_path(struct ast_trans_pvt *tr);
  */
 struct ast_frame *ast_translate(struct ast_trans_pvt *tr, struct ast_frame *f, int consume);
 
+/*!
+ * \brief translates a list of frames
+ * Translate every frame in a list linked through frame_list, keeping the frames
+ * separate rather than combining them into a single input as ast_translate() does.
+ * Voice frames without delivery times are run through each step of the translation
+ * path in turn, so each translator handles the whole list at once, and each output
+ * carries the timing information of the input it came from.  Other frames are
+ * translated one at a time by ast_translate().
+ * \param path tr translator structure to use for translation
+ * \param frames list of frames to translate
+ * \param consume Whether or not to free the original frames
+ * \return a list of frames of the new translation format on success
+ * \retval NULL if no frames were produced
+ */
+struct ast_frame *ast_translate_list(struct ast_trans_pvt *tr, struct ast_frame *frames, int consume);
+
 /*!
  * \brief Returns the number of steps required to convert from 'src' to 'dest'.
  * \param dest destination format
@@ -515,6 +515,35 @@ static force_inline void ast_slinear_saturated_divide_float(short *input, float
 		*input = (short) res;
 }
 
+/*!
+ * \brief Add a buffer of signed linear samples to another with saturation
+ *
+ * Equivalent to calling ast_slinear_saturated_add() on each sample,
+ * using vector instructions when the CPU supports them.
+ *
+ * \param input Samples to add to, receives the result
+ * \param value Samples to add
+ * \param samples Number of samples in each buffer
+ */
+void ast_slinear_saturated_add_buf(short *input, const short *value, size_t samples);
+
+/*!
+ * \brief Subtract a buffer of signed linear samples from another with saturation
+ *
+ * Equivalent to calling ast_slinear_saturated_subtract() on each sample,
+ * using vector instructions when the CPU supports them.
+ *
+ * \param input Samples to subtract from, receives the result
+ * \param value Samples to subtract
+ * \param samples Number of samples in each buffer
+ */
+void ast_slinear_saturated_subtract_buf(short *input, const short *value, size_t samples);
+
+/*!
+ * \brief Get the name of the signed linear buffer mixing implementation in use
+ */
+const char *ast_slinear_mix_implementation(void);
+
 #ifdef localtime_r
 #undef localtime_r
 #endif
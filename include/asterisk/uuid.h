@@ -65,6 +65,21 @@ char *ast_uuid_to_str(struct ast_uuid *uuid, char *buf, size_t size);
  */
 char *ast_uuid_generate_str(char *buf, size_t size);
 
+/*!
+ * \brief Generate a UUID string ordered by the time it was generated
+ *
+ * The UUID is a version 7 UUID, led by the milliseconds since the epoch
+ * and followed by random bits.  UUIDs generated later sort after those
+ * generated in earlier milliseconds, which keeps database indexes of them
+ * compact.  UUIDs generated within the same millisecond are in no order.
+ *
+ * \param buf The buffer where the UUID string will be stored
+ * \param size The size of the buffer. Must be at least AST_UUID_STR_LEN.
+ *
+ * \return The UUID string (a pointer to buf)
+ */
+char *ast_uuid_generate_time_ordered_str(char *buf, size_t size);
+
 /*!
  * \brief Convert a string to a UUID
  *
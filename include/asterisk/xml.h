@@ -52,6 +52,20 @@ int ast_xml_finish(void);
  */
 struct ast_xml_doc *ast_xml_open(char *filename);
 
+/*!
+ * \brief Open an XML document that resides in memory as if it were read from a file.
+ *
+ * Like ast_xml_open(), XML inclusions are processed and a stylesheet the
+ * document asks for is applied, both relative to the given filename.
+ *
+ * \param buffer The address where the document is stored
+ * \param size The number of bytes in the document
+ * \param filename The path the document is taken to be read from
+ * \retval NULL on error.
+ * \return The ast_xml_doc reference to the open document.
+ */
+struct ast_xml_doc *ast_xml_open_memory(const char *buffer, size_t size, const char *filename);
+
 /*!
  * \brief Create a XML document.
  * \retval NULL on error.
@@ -80,6 +80,17 @@ struct ast_xml_doc_item {
 	AST_LIST_ENTRY(ast_xml_doc_item) next;
 };
 
+/*!
+ * \brief Whether the XML documentation is loaded lazily
+ *
+ * When it is, documentation is only parsed when asked for, and whoever
+ * registers documented items should build their documentation when it
+ * is first shown rather than at registration.
+ *
+ * \retval non-zero if the documentation is loaded lazily
+ */
+int ast_xmldoc_lazy(void);
+
 /*! \brief Execute an XPath query on the loaded XML documentation
  * \param fmt The XPath query string to execute
  * \param ... Variable printf style format arguments
@@ -48,6 +48,7 @@
 #include "asterisk/stringfields.h"
 #include "asterisk/pbx.h"
 #include "asterisk/stasis.h"
+#include "asterisk/vector.h"
 
 /*
  * As per RFC 3920 - section 3.1, the maximum length for a full Jabber ID
@@ -113,6 +114,9 @@ struct ast_xmpp_buddy {
 	char id[XMPP_MAX_JIDLEN];        /*!< JID of the buddy */
 	struct ao2_container *resources; /*!< Resources for the buddy */
 	unsigned int subscribe:1;        /*!< Need to subscribe to get their status */
+	unsigned int devstate_queued:1;  /*!< Queued on the client for its device state to be published */
+	int devstate;                    /*!< Device state last published, -1 before the first */
+	int devstate_new;                /*!< Device state to publish when the queue is flushed */
 };
 
 /*! \brief XMPP Client Connection */
@@ -146,6 +150,8 @@ struct ast_xmpp_client {
 	struct stasis_subscription *device_state_sub;
 	/*! The endpoint associated with this client */
 	struct ast_endpoint *endpoint;
+	/*! Buddies whose presence changed, published once no more data is waiting */
+	AST_VECTOR(, struct ast_xmpp_buddy *) devstate_queue;
 };
 
 /*!
@@ -47,6 +47,7 @@
 #include "asterisk/abstract_jb.h"
 #include "fixedjitterbuf.h"
 #include "jitterbuf.h"
+#include "stretchjitterbuf.h"
 
 /*! Internal jb flags */
 enum {
@@ -82,6 +83,17 @@ static int jb_remove_adaptive(void *jb, struct ast_frame **fout);
 static void jb_force_resynch_adaptive(void *jb);
 static void jb_empty_and_reset_adaptive(void *jb);
 static int jb_is_late_adaptive(void *jb, long ts);
+/* stretch */
+static void *jb_create_stretch(struct ast_jb_conf *general_config);
+static void jb_destroy_stretch(void *jb);
+static int jb_put_first_stretch(void *jb, struct ast_frame *fin, long now);
+static int jb_put_stretch(void *jb, struct ast_frame *fin, long now);
+static int jb_get_stretch(void *jb, struct ast_frame **fout, long now, long interpl);
+static long jb_next_stretch(void *jb);
+static int jb_remove_stretch(void *jb, struct ast_frame **fout);
+static void jb_force_resynch_stretch(void *jb);
+static void jb_empty_and_reset_stretch(void *jb);
+static int jb_is_late_stretch(void *jb, long ts);
 
 /* Available jb implementations */
 static const struct ast_jb_impl avail_impl[] = {
@@ -112,6 +124,20 @@ static const struct ast_jb_impl avail_impl[] = {
 		.force_resync = jb_force_resynch_adaptive,
 		.empty_and_reset = jb_empty_and_reset_adaptive,
 		.is_late = jb_is_late_adaptive,
+	},
+	{
+		.name = "stretch",
+		.type = AST_JB_STRETCH,
+		.create = jb_create_stretch,
+		.destroy = jb_destroy_stretch,
+		.put_first = jb_put_first_stretch,
+		.put = jb_put_stretch,
+		.get = jb_get_stretch,
+		.next = jb_next_stretch,
+		.remove = jb_remove_stretch,
+		.force_resync = jb_force_resynch_stretch,
+		.empty_and_reset = jb_empty_and_reset_stretch,
+		.is_late = jb_is_late_stretch,
 	}
 };
 
@@ -833,6 +859,70 @@ static int jb_is_late_adaptive(void *jb, long ts)
 	return jb_is_late(jb, ts);
 }
 
+/* stretch */
+
+static void *jb_create_stretch(struct ast_jb_conf *general_config)
+{
+	jb_conf jbconf;
+
+	jbconf.max_jitterbuf = general_config->max_size;
+	jbconf.resync_threshold = general_config->resync_threshold;
+	jbconf.max_contig_interp = 10;
+	jbconf.target_extra = general_config->target_extra;
+
+	return stretch_jb_new(&jbconf);
+}
+
+static void jb_destroy_stretch(void *jb)
+{
+	stretch_jb_destroy(jb);
+}
+
+static int jb_put_first_stretch(void *jb, struct ast_frame *fin, long now)
+{
+	return jb_put_stretch(jb, fin, now);
+}
+
+static int jb_put_stretch(void *jb, struct ast_frame *fin, long now)
+{
+	return adaptive_to_abstract_code[stretch_jb_put(jb, fin, now)];
+}
+
+static int jb_get_stretch(void *jb, struct ast_frame **fout, long now, long interpl)
+{
+	return adaptive_to_abstract_code[stretch_jb_get(jb, fout, now, interpl)];
+}
+
+static long jb_next_stretch(void *jb)
+{
+	return stretch_jb_next(jb);
+}
+
+static int jb_remove_stretch(void *jb, struct ast_frame **fout)
+{
+	return adaptive_to_abstract_code[stretch_jb_remove(jb, fout)];
+}
+
+static void jb_force_resynch_stretch(void *jb)
+{
+}
+
+static void jb_empty_and_reset_stretch(void *jb)
+{
+	struct ast_frame *f;
+
+	while (stretch_jb_remove(jb, &f) == JB_OK) {
+		ast_frfree(f);
+	}
+
+	stretch_jb_reset(jb);
+}
+
+static int jb_is_late_stretch(void *jb, long ts)
+{
+	return stretch_jb_is_late(jb, ts);
+}
+
 #define DEFAULT_TIMER_INTERVAL 20
 #define DEFAULT_SIZE  200
 #define DEFAULT_TARGET_EXTRA  40
@@ -1237,6 +1327,8 @@ static int jb_framedata_init(struct jb_framedata *framedata, struct ast_jb_conf
 			jb_impl_type = AST_JB_FIXED;
 		} else if (!strcasecmp(jb_conf->impl, "adaptive")) {
 			jb_impl_type = AST_JB_ADAPTIVE;
+		} else if (!strcasecmp(jb_conf->impl, "stretch")) {
+			jb_impl_type = AST_JB_STRETCH;
 		} else {
 			ast_log(LOG_WARNING, "Unknown Jitterbuffer type %s. Failed to create jitterbuffer.\n", jb_conf->impl);
 			return -1;
@@ -241,6 +241,7 @@ struct ast_acl_list *ast_free_acl_list(struct ast_acl_list *acl_list)
 	AST_LIST_LOCK(acl_list);
 	while ((current = AST_LIST_REMOVE_HEAD(acl_list, list))) {
 		ast_free_ha(current->acl);
+		ast_ha_table_free(current->table);
 		ast_free(current);
 	}
 	AST_LIST_UNLOCK(acl_list);
@@ -478,6 +479,11 @@ void ast_append_acl(const char *sense, const char *stuff, struct ast_acl_list **
 		/* With the proper ACL set for modification, we can just pass this off to the ast_ha append function. */
 		acl->acl = ast_append_ha(sense, stuff, acl->acl, error);
 
+		/* The rules changed, so they need compiling again */
+		ast_ha_table_free(acl->table);
+		acl->table = NULL;
+		acl->compiled = 0;
+
 		AST_LIST_UNLOCK(working_list);
 		return;
 	}
@@ -778,7 +784,15 @@ static enum ast_acl_sense ast_apply_acl_internal(struct ast_acl_list *acl_list,
 		}
 
 		if (acl->acl) {
-			if (ast_apply_ha(acl->acl, addr) == AST_SENSE_DENY) {
+			enum ast_acl_sense sense;
+
+			if (!acl->compiled) {
+				/* The list is locked, so this is the only thread compiling it */
+				acl->table = ast_ha_compile(acl->acl);
+				acl->compiled = 1;
+			}
+			sense = acl->table ? ast_ha_table_apply(acl->table, addr) : ast_apply_ha(acl->acl, addr);
+			if (sense == AST_SENSE_DENY) {
 				if (log_prefix) {
 					ast_log(LOG_NOTICE, "%sRejecting '%s' due to a failure to pass ACL '%s'\n",
 							log_prefix, ast_sockaddr_stringify_addr(addr),
@@ -872,6 +886,268 @@ enum ast_acl_sense ast_apply_ha(const struct ast_ha *ha, const struct ast_sockad
 	return res;
 }
 
+/*! \brief An address, as a 128 bit number */
+struct ha_key {
+	uint64_t hi;
+	uint64_t lo;
+};
+
+/*! \brief Addresses from start up to the start of the next range get sense */
+struct ha_range {
+	struct ha_key start;
+	enum ast_acl_sense sense;
+};
+
+/*! \brief A rule, as the range of addresses it matches */
+struct ha_rule {
+	struct ha_key start;
+	struct ha_key end;
+	enum ast_acl_sense sense;
+};
+
+struct ast_ha_table {
+	/*! \brief The ranges of the IPv4 and IPv6 addresses, sorted by their start */
+	struct ha_range *ranges[2];
+	/*! \brief How many ranges each has */
+	size_t count[2];
+};
+
+static int ha_key_cmp(const struct ha_key *a, const struct ha_key *b)
+{
+	if (a->hi != b->hi) {
+		return a->hi < b->hi ? -1 : 1;
+	}
+	if (a->lo != b->lo) {
+		return a->lo < b->lo ? -1 : 1;
+	}
+	return 0;
+}
+
+static int ha_key_sort(const void *a, const void *b)
+{
+	return ha_key_cmp(a, b);
+}
+
+/*!
+ * \internal
+ * \brief Get the key of an address
+ *
+ * \retval 0 for IPv4 addresses
+ * \retval 1 for IPv6 addresses
+ * \retval -1 otherwise
+ */
+static int ha_key_get(const struct ast_sockaddr *addr, struct ha_key *key)
+{
+	const uint8_t *bytes;
+	int len;
+	int family;
+	int i;
+
+	if (ast_sockaddr_is_ipv4(addr)) {
+		bytes = (const uint8_t *) &((const struct sockaddr_in *) &addr->ss)->sin_addr;
+		len = 4;
+		family = 0;
+	} else if (ast_sockaddr_is_ipv6(addr)) {
+		bytes = (const uint8_t *) &((const struct sockaddr_in6 *) &addr->ss)->sin6_addr;
+		len = 16;
+		family = 1;
+	} else {
+		return -1;
+	}
+
+	key->hi = 0;
+	key->lo = 0;
+	for (i = 0; i < len; i++) {
+		key->hi = (key->hi << 8) | (key->lo >> 56);
+		key->lo = (key->lo << 8) | bytes[i];
+	}
+
+	return family;
+}
+
+/*! \brief Whether a key is a netmask of leading ones, for an address of a number of bits */
+static int ha_key_is_prefix(const struct ha_key *mask, int bits)
+{
+	/* Inverted, a prefix mask is a run of trailing ones, so adding one clears them all */
+	struct ha_key inverted = {
+		.hi = bits == 128 ? ~mask->hi : 0,
+		.lo = bits == 128 ? ~mask->lo : ~mask->lo & 0xffffffff,
+	};
+	struct ha_key next = {
+		.hi = inverted.hi + (inverted.lo == UINT64_MAX),
+		.lo = inverted.lo + 1,
+	};
+
+	return !(next.hi & inverted.hi) && !(next.lo & inverted.lo);
+}
+
+/*! \brief Compile the rules of an address family into ranges */
+static int ha_table_build(struct ast_ha_table *table, int family, const struct ha_rule *rules, size_t count)
+{
+	struct ha_key *starts;
+	size_t bounds = 0;
+	size_t i;
+	size_t j;
+
+	/* Every rule starts a range and starts another after it ends, and the space begins one */
+	starts = ast_malloc((count * 2 + 1) * sizeof(*starts));
+	table->ranges[family] = ast_malloc((count * 2 + 1) * sizeof(*table->ranges[family]));
+	if (!starts || !table->ranges[family]) {
+		ast_free(starts);
+		return -1;
+	}
+
+	starts[bounds++] = (struct ha_key) { 0, 0 };
+	for (i = 0; i < count; i++) {
+		starts[bounds++] = rules[i].start;
+		if (rules[i].end.lo != UINT64_MAX || rules[i].end.hi != (family ? UINT64_MAX : 0)) {
+			starts[bounds].hi = rules[i].end.hi + (rules[i].end.lo == UINT64_MAX);
+			starts[bounds].lo = rules[i].end.lo + 1;
+			bounds++;
+		}
+	}
+	qsort(starts, bounds, sizeof(*starts), ha_key_sort);
+
+	for (i = 0; i < bounds; i++) {
+		enum ast_acl_sense sense = AST_SENSE_ALLOW;
+
+		if (i && !ha_key_cmp(&starts[i], &starts[i - 1])) {
+			continue;
+		}
+
+		/* As in ast_apply_ha(), the last rule matching decides */
+		for (j = count; j--;) {
+			if (ha_key_cmp(&rules[j].start, &starts[i]) <= 0 && ha_key_cmp(&starts[i], &rules[j].end) <= 0) {
+				sense = rules[j].sense;
+				break;
+			}
+		}
+
+		if (table->count[family] && table->ranges[family][table->count[family] - 1].sense == sense) {
+			continue;
+		}
+		table->ranges[family][table->count[family]].start = starts[i];
+		table->ranges[family][table->count[family]].sense = sense;
+		table->count[family]++;
+	}
+
+	ast_free(starts);
+
+	return 0;
+}
+
+struct ast_ha_table *ast_ha_compile(const struct ast_ha *ha)
+{
+	struct ast_ha_table *table;
+	struct ha_rule *rules[2];
+	size_t count[2] = { 0, 0 };
+	const struct ast_ha *current;
+	size_t total = 0;
+	int family;
+
+	for (current = ha; current; current = current->next) {
+		total++;
+	}
+
+	table = ast_calloc(1, sizeof(*table));
+	rules[0] = ast_malloc(total * sizeof(*rules[0]) + 1);
+	rules[1] = ast_malloc(total * sizeof(*rules[1]) + 1);
+	if (!table || !rules[0] || !rules[1]) {
+		goto failure;
+	}
+
+	for (current = ha; current; current = current->next) {
+		struct ha_key start;
+		struct ha_key mask;
+		struct ha_rule *rule;
+
+		family = ha_key_get(&current->addr, &start);
+		if (family < 0 || ast_sockaddr_port(&current->addr)
+			|| ha_key_get(&current->netmask, &mask) != family
+			|| !ha_key_is_prefix(&mask, family ? 128 : 32)) {
+			/* Only ast_apply_ha() can apply this rule */
+			goto failure;
+		}
+		if ((start.hi & ~mask.hi) || (start.lo & ~mask.lo)) {
+			/* The address has bits outside the netmask, so nothing matches it */
+			continue;
+		}
+
+		rule = &rules[family][count[family]++];
+		rule->start = start;
+		rule->end.hi = rule->start.hi | (family ? ~mask.hi : 0);
+		rule->end.lo = rule->start.lo | (family ? ~mask.lo : ~mask.lo & 0xffffffff);
+		rule->sense = current->sense;
+	}
+
+	for (family = 0; family < 2; family++) {
+		if (ha_table_build(table, family, rules[family], count[family])) {
+			goto failure;
+		}
+	}
+
+	ast_free(rules[0]);
+	ast_free(rules[1]);
+
+	return table;
+
+failure:
+	ast_free(rules[0]);
+	ast_free(rules[1]);
+	ast_ha_table_free(table);
+
+	return NULL;
+}
+
+enum ast_acl_sense ast_ha_table_apply(const struct ast_ha_table *table, const struct ast_sockaddr *addr)
+{
+	struct ast_sockaddr mapped_addr;
+	const struct ha_range *ranges;
+	struct ha_key key;
+	size_t low = 0;
+	size_t high;
+	int family;
+
+	if (ast_sockaddr_is_ipv4_mapped(addr)) {
+		/* IPv4 rules apply to IPv4-mapped addresses, and IPv6 rules do not */
+		if (!ast_sockaddr_ipv4_mapped(addr, &mapped_addr)) {
+			return AST_SENSE_ALLOW;
+		}
+		addr = &mapped_addr;
+	}
+
+	family = ha_key_get(addr, &key);
+	if (family < 0) {
+		return AST_SENSE_ALLOW;
+	}
+
+	/* Find the last range starting at or before the address, the first starts at 0 */
+	ranges = table->ranges[family];
+	high = table->count[family];
+	while (high - low > 1) {
+		size_t middle = low + (high - low) / 2;
+
+		if (ha_key_cmp(&ranges[middle].start, &key) <= 0) {
+			low = middle;
+		} else {
+			high = middle;
+		}
+	}
+
+	return ranges[low].sense;
+}
+
+void ast_ha_table_free(struct ast_ha_table *table)
+{
+	if (!table) {
+		return;
+	}
+
+	ast_free(table->ranges[0]);
+	ast_free(table->ranges[1]);
+	ast_free(table);
+}
+
 static int resolve_first(struct ast_sockaddr *addr, const char *name, int flag,
 			 int family)
 {
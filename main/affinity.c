@@ -0,0 +1,233 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Thread CPU affinity
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "asterisk/_private.h"
+#include "asterisk/affinity.h"
+#include "asterisk/logger.h"
+#include "asterisk/strings.h"
+#include "asterisk/utils.h"
+
+/*!
+ * \brief The CPUs set aside for a class of threads
+ *
+ * These are only set while asterisk.conf is loaded, before the threads
+ * which use them start.
+ */
+struct thread_affinity {
+	/*! The option of asterisk.conf */
+	const char *option;
+	/*! The value of the option, empty for any CPU */
+	char value[128];
+#ifdef __linux__
+	/*! The CPUs, in the order workers of a pool are spread over them */
+	int cpus[CPU_SETSIZE];
+	/*! How many CPUs there are, 0 for any CPU */
+	int count;
+	cpu_set_t set;
+#endif
+};
+
+static struct thread_affinity thread_affinities[] = {
+	[AST_THREAD_AFFINITY_MEDIA] = { .option = "media_cpus", },
+	[AST_THREAD_AFFINITY_SIGNALING] = { .option = "signaling_cpus", },
+};
+
+#ifdef __linux__
+/*!
+ * \internal
+ * \brief Parse a list of CPUs, such as 0-3,8,10-11
+ *
+ * \retval 0 on success
+ * \retval -1 if the list is not valid
+ */
+static int thread_affinity_parse_list(struct thread_affinity *affinity, char *list)
+{
+	char *range;
+
+	while ((range = strsep(&list, ","))) {
+		int first;
+		int last;
+		int cpu;
+
+		range = ast_strip(range);
+		if (ast_strlen_zero(range)) {
+			continue;
+		}
+		if (sscanf(range, "%30d-%30d", &first, &last) != 2) {
+			if (sscanf(range, "%30d", &first) != 1) {
+				return -1;
+			}
+			last = first;
+		}
+		if (first < 0 || last < first || last >= CPU_SETSIZE) {
+			return -1;
+		}
+		for (cpu = first; cpu <= last; cpu++) {
+			if (!CPU_ISSET(cpu, &affinity->set)) {
+				CPU_SET(cpu, &affinity->set);
+				affinity->cpus[affinity->count++] = cpu;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Parse the CPUs of a NUMA node, as listed by the kernel
+ *
+ * \retval 0 on success
+ * \retval -1 if the node does not exist
+ */
+static int thread_affinity_parse_node(struct thread_affinity *affinity, unsigned int node)
+{
+	char path[64];
+	char list[1024];
+	FILE *file;
+	int res = -1;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+	file = fopen(path, "r");
+	if (!file) {
+		return -1;
+	}
+	if (fgets(list, sizeof(list), file)) {
+		res = thread_affinity_parse_list(affinity, list);
+	}
+	fclose(file);
+
+	return res;
+}
+#endif
+
+int ast_thread_affinity_set_option(const char *option, const char *value)
+{
+	struct thread_affinity *affinity = NULL;
+	int i;
+#ifdef __linux__
+	char *list = ast_strdupa(value);
+	char *node;
+	int res = 0;
+#endif
+
+	for (i = 0; i < ARRAY_LEN(thread_affinities); i++) {
+		if (!strcasecmp(thread_affinities[i].option, option)) {
+			affinity = &thread_affinities[i];
+		}
+	}
+	if (!affinity) {
+		return -1;
+	}
+
+#ifdef __linux__
+	CPU_ZERO(&affinity->set);
+	affinity->count = 0;
+
+	/* A node, or several, may be given as node0 or node0,node1 */
+	while (!res && (node = strsep(&list, ","))) {
+		unsigned int number;
+
+		node = ast_strip(node);
+		if (sscanf(node, "node%30u", &number) == 1) {
+			res = thread_affinity_parse_node(affinity, number);
+		} else if (!ast_strlen_zero(node)) {
+			res = thread_affinity_parse_list(affinity, node);
+		}
+	}
+
+	if (res) {
+		ast_log(LOG_WARNING, "Invalid %s '%s', threads may run on any CPU\n", affinity->option, value);
+		CPU_ZERO(&affinity->set);
+		affinity->count = 0;
+	}
+	ast_copy_string(affinity->value, affinity->count ? value : "", sizeof(affinity->value));
+#else
+	if (!ast_strlen_zero(value)) {
+		ast_log(LOG_WARNING, "CPU affinity is not supported on this platform, ignoring %s\n", affinity->option);
+	}
+#endif
+
+	return 0;
+}
+
+int ast_thread_affinity_cpu(enum ast_thread_affinity_class thread_class, unsigned int index)
+{
+#ifdef __linux__
+	struct thread_affinity *affinity = &thread_affinities[thread_class];
+	long cpus;
+
+	if (affinity->count) {
+		return affinity->cpus[index % affinity->count];
+	}
+
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return cpus > 0 ? index % cpus : 0;
+#else
+	return -1;
+#endif
+}
+
+int ast_thread_affinity_apply(enum ast_thread_affinity_class thread_class, int index)
+{
+#ifdef __linux__
+	struct thread_affinity *affinity = &thread_affinities[thread_class];
+	cpu_set_t set;
+	int cpu;
+
+	if (index < 0) {
+		if (!affinity->count) {
+			return 0;
+		}
+		if (pthread_setaffinity_np(pthread_self(), sizeof(affinity->set), &affinity->set)) {
+			ast_log(LOG_WARNING, "Could not keep thread on %s %s\n", affinity->option, affinity->value);
+			return -1;
+		}
+		return 0;
+	}
+
+	cpu = ast_thread_affinity_cpu(thread_class, index);
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+		ast_log(LOG_WARNING, "Could not pin thread to CPU %d\n", cpu);
+		return -1;
+	}
+	return 0;
+#else
+	return index < 0 ? 0 : -1;
+#endif
+}
+
+const char *ast_thread_affinity_describe(enum ast_thread_affinity_class thread_class)
+{
+	return S_OR(thread_affinities[thread_class].value, "(any)");
+}
@@ -131,6 +131,44 @@ ssize_t ast_alertpipe_write(int alert_pipe[2])
 	return write(alert_pipe[1], &tmp, sizeof(tmp)) != sizeof(tmp);
 }
 
+ssize_t ast_alertpipe_write_count(int alert_pipe[2], unsigned int count)
+{
+	uint64_t tmp[16];
+	unsigned int chunk;
+	unsigned int i;
+
+	if (!ast_alertpipe_writable(alert_pipe)) {
+		errno = EBADF;
+		return 0;
+	}
+
+	/* preset errno in case returned size does not match */
+	errno = EPIPE;
+
+#ifdef HAVE_EVENTFD
+
+	if (alert_pipe[0] == alert_pipe[1]) {
+		/* The events of an eventfd are a counter, reads take one at a time */
+		tmp[0] = count;
+		return count && write(alert_pipe[1], tmp, sizeof(tmp[0])) != sizeof(tmp[0]);
+	}
+
+#endif
+
+	for (i = 0; i < ARRAY_LEN(tmp); i++) {
+		tmp[i] = 1;
+	}
+	while (count) {
+		chunk = MIN(count, ARRAY_LEN(tmp));
+		if (write(alert_pipe[1], tmp, chunk * sizeof(tmp[0])) != chunk * sizeof(tmp[0])) {
+			return 1;
+		}
+		count -= chunk;
+	}
+
+	return 0;
+}
+
 ast_alert_status_t ast_alertpipe_flush(int alert_pipe[2])
 {
 	int bytes_read;
@@ -150,6 +150,7 @@
 #include "asterisk.h"
 
 #include "asterisk/_private.h"
+#include "asterisk/affinity.h"
 
 #undef sched_setscheduler
 #undef setpriority
@@ -557,7 +558,23 @@ static char *handle_show_settings(struct ast_cli_entry *e, int cmd, struct ast_c
 	ast_cli(a->fd, "  Min DTMF duration::          %u\n", option_dtmfminduration);
 #if !defined(LOW_MEMORY)
 	ast_cli(a->fd, "  Cache media frames:          %s\n", ast_opt_cache_media_frames ? "Enabled" : "Disabled");
+	ast_cli(a->fd, "  Media frame cache size:      %u\n", ast_option_frame_cache_size);
 #endif
+	ast_cli(a->fd, "  AstDB read connections:      %u\n", ast_option_astdb_read_connections);
+	ast_cli(a->fd, "  AstDB cached families:       %s\n", S_OR(ast_option_astdb_cached_families, "(none)"));
+	ast_cli(a->fd, "  AstDB cache size:            %u KB\n", ast_option_astdb_cache_size);
+	ast_cli(a->fd, "  Prompt cache size:           %u KB\n", ast_option_prompt_cache_size);
+	ast_cli(a->fd, "  Prompt compiler:             %s\n", ast_option_prompt_compile ? "Enabled" : "Disabled");
+	ast_cli(a->fd, "  Map sound files:             %s\n", ast_option_map_sound_files ? "Enabled" : "Disabled");
+	ast_cli(a->fd, "  MWI coalescing window:       %u ms\n", ast_option_mwi_coalesce);
+	ast_cli(a->fd, "  Security event window:       %u s\n", ast_option_security_event_window);
+	ast_cli(a->fd, "  Security event sample:       %u\n", ast_option_security_event_sample);
+	ast_cli(a->fd, "  Startup profile:             %s\n", ast_option_startup_profile ? "Enabled" : "Disabled");
+	ast_cli(a->fd, "  Latency histograms:          %s\n", ast_option_latency_histograms ? "Enabled" : "Disabled");
+	ast_cli(a->fd, "  Lock contention threshold:   %u us\n", ast_lock_contention_threshold);
+	ast_cli(a->fd, "  Align timers:                %s\n", ast_option_align_timers ? "Enabled" : "Disabled");
+	ast_cli(a->fd, "  Media CPUs:                  %s\n", ast_thread_affinity_describe(AST_THREAD_AFFINITY_MEDIA));
+	ast_cli(a->fd, "  Signaling CPUs:              %s\n", ast_thread_affinity_describe(AST_THREAD_AFFINITY_SIGNALING));
 	ast_cli(a->fd, "  RTP use dynamic payloads:    %u\n", ast_option_rtpusedynamic);
 
 	if (ast_option_rtpptdynamic == AST_RTP_PT_LAST_REASSIGN) {
@@ -4061,8 +4078,19 @@ int main(int argc, char *argv[])
 	return 0;
 }
 
+/*! \brief When the startup phase being timed started, the end of the one before */
+static struct timeval startup_phase_start;
+
+static void startup_phase_done(const char *name)
+{
+	ast_startup_profile_record("core", name, startup_phase_start);
+	startup_phase_start = ast_tvnow();
+}
+
 static inline void check_init(int init_result, const char *name)
 {
+	startup_phase_done(name);
+
 	if (init_result) {
 		if (ast_is_logger_initialized()) {
 			ast_log(LOG_ERROR, "%s initialization failed.  ASTERISK EXITING!\n%s", name, term_quit());
@@ -4083,7 +4111,7 @@ static void asterisk_daemon(int isroot, const char *runuser, const char *rungrou
 	char pbx_uuid[AST_UUID_STR_LEN];
 
 	/* Set time as soon as possible */
-	ast_lastreloadtime = ast_startuptime = ast_tvnow();
+	startup_phase_start = ast_lastreloadtime = ast_startuptime = ast_tvnow();
 
 	/* This needs to remain as high up in the initial start up as possible.
 	 * daemon causes a fork to occur, which has all sorts of unintended
@@ -4186,6 +4214,7 @@ static void asterisk_daemon(int isroot, const char *runuser, const char *rungrou
 #ifdef AST_XML_DOCS
 	/* Load XML documentation. */
 	ast_xmldoc_load_documentation();
+	startup_phase_done("XML Documentation");
 #endif
 
 	check_init(astdb_init(), "ASTdb");
@@ -4207,6 +4236,12 @@ static void asterisk_daemon(int isroot, const char *runuser, const char *rungrou
 	ast_builtins_init();
 
 	check_init(ast_utils_init(), "Utilities");
+	check_init(ast_startup_profile_init(), "Startup Profile");
+	check_init(ast_latency_init(), "Latency Histograms");
+	check_init(ast_lock_contention_init(), "Lock Contention");
+	check_init(ast_slinear_init(), "Signed Linear Mixing");
+	check_init(ast_stretch_jb_init(), "Time Stretching Jitterbuffer");
+	check_init(ast_frame_init(), "Frames");
 	check_init(ast_tps_init(), "Task Processor Core");
 	check_init(ast_fd_init(), "File Descriptor Debugging");
 	check_init(ast_pbx_init(), "ast_pbx_init");
@@ -4265,6 +4300,7 @@ static void asterisk_daemon(int isroot, const char *runuser, const char *rungrou
 	check_init(mwi_init(), "MWI Core");
 	check_init(devstate_init(), "Device State Core");
 	check_init(ast_msg_init(), "Messaging API");
+	check_init(ast_dial_init(), "Dial Batch Scheduler");
 	check_init(ast_channels_init(), "Channel");
 	check_init(ast_endpoint_init(), "Endpoints");
 	check_init(ast_pickup_init(), "Call Pickup");
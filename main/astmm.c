@@ -65,6 +65,8 @@
 
 #if defined(MALLOC_DEBUG) && !defined(STANDALONE) && !defined(STANDALONE2)
 #define __AST_DEBUG_MALLOC
+#elif defined(MALLOC_ACCOUNTING) && !defined(STANDALONE) && !defined(STANDALONE2)
+#define __AST_ACCOUNT_MALLOC
 #endif
 
 #define MALLOC_FAILURE_MSG \
@@ -1520,7 +1522,588 @@ void load_astmm_phase_2(void)
 	ast_register_cleanup(mm_atexit_ast);
 }
 
-#else	/* !defined(__AST_DEBUG_MALLOC) */
+#elif defined(__AST_ACCOUNT_MALLOC)
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "asterisk/cli.h"
+#include "asterisk/lock.h"
+#include "asterisk/strings.h"
+
+/*!
+ * \brief How many source files allocations are counted against, a power of two
+ *
+ * Allocations from files beyond these are counted against one more, shown
+ * as "(other)".
+ */
+#define MM_ACCOUNT_FILES 1024
+
+/*! \brief How much of the name of a source file is kept */
+#define MM_ACCOUNT_NAME 48
+
+/*! \brief How many source files each thread remembers the tag of, a power of two */
+#define MM_ACCOUNT_CACHE 64
+
+/*! \brief The header is this size, so the memory after it is aligned as malloc's */
+#define MM_ACCOUNT_HEADER_SIZE 16
+
+#define MM_ACCOUNT_MAGIC 0xacc0a7ed
+
+/*!
+ * \brief What precedes every accounted allocation
+ *
+ * Memory not allocated by these functions and freed by ast_free() has no
+ * magic number in front of it and is freed as it is, not accounted.
+ */
+struct mm_account_header {
+	/*! The size asked for */
+	size_t size;
+	/*! The source file the allocation is counted against */
+	uint32_t tag;
+	uint32_t magic;
+};
+
+/*!
+ * \brief The allocations counted by a thread
+ *
+ * Only the thread itself writes its counters, so counting takes no lock.
+ * Memory is often freed by another thread than the one which allocated it,
+ * so the counters of a single thread can go negative, only their sums over
+ * every thread mean anything.
+ */
+struct mm_account_thread {
+	struct mm_account_thread *prev;
+	struct mm_account_thread *next;
+	/*! The tags of the source files this thread allocated from last, by address */
+	struct {
+		const char *file;
+		unsigned int tag;
+	} cache[MM_ACCOUNT_CACHE];
+	int64_t allocations[MM_ACCOUNT_FILES + 1];
+	int64_t bytes[MM_ACCOUNT_FILES + 1];
+};
+
+/*!
+ * \brief The names of the source files, by tag
+ *
+ * The names are copied, as the module they point into may be unloaded
+ * while its allocations are still counted.  A tag is never given back.
+ */
+static char mm_account_files[MM_ACCOUNT_FILES + 1][MM_ACCOUNT_NAME];
+AST_MUTEX_DEFINE_STATIC_NOTRACKING(mm_account_files_lock);
+
+/*! \brief Every thread which counted allocations, and what the ones gone counted */
+static struct mm_account_thread *mm_account_threads;
+static struct mm_account_thread mm_account_retired;
+AST_MUTEX_DEFINE_STATIC_NOTRACKING(mm_account_threads_lock);
+
+static pthread_key_t mm_account_key;
+static pthread_once_t mm_account_once = PTHREAD_ONCE_INIT;
+
+/*!
+ * \internal
+ * \brief Find the tag of a source file, giving it one if it has none yet
+ *
+ * Only the name of the file is used, without its directory.
+ */
+static unsigned int mm_account_tag_find(const char *file)
+{
+	const char *name = strrchr(file, '/');
+	unsigned int hash = 0;
+	unsigned int i;
+	const char *c;
+
+	name = name ? name + 1 : file;
+	for (c = name; *c && c - name < MM_ACCOUNT_NAME - 1; c++) {
+		hash = hash * 31 + *c;
+	}
+
+	ast_mutex_lock(&mm_account_files_lock);
+	for (i = 0; i < MM_ACCOUNT_FILES; i++) {
+		unsigned int tag = (hash + i) & (MM_ACCOUNT_FILES - 1);
+
+		if (!mm_account_files[tag][0]) {
+			ast_copy_string(mm_account_files[tag], name, MM_ACCOUNT_NAME);
+			ast_mutex_unlock(&mm_account_files_lock);
+			return tag;
+		}
+		if (!strncmp(mm_account_files[tag], name, MM_ACCOUNT_NAME - 1)) {
+			ast_mutex_unlock(&mm_account_files_lock);
+			return tag;
+		}
+	}
+	ast_mutex_unlock(&mm_account_files_lock);
+
+	return MM_ACCOUNT_FILES;
+}
+
+static void mm_account_thread_destroy(void *data)
+{
+	struct mm_account_thread *thread = data;
+	unsigned int i;
+
+	ast_mutex_lock(&mm_account_threads_lock);
+	if (thread->prev) {
+		thread->prev->next = thread->next;
+	} else {
+		mm_account_threads = thread->next;
+	}
+	if (thread->next) {
+		thread->next->prev = thread->prev;
+	}
+	for (i = 0; i <= MM_ACCOUNT_FILES; i++) {
+		mm_account_retired.allocations[i] += thread->allocations[i];
+		mm_account_retired.bytes[i] += thread->bytes[i];
+	}
+	ast_mutex_unlock(&mm_account_threads_lock);
+
+	free(thread);
+}
+
+static void mm_account_key_create(void)
+{
+	pthread_key_create(&mm_account_key, mm_account_thread_destroy);
+}
+
+/*!
+ * \internal
+ * \brief Get the counters of the calling thread
+ *
+ * \retval NULL if the thread has none and none could be allocated
+ */
+static struct mm_account_thread *mm_account_thread_get(void)
+{
+	struct mm_account_thread *thread;
+
+	pthread_once(&mm_account_once, mm_account_key_create);
+	thread = pthread_getspecific(mm_account_key);
+	if (thread) {
+		return thread;
+	}
+
+	thread = calloc(1, sizeof(*thread));
+	if (!thread) {
+		return NULL;
+	}
+	if (pthread_setspecific(mm_account_key, thread)) {
+		free(thread);
+		return NULL;
+	}
+
+	ast_mutex_lock(&mm_account_threads_lock);
+	thread->next = mm_account_threads;
+	if (thread->next) {
+		thread->next->prev = thread;
+	}
+	mm_account_threads = thread;
+	ast_mutex_unlock(&mm_account_threads_lock);
+
+	return thread;
+}
+
+/*!
+ * \internal
+ * \brief Add to a counter of the calling thread
+ *
+ * The counter is read by other threads while it is written, only this
+ * thread writes it, so it need not be added to atomically.
+ */
+static inline void mm_account_counter_add(int64_t *counter, int64_t delta)
+{
+	__atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + delta, __ATOMIC_RELAXED);
+}
+
+/*!
+ * \internal
+ * \brief Count an allocation or a free against a source file
+ *
+ * \param tag The tag of the source file
+ * \param allocations 1 for an allocation, -1 for a free and 0 for a resize
+ * \param bytes How many bytes were allocated, negative for freed
+ */
+static void mm_account_count(unsigned int tag, int allocations, int64_t bytes)
+{
+	struct mm_account_thread *thread = mm_account_thread_get();
+
+	if (!thread) {
+		/* The thread is exiting or out of memory, count it against the ones gone */
+		ast_mutex_lock(&mm_account_threads_lock);
+		mm_account_retired.allocations[tag] += allocations;
+		mm_account_retired.bytes[tag] += bytes;
+		ast_mutex_unlock(&mm_account_threads_lock);
+		return;
+	}
+
+	mm_account_counter_add(&thread->allocations[tag], allocations);
+	mm_account_counter_add(&thread->bytes[tag], bytes);
+}
+
+/*!
+ * \internal
+ * \brief Get the tag of the source file an allocation is made from
+ *
+ * Each thread remembers the tags of the file names it was passed last by
+ * address, so the name is only hashed the first time.  After a module is
+ * unloaded another module may put a different file name at the same
+ * address, which is then counted against the old name until it is
+ * replaced in the cache.
+ */
+static unsigned int mm_account_tag(const char *file)
+{
+	struct mm_account_thread *thread;
+	unsigned int slot;
+
+	if (!file) {
+		return MM_ACCOUNT_FILES;
+	}
+
+	thread = mm_account_thread_get();
+	if (!thread) {
+		return mm_account_tag_find(file);
+	}
+
+	slot = ((uintptr_t) file >> 4) & (MM_ACCOUNT_CACHE - 1);
+	if (thread->cache[slot].file != file) {
+		thread->cache[slot].tag = mm_account_tag_find(file);
+		thread->cache[slot].file = file;
+	}
+
+	return thread->cache[slot].tag;
+}
+
+/*!
+ * \internal
+ * \brief Set up the header of a new allocation and count it
+ *
+ * \return The memory after the header
+ */
+static void *mm_account_alloced(struct mm_account_header *header, size_t size, const char *file)
+{
+	header->size = size;
+	header->tag = mm_account_tag(file);
+	header->magic = MM_ACCOUNT_MAGIC;
+	mm_account_count(header->tag, 1, size);
+
+	return (char *) header + MM_ACCOUNT_HEADER_SIZE;
+}
+
+/*!
+ * \internal
+ * \brief Get the header of an allocation
+ *
+ * \retval NULL if the memory was not allocated by these functions
+ */
+static struct mm_account_header *mm_account_header_get(void *ptr)
+{
+	struct mm_account_header *header = (void *) ((char *) ptr - MM_ACCOUNT_HEADER_SIZE);
+
+	return header->magic == MM_ACCOUNT_MAGIC ? header : NULL;
+}
+
+void *__ast_repl_calloc(size_t nmemb, size_t size, const char *file, int lineno, const char *func)
+{
+	struct mm_account_header *header;
+
+	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
+
+	if (nmemb && size > (SIZE_MAX - MM_ACCOUNT_HEADER_SIZE) / nmemb) {
+		return NULL;
+	}
+	header = calloc(1, MM_ACCOUNT_HEADER_SIZE + nmemb * size);
+	if (!header) {
+		return NULL;
+	}
+
+	return mm_account_alloced(header, nmemb * size, file);
+}
+
+static void *__ast_repl_calloc_cache(size_t nmemb, size_t size, const char *file, int lineno, const char *func)
+{
+	return __ast_repl_calloc(nmemb, size, file, lineno, func);
+}
+
+void *__ast_repl_malloc(size_t size, const char *file, int lineno, const char *func)
+{
+	struct mm_account_header *header;
+
+	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
+
+	if (size > SIZE_MAX - MM_ACCOUNT_HEADER_SIZE) {
+		return NULL;
+	}
+	header = malloc(MM_ACCOUNT_HEADER_SIZE + size);
+	if (!header) {
+		return NULL;
+	}
+
+	return mm_account_alloced(header, size, file);
+}
+
+void __ast_free(void *ptr, const char *file, int lineno, const char *func)
+{
+	struct mm_account_header *header;
+
+	if (!ptr) {
+		return;
+	}
+
+	header = mm_account_header_get(ptr);
+	if (!header) {
+		free(ptr);
+		return;
+	}
+
+	mm_account_count(header->tag, -1, -(int64_t) header->size);
+	header->magic = 0;
+	free(header);
+}
+
+void *__ast_repl_realloc(void *ptr, size_t size, const char *file, int lineno, const char *func)
+{
+	struct mm_account_header *header;
+	size_t old_size;
+
+	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
+
+	if (!ptr) {
+		return __ast_repl_malloc(size, file, lineno, func);
+	}
+
+	header = mm_account_header_get(ptr);
+	if (!header) {
+		return realloc(ptr, size);
+	}
+
+	if (size > SIZE_MAX - MM_ACCOUNT_HEADER_SIZE) {
+		return NULL;
+	}
+	old_size = header->size;
+	header = realloc(header, MM_ACCOUNT_HEADER_SIZE + size);
+	if (!header) {
+		return NULL;
+	}
+
+	/* The allocation stays counted against the file which made it */
+	header->size = size;
+	mm_account_count(header->tag, 0, (int64_t) size - (int64_t) old_size);
+
+	return (char *) header + MM_ACCOUNT_HEADER_SIZE;
+}
+
+char *__ast_repl_strdup(const char *s, const char *file, int lineno, const char *func)
+{
+	size_t len;
+	char *ptr;
+
+	len = strlen(s) + 1;
+	ptr = __ast_repl_malloc(len, file, lineno, func);
+	if (ptr) {
+		memcpy(ptr, s, len);
+	}
+
+	return ptr;
+}
+
+char *__ast_repl_strndup(const char *s, size_t n, const char *file, int lineno, const char *func)
+{
+	size_t len;
+	char *ptr;
+
+	len = strnlen(s, n);
+	ptr = __ast_repl_malloc(len + 1, file, lineno, func);
+	if (ptr) {
+		memcpy(ptr, s, len);
+		ptr[len] = '\0';
+	}
+
+	return ptr;
+}
+
+int __ast_repl_asprintf(const char *file, int lineno, const char *func, char **strp, const char *fmt, ...)
+{
+	int res;
+	va_list ap;
+
+	va_start(ap, fmt);
+	res = __ast_repl_vasprintf(strp, fmt, ap, file, lineno, func);
+	va_end(ap);
+
+	return res;
+}
+
+int __ast_repl_vasprintf(char **strp, const char *fmt, va_list ap, const char *file, int lineno, const char *func)
+{
+	int size;
+	va_list ap2;
+	char s;
+
+	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, -1);
+
+	*strp = NULL;
+	va_copy(ap2, ap);
+	size = vsnprintf(&s, 1, fmt, ap2);
+	va_end(ap2);
+	if (size < 0) {
+		return -1;
+	}
+	*strp = __ast_repl_malloc(size + 1, file, lineno, func);
+	if (!*strp) {
+		return -1;
+	}
+	vsnprintf(*strp, size + 1, fmt, ap);
+
+	return size;
+}
+
+static int mm_account_cmp(const void *left, const void *right)
+{
+	const struct ast_mm_account *a = left;
+	const struct ast_mm_account *b = right;
+
+	if (a->bytes != b->bytes) {
+		return a->bytes > b->bytes ? -1 : 1;
+	}
+	return strcmp(a->file, b->file);
+}
+
+int ast_mm_accounting_foreach(ast_mm_account_cb callback, void *data)
+{
+	struct mm_account_thread *thread;
+	struct ast_mm_account *accounts;
+	int64_t *allocations;
+	int64_t *bytes;
+	int count = 0;
+	int i;
+
+	accounts = ast_std_malloc(sizeof(*accounts) * (MM_ACCOUNT_FILES + 1));
+	allocations = ast_std_malloc(sizeof(*allocations) * (MM_ACCOUNT_FILES + 1));
+	bytes = ast_std_malloc(sizeof(*bytes) * (MM_ACCOUNT_FILES + 1));
+	if (!accounts || !allocations || !bytes) {
+		ast_std_free(accounts);
+		ast_std_free(allocations);
+		ast_std_free(bytes);
+		return 0;
+	}
+
+	/* Allocations are being counted while this adds them up, so it is a close estimate */
+	ast_mutex_lock(&mm_account_threads_lock);
+	memcpy(allocations, mm_account_retired.allocations, sizeof(*allocations) * (MM_ACCOUNT_FILES + 1));
+	memcpy(bytes, mm_account_retired.bytes, sizeof(*bytes) * (MM_ACCOUNT_FILES + 1));
+	for (thread = mm_account_threads; thread; thread = thread->next) {
+		for (i = 0; i <= MM_ACCOUNT_FILES; i++) {
+			allocations[i] += __atomic_load_n(&thread->allocations[i], __ATOMIC_RELAXED);
+			bytes[i] += __atomic_load_n(&thread->bytes[i], __ATOMIC_RELAXED);
+		}
+	}
+	ast_mutex_unlock(&mm_account_threads_lock);
+
+	ast_mutex_lock(&mm_account_files_lock);
+	for (i = 0; i <= MM_ACCOUNT_FILES; i++) {
+		if (!allocations[i] && !bytes[i]) {
+			continue;
+		}
+		/* A name once set never changes, so it can be used unlocked */
+		accounts[count].file = i == MM_ACCOUNT_FILES ? "(other)" : mm_account_files[i];
+		accounts[count].allocations = allocations[i];
+		accounts[count].bytes = bytes[i];
+		count++;
+	}
+	ast_mutex_unlock(&mm_account_files_lock);
+
+	ast_std_free(allocations);
+	ast_std_free(bytes);
+
+	qsort(accounts, count, sizeof(*accounts), mm_account_cmp);
+	for (i = 0; i < count; i++) {
+		callback(&accounts[i], data);
+	}
+	ast_std_free(accounts);
+
+	return count;
+}
+
+/*! \brief What is needed to total the accounts shown */
+struct mm_account_show {
+	int fd;
+	int limit;
+	int shown;
+	int64_t allocations;
+	int64_t bytes;
+};
+
+static void mm_account_show_cb(const struct ast_mm_account *account, void *data)
+{
+	struct mm_account_show *show = data;
+
+	show->allocations += account->allocations;
+	show->bytes += account->bytes;
+	if (show->limit && show->shown >= show->limit) {
+		return;
+	}
+	show->shown++;
+	ast_cli(show->fd, "%-47s %12" PRId64 " %14" PRId64 "\n",
+		account->file, account->allocations, account->bytes);
+}
+
+static char *handle_memory_show_summary(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct mm_account_show show = { .fd = a->fd, };
+	int count;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "memory show summary";
+		e->usage =
+			"Usage: memory show summary [<count>]\n"
+			"       Summarize the memory allocations outstanding by the source file\n"
+			"       which made them, largest first.  Allocations of astobj2 objects\n"
+			"       are counted against the file which allocated the object.\n"
+			"       Optionally only show the <count> largest.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc > 4) {
+		return CLI_SHOWUSAGE;
+	}
+	if (a->argc == 4 && (sscanf(a->argv[3], "%30d", &show.limit) != 1 || show.limit < 1)) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_cli(a->fd, "%-47s %12s %14s\n", "File", "Allocations", "Bytes");
+	count = ast_mm_accounting_foreach(mm_account_show_cb, &show);
+	ast_cli(a->fd, "%d file%s, %" PRId64 " allocations of %" PRId64 " bytes outstanding in total\n",
+		count, ESS(count), show.allocations, show.bytes);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_memory[] = {
+	AST_CLI_DEFINE(handle_memory_show_summary, "Summarize outstanding memory allocations by source file"),
+};
+
+void load_astmm_phase_1(void)
+{
+}
+
+/*!
+ * \internal
+ */
+static void mm_account_ast(void)
+{
+	ast_cli_unregister_multiple(cli_memory, ARRAY_LEN(cli_memory));
+}
+
+void load_astmm_phase_2(void)
+{
+	ast_cli_register_multiple(cli_memory, ARRAY_LEN(cli_memory));
+	ast_verb(1, "Asterisk Memory Accounting Started\n");
+	ast_register_cleanup(mm_account_ast);
+}
+
+#else	/* !defined(__AST_DEBUG_MALLOC) && !defined(__AST_ACCOUNT_MALLOC) */
 
 void load_astmm_phase_1(void)
 {
@@ -1600,6 +2183,13 @@ int __ast_repl_vasprintf(char **strp, const char *format, va_list ap, const char
 
 #endif	/* defined(__AST_DEBUG_MALLOC) */
 
+#if !defined(__AST_ACCOUNT_MALLOC)
+int ast_mm_accounting_foreach(ast_mm_account_cb callback, void *data)
+{
+	return -1;
+}
+#endif
+
 void *__ast_calloc(size_t nmemb, size_t size, const char *file, int lineno, const char *func)
 {
 	void *p;
@@ -38,6 +38,13 @@
 #include "asterisk/cli.h"
 #include "asterisk/paths.h"
 
+#if defined(__linux__) && defined(HAVE_C_ATOMICS) && !defined(DEBUG_THREADS)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+/*! Objects can have an adaptive lock rather than a mutex */
+#define AO2_ADAPTIVE_LOCK
+#endif
+
 /* Use ast_log_safe in place of ast_log. */
 #define ast_log ast_log_safe
 
@@ -67,7 +74,7 @@ struct __priv_data {
 	 * \note This field is constant after object creation.  It shares
 	 *       a uint32_t with \p lockused and \p magic.
 	 */
-	uint32_t options:3;
+	uint32_t options:4;
 	/*!
 	 * \brief Set to 1 when the lock is used if refdebug is enabled.
 	 *
@@ -82,7 +89,8 @@ struct __priv_data {
 	 * reference.
 	 *
 	 * \note This field is constant after object creation.  It shares
-	 *       a uint32_t with \p options and \p lockused.
+	 *       a uint32_t with \p options and \p lockused.  It is 27 bits
+	 *       so the options have room for AO2_ALLOC_OPT_LOCK_ADAPTIVE.
 	 *
 	 * \warning Stealing bits for any additional writable fields would cause
 	 *          reentrancy issues if using bitfields.  If any additional
@@ -90,11 +98,19 @@ struct __priv_data {
 	 *          all bitfields into a single 'uint32_t flags' field and use
 	 *          atomic operations from \file lock.h to perform writes.
 	 */
-	uint32_t magic:28;
+	uint32_t magic:27;
 };
 
-#define	AO2_MAGIC	0xa70b123
-#define	AO2_WEAK	0xa70b122
+/*!
+ * \brief The reference count of an immortal object and beyond
+ *
+ * Far beyond the excessive reference count, so references counted before
+ * an object was made immortal never bring it back below.
+ */
+#define AO2_REF_IMMORTAL	0x40000000
+
+#define	AO2_MAGIC	0x270b123
+#define	AO2_WEAK	0x270b122
 #define IS_AO2_MAGIC_BAD(p) (AO2_MAGIC != (p->priv_data.magic | 1))
 
 /*!
@@ -123,6 +139,30 @@ struct astobj2_lock {
 	void *user_data[0];
 };
 
+#ifdef AO2_ADAPTIVE_LOCK
+/*!
+ * \brief A recursive lock which spins briefly before sleeping on a futex
+ *
+ * The state is the lock word waited on, the rest is only needed for the
+ * lock to be recursive as ao2 object locks are.
+ */
+struct ao2_adaptive_priv {
+	/*! 0 unlocked, 1 locked, 2 locked with threads sleeping on it */
+	int state;
+	/*! How many more times the owner has it locked */
+	unsigned int depth;
+	/*! The thread holding the lock, only meaningful when locked */
+	pthread_t owner;
+};
+
+/* AstObj2 with adaptive lock. */
+struct astobj2_adaptive {
+	struct ao2_adaptive_priv adaptive;
+	struct __priv_data priv_data;
+	void *user_data[0];
+};
+#endif
+
 struct ao2_rwlock_priv {
 	ast_rwlock_t lock;
 	/*! Count of the number of threads holding a lock on this object. -1 if it is the write lock. */
@@ -154,6 +194,9 @@ struct ao2_stats ao2;
 #define INTERNAL_OBJ_MUTEX(user_data) \
 	((struct astobj2_lock *) (((char *) (user_data)) - sizeof(struct astobj2_lock)))
 
+#define INTERNAL_OBJ_ADAPTIVE(user_data) \
+	((struct astobj2_adaptive *) (((char *) (user_data)) - sizeof(struct astobj2_adaptive)))
+
 #define INTERNAL_OBJ_RWLOCK(user_data) \
 	((struct astobj2_rwlock *) (((char *) (user_data)) - sizeof(struct astobj2_rwlock)))
 
@@ -219,6 +262,121 @@ void log_bad_ao2(void *user_data, const char *file, int line, const char *func)
 	__ast_assert_failed(0, bad_magic, file, line, func);
 }
 
+#ifdef AO2_ADAPTIVE_LOCK
+/*! How many times a thread checks a locked adaptive lock before sleeping */
+#define AO2_ADAPTIVE_SPINS 100
+
+/*! How many times to check, none with a single processor where the holder cannot run meanwhile */
+static int adaptive_spins = AO2_ADAPTIVE_SPINS;
+
+static inline void adaptive_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__ ("yield" ::: "memory");
+#else
+	__asm__ __volatile__ ("" ::: "memory");
+#endif
+}
+
+/*! \brief Take an unlocked adaptive lock, returns the state found if it was not unlocked */
+static inline int adaptive_try_state(struct ao2_adaptive_priv *lock, int state)
+{
+	int expected = 0;
+
+	__atomic_compare_exchange_n(&lock->state, &expected, state, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+	return expected;
+}
+
+static int adaptive_is_owner(struct ao2_adaptive_priv *lock)
+{
+	return ast_atomic_load_n(&lock->state, __ATOMIC_RELAXED)
+		&& pthread_equal(ast_atomic_load_n(&lock->owner, __ATOMIC_RELAXED), pthread_self());
+}
+
+static void adaptive_owned(struct ao2_adaptive_priv *lock)
+{
+	ast_atomic_store_n(&lock->owner, pthread_self(), __ATOMIC_RELAXED);
+	lock->depth = 0;
+}
+
+static int adaptive_lock(struct ao2_adaptive_priv *lock)
+{
+	int state;
+	int spins;
+
+	state = adaptive_try_state(lock, 1);
+	if (!state) {
+		adaptive_owned(lock);
+		return 0;
+	}
+	if (adaptive_is_owner(lock)) {
+		lock->depth++;
+		return 0;
+	}
+
+	/* It is likely to be unlocked in a moment, so check a few times before sleeping */
+	for (spins = 0; spins < adaptive_spins; spins++) {
+		adaptive_cpu_relax();
+		if (!ast_atomic_load_n(&lock->state, __ATOMIC_RELAXED)) {
+			state = adaptive_try_state(lock, 1);
+			if (!state) {
+				adaptive_owned(lock);
+				return 0;
+			}
+		}
+	}
+
+	/* Sleep until woken, marking that someone sleeps so the unlock wakes them */
+	if (state != 2) {
+		state = ast_atomic_exchange_n(&lock->state, 2, __ATOMIC_ACQUIRE);
+	}
+	while (state) {
+		syscall(SYS_futex, &lock->state, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+		state = ast_atomic_exchange_n(&lock->state, 2, __ATOMIC_ACQUIRE);
+	}
+	adaptive_owned(lock);
+
+	return 0;
+}
+
+static int adaptive_trylock(struct ao2_adaptive_priv *lock)
+{
+	if (!adaptive_try_state(lock, 1)) {
+		adaptive_owned(lock);
+		return 0;
+	}
+	if (adaptive_is_owner(lock)) {
+		lock->depth++;
+		return 0;
+	}
+
+	return EBUSY;
+}
+
+static int adaptive_unlock(struct ao2_adaptive_priv *lock)
+{
+	/* Checking the owner here costs as much as the unlock, so only the state is checked */
+	if (!ast_atomic_load_n(&lock->state, __ATOMIC_RELAXED)) {
+		return EPERM;
+	}
+
+	if (lock->depth) {
+		lock->depth--;
+		return 0;
+	}
+
+	/* Before unlocking, so a thread locking it next never sees itself as the owner */
+	ast_atomic_store_n(&lock->owner, (pthread_t) 0, __ATOMIC_RELAXED);
+	if (ast_atomic_exchange_n(&lock->state, 0, __ATOMIC_RELEASE) == 2) {
+		syscall(SYS_futex, &lock->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+	}
+
+	return 0;
+}
+#endif
+
 int __ao2_lock(void *user_data, enum ao2_lock_req lock_how, const char *file, const char *func, int line, const char *var)
 {
 	struct astobj2 *obj = __INTERNAL_OBJ_CHECK(user_data, file, line, func);
@@ -237,6 +395,15 @@ int __ao2_lock(void *user_data, enum ao2_lock_req lock_how, const char *file, co
 
 	switch (obj->priv_data.options & AO2_ALLOC_OPT_LOCK_MASK) {
 	case AO2_ALLOC_OPT_LOCK_MUTEX:
+#ifdef AO2_ADAPTIVE_LOCK
+		if (obj->priv_data.options & AO2_ALLOC_OPT_LOCK_ADAPTIVE) {
+			res = adaptive_lock(&INTERNAL_OBJ_ADAPTIVE(user_data)->adaptive);
+#ifdef AO2_DEBUG
+			ast_atomic_fetchadd_int(&ao2.total_locked, 1);
+#endif
+			break;
+		}
+#endif
 		obj_mutex = INTERNAL_OBJ_MUTEX(user_data);
 		res = __ast_pthread_mutex_lock(file, line, func, var, &obj_mutex->mutex.lock);
 #ifdef AO2_DEBUG
@@ -300,6 +467,21 @@ int __ao2_unlock(void *user_data, const char *file, const char *func, int line,
 
 	switch (obj->priv_data.options & AO2_ALLOC_OPT_LOCK_MASK) {
 	case AO2_ALLOC_OPT_LOCK_MUTEX:
+#ifdef AO2_ADAPTIVE_LOCK
+		if (obj->priv_data.options & AO2_ALLOC_OPT_LOCK_ADAPTIVE) {
+			res = adaptive_unlock(&INTERNAL_OBJ_ADAPTIVE(user_data)->adaptive);
+			if (res) {
+				ast_log(__LOG_ERROR, file, line, func, "Unlocking %s (%p) which is not locked\n",
+					var, user_data);
+			}
+#ifdef AO2_DEBUG
+			if (!res) {
+				ast_atomic_fetchadd_int(&ao2.total_locked, -1);
+			}
+#endif
+			break;
+		}
+#endif
 		obj_mutex = INTERNAL_OBJ_MUTEX(user_data);
 		res = __ast_pthread_mutex_unlock(file, line, func, var, &obj_mutex->mutex.lock);
 #ifdef AO2_DEBUG
@@ -357,6 +539,17 @@ int __ao2_trylock(void *user_data, enum ao2_lock_req lock_how, const char *file,
 
 	switch (obj->priv_data.options & AO2_ALLOC_OPT_LOCK_MASK) {
 	case AO2_ALLOC_OPT_LOCK_MUTEX:
+#ifdef AO2_ADAPTIVE_LOCK
+		if (obj->priv_data.options & AO2_ALLOC_OPT_LOCK_ADAPTIVE) {
+			res = adaptive_trylock(&INTERNAL_OBJ_ADAPTIVE(user_data)->adaptive);
+#ifdef AO2_DEBUG
+			if (!res) {
+				ast_atomic_fetchadd_int(&ao2.total_locked, 1);
+			}
+#endif
+			break;
+		}
+#endif
 		obj_mutex = INTERNAL_OBJ_MUTEX(user_data);
 		res = __ast_pthread_mutex_trylock(file, line, func, var, &obj_mutex->mutex.lock);
 #ifdef AO2_DEBUG
@@ -486,6 +679,10 @@ void *ao2_object_get_lockaddr(void *user_data)
 
 	switch (obj->priv_data.options & AO2_ALLOC_OPT_LOCK_MASK) {
 	case AO2_ALLOC_OPT_LOCK_MUTEX:
+		if (obj->priv_data.options & AO2_ALLOC_OPT_LOCK_ADAPTIVE) {
+			/* It is not a mutex a condition can wait with */
+			break;
+		}
 		obj_mutex = INTERNAL_OBJ_MUTEX(user_data);
 		return &obj_mutex->mutex.lock;
 	default:
@@ -495,6 +692,37 @@ void *ao2_object_get_lockaddr(void *user_data)
 	return NULL;
 }
 
+int __ao2_make_immortal(void *user_data, const char *tag, const char *file, int line, const char *func)
+{
+	struct astobj2 *obj = __INTERNAL_OBJ_CHECK(user_data, file, line, func);
+	int32_t ret;
+
+	if (obj == NULL) {
+		return -1;
+	}
+
+	if (obj->priv_data.weakptr) {
+		ast_log(__LOG_ERROR, file, line, func,
+			"Cannot make ao2 object %p with a weak proxy immortal\n", user_data);
+		return -1;
+	}
+
+	if (obj->priv_data.ref_counter >= AO2_REF_IMMORTAL) {
+		return 0;
+	}
+
+	/* The references counted until now no longer matter, the bias keeps it alive */
+	ret = ast_atomic_fetch_add(&obj->priv_data.ref_counter, AO2_REF_IMMORTAL, __ATOMIC_RELAXED);
+
+	if (ref_log && !(obj->priv_data.options & AO2_ALLOC_OPT_NO_REF_DEBUG)) {
+		fprintf(ref_log, "%p,+0,%d,%s,%d,%s,%d,made immortal %s\n", user_data, ast_get_tid(),
+			file, line, func, (int)ret, tag ?: "");
+		fflush(ref_log);
+	}
+
+	return 0;
+}
+
 int __ao2_ref(void *user_data, int delta,
 	const char *tag, const char *file, int line, const char *func)
 {
@@ -522,6 +750,11 @@ int __ao2_ref(void *user_data, int delta,
 		return obj->priv_data.ref_counter;
 	}
 
+	/* Only read the counter of an immortal object, leaving its cache line shared */
+	if (__atomic_load_n(&obj->priv_data.ref_counter, __ATOMIC_RELAXED) >= AO2_REF_IMMORTAL) {
+		return AO2_REF_IMMORTAL;
+	}
+
 	if (delta < 0 && obj->priv_data.magic == AO2_MAGIC && (weakproxy = obj->priv_data.weakptr)) {
 		ao2_lock(weakproxy);
 	}
@@ -627,8 +860,14 @@ int __ao2_ref(void *user_data, int delta,
 
 	switch (obj->priv_data.options & AO2_ALLOC_OPT_LOCK_MASK) {
 	case AO2_ALLOC_OPT_LOCK_MUTEX:
-		obj_mutex = INTERNAL_OBJ_MUTEX(user_data);
 		lock_state = obj->priv_data.lockused ? "used" : "unused";
+#ifdef AO2_ADAPTIVE_LOCK
+		if (obj->priv_data.options & AO2_ALLOC_OPT_LOCK_ADAPTIVE) {
+			ast_free(INTERNAL_OBJ_ADAPTIVE(user_data));
+			break;
+		}
+#endif
+		obj_mutex = INTERNAL_OBJ_MUTEX(user_data);
 		ast_mutex_destroy(&obj_mutex->mutex.lock);
 
 		ast_free(obj_mutex);
@@ -691,8 +930,31 @@ static void *internal_ao2_alloc(size_t data_size, ao2_destructor_fn destructor_f
 	struct astobj2_lockobj *obj_lockobj;
 	size_t overhead;
 
+#ifdef AO2_ADAPTIVE_LOCK
+	if ((options & AO2_ALLOC_OPT_LOCK_MASK) != AO2_ALLOC_OPT_LOCK_MUTEX) {
+		options &= ~AO2_ALLOC_OPT_LOCK_ADAPTIVE;
+	}
+#else
+	/* Objects get a mutex where there is no adaptive lock */
+	options &= ~AO2_ALLOC_OPT_LOCK_ADAPTIVE;
+#endif
+
 	switch (options & AO2_ALLOC_OPT_LOCK_MASK) {
 	case AO2_ALLOC_OPT_LOCK_MUTEX:
+#ifdef AO2_ADAPTIVE_LOCK
+		if (options & AO2_ALLOC_OPT_LOCK_ADAPTIVE) {
+			struct astobj2_adaptive *obj_adaptive;
+
+			/* Zeroed, the lock is unlocked */
+			overhead = sizeof(*obj_adaptive);
+			obj_adaptive = __ast_calloc(1, overhead + data_size, file, line, func);
+			if (obj_adaptive == NULL) {
+				return NULL;
+			}
+			obj = (struct astobj2 *) &obj_adaptive->priv_data;
+			break;
+		}
+#endif
 		overhead = sizeof(*obj_mutex);
 		obj_mutex = __ast_calloc(1, overhead + data_size, file, line, func);
 		if (obj_mutex == NULL) {
@@ -1180,6 +1442,12 @@ int astobj2_init(void)
 
 	ast_register_cleanup(astobj2_cleanup);
 
+#ifdef AO2_ADAPTIVE_LOCK
+	if (sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+		adaptive_spins = 0;
+	}
+#endif
+
 	if (container_init() != 0) {
 		fclose(ref_log);
 		ref_log = NULL;
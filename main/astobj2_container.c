@@ -95,6 +95,8 @@ int __ao2_link(struct ao2_container *self, void *obj_new, int flags,
 	const char *tag, const char *file, int line, const char *func)
 {
 	int res;
+	int shard = -1;
+	int sharded;
 	enum ao2_lock_req orig_lock;
 	struct ao2_container_node *node;
 
@@ -109,18 +111,27 @@ int __ao2_link(struct ao2_container *self, void *obj_new, int flags,
 		return 0;
 	}
 
+	/* A sharded container only needs the shard holding the object write locked. */
+	sharded = ao2_container_sharded(self);
 	if (flags & OBJ_NOLOCK) {
-		orig_lock = __adjust_lock(self, AO2_LOCK_REQ_WRLOCK, 1);
+		orig_lock = __adjust_lock(self, sharded ? AO2_LOCK_REQ_RDLOCK : AO2_LOCK_REQ_WRLOCK, 1);
 	} else {
-		ao2_wrlock(self);
+		if (sharded) {
+			ao2_rdlock(self);
+		} else {
+			ao2_wrlock(self);
+		}
 		orig_lock = AO2_LOCK_REQ_MUTEX;
 	}
 
 	res = 0;
 	node = self->v_table->new_node(self, obj_new, tag, file, line, func);
 	if (node) {
+		if (sharded) {
+			shard = self->v_table->shard_lock(self, OBJ_SEARCH_OBJECT, obj_new, 1);
+		}
 #if defined(AO2_DEBUG)
-		if (ao2_container_check(self, OBJ_NOLOCK)) {
+		if (!sharded && ao2_container_check(self, OBJ_NOLOCK)) {
 			ast_log(LOG_ERROR, "Container integrity failed before insert.\n");
 		}
 #endif	/* defined(AO2_DEBUG) */
@@ -131,7 +142,7 @@ int __ao2_link(struct ao2_container *self, void *obj_new, int flags,
 			node->is_linked = 1;
 			ast_atomic_fetchadd_int(&self->elements, 1);
 #if defined(AO2_DEBUG)
-			AO2_DEVMODE_STAT(++self->nodes);
+			AO2_DEVMODE_STAT(ast_atomic_fetchadd_int(&self->nodes, 1));
 			if (self->v_table->link_stat) {
 				self->v_table->link_stat(self, node);
 			}
@@ -139,7 +150,7 @@ int __ao2_link(struct ao2_container *self, void *obj_new, int flags,
 			/* Fall through */
 		case AO2_CONTAINER_INSERT_NODE_OBJ_REPLACED:
 #if defined(AO2_DEBUG)
-			if (ao2_container_check(self, OBJ_NOLOCK)) {
+			if (!sharded && ao2_container_check(self, OBJ_NOLOCK)) {
 				ast_log(LOG_ERROR, "Container integrity failed after insert or replace.\n");
 			}
 #endif	/* defined(AO2_DEBUG) */
@@ -149,6 +160,9 @@ int __ao2_link(struct ao2_container *self, void *obj_new, int flags,
 			ao2_ref(node, -1);
 			break;
 		}
+		if (sharded) {
+			self->v_table->shard_unlock(self, shard);
+		}
 	}
 
 	if (flags & OBJ_NOLOCK) {
@@ -236,6 +250,8 @@ static void *internal_ao2_traverse(struct ao2_container *self, enum search_flags
 	ao2_callback_data_fn *cb_withdata = NULL;
 	struct ao2_container_node *node;
 	void *traversal_state;
+	int shard = -1;
+	int sharded;
 
 	enum ao2_lock_req orig_lock;
 	struct ao2_container *multi_container = NULL;
@@ -295,21 +311,30 @@ static void *internal_ao2_traverse(struct ao2_container *self, enum search_flags
 		}
 	}
 
-	/* avoid modifications to the content */
+	/*
+	 * avoid modifications to the content
+	 *
+	 * A sharded container is read locked and the shards the traversal
+	 * visits are locked for the modifications it makes instead.
+	 */
+	sharded = ao2_container_sharded(self);
 	if (flags & OBJ_NOLOCK) {
-		if (flags & OBJ_UNLINK) {
+		if ((flags & OBJ_UNLINK) && !sharded) {
 			orig_lock = __adjust_lock(self, AO2_LOCK_REQ_WRLOCK, 1);
 		} else {
 			orig_lock = __adjust_lock(self, AO2_LOCK_REQ_RDLOCK, 1);
 		}
 	} else {
 		orig_lock = AO2_LOCK_REQ_MUTEX;
-		if (flags & OBJ_UNLINK) {
+		if ((flags & OBJ_UNLINK) && !sharded) {
 			ao2_wrlock(self);
 		} else {
 			ao2_rdlock(self);
 		}
 	}
+	if (sharded) {
+		shard = self->v_table->shard_lock(self, flags, arg, flags & OBJ_UNLINK);
+	}
 
 	/* Create a buffer for the traversal state. */
 	traversal_state = alloca(AO2_TRAVERSAL_STATE_SIZE);
@@ -388,6 +413,9 @@ static void *internal_ao2_traverse(struct ao2_container *self, enum search_flags
 		/* Unref the node from self->v_table->traverse_first/traverse_next() */
 		ao2_ref(node, -1);
 	}
+	if (sharded) {
+		self->v_table->shard_unlock(self, shard);
+	}
 
 	if (flags & OBJ_NOLOCK) {
 		__adjust_lock(self, orig_lock, 0);
@@ -504,11 +532,13 @@ void ao2_iterator_restart(struct ao2_iterator *iter)
 	/* Release the last container node reference if we have one. */
 	if (iter->last_node) {
 		enum ao2_lock_req orig_lock;
+		int shard = -1;
 
 		/*
 		 * Do a read lock in case the container node unref does not
 		 * destroy the node.  If the container node is destroyed then
-		 * the lock will be upgraded to a write lock.
+		 * the lock will be upgraded to a write lock.  The node of a
+		 * sharded container is destroyed under the shard write locks.
 		 */
 		if (iter->flags & AO2_ITERATOR_DONTLOCK) {
 			orig_lock = __adjust_lock(iter->c, AO2_LOCK_REQ_RDLOCK, 1);
@@ -516,10 +546,16 @@ void ao2_iterator_restart(struct ao2_iterator *iter)
 			orig_lock = AO2_LOCK_REQ_MUTEX;
 			ao2_rdlock(iter->c);
 		}
+		if (ao2_container_sharded(iter->c)) {
+			shard = iter->c->v_table->shard_lock(iter->c, 0, NULL, 1);
+		}
 
 		ao2_ref(iter->last_node, -1);
 		iter->last_node = NULL;
 
+		if (ao2_container_sharded(iter->c)) {
+			iter->c->v_table->shard_unlock(iter->c, shard);
+		}
 		if (iter->flags & AO2_ITERATOR_DONTLOCK) {
 			__adjust_lock(iter->c, orig_lock, 0);
 		} else {
@@ -559,6 +595,8 @@ void *__ao2_iterator_next(struct ao2_iterator *iter,
 	enum ao2_lock_req orig_lock;
 	struct ao2_container_node *node;
 	void *ret;
+	int shard = -1;
+	int sharded;
 
 	if (!__is_ao2_object(iter->c, file, line, func)) {
 		return NULL;
@@ -575,20 +613,28 @@ void *__ao2_iterator_next(struct ao2_iterator *iter,
 		return NULL;
 	}
 
+	/*
+	 * Replacing the iterator's node may destroy it, so every shard of a
+	 * sharded container is write locked.
+	 */
+	sharded = ao2_container_sharded(iter->c);
 	if (iter->flags & AO2_ITERATOR_DONTLOCK) {
-		if (iter->flags & AO2_ITERATOR_UNLINK) {
+		if ((iter->flags & AO2_ITERATOR_UNLINK) && !sharded) {
 			orig_lock = __adjust_lock(iter->c, AO2_LOCK_REQ_WRLOCK, 1);
 		} else {
 			orig_lock = __adjust_lock(iter->c, AO2_LOCK_REQ_RDLOCK, 1);
 		}
 	} else {
 		orig_lock = AO2_LOCK_REQ_MUTEX;
-		if (iter->flags & AO2_ITERATOR_UNLINK) {
+		if ((iter->flags & AO2_ITERATOR_UNLINK) && !sharded) {
 			ao2_wrlock(iter->c);
 		} else {
 			ao2_rdlock(iter->c);
 		}
 	}
+	if (sharded) {
+		shard = iter->c->v_table->shard_lock(iter->c, 0, NULL, 1);
+	}
 
 	node = iter->c->v_table->iterator_next(iter->c, iter->last_node, iter->flags);
 	if (node) {
@@ -618,6 +664,9 @@ void *__ao2_iterator_next(struct ao2_iterator *iter,
 	}
 	iter->last_node = node;
 
+	if (sharded) {
+		iter->c->v_table->shard_unlock(iter->c, shard);
+	}
 	if (iter->flags & AO2_ITERATOR_DONTLOCK) {
 		__adjust_lock(iter->c, orig_lock, 0);
 	} else {
@@ -791,6 +840,8 @@ struct ao2_container *__ao2_container_clone(struct ao2_container *orig, enum sea
 
 void ao2_container_dump(struct ao2_container *self, enum search_flags flags, const char *name, void *where, ao2_prnt_fn *prnt, ao2_prnt_obj_fn *prnt_obj)
 {
+	int shard = -1;
+
 	if (!is_ao2_object(self) || !self->v_table) {
 		prnt(where, "Invalid container\n");
 		ast_assert(0);
@@ -800,6 +851,9 @@ void ao2_container_dump(struct ao2_container *self, enum search_flags flags, con
 	if (!(flags & OBJ_NOLOCK)) {
 		ao2_rdlock(self);
 	}
+	if (ao2_container_sharded(self)) {
+		shard = self->v_table->shard_lock(self, 0, NULL, 0);
+	}
 	if (name) {
 		prnt(where, "Container name: %s\n", name);
 	}
@@ -811,6 +865,9 @@ void ao2_container_dump(struct ao2_container *self, enum search_flags flags, con
 	{
 		prnt(where, "Container dump not available.\n");
 	}
+	if (ao2_container_sharded(self)) {
+		self->v_table->shard_unlock(self, shard);
+	}
 	if (!(flags & OBJ_NOLOCK)) {
 		ao2_unlock(self);
 	}
@@ -818,6 +875,8 @@ void ao2_container_dump(struct ao2_container *self, enum search_flags flags, con
 
 void ao2_container_stats(struct ao2_container *self, enum search_flags flags, const char *name, void *where, ao2_prnt_fn *prnt)
 {
+	int shard = -1;
+
 	if (!is_ao2_object(self) || !self->v_table) {
 		prnt(where, "Invalid container\n");
 		ast_assert(0);
@@ -827,6 +886,9 @@ void ao2_container_stats(struct ao2_container *self, enum search_flags flags, co
 	if (!(flags & OBJ_NOLOCK)) {
 		ao2_rdlock(self);
 	}
+	if (ao2_container_sharded(self)) {
+		shard = self->v_table->shard_lock(self, 0, NULL, 0);
+	}
 	if (name) {
 		prnt(where, "Container name: %s\n", name);
 	}
@@ -848,6 +910,9 @@ void ao2_container_stats(struct ao2_container *self, enum search_flags flags, co
 		self->v_table->stats(self, where, prnt);
 	}
 #endif	/* defined(AO2_DEBUG) */
+	if (ao2_container_sharded(self)) {
+		self->v_table->shard_unlock(self, shard);
+	}
 	if (!(flags & OBJ_NOLOCK)) {
 		ao2_unlock(self);
 	}
@@ -856,6 +921,9 @@ void ao2_container_stats(struct ao2_container *self, enum search_flags flags, co
 int ao2_container_check(struct ao2_container *self, enum search_flags flags)
 {
 	int res = 0;
+#if defined(AO2_DEBUG)
+	int shard = -1;
+#endif	/* defined(AO2_DEBUG) */
 
 	if (!is_ao2_object(self) || !self->v_table) {
 		/* Sanity checks. */
@@ -871,7 +939,13 @@ int ao2_container_check(struct ao2_container *self, enum search_flags flags)
 	if (!(flags & OBJ_NOLOCK)) {
 		ao2_rdlock(self);
 	}
+	if (ao2_container_sharded(self)) {
+		shard = self->v_table->shard_lock(self, 0, NULL, 0);
+	}
 	res = self->v_table->integrity(self);
+	if (ao2_container_sharded(self)) {
+		self->v_table->shard_unlock(self, shard);
+	}
 	if (!(flags & OBJ_NOLOCK)) {
 		ao2_unlock(self);
 	}
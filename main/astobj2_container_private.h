@@ -168,6 +168,29 @@ typedef void (*ao2_container_find_cleanup_fn)(void *v_state);
  */
 typedef struct ao2_container_node *(*ao2_iterator_next_fn)(struct ao2_container *self, struct ao2_container_node *prev, enum ao2_iterator_flags flags);
 
+/*!
+ * \brief Lock the shards of a sharded container used by an operation.
+ *
+ * \param self Container to operate upon.
+ * \param flags search_flags of the operation.
+ * \param arg Search object or key if OBJ_SEARCH_OBJECT or OBJ_SEARCH_KEY is set.
+ * \param write TRUE if the shards are to be write locked.
+ *
+ * \note The container is already locked.
+ *
+ * \return the shard locked.
+ * \retval -1 if every shard was locked.
+ */
+typedef int (*ao2_container_shard_lock_fn)(struct ao2_container *self, enum search_flags flags, void *arg, int write);
+
+/*!
+ * \brief Unlock the shards locked by ao2_container_shard_lock_fn.
+ *
+ * \param self Container to operate upon.
+ * \param shard Value returned when the shards were locked.
+ */
+typedef void (*ao2_container_shard_unlock_fn)(struct ao2_container *self, int shard);
+
 /*!
  * \brief Display contents of the specified container.
  *
@@ -239,6 +262,10 @@ struct ao2_container_methods {
 	ao2_container_find_cleanup_fn traverse_cleanup;
 	/*! Find the next iteration element in the container. */
 	ao2_iterator_next_fn iterator_next;
+	/*! Lock the shards used by an operation. (Sharded containers only) */
+	ao2_container_shard_lock_fn shard_lock;
+	/*! Unlock the shards used by an operation. (Sharded containers only) */
+	ao2_container_shard_unlock_fn shard_unlock;
 #if defined(AO2_DEBUG)
 	/*! Increment the container linked object statistic. */
 	ao2_link_node_stat_fn link_stat;
@@ -312,6 +339,14 @@ struct ao2_container {
 int __container_unlink_node_debug(struct ao2_container_node *node, uint32_t flags,
 	const char *tag, const char *file, int line, const char *func);
 
+/*!
+ * \internal
+ * \brief TRUE if the container protects its contents with shard locks.
+ *
+ * \note Containers that can not be sharded clear the option when created.
+ */
+#define ao2_container_sharded(c) ((c)->options & AO2_CONTAINER_ALLOC_OPT_SHARDED)
+
 void container_destruct(void *_c);
 int container_init(void);
 
@@ -71,10 +71,20 @@ struct ao2_container_hash {
 	ao2_hash_fn *hash_fn;
 	/*! Number of hash buckets in this container. */
 	int n_buckets;
+	/*! Number of shards the buckets are divided into.  (Sharded containers) */
+	int n_shards;
+	/*! Shard locks following the buckets array.  (Sharded containers) */
+	ast_rwlock_t *shard_locks;
 	/*! Hash bucket array of n_buckets.  Variable size. */
 	struct hash_bucket buckets[0];
 };
 
+/*! Maximum number of shards in a sharded hash container */
+#define HASH_MAX_SHARDS 32
+
+/*! \brief Get the shard holding a bucket. */
+#define hash_bucket_shard(self, bucket) ((bucket) * (self)->n_shards / (self)->n_buckets)
+
 /*! Traversal state to restart a hash container traversal. */
 struct hash_traversal_state {
 	/*! Active sort function in the traversal if not NULL. */
@@ -138,7 +148,8 @@ static struct ao2_container *hash_ao2_alloc_empty_clone(struct ao2_container_has
  * container is already locked.
  *
  * \note The container must be locked when the node is
- * unreferenced.
+ * unreferenced.  The shard holding the node of a sharded
+ * container must be write locked.
  */
 static void hash_ao2_node_destructor(void *v_doomed)
 {
@@ -166,17 +177,24 @@ static void hash_ao2_node_destructor(void *v_doomed)
 		is_ao2_object(my_container);
 #endif
 
-		__adjust_lock(my_container, AO2_LOCK_REQ_WRLOCK, 1);
+		/*
+		 * The shard holding the node of a sharded container is already
+		 * write locked.
+		 */
+		if (!ao2_container_sharded(&my_container->common)) {
+			__adjust_lock(my_container, AO2_LOCK_REQ_WRLOCK, 1);
+		}
 
 #if defined(AO2_DEBUG)
 		if (!my_container->common.destroying
+			&& !ao2_container_sharded(&my_container->common)
 			&& ao2_container_check(doomed->common.my_container, OBJ_NOLOCK)) {
 			ast_log(LOG_ERROR, "Container integrity failed before node deletion.\n");
 		}
 #endif	/* defined(AO2_DEBUG) */
 		bucket = &my_container->buckets[doomed->my_bucket];
 		AST_DLLIST_REMOVE(&bucket->list, doomed, links);
-		AO2_DEVMODE_STAT(--my_container->common.nodes);
+		AO2_DEVMODE_STAT(ast_atomic_fetchadd_int(&my_container->common.nodes, -1));
 	}
 
 	/*
@@ -720,6 +738,71 @@ static void hash_ao2_unlink_node_stat(struct ao2_container *hash, struct ao2_con
 }
 #endif	/* defined(AO2_DEBUG) */
 
+/*!
+ * \internal
+ * \brief Lock the shards of a sharded hash container used by an operation.
+ *
+ * \param self Container to operate upon.
+ * \param flags search_flags of the operation.
+ * \param arg Search object or key if OBJ_SEARCH_OBJECT or OBJ_SEARCH_KEY is set.
+ * \param write TRUE if the shards are to be write locked.
+ *
+ * \details Searches by object or key only visit one bucket so
+ * only lock its shard.  Any other operation locks every shard in
+ * order.
+ *
+ * \return the shard locked.
+ * \retval -1 if every shard was locked.
+ */
+static int hash_ao2_shard_lock(struct ao2_container_hash *self, enum search_flags flags,
+	void *arg, int write)
+{
+	int shard;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+	case OBJ_SEARCH_KEY:
+		shard = hash_bucket_shard(self,
+			abs(self->hash_fn(arg, flags & OBJ_SEARCH_MASK) % self->n_buckets));
+		if (write) {
+			ast_rwlock_wrlock(&self->shard_locks[shard]);
+		} else {
+			ast_rwlock_rdlock(&self->shard_locks[shard]);
+		}
+		return shard;
+	default:
+		break;
+	}
+
+	for (shard = 0; shard < self->n_shards; ++shard) {
+		if (write) {
+			ast_rwlock_wrlock(&self->shard_locks[shard]);
+		} else {
+			ast_rwlock_rdlock(&self->shard_locks[shard]);
+		}
+	}
+	return -1;
+}
+
+/*!
+ * \internal
+ * \brief Unlock the shards locked by hash_ao2_shard_lock().
+ *
+ * \param self Container to operate upon.
+ * \param shard Value returned by hash_ao2_shard_lock().
+ */
+static void hash_ao2_shard_unlock(struct ao2_container_hash *self, int shard)
+{
+	if (0 <= shard) {
+		ast_rwlock_unlock(&self->shard_locks[shard]);
+		return;
+	}
+
+	for (shard = self->n_shards; shard--;) {
+		ast_rwlock_unlock(&self->shard_locks[shard]);
+	}
+}
+
 /*!
  * \internal
  *
@@ -740,6 +823,10 @@ static void hash_ao2_destroy(struct ao2_container_hash *self)
 			break;
 		}
 	}
+
+	for (idx = self->n_shards; idx--;) {
+		ast_rwlock_destroy(&self->shard_locks[idx]);
+	}
 }
 
 #if defined(AO2_DEBUG)
@@ -1006,6 +1093,8 @@ static const struct ao2_container_methods v_table_hash = {
 	.traverse_first = (ao2_container_find_first_fn) hash_ao2_find_first,
 	.traverse_next = (ao2_container_find_next_fn) hash_ao2_find_next,
 	.iterator_next = (ao2_iterator_next_fn) hash_ao2_iterator_next,
+	.shard_lock = (ao2_container_shard_lock_fn) hash_ao2_shard_lock,
+	.shard_unlock = (ao2_container_shard_unlock_fn) hash_ao2_shard_unlock,
 	.destroy = (ao2_container_destroy_fn) hash_ao2_destroy,
 #if defined(AO2_DEBUG)
 	.link_stat = hash_ao2_link_node_stat,
@@ -1036,6 +1125,7 @@ static int hash_zero(const void *user_obj, const int flags)
  * \param self Container to initialize.
  * \param options Container behaviour options (See enum ao2_container_opts)
  * \param n_buckets Number of buckets for hash
+ * \param n_shards Number of shard locks following the buckets.  (0 if not sharded)
  * \param hash_fn Pointer to a function computing a hash value.
  * \param sort_fn Pointer to a sort function.
  * \param cmp_fn Pointer to a compare function used by ao2_find.
@@ -1044,8 +1134,11 @@ static int hash_zero(const void *user_obj, const int flags)
  */
 static struct ao2_container *hash_ao2_container_init(
 	struct ao2_container_hash *self, unsigned int options, unsigned int n_buckets,
-	ao2_hash_fn *hash_fn, ao2_sort_fn *sort_fn, ao2_callback_fn *cmp_fn)
+	unsigned int n_shards, ao2_hash_fn *hash_fn, ao2_sort_fn *sort_fn,
+	ao2_callback_fn *cmp_fn)
 {
+	int idx;
+
 	if (!self) {
 		return NULL;
 	}
@@ -1057,6 +1150,16 @@ static struct ao2_container *hash_ao2_container_init(
 	self->hash_fn = hash_fn ? hash_fn : hash_zero;
 	self->n_buckets = n_buckets;
 
+	if (n_shards) {
+		self->n_shards = n_shards;
+		self->shard_locks = (ast_rwlock_t *) &self->buckets[n_buckets];
+		for (idx = 0; idx < n_shards; ++idx) {
+			ast_rwlock_init(&self->shard_locks[idx]);
+		}
+	} else {
+		self->common.options &= ~AO2_CONTAINER_ALLOC_OPT_SHARDED;
+	}
+
 #ifdef AO2_DEBUG
 	ast_atomic_fetchadd_int(&ao2.total_containers, 1);
 #endif	/* defined(AO2_DEBUG) */
@@ -1070,16 +1173,25 @@ struct ao2_container *__ao2_container_alloc_hash(unsigned int ao2_options,
 	const char *tag, const char *file, int line, const char *func)
 {
 	unsigned int num_buckets;
+	unsigned int num_shards = 0;
 	size_t container_size;
 	struct ao2_container_hash *self;
 
 	num_buckets = hash_fn ? n_buckets : 1;
 	container_size = sizeof(struct ao2_container_hash) + num_buckets * sizeof(struct hash_bucket);
 
+	/* Shard locks only help if readers can share the container lock. */
+	if ((container_options & AO2_CONTAINER_ALLOC_OPT_SHARDED)
+		&& (ao2_options & AO2_ALLOC_OPT_LOCK_MASK) == AO2_ALLOC_OPT_LOCK_RWLOCK
+		&& 1 < num_buckets) {
+		num_shards = MIN(num_buckets, HASH_MAX_SHARDS);
+		container_size += num_shards * sizeof(ast_rwlock_t);
+	}
+
 	self = __ao2_alloc(container_size, container_destruct, ao2_options,
 		tag ?: __PRETTY_FUNCTION__, file, line, func);
-	return hash_ao2_container_init(self, container_options, num_buckets, hash_fn,
-		sort_fn, cmp_fn);
+	return hash_ao2_container_init(self, container_options, num_buckets, num_shards,
+		hash_fn, sort_fn, cmp_fn);
 }
 
 struct ao2_container *__ao2_container_alloc_list(unsigned int ao2_options,
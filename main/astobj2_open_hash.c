@@ -0,0 +1,848 @@
+/*
+ * astobj2_open_hash - Open addressing hash table implementation for astobj2.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Open addressing hash table functions implementing astobj2 containers.
+ *
+ * The container keeps a power of two sized array of slots, each holding
+ * a node pointer and the node's hash value.  Keyed searches linearly
+ * probe the array and only dereference a node when its stored hash
+ * matches, so a lookup touches a few adjacent cache lines instead of
+ * walking a bucket list.
+ *
+ * Unlinked slots are marked as deleted rather than moved so a node
+ * keeps its slot for as long as a traversal holds it.  Every node is
+ * also kept in a list in insertion order, which is what iterators and
+ * full traversals walk.  Growing the slot array therefore never changes
+ * the iteration order.
+ */
+
+#include "asterisk.h"
+
+#include "asterisk/_private.h"
+#include "asterisk/astobj2.h"
+#include "astobj2_private.h"
+#include "astobj2_container_private.h"
+#include "asterisk/dlinkedlists.h"
+#include "asterisk/utils.h"
+
+/*! Minimum number of slots in the slot array */
+#define OPEN_HASH_MIN_SLOTS 16
+
+struct open_hash_node {
+	/*!
+	 * \brief Items common to all container nodes.
+	 * \note Must be first in the specific node struct.
+	 */
+	struct ao2_container_node common;
+	/*! Next node links in the insertion order list. */
+	AST_DLLIST_ENTRY(open_hash_node) links;
+	/*! Hash value of the node object. */
+	unsigned int hash;
+	/*! Slot holding the node. */
+	unsigned int my_slot;
+};
+
+struct open_hash_slot {
+	/*! Hash value of the node in the slot. */
+	unsigned int hash;
+	/*! Node in the slot.  NULL if empty or OPEN_HASH_DELETED. */
+	struct open_hash_node *node;
+};
+
+/*! Marker for a slot whose node was removed. */
+static struct open_hash_node open_hash_deleted;
+#define OPEN_HASH_DELETED (&open_hash_deleted)
+
+/*!
+ * An open addressing hash container in addition to values common
+ * to all container types, stores the hash callback function, the
+ * slot array, and the list of nodes in insertion order.
+ */
+struct ao2_container_open_hash {
+	/*!
+	 * \brief Items common to all containers.
+	 * \note Must be first in the specific container struct.
+	 */
+	struct ao2_container common;
+	ao2_hash_fn *hash_fn;
+	/*! Number of objects the container was sized for. */
+	unsigned int n_expected;
+	/*! Number of slots minus one.  (The number of slots is a power of two.) */
+	unsigned int mask;
+	/*! Number of slots holding a node. */
+	unsigned int used;
+	/*! Number of slots marked as deleted. */
+	unsigned int deleted;
+	/*! Slot array. */
+	struct open_hash_slot *slots;
+	/*! List of all nodes in insertion order. */
+	AST_DLLIST_HEAD_NOLOCK(, open_hash_node) list;
+};
+
+/*! Traversal state to restart an open hash container traversal. */
+struct open_hash_traversal_state {
+	/*! Active sort function in the traversal if not NULL. */
+	ao2_sort_fn *sort_fn;
+	/*! Saved comparison callback arg pointer. */
+	void *arg;
+	/*! Hash value being probed for if keyed. */
+	unsigned int hash;
+	/*! Saved search flags to control traversing the container. */
+	enum search_flags flags;
+	/*! TRUE if the search probes the slots for a key */
+	unsigned int keyed:1;
+	/*! TRUE if it is a descending search */
+	unsigned int descending:1;
+};
+
+struct open_hash_traversal_state_check {
+	/*
+	 * If we have a division by zero compile error here then there
+	 * is not enough room for the state.  Increase AO2_TRAVERSAL_STATE_SIZE.
+	 */
+	char check[1 / (AO2_TRAVERSAL_STATE_SIZE / sizeof(struct open_hash_traversal_state))];
+};
+
+/*!
+ * \internal
+ * \brief Hash an object or key.
+ *
+ * \details The user hash is mixed so that hash functions returning
+ * sequential or patterned values still spread over the slots.
+ */
+static unsigned int open_hash_value(struct ao2_container_open_hash *self, const void *arg, int flags)
+{
+	unsigned int hash = self->hash_fn(arg, flags);
+
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+/*!
+ * \internal
+ * \brief Get the number of slots needed to hold a number of objects.
+ */
+static unsigned int open_hash_slots_needed(unsigned int objects)
+{
+	unsigned int n_slots = OPEN_HASH_MIN_SLOTS;
+
+	/* Keep the slots at most half full after sizing */
+	while (n_slots / 2 < objects) {
+		n_slots <<= 1;
+	}
+
+	return n_slots;
+}
+
+/*!
+ * \internal
+ * \brief Place a node into the first free slot of its probe sequence.
+ */
+static void open_hash_slot_place(struct ao2_container_open_hash *self, struct open_hash_node *node)
+{
+	unsigned int idx;
+
+	for (idx = node->hash & self->mask;
+		self->slots[idx].node && self->slots[idx].node != OPEN_HASH_DELETED;
+		idx = (idx + 1) & self->mask) {
+	}
+
+	if (self->slots[idx].node == OPEN_HASH_DELETED) {
+		--self->deleted;
+	}
+	self->slots[idx].hash = node->hash;
+	self->slots[idx].node = node;
+	node->my_slot = idx;
+	++self->used;
+}
+
+/*!
+ * \internal
+ * \brief Rebuild the slot array with a new number of slots.
+ *
+ * \retval 0 on success.
+ * \retval -1 on allocation failure.  The slot array is unchanged.
+ */
+static int open_hash_resize(struct ao2_container_open_hash *self, unsigned int n_slots)
+{
+	struct open_hash_slot *slots;
+	struct open_hash_slot *old_slots;
+	unsigned int old_n_slots;
+	unsigned int idx;
+
+	slots = ast_calloc(n_slots, sizeof(*slots));
+	if (!slots) {
+		return -1;
+	}
+
+	old_slots = self->slots;
+	old_n_slots = self->mask + 1;
+
+	self->slots = slots;
+	self->mask = n_slots - 1;
+	self->used = 0;
+	self->deleted = 0;
+
+	for (idx = 0; idx < old_n_slots; ++idx) {
+		if (old_slots[idx].node && old_slots[idx].node != OPEN_HASH_DELETED) {
+			open_hash_slot_place(self, old_slots[idx].node);
+		}
+	}
+	ast_free(old_slots);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Create an empty copy of this container.
+ *
+ * \param self Container to operate upon.
+ * \param tag used for debugging.
+ * \param file Debug file name invoked from
+ * \param line Debug line invoked from
+ * \param func Debug function name invoked from
+ *
+ * \return empty-clone-container on success.
+ * \retval NULL on error.
+ */
+static struct ao2_container *open_hash_ao2_alloc_empty_clone(struct ao2_container_open_hash *self,
+	const char *tag, const char *file, int line, const char *func)
+{
+	if (!__is_ao2_object(self, file, line, func)) {
+		return NULL;
+	}
+
+	return __ao2_container_alloc_open_hash(ao2_options_get(self), self->common.options,
+		self->n_expected, self->hash_fn, self->common.sort_fn, self->common.cmp_fn,
+		tag, file, line, func);
+}
+
+/*!
+ * \internal
+ * \brief Destroy an open hash container node.
+ *
+ * \param v_doomed Container node to destroy.
+ *
+ * \details
+ * The container node unlinks itself from the container as part
+ * of its destruction.  The node must be destroyed while the
+ * container is already locked.
+ *
+ * \note The container must be locked when the node is
+ * unreferenced.
+ */
+static void open_hash_ao2_node_destructor(void *v_doomed)
+{
+	struct open_hash_node *doomed = v_doomed;
+
+	if (doomed->common.is_linked) {
+		struct ao2_container_open_hash *my_container;
+
+		/*
+		 * Promote to write lock if not already there.  Since
+		 * adjust_lock() can potentially release and block waiting for a
+		 * write lock, care must be taken to ensure that node references
+		 * are released before releasing the container references.
+		 *
+		 * Node references held by an iterator can only be held while
+		 * the iterator also holds a reference to the container.  These
+		 * node references must be unreferenced before the container can
+		 * be unreferenced to ensure that the node will not get a
+		 * negative reference and the destructor called twice for the
+		 * same node.
+		 */
+		my_container = (struct ao2_container_open_hash *) doomed->common.my_container;
+#ifdef AST_DEVMODE
+		is_ao2_object(my_container);
+#endif
+
+		__adjust_lock(my_container, AO2_LOCK_REQ_WRLOCK, 1);
+
+#if defined(AO2_DEBUG)
+		if (!my_container->common.destroying
+			&& ao2_container_check(doomed->common.my_container, OBJ_NOLOCK)) {
+			ast_log(LOG_ERROR, "Container integrity failed before node deletion.\n");
+		}
+#endif	/* defined(AO2_DEBUG) */
+		my_container->slots[doomed->my_slot].node = OPEN_HASH_DELETED;
+		--my_container->used;
+		++my_container->deleted;
+		AST_DLLIST_REMOVE(&my_container->list, doomed, links);
+		AO2_DEVMODE_STAT(ast_atomic_fetchadd_int(&my_container->common.nodes, -1));
+	}
+
+	/*
+	 * We could have an object in the node if the container is being
+	 * destroyed or the node had not been linked in yet.
+	 */
+	if (doomed->common.obj) {
+		__container_unlink_node(&doomed->common, AO2_UNLINK_NODE_UNLINK_OBJECT);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Create a new container node.
+ *
+ * \param self Container to operate upon.
+ * \param obj_new Object to put into the node.
+ * \param tag used for debugging.
+ * \param file Debug file name invoked from
+ * \param line Debug line invoked from
+ * \param func Debug function name invoked from
+ *
+ * \return initialized-node on success.
+ * \retval NULL on error.
+ */
+static struct open_hash_node *open_hash_ao2_new_node(struct ao2_container_open_hash *self,
+	void *obj_new, const char *tag, const char *file, int line, const char *func)
+{
+	struct open_hash_node *node;
+
+	node = ao2_alloc_options(sizeof(*node), open_hash_ao2_node_destructor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK | AO2_ALLOC_OPT_NO_REF_DEBUG);
+	if (!node) {
+		return NULL;
+	}
+
+	__ao2_ref(obj_new, +1, tag ?: "Container node creation", file, line, func);
+	node->common.obj = obj_new;
+	node->common.my_container = (struct ao2_container *) self;
+	node->hash = open_hash_value(self, obj_new, OBJ_SEARCH_OBJECT);
+
+	return node;
+}
+
+/*!
+ * \internal
+ * \brief Insert a node into this container.
+ *
+ * \param self Container to operate upon.
+ * \param node Container node to insert into the container.
+ *
+ * \details Duplicate objects are only recognized when a sort
+ * function is given, the same as for hash containers.
+ *
+ * \return \ref ao2_container_insert value.
+ */
+static enum ao2_container_insert open_hash_ao2_insert_node(struct ao2_container_open_hash *self,
+	struct open_hash_node *node)
+{
+	ao2_sort_fn *sort_fn;
+	uint32_t options;
+	unsigned int n_slots;
+	unsigned int idx;
+
+	sort_fn = self->common.sort_fn;
+	options = self->common.options;
+
+	if (sort_fn && (options & AO2_CONTAINER_ALLOC_OPT_DUPS_MASK) != AO2_CONTAINER_ALLOC_OPT_DUPS_ALLOW) {
+		for (idx = node->hash & self->mask; self->slots[idx].node; idx = (idx + 1) & self->mask) {
+			struct open_hash_node *cur = self->slots[idx].node;
+
+			if (cur == OPEN_HASH_DELETED || self->slots[idx].hash != node->hash
+				|| !cur->common.obj
+				|| sort_fn(cur->common.obj, node->common.obj, OBJ_SEARCH_OBJECT)) {
+				continue;
+			}
+			switch (options & AO2_CONTAINER_ALLOC_OPT_DUPS_MASK) {
+			case AO2_CONTAINER_ALLOC_OPT_DUPS_REJECT:
+				/* Reject all objects with the same key. */
+				return AO2_CONTAINER_INSERT_NODE_REJECTED;
+			case AO2_CONTAINER_ALLOC_OPT_DUPS_OBJ_REJECT:
+				if (cur->common.obj == node->common.obj) {
+					/* Reject inserting the same object */
+					return AO2_CONTAINER_INSERT_NODE_REJECTED;
+				}
+				break;
+			case AO2_CONTAINER_ALLOC_OPT_DUPS_REPLACE:
+				SWAP(cur->common.obj, node->common.obj);
+				ao2_ref(node, -1);
+				return AO2_CONTAINER_INSERT_NODE_OBJ_REPLACED;
+			default:
+				break;
+			}
+		}
+	}
+
+	/* Keep the slots at most three quarters full including deleted slots. */
+	if ((self->mask + 1) / 4 * 3 < self->used + self->deleted + 1) {
+		n_slots = open_hash_slots_needed(self->used + 1);
+		if (open_hash_resize(self, MAX(n_slots, self->mask + 1))
+			&& self->mask < self->used + self->deleted + 1) {
+			/* There must always be an empty slot to end a probe. */
+			return AO2_CONTAINER_INSERT_NODE_REJECTED;
+		}
+	}
+
+	open_hash_slot_place(self, node);
+	if (options & AO2_CONTAINER_ALLOC_OPT_INSERT_BEGIN) {
+		AST_DLLIST_INSERT_HEAD(&self->list, node, links);
+	} else {
+		AST_DLLIST_INSERT_TAIL(&self->list, node, links);
+	}
+
+	return AO2_CONTAINER_INSERT_NODE_INSERTED;
+}
+
+/*!
+ * \internal
+ * \brief Find the next node matching a keyed traversal.
+ *
+ * \param self Container to operate upon.
+ * \param state Traversal state.
+ * \param idx Slot to continue probing from.
+ *
+ * \return node-ptr of found node (Not reffed).
+ * \retval NULL when no node found.
+ */
+static struct open_hash_node *open_hash_probe(struct ao2_container_open_hash *self,
+	struct open_hash_traversal_state *state, unsigned int idx)
+{
+	struct open_hash_node *node;
+
+	for (; (node = self->slots[idx].node); idx = (idx + 1) & self->mask) {
+		if (node == OPEN_HASH_DELETED || self->slots[idx].hash != state->hash
+			|| !node->common.obj) {
+			continue;
+		}
+		if (state->sort_fn
+			&& state->sort_fn(node->common.obj, state->arg, state->flags & OBJ_SEARCH_MASK)) {
+			continue;
+		}
+		return node;
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Find the next node in the insertion order list of a traversal.
+ *
+ * \param state Traversal state.
+ * \param node Node to start checking from.
+ *
+ * \return node-ptr of found node (Not reffed).
+ * \retval NULL when no node found.
+ */
+static struct open_hash_node *open_hash_list_walk(struct open_hash_traversal_state *state,
+	struct open_hash_node *node)
+{
+	for (; node; node = state->descending
+			? AST_DLLIST_PREV(node, links) : AST_DLLIST_NEXT(node, links)) {
+		if (!node->common.obj) {
+			/* Node is empty */
+			continue;
+		}
+		if (state->sort_fn
+			&& state->sort_fn(node->common.obj, state->arg, state->flags & OBJ_SEARCH_MASK)) {
+			continue;
+		}
+		return node;
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Find the first open hash container node in a traversal.
+ *
+ * \param self Container to operate upon.
+ * \param flags search_flags to control traversing the container
+ * \param arg Comparison callback arg parameter.
+ * \param state Traversal state to restart open hash container traversal.
+ *
+ * \return node-ptr of found node (Reffed).
+ * \retval NULL when no node found.
+ */
+static struct open_hash_node *open_hash_ao2_find_first(struct ao2_container_open_hash *self,
+	enum search_flags flags, void *arg, struct open_hash_traversal_state *state)
+{
+	struct open_hash_node *node;
+
+	memset(state, 0, sizeof(*state));
+	state->arg = arg;
+	state->flags = flags;
+
+	/* Determine traversal order. */
+	switch (flags & OBJ_ORDER_MASK) {
+	case OBJ_ORDER_POST:
+	case OBJ_ORDER_DESCENDING:
+		state->descending = 1;
+		break;
+	case OBJ_ORDER_PRE:
+	case OBJ_ORDER_ASCENDING:
+	default:
+		break;
+	}
+
+	/*
+	 * If lookup by pointer or search key, probe the slots for the
+	 * hash value.  Otherwise, traverse the whole container.
+	 */
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+	case OBJ_SEARCH_KEY:
+		state->keyed = 1;
+		state->hash = open_hash_value(self, arg, flags & OBJ_SEARCH_MASK);
+		state->sort_fn = self->common.sort_fn;
+		node = open_hash_probe(self, state, state->hash & self->mask);
+		break;
+	case OBJ_SEARCH_PARTIAL_KEY:
+		state->sort_fn = self->common.sort_fn;
+		/* Fall through */
+	default:
+		node = open_hash_list_walk(state, state->descending
+			? AST_DLLIST_LAST(&self->list) : AST_DLLIST_FIRST(&self->list));
+		break;
+	}
+
+	if (node) {
+		/* We have the first traversal node */
+		ao2_ref(node, +1);
+	}
+	return node;
+}
+
+/*!
+ * \internal
+ * \brief Find the next open hash container node in a traversal.
+ *
+ * \param self Container to operate upon.
+ * \param state Traversal state to restart open hash container traversal.
+ * \param prev Previous node returned by the traversal search functions.
+ *    The ref ownership is passed back to this function.
+ *
+ * \return node-ptr of found node (Reffed).
+ * \retval NULL when no node found.
+ */
+static struct open_hash_node *open_hash_ao2_find_next(struct ao2_container_open_hash *self,
+	struct open_hash_traversal_state *state, struct open_hash_node *prev)
+{
+	struct open_hash_node *node;
+
+	for (;;) {
+		if (state->keyed) {
+			node = open_hash_probe(self, state, (prev->my_slot + 1) & self->mask);
+		} else {
+			node = open_hash_list_walk(state, state->descending
+				? AST_DLLIST_PREV(prev, links) : AST_DLLIST_NEXT(prev, links));
+		}
+		if (!node) {
+			break;
+		}
+
+		/* We have the next traversal node */
+		ao2_ref(node, +1);
+
+		/*
+		 * Dereferencing the prev node may result in our next node
+		 * object being removed by another thread.  This could happen if
+		 * the container uses RW locks and the container was read
+		 * locked.
+		 */
+		ao2_ref(prev, -1);
+		if (node->common.obj) {
+			return node;
+		}
+		prev = node;
+	}
+
+	/* No more nodes in the container left to traverse. */
+	ao2_ref(prev, -1);
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Find the next non-empty iteration node in the container.
+ *
+ * \param self Container to operate upon.
+ * \param node Previous node returned by the iterator.
+ * \param flags search_flags to control iterating the container.
+ *   Only AO2_ITERATOR_DESCENDING is useful by the method.
+ *
+ * \note The container is already locked.
+ *
+ * \return node on success.
+ * \retval NULL on error or no more nodes in the container.
+ */
+static struct open_hash_node *open_hash_ao2_iterator_next(struct ao2_container_open_hash *self,
+	struct open_hash_node *node, enum ao2_iterator_flags flags)
+{
+	if (flags & AO2_ITERATOR_DESCENDING) {
+		node = node ? AST_DLLIST_PREV(node, links) : AST_DLLIST_LAST(&self->list);
+		for (; node; node = AST_DLLIST_PREV(node, links)) {
+			if (node->common.obj) {
+				/* Found a non-empty node. */
+				return node;
+			}
+		}
+	} else {
+		node = node ? AST_DLLIST_NEXT(node, links) : AST_DLLIST_FIRST(&self->list);
+		for (; node; node = AST_DLLIST_NEXT(node, links)) {
+			if (node->common.obj) {
+				/* Found a non-empty node. */
+				return node;
+			}
+		}
+	}
+
+	/* No more nodes to visit in the container. */
+	return NULL;
+}
+
+/*!
+ * \internal
+ *
+ * \brief Destroy this container.
+ *
+ * \param self Container to operate upon.
+ */
+static void open_hash_ao2_destroy(struct ao2_container_open_hash *self)
+{
+	/* Check that the container no longer has any nodes */
+	if (!AST_DLLIST_EMPTY(&self->list)) {
+		ast_log(LOG_ERROR, "Node ref leak.  Open hash container still has nodes!\n");
+		ast_assert(0);
+	}
+
+	ast_free(self->slots);
+}
+
+#if defined(AO2_DEBUG)
+/*!
+ * \internal
+ * \brief Display contents of the specified container.
+ *
+ * \param self Container to dump.
+ * \param where User data needed by prnt to determine where to put output.
+ * \param prnt Print output callback function to use.
+ * \param prnt_obj Callback function to print the given object's key. (NULL if not available)
+ */
+static void open_hash_ao2_dump(struct ao2_container_open_hash *self, void *where, ao2_prnt_fn *prnt, ao2_prnt_obj_fn *prnt_obj)
+{
+#define FORMAT  "%6s, %10s, %16s, %16s, %s\n"
+#define FORMAT2 "%6u, %10x, %16p, %16p, "
+
+	struct open_hash_node *node;
+
+	prnt(where, "Number of slots: %u\n\n", self->mask + 1);
+
+	prnt(where, FORMAT, "Slot", "Hash", "Node", "Obj", "Key");
+	AST_DLLIST_TRAVERSE(&self->list, node, links) {
+		prnt(where, FORMAT2, node->my_slot, node->hash, node, node->common.obj);
+		if (node->common.obj && prnt_obj) {
+			prnt_obj(node->common.obj, where, prnt);
+		}
+		prnt(where, "\n");
+	}
+
+#undef FORMAT
+#undef FORMAT2
+}
+#endif	/* defined(AO2_DEBUG) */
+
+#if defined(AO2_DEBUG)
+/*!
+ * \internal
+ * \brief Display statistics of the specified container.
+ *
+ * \param self Container to display statistics.
+ * \param where User data needed by prnt to determine where to put output.
+ * \param prnt Print output callback function to use.
+ *
+ * \note The container is already locked for reading.
+ */
+static void open_hash_ao2_stats(struct ao2_container_open_hash *self, void *where, ao2_prnt_fn *prnt)
+{
+	struct open_hash_node *node;
+	unsigned int max_probe = 0;
+	unsigned int probe;
+
+	AST_DLLIST_TRAVERSE(&self->list, node, links) {
+		probe = (node->my_slot - node->hash) & self->mask;
+		if (max_probe < probe) {
+			max_probe = probe;
+		}
+	}
+
+	prnt(where, "Number of slots: %u\n", self->mask + 1);
+	prnt(where, "Used slots: %u\n", self->used);
+	prnt(where, "Deleted slots: %u\n", self->deleted);
+	prnt(where, "Longest probe: %u\n", max_probe + 1);
+}
+#endif	/* defined(AO2_DEBUG) */
+
+#if defined(AO2_DEBUG)
+/*!
+ * \internal
+ * \brief Perform an integrity check on the specified container.
+ *
+ * \param self Container to check integrity.
+ *
+ * \note The container is already locked for reading.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+static int open_hash_ao2_integrity(struct ao2_container_open_hash *self)
+{
+	struct open_hash_node *node;
+	unsigned int idx;
+	unsigned int used = 0;
+	unsigned int deleted = 0;
+	int count_obj = 0;
+	int count_node = 0;
+
+	for (idx = 0; idx <= self->mask; ++idx) {
+		node = self->slots[idx].node;
+		if (!node) {
+			continue;
+		}
+		if (node == OPEN_HASH_DELETED) {
+			++deleted;
+			continue;
+		}
+		++used;
+		if (node->my_slot != idx) {
+			ast_log(LOG_ERROR, "Slot %u node claims to be in slot %u!\n", idx, node->my_slot);
+			return -1;
+		}
+		if (node->hash != self->slots[idx].hash) {
+			ast_log(LOG_ERROR, "Slot %u hash does not match its node!\n", idx);
+			return -1;
+		}
+	}
+	if (used != self->used || deleted != self->deleted) {
+		ast_log(LOG_ERROR, "Slot counts of %u used and %u deleted do not match stats of %u and %u!\n",
+			used, deleted, self->used, self->deleted);
+		return -1;
+	}
+	if (self->mask < used + deleted) {
+		ast_log(LOG_ERROR, "No empty slot is left to end a probe!\n");
+		return -1;
+	}
+
+	AST_DLLIST_TRAVERSE(&self->list, node, links) {
+		++count_node;
+		if (self->slots[node->my_slot].node != node) {
+			ast_log(LOG_ERROR, "Node is not in its slot %u!\n", node->my_slot);
+			return -1;
+		}
+		if (!node->common.obj) {
+			/* Node is empty. */
+			continue;
+		}
+		++count_obj;
+		if (node->hash != open_hash_value(self, node->common.obj, OBJ_SEARCH_OBJECT)) {
+			ast_log(LOG_ERROR, "Slot %u node hash does not match its object!\n", node->my_slot);
+			return -1;
+		}
+	}
+
+	/* Check total obj count. */
+	if (count_obj != ao2_container_count(&self->common)) {
+		ast_log(LOG_ERROR,
+			"Total object count of %d does not match ao2_container_count() of %d!\n",
+			count_obj, ao2_container_count(&self->common));
+		return -1;
+	}
+
+	/* Check total node count. */
+	if (count_node != self->used || count_node != self->common.nodes) {
+		ast_log(LOG_ERROR, "Total node count of %d does not match stat of %d!\n",
+			count_node, self->common.nodes);
+		return -1;
+	}
+
+	return 0;
+}
+#endif	/* defined(AO2_DEBUG) */
+
+/*! Open hash container virtual method table. */
+static const struct ao2_container_methods v_table_open_hash = {
+	.alloc_empty_clone = (ao2_container_alloc_empty_clone_fn) open_hash_ao2_alloc_empty_clone,
+	.new_node = (ao2_container_new_node_fn) open_hash_ao2_new_node,
+	.insert = (ao2_container_insert_fn) open_hash_ao2_insert_node,
+	.traverse_first = (ao2_container_find_first_fn) open_hash_ao2_find_first,
+	.traverse_next = (ao2_container_find_next_fn) open_hash_ao2_find_next,
+	.iterator_next = (ao2_iterator_next_fn) open_hash_ao2_iterator_next,
+	.destroy = (ao2_container_destroy_fn) open_hash_ao2_destroy,
+#if defined(AO2_DEBUG)
+	.dump = (ao2_container_display) open_hash_ao2_dump,
+	.stats = (ao2_container_statistics) open_hash_ao2_stats,
+	.integrity = (ao2_container_integrity) open_hash_ao2_integrity,
+#endif	/* defined(AO2_DEBUG) */
+};
+
+/*!
+ * \brief always zero hash function
+ *
+ * \retval 0
+ */
+static int open_hash_zero(const void *user_obj, const int flags)
+{
+	return 0;
+}
+
+struct ao2_container *__ao2_container_alloc_open_hash(unsigned int ao2_options,
+	unsigned int container_options, unsigned int n_expected, ao2_hash_fn *hash_fn,
+	ao2_sort_fn *sort_fn, ao2_callback_fn *cmp_fn,
+	const char *tag, const char *file, int line, const char *func)
+{
+	struct ao2_container_open_hash *self;
+	unsigned int n_slots;
+
+	self = __ao2_alloc(sizeof(*self), container_destruct, ao2_options,
+		tag ?: __PRETTY_FUNCTION__, file, line, func);
+	if (!self) {
+		return NULL;
+	}
+
+	n_slots = open_hash_slots_needed(n_expected);
+
+	self->common.v_table = &v_table_open_hash;
+	self->common.sort_fn = sort_fn;
+	self->common.cmp_fn = cmp_fn;
+	/* Only hash containers are sharded. */
+	self->common.options = container_options & ~AO2_CONTAINER_ALLOC_OPT_SHARDED;
+	self->hash_fn = hash_fn ? hash_fn : open_hash_zero;
+	self->n_expected = n_expected;
+	self->mask = n_slots - 1;
+
+#ifdef AO2_DEBUG
+	ast_atomic_fetchadd_int(&ao2.total_containers, 1);
+#endif	/* defined(AO2_DEBUG) */
+
+	self->slots = ast_calloc(n_slots, sizeof(*self->slots));
+	if (!self->slots) {
+		ao2_ref(self, -1);
+		return NULL;
+	}
+
+	return (struct ao2_container *) self;
+}
@@ -2010,7 +2010,8 @@ static struct ao2_container *rb_ao2_container_init(struct ao2_container_rbtree *
 	self->common.v_table = &v_table_rbtree;
 	self->common.sort_fn = sort_fn;
 	self->common.cmp_fn = cmp_fn;
-	self->common.options = options;
+	/* Only hash containers can be sharded. */
+	self->common.options = options & ~AO2_CONTAINER_ALLOC_OPT_SHARDED;
 
 #ifdef AO2_DEBUG
 	ast_atomic_fetchadd_int(&ao2.total_containers, 1);
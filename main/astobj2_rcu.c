@@ -0,0 +1,172 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Read-copy-update holder for read-mostly ao2 containers.
+ *
+ * Readers register in one of two reader counts, selected by the low bit
+ * of the holder's epoch, before loading the current snapshot.  A writer
+ * swaps in the new snapshot, flips the epoch, and waits for the count
+ * of the previous epoch to drain before releasing the old snapshot.  A
+ * reader that registers after the flip rechecks the epoch and moves to
+ * the new count, so it can only observe the new snapshot.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <sched.h>
+
+#include "asterisk/astobj2.h"
+#include "asterisk/lock.h"
+#include "asterisk/utils.h"
+
+struct ao2_rcu_container {
+	/*! Published snapshot */
+	struct ao2_container *current;
+	/*! Readers registered in each epoch */
+	int readers[2];
+	/*! Current epoch, only the low bit selects the reader count */
+	unsigned int epoch;
+};
+
+/*!
+ * \internal
+ * \brief Enter a read side critical section.
+ *
+ * \return Index of the reader count to pass to rcu_read_unlock().
+ */
+static unsigned int rcu_read_lock(struct ao2_rcu_container *rcu)
+{
+	unsigned int idx;
+
+	for (;;) {
+		idx = ast_atomic_load_n(&rcu->epoch, __ATOMIC_SEQ_CST) & 1;
+		ast_atomic_fetch_add(&rcu->readers[idx], 1, __ATOMIC_SEQ_CST);
+		if ((ast_atomic_load_n(&rcu->epoch, __ATOMIC_SEQ_CST) & 1) == idx) {
+			return idx;
+		}
+		/* A writer flipped the epoch under us, register again */
+		ast_atomic_fetch_sub(&rcu->readers[idx], 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+static void rcu_read_unlock(struct ao2_rcu_container *rcu, unsigned int idx)
+{
+	ast_atomic_fetch_sub(&rcu->readers[idx], 1, __ATOMIC_SEQ_CST);
+}
+
+static void rcu_container_destructor(void *obj)
+{
+	struct ao2_rcu_container *rcu = obj;
+
+	ao2_cleanup(rcu->current);
+}
+
+struct ao2_rcu_container *ao2_rcu_container_alloc(struct ao2_container *initial)
+{
+	struct ao2_rcu_container *rcu;
+
+	rcu = ao2_alloc(sizeof(*rcu), rcu_container_destructor);
+	if (!rcu) {
+		return NULL;
+	}
+
+	rcu->current = ao2_bump(initial);
+
+	return rcu;
+}
+
+void ao2_rcu_container_publish(struct ao2_rcu_container *rcu, struct ao2_container *snapshot)
+{
+	struct ao2_container *old;
+	unsigned int idx;
+
+	ao2_lock(rcu);
+
+	old = ast_atomic_exchange_n(&rcu->current, ao2_bump(snapshot), __ATOMIC_SEQ_CST);
+	idx = ast_atomic_fetch_add(&rcu->epoch, 1, __ATOMIC_SEQ_CST) & 1;
+
+	/* Wait for the readers that could still see the old snapshot */
+	while (ast_atomic_load_n(&rcu->readers[idx], __ATOMIC_SEQ_CST)) {
+		sched_yield();
+	}
+
+	ao2_unlock(rcu);
+
+	ao2_cleanup(old);
+}
+
+struct ao2_container *ao2_rcu_container_ref(struct ao2_rcu_container *rcu)
+{
+	struct ao2_container *snapshot;
+	unsigned int idx;
+
+	idx = rcu_read_lock(rcu);
+	snapshot = ao2_bump(ast_atomic_load_n(&rcu->current, __ATOMIC_SEQ_CST));
+	rcu_read_unlock(rcu, idx);
+
+	return snapshot;
+}
+
+void *ao2_rcu_callback(struct ao2_rcu_container *rcu, enum search_flags flags,
+	ao2_callback_fn *cb_fn, void *arg)
+{
+	struct ao2_container *snapshot;
+	void *res = NULL;
+	unsigned int idx;
+
+	if (flags & OBJ_UNLINK) {
+		ast_log(LOG_ERROR, "Cannot unlink objects from a read-copy-update snapshot\n");
+		ast_assert(0);
+		return NULL;
+	}
+
+	idx = rcu_read_lock(rcu);
+	snapshot = ast_atomic_load_n(&rcu->current, __ATOMIC_SEQ_CST);
+	if (snapshot) {
+		res = ao2_callback(snapshot, flags, cb_fn, arg);
+	}
+	rcu_read_unlock(rcu, idx);
+
+	return res;
+}
+
+void *ao2_rcu_find(struct ao2_rcu_container *rcu, const void *arg, enum search_flags flags)
+{
+	struct ao2_container *snapshot;
+	void *res = NULL;
+	unsigned int idx;
+
+	if (flags & OBJ_UNLINK) {
+		ast_log(LOG_ERROR, "Cannot unlink objects from a read-copy-update snapshot\n");
+		ast_assert(0);
+		return NULL;
+	}
+
+	idx = rcu_read_lock(rcu);
+	snapshot = ast_atomic_load_n(&rcu->current, __ATOMIC_SEQ_CST);
+	if (snapshot) {
+		res = ao2_find(snapshot, arg, flags);
+	}
+	rcu_read_unlock(rcu, idx);
+
+	return res;
+}
@@ -47,11 +47,22 @@
 
 #define DEFAULT_INTERNAL_SAMPLE_RATE 8000
 
+/*! The most rates, other than that of the list, that spies are fed shared audio at */
+#define AUDIOHOOK_SPY_TAPS 4
+
 struct ast_audiohook_translate {
 	struct ast_trans_pvt *trans_pvt;
 	struct ast_format *format;
 };
 
+/*! \brief Audio of a direction, resampled once for all the spies wanting it at a rate */
+struct ast_audiohook_tap {
+	/*! The rate the spies want, 0 if the tap is unused */
+	int rate;
+	/*! Resamples from the signed linear audio of the list */
+	struct ast_audiohook_translate translate;
+};
+
 struct ast_audiohook_list {
 	/* If all the audiohooks in this list are capable
 	 * of processing slinear at any sample rate, this
@@ -62,6 +73,7 @@ struct ast_audiohook_list {
 
 	struct ast_audiohook_translate in_translate[2];
 	struct ast_audiohook_translate out_translate[2];
+	struct ast_audiohook_tap spy_taps[2][AUDIOHOOK_SPY_TAPS];
 	AST_LIST_HEAD_NOLOCK(, ast_audiohook) spy_list;
 	AST_LIST_HEAD_NOLOCK(, ast_audiohook) whisper_list;
 	AST_LIST_HEAD_NOLOCK(, ast_audiohook) manipulate_list;
@@ -224,34 +236,23 @@ static struct ast_frame *audiohook_read_frame_single(struct ast_audiohook *audio
 {
 	struct ast_slinfactory *factory = (direction == AST_AUDIOHOOK_DIRECTION_READ ? &audiohook->read_factory : &audiohook->write_factory);
 	int vol = (direction == AST_AUDIOHOOK_DIRECTION_READ ? audiohook->options.read_volume : audiohook->options.write_volume);
-	short buf[samples];
-	struct ast_frame frame = {
-		.frametype = AST_FRAME_VOICE,
-		.subclass.format = ast_format_cache_get_slin_by_rate(audiohook->hook_internal_samp_rate),
-		.data.ptr = buf,
-		.datalen = sizeof(buf),
-		.samples = samples,
-	};
-
-	/* Ensure the factory is able to give us the samples we want */
-	if (samples > ast_slinfactory_available(factory)) {
-		return NULL;
-	}
+	struct ast_frame *frame;
 
-	/* Read data in from factory */
-	if (!ast_slinfactory_read(factory, buf, samples)) {
+	/* The frame shares the audio in the factory, until it is changed below */
+	frame = ast_slinfactory_read_frame(factory, samples);
+	if (!frame) {
 		return NULL;
 	}
 
 	if (SHOULD_MUTE(audiohook, direction)) {
 		/* Swap frame data for zeros if mute is required */
-		ast_frame_clear(&frame);
+		ast_frame_clear(frame);
 	} else if (vol) {
 		/* If a volume adjustment needs to be applied apply it */
-		ast_frame_adjust_volume(&frame, vol);
+		ast_frame_adjust_volume(frame, vol);
 	}
 
-	return ast_frdup(&frame);
+	return frame;
 }
 
 static struct ast_frame *audiohook_read_frame_both(struct ast_audiohook *audiohook, size_t samples, struct ast_frame **read_reference, struct ast_frame **write_reference)
@@ -589,6 +590,8 @@ void ast_audiohook_detach_list(struct ast_audiohook_list *audiohook_list)
 
 	/* Drop translation paths if present */
 	for (i = 0; i < 2; i++) {
+		int j;
+
 		if (audiohook_list->in_translate[i].trans_pvt) {
 			ast_translator_free_path(audiohook_list->in_translate[i].trans_pvt);
 			ao2_cleanup(audiohook_list->in_translate[i].format);
@@ -597,6 +600,12 @@ void ast_audiohook_detach_list(struct ast_audiohook_list *audiohook_list)
 			ast_translator_free_path(audiohook_list->out_translate[i].trans_pvt);
 			ao2_cleanup(audiohook_list->in_translate[i].format);
 		}
+		for (j = 0; j < AUDIOHOOK_SPY_TAPS; j++) {
+			if (audiohook_list->spy_taps[i][j].translate.trans_pvt) {
+				ast_translator_free_path(audiohook_list->spy_taps[i][j].translate.trans_pvt);
+			}
+			ao2_cleanup(audiohook_list->spy_taps[i][j].translate.format);
+		}
 	}
 
 	/* Free ourselves */
@@ -865,6 +874,73 @@ static struct ast_frame *audiohook_list_translate_to_native(struct ast_audiohook
  * \param audiohook the audiohook to update
  * \param rate the current max internal sample rate
  */
+/*!
+ * \brief Get the audio to feed a spy, at the rate of the spy
+ *
+ * \details
+ * A spy at a rate other than that of the list would resample the audio in
+ * its own factory, so N spies on a channel would resample it N times.
+ * Instead the audio is resampled once per rate and direction, and every
+ * spy at that rate is fed the same frame.
+ *
+ * \param audiohook_list List the spy is on
+ * \param direction Direction of the audio
+ * \param middle_frame The signed linear audio of the list
+ * \param rate The rate of the spy
+ * \param tap_frames The frames resampled so far in this pass, by tap
+ * \param tapped Which taps have been resampled so far in this pass
+ *
+ * \return The frame to feed the spy, middle_frame if it is not resampled here
+ */
+static struct ast_frame *audiohook_list_spy_tap(struct ast_audiohook_list *audiohook_list,
+	enum ast_audiohook_direction direction, struct ast_frame *middle_frame, int rate,
+	struct ast_frame **tap_frames, unsigned int *tapped)
+{
+	struct ast_audiohook_tap *taps = audiohook_list->spy_taps[direction == AST_AUDIOHOOK_DIRECTION_READ ? 0 : 1];
+	struct ast_audiohook_tap *tap;
+	int i;
+
+	if (rate == ast_format_get_sample_rate(middle_frame->subclass.format)) {
+		return middle_frame;
+	}
+
+	for (i = 0; i < AUDIOHOOK_SPY_TAPS; i++) {
+		if (!taps[i].rate || taps[i].rate == rate) {
+			break;
+		}
+	}
+	if (i == AUDIOHOOK_SPY_TAPS) {
+		/* Too many rates, so leave it to the spy's factory */
+		return middle_frame;
+	}
+	tap = &taps[i];
+
+	if (!(*tapped & (1 << i))) {
+		*tapped |= 1 << i;
+
+		if (!tap->translate.format
+			|| ast_format_cmp(middle_frame->subclass.format, tap->translate.format) != AST_FORMAT_CMP_EQUAL) {
+			struct ast_trans_pvt *new_trans;
+
+			new_trans = ast_translator_build_path(ast_format_cache_get_slin_by_rate(rate),
+				middle_frame->subclass.format);
+			if (!new_trans) {
+				return middle_frame;
+			}
+			if (tap->translate.trans_pvt) {
+				ast_translator_free_path(tap->translate.trans_pvt);
+			}
+			tap->translate.trans_pvt = new_trans;
+			ao2_replace(tap->translate.format, middle_frame->subclass.format);
+			tap->rate = rate;
+		}
+
+		tap_frames[i] = ast_translate(tap->translate.trans_pvt, middle_frame, 0);
+	}
+
+	return tap_frames[i] ?: middle_frame;
+}
+
 static void audiohook_list_set_hook_rate(struct ast_audiohook_list *audiohook_list,
 					 struct ast_audiohook *audiohook, int *rate)
 {
@@ -914,8 +990,13 @@ static void audiohook_list_set_hook_rate(struct ast_audiohook_list *audiohook_li
 static struct ast_frame *audio_audiohook_write_list(struct ast_channel *chan, struct ast_audiohook_list *audiohook_list, enum ast_audiohook_direction direction, struct ast_frame *frame)
 {
 	struct ast_frame *start_frame = frame, *middle_frame = frame, *end_frame = frame;
+	struct ast_frame *spy_frame;
+	struct ast_frame *tap_frames[AUDIOHOOK_SPY_TAPS] = { NULL, };
+	unsigned int tapped = 0;
+	int tap;
 	struct ast_audiohook *audiohook = NULL;
 	int samples;
+	int middle_rate;
 	int middle_frame_manipulated = 0;
 	int removed = 0;
 	int internal_sample_rate;
@@ -936,6 +1017,7 @@ static struct ast_frame *audio_audiohook_write_list(struct ast_channel *chan, st
 	}
 
 	samples = middle_frame->samples;
+	middle_rate = ast_format_get_sample_rate(middle_frame->subclass.format);
 
 	/*
 	 * While processing each audiohook check to see if the internal sample rate needs
@@ -951,7 +1033,13 @@ static struct ast_frame *audio_audiohook_write_list(struct ast_channel *chan, st
 	internal_sample_rate = audiohook_list->list_internal_samp_rate;
 
 	/* ---Part_2: Send middle_frame to spy and manipulator lists.  middle_frame is guaranteed to be SLINEAR here.*/
-	/* Queue up signed linear frame to each spy */
+	/* Queue up signed linear frame to each spy, sharing one copy of the audio when there are several */
+	spy_frame = middle_frame;
+	if (AST_LIST_FIRST(&audiohook_list->spy_list)
+		&& AST_LIST_NEXT(AST_LIST_FIRST(&audiohook_list->spy_list), list)
+		&& !(spy_frame = ast_frdup_shared(middle_frame))) {
+		spy_frame = middle_frame;
+	}
 	AST_LIST_TRAVERSE_SAFE_BEGIN(&audiohook_list->spy_list, audiohook, list) {
 		ast_audiohook_lock(audiohook);
 		if (audiohook->status != AST_AUDIOHOOK_STATUS_RUNNING) {
@@ -965,10 +1053,23 @@ static struct ast_frame *audio_audiohook_write_list(struct ast_channel *chan, st
 			continue;
 		}
 		audiohook_list_set_hook_rate(audiohook_list, audiohook, &internal_sample_rate);
-		ast_audiohook_write_frame(audiohook, direction, middle_frame);
+		if (audiohook->hook_internal_samp_rate == middle_rate) {
+			ast_audiohook_write_frame(audiohook, direction, spy_frame);
+		} else {
+			ast_audiohook_write_frame(audiohook, direction, audiohook_list_spy_tap(audiohook_list,
+				direction, middle_frame, audiohook->hook_internal_samp_rate, tap_frames, &tapped));
+		}
 		ast_audiohook_unlock(audiohook);
 	}
 	AST_LIST_TRAVERSE_SAFE_END;
+	if (spy_frame != middle_frame) {
+		ast_frfree(spy_frame);
+	}
+	for (tap = 0; tap < AUDIOHOOK_SPY_TAPS; tap++) {
+		if (tap_frames[tap]) {
+			ast_frfree(tap_frames[tap]);
+		}
+	}
 
 	/* If this frame is being written out to the channel then we need to use whisper sources */
 	if (!AST_LIST_EMPTY(&audiohook_list->whisper_list)) {
@@ -999,14 +1100,16 @@ static struct ast_frame *audio_audiohook_write_list(struct ast_channel *chan, st
 		}
 		AST_LIST_TRAVERSE_SAFE_END;
 		/* We take all of the combined whisper sources and combine them into the audio being written out */
-		for (i = 0, data1 = middle_frame->data.ptr, data2 = combine_buf; i < samples; i++, data1++, data2++) {
-			ast_slinear_saturated_add(data1, data2);
+		if (!ast_frame_make_writable(middle_frame)) {
+			for (i = 0, data1 = middle_frame->data.ptr, data2 = combine_buf; i < samples; i++, data1++, data2++) {
+				ast_slinear_saturated_add(data1, data2);
+			}
+			middle_frame_manipulated = 1;
 		}
-		middle_frame_manipulated = 1;
 	}
 
-	/* Pass off frame to manipulate audiohooks */
-	if (!AST_LIST_EMPTY(&audiohook_list->manipulate_list)) {
+	/* Pass off frame to manipulate audiohooks, which change the audio in place */
+	if (!AST_LIST_EMPTY(&audiohook_list->manipulate_list) && !ast_frame_make_writable(middle_frame)) {
 		AST_LIST_TRAVERSE_SAFE_BEGIN(&audiohook_list->manipulate_list, audiohook, list) {
 			ast_audiohook_lock(audiohook);
 			if (audiohook->status != AST_AUDIOHOOK_STATUS_RUNNING) {
@@ -683,6 +683,7 @@ static void destroy_bridge(void *obj)
 	bridge->callid = 0;
 
 	cleanup_video_mode(bridge);
+	ao2_cleanup(bridge->softmix.mix_tap_data);
 
 	ast_string_field_free_memory(bridge);
 	ao2_cleanup(bridge->current_snapshot);
@@ -3702,6 +3703,26 @@ void ast_bridge_set_mixing_interval(struct ast_bridge *bridge, unsigned int mixi
 	ast_bridge_unlock(bridge);
 }
 
+void ast_bridge_set_mixing_threads(struct ast_bridge *bridge, unsigned int mixing_threads)
+{
+	ast_bridge_lock(bridge);
+	bridge->softmix.mixing_threads = mixing_threads;
+	ast_bridge_unlock(bridge);
+}
+
+void ast_bridge_set_mix_tap(struct ast_bridge *bridge, ast_bridge_mix_tap_fn tap, void *data)
+{
+	void *old;
+
+	ast_bridge_lock(bridge);
+	old = bridge->softmix.mix_tap_data;
+	bridge->softmix.mix_tap = tap;
+	bridge->softmix.mix_tap_data = tap ? ao2_bump(data) : NULL;
+	ast_bridge_unlock(bridge);
+
+	ao2_cleanup(old);
+}
+
 void ast_bridge_set_binaural_active(struct ast_bridge *bridge, unsigned int binaural_active)
 {
 	ast_bridge_lock(bridge);
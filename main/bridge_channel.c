@@ -1002,58 +1002,53 @@ static void bridge_frame_free(struct ast_frame *frame)
 	ast_frfree(frame);
 }
 
-int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr)
+/*!
+ * \internal
+ * \brief Check if a frame is to be dropped rather than queued before looking at the bridge channel.
+ */
+static int bridge_channel_queue_frame_discard(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr)
 {
-	struct ast_frame *dup;
-
 	if (bridge_channel->suspended
 		/* Also defer DTMF frames. */
 		&& fr->frametype != AST_FRAME_DTMF_BEGIN
 		&& fr->frametype != AST_FRAME_DTMF_END
 		&& !ast_is_deferrable_frame(fr)) {
 		/* Drop non-deferable frames when suspended. */
-		return 0;
+		return 1;
 	}
 	if (fr->frametype == AST_FRAME_NULL) {
 		/* "Accept" the frame and discard it. */
+		return 1;
+	}
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Check if the bridge channel accepts a frame into its write queue.
+ *
+ * \note The bridge_channel is expected to be locked.
+ */
+static int bridge_channel_queue_frame_accept(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr)
+{
+	if (bridge_channel->state != BRIDGE_CHANNEL_STATE_WAIT) {
+		/* Drop frames on channels leaving the bridge. */
 		return 0;
 	}
 
 	if ((fr->frametype == AST_FRAME_VOICE || fr->frametype == AST_FRAME_VIDEO ||
 		fr->frametype == AST_FRAME_TEXT || fr->frametype == AST_FRAME_IMAGE ||
 		fr->frametype == AST_FRAME_RTCP) && fr->stream_num > -1) {
-		int num = -1;
-
-		ast_bridge_channel_lock(bridge_channel);
-		if (fr->stream_num < (int)AST_VECTOR_SIZE(&bridge_channel->stream_map.to_channel)) {
-			num = AST_VECTOR_GET(&bridge_channel->stream_map.to_channel, fr->stream_num);
-		}
-		ast_bridge_channel_unlock(bridge_channel);
-
-		if (num == -1) {
+		if (fr->stream_num >= (int)AST_VECTOR_SIZE(&bridge_channel->stream_map.to_channel)
+			|| AST_VECTOR_GET(&bridge_channel->stream_map.to_channel, fr->stream_num) == -1) {
 			/* We don't have a mapped stream so just discard this frame. */
 			return 0;
 		}
 	}
 
-	dup = ast_frdup(fr);
-	if (!dup) {
-		return -1;
-	}
-
-	ast_bridge_channel_lock(bridge_channel);
-	if (bridge_channel->state != BRIDGE_CHANNEL_STATE_WAIT) {
-		/* Drop frames on channels leaving the bridge. */
-		ast_bridge_channel_unlock(bridge_channel);
-		bridge_frame_free(dup);
-		return 0;
-	}
-
 	if ((fr->frametype == AST_FRAME_TEXT || fr->frametype == AST_FRAME_TEXT_DATA) &&
 		!bridge_channel->features->text_messaging) {
 		/* This channel is not accepting text messages. */
-		ast_bridge_channel_unlock(bridge_channel);
-		bridge_frame_free(dup);
 		return 0;
 	}
 
@@ -1071,18 +1066,84 @@ int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, st
 		}
 	}
 
-	AST_LIST_INSERT_TAIL(&bridge_channel->wr_queue, dup, frame_list);
+	return 1;
+}
+
+/*!
+ * \internal
+ * \brief Make sure the bridge channel thread wakes up to handle its write queue.
+ *
+ * \details The thread takes everything queued each time it wakes up, so
+ * the alert pipe is only written once until it does.
+ *
+ * \note The bridge_channel is expected to be locked.
+ */
+static void bridge_channel_wr_queue_alert(struct ast_bridge_channel *bridge_channel)
+{
+	if (bridge_channel->wr_alerted) {
+		return;
+	}
 	if (ast_alertpipe_write(bridge_channel->alert_pipe)) {
 		ast_log(LOG_ERROR, "We couldn't write alert pipe for %p(%s)... something is VERY wrong\n",
 			bridge_channel, ast_channel_name(bridge_channel->chan));
+		return;
+	}
+	bridge_channel->wr_alerted = 1;
+}
+
+int ast_bridge_channel_queue_frames(struct ast_bridge_channel *bridge_channel, struct ast_frame **frames, size_t count)
+{
+	AST_LIST_HEAD_NOLOCK(, ast_frame) queue = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
+	AST_LIST_HEAD_NOLOCK(, ast_frame) dropped = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
+	struct ast_frame *dup;
+	size_t idx;
+	int res = 0;
+
+	/* Copy the frames before locking so the lock is only held to queue them. */
+	for (idx = 0; idx < count; ++idx) {
+		if (bridge_channel_queue_frame_discard(bridge_channel, frames[idx])) {
+			continue;
+		}
+		dup = ast_frshare(frames[idx]);
+		if (!dup) {
+			res = -1;
+			continue;
+		}
+		AST_LIST_INSERT_TAIL(&queue, dup, frame_list);
+	}
+	if (AST_LIST_EMPTY(&queue)) {
+		return res;
+	}
+
+	ast_bridge_channel_lock(bridge_channel);
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&queue, dup, frame_list) {
+		if (!bridge_channel_queue_frame_accept(bridge_channel, dup)) {
+			AST_LIST_REMOVE_CURRENT(frame_list);
+			AST_LIST_INSERT_TAIL(&dropped, dup, frame_list);
+		}
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+	if (!AST_LIST_EMPTY(&queue)) {
+		AST_LIST_APPEND_LIST(&bridge_channel->wr_queue, &queue, frame_list);
+		bridge_channel_wr_queue_alert(bridge_channel);
 	}
 	ast_bridge_channel_unlock(bridge_channel);
-	return 0;
+
+	while ((dup = AST_LIST_REMOVE_HEAD(&dropped, frame_list))) {
+		bridge_frame_free(dup);
+	}
+	return res;
+}
+
+int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr)
+{
+	return ast_bridge_channel_queue_frames(bridge_channel, &fr, 1);
 }
 
 int ast_bridge_queue_everyone_else(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel, struct ast_frame *frame)
 {
 	struct ast_bridge_channel *cur;
+	struct ast_frame *shared = NULL;
 	int not_written = -1;
 
 	if (frame->frametype == AST_FRAME_NULL) {
@@ -1090,14 +1151,20 @@ int ast_bridge_queue_everyone_else(struct ast_bridge *bridge, struct ast_bridge_
 		return 0;
 	}
 
+	/* Let every channel queue the same payload rather than a copy of it. */
+	if (bridge->num_channels > 2) {
+		shared = ast_frdup_shared(frame);
+	}
+
 	AST_LIST_TRAVERSE(&bridge->channels, cur, entry) {
 		if (cur == bridge_channel) {
 			continue;
 		}
-		if (!ast_bridge_channel_queue_frame(cur, frame)) {
+		if (!ast_bridge_channel_queue_frame(cur, shared ?: frame)) {
 			not_written = 0;
 		}
 	}
+	ast_frfree(shared);
 	return not_written;
 }
 
@@ -2355,60 +2422,17 @@ static void sendtext_safe(struct ast_channel *chan, const struct ast_frame *f)
 
 /*!
  * \internal
- * \brief Handle bridge channel write frame to channel.
- * \since 12.0.0
+ * \brief Handle a frame taken from the bridge channel write queue.
  *
  * \param bridge_channel Channel to write outgoing frame.
+ * \param fr Frame to handle.  It is freed.
  */
-static void bridge_channel_handle_write(struct ast_bridge_channel *bridge_channel)
+static void bridge_channel_handle_write_frame(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr)
 {
-	struct ast_frame *fr;
 	struct sync_payload *sync_payload;
 	int num;
 	struct ast_msg_data *msg;
 
-	ast_bridge_channel_lock(bridge_channel);
-
-	/* It's not good to have unbalanced frames and alert_pipe alerts. */
-	ast_assert(!AST_LIST_EMPTY(&bridge_channel->wr_queue));
-	if (AST_LIST_EMPTY(&bridge_channel->wr_queue)) {
-		/* No frame, flush the alert pipe of excess alerts. */
-		ast_log(LOG_WARNING, "Weird.  No frame from bridge for %s to process?\n",
-			ast_channel_name(bridge_channel->chan));
-		ast_alertpipe_read(bridge_channel->alert_pipe);
-		ast_bridge_channel_unlock(bridge_channel);
-		return;
-	}
-
-	AST_LIST_TRAVERSE_SAFE_BEGIN(&bridge_channel->wr_queue, fr, frame_list) {
-		if (bridge_channel->dtmf_hook_state.collected[0]) {
-			switch (fr->frametype) {
-			case AST_FRAME_BRIDGE_ACTION:
-			case AST_FRAME_BRIDGE_ACTION_SYNC:
-				/* Defer processing these frames while DTMF is collected. */
-				continue;
-			default:
-				break;
-			}
-		}
-		ast_alertpipe_read(bridge_channel->alert_pipe);
-		AST_LIST_REMOVE_CURRENT(frame_list);
-		break;
-	}
-	AST_LIST_TRAVERSE_SAFE_END;
-
-	ast_bridge_channel_unlock(bridge_channel);
-
-	if (!fr) {
-		/*
-		 * Wait some to reduce CPU usage from a tight loop
-		 * without any wait because we only have deferred
-		 * frames in the wr_queue.
-		 */
-		usleep(1);
-		return;
-	}
-
 	switch (fr->frametype) {
 	case AST_FRAME_BRIDGE_ACTION:
 		bridge_channel_handle_action(bridge_channel, fr->subclass.integer, fr->data.ptr);
@@ -2463,6 +2487,95 @@ static void bridge_channel_handle_write(struct ast_bridge_channel *bridge_channe
 	bridge_frame_free(fr);
 }
 
+/*!
+ * \internal
+ * \brief Handle bridge channel write frame to channel.
+ * \since 12.0.0
+ *
+ * \details Everything queued when the thread was woken is handled,
+ * other than bridge actions deferred while DTMF is collected.
+ *
+ * \param bridge_channel Channel to write outgoing frame.
+ */
+static void bridge_channel_handle_write(struct ast_bridge_channel *bridge_channel)
+{
+	AST_LIST_HEAD_NOLOCK(, ast_frame) frames = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
+	struct ast_frame *fr;
+
+	ast_bridge_channel_lock(bridge_channel);
+
+	/* It's not good to have unbalanced frames and alert_pipe alerts. */
+	ast_assert(!AST_LIST_EMPTY(&bridge_channel->wr_queue));
+	if (AST_LIST_EMPTY(&bridge_channel->wr_queue)) {
+		/* No frame, flush the alert pipe of excess alerts. */
+		ast_log(LOG_WARNING, "Weird.  No frame from bridge for %s to process?\n",
+			ast_channel_name(bridge_channel->chan));
+		ast_alertpipe_read(bridge_channel->alert_pipe);
+		bridge_channel->wr_alerted = 0;
+		ast_bridge_channel_unlock(bridge_channel);
+		return;
+	}
+
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&bridge_channel->wr_queue, fr, frame_list) {
+		if (bridge_channel->dtmf_hook_state.collected[0]) {
+			switch (fr->frametype) {
+			case AST_FRAME_BRIDGE_ACTION:
+			case AST_FRAME_BRIDGE_ACTION_SYNC:
+				/* Defer processing these frames while DTMF is collected. */
+				continue;
+			default:
+				break;
+			}
+		}
+		AST_LIST_REMOVE_CURRENT(frame_list);
+		AST_LIST_INSERT_TAIL(&frames, fr, frame_list);
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+
+	/*
+	 * Deferred frames keep the alert pipe signaled so they are looked
+	 * at again, otherwise the next frame queued must signal it.
+	 */
+	if (AST_LIST_EMPTY(&bridge_channel->wr_queue)) {
+		ast_alertpipe_read(bridge_channel->alert_pipe);
+		bridge_channel->wr_alerted = 0;
+	}
+
+	ast_bridge_channel_unlock(bridge_channel);
+
+	if (AST_LIST_EMPTY(&frames)) {
+		/*
+		 * Wait some to reduce CPU usage from a tight loop
+		 * without any wait because we only have deferred
+		 * frames in the wr_queue.
+		 */
+		usleep(1);
+		return;
+	}
+
+	while ((fr = AST_LIST_REMOVE_HEAD(&frames, frame_list))) {
+		bridge_channel_handle_write_frame(bridge_channel, fr);
+
+		if (AST_LIST_EMPTY(&frames)
+			|| (!bridge_channel->suspended
+				&& bridge_channel->state == BRIDGE_CHANNEL_STATE_WAIT
+				&& !bridge_channel->dtmf_hook_state.collected[0])) {
+			continue;
+		}
+
+		/*
+		 * What was just handled means the rest must wait, put them
+		 * back in front of anything queued since.
+		 */
+		ast_bridge_channel_lock(bridge_channel);
+		AST_LIST_APPEND_LIST(&frames, &bridge_channel->wr_queue, frame_list);
+		AST_LIST_APPEND_LIST(&bridge_channel->wr_queue, &frames, frame_list);
+		bridge_channel_wr_queue_alert(bridge_channel);
+		ast_bridge_channel_unlock(bridge_channel);
+		break;
+	}
+}
+
 /*!
  * \internal
  * \brief Handle DTMF from a channel
@@ -219,6 +219,17 @@
 					submission of CDR data during asterisk shutdown, set this to <literal>yes</literal>.</para>
 					</description>
 				</configOption>
+				<configOption name="backendqueuesize">
+					<synopsis>The maximum number of CDRs waiting to be posted to a backend</synopsis>
+					<description><para>Every backend is given the CDRs by a thread of its own, from a queue
+					of its own, so a slow backend does not hold up the others or the calls.  When this many
+					CDRs wait in the queue of a backend, further CDRs are dropped for that backend.  The
+					CLI <astcli>cdr show status</astcli> command shows how many CDRs each backend has
+					waiting and has dropped.</para>
+					<para>Set to <literal>0</literal> to post the CDRs to the backends one after
+					the other in the thread ending the CDR.</para>
+					</description>
+				</configOption>
 			</configObject>
 		</configFile>
 	</configInfo>
@@ -240,6 +251,10 @@
 #define MAX_BATCH_TIME 86400
 #define DEFAULT_BATCH_SCHEDULER_ONLY "0"
 #define DEFAULT_BATCH_SAFE_SHUTDOWN "1"
+#define DEFAULT_BACKEND_QUEUE_SIZE "10000"
+#define MAX_BACKEND_QUEUE_SIZE 1000000
+/*! Most CDRs given to a batch backend callback at once */
+#define BACKEND_BATCH_MAX 100
 
 #define cdr_set_debug_mode(mod_cfg) \
 	do { \
@@ -359,13 +374,36 @@ static void *module_config_alloc(void)
 	return mod_cfg;
 }
 
+/*! \brief A CDR shared by the queues of the backends posting it */
+struct cdr_post {
+	struct ast_cdr *cdr;
+};
+
+AST_VECTOR(cdr_posts, struct cdr_post *);
+
 /*! \brief Registration object for CDR backends */
 struct cdr_beitem {
 	char name[20];
 	char desc[80];
 	ast_cdrbe be;
+	ast_cdrbe_batch be_batch;
 	AST_RWLIST_ENTRY(cdr_beitem) list;
 	int suspended:1;
+	/*! TRUE while a task posting the queue is pending or running */
+	unsigned int posting:1;
+	/*! Posts the queued CDRs to a backend, NULL for modifiers */
+	struct ast_taskprocessor *serializer;
+	ast_mutex_t queue_lock;
+	/*! Signalled when the queue is empty and no longer posted */
+	ast_cond_t queue_drained;
+	/*! CDRs waiting for the backend */
+	struct cdr_posts queue;
+	/*! Most CDRs ever waiting for the backend */
+	size_t queue_peak;
+	/*! CDRs posted to the backend */
+	unsigned long posted;
+	/*! CDRs dropped because the queue was full */
+	unsigned long dropped;
 };
 
 /*! \brief List of registered backends */
@@ -427,6 +465,32 @@ static struct stasis_topic *cdr_topic;
 /*! \brief A message type used to synchronize with the CDR topic */
 STASIS_MESSAGE_TYPE_DEFN_LOCAL(cdr_sync_message_type);
 
+/*! \brief The number of serializers the messages of unrelated calls are spread over */
+#define CDR_SHARDS 8
+
+/*! \brief Serializers each processing the messages of their channels in order */
+static struct ast_taskprocessor *cdr_shards[CDR_SHARDS];
+
+/*!
+ * \brief The shard processing the messages of each channel
+ *
+ * Only used by the message router, so it needs no lock.
+ */
+static struct ao2_container *cdr_channel_shards;
+
+/*! \brief A channel and the shard processing its messages */
+struct cdr_channel_shard {
+	/*! The shard picked when the channel was created */
+	unsigned int shard;
+	/*! Whether the messages of the channel are processed with every shard stopped */
+	unsigned int global:1;
+	/*! The uniqueid of the channel */
+	char uniqueid[0];
+};
+
+AO2_STRING_FIELD_HASH_FN(cdr_channel_shard, uniqueid);
+AO2_STRING_FIELD_CMP_FN(cdr_channel_shard, uniqueid);
+
 struct cdr_object;
 
 /*! \brief Return types for \p process_bridge_enter functions */
@@ -2336,6 +2400,11 @@ static void handle_channel_snapshot_update_message(void *data, struct stasis_sub
 		return;
 	}
 
+	/* CDRs do not record connected line or channel variables from snapshots */
+	if (!(update->changed & ~(AST_CHANNEL_SNAPSHOT_CHANGED_CONNECTED | AST_CHANNEL_SNAPSHOT_CHANGED_VARS))) {
+		return;
+	}
+
 	if (update->new_snapshot && !update->old_snapshot) {
 		struct module_config *mod_cfg = NULL;
 
@@ -2885,6 +2954,306 @@ static void handle_cdr_sync_message(void *data, struct stasis_subscription *sub,
 	return;
 }
 
+/*!
+ * \internal
+ * \brief Process a message with the handler of its type
+ */
+static void cdr_message_handle(struct stasis_message *message)
+{
+	struct stasis_message_type *type = stasis_message_type(message);
+
+	if (type == ast_channel_snapshot_type()) {
+		handle_channel_snapshot_update_message(NULL, NULL, message);
+	} else if (type == ast_channel_dial_type()) {
+		handle_dial_message(NULL, NULL, message);
+	} else if (type == ast_channel_entered_bridge_type()) {
+		handle_bridge_enter_message(NULL, NULL, message);
+	} else if (type == ast_channel_left_bridge_type()) {
+		handle_bridge_leave_message(NULL, NULL, message);
+	} else if (type == ast_parked_call_type()) {
+		handle_parked_call_message(NULL, NULL, message);
+	} else if (type == cdr_sync_message_type()) {
+		handle_cdr_sync_message(NULL, NULL, message);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Shard task processing a message
+ */
+static int cdr_message_handle_task(void *data)
+{
+	struct stasis_message *message = data;
+
+	cdr_message_handle(message);
+	ao2_ref(message, -1);
+
+	return 0;
+}
+
+/*! \brief A point in the queues of the shards the router waits for them to reach */
+struct cdr_shard_barrier {
+	ast_mutex_t lock;
+	ast_cond_t cond;
+	/*! The number of shards that have not reached the barrier yet */
+	int pending;
+};
+
+/*!
+ * \internal
+ * \brief Shard task signalling it reached a barrier
+ */
+static int cdr_shard_barrier_task(void *data)
+{
+	struct cdr_shard_barrier *barrier = data;
+
+	ast_mutex_lock(&barrier->lock);
+	if (!--barrier->pending) {
+		ast_cond_signal(&barrier->cond);
+	}
+	ast_mutex_unlock(&barrier->lock);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Wait for shards to process the messages pushed to them
+ *
+ * \param shard The shard to wait for, or -1 to wait for every shard
+ */
+static void cdr_shards_drain(int shard)
+{
+	struct cdr_shard_barrier barrier = { .pending = 0, };
+	int i;
+
+	ast_mutex_init(&barrier.lock);
+	ast_cond_init(&barrier.cond, NULL);
+
+	ast_mutex_lock(&barrier.lock);
+	for (i = 0; i < CDR_SHARDS; ++i) {
+		if (!cdr_shards[i] || (shard >= 0 && i != shard)) {
+			continue;
+		}
+		if (!ast_taskprocessor_push(cdr_shards[i], cdr_shard_barrier_task, &barrier)) {
+			++barrier.pending;
+		}
+	}
+	while (barrier.pending) {
+		ast_cond_wait(&barrier.cond, &barrier.lock);
+	}
+	ast_mutex_unlock(&barrier.lock);
+
+	ast_mutex_destroy(&barrier.lock);
+	ast_cond_destroy(&barrier.cond);
+}
+
+/*!
+ * \internal
+ * \brief Remember the shard of a new channel
+ *
+ * The shard is picked by the linkedid the channel is created with, which
+ * puts a channel and the channels it dials in the same shard.
+ */
+static void cdr_channel_shard_add(struct ast_channel_snapshot *snapshot)
+{
+	struct cdr_channel_shard *entry;
+	size_t len = strlen(snapshot->base->uniqueid) + 1;
+
+	entry = ao2_alloc_options(sizeof(*entry) + len, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	entry->shard = (unsigned int) ast_str_hash(snapshot->peer->linkedid) % CDR_SHARDS;
+	memcpy(entry->uniqueid, snapshot->base->uniqueid, len);
+	ao2_link(cdr_channel_shards, entry);
+	ao2_ref(entry, -1);
+}
+
+/*!
+ * \internal
+ * \brief Find the shard processing the messages of a channel
+ *
+ * \retval -1 if the messages of the channel are processed with every shard stopped
+ * \return the shard otherwise
+ */
+static int cdr_channel_shard_get(const char *uniqueid)
+{
+	struct cdr_channel_shard *entry;
+	int shard;
+
+	entry = ao2_find(cdr_channel_shards, uniqueid, OBJ_SEARCH_KEY);
+	if (!entry) {
+		return (unsigned int) ast_str_hash(uniqueid) % CDR_SHARDS;
+	}
+	shard = entry->global ? -1 : entry->shard;
+	ao2_ref(entry, -1);
+
+	return shard;
+}
+
+/*!
+ * \internal
+ * \brief Process the messages of a channel with every shard stopped from now on
+ */
+static void cdr_channel_shard_set_global(const char *uniqueid)
+{
+	struct cdr_channel_shard *entry;
+
+	entry = ao2_find(cdr_channel_shards, uniqueid, OBJ_SEARCH_KEY);
+	if (entry) {
+		entry->global = 1;
+		ao2_ref(entry, -1);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Add a channel to the shard of a message
+ *
+ * \param shard The shard of the channels added so far, CDR_SHARDS if none
+ * \param uniqueid The channel, or NULL
+ *
+ * \retval -1 if the channels are not all processed by one shard
+ * \return the shard of the channels otherwise
+ */
+static int cdr_message_shard_add(int shard, const char *uniqueid)
+{
+	int channel_shard;
+
+	if (!uniqueid || shard < 0) {
+		return shard;
+	}
+	channel_shard = cdr_channel_shard_get(uniqueid);
+	if (shard == CDR_SHARDS || shard == channel_shard) {
+		return channel_shard;
+	}
+
+	return -1;
+}
+
+/*!
+ * \internal
+ * \brief Find the shard of a message about a channel and the channels of a bridge
+ *
+ * The CDRs of channels in a bridge refer to each other, so channels from
+ * different shards entering a bridge are processed with every shard stopped
+ * from then on.
+ */
+static int cdr_bridge_message_shard(struct ast_channel_snapshot *channel, struct ast_bridge_snapshot *bridge)
+{
+	struct ao2_iterator it;
+	char *uniqueid;
+	int shard;
+
+	shard = cdr_message_shard_add(CDR_SHARDS, channel->base->uniqueid);
+	it = ao2_iterator_init(bridge->channels, 0);
+	while ((uniqueid = ao2_iterator_next(&it))) {
+		shard = cdr_message_shard_add(shard, uniqueid);
+		ao2_ref(uniqueid, -1);
+	}
+	ao2_iterator_destroy(&it);
+
+	if (shard < 0) {
+		cdr_channel_shard_set_global(channel->base->uniqueid);
+		it = ao2_iterator_init(bridge->channels, 0);
+		while ((uniqueid = ao2_iterator_next(&it))) {
+			cdr_channel_shard_set_global(uniqueid);
+			ao2_ref(uniqueid, -1);
+		}
+		ao2_iterator_destroy(&it);
+	}
+
+	return shard;
+}
+
+/*!
+ * \internal
+ * \brief Find the shard of a dial message
+ */
+static int cdr_dial_message_shard(struct ast_multi_channel_blob *payload)
+{
+	struct ast_channel_snapshot *caller = ast_multi_channel_blob_get_channel(payload, "caller");
+	struct ast_channel_snapshot *peer = ast_multi_channel_blob_get_channel(payload, "peer");
+	int shard;
+
+	shard = cdr_message_shard_add(CDR_SHARDS, caller ? caller->base->uniqueid : NULL);
+	shard = cdr_message_shard_add(shard, peer ? peer->base->uniqueid : NULL);
+	if (shard < 0) {
+		if (caller) {
+			cdr_channel_shard_set_global(caller->base->uniqueid);
+		}
+		if (peer) {
+			cdr_channel_shard_set_global(peer->base->uniqueid);
+		}
+	}
+
+	return shard;
+}
+
+/*!
+ * \internal
+ * \brief Route a message to the shard of the channels it is about
+ *
+ * Messages about channels of one shard are processed by that shard, in
+ * order with the other messages of the shard, and in parallel with the
+ * other shards.  Anything else is processed by the router once every shard
+ * has processed the messages it was given before.
+ */
+static void cdr_message_dispatch(void *data, struct stasis_subscription *sub,
+		struct stasis_message *message)
+{
+	struct stasis_message_type *type = stasis_message_type(message);
+	int shard = -1;
+
+	if (type == ast_channel_snapshot_type()) {
+		struct ast_channel_snapshot_update *update = stasis_message_data(message);
+
+		if (!update->old_snapshot) {
+			cdr_channel_shard_add(update->new_snapshot);
+		}
+		shard = cdr_channel_shard_get(update->new_snapshot->base->uniqueid);
+		if (ast_test_flag(&update->new_snapshot->flags, AST_FLAG_DEAD)) {
+			ao2_find(cdr_channel_shards, update->new_snapshot->base->uniqueid,
+				OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+		}
+	} else if (type == ast_channel_dial_type()) {
+		shard = cdr_dial_message_shard(stasis_message_data(message));
+	} else if (type == ast_channel_entered_bridge_type()) {
+		struct ast_bridge_blob *update = stasis_message_data(message);
+
+		shard = cdr_bridge_message_shard(update->channel, update->bridge);
+	} else if (type == ast_channel_left_bridge_type()) {
+		struct ast_bridge_blob *update = stasis_message_data(message);
+
+		shard = cdr_channel_shard_get(update->channel->base->uniqueid);
+	} else if (type == ast_parked_call_type()) {
+		struct ast_parked_call_payload *payload = stasis_message_data(message);
+
+		if (payload->parkee) {
+			shard = cdr_channel_shard_get(payload->parkee->base->uniqueid);
+		}
+	}
+
+	if (shard >= 0 && shard < CDR_SHARDS && cdr_shards[shard]) {
+		if (!ast_taskprocessor_push(cdr_shards[shard], cdr_message_handle_task, ao2_bump(message))) {
+			return;
+		}
+		ao2_ref(message, -1);
+	}
+
+	cdr_shards_drain(shard < CDR_SHARDS ? shard : -1);
+	cdr_message_handle(message);
+}
+
+void ast_cdr_message_router_sync(const char *uniqueid)
+{
+	if (!cdr_channel_shards) {
+		return;
+	}
+	cdr_shards_drain(uniqueid ? cdr_channel_shard_get(uniqueid) : -1);
+}
+
 struct ast_cdr_config *ast_cdr_get_config(void)
 {
 	struct ast_cdr_config *general;
@@ -2961,7 +3330,17 @@ int ast_cdr_backend_unsuspend(const char *name)
 	return success;
 }
 
-static int cdr_generic_register(struct be_list *generic_list, const char *name, const char *desc, ast_cdrbe be)
+static void cdr_beitem_free(struct cdr_beitem *i)
+{
+	ast_taskprocessor_unreference(i->serializer);
+	AST_VECTOR_FREE(&i->queue);
+	ast_cond_destroy(&i->queue_drained);
+	ast_mutex_destroy(&i->queue_lock);
+	ast_free(i);
+}
+
+static int cdr_generic_register(struct be_list *generic_list, const char *name, const char *desc,
+	ast_cdrbe be, ast_cdrbe_batch be_batch)
 {
 	struct cdr_beitem *i;
 	struct cdr_beitem *cur;
@@ -2982,15 +3361,30 @@ static int cdr_generic_register(struct be_list *generic_list, const char *name,
 	}
 
 	i->be = be;
+	i->be_batch = be_batch;
 	ast_copy_string(i->name, name, sizeof(i->name));
 	ast_copy_string(i->desc, desc, sizeof(i->desc));
+	ast_mutex_init(&i->queue_lock);
+	ast_cond_init(&i->queue_drained, NULL);
+	AST_VECTOR_INIT(&i->queue, 0);
+
+	if (generic_list == &be_list) {
+		char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+
+		ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "cdr/%s", name);
+		i->serializer = ast_taskprocessor_get(tps_name, TPS_REF_DEFAULT);
+		if (!i->serializer) {
+			cdr_beitem_free(i);
+			return -1;
+		}
+	}
 
 	AST_RWLIST_WRLOCK(generic_list);
 	AST_RWLIST_TRAVERSE(generic_list, cur, list) {
 		if (!strcasecmp(name, cur->name)) {
 			ast_log(LOG_WARNING, "Already have a CDR backend called '%s'\n", name);
 			AST_RWLIST_UNLOCK(generic_list);
-			ast_free(i);
+			cdr_beitem_free(i);
 
 			return -1;
 		}
@@ -3004,12 +3398,17 @@ static int cdr_generic_register(struct be_list *generic_list, const char *name,
 
 int ast_cdr_register(const char *name, const char *desc, ast_cdrbe be)
 {
-	return cdr_generic_register(&be_list, name, desc, be);
+	return cdr_generic_register(&be_list, name, desc, be, NULL);
+}
+
+int ast_cdr_register_batch(const char *name, const char *desc, ast_cdrbe be, ast_cdrbe_batch be_batch)
+{
+	return cdr_generic_register(&be_list, name, desc, be, be_batch);
 }
 
 int ast_cdr_modifier_register(const char *name, const char *desc, ast_cdrbe be)
 {
-	return cdr_generic_register((struct be_list *)&mo_list, name, desc, be);
+	return cdr_generic_register((struct be_list *)&mo_list, name, desc, be, NULL);
 }
 
 static int ast_cdr_generic_unregister(struct be_list *generic_list, const char *name)
@@ -3041,8 +3440,15 @@ static int ast_cdr_generic_unregister(struct be_list *generic_list, const char *
 	AST_RWLIST_REMOVE(generic_list, match, list);
 	AST_RWLIST_UNLOCK(generic_list);
 
+	/* Let the backend have what is still waiting for it */
+	ast_mutex_lock(&match->queue_lock);
+	while (match->posting) {
+		ast_cond_wait(&match->queue_drained, &match->queue_lock);
+	}
+	ast_mutex_unlock(&match->queue_lock);
+
 	ast_verb(5, "Unregistered '%s' CDR backend\n", name);
-	ast_free(match);
+	cdr_beitem_free(match);
 
 	return 0;
 }
@@ -3567,22 +3973,132 @@ void ast_cdr_setuserfield(const char *channel_name, const char *userfield)
 	ao2_cleanup(cdr);
 }
 
+static void cdr_post_destroy(void *obj)
+{
+	struct cdr_post *post = obj;
+
+	ast_cdr_free(post->cdr);
+}
+
+/*! \brief Task posting the CDRs queued for a backend */
+static int cdr_backend_post(void *data)
+{
+	struct cdr_beitem *i = data;
+	struct ast_cdr *cdrs[BACKEND_BATCH_MAX];
+	struct cdr_posts posts;
+	size_t count;
+	size_t j;
+	size_t k;
+
+	for (;;) {
+		ast_mutex_lock(&i->queue_lock);
+		if (!AST_VECTOR_SIZE(&i->queue)) {
+			i->posting = 0;
+			ast_cond_broadcast(&i->queue_drained);
+			ast_mutex_unlock(&i->queue_lock);
+			return 0;
+		}
+		/* Take the whole queue, so posting does not hold up queueing */
+		posts = i->queue;
+		AST_VECTOR_INIT(&i->queue, 0);
+		i->posted += AST_VECTOR_SIZE(&posts);
+		ast_mutex_unlock(&i->queue_lock);
+
+		for (j = 0; j < AST_VECTOR_SIZE(&posts); j += count) {
+			count = MIN(AST_VECTOR_SIZE(&posts) - j, ARRAY_LEN(cdrs));
+			if (i->be_batch && count > 1) {
+				for (k = 0; k < count; k++) {
+					cdrs[k] = AST_VECTOR_GET(&posts, j + k)->cdr;
+				}
+				i->be_batch(cdrs, count);
+			} else {
+				for (k = 0; k < count; k++) {
+					i->be(AST_VECTOR_GET(&posts, j + k)->cdr);
+				}
+			}
+		}
+
+		AST_VECTOR_CALLBACK_VOID(&posts, ao2_ref, -1);
+		AST_VECTOR_FREE(&posts);
+	}
+}
+
+/*! \brief Queue a CDR for a backend.  Called with the be_list read lock held. */
+static void cdr_backend_queue(struct cdr_beitem *i, struct cdr_post *post, unsigned int queue_size)
+{
+	int start;
+
+	ast_mutex_lock(&i->queue_lock);
+	if (AST_VECTOR_SIZE(&i->queue) >= queue_size
+		|| AST_VECTOR_APPEND(&i->queue, post)) {
+		/* Only tell once in a while, as a backend stuck drops every CDR */
+		if (i->dropped++ % 1000 == 0) {
+			ast_log(LOG_WARNING, "CDR backend %s is not keeping up; %lu CDRs dropped so far\n",
+				i->name, i->dropped);
+		}
+		ast_mutex_unlock(&i->queue_lock);
+		return;
+	}
+	ao2_ref(post, +1);
+	if (AST_VECTOR_SIZE(&i->queue) > i->queue_peak) {
+		i->queue_peak = AST_VECTOR_SIZE(&i->queue);
+	}
+	start = !i->posting;
+	i->posting = 1;
+	ast_mutex_unlock(&i->queue_lock);
+
+	if (start && ast_taskprocessor_push(i->serializer, cdr_backend_post, i)) {
+		/* Better late than never */
+		cdr_backend_post(i);
+	}
+}
+
+/*! \brief Wait for the backends to be done with the CDRs queued for them */
+static void cdr_backends_drain(void)
+{
+	struct cdr_beitem *i;
+
+	AST_RWLIST_RDLOCK(&be_list);
+	AST_RWLIST_TRAVERSE(&be_list, i, list) {
+		ast_mutex_lock(&i->queue_lock);
+		while (i->posting) {
+			ast_cond_wait(&i->queue_drained, &i->queue_lock);
+		}
+		ast_mutex_unlock(&i->queue_lock);
+	}
+	AST_RWLIST_UNLOCK(&be_list);
+}
+
+/*!
+ * \brief Post a chain of CDRs to the backends
+ *
+ * \note The CDRs are consumed, and freed once every backend is done with them.
+ */
 static void post_cdr(struct ast_cdr *cdr)
 {
 	struct module_config *mod_cfg;
 	struct cdr_beitem *i;
+	struct ast_cdr *next;
 
 	mod_cfg = ao2_global_obj_ref(module_configs);
 	if (!mod_cfg) {
+		ast_cdr_free(cdr);
 		return;
 	}
 
-	for (; cdr ; cdr = cdr->next) {
+	for (; cdr ; cdr = next) {
+		struct cdr_post *post;
+
+		/* Every record of the chain is posted on its own */
+		next = cdr->next;
+		cdr->next = NULL;
+
 		/* For people, who don't want to see unanswered single-channel events */
 		if (!ast_test_flag(&mod_cfg->general->settings, CDR_UNANSWERED) &&
 				cdr->disposition < AST_CDR_ANSWERED &&
 				(ast_strlen_zero(cdr->channel) || ast_strlen_zero(cdr->dstchannel))) {
 			ast_debug(1, "Skipping CDR for %s since we weren't answered\n", cdr->channel);
+			ast_cdr_free(cdr);
 			continue;
 		}
 
@@ -3594,15 +4110,31 @@ static void post_cdr(struct ast_cdr *cdr)
 		AST_RWLIST_UNLOCK(&mo_list);
 
 		if (ast_test_flag(cdr, AST_CDR_FLAG_DISABLE)) {
+			ast_cdr_free(cdr);
 			continue;
 		}
+
+		post = ao2_alloc_options(sizeof(*post), cdr_post_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!post) {
+			ast_cdr_free(cdr);
+			continue;
+		}
+		post->cdr = cdr;
+
 		AST_RWLIST_RDLOCK(&be_list);
 		AST_RWLIST_TRAVERSE(&be_list, i, list) {
-			if (!i->suspended) {
+			if (i->suspended) {
+				continue;
+			}
+			if (!mod_cfg->general->backend_queue_size) {
 				i->be(cdr);
+			} else {
+				cdr_backend_queue(i, post, mod_cfg->general->backend_queue_size);
 			}
 		}
 		AST_RWLIST_UNLOCK(&be_list);
+
+		ao2_ref(post, -1);
 	}
 	ao2_cleanup(mod_cfg);
 }
@@ -3816,7 +4348,6 @@ static void *do_batch_backend_process(void *data)
 	/* Push each CDR into storage mechanism(s) and free all the memory */
 	while (batchitem) {
 		post_cdr(batchitem->cdr);
-		ast_cdr_free(batchitem->cdr);
 		processeditem = batchitem;
 		batchitem = batchitem->next;
 		ast_free(processeditem);
@@ -3921,7 +4452,6 @@ static void cdr_detach(struct ast_cdr *cdr)
 	/* post stuff immediately if we are not in batch mode, this is legacy behaviour */
 	if (!ast_test_flag(&mod_cfg->general->settings, CDR_BATCHMODE)) {
 		post_cdr(cdr);
-		ast_cdr_free(cdr);
 		return;
 	}
 
@@ -3931,7 +4461,6 @@ static void cdr_detach(struct ast_cdr *cdr)
 	/* we'll need a new tail for every CDR */
 	if (!(newtail = ast_calloc(1, sizeof(*newtail)))) {
 		post_cdr(cdr);
-		ast_cdr_free(cdr);
 		return;
 	}
 
@@ -4263,7 +4792,21 @@ static char *handle_cli_status(struct ast_cli_entry *e, int cmd, struct ast_cli_
 			ast_cli(a->fd, "    (none)\n");
 		} else {
 			AST_RWLIST_TRAVERSE(&be_list, beitem, list) {
+				size_t queued;
+				size_t peak;
+				unsigned long posted;
+				unsigned long dropped;
+
+				ast_mutex_lock(&beitem->queue_lock);
+				queued = AST_VECTOR_SIZE(&beitem->queue);
+				peak = beitem->queue_peak;
+				posted = beitem->posted;
+				dropped = beitem->dropped;
+				ast_mutex_unlock(&beitem->queue_lock);
+
 				ast_cli(a->fd, "    %s%s\n", beitem->name, beitem->suspended ? " (suspended) " : "");
+				ast_cli(a->fd, "      Queued: %zu (peak %zu), posted: %lu, dropped: %lu\n",
+					queued, peak, posted, dropped);
 			}
 		}
 		AST_RWLIST_UNLOCK(&be_list);
@@ -4419,6 +4962,7 @@ static int process_config(int reload)
 		aco_option_register(&cfg_info, "scheduleronly", ACO_EXACT, general_options, DEFAULT_BATCH_SCHEDULER_ONLY, OPT_BOOLFLAG_T, 1, FLDSET(struct ast_cdr_config, batch_settings.settings), BATCH_MODE_SCHEDULER_ONLY);
 		aco_option_register(&cfg_info, "safeshutdown", ACO_EXACT, general_options, DEFAULT_BATCH_SAFE_SHUTDOWN, OPT_BOOLFLAG_T, 1, FLDSET(struct ast_cdr_config, batch_settings.settings), BATCH_MODE_SAFE_SHUTDOWN);
 		aco_option_register(&cfg_info, "size", ACO_EXACT, general_options, DEFAULT_BATCH_SIZE, OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct ast_cdr_config, batch_settings.size), 0, MAX_BATCH_SIZE);
+		aco_option_register(&cfg_info, "backendqueuesize", ACO_EXACT, general_options, DEFAULT_BACKEND_QUEUE_SIZE, OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct ast_cdr_config, backend_queue_size), 0, MAX_BACKEND_QUEUE_SIZE);
 		aco_option_register(&cfg_info, "time", ACO_EXACT, general_options, DEFAULT_BATCH_TIME, OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct ast_cdr_config, batch_settings.time), 1, MAX_BATCH_TIME);
 		aco_option_register(&cfg_info, "channeldefaultenabled", ACO_EXACT, general_options, DEFAULT_CHANNEL_ENABLED, OPT_BOOLFLAG_T, 1, FLDSET(struct ast_cdr_config, settings), CDR_CHANNEL_DEFAULT_ENABLED);
 		aco_option_register(&cfg_info, "ignorestatechanges", ACO_EXACT, general_options, DEFAULT_IGNORE_STATE_CHANGES, OPT_BOOLFLAG_T, 1, FLDSET(struct ast_cdr_config, settings), CDR_IGNORE_STATE_CHANGES);
@@ -4450,10 +4994,56 @@ static int process_config(int reload)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Create the serializers the CDR messages are processed by
+ */
+static int cdr_shards_create(void)
+{
+	char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+	int i;
+
+	cdr_channel_shards = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0,
+		AST_NUM_CHANNEL_BUCKETS, cdr_channel_shard_hash_fn, NULL, cdr_channel_shard_cmp_fn);
+	if (!cdr_channel_shards) {
+		return -1;
+	}
+
+	for (i = 0; i < CDR_SHARDS; ++i) {
+		ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "cdr/shard%d", i);
+		cdr_shards[i] = ast_taskprocessor_get(tps_name, TPS_REF_DEFAULT);
+		if (!cdr_shards[i]) {
+			return -1;
+		}
+		ast_taskprocessor_alert_set_levels(cdr_shards[i], -1,
+			10 * AST_TASKPROCESSOR_HIGH_WATER_LEVEL);
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Wait for the serializers to process their messages and destroy them
+ */
+static void cdr_shards_destroy(void)
+{
+	int i;
+
+	cdr_shards_drain(-1);
+	for (i = 0; i < CDR_SHARDS; ++i) {
+		cdr_shards[i] = ast_taskprocessor_unreference(cdr_shards[i]);
+	}
+
+	ao2_cleanup(cdr_channel_shards);
+	cdr_channel_shards = NULL;
+}
+
 static void cdr_engine_shutdown(void)
 {
 	stasis_message_router_unsubscribe_and_join(stasis_router);
 	stasis_router = NULL;
+	cdr_shards_destroy();
 
 	ao2_cleanup(cdr_topic);
 	cdr_topic = NULL;
@@ -4606,12 +5196,16 @@ static int load_module(void)
 		return AST_MODULE_LOAD_FAILURE;
 	}
 
+	if (cdr_shards_create()) {
+		return AST_MODULE_LOAD_FAILURE;
+	}
+
 	mod_cfg = ao2_global_obj_ref(module_configs);
 
-	stasis_message_router_add(stasis_router, ast_channel_snapshot_type(), handle_channel_snapshot_update_message, NULL);
+	stasis_message_router_add(stasis_router, ast_channel_snapshot_type(), cdr_message_dispatch, NULL);
 
 	/* Always process dial messages, because even if we ignore most of it, we do want the dial status for the disposition. */
-	stasis_message_router_add(stasis_router, ast_channel_dial_type(), handle_dial_message, NULL);
+	stasis_message_router_add(stasis_router, ast_channel_dial_type(), cdr_message_dispatch, NULL);
 	if (!mod_cfg || !ast_test_flag(&mod_cfg->general->settings, CDR_IGNORE_DIAL_CHANGES)) {
 		dial_changes_ignored = 0;
 	} else {
@@ -4621,14 +5215,14 @@ static int load_module(void)
 
 	/* If explicitly instructed to ignore call state changes, then ignore bridging events, parking, etc. */
 	if (!mod_cfg || !ast_test_flag(&mod_cfg->general->settings, CDR_IGNORE_STATE_CHANGES)) {
-		stasis_message_router_add(stasis_router, ast_channel_entered_bridge_type(), handle_bridge_enter_message, NULL);
-		stasis_message_router_add(stasis_router, ast_channel_left_bridge_type(), handle_bridge_leave_message, NULL);
-		stasis_message_router_add(stasis_router, ast_parked_call_type(), handle_parked_call_message, NULL);
+		stasis_message_router_add(stasis_router, ast_channel_entered_bridge_type(), cdr_message_dispatch, NULL);
+		stasis_message_router_add(stasis_router, ast_channel_left_bridge_type(), cdr_message_dispatch, NULL);
+		stasis_message_router_add(stasis_router, ast_parked_call_type(), cdr_message_dispatch, NULL);
 	} else {
 		CDR_DEBUG("All bridge and parking messages will be ignored\n");
 	}
 
-	stasis_message_router_add(stasis_router, cdr_sync_message_type(), handle_cdr_sync_message, NULL);
+	stasis_message_router_add(stasis_router, cdr_sync_message_type(), cdr_message_dispatch, NULL);
 
 	if (mod_cfg) {
 		ao2_cleanup(mod_cfg);
@@ -4700,6 +5294,8 @@ void ast_cdr_engine_term(void)
 	if (ast_test_flag(&mod_cfg->general->settings, CDR_BATCHMODE)) {
 		cdr_submit_batch(ast_test_flag(&mod_cfg->general->batch_settings.settings, BATCH_MODE_SAFE_SHUTDOWN));
 	}
+
+	cdr_backends_drain();
 }
 
 static int reload_module(void)
@@ -58,6 +58,8 @@
 #include "asterisk/pickup.h"
 #include "asterisk/core_local.h"
 #include "asterisk/taskprocessor.h"
+#include "asterisk/sched.h"
+#include "asterisk/vector.h"
 
 /*** DOCUMENTATION
 	<configInfo name="cel" language="en_US">
@@ -70,6 +72,21 @@
 				<configOption name="dateformat">
 					<synopsis>The format to be used for dates when logging</synopsis>
 				</configOption>
+				<configOption name="batchsize">
+					<synopsis>The number of events to queue for a backend before posting them</synopsis>
+					<description><para>Events are queued for each backend and posted to it
+					from a thread of its own, so a slow backend does not hold up the
+					processing of channel events.  Backends storing several events at once
+					are given up to this many events together.  The events are posted once
+					this many are queued, or after <replaceable>batchtime</replaceable>.
+					A value of <literal>0</literal> posts every event to the backends
+					synchronously as it happens.</para>
+					<para>A backend falling behind by more than 100 batches loses the events
+					that do not fit its queue.</para></description>
+				</configOption>
+				<configOption name="batchtime">
+					<synopsis>The longest time events are queued for a backend, in milliseconds</synopsis>
+				</configOption>
 				<configOption name="apps">
 					<synopsis>List of apps for CEL to track</synopsis>
 					<description><para>A case-insensitive, comma-separated list of applications
@@ -141,6 +158,24 @@ static AO2_GLOBAL_OBJ_STATIC(cel_backends);
 /*! The number of buckets into which backend names will be hashed */
 #define BACKEND_BUCKETS 13
 
+/*! The most events queued for a backend, in batches */
+#define BACKEND_QUEUE_BATCHES 100
+
+/*! The default batchsize */
+#define DEFAULT_BATCH_SIZE "100"
+
+/*! The largest batchsize */
+#define MAX_BATCH_SIZE 10000
+
+/*! The default batchtime */
+#define DEFAULT_BATCH_TIME "250"
+
+/*! The largest batchtime */
+#define MAX_BATCH_TIME 60000
+
+/*! Scheduler posting the events queued for backends in time */
+static struct ast_sched_context *cel_sched;
+
 /*! Container for dial end multichannel blobs for holding on to dial statuses */
 static AO2_GLOBAL_OBJ_STATIC(cel_dialstatus_store);
 
@@ -325,8 +360,24 @@ static const char * const cel_event_types[CEL_MAX_EVENT_IDS] = {
 	[AST_CEL_LOCAL_OPTIMIZE_BEGIN]   = "LOCAL_OPTIMIZE_BEGIN",
 };
 
+/*! \brief An event shared by the backends it is queued for */
+struct cel_post {
+	struct ast_event *event;
+};
+
+AST_VECTOR(cel_posts, struct cel_post *);
+
 struct cel_backend {
 	ast_cel_backend_cb callback; /*!< Callback for this backend */
+	ast_cel_backend_batch_cb batch_callback; /*!< Callback for several events, if any */
+	struct ast_taskprocessor *serializer; /*!< Posts the queued events to the backend */
+	ast_mutex_t queue_lock;
+	ast_cond_t queue_drained;    /*!< Signalled when the queue is empty and no longer posted */
+	struct cel_posts queue;      /*!< Events waiting for the backend */
+	unsigned int posting:1;      /*!< TRUE while a task posting the queue is pending or running */
+	unsigned int unregistered:1; /*!< TRUE once the backend takes no more events */
+	unsigned long posted;        /*!< Events posted to the backend */
+	unsigned long dropped;       /*!< Events dropped because the queue was full */
 	char name[0];                /*!< Name of this backend */
 };
 
@@ -408,6 +459,10 @@ static char *handle_cli_status(struct ast_cli_entry *e, int cmd, struct ast_cli_
 		iter = ao2_iterator_init(backends, 0);
 		for (; (backend = ao2_iterator_next(&iter)); ao2_ref(backend, -1)) {
 			ast_cli(a->fd, "CEL Event Subscriber: %s\n", backend->name);
+			ast_mutex_lock(&backend->queue_lock);
+			ast_cli(a->fd, "  Queued: %zu  Posted: %lu  Dropped: %lu\n",
+				AST_VECTOR_SIZE(&backend->queue), backend->posted, backend->dropped);
+			ast_mutex_unlock(&backend->queue_lock);
 		}
 		ao2_iterator_destroy(&iter);
 	}
@@ -560,11 +615,170 @@ struct ast_event *ast_cel_create_event_with_time(struct ast_channel_snapshot *sn
 		AST_EVENT_IE_END);
 }
 
-static int cel_backend_send_cb(void *obj, void *arg, int flags)
+static void cel_post_destroy(void *obj)
+{
+	struct cel_post *post = obj;
+
+	ast_event_destroy(post->event);
+}
+
+/*! \brief Post an event to a backend as it happens */
+static void cel_backend_send(struct cel_backend *backend, struct ast_event *event)
+{
+	if (backend->callback) {
+		backend->callback(event);
+	} else {
+		backend->batch_callback(&event, 1);
+	}
+}
+
+/*! \brief Task posting the events queued for a backend */
+static int cel_backend_post(void *data)
+{
+	struct cel_backend *backend = data;
+	struct cel_config *cfg = ao2_global_obj_ref(cel_configs);
+	size_t batch_size = cfg && cfg->general && cfg->general->batch_size ? cfg->general->batch_size : 1;
+	struct ast_event **events = NULL;
+	struct cel_posts posts;
+	size_t count;
+	size_t i;
+	size_t j;
+
+	ao2_cleanup(cfg);
+
+	if (backend->batch_callback && batch_size > 1) {
+		events = ast_malloc(batch_size * sizeof(*events));
+	}
+
+	for (;;) {
+		ast_mutex_lock(&backend->queue_lock);
+		if (!AST_VECTOR_SIZE(&backend->queue)) {
+			backend->posting = 0;
+			ast_cond_broadcast(&backend->queue_drained);
+			ast_mutex_unlock(&backend->queue_lock);
+			break;
+		}
+		/* Take the whole queue, so posting does not hold up queueing */
+		posts = backend->queue;
+		AST_VECTOR_INIT(&backend->queue, 0);
+		backend->posted += AST_VECTOR_SIZE(&posts);
+		ast_mutex_unlock(&backend->queue_lock);
+
+		for (i = 0; i < AST_VECTOR_SIZE(&posts); i += count) {
+			count = MIN(AST_VECTOR_SIZE(&posts) - i, batch_size);
+			if (events && count > 1) {
+				for (j = 0; j < count; j++) {
+					events[j] = AST_VECTOR_GET(&posts, i + j)->event;
+				}
+				backend->batch_callback(events, count);
+			} else {
+				for (j = 0; j < count; j++) {
+					cel_backend_send(backend, AST_VECTOR_GET(&posts, i + j)->event);
+				}
+			}
+		}
+
+		AST_VECTOR_CALLBACK_VOID(&posts, ao2_ref, -1);
+		AST_VECTOR_FREE(&posts);
+	}
+
+	ast_free(events);
+	ao2_ref(backend, -1);
+
+	return 0;
+}
+
+/*! \brief Start posting the queue of a backend.  Called with posting set. */
+static void cel_backend_post_start(struct cel_backend *backend)
+{
+	ao2_ref(backend, +1);
+	if (ast_taskprocessor_push(backend->serializer, cel_backend_post, backend)) {
+		/* Better late than never */
+		cel_backend_post(backend);
+	}
+}
+
+/*! \brief Queue an event for a backend, posting the queue once a batch is full */
+static void cel_backend_queue(struct cel_backend *backend, struct cel_post *post, unsigned int batch_size)
+{
+	int start;
+
+	ast_mutex_lock(&backend->queue_lock);
+	if (backend->unregistered) {
+		ast_mutex_unlock(&backend->queue_lock);
+		return;
+	}
+	if (AST_VECTOR_SIZE(&backend->queue) >= (size_t) batch_size * BACKEND_QUEUE_BATCHES
+		|| AST_VECTOR_APPEND(&backend->queue, post)) {
+		/* Only tell once in a while, as a backend stuck drops every event */
+		if (backend->dropped++ % 1000 == 0) {
+			ast_log(LOG_WARNING, "CEL backend %s is not keeping up; %lu events dropped so far\n",
+				backend->name, backend->dropped);
+		}
+		ast_mutex_unlock(&backend->queue_lock);
+		return;
+	}
+	ao2_ref(post, +1);
+	start = !backend->posting && AST_VECTOR_SIZE(&backend->queue) >= batch_size;
+	if (start) {
+		backend->posting = 1;
+	}
+	ast_mutex_unlock(&backend->queue_lock);
+
+	if (start) {
+		cel_backend_post_start(backend);
+	}
+}
+
+/*! \brief Start posting the queue of a backend, however short */
+static int cel_backend_flush_cb(void *obj, void *arg, int flags)
 {
 	struct cel_backend *backend = obj;
+	int start;
+
+	ast_mutex_lock(&backend->queue_lock);
+	start = !backend->posting && AST_VECTOR_SIZE(&backend->queue);
+	if (start) {
+		backend->posting = 1;
+	}
+	ast_mutex_unlock(&backend->queue_lock);
+
+	if (start) {
+		cel_backend_post_start(backend);
+	}
+
+	return 0;
+}
+
+/*! \brief Post the events queued for the backends for too long */
+static int cel_flush_sched_cb(const void *data)
+{
+	struct ao2_container *backends = ao2_global_obj_ref(cel_backends);
+	struct cel_config *cfg = ao2_global_obj_ref(cel_configs);
+	int batch_time = cfg && cfg->general && cfg->general->batch_time ? cfg->general->batch_time : 1000;
+
+	ao2_cleanup(cfg);
+	if (backends) {
+		ao2_callback(backends, OBJ_MULTIPLE | OBJ_NODATA, cel_backend_flush_cb, NULL);
+		ao2_ref(backends, -1);
+	}
+
+	return batch_time;
+}
+
+/*! \brief Wait for a backend to be done with the events queued for it */
+static int cel_backend_drain_cb(void *obj, void *arg, int flags)
+{
+	struct cel_backend *backend = obj;
+
+	cel_backend_flush_cb(backend, NULL, 0);
+
+	ast_mutex_lock(&backend->queue_lock);
+	while (backend->posting) {
+		ast_cond_wait(&backend->queue_drained, &backend->queue_lock);
+	}
+	ast_mutex_unlock(&backend->queue_lock);
 
-	backend->callback(arg);
 	return 0;
 }
 
@@ -574,6 +788,9 @@ static int cel_report_event(struct ast_channel_snapshot *snapshot,
 		const char *peer_str)
 {
 	struct ast_event *ev;
+	struct cel_post *post;
+	struct cel_backend *backend;
+	struct ao2_iterator iter;
 	RAII_VAR(struct cel_config *, cfg, ao2_global_obj_ref(cel_configs), ao2_cleanup);
 	RAII_VAR(struct ao2_container *, backends, ao2_global_obj_ref(cel_backends), ao2_cleanup);
 
@@ -605,8 +822,28 @@ static int cel_report_event(struct ast_channel_snapshot *snapshot,
 	}
 
 	/* Distribute event to backends */
-	ao2_callback(backends, OBJ_MULTIPLE | OBJ_NODATA, cel_backend_send_cb, ev);
-	ast_event_destroy(ev);
+	iter = ao2_iterator_init(backends, 0);
+	if (!cfg->general->batch_size) {
+		for (; (backend = ao2_iterator_next(&iter)); ao2_ref(backend, -1)) {
+			cel_backend_send(backend, ev);
+		}
+		ao2_iterator_destroy(&iter);
+		ast_event_destroy(ev);
+		return 0;
+	}
+
+	post = ao2_alloc_options(sizeof(*post), cel_post_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!post) {
+		ao2_iterator_destroy(&iter);
+		ast_event_destroy(ev);
+		return -1;
+	}
+	post->event = ev;
+	for (; (backend = ao2_iterator_next(&iter)); ao2_ref(backend, -1)) {
+		cel_backend_queue(backend, post, cfg->general->batch_size);
+	}
+	ao2_iterator_destroy(&iter);
+	ao2_ref(post, -1);
 
 	return 0;
 }
@@ -979,10 +1216,14 @@ static void cel_channel_app_change(
  * changes to ensure that hangup notifications occur after application changes.
  * Linkedid checking should always come last.
  */
-cel_channel_snapshot_monitor cel_channel_monitors[] = {
-	cel_channel_app_change,
-	cel_channel_state_change,
-	cel_channel_linkedid_change,
+static const struct {
+	cel_channel_snapshot_monitor monitor;
+	/*! \ref ast_channel_snapshot_update_change bits the monitor inspects */
+	unsigned int changes;
+} cel_channel_monitors[] = {
+	{ cel_channel_app_change, AST_CHANNEL_SNAPSHOT_CHANGED_DIALPLAN },
+	{ cel_channel_state_change, AST_CHANNEL_SNAPSHOT_CHANGED_STATE },
+	{ cel_channel_linkedid_change, AST_CHANNEL_SNAPSHOT_CHANGED_PEER },
 };
 
 static int cel_filter_channel_snapshot(struct ast_channel_snapshot *snapshot)
@@ -1004,7 +1245,10 @@ static void cel_snapshot_update_cb(void *data, struct stasis_subscription *sub,
 	}
 
 	for (i = 0; i < ARRAY_LEN(cel_channel_monitors); ++i) {
-		cel_channel_monitors[i](update->old_snapshot, update->new_snapshot, stasis_message_timestamp(message));
+		if (!(update->changed & cel_channel_monitors[i].changes)) {
+			continue;
+		}
+		cel_channel_monitors[i].monitor(update->old_snapshot, update->new_snapshot, stasis_message_timestamp(message));
 	}
 }
 
@@ -1455,10 +1699,20 @@ static void destroy_subscriptions(void)
 
 static int unload_module(void)
 {
+	struct ao2_container *backends;
+
 	destroy_routes();
 	destroy_subscriptions();
 	STASIS_MESSAGE_TYPE_CLEANUP(cel_generic_type);
 
+	ast_sched_context_destroy(cel_sched);
+	cel_sched = NULL;
+	backends = ao2_global_obj_ref(cel_backends);
+	if (backends) {
+		ao2_callback(backends, OBJ_MULTIPLE | OBJ_NODATA, cel_backend_drain_cb, NULL);
+		ao2_ref(backends, -1);
+	}
+
 	ast_cli_unregister(&cli_status);
 	aco_info_destroy(&cel_cfg_info);
 	ao2_global_obj_release(cel_configs);
@@ -1636,6 +1890,8 @@ static int load_module(void)
 
 	aco_option_register(&cel_cfg_info, "enable", ACO_EXACT, general_options, "no", OPT_BOOL_T, 1, FLDSET(struct ast_cel_general_config, enable));
 	aco_option_register(&cel_cfg_info, "dateformat", ACO_EXACT, general_options, "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct ast_cel_general_config, date_format));
+	aco_option_register(&cel_cfg_info, "batchsize", ACO_EXACT, general_options, DEFAULT_BATCH_SIZE, OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct ast_cel_general_config, batch_size), 0, MAX_BATCH_SIZE);
+	aco_option_register(&cel_cfg_info, "batchtime", ACO_EXACT, general_options, DEFAULT_BATCH_TIME, OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct ast_cel_general_config, batch_time), 1, MAX_BATCH_TIME);
 	aco_option_register_custom(&cel_cfg_info, "apps", ACO_EXACT, general_options, "", apps_handler, 0);
 	aco_option_register_custom(&cel_cfg_info, "events", ACO_EXACT, general_options, "", events_handler, 0);
 
@@ -1654,6 +1910,12 @@ static int load_module(void)
 		ao2_ref(cel_cfg, -1);
 	}
 
+	cel_sched = ast_sched_context_create();
+	if (!cel_sched || ast_sched_start_thread(cel_sched)
+		|| ast_sched_add_variable(cel_sched, 1000, cel_flush_sched_cb, NULL, 1) < 0) {
+		return AST_MODULE_LOAD_FAILURE;
+	}
+
 	if (create_subscriptions()) {
 		return AST_MODULE_LOAD_FAILURE;
 	}
@@ -1769,38 +2031,80 @@ void ast_cel_set_config(struct ast_cel_general_config *config)
 int ast_cel_backend_unregister(const char *name)
 {
 	struct ao2_container *backends = ao2_global_obj_ref(cel_backends);
+	struct cel_backend *backend;
 
 	if (backends) {
-		ao2_find(backends, name, OBJ_SEARCH_KEY | OBJ_NODATA | OBJ_UNLINK);
+		backend = ao2_find(backends, name, OBJ_SEARCH_KEY | OBJ_UNLINK);
+		if (backend) {
+			/* Hand the backend what was queued for it before it goes away */
+			ast_mutex_lock(&backend->queue_lock);
+			backend->unregistered = 1;
+			ast_mutex_unlock(&backend->queue_lock);
+			cel_backend_drain_cb(backend, NULL, 0);
+			ao2_ref(backend, -1);
+		}
 		ao2_ref(backends, -1);
 	}
 
 	return 0;
 }
 
-int ast_cel_backend_register(const char *name, ast_cel_backend_cb backend_callback)
+static void cel_backend_destroy(void *obj)
+{
+	struct cel_backend *backend = obj;
+
+	ast_taskprocessor_unreference(backend->serializer);
+	AST_VECTOR_CALLBACK_VOID(&backend->queue, ao2_ref, -1);
+	AST_VECTOR_FREE(&backend->queue);
+	ast_mutex_destroy(&backend->queue_lock);
+	ast_cond_destroy(&backend->queue_drained);
+}
+
+int ast_cel_backend_register_batch(const char *name, ast_cel_backend_cb backend_callback,
+	ast_cel_backend_batch_cb batch_callback)
 {
 	RAII_VAR(struct ao2_container *, backends, ao2_global_obj_ref(cel_backends), ao2_cleanup);
 	struct cel_backend *backend;
+	char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
 
-	if (!backends || ast_strlen_zero(name) || !backend_callback) {
+	if (!backends || ast_strlen_zero(name) || (!backend_callback && !batch_callback)) {
 		return -1;
 	}
 
-	/* The backend object is immutable so it doesn't need a lock of its own. */
-	backend = ao2_alloc_options(sizeof(*backend) + 1 + strlen(name), NULL,
+	/* The queue has a lock of its own; the rest of the backend object is immutable. */
+	backend = ao2_alloc_options(sizeof(*backend) + 1 + strlen(name), cel_backend_destroy,
 		AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!backend) {
 		return -1;
 	}
 	strcpy(backend->name, name);/* Safe */
 	backend->callback = backend_callback;
+	backend->batch_callback = batch_callback;
+	ast_mutex_init(&backend->queue_lock);
+	ast_cond_init(&backend->queue_drained, NULL);
+	AST_VECTOR_INIT(&backend->queue, 0);
+
+	ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "cel/%s", name);
+	backend->serializer = ast_taskprocessor_get(tps_name, TPS_REF_DEFAULT);
+	if (!backend->serializer) {
+		ao2_ref(backend, -1);
+		return -1;
+	}
 
 	ao2_link(backends, backend);
 	ao2_ref(backend, -1);
 	return 0;
 }
 
+int ast_cel_backend_register(const char *name, ast_cel_backend_cb backend_callback)
+{
+	if (!backend_callback) {
+		return -1;
+	}
+
+	return ast_cel_backend_register_batch(name, backend_callback, NULL);
+}
+
 AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_GLOBAL_SYMBOLS | AST_MODFLAG_LOAD_ORDER, "CEL Engine",
 	.support_level = AST_MODULE_SUPPORT_CORE,
 	.load = load_module,
@@ -120,9 +120,17 @@ struct chanlist {
 /*! \brief the list of registered channel types */
 static AST_RWLIST_HEAD_STATIC(backends, chanlist);
 
-/*! \brief All active channels on the system */
+/*! \brief All active channels on the system, ordered by name */
 static struct ao2_container *channels;
 
+/*!
+ * \brief All active channels on the system, ordered by uniqueid
+ *
+ * \note Channels are linked into and unlinked from this container with
+ * the channels container locked so the two always agree.
+ */
+static struct ao2_container *channels_by_uniqueid;
+
 /*! \brief map AST_CAUSE's to readable string representations
  *
  * \ref causes.h
@@ -717,7 +725,8 @@ static int does_id_conflict(const char *uniqueid)
 		return 0;
 	}
 
-	conflict = ast_channel_callback(ast_channel_by_uniqueid_cb, (char *) uniqueid, &length, OBJ_NOLOCK);
+	conflict = ao2_callback_data(channels_by_uniqueid, OBJ_SEARCH_KEY, ast_channel_by_uniqueid_cb,
+		(char *) uniqueid, &length);
 	if (conflict) {
 		ast_log(LOG_ERROR, "Channel Unique ID '%s' already in use by channel %s(%p)\n",
 			uniqueid, ast_channel_name(conflict), conflict);
@@ -740,7 +749,6 @@ __ast_channel_alloc_ap(int needqueue, int state, const char *cid_num, const char
 	struct varshead *headp;
 	char *tech = "", *tech2 = NULL;
 	struct ast_format_cap *nativeformats;
-	struct ast_sched_context *schedctx;
 	struct ast_timer *timer;
 	struct timeval now;
 	const struct ast_channel_tech *channel_tech;
@@ -788,13 +796,6 @@ __ast_channel_alloc_ap(int needqueue, int state, const char *cid_num, const char
 	ast_channel_set_writeformat(tmp, ast_format_none);
 	ast_channel_set_readformat(tmp, ast_format_none);
 
-	if (!(schedctx = ast_sched_context_create())) {
-		ast_log(LOG_WARNING, "Channel allocation failed: Unable to create schedule context\n");
-		/* See earlier channel creation abort comment above. */
-		return ast_channel_unref(tmp);
-	}
-	ast_channel_sched_set(tmp, schedctx);
-
 	ast_party_dialed_init(ast_channel_dialed(tmp));
 	ast_party_caller_init(ast_channel_caller(tmp));
 	ast_party_connected_line_init(ast_channel_connected(tmp));
@@ -933,6 +934,7 @@ __ast_channel_alloc_ap(int needqueue, int state, const char *cid_num, const char
 	ast_channel_internal_finalize(tmp);
 	ast_atomic_fetchadd_int(&chancount, +1);
 	ao2_link_flags(channels, tmp, OBJ_NOLOCK);
+	ao2_link(channels_by_uniqueid, tmp);
 
 	ao2_unlock(channels);
 
@@ -1006,6 +1008,20 @@ struct ast_channel *__ast_dummy_channel_alloc(const char *file, int line, const
 	return tmp;
 }
 
+/*!
+ * \internal
+ * \brief Account for frames added to or, when negative, removed from the read queue
+ *
+ * \pre chan is locked
+ */
+static void readq_count_update(struct ast_channel *chan, int frames, int voice_frames)
+{
+	int total = (int) ast_channel_internal_readq_frames(chan) + frames;
+	int voice = (int) ast_channel_internal_readq_voice_frames(chan) + voice_frames;
+
+	ast_channel_internal_readq_frames_set(chan, MAX(total, 0), MAX(voice, 0));
+}
+
 static int __ast_queue_frame(struct ast_channel *chan, struct ast_frame *fin, int head, struct ast_frame *after)
 {
 	struct ast_frame *f;
@@ -1034,6 +1050,7 @@ static int __ast_queue_frame(struct ast_channel *chan, struct ast_frame *fin, in
 				 */
 				AST_LIST_REMOVE(ast_channel_readq(chan), cur, frame_list);
 				ast_frfree(cur);
+				readq_count_update(chan, -1, 0);
 
 				/*
 				 * This has degenerated to a normal queue append anyway.  Since
@@ -1071,13 +1088,15 @@ static int __ast_queue_frame(struct ast_channel *chan, struct ast_frame *fin, in
 		}
 	}
 
-	/* Count how many frames exist on the queue */
-	AST_LIST_TRAVERSE(ast_channel_readq(chan), cur, frame_list) {
-		queued_frames++;
-		if (cur->frametype == AST_FRAME_VOICE) {
-			queued_voice_frames++;
-		}
+	/*
+	 * The counts are kept as frames are queued and read.  Anything that
+	 * empties the queue behind our back is caught up with here.
+	 */
+	if (AST_LIST_EMPTY(ast_channel_readq(chan))) {
+		ast_channel_internal_readq_frames_set(chan, 0, 0);
 	}
+	queued_frames = ast_channel_internal_readq_frames(chan);
+	queued_voice_frames = ast_channel_internal_readq_voice_frames(chan);
 
 	if ((queued_frames + new_frames > 128 || queued_voice_frames + new_voice_frames > 96)) {
 		int total_queued = queued_frames + new_frames;
@@ -1094,6 +1113,7 @@ static int __ast_queue_frame(struct ast_channel *chan, struct ast_frame *fin, in
 					break;
 				}
 				AST_LIST_REMOVE_CURRENT(frame_list);
+				readq_count_update(chan, -1, cur->frametype == AST_FRAME_VOICE ? -1 : 0);
 				ast_frfree(cur);
 
 				/* Read from the alert pipe for each flushed frame. */
@@ -1115,15 +1135,13 @@ static int __ast_queue_frame(struct ast_channel *chan, struct ast_frame *fin, in
 		}
 		AST_LIST_APPEND_LIST(ast_channel_readq(chan), &frames, frame_list);
 	}
+	readq_count_update(chan, new_frames, new_voice_frames);
 
 	if (ast_channel_alert_writable(chan)) {
-		/* Write to the alert pipe for each added frame */
-		while (new_frames--) {
-			if (ast_channel_alert_write(chan)) {
-				ast_log(LOG_WARNING, "Unable to write to alert pipe on %s (qlen = %u): %s!\n",
-					ast_channel_name(chan), queued_frames, strerror(errno));
-				break;
-			}
+		/* Write to the alert pipe for each added frame, all in one go */
+		if (ast_channel_internal_alert_write_count(chan, new_frames)) {
+			ast_log(LOG_WARNING, "Unable to write to alert pipe on %s (qlen = %u): %s!\n",
+				ast_channel_name(chan), queued_frames, strerror(errno));
 		}
 	} else if (ast_channel_timingfd(chan) > -1) {
 		ast_timer_enable_continuous(ast_channel_timer(chan));
@@ -1394,9 +1412,15 @@ struct ast_channel_iterator *ast_channel_iterator_by_name_new(const char *name,
 		return NULL;
 	}
 
+	if (name_len) {
+		/* The channels are ordered by name so only those starting with the prefix are visited */
+		l_name = ast_alloca(name_len + 1);
+		ast_copy_string(l_name, name, name_len + 1);
+	}
+
 	i->active_iterator = (void *) ast_channel_callback(ast_channel_by_name_cb,
 		l_name, &name_len,
-		OBJ_MULTIPLE | (name_len == 0 /* match the whole word, so optimize */ ? OBJ_KEY : 0));
+		OBJ_MULTIPLE | (name_len == 0 ? OBJ_SEARCH_KEY : OBJ_SEARCH_PARTIAL_KEY));
 	if (!i->active_iterator) {
 		ast_free(i);
 		return NULL;
@@ -1424,31 +1448,33 @@ struct ast_channel *ast_channel_iterator_next(struct ast_channel_iterator *i)
 	return ao2_iterator_next(i->active_iterator);
 }
 
-/* Legacy function, not currently used for lookups, but we need a cmp_fn */
-static int ast_channel_cmp_cb(void *obj, void *arg, int flags)
-{
-	ast_log(LOG_ERROR, "BUG! Should never be called!\n");
-	return CMP_STOP;
-}
-
 struct ast_channel *ast_channel_get_by_name_prefix(const char *name, size_t name_len)
 {
 	struct ast_channel *chan;
 	char *l_name = (char *) name;
+	int search;
 
 	if (ast_strlen_zero(l_name)) {
 		/* We didn't have a name to search for so quit. */
 		return NULL;
 	}
 
-	chan = ast_channel_callback(ast_channel_by_name_cb, l_name, &name_len,
-		(name_len == 0) /* optimize if it is a complete name match */ ? OBJ_KEY : 0);
+	/* Both containers are ordered so a prefix only visits the channels starting with it */
+	if (name_len) {
+		l_name = ast_alloca(name_len + 1);
+		ast_copy_string(l_name, name, name_len + 1);
+		search = OBJ_SEARCH_PARTIAL_KEY;
+	} else {
+		search = OBJ_SEARCH_KEY;
+	}
+
+	chan = ast_channel_callback(ast_channel_by_name_cb, l_name, &name_len, search);
 	if (chan) {
 		return chan;
 	}
 
 	/* Now try a search for uniqueid. */
-	return ast_channel_callback(ast_channel_by_uniqueid_cb, l_name, &name_len, 0);
+	return ao2_callback_data(channels_by_uniqueid, search, ast_channel_by_uniqueid_cb, l_name, &name_len);
 }
 
 struct ast_channel *ast_channel_get_by_name(const char *name)
@@ -1581,10 +1607,43 @@ int ast_safe_sleep_without_silence(struct ast_channel *chan, int ms)
 	return safe_sleep_conditional(chan, ms, NULL, NULL, 0);
 }
 
+/*!
+ * \internal
+ * \brief Remove a channel from the channels container and its indexes
+ *
+ * \note Safe, even if already unlinked.
+ */
+static void channel_unlink(struct ast_channel *chan)
+{
+	ao2_lock(channels);
+	ao2_unlink(channels, chan);
+	ao2_unlink(channels_by_uniqueid, chan);
+	ao2_unlock(channels);
+}
+
+struct ast_sched_context *ast_channel_sched_create(struct ast_channel *chan)
+{
+	struct ast_sched_context *sched;
+
+	ast_channel_lock(chan);
+	sched = ast_channel_sched(chan);
+	if (!sched) {
+		sched = ast_sched_context_create();
+		if (sched) {
+			ast_channel_sched_set(chan, sched);
+		} else {
+			ast_log(LOG_WARNING, "Unable to create schedule context for '%s'\n", ast_channel_name(chan));
+		}
+	}
+	ast_channel_unlock(chan);
+
+	return sched;
+}
+
 struct ast_channel *ast_channel_release(struct ast_channel *chan)
 {
 	/* Safe, even if already unlinked. */
-	ao2_unlink(channels, chan);
+	channel_unlink(chan);
 	return ast_channel_unref(chan);
 }
 
@@ -2287,6 +2346,7 @@ static void ast_channel_destructor(void *obj)
 	}
 	while ((f = AST_LIST_REMOVE_HEAD(ast_channel_readq(chan), frame_list)))
 		ast_frfree(f);
+	ast_channel_internal_readq_frames_set(chan, 0, 0);
 
 	/* loop over the variables list, freeing all data and deleting list items */
 	/* no need to lock the list, as the channel is already locked */
@@ -2448,6 +2508,7 @@ void ast_channel_clear_softhangup(struct ast_channel *chan, int flag)
 				fr->subclass.integer == AST_CONTROL_END_OF_Q) {
 			AST_LIST_REMOVE(ast_channel_readq(chan), fr, frame_list);
 			ast_frfree(fr);
+			readq_count_update(chan, -1, 0);
 		}
 	}
 
@@ -2571,7 +2632,7 @@ void ast_hangup(struct ast_channel *chan)
 	 * longer be needed.
 	 */
 	ast_pbx_hangup_handler_run(chan);
-	ao2_unlink(channels, chan);
+	channel_unlink(chan);
 	ast_channel_lock(chan);
 
 	destroy_hooks(chan);
@@ -2984,12 +3045,109 @@ int ast_waitfor_n_fd(int *fds, int n, int *ms, int *exception)
 	return winner;
 }
 
-/*! \brief Wait for x amount of time on a file descriptor to have input.  */
-struct ast_channel *ast_waitfor_nandfds(struct ast_channel **c, int n, int *fds, int nfds,
-					int *exception, int *outfd, int *ms)
+/*! \brief Which channel and channel fd an entry of the poll set is for */
+struct waitfor_fdmap {
+	/*! Index of the channel, -1 for the individual fds */
+	int chan;
+	int fdno;
+};
+
+/*!
+ * \brief Poll set reused by each call of ast_waitfor_nandfds() on a thread
+ *
+ * Media threads wait in a loop so the arrays are kept for the life of
+ * the thread rather than allocated on every call.
+ */
+struct waitfor_set {
+	struct pollfd *pfds;
+	struct waitfor_fdmap *fdmap;
+	int size;
+};
+
+static void waitfor_set_free(void *data)
+{
+	struct waitfor_set *set = data;
+
+	ast_free(set->pfds);
+	ast_free(set->fdmap);
+	ast_free(set);
+}
+
+AST_THREADSTORAGE_CUSTOM(waitfor_set_buf, NULL, waitfor_set_free);
+
+static int waitfor_set_grow(struct waitfor_set *set, int size)
+{
+	struct pollfd *pfds;
+	struct waitfor_fdmap *fdmap;
+
+	if (size <= set->size) {
+		return 0;
+	}
+	size = MAX(size, set->size * 2);
+
+	pfds = ast_realloc(set->pfds, sizeof(*pfds) * size);
+	if (!pfds) {
+		return -1;
+	}
+	set->pfds = pfds;
+	fdmap = ast_realloc(set->fdmap, sizeof(*fdmap) * size);
+	if (!fdmap) {
+		return -1;
+	}
+	set->fdmap = fdmap;
+	set->size = size;
+
+	return 0;
+}
+
+/*!
+ * \brief Add a channel with activity to the ready channels
+ *
+ * The fds of a channel are polled together, so the channel is only
+ * already there if it was the last added, or one of the first expired.
+ */
+static void waitfor_ready_add(int *ready, int *nready, int expired, int idx)
+{
+	int x;
+
+	if (*nready > expired && ready[*nready - 1] == idx) {
+		return;
+	}
+	for (x = 0; x < expired; x++) {
+		if (ready[x] == idx) {
+			return;
+		}
+	}
+	ready[(*nready)++] = idx;
+}
+
+/*! \brief Clear the blocking flag set on the channels waited on */
+static void waitfor_unblock(struct ast_channel **c, int n)
+{
+	int x;
+
+	for (x = 0; x < n; x++) {
+		ast_channel_lock(c[x]);
+		ast_clear_flag(ast_channel_flags(c[x]), AST_FLAG_BLOCKING);
+		ast_channel_unlock(c[x]);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Wait for activity on channels and fds
+ *
+ * \param ready If not NULL, filled with the index of every channel with
+ *        activity, each once.
+ * \param nready Set to how many channels were put in ready.
+ */
+static struct ast_channel *waitfor_nandfds(struct ast_channel **c, int n, int *fds, int nfds,
+	int *exception, int *outfd, int *ms, int *ready, int *nready)
 {
 	struct timeval start = { 0 , 0 };
-	struct pollfd *pfds = NULL;
+	struct waitfor_set *set;
+	struct pollfd *pfds;
+	struct waitfor_fdmap *fdmap;
 	int res;
 	long rms;
 	int x, y, max;
@@ -2997,10 +3155,7 @@ struct ast_channel *ast_waitfor_nandfds(struct ast_channel **c, int n, int *fds,
 	struct timeval now = { 0, 0 };
 	struct timeval whentohangup = { 0, 0 }, diff;
 	struct ast_channel *winner = NULL;
-	struct fdmap {
-		int chan;
-		int fdno;
-	} *fdmap = NULL;
+	int expired = 0;
 
 	if (outfd) {
 		*outfd = -99999;
@@ -3009,6 +3164,21 @@ struct ast_channel *ast_waitfor_nandfds(struct ast_channel **c, int n, int *fds,
 		*exception = 0;
 	}
 
+	set = ast_threadstorage_get(&waitfor_set_buf, sizeof(*set));
+	if (!set) {
+		*ms = -1;
+		return NULL;
+	}
+
+	/*
+	 * Build the pollfd array, putting the channels' fds first,
+	 * followed by individual fds. Order is important because
+	 * individual fd's must have priority over channel fds.
+	 *
+	 * Each channel is locked only once to both check when it is
+	 * to be hung up and add its fds.
+	 */
+	max = 0;
 	for (x = 0; x < n; x++) {
 		ast_channel_lock(c[x]);
 		if (!ast_tvzero(*ast_channel_whentohangup(c[x]))) {
@@ -3020,21 +3190,48 @@ struct ast_channel *ast_waitfor_nandfds(struct ast_channel **c, int n, int *fds,
 				/* Should already be hungup */
 				ast_channel_softhangup_internal_flag_add(c[x], AST_SOFTHANGUP_TIMEOUT);
 				ast_channel_unlock(c[x]);
+				waitfor_unblock(c, x);
+				if (ready) {
+					ready[(*nready)++] = x;
+				}
 				return c[x];
 			}
 			if (ast_tvzero(whentohangup) || ast_tvcmp(diff, whentohangup) < 0)
 				whentohangup = diff;
 		}
 		sz += ast_channel_fd_count(c[x]);
+		if (waitfor_set_grow(set, max + ast_channel_fd_count(c[x]))) {
+			ast_channel_unlock(c[x]);
+			waitfor_unblock(c, x);
+			*ms = -1;
+			return NULL;
+		}
+		for (y = 0; y < ast_channel_fd_count(c[x]); y++) {
+			set->fdmap[max].fdno = y;  /* fd y is linked to this pfds */
+			set->fdmap[max].chan = x;  /* channel x is linked to this pfds */
+			max += ast_add_fd(&set->pfds[max], ast_channel_fd(c[x], y));
+		}
+		CHECK_BLOCKING(c[x]);
 		ast_channel_unlock(c[x]);
 	}
 
 	if (!sz) {
+		waitfor_unblock(c, n);
 		return NULL;
 	}
 
-	pfds = ast_alloca(sizeof(*pfds) * sz);
-	fdmap = ast_alloca(sizeof(*fdmap) * sz);
+	/* Add the individual fds */
+	if (waitfor_set_grow(set, max + nfds)) {
+		waitfor_unblock(c, n);
+		*ms = -1;
+		return NULL;
+	}
+	for (x = 0; x < nfds; x++) {
+		set->fdmap[max].chan = -1;
+		max += ast_add_fd(&set->pfds[max], fds[x]);
+	}
+	pfds = set->pfds;
+	fdmap = set->fdmap;
 
 	/* Wait full interval */
 	rms = *ms;
@@ -3048,27 +3245,6 @@ struct ast_channel *ast_waitfor_nandfds(struct ast_channel **c, int n, int *fds,
 		/* Tiny corner case... call would need to last >24 days */
 		rms = INT_MAX;
 	}
-	/*
-	 * Build the pollfd array, putting the channels' fds first,
-	 * followed by individual fds. Order is important because
-	 * individual fd's must have priority over channel fds.
-	 */
-	max = 0;
-	for (x = 0; x < n; x++) {
-		ast_channel_lock(c[x]);
-		for (y = 0; y < ast_channel_fd_count(c[x]); y++) {
-			fdmap[max].fdno = y;  /* fd y is linked to this pfds */
-			fdmap[max].chan = x;  /* channel x is linked to this pfds */
-			max += ast_add_fd(&pfds[max], ast_channel_fd(c[x], y));
-		}
-		CHECK_BLOCKING(c[x]);
-		ast_channel_unlock(c[x]);
-	}
-	/* Add the individual fds */
-	for (x = 0; x < nfds; x++) {
-		fdmap[max].chan = -1;
-		max += ast_add_fd(&pfds[max], fds[x]);
-	}
 
 	if (*ms > 0) {
 		start = ast_tvnow();
@@ -3088,11 +3264,7 @@ struct ast_channel *ast_waitfor_nandfds(struct ast_channel **c, int n, int *fds,
 	} else {
 		res = ast_poll(pfds, max, rms);
 	}
-	for (x = 0; x < n; x++) {
-		ast_channel_lock(c[x]);
-		ast_clear_flag(ast_channel_flags(c[x]), AST_FLAG_BLOCKING);
-		ast_channel_unlock(c[x]);
-	}
+	waitfor_unblock(c, n);
 	if (res < 0) { /* Simulate a timeout if we were interrupted */
 		if (errno != EINTR) {
 			*ms = -1;
@@ -3108,6 +3280,10 @@ struct ast_channel *ast_waitfor_nandfds(struct ast_channel **c, int n, int *fds,
 				if (winner == NULL) {
 					winner = c[x];
 				}
+				if (ready) {
+					expired++;
+					ready[(*nready)++] = x;
+				}
 			}
 		}
 	}
@@ -3127,6 +3303,9 @@ struct ast_channel *ast_waitfor_nandfds(struct ast_channel **c, int n, int *fds,
 		}
 		if (fdmap[x].chan >= 0) {	/* this is a channel */
 			winner = c[fdmap[x].chan];	/* override previous winners */
+			if (ready) {
+				waitfor_ready_add(ready, nready, expired, fdmap[x].chan);
+			}
 			ast_channel_lock(winner);
 			if (res & POLLPRI) {
 				ast_set_flag(ast_channel_flags(winner), AST_FLAG_EXCEPTION);
@@ -3154,6 +3333,20 @@ struct ast_channel *ast_waitfor_nandfds(struct ast_channel **c, int n, int *fds,
 	return winner;
 }
 
+struct ast_channel *ast_waitfor_nandfds(struct ast_channel **c, int n, int *fds, int nfds,
+	int *exception, int *outfd, int *ms)
+{
+	return waitfor_nandfds(c, n, fds, nfds, exception, outfd, ms, NULL, NULL);
+}
+
+int ast_waitfor_n_ready(struct ast_channel **c, int n, int *ms, int *ready)
+{
+	int nready = 0;
+
+	waitfor_nandfds(c, n, NULL, 0, NULL, NULL, ms, ready, &nready);
+	return nready;
+}
+
 struct ast_channel *ast_waitfor_n(struct ast_channel **c, int n, int *ms)
 {
 	return ast_waitfor_nandfds(c, n, NULL, 0, NULL, NULL, ms);
@@ -3269,7 +3462,7 @@ int ast_waitfordigit_full(struct ast_channel *c, int timeout_ms, const char *bre
 			return -1;
 		} else if (outfd > -1) {
 			/* The FD we were watching has something waiting */
-			ast_log(LOG_WARNING, "The FD we were waiting for has something waiting. Waitfordigit returning numeric 1\n");
+			ast_debug(3, "The FD we were waiting for has something waiting. Waitfordigit returning numeric 1\n");
 			ast_channel_clear_flag(c, AST_FLAG_END_DTMF_ONLY);
 			return 1;
 		} else if (rchan) {
@@ -3678,6 +3871,7 @@ static struct ast_frame *__ast_read(struct ast_channel *chan, int dropaudio, int
 			}
 
 			AST_LIST_REMOVE_CURRENT(frame_list);
+			readq_count_update(chan, -1, f->frametype == AST_FRAME_VOICE ? -1 : 0);
 			break;
 		}
 		AST_LIST_TRAVERSE_SAFE_END;
@@ -6758,7 +6952,7 @@ static void __ast_change_name_nolink(struct ast_channel *chan, const char *newna
 
 void ast_change_name(struct ast_channel *chan, const char *newname)
 {
-	/* We must re-link, as the hash value will change here. */
+	/* We must re-link, as the sort order will change here. */
 	ao2_lock(channels);
 	ast_channel_lock(chan);
 	ao2_unlink(channels, chan);
@@ -6911,9 +7105,11 @@ static void channel_do_masquerade(struct ast_channel *original, struct ast_chann
 	ast_channel_ref(original);
 	ast_channel_ref(clonechan);
 
-	/* unlink from channels container as name (which is the hash value) will change */
+	/* unlink from channels containers as name and uniqueid (the sort keys) will change */
 	ao2_unlink(channels, original);
 	ao2_unlink(channels, clonechan);
+	ao2_unlink(channels_by_uniqueid, original);
+	ao2_unlink(channels_by_uniqueid, clonechan);
 
 	moh_is_playing = ast_test_flag(ast_channel_flags(original), AST_FLAG_MOH);
 	if (moh_is_playing) {
@@ -7010,6 +7206,10 @@ static void channel_do_masquerade(struct ast_channel *original, struct ast_chann
 		AST_LIST_HEAD_INIT_NOLOCK(&tmp_readq);
 		AST_LIST_APPEND_LIST(&tmp_readq, ast_channel_readq(original), frame_list);
 		AST_LIST_APPEND_LIST(ast_channel_readq(original), ast_channel_readq(clonechan), frame_list);
+		ast_channel_internal_readq_frames_set(original,
+			ast_channel_internal_readq_frames(original) + ast_channel_internal_readq_frames(clonechan),
+			ast_channel_internal_readq_voice_frames(original) + ast_channel_internal_readq_voice_frames(clonechan));
+		ast_channel_internal_readq_frames_set(clonechan, 0, 0);
 
 		while ((current = AST_LIST_REMOVE_HEAD(&tmp_readq, frame_list))) {
 			AST_LIST_INSERT_TAIL(ast_channel_readq(original), current, frame_list);
@@ -7321,6 +7521,8 @@ static void channel_do_masquerade(struct ast_channel *original, struct ast_chann
 
 	ao2_link(channels, clonechan);
 	ao2_link(channels, original);
+	ao2_link(channels_by_uniqueid, clonechan);
+	ao2_link(channels_by_uniqueid, original);
 	ao2_unlock(channels);
 
 	/* Release our held safety references. */
@@ -7785,17 +7987,48 @@ void ast_moh_cleanup(struct ast_channel *chan)
 		ast_moh_cleanup_ptr(chan);
 }
 
-static int ast_channel_hash_cb(const void *obj, const int flags)
+static int ast_channel_sort_cb(const void *obj_left, const void *obj_right, int flags)
 {
-	const char *name = (flags & OBJ_KEY) ? obj : ast_channel_name((struct ast_channel *) obj);
+	const struct ast_channel *left = obj_left;
+	const struct ast_channel *right = obj_right;
+	const char *right_key = obj_right;
+	int cmp;
 
-	/* If the name isn't set, return 0 so that the ao2_find() search will
-	 * start in the first bucket. */
-	if (ast_strlen_zero(name)) {
-		return 0;
+	switch (flags & OBJ_SEARCH_MASK) {
+	default:
+	case OBJ_SEARCH_OBJECT:
+		right_key = ast_channel_name(right);
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		cmp = strcasecmp(ast_channel_name(left), right_key);
+		break;
+	case OBJ_SEARCH_PARTIAL_KEY:
+		cmp = strncasecmp(ast_channel_name(left), right_key, strlen(right_key));
+		break;
 	}
+	return cmp;
+}
 
-	return ast_str_case_hash(name);
+static int ast_channel_uniqueid_sort_cb(const void *obj_left, const void *obj_right, int flags)
+{
+	const struct ast_channel *left = obj_left;
+	const struct ast_channel *right = obj_right;
+	const char *right_key = obj_right;
+	int cmp;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	default:
+	case OBJ_SEARCH_OBJECT:
+		right_key = ast_channel_uniqueid(right);
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		cmp = strcasecmp(ast_channel_uniqueid(left), right_key);
+		break;
+	case OBJ_SEARCH_PARTIAL_KEY:
+		cmp = strncasecmp(ast_channel_uniqueid(left), right_key, strlen(right_key));
+		break;
+	}
+	return cmp;
 }
 
 /*!
@@ -8001,18 +8234,30 @@ static void channels_shutdown(void)
 		ao2_ref(channels, -1);
 		channels = NULL;
 	}
+	if (channels_by_uniqueid) {
+		ao2_container_unregister("channels_by_uniqueid");
+		ao2_ref(channels_by_uniqueid, -1);
+		channels_by_uniqueid = NULL;
+	}
 	ast_channel_unregister(&surrogate_tech);
 }
 
 int ast_channels_init(void)
 {
-	channels = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, AST_NUM_CHANNEL_BUCKETS,
-		ast_channel_hash_cb, NULL, ast_channel_cmp_cb);
+	channels = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_MUTEX,
+		AO2_CONTAINER_ALLOC_OPT_DUPS_ALLOW, ast_channel_sort_cb, NULL);
 	if (!channels) {
 		return -1;
 	}
 	ao2_container_register("channels", channels, prnt_channel_key);
 
+	channels_by_uniqueid = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_MUTEX,
+		AO2_CONTAINER_ALLOC_OPT_DUPS_ALLOW, ast_channel_uniqueid_sort_cb, NULL);
+	if (!channels_by_uniqueid) {
+		return -1;
+	}
+	ao2_container_register("channels_by_uniqueid", channels_by_uniqueid, prnt_channel_key);
+
 	ast_channel_register(&surrogate_tech);
 
 	ast_stasis_channels_init();
@@ -10528,7 +10773,7 @@ int ast_channel_get_cc_agent_type(struct ast_channel *chan, char *agent_type, si
 
 void ast_channel_unlink(struct ast_channel *chan)
 {
-	ao2_unlink(channels, chan);
+	channel_unlink(chan);
 }
 
 struct ast_bridge *ast_channel_get_bridge(const struct ast_channel *chan)
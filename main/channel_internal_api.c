@@ -155,6 +155,8 @@ struct ast_channel {
 	struct timeval creationtime;			/*!< The time of channel creation */
 	struct timeval answertime;				/*!< The time the channel was answered */
 	struct ast_readq_list readq;
+	unsigned int readq_frames;			/*!< How many frames are on readq */
+	unsigned int readq_voice_frames;		/*!< How many voice frames are on readq */
 	struct ast_jb jb;				/*!< The jitterbuffer state */
 	struct timeval dtmf_tv;				/*!< The time that an in process digit began, or the last digit ended */
 	struct ast_hangup_handler_list hangup_handlers;/*!< Hangup handlers on the channel. */
@@ -862,6 +864,19 @@ struct ast_readq_list *ast_channel_readq(struct ast_channel *chan)
 {
 	return &chan->readq;
 }
+unsigned int ast_channel_internal_readq_frames(const struct ast_channel *chan)
+{
+	return chan->readq_frames;
+}
+unsigned int ast_channel_internal_readq_voice_frames(const struct ast_channel *chan)
+{
+	return chan->readq_voice_frames;
+}
+void ast_channel_internal_readq_frames_set(struct ast_channel *chan, unsigned int frames, unsigned int voice_frames)
+{
+	chan->readq_frames = frames;
+	chan->readq_voice_frames = voice_frames;
+}
 struct ast_frame *ast_channel_dtmff(struct ast_channel *chan)
 {
 	return &chan->dtmff;
@@ -1097,6 +1112,11 @@ int ast_channel_alert_write(struct ast_channel *chan)
 	return ast_alertpipe_write(chan->alertpipe);
 }
 
+int ast_channel_internal_alert_write_count(struct ast_channel *chan, unsigned int count)
+{
+	return ast_alertpipe_write_count(chan->alertpipe, count);
+}
+
 ast_alert_status_t ast_channel_internal_alert_flush(struct ast_channel *chan)
 {
 	return ast_alertpipe_flush(chan->alertpipe);
@@ -1247,6 +1267,24 @@ struct ast_flags *ast_channel_flags(struct ast_channel *chan)
 	return &chan->flags;
 }
 
+/*! \brief Hash function for pvt cause code frames */
+static int pvt_cause_hash_fn(const void *vpc, const int flags)
+{
+	const struct ast_control_pvt_cause_code *pc = vpc;
+	return ast_str_hash(ast_tech_to_upper(ast_strdupa(pc->chan_name)));
+}
+
+/*! \brief Comparison function for pvt cause code frames */
+static int pvt_cause_cmp_fn(void *obj, void *vstr, int flags)
+{
+	struct ast_control_pvt_cause_code *pc = obj;
+	char *str = ast_tech_to_upper(ast_strdupa(vstr));
+	char *pc_str = ast_tech_to_upper(ast_strdupa(pc->chan_name));
+	return !strcmp(pc_str, str) ? CMP_MATCH | CMP_STOP : 0;
+}
+
+#define DIALED_CAUSES_BUCKETS 37
+
 static int collect_names_cb(void *obj, void *arg, int flags)
 {
 	struct ast_control_pvt_cause_code *cause_code = obj;
@@ -1265,19 +1303,38 @@ struct ast_str *ast_channel_dialed_causes_channels(const struct ast_channel *cha
 		return NULL;
 	}
 
-	ao2_callback(chan->dialed_causes, 0, collect_names_cb, &chanlist);
+	if (chan->dialed_causes) {
+		ao2_callback(chan->dialed_causes, 0, collect_names_cb, &chanlist);
+	}
 
 	return chanlist;
 }
 
 struct ast_control_pvt_cause_code *ast_channel_dialed_causes_find(const struct ast_channel *chan, const char *chan_name)
 {
+	if (!chan->dialed_causes) {
+		return NULL;
+	}
 	return ao2_find(chan->dialed_causes, chan_name, OBJ_KEY);
 }
 
 int ast_channel_dialed_causes_add(const struct ast_channel *chan, const struct ast_control_pvt_cause_code *cause_code, int datalen)
 {
 	struct ast_control_pvt_cause_code *ao2_cause_code;
+
+	if (!chan->dialed_causes) {
+		/* Only channels that dial others ever have any, so the container is made on first use */
+		ao2_lock((struct ast_channel *) chan);
+		if (!chan->dialed_causes) {
+			((struct ast_channel *) chan)->dialed_causes = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+				DIALED_CAUSES_BUCKETS, pvt_cause_hash_fn, NULL, pvt_cause_cmp_fn);
+		}
+		ao2_unlock((struct ast_channel *) chan);
+		if (!chan->dialed_causes) {
+			return -1;
+		}
+	}
+
 	ao2_find(chan->dialed_causes, cause_code->chan_name, OBJ_KEY | OBJ_UNLINK | OBJ_NODATA);
 	ao2_cause_code = ao2_alloc(datalen, NULL);
 
@@ -1293,45 +1350,27 @@ int ast_channel_dialed_causes_add(const struct ast_channel *chan, const struct a
 
 void ast_channel_dialed_causes_clear(const struct ast_channel *chan)
 {
-	ao2_callback(chan->dialed_causes, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
-}
-
-/*! \brief Hash function for pvt cause code frames */
-static int pvt_cause_hash_fn(const void *vpc, const int flags)
-{
-	const struct ast_control_pvt_cause_code *pc = vpc;
-	return ast_str_hash(ast_tech_to_upper(ast_strdupa(pc->chan_name)));
-}
-
-/*! \brief Comparison function for pvt cause code frames */
-static int pvt_cause_cmp_fn(void *obj, void *vstr, int flags)
-{
-	struct ast_control_pvt_cause_code *pc = obj;
-	char *str = ast_tech_to_upper(ast_strdupa(vstr));
-	char *pc_str = ast_tech_to_upper(ast_strdupa(pc->chan_name));
-	return !strcmp(pc_str, str) ? CMP_MATCH | CMP_STOP : 0;
+	if (chan->dialed_causes) {
+		ao2_callback(chan->dialed_causes, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	}
 }
 
-#define DIALED_CAUSES_BUCKETS 37
+/*! \brief Default size of the string field pool, room for the fields most channels set */
+#define CHANNEL_STRING_FIELD_POOL_SIZE 256
 
 struct ast_channel *__ast_channel_internal_alloc(void (*destructor)(void *obj), const struct ast_assigned_ids *assignedids, const struct ast_channel *requestor, const char *file, int line, const char *function)
 {
 	struct ast_channel *tmp;
 
+	/* Channels are locked many times for every frame, each time only briefly */
 	tmp = __ao2_alloc(sizeof(*tmp), destructor,
-		AO2_ALLOC_OPT_LOCK_MUTEX, "", file, line, function);
+		AO2_ALLOC_OPT_LOCK_MUTEX | AO2_ALLOC_OPT_LOCK_ADAPTIVE, "", file, line, function);
 
 	if (!tmp) {
 		return NULL;
 	}
 
-	if ((ast_string_field_init(tmp, 128))) {
-		return ast_channel_unref(tmp);
-	}
-
-	tmp->dialed_causes = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
-		DIALED_CAUSES_BUCKETS, pvt_cause_hash_fn, NULL, pvt_cause_cmp_fn);
-	if (!tmp->dialed_causes) {
+	if ((ast_string_field_init(tmp, CHANNEL_STRING_FIELD_POOL_SIZE))) {
 		return ast_channel_unref(tmp);
 	}
 
@@ -48,6 +48,7 @@ struct ast_var_t *_ast_var_assign(const char *name, const char *value, const cha
 	ast_copy_string(var->name, name, name_len);
 	var->value = var->name + name_len;
 	ast_copy_string(var->value, value, value_len);
+	var->hash = ast_var_name_hash(name);
 
 	return var;
 }
@@ -82,18 +83,42 @@ const char *ast_var_value(const struct ast_var_t *var)
 	return (var ? var->value : NULL);
 }
 
+unsigned int ast_var_name_hash(const char *name)
+{
+	if (name[0] == '_') {
+		name++;
+		if (name[0] == '_')
+			name++;
+	}
+	return ast_str_hash(name);
+}
+
 char *ast_var_find(const struct varshead *head, const char *name)
 {
 	struct ast_var_t *var;
+	unsigned int hash = ast_var_name_hash(name);
 
 	AST_LIST_TRAVERSE(head, var, entries) {
-		if (!strcmp(name, var->name)) {
+		if (var->hash == hash && !strcmp(name, var->name)) {
 			return var->value;
 		}
 	}
 	return NULL;
 }
 
+struct ast_var_t *ast_var_find_by_name(const struct varshead *head, const char *name)
+{
+	struct ast_var_t *var;
+	unsigned int hash = ast_var_name_hash(name);
+
+	AST_LIST_TRAVERSE(head, var, entries) {
+		if (var->hash == hash && !strcmp(name, ast_var_name(var))) {
+			return var;
+		}
+	}
+	return NULL;
+}
+
 struct varshead *ast_var_list_create(void)
 {
 	struct varshead *head;
@@ -1101,6 +1101,14 @@ static char *handle_showcalls(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 	return RESULT_SUCCESS;
 }
 
+/*! \brief Channels are listed by name */
+static const char *channel_snapshot_page_key(const void *obj)
+{
+	const struct ast_channel_snapshot *snapshot = obj;
+
+	return snapshot->base->name;
+}
+
 static char *handle_chanlist(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 #define FORMAT_STRING  "%-64.64s %-32.32s %-7.7s %-30.30s\n"
@@ -1110,37 +1118,48 @@ static char *handle_chanlist(struct ast_cli_entry *e, int cmd, struct ast_cli_ar
 #define VERBOSE_FORMAT_STRING2 "%-80.80s %-24.24s %-24.24s %-4.4s %-7.7s %-12.12s %-25.25s %-15.15s %8.8s %-11.11s %-11.11s %-20.20s\n"
 
 	struct ao2_container *channels;
-	struct ao2_iterator it_chans;
+	struct ast_cli_page page = { 0, };
 	struct ast_channel_snapshot *cs;
 	int numchans = 0, concise = 0, verbose = 0, count = 0;
+	int pos = e->args - 1;
+	size_t limit = 0;
+	const char *after = NULL;
+	size_t i;
 
 	switch (cmd) {
 	case CLI_INIT:
 		e->command = "core show channels [concise|verbose|count]";
 		e->usage =
-			"Usage: core show channels [concise|verbose|count]\n"
+			"Usage: core show channels [concise|verbose|count] [limit <n>] [after <channel>]\n"
 			"       Lists currently defined channels and some information about them. If\n"
 			"       'concise' is specified, the format is abridged and in a more easily\n"
 			"       machine parsable format. If 'verbose' is specified, the output includes\n"
 			"       more and longer fields. If 'count' is specified only the channel and call\n"
-			"       count is output.\n";
+			"       count is output.\n"
+			"       Channels are listed by name. With 'limit' at most that many are listed,\n"
+			"       and 'after' starts the list after the named channel, the last one of\n"
+			"       the previous page.\n";
 		return NULL;
 
 	case CLI_GENERATE:
 		return NULL;
 	}
 
-	if (a->argc == e->args) {
-		if (!strcasecmp(a->argv[e->args-1],"concise"))
+	if (a->argc > pos) {
+		if (!strcasecmp(a->argv[pos], "concise")) {
 			concise = 1;
-		else if (!strcasecmp(a->argv[e->args-1],"verbose"))
+			pos++;
+		} else if (!strcasecmp(a->argv[pos], "verbose")) {
 			verbose = 1;
-		else if (!strcasecmp(a->argv[e->args-1],"count"))
+			pos++;
+		} else if (!strcasecmp(a->argv[pos], "count")) {
 			count = 1;
-		else
-			return CLI_SHOWUSAGE;
-	} else if (a->argc != e->args - 1)
+			pos++;
+		}
+	}
+	if (ast_cli_page_args(a, pos, &limit, &after)) {
 		return CLI_SHOWUSAGE;
+	}
 
 	channels = ast_channel_cache_by_name();
 
@@ -1152,57 +1171,65 @@ static char *handle_chanlist(struct ast_cli_entry *e, int cmd, struct ast_cli_ar
 				"CallerID", "Duration", "Accountcode", "PeerAccount", "BridgeID");
 	}
 
-	it_chans = ao2_iterator_init(channels, 0);
-	for (; (cs = ao2_iterator_next(&it_chans)); ao2_ref(cs, -1)) {
+	if (!count && ast_cli_page_take(&page, channels, channel_snapshot_page_key, after, limit)) {
+		ao2_ref(channels, -1);
+		return CLI_FAILURE;
+	}
+
+	for (i = 0; i < page.count; i++) {
 		char durbuf[16] = "-";
 
-		if (!count) {
-			if ((concise || verbose)  && !ast_tvzero(cs->base->creationtime)) {
-				int duration = (int)(ast_tvdiff_ms(ast_tvnow(), cs->base->creationtime) / 1000);
-				if (verbose) {
-					int durh = duration / 3600;
-					int durm = (duration % 3600) / 60;
-					int durs = duration % 60;
-					snprintf(durbuf, sizeof(durbuf), "%02d:%02d:%02d", durh, durm, durs);
-				} else {
-					snprintf(durbuf, sizeof(durbuf), "%d", duration);
-				}
-			}
-			if (concise) {
-				ast_cli(a->fd, CONCISE_FORMAT_STRING, cs->base->name, cs->dialplan->context, cs->dialplan->exten, cs->dialplan->priority, ast_state2str(cs->state),
-					S_OR(cs->dialplan->appl, "(None)"),
-					cs->dialplan->data,
-					cs->caller->number,
-					cs->base->accountcode,
-					cs->peer->account,
-					cs->amaflags,
-					durbuf,
-					cs->bridge->id,
-					cs->base->uniqueid);
-			} else if (verbose) {
-				ast_cli(a->fd, VERBOSE_FORMAT_STRING, cs->base->name, cs->dialplan->context, cs->dialplan->exten, cs->dialplan->priority, ast_state2str(cs->state),
-					S_OR(cs->dialplan->appl, "(None)"),
-					S_OR(cs->dialplan->data, "(Empty)"),
-					cs->caller->number,
-					durbuf,
-					cs->base->accountcode,
-					cs->peer->account,
-					cs->bridge->id);
+		cs = page.objects[i];
+		if ((concise || verbose)  && !ast_tvzero(cs->base->creationtime)) {
+			int duration = (int)(ast_tvdiff_ms(ast_tvnow(), cs->base->creationtime) / 1000);
+			if (verbose) {
+				int durh = duration / 3600;
+				int durm = (duration % 3600) / 60;
+				int durs = duration % 60;
+				snprintf(durbuf, sizeof(durbuf), "%02d:%02d:%02d", durh, durm, durs);
 			} else {
-				char locbuf[40] = "(None)";
-				char appdata[40] = "(None)";
+				snprintf(durbuf, sizeof(durbuf), "%d", duration);
+			}
+		}
+		if (concise) {
+			ast_cli(a->fd, CONCISE_FORMAT_STRING, cs->base->name, cs->dialplan->context, cs->dialplan->exten, cs->dialplan->priority, ast_state2str(cs->state),
+				S_OR(cs->dialplan->appl, "(None)"),
+				cs->dialplan->data,
+				cs->caller->number,
+				cs->base->accountcode,
+				cs->peer->account,
+				cs->amaflags,
+				durbuf,
+				cs->bridge->id,
+				cs->base->uniqueid);
+		} else if (verbose) {
+			ast_cli(a->fd, VERBOSE_FORMAT_STRING, cs->base->name, cs->dialplan->context, cs->dialplan->exten, cs->dialplan->priority, ast_state2str(cs->state),
+				S_OR(cs->dialplan->appl, "(None)"),
+				S_OR(cs->dialplan->data, "(Empty)"),
+				cs->caller->number,
+				durbuf,
+				cs->base->accountcode,
+				cs->peer->account,
+				cs->bridge->id);
+		} else {
+			char locbuf[40] = "(None)";
+			char appdata[40] = "(None)";
 
-				if (!ast_strlen_zero(cs->dialplan->context) && !ast_strlen_zero(cs->dialplan->exten)) {
-					snprintf(locbuf, sizeof(locbuf), "%s@%s:%d", cs->dialplan->exten, cs->dialplan->context, cs->dialplan->priority);
-				}
-				if (!ast_strlen_zero(cs->dialplan->appl)) {
-					snprintf(appdata, sizeof(appdata), "%s(%s)", cs->dialplan->appl, S_OR(cs->dialplan->data, ""));
-				}
-				ast_cli(a->fd, FORMAT_STRING, cs->base->name, locbuf, ast_state2str(cs->state), appdata);
+			if (!ast_strlen_zero(cs->dialplan->context) && !ast_strlen_zero(cs->dialplan->exten)) {
+				snprintf(locbuf, sizeof(locbuf), "%s@%s:%d", cs->dialplan->exten, cs->dialplan->context, cs->dialplan->priority);
+			}
+			if (!ast_strlen_zero(cs->dialplan->appl)) {
+				snprintf(appdata, sizeof(appdata), "%s(%s)", cs->dialplan->appl, S_OR(cs->dialplan->data, ""));
 			}
+			ast_cli(a->fd, FORMAT_STRING, cs->base->name, locbuf, ast_state2str(cs->state), appdata);
 		}
 	}
-	ao2_iterator_destroy(&it_chans);
+
+	if (!concise && page.remaining) {
+		ast_cli(a->fd, "%zu more channel%s, continue after %s\n", page.remaining,
+			ESS(page.remaining), ((struct ast_channel_snapshot *) page.objects[page.count - 1])->base->name);
+	}
+	ast_cli_page_release(&page);
 
 	if (!concise) {
 		numchans = ast_active_channels();
@@ -3058,6 +3085,140 @@ void ast_cli_print_timestr_fromseconds(int fd, int seconds, const char *prefix)
 	print_uptimestr(fd, ast_tv(seconds, 0), prefix, 0);
 }
 
+/*! \brief An object taken for a page with its key */
+struct cli_page_entry {
+	const char *key;
+	void *obj;
+};
+
+/*! \brief The objects being taken for a page */
+struct cli_page_collect {
+	struct cli_page_entry *entries;
+	size_t count;
+	size_t size;
+	const char *(*key)(const void *obj);
+	const char *after;
+};
+
+static int cli_page_collect_cb(void *obj, void *arg, int flags)
+{
+	struct cli_page_collect *collect = arg;
+	const char *key = collect->key(obj);
+
+	if (collect->after && strcmp(key, collect->after) <= 0) {
+		return 0;
+	}
+
+	if (collect->count == collect->size) {
+		size_t size = MAX(collect->size * 2, 64);
+		struct cli_page_entry *entries;
+
+		entries = ast_realloc(collect->entries, size * sizeof(*entries));
+		if (!entries) {
+			return CMP_STOP;
+		}
+		collect->entries = entries;
+		collect->size = size;
+	}
+
+	collect->entries[collect->count].key = key;
+	collect->entries[collect->count].obj = ao2_bump(obj);
+	collect->count++;
+
+	return 0;
+}
+
+static int cli_page_entry_cmp(const void *a, const void *b)
+{
+	const struct cli_page_entry *left = a;
+	const struct cli_page_entry *right = b;
+
+	return strcmp(left->key, right->key);
+}
+
+int ast_cli_page_take(struct ast_cli_page *page, struct ao2_container *container,
+	const char *(*key)(const void *obj), const char *after, size_t limit)
+{
+	struct cli_page_collect collect = {
+		.key = key,
+		.after = ast_strlen_zero(after) ? NULL : after,
+	};
+	size_t i;
+
+	memset(page, 0, sizeof(*page));
+
+	/* Sized up front so the container is not locked while memory is grown */
+	collect.size = ao2_container_count(container) + 16;
+	collect.entries = ast_malloc(collect.size * sizeof(*collect.entries));
+	if (!collect.entries) {
+		return -1;
+	}
+
+	ao2_callback(container, OBJ_NODATA, cli_page_collect_cb, &collect);
+
+	qsort(collect.entries, collect.count, sizeof(*collect.entries), cli_page_entry_cmp);
+
+	if (limit && collect.count > limit) {
+		for (i = limit; i < collect.count; i++) {
+			ao2_ref(collect.entries[i].obj, -1);
+		}
+		page->remaining = collect.count - limit;
+		collect.count = limit;
+	}
+
+	page->objects = ast_malloc(MAX(collect.count, 1) * sizeof(*page->objects));
+	if (!page->objects) {
+		for (i = 0; i < collect.count; i++) {
+			ao2_ref(collect.entries[i].obj, -1);
+		}
+		ast_free(collect.entries);
+		page->remaining = 0;
+		return -1;
+	}
+	for (i = 0; i < collect.count; i++) {
+		page->objects[i] = collect.entries[i].obj;
+	}
+	page->count = collect.count;
+	ast_free(collect.entries);
+
+	return 0;
+}
+
+void ast_cli_page_release(struct ast_cli_page *page)
+{
+	size_t i;
+
+	for (i = 0; i < page->count; i++) {
+		ao2_ref(page->objects[i], -1);
+	}
+	ast_free(page->objects);
+	page->objects = NULL;
+	page->count = 0;
+}
+
+int ast_cli_page_args(struct ast_cli_args *a, int pos, size_t *limit, const char **after)
+{
+	unsigned int value;
+
+	for (; pos < a->argc; pos += 2) {
+		if (pos + 1 >= a->argc) {
+			return -1;
+		}
+		if (!strcasecmp(a->argv[pos], "limit")) {
+			if (sscanf(a->argv[pos + 1], "%30u", &value) != 1) {
+				return -1;
+			}
+			*limit = value;
+		} else if (!strcasecmp(a->argv[pos], "after")) {
+			*after = a->argv[pos + 1];
+		} else {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 int ast_cli_allow_at_shutdown(struct ast_cli_entry *e)
 {
 	int res;
@@ -925,6 +925,20 @@ static struct ast_codec silk24 = {
 	.samples_count = silk_samples
 };
 
+/*!
+ * \brief Stop counting references to a builtin codec and its cached format
+ *
+ * They live as long as Asterisk does, and are referenced for nearly every
+ * frame by every thread handling media.
+ */
+#define CODEC_MAKE_IMMORTAL(codec, fmt) \
+	do { \
+		if ((codec) && (fmt)) { \
+			ao2_make_immortal(codec); \
+			ao2_make_immortal(fmt); \
+		} \
+	} while (0)
+
 #define CODEC_REGISTER_AND_CACHE(codec) \
 	({ \
 		int __res_ ## __LINE__ = 0; \
@@ -934,6 +948,7 @@ static struct ast_codec silk24 = {
 		__codec_ ## __LINE__ = ast_codec_get((codec).name, (codec).type, (codec).sample_rate); \
 		__fmt_ ## __LINE__ = __codec_ ## __LINE__ ? ast_format_create(__codec_ ## __LINE__) : NULL; \
 		res |= ast_format_cache_set(__fmt_ ## __LINE__); \
+		CODEC_MAKE_IMMORTAL(__codec_ ## __LINE__, __fmt_ ## __LINE__); \
 		ao2_ref(__fmt_ ## __LINE__, -1); \
 		ao2_ref(__codec_ ## __LINE__, -1); \
 		__res_ ## __LINE__; \
@@ -948,6 +963,7 @@ static struct ast_codec silk24 = {
 		__codec_ ## __LINE__ = ast_codec_get((codec).name, (codec).type, (codec).sample_rate); \
 		__fmt_ ## __LINE__ = ast_format_create_named((fmt_name), __codec_ ## __LINE__); \
 		res |= ast_format_cache_set(__fmt_ ## __LINE__); \
+		CODEC_MAKE_IMMORTAL(__codec_ ## __LINE__, __fmt_ ## __LINE__); \
 		ao2_ref(__fmt_ ## __LINE__, -1); \
 		ao2_ref(__codec_ ## __LINE__, -1); \
 		__res_ ## __LINE__; \
@@ -44,10 +44,12 @@
 #include <libgen.h>
 #include <time.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 #include <math.h>	/* HUGE_VAL */
 #include <regex.h>
 
+#include "asterisk/_private.h"
 #include "asterisk/config.h"
 #include "asterisk/cli.h"
 #include "asterisk/lock.h"
@@ -104,6 +106,8 @@ struct cache_file_mtime {
 	unsigned long stat_mtime_nsec;
 	/*! stat() file modtime seconds since epoc */
 	time_t stat_mtime;
+	/*! Hash of the file contents, only kept for the parsed cache */
+	uint64_t content_hash;
 
 	/*! String stuffed in filename[] after the filename string. */
 	const char *who_asked;
@@ -114,6 +118,35 @@ struct cache_file_mtime {
 /*! Cached file mtime list. */
 static AST_LIST_HEAD_STATIC(cfmtime_head, cache_file_mtime);
 
+AST_LIST_HEAD_NOLOCK(config_parsed_files, cache_file_mtime);
+
+/*!
+ * \brief A configuration file as parsed, shared by everything loading it.
+ *
+ * While being parsed it records the files read, with the includes each
+ * named, and the directories they were looked for in.  It can be used for
+ * as long as none of them have changed.
+ */
+struct config_parsed {
+	AST_LIST_ENTRY(config_parsed) list;
+	/*! The configuration as parsed, never modified once cached */
+	struct ast_config *cfg;
+	/*! The files parsed, who_asked is empty */
+	struct config_parsed_files files;
+	/*! The directories the files and includes were looked for in */
+	struct config_parsed_files dirs;
+	/*! Something was read that can change without a file changing, an #exec or realtime */
+	unsigned int uncacheable:1;
+	/*! The name the file was loaded by */
+	char filename[0];
+};
+
+/*! Parsed configuration files. */
+static AST_LIST_HEAD_STATIC(parsed_cache, config_parsed);
+
+/*! The configuration being parsed by this thread for the parsed cache, if any. */
+AST_THREADSTORAGE(config_parsed_current);
+
 static int init_appendbuf(void *data)
 {
 	struct ast_str **str = data;
@@ -214,6 +247,45 @@ static struct ast_config_map {
 AST_MUTEX_DEFINE_STATIC(config_lock);
 static struct ast_config_engine *config_engine_list;
 
+/*! \brief How lookups of a realtime family are cached, from the [realtime_cache] section of extconfig.conf */
+struct realtime_cache_family {
+	AST_LIST_ENTRY(realtime_cache_family) list;
+	/*! Seconds a lookup that found something is cached for, 0 to only share lookups in flight */
+	int ttl;
+	/*! Seconds a lookup that found nothing is cached for */
+	int negative_ttl;
+	char name[0];
+};
+
+/*! \brief A realtime lookup, in flight or cached */
+struct realtime_cache_entry {
+	/*! When the result stops being used */
+	struct timeval expires;
+	int ttl;
+	int negative_ttl;
+	/*! The lookup is still being done, by the first thread to want it */
+	unsigned int pending:1;
+	/*! The entry found by ast_load_realtime_all_fields() */
+	struct ast_variable *var;
+	/*! The entries found by ast_load_realtime_multientry_fields() */
+	struct ast_config *cfg;
+	/*! The family, whether multiple entries were looked up and the fields looked up by */
+	char key[0];
+};
+
+/*! \brief The most realtime lookups cached at once */
+#define REALTIME_CACHE_MAX 10000
+
+/*! \brief Separates the parts of the key of a cached realtime lookup */
+#define REALTIME_CACHE_SEP '\x1f'
+
+/*! \brief Protects the realtime cache, the families it caches and its entries */
+AST_MUTEX_DEFINE_STATIC(realtime_cache_lock);
+/*! \brief Signalled when a lookup in flight finishes */
+static ast_cond_t realtime_cache_cond;
+static AST_LIST_HEAD_NOLOCK_STATIC(realtime_cache_families, realtime_cache_family);
+static struct ao2_container *realtime_cache;
+
 #define MAX_INCLUDE_LEVEL 10
 
 struct ast_category_template_instance {
@@ -1768,6 +1840,201 @@ static void config_cache_remove(const char *filename, const char *who_asked)
 	AST_LIST_UNLOCK(&cfmtime_head);
 }
 
+/*!
+ * \internal
+ * \brief Hash the contents of a file.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the file cannot be read.
+ */
+static int config_file_hash(const char *filename, uint64_t *hash)
+{
+	struct stat statbuf;
+	const unsigned char *map;
+	size_t i;
+	int fd;
+
+	/* FNV-1a */
+	*hash = 14695981039346656037ULL;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+	if (fstat(fd, &statbuf)) {
+		close(fd);
+		return -1;
+	}
+	if (!statbuf.st_size) {
+		close(fd);
+		return 0;
+	}
+
+	map = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return -1;
+	}
+	for (i = 0; i < statbuf.st_size; ++i) {
+		*hash = (*hash ^ map[i]) * 1099511628211ULL;
+	}
+	munmap((void *) map, statbuf.st_size);
+
+	return 0;
+}
+
+static void config_parsed_files_flush(struct config_parsed_files *files)
+{
+	struct cache_file_mtime *cfmtime;
+
+	while ((cfmtime = AST_LIST_REMOVE_HEAD(files, list))) {
+		config_cache_destroy_entry(cfmtime);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Get the configuration this thread is parsing for the parsed cache.
+ *
+ * \retval NULL if none.
+ */
+static struct config_parsed *config_parsed_recording(void)
+{
+	struct config_parsed **current;
+
+	current = ast_threadstorage_get(&config_parsed_current, sizeof(*current));
+
+	return current ? *current : NULL;
+}
+
+/*!
+ * \internal
+ * \brief Record a file or directory read by the configuration being parsed.
+ *
+ * \param files Where to record it.
+ * \param filename The file or directory.
+ * \param statbuf Its stat(), NULL to stat() it here.
+ *
+ * \return The record, NULL on failure.
+ */
+static struct cache_file_mtime *config_parsed_record(struct config_parsed_files *files,
+	const char *filename, struct stat *statbuf)
+{
+	struct cache_file_mtime *cfmtime;
+	struct stat dirbuf;
+
+	AST_LIST_TRAVERSE(files, cfmtime, list) {
+		if (!strcmp(cfmtime->filename, filename)) {
+			return cfmtime;
+		}
+	}
+
+	if (!statbuf) {
+		if (stat(filename, &dirbuf)) {
+			return NULL;
+		}
+		statbuf = &dirbuf;
+	}
+
+	cfmtime = cfmtime_new(filename, "");
+	if (!cfmtime) {
+		return NULL;
+	}
+	cfmstat_save(cfmtime, statbuf);
+	AST_LIST_INSERT_TAIL(files, cfmtime, list);
+
+	return cfmtime;
+}
+
+/*!
+ * \internal
+ * \brief Record the directory a file is looked for in by the configuration being parsed.
+ */
+static void config_parsed_record_dir(const char *fn)
+{
+	struct config_parsed *parsed = config_parsed_recording();
+	char *dir;
+
+	if (!parsed) {
+		return;
+	}
+
+	dir = ast_strdupa(fn);
+	if (!config_parsed_record(&parsed->dirs, dirname(dir), NULL)) {
+		parsed->uncacheable = 1;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Record a file parsed by the configuration being parsed.
+ */
+static void config_parsed_record_file(const char *fn, struct stat *statbuf)
+{
+	struct config_parsed *parsed = config_parsed_recording();
+	struct cache_file_mtime *cfmtime;
+
+	if (!parsed) {
+		return;
+	}
+
+	cfmtime = config_parsed_record(&parsed->files, fn, statbuf);
+	if (!cfmtime || config_file_hash(fn, &cfmtime->content_hash)) {
+		parsed->uncacheable = 1;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Record something read by the configuration being parsed that has no file.
+ */
+static void config_parsed_record_uncacheable(void)
+{
+	struct config_parsed *parsed = config_parsed_recording();
+
+	if (parsed) {
+		parsed->uncacheable = 1;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Record an include named by a file of the configuration being parsed.
+ */
+static void config_parsed_record_include(const char *configfile, const char *filename)
+{
+	struct config_parsed *parsed = config_parsed_recording();
+	struct cache_file_mtime *cfmtime;
+	struct cache_file_include *cfinclude;
+
+	if (!parsed) {
+		return;
+	}
+
+	AST_LIST_TRAVERSE(&parsed->files, cfmtime, list) {
+		if (!strcmp(cfmtime->filename, configfile)) {
+			break;
+		}
+	}
+	if (!cfmtime) {
+		return;
+	}
+
+	AST_LIST_TRAVERSE(&cfmtime->includes, cfinclude, list) {
+		if (!strcmp(cfinclude->include, filename)) {
+			return;
+		}
+	}
+
+	cfinclude = ast_calloc(1, sizeof(*cfinclude) + strlen(filename) + 1);
+	if (!cfinclude) {
+		parsed->uncacheable = 1;
+		return;
+	}
+	strcpy(cfinclude->include, filename); /* Safe */
+	AST_LIST_INSERT_TAIL(&cfmtime->includes, cfinclude, list);
+}
+
 static void config_cache_attribute(const char *configfile, enum config_cache_attribute_enum attrtype, const char *filename, const char *who_asked)
 {
 	struct cache_file_mtime *cfmtime;
@@ -1791,6 +2058,7 @@ static void config_cache_attribute(const char *configfile, enum config_cache_att
 
 	switch (attrtype) {
 	case ATTRIBUTE_INCLUDE:
+		config_parsed_record_include(configfile, filename);
 		AST_LIST_TRAVERSE(&cfmtime->includes, cfinclude, list) {
 			if (!strcmp(cfinclude->include, filename)) {
 				AST_LIST_UNLOCK(&cfmtime_head);
@@ -1806,6 +2074,7 @@ static void config_cache_attribute(const char *configfile, enum config_cache_att
 		AST_LIST_INSERT_TAIL(&cfmtime->includes, cfinclude, list);
 		break;
 	case ATTRIBUTE_EXEC:
+		config_parsed_record_uncacheable();
 		cfmtime->has_exec = 1;
 		break;
 	}
@@ -2244,6 +2513,11 @@ static struct ast_config *config_text_file_load(const char *database, const char
 		snprintf(fn, sizeof(fn), "%s/%s", ast_config_AST_CONFIG_DIR, filename);
 	}
 
+	if (cfg) {
+		/* A file appearing there changes what is parsed */
+		config_parsed_record_dir(fn);
+	}
+
 	if (ast_test_flag(&flags, CONFIG_FLAG_WITHCOMMENTS)) {
 		comment_buffer = ast_str_create(CB_SIZE);
 		if (comment_buffer) {
@@ -2372,6 +2646,7 @@ static struct ast_config *config_text_file_load(const char *database, const char
 					continue;
 				}
 				count++;
+				config_parsed_record_file(fn, &statbuf);
 				/* If we get to this point, then we're loading regardless */
 				ast_clear_flag(&flags, CONFIG_FLAG_FILEUNCHANGED);
 				ast_debug(1, "Parsing %s\n", fn);
@@ -3023,6 +3298,220 @@ int ast_config_text_file_save2(const char *configfile, const struct ast_config *
 	return 0;
 }
 
+static void realtime_cache_entry_destructor(void *obj)
+{
+	struct realtime_cache_entry *entry = obj;
+
+	ast_variables_destroy(entry->var);
+	ast_config_destroy(entry->cfg);
+}
+
+static int realtime_cache_entry_hash(const void *obj, const int flags)
+{
+	const struct realtime_cache_entry *entry = obj;
+	const char *key = obj;
+
+	if ((flags & OBJ_SEARCH_MASK) != OBJ_SEARCH_KEY) {
+		key = entry->key;
+	}
+
+	return ast_str_hash(key);
+}
+
+static int realtime_cache_entry_cmp(void *obj, void *arg, int flags)
+{
+	const struct realtime_cache_entry *entry = obj;
+	const struct realtime_cache_entry *other = arg;
+	const char *key = arg;
+
+	if ((flags & OBJ_SEARCH_MASK) != OBJ_SEARCH_KEY) {
+		key = other->key;
+	}
+
+	return strcmp(entry->key, key) ? 0 : CMP_MATCH;
+}
+
+static int realtime_cache_entry_of_family(void *obj, void *arg, int flags)
+{
+	const struct realtime_cache_entry *entry = obj;
+	const char *family = arg;
+	size_t len = strlen(family);
+
+	return !strncasecmp(entry->key, family, len) && entry->key[len] == REALTIME_CACHE_SEP ? CMP_MATCH : 0;
+}
+
+static int realtime_cache_entry_expired(void *obj, void *arg, int flags)
+{
+	const struct realtime_cache_entry *entry = obj;
+	const struct timeval *now = arg;
+
+	return !entry->pending && ast_tvcmp(entry->expires, *now) <= 0 ? CMP_MATCH : 0;
+}
+
+/*! \note Called with realtime_cache_lock held */
+static struct realtime_cache_family *realtime_cache_find_family(const char *family)
+{
+	struct realtime_cache_family *cached;
+
+	AST_LIST_TRAVERSE(&realtime_cache_families, cached, list) {
+		if (!strcasecmp(cached->name, family)) {
+			break;
+		}
+	}
+
+	return cached;
+}
+
+static void realtime_cache_append_family(const char *family, int ttl, int negative_ttl)
+{
+	struct realtime_cache_family *cached;
+
+	if (!(cached = ast_calloc(1, sizeof(*cached) + strlen(family) + 1))) {
+		return;
+	}
+	strcpy(cached->name, family); /* Safe */
+	cached->ttl = ttl;
+	cached->negative_ttl = negative_ttl;
+
+	ast_mutex_lock(&realtime_cache_lock);
+	AST_LIST_INSERT_TAIL(&realtime_cache_families, cached, list);
+	ast_mutex_unlock(&realtime_cache_lock);
+
+	ast_verb(5, "Caching realtime %s for %d seconds, %d seconds when nothing is found\n",
+		family, ttl, negative_ttl);
+}
+
+static void realtime_cache_clear_families(void)
+{
+	struct realtime_cache_family *cached;
+
+	ast_mutex_lock(&realtime_cache_lock);
+	while ((cached = AST_LIST_REMOVE_HEAD(&realtime_cache_families, list))) {
+		ast_free(cached);
+	}
+	if (realtime_cache) {
+		ao2_callback(realtime_cache, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA | OBJ_NOLOCK, NULL, NULL);
+	}
+	ast_mutex_unlock(&realtime_cache_lock);
+}
+
+/*!
+ * \internal
+ * \brief Start a realtime lookup through the cache
+ *
+ * Waits for an identical lookup in flight to finish.
+ *
+ * \param family The family looked up
+ * \param fields The fields looked up by
+ * \param multi Whether multiple entries are looked up
+ * \param[out] owner Set if the caller is to do the lookup and pass its
+ *             result to realtime_cache_finish()
+ *
+ * \return The entry of the lookup, which must be unreferenced
+ * \retval NULL if lookups of the family are not cached
+ */
+static struct realtime_cache_entry *realtime_cache_start(const char *family,
+	const struct ast_variable *fields, int multi, int *owner)
+{
+	struct realtime_cache_family *cached;
+	struct realtime_cache_entry *entry;
+	struct ast_str *key;
+	struct timeval now;
+
+	/* Checked without the lock, it only matters that it is set before use */
+	if (!realtime_cache || AST_LIST_EMPTY(&realtime_cache_families)) {
+		return NULL;
+	}
+
+	if (!(key = ast_str_create(128))) {
+		return NULL;
+	}
+	ast_str_set(&key, 0, "%s%c%c", family, REALTIME_CACHE_SEP, multi ? 'm' : 's');
+	for (; fields; fields = fields->next) {
+		ast_str_append(&key, 0, "%c%s%c%s", REALTIME_CACHE_SEP, fields->name,
+			REALTIME_CACHE_SEP, fields->value);
+	}
+
+	ast_mutex_lock(&realtime_cache_lock);
+	if (!(cached = realtime_cache_find_family(family))) {
+		ast_mutex_unlock(&realtime_cache_lock);
+		ast_free(key);
+		return NULL;
+	}
+
+	now = ast_tvnow();
+	entry = ao2_find(realtime_cache, ast_str_buffer(key), OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (entry && realtime_cache_entry_expired(entry, &now, 0)) {
+		ao2_unlink_flags(realtime_cache, entry, OBJ_NOLOCK);
+		ao2_ref(entry, -1);
+		entry = NULL;
+	}
+
+	if (entry) {
+		while (entry->pending) {
+			ast_cond_wait(&realtime_cache_cond, &realtime_cache_lock);
+		}
+		*owner = 0;
+	} else if ((entry = ao2_alloc_options(sizeof(*entry) + ast_str_strlen(key) + 1,
+		realtime_cache_entry_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK))) {
+		strcpy(entry->key, ast_str_buffer(key)); /* Safe */
+		entry->ttl = cached->ttl;
+		entry->negative_ttl = cached->negative_ttl;
+		entry->pending = 1;
+		if (ao2_container_count(realtime_cache) >= REALTIME_CACHE_MAX) {
+			ao2_callback(realtime_cache, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA | OBJ_NOLOCK,
+				realtime_cache_entry_expired, &now);
+		}
+		/* If the cache is full, the lookup is neither shared nor cached */
+		if (ao2_container_count(realtime_cache) < REALTIME_CACHE_MAX) {
+			ao2_link_flags(realtime_cache, entry, OBJ_NOLOCK);
+		}
+		*owner = 1;
+	}
+	ast_mutex_unlock(&realtime_cache_lock);
+	ast_free(key);
+
+	return entry;
+}
+
+/*!
+ * \internal
+ * \brief Finish a realtime lookup through the cache
+ *
+ * \param entry The entry of the lookup
+ * \param var The entry found, of which the cache keeps a copy
+ * \param cfg The entries found, of which the cache keeps a copy
+ */
+static void realtime_cache_finish(struct realtime_cache_entry *entry,
+	const struct ast_variable *var, const struct ast_config *cfg)
+{
+	struct ast_variable *var_copy = var ? ast_variables_dup((struct ast_variable *) var) : NULL;
+	struct ast_config *cfg_copy = cfg ? ast_config_copy(cfg) : NULL;
+	int ttl = var_copy || cfg_copy ? entry->ttl : entry->negative_ttl;
+
+	ast_mutex_lock(&realtime_cache_lock);
+	entry->var = var_copy;
+	entry->cfg = cfg_copy;
+	entry->expires = ast_tvadd(ast_tvnow(), ast_samp2tv(ttl, 1));
+	entry->pending = 0;
+	if (!ttl) {
+		/* Only shared while it was in flight */
+		ao2_unlink_flags(realtime_cache, entry, OBJ_NOLOCK);
+	}
+	ast_cond_broadcast(&realtime_cache_cond);
+	ast_mutex_unlock(&realtime_cache_lock);
+}
+
+void ast_realtime_cache_invalidate(const char *family)
+{
+	ast_mutex_lock(&realtime_cache_lock);
+	if (realtime_cache && (!family || realtime_cache_find_family(family))) {
+		ao2_callback(realtime_cache, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA | OBJ_NOLOCK,
+			family ? realtime_cache_entry_of_family : NULL, (char *) family);
+	}
+	ast_mutex_unlock(&realtime_cache_lock);
+}
+
 static void clear_config_maps(void)
 {
 	struct ast_config_map *map;
@@ -3083,6 +3572,7 @@ static int reload_module(void)
 	SCOPED_MUTEX(lock, &config_lock);
 
 	clear_config_maps();
+	realtime_cache_clear_families();
 
 	configtmp = ast_config_new();
 	if (!configtmp) {
@@ -3150,6 +3640,26 @@ static int reload_module(void)
 			ast_realtime_append_mapping(v->name, driver, database, table, pri);
 	}
 
+	for (v = ast_variable_browse(config, "realtime_cache"); v; v = v->next) {
+		int ttl;
+		int negative_ttl;
+
+		switch (sscanf(v->value, "%30d,%30d", &ttl, &negative_ttl)) {
+		case 1:
+			negative_ttl = ttl;
+			/* Fall through */
+		case 2:
+			if (ttl >= 0 && negative_ttl >= 0) {
+				realtime_cache_append_family(v->name, ttl, negative_ttl);
+				break;
+			}
+			/* Fall through */
+		default:
+			ast_log(LOG_WARNING, "extconfig.conf: realtime_cache value '%s' for '%s' ignored due to wrong format\n",
+				v->value, v->name);
+		}
+	}
+
 	ast_config_destroy(config);
 	return 0;
 }
@@ -3282,6 +3792,7 @@ struct ast_config *ast_config_internal_load(const char *filename, struct ast_con
 	char table[256];
 	struct ast_config_engine *loader = &text_file_engine;
 	struct ast_config *result;
+	struct timeval start = { 0, };
 
 	/* The config file itself bumps include_level by 1 */
 	if (cfg->max_include_level > 0 && cfg->include_level == cfg->max_include_level + 1) {
@@ -3306,8 +3817,20 @@ struct ast_config *ast_config_internal_load(const char *filename, struct ast_con
 		}
 	}
 
+	if (loader != &text_file_engine) {
+		config_parsed_record_uncacheable();
+	}
+
+	if (ast_startup_profile_active()) {
+		start = ast_tvnow();
+	}
+
 	result = loader->load_func(db, table, filename, cfg, flags, suggested_include_file, who_asked);
 
+	if (!ast_tvzero(start)) {
+		ast_startup_profile_record(loader == &text_file_engine ? "config" : "realtime", filename, start);
+	}
+
 	if (result && result != CONFIG_STATUS_FILEINVALID && result != CONFIG_STATUS_FILEUNCHANGED) {
 		result->include_level--;
 		config_hook_exec(filename, who_asked, result);
@@ -3318,18 +3841,321 @@ struct ast_config *ast_config_internal_load(const char *filename, struct ast_con
 	return result;
 }
 
+static void config_parsed_destroy(void *obj)
+{
+	struct config_parsed *parsed = obj;
+
+	ast_config_destroy(parsed->cfg);
+	config_parsed_files_flush(&parsed->files);
+	config_parsed_files_flush(&parsed->dirs);
+}
+
+static struct config_parsed *config_parsed_alloc(const char *filename)
+{
+	struct config_parsed *parsed;
+
+	parsed = ao2_alloc_options(sizeof(*parsed) + strlen(filename) + 1, config_parsed_destroy,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (parsed) {
+		strcpy(parsed->filename, filename); /* Safe */
+	}
+
+	return parsed;
+}
+
+/*!
+ * \internal
+ * \brief Copy a parsed configuration, templates and includes as well.
+ *
+ * Unlike ast_config_copy() the copy is the same as parsing the files
+ * again would have made it.
+ */
+static struct ast_config *config_parsed_copy(const struct ast_config *old)
+{
+	struct ast_config *new_config = ast_config_new();
+	const struct ast_category *cat_iter;
+	const struct ast_config_include *incl;
+	struct ast_config_include **next_incl;
+
+	if (!new_config) {
+		return NULL;
+	}
+	new_config->max_include_level = old->max_include_level;
+
+	for (cat_iter = old->root; cat_iter; cat_iter = cat_iter->next) {
+		struct ast_category_template_instance *x;
+		struct ast_variable *var;
+		struct ast_category *new_cat;
+
+		new_cat = ast_category_new(cat_iter->name, cat_iter->file, cat_iter->lineno);
+		if (!new_cat) {
+			goto fail;
+		}
+		ast_category_append(new_config, new_cat);
+		new_cat->ignored = cat_iter->ignored;
+		new_cat->include_level = cat_iter->include_level;
+
+		for (var = cat_iter->root; var; var = var->next) {
+			struct ast_variable *cloned = variable_clone(var);
+
+			if (!cloned) {
+				goto fail;
+			}
+			cloned->inherited = var->inherited;
+			ast_variable_append(new_cat, cloned);
+		}
+
+		AST_LIST_TRAVERSE(&cat_iter->template_instances, x, next) {
+			struct ast_category_template_instance *new_x;
+			const struct ast_category *old_base = old->root;
+			const struct ast_category *new_base = new_config->root;
+
+			/* Templates are usually near the top so finding the copy by position is quick */
+			while (old_base && old_base != x->inst) {
+				old_base = old_base->next;
+				new_base = new_base->next;
+			}
+
+			new_x = ast_calloc(1, sizeof(*new_x));
+			if (!new_x) {
+				goto fail;
+			}
+			strcpy(new_x->name, x->name); /* Safe */
+			new_x->inst = old_base ? new_base : NULL;
+			AST_LIST_INSERT_TAIL(&new_cat->template_instances, new_x, next);
+		}
+	}
+
+	next_incl = &new_config->includes;
+	for (incl = old->includes; incl; incl = incl->next) {
+		struct ast_config_include *new_incl = ast_calloc(1, sizeof(*new_incl));
+
+		if (!new_incl) {
+			goto fail;
+		}
+		*next_incl = new_incl;
+		next_incl = &new_incl->next;
+
+		new_incl->include_location_file = ast_strdup(incl->include_location_file);
+		new_incl->include_location_lineno = incl->include_location_lineno;
+		new_incl->exec = incl->exec;
+		new_incl->exec_file = ast_strdup(incl->exec_file);
+		new_incl->included_file = ast_strdup(incl->included_file);
+		new_incl->inclusion_count = incl->inclusion_count;
+		if (!new_incl->include_location_file || !new_incl->included_file
+			|| (incl->exec_file && !new_incl->exec_file)) {
+			goto fail;
+		}
+	}
+
+	return new_config;
+
+fail:
+	ast_config_destroy(new_config);
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Check none of the files a parsed configuration was read from have changed.
+ */
+static int config_parsed_is_current(struct config_parsed *parsed)
+{
+	struct cache_file_mtime *cfmtime;
+	struct stat statbuf;
+
+	AST_LIST_TRAVERSE(&parsed->dirs, cfmtime, list) {
+		if (stat(cfmtime->filename, &statbuf) || cfmstat_cmp(cfmtime, &statbuf)) {
+			return 0;
+		}
+	}
+	AST_LIST_TRAVERSE(&parsed->files, cfmtime, list) {
+		uint64_t hash;
+
+		if (stat(cfmtime->filename, &statbuf) || cfmstat_cmp(cfmtime, &statbuf)) {
+			return 0;
+		}
+		/* A file rewritten within the resolution of its mtime looks the same to stat() */
+		if (config_file_hash(cfmtime->filename, &hash) || hash != cfmtime->content_hash) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*!
+ * \internal
+ * \brief Remember the files of a parsed configuration as read on behalf of who_asked.
+ *
+ * This is what parsing the files would have recorded, so later loads with
+ * CONFIG_FLAG_FILEUNCHANGED find them unchanged.
+ */
+static void config_parsed_cache_attributes(struct config_parsed *parsed, const char *who_asked)
+{
+	struct cache_file_mtime *file;
+	struct cache_file_mtime *cfmtime;
+	struct cache_file_include *include;
+	struct cache_file_include *cfinclude;
+
+	AST_LIST_LOCK(&cfmtime_head);
+	AST_LIST_TRAVERSE(&parsed->files, file, list) {
+		AST_LIST_TRAVERSE(&cfmtime_head, cfmtime, list) {
+			if (!strcmp(cfmtime->filename, file->filename) && !strcmp(cfmtime->who_asked, who_asked)) {
+				break;
+			}
+		}
+		if (!cfmtime) {
+			cfmtime = cfmtime_new(file->filename, who_asked);
+			if (!cfmtime) {
+				continue;
+			}
+			AST_LIST_INSERT_SORTALPHA(&cfmtime_head, cfmtime, list, filename);
+		}
+
+		cfmtime->has_exec = 0;
+		config_cache_flush_includes(cfmtime);
+		cfmtime->stat_size = file->stat_size;
+		cfmtime->stat_mtime_nsec = file->stat_mtime_nsec;
+		cfmtime->stat_mtime = file->stat_mtime;
+
+		AST_LIST_TRAVERSE(&file->includes, include, list) {
+			cfinclude = ast_calloc(1, sizeof(*cfinclude) + strlen(include->include) + 1);
+			if (!cfinclude) {
+				break;
+			}
+			strcpy(cfinclude->include, include->include); /* Safe */
+			AST_LIST_INSERT_TAIL(&cfmtime->includes, cfinclude, list);
+		}
+	}
+	AST_LIST_UNLOCK(&cfmtime_head);
+}
+
+/*!
+ * \internal
+ * \brief Get a copy of a configuration file from the parsed cache.
+ *
+ * \retval NULL if it is not cached or any of its files have changed.
+ */
+static struct ast_config *config_parsed_get(const char *filename, const char *who_asked)
+{
+	struct config_parsed *parsed;
+	struct ast_config *cfg = NULL;
+	struct timeval start = { 0, };
+
+	if (ast_startup_profile_active()) {
+		start = ast_tvnow();
+	}
+
+	AST_LIST_LOCK(&parsed_cache);
+	AST_LIST_TRAVERSE(&parsed_cache, parsed, list) {
+		if (!strcmp(parsed->filename, filename)) {
+			ao2_ref(parsed, +1);
+			break;
+		}
+	}
+	AST_LIST_UNLOCK(&parsed_cache);
+
+	if (!parsed) {
+		return NULL;
+	}
+
+	/* The cached configuration is never modified so it is copied without a lock */
+	if (config_parsed_is_current(parsed)) {
+		cfg = config_parsed_copy(parsed->cfg);
+	}
+	if (cfg) {
+		ast_debug(1, "Using parsed %s\n", filename);
+		config_parsed_cache_attributes(parsed, who_asked);
+		config_hook_exec(filename, who_asked, cfg);
+		if (!ast_tvzero(start)) {
+			ast_startup_profile_record("config", filename, start);
+		}
+	}
+	ao2_ref(parsed, -1);
+
+	return cfg;
+}
+
+/*!
+ * \internal
+ * \brief Put a configuration file just parsed in the parsed cache.
+ */
+static void config_parsed_store(struct config_parsed *parsed, const struct ast_config *cfg)
+{
+	struct config_parsed *old;
+
+	if (parsed->uncacheable || AST_LIST_EMPTY(&parsed->files)) {
+		return;
+	}
+
+	parsed->cfg = config_parsed_copy(cfg);
+	if (!parsed->cfg) {
+		return;
+	}
+
+	AST_LIST_LOCK(&parsed_cache);
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&parsed_cache, old, list) {
+		if (!strcmp(old->filename, parsed->filename)) {
+			AST_LIST_REMOVE_CURRENT(list);
+			ao2_ref(old, -1);
+			break;
+		}
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+	AST_LIST_INSERT_TAIL(&parsed_cache, parsed, list);
+	ao2_ref(parsed, +1);
+	AST_LIST_UNLOCK(&parsed_cache);
+}
+
 struct ast_config *ast_config_load2(const char *filename, const char *who_asked, struct ast_flags flags)
 {
 	struct ast_config *cfg;
 	struct ast_config *result;
+	struct config_parsed **current = NULL;
+	struct config_parsed *parsed = NULL;
+	struct config_parsed *outer = NULL;
+
+	/*
+	 * Loads with flags are reload checks or want comments, both of which
+	 * parse the files themselves.
+	 */
+	if (!flags.flags) {
+		result = config_parsed_get(filename, who_asked);
+		if (result) {
+			return result;
+		}
+
+		parsed = config_parsed_alloc(filename);
+		current = ast_threadstorage_get(&config_parsed_current, sizeof(*current));
+		if (parsed && current) {
+			/* A config hook may load another file while this one is parsed */
+			outer = *current;
+			*current = parsed;
+		} else {
+			current = NULL;
+		}
+	}
 
 	cfg = ast_config_new();
-	if (!cfg)
+	if (!cfg) {
+		if (current) {
+			*current = outer;
+		}
+		ao2_cleanup(parsed);
 		return NULL;
+	}
 
 	result = ast_config_internal_load(filename, cfg, flags, "", who_asked);
-	if (!result || result == CONFIG_STATUS_FILEUNCHANGED || result == CONFIG_STATUS_FILEINVALID)
+	if (current) {
+		*current = outer;
+	}
+	if (!result || result == CONFIG_STATUS_FILEUNCHANGED || result == CONFIG_STATUS_FILEINVALID) {
 		ast_config_destroy(cfg);
+	} else if (current) {
+		config_parsed_store(parsed, result);
+	}
+	ao2_cleanup(parsed);
 
 	return result;
 }
@@ -3430,24 +4256,54 @@ static int realtime_arguments_to_fields2(va_list ap, int skip, struct ast_variab
 	return 0;
 }
 
-struct ast_variable *ast_load_realtime_all_fields(const char *family, const struct ast_variable *fields)
+static struct ast_variable *realtime_load_engines(const char *family, const struct ast_variable *fields)
 {
 	struct ast_config_engine *eng;
 	char db[256];
 	char table[256];
 	struct ast_variable *res=NULL;
+	struct timeval start = { 0, };
 	int i;
 
+	if (ast_startup_profile_active()) {
+		start = ast_tvnow();
+	}
+
 	for (i = 1; ; i++) {
 		if ((eng = find_engine(family, i, db, sizeof(db), table, sizeof(table)))) {
 			if (eng->realtime_func && (res = eng->realtime_func(db, table, fields))) {
-				return res;
+				break;
 			}
 		} else {
-			return NULL;
+			break;
 		}
 	}
 
+	if (!ast_tvzero(start)) {
+		ast_startup_profile_record("realtime", family, start);
+	}
+
+	return res;
+}
+
+struct ast_variable *ast_load_realtime_all_fields(const char *family, const struct ast_variable *fields)
+{
+	struct realtime_cache_entry *entry;
+	struct ast_variable *res;
+	int owner;
+
+	if (!(entry = realtime_cache_start(family, fields, 0, &owner))) {
+		return realtime_load_engines(family, fields);
+	}
+
+	if (owner) {
+		res = realtime_load_engines(family, fields);
+		realtime_cache_finish(entry, res, NULL);
+	} else {
+		res = entry->var ? ast_variables_dup(entry->var) : NULL;
+	}
+	ao2_ref(entry, -1);
+
 	return res;
 }
 
@@ -3593,14 +4449,19 @@ int ast_unload_realtime(const char *family)
 	return res;
 }
 
-struct ast_config *ast_load_realtime_multientry_fields(const char *family, const struct ast_variable *fields)
+static struct ast_config *realtime_multi_load_engines(const char *family, const struct ast_variable *fields)
 {
 	struct ast_config_engine *eng;
 	char db[256];
 	char table[256];
 	struct ast_config *res = NULL;
+	struct timeval start = { 0, };
 	int i;
 
+	if (ast_startup_profile_active()) {
+		start = ast_tvnow();
+	}
+
 	for (i = 1; ; i++) {
 		if ((eng = find_engine(family, i, db, sizeof(db), table, sizeof(table)))) {
 			if (eng->realtime_multi_func && (res = eng->realtime_multi_func(db, table, fields))) {
@@ -3616,6 +4477,31 @@ struct ast_config *ast_load_realtime_multientry_fields(const char *family, const
 		}
 	}
 
+	if (!ast_tvzero(start)) {
+		ast_startup_profile_record("realtime", family, start);
+	}
+
+	return res;
+}
+
+struct ast_config *ast_load_realtime_multientry_fields(const char *family, const struct ast_variable *fields)
+{
+	struct realtime_cache_entry *entry;
+	struct ast_config *res;
+	int owner;
+
+	if (!(entry = realtime_cache_start(family, fields, 1, &owner))) {
+		return realtime_multi_load_engines(family, fields);
+	}
+
+	if (owner) {
+		res = realtime_multi_load_engines(family, fields);
+		realtime_cache_finish(entry, NULL, res);
+	} else {
+		res = entry->cfg ? ast_config_copy(entry->cfg) : NULL;
+	}
+	ao2_ref(entry, -1);
+
 	return res;
 }
 
@@ -3653,6 +4539,8 @@ int ast_update_realtime_fields(const char *family, const char *keyfield, const c
 		}
 	}
 
+
+	ast_realtime_cache_invalidate(family);
 	return res;
 }
 
@@ -3689,6 +4577,8 @@ int ast_update2_realtime_fields(const char *family, const struct ast_variable *l
 		}
 	}
 
+
+	ast_realtime_cache_invalidate(family);
 	return res;
 }
 
@@ -3734,6 +4624,8 @@ int ast_store_realtime_fields(const char *family, const struct ast_variable *fie
 		}
 	}
 
+
+	ast_realtime_cache_invalidate(family);
 	return res;
 }
 
@@ -3770,6 +4662,8 @@ int ast_destroy_realtime_fields(const char *family, const char *keyfield, const
 		}
 	}
 
+
+	ast_realtime_cache_invalidate(family);
 	return res;
 }
 
@@ -4209,15 +5103,58 @@ static char *handle_cli_config_list(struct ast_cli_entry *e, int cmd, struct ast
 	return CLI_SUCCESS;
 }
 
+static char *handle_cli_realtime_cache_flush(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct realtime_cache_family *cached;
+	int wordlen;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "realtime cache flush";
+		e->usage =
+			"Usage: realtime cache flush [<family>]\n"
+			"   Forgets the cached realtime lookups of <family>, or of every family\n";
+		return NULL;
+	case CLI_GENERATE:
+		if (a->pos > 3) {
+			return NULL;
+		}
+
+		wordlen = strlen(a->word);
+
+		ast_mutex_lock(&realtime_cache_lock);
+		AST_LIST_TRAVERSE(&realtime_cache_families, cached, list) {
+			if (!strncasecmp(cached->name, a->word, wordlen)) {
+				if (ast_cli_completion_add(ast_strdup(cached->name))) {
+					break;
+				}
+			}
+		}
+		ast_mutex_unlock(&realtime_cache_lock);
+
+		return NULL;
+	}
+
+	if (a->argc < 3 || a->argc > 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_realtime_cache_invalidate(a->argc == 4 ? a->argv[3] : NULL);
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_config[] = {
 	AST_CLI_DEFINE(handle_cli_core_show_config_mappings, "Display config mappings (file names to config engines)"),
 	AST_CLI_DEFINE(handle_cli_config_reload, "Force a reload on modules using a particular configuration file"),
 	AST_CLI_DEFINE(handle_cli_config_list, "Show all files that have loaded a configuration file"),
+	AST_CLI_DEFINE(handle_cli_realtime_cache_flush, "Forget cached realtime lookups"),
 };
 
 static void config_shutdown(void)
 {
 	struct cache_file_mtime *cfmtime;
+	struct config_parsed *parsed;
 
 	AST_LIST_LOCK(&cfmtime_head);
 	while ((cfmtime = AST_LIST_REMOVE_HEAD(&cfmtime_head, list))) {
@@ -4225,16 +5162,32 @@ static void config_shutdown(void)
 	}
 	AST_LIST_UNLOCK(&cfmtime_head);
 
+	AST_LIST_LOCK(&parsed_cache);
+	while ((parsed = AST_LIST_REMOVE_HEAD(&parsed_cache, list))) {
+		ao2_ref(parsed, -1);
+	}
+	AST_LIST_UNLOCK(&parsed_cache);
+
 	ast_cli_unregister_multiple(cli_config, ARRAY_LEN(cli_config));
 
 	clear_config_maps();
 
+	realtime_cache_clear_families();
+	ao2_cleanup(realtime_cache);
+	realtime_cache = NULL;
+	ast_cond_destroy(&realtime_cache_cond);
+
 	ao2_cleanup(cfg_hooks);
 	cfg_hooks = NULL;
 }
 
 int register_config_cli(void)
 {
+	ast_cond_init(&realtime_cache_cond, NULL);
+	/* Protected by realtime_cache_lock */
+	realtime_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, 257,
+		realtime_cache_entry_hash, NULL, realtime_cache_entry_cmp);
+
 	ast_cli_register_multiple(cli_config, ARRAY_LEN(cli_config));
 	/* This is separate from the module load so cleanup can happen very late. */
 	ast_register_cleanup(config_shutdown);
@@ -80,6 +80,8 @@ struct aco_option {
 
 #ifdef AST_XML_DOCS
 static struct ao2_container *xmldocs;
+/*! \brief Protects building xmldocs when first shown */
+AST_MUTEX_DEFINE_STATIC(xmldocs_lock);
 
 /*! \brief Value of the aco_option_type enum as strings */
 static char *aco_option_type_string[] = {
@@ -1087,11 +1089,18 @@ static struct ast_str *derive_category_text(enum aco_category_op category_match,
 static int xmldoc_update_config_type(const char *module, const char *name, const char *category, const char *matchfield, const char *matchvalue, enum aco_category_op category_match)
 {
 	RAII_VAR(struct ast_xml_xpath_results *, results, NULL, ast_xml_xpath_results_free);
-	RAII_VAR(struct ast_xml_doc_item *, config_info, ao2_find(xmldocs, module, OBJ_KEY), ao2_cleanup);
+	RAII_VAR(struct ast_xml_doc_item *, config_info, NULL, ao2_cleanup);
 	struct ast_xml_doc_item *config_type;
 	struct ast_xml_node *type, *syntax, *matchinfo, *tmp;
 	struct ast_str *derived_category = NULL;
 
+	/* Looking the documentation up would parse it, which lazy loading is there to avoid */
+	if (ast_xmldoc_lazy()) {
+		return 0;
+	}
+
+	config_info = ao2_find(xmldocs, module, OBJ_KEY);
+
 	/* If we already have a syntax element, bail. This isn't an error, since we may unload a module which
 	 * has updated the docs and then load it again. */
 	if ((results = ast_xmldoc_query("/docs/configInfo[@name='%s']/configFile/configObject[@name='%s']/syntax", module, name))) {
@@ -1172,12 +1181,18 @@ static int xmldoc_update_config_type(const char *module, const char *name, const
 static int xmldoc_update_config_option(struct aco_type **types, const char *module, const char *name, const char *object_name, const char *default_value, unsigned int regex, enum aco_option_type type)
 {
 	RAII_VAR(struct ast_xml_xpath_results *, results, NULL, ast_xml_xpath_results_free);
-	RAII_VAR(struct ast_xml_doc_item *, config_info, ao2_find(xmldocs, module, OBJ_KEY), ao2_cleanup);
+	RAII_VAR(struct ast_xml_doc_item *, config_info, NULL, ao2_cleanup);
 	struct ast_xml_doc_item * config_option;
 	struct ast_xml_node *option;
 
 	ast_assert(ARRAY_LEN(aco_option_type_string) > type);
 
+	if (ast_xmldoc_lazy()) {
+		return 0;
+	}
+
+	config_info = ao2_find(xmldocs, module, OBJ_KEY);
+
 	if (!config_info || !(config_option = find_xmldoc_option(config_info, types, name))) {
 		ast_log(LOG_ERROR, "XML Documentation for option '%s' in modules '%s' not found!\n", name, module);
 		return XMLDOC_STRICT ? -1 : 0;
@@ -1358,6 +1373,22 @@ static void cli_show_module_options(struct ast_cli_args *a)
 	}
 }
 
+/*! \internal
+ * \brief Build the configuration documentation, if it was deferred until first shown
+ *
+ * \retval 0 if the documentation is available
+ */
+static int xmldocs_load(void)
+{
+	ast_mutex_lock(&xmldocs_lock);
+	if (!xmldocs) {
+		xmldocs = ast_xmldoc_build_documentation("configInfo");
+	}
+	ast_mutex_unlock(&xmldocs_lock);
+
+	return xmldocs ? 0 : -1;
+}
+
 static char *cli_show_help(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	switch (cmd) {
@@ -1382,6 +1413,9 @@ static char *cli_show_help(struct ast_cli_entry *e, int cmd, struct ast_cli_args
 			"     configuration help for that module may be incomplete.\n";
 		return NULL;
 	case CLI_GENERATE:
+		if (xmldocs_load()) {
+			return NULL;
+		}
 		switch(a->pos) {
 		case 3:
 			return complete_config_module(a->word);
@@ -1394,6 +1428,11 @@ static char *cli_show_help(struct ast_cli_entry *e, int cmd, struct ast_cli_args
 		}
 	}
 
+	if (xmldocs_load()) {
+		ast_cli(a->fd, "Configuration documentation is not available\n");
+		return CLI_FAILURE;
+	}
+
 	switch (a->argc) {
 	case 3:
 		cli_show_modules(a);
@@ -1429,7 +1468,8 @@ int aco_init(void)
 {
 #ifdef AST_XML_DOCS
 	ast_register_cleanup(aco_deinit);
-	if (!(xmldocs = ast_xmldoc_build_documentation("configInfo"))) {
+	/* When loaded lazily, the documentation is built when first shown */
+	if (!ast_xmldoc_lazy() && !(xmldocs = ast_xmldoc_build_documentation("configInfo"))) {
 		ast_log(LOG_ERROR, "Couldn't build config documentation\n");
 		return -1;
 	}
@@ -51,6 +51,7 @@
 #include "asterisk/cli.h"
 #include "asterisk/utils.h"
 #include "asterisk/manager.h"
+#include "asterisk/options.h"
 
 /*** DOCUMENTATION
 	<manager name="DBGet" language="en_US">
@@ -126,18 +127,78 @@ static int dosync;
 
 static void db_sync(void);
 
+/*!
+ * \brief A connection reading the database and its prepared statements
+ *
+ * The main connection, guarded by dblock, is always one.  When astdb runs
+ * in WAL mode, a pool of read-only connections is added so reads no longer
+ * wait for each other or for writes.
+ */
+struct db_reader {
+	sqlite3 *db;
+	sqlite3_stmt *get_stmt;
+	sqlite3_stmt *exists_stmt;
+	sqlite3_stmt *gettree_stmt;
+	sqlite3_stmt *gettree_all_stmt;
+	sqlite3_stmt *gettree_prefix_stmt;
+	sqlite3_stmt *showkey_stmt;
+	AST_LIST_ENTRY(db_reader) list;
+};
+
+/*! The statements of the main connection */
+static struct db_reader main_reader;
+
+/*! Number of read-only connections, 0 if astdb is not in WAL mode */
+static unsigned int read_connections;
+/*! The read-only connections not in use */
+static AST_LIST_HEAD_NOLOCK_STATIC(readers, db_reader);
+AST_MUTEX_DEFINE_STATIC(readers_lock);
+static ast_cond_t readers_cond;
+/*! Set once the read-only connections are closed */
+static int readers_closed;
+
+enum db_write_type {
+	DB_WRITE_PUT,
+	DB_WRITE_DEL,
+	DB_WRITE_DEL2,
+	DB_WRITE_DELTREE,
+};
+
+/*! \brief A change waiting to be committed by the write thread */
+struct db_write {
+	enum db_write_type type;
+	/*! The full key, or the prefix of the keys to delete */
+	const char *key;
+	size_t key_len;
+	const char *value;
+	/*! The result of the change */
+	int res;
+	/*! Set once the change is committed */
+	int done;
+	AST_LIST_ENTRY(db_write) list;
+};
+
+/*! The changes the write thread will commit together next */
+static AST_LIST_HEAD_NOLOCK_STATIC(write_queue, db_write);
+AST_MUTEX_DEFINE_STATIC(write_lock);
+static ast_cond_t write_cond;
+static ast_cond_t write_done_cond;
+static int write_exit;
+
 #define DEFINE_SQL_STATEMENT(stmt,sql) static sqlite3_stmt *stmt; \
 	const char stmt##_sql[] = sql;
+/* Statements of struct db_reader, prepared on every connection reading the database */
+#define DEFINE_SQL_READ_STATEMENT(stmt,sql) const char stmt##_sql[] = sql;
 
 DEFINE_SQL_STATEMENT(put_stmt, "INSERT OR REPLACE INTO astdb (key, value) VALUES (?, ?)")
-DEFINE_SQL_STATEMENT(get_stmt, "SELECT value FROM astdb WHERE key=?")
-DEFINE_SQL_STATEMENT(exists_stmt, "SELECT CAST(COUNT(1) AS INTEGER) AS 'exists' FROM astdb WHERE key=?")
+DEFINE_SQL_READ_STATEMENT(get_stmt, "SELECT value FROM astdb WHERE key=?")
+DEFINE_SQL_READ_STATEMENT(exists_stmt, "SELECT CAST(COUNT(1) AS INTEGER) AS 'exists' FROM astdb WHERE key=?")
 DEFINE_SQL_STATEMENT(del_stmt, "DELETE FROM astdb WHERE key=?")
 DEFINE_SQL_STATEMENT(deltree_stmt, "DELETE FROM astdb WHERE key || '/' LIKE ? || '/' || '%'")
 DEFINE_SQL_STATEMENT(deltree_all_stmt, "DELETE FROM astdb")
-DEFINE_SQL_STATEMENT(gettree_stmt, "SELECT key, value FROM astdb WHERE key || '/' LIKE ? || '/' || '%' ORDER BY key")
-DEFINE_SQL_STATEMENT(gettree_all_stmt, "SELECT key, value FROM astdb ORDER BY key")
-DEFINE_SQL_STATEMENT(showkey_stmt, "SELECT key, value FROM astdb WHERE key LIKE '%' || '/' || ? ORDER BY key")
+DEFINE_SQL_READ_STATEMENT(gettree_stmt, "SELECT key, value FROM astdb WHERE key || '/' LIKE ? || '/' || '%' ORDER BY key")
+DEFINE_SQL_READ_STATEMENT(gettree_all_stmt, "SELECT key, value FROM astdb ORDER BY key")
+DEFINE_SQL_READ_STATEMENT(showkey_stmt, "SELECT key, value FROM astdb WHERE key LIKE '%' || '/' || ? ORDER BY key")
 DEFINE_SQL_STATEMENT(create_astdb_stmt, "CREATE TABLE IF NOT EXISTS astdb(key VARCHAR(256), value VARCHAR(256), PRIMARY KEY(key))")
 
 /* This query begs an explanation:
@@ -152,13 +213,13 @@ DEFINE_SQL_STATEMENT(create_astdb_stmt, "CREATE TABLE IF NOT EXISTS astdb(key VA
  * that have 'key' as a prefix and performs much better than the equivalent "LIKE key ||
  * '%'" operation.
  */
-DEFINE_SQL_STATEMENT(gettree_prefix_stmt, "SELECT key, value FROM astdb WHERE key > ?1 AND key <= ?1 || X'ffff'")
+DEFINE_SQL_READ_STATEMENT(gettree_prefix_stmt, "SELECT key, value FROM astdb WHERE key > ?1 AND key <= ?1 || X'ffff'")
 
-static int init_stmt(sqlite3_stmt **stmt, const char *sql, size_t len)
+static int init_stmt(sqlite3 *db, sqlite3_stmt **stmt, const char *sql, size_t len)
 {
 	ast_mutex_lock(&dblock);
-	if (sqlite3_prepare(astdb, sql, len, stmt, NULL) != SQLITE_OK) {
-		ast_log(LOG_WARNING, "Couldn't prepare statement '%s': %s\n", sql, sqlite3_errmsg(astdb));
+	if (sqlite3_prepare(db, sql, len, stmt, NULL) != SQLITE_OK) {
+		ast_log(LOG_WARNING, "Couldn't prepare statement '%s': %s\n", sql, sqlite3_errmsg(db));
 		ast_mutex_unlock(&dblock);
 		return -1;
 	}
@@ -171,10 +232,10 @@ static int init_stmt(sqlite3_stmt **stmt, const char *sql, size_t len)
  * \brief Clean up the prepared SQLite3 statement
  * \note dblock should already be locked prior to calling this method
  */
-static int clean_stmt(sqlite3_stmt **stmt, const char *sql)
+static int clean_stmt(sqlite3 *db, sqlite3_stmt **stmt, const char *sql)
 {
 	if (sqlite3_finalize(*stmt) != SQLITE_OK) {
-		ast_log(LOG_WARNING, "Couldn't finalize statement '%s': %s\n", sql, sqlite3_errmsg(astdb));
+		ast_log(LOG_WARNING, "Couldn't finalize statement '%s': %s\n", sql, sqlite3_errmsg(db));
 		*stmt = NULL;
 		return -1;
 	}
@@ -182,39 +243,52 @@ static int clean_stmt(sqlite3_stmt **stmt, const char *sql)
 	return 0;
 }
 
+/*! \internal
+ * \brief Clean up the prepared SQLite3 statements of a reading connection
+ */
+static void clean_reader_statements(struct db_reader *reader)
+{
+	clean_stmt(reader->db, &reader->get_stmt, get_stmt_sql);
+	clean_stmt(reader->db, &reader->exists_stmt, exists_stmt_sql);
+	clean_stmt(reader->db, &reader->gettree_stmt, gettree_stmt_sql);
+	clean_stmt(reader->db, &reader->gettree_all_stmt, gettree_all_stmt_sql);
+	clean_stmt(reader->db, &reader->gettree_prefix_stmt, gettree_prefix_stmt_sql);
+	clean_stmt(reader->db, &reader->showkey_stmt, showkey_stmt_sql);
+}
+
 /*! \internal
  * \brief Clean up all prepared SQLite3 statements
  * \note dblock should already be locked prior to calling this method
  */
 static void clean_statements(void)
 {
-	clean_stmt(&get_stmt, get_stmt_sql);
-	clean_stmt(&exists_stmt, exists_stmt_sql);
-	clean_stmt(&del_stmt, del_stmt_sql);
-	clean_stmt(&deltree_stmt, deltree_stmt_sql);
-	clean_stmt(&deltree_all_stmt, deltree_all_stmt_sql);
-	clean_stmt(&gettree_stmt, gettree_stmt_sql);
-	clean_stmt(&gettree_all_stmt, gettree_all_stmt_sql);
-	clean_stmt(&gettree_prefix_stmt, gettree_prefix_stmt_sql);
-	clean_stmt(&showkey_stmt, showkey_stmt_sql);
-	clean_stmt(&put_stmt, put_stmt_sql);
-	clean_stmt(&create_astdb_stmt, create_astdb_stmt_sql);
+	clean_reader_statements(&main_reader);
+	clean_stmt(astdb, &del_stmt, del_stmt_sql);
+	clean_stmt(astdb, &deltree_stmt, deltree_stmt_sql);
+	clean_stmt(astdb, &deltree_all_stmt, deltree_all_stmt_sql);
+	clean_stmt(astdb, &put_stmt, put_stmt_sql);
+	clean_stmt(astdb, &create_astdb_stmt, create_astdb_stmt_sql);
+}
+
+static int init_reader_statements(struct db_reader *reader)
+{
+	return init_stmt(reader->db, &reader->get_stmt, get_stmt_sql, sizeof(get_stmt_sql))
+	|| init_stmt(reader->db, &reader->exists_stmt, exists_stmt_sql, sizeof(exists_stmt_sql))
+	|| init_stmt(reader->db, &reader->gettree_stmt, gettree_stmt_sql, sizeof(gettree_stmt_sql))
+	|| init_stmt(reader->db, &reader->gettree_all_stmt, gettree_all_stmt_sql, sizeof(gettree_all_stmt_sql))
+	|| init_stmt(reader->db, &reader->gettree_prefix_stmt, gettree_prefix_stmt_sql, sizeof(gettree_prefix_stmt_sql))
+	|| init_stmt(reader->db, &reader->showkey_stmt, showkey_stmt_sql, sizeof(showkey_stmt_sql));
 }
 
 static int init_statements(void)
 {
 	/* Don't initialize create_astdb_statement here as the astdb table needs to exist
 	 * brefore these statements can be initialized */
-	return init_stmt(&get_stmt, get_stmt_sql, sizeof(get_stmt_sql))
-	|| init_stmt(&exists_stmt, exists_stmt_sql, sizeof(exists_stmt_sql))
-	|| init_stmt(&del_stmt, del_stmt_sql, sizeof(del_stmt_sql))
-	|| init_stmt(&deltree_stmt, deltree_stmt_sql, sizeof(deltree_stmt_sql))
-	|| init_stmt(&deltree_all_stmt, deltree_all_stmt_sql, sizeof(deltree_all_stmt_sql))
-	|| init_stmt(&gettree_stmt, gettree_stmt_sql, sizeof(gettree_stmt_sql))
-	|| init_stmt(&gettree_all_stmt, gettree_all_stmt_sql, sizeof(gettree_all_stmt_sql))
-	|| init_stmt(&gettree_prefix_stmt, gettree_prefix_stmt_sql, sizeof(gettree_prefix_stmt_sql))
-	|| init_stmt(&showkey_stmt, showkey_stmt_sql, sizeof(showkey_stmt_sql))
-	|| init_stmt(&put_stmt, put_stmt_sql, sizeof(put_stmt_sql));
+	return init_reader_statements(&main_reader)
+	|| init_stmt(astdb, &del_stmt, del_stmt_sql, sizeof(del_stmt_sql))
+	|| init_stmt(astdb, &deltree_stmt, deltree_stmt_sql, sizeof(deltree_stmt_sql))
+	|| init_stmt(astdb, &deltree_all_stmt, deltree_all_stmt_sql, sizeof(deltree_all_stmt_sql))
+	|| init_stmt(astdb, &put_stmt, put_stmt_sql, sizeof(put_stmt_sql));
 }
 
 static int convert_bdb_to_sqlite3(void)
@@ -236,7 +310,7 @@ static int db_create_astdb(void)
 	int res = 0;
 
 	if (!create_astdb_stmt) {
-		init_stmt(&create_astdb_stmt, create_astdb_stmt_sql, sizeof(create_astdb_stmt_sql));
+		init_stmt(astdb, &create_astdb_stmt, create_astdb_stmt_sql, sizeof(create_astdb_stmt_sql));
 	}
 
 	ast_mutex_lock(&dblock);
@@ -288,22 +362,571 @@ static int db_open(void)
 		ast_mutex_unlock(&dblock);
 		return -1;
 	}
+	main_reader.db = astdb;
+
+	ast_mutex_unlock(&dblock);
+
+	return 0;
+}
+
+static int journal_mode_cb(void *arg, int columns, char **values, char **colnames)
+{
+	char *mode = arg;
+
+	if (columns && values[0]) {
+		ast_copy_string(mode, values[0], 8);
+	}
+
+	return 0;
+}
 
+/*!
+ * \internal
+ * \brief Switch the database to write-ahead logging so it can be read while written
+ *
+ * \retval 0 The database is in WAL mode
+ * \retval -1 It is not, and only the main connection can be used
+ */
+static int db_enable_wal(void)
+{
+	char mode[8] = "";
+	char *errmsg = NULL;
+
+	ast_mutex_lock(&dblock);
+	if (sqlite3_exec(astdb, "PRAGMA journal_mode=WAL", journal_mode_cb, mode, &errmsg) != SQLITE_OK) {
+		ast_log(LOG_WARNING, "Couldn't switch astdb to WAL mode: %s\n", errmsg);
+		sqlite3_free(errmsg);
+		ast_mutex_unlock(&dblock);
+		return -1;
+	}
+	if (strcasecmp(mode, "wal")) {
+		ast_log(LOG_WARNING, "Couldn't switch astdb to WAL mode, it stays in '%s' mode\n", mode);
+		ast_mutex_unlock(&dblock);
+		return -1;
+	}
+	/* Commits only wait for the disk on checkpoints, which is as safe as the rollback journal */
+	if (sqlite3_exec(astdb, "PRAGMA synchronous=NORMAL", NULL, NULL, &errmsg) != SQLITE_OK) {
+		ast_log(LOG_WARNING, "Couldn't set astdb synchronous mode: %s\n", errmsg);
+		sqlite3_free(errmsg);
+	}
 	ast_mutex_unlock(&dblock);
 
 	return 0;
 }
 
+/*! \internal
+ * \brief Close the read-only connections, waiting for those in use
+ */
+static void db_readers_close(void)
+{
+	struct db_reader *reader;
+	unsigned int closed = 0;
+
+	ast_mutex_lock(&readers_lock);
+	while (closed < read_connections) {
+		while (!(reader = AST_LIST_REMOVE_HEAD(&readers, list))) {
+			ast_cond_wait(&readers_cond, &readers_lock);
+		}
+		clean_reader_statements(reader);
+		sqlite3_close(reader->db);
+		ast_free(reader);
+		++closed;
+	}
+	/* Anyone still wanting to read falls back to the main connection */
+	readers_closed = 1;
+	ast_cond_broadcast(&readers_cond);
+	ast_mutex_unlock(&readers_lock);
+}
+
+/*! \internal
+ * \brief Open the read-only connections
+ */
+static int db_readers_open(void)
+{
+	const char *dbname = sqlite3_db_filename(astdb, "main");
+	unsigned int opened;
+
+	for (opened = 0; opened < read_connections; ++opened) {
+		struct db_reader *reader = ast_calloc(1, sizeof(*reader));
+
+		if (!reader) {
+			break;
+		}
+		if (sqlite3_open_v2(dbname, &reader->db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+			ast_log(LOG_WARNING, "Unable to open Asterisk database '%s' for reading: %s\n",
+				dbname, sqlite3_errmsg(reader->db));
+			sqlite3_close(reader->db);
+			ast_free(reader);
+			break;
+		}
+		sqlite3_busy_timeout(reader->db, 1000);
+		if (init_reader_statements(reader)) {
+			clean_reader_statements(reader);
+			sqlite3_close(reader->db);
+			ast_free(reader);
+			break;
+		}
+
+		ast_mutex_lock(&readers_lock);
+		AST_LIST_INSERT_HEAD(&readers, reader, list);
+		ast_mutex_unlock(&readers_lock);
+	}
+
+	if (opened < read_connections) {
+		/* Only the ones opened must be waited for */
+		read_connections = opened;
+		db_readers_close();
+		read_connections = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Get a connection to read the database with
+ *
+ * \note Must be given back with db_reader_release()
+ */
+static struct db_reader *db_reader_acquire(void)
+{
+	struct db_reader *reader = NULL;
+
+	if (read_connections) {
+		ast_mutex_lock(&readers_lock);
+		while (!readers_closed && !(reader = AST_LIST_REMOVE_HEAD(&readers, list))) {
+			ast_cond_wait(&readers_cond, &readers_lock);
+		}
+		ast_mutex_unlock(&readers_lock);
+		if (reader) {
+			return reader;
+		}
+	}
+
+	ast_mutex_lock(&dblock);
+	return &main_reader;
+}
+
+static void db_reader_release(struct db_reader *reader)
+{
+	if (reader == &main_reader) {
+		ast_mutex_unlock(&dblock);
+		return;
+	}
+
+	ast_mutex_lock(&readers_lock);
+	AST_LIST_INSERT_HEAD(&readers, reader, list);
+	ast_cond_signal(&readers_cond);
+	ast_mutex_unlock(&readers_lock);
+}
+
+/*! Buckets of the hash of a cached family */
+#define DB_CACHE_BUCKETS 1031
+/*! Approximate bytes two containers spend on each cached entry besides the entry */
+#define DB_CACHE_ENTRY_OVERHEAD 96
+
+/*! \brief A cached key and its value */
+struct db_cache_entry {
+	/*! The value, stored after the key */
+	const char *value;
+	/*! Bytes counted against the cache size */
+	size_t size;
+	/*! The full key */
+	char key[0];
+};
+
+/*!
+ * \brief An astdb family held in memory
+ *
+ * The whole family is loaded on first use so missing keys and prefix searches
+ * can be answered from memory too.  It is changed along with the database
+ * (write through), always with dblock held, and readers only take its lock.
+ */
+struct db_cache_family {
+	ast_rwlock_t lock;
+	/*! Entries by key */
+	struct ao2_container *entries;
+	/*! The same entries in key order */
+	struct ao2_container *index;
+	/*! Bytes counted against the cache size */
+	size_t size;
+	/*! Set while the entries hold the whole family */
+	unsigned int loaded:1;
+	/*! Set once the family did not fit in the cache */
+	unsigned int disabled:1;
+	/*! "/family/", the start of every key of the family */
+	size_t prefix_len;
+	char prefix[0];
+};
+
+/*! The families cached, fixed once astdb is initialized */
+static AST_VECTOR(, struct db_cache_family *) cached_families;
+/*! Bytes used by all cached families, protected by dblock */
+static size_t cache_size;
+
+AO2_STRING_FIELD_HASH_FN(db_cache_entry, key);
+AO2_STRING_FIELD_CMP_FN(db_cache_entry, key);
+
+static int db_cache_entry_sort(const void *obj_left, const void *obj_right, int flags)
+{
+	const struct db_cache_entry *left = obj_left;
+	const char *right_key = obj_right;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = ((const struct db_cache_entry *) obj_right)->key;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		return strcmp(left->key, right_key);
+	case OBJ_SEARCH_PARTIAL_KEY:
+		return strncmp(left->key, right_key, strlen(right_key));
+	default:
+		ast_assert(0);
+		return 0;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Find the cached family of the given name
+ */
+static struct db_cache_family *db_cache_family_find(const char *family)
+{
+	size_t len = strlen(family);
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&cached_families); ++i) {
+		struct db_cache_family *cached = AST_VECTOR_GET(&cached_families, i);
+
+		if (cached->prefix_len == len + 2 && !strncmp(cached->prefix + 1, family, len)) {
+			return cached;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Find the cached family a full key belongs to
+ */
+static struct db_cache_family *db_cache_family_of_key(const char *fullkey)
+{
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&cached_families); ++i) {
+		struct db_cache_family *cached = AST_VECTOR_GET(&cached_families, i);
+
+		if (!strncmp(fullkey, cached->prefix, cached->prefix_len)) {
+			return cached;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Drop the entries of a cached family
+ * \note dblock and the family lock should already be locked prior to calling this method
+ */
+static void db_cache_flush(struct db_cache_family *cached)
+{
+	ao2_cleanup(cached->entries);
+	cached->entries = NULL;
+	ao2_cleanup(cached->index);
+	cached->index = NULL;
+	cache_size -= cached->size;
+	cached->size = 0;
+	cached->loaded = 0;
+}
+
+/*!
+ * \internal
+ * \brief Add or replace a key in a cached family
+ * \note dblock and the family lock should already be locked prior to calling this method
+ */
+static void db_cache_set(struct db_cache_family *cached, const char *fullkey, const char *value)
+{
+	struct db_cache_entry *entry;
+	struct db_cache_entry *old;
+	size_t key_len = strlen(fullkey) + 1;
+	size_t value_len = strlen(value) + 1;
+
+	entry = ao2_alloc_options(sizeof(*entry) + key_len + value_len, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		/* Better not to cache the family than to cache it wrong */
+		db_cache_flush(cached);
+		return;
+	}
+	memcpy(entry->key, fullkey, key_len);
+	entry->value = memcpy(entry->key + key_len, value, value_len);
+	entry->size = sizeof(*entry) + key_len + value_len + DB_CACHE_ENTRY_OVERHEAD;
+
+	old = ao2_find(cached->entries, fullkey, OBJ_SEARCH_KEY);
+	if (old) {
+		cached->size -= old->size;
+		cache_size -= old->size;
+		ao2_ref(old, -1);
+	}
+
+	if (cache_size + entry->size > (size_t) ast_option_astdb_cache_size * 1024) {
+		ast_log(LOG_WARNING, "AstDB family '%.*s' does not fit in astdb_cache_size, no longer caching it\n",
+			(int) cached->prefix_len - 2, cached->prefix + 1);
+		cached->disabled = 1;
+		db_cache_flush(cached);
+		ao2_ref(entry, -1);
+		return;
+	}
+
+	if (!ao2_link_flags(cached->entries, entry, OBJ_NOLOCK)
+		|| !ao2_link_flags(cached->index, entry, OBJ_NOLOCK)) {
+		db_cache_flush(cached);
+		ao2_ref(entry, -1);
+		return;
+	}
+	cached->size += entry->size;
+	cache_size += entry->size;
+	ao2_ref(entry, -1);
+}
+
+/*!
+ * \internal
+ * \brief Remove a key from a cached family
+ * \note dblock and the family lock should already be locked prior to calling this method
+ */
+static void db_cache_unset(struct db_cache_family *cached, const char *fullkey)
+{
+	struct db_cache_entry *entry;
+
+	entry = ao2_find(cached->entries, fullkey, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	ao2_unlink_flags(cached->index, entry, OBJ_NOLOCK);
+	cached->size -= entry->size;
+	cache_size -= entry->size;
+	ao2_ref(entry, -1);
+}
+
+/*!
+ * \internal
+ * \brief Load a cached family from the main connection
+ *
+ * \retval 0 The family is loaded
+ * \retval -1 It is not, the database has to be read instead
+ */
+static int db_cache_load(struct db_cache_family *cached)
+{
+	sqlite3_stmt *stmt = main_reader.gettree_prefix_stmt;
+	int res;
+
+	/* dblock first, as writers do, and the main connection sees every change */
+	ast_mutex_lock(&dblock);
+	ast_rwlock_wrlock(&cached->lock);
+	if (cached->loaded || cached->disabled) {
+		res = cached->loaded ? 0 : -1;
+		ast_rwlock_unlock(&cached->lock);
+		ast_mutex_unlock(&dblock);
+		return res;
+	}
+
+	cached->entries = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK,
+		AO2_CONTAINER_ALLOC_OPT_DUPS_REPLACE, DB_CACHE_BUCKETS,
+		db_cache_entry_hash_fn, NULL, db_cache_entry_cmp_fn);
+	cached->index = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_NOLOCK,
+		AO2_CONTAINER_ALLOC_OPT_DUPS_REPLACE, db_cache_entry_sort, NULL);
+	cached->loaded = 1;
+	if (!cached->entries || !cached->index) {
+		db_cache_flush(cached);
+	} else if (sqlite3_bind_text(stmt, 1, cached->prefix, cached->prefix_len, SQLITE_STATIC) != SQLITE_OK) {
+		ast_log(LOG_WARNING, "Could not bind %s to stmt: %s\n", cached->prefix, sqlite3_errmsg(astdb));
+		db_cache_flush(cached);
+	} else {
+		while (cached->loaded && sqlite3_step(stmt) == SQLITE_ROW) {
+			const char *key = (const char *) sqlite3_column_text(stmt, 0);
+			const char *value = (const char *) sqlite3_column_text(stmt, 1);
+
+			if (key && value) {
+				db_cache_set(cached, key, value);
+			}
+		}
+	}
+	sqlite3_reset(stmt);
+
+	res = cached->loaded ? 0 : -1;
+	ast_rwlock_unlock(&cached->lock);
+	ast_mutex_unlock(&dblock);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Read lock a cached family, loading it if needed
+ *
+ * \retval 0 The family is locked and loaded
+ * \retval -1 It is not cached, the database has to be read instead
+ */
+static int db_cache_rdlock(struct db_cache_family *cached)
+{
+	ast_rwlock_rdlock(&cached->lock);
+	while (!cached->loaded) {
+		ast_rwlock_unlock(&cached->lock);
+		if (db_cache_load(cached)) {
+			return -1;
+		}
+		ast_rwlock_rdlock(&cached->lock);
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Update the cache after a change to the database
+ * \note dblock should already be locked prior to calling this method
+ */
+static void db_cache_write(const char *fullkey, const char *value)
+{
+	struct db_cache_family *cached = db_cache_family_of_key(fullkey);
+
+	if (!cached) {
+		return;
+	}
+
+	ast_rwlock_wrlock(&cached->lock);
+	if (cached->loaded) {
+		if (value) {
+			db_cache_set(cached, fullkey, value);
+		} else {
+			db_cache_unset(cached, fullkey);
+		}
+	}
+	ast_rwlock_unlock(&cached->lock);
+}
+
+/*!
+ * \internal
+ * \brief Check whether keys of a cached family may start with a LIKE pattern
+ */
+static int db_cache_prefix_overlaps(struct db_cache_family *cached, const char *prefix)
+{
+	size_t i;
+
+	/* Deleting trees matches keys with LIKE, so without regard to case */
+	for (i = 0; prefix[i] && i < cached->prefix_len - 1; ++i) {
+		if (prefix[i] == '%') {
+			return 1;
+		} else if (prefix[i] != '_' && tolower(prefix[i]) != tolower(cached->prefix[i])) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*!
+ * \internal
+ * \brief Drop the cached families a change may have touched
+ *
+ * \param prefix Prefix of the keys deleted, NULL if anything may have changed
+ *
+ * \note dblock should already be locked prior to calling this method
+ */
+static void db_cache_invalidate(const char *prefix)
+{
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&cached_families); ++i) {
+		struct db_cache_family *cached = AST_VECTOR_GET(&cached_families, i);
+
+		if (!ast_strlen_zero(prefix) && !db_cache_prefix_overlaps(cached, prefix)) {
+			continue;
+		}
+
+		ast_rwlock_wrlock(&cached->lock);
+		db_cache_flush(cached);
+		ast_rwlock_unlock(&cached->lock);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Set up the families named by astdb_cached_families
+ */
+static void db_cache_init(void)
+{
+	char *families = ast_strdupa(ast_option_astdb_cached_families);
+	char *family;
+
+	if (AST_VECTOR_INIT(&cached_families, 0) || !ast_option_astdb_cache_size) {
+		return;
+	}
+
+	while ((family = ast_strip(strsep(&families, ",")))) {
+		struct db_cache_family *cached;
+		size_t len = strlen(family);
+
+		if (!len || db_cache_family_find(family)) {
+			continue;
+		}
+
+		cached = ast_calloc(1, sizeof(*cached) + len + 3);
+		if (!cached) {
+			continue;
+		}
+		ast_rwlock_init(&cached->lock);
+		cached->prefix_len = sprintf(cached->prefix, "/%s/", family);
+		if (AST_VECTOR_APPEND(&cached_families, cached)) {
+			ast_rwlock_destroy(&cached->lock);
+			ast_free(cached);
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Stop caching, the families stay allocated for readers still around
+ * \note dblock should already be locked prior to calling this method
+ */
+static void db_cache_shutdown(void)
+{
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&cached_families); ++i) {
+		struct db_cache_family *cached = AST_VECTOR_GET(&cached_families, i);
+
+		ast_rwlock_wrlock(&cached->lock);
+		db_cache_flush(cached);
+		cached->disabled = 1;
+		ast_rwlock_unlock(&cached->lock);
+	}
+}
+
 static int db_init(void)
 {
 	if (astdb) {
 		return 0;
 	}
 
-	if (db_open() || db_create_astdb() || init_statements()) {
+	if (db_open()) {
 		return -1;
 	}
 
+	if (read_connections && db_enable_wal()) {
+		read_connections = 0;
+	}
+
+	if (db_create_astdb() || init_statements()) {
+		return -1;
+	}
+
+	if (read_connections && db_readers_open()) {
+		ast_log(LOG_WARNING, "Couldn't open astdb read connections, using a single connection\n");
+	}
+
 	return 0;
 }
 
@@ -339,20 +962,11 @@ static int ast_db_rollback_transaction(void)
 	return db_execute_sql("ROLLBACK", NULL, NULL);
 }
 
-int ast_db_put(const char *family, const char *key, const char *value)
+/*! \note dblock should already be locked prior to calling this method */
+static int db_put_locked(const char *fullkey, size_t fullkey_len, const char *value)
 {
-	char fullkey[MAX_DB_FIELD];
-	size_t fullkey_len;
 	int res = 0;
 
-	if (strlen(family) + strlen(key) + 2 > sizeof(fullkey) - 1) {
-		ast_log(LOG_WARNING, "Family and key length must be less than %zu bytes\n", sizeof(fullkey) - 3);
-		return -1;
-	}
-
-	fullkey_len = snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
-
-	ast_mutex_lock(&dblock);
 	if (sqlite3_bind_text(put_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK) {
 		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(astdb));
 		res = -1;
@@ -365,12 +979,155 @@ int ast_db_put(const char *family, const char *key, const char *value)
 	}
 
 	sqlite3_reset(put_stmt);
-	db_sync();
-	ast_mutex_unlock(&dblock);
+
+	return res;
+}
+
+/*! \note dblock should already be locked prior to calling this method */
+static int db_del_locked(const char *fullkey, size_t fullkey_len)
+{
+	int res = 0;
+
+	if (sqlite3_bind_text(del_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK) {
+		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(astdb));
+		res = -1;
+	} else if (sqlite3_step(del_stmt) != SQLITE_DONE) {
+		ast_debug(1, "Unable to find key '%s'\n", fullkey);
+		res = -1;
+	}
+	sqlite3_reset(del_stmt);
+
+	return res;
+}
+
+/*! \note dblock should already be locked prior to calling this method */
+static int db_del2_locked(const char *fullkey, size_t fullkey_len)
+{
+	int mres, res = 0;
+
+	if (sqlite3_bind_text(main_reader.exists_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK
+		|| sqlite3_step(main_reader.exists_stmt) != SQLITE_ROW
+		|| !sqlite3_column_int(main_reader.exists_stmt, 0)) {
+		ast_log(LOG_WARNING, "AstDB key %s does not exist\n", fullkey);
+		res = -1;
+	} else if (sqlite3_bind_text(del_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK) {
+		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(astdb));
+		res = -1;
+	} else if ((mres = sqlite3_step(del_stmt) != SQLITE_DONE)) {
+		ast_log(LOG_WARNING, "AstDB error (%s): %s\n", fullkey, sqlite3_errstr(mres));
+		res = -1;
+	}
+	sqlite3_reset(main_reader.exists_stmt);
+	sqlite3_reset(del_stmt);
+
+	return res;
+}
+
+/*!
+ * \note dblock should already be locked prior to calling this method
+ * \return The number of keys deleted
+ */
+static int db_deltree_locked(const char *prefix)
+{
+	sqlite3_stmt *stmt = ast_strlen_zero(prefix) ? deltree_all_stmt : deltree_stmt;
+	int res;
+
+	if (!ast_strlen_zero(prefix) && (sqlite3_bind_text(stmt, 1, prefix, -1, SQLITE_STATIC) != SQLITE_OK)) {
+		ast_log(LOG_WARNING, "Couldn't bind %s to stmt: %s\n", prefix, sqlite3_errmsg(astdb));
+	} else if (sqlite3_step(stmt) != SQLITE_DONE) {
+		ast_log(LOG_WARNING, "Couldn't execute stmt: %s\n", sqlite3_errmsg(astdb));
+	}
+	res = sqlite3_changes(astdb);
+	sqlite3_reset(stmt);
+
+	return res;
+}
+
+/*! \note dblock should already be locked prior to calling this method */
+static int db_write_apply(struct db_write *write)
+{
+	int res = -1;
+
+	switch (write->type) {
+	case DB_WRITE_PUT:
+		res = db_put_locked(write->key, write->key_len, write->value);
+		if (!res) {
+			db_cache_write(write->key, write->value);
+		}
+		break;
+	case DB_WRITE_DEL:
+		res = db_del_locked(write->key, write->key_len);
+		if (!res) {
+			db_cache_write(write->key, NULL);
+		}
+		break;
+	case DB_WRITE_DEL2:
+		res = db_del2_locked(write->key, write->key_len);
+		if (!res) {
+			db_cache_write(write->key, NULL);
+		}
+		break;
+	case DB_WRITE_DELTREE:
+		res = db_deltree_locked(write->key);
+		db_cache_invalidate(write->key);
+		break;
+	}
 
 	return res;
 }
 
+/*!
+ * \internal
+ * \brief Make a change to the database
+ *
+ * In WAL mode the change is queued for the write thread, which commits the
+ * changes queued while it was busy together, and this waits for the commit
+ * so the change is seen by the read-only connections once this returns.
+ * Otherwise it is made on the main connection in the transaction the sync
+ * thread commits.
+ */
+static int db_write(struct db_write *write)
+{
+	int res;
+
+	if (!read_connections) {
+		ast_mutex_lock(&dblock);
+		res = db_write_apply(write);
+		db_sync();
+		ast_mutex_unlock(&dblock);
+		return res;
+	}
+
+	ast_mutex_lock(&write_lock);
+	if (write_exit) {
+		ast_mutex_unlock(&write_lock);
+		return -1;
+	}
+	AST_LIST_INSERT_TAIL(&write_queue, write, list);
+	ast_cond_signal(&write_cond);
+	while (!write->done) {
+		ast_cond_wait(&write_done_cond, &write_lock);
+	}
+	ast_mutex_unlock(&write_lock);
+
+	return write->res;
+}
+
+int ast_db_put(const char *family, const char *key, const char *value)
+{
+	char fullkey[MAX_DB_FIELD];
+	struct db_write write = { .type = DB_WRITE_PUT, .key = fullkey, .value = value, };
+
+	if (strlen(family) + strlen(key) + 2 > sizeof(fullkey) - 1) {
+		ast_log(LOG_WARNING, "Family and key length must be less than %zu bytes\n", sizeof(fullkey) - 3);
+		return -1;
+	}
+
+	write.key_len = snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
+
+	return db_write(&write);
+}
+
 /*!
  * \internal
  * \brief Get key value specified by family/key.
@@ -387,6 +1144,8 @@ int ast_db_put(const char *family, const char *key, const char *value)
  */
 static int db_get_common(const char *family, const char *key, char **buffer, int bufferlen)
 {
+	struct db_cache_family *cached;
+	struct db_reader *reader;
 	const unsigned char *result;
 	char fullkey[MAX_DB_FIELD];
 	size_t fullkey_len;
@@ -399,14 +1158,32 @@ static int db_get_common(const char *family, const char *key, char **buffer, int
 
 	fullkey_len = snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
 
-	ast_mutex_lock(&dblock);
-	if (sqlite3_bind_text(get_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK) {
-		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(astdb));
+	cached = db_cache_family_find(family);
+	if (cached && !db_cache_rdlock(cached)) {
+		struct db_cache_entry *entry = ao2_find(cached->entries, fullkey, OBJ_SEARCH_KEY);
+
+		if (!entry) {
+			ast_debug(1, "Unable to find key '%s' in family '%s'\n", key, family);
+			res = -1;
+		} else if (bufferlen == -1) {
+			*buffer = ast_strdup(entry->value);
+		} else {
+			ast_copy_string(*buffer, entry->value, bufferlen);
+		}
+		ast_rwlock_unlock(&cached->lock);
+		ao2_cleanup(entry);
+
+		return res;
+	}
+
+	reader = db_reader_acquire();
+	if (sqlite3_bind_text(reader->get_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK) {
+		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(reader->db));
 		res = -1;
-	} else if (sqlite3_step(get_stmt) != SQLITE_ROW) {
+	} else if (sqlite3_step(reader->get_stmt) != SQLITE_ROW) {
 		ast_debug(1, "Unable to find key '%s' in family '%s'\n", key, family);
 		res = -1;
-	} else if (!(result = sqlite3_column_text(get_stmt, 0))) {
+	} else if (!(result = sqlite3_column_text(reader->get_stmt, 0))) {
 		ast_log(LOG_WARNING, "Couldn't get value\n");
 		res = -1;
 	} else {
@@ -418,8 +1195,8 @@ static int db_get_common(const char *family, const char *key, char **buffer, int
 			ast_copy_string(*buffer, value, bufferlen);
 		}
 	}
-	sqlite3_reset(get_stmt);
-	ast_mutex_unlock(&dblock);
+	sqlite3_reset(reader->get_stmt);
+	db_reader_release(reader);
 
 	return res;
 }
@@ -443,6 +1220,8 @@ int ast_db_get_allocated(const char *family, const char *key, char **out)
 
 int ast_db_exists(const char *family, const char *key)
 {
+	struct db_cache_family *cached;
+	struct db_reader *reader;
 	int result;
 	char fullkey[MAX_DB_FIELD];
 	size_t fullkey_len;
@@ -454,20 +1233,31 @@ int ast_db_exists(const char *family, const char *key)
 		return -1;
 	}
 
-	ast_mutex_lock(&dblock);
-	res = sqlite3_bind_text(exists_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC);
+	cached = db_cache_family_find(family);
+	if (cached && !db_cache_rdlock(cached)) {
+		struct db_cache_entry *entry = ao2_find(cached->entries, fullkey, OBJ_SEARCH_KEY);
+
+		ast_rwlock_unlock(&cached->lock);
+		res = entry ? 1 : 0;
+		ao2_cleanup(entry);
+
+		return res;
+	}
+
+	reader = db_reader_acquire();
+	res = sqlite3_bind_text(reader->exists_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC);
 	if (res != SQLITE_OK) {
-		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %d:%s\n", res, sqlite3_errmsg(astdb));
+		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %d:%s\n", res, sqlite3_errmsg(reader->db));
 		res = 0;
-	} else if (sqlite3_step(exists_stmt) != SQLITE_ROW) {
+	} else if (sqlite3_step(reader->exists_stmt) != SQLITE_ROW) {
 		res = 0;
-	} else if (!(result = sqlite3_column_int(exists_stmt, 0))) {
+	} else if (!(result = sqlite3_column_int(reader->exists_stmt, 0))) {
 		res = 0;
 	} else {
 		res = result;
 	}
-	sqlite3_reset(exists_stmt);
-	ast_mutex_unlock(&dblock);
+	sqlite3_reset(reader->exists_stmt);
+	db_reader_release(reader);
 
 	return res;
 }
@@ -476,68 +1266,37 @@ int ast_db_exists(const char *family, const char *key)
 int ast_db_del(const char *family, const char *key)
 {
 	char fullkey[MAX_DB_FIELD];
-	size_t fullkey_len;
-	int res = 0;
+	struct db_write write = { .type = DB_WRITE_DEL, .key = fullkey, };
 
 	if (strlen(family) + strlen(key) + 2 > sizeof(fullkey) - 1) {
 		ast_log(LOG_WARNING, "Family and key length must be less than %zu bytes\n", sizeof(fullkey) - 3);
 		return -1;
 	}
 
-	fullkey_len = snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
-
-	ast_mutex_lock(&dblock);
-	if (sqlite3_bind_text(del_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK) {
-		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(astdb));
-		res = -1;
-	} else if (sqlite3_step(del_stmt) != SQLITE_DONE) {
-		ast_debug(1, "Unable to find key '%s' in family '%s'\n", key, family);
-		res = -1;
-	}
-	sqlite3_reset(del_stmt);
-	db_sync();
-	ast_mutex_unlock(&dblock);
+	write.key_len = snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
 
-	return res;
+	return db_write(&write);
 }
 
 int ast_db_del2(const char *family, const char *key)
 {
 	char fullkey[MAX_DB_FIELD];
-	char tmp[1];
-	size_t fullkey_len;
-	int mres, res = 0;
+	struct db_write write = { .type = DB_WRITE_DEL2, .key = fullkey, };
 
 	if (strlen(family) + strlen(key) + 2 > sizeof(fullkey) - 1) {
 		ast_log(LOG_WARNING, "Family and key length must be less than %zu bytes\n", sizeof(fullkey) - 3);
 		return -1;
 	}
 
-	fullkey_len = snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
-
-	ast_mutex_lock(&dblock);
-	if (ast_db_get(family, key, tmp, sizeof(tmp))) {
-		ast_log(LOG_WARNING, "AstDB key %s does not exist\n", fullkey);
-		res = -1;
-	} else if (sqlite3_bind_text(del_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK) {
-		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(astdb));
-		res = -1;
-	} else if ((mres = sqlite3_step(del_stmt) != SQLITE_DONE)) {
-		ast_log(LOG_WARNING, "AstDB error (%s): %s\n", fullkey, sqlite3_errstr(mres));
-		res = -1;
-	}
-	sqlite3_reset(del_stmt);
-	db_sync();
-	ast_mutex_unlock(&dblock);
+	write.key_len = snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
 
-	return res;
+	return db_write(&write);
 }
 
 int ast_db_deltree(const char *family, const char *keytree)
 {
-	sqlite3_stmt *stmt = deltree_stmt;
 	char prefix[MAX_DB_FIELD];
-	int res = 0;
+	struct db_write write = { .type = DB_WRITE_DELTREE, .key = prefix, };
 
 	if (!ast_strlen_zero(family)) {
 		if (!ast_strlen_zero(keytree)) {
@@ -549,23 +1308,28 @@ int ast_db_deltree(const char *family, const char *keytree)
 		}
 	} else {
 		prefix[0] = '\0';
-		stmt = deltree_all_stmt;
 	}
 
-	ast_mutex_lock(&dblock);
-	if (!ast_strlen_zero(prefix) && (sqlite3_bind_text(stmt, 1, prefix, -1, SQLITE_STATIC) != SQLITE_OK)) {
-		ast_log(LOG_WARNING, "Couldn't bind %s to stmt: %s\n", prefix, sqlite3_errmsg(astdb));
-		res = -1;
-	} else if (sqlite3_step(stmt) != SQLITE_DONE) {
-		ast_log(LOG_WARNING, "Couldn't execute stmt: %s\n", sqlite3_errmsg(astdb));
-		res = -1;
+	return db_write(&write);
+}
+
+static struct ast_db_entry *db_entry_alloc(const char *key, const char *value)
+{
+	struct ast_db_entry *cur;
+	size_t key_len = strlen(key);
+	size_t value_len = strlen(value);
+
+	cur = ast_malloc(sizeof(*cur) + key_len + value_len + 2);
+	if (!cur) {
+		return NULL;
 	}
-	res = sqlite3_changes(astdb);
-	sqlite3_reset(stmt);
-	db_sync();
-	ast_mutex_unlock(&dblock);
 
-	return res;
+	cur->next = NULL;
+	cur->key = cur->data + value_len + 1;
+	memcpy(cur->data, value, value_len + 1);
+	memcpy(cur->key, key, key_len + 1);
+
+	return cur;
 }
 
 static struct ast_db_entry *db_gettree_common(sqlite3_stmt *stmt)
@@ -574,7 +1338,6 @@ static struct ast_db_entry *db_gettree_common(sqlite3_stmt *stmt)
 
 	while (sqlite3_step(stmt) == SQLITE_ROW) {
 		const char *key, *value;
-		size_t key_len, value_len;
 
 		key   = (const char *) sqlite3_column_text(stmt, 0);
 		value = (const char *) sqlite3_column_text(stmt, 1);
@@ -583,19 +1346,11 @@ static struct ast_db_entry *db_gettree_common(sqlite3_stmt *stmt)
 			break;
 		}
 
-		key_len = strlen(key);
-		value_len = strlen(value);
-
-		cur = ast_malloc(sizeof(*cur) + key_len + value_len + 2);
+		cur = db_entry_alloc(key, value);
 		if (!cur) {
 			break;
 		}
 
-		cur->next = NULL;
-		cur->key = cur->data + value_len + 1;
-		memcpy(cur->data, value, value_len + 1);
-		memcpy(cur->key, key, key_len + 1);
-
 		if (prev) {
 			prev->next = cur;
 		} else {
@@ -610,7 +1365,8 @@ static struct ast_db_entry *db_gettree_common(sqlite3_stmt *stmt)
 struct ast_db_entry *ast_db_gettree(const char *family, const char *keytree)
 {
 	char prefix[MAX_DB_FIELD];
-	sqlite3_stmt *stmt = gettree_stmt;
+	struct db_reader *reader;
+	sqlite3_stmt *stmt;
 	size_t res = 0;
 	struct ast_db_entry *ret;
 
@@ -629,27 +1385,60 @@ struct ast_db_entry *ast_db_gettree(const char *family, const char *keytree)
 		}
 	} else {
 		prefix[0] = '\0';
-		stmt = gettree_all_stmt;
 	}
 
-	ast_mutex_lock(&dblock);
+	reader = db_reader_acquire();
+	stmt = res ? reader->gettree_stmt : reader->gettree_all_stmt;
 	if (res && (sqlite3_bind_text(stmt, 1, prefix, res, SQLITE_STATIC) != SQLITE_OK)) {
-		ast_log(LOG_WARNING, "Could not bind %s to stmt: %s\n", prefix, sqlite3_errmsg(astdb));
+		ast_log(LOG_WARNING, "Could not bind %s to stmt: %s\n", prefix, sqlite3_errmsg(reader->db));
 		sqlite3_reset(stmt);
-		ast_mutex_unlock(&dblock);
+		db_reader_release(reader);
 		return NULL;
 	}
 
 	ret = db_gettree_common(stmt);
 	sqlite3_reset(stmt);
-	ast_mutex_unlock(&dblock);
+	db_reader_release(reader);
 
 	return ret;
 }
 
+struct db_cache_gettree {
+	size_t prefix_len;
+	struct ast_db_entry *head;
+	struct ast_db_entry *tail;
+};
+
+static int db_cache_gettree_cb(void *obj, void *arg, void *data, int flags)
+{
+	struct db_cache_entry *entry = obj;
+	struct db_cache_gettree *tree = data;
+	struct ast_db_entry *cur;
+
+	/* Like the query, only keys longer than the prefix */
+	if (!entry->key[tree->prefix_len]) {
+		return 0;
+	}
+
+	cur = db_entry_alloc(entry->key, entry->value);
+	if (!cur) {
+		return CMP_STOP;
+	}
+	if (tree->tail) {
+		tree->tail->next = cur;
+	} else {
+		tree->head = cur;
+	}
+	tree->tail = cur;
+
+	return 0;
+}
+
 struct ast_db_entry *ast_db_gettree_by_prefix(const char *family, const char *key_prefix)
 {
 	char prefix[MAX_DB_FIELD];
+	struct db_cache_family *cached;
+	struct db_reader *reader;
 	size_t res;
 	struct ast_db_entry *ret;
 
@@ -659,17 +1448,29 @@ struct ast_db_entry *ast_db_gettree_by_prefix(const char *family, const char *ke
 		return NULL;
 	}
 
-	ast_mutex_lock(&dblock);
-	if (sqlite3_bind_text(gettree_prefix_stmt, 1, prefix, res, SQLITE_STATIC) != SQLITE_OK) {
-		ast_log(LOG_WARNING, "Could not bind %s to stmt: %s\n", prefix, sqlite3_errmsg(astdb));
-		sqlite3_reset(gettree_prefix_stmt);
-		ast_mutex_unlock(&dblock);
+	cached = db_cache_family_find(family);
+	if (cached && !db_cache_rdlock(cached)) {
+		struct db_cache_gettree tree = { .prefix_len = res, };
+
+		/* The sorted index walks just the keys with the prefix, in order */
+		ao2_callback_data(cached->index, OBJ_SEARCH_PARTIAL_KEY | OBJ_MULTIPLE | OBJ_NODATA,
+			db_cache_gettree_cb, prefix, &tree);
+		ast_rwlock_unlock(&cached->lock);
+
+		return tree.head;
+	}
+
+	reader = db_reader_acquire();
+	if (sqlite3_bind_text(reader->gettree_prefix_stmt, 1, prefix, res, SQLITE_STATIC) != SQLITE_OK) {
+		ast_log(LOG_WARNING, "Could not bind %s to stmt: %s\n", prefix, sqlite3_errmsg(reader->db));
+		sqlite3_reset(reader->gettree_prefix_stmt);
+		db_reader_release(reader);
 		return NULL;
 	}
 
-	ret = db_gettree_common(gettree_prefix_stmt);
-	sqlite3_reset(gettree_prefix_stmt);
-	ast_mutex_unlock(&dblock);
+	ret = db_gettree_common(reader->gettree_prefix_stmt);
+	sqlite3_reset(reader->gettree_prefix_stmt);
+	db_reader_release(reader);
 
 	return ret;
 }
@@ -805,7 +1606,8 @@ static char *handle_cli_database_show(struct ast_cli_entry *e, int cmd, struct a
 {
 	char prefix[MAX_DB_FIELD];
 	int counter = 0;
-	sqlite3_stmt *stmt = gettree_stmt;
+	struct db_reader *reader;
+	sqlite3_stmt *stmt;
 
 	switch (cmd) {
 	case CLI_INIT:
@@ -830,17 +1632,16 @@ static char *handle_cli_database_show(struct ast_cli_entry *e, int cmd, struct a
 	} else if (a->argc == 2) {
 		/* Neither */
 		prefix[0] = '\0';
-		stmt = gettree_all_stmt;
-
 	} else {
 		return CLI_SHOWUSAGE;
 	}
 
-	ast_mutex_lock(&dblock);
+	reader = db_reader_acquire();
+	stmt = ast_strlen_zero(prefix) ? reader->gettree_all_stmt : reader->gettree_stmt;
 	if (!ast_strlen_zero(prefix) && (sqlite3_bind_text(stmt, 1, prefix, -1, SQLITE_STATIC) != SQLITE_OK)) {
-		ast_log(LOG_WARNING, "Couldn't bind %s to stmt: %s\n", prefix, sqlite3_errmsg(astdb));
+		ast_log(LOG_WARNING, "Couldn't bind %s to stmt: %s\n", prefix, sqlite3_errmsg(reader->db));
 		sqlite3_reset(stmt);
-		ast_mutex_unlock(&dblock);
+		db_reader_release(reader);
 		return NULL;
 	}
 
@@ -859,7 +1660,7 @@ static char *handle_cli_database_show(struct ast_cli_entry *e, int cmd, struct a
 	}
 
 	sqlite3_reset(stmt);
-	ast_mutex_unlock(&dblock);
+	db_reader_release(reader);
 
 	ast_cli(a->fd, "%d results found.\n", counter);
 	return CLI_SUCCESS;
@@ -868,6 +1669,7 @@ static char *handle_cli_database_show(struct ast_cli_entry *e, int cmd, struct a
 static char *handle_cli_database_showkey(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	int counter = 0;
+	struct db_reader *reader;
 
 	switch (cmd) {
 	case CLI_INIT:
@@ -884,27 +1686,27 @@ static char *handle_cli_database_showkey(struct ast_cli_entry *e, int cmd, struc
 		return CLI_SHOWUSAGE;
 	}
 
-	ast_mutex_lock(&dblock);
-	if (!ast_strlen_zero(a->argv[2]) && (sqlite3_bind_text(showkey_stmt, 1, a->argv[2], -1, SQLITE_STATIC) != SQLITE_OK)) {
-		ast_log(LOG_WARNING, "Couldn't bind %s to stmt: %s\n", a->argv[2], sqlite3_errmsg(astdb));
-		sqlite3_reset(showkey_stmt);
-		ast_mutex_unlock(&dblock);
+	reader = db_reader_acquire();
+	if (!ast_strlen_zero(a->argv[2]) && (sqlite3_bind_text(reader->showkey_stmt, 1, a->argv[2], -1, SQLITE_STATIC) != SQLITE_OK)) {
+		ast_log(LOG_WARNING, "Couldn't bind %s to stmt: %s\n", a->argv[2], sqlite3_errmsg(reader->db));
+		sqlite3_reset(reader->showkey_stmt);
+		db_reader_release(reader);
 		return NULL;
 	}
 
-	while (sqlite3_step(showkey_stmt) == SQLITE_ROW) {
+	while (sqlite3_step(reader->showkey_stmt) == SQLITE_ROW) {
 		const char *key_s, *value_s;
-		if (!(key_s = (const char *) sqlite3_column_text(showkey_stmt, 0))) {
+		if (!(key_s = (const char *) sqlite3_column_text(reader->showkey_stmt, 0))) {
 			break;
 		}
-		if (!(value_s = (const char *) sqlite3_column_text(showkey_stmt, 1))) {
+		if (!(value_s = (const char *) sqlite3_column_text(reader->showkey_stmt, 1))) {
 			break;
 		}
 		++counter;
 		ast_cli(a->fd, "%-50s: %-25s\n", key_s, value_s);
 	}
-	sqlite3_reset(showkey_stmt);
-	ast_mutex_unlock(&dblock);
+	sqlite3_reset(reader->showkey_stmt);
+	db_reader_release(reader);
 
 	ast_cli(a->fd, "%d results found.\n", counter);
 	return CLI_SUCCESS;
@@ -943,6 +1745,7 @@ static char *handle_cli_database_query(struct ast_cli_entry *e, int cmd, struct
 
 	ast_mutex_lock(&dblock);
 	db_execute_sql(a->argv[2], display_results, a);
+	db_cache_invalidate(NULL);
 	db_sync(); /* Go ahead and sync the db in case they write */
 	ast_mutex_unlock(&dblock);
 
@@ -1033,7 +1836,8 @@ static int manager_db_tree_get(struct mansession *s, const struct message *m)
 	const char *id = astman_get_header(m,"ActionID");
 	const char *family = astman_get_header(m, "Family");
 	const char *key = astman_get_header(m, "Key");
-	sqlite3_stmt *stmt = gettree_stmt;
+	struct db_reader *reader;
+	sqlite3_stmt *stmt;
 	int count = 0;
 
 	if (!ast_strlen_zero(family) && !ast_strlen_zero(key)) {
@@ -1045,7 +1849,6 @@ static int manager_db_tree_get(struct mansession *s, const struct message *m)
 	} else {
 		/* Neither */
 		prefix[0] = '\0';
-		stmt = gettree_all_stmt;
 	}
 
 	idText[0] = '\0';
@@ -1053,11 +1856,12 @@ static int manager_db_tree_get(struct mansession *s, const struct message *m)
 		snprintf(idText, sizeof(idText) ,"ActionID: %s\r\n", id);
 	}
 
-	ast_mutex_lock(&dblock);
+	reader = db_reader_acquire();
+	stmt = ast_strlen_zero(prefix) ? reader->gettree_all_stmt : reader->gettree_stmt;
 	if (!ast_strlen_zero(prefix) && (sqlite3_bind_text(stmt, 1, prefix, -1, SQLITE_STATIC) != SQLITE_OK)) {
-		ast_log(LOG_WARNING, "Couldn't bind %s to stmt: %s\n", prefix, sqlite3_errmsg(astdb));
+		ast_log(LOG_WARNING, "Couldn't bind %s to stmt: %s\n", prefix, sqlite3_errmsg(reader->db));
 		sqlite3_reset(stmt);
-		ast_mutex_unlock(&dblock);
+		db_reader_release(reader);
 		astman_send_error(s, m, "Unable to search database");
 		return 0;
 	}
@@ -1084,7 +1888,7 @@ static int manager_db_tree_get(struct mansession *s, const struct message *m)
 	}
 
 	sqlite3_reset(stmt);
-	ast_mutex_unlock(&dblock);
+	db_reader_release(reader);
 
 	astman_send_list_complete_start(s, m, "DBGetTreeComplete", count);
 	astman_send_list_complete_end(s);
@@ -1182,6 +1986,7 @@ static void *db_sync_thread(void *data)
 		dosync = 0;
 		if (ast_db_commit_transaction()) {
 			ast_db_rollback_transaction();
+			db_cache_invalidate(NULL);
 		}
 		if (doexit) {
 			ast_mutex_unlock(&dblock);
@@ -1196,6 +2001,58 @@ static void *db_sync_thread(void *data)
 	return NULL;
 }
 
+/*!
+ * \internal
+ * \brief astdb write thread
+ *
+ * Used instead of the sync thread when astdb is in WAL mode.  It commits
+ * the changes queued while it was committing the previous ones in a single
+ * transaction, so the cost of a commit is shared by all the threads writing
+ * at the same time and no change waits for a timer.
+ */
+static void *db_write_thread(void *data)
+{
+	AST_LIST_HEAD_NOLOCK(, db_write) batch = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
+	struct db_write *write;
+
+	for (;;) {
+		ast_mutex_lock(&write_lock);
+		while (AST_LIST_EMPTY(&write_queue) && !write_exit) {
+			ast_cond_wait(&write_cond, &write_lock);
+		}
+		if (AST_LIST_EMPTY(&write_queue)) {
+			ast_mutex_unlock(&write_lock);
+			break;
+		}
+		AST_LIST_APPEND_LIST(&batch, &write_queue, list);
+		ast_mutex_unlock(&write_lock);
+
+		ast_mutex_lock(&dblock);
+		ast_db_begin_transaction();
+		AST_LIST_TRAVERSE(&batch, write, list) {
+			write->res = db_write_apply(write);
+		}
+		if (ast_db_commit_transaction()) {
+			ast_db_rollback_transaction();
+			db_cache_invalidate(NULL);
+			AST_LIST_TRAVERSE(&batch, write, list) {
+				write->res = -1;
+			}
+		}
+		ast_mutex_unlock(&dblock);
+
+		ast_mutex_lock(&write_lock);
+		while ((write = AST_LIST_REMOVE_HEAD(&batch, list))) {
+			/* The writer can return as soon as this is set */
+			write->done = 1;
+		}
+		ast_cond_broadcast(&write_done_cond);
+		ast_mutex_unlock(&write_lock);
+	}
+
+	return NULL;
+}
+
 /*!
  * \internal
  * \brief Clean up resources on Asterisk shutdown
@@ -1209,15 +2066,27 @@ static void astdb_atexit(void)
 	ast_manager_unregister("DBDel");
 	ast_manager_unregister("DBDelTree");
 
-	/* Set doexit to 1 to kill thread. db_sync must be called with
-	 * mutex held. */
-	ast_mutex_lock(&dblock);
-	doexit = 1;
-	db_sync();
-	ast_mutex_unlock(&dblock);
+	if (read_connections) {
+		/* The write thread commits what is queued before exiting */
+		ast_mutex_lock(&write_lock);
+		write_exit = 1;
+		ast_cond_signal(&write_cond);
+		ast_mutex_unlock(&write_lock);
 
-	pthread_join(syncthread, NULL);
+		pthread_join(syncthread, NULL);
+		db_readers_close();
+	} else {
+		/* Set doexit to 1 to kill thread. db_sync must be called with
+		 * mutex held. */
+		ast_mutex_lock(&dblock);
+		doexit = 1;
+		db_sync();
+		ast_mutex_unlock(&dblock);
+
+		pthread_join(syncthread, NULL);
+	}
 	ast_mutex_lock(&dblock);
+	db_cache_shutdown();
 	clean_statements();
 	if (sqlite3_close(astdb) == SQLITE_OK) {
 		astdb = NULL;
@@ -1228,12 +2097,18 @@ static void astdb_atexit(void)
 int astdb_init(void)
 {
 	ast_cond_init(&dbcond, NULL);
+	ast_cond_init(&readers_cond, NULL);
+	ast_cond_init(&write_cond, NULL);
+	ast_cond_init(&write_done_cond, NULL);
 
+	read_connections = ast_option_astdb_read_connections;
+	db_cache_init();
 	if (db_init()) {
 		return -1;
 	}
 
-	if (ast_pthread_create_background(&syncthread, NULL, db_sync_thread, NULL)) {
+	if (ast_pthread_create_background(&syncthread, NULL,
+			read_connections ? db_write_thread : db_sync_thread, NULL)) {
 		return -1;
 	}
 
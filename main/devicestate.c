@@ -203,15 +203,36 @@ struct state_change {
 	char device[1];
 };
 
-/*! \brief The state change queue. State changes are queued
-	for processing by a separate thread */
-static AST_LIST_HEAD_STATIC(state_changes, state_change);
+/*! \brief The number of threads processing state changes, each for a share of the devices */
+#define DEVSTATE_CHANGE_THREADS 4
 
-/*! \brief The device state change notification thread */
-static pthread_t change_thread = AST_PTHREADT_NULL;
+/*! \brief Buckets of the changes pending on each thread */
+#define DEVSTATE_PENDING_BUCKETS 61
 
-/*! \brief Flag for the queue */
-static ast_cond_t change_pending;
+/*!
+ * \brief A device state change thread
+ *
+ * State changes are queued for processing by the thread the device hashes
+ * to, so the changes of a device are processed in order while those of
+ * different devices are processed in parallel.  A change queued for a
+ * device that already has one waiting is dropped, since the one waiting
+ * will find out the latest state.
+ */
+struct devstate_worker {
+	/*! The state change queue */
+	AST_LIST_HEAD(state_change_list, state_change) changes;
+	/*! The queued changes by device, protected by the queue lock */
+	struct ao2_container *pending;
+	/*! Flag for the queue */
+	ast_cond_t change_pending;
+	/*! The thread */
+	pthread_t thread;
+};
+
+static struct devstate_worker change_workers[DEVSTATE_CHANGE_THREADS];
+
+/*! \brief The device state change threads have been started */
+static int change_workers_started;
 static volatile int shuttingdown;
 
 struct stasis_subscription *devstate_message_sub;
@@ -468,6 +489,38 @@ static void do_state_change(const char *device, enum ast_devstate_cache cachable
 	ast_publish_device_state(device, state, cachable);
 }
 
+AO2_STRING_FIELD_HASH_FN(state_change, device);
+AO2_STRING_FIELD_CMP_FN(state_change, device);
+
+/*! \brief Queue a state change for the thread the device belongs to */
+static void queue_state_change(struct state_change *change)
+{
+	struct devstate_worker *worker;
+	struct state_change *pending;
+
+	worker = &change_workers[ast_str_hash(change->device) % DEVSTATE_CHANGE_THREADS];
+
+	AST_LIST_LOCK(&worker->changes);
+	pending = ao2_find(worker->pending, change->device, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (pending) {
+		if (pending->cachable == change->cachable) {
+			/* The change already queued covers this one */
+			AST_LIST_UNLOCK(&worker->changes);
+			ast_debug(4, "Coalesced state change for %s\n", change->device);
+			ao2_ref(pending, -1);
+			ao2_ref(change, -1);
+			return;
+		}
+		ao2_ref(pending, -1);
+	} else {
+		ao2_link_flags(worker->pending, change, OBJ_NOLOCK);
+	}
+	/* The queue takes the reference */
+	AST_LIST_INSERT_TAIL(&worker->changes, change, list);
+	ast_cond_signal(&worker->change_pending);
+	AST_LIST_UNLOCK(&worker->changes);
+}
+
 int ast_devstate_changed_literal(enum ast_device_state state, enum ast_devstate_cache cachable, const char *device)
 {
 	struct state_change *change;
@@ -490,7 +543,8 @@ int ast_devstate_changed_literal(enum ast_device_state state, enum ast_devstate_
 
 	if (state != AST_DEVICE_UNKNOWN) {
 		ast_publish_device_state(device, state, cachable);
-	} else if (change_thread == AST_PTHREADT_NULL || !(change = ast_calloc(1, sizeof(*change) + strlen(device)))) {
+	} else if (!change_workers_started
+		|| !(change = ao2_alloc_options(sizeof(*change) + strlen(device), NULL, AO2_ALLOC_OPT_LOCK_NOLOCK))) {
 		/* we could not allocate a change struct, or */
 		/* there is no background thread, so process the change now */
 		do_state_change(device, cachable);
@@ -498,10 +552,7 @@ int ast_devstate_changed_literal(enum ast_device_state state, enum ast_devstate_
 		/* queue the change */
 		strcpy(change->device, device);
 		change->cachable = cachable;
-		AST_LIST_LOCK(&state_changes);
-		AST_LIST_INSERT_TAIL(&state_changes, change, list);
-		ast_cond_signal(&change_pending);
-		AST_LIST_UNLOCK(&state_changes);
+		queue_state_change(change);
 	}
 
 	return 0;
@@ -522,22 +573,25 @@ int ast_devstate_changed(enum ast_device_state state, enum ast_devstate_cache ca
 /*! \brief Go through the dev state change queue and update changes in the dev state thread */
 static void *do_devstate_changes(void *data)
 {
+	struct devstate_worker *worker = data;
 	struct state_change *next, *current;
 
 	while (!shuttingdown) {
 		/* This basically pops off any state change entries, resets the list back to NULL, unlocks, and processes each state change */
-		AST_LIST_LOCK(&state_changes);
-		if (AST_LIST_EMPTY(&state_changes))
-			ast_cond_wait(&change_pending, &state_changes.lock);
-		next = AST_LIST_FIRST(&state_changes);
-		AST_LIST_HEAD_INIT_NOLOCK(&state_changes);
-		AST_LIST_UNLOCK(&state_changes);
+		AST_LIST_LOCK(&worker->changes);
+		if (AST_LIST_EMPTY(&worker->changes))
+			ast_cond_wait(&worker->change_pending, &worker->changes.lock);
+		next = AST_LIST_FIRST(&worker->changes);
+		AST_LIST_HEAD_INIT_NOLOCK(&worker->changes);
+		/* Changes queued from now on are processed after these */
+		ao2_callback(worker->pending, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_NOLOCK, NULL, NULL);
+		AST_LIST_UNLOCK(&worker->changes);
 
 		/* Process each state change */
 		while ((current = next)) {
 			next = AST_LIST_NEXT(current, list);
 			do_state_change(current->device, current->cachable);
-			ast_free(current);
+			ao2_ref(current, -1);
 		}
 	}
 
@@ -604,26 +658,65 @@ static void devstate_change_cb(void *data, struct stasis_subscription *sub, stru
 
 static void device_state_engine_cleanup(void)
 {
+	int i;
+
 	shuttingdown = 1;
-	AST_LIST_LOCK(&state_changes);
-	ast_cond_signal(&change_pending);
-	AST_LIST_UNLOCK(&state_changes);
+	for (i = 0; i < DEVSTATE_CHANGE_THREADS; i++) {
+		struct devstate_worker *worker = &change_workers[i];
 
-	if (change_thread != AST_PTHREADT_NULL) {
-		pthread_join(change_thread, NULL);
+		AST_LIST_LOCK(&worker->changes);
+		ast_cond_signal(&worker->change_pending);
+		AST_LIST_UNLOCK(&worker->changes);
+
+		if (worker->thread != AST_PTHREADT_NULL) {
+			pthread_join(worker->thread, NULL);
+		}
+	}
+
+	for (i = 0; i < DEVSTATE_CHANGE_THREADS; i++) {
+		struct devstate_worker *worker = &change_workers[i];
+		struct state_change *change;
+
+		while ((change = AST_LIST_REMOVE_HEAD(&worker->changes, list))) {
+			ao2_ref(change, -1);
+		}
+		ao2_cleanup(worker->pending);
+		worker->pending = NULL;
 	}
 }
 
-/*! \brief Initialize the device state engine in separate thread */
+/*! \brief Initialize the device state engine in separate threads */
 int ast_device_state_engine_init(void)
 {
-	ast_cond_init(&change_pending, NULL);
-	if (ast_pthread_create_background(&change_thread, NULL, do_devstate_changes, NULL) < 0) {
-		ast_log(LOG_ERROR, "Unable to start device state change thread.\n");
-		return -1;
+	int i;
+
+	for (i = 0; i < DEVSTATE_CHANGE_THREADS; i++) {
+		struct devstate_worker *worker = &change_workers[i];
+
+		AST_LIST_HEAD_INIT(&worker->changes);
+		ast_cond_init(&worker->change_pending, NULL);
+		worker->thread = AST_PTHREADT_NULL;
+		worker->pending = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0,
+			DEVSTATE_PENDING_BUCKETS, state_change_hash_fn, NULL, state_change_cmp_fn);
+		if (!worker->pending) {
+			ast_log(LOG_ERROR, "Unable to allocate device state change queue.\n");
+			return -1;
+		}
 	}
+
 	ast_register_cleanup(device_state_engine_cleanup);
 
+	for (i = 0; i < DEVSTATE_CHANGE_THREADS; i++) {
+		struct devstate_worker *worker = &change_workers[i];
+
+		if (ast_pthread_create_background(&worker->thread, NULL, do_devstate_changes, worker) < 0) {
+			ast_log(LOG_ERROR, "Unable to start device state change thread.\n");
+			worker->thread = AST_PTHREADT_NULL;
+			return -1;
+		}
+	}
+	change_workers_started = 1;
+
 	return 0;
 }
 
@@ -32,6 +32,7 @@
 #include <sys/time.h>
 #include <signal.h>
 
+#include "asterisk/_private.h"
 #include "asterisk/channel.h"
 #include "asterisk/utils.h"
 #include "asterisk/lock.h"
@@ -43,6 +44,8 @@
 #include "asterisk/causes.h"
 #include "asterisk/stasis_channels.h"
 #include "asterisk/max_forwards.h"
+#include "asterisk/sched.h"
+#include "asterisk/threadpool.h"
 
 /*! \brief Main dialing structure. Contains global options, channels being dialed, and more! */
 struct ast_dial {
@@ -1305,3 +1308,182 @@ void ast_dial_set_timeout(struct ast_dial *dial, int num, int timeout)
 
 	return;
 }
+
+/*! \brief A batch of calls being originated */
+struct dial_batch {
+	/*! \brief Passed to the callback */
+	void *data;
+	/*! \brief Run for each item */
+	ast_dial_batch_cb callback;
+	/*! \brief How many items the batch has */
+	size_t count;
+	/*! \brief The next item to start, only touched by the scheduler thread */
+	size_t next;
+	/*! \brief How many items to start a second */
+	unsigned int cps;
+	/*! \brief When the batch started */
+	struct timeval start;
+};
+
+/*! \brief An item of a batch to run */
+struct dial_batch_item {
+	struct dial_batch *batch;
+	size_t index;
+};
+
+/*! \brief Starts the items of batches when they are due */
+static struct ast_sched_context *dial_batch_sched;
+
+/*! \brief Runs the items of batches */
+static struct ast_threadpool *dial_batch_pool;
+
+static void dial_batch_destructor(void *obj)
+{
+	struct dial_batch *batch = obj;
+
+	ao2_cleanup(batch->data);
+}
+
+static int dial_batch_item_run(void *data)
+{
+	struct dial_batch_item *item = data;
+
+	item->batch->callback(item->batch->data, item->index);
+	ao2_ref(item->batch, -1);
+	ast_free(item);
+
+	return 0;
+}
+
+/*! \brief Hand an item of a batch to the pool, running it here if it cannot be */
+static void dial_batch_push(struct dial_batch *batch, size_t index)
+{
+	struct dial_batch_item *item;
+
+	item = ast_malloc(sizeof(*item));
+	if (item) {
+		item->batch = ao2_bump(batch);
+		item->index = index;
+		if (!ast_threadpool_push(dial_batch_pool, dial_batch_item_run, item)) {
+			return;
+		}
+		ao2_ref(batch, -1);
+		ast_free(item);
+	}
+
+	ast_log(LOG_WARNING, "Unable to queue item %zu of a dial batch, running it now\n", index);
+	batch->callback(batch->data, index);
+}
+
+/*!
+ * \brief Scheduler callback starting the items of a batch that are due
+ *
+ * \return How long until the next item is due, in milliseconds
+ * \retval 0 when every item has been started
+ */
+static int dial_batch_launch(const void *data)
+{
+	struct dial_batch *batch = (struct dial_batch *) data;
+	int64_t elapsed = ast_tvdiff_ms(ast_tvnow(), batch->start);
+	size_t due = MIN(batch->count, (size_t) (elapsed * batch->cps / 1000) + 1);
+	int64_t wait;
+
+	while (batch->next < due) {
+		dial_batch_push(batch, batch->next++);
+	}
+
+	if (batch->next == batch->count) {
+		ao2_ref(batch, -1);
+		return 0;
+	}
+
+	wait = (int64_t) batch->next * 1000 / batch->cps - elapsed;
+	return MAX(wait, 1);
+}
+
+/*! \brief Scheduler cleanup callback for batches abandoned at shutdown */
+static int dial_batch_abandon(const void *data)
+{
+	struct dial_batch *batch = (struct dial_batch *) data;
+
+	ast_log(LOG_WARNING, "Abandoning %zu of %zu items of a dial batch\n",
+		batch->count - batch->next, batch->count);
+	ao2_ref(batch, -1);
+
+	return 0;
+}
+
+int ast_dial_batch_start(void *data, size_t count, unsigned int cps, ast_dial_batch_cb callback)
+{
+	struct dial_batch *batch;
+	size_t i;
+
+	if (!count) {
+		return 0;
+	}
+
+	batch = ao2_alloc_options(sizeof(*batch), dial_batch_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!batch) {
+		return -1;
+	}
+	batch->data = ao2_bump(data);
+	batch->callback = callback;
+	batch->count = count;
+	batch->cps = cps;
+	batch->start = ast_tvnow();
+
+	if (!cps || count == 1) {
+		for (i = 0; i < count; i++) {
+			dial_batch_push(batch, i);
+		}
+		ao2_ref(batch, -1);
+		return 0;
+	}
+
+	/* The reference is passed to the scheduler */
+	if (ast_sched_add_variable(dial_batch_sched, 0, dial_batch_launch, batch, 1) < 0) {
+		ao2_ref(batch, -1);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void dial_shutdown(void)
+{
+	if (dial_batch_sched) {
+		ast_sched_clean_by_callback(dial_batch_sched, dial_batch_launch, dial_batch_abandon);
+		ast_sched_context_destroy(dial_batch_sched);
+		dial_batch_sched = NULL;
+	}
+
+	if (dial_batch_pool) {
+		ast_threadpool_shutdown(dial_batch_pool);
+		dial_batch_pool = NULL;
+	}
+}
+
+int ast_dial_init(void)
+{
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 60,
+		.auto_increment = 1,
+		.initial_size = 0,
+		.max_size = 0,
+	};
+
+	ast_register_cleanup(dial_shutdown);
+
+	dial_batch_pool = ast_threadpool_create("dial_batch", NULL, &options);
+	if (!dial_batch_pool) {
+		return -1;
+	}
+
+	dial_batch_sched = ast_sched_context_create();
+	if (!dial_batch_sched) {
+		return -1;
+	}
+
+	return ast_sched_start_thread(dial_batch_sched);
+}
@@ -0,0 +1,673 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief DNS Answer Cache
+ *
+ * Answers from resolvers that ask for it are cached for as long as their
+ * records live, and answers saying there are no records for as long as
+ * the SOA record that comes with them allows.  Queries for the same name,
+ * type and class that arrive while one is being resolved wait for its
+ * answer rather than being resolved themselves, and an answer that is
+ * still being used is resolved again shortly before it expires so that
+ * queries do not have to wait for it.
+ *
+ * Queries are given cached answers from a taskprocessor, so they complete
+ * after being started just like they would with a resolver.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/astobj2.h"
+#include "asterisk/sched.h"
+#include "asterisk/strings.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/time.h"
+#include "asterisk/utils.h"
+#include "asterisk/vector.h"
+#include "asterisk/dns_core.h"
+#include "asterisk/dns_resolver.h"
+#include "asterisk/dns_internal.h"
+
+#include <arpa/nameser.h>
+
+/*! \brief The number of buckets for cached names */
+#define DNS_CACHE_BUCKETS 257
+
+/*! \brief The longest an answer with records is cached, in seconds */
+#define DNS_CACHE_MAX_TTL 86400
+
+/*! \brief The longest an answer without records is cached, in seconds */
+#define DNS_CACHE_MAX_NEGATIVE_TTL 900
+
+/*! \brief How long an answer without records or an SOA record is cached, in seconds */
+#define DNS_CACHE_NEGATIVE_TTL 5
+
+/*! \brief Answers cached for less than this many seconds are not resolved again before they expire */
+#define DNS_CACHE_PREFETCH_MIN_TTL 10
+
+/*! \brief How often expired answers are removed, in seconds */
+#define DNS_CACHE_PURGE_INTERVAL 60
+
+/*! \brief An answer, shared by every query it is given to */
+struct dns_cache_answer {
+	/*! \brief The result, NULL if resolution failed */
+	struct ast_dns_result *result;
+	/*! \brief When the answer expires */
+	struct timeval expires;
+	/*! \brief How many seconds the answer is cached for, 0 if it is not */
+	int ttl;
+};
+
+AST_VECTOR(dns_cache_queries, struct ast_dns_query *);
+
+/*! \brief The answer to a name, type and class */
+struct dns_cache_entry {
+	/*! \brief The resolver that gives the answer */
+	struct ast_dns_resolver *resolver;
+	/*! \brief The cached answer, if there is one */
+	struct dns_cache_answer *answer;
+	/*! \brief The query resolving the answer, if one is */
+	struct ast_dns_query *lookup;
+	/*! \brief Queries waiting for the query resolving the answer */
+	struct dns_cache_queries waiting;
+	/*! \brief Queries waiting to be given the cached answer */
+	struct dns_cache_queries ready;
+	/*! \brief Resource record type */
+	int rr_type;
+	/*! \brief Resource record class */
+	int rr_class;
+	/*! \brief The name of what is being resolved */
+	char *name;
+	/*! \brief The resolver, class, type and name */
+	char key[0];
+};
+
+/*! \brief Cached answers, by resolver, class, type and name */
+static struct ao2_container *cache;
+
+/*! \brief Where cached answers are given to queries */
+static struct ast_taskprocessor *cache_tps;
+
+/*! \brief The scheduled removal of expired answers */
+static int purge_sched_id = -1;
+
+AO2_STRING_FIELD_HASH_FN(dns_cache_entry, key);
+AO2_STRING_FIELD_CMP_FN(dns_cache_entry, key);
+
+/*!
+ * \internal
+ * \brief Skip a domain name in a DNS message
+ *
+ * \return Where what follows the name starts
+ * \retval -1 if the name runs past the end of the message
+ */
+static int dns_cache_skip_name(const unsigned char *message, size_t size, size_t pos)
+{
+	while (pos < size) {
+		unsigned char len = message[pos];
+
+		if (!len) {
+			return pos + 1;
+		} else if ((len & 0xc0) == 0xc0) {
+			/* A pointer to a name elsewhere ends the name */
+			return pos + 2 <= size ? pos + 2 : -1;
+		} else if (len & 0xc0) {
+			return -1;
+		}
+		pos += len + 1;
+	}
+
+	return -1;
+}
+
+/*!
+ * \internal
+ * \brief How long an answer without records may be cached
+ *
+ * As RFC 2308 says, that is the lower of the TTL and minimum TTL of the SOA
+ * record in the authority section of the answer.
+ */
+static int dns_cache_negative_ttl(const char *answer, size_t size)
+{
+	const unsigned char *message = (const unsigned char *) answer;
+	int questions;
+	int answers;
+	int records;
+	int pos = 12;
+	int i;
+
+	if (size < 12) {
+		return DNS_CACHE_NEGATIVE_TTL;
+	}
+
+	questions = (message[4] << 8) | message[5];
+	answers = (message[6] << 8) | message[7];
+	records = answers + ((message[8] << 8) | message[9]);
+
+	while (questions--) {
+		pos = dns_cache_skip_name(message, size, pos);
+		if (pos < 0 || pos + 4 > size) {
+			return DNS_CACHE_NEGATIVE_TTL;
+		}
+		pos += 4;
+	}
+
+	for (i = 0; i < records; i++) {
+		int type;
+		int rdata;
+		unsigned int ttl;
+		unsigned int minimum;
+
+		pos = dns_cache_skip_name(message, size, pos);
+		if (pos < 0 || pos + 10 > size) {
+			return DNS_CACHE_NEGATIVE_TTL;
+		}
+
+		type = (message[pos] << 8) | message[pos + 1];
+		ttl = ((unsigned int) message[pos + 4] << 24) | (message[pos + 5] << 16)
+			| (message[pos + 6] << 8) | message[pos + 7];
+		rdata = pos + 10;
+		pos = rdata + ((message[pos + 8] << 8) | message[pos + 9]);
+		if (pos > size) {
+			return DNS_CACHE_NEGATIVE_TTL;
+		}
+
+		if (i < answers || type != T_SOA) {
+			continue;
+		}
+
+		/* The minimum TTL is the last of the serial, refresh, retry, expire and minimum */
+		rdata = dns_cache_skip_name(message, pos, rdata);
+		rdata = rdata < 0 ? -1 : dns_cache_skip_name(message, pos, rdata);
+		if (rdata < 0 || rdata + 20 > pos) {
+			return DNS_CACHE_NEGATIVE_TTL;
+		}
+		minimum = ((unsigned int) message[rdata + 16] << 24) | (message[rdata + 17] << 16)
+			| (message[rdata + 18] << 8) | message[rdata + 19];
+
+		return MIN(MIN(ttl, minimum), DNS_CACHE_MAX_NEGATIVE_TTL);
+	}
+
+	return DNS_CACHE_NEGATIVE_TTL;
+}
+
+/*!
+ * \internal
+ * \brief How long a result may be cached
+ *
+ * \retval 0 if it may not be cached
+ */
+static int dns_cache_ttl(const struct ast_dns_result *result)
+{
+	if (!result || result->bogus) {
+		return 0;
+	}
+
+	if (result->rcode == NXDOMAIN || (result->rcode == NOERROR && !ast_dns_result_get_records(result))) {
+		return dns_cache_negative_ttl(result->answer, result->answer_size);
+	} else if (result->rcode != NOERROR) {
+		/* Servers failing is not cached, they may well not be failing next time */
+		return 0;
+	}
+
+	return MIN(ast_dns_result_get_lowest_ttl(result), DNS_CACHE_MAX_TTL);
+}
+
+static void dns_cache_answer_destroy(void *obj)
+{
+	struct dns_cache_answer *answer = obj;
+
+	ast_dns_result_free(answer->result);
+}
+
+/*!
+ * \internal
+ * \brief Create an answer from the result of a query, which it takes
+ */
+static struct dns_cache_answer *dns_cache_answer_alloc(struct ast_dns_query *query)
+{
+	struct dns_cache_answer *answer;
+
+	answer = ao2_alloc_options(sizeof(*answer), dns_cache_answer_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!answer) {
+		return NULL;
+	}
+
+	answer->result = query->result;
+	query->result = NULL;
+	answer->ttl = dns_cache_ttl(answer->result);
+	answer->expires = ast_tvadd(ast_tvnow(), ast_samp2tv(answer->ttl, 1));
+
+	return answer;
+}
+
+/*!
+ * \internal
+ * \brief How many seconds an answer has left, rounded up
+ *
+ * \retval 0 if it has expired or is not cached
+ */
+static int dns_cache_answer_remaining(const struct dns_cache_answer *answer)
+{
+	int64_t ms;
+
+	if (!answer || !answer->ttl) {
+		return 0;
+	}
+
+	ms = ast_tvdiff_ms(answer->expires, ast_tvnow());
+
+	return ms > 0 ? (ms + 999) / 1000 : 0;
+}
+
+/*!
+ * \internal
+ * \brief Complete a query with an answer, as a resolver would
+ *
+ * \note This releases the reference to the query held for it.
+ */
+static void dns_cache_answer_give(struct dns_cache_answer *answer, struct ast_dns_query *query)
+{
+	const struct ast_dns_result *result = answer ? answer->result : NULL;
+	const struct ast_dns_record *record;
+	int remaining = dns_cache_answer_remaining(answer);
+
+	if (!result || ast_dns_resolver_set_result(query, result->secure, result->bogus, result->rcode,
+		result->canonical, result->answer, result->answer_size)) {
+		query->callback(query);
+		ao2_ref(query, -1);
+		return;
+	}
+
+	for (record = ast_dns_result_get_records(result); record; record = ast_dns_record_get_next(record)) {
+		int ttl = record->ttl;
+
+		if (answer->ttl) {
+			/* The records live only as long as they have left in the cache */
+			ttl = MIN(ttl, MAX(remaining, 1));
+		}
+		ast_dns_resolver_add_record(query, record->rr_type, record->rr_class, ttl,
+			record->data_ptr, record->data_len);
+	}
+
+	ast_dns_resolver_completed(query);
+	ao2_ref(query, -1);
+}
+
+/*!
+ * \internal
+ * \brief Complete queries with an answer, and free the vector of them
+ */
+static void dns_cache_answer_give_all(struct dns_cache_answer *answer, struct dns_cache_queries *queries)
+{
+	size_t i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(queries); ++i) {
+		dns_cache_answer_give(answer, AST_VECTOR_GET(queries, i));
+	}
+	AST_VECTOR_FREE(queries);
+}
+
+static void dns_cache_entry_destroy(void *obj)
+{
+	struct dns_cache_entry *entry = obj;
+
+	ao2_cleanup(entry->answer);
+	ao2_cleanup(entry->lookup);
+	AST_VECTOR_CALLBACK_VOID(&entry->waiting, ao2_ref, -1);
+	AST_VECTOR_FREE(&entry->waiting);
+	AST_VECTOR_CALLBACK_VOID(&entry->ready, ao2_ref, -1);
+	AST_VECTOR_FREE(&entry->ready);
+}
+
+/*!
+ * \internal
+ * \brief Build the key of the answer to a query
+ *
+ * \retval 0 success
+ * \retval -1 if the key does not fit
+ */
+static int dns_cache_key(char *key, size_t size, const struct ast_dns_query *query)
+{
+	int len = snprintf(key, size, "%s|%d|%d|%s", query->resolver->name, query->rr_class,
+		query->rr_type, query->name);
+
+	if (len < 0 || len >= size) {
+		return -1;
+	}
+
+	/* Names are not case sensitive */
+	ast_str_to_lower(key);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Find the answer to a query, creating it if there is none
+ */
+static struct dns_cache_entry *dns_cache_entry_get(const struct ast_dns_query *query, const char *key)
+{
+	struct dns_cache_entry *entry;
+
+	ao2_lock(cache);
+	entry = ao2_find(cache, key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!entry) {
+		entry = ao2_alloc(sizeof(*entry) + strlen(key) + 1 + strlen(query->name) + 1,
+			dns_cache_entry_destroy);
+		if (entry) {
+			entry->resolver = query->resolver;
+			entry->rr_type = query->rr_type;
+			entry->rr_class = query->rr_class;
+			AST_VECTOR_INIT(&entry->waiting, 0);
+			AST_VECTOR_INIT(&entry->ready, 0);
+			strcpy(entry->key, key); /* SAFE */
+			entry->name = entry->key + strlen(key) + 1;
+			strcpy(entry->name, query->name); /* SAFE */
+			ao2_link_flags(cache, entry, OBJ_NOLOCK);
+		}
+	}
+	ao2_unlock(cache);
+
+	return entry;
+}
+
+static void dns_cache_lookup_callback(const struct ast_dns_query *query);
+
+/*!
+ * \internal
+ * \brief Create the query that resolves an answer
+ *
+ * \pre The entry is locked
+ *
+ * \return The query, to start with dns_cache_lookup_start() once the entry is unlocked
+ */
+static struct ast_dns_query *dns_cache_lookup_alloc(struct dns_cache_entry *entry)
+{
+	struct ast_dns_query *lookup;
+
+	lookup = dns_query_alloc(entry->name, entry->rr_type, entry->rr_class, dns_cache_lookup_callback, entry);
+	if (!lookup) {
+		return NULL;
+	}
+
+	/* The answer is cached for one resolver, even if another has been registered since */
+	lookup->resolver = entry->resolver;
+	entry->lookup = ao2_bump(lookup);
+
+	return lookup;
+}
+
+/*!
+ * \internal
+ * \brief Start the query that resolves an answer
+ *
+ * If the resolver fails to start it, the queries waiting for it are
+ * completed without a result, except for the query it was started for.
+ *
+ * \param entry The answer
+ * \param lookup The query, which this releases
+ * \param query The query it was started for, NULL if it is resolving the answer again
+ *
+ * \retval 0 success
+ * \retval -1 failure
+ */
+static int dns_cache_lookup_start(struct dns_cache_entry *entry, struct ast_dns_query *lookup,
+	struct ast_dns_query *query)
+{
+	struct dns_cache_queries waiting;
+	int res = 0;
+
+	if (!lookup->resolver->resolve(lookup)) {
+		ao2_ref(lookup, -1);
+		return 0;
+	}
+
+	ao2_lock(entry);
+	if (entry->lookup == lookup) {
+		ao2_replace(entry->lookup, NULL);
+	}
+	if (query && !AST_VECTOR_REMOVE_ELEM_UNORDERED(&entry->waiting, query, AST_VECTOR_ELEM_CLEANUP_NOOP)) {
+		ao2_ref(query, -1);
+		res = -1;
+	}
+	waiting = entry->waiting;
+	AST_VECTOR_INIT(&entry->waiting, 0);
+	ao2_unlock(entry);
+
+	dns_cache_answer_give_all(NULL, &waiting);
+	ao2_ref(lookup, -1);
+
+	return res;
+}
+
+/*! \brief Called when the query resolving an answer completes */
+static void dns_cache_lookup_callback(const struct ast_dns_query *query)
+{
+	struct ast_dns_query *lookup = (struct ast_dns_query *) query;
+	struct dns_cache_entry *entry = ast_dns_query_get_data(query);
+	struct dns_cache_answer *answer;
+	struct dns_cache_queries waiting;
+
+	answer = dns_cache_answer_alloc(lookup);
+
+	ao2_lock(entry);
+	if (entry->lookup == lookup) {
+		ao2_replace(entry->lookup, NULL);
+	}
+	if (answer && answer->ttl) {
+		ao2_replace(entry->answer, answer);
+	}
+
+	/* Queries that arrive once this is unlocked have the new answer or start a new query */
+	waiting = entry->waiting;
+	AST_VECTOR_INIT(&entry->waiting, 0);
+	ao2_unlock(entry);
+
+	dns_cache_answer_give_all(answer, &waiting);
+	ao2_cleanup(answer);
+}
+
+/*! \brief Give the queries waiting for a cached answer the answer */
+static int dns_cache_ready(void *data)
+{
+	struct dns_cache_entry *entry = data;
+	struct dns_cache_answer *answer;
+	struct dns_cache_queries ready;
+
+	ao2_lock(entry);
+	answer = ao2_bump(entry->answer);
+	ready = entry->ready;
+	AST_VECTOR_INIT(&entry->ready, 0);
+	ao2_unlock(entry);
+
+	dns_cache_answer_give_all(answer, &ready);
+	ao2_cleanup(answer);
+	ao2_ref(entry, -1);
+
+	return 0;
+}
+
+int dns_cache_resolve(struct ast_dns_query *query)
+{
+	char key[512];
+	struct dns_cache_entry *entry;
+	struct ast_dns_query *lookup = NULL;
+	int remaining;
+	int res = 0;
+
+	if (!query->resolver->cache || !cache || dns_cache_key(key, sizeof(key), query)) {
+		return query->resolver->resolve(query);
+	}
+
+	entry = dns_cache_entry_get(query, key);
+	if (!entry) {
+		return query->resolver->resolve(query);
+	}
+
+	ao2_lock(entry);
+	remaining = dns_cache_answer_remaining(entry->answer);
+	if (remaining) {
+		if (AST_VECTOR_APPEND(&entry->ready, ao2_bump(query))) {
+			ao2_ref(query, -1);
+			res = -1;
+		} else if (AST_VECTOR_SIZE(&entry->ready) == 1
+			&& ast_taskprocessor_push(cache_tps, dns_cache_ready, ao2_bump(entry))) {
+			ao2_ref(entry, -1);
+			AST_VECTOR_REMOVE_UNORDERED(&entry->ready, 0);
+			ao2_ref(query, -1);
+			res = -1;
+		}
+
+		/* Resolve answers still in use again before they expire, so nothing waits for them */
+		if (!entry->lookup && entry->answer->ttl >= DNS_CACHE_PREFETCH_MIN_TTL
+			&& remaining * 10 <= entry->answer->ttl) {
+			ast_debug(3, "Resolving '%s' of class '%d' and type '%d' again, %d seconds before it expires\n",
+				entry->name, entry->rr_class, entry->rr_type, remaining);
+			lookup = dns_cache_lookup_alloc(entry);
+		}
+		ao2_unlock(entry);
+
+		if (lookup) {
+			dns_cache_lookup_start(entry, lookup, NULL);
+		}
+	} else {
+		if (AST_VECTOR_APPEND(&entry->waiting, ao2_bump(query))) {
+			ao2_ref(query, -1);
+			res = -1;
+		} else if (!entry->lookup) {
+			lookup = dns_cache_lookup_alloc(entry);
+			if (!lookup) {
+				AST_VECTOR_REMOVE_UNORDERED(&entry->waiting, AST_VECTOR_SIZE(&entry->waiting) - 1);
+				ao2_ref(query, -1);
+				res = -1;
+			}
+		}
+		ao2_unlock(entry);
+
+		if (lookup) {
+			res = dns_cache_lookup_start(entry, lookup, query);
+		}
+	}
+
+	ao2_ref(entry, -1);
+
+	return res;
+}
+
+int dns_cache_cancel(struct ast_dns_query *query)
+{
+	char key[512];
+	struct dns_cache_entry *entry;
+	int res = -1;
+
+	if (!query->resolver->cache || !cache || dns_cache_key(key, sizeof(key), query)) {
+		return query->resolver->cancel(query);
+	}
+
+	entry = ao2_find(cache, key, OBJ_SEARCH_KEY);
+	if (!entry) {
+		return -1;
+	}
+
+	/* The query resolving the answer carries on, as the answer will be cached */
+	ao2_lock(entry);
+	if (!AST_VECTOR_REMOVE_ELEM_UNORDERED(&entry->waiting, query, AST_VECTOR_ELEM_CLEANUP_NOOP)
+		|| !AST_VECTOR_REMOVE_ELEM_UNORDERED(&entry->ready, query, AST_VECTOR_ELEM_CLEANUP_NOOP)) {
+		res = 0;
+	}
+	ao2_unlock(entry);
+
+	if (!res) {
+		ao2_ref(query, -1);
+	}
+	ao2_ref(entry, -1);
+
+	return res;
+}
+
+static int dns_cache_entry_resolver_cmp(void *obj, void *arg, int flags)
+{
+	struct dns_cache_entry *entry = obj;
+
+	return entry->resolver == arg ? CMP_MATCH : 0;
+}
+
+void dns_cache_flush(struct ast_dns_resolver *resolver)
+{
+	if (!cache) {
+		return;
+	}
+
+	ao2_callback(cache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, dns_cache_entry_resolver_cmp, resolver);
+}
+
+static int dns_cache_entry_expired(void *obj, void *arg, int flags)
+{
+	struct dns_cache_entry *entry = obj;
+	int expired;
+
+	ao2_lock(entry);
+	expired = !entry->lookup && !AST_VECTOR_SIZE(&entry->waiting) && !AST_VECTOR_SIZE(&entry->ready)
+		&& !dns_cache_answer_remaining(entry->answer);
+	ao2_unlock(entry);
+
+	return expired ? CMP_MATCH : 0;
+}
+
+/*! \brief Remove the answers that have expired and nothing is waiting for */
+static int dns_cache_purge(const void *data)
+{
+	ao2_callback(cache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, dns_cache_entry_expired, NULL);
+
+	return 1;
+}
+
+void dns_cache_shutdown(void)
+{
+	AST_SCHED_DEL(ast_dns_get_sched(), purge_sched_id);
+	ao2_cleanup(cache);
+	cache = NULL;
+	cache_tps = ast_taskprocessor_unreference(cache_tps);
+}
+
+int dns_cache_init(void)
+{
+	cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, DNS_CACHE_BUCKETS,
+		dns_cache_entry_hash_fn, NULL, dns_cache_entry_cmp_fn);
+	if (!cache) {
+		return -1;
+	}
+
+	cache_tps = ast_taskprocessor_get("dns_cache", TPS_REF_DEFAULT);
+	if (!cache_tps) {
+		return -1;
+	}
+
+	purge_sched_id = ast_sched_add(ast_dns_get_sched(), DNS_CACHE_PURGE_INTERVAL * 1000,
+		dns_cache_purge, NULL);
+	if (purge_sched_id < 0) {
+		return -1;
+	}
+
+	return 0;
+}
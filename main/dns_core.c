@@ -259,7 +259,7 @@ struct ast_dns_query_active *ast_dns_resolve_async(const char *name, int rr_type
 		return NULL;
 	}
 
-	if (active->query->resolver->resolve(active->query)) {
+	if (dns_cache_resolve(active->query)) {
 		ast_log(LOG_ERROR, "Resolver '%s' returned an error when resolving '%s' of class '%d' and type '%d'\n",
 			active->query->resolver->name, name, rr_class, rr_type);
 		ao2_ref(active, -1);
@@ -271,7 +271,7 @@ struct ast_dns_query_active *ast_dns_resolve_async(const char *name, int rr_type
 
 int ast_dns_resolve_cancel(struct ast_dns_query_active *active)
 {
-	return active->query->resolver->cancel(active->query);
+	return dns_cache_cancel(active->query);
 }
 
 /*! \brief Structure used for signaling back for synchronous resolution completion */
@@ -605,6 +605,8 @@ void ast_dns_resolver_completed(struct ast_dns_query *query)
 
 static void dns_shutdown(void)
 {
+	dns_cache_shutdown();
+
 	if (sched) {
 		ast_sched_context_destroy(sched);
 		sched = NULL;
@@ -622,6 +624,10 @@ int dns_core_init(void)
 		return -1;
 	}
 
+	if (dns_cache_init()) {
+		return -1;
+	}
+
 	ast_register_cleanup(dns_shutdown);
 
 	return 0;
@@ -695,6 +701,8 @@ void ast_dns_resolver_unregister(struct ast_dns_resolver *resolver)
 	AST_RWLIST_TRAVERSE_SAFE_END;
 	AST_RWLIST_UNLOCK(&resolvers);
 
+	dns_cache_flush(resolver);
+
 	ast_verb(5, "Unregistered DNS resolver '%s'\n", resolver->name);
 }
 
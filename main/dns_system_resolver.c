@@ -63,6 +63,7 @@ struct ast_dns_resolver dns_system_resolver_base = {
 	.priority = DNS_SYSTEM_RESOLVER_PRIORITY,
 	.resolve = dns_system_resolver_resolve,
 	.cancel = dns_system_resolver_cancel,
+	.cache = 1,
 };
 
 /*!
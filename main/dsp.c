@@ -53,6 +53,8 @@
 	<support_level>core</support_level>
  ***/
 
+/* Needed for the intrinsics headers */
+#define ASTMM_LIBC ASTMM_IGNORE
 #include "asterisk.h"
 
 #include <math.h>
@@ -68,6 +70,16 @@
 #include "asterisk/options.h"
 #include "asterisk/config.h"
 #include "asterisk/test.h"
+#include "asterisk/audiohook.h"
+#include "asterisk/vector.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GOERTZEL_BANK_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GOERTZEL_BANK_NEON
+#include <arm_neon.h>
+#endif
 
 /*! Number of goertzels for progress detect */
 enum gsamp_size {
@@ -201,6 +213,15 @@ enum gsamp_thresh {
 #define BELL_MF_TWIST		4.0     /* 6dB */
 #define BELL_MF_RELATIVE_PEAK	12.6    /* 11dB */
 
+/*
+ * The energy a goertzel finds in a block is at most the block size times the
+ * energy of the block.  Blocks too quiet for any goertzel to reach the detection
+ * threshold, with a margin for the rounding of the fixed point goertzels, are
+ * not filtered at all.
+ */
+#define DTMF_GATE_ENERGY	(DTMF_THRESHOLD / (DTMF_GSIZE * 4))
+#define BELL_MF_GATE_ENERGY	(BELL_MF_THRESHOLD / (MF_GSIZE * 4))
+
 #if defined(BUSYDETECT_TONEONLY) && defined(BUSYDETECT_COMPARE_TONE_AND_SILENCE)
 #error You cant use BUSYDETECT_TONEONLY together with BUSYDETECT_COMPARE_TONE_AND_SILENCE
 #endif
@@ -262,6 +283,26 @@ typedef struct {
 	int power;
 } goertzel_result_t;
 
+/*! Number of goertzels in a bank */
+#define GOERTZEL_BANK_SIZE	8
+
+/*!
+ * \brief Goertzels fed the same samples
+ *
+ * Each goertzel is a lane of the arrays, which is what lets all of them be
+ * updated at once with vector instructions.  Every lane computes exactly
+ * what goertzel_sample() does.
+ */
+typedef struct {
+	int v2[GOERTZEL_BANK_SIZE];
+	int v3[GOERTZEL_BANK_SIZE];
+	int chunky[GOERTZEL_BANK_SIZE];
+	int fac[GOERTZEL_BANK_SIZE];
+} goertzel_bank_t;
+
+/*! Lane of the bank of a DTMF detector for a column frequency, the rows being first */
+#define DTMF_COL_LANE(col)	(DTMF_MATRIX_SIZE + (col))
+
 typedef struct
 {
 	int freq;
@@ -282,8 +323,8 @@ typedef struct
 
 typedef struct
 {
-	goertzel_state_t row_out[DTMF_MATRIX_SIZE];
-	goertzel_state_t col_out[DTMF_MATRIX_SIZE];
+	goertzel_bank_t bank;		/* Row goertzels followed by column goertzels */
+	int16_t block[DTMF_GSIZE];	/* Samples of the current block */
 	int hits;			/* How many successive hits we have seen already */
 	int misses;			/* How many successive misses we have seen already */
 	int lasthit;
@@ -295,7 +336,8 @@ typedef struct
 
 typedef struct
 {
-	goertzel_state_t tone_out[6];
+	goertzel_bank_t bank;		/* The first six lanes are the tone goertzels */
+	int16_t block[MF_GSIZE];	/* Samples of the current block */
 	int current_hit;
 	int hits[5];
 	int current_sample;
@@ -386,6 +428,146 @@ static inline void goertzel_reset(goertzel_state_t *s)
 	s->v2 = s->v3 = s->chunky = 0;
 }
 
+typedef void (*goertzel_bank_fn)(goertzel_bank_t *bank, const int16_t *amp, int samples);
+
+static void goertzel_bank_update_scalar(goertzel_bank_t *bank, const int16_t *amp, int samples)
+{
+	int i;
+	int lane;
+
+	for (i = 0; i < samples; i++) {
+		for (lane = 0; lane < GOERTZEL_BANK_SIZE; lane++) {
+			int v1 = bank->v2[lane];
+
+			bank->v2[lane] = bank->v3[lane];
+			bank->v3[lane] = (bank->fac[lane] * bank->v2[lane]) >> 15;
+			bank->v3[lane] = bank->v3[lane] - v1 + (amp[i] >> bank->chunky[lane]);
+			if (abs(bank->v3[lane]) > (1 << 15)) {
+				bank->chunky[lane]++;
+				bank->v3[lane] = bank->v3[lane] >> 1;
+				bank->v2[lane] = bank->v2[lane] >> 1;
+			}
+		}
+	}
+}
+
+#ifdef GOERTZEL_BANK_X86
+__attribute__((target("avx2")))
+static void goertzel_bank_update_avx2(goertzel_bank_t *bank, const int16_t *amp, int samples)
+{
+	__m256i v2 = _mm256_loadu_si256((const __m256i *) bank->v2);
+	__m256i v3 = _mm256_loadu_si256((const __m256i *) bank->v3);
+	__m256i chunky = _mm256_loadu_si256((const __m256i *) bank->chunky);
+	const __m256i fac = _mm256_loadu_si256((const __m256i *) bank->fac);
+	const __m256i limit = _mm256_set1_epi32(1 << 15);
+	int i;
+
+	for (i = 0; i < samples; i++) {
+		__m256i v1 = v2;
+		__m256i overflow;
+
+		v2 = v3;
+		v3 = _mm256_srai_epi32(_mm256_mullo_epi32(fac, v2), 15);
+		v3 = _mm256_add_epi32(_mm256_sub_epi32(v3, v1),
+			_mm256_srav_epi32(_mm256_set1_epi32(amp[i]), chunky));
+		overflow = _mm256_cmpgt_epi32(_mm256_abs_epi32(v3), limit);
+		if (!_mm256_testz_si256(overflow, overflow)) {
+			/* Overflowing lanes are all ones, so subtracting increments their chunky */
+			chunky = _mm256_sub_epi32(chunky, overflow);
+			v3 = _mm256_blendv_epi8(v3, _mm256_srai_epi32(v3, 1), overflow);
+			v2 = _mm256_blendv_epi8(v2, _mm256_srai_epi32(v2, 1), overflow);
+		}
+	}
+
+	_mm256_storeu_si256((__m256i *) bank->v2, v2);
+	_mm256_storeu_si256((__m256i *) bank->v3, v3);
+	_mm256_storeu_si256((__m256i *) bank->chunky, chunky);
+}
+#endif
+
+#ifdef GOERTZEL_BANK_NEON
+static void goertzel_bank_update_neon(goertzel_bank_t *bank, const int16_t *amp, int samples)
+{
+	const int32x4_t limit = vdupq_n_s32(1 << 15);
+	int lane;
+	int i;
+
+	/* The lanes are independent, so each half of the bank is run on its own */
+	for (lane = 0; lane < GOERTZEL_BANK_SIZE; lane += 4) {
+		int32x4_t v2 = vld1q_s32(bank->v2 + lane);
+		int32x4_t v3 = vld1q_s32(bank->v3 + lane);
+		int32x4_t chunky = vld1q_s32(bank->chunky + lane);
+		const int32x4_t fac = vld1q_s32(bank->fac + lane);
+
+		for (i = 0; i < samples; i++) {
+			int32x4_t v1 = v2;
+			uint32x4_t overflow;
+
+			v2 = v3;
+			v3 = vshrq_n_s32(vmulq_s32(fac, v2), 15);
+			/* Shifting left by a negative count is an arithmetic shift right */
+			v3 = vaddq_s32(vsubq_s32(v3, v1), vshlq_s32(vdupq_n_s32(amp[i]), vnegq_s32(chunky)));
+			overflow = vcgtq_s32(vabsq_s32(v3), limit);
+			chunky = vsubq_s32(chunky, vreinterpretq_s32_u32(overflow));
+			v3 = vbslq_s32(overflow, vshrq_n_s32(v3, 1), v3);
+			v2 = vbslq_s32(overflow, vshrq_n_s32(v2, 1), v2);
+		}
+
+		vst1q_s32(bank->v2 + lane, v2);
+		vst1q_s32(bank->v3 + lane, v3);
+		vst1q_s32(bank->chunky + lane, chunky);
+	}
+}
+#endif
+
+/*! Feed samples to every goertzel of a bank, using the best implementation the CPU supports */
+static goertzel_bank_fn goertzel_bank_update = goertzel_bank_update_scalar;
+static const char *goertzel_bank_name = "scalar";
+
+static inline float goertzel_bank_result(const goertzel_bank_t *bank, int lane)
+{
+	goertzel_result_t r;
+
+	r.value = (bank->v3[lane] * bank->v3[lane]) + (bank->v2[lane] * bank->v2[lane]);
+	r.value -= ((bank->v2[lane] * bank->v3[lane]) >> 15) * bank->fac[lane];
+	r.power = bank->chunky[lane] * 2;
+	return (float)r.value * (float)(1 << r.power);
+}
+
+static inline void goertzel_bank_init(goertzel_bank_t *bank, int lane, float freq, unsigned int sample_rate)
+{
+	bank->v2[lane] = bank->v3[lane] = bank->chunky[lane] = 0;
+	bank->fac[lane] = (int)(32768.0 * 2.0 * cos(2.0 * M_PI * freq / sample_rate));
+}
+
+static inline void goertzel_bank_reset(goertzel_bank_t *bank)
+{
+	memset(bank->v2, 0, sizeof(bank->v2));
+	memset(bank->v3, 0, sizeof(bank->v3));
+	memset(bank->chunky, 0, sizeof(bank->chunky));
+}
+
+static void goertzel_bank_select(void)
+{
+#ifdef GOERTZEL_BANK_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		goertzel_bank_name = "avx2";
+		goertzel_bank_update = goertzel_bank_update_avx2;
+	}
+#elif defined(GOERTZEL_BANK_NEON)
+	goertzel_bank_name = "neon";
+	goertzel_bank_update = goertzel_bank_update_neon;
+#endif
+
+	ast_debug(1, "Using %s goertzel banks\n", goertzel_bank_name);
+}
+
+const char *ast_dsp_goertzel_implementation(void)
+{
+	return goertzel_bank_name;
+}
+
 typedef struct {
 	int start;
 	int end;
@@ -418,7 +600,7 @@ struct ast_dsp {
 	struct ast_dsp_busy_pattern busy_cadence;
 	int historicnoise[DSP_HISTORY];
 	int historicsilence[DSP_HISTORY];
-	goertzel_state_t freqs[FREQ_ARRAY_SIZE];
+	goertzel_bank_t freqs;
 	int freqcount;
 	int gsamps;
 	enum gsamp_size gsamp_size;
@@ -535,8 +717,8 @@ static void ast_dtmf_detect_init(dtmf_detect_state_t *s, unsigned int sample_rat
 	int i;
 
 	for (i = 0; i < DTMF_MATRIX_SIZE; i++) {
-		goertzel_init(&s->row_out[i], dtmf_row[i], sample_rate);
-		goertzel_init(&s->col_out[i], dtmf_col[i], sample_rate);
+		goertzel_bank_init(&s->bank, i, dtmf_row[i], sample_rate);
+		goertzel_bank_init(&s->bank, DTMF_COL_LANE(i), dtmf_col[i], sample_rate);
 	}
 	s->lasthit = 0;
 	s->current_hit = 0;
@@ -550,8 +732,9 @@ static void ast_mf_detect_init(mf_detect_state_t *s, unsigned int sample_rate)
 {
 	int i;
 
+	memset(&s->bank, 0, sizeof(s->bank));
 	for (i = 0; i < 6; i++) {
-		goertzel_init(&s->tone_out[i], mf_tones[i], sample_rate);
+		goertzel_bank_init(&s->bank, i, mf_tones[i], sample_rate);
 	}
 	s->hits[0] = s->hits[1] = s->hits[2] = s->hits[3] = s->hits[4] = 0;
 	s->current_sample = 0;
@@ -719,38 +902,35 @@ static int dtmf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp
 		} else {
 			limit = samples;
 		}
-		/* The following unrolled loop takes only 35% (rough estimate) of the
-		   time of a rolled loop on the machine on which it was developed */
+		/* The goertzels only run once the block is complete and loud enough */
 		for (j = sample; j < limit; j++) {
 			samp = amp[j];
 			s->td.dtmf.energy += (int32_t) samp * (int32_t) samp;
-			/* With GCC 2.95, the following unrolled code seems to take about 35%
-			   (rough estimate) as long as a neat little 0-3 loop */
-			goertzel_sample(s->td.dtmf.row_out, samp);
-			goertzel_sample(s->td.dtmf.col_out, samp);
-			goertzel_sample(s->td.dtmf.row_out + 1, samp);
-			goertzel_sample(s->td.dtmf.col_out + 1, samp);
-			goertzel_sample(s->td.dtmf.row_out + 2, samp);
-			goertzel_sample(s->td.dtmf.col_out + 2, samp);
-			goertzel_sample(s->td.dtmf.row_out + 3, samp);
-			goertzel_sample(s->td.dtmf.col_out + 3, samp);
-			/* go up to DTMF_MATRIX_SIZE - 1 */
 		}
+		memcpy(s->td.dtmf.block + s->td.dtmf.current_sample, amp + sample,
+			(limit - sample) * sizeof(*amp));
 		s->td.dtmf.current_sample += (limit - sample);
 		if (s->td.dtmf.current_sample < DTMF_GSIZE) {
 			continue;
 		}
 		/* We are at the end of a DTMF detection block */
-		/* Find the peak row and the peak column */
-		row_energy[0] = goertzel_result(&s->td.dtmf.row_out[0]);
-		col_energy[0] = goertzel_result(&s->td.dtmf.col_out[0]);
+		if (s->td.dtmf.energy >= DTMF_GATE_ENERGY) {
+			goertzel_bank_update(&s->td.dtmf.bank, s->td.dtmf.block, DTMF_GSIZE);
+			for (i = 0; i < DTMF_MATRIX_SIZE; i++) {
+				row_energy[i] = goertzel_bank_result(&s->td.dtmf.bank, i);
+				col_energy[i] = goertzel_bank_result(&s->td.dtmf.bank, DTMF_COL_LANE(i));
+			}
+		} else {
+			/* Too quiet to be a hit */
+			memset(row_energy, 0, sizeof(row_energy));
+			memset(col_energy, 0, sizeof(col_energy));
+		}
 
+		/* Find the peak row and the peak column */
 		for (best_row = best_col = 0, i = 1; i < DTMF_MATRIX_SIZE; i++) {
-			row_energy[i] = goertzel_result(&s->td.dtmf.row_out[i]);
 			if (row_energy[i] > row_energy[best_row]) {
 				best_row = i;
 			}
-			col_energy[i] = goertzel_result(&s->td.dtmf.col_out[i]);
 			if (col_energy[i] > col_energy[best_col]) {
 				best_col = i;
 			}
@@ -881,10 +1061,7 @@ static int dtmf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp
 		}
 
 		/* Reinitialise the detector for the next block */
-		for (i = 0; i < DTMF_MATRIX_SIZE; i++) {
-			goertzel_reset(&s->td.dtmf.row_out[i]);
-			goertzel_reset(&s->td.dtmf.col_out[i]);
-		}
+		goertzel_bank_reset(&s->td.dtmf.bank);
 		s->td.dtmf.energy = 0.0;
 		s->td.dtmf.current_sample = 0;
 	}
@@ -904,6 +1081,7 @@ static int mf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp[]
 		int samples, int squelch, int relax)
 {
 	float energy[6];
+	float block_energy;
 	int best;
 	int second_best;
 	int i;
@@ -928,23 +1106,27 @@ static int mf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp[]
 		} else {
 			limit = samples;
 		}
-		/* The following unrolled loop takes only 35% (rough estimate) of the
-		   time of a rolled loop on the machine on which it was developed */
-		for (j = sample; j < limit; j++) {
-			/* With GCC 2.95, the following unrolled code seems to take about 35%
-			   (rough estimate) as long as a neat little 0-3 loop */
-			samp = amp[j];
-			goertzel_sample(s->td.mf.tone_out, samp);
-			goertzel_sample(s->td.mf.tone_out + 1, samp);
-			goertzel_sample(s->td.mf.tone_out + 2, samp);
-			goertzel_sample(s->td.mf.tone_out + 3, samp);
-			goertzel_sample(s->td.mf.tone_out + 4, samp);
-			goertzel_sample(s->td.mf.tone_out + 5, samp);
-		}
+		/* The goertzels only run once the block is complete and loud enough */
+		memcpy(s->td.mf.block + s->td.mf.current_sample, amp + sample,
+			(limit - sample) * sizeof(*amp));
 		s->td.mf.current_sample += (limit - sample);
 		if (s->td.mf.current_sample < MF_GSIZE) {
 			continue;
 		}
+		block_energy = 0.0;
+		for (j = 0; j < MF_GSIZE; j++) {
+			samp = s->td.mf.block[j];
+			block_energy += (int32_t) samp * (int32_t) samp;
+		}
+		if (block_energy >= BELL_MF_GATE_ENERGY) {
+			goertzel_bank_update(&s->td.mf.bank, s->td.mf.block, MF_GSIZE);
+			for (i = 0; i < 6; i++) {
+				energy[i] = goertzel_bank_result(&s->td.mf.bank, i);
+			}
+		} else {
+			/* Too quiet to be a hit */
+			memset(energy, 0, sizeof(energy));
+		}
 		/* We're at the end of an MF detection block.  */
 		/* Find the two highest energies. The spec says to look for
 		   two tones and two tones only. Taking this literally -ie
@@ -952,8 +1134,6 @@ static int mf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp[]
 		   well. The sinc function mess, due to rectangular windowing
 		   ensure that! Find the two highest energies and ensure they
 		   are considerably stronger than any of the others. */
-		energy[0] = goertzel_result(&s->td.mf.tone_out[0]);
-		energy[1] = goertzel_result(&s->td.mf.tone_out[1]);
 		if (energy[0] > energy[1]) {
 			best = 0;
 			second_best = 1;
@@ -963,7 +1143,6 @@ static int mf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp[]
 		}
 		/*endif*/
 		for (i = 2; i < 6; i++) {
-			energy[i] = goertzel_result(&s->td.mf.tone_out[i]);
 			if (energy[i] >= energy[best]) {
 				second_best = best;
 				best = i;
@@ -1034,9 +1213,7 @@ static int mf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp[]
 		}
 
 		/* Reinitialise the detector for the next block */
-		for (i = 0; i < 6; i++) {
-			goertzel_reset(&s->td.mf.tone_out[i]);
-		}
+		goertzel_bank_reset(&s->td.mf.bank);
 		s->td.mf.current_sample = 0;
 	}
 
@@ -1093,9 +1270,9 @@ static int __ast_dsp_call_progress(struct ast_dsp *dsp, short *s, int len)
 		for (x = 0; x < pass; x++) {
 			samp = s[x];
 			dsp->genergy += (int32_t) samp * (int32_t) samp;
-			for (y = 0; y < freqcount; y++) {
-				goertzel_sample(&dsp->freqs[y], samp);
-			}
+		}
+		if (freqcount) {
+			goertzel_bank_update(&dsp->freqs, s, pass);
 		}
 		s += pass;
 		dsp->gsamps += pass;
@@ -1103,7 +1280,7 @@ static int __ast_dsp_call_progress(struct ast_dsp *dsp, short *s, int len)
 		if (dsp->gsamps == dsp->gsamp_size) {
 			float hz[FREQ_ARRAY_SIZE];
 			for (y = 0; y < FREQ_ARRAY_SIZE; y++) {
-				hz[y] = goertzel_result(&dsp->freqs[y]);
+				hz[y] = y < freqcount ? goertzel_bank_result(&dsp->freqs, y) : 0.0;
 			}
 			switch (dsp->progmode) {
 			case PROG_MODE_NA:
@@ -1205,8 +1382,12 @@ static int __ast_dsp_call_progress(struct ast_dsp *dsp, short *s, int len)
 			}
 
 			/* Reset goertzel */
-			for (x = 0; x < 7; x++) {
-				dsp->freqs[x].v2 = dsp->freqs[x].v3 = 0.0;
+			for (x = 0; x < GOERTZEL_BANK_SIZE; x++) {
+				dsp->freqs.v2[x] = dsp->freqs.v3[x] = 0;
+				if (x >= freqcount) {
+					/* Unused lanes are fed too, keep them from scaling forever */
+					dsp->freqs.chunky[x] = 0;
+				}
 			}
 			dsp->gsamps = 0;
 			dsp->genergy = 0.0;
@@ -1230,23 +1411,36 @@ int ast_dsp_call_progress(struct ast_dsp *dsp, struct ast_frame *inf)
 	return __ast_dsp_call_progress(dsp, inf->data.ptr, inf->datalen / 2);
 }
 
-static int __ast_dsp_silence_noise(struct ast_dsp *dsp, short *s, int len, int *totalsilence, int *totalnoise, int *frames_energy)
+/*!
+ * \internal
+ * \brief Average absolute value of the samples, the energy silence is judged by
+ */
+static int dsp_energy(const short *s, int len)
 {
-	int accum;
+	int accum = 0;
 	int x;
-	int res = 0;
 
-	if (!len) {
-		return 0;
-	}
-	accum = 0;
 	for (x = 0; x < len; x++) {
 		accum += abs(s[x]);
 	}
-	accum /= len;
+	return accum / len;
+}
+
+/*!
+ * \internal
+ * \brief Update the silence and noise state with the energy of some audio
+ *
+ * \param dsp The DSP
+ * \param accum The energy of the audio
+ * \param ms The length of the audio in milliseconds
+ */
+static int dsp_silence_noise_update(struct ast_dsp *dsp, int accum, int ms, int *totalsilence, int *totalnoise, int *frames_energy)
+{
+	int res = 0;
+
 	if (accum < dsp->threshold) {
 		/* Silent */
-		dsp->totalsilence += len / (dsp->sample_rate / 1000);
+		dsp->totalsilence += ms;
 		if (dsp->totalnoise) {
 			/* Move and save history */
 			memmove(dsp->historicnoise + DSP_HISTORY - dsp->busycount, dsp->historicnoise + DSP_HISTORY - dsp->busycount + 1, dsp->busycount * sizeof(dsp->historicnoise[0]));
@@ -1260,7 +1454,7 @@ static int __ast_dsp_silence_noise(struct ast_dsp *dsp, short *s, int len, int *
 		res = 1;
 	} else {
 		/* Not silent */
-		dsp->totalnoise += len / (dsp->sample_rate / 1000);
+		dsp->totalnoise += ms;
 		if (dsp->totalsilence) {
 			int silence1 = dsp->historicsilence[DSP_HISTORY - 1];
 			int silence2 = dsp->historicsilence[DSP_HISTORY - 2];
@@ -1296,6 +1490,15 @@ static int __ast_dsp_silence_noise(struct ast_dsp *dsp, short *s, int len, int *
 	return res;
 }
 
+static int __ast_dsp_silence_noise(struct ast_dsp *dsp, short *s, int len, int *totalsilence, int *totalnoise, int *frames_energy)
+{
+	if (!len) {
+		return 0;
+	}
+	return dsp_silence_noise_update(dsp, dsp_energy(s, len), len / (dsp->sample_rate / 1000),
+		totalsilence, totalnoise, frames_energy);
+}
+
 int ast_dsp_busydetect(struct ast_dsp *dsp)
 {
 	int res = 0, x;
@@ -1495,6 +1698,206 @@ int ast_dsp_noise(struct ast_dsp *dsp, struct ast_frame *f, int *totalnoise)
 	return ast_dsp_silence_noise_with_energy(dsp, f, totalnoise, NULL, 1);
 }
 
+/*! \brief A subscriber to the shared voice activity analysis of a channel */
+struct dsp_vad_subscriber {
+	int id;
+	ast_dsp_vad_cb callback;
+	void *data;
+};
+
+/*! \brief The shared voice activity analysis of a channel */
+struct dsp_vad {
+	/*! The audiohook measuring the frames read */
+	struct ast_audiohook audiohook;
+	/*! Who gets the results */
+	AST_VECTOR(, struct dsp_vad_subscriber) subscribers;
+	/*! The last subscription identifier given out */
+	int last_id;
+};
+
+#define DSP_VAD_SUBSCRIBER_ID_CMP(elem, value) ((elem).id == (value))
+
+static void dsp_vad_destroy(void *data)
+{
+	struct dsp_vad *vad = data;
+
+	ast_audiohook_destroy(&vad->audiohook);
+	AST_VECTOR_FREE(&vad->subscribers);
+	ast_free(vad);
+}
+
+static const struct ast_datastore_info dsp_vad_datastore = {
+	.type = "dsp_vad",
+	.destroy = dsp_vad_destroy,
+};
+
+/*!
+ * \internal
+ * \brief Measure a frame read from the channel once for all subscribers
+ *
+ * \note The audio is not modified, so this always returns a 'failure'.
+ */
+static int dsp_vad_audiohook_cb(struct ast_audiohook *audiohook, struct ast_channel *chan, struct ast_frame *frame, enum ast_audiohook_direction direction)
+{
+	struct ast_datastore *datastore;
+	struct dsp_vad *vad;
+	struct ast_dsp_vad_result result;
+	int i;
+
+	if (audiohook->status == AST_AUDIOHOOK_STATUS_DONE || !frame
+		|| direction != AST_AUDIOHOOK_DIRECTION_READ
+		|| frame->frametype != AST_FRAME_VOICE) {
+		return 1;
+	}
+
+	/* Manipulate audiohooks are fed signed linear */
+	result.samples = frame->datalen / 2;
+	result.sample_rate = ast_format_get_sample_rate(frame->subclass.format);
+	if (!result.samples || result.sample_rate < 1000) {
+		return 1;
+	}
+
+	datastore = ast_channel_datastore_find(chan, &dsp_vad_datastore, NULL);
+	if (!datastore) {
+		return 1;
+	}
+	vad = datastore->data;
+
+	result.energy = dsp_energy(frame->data.ptr, result.samples);
+	for (i = 0; i < AST_VECTOR_SIZE(&vad->subscribers); i++) {
+		struct dsp_vad_subscriber *subscriber = AST_VECTOR_GET_ADDR(&vad->subscribers, i);
+
+		subscriber->callback(chan, &result, subscriber->data);
+	}
+
+	return 1;
+}
+
+int ast_dsp_vad_subscribe(struct ast_channel *chan, ast_dsp_vad_cb callback, void *data)
+{
+	struct ast_datastore *datastore;
+	struct dsp_vad *vad;
+	struct dsp_vad_subscriber subscriber = {
+		.callback = callback,
+		.data = data,
+	};
+	SCOPED_CHANNELLOCK(chan_lock, chan);
+
+	datastore = ast_channel_datastore_find(chan, &dsp_vad_datastore, NULL);
+	if (!datastore) {
+		datastore = ast_datastore_alloc(&dsp_vad_datastore, NULL);
+		if (!datastore) {
+			return -1;
+		}
+
+		vad = ast_calloc(1, sizeof(*vad));
+		if (!vad || AST_VECTOR_INIT(&vad->subscribers, 2)) {
+			ast_free(vad);
+			ast_datastore_free(datastore);
+			return -1;
+		}
+
+		ast_audiohook_init(&vad->audiohook, AST_AUDIOHOOK_TYPE_MANIPULATE,
+			"DSP_VAD", AST_AUDIOHOOK_MANIPULATE_ALL_RATES);
+		vad->audiohook.manipulate_callback = dsp_vad_audiohook_cb;
+		ast_set_flag(&vad->audiohook, AST_AUDIOHOOK_TRIGGER_READ);
+		datastore->data = vad;
+
+		if (ast_audiohook_attach(chan, &vad->audiohook)) {
+			ast_datastore_free(datastore);
+			return -1;
+		}
+		ast_channel_datastore_add(chan, datastore);
+	}
+	vad = datastore->data;
+
+	subscriber.id = ++vad->last_id;
+	if (AST_VECTOR_APPEND(&vad->subscribers, subscriber)) {
+		if (!AST_VECTOR_SIZE(&vad->subscribers)) {
+			ast_audiohook_remove(chan, &vad->audiohook);
+			ast_channel_datastore_remove(chan, datastore);
+			ast_datastore_free(datastore);
+		}
+		return -1;
+	}
+
+	return subscriber.id;
+}
+
+void ast_dsp_vad_unsubscribe(struct ast_channel *chan, int id)
+{
+	struct ast_datastore *datastore;
+	struct dsp_vad *vad;
+	SCOPED_CHANNELLOCK(chan_lock, chan);
+
+	datastore = ast_channel_datastore_find(chan, &dsp_vad_datastore, NULL);
+	if (!datastore) {
+		return;
+	}
+	vad = datastore->data;
+
+	AST_VECTOR_REMOVE_CMP_ORDERED(&vad->subscribers, id, DSP_VAD_SUBSCRIBER_ID_CMP,
+		AST_VECTOR_ELEM_CLEANUP_NOOP);
+	if (AST_VECTOR_SIZE(&vad->subscribers)) {
+		return;
+	}
+
+	ast_audiohook_remove(chan, &vad->audiohook);
+	ast_channel_datastore_remove(chan, datastore);
+	ast_datastore_free(datastore);
+}
+
+int ast_dsp_vad_silence(struct ast_dsp *dsp, const struct ast_dsp_vad_result *result, int *totalsilence)
+{
+	return dsp_silence_noise_update(dsp, result->energy, result->samples / (result->sample_rate / 1000),
+		totalsilence, NULL, NULL);
+}
+
+void ast_dsp_vad_latest_cb(struct ast_channel *chan, const struct ast_dsp_vad_result *result, void *data)
+{
+	struct ast_dsp_vad_latest *latest = data;
+
+	latest->result = *result;
+	latest->pending = 1;
+}
+
+static int dsp_silence_noise_vad(struct ast_dsp *dsp, struct ast_dsp_vad_latest *latest, struct ast_frame *f, int *total, int *frames_energy, int noise)
+{
+	const struct ast_dsp_vad_result *result = &latest->result;
+	unsigned int rate;
+	int ms;
+
+	/*
+	 * The audiohook may have seen the frame before it was translated to
+	 * the read format, so compare how much audio the two cover.  A frame
+	 * the audiohook never saw, like one replaced on the way, is measured.
+	 */
+	if (latest->pending && f && f->frametype == AST_FRAME_VOICE) {
+		latest->pending = 0;
+		rate = ast_format_get_sample_rate(f->subclass.format);
+		ms = result->samples / (result->sample_rate / 1000);
+		if (rate >= 1000 && ms == f->samples / (rate / 1000)) {
+			if (noise) {
+				return dsp_silence_noise_update(dsp, result->energy, ms, NULL, total, frames_energy);
+			} else {
+				return dsp_silence_noise_update(dsp, result->energy, ms, total, NULL, frames_energy);
+			}
+		}
+	}
+
+	return ast_dsp_silence_noise_with_energy(dsp, f, total, frames_energy, noise);
+}
+
+int ast_dsp_silence_vad(struct ast_dsp *dsp, struct ast_dsp_vad_latest *latest, struct ast_frame *f, int *totalsilence, int *frames_energy)
+{
+	return dsp_silence_noise_vad(dsp, latest, f, totalsilence, frames_energy, 0);
+}
+
+int ast_dsp_noise_vad(struct ast_dsp *dsp, struct ast_dsp_vad_latest *latest, struct ast_frame *f, int *totalnoise)
+{
+	return dsp_silence_noise_vad(dsp, latest, f, totalnoise, NULL, 1);
+}
+
 
 struct ast_frame *ast_dsp_process(struct ast_channel *chan, struct ast_dsp *dsp, struct ast_frame *af)
 {
@@ -1719,7 +2122,7 @@ static void ast_dsp_prog_reset(struct ast_dsp *dsp)
 	dsp->gsamps = 0;
 	for (x = 0; x < FREQ_ARRAY_SIZE; x++) {
 		if (modes[dsp->progmode].freqs[x]) {
-			goertzel_init(&dsp->freqs[x], (float)modes[dsp->progmode].freqs[x], dsp->sample_rate);
+			goertzel_bank_init(&dsp->freqs, x, (float)modes[dsp->progmode].freqs[x], dsp->sample_rate);
 			max = x + 1;
 		}
 	}
@@ -1809,25 +2212,18 @@ void ast_dsp_set_busy_pattern(struct ast_dsp *dsp, const struct ast_dsp_busy_pat
 
 void ast_dsp_digitreset(struct ast_dsp *dsp)
 {
-	int i;
-
 	dsp->dtmf_began = 0;
 	if (dsp->digitmode & DSP_DIGITMODE_MF) {
 		mf_detect_state_t *s = &dsp->digit_state.td.mf;
 		/* Reinitialise the detector for the next block */
-		for (i = 0; i < 6; i++) {
-			goertzel_reset(&s->tone_out[i]);
-		}
+		goertzel_bank_reset(&s->bank);
 		s->hits[4] = s->hits[3] = s->hits[2] = s->hits[1] = s->hits[0] = 0;
 		s->current_hit = 0;
 		s->current_sample = 0;
 	} else {
 		dtmf_detect_state_t *s = &dsp->digit_state.td.dtmf;
 		/* Reinitialise the detector for the next block */
-		for (i = 0; i < 4; i++) {
-			goertzel_reset(&s->row_out[i]);
-			goertzel_reset(&s->col_out[i]);
-		}
+		goertzel_bank_reset(&s->bank);
 		s->lasthit = 0;
 		s->current_hit = 0;
 		s->energy = 0.0;
@@ -1847,7 +2243,7 @@ void ast_dsp_reset(struct ast_dsp *dsp)
 	dsp->totalsilence = 0;
 	dsp->gsamps = 0;
 	for (x = 0; x < 4; x++) {
-		dsp->freqs[x].v2 = dsp->freqs[x].v3 = 0.0;
+		dsp->freqs.v2[x] = dsp->freqs.v3[x] = 0;
 	}
 	memset(dsp->historicsilence, 0, sizeof(dsp->historicsilence));
 	memset(dsp->historicnoise, 0, sizeof(dsp->historicnoise));
@@ -2444,22 +2840,91 @@ AST_TEST_DEFINE(test_dsp_dtmf_detect)
 }
 #endif
 
+#ifdef TEST_FRAMEWORK
+AST_TEST_DEFINE(test_dsp_goertzel_bank)
+{
+	static const float freqs[GOERTZEL_BANK_SIZE] = {
+		697.0, 770.0, 852.0, 941.0, 1209.0, 1336.0, 1477.0, 1633.0
+	};
+	goertzel_state_t expected[GOERTZEL_BANK_SIZE];
+	goertzel_bank_t bank;
+	int16_t amp[DTMF_GSIZE * 3];
+	int iteration;
+	int lane;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "goertzel_bank";
+		info->category = "/main/dsp/";
+		info->summary = "DSP goertzel bank unit test";
+		info->description =
+			"Tests the goertzel bank in use computes exactly what the\n"
+			"goertzels do one at a time, over quiet and loud signals.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_test_status_update(test, "Using %s goertzel banks\n", goertzel_bank_name);
+
+	for (iteration = 0; iteration < 200; ++iteration) {
+		/* From a whisper to full scale, so the goertzels have to rescale */
+		short amplitude = iteration % 4 ? 1 << (iteration % 15) : 0x7fff;
+		int samples = ast_random() % ARRAY_LEN(amp);
+
+		memset(&bank, 0, sizeof(bank));
+		for (lane = 0; lane < GOERTZEL_BANK_SIZE; lane++) {
+			goertzel_init(&expected[lane], freqs[lane], DEFAULT_SAMPLE_RATE);
+			goertzel_bank_init(&bank, lane, freqs[lane], DEFAULT_SAMPLE_RATE);
+		}
+
+		test_dual_sample_gen(amp, samples, DEFAULT_SAMPLE_RATE,
+			freqs[iteration % DTMF_MATRIX_SIZE], amplitude / 3,
+			freqs[DTMF_COL_LANE(iteration % DTMF_MATRIX_SIZE)], amplitude / 3);
+		for (i = 0; i < samples; i++) {
+			amp[i] += (short) (ast_random() % 64) - 32;
+			for (lane = 0; lane < GOERTZEL_BANK_SIZE; lane++) {
+				goertzel_sample(&expected[lane], amp[i]);
+			}
+		}
+		goertzel_bank_update(&bank, amp, samples);
+
+		for (lane = 0; lane < GOERTZEL_BANK_SIZE; lane++) {
+			if (bank.v2[lane] != expected[lane].v2 || bank.v3[lane] != expected[lane].v3
+				|| bank.chunky[lane] != expected[lane].chunky
+				|| goertzel_bank_result(&bank, lane) != goertzel_result(&expected[lane])) {
+				ast_test_status_update(test, "Goertzel %d differs after %d samples at amplitude %d\n",
+					lane, samples, amplitude);
+				return AST_TEST_FAIL;
+			}
+		}
+	}
+
+	return AST_TEST_PASS;
+}
+#endif
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(test_dsp_fax_detect);
 	AST_TEST_UNREGISTER(test_dsp_dtmf_detect);
+	AST_TEST_UNREGISTER(test_dsp_goertzel_bank);
 
 	return 0;
 }
 
 static int load_module(void)
 {
+	goertzel_bank_select();
+
 	if (_dsp_init(0)) {
 		return AST_MODULE_LOAD_FAILURE;
 	}
 
 	AST_TEST_REGISTER(test_dsp_fax_detect);
 	AST_TEST_REGISTER(test_dsp_dtmf_detect);
+	AST_TEST_REGISTER(test_dsp_goertzel_bank);
 
 	return AST_MODULE_LOAD_SUCCESS;
 }
@@ -74,6 +74,8 @@ struct ast_endpoint {
 	struct ao2_container *channel_ids;
 	/*! Forwarding subscription from an endpoint to its tech endpoint */
 	struct stasis_forward *tech_forward;
+	/*! Set when channel_ids has changed since a snapshot was last published */
+	unsigned int snapshot_stale:1;
 };
 
 AO2_STRING_FIELD_HASH_FN(ast_endpoint, id)
@@ -142,6 +144,44 @@ static void endpoint_publish_snapshot(struct ast_endpoint *endpoint)
 	stasis_publish(ast_endpoint_topic(endpoint), message);
 }
 
+/*!
+ * \internal
+ * \brief Publish a channel being added to or removed from an endpoint
+ *
+ * The endpoint's router publishes a snapshot once it gets this, which
+ * covers this change and any made since.
+ */
+static void endpoint_publish_channel_update(struct ast_endpoint *endpoint,
+	const char *channel_id, int added, int num_channels)
+{
+	struct ast_endpoint_channel_update *update;
+	struct stasis_message *message;
+	size_t id_len = strlen(endpoint->id) + 1;
+	size_t channel_id_len = strlen(channel_id) + 1;
+
+	if (!ast_endpoint_channel_update_type()) {
+		return;
+	}
+
+	update = ao2_alloc_options(sizeof(*update) + id_len + channel_id_len, NULL,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!update) {
+		return;
+	}
+	update->id = memcpy(update->data, endpoint->id, id_len);
+	update->channel_id = memcpy(update->data + id_len, channel_id, channel_id_len);
+	update->added = added;
+	update->num_channels = num_channels;
+
+	message = stasis_message_create(ast_endpoint_channel_update_type(), update);
+	ao2_ref(update, -1);
+	if (!message) {
+		return;
+	}
+	stasis_publish(ast_endpoint_topic(endpoint), message);
+	ao2_ref(message, -1);
+}
+
 static void endpoint_dtor(void *obj)
 {
 	struct ast_endpoint *endpoint = obj;
@@ -164,6 +204,8 @@ static void endpoint_dtor(void *obj)
 int ast_endpoint_add_channel(struct ast_endpoint *endpoint,
 	struct ast_channel *chan)
 {
+	int num_channels;
+
 	ast_assert(chan != NULL);
 	ast_assert(endpoint != NULL);
 	ast_assert(!ast_strlen_zero(endpoint->resource));
@@ -172,9 +214,11 @@ int ast_endpoint_add_channel(struct ast_endpoint *endpoint,
 
 	ao2_lock(endpoint);
 	ast_str_container_add(endpoint->channel_ids, ast_channel_uniqueid(chan));
+	num_channels = ao2_container_count(endpoint->channel_ids);
+	endpoint->snapshot_stale = 1;
 	ao2_unlock(endpoint);
 
-	endpoint_publish_snapshot(endpoint);
+	endpoint_publish_channel_update(endpoint, ast_channel_uniqueid(chan), 1, num_channels);
 
 	return 0;
 }
@@ -186,6 +230,7 @@ static void endpoint_cache_clear(void *data,
 {
 	struct ast_endpoint *endpoint = data;
 	struct ast_channel_snapshot_update *update = stasis_message_data(message);
+	int num_channels;
 
 	/* Only when the channel is dead do we remove it */
 	if (!ast_test_flag(&update->new_snapshot->flags, AST_FLAG_DEAD)) {
@@ -196,8 +241,34 @@ static void endpoint_cache_clear(void *data,
 
 	ao2_lock(endpoint);
 	ast_str_container_remove(endpoint->channel_ids, update->new_snapshot->base->uniqueid);
+	num_channels = ao2_container_count(endpoint->channel_ids);
+	endpoint->snapshot_stale = 1;
 	ao2_unlock(endpoint);
-	endpoint_publish_snapshot(endpoint);
+
+	endpoint_publish_channel_update(endpoint, update->new_snapshot->base->uniqueid, 0, num_channels);
+}
+
+/*! \brief Handler for channel updates, publishes a snapshot with the changes made so far */
+static void endpoint_channel_update(void *data,
+	struct stasis_subscription *sub,
+	struct stasis_message *message)
+{
+	struct ast_endpoint *endpoint = data;
+	int stale;
+
+	/*
+	 * Changes made while earlier updates waited to be routed are covered
+	 * by the one snapshot.  Any made after this point set the flag again
+	 * and have their own update still to come.
+	 */
+	ao2_lock(endpoint);
+	stale = endpoint->snapshot_stale;
+	endpoint->snapshot_stale = 0;
+	ao2_unlock(endpoint);
+
+	if (stale) {
+		endpoint_publish_snapshot(endpoint);
+	}
 }
 
 static void endpoint_subscription_change(void *data,
@@ -279,6 +350,9 @@ static struct ast_endpoint *endpoint_internal_create(const char *tech, const cha
 		r |= stasis_message_router_add(endpoint->router,
 			ast_channel_snapshot_type(), endpoint_cache_clear,
 			endpoint);
+		r |= stasis_message_router_add(endpoint->router,
+			ast_endpoint_channel_update_type(), endpoint_channel_update,
+			endpoint);
 		r |= stasis_message_router_add(endpoint->router,
 			stasis_subscription_change_type(), endpoint_subscription_change,
 			endpoint);
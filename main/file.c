@@ -31,6 +31,7 @@
 
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/wait.h>
 #include <math.h>
 
@@ -46,10 +47,12 @@
 #include "asterisk/app.h"
 #include "asterisk/pbx.h"
 #include "asterisk/linkedlists.h"
+#include "asterisk/dlinkedlists.h"
 #include "asterisk/module.h"
 #include "asterisk/astobj2.h"
 #include "asterisk/test.h"
 #include "asterisk/stasis.h"
+#include "asterisk/taskprocessor.h"
 #include "asterisk/json.h"
 #include "asterisk/stasis_system.h"
 #include "asterisk/media_cache.h"
@@ -385,6 +388,289 @@ static int type_in_list(const char *list, const char *type, int (*cmp)(const cha
 
 #define exts_compare(list, type) (type_in_list((list), (type), strcmp))
 
+/*!
+ * \brief A sound file held in memory by the prompt cache
+ *
+ * Files are kept as they are on disk, in their native format, and read by
+ * the format modules through fmemopen(), so everything a format module
+ * does with a file it also does with a cached one.
+ */
+struct prompt_cache_entry {
+	AST_DLLIST_ENTRY(prompt_cache_entry) list;
+	/*! When the file was last changed, to tell when it must be read again */
+	struct timespec mtime;
+	/*! The size of the file */
+	size_t size;
+	/*! The contents of the file */
+	char *data;
+	/*! The path of the file */
+	char path[0];
+};
+
+/*! \brief Prompt cache entries, the most recently played first; the lock guards the whole cache */
+static AST_DLLIST_HEAD_STATIC(prompt_cache_lru, prompt_cache_entry);
+/*! \brief Prompt cache entries by path */
+static struct ao2_container *prompt_cache;
+/*! \brief Bytes held by the prompt cache */
+static size_t prompt_cache_bytes;
+static unsigned int prompt_cache_hits;
+static unsigned int prompt_cache_misses;
+
+#define PROMPT_CACHE_BUCKETS 127
+
+AO2_STRING_FIELD_HASH_FN(prompt_cache_entry, path)
+AO2_STRING_FIELD_CMP_FN(prompt_cache_entry, path)
+
+static struct timespec stat_mtime(const struct stat *st)
+{
+#if defined(__APPLE__)
+	return st->st_mtimespec;
+#else
+	return st->st_mtim;
+#endif
+}
+
+/*!
+ * \internal
+ * \brief Take an entry out of the prompt cache
+ *
+ * \pre prompt_cache_lru is locked
+ */
+static void prompt_cache_remove(struct prompt_cache_entry *entry)
+{
+	AST_DLLIST_REMOVE(&prompt_cache_lru, entry, list);
+	prompt_cache_bytes -= entry->size;
+	ao2_unlink_flags(prompt_cache, entry, OBJ_NOLOCK);
+}
+
+/*!
+ * \internal
+ * \brief Read a file into a new prompt cache entry
+ */
+static struct prompt_cache_entry *prompt_cache_load(const char *fn, const struct stat *st)
+{
+	struct prompt_cache_entry *entry;
+	size_t path_len = strlen(fn) + 1;
+	FILE *bfile;
+	int res;
+
+	entry = ao2_alloc_options(sizeof(*entry) + path_len + st->st_size, NULL,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return NULL;
+	}
+	entry->mtime = stat_mtime(st);
+	entry->size = st->st_size;
+	strcpy(entry->path, fn); /* Safe */
+	entry->data = entry->path + path_len;
+
+	bfile = fopen(fn, "r");
+	if (!bfile) {
+		ao2_ref(entry, -1);
+		return NULL;
+	}
+	res = fread(entry->data, 1, entry->size, bfile) != entry->size;
+	fclose(bfile);
+	if (res) {
+		/* Changed while we read it */
+		ao2_ref(entry, -1);
+		return NULL;
+	}
+
+	return entry;
+}
+
+/*!
+ * \internal
+ * \brief Open a sound file for reading, from the prompt cache if it can be
+ *
+ * \param fn The path of the file
+ * \param st What stat() said about the file
+ * \param cached Set to the prompt cache entry the file is read from, which
+ *        must be kept until the file is closed, or NULL
+ *
+ * \return The open file, or NULL
+ */
+static FILE *prompt_cache_open(const char *fn, const struct stat *st, struct prompt_cache_entry **cached)
+{
+	size_t limit = (size_t) ast_option_prompt_cache_size * 1024;
+	struct prompt_cache_entry *entry;
+	struct timespec mtime = stat_mtime(st);
+	FILE *bfile;
+
+	*cached = NULL;
+
+	/* A file larger than a quarter of the cache would push out too much else */
+	if (!limit || !prompt_cache || !st->st_size || st->st_size > limit / 4) {
+		return fopen(fn, "r");
+	}
+
+	AST_DLLIST_LOCK(&prompt_cache_lru);
+	entry = ao2_find(prompt_cache, fn, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (entry && (entry->size != st->st_size
+		|| entry->mtime.tv_sec != mtime.tv_sec || entry->mtime.tv_nsec != mtime.tv_nsec)) {
+		prompt_cache_remove(entry);
+		ao2_ref(entry, -1);
+		entry = NULL;
+	}
+	if (entry) {
+		AST_DLLIST_REMOVE(&prompt_cache_lru, entry, list);
+		AST_DLLIST_INSERT_HEAD(&prompt_cache_lru, entry, list);
+		++prompt_cache_hits;
+	} else {
+		++prompt_cache_misses;
+	}
+	AST_DLLIST_UNLOCK(&prompt_cache_lru);
+
+	if (!entry) {
+		struct prompt_cache_entry *found;
+
+		entry = prompt_cache_load(fn, st);
+		if (!entry) {
+			return fopen(fn, "r");
+		}
+
+		AST_DLLIST_LOCK(&prompt_cache_lru);
+		found = ao2_find(prompt_cache, fn, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+		if (found) {
+			/* Another channel read it at the same time */
+			ao2_ref(found, -1);
+		} else if (!ao2_link_flags(prompt_cache, entry, OBJ_NOLOCK)) {
+			AST_DLLIST_UNLOCK(&prompt_cache_lru);
+			ao2_ref(entry, -1);
+			return fopen(fn, "r");
+		} else {
+			AST_DLLIST_INSERT_HEAD(&prompt_cache_lru, entry, list);
+			prompt_cache_bytes += entry->size;
+			while (prompt_cache_bytes > limit) {
+				struct prompt_cache_entry *oldest = AST_DLLIST_LAST(&prompt_cache_lru);
+
+				prompt_cache_remove(oldest);
+			}
+		}
+		AST_DLLIST_UNLOCK(&prompt_cache_lru);
+	}
+
+	bfile = fmemopen(entry->data, entry->size, "r");
+	if (!bfile) {
+		ao2_ref(entry, -1);
+		return fopen(fn, "r");
+	}
+
+	*cached = entry;
+	return bfile;
+}
+
+/*!
+ * \internal
+ * \brief Map the file of a stream opened for reading into memory, if its format allows
+ *
+ * Files from the prompt cache are read from the cache's copy.  Others are
+ * mapped only with map_sound_files enabled, since a mapped file that is
+ * truncated while it plays faults when read.
+ */
+static void filestream_map(struct ast_filestream *s)
+{
+	struct stat st;
+	off_t pos;
+	void *map;
+	int fd;
+
+	if (!s->fmt->mappable || (pos = ftello(s->f)) < 0) {
+		return;
+	}
+
+	if (s->cached) {
+		struct prompt_cache_entry *entry = s->cached;
+
+		s->map = entry->data;
+		s->map_size = entry->size;
+		s->map_pos = pos;
+		return;
+	}
+
+	if (!ast_option_map_sound_files || (fd = fileno(s->f)) < 0 || fstat(fd, &st)
+		|| !S_ISREG(st.st_mode) || !st.st_size) {
+		return;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		ast_debug(1, "Unable to map %s: %s\n", s->fmt->name, strerror(errno));
+		return;
+	}
+	s->map = map;
+	s->map_size = st.st_size;
+	s->map_pos = pos;
+}
+
+size_t ast_filestream_read(struct ast_filestream *fs, size_t len)
+{
+	size_t res;
+
+	if (!fs->map) {
+		AST_FRAME_SET_BUFFER(&fs->fr, fs->buf, AST_FRIENDLY_OFFSET, len);
+		res = fread(fs->fr.data.ptr, 1, len, fs->f);
+		fs->fr.datalen = res;
+		return res;
+	}
+
+	res = fs->map_pos < fs->map_size ? MIN(len, fs->map_size - fs->map_pos) : 0;
+	fs->fr.data.ptr = (char *) fs->map + fs->map_pos;
+	fs->fr.offset = 0;
+	fs->fr.datalen = res;
+	fs->map_pos += res;
+
+	return res;
+}
+
+off_t ast_filestream_tell_bytes(struct ast_filestream *fs)
+{
+	return fs->map ? fs->map_pos : ftello(fs->f);
+}
+
+int ast_filestream_seek_bytes(struct ast_filestream *fs, off_t offset, int whence)
+{
+	if (!fs->map) {
+		return fseeko(fs->f, offset, whence);
+	}
+
+	switch (whence) {
+	case SEEK_SET:
+		break;
+	case SEEK_CUR:
+		offset += fs->map_pos;
+		break;
+	case SEEK_END:
+		offset += fs->map_size;
+		break;
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+	if (offset < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	fs->map_pos = offset;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Empty the prompt cache
+ */
+static void prompt_cache_flush(void)
+{
+	struct prompt_cache_entry *entry;
+
+	AST_DLLIST_LOCK(&prompt_cache_lru);
+	while ((entry = AST_DLLIST_FIRST(&prompt_cache_lru))) {
+		prompt_cache_remove(entry);
+	}
+	AST_DLLIST_UNLOCK(&prompt_cache_lru);
+}
+
 /*!
  * \internal
  * \brief Close the file stream by canceling any pending read / write callbacks
@@ -433,9 +719,13 @@ static void filestream_destructor(void *arg)
 		closefn(f);
 	}
 
+	if (f->map && !f->cached) {
+		munmap((void *) f->map, f->map_size);
+	}
 	if (f->f) {
 		fclose(f->f);
 	}
+	ao2_cleanup(f->cached);
 
 	if (f->realfilename && f->filename) {
 		pid = ast_safe_fork(0);
@@ -585,6 +875,7 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 				struct ast_channel *chan = (struct ast_channel *)arg2;
 				FILE *bfile;
 				struct ast_filestream *s;
+				struct prompt_cache_entry *cached;
 
 				if ((ast_format_cmp(ast_channel_writeformat(chan), f->format) == AST_FORMAT_CMP_NOT_EQUAL) &&
 				     !(((ast_format_get_type(f->format) == AST_MEDIA_TYPE_AUDIO) && fmt) ||
@@ -592,21 +883,24 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 					ast_free(fn);
 					continue;	/* not a supported format */
 				}
-				if ( (bfile = fopen(fn, "r")) == NULL) {
+				if ( (bfile = prompt_cache_open(fn, &st, &cached)) == NULL) {
 					ast_free(fn);
 					continue;	/* cannot open file */
 				}
 				s = get_filestream(f, bfile);
 				if (!s) {
 					fclose(bfile);
+					ao2_cleanup(cached);
 					ast_free(fn);	/* cannot allocate descriptor */
 					continue;
 				}
+				s->cached = cached;
 				if (open_wrapper(s)) {
 					ast_free(fn);
 					ast_closestream(s);
 					continue;	/* cannot run open on file */
 				}
+				filestream_map(s);
 				if (st.st_size == 0) {
 					ast_log(LOG_WARNING, "File %s detected to have zero size.\n", fn);
 				}
@@ -682,6 +976,156 @@ static int is_remote_path(const char *filename)
 	return strstr(filename, "://") ? 1 : 0;
 }
 
+/*! \brief Sound files and formats the prompt compiler was asked for, so each is made once */
+static struct ao2_container *prompt_compile_requested;
+static struct ast_taskprocessor *prompt_compile_tps;
+
+#define PROMPT_COMPILE_BUCKETS 127
+
+/*! \brief A sound file for the prompt compiler to encode in another format */
+struct prompt_compile_job {
+	/*! The extension of the file to read */
+	char *src_ext;
+	/*! The extension of the file to write */
+	char *dst_ext;
+	/*! The name of the sound file, without extension */
+	char name[0];
+};
+
+/*!
+ * \internal
+ * \brief Encode a sound file in another format, next to the original
+ *
+ * The file is written under a temporary name and renamed once complete, so
+ * a channel never opens a partly written file.
+ */
+static int prompt_compile(void *data)
+{
+	struct prompt_compile_job *job = data;
+	struct ast_filestream *rs = NULL;
+	struct ast_filestream *ws = NULL;
+	struct ast_frame *fr;
+	char *tmp_name = NULL;
+	char *tmp_fn = NULL;
+	char *fn;
+	int res = -1;
+
+	fn = build_filename(job->name, job->dst_ext);
+	if (!fn || !access(fn, F_OK)) {
+		/* Made while the job was queued */
+		goto cleanup;
+	}
+	if (ast_asprintf(&tmp_name, "%s.compiling", job->name) < 0
+		|| !(tmp_fn = build_filename(tmp_name, job->dst_ext))) {
+		goto cleanup;
+	}
+
+	rs = ast_readfile(job->name, job->src_ext, NULL, O_RDONLY, 0, 0);
+	if (!rs) {
+		goto cleanup;
+	}
+	ws = ast_writefile(tmp_name, job->dst_ext, NULL, O_WRONLY, 0, AST_FILE_MODE);
+	if (!ws) {
+		ast_debug(1, "Unable to write %s, not compiling %s\n", tmp_fn, fn);
+		goto cleanup;
+	}
+
+	res = 0;
+	while (!res && (fr = ast_readframe(rs))) {
+		res = ast_writestream(ws, fr);
+		ast_frfree(fr);
+	}
+	ast_closestream(ws);
+	ws = NULL;
+
+	if (!res && !rename(tmp_fn, fn)) {
+		ast_verb(4, "Compiled prompt %s\n", fn);
+	} else {
+		ast_log(LOG_WARNING, "Unable to compile prompt %s\n", fn);
+		unlink(tmp_fn);
+	}
+
+cleanup:
+	if (rs) {
+		ast_closestream(rs);
+	}
+	if (ws) {
+		ast_closestream(ws);
+	}
+	ast_free(tmp_fn);
+	ast_free(tmp_name);
+	ast_free(fn);
+	ast_free(job);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Have the prompt compiler encode a sound file in the format a channel uses
+ *
+ * \param name The sound file, without extension, relative to the sounds directory
+ * \param src The format of the file being played
+ * \param dst The format the channel writes, which the file is translated to
+ */
+static void prompt_compile_queue(const char *name, const struct ast_format_def *src, struct ast_format *dst)
+{
+	struct ast_format_def *f;
+	struct prompt_compile_job *job;
+	const char *dst_exts = NULL;
+	size_t name_len = strlen(name) + 1;
+	size_t src_len = strcspn(src->exts, "|") + 1;
+	size_t dst_len;
+	char *key;
+	char *found;
+	int res = 0;
+
+	if (!prompt_compile_tps
+		|| ast_asprintf(&key, "%s|%s", name, ast_format_get_name(dst)) < 0) {
+		return;
+	}
+	ao2_lock(prompt_compile_requested);
+	found = ao2_find(prompt_compile_requested, key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!found) {
+		res = ast_str_container_add(prompt_compile_requested, key);
+	}
+	ao2_unlock(prompt_compile_requested);
+	ast_free(key);
+	if (found || res) {
+		ao2_cleanup(found);
+		return;
+	}
+
+	AST_RWLIST_RDLOCK(&formats);
+	AST_RWLIST_TRAVERSE(&formats, f, list) {
+		if (f->write && ast_format_cmp(f->format, dst) == AST_FORMAT_CMP_EQUAL) {
+			dst_exts = f->exts;
+			break;
+		}
+	}
+	if (!dst_exts) {
+		/* No format module can write it */
+		AST_RWLIST_UNLOCK(&formats);
+		return;
+	}
+	dst_len = strcspn(dst_exts, "|") + 1;
+
+	job = ast_malloc(sizeof(*job) + name_len + src_len + dst_len);
+	if (!job) {
+		AST_RWLIST_UNLOCK(&formats);
+		return;
+	}
+	strcpy(job->name, name); /* Safe */
+	job->src_ext = job->name + name_len;
+	ast_copy_string(job->src_ext, src->exts, src_len);
+	job->dst_ext = job->src_ext + src_len;
+	ast_copy_string(job->dst_ext, dst_exts, dst_len);
+	AST_RWLIST_UNLOCK(&formats);
+
+	if (ast_taskprocessor_push(prompt_compile_tps, prompt_compile, job)) {
+		ast_free(job);
+	}
+}
+
 /*!
  * \brief test if a file exists for a given format.
  * \note result_cap is OPTIONAL
@@ -840,9 +1284,25 @@ struct ast_filestream *ast_openstream_full(struct ast_channel *chan,
 		return NULL;
 	}
 	res = filehelper(buf, chan, NULL, ACTION_OPEN);
-	if (res >= 0)
-		return ast_channel_stream(chan);
-	return NULL;
+	if (res < 0) {
+		return NULL;
+	}
+
+	if (ast_option_prompt_compile && !is_absolute_path(buf) && !is_remote_path(filename)) {
+		struct ast_filestream *s = ast_channel_stream(chan);
+		struct ast_format *rawformat;
+
+		ast_channel_lock(chan);
+		rawformat = ao2_bump(ast_channel_rawwriteformat(chan));
+		ast_channel_unlock(chan);
+		/* The file is translated as it plays, so have it encoded ahead for the next time */
+		if (s && rawformat && ast_format_cmp(s->fmt->format, rawformat) == AST_FORMAT_CMP_NOT_EQUAL) {
+			prompt_compile_queue(buf, s->fmt, rawformat);
+		}
+		ao2_cleanup(rawformat);
+	}
+
+	return ast_channel_stream(chan);
 }
 
 struct ast_filestream *ast_openvstream(struct ast_channel *chan,
@@ -983,7 +1443,12 @@ static enum fsread_res ast_readaudio_callback(struct ast_filestream *s)
 
 			ast_settimeout_full(s->owner, rate, ast_fsread_audio, s, 1);
 		} else {
-			ast_channel_streamid_set(s->owner, ast_sched_add(ast_channel_sched(s->owner), whennext / (ast_format_get_sample_rate(s->fmt->format) / 1000), ast_fsread_audio, s));
+			struct ast_sched_context *sched = ast_channel_sched_create(s->owner);
+
+			if (!sched) {
+				goto return_failure;
+			}
+			ast_channel_streamid_set(s->owner, ast_sched_add(sched, whennext / (ast_format_get_sample_rate(s->fmt->format) / 1000), ast_fsread_audio, s));
 		}
 		s->lasttimeout = whennext;
 		return FSREAD_SUCCESS_NOSCHED;
@@ -1033,7 +1498,13 @@ static enum fsread_res ast_readvideo_callback(struct ast_filestream *s)
 	}
 
 	if (whennext != s->lasttimeout) {
-		ast_channel_vstreamid_set(s->owner, ast_sched_add(ast_channel_sched(s->owner), whennext / (ast_format_get_sample_rate(s->fmt->format) / 1000), ast_fsread_video, s));
+		struct ast_sched_context *sched = ast_channel_sched_create(s->owner);
+
+		if (!sched) {
+			ast_channel_vstreamid_set(s->owner, -1);
+			return FSREAD_FAILURE;
+		}
+		ast_channel_vstreamid_set(s->owner, ast_sched_add(sched, whennext / (ast_format_get_sample_rate(s->fmt->format) / 1000), ast_fsread_video, s));
 		s->lasttimeout = whennext;
 		return FSREAD_SUCCESS_NOSCHED;
 	}
@@ -1409,6 +1880,9 @@ struct ast_filestream *ast_readfile(const char *filename, const char *type, cons
 		fs->mode = mode;
 		fs->filename = ast_strdup(filename);
 		fs->vfs = NULL;
+		if ((flags & O_ACCMODE) == O_RDONLY) {
+			filestream_map(fs);
+		}
 		ast_free(fn);
 		break;
 	}
@@ -1420,6 +1894,68 @@ struct ast_filestream *ast_readfile(const char *filename, const char *type, cons
 	return fs;
 }
 
+struct ast_filestream *ast_readfile_any(const char *filename, const char *preflang)
+{
+	struct ast_format_cap *file_fmt_cap;
+	struct ast_format *format;
+	struct ast_format_def *f;
+	char *ext = NULL;
+	int buflen;
+	char *buf;
+
+	if (preflang == NULL) {
+		preflang = "";
+	}
+	buflen = strlen(preflang) + strlen(filename) + 4;
+	buf = ast_alloca(buflen);
+
+	if (!(file_fmt_cap = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT))) {
+		return NULL;
+	}
+	if (!fileexists_core(filename, NULL, preflang, buf, buflen, file_fmt_cap)) {
+		ao2_ref(file_fmt_cap, -1);
+		return NULL;
+	}
+	format = ast_format_cap_get_best_by_type(file_fmt_cap, AST_MEDIA_TYPE_AUDIO);
+	ao2_ref(file_fmt_cap, -1);
+	if (!format) {
+		return NULL;
+	}
+
+	/* Find the extension the file has in that format */
+	AST_RWLIST_RDLOCK(&formats);
+	AST_RWLIST_TRAVERSE(&formats, f, list) {
+		char *stringp;
+
+		if (ast_format_cmp(f->format, format) != AST_FORMAT_CMP_EQUAL) {
+			continue;
+		}
+
+		stringp = ast_strdupa(f->exts);
+		while ((ext = strsep(&stringp, "|"))) {
+			char *fn = build_filename(buf, ext);
+			int found = fn && !access(fn, R_OK);
+
+			ast_free(fn);
+			if (found) {
+				break;
+			}
+		}
+		if (ext) {
+			ext = ast_strdupa(ext);
+			break;
+		}
+	}
+	AST_RWLIST_UNLOCK(&formats);
+	ao2_ref(format, -1);
+
+	if (!ext) {
+		return NULL;
+	}
+
+	return ast_readfile(buf, ext, NULL, O_RDONLY, 0, 0);
+}
+
 struct ast_filestream *ast_writefile(const char *filename, const char *type, const char *comment, int flags, int check, mode_t mode)
 {
 	int fd, myflags = 0;
@@ -2037,13 +2573,50 @@ int ast_get_extension_for_mime_type(const char *mime_type, char *buffer, size_t
 	return 0;
 }
 
+static char *handle_cli_core_show_prompt_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show prompt cache";
+		e->usage =
+			"Usage: core show prompt cache\n"
+			"       Shows how many sound files the prompt cache holds in memory,\n"
+			"       how much memory they use and how often files were found in it.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	AST_DLLIST_LOCK(&prompt_cache_lru);
+	ast_cli(a->fd, "Cache size:   %u KB\n", ast_option_prompt_cache_size);
+	ast_cli(a->fd, "Files cached: %d\n", prompt_cache ? ao2_container_count(prompt_cache) : 0);
+	ast_cli(a->fd, "Bytes cached: %zu\n", prompt_cache_bytes);
+	ast_cli(a->fd, "Hits:         %u\n", prompt_cache_hits);
+	ast_cli(a->fd, "Misses:       %u\n", prompt_cache_misses);
+	AST_DLLIST_UNLOCK(&prompt_cache_lru);
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_file[] = {
-	AST_CLI_DEFINE(handle_cli_core_show_file_formats, "Displays file formats")
+	AST_CLI_DEFINE(handle_cli_core_show_file_formats, "Displays file formats"),
+	AST_CLI_DEFINE(handle_cli_core_show_prompt_cache, "Displays prompt cache usage"),
 };
 
 static void file_shutdown(void)
 {
 	ast_cli_unregister_multiple(cli_file, ARRAY_LEN(cli_file));
+	prompt_cache_flush();
+	ao2_cleanup(prompt_cache);
+	prompt_cache = NULL;
+	ast_taskprocessor_unreference(prompt_compile_tps);
+	prompt_compile_tps = NULL;
+	ao2_cleanup(prompt_compile_requested);
+	prompt_compile_requested = NULL;
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_format_register_type);
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_format_unregister_type);
 }
@@ -2052,6 +2625,12 @@ int ast_file_init(void)
 {
 	STASIS_MESSAGE_TYPE_INIT(ast_format_register_type);
 	STASIS_MESSAGE_TYPE_INIT(ast_format_unregister_type);
+	prompt_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, PROMPT_CACHE_BUCKETS,
+		prompt_cache_entry_hash_fn, NULL, prompt_cache_entry_cmp_fn);
+	prompt_compile_requested = ast_str_container_alloc(PROMPT_COMPILE_BUCKETS);
+	if (prompt_compile_requested) {
+		prompt_compile_tps = ast_taskprocessor_get("prompt_compiler", TPS_REF_DEFAULT);
+	}
 	ast_cli_register_multiple(cli_file, ARRAY_LEN(cli_file));
 	ast_register_cleanup(file_shutdown);
 	return 0;
@@ -44,114 +44,346 @@
 #include "asterisk/file.h"
 
 #include <math.h>
+#include <inttypes.h>
 
 #if (defined(LOW_MEMORY) || defined(MALLOC_DEBUG)) && !defined(NO_FRAME_CACHE)
 #define NO_FRAME_CACHE
 #endif
 
+/*! \brief Allocation size of each size class of the frame caches */
+static const size_t frame_cache_class_sizes[AST_FRAME_CACHE_CLASSES] = {
+	256, 512, 1024, 2048, 4096,
+};
+
 #if !defined(NO_FRAME_CACHE)
+static int frame_cache_init(void *data);
 static void frame_cache_cleanup(void *data);
 
-/*! \brief A per-thread cache of frame headers */
-AST_THREADSTORAGE_CUSTOM(frame_cache, NULL, frame_cache_cleanup);
-
 /*!
- * \brief Maximum ast_frame cache size
+ * \brief A per-thread cache of frame headers and data buffers
  *
- * In most cases where the frame header cache will be useful, the size
- * of the cache will stay very small.  However, it is not always the case that
- * the same thread that allocates the frame will be the one freeing them, so
- * sometimes a thread will never have any frames in its cache, or the cache
- * will never be pulled from.  For the latter case, we limit the maximum size.
+ * Frames and data buffers are allocated in a few fixed sizes so that any
+ * cached one of the right size class can be reused.  In most cases where
+ * the cache will be useful, the number cached will stay very small.
+ * However, it is not always the case that the same thread that allocates
+ * the frame will be the one freeing them, so sometimes a thread will never
+ * have any frames in its cache, or the cache will never be pulled from.
+ * For the latter case, the number cached in each size class is limited by
+ * the cache_media_frames_size option.
  */
-#define FRAME_CACHE_MAX_SIZE	10
+AST_THREADSTORAGE_CUSTOM(frame_cache, frame_cache_init, frame_cache_cleanup);
 
 /*! \brief This is just so ast_frames, a list head struct for holding a list of
  *  ast_frame structures, is defined. */
 AST_LIST_HEAD_NOLOCK(ast_frames, ast_frame);
 
+/*! \brief The start of a data buffer allocated in a size class */
+struct frame_cache_buffer {
+	/*! Size class the buffer was allocated in */
+	unsigned int size_class;
+	/*! Next buffer while cached */
+	struct frame_cache_buffer *next;
+};
+
+/*!
+ * \brief Bytes reserved before the data of a size class buffer
+ *
+ * \note Kept a multiple of 16 so the data is as aligned as malloc() makes it.
+ */
+#define FRAME_CACHE_BUFFER_PREFIX 16
+
+/*! \brief A size class of a frame cache */
+struct frame_cache_class {
+	/*! Cached frames, a header along with room for data */
+	struct ast_frames frames;
+	/*! Cached data buffers */
+	struct frame_cache_buffer *buffers;
+	/*! Number of frames or buffers cached */
+	unsigned int size;
+	/*! Allocations taken from the cache */
+	uint64_t hits;
+	/*! Allocations made when the cache was empty */
+	uint64_t misses;
+	/*! Frees made when the cache was full */
+	uint64_t overflows;
+};
+
 struct ast_frame_cache {
-	struct ast_frames list;
-	size_t size;
+	/*! Frames, by size of the allocation including any data */
+	struct frame_cache_class frames[AST_FRAME_CACHE_CLASSES];
+	/*! Separately malloc'd data buffers */
+	struct frame_cache_class data[AST_FRAME_CACHE_CLASSES];
+	AST_LIST_ENTRY(ast_frame_cache) list;
 };
-#endif
 
-struct ast_frame ast_null_frame = { AST_FRAME_NULL, };
+/*! \brief The frame caches of all threads, so statistics can be reported */
+static AST_LIST_HEAD_STATIC(frame_caches, ast_frame_cache);
 
-static struct ast_frame *ast_frame_header_new(const char *file, int line, const char *func)
+/*! \brief Statistics of frame caches whose threads have exited, protected by the frame_caches lock */
+static struct ast_frame_cache_stats frame_caches_retired;
+
+static int frame_cache_init(void *data)
+{
+	struct ast_frame_cache *frames = data;
+
+	AST_LIST_LOCK(&frame_caches);
+	AST_LIST_INSERT_TAIL(&frame_caches, frames, list);
+	AST_LIST_UNLOCK(&frame_caches);
+
+	return 0;
+}
+
+static void frame_cache_class_stats_add(struct ast_frame_cache_class_stats *stats,
+	const struct frame_cache_class *cls, int cached)
 {
+	stats->hits += cls->hits;
+	stats->misses += cls->misses;
+	stats->overflows += cls->overflows;
+	if (cached) {
+		stats->cached += cls->size;
+	}
+}
+
+static void frame_cache_cleanup(void *data)
+{
+	struct ast_frame_cache *frames = data;
+	struct frame_cache_buffer *buffer;
 	struct ast_frame *f;
+	int i;
 
-#if !defined(NO_FRAME_CACHE)
-	struct ast_frame_cache *frames;
+	AST_LIST_LOCK(&frame_caches);
+	AST_LIST_REMOVE(&frame_caches, frames, list);
+	for (i = 0; i < AST_FRAME_CACHE_CLASSES; ++i) {
+		frame_cache_class_stats_add(&frame_caches_retired.frames[i], &frames->frames[i], 0);
+		frame_cache_class_stats_add(&frame_caches_retired.data[i], &frames->data[i], 0);
+	}
+	AST_LIST_UNLOCK(&frame_caches);
+
+	for (i = 0; i < AST_FRAME_CACHE_CLASSES; ++i) {
+		while ((f = AST_LIST_REMOVE_HEAD(&frames->frames[i].frames, frame_list))) {
+			ast_free(f);
+		}
+		while ((buffer = frames->data[i].buffers)) {
+			frames->data[i].buffers = buffer->next;
+			ast_free(buffer);
+		}
+	}
 
-	if ((frames = ast_threadstorage_get(&frame_cache, sizeof(*frames)))) {
-		if ((f = AST_LIST_REMOVE_HEAD(&frames->list, frame_list))) {
-			size_t mallocd_len = f->mallocd_hdr_len;
+	ast_free(frames);
+}
 
-			memset(f, 0, sizeof(*f));
-			f->mallocd_hdr_len = mallocd_len;
-			frames->size--;
-			return f;
+/*!
+ * \brief Find the smallest size class an allocation fits in
+ *
+ * \retval -1 if the allocation is too large to be cached
+ */
+static int frame_cache_class_find(size_t len)
+{
+	int i;
+
+	for (i = 0; i < AST_FRAME_CACHE_CLASSES; ++i) {
+		if (len <= frame_cache_class_sizes[i]) {
+			return i;
 		}
 	}
-#endif
+	return -1;
+}
 
-	if (!(f = __ast_calloc(1, sizeof(*f), file, line, func))) {
+/*!
+ * \brief Take a frame from the calling thread's cache
+ *
+ * \param len Bytes needed for the header and anything stored after it
+ * \param[out] alloc_len Bytes a new frame should be allocated with if none was cached
+ *
+ * \return A frame with a cleared header, or NULL if none was cached
+ */
+static struct ast_frame *frame_cache_get(size_t len, size_t *alloc_len)
+{
+	struct ast_frame_cache *frames;
+	struct frame_cache_class *cls;
+	struct ast_frame *f;
+	int size_class;
+
+	*alloc_len = len;
+	if (!ast_opt_cache_media_frames || (size_class = frame_cache_class_find(len)) < 0) {
 		return NULL;
 	}
+	*alloc_len = frame_cache_class_sizes[size_class];
 
-	f->mallocd_hdr_len = sizeof(*f);
+	if (!(frames = ast_threadstorage_get(&frame_cache, sizeof(*frames)))) {
+		return NULL;
+	}
+	cls = &frames->frames[size_class];
+	if (!(f = AST_LIST_REMOVE_HEAD(&cls->frames, frame_list))) {
+		cls->misses++;
+		return NULL;
+	}
+	cls->size--;
+	cls->hits++;
 
+	memset(f, 0, sizeof(*f));
+	f->mallocd_hdr_len = *alloc_len;
 	return f;
 }
 
-#if !defined(NO_FRAME_CACHE)
-static void frame_cache_cleanup(void *data)
+/*!
+ * \brief Put a frame whose header is all that remains allocated in the calling thread's cache
+ *
+ * \retval 1 if the frame was cached
+ * \retval 0 if the frame must be freed
+ */
+static int frame_cache_put(struct ast_frame *fr)
 {
-	struct ast_frame_cache *frames = data;
-	struct ast_frame *f;
+	struct ast_frame_cache *frames;
+	struct frame_cache_class *cls;
+	int size_class;
 
-	while ((f = AST_LIST_REMOVE_HEAD(&frames->list, frame_list)))
-		ast_free(f);
+	/* Only frames allocated in a size class can be reused */
+	size_class = frame_cache_class_find(fr->mallocd_hdr_len);
+	if (size_class < 0 || frame_cache_class_sizes[size_class] != fr->mallocd_hdr_len
+		|| !(frames = ast_threadstorage_get(&frame_cache, sizeof(*frames)))) {
+		return 0;
+	}
+	cls = &frames->frames[size_class];
+	if (cls->size >= ast_option_frame_cache_size) {
+		cls->overflows++;
+		return 0;
+	}
 
-	ast_free(frames);
+	AST_LIST_INSERT_HEAD(&cls->frames, fr, frame_list);
+	cls->size++;
+	return 1;
 }
 #endif
 
-static void __frame_free(struct ast_frame *fr, int cache)
+/*!
+ * \brief Allocate a data buffer for a frame
+ *
+ * \param len Bytes needed, including any offset
+ * \param[out] mallocd The AST_MALLOCD_ flags the frame must be given for the buffer
+ *
+ * \return The buffer or NULL on error
+ */
+static void *frame_data_alloc(size_t len, int *mallocd)
 {
-	if (!fr->mallocd)
-		return;
-
 #if !defined(NO_FRAME_CACHE)
-	if (fr->mallocd == AST_MALLOCD_HDR
-		&& cache
-		&& ast_opt_cache_media_frames) {
-		/* Cool, only the header is malloc'd, let's just cache those for now
-		 * to keep things simple... */
-		struct ast_frame_cache *frames;
-
-		frames = ast_threadstorage_get(&frame_cache, sizeof(*frames));
-		if (frames && frames->size < FRAME_CACHE_MAX_SIZE) {
-			if (fr->frametype == AST_FRAME_VOICE
-				|| fr->frametype == AST_FRAME_VIDEO
-				|| fr->frametype == AST_FRAME_IMAGE) {
-				ao2_cleanup(fr->subclass.format);
-			} else if (fr->frametype == AST_FRAME_CONTROL && fr->subclass.integer == AST_CONTROL_ANSWER) {
-				ao2_cleanup(fr->subclass.topology);
+	struct ast_frame_cache *frames;
+	struct frame_cache_buffer *buffer;
+	int size_class;
+
+	if (ast_opt_cache_media_frames
+		&& (size_class = frame_cache_class_find(len + FRAME_CACHE_BUFFER_PREFIX)) >= 0) {
+		if ((frames = ast_threadstorage_get(&frame_cache, sizeof(*frames)))) {
+			struct frame_cache_class *cls = &frames->data[size_class];
+
+			if ((buffer = cls->buffers)) {
+				cls->buffers = buffer->next;
+				cls->size--;
+				cls->hits++;
+			} else {
+				cls->misses++;
 			}
+		} else {
+			buffer = NULL;
+		}
+		if (!buffer && !(buffer = ast_malloc(frame_cache_class_sizes[size_class]))) {
+			return NULL;
+		}
+		buffer->size_class = size_class;
+		*mallocd = AST_MALLOCD_DATA | AST_MALLOCD_DATA_CACHED;
+		return (char *) buffer + FRAME_CACHE_BUFFER_PREFIX;
+	}
+#endif
+
+	*mallocd = AST_MALLOCD_DATA;
+	return ast_malloc(len);
+}
 
-			AST_LIST_INSERT_HEAD(&frames->list, fr, frame_list);
-			frames->size++;
+/*!
+ * \brief Free the malloc'd data buffer of a frame
+ *
+ * \param fr The frame
+ * \param cache Whether the buffer may be cached
+ */
+static void frame_data_free(struct ast_frame *fr, int cache)
+{
+	void *data = fr->data.ptr - fr->offset;
+#if !defined(NO_FRAME_CACHE)
+	struct ast_frame_cache *frames;
+	struct frame_cache_buffer *buffer;
+
+	if (!(fr->mallocd & AST_MALLOCD_DATA_CACHED)) {
+		ast_free(data);
+		return;
+	}
+
+	buffer = (struct frame_cache_buffer *) ((char *) data - FRAME_CACHE_BUFFER_PREFIX);
+	if (cache && ast_opt_cache_media_frames
+		&& (frames = ast_threadstorage_get(&frame_cache, sizeof(*frames)))) {
+		struct frame_cache_class *cls = &frames->data[buffer->size_class];
+
+		if (cls->size < ast_option_frame_cache_size) {
+			buffer->next = cls->buffers;
+			cls->buffers = buffer;
+			cls->size++;
 			return;
 		}
+		cls->overflows++;
 	}
+	ast_free(buffer);
+#else
+	ast_free(data);
 #endif
+}
+
+struct ast_frame ast_null_frame = { AST_FRAME_NULL, };
+
+/*!
+ * \brief Get the reference counted payload holding the data of a frame
+ *
+ * \note Like a malloc'd data buffer, the payload starts offset bytes
+ * before the data.
+ */
+static void *frame_payload(const struct ast_frame *fr)
+{
+	return (char *) fr->data.ptr - fr->offset;
+}
+
+static struct ast_frame *ast_frame_header_new(const char *file, int line, const char *func)
+{
+	struct ast_frame *f;
+	size_t len = sizeof(*f);
+
+#if !defined(NO_FRAME_CACHE)
+	if ((f = frame_cache_get(sizeof(*f), &len))) {
+		return f;
+	}
+#endif
+
+	if (!(f = __ast_calloc(1, len, file, line, func))) {
+		return NULL;
+	}
+
+	f->mallocd_hdr_len = len;
+
+	return f;
+}
+
+static void __frame_free(struct ast_frame *fr, int cache)
+{
+	if (!fr->mallocd)
+		return;
+
+	if (fr->mallocd & AST_MALLOCD_SHARED) {
+		/* Drop this frame's reference, the payload goes with the last one. */
+		ao2_ref(frame_payload(fr), -1);
+		fr->data.ptr = NULL;
+		fr->mallocd &= ~AST_MALLOCD_SHARED;
+	}
 
 	if (fr->mallocd & AST_MALLOCD_DATA) {
 		if (fr->data.ptr) {
-			ast_free(fr->data.ptr - fr->offset);
+			frame_data_free(fr, cache);
 		}
 	}
 	if (fr->mallocd & AST_MALLOCD_SRC) {
@@ -166,6 +398,12 @@ static void __frame_free(struct ast_frame *fr, int cache)
 			ao2_cleanup(fr->subclass.topology);
 		}
 
+#if !defined(NO_FRAME_CACHE)
+		/* Cool, only the header is left, cache it for the next frame */
+		if (cache && ast_opt_cache_media_frames && frame_cache_put(fr)) {
+			return;
+		}
+#endif
 		ast_free(fr);
 	} else {
 		fr->mallocd = 0;
@@ -198,6 +436,7 @@ struct ast_frame *__ast_frisolate(struct ast_frame *fr, const char *file, int li
 {
 	struct ast_frame *out;
 	void *newdata;
+	int data_mallocd;
 
 	/* if none of the existing frame is malloc'd, let ast_frdup() do it
 	   since it is more efficient
@@ -206,9 +445,10 @@ struct ast_frame *__ast_frisolate(struct ast_frame *fr, const char *file, int li
 		return __ast_frdup(fr, file, line, func);
 	}
 
-	/* if everything is already malloc'd, we are done */
-	if ((fr->mallocd & (AST_MALLOCD_HDR | AST_MALLOCD_SRC | AST_MALLOCD_DATA)) ==
-	    (AST_MALLOCD_HDR | AST_MALLOCD_SRC | AST_MALLOCD_DATA)) {
+	/* if everything is already malloc'd, we are done.  A shared payload
+	   counts as malloc'd data since it lives as long as the frame does */
+	if ((fr->mallocd & (AST_MALLOCD_HDR | AST_MALLOCD_SRC)) == (AST_MALLOCD_HDR | AST_MALLOCD_SRC)
+		&& (fr->mallocd & (AST_MALLOCD_DATA | AST_MALLOCD_SHARED))) {
 		return fr;
 	}
 
@@ -268,7 +508,7 @@ struct ast_frame *__ast_frisolate(struct ast_frame *fr, const char *file, int li
 		}
 	}
 
-	if (!(fr->mallocd & AST_MALLOCD_DATA))  {
+	if (!(fr->mallocd & (AST_MALLOCD_DATA | AST_MALLOCD_SHARED)))  {
 		/* The original frame has a non-malloced data buffer. */
 		if (!fr->datalen && fr->frametype != AST_FRAME_TEXT) {
 			/* Actually it's just an int so we can simply copy it. */
@@ -279,7 +519,7 @@ struct ast_frame *__ast_frisolate(struct ast_frame *fr, const char *file, int li
 		 * Duplicate the data buffer and put it into the isolated frame
 		 * which may also be the original frame.
 		 */
-		newdata = ast_malloc(fr->datalen + AST_FRIENDLY_OFFSET);
+		newdata = frame_data_alloc(fr->datalen + AST_FRIENDLY_OFFSET, &data_mallocd);
 		if (!newdata) {
 			if (out != fr) {
 				ast_frame_free(out, 0);
@@ -290,30 +530,40 @@ struct ast_frame *__ast_frisolate(struct ast_frame *fr, const char *file, int li
 		out->offset = AST_FRIENDLY_OFFSET;
 		memcpy(newdata, fr->data.ptr, fr->datalen);
 		out->data.ptr = newdata;
-		out->mallocd |= AST_MALLOCD_DATA;
+		out->mallocd |= data_mallocd;
 	} else if (out != fr) {
-		/* Steal the data buffer from the original frame. */
+		/* Steal the data buffer or shared payload from the original frame. */
+		data_mallocd = AST_MALLOCD_DATA | AST_MALLOCD_DATA_CACHED | AST_MALLOCD_SHARED;
 		out->data = fr->data;
 		memset(&fr->data, 0, sizeof(fr->data));
-		fr->mallocd &= ~AST_MALLOCD_DATA;
-		out->mallocd |= AST_MALLOCD_DATA;
+		out->mallocd |= fr->mallocd & data_mallocd;
+		fr->mallocd &= ~data_mallocd;
 	}
 
 	return out;
 }
 
-struct ast_frame *__ast_frdup(const struct ast_frame *f, const char *file, int line, const char *func)
+/*!
+ * \brief Copy a frame
+ *
+ * \param f Frame to copy
+ * \param payload If not NULL, the shared payload the copy references instead
+ * of getting its own copy of the data.  The caller's reference is given to
+ * the new frame.
+ * \param payload_offset Where in the payload the data begins
+ */
+static struct ast_frame *frame_copy(const struct ast_frame *f, void *payload, int payload_offset,
+	const char *file, int line, const char *func)
 {
 	struct ast_frame *out = NULL;
 	int len, srclen = 0;
+	/* A shared payload is not part of the frame allocation */
+	int data_space = payload ? 0 : AST_FRIENDLY_OFFSET + f->datalen;
+	size_t alloc_len;
 	void *buf = NULL;
 
-#if !defined(NO_FRAME_CACHE)
-	struct ast_frame_cache *frames;
-#endif
-
 	/* Start with standard stuff */
-	len = sizeof(*out) + AST_FRIENDLY_OFFSET + f->datalen;
+	len = sizeof(*out) + data_space;
 	/* If we have a source, add space for it */
 	/*
 	 * XXX Watch out here - if we receive a src which is not terminated
@@ -324,29 +574,16 @@ struct ast_frame *__ast_frdup(const struct ast_frame *f, const char *file, int l
 	if (srclen > 0)
 		len += srclen + 1;
 
+	alloc_len = len;
 #if !defined(NO_FRAME_CACHE)
-	if ((frames = ast_threadstorage_get(&frame_cache, sizeof(*frames)))) {
-		AST_LIST_TRAVERSE_SAFE_BEGIN(&frames->list, out, frame_list) {
-			if (out->mallocd_hdr_len >= len) {
-				size_t mallocd_len = out->mallocd_hdr_len;
-
-				AST_LIST_REMOVE_CURRENT(frame_list);
-				memset(out, 0, sizeof(*out));
-				out->mallocd_hdr_len = mallocd_len;
-				buf = out;
-				frames->size--;
-				break;
-			}
-		}
-		AST_LIST_TRAVERSE_SAFE_END;
-	}
+	buf = out = frame_cache_get(len, &alloc_len);
 #endif
 
 	if (!buf) {
-		if (!(buf = __ast_calloc(1, len, file, line, func)))
+		if (!(buf = __ast_calloc(1, alloc_len, file, line, func)))
 			return NULL;
 		out = buf;
-		out->mallocd_hdr_len = len;
+		out->mallocd_hdr_len = alloc_len;
 	}
 
 	out->frametype = f->frametype;
@@ -370,8 +607,12 @@ struct ast_frame *__ast_frdup(const struct ast_frame *f, const char *file, int l
 	 */
 	out->mallocd = AST_MALLOCD_HDR;
 	out->offset = AST_FRIENDLY_OFFSET;
+	if (payload) {
+		out->offset = payload_offset;
+		out->data.ptr = payload + payload_offset;
+		out->mallocd |= AST_MALLOCD_SHARED;
 	/* Make sure that empty text frames have a valid data.ptr */
-	if (out->datalen || f->frametype == AST_FRAME_TEXT) {
+	} else if (out->datalen || f->frametype == AST_FRAME_TEXT) {
 		out->data.ptr = buf + sizeof(*out) + AST_FRIENDLY_OFFSET;
 		memcpy(out->data.ptr, f->data.ptr, out->datalen);
 	} else {
@@ -380,7 +621,7 @@ struct ast_frame *__ast_frdup(const struct ast_frame *f, const char *file, int l
 	if (srclen > 0) {
 		/* This may seem a little strange, but it's to avoid a gcc (4.2.4) compiler warning */
 		char *src;
-		out->src = buf + sizeof(*out) + AST_FRIENDLY_OFFSET + f->datalen;
+		out->src = buf + sizeof(*out) + data_space;
 		src = (char *) out->src;
 		/* Must have space since we allocated for it */
 		strcpy(src, f->src);
@@ -393,6 +634,89 @@ struct ast_frame *__ast_frdup(const struct ast_frame *f, const char *file, int l
 	return out;
 }
 
+struct ast_frame *__ast_frdup(const struct ast_frame *f, const char *file, int line, const char *func)
+{
+	return frame_copy(f, NULL, 0, file, line, func);
+}
+
+struct ast_frame *__ast_frdup_shared(const struct ast_frame *f, const char *file, int line, const char *func)
+{
+	struct ast_frame *out;
+	void *payload;
+
+	if (f->mallocd & AST_MALLOCD_SHARED) {
+		return __ast_frshare(f, file, line, func);
+	}
+
+	/* Frames without a data buffer have nothing to share */
+	if (!f->datalen) {
+		return frame_copy(f, NULL, 0, file, line, func);
+	}
+
+	payload = __ao2_alloc(AST_FRIENDLY_OFFSET + f->datalen, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK,
+		"frame payload", file, line, func);
+	if (!payload) {
+		return NULL;
+	}
+	memcpy(payload + AST_FRIENDLY_OFFSET, f->data.ptr, f->datalen);
+
+	out = frame_copy(f, payload, AST_FRIENDLY_OFFSET, file, line, func);
+	if (!out) {
+		ao2_ref(payload, -1);
+	}
+	return out;
+}
+
+struct ast_frame *__ast_frshare(const struct ast_frame *f, const char *file, int line, const char *func)
+{
+	struct ast_frame *out;
+	void *payload;
+
+	if (!(f->mallocd & AST_MALLOCD_SHARED)) {
+		return frame_copy(f, NULL, 0, file, line, func);
+	}
+
+	payload = frame_payload(f);
+	ao2_ref(payload, +1);
+	out = frame_copy(f, payload, f->offset, file, line, func);
+	if (!out) {
+		ao2_ref(payload, -1);
+	}
+	return out;
+}
+
+int ast_frame_is_shared(const struct ast_frame *fr)
+{
+	/* The refcount can only grow through a frame holding a reference, so a
+	 * single reference means nothing else can be using the payload. */
+	return (fr->mallocd & AST_MALLOCD_SHARED) && ao2_ref(frame_payload(fr), 0) > 1;
+}
+
+int ast_frame_make_writable(struct ast_frame *fr)
+{
+	void *newdata;
+	int data_mallocd;
+
+	if (!ast_frame_is_shared(fr)) {
+		return 0;
+	}
+
+	newdata = frame_data_alloc(fr->datalen + AST_FRIENDLY_OFFSET, &data_mallocd);
+	if (!newdata) {
+		return -1;
+	}
+	newdata += AST_FRIENDLY_OFFSET;
+	memcpy(newdata, fr->data.ptr, fr->datalen);
+
+	ao2_ref(frame_payload(fr), -1);
+	fr->data.ptr = newdata;
+	fr->offset = AST_FRIENDLY_OFFSET;
+	fr->mallocd &= ~AST_MALLOCD_SHARED;
+	fr->mallocd |= data_mallocd;
+
+	return 0;
+}
+
 void ast_swapcopy_samples(void *dst, const void *src, int samples)
 {
 	int i;
@@ -787,7 +1111,7 @@ void ast_frame_dump(const char *name, struct ast_frame *f, char *prefix)
 int ast_frame_adjust_volume(struct ast_frame *f, int adjustment)
 {
 	int count;
-	short *fdata = f->data.ptr;
+	short *fdata;
 	short adjust_value = abs(adjustment);
 
 	if ((f->frametype != AST_FRAME_VOICE) || !(ast_format_cache_is_slinear(f->subclass.format))) {
@@ -798,6 +1122,11 @@ int ast_frame_adjust_volume(struct ast_frame *f, int adjustment)
 		return 0;
 	}
 
+	if (ast_frame_make_writable(f)) {
+		return -1;
+	}
+	fdata = f->data.ptr;
+
 	for (count = 0; count < f->samples; count++) {
 		if (adjustment > 0) {
 			ast_slinear_saturated_multiply(&fdata[count], &adjust_value);
@@ -812,7 +1141,7 @@ int ast_frame_adjust_volume(struct ast_frame *f, int adjustment)
 int ast_frame_adjust_volume_float(struct ast_frame *f, float adjustment)
 {
 	int count;
-	short *fdata = f->data.ptr;
+	short *fdata;
 	float adjust_value = fabs(adjustment);
 
 	if ((f->frametype != AST_FRAME_VOICE) || !(ast_format_cache_is_slinear(f->subclass.format))) {
@@ -823,6 +1152,11 @@ int ast_frame_adjust_volume_float(struct ast_frame *f, float adjustment)
 		return 0;
 	}
 
+	if (ast_frame_make_writable(f)) {
+		return -1;
+	}
+	fdata = f->data.ptr;
+
 	for (count = 0; count < f->samples; count++) {
 		if (adjustment > 0) {
 			ast_slinear_saturated_multiply_float(&fdata[count], &adjust_value);
@@ -848,6 +1182,9 @@ int ast_frame_slinear_sum(struct ast_frame *f1, struct ast_frame *f2)
 	if (f1->samples != f2->samples)
 		return -1;
 
+	if (ast_frame_make_writable(f1))
+		return -1;
+
 	for (count = 0, data1 = f1->data.ptr, data2 = f2->data.ptr;
 	     count < f1->samples;
 	     count++, data1++, data2++)
@@ -863,7 +1200,105 @@ int ast_frame_clear(struct ast_frame *frame)
 	for (next = AST_LIST_NEXT(frame, frame_list);
 		 frame;
 		 frame = next, next = frame ? AST_LIST_NEXT(frame, frame_list) : NULL) {
+		if (ast_frame_make_writable(frame)) {
+			return -1;
+		}
 		memset(frame->data.ptr, 0, frame->datalen);
 	}
 	return 0;
 }
+
+void ast_frame_cache_stats_get(struct ast_frame_cache_stats *stats)
+{
+#if !defined(NO_FRAME_CACHE)
+	struct ast_frame_cache *frames;
+#endif
+	int i;
+
+	memset(stats, 0, sizeof(*stats));
+
+#if !defined(NO_FRAME_CACHE)
+	AST_LIST_LOCK(&frame_caches);
+	*stats = frame_caches_retired;
+	/* The counters of running threads are read without their knowledge, so they are approximate */
+	AST_LIST_TRAVERSE(&frame_caches, frames, list) {
+		for (i = 0; i < AST_FRAME_CACHE_CLASSES; ++i) {
+			frame_cache_class_stats_add(&stats->frames[i], &frames->frames[i], 1);
+			frame_cache_class_stats_add(&stats->data[i], &frames->data[i], 1);
+		}
+		stats->threads++;
+	}
+	AST_LIST_UNLOCK(&frame_caches);
+#endif
+
+	for (i = 0; i < AST_FRAME_CACHE_CLASSES; ++i) {
+		stats->frames[i].size = frame_cache_class_sizes[i];
+		stats->data[i].size = frame_cache_class_sizes[i];
+	}
+}
+
+static void show_frame_cache_classes(int fd, const char *name,
+	const struct ast_frame_cache_class_stats *classes)
+{
+	int i;
+
+	for (i = 0; i < AST_FRAME_CACHE_CLASSES; ++i) {
+		ast_cli(fd, "%-8s %6zu %10" PRIu64 " %15" PRIu64 " %15" PRIu64 " %15" PRIu64 "\n",
+			name, classes[i].size, classes[i].cached, classes[i].hits,
+			classes[i].misses, classes[i].overflows);
+	}
+}
+
+static char *show_frame_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct ast_frame_cache_stats stats;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show frame cache";
+		e->usage =
+			"Usage: core show frame cache\n"
+			"       Displays statistics of the per-thread media frame caches\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_frame_cache_stats_get(&stats);
+
+#if defined(NO_FRAME_CACHE)
+	ast_cli(a->fd, "Media frame caching:        Not available in this build\n");
+#else
+	ast_cli(a->fd, "Media frame caching:        %s\n", ast_opt_cache_media_frames ? "Enabled" : "Disabled");
+#endif
+	ast_cli(a->fd, "Maximum cached per size:    %u\n", ast_option_frame_cache_size);
+	ast_cli(a->fd, "Threads with a cache:       %u\n\n", stats.threads);
+	ast_cli(a->fd, "%-8s %6s %10s %15s %15s %15s\n",
+		"Cache", "Size", "Cached", "Hits", "Misses", "Overflows");
+	show_frame_cache_classes(a->fd, "frames", stats.frames);
+	show_frame_cache_classes(a->fd, "data", stats.data);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry frame_cli[] = {
+	AST_CLI_DEFINE(show_frame_cache, "Displays media frame cache statistics"),
+};
+
+/*! \brief Function called when the process is shutting down */
+static void frame_shutdown(void)
+{
+	ast_cli_unregister_multiple(frame_cli, ARRAY_LEN(frame_cli));
+}
+
+int ast_frame_init(void)
+{
+	ast_cli_register_multiple(frame_cli, ARRAY_LEN(frame_cli));
+	ast_register_cleanup(frame_shutdown);
+
+	return 0;
+}
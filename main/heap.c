@@ -18,7 +18,7 @@
 
 /*! \file
  *
- * \brief Max Heap data structure
+ * \brief Max Heap and timer heap data structures
  *
  * \author Russell Bryant <russell@digium.com>
  */
@@ -292,3 +292,336 @@ int __ast_heap_unlock(struct ast_heap *h, const char *file, const char *func, in
 {
 	return __ast_rwlock_unlock(file, line, func, &h->lock, "&h->lock");
 }
+
+/*! \brief Bits of a timer heap key holding the tie breaker */
+#define TIMER_HEAP_SEQ_BITS 10
+/*! \brief Bytes the children of a timer heap node are aligned to */
+#define TIMER_HEAP_LINE 64
+
+/*!
+ * \brief A timer heap node
+ *
+ * The key is the expiry in microseconds shifted above a tie breaker, so
+ * nodes are ordered by one integer comparison.  On 64 bit platforms a node
+ * is 16 bytes and the four children of a node fill a cache line.
+ */
+struct timer_heap_entry {
+	uint64_t key;
+	void *elm;
+};
+
+struct ast_timer_heap {
+	/*! Nodes, with the children of every node starting a cache line */
+	struct timer_heap_entry *entries;
+	/*! The allocation the nodes are in */
+	void *alloc;
+	ssize_t index_offset;
+	size_t cur_len;
+	size_t avail_len;
+	/*! Next tie breaker */
+	unsigned int seq;
+};
+
+static inline uint64_t timer_heap_time(struct timeval tv)
+{
+	if (tv.tv_sec < 0) {
+		return 0;
+	}
+	return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static inline uint64_t timer_heap_key(struct ast_timer_heap *h, struct timeval tv)
+{
+	return (timer_heap_time(tv) << TIMER_HEAP_SEQ_BITS)
+		| (h->seq++ & ((1 << TIMER_HEAP_SEQ_BITS) - 1));
+}
+
+static inline void timer_heap_set(struct ast_timer_heap *h, size_t i, struct timer_heap_entry entry)
+{
+	h->entries[i] = entry;
+	*(ssize_t *) (entry.elm + h->index_offset) = i + 1;
+}
+
+/*!
+ * \internal
+ * \brief Allocate room for a number of nodes
+ *
+ * Node 0 is placed so nodes 1 to 4, and so every group of children after
+ * them, start at a multiple of TIMER_HEAP_LINE.
+ */
+static int timer_heap_alloc(struct ast_timer_heap *h, size_t len,
+	const char *file, int lineno, const char *func)
+{
+	void *alloc;
+	uintptr_t first;
+
+	alloc = __ast_malloc(len * sizeof(struct timer_heap_entry) + TIMER_HEAP_LINE, file, lineno, func);
+	if (!alloc) {
+		return -1;
+	}
+
+	first = ((uintptr_t) alloc + sizeof(struct timer_heap_entry) + TIMER_HEAP_LINE - 1)
+		& ~((uintptr_t) TIMER_HEAP_LINE - 1);
+	if (h->cur_len) {
+		memcpy((void *) (first - sizeof(struct timer_heap_entry)), h->entries,
+			h->cur_len * sizeof(struct timer_heap_entry));
+	}
+	ast_free(h->alloc);
+	h->alloc = alloc;
+	h->entries = (struct timer_heap_entry *) (first - sizeof(struct timer_heap_entry));
+	h->avail_len = len;
+
+	return 0;
+}
+
+struct ast_timer_heap *_ast_timer_heap_create(size_t init_size, ssize_t index_offset,
+	const char *file, int lineno, const char *func)
+{
+	struct ast_timer_heap *h;
+
+	if (index_offset < 0) {
+		ast_log(LOG_ERROR, "A timer heap needs the index of its elements\n");
+		return NULL;
+	}
+
+	h = __ast_calloc(1, sizeof(*h), file, lineno, func);
+	if (!h) {
+		return NULL;
+	}
+	h->index_offset = index_offset;
+
+	if (timer_heap_alloc(h, init_size ?: 64, file, lineno, func)) {
+		ast_free(h);
+		return NULL;
+	}
+
+	return h;
+}
+
+struct ast_timer_heap *ast_timer_heap_destroy(struct ast_timer_heap *h)
+{
+	if (h) {
+		ast_free(h->alloc);
+		ast_free(h);
+	}
+
+	return NULL;
+}
+
+static void timer_heap_sift_up(struct ast_timer_heap *h, size_t i, struct timer_heap_entry entry)
+{
+	while (i) {
+		size_t parent = (i - 1) / 4;
+
+		if (h->entries[parent].key <= entry.key) {
+			break;
+		}
+		timer_heap_set(h, i, h->entries[parent]);
+		i = parent;
+	}
+	timer_heap_set(h, i, entry);
+}
+
+static void timer_heap_sift_down(struct ast_timer_heap *h, size_t i, struct timer_heap_entry entry)
+{
+	for (;;) {
+		size_t first = 4 * i + 1;
+		size_t last;
+		size_t min;
+		size_t child;
+
+		if (first >= h->cur_len) {
+			break;
+		}
+		last = MIN(first + 4, h->cur_len);
+		min = first;
+		for (child = first + 1; child < last; child++) {
+			if (h->entries[child].key < h->entries[min].key) {
+				min = child;
+			}
+		}
+
+		if (entry.key <= h->entries[min].key) {
+			break;
+		}
+		timer_heap_set(h, i, h->entries[min]);
+		i = min;
+	}
+	timer_heap_set(h, i, entry);
+}
+
+static int timer_heap_reserve(struct ast_timer_heap *h, size_t count)
+{
+	size_t len = h->avail_len;
+
+	if (h->cur_len + count <= len) {
+		return 0;
+	}
+	while (len < h->cur_len + count) {
+		len *= 2;
+	}
+	return timer_heap_alloc(h, len, __FILE__, __LINE__, __PRETTY_FUNCTION__);
+}
+
+int ast_timer_heap_push(struct ast_timer_heap *h, struct timeval when, void *elm)
+{
+	struct timer_heap_entry entry;
+
+	if (timer_heap_reserve(h, 1)) {
+		return -1;
+	}
+
+	if (!h->cur_len) {
+		h->seq = 0;
+	}
+	entry.key = timer_heap_key(h, when);
+	entry.elm = elm;
+	timer_heap_sift_up(h, h->cur_len++, entry);
+
+	return 0;
+}
+
+int ast_timer_heap_push_bulk(struct ast_timer_heap *h, const struct timeval *when,
+	void * const *elms, size_t count)
+{
+	struct timer_heap_entry entry;
+	size_t i;
+
+	if (timer_heap_reserve(h, count)) {
+		return -1;
+	}
+
+	if (!h->cur_len) {
+		h->seq = 0;
+	}
+
+	if (count < h->cur_len) {
+		for (i = 0; i < count; i++) {
+			entry.key = timer_heap_key(h, when[i]);
+			entry.elm = elms[i];
+			timer_heap_sift_up(h, h->cur_len++, entry);
+		}
+		return 0;
+	}
+
+	/*
+	 * Append everything and sift down every node from the last, which also
+	 * records the position of the new elements.
+	 */
+	for (i = 0; i < count; i++) {
+		h->entries[h->cur_len].key = timer_heap_key(h, when[i]);
+		h->entries[h->cur_len].elm = elms[i];
+		h->cur_len++;
+	}
+	for (i = h->cur_len; i--;) {
+		timer_heap_sift_down(h, i, h->entries[i]);
+	}
+
+	return 0;
+}
+
+static void *timer_heap_remove_at(struct ast_timer_heap *h, size_t i)
+{
+	void *elm = h->entries[i].elm;
+	struct timer_heap_entry last;
+
+	last = h->entries[--h->cur_len];
+	if (i == h->cur_len) {
+		return elm;
+	}
+
+	if (i && last.key < h->entries[(i - 1) / 4].key) {
+		timer_heap_sift_up(h, i, last);
+	} else {
+		timer_heap_sift_down(h, i, last);
+	}
+
+	return elm;
+}
+
+void *ast_timer_heap_pop(struct ast_timer_heap *h)
+{
+	if (!h->cur_len) {
+		return NULL;
+	}
+
+	return timer_heap_remove_at(h, 0);
+}
+
+void *ast_timer_heap_pop_expired(struct ast_timer_heap *h, struct timeval now)
+{
+	if (!h->cur_len || (h->entries[0].key >> TIMER_HEAP_SEQ_BITS) >= timer_heap_time(now)) {
+		return NULL;
+	}
+
+	return timer_heap_remove_at(h, 0);
+}
+
+size_t ast_timer_heap_pop_all_expired(struct ast_timer_heap *h, struct timeval now,
+	void **elms, size_t max)
+{
+	uint64_t expired = timer_heap_time(now) << TIMER_HEAP_SEQ_BITS;
+	size_t count = 0;
+
+	while (count < max && h->cur_len && h->entries[0].key < expired) {
+		elms[count++] = timer_heap_remove_at(h, 0);
+	}
+
+	return count;
+}
+
+void *ast_timer_heap_remove(struct ast_timer_heap *h, void *elm)
+{
+	ssize_t i = *(ssize_t *) (elm + h->index_offset);
+
+	if (i < 1 || i > h->cur_len || h->entries[i - 1].elm != elm) {
+		return NULL;
+	}
+
+	return timer_heap_remove_at(h, i - 1);
+}
+
+void *ast_timer_heap_peek(struct ast_timer_heap *h, unsigned int index)
+{
+	if (!index || index > h->cur_len) {
+		return NULL;
+	}
+
+	return h->entries[index - 1].elm;
+}
+
+int ast_timer_heap_next(struct ast_timer_heap *h, struct timeval *when)
+{
+	uint64_t usec;
+
+	if (!h->cur_len) {
+		return -1;
+	}
+
+	usec = h->entries[0].key >> TIMER_HEAP_SEQ_BITS;
+	when->tv_sec = usec / 1000000;
+	when->tv_usec = usec % 1000000;
+
+	return 0;
+}
+
+size_t ast_timer_heap_size(struct ast_timer_heap *h)
+{
+	return h->cur_len;
+}
+
+int ast_timer_heap_verify(struct ast_timer_heap *h)
+{
+	size_t i;
+
+	for (i = 1; i < h->cur_len; i++) {
+		if (h->entries[i].key < h->entries[(i - 1) / 4].key) {
+			return -1;
+		}
+		if (*(ssize_t *) (h->entries[i].elm + h->index_offset) != i + 1) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
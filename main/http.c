@@ -64,6 +64,10 @@
 #include "asterisk/astobj2.h"
 #include "asterisk/netsock2.h"
 #include "asterisk/json.h"
+#include "asterisk/alertpipe.h"
+#include "asterisk/poll-compat.h"
+#include "asterisk/threadpool.h"
+#include "asterisk/vector.h"
 
 #define MAX_PREFIX 80
 #define DEFAULT_PORT 8088
@@ -107,9 +111,30 @@ static int session_limit = DEFAULT_SESSION_LIMIT;
 static int session_inactivity = DEFAULT_SESSION_INACTIVITY;
 static int session_keep_alive = DEFAULT_SESSION_KEEP_ALIVE;
 static int session_count = 0;
+static int http_worker_threads = 0;
 
 static struct ast_tls_config http_tls_cfg;
 
+/*! Threads serving the requests of persistent connections */
+static struct ast_threadpool *http_threadpool;
+/*! Thread waiting for the next request of persistent connections */
+static pthread_t http_poller_thread = AST_PTHREADT_NULL;
+static int http_poller_alert[2] = { -1, -1 };
+static int http_poller_stop;
+AST_MUTEX_DEFINE_STATIC(http_parked_lock);
+
+/*! A persistent connection waiting for its next request */
+struct http_parked_session {
+	struct ast_tcptls_session_instance *ser;
+	/*! When the connection is closed if no request came */
+	struct timeval expires;
+};
+
+AST_VECTOR(http_parked_sessions, struct http_parked_session);
+
+/*! Connections parked since the poller last looked, protected by http_parked_lock */
+static struct http_parked_sessions http_parked_new;
+
 static void *httpd_helper_thread(void *arg);
 
 /*!
@@ -446,6 +471,8 @@ enum http_private_flags {
 	HTTP_FLAG_BODY_READ = (1 << 1),
 	/*! TRUE if the HTTP request must close when completed. */
 	HTTP_FLAG_CLOSE_ON_COMPLETION = (1 << 2),
+	/*! TRUE if the HTTP request is served by a thread of the worker pool. */
+	HTTP_FLAG_POOLED = (1 << 3),
 };
 
 /*! HTTP tcptls worker_fn private data. */
@@ -456,6 +483,24 @@ struct http_worker_private_data {
 	struct ast_flags flags;
 };
 
+/*!
+ * \internal
+ * \brief Determine whether the session must be closed once the response is sent
+ */
+static int http_response_close_connection(struct ast_tcptls_session_instance *ser)
+{
+	struct http_worker_private_data *request;
+
+	if (session_keep_alive <= 0) {
+		return 1;
+	}
+
+	request = ser->private_data;
+	return !request
+		|| ast_test_flag(&request->flags, HTTP_FLAG_CLOSE_ON_COMPLETION)
+		|| ast_http_body_discard(ser);
+}
+
 void ast_http_send(struct ast_tcptls_session_instance *ser,
 	enum ast_http_method method, int status_code, const char *status_title,
 	struct ast_str *http_header, struct ast_str *out, int fd,
@@ -493,20 +538,7 @@ void ast_http_send(struct ast_tcptls_session_instance *ser,
 	 */
 	ast_assert(200 <= status_code);
 
-	if (session_keep_alive <= 0) {
-		close_connection = 1;
-	} else {
-		struct http_worker_private_data *request;
-
-		request = ser->private_data;
-		if (!request
-			|| ast_test_flag(&request->flags, HTTP_FLAG_CLOSE_ON_COMPLETION)
-			|| ast_http_body_discard(ser)) {
-			close_connection = 1;
-		} else {
-			close_connection = 0;
-		}
-	}
+	close_connection = http_response_close_connection(ser);
 
 	ast_strftime(timebuf, sizeof(timebuf), "%a, %d %b %Y %H:%M:%S GMT", ast_localtime(&now, &tm, "GMT"));
 
@@ -567,6 +599,103 @@ void ast_http_send(struct ast_tcptls_session_instance *ser,
 	}
 }
 
+int ast_http_send_chunked_start(struct ast_tcptls_session_instance *ser,
+	enum ast_http_method method, int status_code, const char *status_title,
+	struct ast_str *http_header, unsigned int static_content)
+{
+	struct http_worker_private_data *request;
+	struct timeval now = ast_tvnow();
+	struct ast_tm tm;
+	char timebuf[80];
+	int close_connection;
+	int res;
+
+	if (!ser) {
+		ast_free(http_header);
+		return -1;
+	}
+
+	ast_assert(200 <= status_code);
+
+	close_connection = http_response_close_connection(ser);
+
+	ast_strftime(timebuf, sizeof(timebuf), "%a, %d %b %Y %H:%M:%S GMT", ast_localtime(&now, &tm, "GMT"));
+
+	res = ast_iostream_printf(ser->stream,
+		"HTTP/1.1 %d %s\r\n"
+		"%s%s%s"
+		"Date: %s\r\n"
+		"%s"
+		"%s"
+		"%s"
+		"Transfer-Encoding: chunked\r\n"
+		"\r\n",
+		status_code, status_title ? status_title : "OK",
+		ast_strlen_zero(http_server_name) ? "" : "Server: ",
+		ast_strlen_zero(http_server_name) ? "" : http_server_name,
+		ast_strlen_zero(http_server_name) ? "" : "\r\n",
+		timebuf,
+		close_connection ? "Connection: close\r\n" : "",
+		static_content ? "" : "Cache-Control: no-cache, no-store\r\n",
+		http_header ? ast_str_buffer(http_header) : "");
+	ast_free(http_header);
+
+	if (res <= 0 || method == AST_HTTP_HEAD) {
+		if (res <= 0) {
+			ast_debug(1, "ast_iostream_printf() failed: %s\n", strerror(errno));
+			close_connection = 1;
+		}
+		if (close_connection) {
+			ast_tcptls_close_session_file(ser);
+		}
+		return -1;
+	}
+
+	/* Remember to close the session once the last chunk is sent */
+	request = ser->private_data;
+	if (close_connection && request) {
+		ast_set_flag(&request->flags, HTTP_FLAG_CLOSE_ON_COMPLETION);
+	}
+
+	return 0;
+}
+
+int ast_http_send_chunk(struct ast_tcptls_session_instance *ser, const char *data, size_t len)
+{
+	char header[32];
+	int header_len;
+
+	if (!len) {
+		/* An empty chunk would end the body */
+		return 0;
+	}
+
+	header_len = snprintf(header, sizeof(header), "%zx\r\n", len);
+	if (ast_iostream_write(ser->stream, header, header_len) != header_len
+		|| ast_iostream_write(ser->stream, data, len) != len
+		|| ast_iostream_write(ser->stream, "\r\n", 2) != 2) {
+		ast_debug(1, "ast_iostream_write() failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+void ast_http_send_chunked_end(struct ast_tcptls_session_instance *ser)
+{
+	struct http_worker_private_data *request = ser->private_data;
+
+	if (ast_iostream_write(ser->stream, "0\r\n\r\n", 5) != 5) {
+		ast_debug(1, "ast_iostream_write() failed: %s\n", strerror(errno));
+	} else if (request && !ast_test_flag(&request->flags, HTTP_FLAG_CLOSE_ON_COMPLETION)) {
+		ast_debug(1, "HTTP keeping session open after chunked response\n");
+		return;
+	}
+
+	ast_debug(1, "HTTP closing session after chunked response\n");
+	ast_tcptls_close_session_file(ser);
+}
+
 void ast_http_create_response(struct ast_tcptls_session_instance *ser, int status_code,
 	const char *status_title, struct ast_str *http_header_data, const char *text)
 {
@@ -1829,6 +1958,96 @@ static int http_request_headers_get(struct ast_tcptls_session_instance *ser, str
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Handle a HTTP request whose request line and headers were read.
+ *
+ * \param ser HTTP TCP/TLS session object.
+ * \param uri The URI requested.
+ * \param method The method of the request.
+ * \param headers The headers of the request.
+ *
+ * \retval 0 Continue and process the next HTTP request.
+ * \retval -1 Fatal HTTP connection error.  Force the HTTP connection closed.
+ */
+static int httpd_handle_request(struct ast_tcptls_session_instance *ser, char *uri,
+	enum ast_http_method method, struct ast_variable *headers)
+{
+	struct http_worker_private_data *request = ser->private_data;
+
+	if (http_request_tracking_setup(ser, headers)
+		|| handle_uri(ser, uri, method, headers)
+		|| ast_test_flag(&request->flags, HTTP_FLAG_CLOSE_ON_COMPLETION)) {
+		return -1;
+	}
+	return 0;
+}
+
+static void httpd_session_close(struct ast_tcptls_session_instance *ser);
+static int httpd_session_serve(struct ast_tcptls_session_instance *ser, int timeout);
+
+/*! A request to upgrade the connection handed from the worker pool to a thread of its own */
+struct http_upgrade {
+	struct ast_tcptls_session_instance *ser;
+	enum ast_http_method method;
+	struct ast_variable *headers;
+	char uri[0];
+};
+
+static void *httpd_upgrade_thread(void *data)
+{
+	struct http_upgrade *upgrade = data;
+	struct ast_tcptls_session_instance *ser = upgrade->ser;
+	int res;
+
+	res = httpd_handle_request(ser, upgrade->uri, upgrade->method, upgrade->headers);
+	ast_variables_destroy(upgrade->headers);
+	ast_free(upgrade);
+
+	if (!res) {
+		res = httpd_session_serve(ser, session_keep_alive);
+	}
+	if (res < 0) {
+		httpd_session_close(ser);
+	}
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Hand a request to upgrade the connection to a thread of its own.
+ *
+ * A WebSocket keeps the thread serving it for as long as it is open, which
+ * must not be a thread of the worker pool.
+ *
+ * \retval 0 The request and the connection were handed over.
+ * \retval -1 The request has to be handled by the calling thread.
+ */
+static int httpd_upgrade_handoff(struct ast_tcptls_session_instance *ser, char *uri,
+	enum ast_http_method method, struct ast_variable *headers)
+{
+	struct http_worker_private_data *request = ser->private_data;
+	struct http_upgrade *upgrade;
+	pthread_t thread;
+
+	upgrade = ast_malloc(sizeof(*upgrade) + strlen(uri) + 1);
+	if (!upgrade) {
+		return -1;
+	}
+	upgrade->ser = ser;
+	upgrade->method = method;
+	upgrade->headers = headers;
+	strcpy(upgrade->uri, uri); /* Safe */
+
+	ast_clear_flag(&request->flags, HTTP_FLAG_POOLED);
+	if (ast_pthread_create_detached_background(&thread, NULL, httpd_upgrade_thread, upgrade)) {
+		ast_set_flag(&request->flags, HTTP_FLAG_POOLED);
+		ast_free(upgrade);
+		return -1;
+	}
+	return 0;
+}
+
 /*!
  * \internal
  * \brief Process a HTTP request.
@@ -1837,6 +2056,7 @@ static int http_request_headers_get(struct ast_tcptls_session_instance *ser, str
  * \param ser HTTP TCP/TLS session object.
  *
  * \retval 0 Continue and process the next HTTP request.
+ * \retval 1 The connection was handed to another thread.
  * \retval -1 Fatal HTTP connection error.  Force the HTTP connection closed.
  */
 static int httpd_process_request(struct ast_tcptls_session_instance *ser)
@@ -1847,7 +2067,6 @@ static int httpd_process_request(struct ast_tcptls_session_instance *ser)
 	const char *transfer_encoding;
 	struct http_worker_private_data *request;
 	enum ast_http_method http_method = AST_HTTP_UNKNOWN;
-	int res;
 	ssize_t len;
 	char request_line[MAX_HTTP_LINE_LENGTH];
 
@@ -1927,16 +2146,263 @@ static int httpd_process_request(struct ast_tcptls_session_instance *ser)
 		return -1;
 	}
 
-	if (http_request_tracking_setup(ser, headers)
-		|| handle_uri(ser, uri, http_method, headers)
-		|| ast_test_flag(&request->flags, HTTP_FLAG_CLOSE_ON_COMPLETION)) {
-		res = -1;
-	} else {
-		res = 0;
+	if (ast_test_flag(&request->flags, HTTP_FLAG_POOLED) && get_header(headers, "Upgrade")
+		&& !httpd_upgrade_handoff(ser, uri, http_method, headers)) {
+		/* The headers now belong to the thread handling the upgrade */
+		headers = NULL;
+		return 1;
+	}
+
+	return httpd_handle_request(ser, uri, http_method, headers);
+}
+
+/*!
+ * \internal
+ * \brief Park a persistent connection until its next request arrives.
+ *
+ * \retval 0 The connection now belongs to the poller.
+ * \retval -1 The connection could not be parked.
+ */
+static int httpd_session_park(struct ast_tcptls_session_instance *ser)
+{
+	struct http_parked_session parked = {
+		.ser = ser,
+		.expires = ast_tvadd(ast_tvnow(), ast_samp2tv(session_keep_alive, 1000)),
+	};
+	int res;
+
+	ast_mutex_lock(&http_parked_lock);
+	res = http_poller_stop || AST_VECTOR_APPEND(&http_parked_new, parked);
+	if (!res) {
+		ast_alertpipe_write(http_poller_alert);
 	}
+	ast_mutex_unlock(&http_parked_lock);
+
 	return res;
 }
 
+/*!
+ * \internal
+ * \brief Decide what becomes of a connection after a request was handled.
+ *
+ * \retval 0 Process the next HTTP request in this thread.
+ * \retval 1 The connection was parked.
+ * \retval -1 The connection has to be closed.
+ */
+static int httpd_session_next(struct ast_tcptls_session_instance *ser)
+{
+	if (!ser->stream) {
+		/* Web-socket or similar that took the connection */
+		return -1;
+	}
+	if (session_keep_alive <= 0) {
+		/* Persistent connections not enabled. */
+		return -1;
+	}
+	/* Pipelined requests already read are served right away */
+	if (http_worker_threads && http_poller_thread != AST_PTHREADT_NULL
+		&& !ast_iostream_get_buffered(ser->stream)
+		&& !httpd_session_park(ser)) {
+		return 1;
+	}
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Serve the requests of a connection.
+ *
+ * \param ser HTTP TCP/TLS session object.
+ * \param timeout (ms) How long to wait for the first request.
+ *
+ * \retval 1 The connection was parked or handed to another thread.
+ * \retval -1 The connection has to be closed.
+ */
+static int httpd_session_serve(struct ast_tcptls_session_instance *ser, int timeout)
+{
+	int res;
+
+	for (;;) {
+		/* Wait for next potential HTTP request message. */
+		ast_iostream_set_timeout_idle_inactivity(ser->stream, timeout, session_inactivity);
+		res = httpd_process_request(ser);
+		if (!res) {
+			res = httpd_session_next(ser);
+		}
+		if (res) {
+			return res;
+		}
+		timeout = session_keep_alive;
+	}
+}
+
+static void httpd_session_close(struct ast_tcptls_session_instance *ser)
+{
+	ast_atomic_fetchadd_int(&session_count, -1);
+
+	ast_debug(1, "HTTP closing session.  Top level\n");
+	ast_tcptls_close_session_file(ser);
+
+	ao2_ref(ser, -1);
+}
+
+/*! \brief Worker pool task serving a parked connection whose next request arrived */
+static int httpd_session_resume(void *data)
+{
+	struct ast_tcptls_session_instance *ser = data;
+	struct http_worker_private_data *request = ser->private_data;
+
+	ast_set_flag(&request->flags, HTTP_FLAG_POOLED);
+	if (httpd_session_serve(ser, session_keep_alive) < 0) {
+		httpd_session_close(ser);
+	}
+	return 0;
+}
+
+/*! \brief Thread waiting for the next request of the parked connections */
+static void *httpd_poller(void *data)
+{
+	struct http_parked_sessions parked;
+	AST_VECTOR(, struct pollfd) fds;
+	int stop = 0;
+	size_t i;
+
+	if (AST_VECTOR_INIT(&parked, 32) || AST_VECTOR_INIT(&fds, 33)) {
+		AST_VECTOR_FREE(&parked);
+		return NULL;
+	}
+
+	while (!stop) {
+		struct pollfd pfd = {
+			.fd = ast_alertpipe_readfd(http_poller_alert),
+			.events = POLLIN,
+		};
+		struct timeval now;
+		int timeout = -1;
+
+		ast_mutex_lock(&http_parked_lock);
+		stop = http_poller_stop;
+		for (i = 0; i < AST_VECTOR_SIZE(&http_parked_new); i++) {
+			if (AST_VECTOR_APPEND(&parked, AST_VECTOR_GET(&http_parked_new, i))) {
+				httpd_session_close(AST_VECTOR_GET(&http_parked_new, i).ser);
+			}
+		}
+		AST_VECTOR_RESET(&http_parked_new, AST_VECTOR_ELEM_CLEANUP_NOOP);
+		ast_mutex_unlock(&http_parked_lock);
+
+		AST_VECTOR_RESET(&fds, AST_VECTOR_ELEM_CLEANUP_NOOP);
+		if (!stop) {
+			AST_VECTOR_APPEND(&fds, pfd);
+
+			now = ast_tvnow();
+			for (i = 0; i < AST_VECTOR_SIZE(&parked); i++) {
+				struct http_parked_session *session = AST_VECTOR_GET_ADDR(&parked, i);
+				int64_t remaining = ast_tvdiff_ms(session->expires, now);
+
+				/* Connections left out are only checked for expiry this time around */
+				pfd.fd = ast_iostream_get_fd(session->ser->stream);
+				if (AST_VECTOR_SIZE(&fds) == i + 1 && AST_VECTOR_APPEND(&fds, pfd)) {
+					ast_log(LOG_WARNING, "Unable to wait for %zu parked HTTP connections\n",
+						AST_VECTOR_SIZE(&parked) - i);
+				}
+				if (remaining < 0) {
+					remaining = 0;
+				}
+				if (timeout < 0 || remaining < timeout) {
+					timeout = MIN(remaining, INT_MAX);
+				}
+			}
+
+			if (ast_poll(AST_VECTOR_GET_ADDR(&fds, 0), AST_VECTOR_SIZE(&fds), timeout) < 0) {
+				if (errno != EINTR) {
+					ast_log(LOG_WARNING, "HTTP poller poll failed: %s\n", strerror(errno));
+				}
+				continue;
+			}
+			if (AST_VECTOR_GET(&fds, 0).revents) {
+				ast_alertpipe_flush(http_poller_alert);
+			}
+		}
+
+		now = ast_tvnow();
+		/* Going backwards so removing an entry only moves those already looked at */
+		for (i = AST_VECTOR_SIZE(&parked); i--;) {
+			struct http_parked_session session = AST_VECTOR_GET(&parked, i);
+
+			if (!stop && i + 1 < AST_VECTOR_SIZE(&fds) && AST_VECTOR_GET(&fds, i + 1).revents) {
+				if (ast_threadpool_push(http_threadpool, httpd_session_resume, session.ser)) {
+					httpd_session_close(session.ser);
+				}
+			} else if (stop || ast_tvcmp(now, session.expires) >= 0) {
+				httpd_session_close(session.ser);
+			} else {
+				continue;
+			}
+			AST_VECTOR_REMOVE_UNORDERED(&parked, i);
+		}
+	}
+
+	AST_VECTOR_FREE(&parked);
+	AST_VECTOR_FREE(&fds);
+
+	return NULL;
+}
+
+/*! \brief Start the worker pool and the poller for the worker_threads option */
+static void httpd_workers_start(void)
+{
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 0,
+		.auto_increment = 0,
+		.initial_size = http_worker_threads,
+		.max_size = http_worker_threads,
+	};
+
+	if (http_threadpool) {
+		/* Parked connections still need the threads there are */
+		if (http_worker_threads) {
+			ast_threadpool_set_size(http_threadpool, http_worker_threads);
+		}
+		return;
+	}
+	if (!http_worker_threads) {
+		return;
+	}
+
+	http_threadpool = ast_threadpool_create("httpd", NULL, &options);
+	if (!http_threadpool) {
+		ast_log(LOG_WARNING, "Unable to create the HTTP worker threads\n");
+		return;
+	}
+	if (ast_alertpipe_init(http_poller_alert)
+		|| ast_pthread_create_background(&http_poller_thread, NULL, httpd_poller, NULL)) {
+		/* Connections keep their threads instead */
+		ast_log(LOG_WARNING, "Unable to start the HTTP poller thread\n");
+		ast_alertpipe_close(http_poller_alert);
+		http_poller_thread = AST_PTHREADT_NULL;
+	}
+}
+
+static void httpd_workers_stop(void)
+{
+	if (http_poller_thread != AST_PTHREADT_NULL) {
+		ast_mutex_lock(&http_parked_lock);
+		http_poller_stop = 1;
+		ast_alertpipe_write(http_poller_alert);
+		ast_mutex_unlock(&http_parked_lock);
+
+		pthread_join(http_poller_thread, NULL);
+		http_poller_thread = AST_PTHREADT_NULL;
+		ast_alertpipe_close(http_poller_alert);
+	}
+	if (http_threadpool) {
+		ast_threadpool_shutdown(http_threadpool);
+		http_threadpool = NULL;
+	}
+	AST_VECTOR_FREE(&http_parked_new);
+}
+
 static void *httpd_helper_thread(void *data)
 {
 	struct ast_tcptls_session_instance *ser = data;
@@ -1988,32 +2454,13 @@ static void *httpd_helper_thread(void *data)
 	/* We can let the stream wait for data to arrive. */
 	ast_iostream_set_exclusive_input(ser->stream, 1);
 
-	for (;;) {
-		/* Wait for next potential HTTP request message. */
-		ast_iostream_set_timeout_idle_inactivity(ser->stream, timeout, session_inactivity);
-		if (httpd_process_request(ser)) {
-			/* Break the connection or the connection closed */
-			break;
-		}
-		if (!ser->stream) {
-			/* Web-socket or similar that took the connection */
-			break;
-		}
-
-		timeout = session_keep_alive;
-		if (timeout <= 0) {
-			/* Persistent connections not enabled. */
-			break;
-		}
+	if (httpd_session_serve(ser, timeout) > 0) {
+		/* The connection was parked or handed to another thread */
+		return NULL;
 	}
 
 done:
-	ast_atomic_fetchadd_int(&session_count, -1);
-
-	ast_debug(1, "HTTP closing session.  Top level\n");
-	ast_tcptls_close_session_file(ser);
-
-	ao2_ref(ser, -1);
+	httpd_session_close(ser);
 	return NULL;
 }
 
@@ -2422,6 +2869,7 @@ static int __ast_http_load(int reload)
 	session_limit = DEFAULT_SESSION_LIMIT;
 	session_inactivity = DEFAULT_SESSION_INACTIVITY;
 	session_keep_alive = DEFAULT_SESSION_KEEP_ALIVE;
+	http_worker_threads = 0;
 
 	snprintf(server_name, sizeof(server_name), "Asterisk/%s", ast_get_version());
 
@@ -2487,6 +2935,12 @@ static int __ast_http_load(int reload)
 				ast_log(LOG_WARNING, "Invalid %s '%s' at line %d of http.conf\n",
 					v->name, v->value, v->lineno);
 			}
+		} else if (!strcasecmp(v->name, "worker_threads")) {
+			if (ast_parse_arg(v->value, PARSE_INT32 | PARSE_DEFAULT | PARSE_IN_RANGE,
+				&http_worker_threads, 0, 0, INT_MAX)) {
+				ast_log(LOG_WARNING, "Invalid %s '%s' at line %d of http.conf\n",
+					v->name, v->value, v->lineno);
+			}
 		} else {
 			ast_log(LOG_WARNING, "Ignoring unknown option '%s' in http.conf\n", v->name);
 		}
@@ -2500,6 +2954,8 @@ static int __ast_http_load(int reload)
 
 	ast_copy_string(http_server_name, server_name, sizeof(http_server_name));
 
+	httpd_workers_start();
+
 	if (enabled) {
 		http_server_get("http server", bindaddr, bindport, &global_http_server);
 	} else if (global_http_server) {
@@ -2578,6 +3034,9 @@ static char *handle_show_http(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 	ast_cli(a->fd, "HTTP Server Status:\n");
 	ast_cli(a->fd, "Prefix: %s\n", prefix);
 	ast_cli(a->fd, "Server: %s\n", http_server_name);
+	if (http_poller_thread != AST_PTHREADT_NULL && http_worker_threads) {
+		ast_cli(a->fd, "Worker Threads: %d\n", http_worker_threads);
+	}
 	if (!global_http_server) {
 		ast_cli(a->fd, "Server Disabled\n\n");
 	} else {
@@ -2631,6 +3090,8 @@ static int unload_module(void)
 	if (http_tls_cfg.enabled) {
 		ast_tcptls_server_stop(&https_desc);
 	}
+	httpd_workers_stop();
+
 	ast_free(http_tls_cfg.certfile);
 	ast_free(http_tls_cfg.capath);
 	ast_free(http_tls_cfg.pvtfile);
@@ -28,6 +28,7 @@
 #endif
 #include <sys/socket.h>                 /* for shutdown, SHUT_RDWR */
 #include <sys/time.h>                   /* for timeval */
+#include <sys/uio.h>                    /* for writev, iovec */
 
 #include "asterisk/astobj2.h"           /* for ao2_alloc_options, ao2_alloc_... */
 #include "asterisk/logger.h"            /* for ast_debug, ast_log, LOG_ERROR */
@@ -101,6 +102,18 @@ int ast_iostream_wait_for_input(struct ast_iostream *stream, int timeout)
 	return ast_wait_for_input(stream->fd, timeout);
 }
 
+size_t ast_iostream_get_buffered(struct ast_iostream *stream)
+{
+	size_t buffered = stream->rbuflen;
+
+#if defined(DO_SSL)
+	if (stream->ssl) {
+		buffered += SSL_pending(stream->ssl);
+	}
+#endif
+	return buffered;
+}
+
 void ast_iostream_nonblock(struct ast_iostream *stream)
 {
 	ast_fd_set_flags(stream->fd, O_NONBLOCK);
@@ -499,6 +512,99 @@ ssize_t ast_iostream_write(struct ast_iostream *stream, const void *buffer, size
 	}
 }
 
+/*! \brief Most buffers ast_iostream_writev() writes at once */
+#define IOSTREAM_IOV_MAX 16
+
+ssize_t ast_iostream_writev(struct ast_iostream *stream, const struct iovec *iov, int iovcnt)
+{
+	struct iovec pending[IOSTREAM_IOV_MAX];
+	struct timeval start;
+	size_t size = 0;
+	size_t written = 0;
+	ssize_t res;
+	int count;
+	int ms;
+	int i;
+
+	if (!stream || stream->fd == -1) {
+		errno = EBADF;
+		return -1;
+	}
+
+#if defined(DO_SSL)
+	if (stream->ssl) {
+		/* Every write makes records of its own anyway */
+		for (i = 0; i < iovcnt; ++i) {
+			res = ast_iostream_write(stream, iov[i].iov_base, iov[i].iov_len);
+			if (res < 0) {
+				return written ? written : -1;
+			}
+			written += res;
+			if (res != iov[i].iov_len) {
+				break;
+			}
+		}
+		return written;
+	}
+#endif	/* defined(DO_SSL) */
+
+	if (iovcnt > IOSTREAM_IOV_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	count = 0;
+	for (i = 0; i < iovcnt; ++i) {
+		if (iov[i].iov_len) {
+			pending[count++] = iov[i];
+			size += iov[i].iov_len;
+		}
+	}
+	if (!size) {
+		return 0;
+	}
+
+	if (stream->start.tv_sec) {
+		start = stream->start;
+	} else {
+		start = ast_tvnow();
+	}
+
+	i = 0;
+	for (;;) {
+		res = writev(stream->fd, &pending[i], count - i);
+		if (0 < res) {
+			written += res;
+			if (written == size) {
+				return size;
+			}
+			/* Skip what was written and try to write the rest */
+			while (res >= pending[i].iov_len) {
+				res -= pending[i].iov_len;
+				++i;
+			}
+			pending[i].iov_base = (char *) pending[i].iov_base + res;
+			pending[i].iov_len -= res;
+			continue;
+		}
+		if (errno != EINTR && errno != EAGAIN) {
+			/* Not a retryable error. */
+			ast_debug(1, "TCP socket error writing: %s\n", strerror(errno));
+			if (written) {
+				return written;
+			}
+			return -1;
+		}
+		ms = ast_remaining_ms(start, stream->timeout);
+		if (!ms) {
+			/* Report partial write. */
+			ast_debug(1, "TCP timeout writing data\n");
+			return written;
+		}
+		ast_wait_for_output(stream->fd, ms);
+	}
+}
+
 ssize_t ast_iostream_printf(struct ast_iostream *stream, const char *format, ...)
 {
 	char sbuf[512], *buf = sbuf;
@@ -538,6 +538,302 @@ int ast_json_dump_new_file_format(struct ast_json *root, const char *path, enum
 	return json_dump_file((json_t *)root, path, dump_flags(format));
 }
 
+/*!
+ * \internal
+ * \brief Append text to what a JSON writer wrote
+ */
+static void writer_append(struct ast_json_writer *writer, const char *text, size_t len)
+{
+	if (!writer->error && len && write_to_ast_str(text, len, writer->buf)) {
+		writer->error = 1;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Append a string to what a JSON writer wrote, quoted and escaped
+ */
+static void writer_append_string(struct ast_json_writer *writer, const char *str)
+{
+	const char *run = str;
+	const char *pos;
+
+	if (!ast_json_utf8_check(str)) {
+		writer->error = 1;
+		return;
+	}
+
+	writer_append(writer, "\"", 1);
+	for (pos = str; *pos; ++pos) {
+		unsigned char ch = *pos;
+		char escape[7];
+
+		if (ch >= 0x20 && ch != '"' && ch != '\\') {
+			continue;
+		}
+
+		writer_append(writer, run, pos - run);
+		run = pos + 1;
+
+		switch (ch) {
+		case '"':
+		case '\\':
+			escape[0] = '\\';
+			escape[1] = ch;
+			escape[2] = '\0';
+			break;
+		case '\b':
+			strcpy(escape, "\\b");
+			break;
+		case '\f':
+			strcpy(escape, "\\f");
+			break;
+		case '\n':
+			strcpy(escape, "\\n");
+			break;
+		case '\r':
+			strcpy(escape, "\\r");
+			break;
+		case '\t':
+			strcpy(escape, "\\t");
+			break;
+		default:
+			snprintf(escape, sizeof(escape), "\\u%04X", ch);
+			break;
+		}
+		writer_append(writer, escape, strlen(escape));
+	}
+	writer_append(writer, run, pos - run);
+	writer_append(writer, "\"", 1);
+}
+
+/*!
+ * \internal
+ * \brief Check a value may be written next, separating it from the one before
+ *
+ * \retval 0 if it may.
+ * \retval -1 if not, or writing already failed.
+ */
+static int writer_value_start(struct ast_json_writer *writer)
+{
+	unsigned int bit;
+
+	if (writer->error) {
+		return -1;
+	}
+
+	if (!writer->depth) {
+		if (writer->done) {
+			writer->error = 1;
+			return -1;
+		}
+		return 0;
+	}
+
+	bit = 1U << (writer->depth - 1);
+	if (writer->objects & bit) {
+		if (!writer->key) {
+			writer->error = 1;
+			return -1;
+		}
+		writer->key = 0;
+		return 0;
+	}
+
+	if (writer->members & bit) {
+		writer_append(writer, ",", 1);
+	}
+	writer->members |= bit;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Note a value was written
+ */
+static void writer_value_end(struct ast_json_writer *writer)
+{
+	if (!writer->depth) {
+		writer->done = 1;
+	}
+}
+
+static void writer_container_start(struct ast_json_writer *writer, int object)
+{
+	unsigned int bit;
+
+	if (writer_value_start(writer)) {
+		return;
+	}
+
+	if (writer->depth == AST_JSON_WRITER_MAX_DEPTH) {
+		writer->error = 1;
+		return;
+	}
+
+	bit = 1U << writer->depth++;
+	if (object) {
+		writer->objects |= bit;
+	} else {
+		writer->objects &= ~bit;
+	}
+	writer->members &= ~bit;
+
+	writer_append(writer, object ? "{" : "[", 1);
+}
+
+static void writer_container_end(struct ast_json_writer *writer, int object)
+{
+	if (writer->error) {
+		return;
+	}
+
+	if (!writer->depth || writer->key
+		|| !(writer->objects & (1U << (writer->depth - 1))) != !object) {
+		writer->error = 1;
+		return;
+	}
+
+	--writer->depth;
+	writer_append(writer, object ? "}" : "]", 1);
+	writer_value_end(writer);
+}
+
+void ast_json_writer_init(struct ast_json_writer *writer, struct ast_str **buf)
+{
+	memset(writer, 0, sizeof(*writer));
+	writer->buf = buf;
+}
+
+int ast_json_writer_finish(struct ast_json_writer *writer)
+{
+	return writer->error || !writer->done ? -1 : 0;
+}
+
+void ast_json_writer_object_start(struct ast_json_writer *writer)
+{
+	writer_container_start(writer, 1);
+}
+
+void ast_json_writer_object_end(struct ast_json_writer *writer)
+{
+	writer_container_end(writer, 1);
+}
+
+void ast_json_writer_array_start(struct ast_json_writer *writer)
+{
+	writer_container_start(writer, 0);
+}
+
+void ast_json_writer_array_end(struct ast_json_writer *writer)
+{
+	writer_container_end(writer, 0);
+}
+
+void ast_json_writer_key(struct ast_json_writer *writer, const char *key)
+{
+	unsigned int bit;
+
+	if (writer->error) {
+		return;
+	}
+
+	if (!writer->depth || writer->key || !key
+		|| !(writer->objects & (1U << (writer->depth - 1)))) {
+		writer->error = 1;
+		return;
+	}
+
+	bit = 1U << (writer->depth - 1);
+	if (writer->members & bit) {
+		writer_append(writer, ",", 1);
+	}
+	writer->members |= bit;
+
+	writer_append_string(writer, key);
+	writer_append(writer, ":", 1);
+	writer->key = 1;
+}
+
+void ast_json_writer_string(struct ast_json_writer *writer, const char *value)
+{
+	if (!value) {
+		ast_json_writer_null(writer);
+		return;
+	}
+
+	if (writer_value_start(writer)) {
+		return;
+	}
+	writer_append_string(writer, value);
+	writer_value_end(writer);
+}
+
+void ast_json_writer_integer(struct ast_json_writer *writer, intmax_t value)
+{
+	char buf[32];
+
+	if (writer_value_start(writer)) {
+		return;
+	}
+	writer_append(writer, buf, snprintf(buf, sizeof(buf), "%jd", value));
+	writer_value_end(writer);
+}
+
+void ast_json_writer_boolean(struct ast_json_writer *writer, int value)
+{
+	if (writer_value_start(writer)) {
+		return;
+	}
+	if (value) {
+		writer_append(writer, "true", 4);
+	} else {
+		writer_append(writer, "false", 5);
+	}
+	writer_value_end(writer);
+}
+
+void ast_json_writer_null(struct ast_json_writer *writer)
+{
+	if (writer_value_start(writer)) {
+		return;
+	}
+	writer_append(writer, "null", 4);
+	writer_value_end(writer);
+}
+
+void ast_json_writer_timeval(struct ast_json_writer *writer, const struct timeval tv, const char *zone)
+{
+	char buf[AST_ISO8601_LEN];
+	struct ast_tm tm = {};
+
+	ast_localtime(&tv, &tm, zone);
+
+	ast_strftime(buf, sizeof(buf), AST_ISO8601_FORMAT, &tm);
+
+	ast_json_writer_string(writer, buf);
+}
+
+void ast_json_writer_json(struct ast_json_writer *writer, struct ast_json *value)
+{
+	if (writer_value_start(writer)) {
+		return;
+	}
+	if (!value || json_dump_callback((json_t *)value, write_to_ast_str, writer->buf,
+			JSON_COMPACT | JSON_ENCODE_ANY)) {
+		writer->error = 1;
+		return;
+	}
+	writer_value_end(writer);
+}
+
+void ast_json_writer_member_string(struct ast_json_writer *writer, const char *key, const char *value)
+{
+	ast_json_writer_key(writer, key);
+	ast_json_writer_string(writer, value);
+}
+
 /*!
  * \brief Copy Jansson error struct to ours.
  */
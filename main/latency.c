@@ -0,0 +1,379 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Latency histograms
+ *
+ * Each histogram has a number of shards, and each thread records into the
+ * shard it was given the first time it recorded anything.  Recording is
+ * only ever a relaxed atomic addition, so it never takes a lock, and the
+ * counts are only summed over the shards when they are shown.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/_private.h"
+#include "asterisk/cli.h"
+#include "asterisk/latency.h"
+#include "asterisk/lock.h"
+#include "asterisk/threadstorage.h"
+#include "asterisk/utils.h"
+#include "asterisk/vector.h"
+
+/*! \brief How many shards each histogram is split into */
+#define LATENCY_SHARDS 16
+
+/*! \brief Each power of two is split into 1 << LATENCY_SUB_BITS buckets */
+#define LATENCY_SUB_BITS 3
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+
+/*! \brief Latencies at or above 1 << LATENCY_MAX_BITS ns, about 36 minutes, share the last bucket */
+#define LATENCY_MAX_BITS 41
+
+/*! \brief One shard of a histogram, padded to a whole number of cache lines */
+struct latency_shard {
+	uint64_t sum;
+	uint64_t buckets[AST_LATENCY_BUCKETS];
+	uint64_t padding[7];
+};
+
+struct ast_latency_histogram {
+	struct latency_shard shards[LATENCY_SHARDS];
+	char *description;
+	char name[0];
+};
+
+AST_VECTOR(latency_histograms, struct ast_latency_histogram *);
+
+static struct latency_histograms histograms;
+AST_MUTEX_DEFINE_STATIC(histograms_lock);
+
+/*! \brief The shard of each thread, plus one so that 0 is none yet */
+AST_THREADSTORAGE(latency_shard_index);
+
+static unsigned int next_shard;
+
+/*!
+ * \internal
+ * \brief Find the bucket of a latency
+ *
+ * Latencies below 2 * LATENCY_SUB_BUCKETS ns have a bucket each.  Above
+ * that each power of two has LATENCY_SUB_BUCKETS buckets, told apart by
+ * the bits below the highest one set.
+ */
+static force_inline unsigned int latency_bucket(uint64_t ns)
+{
+	unsigned int exponent;
+
+	if (ns < 2 * LATENCY_SUB_BUCKETS) {
+		return ns;
+	}
+	if (ns >= (UINT64_C(1) << LATENCY_MAX_BITS)) {
+		return AST_LATENCY_BUCKETS - 1;
+	}
+
+	exponent = 63 - __builtin_clzll(ns);
+	return (exponent - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS
+		+ ((ns >> (exponent - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+/*! \brief The lowest latency that falls in a bucket */
+static uint64_t latency_bucket_lowest(unsigned int bucket)
+{
+	unsigned int exponent;
+
+	if (bucket < 2 * LATENCY_SUB_BUCKETS) {
+		return bucket;
+	}
+
+	exponent = bucket / LATENCY_SUB_BUCKETS + LATENCY_SUB_BITS - 1;
+	return (uint64_t) (LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS)
+		<< (exponent - LATENCY_SUB_BITS);
+}
+
+/*! \brief The highest latency that falls in a bucket */
+static uint64_t latency_bucket_highest(unsigned int bucket)
+{
+	if (bucket == AST_LATENCY_BUCKETS - 1) {
+		return UINT64_MAX;
+	}
+	return latency_bucket_lowest(bucket + 1) - 1;
+}
+
+void ast_latency_record(struct ast_latency_histogram *histogram, uint64_t ns)
+{
+	unsigned int *index;
+	struct latency_shard *shard;
+
+	if (!histogram) {
+		return;
+	}
+
+	index = ast_threadstorage_get(&latency_shard_index, sizeof(*index));
+	if (!index) {
+		return;
+	}
+	if (!*index) {
+		*index = ast_atomic_fetch_add(&next_shard, 1, __ATOMIC_RELAXED) % LATENCY_SHARDS + 1;
+	}
+
+	shard = &histogram->shards[*index - 1];
+	ast_atomic_fetch_add(&shard->buckets[latency_bucket(ns)], 1, __ATOMIC_RELAXED);
+	ast_atomic_fetch_add(&shard->sum, ns, __ATOMIC_RELAXED);
+}
+
+struct ast_latency_histogram *ast_latency_histogram_get(const char *name, const char *description)
+{
+	struct ast_latency_histogram *histogram;
+	size_t name_len = strlen(name) + 1;
+	int i;
+
+	ast_mutex_lock(&histograms_lock);
+	for (i = 0; i < AST_VECTOR_SIZE(&histograms); i++) {
+		histogram = AST_VECTOR_GET(&histograms, i);
+		if (!strcmp(histogram->name, name)) {
+			ast_mutex_unlock(&histograms_lock);
+			return histogram;
+		}
+	}
+
+	histogram = ast_calloc(1, sizeof(*histogram) + name_len + strlen(description) + 1);
+	if (!histogram) {
+		ast_mutex_unlock(&histograms_lock);
+		return NULL;
+	}
+	strcpy(histogram->name, name); /* Safe */
+	histogram->description = histogram->name + name_len;
+	strcpy(histogram->description, description); /* Safe */
+
+	if (AST_VECTOR_APPEND(&histograms, histogram)) {
+		ast_free(histogram);
+		histogram = NULL;
+	}
+	ast_mutex_unlock(&histograms_lock);
+
+	return histogram;
+}
+
+/*!
+ * \internal
+ * \brief Sum the shards of a histogram
+ */
+static void latency_histogram_snapshot(struct ast_latency_histogram *histogram,
+	struct ast_latency_snapshot *snapshot)
+{
+	int shard;
+	int i;
+
+	memset(snapshot, 0, sizeof(*snapshot));
+	snapshot->name = histogram->name;
+	snapshot->description = histogram->description;
+
+	for (shard = 0; shard < LATENCY_SHARDS; shard++) {
+		snapshot->sum += ast_atomic_load_n(&histogram->shards[shard].sum, __ATOMIC_RELAXED);
+		for (i = 0; i < AST_LATENCY_BUCKETS; i++) {
+			snapshot->buckets[i] += ast_atomic_load_n(&histogram->shards[shard].buckets[i], __ATOMIC_RELAXED);
+		}
+	}
+
+	for (i = 0; i < AST_LATENCY_BUCKETS; i++) {
+		snapshot->count += snapshot->buckets[i];
+	}
+}
+
+void ast_latency_histograms_snapshot(ast_latency_snapshot_cb callback, void *data)
+{
+	struct ast_latency_snapshot *snapshot;
+	int i;
+
+	/* Too big for the stacks of some of the threads this is called on */
+	snapshot = ast_malloc(sizeof(*snapshot));
+	if (!snapshot) {
+		return;
+	}
+
+	ast_mutex_lock(&histograms_lock);
+	for (i = 0; i < AST_VECTOR_SIZE(&histograms); i++) {
+		latency_histogram_snapshot(AST_VECTOR_GET(&histograms, i), snapshot);
+		callback(snapshot, data);
+	}
+	ast_mutex_unlock(&histograms_lock);
+
+	ast_free(snapshot);
+}
+
+uint64_t ast_latency_snapshot_count_le(const struct ast_latency_snapshot *snapshot, uint64_t ns)
+{
+	uint64_t count = 0;
+	int i;
+
+	for (i = 0; i < AST_LATENCY_BUCKETS && latency_bucket_lowest(i) <= ns; i++) {
+		count += snapshot->buckets[i];
+	}
+
+	return count;
+}
+
+uint64_t ast_latency_snapshot_percentile(const struct ast_latency_snapshot *snapshot, double percentile)
+{
+	uint64_t rank;
+	uint64_t count = 0;
+	int i;
+
+	if (!snapshot->count) {
+		return 0;
+	}
+
+	/* The rank of the latency wanted, counting from 1 */
+	rank = (uint64_t) (snapshot->count * percentile / 100.0 + 0.5);
+	rank = MAX(rank, 1);
+
+	for (i = 0; i < AST_LATENCY_BUCKETS; i++) {
+		count += snapshot->buckets[i];
+		if (count >= rank) {
+			return latency_bucket_highest(i);
+		}
+	}
+
+	return latency_bucket_highest(AST_LATENCY_BUCKETS - 1);
+}
+
+/*! \brief Print a latency in nanoseconds as microseconds */
+static const char *latency_format(char *buf, size_t size, uint64_t ns)
+{
+	if (ns == UINT64_MAX) {
+		ast_copy_string(buf, "-", size);
+	} else {
+		snprintf(buf, size, "%" PRIu64 ".%" PRIu64, ns / 1000, ns % 1000 / 100);
+	}
+	return buf;
+}
+
+static void latency_show_one(const struct ast_latency_snapshot *snapshot, void *data)
+{
+#define FORMAT "%-24s %10" PRIu64 " %10s %10s %10s %10s %10s\n"
+	struct ast_cli_args *a = data;
+	char mean[24];
+	char p50[24];
+	char p90[24];
+	char p99[24];
+	char p999[24];
+
+	ast_cli(a->fd, FORMAT, snapshot->name, snapshot->count,
+		latency_format(mean, sizeof(mean), snapshot->count ? snapshot->sum / snapshot->count : 0),
+		latency_format(p50, sizeof(p50), ast_latency_snapshot_percentile(snapshot, 50)),
+		latency_format(p90, sizeof(p90), ast_latency_snapshot_percentile(snapshot, 90)),
+		latency_format(p99, sizeof(p99), ast_latency_snapshot_percentile(snapshot, 99)),
+		latency_format(p999, sizeof(p999), ast_latency_snapshot_percentile(snapshot, 99.9)));
+#undef FORMAT
+}
+
+static char *handle_core_show_latency(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show latency";
+		e->usage =
+			"Usage: core show latency\n"
+			"       Shows how many latencies each latency histogram recorded, their\n"
+			"       mean and their 50th, 90th, 99th and 99.9th percentiles, in\n"
+			"       microseconds.  Percentiles are the top of the bucket they fall\n"
+			"       in, so are up to 12.5% high.\n"
+			"       Requires latency_histograms to be enabled in asterisk.conf.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!ast_option_latency_histograms) {
+		ast_cli(a->fd, "Latency histograms are disabled.  Enable latency_histograms in asterisk.conf.\n");
+	}
+
+	ast_cli(a->fd, "%-24s %10s %10s %10s %10s %10s %10s\n",
+		"Histogram", "Count", "Mean (us)", "50% (us)", "90% (us)", "99% (us)", "99.9% (us)");
+	ast_latency_histograms_snapshot(latency_show_one, a);
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_core_reset_latency(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core reset latency";
+		e->usage =
+			"Usage: core reset latency\n"
+			"       Empties every latency histogram.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&histograms_lock);
+	for (i = 0; i < AST_VECTOR_SIZE(&histograms); i++) {
+		struct ast_latency_histogram *histogram = AST_VECTOR_GET(&histograms, i);
+		int shard;
+		int bucket;
+
+		/* Anything recorded while this runs may be lost, which does not matter here */
+		for (shard = 0; shard < LATENCY_SHARDS; shard++) {
+			ast_atomic_store_n(&histogram->shards[shard].sum, 0, __ATOMIC_RELAXED);
+			for (bucket = 0; bucket < AST_LATENCY_BUCKETS; bucket++) {
+				ast_atomic_store_n(&histogram->shards[shard].buckets[bucket], 0, __ATOMIC_RELAXED);
+			}
+		}
+	}
+	ast_mutex_unlock(&histograms_lock);
+
+	ast_cli(a->fd, "Latency histograms reset.\n");
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_latency[] = {
+	AST_CLI_DEFINE(handle_core_show_latency, "Show internal latency histograms"),
+	AST_CLI_DEFINE(handle_core_reset_latency, "Empty internal latency histograms"),
+};
+
+static void latency_shutdown(void)
+{
+	ast_cli_unregister_multiple(cli_latency, ARRAY_LEN(cli_latency));
+
+	/* Histograms may still be recorded into by threads that outlive this, so they are kept */
+}
+
+int ast_latency_init(void)
+{
+	ast_cli_register_multiple(cli_latency, ARRAY_LEN(cli_latency));
+	ast_register_cleanup(latency_shutdown);
+
+	return 0;
+}
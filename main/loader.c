@@ -315,6 +315,8 @@ struct ast_module {
 	 * to this list with a reference.
 	 */
 	struct module_vector reffed_deps;
+	/*! How long the load function of the module took, in microseconds. */
+	int64_t load_time;
 	struct {
 		/*! The module running and ready to accept requests. */
 		unsigned int running:1;
@@ -1838,6 +1840,7 @@ static enum ast_module_load_result start_resource(struct ast_module *mod)
 {
 	char tmp[256];
 	enum ast_module_load_result res;
+	struct timeval start;
 
 	if (mod->flags.running) {
 		return AST_MODULE_LOAD_SUCCESS;
@@ -1869,7 +1872,10 @@ static enum ast_module_load_result start_resource(struct ast_module *mod)
 	if (!ast_fully_booted) {
 		ast_verb(4, "Loading %s.\n", mod->resource);
 	}
+	start = ast_tvnow();
 	res = mod->info->load();
+	mod->load_time = ast_tvdiff_us(ast_tvnow(), start);
+	ast_startup_profile_record("module", mod->resource, start);
 
 	switch (res) {
 	case AST_MODULE_LOAD_SUCCESS:
@@ -2505,6 +2511,67 @@ done:
 	return res;
 }
 
+/*! The number of modules listed in the startup timing report at verbose level 2. */
+#define LOAD_TIME_REPORT_SLOWEST 10
+
+static int module_vector_load_time_cmp(struct ast_module *a, struct ast_module *b)
+{
+	if (a->load_time == b->load_time) {
+		return strcasecmp(a->resource, b->resource);
+	}
+
+	return a->load_time < b->load_time ? 1 : -1;
+}
+
+/*!
+ * \internal
+ * \brief Report how long the load function of each started module took.
+ *
+ * The slowest modules are listed at verbose level 2, all of them with debug.
+ *
+ * \pre module_list must be locked.
+ */
+static void load_time_report(void)
+{
+	struct module_vector by_time;
+	struct ast_module *cur;
+	int64_t total = 0;
+	int i;
+
+	if (AST_VECTOR_INIT(&by_time, 32)) {
+		return;
+	}
+
+	AST_DLLIST_TRAVERSE(&module_list, cur, entry) {
+		if (!cur->flags.running || !cur->load_time) {
+			continue;
+		}
+		if (AST_VECTOR_ADD_SORTED(&by_time, cur, module_vector_load_time_cmp)) {
+			AST_VECTOR_FREE(&by_time);
+			return;
+		}
+		total += cur->load_time;
+	}
+
+	if (AST_VECTOR_SIZE(&by_time)) {
+		ast_verb(2, "Module load functions took %" PRId64 ".%06" PRId64 " seconds, the slowest were:\n",
+			total / 1000000, total % 1000000);
+	}
+	for (i = 0; i < AST_VECTOR_SIZE(&by_time); i++) {
+		cur = AST_VECTOR_GET(&by_time, i);
+
+		if (i < LOAD_TIME_REPORT_SLOWEST) {
+			ast_verb(2, "  %-40s %8" PRId64 ".%03" PRId64 " ms\n", cur->resource,
+				cur->load_time / 1000, cur->load_time % 1000);
+		} else {
+			ast_debug(1, "  %-40s %8" PRId64 ".%03" PRId64 " ms\n", cur->resource,
+				cur->load_time / 1000, cur->load_time % 1000);
+		}
+	}
+
+	AST_VECTOR_FREE(&by_time);
+}
+
 int load_modules(void)
 {
 	struct load_order_entry *order;
@@ -2669,6 +2736,8 @@ done:
 	ast_free(warning_msg);
 #endif
 
+	load_time_report();
+
 	AST_DLLIST_UNLOCK(&module_list);
 
 
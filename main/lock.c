@@ -54,6 +54,321 @@ static void __attribute__((constructor)) __mtx_init(void)
 #undef pthread_cond_wait
 #undef pthread_cond_timedwait
 
+unsigned int ast_lock_contention_threshold = 1000;
+
+/*! \brief How many contentions each thread holds before adding them to the sites */
+#define LOCK_CONTENTION_RECORDS 32
+
+/*! \brief How many places locks can be recorded as contended at, a power of two */
+#define LOCK_CONTENTION_SITES 1024
+
+/*! \brief How much of the file, function and lock names is kept */
+#define LOCK_CONTENTION_NAME 64
+
+/*!
+ * \brief A place a lock was contended at
+ *
+ * The names are copied, as the module they point into may be unloaded
+ * before they are looked at.
+ */
+struct lock_contention_site {
+	char file[LOCK_CONTENTION_NAME];
+	char func[LOCK_CONTENTION_NAME];
+	char name[LOCK_CONTENTION_NAME];
+	int line;
+	uint64_t count;
+	uint64_t total;
+	uint64_t max;
+};
+
+/*!
+ * \brief The contentions of a thread that have not been added to the sites yet
+ *
+ * Only the thread itself and ast_lock_contention_foreach() take the lock
+ * of a buffer, so it is all but never contended itself.
+ */
+struct lock_contention_buffer {
+	pthread_mutex_t lock;
+	unsigned int used;
+	struct lock_contention_buffer *prev;
+	struct lock_contention_buffer *next;
+	struct lock_contention_site records[LOCK_CONTENTION_RECORDS];
+};
+
+/*!
+ * \brief The places locks were contended at, by hash
+ *
+ * These use pthread locks directly, as anything recording contention
+ * must not record contention.
+ */
+static struct lock_contention_site lock_contention_sites[LOCK_CONTENTION_SITES];
+static uint64_t lock_contention_dropped;
+static pthread_mutex_t lock_contention_sites_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*! \brief The buffers of every thread that recorded a contention */
+static struct lock_contention_buffer *lock_contention_buffers;
+static pthread_mutex_t lock_contention_buffers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_key_t lock_contention_key;
+static pthread_once_t lock_contention_once = PTHREAD_ONCE_INIT;
+
+static uint64_t lock_contention_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*!
+ * \internal
+ * \brief Start timing taking a lock that was found to be held
+ *
+ * \retval 0 if contention is not being recorded
+ */
+static inline uint64_t lock_contention_start(void)
+{
+	return ast_lock_contention_threshold ? lock_contention_now() : 0;
+}
+
+/*!
+ * \internal
+ * \brief Add a contention to the sites
+ *
+ * \pre lock_contention_sites_lock is held
+ */
+static void lock_contention_site_add(const struct lock_contention_site *record)
+{
+	unsigned int hash = record->line;
+	unsigned int i;
+	const char *c;
+
+	for (c = record->file; *c; c++) {
+		hash = hash * 31 + *c;
+	}
+	for (c = record->name; *c; c++) {
+		hash = hash * 31 + *c;
+	}
+
+	for (i = 0; i < LOCK_CONTENTION_SITES; i++) {
+		struct lock_contention_site *site = &lock_contention_sites[(hash + i) & (LOCK_CONTENTION_SITES - 1)];
+
+		if (!site->count) {
+			*site = *record;
+			return;
+		}
+		if (site->line == record->line && !strcmp(site->file, record->file)
+			&& !strcmp(site->name, record->name)) {
+			site->count += record->count;
+			site->total += record->total;
+			site->max = MAX(site->max, record->max);
+			return;
+		}
+	}
+
+	lock_contention_dropped += record->count;
+}
+
+/*!
+ * \internal
+ * \brief Add the contentions of a thread to the sites
+ *
+ * \pre The lock of the buffer is held
+ */
+static void lock_contention_buffer_drain(struct lock_contention_buffer *buffer)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&lock_contention_sites_lock);
+	for (i = 0; i < buffer->used; i++) {
+		lock_contention_site_add(&buffer->records[i]);
+	}
+	pthread_mutex_unlock(&lock_contention_sites_lock);
+	buffer->used = 0;
+}
+
+static void lock_contention_buffer_destroy(void *data)
+{
+	struct lock_contention_buffer *buffer = data;
+
+	pthread_mutex_lock(&lock_contention_buffers_lock);
+	if (buffer->prev) {
+		buffer->prev->next = buffer->next;
+	} else {
+		lock_contention_buffers = buffer->next;
+	}
+	if (buffer->next) {
+		buffer->next->prev = buffer->prev;
+	}
+	pthread_mutex_unlock(&lock_contention_buffers_lock);
+
+	pthread_mutex_lock(&buffer->lock);
+	lock_contention_buffer_drain(buffer);
+	pthread_mutex_unlock(&buffer->lock);
+
+	pthread_mutex_destroy(&buffer->lock);
+	ast_std_free(buffer);
+}
+
+static void lock_contention_key_create(void)
+{
+	pthread_key_create(&lock_contention_key, lock_contention_buffer_destroy);
+}
+
+static struct lock_contention_buffer *lock_contention_buffer_get(void)
+{
+	struct lock_contention_buffer *buffer;
+
+	pthread_once(&lock_contention_once, lock_contention_key_create);
+	buffer = pthread_getspecific(lock_contention_key);
+	if (buffer) {
+		return buffer;
+	}
+
+	buffer = ast_std_calloc(1, sizeof(*buffer));
+	if (!buffer) {
+		return NULL;
+	}
+	pthread_mutex_init(&buffer->lock, NULL);
+	if (pthread_setspecific(lock_contention_key, buffer)) {
+		pthread_mutex_destroy(&buffer->lock);
+		ast_std_free(buffer);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&lock_contention_buffers_lock);
+	buffer->next = lock_contention_buffers;
+	if (buffer->next) {
+		buffer->next->prev = buffer;
+	}
+	lock_contention_buffers = buffer;
+	pthread_mutex_unlock(&lock_contention_buffers_lock);
+
+	return buffer;
+}
+
+/*!
+ * \internal
+ * \brief Record taking a lock that was found to be held, if it blocked long enough
+ *
+ * \param start What lock_contention_start() returned
+ */
+static void lock_contention_end(uint64_t start, const char *file, int line,
+	const char *func, const char *name)
+{
+	struct lock_contention_buffer *buffer;
+	struct lock_contention_site *record;
+	uint64_t wait;
+
+	if (!start) {
+		return;
+	}
+
+	wait = lock_contention_now() - start;
+	if (wait < (uint64_t) ast_lock_contention_threshold * 1000) {
+		return;
+	}
+
+	buffer = lock_contention_buffer_get();
+	if (!buffer) {
+		return;
+	}
+
+	pthread_mutex_lock(&buffer->lock);
+	if (buffer->used == LOCK_CONTENTION_RECORDS) {
+		lock_contention_buffer_drain(buffer);
+	}
+	record = &buffer->records[buffer->used++];
+	ast_copy_string(record->file, file, sizeof(record->file));
+	ast_copy_string(record->func, func, sizeof(record->func));
+	ast_copy_string(record->name, name, sizeof(record->name));
+	record->line = line;
+	record->count = 1;
+	record->total = wait;
+	record->max = wait;
+	pthread_mutex_unlock(&buffer->lock);
+}
+
+static int lock_contention_cmp(const void *left, const void *right)
+{
+	const struct lock_contention_site *a = left;
+	const struct lock_contention_site *b = right;
+
+	if (a->total != b->total) {
+		return a->total > b->total ? -1 : 1;
+	}
+	return 0;
+}
+
+uint64_t ast_lock_contention_foreach(ast_lock_contention_cb callback, void *data)
+{
+	struct lock_contention_buffer *buffer;
+	struct lock_contention_site *sites;
+	uint64_t dropped;
+	size_t count = 0;
+	size_t i;
+
+	/* Pick up what every thread has recorded so far */
+	pthread_mutex_lock(&lock_contention_buffers_lock);
+	for (buffer = lock_contention_buffers; buffer; buffer = buffer->next) {
+		pthread_mutex_lock(&buffer->lock);
+		lock_contention_buffer_drain(buffer);
+		pthread_mutex_unlock(&buffer->lock);
+	}
+	pthread_mutex_unlock(&lock_contention_buffers_lock);
+
+	sites = ast_std_malloc(sizeof(lock_contention_sites));
+	if (!sites) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&lock_contention_sites_lock);
+	for (i = 0; i < LOCK_CONTENTION_SITES; i++) {
+		if (lock_contention_sites[i].count) {
+			sites[count++] = lock_contention_sites[i];
+		}
+	}
+	dropped = lock_contention_dropped;
+	pthread_mutex_unlock(&lock_contention_sites_lock);
+
+	qsort(sites, count, sizeof(*sites), lock_contention_cmp);
+
+	for (i = 0; i < count; i++) {
+		struct ast_lock_contention contention = {
+			.file = sites[i].file,
+			.line = sites[i].line,
+			.func = sites[i].func,
+			.name = sites[i].name,
+			.count = sites[i].count,
+			.total = sites[i].total,
+			.max = sites[i].max,
+		};
+
+		callback(&contention, data);
+	}
+	ast_std_free(sites);
+
+	return dropped;
+}
+
+void ast_lock_contention_reset(void)
+{
+	struct lock_contention_buffer *buffer;
+
+	pthread_mutex_lock(&lock_contention_buffers_lock);
+	for (buffer = lock_contention_buffers; buffer; buffer = buffer->next) {
+		pthread_mutex_lock(&buffer->lock);
+		buffer->used = 0;
+		pthread_mutex_unlock(&buffer->lock);
+	}
+	pthread_mutex_unlock(&lock_contention_buffers_lock);
+
+	pthread_mutex_lock(&lock_contention_sites_lock);
+	memset(lock_contention_sites, 0, sizeof(lock_contention_sites));
+	lock_contention_dropped = 0;
+	pthread_mutex_unlock(&lock_contention_sites_lock);
+}
+
 #if defined(DEBUG_THREADS) || defined(DETECT_DEADLOCKS)
 #define log_mutex_error(canlog, ...) \
 	do { \
@@ -346,11 +661,18 @@ int __ast_pthread_mutex_lock(const char *filename, int lineno, const char *func,
 #else /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
 #ifdef	HAVE_MTX_PROFILE
 	ast_mark(mtx_prof, 1);
+#endif
+	/* Only locks found to be held pay for timing how long they block */
 	res = pthread_mutex_trylock(&t->mutex);
+#ifdef	HAVE_MTX_PROFILE
 	ast_mark(mtx_prof, 0);
-	if (res)
 #endif
-	res = pthread_mutex_lock(&t->mutex);
+	if (res == EBUSY) {
+		uint64_t start = lock_contention_start();
+
+		res = pthread_mutex_lock(&t->mutex);
+		lock_contention_end(start, filename, lineno, func, mutex_name);
+	}
 #endif /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
 
 #ifdef DEBUG_THREADS
@@ -911,7 +1233,13 @@ int __ast_rwlock_rdlock(const char *filename, int line, const char *func,
 		} while (res == EBUSY);
 	}
 #else /* !DETECT_DEADLOCKS */
-	res = pthread_rwlock_rdlock(&t->lock);
+	res = pthread_rwlock_tryrdlock(&t->lock);
+	if (res == EBUSY) {
+		uint64_t start = lock_contention_start();
+
+		res = pthread_rwlock_rdlock(&t->lock);
+		lock_contention_end(start, filename, line, func, name);
+	}
 #endif /* !DETECT_DEADLOCKS */
 
 #ifdef DEBUG_THREADS
@@ -1015,7 +1343,13 @@ int __ast_rwlock_wrlock(const char *filename, int line, const char *func, \
 		} while (res == EBUSY);
 	}
 #else /* !DETECT_DEADLOCKS */
-	res = pthread_rwlock_wrlock(&t->lock);
+	res = pthread_rwlock_trywrlock(&t->lock);
+	if (res == EBUSY) {
+		uint64_t start = lock_contention_start();
+
+		res = pthread_rwlock_wrlock(&t->lock);
+		lock_contention_end(start, filename, line, func, name);
+	}
 #endif /* !DETECT_DEADLOCKS */
 
 #ifdef DEBUG_THREADS
@@ -0,0 +1,149 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Lock contention reporting
+ *
+ * The contention itself is recorded by lock.c, which is also built into
+ * utilities that have no CLI, so showing it lives here.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/_private.h"
+#include "asterisk/cli.h"
+#include "asterisk/lock.h"
+#include "asterisk/utils.h"
+
+/*! \brief How many places are shown by default */
+#define LOCK_CONTENTION_SHOW 20
+
+struct lock_contention_show {
+	struct ast_cli_args *a;
+	int limit;
+	int shown;
+	uint64_t places;
+};
+
+static void lock_contention_show_one(const struct ast_lock_contention *contention, void *data)
+{
+#define FORMAT "%-40s %-28s %-24s %10" PRIu64 " %12" PRIu64 " %10" PRIu64 "\n"
+	struct lock_contention_show *show = data;
+	char where[80];
+
+	show->places++;
+	if (show->limit && show->shown >= show->limit) {
+		return;
+	}
+	show->shown++;
+
+	snprintf(where, sizeof(where), "%s:%d", contention->file, contention->line);
+	ast_cli(show->a->fd, FORMAT, where, contention->func, contention->name, contention->count,
+		contention->total / 1000, contention->max / 1000);
+#undef FORMAT
+}
+
+static char *handle_core_show_lock_contention(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct lock_contention_show show = { .a = a, .limit = LOCK_CONTENTION_SHOW, };
+	uint64_t dropped;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show lock contention";
+		e->usage =
+			"Usage: core show lock contention [<count>|all]\n"
+			"       Shows where locks were waited for at least\n"
+			"       lock_contention_threshold microseconds, the lock, how many\n"
+			"       times, and the total and longest waits in microseconds.\n"
+			"       The places waited longest in total are shown first, 20 of\n"
+			"       them unless a count is given.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc == 5) {
+		if (!strcasecmp(a->argv[4], "all")) {
+			show.limit = 0;
+		} else if (sscanf(a->argv[4], "%30d", &show.limit) != 1 || show.limit < 1) {
+			return CLI_SHOWUSAGE;
+		}
+	} else if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!ast_lock_contention_threshold) {
+		ast_cli(a->fd, "Lock contention is not being recorded.  Set lock_contention_threshold in asterisk.conf.\n");
+	}
+
+	ast_cli(a->fd, "%-40s %-28s %-24s %10s %12s %10s\n",
+		"Location", "Function", "Lock", "Count", "Total (us)", "Max (us)");
+	dropped = ast_lock_contention_foreach(lock_contention_show_one, &show);
+	ast_cli(a->fd, "%d of %" PRIu64 " places shown.\n", show.shown, show.places);
+	if (dropped) {
+		ast_cli(a->fd, "%" PRIu64 " contentions were not recorded, too many places were contended.\n",
+			dropped);
+	}
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_core_reset_lock_contention(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core reset lock contention";
+		e->usage =
+			"Usage: core reset lock contention\n"
+			"       Forgets all the lock contention recorded so far.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_lock_contention_reset();
+	ast_cli(a->fd, "Lock contention reset.\n");
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_lock_contention[] = {
+	AST_CLI_DEFINE(handle_core_show_lock_contention, "Show where locks are contended"),
+	AST_CLI_DEFINE(handle_core_reset_lock_contention, "Forget recorded lock contention"),
+};
+
+static void lock_contention_shutdown(void)
+{
+	ast_cli_unregister_multiple(cli_lock_contention, ARRAY_LEN(cli_lock_contention));
+}
+
+int ast_lock_contention_init(void)
+{
+	ast_cli_register_multiple(cli_lock_contention, ARRAY_LEN(cli_lock_contention));
+	ast_register_cleanup(lock_contention_shutdown);
+
+	return 0;
+}
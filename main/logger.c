@@ -47,12 +47,14 @@
 #include <time.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 
 #include "asterisk/_private.h"
 #include "asterisk/module.h"
 #include "asterisk/paths.h"	/* use ast_config_AST_LOG_DIR */
 #include "asterisk/logger.h"
 #include "asterisk/logger_category.h"
+#include "asterisk/logger_binary.h"
 #include "asterisk/lock.h"
 #include "asterisk/channel.h"
 #include "asterisk/config.h"
@@ -70,6 +72,7 @@
 #include "asterisk/ast_version.h"
 #include "asterisk/backtrace.h"
 #include "asterisk/json.h"
+#include "asterisk/sem.h"
 
 /*** DOCUMENTATION
  ***/
@@ -89,6 +92,10 @@ static int queuelog_init;
 static int logger_initialized;
 static volatile int next_unique_callid = 1; /* Used to assign unique call_ids to calls */
 static int display_callids;
+/*! The size of each file of a binary log channel, in MB */
+static unsigned int binary_file_size = 16;
+/*! How many files a binary log channel writes in turn */
+static unsigned int binary_files = 4;
 
 AST_THREADSTORAGE(unique_callid);
 
@@ -121,6 +128,7 @@ AST_THREADSTORAGE_RAW(in_safe_log);
 
 struct logchannel;
 struct logmsg;
+struct log_ring;
 
 struct logformatter {
 	/* The name of the log formatter */
@@ -133,6 +141,7 @@ enum logtypes {
 	LOGTYPE_SYSLOG,
 	LOGTYPE_FILE,
 	LOGTYPE_CONSOLE,
+	LOGTYPE_BINARY,
 };
 
 struct logchannel {
@@ -150,6 +159,8 @@ struct logchannel {
 	enum logtypes type;
 	/*! logfile logging file pointer */
 	FILE *fileptr;
+	/*! The files written by a binary channel */
+	struct log_ring *ring;
 	/*! Filename */
 	char filename[PATH_MAX];
 	/*! field for linking to list */
@@ -177,6 +188,7 @@ struct logmsg {
 	int lwp;
 	ast_callid callid;
 	unsigned int hidecli:1;		/*!< Whether to suppress log message from CLI output (but log normally to other log channels */
+	struct timeval when;		/*!< When the message was logged, turned into the date when it is printed */
 	AST_DECLARE_STRING_FIELDS(
 		AST_STRING_FIELD(date);
 		AST_STRING_FIELD(file);
@@ -193,11 +205,90 @@ static void logmsg_free(struct logmsg *msg)
 	ast_free(msg);
 }
 
-static AST_LIST_HEAD_STATIC(logmsgs, logmsg);
+/*!
+ * \brief Messages waiting for the logger thread
+ *
+ * Any thread appends to the queue by exchanging its head, so logging never
+ * waits on a lock held by the logger thread or another logging thread.  Only
+ * the logger thread takes messages off the tail.
+ */
+static struct {
+	/*! The message appended last */
+	struct logmsg *head;
+	/*! The message to take off next */
+	struct logmsg *tail;
+	/*! Placeholder that keeps the queue from ever being empty */
+	struct logmsg stub;
+} logmsgs = {
+	.head = &logmsgs.stub,
+	.tail = &logmsgs.stub,
+};
+/*! Posted when a message is queued while the logger thread has nothing to do */
+static struct ast_sem logsem;
 static pthread_t logthread = AST_PTHREADT_NULL;
-static ast_cond_t logcond;
 static int close_logger_thread = 0;
 
+static void logmsg_push(struct logmsg *msg)
+{
+	struct logmsg *prev;
+
+	AST_LIST_NEXT(msg, list) = NULL;
+	prev = ast_atomic_exchange_n(&logmsgs.head, msg, __ATOMIC_ACQ_REL);
+	/* Until the previous message is linked to this one the queue ends there */
+	ast_atomic_store_n(&AST_LIST_NEXT(prev, list), msg, __ATOMIC_RELEASE);
+}
+
+/*!
+ * \internal
+ * \brief Take the oldest message off the queue
+ *
+ * \note Only the logger thread, or whoever joined it, may call this.
+ *
+ * \return The message, or NULL if none is fully queued yet
+ */
+static struct logmsg *logmsg_pop(void)
+{
+	struct logmsg *tail = logmsgs.tail;
+	struct logmsg *next = ast_atomic_load_n(&AST_LIST_NEXT(tail, list), __ATOMIC_ACQUIRE);
+
+	if (tail == &logmsgs.stub) {
+		if (!next) {
+			return NULL;
+		}
+		logmsgs.tail = tail = next;
+		next = ast_atomic_load_n(&AST_LIST_NEXT(tail, list), __ATOMIC_ACQUIRE);
+	}
+
+	if (next) {
+		logmsgs.tail = next;
+		return tail;
+	}
+
+	if (tail != ast_atomic_load_n(&logmsgs.head, __ATOMIC_ACQUIRE)) {
+		/* Another message is being linked behind this one */
+		return NULL;
+	}
+
+	/* Put the stub behind the last message so it can be taken off */
+	logmsg_push(&logmsgs.stub);
+	next = ast_atomic_load_n(&AST_LIST_NEXT(tail, list), __ATOMIC_ACQUIRE);
+	if (next) {
+		logmsgs.tail = next;
+		return tail;
+	}
+
+	return NULL;
+}
+
+/*! \brief Queue a message for the logger thread and wake it if it is idle */
+static void logmsg_queue(struct logmsg *msg)
+{
+	logmsg_push(msg);
+	if (!ast_atomic_fetch_add(&logger_queue_size, 1, __ATOMIC_ACQ_REL)) {
+		ast_sem_post(&logsem);
+	}
+}
+
 static FILE *qlog;
 
 /*! \brief Logging channels used in the Asterisk logging system
@@ -409,6 +500,7 @@ static int format_log_default(struct logchannel *chan, struct logmsg *msg, char
 		term_strip(buf, buf, size);
 		break;
 	case LOGTYPE_FILE:
+	case LOGTYPE_BINARY:
 		snprintf(buf, size, "[%s] %s[%d]%s %s: %s",
 		      msg->date, msg->level_name, msg->lwp, call_identifier_str,
 		      msg->file, msg->message);
@@ -478,6 +570,7 @@ static int format_log_plain(struct logchannel *chan, struct logmsg *msg, char *b
 		break;
 	case LOGTYPE_FILE:
 	case LOGTYPE_CONSOLE:
+	case LOGTYPE_BINARY:
 		/* Turn the numerical line number into a string */
 		snprintf(linestr, sizeof(linestr), "%d", msg->line);
 		/* Build string to print out */
@@ -505,6 +598,368 @@ static struct logformatter logformatter_plain = {
 	.format_log = format_log_plain,
 };
 
+/*! \brief How many message locations a binary channel remembers */
+#define LOG_RING_LOCATIONS 1024
+
+/*! \brief A message location already written to the current file */
+struct log_ring_location {
+	unsigned int hash;
+	int line;
+	uint32_t id;
+	char *file;
+	char *function;
+};
+
+/*! \brief The memory mapped files a binary channel writes in turn */
+struct log_ring {
+	/*! The file mapped */
+	int fd;
+	/*! Which of the files is mapped */
+	unsigned int file;
+	unsigned int files;
+	/*! The size of each file */
+	size_t size;
+	/*! The mapped file, starting with its header */
+	struct ast_log_binary_header *header;
+	/*! The levels whose names were written to the file */
+	unsigned int levels;
+	/*! The id of the next location written to the file */
+	uint32_t next_location;
+	struct log_ring_location locations[LOG_RING_LOCATIONS];
+};
+
+static void log_ring_forget(struct log_ring *ring)
+{
+	int i;
+
+	ring->levels = 0;
+	ring->next_location = 0;
+	for (i = 0; i < LOG_RING_LOCATIONS; i++) {
+		ast_free(ring->locations[i].file);
+		ast_free(ring->locations[i].function);
+	}
+	memset(ring->locations, 0, sizeof(ring->locations));
+}
+
+static void log_ring_unmap(struct log_ring *ring)
+{
+	if (ring->header) {
+		munmap(ring->header, ring->size);
+		ring->header = NULL;
+	}
+	if (ring->fd > -1) {
+		close(ring->fd);
+		ring->fd = -1;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Map a file of the ring and start it over
+ *
+ * \param chan The binary channel
+ * \param sequence The sequence of the file
+ */
+static int log_ring_map(struct logchannel *chan, uint64_t sequence)
+{
+	struct log_ring *ring = chan->ring;
+	char filename[PATH_MAX + 16];
+
+	snprintf(filename, sizeof(filename), "%s.%u", chan->filename, ring->file);
+	ring->fd = open(filename, O_RDWR | O_CREAT, 0666);
+	if (ring->fd < 0) {
+		return -1;
+	}
+
+	if (ftruncate(ring->fd, ring->size)) {
+		log_ring_unmap(ring);
+		return -1;
+	}
+
+	ring->header = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+	if (ring->header == MAP_FAILED) {
+		ring->header = NULL;
+		log_ring_unmap(ring);
+		return -1;
+	}
+
+	/* Claim the file before the magic says it is valid again */
+	ring->header->used = 0;
+	ring->header->sequence = sequence;
+	ring->header->size = ring->size;
+	ring->header->header_size = sizeof(*ring->header);
+	ring->header->version = AST_LOG_BINARY_VERSION;
+	ast_copy_string(ring->header->magic, AST_LOG_BINARY_MAGIC, sizeof(ring->header->magic));
+
+	log_ring_forget(ring);
+
+	return 0;
+}
+
+/*! \brief Move on to the next file of the ring */
+static int log_ring_next(struct logchannel *chan)
+{
+	struct log_ring *ring = chan->ring;
+	uint64_t sequence = ring->header->sequence + 1;
+
+	log_ring_unmap(ring);
+	ring->file = (ring->file + 1) % ring->files;
+
+	return log_ring_map(chan, sequence);
+}
+
+static void log_ring_close(struct logchannel *chan)
+{
+	if (!chan->ring) {
+		return;
+	}
+
+	log_ring_unmap(chan->ring);
+	log_ring_forget(chan->ring);
+	ast_free(chan->ring);
+	chan->ring = NULL;
+}
+
+/*!
+ * \internal
+ * \brief Open the files of a binary channel
+ *
+ * Writing carries on with the file after the one written last, so the
+ * messages logged before a restart or reload are kept for as long as
+ * possible.
+ */
+static int log_ring_open(struct logchannel *chan)
+{
+	struct log_ring *ring;
+	char filename[PATH_MAX + 16];
+	uint64_t sequence = 0;
+	unsigned int i;
+
+	ring = ast_calloc(1, sizeof(*ring));
+	if (!ring) {
+		return -1;
+	}
+	ring->fd = -1;
+	ring->files = binary_files;
+	ring->size = (size_t) binary_file_size * 1024 * 1024;
+	chan->ring = ring;
+
+	for (i = 0; i < ring->files; i++) {
+		struct ast_log_binary_header header;
+		int fd;
+
+		snprintf(filename, sizeof(filename), "%s.%u", chan->filename, i);
+		fd = open(filename, O_RDONLY);
+		if (fd < 0) {
+			continue;
+		}
+		if (read(fd, &header, sizeof(header)) == sizeof(header)
+			&& !strcmp(header.magic, AST_LOG_BINARY_MAGIC)
+			&& header.sequence >= sequence) {
+			sequence = header.sequence + 1;
+			ring->file = (i + 1) % ring->files;
+		}
+		close(fd);
+	}
+
+	if (log_ring_map(chan, sequence)) {
+		log_ring_close(chan);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*! \brief Copy a record to the end of the mapped file */
+static void log_ring_append(struct log_ring *ring, const void *record)
+{
+	uint32_t used = ring->header->used;
+	uint32_t length = ((const struct ast_log_binary_record *) record)->length;
+
+	memcpy((char *) ring->header + ring->header->header_size + used, record, length);
+	/* Whoever reads the live file sees the record only once it is complete */
+	ast_atomic_store_n(&ring->header->used, used + length, __ATOMIC_RELEASE);
+}
+
+static size_t log_ring_free_space(struct log_ring *ring)
+{
+	return ring->size - ring->header->header_size - ring->header->used;
+}
+
+/*!
+ * \internal
+ * \brief Find the location of a message among those written to the current file
+ *
+ * \param ring The ring
+ * \param msg The message
+ * \param[out] slot Where the location is remembered, or would be
+ *
+ * \retval 1 if the location was written to the current file
+ */
+static int log_ring_location_find(struct log_ring *ring, struct logmsg *msg,
+	struct log_ring_location **slot)
+{
+	unsigned int hash = ast_str_hash_add(msg->function, ast_str_hash(msg->file) + msg->line);
+	struct log_ring_location *location = &ring->locations[hash % LOG_RING_LOCATIONS];
+
+	*slot = location;
+
+	return location->file && location->hash == hash && location->line == msg->line
+		&& !strcmp(location->file, msg->file) && !strcmp(location->function, msg->function);
+}
+
+static void log_ring_write_level(struct log_ring *ring, struct logmsg *msg)
+{
+	size_t name_length = strlen(msg->level_name);
+	char buf[AST_LOG_BINARY_ALIGN(sizeof(struct ast_log_binary_level) + 64)] = { 0, };
+	struct ast_log_binary_level *record = (struct ast_log_binary_level *) buf;
+
+	name_length = MIN(name_length, sizeof(buf) - sizeof(*record));
+	record->record.length = AST_LOG_BINARY_ALIGN(sizeof(*record) + name_length);
+	record->record.type = AST_LOG_BINARY_LEVEL;
+	record->level = msg->level;
+	record->name_length = name_length;
+	memcpy(record->name, msg->level_name, name_length);
+
+	log_ring_append(ring, record);
+	ring->levels |= (1 << msg->level);
+}
+
+static int log_ring_write_location(struct log_ring *ring, struct logmsg *msg,
+	struct log_ring_location *location, char *buf, size_t size)
+{
+	struct ast_log_binary_location *record = (struct ast_log_binary_location *) buf;
+	size_t file_length = MIN(strlen(msg->file), (size - sizeof(*record)) / 2);
+	size_t function_length = MIN(strlen(msg->function), (size - sizeof(*record)) / 2);
+	char *file = ast_strdup(msg->file);
+	char *function = ast_strdup(msg->function);
+
+	if (!file || !function) {
+		ast_free(file);
+		ast_free(function);
+		return -1;
+	}
+
+	ast_free(location->file);
+	ast_free(location->function);
+	location->file = file;
+	location->function = function;
+	location->line = msg->line;
+	location->hash = ast_str_hash_add(msg->function, ast_str_hash(msg->file) + msg->line);
+	location->id = ring->next_location++;
+
+	memset(record, 0, AST_LOG_BINARY_ALIGN(sizeof(*record) + file_length + function_length));
+	record->record.length = AST_LOG_BINARY_ALIGN(sizeof(*record) + file_length + function_length);
+	record->record.type = AST_LOG_BINARY_LOCATION;
+	record->id = location->id;
+	record->line = msg->line;
+	record->file_length = file_length;
+	record->function_length = function_length;
+	memcpy(record->strings, msg->file, file_length);
+	memcpy(record->strings + file_length, msg->function, function_length);
+
+	log_ring_append(ring, record);
+
+	return 0;
+}
+
+static int format_log_binary(struct logchannel *chan, struct logmsg *msg, char *buf, size_t size)
+{
+	struct ast_log_binary_message *record = (struct ast_log_binary_message *) buf;
+	size_t message_length = strlen(msg->message);
+	size_t length;
+
+	/* The trailing newline every message gets is left out */
+	if (message_length && msg->message[message_length - 1] == '\n') {
+		message_length--;
+	}
+	message_length = MIN(message_length, size - AST_LOG_BINARY_ALIGNMENT - sizeof(*record));
+	length = AST_LOG_BINARY_ALIGN(sizeof(*record) + message_length);
+
+	memset(record, 0, length);
+	record->record.length = length;
+	record->record.type = AST_LOG_BINARY_MESSAGE;
+	record->time = (uint64_t) msg->when.tv_sec * 1000000 + msg->when.tv_usec;
+	record->lwp = msg->lwp;
+	record->callid = msg->callid;
+	record->level = msg->level;
+	record->sublevel = msg->sublevel;
+	record->message_length = message_length;
+	memcpy(record->message, msg->message, message_length);
+
+	return 0;
+}
+
+static struct logformatter logformatter_binary = {
+	.name = "binary",
+	.format_log = format_log_binary,
+};
+
+/*!
+ * \internal
+ * \brief Write a message to a binary channel
+ *
+ * \note Messages are only printed by the logger thread, so the ring is
+ * never written by two threads at once.
+ */
+static int log_ring_write(struct logchannel *chan, struct logmsg *msg, char *buf, size_t size)
+{
+	struct log_ring *ring = chan->ring;
+	struct ast_log_binary_message *record = (struct ast_log_binary_message *) buf;
+	struct log_ring_location *location;
+	char location_buf[AST_LOG_BINARY_ALIGN(sizeof(struct ast_log_binary_location) + 2 * 256)];
+	size_t needed;
+
+	if (!ring->header || chan->formatter.format_log(chan, msg, buf, size)) {
+		return -1;
+	}
+
+	for (;;) {
+		needed = record->record.length;
+		if (!(ring->levels & (1 << msg->level))) {
+			needed += AST_LOG_BINARY_ALIGN(sizeof(struct ast_log_binary_level) + 64);
+		}
+		if (!log_ring_location_find(ring, msg, &location)) {
+			needed += sizeof(location_buf);
+		}
+		if (needed <= log_ring_free_space(ring)) {
+			break;
+		}
+		if (ring->header->used == 0 || log_ring_next(chan)) {
+			return -1;
+		}
+	}
+
+	if (!(ring->levels & (1 << msg->level))) {
+		log_ring_write_level(ring, msg);
+	}
+	if (!log_ring_location_find(ring, msg, &location)
+		&& log_ring_write_location(ring, msg, location, location_buf, sizeof(location_buf))) {
+		return -1;
+	}
+
+	record->location = location->id;
+	log_ring_append(ring, record);
+
+	return 0;
+}
+
+static const char *logchannel_type_name(struct logchannel *chan)
+{
+	switch (chan->type) {
+	case LOGTYPE_CONSOLE:
+		return "Console";
+	case LOGTYPE_SYSLOG:
+		return "Syslog";
+	case LOGTYPE_BINARY:
+		return "Binary";
+	case LOGTYPE_FILE:
+		break;
+	}
+
+	return "File";
+}
+
 static void make_components(struct logchannel *chan)
 {
 	char *w;
@@ -541,7 +996,9 @@ static void make_components(struct logchannel *chan)
 		}
 	}
 
-	if (!chan->formatter.name) {
+	if (chan->type == LOGTYPE_BINARY) {
+		memcpy(&chan->formatter, &logformatter_binary, sizeof(chan->formatter));
+	} else if (!chan->formatter.name) {
 		memcpy(&chan->formatter, &logformatter_default, sizeof(chan->formatter));
 	}
 
@@ -602,6 +1059,11 @@ static void make_filename(const char *channel, char *filename, size_t size)
 		return;
 	}
 
+	/* The files of a binary channel are named after the rest */
+	if (!strncasecmp(channel, "binary:", 7)) {
+		channel += 7;
+	}
+
 	/* It's a filename */
 
 	if (channel[0] != '/') {
@@ -682,6 +1144,21 @@ static struct logchannel *make_logchannel(const char *channel, const char *compo
 
 		chan->type = LOGTYPE_SYSLOG;
 		openlog("asterisk", LOG_PID, chan->facility);
+	} else if (!strncasecmp(channel, "binary:", 7)) {
+		/*
+		* syntax is:
+		*  binary:filename => level,level,level
+		*/
+		chan->type = LOGTYPE_BINARY;
+		if (log_ring_open(chan)) {
+			ast_console_puts_mutable("ERROR: Unable to open binary log '", __LOG_ERROR);
+			ast_console_puts_mutable(chan->filename, __LOG_ERROR);
+			ast_console_puts_mutable("': ", __LOG_ERROR);
+			ast_console_puts_mutable(strerror(errno), __LOG_ERROR);
+			ast_console_puts_mutable("'\n", __LOG_ERROR);
+			ast_free(chan);
+			return NULL;
+		}
 	} else {
 		if (!(chan->fileptr = fopen(chan->filename, "a"))) {
 			/* Can't do real logging here since we're called with a lock
@@ -777,9 +1254,12 @@ static int init_logger_chain(const char *altconf)
 	ast_copy_string(queue_log_name, QUEUELOG, sizeof(queue_log_name));
 	exec_after_rotate[0] = '\0';
 	rotatestrategy = SEQUENTIAL;
+	binary_file_size = 16;
+	binary_files = 4;
 
 	/* delete our list of log channels */
 	while ((chan = AST_RWLIST_REMOVE_HEAD(&logchannels, list))) {
+		log_ring_close(chan);
 		ast_free(chan);
 	}
 	global_logmask = 0;
@@ -849,6 +1329,18 @@ static int init_logger_chain(const char *altconf)
 			fprintf(stderr, "rotatetimestamp option has been deprecated.  Please use rotatestrategy instead.\n");
 		}
 	}
+	if ((s = ast_variable_retrieve(cfg, "general", "binary_file_size"))) {
+		if (sscanf(s, "%30u", &binary_file_size) != 1 || !binary_file_size || binary_file_size > 1024) {
+			fprintf(stderr, "binary_file_size must be between 1 and 1024.  Setting to 16.\n");
+			binary_file_size = 16;
+		}
+	}
+	if ((s = ast_variable_retrieve(cfg, "general", "binary_files"))) {
+		if (sscanf(s, "%30u", &binary_files) != 1 || binary_files < 2 || binary_files > 100) {
+			fprintf(stderr, "binary_files must be between 2 and 100.  Setting to 4.\n");
+			binary_files = 4;
+		}
+	}
 	if ((s = ast_variable_retrieve(cfg, "general", "logger_queue_limit"))) {
 		if (sscanf(s, "%30d", &logger_queue_limit) != 1) {
 			fprintf(stderr, "logger_queue_limit has an invalid value.  Leaving at default of %d.\n",
@@ -1429,8 +1921,7 @@ int ast_logger_get_channels(int (*logentry)(const char *channel, const char *typ
 			}
 		}
 
-		res = logentry(chan->filename, chan->type == LOGTYPE_CONSOLE ? "Console" :
-			(chan->type == LOGTYPE_SYSLOG ? "Syslog" : "File"), chan->disabled ?
+		res = logentry(chan->filename, logchannel_type_name(chan), chan->disabled ?
 			"Disabled" : "Enabled", ast_str_buffer(configs), data);
 
 		if (res) {
@@ -1472,7 +1963,7 @@ static char *handle_logger_show_channels(struct ast_cli_entry *e, int cmd, struc
 	AST_RWLIST_TRAVERSE(&logchannels, chan, list) {
 		unsigned int level;
 
-		ast_cli(a->fd, FORMATL, chan->filename, chan->type == LOGTYPE_CONSOLE ? "Console" : (chan->type == LOGTYPE_SYSLOG ? "Syslog" : "File"),
+		ast_cli(a->fd, FORMATL, chan->filename, logchannel_type_name(chan),
 			chan->formatter.name,
 			chan->disabled ? "Disabled" : "Enabled");
 		ast_cli(a->fd, " - ");
@@ -1603,6 +2094,7 @@ int ast_logger_remove_channel(const char *log_channel)
 		fclose(chan->fileptr);
 		chan->fileptr = NULL;
 	}
+	log_ring_close(chan);
 	ast_free(chan);
 	chan = NULL;
 
@@ -1912,6 +2404,17 @@ static struct sigaction handle_SIGXFSZ = {
 	.sa_flags = SA_RESTART,
 };
 
+/*! \brief Fill in the date of a message from the time it was logged */
+static void logmsg_set_date(struct logmsg *logmsg)
+{
+	struct ast_tm tm;
+	char datestring[256];
+
+	ast_localtime(&logmsg->when, &tm, NULL);
+	ast_strftime(datestring, sizeof(datestring), dateformat, &tm);
+	ast_string_field_set(logmsg, date, datestring);
+}
+
 /*! \brief Print a normal log message to the channels */
 static void logger_print_normal(struct logmsg *logmsg)
 {
@@ -1919,6 +2422,8 @@ static void logger_print_normal(struct logmsg *logmsg)
 	char buf[LOGMSG_SIZE];
 	int level = 0;
 
+	logmsg_set_date(logmsg);
+
 	AST_RWLIST_RDLOCK(&logchannels);
 	if (!AST_RWLIST_EMPTY(&logchannels)) {
 		AST_RWLIST_TRAVERSE(&logchannels, chan, list) {
@@ -1998,6 +2503,14 @@ static void logger_print_normal(struct logmsg *logmsg)
 					}
 				}
 				break;
+			case LOGTYPE_BINARY:
+				if (log_ring_write(chan, logmsg, buf, sizeof(buf))) {
+					fprintf(stderr, "Logger Warning: Unable to write to binary log '%s': %s (disabled)\n",
+						chan->filename, strerror(errno));
+					manager_event(EVENT_FLAG_SYSTEM, "LogChannel", "Channel: %s\r\nEnabled: No\r\nReason: %d - %s\r\n", chan->filename, errno, strerror(errno));
+					chan->disabled = 1;
+				}
+				break;
 			}
 		}
 	} else if (logmsg->level != __LOG_VERBOSE || option_verbose >= logmsg->sublevel) {
@@ -2021,10 +2534,7 @@ static struct logmsg * __attribute__((format(printf, 7, 0))) format_log_message_
 {
 	struct logmsg *logmsg = NULL;
 	struct ast_str *buf = NULL;
-	struct ast_tm tm;
-	struct timeval now = ast_tvnow();
 	int res = 0;
-	char datestring[256];
 
 	if (!(buf = ast_str_thread_get(&log_buf, LOG_BUF_INIT_SIZE))) {
 		return NULL;
@@ -2062,10 +2572,8 @@ static struct logmsg * __attribute__((format(printf, 7, 0))) format_log_message_
 		logmsg->callid = callid;
 	}
 
-	/* Create our date/time */
-	ast_localtime(&now, &tm, NULL);
-	ast_strftime(datestring, sizeof(datestring), dateformat, &tm);
-	ast_string_field_set(logmsg, date, datestring);
+	/* The date is formatted by whoever prints the message */
+	logmsg->when = ast_tvnow();
 
 	/* Copy over data */
 	logmsg->level = level;
@@ -2079,64 +2587,65 @@ static struct logmsg * __attribute__((format(printf, 7, 0))) format_log_message_
 	return logmsg;
 }
 
-static struct logmsg * __attribute__((format(printf, 7, 0))) format_log_message(int level,
-	int sublevel, const char *file, int line, const char *function, ast_callid callid,
-	const char *fmt, ...)
+/*!
+ * \internal
+ * \brief Print a message the logger thread made up itself
+ */
+static void __attribute__((format(printf, 1, 2))) logger_print_warning(const char *fmt, ...)
 {
-	struct logmsg *logmsg;
+	struct logmsg *msg;
 	va_list ap;
 
 	va_start(ap, fmt);
-	logmsg = format_log_message_ap(level, sublevel, file, line, function, callid, fmt, ap);
+	msg = format_log_message_ap(__LOG_WARNING, 0, "logger", 0, "***", 0, fmt, ap);
 	va_end(ap);
 
-	return logmsg;
+	if (msg) {
+		logger_print_normal(msg);
+		logmsg_free(msg);
+	}
 }
 
 /*! \brief Actual logging thread */
 static void *logger_thread(void *data)
 {
-	struct logmsg *next = NULL, *msg = NULL;
+	struct logmsg *msg;
+	int queued;
 
 	for (;;) {
-		/* We lock the message list, and see if any message exists... if not we wait on the condition to be signalled */
-		AST_LIST_LOCK(&logmsgs);
-		if (AST_LIST_EMPTY(&logmsgs)) {
-			if (close_logger_thread) {
-				AST_LIST_UNLOCK(&logmsgs);
-				break;
-			} else {
-				ast_cond_wait(&logcond, &logmsgs.lock);
-			}
+		/* Process each message in the order added */
+		msg = logmsg_pop();
+		if (msg) {
+			logger_print_normal(msg);
+			logmsg_free(msg);
+			queued = ast_atomic_sub_fetch(&logger_queue_size, 1, __ATOMIC_ACQ_REL);
+		} else {
+			queued = ast_atomic_load_n(&logger_queue_size, __ATOMIC_ACQUIRE);
 		}
 
-		if (high_water_alert) {
-			msg = format_log_message(__LOG_WARNING, 0, "logger", 0, "***", 0,
-				"Logging resumed.  %d message%s discarded.\n",
-				logger_messages_discarded, logger_messages_discarded == 1 ? "" : "s");
-			if (msg) {
-				AST_LIST_INSERT_TAIL(&logmsgs, msg, list);
+		if (queued) {
+			if (!msg) {
+				/* A message is being queued but is not linked or counted yet */
+				sched_yield();
 			}
-			high_water_alert = 0;
-			logger_messages_discarded = 0;
+			continue;
 		}
 
-		next = AST_LIST_FIRST(&logmsgs);
-		AST_LIST_HEAD_INIT_NOLOCK(&logmsgs);
-		logger_queue_size = 0;
-		AST_LIST_UNLOCK(&logmsgs);
-
-		/* Otherwise go through and process each message in the order added */
-		while ((msg = next)) {
-			/* Get the next entry now so that we can free our current structure later */
-			next = AST_LIST_NEXT(msg, list);
+		if (ast_atomic_exchange_n(&high_water_alert, 0, __ATOMIC_ACQ_REL)) {
+			int discarded = ast_atomic_exchange_n(&logger_messages_discarded, 0, __ATOMIC_ACQ_REL);
 
-			/* Depending on the type, send it to the proper function */
-			logger_print_normal(msg);
+			logger_print_warning("Log queue threshold (%d) exceeded.  Discarding new messages.\n",
+				logger_queue_limit);
+			logger_print_warning("Logging resumed.  %d message%s discarded.\n",
+				discarded, discarded == 1 ? "" : "s");
+		}
 
-			/* Free the data since we are done */
-			logmsg_free(msg);
+		if (ast_atomic_load_n(&close_logger_thread, __ATOMIC_ACQUIRE)) {
+			break;
 		}
+
+		/* Whoever queues the next message wakes us up */
+		ast_sem_wait(&logsem);
 	}
 
 	return NULL;
@@ -2205,19 +2714,13 @@ int init_logger(void)
 	/* auto rotate if sig SIGXFSZ comes a-knockin */
 	sigaction(SIGXFSZ, &handle_SIGXFSZ, NULL);
 
-	/* Re-initialize the logmsgs mutex.  The recursive mutex can be accessed prior
- 	 * to Asterisk being forked into the background, which can cause the thread
- 	 * ID tracked by the underlying pthread mutex to be different than the ID of
- 	 * the thread that unlocks the mutex.  Since init_logger is called after the
- 	 * fork, it is safe to initialize the mutex here for future accesses.
- 	 */
-	ast_mutex_destroy(&logmsgs.lock);
-	ast_mutex_init(&logmsgs.lock);
-	ast_cond_init(&logcond, NULL);
+	if (ast_sem_init(&logsem, 0, 0)) {
+		return -1;
+	}
 
 	/* start logger thread */
 	if (ast_pthread_create(&logthread, NULL, logger_thread, NULL) < 0) {
-		ast_cond_destroy(&logcond);
+		ast_sem_destroy(&logsem);
 		return -1;
 	}
 
@@ -2254,13 +2757,19 @@ void close_logger(void)
 	logger_initialized = 0;
 
 	/* Stop logger thread */
-	AST_LIST_LOCK(&logmsgs);
-	close_logger_thread = 1;
-	ast_cond_signal(&logcond);
-	AST_LIST_UNLOCK(&logmsgs);
+	ast_atomic_store_n(&close_logger_thread, 1, __ATOMIC_RELEASE);
 
 	if (logthread != AST_PTHREADT_NULL) {
+		struct logmsg *msg;
+
+		ast_sem_post(&logsem);
 		pthread_join(logthread, NULL);
+
+		/* Whatever was queued while the thread was stopping is lost */
+		while ((msg = logmsg_pop())) {
+			logmsg_free(msg);
+		}
+		ast_sem_destroy(&logsem);
 	}
 
 	AST_RWLIST_WRLOCK(&logchannels);
@@ -2275,6 +2784,7 @@ void close_logger(void)
 			fclose(f->fileptr);
 			f->fileptr = NULL;
 		}
+		log_ring_close(f);
 		ast_free(f);
 	}
 
@@ -2410,20 +2920,18 @@ static void __attribute__((format(printf, 7, 0))) ast_log_full(int level, int su
 		return;
 	}
 
-	AST_LIST_LOCK(&logmsgs);
-	if (logger_queue_size >= logger_queue_limit && !close_logger_thread) {
-		logger_messages_discarded++;
-		if (!high_water_alert && !close_logger_thread) {
-			logmsg = format_log_message(__LOG_WARNING, 0, "logger", 0, "***", 0,
-				"Log queue threshold (%d) exceeded.  Discarding new messages.\n", logger_queue_limit);
-			AST_LIST_INSERT_TAIL(&logmsgs, logmsg, list);
-			high_water_alert = 1;
-			ast_cond_signal(&logcond);
-		}
-		AST_LIST_UNLOCK(&logmsgs);
+	/* Nothing would take the message, so do not even format it */
+	if (global_logmask && !(global_logmask & (1 << level))) {
+		return;
+	}
+
+	if (ast_atomic_load_n(&logger_queue_size, __ATOMIC_ACQUIRE) >= logger_queue_limit
+		&& !close_logger_thread) {
+		/* The logger thread reports the discarded messages once it catches up */
+		ast_atomic_fetch_add(&logger_messages_discarded, 1, __ATOMIC_RELAXED);
+		ast_atomic_store_n(&high_water_alert, 1, __ATOMIC_RELEASE);
 		return;
 	}
-	AST_LIST_UNLOCK(&logmsgs);
 
 	logmsg = format_log_message_ap(level, sublevel, file, line, function, callid, fmt, ap);
 	if (!logmsg) {
@@ -2432,18 +2940,14 @@ static void __attribute__((format(printf, 7, 0))) ast_log_full(int level, int su
 
 	logmsg->hidecli = hidecli;
 
-	/* If the logger thread is active, append it to the tail end of the list - otherwise skip that step */
+	/* If the logger thread is active, append it to the queue - otherwise skip that step */
 	if (logthread != AST_PTHREADT_NULL) {
-		AST_LIST_LOCK(&logmsgs);
-		if (close_logger_thread) {
+		if (ast_atomic_load_n(&close_logger_thread, __ATOMIC_ACQUIRE)) {
 			/* Logger is either closing or closed.  We cannot log this message. */
 			logmsg_free(logmsg);
 		} else {
-			AST_LIST_INSERT_TAIL(&logmsgs, logmsg, list);
-			logger_queue_size++;
-			ast_cond_signal(&logcond);
+			logmsg_queue(logmsg);
 		}
-		AST_LIST_UNLOCK(&logmsgs);
 	} else {
 		logger_print_normal(logmsg);
 		logmsg_free(logmsg);
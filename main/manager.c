@@ -60,6 +60,7 @@
 #include <signal.h>
 #include <sys/mman.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <regex.h>
 
 #include "asterisk/channel.h"
@@ -69,6 +70,7 @@
 #include "asterisk/config.h"
 #include "asterisk/callerid.h"
 #include "asterisk/core_local.h"
+#include "asterisk/dial.h"
 #include "asterisk/lock.h"
 #include "asterisk/cli.h"
 #include "asterisk/app.h"
@@ -102,6 +104,9 @@
 #include "asterisk/translate.h"
 #include "asterisk/taskprocessor.h"
 #include "asterisk/message.h"
+#include "asterisk/alertpipe.h"
+#include "asterisk/poll-compat.h"
+#include "asterisk/vector.h"
 
 /*** DOCUMENTATION
 	<manager name="Ping" language="en_US">
@@ -186,6 +191,17 @@
 			<parameter name="Events">
 				<xi:include xpointer="xpointer(/docs/manager[@name='Events']/syntax/parameter[@name='EventMask']/enumlist)" />
 			</parameter>
+			<parameter name="Format">
+				<para>Format of the responses and events sent on a TCP
+				connection from the response to this action on. Valid values are:</para>
+				<enumlist>
+					<enum name="ami"><para>Lines of <literal>Key: Value</literal>, each
+					message ending with an empty line. (default)</para></enum>
+					<enum name="json"><para>A JSON object on a line of its own for each
+					message, with a member for each header. The values of a header
+					given more than once are gathered in an array.</para></enum>
+				</enumlist>
+			</parameter>
 		</syntax>
 		<description>
 			<para>Login Manager.</para>
@@ -752,9 +768,47 @@
 			<ref type="managerEvent">OriginateResponse</ref>
 		</see-also>
 	</manager>
+	<manager name="BulkOriginate" language="en_US">
+		<synopsis>
+			Originate many calls.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+			<parameter name="Channel" required="true">
+				<para>Channel name to call, multiple Channel: headers are allowed.</para>
+			</parameter>
+			<parameter name="Rate" default="0">
+				<para>How many calls to start a second, <literal>0</literal> to start them all at once.</para>
+			</parameter>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Originate']/syntax/parameter[@name='Exten'])" />
+			<xi:include xpointer="xpointer(/docs/manager[@name='Originate']/syntax/parameter[@name='Context'])" />
+			<xi:include xpointer="xpointer(/docs/manager[@name='Originate']/syntax/parameter[@name='Priority'])" />
+			<xi:include xpointer="xpointer(/docs/manager[@name='Originate']/syntax/parameter[@name='Application'])" />
+			<xi:include xpointer="xpointer(/docs/manager[@name='Originate']/syntax/parameter[@name='Data'])" />
+			<xi:include xpointer="xpointer(/docs/manager[@name='Originate']/syntax/parameter[@name='Timeout'])" />
+			<xi:include xpointer="xpointer(/docs/manager[@name='Originate']/syntax/parameter[@name='CallerID'])" />
+			<xi:include xpointer="xpointer(/docs/manager[@name='Originate']/syntax/parameter[@name='Variable'])" />
+			<xi:include xpointer="xpointer(/docs/manager[@name='Originate']/syntax/parameter[@name='Account'])" />
+			<xi:include xpointer="xpointer(/docs/manager[@name='Originate']/syntax/parameter[@name='EarlyMedia'])" />
+			<xi:include xpointer="xpointer(/docs/manager[@name='Originate']/syntax/parameter[@name='Codecs'])" />
+		</syntax>
+		<description>
+			<para>Generates an outgoing call to each
+			<replaceable>Channel</replaceable>, all of them going to the same
+			<replaceable>Extension</replaceable>/<replaceable>Context</replaceable>/<replaceable>Priority</replaceable>
+			or <replaceable>Application</replaceable>/<replaceable>Data</replaceable>.
+			The calls are always made asynchronously, paced by <replaceable>Rate</replaceable>,
+			and the result of each is raised as an <literal>OriginateResponse</literal> event
+			carrying the <replaceable>ActionID</replaceable>.</para>
+		</description>
+		<see-also>
+			<ref type="manager">Originate</ref>
+			<ref type="managerEvent">OriginateResponse</ref>
+		</see-also>
+	</manager>
 	<managerEvent language="en_US" name="OriginateResponse">
 		<managerEventInstance class="EVENT_FLAG_CALL">
-			<synopsis>Raised in response to an Originate command.</synopsis>
+			<synopsis>Raised in response to an Originate or BulkOriginate command.</synopsis>
 			<syntax>
 				<parameter name="ActionID" required="false"/>
 				<parameter name="Response">
@@ -775,6 +829,7 @@
 			</syntax>
 			<see-also>
 				<ref type="manager">Originate</ref>
+				<ref type="manager">BulkOriginate</ref>
 			</see-also>
 		</managerEventInstance>
 	</managerEvent>
@@ -1048,6 +1103,9 @@
 				<parameter name="ListItems">
 					<para>The total number of list items produced</para>
 				</parameter>
+				<parameter name="Remaining">
+					<para>The number of channels after the ones listed, left for later pages</para>
+				</parameter>
 			</syntax>
 			<see-also>
 				<ref type="manager">CoreShowChannels</ref>
@@ -1061,9 +1119,17 @@
 		</synopsis>
 		<syntax>
 			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+			<parameter name="Limit">
+				<para>The most channels to list, all of them if not given.</para>
+			</parameter>
+			<parameter name="After">
+				<para>List the channels whose names sort after this one, the last
+				channel of the previous page.</para>
+			</parameter>
 		</syntax>
 		<description>
-			<para>List currently defined channels and some information about them.</para>
+			<para>List currently defined channels and some information about them.
+			Channels are listed in order of their names.</para>
 		</description>
 		<responses>
 			<list-elements>
@@ -1591,39 +1657,94 @@ enum add_filter_result {
 };
 
 /*!
- * Linked list of events.
- * Global events are appended to the list by append_event().
- * The usecount is the number of stored pointers to the element,
- * excluding the list pointers. So an element that is only in
- * the list has a usecount of 0, not 1.
+ * \brief A compiled event filter
  *
- * Clients have a pointer to the last event processed, and for each
- * of these clients we track the usecount of the elements.
- * If we have a pointer to an entry in the list, it is safe to navigate
- * it forward because elements will not be deleted, but only appended.
- * The worst that can happen is seeing the pointer still NULL.
+ * Filters of the form "Event: Name" or "^Event: Name", with a name made
+ * of letters, digits and underscores, are decided from the name of the
+ * event before it is formatted:
  *
- * When the usecount of an element drops to 0, and the element is the
- * first in the list, we can remove it. Removal is done within the
- * main thread, which is woken up for the purpose.
+ * \li "^Event: Name" matches exactly the events whose name starts with Name.
+ * \li "Event: Name" matches those too, but may match others through another
+ * header ending in "Event: Name", so it has to be run to reject an event.
+ */
+struct event_filter_entry {
+	regex_t regex;
+	/*! The event name prefix the filter matches, NULL if it is any other expression */
+	char *event_name;
+	/*! Length of the event name prefix */
+	size_t event_name_len;
+	/*! Whether the filter is anchored to the Event header */
+	unsigned int anchored:1;
+};
+
+/*! \brief What can be told of an event for a session before it is formatted */
+enum event_precheck {
+	/*! The session does not get the event */
+	EVENT_PRECHECK_REJECT,
+	/*! The session gets the event */
+	EVENT_PRECHECK_ACCEPT,
+	/*! The session's filters have to be run over the formatted event */
+	EVENT_PRECHECK_REGEX,
+};
+
+/*!
+ * An event, formatted once and shared by reference between the event
+ * queues of the sessions it is sent to.
  *
- * For simplicity of implementation, we make sure the list is never empty.
+ * Each session has a bounded ring of the events waiting to be sent to
+ * it.  Events are pushed to the sessions that want them when they are
+ * raised, so a session whose permissions or filters exclude an event
+ * never sees it.  An event is freed when the last session is done with it.
  */
 struct eventqent {
-	int usecount;		/*!< # of clients who still need the event */
 	int category;
-	unsigned int seq;	/*!< sequence number */
-	struct timeval tv;  /*!< When event was allocated */
-	AST_RWLIST_ENTRY(eventqent) eq_next;
-	char eventdata[1];	/*!< really variable size, allocated by append_event() */
+	char *json;	/*!< The event as a line of JSON, if a session wanted it so */
+	char eventdata[1];	/*!< really variable size, allocated by alloc_event() */
 };
 
-static AST_RWLIST_HEAD_STATIC(all_events, eventqent);
+/*! \brief Default of the most events waiting to be sent to a session */
+#define DEFAULT_EVENTQUEUE_SIZE 10000
+
+/*! \brief Formats a TCP session can receive its output in */
+enum manager_format {
+	/*! Lines of "Key: Value", a message ending with an empty line */
+	MANAGER_FORMAT_AMI,
+	/*! A JSON object on a line of its own for each message */
+	MANAGER_FORMAT_JSON,
+};
+
+/*! \brief Default of the most bytes waiting to be written to a session */
+#define DEFAULT_OUTPUT_HIGH_WATER (1024 * 1024)
+
+/*! \brief What to do with a session whose output reached the high water mark */
+enum output_overflow_policy {
+	/*! Disconnect the session */
+	OUTPUT_OVERFLOW_DISCONNECT,
+	/*! Drop the events the session cannot take, but keep responses */
+	OUTPUT_OVERFLOW_DROP,
+};
+
+/*!
+ * \brief Output waiting for the writer thread to write it to a session
+ *
+ * TCP sessions do not write to their socket themselves.  What they send
+ * is queued on the session and the writer thread writes the queues of all
+ * the sessions whose socket can take more, gathering them with writev().
+ */
+struct manager_output {
+	AST_LIST_ENTRY(manager_output) list;
+	size_t len;		/*!< Length of the data */
+	size_t written;		/*!< Bytes of the data already written */
+	char data[0];
+};
 
 static int displayconnects = 1;
 static int allowmultiplelogin = 1;
 static int timestampevents;
 static int httptimeout = 60;
+static int eventqueuesize = DEFAULT_EVENTQUEUE_SIZE;
+static int outputhighwater = DEFAULT_OUTPUT_HIGH_WATER;
+static enum output_overflow_policy outputoverflow = OUTPUT_OVERFLOW_DISCONNECT;
 static int broken_events_action = 0;
 static int manager_enabled = 0;
 static int subscribed = 0;
@@ -1759,7 +1880,11 @@ struct mansession_session {
 	struct ao2_container *blackfilters;	/*!< Manager event filters - black list */
 	struct ast_variable *chanvars;  /*!< Channel variables to set for originate */
 	int send_events;	/*!<  XXX what ? */
-	struct eventqent *last_ev;	/*!< last event processed. */
+	struct eventqent **events;	/*!< Ring of the events waiting to be sent, protected by notify_lock */
+	size_t events_size;	/*!< Slots in the ring */
+	size_t events_head;	/*!< Slot of the oldest event */
+	size_t events_count;	/*!< Events in the ring */
+	unsigned int events_dropped;	/*!< Events dropped because the ring was full */
 	int writetimeout;	/*!< Timeout for ast_carefulwrite() */
 	time_t authstart;
 	int pending_event;         /*!< Pending events indicator in case when waiting_thread is NULL */
@@ -1768,6 +1893,16 @@ struct mansession_session {
 	unsigned long nc;	/*!< incremental  nonce counter */
 	unsigned int kicked:1;	/*!< Flag set if session is forcibly kicked */
 	ast_mutex_t notify_lock; /*!< Lock for notifying this session of events */
+	ast_mutex_t out_lock;	/*!< Lock for the output queue */
+	ast_cond_t out_cond;	/*!< Signaled when the output queue empties */
+	AST_LIST_HEAD_NOLOCK(, manager_output) out_queue; /*!< Output waiting for the writer thread */
+	size_t out_bytes;	/*!< Bytes in the output queue */
+	size_t out_peak;	/*!< Most bytes ever in the output queue */
+	unsigned int out_dropped;	/*!< Events dropped because the output queue was full */
+	unsigned int out_async:1;	/*!< Set if the writer thread writes the output */
+	unsigned int out_error:1;	/*!< Set if writing failed or the output queue overflowed */
+	enum manager_format format;	/*!< Format of the output of a TCP session */
+	struct ast_str *json_pending;	/*!< Output waiting to complete a message to be sent as JSON */
 	AST_LIST_HEAD_NOLOCK(mansession_datastores, ast_datastore) datastores; /*!< Data stores on the session */
 	AST_LIST_ENTRY(mansession_session) list;
 };
@@ -1830,6 +1965,79 @@ static AST_RWLIST_HEAD_STATIC(manager_hooks, manager_custom_hook);
 #ifdef AST_XML_DOCS
 /*! \brief A container of event documentation nodes */
 static AO2_GLOBAL_OBJ_STATIC(event_docs);
+
+/*! \brief Protects building documentation when first shown */
+AST_MUTEX_DEFINE_STATIC(manager_docs_lock);
+
+/*!
+ * \internal
+ * \brief Get the event documentation, building it if it was deferred.
+ *
+ * \return The container of event documentation, NULL if there is none
+ */
+static struct ao2_container *manager_event_docs(void)
+{
+	struct ao2_container *events;
+
+	events = ao2_global_obj_ref(event_docs);
+	if (events || !ast_xmldoc_lazy()) {
+		return events;
+	}
+
+	ast_mutex_lock(&manager_docs_lock);
+	events = ao2_global_obj_ref(event_docs);
+	if (!events) {
+		events = ast_xmldoc_build_documentation("managerEvent");
+		if (events) {
+			ao2_global_obj_replace_unref(event_docs, events);
+		}
+	}
+	ast_mutex_unlock(&manager_docs_lock);
+
+	return events;
+}
+
+static void action_build_xmldoc(struct manager_action *cur)
+{
+	char *tmpxml;
+
+	tmpxml = ast_xmldoc_build_synopsis("manager", cur->action, NULL);
+	ast_string_field_set(cur, synopsis, tmpxml);
+	ast_free(tmpxml);
+
+	tmpxml = ast_xmldoc_build_syntax("manager", cur->action, NULL);
+	ast_string_field_set(cur, syntax, tmpxml);
+	ast_free(tmpxml);
+
+	tmpxml = ast_xmldoc_build_description("manager", cur->action, NULL);
+	ast_string_field_set(cur, description, tmpxml);
+	ast_free(tmpxml);
+
+	tmpxml = ast_xmldoc_build_seealso("manager", cur->action, NULL);
+	ast_string_field_set(cur, seealso, tmpxml);
+	ast_free(tmpxml);
+
+	tmpxml = ast_xmldoc_build_arguments("manager", cur->action, NULL);
+	ast_string_field_set(cur, arguments, tmpxml);
+	ast_free(tmpxml);
+
+	cur->final_response = ast_xmldoc_build_final_response("manager", cur->action, NULL);
+	cur->list_responses = ast_xmldoc_build_list_responses("manager", cur->action, NULL);
+}
+
+/*!
+ * \internal
+ * \brief Build the documentation of an action if it was deferred.
+ */
+static void action_load_xmldoc(struct manager_action *cur)
+{
+	ast_mutex_lock(&manager_docs_lock);
+	if (cur->docs_pending) {
+		action_build_xmldoc(cur);
+		cur->docs_pending = 0;
+	}
+	ast_mutex_unlock(&manager_docs_lock);
+}
 #endif
 
 static int __attribute__((format(printf, 9, 0))) __manager_event_sessions(
@@ -1845,7 +2053,8 @@ static int __attribute__((format(printf, 9, 0))) __manager_event_sessions(
 	...);
 static enum add_filter_result manager_add_filter(const char *filter_pattern, struct ao2_container *whitefilters, struct ao2_container *blackfilters);
 
-static int match_filter(struct mansession *s, char *eventdata);
+static int match_filter(struct mansession_session *session, char *eventdata);
+static int manager_event_wanted(struct ao2_container *sessions, int category, const char *event);
 
 /*!
  * @{ \brief Define AMI message types.
@@ -2048,6 +2257,12 @@ static void manager_generic_msg_cb(void *data, struct stasis_subscription *sub,
 	type = ast_json_string_get(ast_json_object_get(payload->json, "type"));
 	event = ast_json_object_get(payload->json, "event");
 
+	if (!manager_event_wanted(sessions, class_type, type)) {
+		/* Nobody gets the event */
+		ao2_cleanup(sessions);
+		return;
+	}
+
 	event_buffer = ast_manager_str_from_json_object(event, NULL);
 	if (!event_buffer) {
 		ast_log(AST_LOG_WARNING, "Error while creating payload for event %s\n", type);
@@ -2117,55 +2332,361 @@ int ast_webmanager_check_enabled(void)
 }
 
 /*!
- * Grab a reference to the last event, update usecount as needed.
- * Can handle a NULL pointer.
+ * \internal
+ * \brief Add an event to the queue of a session
+ *
+ * \note The session's notify_lock must be held.
  */
-static struct eventqent *grab_last(void)
+static void session_event_push(struct mansession_session *session, struct eventqent *eqe)
 {
-	struct eventqent *ret;
+	if (session->events_count == session->events_size) {
+		struct eventqent **events = NULL;
+		size_t size = 0;
+		size_t i;
 
-	AST_RWLIST_WRLOCK(&all_events);
-	ret = AST_RWLIST_LAST(&all_events);
-	/* the list is never empty now, but may become so when
-	 * we optimize it in the future, so be prepared.
-	 */
-	if (ret) {
-		ast_atomic_fetchadd_int(&ret->usecount, 1);
+		if (session->events_size < eventqueuesize) {
+			size = MIN(MAX(session->events_size * 2, 16), eventqueuesize);
+			events = ast_malloc(size * sizeof(*events));
+		}
+		if (events) {
+			for (i = 0; i < session->events_count; i++) {
+				events[i] = session->events[(session->events_head + i) % session->events_size];
+			}
+			ast_free(session->events);
+			session->events = events;
+			session->events_size = size;
+			session->events_head = 0;
+		} else if (session->events_size) {
+			/* A session not keeping up loses its oldest events */
+			ao2_ref(session->events[session->events_head], -1);
+			session->events_head = (session->events_head + 1) % session->events_size;
+			session->events_count--;
+			if (!(session->events_dropped++ % 1000)) {
+				ast_log(LOG_WARNING, "Manager session of '%s' is not keeping up with events, %u dropped so far\n",
+					session->username, session->events_dropped);
+			}
+		} else {
+			return;
+		}
 	}
-	AST_RWLIST_UNLOCK(&all_events);
-	return ret;
+
+	session->events[(session->events_head + session->events_count) % session->events_size] = ao2_bump(eqe);
+	session->events_count++;
 }
 
 /*!
- * Purge unused events. Remove elements from the head
- * as long as their usecount is 0 and there is a next element.
+ * \internal
+ * \brief Take the oldest event from the queue of a session
+ *
+ * \return The event, which the caller must unref, or NULL if none is waiting
  */
-static void purge_events(void)
+static struct eventqent *session_event_pop(struct mansession_session *session)
 {
-	struct eventqent *ev;
-	struct timeval now = ast_tvnow();
+	struct eventqent *eqe = NULL;
 
-	AST_RWLIST_WRLOCK(&all_events);
-	while ( (ev = AST_RWLIST_FIRST(&all_events)) &&
-	    ev->usecount == 0 && AST_RWLIST_NEXT(ev, eq_next)) {
-		AST_RWLIST_REMOVE_HEAD(&all_events, eq_next);
-		ast_free(ev);
+	ast_mutex_lock(&session->notify_lock);
+	if (session->events_count) {
+		eqe = session->events[session->events_head];
+		session->events_head = (session->events_head + 1) % session->events_size;
+		session->events_count--;
 	}
+	ast_mutex_unlock(&session->notify_lock);
+
+	return eqe;
+}
+
+/*! \brief Most pieces of output gathered by one writev() */
+#define MANAGER_OUTPUT_IOV 64
+
+/*! \brief Thread writing the output of the TCP sessions */
+static pthread_t manager_writer_thread = AST_PTHREADT_NULL;
+/*! \brief Alert pipe waking the writer thread up */
+static int manager_writer_alert[2] = { -1, -1 };
+/*! \brief Set to make the writer thread exit */
+static int manager_writer_stop;
+
+/*!
+ * \internal
+ * \brief Free the output queue of a session
+ *
+ * \note The session's out_lock must be held, unless the session is being destroyed.
+ */
+static void session_output_free(struct mansession_session *session)
+{
+	struct manager_output *out;
 
-	AST_RWLIST_TRAVERSE_SAFE_BEGIN(&all_events, ev, eq_next) {
-		/* Never release the last event */
-		if (!AST_RWLIST_NEXT(ev, eq_next)) {
+	while ((out = AST_LIST_REMOVE_HEAD(&session->out_queue, list))) {
+		ast_free(out);
+	}
+	session->out_bytes = 0;
+}
+
+/*! \internal \brief Wake the writer thread up to look for output again */
+static void manager_writer_wake(void)
+{
+	if (ast_alertpipe_writable(manager_writer_alert)) {
+		ast_alertpipe_write(manager_writer_alert);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Queue output for the writer thread to write to a session
+ *
+ * Output that would take the queue over the high water mark disconnects
+ * the session.  Under the drop policy events are dropped instead, while
+ * responses are kept until the queue is twice the high water mark.
+ *
+ * \param s The session
+ * \param string The output
+ * \param len The length of the output
+ * \param is_event Whether the output is an event
+ *
+ * \return The length of the output, or -1 if the session must be disconnected
+ */
+static int session_output_queue(struct mansession *s, const char *string, size_t len, int is_event)
+{
+	struct mansession_session *session = s->session;
+	struct manager_output *out;
+	int wake;
+
+	ast_mutex_lock(&session->out_lock);
+	if (session->out_error) {
+		ast_mutex_unlock(&session->out_lock);
+		s->write_error = 1;
+		return -1;
+	}
+
+	if (session->out_bytes + len > (size_t) outputhighwater) {
+		if (is_event && outputoverflow == OUTPUT_OVERFLOW_DROP) {
+			if (!(session->out_dropped++ % 1000)) {
+				ast_log(LOG_WARNING, "Manager session of '%s' is not reading its output, %u events dropped so far\n",
+					session->username, session->out_dropped);
+			}
+			ast_mutex_unlock(&session->out_lock);
+			return len;
+		}
+		if (outputoverflow == OUTPUT_OVERFLOW_DISCONNECT
+			|| session->out_bytes + len > 2 * (size_t) outputhighwater) {
+			ast_log(LOG_WARNING, "Manager session of '%s' from %s has %zu bytes of output waiting, disconnecting\n",
+				session->username, ast_sockaddr_stringify_addr(&session->addr), session->out_bytes);
+			session->out_error = 1;
+			session_output_free(session);
+			ast_mutex_unlock(&session->out_lock);
+			s->write_error = 1;
+			return -1;
+		}
+	}
+
+	out = ast_malloc(sizeof(*out) + len);
+	if (!out) {
+		ast_mutex_unlock(&session->out_lock);
+		s->write_error = 1;
+		return -1;
+	}
+	memcpy(out->data, string, len);
+	out->len = len;
+	out->written = 0;
+
+	wake = AST_LIST_EMPTY(&session->out_queue);
+	AST_LIST_INSERT_TAIL(&session->out_queue, out, list);
+	session->out_bytes += len;
+	if (session->out_bytes > session->out_peak) {
+		session->out_peak = session->out_bytes;
+	}
+	ast_mutex_unlock(&session->out_lock);
+
+	if (wake) {
+		manager_writer_wake();
+	}
+
+	return len;
+}
+
+/*!
+ * \internal
+ * \brief Write as much of the output queue of a session as its socket takes
+ */
+static void session_output_write(struct mansession_session *session)
+{
+	struct iovec iov[MANAGER_OUTPUT_IOV];
+	struct manager_output *out;
+	ssize_t res;
+	int count = 0;
+
+	ast_mutex_lock(&session->out_lock);
+	if (!session->out_async || session->out_error) {
+		ast_mutex_unlock(&session->out_lock);
+		return;
+	}
+
+	AST_LIST_TRAVERSE(&session->out_queue, out, list) {
+		iov[count].iov_base = out->data + out->written;
+		iov[count].iov_len = out->len - out->written;
+		if (++count == ARRAY_LEN(iov)) {
+			break;
+		}
+	}
+	if (!count) {
+		ast_mutex_unlock(&session->out_lock);
+		return;
+	}
+
+	res = writev(ast_iostream_get_fd(session->stream), iov, count);
+	if (res < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+			ast_mutex_unlock(&session->out_lock);
+			return;
+		}
+		ast_debug(1, "Manager session of '%s' failed to write: %s\n",
+			session->username, strerror(errno));
+		session->out_error = 1;
+		session_output_free(session);
+		ast_cond_broadcast(&session->out_cond);
+		ast_mutex_unlock(&session->out_lock);
+
+		/* Have the session thread notice and close the session */
+		ast_mutex_lock(&session->notify_lock);
+		if (session->waiting_thread != AST_PTHREADT_NULL) {
+			pthread_kill(session->waiting_thread, SIGURG);
+		} else {
+			session->pending_event = 1;
+		}
+		ast_mutex_unlock(&session->notify_lock);
+		return;
+	}
+
+	session->out_bytes -= res;
+	while ((out = AST_LIST_FIRST(&session->out_queue))) {
+		size_t left = out->len - out->written;
+
+		if ((size_t) res < left) {
+			out->written += res;
 			break;
 		}
+		res -= left;
+		AST_LIST_REMOVE_HEAD(&session->out_queue, list);
+		ast_free(out);
+	}
+	if (AST_LIST_EMPTY(&session->out_queue)) {
+		ast_cond_broadcast(&session->out_cond);
+	}
+	ast_mutex_unlock(&session->out_lock);
+}
 
-		/* 2.5 times whatever the HTTP timeout is (maximum 2.5 hours) is the maximum time that we will definitely cache an event */
-		if (ev->usecount == 0 && ast_tvdiff_sec(now, ev->tv) > (httptimeout > 3600 ? 3600 : httptimeout) * 2.5) {
-			AST_RWLIST_REMOVE_CURRENT(eq_next);
-			ast_free(ev);
+/*!
+ * \internal
+ * \brief Let the writer thread finish the output of a session and stop it
+ *
+ * Waits at most the session's write timeout for the output queue to empty
+ * and then throws away what is left.  Output is written by the session
+ * itself afterwards.
+ */
+static void session_output_finish(struct mansession_session *session)
+{
+	struct timeval deadline = ast_tvadd(ast_tvnow(), ast_samp2tv(session->writetimeout, 1000));
+	struct timespec ts = {
+		.tv_sec = deadline.tv_sec,
+		.tv_nsec = deadline.tv_usec * 1000,
+	};
+
+	int pending;
+
+	ast_mutex_lock(&session->out_lock);
+	while (!AST_LIST_EMPTY(&session->out_queue) && !session->out_error) {
+		if (ast_cond_timedwait(&session->out_cond, &session->out_lock, &ts) == ETIMEDOUT) {
+			break;
 		}
 	}
-	AST_RWLIST_TRAVERSE_SAFE_END;
-	AST_RWLIST_UNLOCK(&all_events);
+	pending = !AST_LIST_EMPTY(&session->out_queue);
+	session->out_async = 0;
+	session_output_free(session);
+	ast_mutex_unlock(&session->out_lock);
+
+	if (pending) {
+		/* Stop the writer thread polling the stream about to be closed */
+		manager_writer_wake();
+	}
+}
+
+/*!
+ * \internal
+ * \brief The writer thread
+ *
+ * Polls the sockets of the sessions with output waiting for room to write
+ * it, and the alert pipe for sessions that just queued some.
+ */
+static void *manager_writer(void *unused)
+{
+	AST_VECTOR(, struct mansession_session *) pending;
+	AST_VECTOR(, struct pollfd) fds;
+	size_t i;
+
+	if (AST_VECTOR_INIT(&pending, 16) || AST_VECTOR_INIT(&fds, 17)) {
+		AST_VECTOR_FREE(&pending);
+		return NULL;
+	}
+
+	while (!manager_writer_stop) {
+		struct ao2_container *sessions;
+		struct mansession_session *session;
+		struct ao2_iterator iter;
+		struct pollfd pfd = {
+			.fd = ast_alertpipe_readfd(manager_writer_alert),
+			.events = POLLIN,
+		};
+
+		AST_VECTOR_RESET(&pending, ao2_cleanup);
+		AST_VECTOR_RESET(&fds, AST_VECTOR_ELEM_CLEANUP_NOOP);
+		AST_VECTOR_APPEND(&fds, pfd);
+
+		sessions = ao2_global_obj_ref(mgr_sessions);
+		if (sessions) {
+			iter = ao2_iterator_init(sessions, 0);
+			ao2_ref(sessions, -1);
+			while ((session = ao2_iterator_next(&iter))) {
+				/* The stream is only certain to be open while the output is ours */
+				ast_mutex_lock(&session->out_lock);
+				pfd.fd = -1;
+				if (session->out_async && !session->out_error
+					&& !AST_LIST_EMPTY(&session->out_queue)) {
+					pfd.fd = ast_iostream_get_fd(session->stream);
+				}
+				ast_mutex_unlock(&session->out_lock);
+
+				pfd.events = POLLOUT;
+				if (pfd.fd < 0 || AST_VECTOR_APPEND(&pending, session)) {
+					ao2_ref(session, -1);
+				} else if (AST_VECTOR_APPEND(&fds, pfd)) {
+					AST_VECTOR_REMOVE_UNORDERED(&pending, AST_VECTOR_SIZE(&pending) - 1);
+					ao2_ref(session, -1);
+				}
+			}
+			ao2_iterator_destroy(&iter);
+		}
+
+		if (ast_poll(AST_VECTOR_GET_ADDR(&fds, 0), AST_VECTOR_SIZE(&fds), -1) < 0) {
+			if (errno != EINTR) {
+				ast_log(LOG_WARNING, "Manager writer poll failed: %s\n", strerror(errno));
+			}
+			continue;
+		}
+
+		if (AST_VECTOR_GET(&fds, 0).revents) {
+			ast_alertpipe_flush(manager_writer_alert);
+		}
+		for (i = 0; i < AST_VECTOR_SIZE(&pending); i++) {
+			if (AST_VECTOR_GET(&fds, i + 1).revents) {
+				session_output_write(AST_VECTOR_GET(&pending, i));
+			}
+		}
+	}
+
+	AST_VECTOR_RESET(&pending, ao2_cleanup);
+	AST_VECTOR_FREE(&pending);
+	AST_VECTOR_FREE(&fds);
+
+	return NULL;
 }
 
 /*!
@@ -2351,14 +2872,16 @@ static struct mansession_session *unref_mansession(struct mansession_session *s)
 
 static void event_filter_destructor(void *obj)
 {
-	regex_t *regex_filter = obj;
-	regfree(regex_filter);
+	struct event_filter_entry *filter = obj;
+
+	regfree(&filter->regex);
+	ast_free(filter->event_name);
 }
 
 static void session_destructor(void *obj)
 {
 	struct mansession_session *session = obj;
-	struct eventqent *eqe = session->last_ev;
+	struct eventqent *eqe;
 	struct ast_datastore *datastore;
 
 	/* Get rid of each of the data stores on the session */
@@ -2367,9 +2890,13 @@ static void session_destructor(void *obj)
 		ast_datastore_free(datastore);
 	}
 
-	if (eqe) {
-		ast_atomic_fetchadd_int(&eqe->usecount, -1);
+	while ((eqe = session_event_pop(session))) {
+		ao2_ref(eqe, -1);
 	}
+	ast_free(session->events);
+	session_output_free(session);
+	ast_free(session->json_pending);
+
 	if (session->chanvars) {
 		ast_variables_destroy(session->chanvars);
 	}
@@ -2383,6 +2910,8 @@ static void session_destructor(void *obj)
 	}
 
 	ast_mutex_destroy(&session->notify_lock);
+	ast_mutex_destroy(&session->out_lock);
+	ast_cond_destroy(&session->out_cond);
 }
 
 /*! \brief Allocate manager session structure and add it to the list of sessions */
@@ -2395,6 +2924,8 @@ static struct mansession_session *build_mansession(const struct ast_sockaddr *ad
 	if (!newsession) {
 		return NULL;
 	}
+	ast_mutex_init(&newsession->out_lock);
+	ast_cond_init(&newsession->out_cond, NULL);
 
 	newsession->whitefilters = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX, 0, NULL, NULL);
 	newsession->blackfilters = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX, 0, NULL, NULL);
@@ -2554,6 +3085,7 @@ static char *handle_showmancmd(struct ast_cli_entry *e, int cmd, struct ast_cli_
 				auth_str = authority_to_str(cur->authority, &authority);
 
 #ifdef AST_XML_DOCS
+				action_load_xmldoc(cur);
 				if (cur->docsrc == AST_XML_DOC) {
 					char *syntax = ast_xmldoc_printable(S_OR(cur->syntax, "Not available"), 1);
 					char *synopsis = ast_xmldoc_printable(S_OR(cur->synopsis, "Not available"), 1);
@@ -2804,6 +3336,9 @@ static char *handle_showmancmds(struct ast_cli_entry *e, int cmd, struct ast_cli
 	ast_cli(a->fd, HSMC_FORMAT, name_len, name_len, "------", space_remaining, "--------");
 
 	AST_RWLIST_TRAVERSE(&actions, cur, list) {
+#ifdef AST_XML_DOCS
+		action_load_xmldoc(cur);
+#endif
 		ast_cli(a->fd, HSMC_FORMAT, name_len, name_len, cur->action, space_remaining, cur->synopsis);
 	}
 	AST_RWLIST_UNLOCK(&actions);
@@ -2887,8 +3422,8 @@ static char *handle_showmanconn(struct ast_cli_entry *e, int cmd, struct ast_cli
 	struct ao2_container *sessions;
 	struct mansession_session *session;
 	time_t now = time(NULL);
-#define HSMCONN_FORMAT1 "  %-15.15s  %-55.55s  %-10.10s  %-10.10s  %-8.8s  %-8.8s  %-10.10s  %-10.10s\n"
-#define HSMCONN_FORMAT2 "  %-15.15s  %-55.55s  %-10d  %-10d  %-8d  %-8d  %-10.10d  %-10.10d\n"
+#define HSMCONN_FORMAT1 "  %-15.15s  %-55.55s  %-10.10s  %-10.10s  %-8.8s  %-8.8s  %-10.10s  %-10.10s  %-10.10s  %-10.10s  %-10.10s\n"
+#define HSMCONN_FORMAT2 "  %-15.15s  %-55.55s  %-10d  %-10d  %-8d  %-8d  %-10.10d  %-10.10d  %-10zu  %-10zu  %-10u\n"
 	int count = 0;
 	struct ao2_iterator i;
 
@@ -2898,19 +3433,32 @@ static char *handle_showmanconn(struct ast_cli_entry *e, int cmd, struct ast_cli
 		e->usage =
 			"Usage: manager show connected\n"
 			"	Prints a listing of the users that are currently connected to the\n"
-			"Asterisk manager interface.\n";
+			"Asterisk manager interface, with the bytes of output waiting to be\n"
+			"written to each, the most that ever waited and the events dropped\n"
+			"because too much was waiting.\n";
 		return NULL;
 	case CLI_GENERATE:
 		return NULL;
 	}
 
-	ast_cli(a->fd, HSMCONN_FORMAT1, "Username", "IP Address", "Start", "Elapsed", "FileDes", "HttpCnt", "ReadPerms", "WritePerms");
+	ast_cli(a->fd, HSMCONN_FORMAT1, "Username", "IP Address", "Start", "Elapsed", "FileDes", "HttpCnt", "ReadPerms", "WritePerms",
+		"OutQueued", "OutPeak", "OutDropped");
 
 	sessions = ao2_global_obj_ref(mgr_sessions);
 	if (sessions) {
 		i = ao2_iterator_init(sessions, 0);
 		ao2_ref(sessions, -1);
 		while ((session = ao2_iterator_next(&i))) {
+			size_t out_bytes;
+			size_t out_peak;
+			unsigned int out_dropped;
+
+			ast_mutex_lock(&session->out_lock);
+			out_bytes = session->out_bytes;
+			out_peak = session->out_peak;
+			out_dropped = session->out_dropped;
+			ast_mutex_unlock(&session->out_lock);
+
 			ao2_lock(session);
 			ast_cli(a->fd, HSMCONN_FORMAT2, session->username,
 				ast_sockaddr_stringify_addr(&session->addr),
@@ -2919,7 +3467,10 @@ static char *handle_showmanconn(struct ast_cli_entry *e, int cmd, struct ast_cli
 				session->stream ? ast_iostream_get_fd(session->stream) : -1,
 				session->inuse,
 				session->readperm,
-				session->writeperm);
+				session->writeperm,
+				out_bytes,
+				out_peak,
+				out_dropped);
 			count++;
 			ao2_unlock(session);
 			unref_mansession(session);
@@ -2935,25 +3486,45 @@ static char *handle_showmanconn(struct ast_cli_entry *e, int cmd, struct ast_cli
 /* Should change to "manager show connected" */
 static char *handle_showmaneventq(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
-	struct eventqent *s;
+	struct ao2_container *sessions;
+	struct mansession_session *session;
+	struct ao2_iterator i;
+	size_t n;
+
 	switch (cmd) {
 	case CLI_INIT:
 		e->command = "manager show eventq";
 		e->usage =
 			"Usage: manager show eventq\n"
-			"	Prints a listing of all events pending in the Asterisk manger\n"
-			"event queue.\n";
+			"	Prints a listing of all events pending in the event queues\n"
+			"of the Asterisk manager sessions.\n";
 		return NULL;
 	case CLI_GENERATE:
 		return NULL;
 	}
-	AST_RWLIST_RDLOCK(&all_events);
-	AST_RWLIST_TRAVERSE(&all_events, s, eq_next) {
-		ast_cli(a->fd, "Usecount: %d\n", s->usecount);
-		ast_cli(a->fd, "Category: %d\n", s->category);
-		ast_cli(a->fd, "Event:\n%s", s->eventdata);
+
+	sessions = ao2_global_obj_ref(mgr_sessions);
+	if (!sessions) {
+		return CLI_SUCCESS;
 	}
-	AST_RWLIST_UNLOCK(&all_events);
+	i = ao2_iterator_init(sessions, 0);
+	ao2_ref(sessions, -1);
+	while ((session = ao2_iterator_next(&i))) {
+		ast_mutex_lock(&session->notify_lock);
+		ast_cli(a->fd, "Session: %s from %s\n", session->username,
+			ast_sockaddr_stringify_addr(&session->addr));
+		ast_cli(a->fd, "Queued: %zu\n", session->events_count);
+		ast_cli(a->fd, "Dropped: %u\n", session->events_dropped);
+		for (n = 0; n < session->events_count; n++) {
+			struct eventqent *eqe = session->events[(session->events_head + n) % session->events_size];
+
+			ast_cli(a->fd, "Category: %d\n", eqe->category);
+			ast_cli(a->fd, "Event:\n%s", eqe->eventdata);
+		}
+		ast_mutex_unlock(&session->notify_lock);
+		unref_mansession(session);
+	}
+	ao2_iterator_destroy(&i);
 
 	return CLI_SUCCESS;
 }
@@ -2980,19 +3551,6 @@ static char *handle_manager_reload(struct ast_cli_entry *e, int cmd, struct ast_
 	return CLI_SUCCESS;
 }
 
-static struct eventqent *advance_event(struct eventqent *e)
-{
-	struct eventqent *next;
-
-	AST_RWLIST_RDLOCK(&all_events);
-	if ((next = AST_RWLIST_NEXT(e, eq_next))) {
-		ast_atomic_fetchadd_int(&next->usecount, 1);
-		ast_atomic_fetchadd_int(&e->usecount, -1);
-	}
-	AST_RWLIST_UNLOCK(&all_events);
-	return next;
-}
-
 #define	GET_HEADER_FIRST_MATCH	0
 #define	GET_HEADER_LAST_MATCH	1
 #define	GET_HEADER_SKIP_EMPTY	2
@@ -3248,14 +3806,174 @@ int ast_hook_send_action(struct manager_custom_hook *hook, const char *msg)
 	return ret;
 }
 
+/*!
+ * \internal
+ * \brief Write a string to a stream of a session
+ */
+static int send_stream(struct mansession *s, struct ast_iostream *stream, const char *string, int is_event)
+{
+	int len, res;
+
+	len = strlen(string);
+	if (stream == s->session->stream && s->session->out_async) {
+		return session_output_queue(s, string, len, is_event);
+	}
+
+	ast_iostream_set_timeout_inactivity(stream, s->session->writetimeout);
+	res = ast_iostream_write(stream, string, len);
+	ast_iostream_set_timeout_disable(stream);
+
+	if (res < len) {
+		s->write_error = 1;
+	}
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Add a header of an AMI message to its JSON object
+ *
+ * The values of a header given more than once are gathered in an array.
+ */
+static void manager_json_add(struct ast_json *obj, const char *key, const char *value)
+{
+	struct ast_json *str;
+	struct ast_json *prev;
+
+	str = ast_json_string_create(AST_JSON_UTF8_VALIDATE(value));
+	if (!str) {
+		return;
+	}
+
+	prev = ast_json_object_get(obj, key);
+	if (!prev) {
+		ast_json_object_set(obj, key, str);
+		return;
+	}
+
+	if (ast_json_typeof(prev) != AST_JSON_ARRAY) {
+		struct ast_json *array = ast_json_array_create();
+
+		if (!array || ast_json_array_append(array, ast_json_ref(prev))) {
+			ast_json_unref(array);
+			ast_json_unref(str);
+			return;
+		}
+		ast_json_object_set(obj, key, array);
+		prev = array;
+	}
+	ast_json_array_append(prev, str);
+}
+
+/*!
+ * \internal
+ * \brief Convert an AMI message to a line of JSON
+ *
+ * Each "Key: Value" line of the message becomes a member of a JSON object.
+ * Lines without a key are gathered under "Output".
+ *
+ * \param message The message
+ * \param len The length of the message
+ *
+ * \return The JSON object on a line of its own, which the caller must free,
+ *         or NULL on error
+ */
+static char *manager_message_to_json(const char *message, size_t len)
+{
+	struct ast_json *obj;
+	char *copy;
+	char *next;
+	char *line;
+	char *dumped;
+	char *json = NULL;
+
+	copy = ast_strndup(message, len);
+	obj = ast_json_object_create();
+	if (!copy || !obj) {
+		ast_free(copy);
+		ast_json_unref(obj);
+		return NULL;
+	}
+
+	next = copy;
+	while ((line = strsep(&next, "\n"))) {
+		char *value;
+
+		ast_trim_blanks(line);
+		if (ast_strlen_zero(line)) {
+			continue;
+		}
+
+		value = strchr(line, ':');
+		if (value) {
+			*value++ = '\0';
+			manager_json_add(obj, AST_JSON_UTF8_VALIDATE(line), ast_skip_blanks(value));
+		} else {
+			manager_json_add(obj, "Output", line);
+		}
+	}
+	ast_free(copy);
+
+	dumped = ast_json_dump_string(obj);
+	ast_json_unref(obj);
+	if (dumped) {
+		if (ast_asprintf(&json, "%s\n", dumped) < 0) {
+			json = NULL;
+		}
+		ast_json_free(dumped);
+	}
+
+	return json;
+}
+
+/*!
+ * \internal
+ * \brief Send a string to a session using the JSON format
+ *
+ * The string is held until it completes an AMI message, which is then
+ * sent as a line of JSON.
+ */
+static int session_json_send(struct mansession *s, struct ast_iostream *stream, const char *string, int is_event)
+{
+	struct mansession_session *session = s->session;
+	char *buf;
+	char *end;
+
+	if (!session->json_pending && !(session->json_pending = ast_str_create(256))) {
+		s->write_error = 1;
+		return -1;
+	}
+	ast_str_append(&session->json_pending, 0, "%s", string);
+
+	buf = ast_str_buffer(session->json_pending);
+	while ((end = strstr(buf, "\r\n\r\n"))) {
+		size_t len = end - buf + 4;
+		char *json = manager_message_to_json(buf, len);
+
+		if (json) {
+			int res = send_stream(s, stream, json, is_event);
+
+			ast_free(json);
+			if (res < 0) {
+				ast_str_reset(session->json_pending);
+				return -1;
+			}
+		}
+		memmove(buf, buf + len, strlen(buf + len) + 1);
+		ast_str_update(session->json_pending);
+	}
+
+	return strlen(string);
+}
+
 /*!
  * helper function to send a string to the socket.
  * Return -1 on error (e.g. buffer full).
  */
-static int send_string(struct mansession *s, char *string)
+static int __send_string(struct mansession *s, char *string, int is_event)
 {
 	struct ast_iostream *stream;
-	int len, res;
 
 	/* It's a result from one of the hook's action invocation */
 	if (s->hook) {
@@ -3269,16 +3987,16 @@ static int send_string(struct mansession *s, char *string)
 
 	stream = s->stream ? s->stream : s->session->stream;
 
-	len = strlen(string);
-	ast_iostream_set_timeout_inactivity(stream, s->session->writetimeout);
-	res = ast_iostream_write(stream, string, len);
-	ast_iostream_set_timeout_disable(stream);
-
-	if (res < len) {
-		s->write_error = 1;
+	if (stream == s->session->stream && s->session->format == MANAGER_FORMAT_JSON) {
+		return session_json_send(s, stream, string, is_event);
 	}
 
-	return res;
+	return send_stream(s, stream, string, is_event);
+}
+
+static int send_string(struct mansession *s, char *string)
+{
+	return __send_string(s, string, 0);
 }
 
 /*!
@@ -3477,6 +4195,21 @@ void astman_send_list_complete_end(struct mansession *s)
 	astman_append(s, "\r\n");
 }
 
+int astman_get_list_page(struct mansession *s, const struct message *m, size_t *limit, const char **after)
+{
+	const char *limit_str = astman_get_header(m, "Limit");
+	unsigned int value = 0;
+
+	if (!ast_strlen_zero(limit_str) && sscanf(limit_str, "%30u", &value) != 1) {
+		astman_send_error(s, m, "Invalid Limit");
+		return -1;
+	}
+
+	*limit = value;
+	*after = S_OR(astman_get_header(m, "After"), NULL);
+	return 0;
+}
+
 /*! \brief Lock the 'mansession' structure. */
 static void mansession_lock(struct mansession *s)
 {
@@ -3738,7 +4471,7 @@ static int authenticate(struct mansession *s, const struct message *m)
 	const char *password = astman_get_header(m, "Secret");
 	int error = -1;
 	struct ast_manager_user *user = NULL;
-	regex_t *regex_filter;
+	struct event_filter_entry *regex_filter;
 	struct ao2_iterator filter_iter;
 
 	if (ast_strlen_zero(username)) {	/* missing username */
@@ -4564,9 +5297,11 @@ static int action_waitevent(struct mansession *s, const struct message *m)
 
 	for (x = 0; x < timeout || timeout < 0; x++) {
 		ao2_lock(s->session);
-		if (AST_RWLIST_NEXT(s->session->last_ev, eq_next)) {
+		ast_mutex_lock(&s->session->notify_lock);
+		if (s->session->events_count) {
 			needexit = 1;
 		}
+		ast_mutex_unlock(&s->session->notify_lock);
 		if (s->session->needdestroy) {
 			needexit = 1;
 		}
@@ -4595,20 +5330,19 @@ static int action_waitevent(struct mansession *s, const struct message *m)
 
 	ast_mutex_lock(&s->session->notify_lock);
 	if (s->session->waiting_thread == pthread_self()) {
-		struct eventqent *eqe = s->session->last_ev;
+		struct eventqent *eqe;
 
 		s->session->waiting_thread = AST_PTHREADT_NULL;
 		ast_mutex_unlock(&s->session->notify_lock);
 
 		ao2_lock(s->session);
 		astman_send_response(s, m, "Success", "Waiting for Event completed.");
-		while ((eqe = advance_event(eqe))) {
+		while ((eqe = session_event_pop(s->session))) {
 			if (((s->session->readperm & eqe->category) == eqe->category)
-				&& ((s->session->send_events & eqe->category) == eqe->category)
-				&& match_filter(s, eqe->eventdata)) {
+				&& ((s->session->send_events & eqe->category) == eqe->category)) {
 				astman_append(s, "%s", eqe->eventdata);
 			}
-			s->session->last_ev = eqe;
+			ao2_ref(eqe, -1);
 		}
 		astman_append(s,
 			"Event: WaitEventComplete\r\n"
@@ -4632,6 +5366,9 @@ static int action_listcommands(struct mansession *s, const struct message *m)
 	AST_RWLIST_RDLOCK(&actions);
 	AST_RWLIST_TRAVERSE(&actions, cur, list) {
 		if ((s->session->writeperm & cur->authority) || cur->authority == 0) {
+#ifdef AST_XML_DOCS
+			action_load_xmldoc(cur);
+#endif
 			astman_append(s, "%s: %s (Priv: %s)\r\n",
 				cur->action, cur->synopsis, authority_to_str(cur->authority, &temp));
 		}
@@ -4694,6 +5431,7 @@ static int action_logoff(struct mansession *s, const struct message *m)
 
 static int action_login(struct mansession *s, const struct message *m)
 {
+	const char *format = astman_get_header(m, "Format");
 
 	/* still authenticated - don't process again */
 	if (s->session->authenticated) {
@@ -4701,12 +5439,21 @@ static int action_login(struct mansession *s, const struct message *m)
 		return 0;
 	}
 
+	if (!ast_strlen_zero(format) && strcasecmp(format, "ami") && strcasecmp(format, "json")) {
+		astman_send_error(s, m, "Invalid Format");
+		return 0;
+	}
+
 	if (authenticate(s, m)) {
 		sleep(1);
 		astman_send_error(s, m, "Authentication failed");
 		return -1;
 	}
 	s->session->authenticated = 1;
+	if (!s->session->managerid && !strcasecmp(format, "json")) {
+		/* HTTP sessions have formats of their own */
+		s->session->format = MANAGER_FORMAT_JSON;
+	}
 	ast_atomic_fetchadd_int(&unauth_sessions, -1);
 	if (manager_displayconnects(s->session)) {
 		ast_verb(2, "%sManager '%s' logged on from %s\n", (s->session->managerid ? "HTTP " : ""), s->session->username, ast_sockaddr_stringify_addr(&s->session->addr));
@@ -6322,7 +7069,71 @@ aocmessage_cleanup:
 	if (chan) {
 		chan = ast_channel_unref(chan);
 	}
-	return 0;
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Check an application may be originated by the session, sending an error if not
+ *
+ * \retval 0 if it may be
+ * \retval -1 if the error was sent
+ */
+static int originate_forbidden(struct mansession *s, const struct message *m,
+	const char *app, const char *appdata)
+{
+	if (!ast_strlen_zero(app) && s->session) {
+		int bad_appdata = 0;
+		/* To run the System application (or anything else that goes to
+		 * shell), you must have the additional System privilege */
+		if (!(s->session->writeperm & EVENT_FLAG_SYSTEM)
+			&& (
+				strcasestr(app, "system") ||      /* System(rm -rf /)
+				                                     TrySystem(rm -rf /)       */
+				strcasestr(app, "exec") ||        /* Exec(System(rm -rf /))
+				                                     TryExec(System(rm -rf /)) */
+				strcasestr(app, "agi") ||         /* AGI(/bin/rm,-rf /)
+				                                     EAGI(/bin/rm,-rf /)       */
+				strcasestr(app, "mixmonitor") ||  /* MixMonitor(blah,,rm -rf)  */
+				strcasestr(app, "externalivr") || /* ExternalIVR(rm -rf)       */
+				strcasestr(app, "originate") ||   /* Originate(Local/1234,app,System,rm -rf) */
+				(strstr(appdata, "SHELL") && (bad_appdata = 1)) ||       /* NoOp(${SHELL(rm -rf /)})  */
+				(strstr(appdata, "EVAL") && (bad_appdata = 1))           /* NoOp(${EVAL(${some_var_containing_SHELL})}) */
+				)) {
+			char error_buf[64];
+			snprintf(error_buf, sizeof(error_buf), "Originate Access Forbidden: %s", bad_appdata ? "Data" : "Application");
+			astman_send_error(s, m, error_buf);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Get the variables to set on an originated channel, the session's then the action's
+ */
+static struct ast_variable *originate_variables(struct mansession *s, const struct message *m)
+{
+	struct ast_variable *vars;
+
+	vars = astman_get_variables(m);
+	if (s->session && s->session->chanvars) {
+		struct ast_variable *v, *old;
+		old = vars;
+		vars = NULL;
+
+		/* The variables in the AMI originate action are appended at the end of the list, to override any user variables that apply */
+
+		vars = ast_variables_dup(s->session->chanvars);
+		if (old) {
+			for (v = vars; v->next; v = v->next );
+			v->next = old;	/* Append originate variables at end of list */
+		}
+	}
+
+	return vars;
 }
 
 static int action_originate(struct mansession *s, const struct message *m)
@@ -6417,30 +7228,9 @@ static int action_originate(struct mansession *s, const struct message *m)
 		ast_format_cap_update_by_allow_disallow(cap, codecs, 1);
 	}
 
-	if (!ast_strlen_zero(app) && s->session) {
-		int bad_appdata = 0;
-		/* To run the System application (or anything else that goes to
-		 * shell), you must have the additional System privilege */
-		if (!(s->session->writeperm & EVENT_FLAG_SYSTEM)
-			&& (
-				strcasestr(app, "system") ||      /* System(rm -rf /)
-				                                     TrySystem(rm -rf /)       */
-				strcasestr(app, "exec") ||        /* Exec(System(rm -rf /))
-				                                     TryExec(System(rm -rf /)) */
-				strcasestr(app, "agi") ||         /* AGI(/bin/rm,-rf /)
-				                                     EAGI(/bin/rm,-rf /)       */
-				strcasestr(app, "mixmonitor") ||  /* MixMonitor(blah,,rm -rf)  */
-				strcasestr(app, "externalivr") || /* ExternalIVR(rm -rf)       */
-				strcasestr(app, "originate") ||   /* Originate(Local/1234,app,System,rm -rf) */
-				(strstr(appdata, "SHELL") && (bad_appdata = 1)) ||       /* NoOp(${SHELL(rm -rf /)})  */
-				(strstr(appdata, "EVAL") && (bad_appdata = 1))           /* NoOp(${EVAL(${some_var_containing_SHELL})}) */
-				)) {
-			char error_buf[64];
-			snprintf(error_buf, sizeof(error_buf), "Originate Access Forbidden: %s", bad_appdata ? "Data" : "Application");
-			astman_send_error(s, m, error_buf);
-			res = 0;
-			goto fast_orig_cleanup;
-		}
+	if (originate_forbidden(s, m, app, appdata)) {
+		res = 0;
+		goto fast_orig_cleanup;
 	}
 
 	/* Check early if the extension exists. If not, we need to bail out here. */
@@ -6454,20 +7244,7 @@ static int action_originate(struct mansession *s, const struct message *m)
 	}
 
 	/* Allocate requested channel variables */
-	vars = astman_get_variables(m);
-	if (s->session && s->session->chanvars) {
-		struct ast_variable *v, *old;
-		old = vars;
-		vars = NULL;
-
-		/* The variables in the AMI originate action are appended at the end of the list, to override any user variables that apply */
-
-		vars = ast_variables_dup(s->session->chanvars);
-		if (old) {
-			for (v = vars; v->next; v = v->next );
-			v->next = old;	/* Append originate variables at end of list */
-		}
-	}
+	vars = originate_variables(s, m);
 
 	/* For originate async - we can bridge in early media stage */
 	bridge_early = ast_true(early_media);
@@ -6538,6 +7315,184 @@ fast_orig_cleanup:
 	return 0;
 }
 
+/*! \brief The calls of a BulkOriginate action, started by a dial batch */
+struct bulk_originate {
+	AST_VECTOR(, struct fast_originate_helper *) calls;
+};
+
+static void bulk_originate_destructor(void *obj)
+{
+	struct bulk_originate *bulk = obj;
+	int i;
+
+	/* Only the calls that were never started are left */
+	for (i = 0; i < AST_VECTOR_SIZE(&bulk->calls); i++) {
+		struct fast_originate_helper *fast = AST_VECTOR_GET(&bulk->calls, i);
+
+		if (fast) {
+			destroy_fast_originate_helper(fast);
+		}
+	}
+	AST_VECTOR_FREE(&bulk->calls);
+}
+
+static void bulk_originate_call(void *data, size_t index)
+{
+	struct bulk_originate *bulk = data;
+	struct fast_originate_helper *fast = AST_VECTOR_GET(&bulk->calls, index);
+
+	/* Every call is started once, by one thread, so no lock is needed */
+	AST_VECTOR_REPLACE(&bulk->calls, index, NULL);
+	fast_originate(fast);
+}
+
+static int action_bulkoriginate(struct mansession *s, const struct message *m)
+{
+	static const char channel_hdr[] = "Channel:";
+	const char *exten = astman_get_header(m, "Exten");
+	const char *context = astman_get_header(m, "Context");
+	const char *priority = astman_get_header(m, "Priority");
+	const char *timeout = astman_get_header(m, "Timeout");
+	const char *callerid = astman_get_header(m, "CallerID");
+	const char *account = astman_get_header(m, "Account");
+	const char *app = astman_get_header(m, "Application");
+	const char *appdata = astman_get_header(m, "Data");
+	const char *id = astman_get_header(m, "ActionID");
+	const char *codecs = astman_get_header(m, "Codecs");
+	const char *early_media = astman_get_header(m, "Earlymedia");
+	const char *rate = astman_get_header(m, "Rate");
+	struct bulk_originate *bulk = NULL;
+	struct ast_variable *vars = NULL;
+	struct ast_format_cap *cap;
+	char *l = NULL, *n = NULL;
+	char tmp2[256];
+	unsigned int cps = 0;
+	int pi = 0;
+	int to = 30000;
+	int x;
+
+	if (originate_forbidden(s, m, app, appdata)) {
+		return 0;
+	}
+	if (ast_strlen_zero(app) && (ast_strlen_zero(exten) || ast_strlen_zero(context))) {
+		astman_send_error(s, m, "Originate with 'Exten' requires 'Context' and 'Priority'");
+		return 0;
+	}
+	if (!ast_strlen_zero(priority) && (sscanf(priority, "%30d", &pi) != 1)) {
+		if ((pi = ast_findlabel_extension(NULL, context, exten, priority, NULL)) < 1) {
+			astman_send_error(s, m, "Invalid priority");
+			return 0;
+		}
+	}
+	if (ast_strlen_zero(app) && !pi) {
+		astman_send_error(s, m, "Originate with 'Exten' requires 'Context' and 'Priority'");
+		return 0;
+	}
+	if (!ast_strlen_zero(timeout) && (sscanf(timeout, "%30d", &to) != 1)) {
+		astman_send_error(s, m, "Invalid timeout");
+		return 0;
+	}
+	if (!ast_strlen_zero(rate) && (sscanf(rate, "%30u", &cps) != 1)) {
+		astman_send_error(s, m, "Invalid rate");
+		return 0;
+	}
+	ast_copy_string(tmp2, callerid, sizeof(tmp2));
+	ast_callerid_parse(tmp2, &n, &l);
+	if (n) {
+		if (ast_strlen_zero(n)) {
+			n = NULL;
+		}
+	}
+	if (l) {
+		ast_shrink_phone_number(l);
+		if (ast_strlen_zero(l)) {
+			l = NULL;
+		}
+	}
+
+	/* Check early if the extension exists. If not, we need to bail out here. */
+	if (ast_strlen_zero(app) && !ast_exists_extension(NULL, context, exten, pi, l)) {
+		astman_send_error(s, m, "Extension does not exist.");
+		return 0;
+	}
+
+	cap = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+	bulk = ao2_alloc_options(sizeof(*bulk), bulk_originate_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!cap || !bulk || AST_VECTOR_INIT(&bulk->calls, 16)) {
+		astman_send_error(s, m, "Internal Error. Memory allocation failure.");
+		goto cleanup;
+	}
+	ast_format_cap_append(cap, ast_format_slin, 0);
+	if (!ast_strlen_zero(codecs)) {
+		ast_format_cap_remove_by_type(cap, AST_MEDIA_TYPE_UNKNOWN);
+		ast_format_cap_update_by_allow_disallow(cap, codecs, 1);
+	}
+
+	vars = originate_variables(s, m);
+
+	/* Process all "Channel:" headers. */
+	for (x = 0; x < m->hdrcount; x++) {
+		struct fast_originate_helper *fast;
+		char tmp[256];
+		char *tech, *data;
+
+		if (strncasecmp(channel_hdr, m->headers[x], strlen(channel_hdr))) {
+			continue;
+		}
+		ast_copy_string(tmp, ast_skip_blanks(m->headers[x] + strlen(channel_hdr)), sizeof(tmp));
+		tech = tmp;
+		data = strchr(tmp, '/');
+		if (!data || ast_strlen_zero(tech) || ast_strlen_zero(data + 1)) {
+			astman_send_error_va(s, m, "Invalid channel '%s'", tmp);
+			goto cleanup;
+		}
+		*data++ = '\0';
+
+		fast = ast_calloc(1, sizeof(*fast));
+		if (!fast || ast_string_field_init(fast, 252)) {
+			ast_free(fast);
+			astman_send_error(s, m, "Internal Error. Memory allocation failure.");
+			goto cleanup;
+		}
+		if (!ast_strlen_zero(id)) {
+			ast_string_field_build(fast, idtext, "ActionID: %s\r\n", id);
+		}
+		ast_string_field_set(fast, tech, tech);
+		ast_string_field_set(fast, data, data);
+		ast_string_field_set(fast, app, app);
+		ast_string_field_set(fast, appdata, appdata);
+		ast_string_field_set(fast, cid_num, l);
+		ast_string_field_set(fast, cid_name, n);
+		ast_string_field_set(fast, context, context);
+		ast_string_field_set(fast, exten, exten);
+		ast_string_field_set(fast, account, account);
+		fast->vars = ast_variables_dup(vars);
+		fast->cap = ao2_bump(cap);
+		fast->timeout = to;
+		fast->early_media = ast_true(early_media);
+		fast->priority = pi;
+		if ((vars && !fast->vars) || AST_VECTOR_APPEND(&bulk->calls, fast)) {
+			destroy_fast_originate_helper(fast);
+			astman_send_error(s, m, "Internal Error. Memory allocation failure.");
+			goto cleanup;
+		}
+	}
+
+	if (!AST_VECTOR_SIZE(&bulk->calls)) {
+		astman_send_error(s, m, "Channel not specified");
+	} else if (ast_dial_batch_start(bulk, AST_VECTOR_SIZE(&bulk->calls), cps, bulk_originate_call)) {
+		astman_send_error(s, m, "Originate failed");
+	} else {
+		astman_send_ack(s, m, "Originate successfully queued");
+	}
+
+cleanup:
+	ast_variables_destroy(vars);
+	ao2_cleanup(bulk);
+	ao2_cleanup(cap);
+	return 0;
+}
+
 static int action_mailboxstatus(struct mansession *s, const struct message *m)
 {
 	const char *mailbox = astman_get_header(m, "Mailbox");
@@ -6682,11 +7637,11 @@ static int action_timeout(struct mansession *s, const struct message *m)
 
 static int whitefilter_cmp_fn(void *obj, void *arg, void *data, int flags)
 {
-	regex_t *regex_filter = obj;
+	struct event_filter_entry *filter = obj;
 	const char *eventdata = arg;
 	int *result = data;
 
-	if (!regexec(regex_filter, eventdata, 0, NULL, 0)) {
+	if (!regexec(&filter->regex, eventdata, 0, NULL, 0)) {
 		*result = 1;
 		return (CMP_MATCH | CMP_STOP);
 	}
@@ -6696,11 +7651,11 @@ static int whitefilter_cmp_fn(void *obj, void *arg, void *data, int flags)
 
 static int blackfilter_cmp_fn(void *obj, void *arg, void *data, int flags)
 {
-	regex_t *regex_filter = obj;
+	struct event_filter_entry *filter = obj;
 	const char *eventdata = arg;
 	int *result = data;
 
-	if (!regexec(regex_filter, eventdata, 0, NULL, 0)) {
+	if (!regexec(&filter->regex, eventdata, 0, NULL, 0)) {
 		*result = 0;
 		return (CMP_MATCH | CMP_STOP);
 	}
@@ -6766,7 +7721,8 @@ static int action_filter(struct mansession *s, const struct message *m)
  *
  */
 static enum add_filter_result manager_add_filter(const char *filter_pattern, struct ao2_container *whitefilters, struct ao2_container *blackfilters) {
-	regex_t *new_filter = ao2_t_alloc(sizeof(*new_filter), event_filter_destructor, "event_filter allocation");
+	struct event_filter_entry *new_filter = ao2_t_alloc(sizeof(*new_filter), event_filter_destructor, "event_filter allocation");
+	const char *name;
 	int is_blackfilter;
 
 	if (!new_filter) {
@@ -6780,11 +7736,25 @@ static enum add_filter_result manager_add_filter(const char *filter_pattern, str
 		is_blackfilter = 0;
 	}
 
-	if (regcomp(new_filter, filter_pattern, REG_EXTENDED | REG_NOSUB)) {
+	if (regcomp(&new_filter->regex, filter_pattern, REG_EXTENDED | REG_NOSUB)) {
 		ao2_t_ref(new_filter, -1, "failed to make regex");
 		return FILTER_COMPILE_FAIL;
 	}
 
+	/* See if the filter can be decided from the name of the event */
+	name = filter_pattern;
+	if (*name == '^') {
+		new_filter->anchored = 1;
+		name++;
+	}
+	if (!strncmp(name, "Event: ", 7) && name[7]) {
+		name += 7;
+		if (strspn(name, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_") == strlen(name)) {
+			new_filter->event_name = ast_strdup(name);
+			new_filter->event_name_len = strlen(name);
+		}
+	}
+
 	if (is_blackfilter) {
 		ao2_t_link(blackfilters, new_filter, "link new filter into black user container");
 	} else {
@@ -6796,7 +7766,7 @@ static enum add_filter_result manager_add_filter(const char *filter_pattern, str
 	return FILTER_SUCCESS;
 }
 
-static int match_filter(struct mansession *s, char *eventdata)
+static int match_filter(struct mansession_session *session, char *eventdata)
 {
 	int result = 0;
 
@@ -6805,20 +7775,20 @@ static int match_filter(struct mansession *s, char *eventdata)
 	} else {
 		ast_debug(4, "Examining AMI event:\n%s\n", eventdata);
 	}
-	if (!ao2_container_count(s->session->whitefilters) && !ao2_container_count(s->session->blackfilters)) {
+	if (!ao2_container_count(session->whitefilters) && !ao2_container_count(session->blackfilters)) {
 		return 1; /* no filtering means match all */
-	} else if (ao2_container_count(s->session->whitefilters) && !ao2_container_count(s->session->blackfilters)) {
+	} else if (ao2_container_count(session->whitefilters) && !ao2_container_count(session->blackfilters)) {
 		/* white filters only: implied black all filter processed first, then white filters */
-		ao2_t_callback_data(s->session->whitefilters, OBJ_NODATA, whitefilter_cmp_fn, eventdata, &result, "find filter in session filter container");
-	} else if (!ao2_container_count(s->session->whitefilters) && ao2_container_count(s->session->blackfilters)) {
+		ao2_t_callback_data(session->whitefilters, OBJ_NODATA, whitefilter_cmp_fn, eventdata, &result, "find filter in session filter container");
+	} else if (!ao2_container_count(session->whitefilters) && ao2_container_count(session->blackfilters)) {
 		/* black filters only: implied white all filter processed first, then black filters */
-		ao2_t_callback_data(s->session->blackfilters, OBJ_NODATA, blackfilter_cmp_fn, eventdata, &result, "find filter in session filter container");
+		ao2_t_callback_data(session->blackfilters, OBJ_NODATA, blackfilter_cmp_fn, eventdata, &result, "find filter in session filter container");
 	} else {
 		/* white and black filters: implied black all filter processed first, then white filters, and lastly black filters */
-		ao2_t_callback_data(s->session->whitefilters, OBJ_NODATA, whitefilter_cmp_fn, eventdata, &result, "find filter in session filter container");
+		ao2_t_callback_data(session->whitefilters, OBJ_NODATA, whitefilter_cmp_fn, eventdata, &result, "find filter in session filter container");
 		if (result) {
 			result = 0;
-			ao2_t_callback_data(s->session->blackfilters, OBJ_NODATA, blackfilter_cmp_fn, eventdata, &result, "find filter in session filter container");
+			ao2_t_callback_data(session->blackfilters, OBJ_NODATA, blackfilter_cmp_fn, eventdata, &result, "find filter in session filter container");
 		}
 	}
 
@@ -6833,25 +7803,37 @@ static int match_filter(struct mansession *s, char *eventdata)
 static int process_events(struct mansession *s)
 {
 	int ret = 0;
+	int res;
+
+	ast_mutex_lock(&s->session->out_lock);
+	if (s->session->out_error) {
+		/* The writer thread failed to write to the session */
+		ret = -1;
+	}
+	ast_mutex_unlock(&s->session->out_lock);
 
 	ao2_lock(s->session);
-	if (s->session->stream != NULL) {
-		struct eventqent *eqe = s->session->last_ev;
+	if (!ret && s->session->stream != NULL) {
+		struct eventqent *eqe;
 
-		while ((eqe = advance_event(eqe))) {
+		while ((eqe = session_event_pop(s->session))) {
 			if (eqe->category == EVENT_FLAG_SHUTDOWN) {
 				ast_debug(3, "Received CloseSession event\n");
 				ret = -1;
 			}
+			/* The session's permissions may have changed since the event was queued */
 			if (!ret && s->session->authenticated &&
 			    (s->session->readperm & eqe->category) == eqe->category &&
 			    (s->session->send_events & eqe->category) == eqe->category) {
-					if (match_filter(s, eqe->eventdata)) {
-						if (send_string(s, eqe->eventdata) < 0 || s->write_error)
-							ret = -1;	/* don't send more */
+					if (s->session->format == MANAGER_FORMAT_JSON && eqe->json) {
+						res = send_stream(s, s->session->stream, eqe->json, 1);
+					} else {
+						res = __send_string(s, eqe->eventdata, 1);
 					}
+					if (res < 0 || s->write_error)
+						ret = -1;	/* don't send more */
 			}
-			s->session->last_ev = eqe;
+			ao2_ref(eqe, -1);
 		}
 	}
 	ao2_unlock(s->session);
@@ -6995,14 +7977,29 @@ static int action_reload(struct mansession *s, const struct message *m)
 
 /*! \brief  Manager command "CoreShowChannels" - List currently defined channels
  *          and some information about them. */
+/*! \brief Channels are listed by name */
+static const char *coreshowchannels_page_key(const void *obj)
+{
+	const struct ast_channel_snapshot *snapshot = obj;
+
+	return snapshot->base->name;
+}
+
 static int action_coreshowchannels(struct mansession *s, const struct message *m)
 {
 	const char *actionid = astman_get_header(m, "ActionID");
 	char idText[256];
 	int numchans = 0;
 	struct ao2_container *channels;
-	struct ao2_iterator it_chans;
+	struct ast_cli_page page;
 	struct ast_channel_snapshot *cs;
+	size_t limit;
+	const char *after;
+	size_t i;
+
+	if (astman_get_list_page(s, m, &limit, &after)) {
+		return 0;
+	}
 
 	if (!ast_strlen_zero(actionid)) {
 		snprintf(idText, sizeof(idText), "ActionID: %s\r\n", actionid);
@@ -7011,14 +8008,22 @@ static int action_coreshowchannels(struct mansession *s, const struct message *m
 	}
 
 	channels = ast_channel_cache_by_name();
+	if (ast_cli_page_take(&page, channels, coreshowchannels_page_key, after, limit)) {
+		ao2_ref(channels, -1);
+		astman_send_error(s, m, "Could not list the channels");
+		return 0;
+	}
+	ao2_ref(channels, -1);
 
 	astman_send_listack(s, m, "Channels will follow", "start");
 
-	it_chans = ao2_iterator_init(channels, 0);
-	for (; (cs = ao2_iterator_next(&it_chans)); ao2_ref(cs, -1)) {
-		struct ast_str *built = ast_manager_build_channel_state_string_prefix(cs, "");
+	for (i = 0; i < page.count; i++) {
+		struct ast_str *built;
 		char durbuf[16] = "";
 
+		cs = page.objects[i];
+		built = ast_manager_build_channel_state_string_prefix(cs, "");
+
 		if (!built) {
 			continue;
 		}
@@ -7053,11 +8058,12 @@ static int action_coreshowchannels(struct mansession *s, const struct message *m
 
 		ast_free(built);
 	}
-	ao2_iterator_destroy(&it_chans);
 
-	astman_send_list_complete(s, m, "CoreShowChannelsComplete", numchans);
+	astman_send_list_complete_start(s, m, "CoreShowChannelsComplete", numchans);
+	astman_append(s, "Remaining: %zu\r\n", page.remaining);
+	astman_send_list_complete_end(s);
 
-	ao2_ref(channels, -1);
+	ast_cli_page_release(&page);
 	return 0;
 }
 
@@ -7755,8 +8761,6 @@ static void *session_do(void *data)
 	ast_iostream_nonblock(ser->stream);
 
 	ao2_lock(session);
-	/* Hook to the tail of the event queue */
-	session->last_ev = grab_last();
 
 	ast_mutex_init(&s.lock);
 
@@ -7785,6 +8789,12 @@ static void *session_do(void *data)
 	ast_iostream_set_timeout_sequence(ser->stream,
 		ast_tvnow(), authtimeout * 1000);
 
+	/* The writer thread cannot write TLS, which has state of its own */
+	ast_mutex_lock(&session->out_lock);
+	session->out_async = outputhighwater && manager_writer_thread != AST_PTHREADT_NULL
+		&& !ast_iostream_get_ssl(ser->stream);
+	ast_mutex_unlock(&session->out_lock);
+
 	astman_append(&s, "Asterisk Call Manager/%s\r\n", AMI_VERSION);	/* welcome prompt */
 	for (;;) {
 		if ((res = do_message(&s)) < 0 || s.write_error || session->kicked) {
@@ -7806,6 +8816,7 @@ static void *session_do(void *data)
 		}
 	}
 
+	session_output_finish(session);
 	session_destroy(session);
 
 	ast_mutex_destroy(&s.lock);
@@ -7852,34 +8863,133 @@ static int purge_sessions(int n_max)
 	return purged;
 }
 
-/*! \brief
- * events are appended to a queue from where they
- * can be dispatched to clients.
+static void event_destructor(void *obj)
+{
+	struct eventqent *eqe = obj;
+
+	ast_free(eqe->json);
+}
+
+/*!
+ * \brief Allocate an event to be shared by the queues of the sessions
  */
-static int append_event(const char *str, int category)
+static struct eventqent *alloc_event(const char *str, int category)
 {
-	struct eventqent *tmp = ast_malloc(sizeof(*tmp) + strlen(str));
-	static int seq;	/* sequence number */
+	struct eventqent *eqe;
 
-	if (!tmp) {
-		return -1;
+	eqe = ao2_alloc_options(sizeof(*eqe) + strlen(str), event_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!eqe) {
+		return NULL;
 	}
 
-	/* need to init all fields, because ast_malloc() does not */
-	tmp->usecount = 0;
-	tmp->category = category;
-	tmp->seq = ast_atomic_fetchadd_int(&seq, 1);
-	tmp->tv = ast_tvnow();
-	AST_RWLIST_NEXT(tmp, eq_next) = NULL;
-	strcpy(tmp->eventdata, str);
+	eqe->category = category;
+	strcpy(eqe->eventdata, str);
+
+	return eqe;
+}
+
+/*! \brief What the filters of a session tell of an event name */
+struct filter_precheck_state {
+	const char *event;
+	/*! A filter decided by the name matches */
+	int matched;
+	/*! A filter has to be run over the formatted event */
+	int unknown;
+};
+
+static int filter_precheck_cmp_fn(void *obj, void *arg, int flags)
+{
+	struct event_filter_entry *filter = obj;
+	struct filter_precheck_state *state = arg;
 
-	AST_RWLIST_WRLOCK(&all_events);
-	AST_RWLIST_INSERT_TAIL(&all_events, tmp, eq_next);
-	AST_RWLIST_UNLOCK(&all_events);
+	if (filter->event_name && !strncmp(state->event, filter->event_name, filter->event_name_len)) {
+		state->matched = 1;
+		return CMP_MATCH | CMP_STOP;
+	}
+	if (!filter->event_name || !filter->anchored) {
+		state->unknown = 1;
+	}
 
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Tell whether a session gets an event before formatting it
+ *
+ * \note The session is not locked, as it may be busy writing to its
+ * client.  A change racing the event is caught when the event is sent.
+ */
+static enum event_precheck session_event_precheck(struct mansession_session *session, int category, const char *event)
+{
+	struct filter_precheck_state state = { .event = S_OR(event, ""), };
+	int whitecount;
+
+	if (category == EVENT_FLAG_SHUTDOWN) {
+		return EVENT_PRECHECK_ACCEPT;
+	}
+	if (!session->authenticated || (session->readperm & category) != category) {
+		return EVENT_PRECHECK_REJECT;
+	}
+	/*
+	 * HTTP sessions start with events off and turn them on when they
+	 * first wait for events, which gets them the events raised since
+	 * they logged in.
+	 */
+	if ((session->send_events & category) != category
+		&& !(session->managerid && !session->send_events)) {
+		return EVENT_PRECHECK_REJECT;
+	}
+
+	/* Same order as match_filter(): white filters first, then black ones */
+	whitecount = ao2_container_count(session->whitefilters);
+	if (whitecount) {
+		ao2_callback(session->whitefilters, OBJ_NODATA, filter_precheck_cmp_fn, &state);
+		if (!state.matched) {
+			return state.unknown ? EVENT_PRECHECK_REGEX : EVENT_PRECHECK_REJECT;
+		}
+		state.matched = 0;
+	}
+	if (ao2_container_count(session->blackfilters)) {
+		ao2_callback(session->blackfilters, OBJ_NODATA, filter_precheck_cmp_fn, &state);
+		if (state.matched) {
+			return EVENT_PRECHECK_REJECT;
+		}
+		if (state.unknown) {
+			return EVENT_PRECHECK_REGEX;
+		}
+	}
+
+	return EVENT_PRECHECK_ACCEPT;
+}
+
+/*!
+ * \internal
+ * \brief Whether any session or hook gets an event, so that it is worth formatting
+ */
+static int manager_event_wanted(struct ao2_container *sessions, int category, const char *event)
+{
+	struct ao2_iterator iter;
+	struct mansession_session *session;
+	int wanted = 0;
+
+	if (category != EVENT_FLAG_SHUTDOWN && !AST_RWLIST_EMPTY(&manager_hooks)) {
+		return 1;
+	}
+	if (!sessions) {
+		return 0;
+	}
+
+	iter = ao2_iterator_init(sessions, 0);
+	while (!wanted && (session = ao2_iterator_next(&iter))) {
+		wanted = session_event_precheck(session, category, event) != EVENT_PRECHECK_REJECT;
+		unref_mansession(session);
+	}
+	ao2_iterator_destroy(&iter);
+
+	return wanted;
+}
+
 static void append_channel_vars(struct ast_str **pbuf, struct ast_channel *chan)
 {
 	struct varshead *vars;
@@ -7926,6 +9036,11 @@ static int __attribute__((format(printf, 9, 0))) __manager_event_sessions_va(
 		}
 	}
 
+	/* Only format the event for someone who gets it */
+	if (!manager_event_wanted(sessions, category, event)) {
+		return 0;
+	}
+
 	buf = ast_str_thread_get(&manager_event_buf, MANAGER_EVENT_BUF_INITSIZE);
 	if (!buf) {
 		return -1;
@@ -7968,16 +9083,28 @@ static int __attribute__((format(printf, 9, 0))) __manager_event_sessions_va(
 
 	ast_str_append(&buf, 0, "\r\n");
 
-	append_event(ast_str_buffer(buf), category);
-
-	/* Wake up any sleeping sessions */
-	if (sessions) {
+	/* Queue the event for the sessions that want it and wake them up */
+	if (sessions && ao2_container_count(sessions)) {
 		struct ao2_iterator iter;
 		struct mansession_session *session;
+		struct eventqent *eqe;
 
+		eqe = alloc_event(ast_str_buffer(buf), category);
 		iter = ao2_iterator_init(sessions, 0);
-		while ((session = ao2_iterator_next(&iter))) {
+		while (eqe && (session = ao2_iterator_next(&iter))) {
+			enum event_precheck precheck = session_event_precheck(session, category, event);
+
+			if (precheck == EVENT_PRECHECK_REJECT
+				|| (precheck == EVENT_PRECHECK_REGEX && !match_filter(session, eqe->eventdata))) {
+				unref_mansession(session);
+				continue;
+			}
+			if (session->format == MANAGER_FORMAT_JSON && !eqe->json) {
+				/* Converted once for all the sessions wanting JSON */
+				eqe->json = manager_message_to_json(eqe->eventdata, strlen(eqe->eventdata));
+			}
 			ast_mutex_lock(&session->notify_lock);
+			session_event_push(session, eqe);
 			if (session->waiting_thread != AST_PTHREADT_NULL) {
 				pthread_kill(session->waiting_thread, SIGURG);
 			} else {
@@ -7992,6 +9119,7 @@ static int __attribute__((format(printf, 9, 0))) __manager_event_sessions_va(
 			unref_mansession(session);
 		}
 		ao2_iterator_destroy(&iter);
+		ao2_cleanup(eqe);
 	}
 
 	if (category != EVENT_FLAG_SHUTDOWN && !AST_RWLIST_EMPTY(&manager_hooks)) {
@@ -8199,30 +9327,11 @@ int ast_manager_register2(const char *action, int auth, int (*func)(struct manse
 	cur->module = module;
 #ifdef AST_XML_DOCS
 	if (ast_strlen_zero(synopsis) && ast_strlen_zero(description)) {
-		char *tmpxml;
-
-		tmpxml = ast_xmldoc_build_synopsis("manager", action, NULL);
-		ast_string_field_set(cur, synopsis, tmpxml);
-		ast_free(tmpxml);
-
-		tmpxml = ast_xmldoc_build_syntax("manager", action, NULL);
-		ast_string_field_set(cur, syntax, tmpxml);
-		ast_free(tmpxml);
-
-		tmpxml = ast_xmldoc_build_description("manager", action, NULL);
-		ast_string_field_set(cur, description, tmpxml);
-		ast_free(tmpxml);
-
-		tmpxml = ast_xmldoc_build_seealso("manager", action, NULL);
-		ast_string_field_set(cur, seealso, tmpxml);
-		ast_free(tmpxml);
-
-		tmpxml = ast_xmldoc_build_arguments("manager", action, NULL);
-		ast_string_field_set(cur, arguments, tmpxml);
-		ast_free(tmpxml);
-
-		cur->final_response = ast_xmldoc_build_final_response("manager", action, NULL);
-		cur->list_responses = ast_xmldoc_build_list_responses("manager", action, NULL);
+		if (ast_xmldoc_lazy()) {
+			cur->docs_pending = 1;
+		} else {
+			action_build_xmldoc(cur);
+		}
 
 		cur->docsrc = AST_XML_DOC;
 	} else
@@ -8758,7 +9867,6 @@ static int generic_http_callback(struct ast_tcptls_session_instance *ser,
 		 */
 		while ((session->managerid = ast_random() ^ (unsigned long) session) == 0) {
 		}
-		session->last_ev = grab_last();
 		AST_LIST_HEAD_INIT_NOLOCK(&session->datastores);
 	}
 	ao2_unlock(session);
@@ -9067,7 +10175,6 @@ static int auth_http_callback(struct ast_tcptls_session_instance *ser,
 
 		ast_copy_string(session->username, u_username, sizeof(session->username));
 		session->managerid = nonce;
-		session->last_ev = grab_last();
 		AST_LIST_HEAD_INIT_NOLOCK(&session->datastores);
 
 		session->readperm = u_readperm;
@@ -9453,7 +10560,6 @@ static void purge_old_stuff(void *data)
 	} else {
 		ser->poll_timeout = 5000;
 	}
-	purge_events();
 }
 
 static struct ast_tls_config ami_tls_cfg;
@@ -9503,6 +10609,9 @@ static char *handle_manager_show_settings(struct ast_cli_entry *e, int cmd, stru
 	ast_cli(a->fd, FORMAT, "Web Manager (AMI/HTTP):", AST_CLI_YESNO(webmanager_enabled));
 	ast_cli(a->fd, FORMAT, "TCP Bindaddress:", manager_enabled != 0 ? ast_sockaddr_stringify(&ami_desc.local_address) : "Disabled");
 	ast_cli(a->fd, FORMAT2, "HTTP Timeout (seconds):", httptimeout);
+	ast_cli(a->fd, FORMAT2, "Event queue size:", eventqueuesize);
+	ast_cli(a->fd, FORMAT2, "Output high water (bytes):", outputhighwater);
+	ast_cli(a->fd, FORMAT, "Output overflow:", outputoverflow == OUTPUT_OVERFLOW_DROP ? "drop" : "disconnect");
 	ast_cli(a->fd, FORMAT, "TLS Enable:", AST_CLI_YESNO(ami_tls_cfg.enabled));
 	ast_cli(a->fd, FORMAT, "TLS Bindaddress:", ami_tls_cfg.enabled != 0 ? ast_sockaddr_stringify(&amis_desc.local_address) : "Disabled");
 	ast_cli(a->fd, FORMAT, "TLS Certfile:", ami_tls_cfg.certfile);
@@ -9558,7 +10667,7 @@ static char *handle_manager_show_events(struct ast_cli_entry *e, int cmd, struct
 		return CLI_SUCCESS;
 	}
 
-	events = ao2_global_obj_ref(event_docs);
+	events = manager_event_docs();
 	if (!events) {
 		ast_cli(a->fd, "No manager event documentation loaded\n");
 		ast_free(buffer);
@@ -9663,7 +10772,7 @@ static char *handle_manager_show_event(struct ast_cli_entry *e, int cmd, struct
 		return NULL;
 	}
 
-	events = ao2_global_obj_ref(event_docs);
+	events = manager_event_docs();
 	if (!events) {
 		ast_cli(a->fd, "No manager event documentation loaded\n");
 		return CLI_SUCCESS;
@@ -9810,6 +10919,7 @@ static void manager_shutdown(void)
 	ast_manager_unregister("Atxfer");
 	ast_manager_unregister("CancelAtxfer");
 	ast_manager_unregister("Originate");
+	ast_manager_unregister("BulkOriginate");
 	ast_manager_unregister("Command");
 	ast_manager_unregister("ExtensionState");
 	ast_manager_unregister("PresenceState");
@@ -9858,6 +10968,14 @@ static void manager_shutdown(void)
 	ast_tcptls_server_stop(&ami_desc);
 	ast_tcptls_server_stop(&amis_desc);
 
+	if (manager_writer_thread != AST_PTHREADT_NULL) {
+		manager_writer_stop = 1;
+		manager_writer_wake();
+		pthread_join(manager_writer_thread, NULL);
+		manager_writer_thread = AST_PTHREADT_NULL;
+	}
+	ast_alertpipe_close(manager_writer_alert);
+
 	ast_free(ami_tls_cfg.certfile);
 	ami_tls_cfg.certfile = NULL;
 	ast_free(ami_tls_cfg.pvtfile);
@@ -9955,6 +11073,8 @@ static void manager_set_defaults(void)
 	authtimeout = 30;
 	authlimit = 50;
 	manager_debug = 0;		/* Debug disabled by default */
+	outputhighwater = DEFAULT_OUTPUT_HIGH_WATER;
+	outputoverflow = OUTPUT_OVERFLOW_DISCONNECT;
 
 	/* default values */
 	ast_copy_string(global_realm, S_OR(ast_config_AST_SYSTEM_NAME, DEFAULT_REALM),
@@ -9981,6 +11101,7 @@ static int __init_manager(int reload, int by_external_config)
 	const char *val;
 	char *cat = NULL;
 	int newhttptimeout = 60;
+	int neweventqueuesize = DEFAULT_EVENTQUEUE_SIZE;
 	struct ast_manager_user *user = NULL;
 	struct ast_variable *var;
 	struct ast_flags config_flags = { (reload && !by_external_config) ? CONFIG_FLAG_FILEUNCHANGED : 0 };
@@ -10026,6 +11147,7 @@ static int __init_manager(int reload, int by_external_config)
 		ast_manager_register_xml_core("Atxfer", EVENT_FLAG_CALL, action_atxfer);
 		ast_manager_register_xml_core("CancelAtxfer", EVENT_FLAG_CALL, action_cancel_atxfer);
 		ast_manager_register_xml_core("Originate", EVENT_FLAG_ORIGINATE, action_originate);
+		ast_manager_register_xml_core("BulkOriginate", EVENT_FLAG_ORIGINATE, action_bulkoriginate);
 		ast_manager_register_xml_core("Command", EVENT_FLAG_COMMAND, action_command);
 		ast_manager_register_xml_core("ExtensionState", EVENT_FLAG_CALL | EVENT_FLAG_REPORTING, action_extensionstate);
 		ast_manager_register_xml_core("PresenceState", EVENT_FLAG_CALL | EVENT_FLAG_REPORTING, action_presencestate);
@@ -10056,13 +11178,9 @@ static int __init_manager(int reload, int by_external_config)
 		__ast_custom_function_register(&managerclient_function, NULL);
 		ast_extension_state_add(NULL, NULL, manager_state_cb, NULL);
 
-		/* Append placeholder event so master_eventq never runs dry */
-		if (append_event("Event: Placeholder\r\n\r\n", 0)) {
-			return -1;
-		}
-
 #ifdef AST_XML_DOCS
-		temp_event_docs = ast_xmldoc_build_documentation("managerEvent");
+		/* When loaded lazily, the event documentation is built when first shown */
+		temp_event_docs = ast_xmldoc_lazy() ? NULL : ast_xmldoc_build_documentation("managerEvent");
 		if (temp_event_docs) {
 			ao2_t_global_obj_replace_unref(event_docs, temp_event_docs, "Toss old event docs");
 			ao2_t_ref(temp_event_docs, -1, "Remove creation ref - container holds only ref now");
@@ -10077,6 +11195,14 @@ static int __init_manager(int reload, int by_external_config)
 		ao2_global_obj_replace_unref(mgr_sessions, sessions);
 		ao2_ref(sessions, -1);
 
+		if (ast_alertpipe_init(manager_writer_alert)
+			|| ast_pthread_create_background(&manager_writer_thread, NULL, manager_writer, NULL)) {
+			/* Sessions write their output themselves instead */
+			ast_log(LOG_WARNING, "Unable to start the manager writer thread\n");
+			ast_alertpipe_close(manager_writer_alert);
+			manager_writer_thread = AST_PTHREADT_NULL;
+		}
+
 		/* Initialize all settings before first configuration load. */
 		manager_set_defaults();
 	}
@@ -10155,6 +11281,30 @@ static int __init_manager(int reload, int by_external_config)
 			manager_debug = ast_true(val);
 		} else if (!strcasecmp(var->name, "httptimeout")) {
 			newhttptimeout = atoi(val);
+		} else if (!strcasecmp(var->name, "eventqueuesize")) {
+			int size = atoi(val);
+
+			if (size < 1) {
+				ast_log(LOG_WARNING, "Invalid eventqueuesize value '%s', using default value\n", val);
+			} else {
+				neweventqueuesize = size;
+			}
+		} else if (!strcasecmp(var->name, "outputhighwater")) {
+			int size = atoi(val);
+
+			if (size < 0) {
+				ast_log(LOG_WARNING, "Invalid outputhighwater value '%s', using default value\n", val);
+			} else {
+				outputhighwater = size;
+			}
+		} else if (!strcasecmp(var->name, "outputoverflow")) {
+			if (!strcasecmp(val, "drop")) {
+				outputoverflow = OUTPUT_OVERFLOW_DROP;
+			} else if (!strcasecmp(val, "disconnect")) {
+				outputoverflow = OUTPUT_OVERFLOW_DISCONNECT;
+			} else {
+				ast_log(LOG_WARNING, "Invalid outputoverflow value '%s', using default value\n", val);
+			}
 		} else if (!strcasecmp(var->name, "authtimeout")) {
 			int timeout = atoi(var->value);
 
@@ -10460,6 +11610,7 @@ static int __init_manager(int reload, int by_external_config)
 	if (newhttptimeout > 0) {
 		httptimeout = newhttptimeout;
 	}
+	eventqueuesize = neweventqueuesize;
 
 	ast_tcptls_server_start(&ami_desc);
 	if (tls_was_enabled && !ami_tls_cfg.enabled) {
@@ -676,12 +676,19 @@ static struct ast_manager_event_blob *channel_new_accountcode(
 		"OldAccountCode: %s\r\n", old_snapshot->base->accountcode);
 }
 
-channel_snapshot_monitor channel_monitors[] = {
-	channel_state_change,
-	channel_newexten,
-	channel_new_callerid,
-	channel_new_accountcode,
-	channel_new_connected_line,
+/*! \brief Channel snapshot monitor and the snapshot changes it reacts to */
+struct channel_snapshot_monitor_entry {
+	channel_snapshot_monitor monitor;
+	/*! \ref ast_channel_snapshot_update_change bits the monitor inspects */
+	unsigned int changes;
+};
+
+static const struct channel_snapshot_monitor_entry channel_monitors[] = {
+	{ channel_state_change, AST_CHANNEL_SNAPSHOT_CHANGED_STATE },
+	{ channel_newexten, AST_CHANNEL_SNAPSHOT_CHANGED_DIALPLAN },
+	{ channel_new_callerid, AST_CHANNEL_SNAPSHOT_CHANGED_CALLER },
+	{ channel_new_accountcode, AST_CHANNEL_SNAPSHOT_CHANGED_BASE },
+	{ channel_new_connected_line, AST_CHANNEL_SNAPSHOT_CHANGED_CONNECTED },
 };
 
 static void channel_snapshot_update(void *data, struct stasis_subscription *sub,
@@ -695,7 +702,11 @@ static void channel_snapshot_update(void *data, struct stasis_subscription *sub,
 
 	for (i = 0; i < ARRAY_LEN(channel_monitors); ++i) {
 		RAII_VAR(struct ast_manager_event_blob *, ev, NULL, ao2_cleanup);
-		ev = channel_monitors[i](update->old_snapshot, update->new_snapshot);
+
+		if (!(update->changed & channel_monitors[i].changes)) {
+			continue;
+		}
+		ev = channel_monitors[i].monitor(update->old_snapshot, update->new_snapshot);
 
 		if (!ev) {
 			continue;
@@ -37,6 +37,8 @@
 #include "asterisk/cli.h"
 #include "asterisk/file.h"
 #include "asterisk/media_cache.h"
+#include "asterisk/threadpool.h"
+#include "asterisk/vector.h"
 
 /*! The name of the AstDB family holding items in the cache. */
 #define AST_DB_FAMILY "MediaCache"
@@ -50,6 +52,18 @@
 /*! Our one and only container holding media items */
 static struct ao2_container *media_cache;
 
+/*! The most items retrieved in the background at the same time */
+#define PREFETCH_THREADS 4
+
+/*! URIs being retrieved from their backends, so each is retrieved once at a time */
+static struct ast_vector_string fetching;
+AST_MUTEX_DEFINE_STATIC(fetching_lock);
+/*! Signalled whenever a retrieval finishes */
+static ast_cond_t fetching_cond;
+
+/*! Threads retrieving items in the background */
+static struct ast_threadpool *prefetch_pool;
+
 int ast_media_cache_exists(const char *uri)
 {
 	struct ast_bucket_file *bucket_file;
@@ -154,16 +168,57 @@ static void bucket_file_update_path(struct ast_bucket_file *bucket_file,
 	}
 }
 
+/*!
+ * \internal
+ * \brief Mark a URI as being retrieved, or wait for the retrieval of it in progress
+ *
+ * \retval 0 The caller is to retrieve the URI and call fetching_done()
+ * \retval 1 Another thread retrieved it, look in the cache again
+ */
+static int fetching_begin(const char *uri)
+{
+	char *dup;
+
+	ast_mutex_lock(&fetching_lock);
+	if (AST_VECTOR_GET_CMP(&fetching, uri, !strcmp)) {
+		ast_debug(5, "Waiting for the retrieval of '%s' in progress\n", uri);
+		do {
+			ast_cond_wait(&fetching_cond, &fetching_lock);
+		} while (AST_VECTOR_GET_CMP(&fetching, uri, !strcmp));
+		ast_mutex_unlock(&fetching_lock);
+		return 1;
+	}
+
+	dup = ast_strdup(uri);
+	if (dup && AST_VECTOR_APPEND(&fetching, dup)) {
+		ast_free(dup);
+	}
+	ast_mutex_unlock(&fetching_lock);
+
+	return 0;
+}
+
+static void fetching_done(const char *uri)
+{
+	ast_mutex_lock(&fetching_lock);
+	AST_VECTOR_REMOVE_CMP_UNORDERED(&fetching, uri, !strcmp, ast_free);
+	ast_cond_broadcast(&fetching_cond);
+	ast_mutex_unlock(&fetching_lock);
+}
+
 int ast_media_cache_retrieve(const char *uri, const char *preferred_file_name,
 	char *file_path, size_t len)
 {
 	struct ast_bucket_file *bucket_file;
 	struct ast_bucket_file *tmp_bucket_file;
 	char *ext;
+	int waited = 0;
+
 	if (ast_strlen_zero(uri)) {
 		return -1;
 	}
 
+retry:
 	ao2_lock(media_cache);
 	ast_debug(5, "Looking for media at local cache, file: %s\n", uri);
 
@@ -196,12 +251,22 @@ int ast_media_cache_retrieve(const char *uri, const char *preferred_file_name,
 	 */
 	ao2_unlock(media_cache);
 
+	/* Only one thread retrieves a URI at a time; the rest use what it
+	 * retrieved. Should that fail they each try once themselves. */
+	if (!waited && fetching_begin(uri)) {
+		waited = 1;
+		goto retry;
+	}
+
 	/* Either this is new or the resource is stale; do a full retrieve
 	 * from the appropriate bucket_file backend
 	 */
 	bucket_file = ast_bucket_file_retrieve(uri);
 	if (!bucket_file) {
 		ast_debug(2, "Failed to obtain media at '%s'\n", uri);
+		if (!waited) {
+			fetching_done(uri);
+		}
 		return -1;
 	}
 
@@ -213,10 +278,17 @@ int ast_media_cache_retrieve(const char *uri, const char *preferred_file_name,
 	 */
 	tmp_bucket_file = ao2_find(media_cache, uri, OBJ_SEARCH_KEY | OBJ_NOLOCK);
 	if (tmp_bucket_file) {
+		ast_copy_string(file_path, tmp_bucket_file->path, len);
+		if ((ext = strrchr(file_path, '.'))) {
+			*ext = '\0';
+		}
 		ao2_ref(tmp_bucket_file, -1);
 		ast_bucket_file_delete(bucket_file);
 		ao2_ref(bucket_file, -1);
 		ao2_unlock(media_cache);
+		if (!waited) {
+			fetching_done(uri);
+		}
 		return 0;
 	}
 
@@ -235,6 +307,41 @@ int ast_media_cache_retrieve(const char *uri, const char *preferred_file_name,
 	ast_debug(5, "Returning media at local file: %s\n", file_path);
 	ao2_unlock(media_cache);
 
+	if (!waited) {
+		fetching_done(uri);
+	}
+
+	return 0;
+}
+
+static int prefetch_task(void *data)
+{
+	char *uri = data;
+	char file_path[PATH_MAX];
+
+	ast_media_cache_retrieve(uri, NULL, file_path, sizeof(file_path));
+	ast_free(uri);
+
+	return 0;
+}
+
+int ast_media_cache_prefetch(const char *uri)
+{
+	char *dup;
+
+	if (ast_strlen_zero(uri) || !prefetch_pool) {
+		return -1;
+	}
+
+	dup = ast_strdup(uri);
+	if (!dup) {
+		return -1;
+	}
+	if (ast_threadpool_push(prefetch_pool, prefetch_task, dup)) {
+		ast_free(dup);
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -662,16 +769,43 @@ static struct ast_cli_entry cli_media_cache[] = {
  */
 static void media_cache_shutdown(void)
 {
+	if (prefetch_pool) {
+		ast_threadpool_shutdown(prefetch_pool);
+		prefetch_pool = NULL;
+	}
+
 	ao2_cleanup(media_cache);
 	media_cache = NULL;
 
+	AST_VECTOR_RESET(&fetching, ast_free);
+	AST_VECTOR_FREE(&fetching);
+	ast_cond_destroy(&fetching_cond);
+
 	ast_cli_unregister_multiple(cli_media_cache, ARRAY_LEN(cli_media_cache));
 }
 
 int ast_media_cache_init(void)
 {
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 60,
+		.auto_increment = 1,
+		.initial_size = 0,
+		.max_size = PREFETCH_THREADS,
+	};
+
 	ast_register_cleanup(media_cache_shutdown);
 
+	if (AST_VECTOR_INIT(&fetching, 8)) {
+		return -1;
+	}
+	ast_cond_init(&fetching_cond, NULL);
+
+	prefetch_pool = ast_threadpool_create("media_cache_prefetch", NULL, &options);
+	if (!prefetch_pool) {
+		return -1;
+	}
+
 	media_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, AO2_BUCKETS,
 		ast_sorcery_object_id_hash, NULL, ast_sorcery_object_id_compare);
 	if (!media_cache) {
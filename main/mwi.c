@@ -24,6 +24,8 @@
 
 #include "asterisk/app.h"
 #include "asterisk/mwi.h"
+#include "asterisk/options.h"
+#include "asterisk/sched.h"
 #include "asterisk/stasis_channels.h"
 
 /*!
@@ -36,6 +38,30 @@ static struct stasis_caching_topic *mwi_topic_cached;
 
 /*! @} */
 
+/*!
+ * \brief A mailbox whose MWI states are being coalesced
+ *
+ * Created when a state of the mailbox is published, which happens at once.
+ * Until the window of ast_option_mwi_coalesce milliseconds closes, later
+ * states only replace the one held here, and the last of them is published
+ * when it does.  The window then opens again, and the mailbox is forgotten
+ * once a window closes with nothing held.
+ */
+struct mwi_coalesced {
+	/*! The latest state, published when the window closes */
+	struct stasis_message *msg;
+	/*! The publisher of the latest state, if it came from one */
+	struct stasis_state_publisher *pub;
+	/*! The unique id of the mailbox */
+	char uniqueid[0];
+};
+
+#define MWI_COALESCED_BUCKETS 61
+static struct ao2_container *mwi_coalesced_mailboxes;
+static struct ast_sched_context *mwi_sched;
+AO2_STRING_FIELD_HASH_FN(mwi_coalesced, uniqueid);
+AO2_STRING_FIELD_CMP_FN(mwi_coalesced, uniqueid);
+
 /*! \brief Convert a MWI \ref stasis_message to a \ref ast_event */
 static struct ast_event *mwi_to_event(struct stasis_message *message)
 {
@@ -355,6 +381,114 @@ void ast_mwi_state_callback_subscribed(on_mwi_state handler, void *data)
 	stasis_state_callback_subscribed(mwi_state_manager, handle_mwi_state, &d);
 }
 
+static void mwi_publish_now(struct stasis_state_publisher *pub, const char *uniqueid,
+	struct stasis_message *msg)
+{
+	if (pub) {
+		stasis_state_publish(pub, msg);
+	} else {
+		stasis_state_publish_by_id(mwi_state_manager, uniqueid, NULL, msg);
+	}
+}
+
+static void mwi_coalesced_dtor(void *obj)
+{
+	struct mwi_coalesced *coalesced = obj;
+
+	ao2_cleanup(coalesced->msg);
+	ao2_cleanup(coalesced->pub);
+}
+
+/*!
+ * \internal
+ * \brief Publish the state held for a mailbox when its window closes
+ *
+ * \retval non-zero to open another window
+ */
+static int mwi_coalesce_window_closed(const void *data)
+{
+	struct mwi_coalesced *coalesced = (struct mwi_coalesced *) data;
+	struct stasis_message *msg;
+	struct stasis_state_publisher *pub;
+
+	ao2_lock(mwi_coalesced_mailboxes);
+	msg = coalesced->msg;
+	pub = coalesced->pub;
+	coalesced->msg = NULL;
+	coalesced->pub = NULL;
+	if (!msg) {
+		ao2_unlink_flags(mwi_coalesced_mailboxes, coalesced, OBJ_NOLOCK);
+		ao2_unlock(mwi_coalesced_mailboxes);
+		/* The reference held by the scheduler */
+		ao2_ref(coalesced, -1);
+		return 0;
+	}
+	/* Keeps whatever is published next from overtaking this */
+	ao2_lock(coalesced);
+	ao2_unlock(mwi_coalesced_mailboxes);
+
+	mwi_publish_now(pub, coalesced->uniqueid, msg);
+	ao2_unlock(coalesced);
+
+	ao2_ref(msg, -1);
+	ao2_cleanup(pub);
+
+	return 1;
+}
+
+static int mwi_coalesce_cleanup(const void *data)
+{
+	ao2_ref((void *) data, -1);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Publish a MWI state, or hold it while the window of its mailbox is open
+ */
+static void mwi_publish(struct stasis_state_publisher *pub, const char *uniqueid,
+	struct stasis_message *msg)
+{
+	struct mwi_coalesced *coalesced;
+
+	if (!mwi_sched) {
+		mwi_publish_now(pub, uniqueid, msg);
+		return;
+	}
+
+	ao2_lock(mwi_coalesced_mailboxes);
+	coalesced = ao2_find(mwi_coalesced_mailboxes, uniqueid, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (coalesced) {
+		ao2_replace(coalesced->msg, msg);
+		ao2_replace(coalesced->pub, pub);
+		ao2_unlock(mwi_coalesced_mailboxes);
+		ao2_ref(coalesced, -1);
+		return;
+	}
+
+	coalesced = ao2_alloc(sizeof(*coalesced) + strlen(uniqueid) + 1, mwi_coalesced_dtor);
+	if (!coalesced) {
+		ao2_unlock(mwi_coalesced_mailboxes);
+		mwi_publish_now(pub, uniqueid, msg);
+		return;
+	}
+	strcpy(coalesced->uniqueid, uniqueid); /* Safe */
+
+	if (ast_sched_add(mwi_sched, ast_option_mwi_coalesce, mwi_coalesce_window_closed,
+			ao2_bump(coalesced)) < 0) {
+		ao2_ref(coalesced, -1);
+	} else {
+		ao2_link_flags(mwi_coalesced_mailboxes, coalesced, OBJ_NOLOCK);
+	}
+
+	ao2_lock(coalesced);
+	ao2_unlock(mwi_coalesced_mailboxes);
+	mwi_publish_now(pub, uniqueid, msg);
+	ao2_unlock(coalesced);
+
+	ao2_ref(coalesced, -1);
+}
+
 int ast_mwi_publish(struct ast_mwi_publisher *pub, int urgent_msgs,
 	int new_msgs, int old_msgs, const char *channel_id, struct ast_eid *eid)
 {
@@ -366,7 +500,7 @@ int ast_mwi_publish(struct ast_mwi_publisher *pub, int urgent_msgs,
 		return -1;
 	}
 
-	stasis_state_publish(p, msg);
+	mwi_publish(p, stasis_state_publisher_id(p), msg);
 	ao2_ref(msg, -1);
 
 	return 0;
@@ -384,7 +518,7 @@ int ast_mwi_publish_by_mailbox(const char *mailbox, const char *context, int urg
 	}
 
 	mwi_state = stasis_message_data(msg);
-	stasis_state_publish_by_id(mwi_state_manager, mwi_state->uniqueid, NULL, msg);
+	mwi_publish(NULL, mwi_state->uniqueid, msg);
 	ao2_ref(msg, -1);
 
 	return 0;
@@ -415,6 +549,21 @@ int ast_delete_mwi_state_full(const char *mailbox, const char *context, struct a
 
 	mwi_state = stasis_message_data(msg);
 
+	if (mwi_coalesced_mailboxes) {
+		struct mwi_coalesced *coalesced;
+
+		/* A state held back would bring the mailbox back once deleted */
+		ao2_lock(mwi_coalesced_mailboxes);
+		coalesced = ao2_find(mwi_coalesced_mailboxes, mwi_state->uniqueid,
+			OBJ_SEARCH_KEY | OBJ_NOLOCK);
+		if (coalesced) {
+			ao2_replace(coalesced->msg, NULL);
+			ao2_replace(coalesced->pub, NULL);
+			ao2_ref(coalesced, -1);
+		}
+		ao2_unlock(mwi_coalesced_mailboxes);
+	}
+
 	/*
 	 * XXX As far as stasis is concerned, all MWI events are local.
 	 *
@@ -495,6 +644,13 @@ struct stasis_message *ast_mwi_blob_create(struct ast_mwi_state *mwi_state,
 
 static void mwi_cleanup(void)
 {
+	if (mwi_sched) {
+		ast_sched_clean_by_callback(mwi_sched, mwi_coalesce_window_closed, mwi_coalesce_cleanup);
+		ast_sched_context_destroy(mwi_sched);
+		mwi_sched = NULL;
+	}
+	ao2_cleanup(mwi_coalesced_mailboxes);
+	mwi_coalesced_mailboxes = NULL;
 	ao2_cleanup(mwi_state_cache);
 	mwi_state_cache = NULL;
 	mwi_topic_cached = stasis_caching_unsubscribe_and_join(mwi_topic_cached);
@@ -531,5 +687,17 @@ int mwi_init(void)
 		return -1;
 	}
 
+	if (ast_option_mwi_coalesce) {
+		mwi_coalesced_mailboxes = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+			MWI_COALESCED_BUCKETS, mwi_coalesced_hash_fn, NULL, mwi_coalesced_cmp_fn);
+		if (!mwi_coalesced_mailboxes) {
+			return -1;
+		}
+		mwi_sched = ast_sched_context_create();
+		if (!mwi_sched || ast_sched_start_thread(mwi_sched)) {
+			return -1;
+		}
+	}
+
 	return 0;
 }
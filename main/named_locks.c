@@ -33,6 +33,12 @@
 struct ao2_container *named_locks;
 #define NAMED_LOCKS_BUCKETS 101
 
+/*! \brief How many locks keys are spread over by ast_named_lock_get_striped */
+#define NAMED_LOCK_STRIPES 256
+
+/*! \brief The striped locks, mutexes then read/write locks */
+static struct ast_named_lock *named_lock_stripes[2][NAMED_LOCK_STRIPES];
+
 struct named_lock_proxy {
 	AO2_WEAKPROXY();
 	char key[0];
@@ -51,12 +57,27 @@ static void named_locks_shutdown(void)
 
 int ast_named_locks_init(void)
 {
+	int i;
+
 	named_locks = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
 		NAMED_LOCKS_BUCKETS, named_lock_proxy_hash_fn, NULL, named_lock_proxy_cmp_fn);
 	if (!named_locks) {
 		return -1;
 	}
 
+	for (i = 0; i < NAMED_LOCK_STRIPES; i++) {
+		named_lock_stripes[0][i] = ao2_alloc_options(sizeof(struct ast_named_lock), NULL,
+			AST_NAMED_LOCK_TYPE_MUTEX);
+		named_lock_stripes[1][i] = ao2_alloc_options(sizeof(struct ast_named_lock), NULL,
+			AST_NAMED_LOCK_TYPE_RWLOCK);
+		if (!named_lock_stripes[0][i] || !named_lock_stripes[1][i]) {
+			return -1;
+		}
+		/* They are never freed, so getting and putting them is only a read */
+		ao2_make_immortal(named_lock_stripes[0][i]);
+		ao2_make_immortal(named_lock_stripes[1][i]);
+	}
+
 	ast_register_cleanup(named_locks_shutdown);
 
 	return 0;
@@ -121,3 +142,13 @@ failure_cleanup:
 
 	return NULL;
 }
+
+struct ast_named_lock *ast_named_lock_get_striped(enum ast_named_lock_type lock_type,
+	const char *keyspace, const char *key)
+{
+	unsigned int hash = ast_str_hash_add(key, ast_str_hash_add("-", ast_str_hash(keyspace)));
+
+	ast_assert(lock_type == AST_NAMED_LOCK_TYPE_MUTEX || lock_type == AST_NAMED_LOCK_TYPE_RWLOCK);
+
+	return ao2_bump(named_lock_stripes[lock_type == AST_NAMED_LOCK_TYPE_RWLOCK][hash % NAMED_LOCK_STRIPES]);
+}
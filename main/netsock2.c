@@ -603,6 +603,12 @@ int ast_getsockname(int sockfd, struct ast_sockaddr *addr)
 	return getsockname(sockfd, (struct sockaddr *)&addr->ss, &addr->len);
 }
 
+int ast_getpeername(int sockfd, struct ast_sockaddr *addr)
+{
+	addr->len = sizeof(addr->ss);
+	return getpeername(sockfd, (struct sockaddr *)&addr->ss, &addr->len);
+}
+
 ssize_t ast_recvfrom(int sockfd, void *buf, size_t len, int flags,
 		     struct ast_sockaddr *src_addr)
 {
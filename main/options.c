@@ -81,6 +81,32 @@ int ast_option_maxcalls;
 int ast_option_maxfiles;
 /*! Minimum duration of DTMF. */
 unsigned int option_dtmfminduration = AST_MIN_DTMF_DURATION;
+/*! Maximum number of frames or data buffers of each size each thread caches */
+unsigned int ast_option_frame_cache_size = 10;
+/*! Number of read-only astdb connections, 0 to use one connection and no WAL */
+unsigned int ast_option_astdb_read_connections;
+/*! Comma separated astdb families held in memory */
+char ast_option_astdb_cached_families[256];
+/*! Kilobytes the cached astdb families may use */
+unsigned int ast_option_astdb_cache_size = 4096;
+/*! Kilobytes of prompt files held in memory, 0 to read them from disk every time */
+unsigned int ast_option_prompt_cache_size;
+/*! Encode sound files ahead in the formats channels play them in */
+int ast_option_prompt_compile;
+/*! Read raw sound files through memory maps rather than with read() */
+int ast_option_map_sound_files;
+/*! Milliseconds MWI states of a mailbox are held back to coalesce them */
+unsigned int ast_option_mwi_coalesce;
+/*! Seconds security events from one address are aggregated over */
+unsigned int ast_option_security_event_window;
+/*! Publish every this many aggregated security events, 0 for none */
+unsigned int ast_option_security_event_sample;
+/*! Record how long each part of startup takes */
+int ast_option_startup_profile;
+/*! Record internal latencies in histograms */
+int ast_option_latency_histograms;
+/*! Make periodic timers of the same rate expire together */
+int ast_option_align_timers;
 #if defined(HAVE_SYSINFO)
 /*! Minimum amount of free system memory - stop accepting calls if free memory falls below this watermark */
 long option_minmemfree;
@@ -360,6 +386,12 @@ void load_asterisk_conf(void)
 		/* Cache media frames for performance */
 		} else if (!strcasecmp(v->name, "cache_media_frames")) {
 			ast_set2_flag(&ast_options, ast_true(v->value), AST_OPT_FLAG_CACHE_MEDIA_FRAMES);
+		} else if (!strcasecmp(v->name, "cache_media_frames_size")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32 | PARSE_IN_RANGE | PARSE_DEFAULT,
+					&ast_option_frame_cache_size, 10, 0, 10000)) {
+				ast_log(LOG_WARNING, "Invalid cache_media_frames_size '%s', using %u\n",
+					v->value, ast_option_frame_cache_size);
+			}
 #endif
 		/* Specify cache directory */
 		} else if (!strcasecmp(v->name, "record_cache_dir")) {
@@ -468,6 +500,63 @@ void load_asterisk_conf(void)
 					v->value);
 				ast_clear_flag(&ast_options, AST_OPT_FLAG_STDEXTEN_MACRO);
 			}
+		} else if (!strcasecmp(v->name, "astdb_read_connections")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32 | PARSE_IN_RANGE | PARSE_DEFAULT,
+					&ast_option_astdb_read_connections, 0, 0, 64)) {
+				ast_log(LOG_WARNING, "Invalid astdb_read_connections '%s', using %u\n",
+					v->value, ast_option_astdb_read_connections);
+			}
+		} else if (!strcasecmp(v->name, "astdb_cached_families")) {
+			ast_copy_string(ast_option_astdb_cached_families, v->value,
+				sizeof(ast_option_astdb_cached_families));
+		} else if (!strcasecmp(v->name, "astdb_cache_size")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32 | PARSE_DEFAULT,
+					&ast_option_astdb_cache_size, 4096)) {
+				ast_log(LOG_WARNING, "Invalid astdb_cache_size '%s', using %u\n",
+					v->value, ast_option_astdb_cache_size);
+			}
+		} else if (!strcasecmp(v->name, "prompt_cache_size")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32 | PARSE_DEFAULT,
+					&ast_option_prompt_cache_size, 0)) {
+				ast_log(LOG_WARNING, "Invalid prompt_cache_size '%s', using %u\n",
+					v->value, ast_option_prompt_cache_size);
+			}
+		} else if (!strcasecmp(v->name, "prompt_compile")) {
+			ast_option_prompt_compile = ast_true(v->value);
+		} else if (!strcasecmp(v->name, "map_sound_files")) {
+			ast_option_map_sound_files = ast_true(v->value);
+		} else if (!strcasecmp(v->name, "mwi_coalesce")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32 | PARSE_DEFAULT,
+					&ast_option_mwi_coalesce, 0)) {
+				ast_log(LOG_WARNING, "Invalid mwi_coalesce '%s', using %u\n",
+					v->value, ast_option_mwi_coalesce);
+			}
+		} else if (!strcasecmp(v->name, "security_event_window")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32 | PARSE_DEFAULT,
+					&ast_option_security_event_window, 0)) {
+				ast_log(LOG_WARNING, "Invalid security_event_window '%s', using %u\n",
+					v->value, ast_option_security_event_window);
+			}
+		} else if (!strcasecmp(v->name, "security_event_sample")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32 | PARSE_DEFAULT,
+					&ast_option_security_event_sample, 0)) {
+				ast_log(LOG_WARNING, "Invalid security_event_sample '%s', using %u\n",
+					v->value, ast_option_security_event_sample);
+			}
+		} else if (!strcasecmp(v->name, "startup_profile")) {
+			ast_option_startup_profile = ast_true(v->value);
+		} else if (!strcasecmp(v->name, "latency_histograms")) {
+			ast_option_latency_histograms = ast_true(v->value);
+		} else if (!strcasecmp(v->name, "align_timers")) {
+			ast_option_align_timers = ast_true(v->value);
+		} else if (!strcasecmp(v->name, "lock_contention_threshold")) {
+			if (ast_parse_arg(v->value, PARSE_UINT32 | PARSE_DEFAULT,
+					&ast_lock_contention_threshold, 1000)) {
+				ast_log(LOG_WARNING, "Invalid lock_contention_threshold '%s', using %u\n",
+					v->value, ast_lock_contention_threshold);
+			}
+		} else if (!strcasecmp(v->name, "media_cpus") || !strcasecmp(v->name, "signaling_cpus")) {
+			ast_thread_affinity_set_option(v->name, v->value);
 		} else if (!strcasecmp(v->name, "live_dangerously")) {
 			live_dangerously = ast_true(v->value);
 		} else if (!strcasecmp(v->name, "hide_messaging_ami_events")) {
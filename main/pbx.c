@@ -53,6 +53,7 @@
 #include "asterisk/time.h"
 #include "asterisk/manager.h"
 #include "asterisk/ast_expr.h"
+#include "asterisk/latency.h"
 #include "asterisk/linkedlists.h"
 #define	SAY_STUBS	/* generate declarations and stubs for say methods */
 #include "asterisk/say.h"
@@ -246,6 +247,7 @@ struct ast_exten {
 	const char *app;		/*!< Application to execute */
 	struct ast_app *cached_app;     /*!< Cached location of application */
 	void *data;			/*!< Data to use (arguments) */
+	struct pbx_substitution *cached_data; /*!< Data compiled for variable substitution, if it has any */
 	void (*datad)(void *);		/*!< Data destructor */
 	struct ast_exten *peer;		/*!< Next higher priority with our extension */
 	struct ast_hashtab *peer_table;    /*!< Priorities list in hashtab form -- only on the head of the peer list */
@@ -295,6 +297,10 @@ struct ast_context {
 	struct ast_sws alts;              /*!< Alternative switches */
 	int refcount;                     /*!< each module that would have created this context should inc/dec this as appropriate */
 	int autohints;                    /*!< Whether autohints support is enabled or not */
+	int changes;                      /*!< Incremented whenever the context is changed */
+	int merge_changes;                /*!< What changes was when merge_scan() scanned the context */
+	unsigned int merge_scanned:1;     /*!< Set once merge_scan() scanned the context */
+	unsigned int merge_leftovers:1;   /*!< Set if merge_scan() found something context_merge() has to carry over */
 
 	/*!
 	 * Buffer to hold the name & registrar character data.
@@ -328,6 +334,14 @@ struct ast_state_cb {
  *
  * See \ref AstExtState
  */
+/*! \brief Last known state of one device of a hint */
+struct hint_device_state {
+	enum ast_device_state state;
+	char device[0];
+};
+
+AST_VECTOR(hint_device_states, struct hint_device_state *);
+
 struct ast_hint {
 	/*!
 	 * \brief Hint extension
@@ -340,6 +354,14 @@ struct ast_hint {
 
 	/*! Dev state variables */
 	int laststate;			/*!< Last known device state */
+	/*!
+	 * \brief Last known state of each device of the hint, in hint order
+	 *
+	 * \note Kept up to date from device state messages so the hint
+	 * state can be aggregated without asking for every device again.
+	 */
+	struct hint_device_states device_states;
+	int device_states_cached;	/*!< device_states are known, they are not for dynamic hints */
 
 	/*! Presence state variables */
 	int last_presence_state;     /*!< Last known presence state */
@@ -769,6 +791,70 @@ static int autofallthrough = 1;
 static int extenpatternmatchnew = 0;
 static char *overrideswitch = NULL;
 
+/*! Number of buckets of the extension lookup cache */
+#define FIND_CACHE_BUCKETS 1021
+/*! The extension lookup cache is emptied when it holds more lookups than this */
+#define FIND_CACHE_MAX 8192
+
+/*!
+ * \brief The result of an extension lookup through a context and its includes
+ *
+ * Only valid while dialplan_version is what it was when the lookup started.
+ */
+struct find_cache_entry {
+	/*! dialplan_version the lookup was made at */
+	int version;
+	/*! Status the lookup set */
+	int status;
+	/*! The extension found, NULL if none was */
+	struct ast_exten *exten;
+	/*! The context it was found in, NULL if the one searched */
+	const char *foundcontext;
+	/*! Set if foundcontext was the context searched */
+	unsigned int found_in_context:1;
+	/*! Action, priority, context, extension, caller id and label */
+	char key[0];
+};
+
+/*! Lookups made from the top of a context, with the includes walked */
+static struct ao2_container *find_cache;
+
+/*! How long dialplan lookups take */
+static struct ast_latency_histogram *find_extension_latency;
+/*! Changed whenever the dialplan is, to invalidate every cached lookup */
+static int dialplan_version;
+
+AO2_STRING_FIELD_HASH_FN(find_cache_entry, key);
+AO2_STRING_FIELD_CMP_FN(find_cache_entry, key);
+
+/*! \brief Invalidate cached extension lookups after a dialplan change */
+static void dialplan_changed(void)
+{
+	ast_atomic_fetchadd_int(&dialplan_version, 1);
+}
+
+/*!
+ * \brief Note a change to a context, made with the context write locked
+ */
+static void context_changed(struct ast_context *con)
+{
+	ast_atomic_fetchadd_int(&con->changes, 1);
+	dialplan_changed();
+}
+
+/*!
+ * \brief Unlock a context that was changed
+ *
+ * Lookups do not lock the contexts they search, so one running during the
+ * change could have cached what it saw half way.  The version is changed
+ * again once the change is complete to invalidate it.
+ */
+static void unlock_changed_context(struct ast_context *con)
+{
+	dialplan_changed();
+	ast_unlock_context(con);
+}
+
 /*! \brief Subscription for device state change events */
 static struct stasis_subscription *device_state_sub;
 /*! \brief Subscription for presence state change events */
@@ -794,6 +880,15 @@ AST_MUTEX_DEFINE_STATIC(conlock);
  */
 AST_MUTEX_DEFINE_STATIC(context_merge_lock);
 
+/*!
+ * \brief Set while ast_merge_contexts_and_delete() scans the old dialplan without conlock
+ *
+ * Contexts destroyed meanwhile are kept on merge_deferred until the merge is
+ * done, as the scan may still look at them.  Both are protected by conlock.
+ */
+static int merge_scanning;
+static struct ast_context *merge_deferred;
+
 static int stateid = 1;
 /*!
  * \note When holding this container's lock, do _not_ do
@@ -2479,10 +2574,17 @@ static int matchcid(const char *cidpattern, const char *callerid)
 	return ast_extension_match(cidpattern, callerid);
 }
 
-struct ast_exten *pbx_find_extension(struct ast_channel *chan,
+/*!
+ * \internal
+ * \brief Find an extension in a context and its includes
+ *
+ * \param cacheable Cleared if the result depends on more than the dialplan,
+ *        like switches, the channel or the time
+ */
+static struct ast_exten *find_extension(struct ast_channel *chan,
 	struct ast_context *bypass, struct pbx_find_info *q,
 	const char *context, const char *exten, int priority,
-	const char *label, const char *callerid, enum ext_match_t action)
+	const char *label, const char *callerid, enum ext_match_t action, int *cacheable)
 {
 	int x, res;
 	struct ast_context *tmp = NULL;
@@ -2553,6 +2655,8 @@ struct ast_exten *pbx_find_extension(struct ast_channel *chan,
 			char *datap;
 			int eval = 0;
 
+			*cacheable = 0;
+
 			name = strsep(&osw, "/");
 			asw = pbx_findswitch(name);
 
@@ -2710,6 +2814,9 @@ struct ast_exten *pbx_find_extension(struct ast_channel *chan,
 	}
 
 	/* Check alternative switches */
+	if (ast_context_switches_count(tmp)) {
+		*cacheable = 0;
+	}
 	for (idx = 0; idx < ast_context_switches_count(tmp); idx++) {
 		const struct ast_sw *sw = ast_context_switches_get(tmp, idx);
 		struct ast_switch *asw = pbx_findswitch(ast_get_switch_name(sw));
@@ -2766,8 +2873,11 @@ struct ast_exten *pbx_find_extension(struct ast_channel *chan,
 	for (idx = 0; idx < ast_context_includes_count(tmp); idx++) {
 		const struct ast_include *i = ast_context_includes_get(tmp, idx);
 
+		if (include_has_timing(i)) {
+			*cacheable = 0;
+		}
 		if (include_valid(i)) {
-			if ((e = pbx_find_extension(chan, bypass, q, include_rname(i), exten, priority, label, callerid, action))) {
+			if ((e = find_extension(chan, bypass, q, include_rname(i), exten, priority, label, callerid, action, cacheable))) {
 #ifdef NEED_DEBUG_HERE
 				ast_log(LOG_NOTICE,"Returning recursive match of %s\n", e->exten);
 #endif
@@ -2780,6 +2890,85 @@ struct ast_exten *pbx_find_extension(struct ast_channel *chan,
 	return NULL;
 }
 
+static struct ast_exten *find_extension_cached(struct ast_channel *chan,
+	struct ast_context *bypass, struct pbx_find_info *q,
+	const char *context, const char *exten, int priority,
+	const char *label, const char *callerid, enum ext_match_t action)
+{
+	char key[AST_MAX_CONTEXT + AST_MAX_EXTENSION * 3 + 32];
+	struct find_cache_entry *entry;
+	struct ast_exten *e;
+	int cacheable = 1;
+	int version;
+	size_t key_len;
+
+	/* Only whole lookups are cached, not those of an include or of a single context */
+	if (bypass || q->stacklen || !find_cache) {
+		return find_extension(chan, bypass, q, context, exten, priority, label, callerid, action, &cacheable);
+	}
+
+	key_len = snprintf(key, sizeof(key), "%d/%d/%s/%s/%s/%s", (int) action, priority,
+		context, exten, S_OR(callerid, ""), S_OR(label, ""));
+	if (key_len >= sizeof(key)) {
+		return find_extension(chan, bypass, q, context, exten, priority, label, callerid, action, &cacheable);
+	}
+
+	version = ast_atomic_fetchadd_int(&dialplan_version, 0);
+	entry = ao2_find(find_cache, key, OBJ_SEARCH_KEY);
+	if (entry && entry->version == version) {
+		q->status = entry->status;
+		q->swo = NULL;
+		q->data = NULL;
+		q->foundcontext = entry->found_in_context ? context : entry->foundcontext;
+		e = entry->exten;
+		ao2_ref(entry, -1);
+		return e;
+	}
+	ao2_cleanup(entry);
+
+	e = find_extension(chan, bypass, q, context, exten, priority, label, callerid, action, &cacheable);
+	if (!cacheable || q->swo) {
+		return e;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + key_len + 1, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return e;
+	}
+	/* A change made during the lookup left it with the old version, so it is never used */
+	entry->version = version;
+	entry->status = q->status;
+	entry->exten = e;
+	if (q->foundcontext == context) {
+		entry->found_in_context = 1;
+	} else {
+		entry->foundcontext = q->foundcontext;
+	}
+	strcpy(entry->key, key); /* Safe */
+
+	if (ao2_container_count(find_cache) >= FIND_CACHE_MAX) {
+		ao2_callback(find_cache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	}
+	ao2_link(find_cache, entry);
+	ao2_ref(entry, -1);
+
+	return e;
+}
+
+struct ast_exten *pbx_find_extension(struct ast_channel *chan,
+	struct ast_context *bypass, struct pbx_find_info *q,
+	const char *context, const char *exten, int priority,
+	const char *label, const char *callerid, enum ext_match_t action)
+{
+	uint64_t start = ast_latency_start();
+	struct ast_exten *e;
+
+	e = find_extension_cached(chan, bypass, q, context, exten, priority, label, callerid, action);
+	ast_latency_end(find_extension_latency, start);
+
+	return e;
+}
+
 static void exception_store_free(void *data)
 {
 	struct pbx_exception *exception = data;
@@ -2879,6 +3068,7 @@ static int pbx_extension_helper(struct ast_channel *c, struct ast_context *con,
 	struct ast_exten *e;
 	struct ast_app *app;
 	char *substitute = NULL;
+	struct pbx_substitution *substitution = NULL;
 	struct pbx_find_info q = { .stacklen = 0 }; /* the rest is reset in pbx_find_extension */
 	char passdata[EXT_DATA_SIZE];
 	int matching_action = (action == E_MATCH || action == E_CANMATCH || action == E_MATCHMORE);
@@ -2918,13 +3108,22 @@ static int pbx_extension_helper(struct ast_channel *c, struct ast_context *con,
 					/* no variables to substitute, copy on through */
 					ast_copy_string(passdata, e->data, sizeof(passdata));
 				} else {
-					/* save e->data on stack for later processing after lock released */
-					substitute = ast_strdupa(e->data);
+					/* Compiled once, and referenced for processing after lock released */
+					if (!e->cached_data) {
+						e->cached_data = pbx_substitution_compile(e->data);
+					}
+					if (e->cached_data) {
+						substitution = ao2_bump(e->cached_data);
+					} else {
+						/* save e->data on stack for later processing after lock released */
+						substitute = ast_strdupa(e->data);
+					}
 				}
 			}
 			ast_unlock_contexts();
 			if (!app) {
 				ast_log(LOG_WARNING, "No application '%s' for extension (%s, %s, %d)\n", e->app, context, exten, priority);
+				ao2_cleanup(substitution);
 				return -1;
 			}
 			if (ast_channel_context(c) != context)
@@ -2932,7 +3131,10 @@ static int pbx_extension_helper(struct ast_channel *c, struct ast_context *con,
 			if (ast_channel_exten(c) != exten)
 				ast_channel_exten_set(c, exten);
 			ast_channel_priority_set(c, priority);
-			if (substitute) {
+			if (substitution) {
+				pbx_substitution_apply(c, substitution, passdata, sizeof(passdata)-1);
+				ao2_ref(substitution, -1);
+			} else if (substitute) {
 				pbx_substitute_variables_helper(c, substitute, passdata, sizeof(passdata)-1);
 			}
 			ast_debug(1, "Launching '%s'\n", app_name(app));
@@ -3078,43 +3280,119 @@ static struct ao2_container *alloc_device_state_info(void)
 	return ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, NULL, NULL);
 }
 
-static int ast_extension_state3(struct ast_str *hint_app, struct ao2_container *device_state_info)
+static void device_state_info_add(struct ao2_container *device_state_info,
+	const char *device, enum ast_device_state state)
+{
+	struct ast_device_state_info *obj;
+
+	obj = ao2_alloc_options(sizeof(*obj) + strlen(device), device_state_info_dt, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	/* if failed we cannot add this device */
+	if (obj) {
+		obj->device_state = state;
+		strcpy(obj->device_name, device);
+		ao2_link(device_state_info, obj);
+		ao2_ref(obj, -1);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Get the state of every device of a hint
+ *
+ * \note No locks may be held as the device state providers may be asked.
+ */
+static void hint_device_states_load(struct ast_str *hint_app, struct hint_device_states *states)
 {
 	char *cur;
 	char *rest;
-	struct ast_devstate_aggregate agg;
 
 	/* One or more devices separated with a & character */
 	rest = parse_hint_device(hint_app);
 
-	ast_devstate_aggregate_init(&agg);
 	while ((cur = strsep(&rest, "&"))) {
-		enum ast_device_state state = ast_device_state(cur);
+		struct hint_device_state *device;
 
-		ast_devstate_aggregate_add(&agg, state);
+		device = ast_malloc(sizeof(*device) + strlen(cur) + 1);
+		if (!device) {
+			continue;
+		}
+		device->state = ast_device_state(cur);
+		strcpy(device->device, cur); /* Safe */
+		if (AST_VECTOR_APPEND(states, device)) {
+			ast_free(device);
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Aggregate the known device states of a hint into the extension state
+ *
+ * \pre The hint the states belong to is locked.
+ */
+static int hint_device_states_aggregate(struct hint_device_states *states,
+	struct ao2_container *device_state_info)
+{
+	struct ast_devstate_aggregate agg;
+	int i;
+
+	ast_devstate_aggregate_init(&agg);
+	for (i = 0; i < AST_VECTOR_SIZE(states); i++) {
+		struct hint_device_state *device = AST_VECTOR_GET(states, i);
+
+		ast_devstate_aggregate_add(&agg, device->state);
 		if (device_state_info) {
-			struct ast_device_state_info *obj;
-
-			obj = ao2_alloc_options(sizeof(*obj) + strlen(cur), device_state_info_dt, AO2_ALLOC_OPT_LOCK_NOLOCK);
-			/* if failed we cannot add this device */
-			if (obj) {
-				obj->device_state = state;
-				strcpy(obj->device_name, cur);
-				ao2_link(device_state_info, obj);
-				ao2_ref(obj, -1);
-			}
+			device_state_info_add(device_state_info, device->device, device->state);
 		}
 	}
 
 	return ast_devstate_to_extenstate(ast_devstate_aggregate_result(&agg));
 }
 
+static int ast_extension_state3(struct ast_str *hint_app, struct ao2_container *device_state_info)
+{
+	struct hint_device_states states;
+	int state;
+
+	AST_VECTOR_INIT(&states, 0);
+	hint_device_states_load(hint_app, &states);
+	state = hint_device_states_aggregate(&states, device_state_info);
+	AST_VECTOR_RESET(&states, ast_free);
+	AST_VECTOR_FREE(&states);
+
+	return state;
+}
+
 /*! \brief Check state of extension by using hints */
 static int ast_extension_state2(struct ast_exten *e, struct ao2_container *device_state_info)
 {
-	struct ast_str *hint_app = ast_str_thread_get(&extensionstate_buf, 32);
+	struct ast_str *hint_app;
+	struct ast_hint *hint;
 
-	if (!e || !hint_app) {
+	if (!e) {
+		return -1;
+	}
+
+	/* Use the device states the hint has kept up to date if there is one */
+	hint = ao2_find(hints, e, 0);
+	if (hint) {
+		int state = -1;
+		int cached;
+
+		ao2_lock(hint);
+		cached = hint->device_states_cached;
+		if (cached) {
+			state = hint_device_states_aggregate(&hint->device_states, device_state_info);
+		}
+		ao2_unlock(hint);
+		ao2_ref(hint, -1);
+		if (cached) {
+			return state;
+		}
+	}
+
+	hint_app = ast_str_thread_get(&extensionstate_buf, 32);
+	if (!hint_app) {
 		return -1;
 	}
 
@@ -3367,7 +3645,17 @@ static void get_device_state_causing_channels(struct ao2_container *c)
 	ao2_iterator_destroy(&iter);
 }
 
-static void device_state_notify_callbacks(struct ast_hint *hint, struct ast_str **hint_app)
+/*!
+ * \internal
+ * \brief Update the state of a hint and notify its watchers if it changed
+ *
+ * \param hint The hint to update
+ * \param hint_app Buffer to use for the hint string
+ * \param dev_state The device that changed, or NULL to get the state of
+ * every device of the hint again
+ */
+static void device_state_notify_callbacks(struct ast_hint *hint, struct ast_str **hint_app,
+	struct ast_device_state_message *dev_state)
 {
 	struct ao2_iterator cb_iter;
 	struct ast_state_cb *state_cb;
@@ -3377,6 +3665,8 @@ static void device_state_notify_callbacks(struct ast_hint *hint, struct ast_str
 	int first_extended_cb_call = 1;
 	char context_name[AST_MAX_CONTEXT];
 	char exten_name[AST_MAX_EXTENSION];
+	struct hint_device_states states;
+	int i;
 
 	ao2_lock(hint);
 	if (!hint->exten) {
@@ -3384,6 +3674,9 @@ static void device_state_notify_callbacks(struct ast_hint *hint, struct ast_str
 		ao2_unlock(hint);
 		return;
 	}
+	if (!hint->device_states_cached) {
+		dev_state = NULL;
+	}
 
 	/*
 	 * Save off strings in case the hint extension gets destroyed
@@ -3404,22 +3697,43 @@ static void device_state_notify_callbacks(struct ast_hint *hint, struct ast_str
 	 * device state or notifying the watchers without causing a
 	 * deadlock.  (conlock, hints, and hint)
 	 */
+	AST_VECTOR_INIT(&states, 0);
+	if (!dev_state) {
+		hint_device_states_load(*hint_app, &states);
+	}
 
-	/* Make a container so state3 can fill it if we wish.
+	/* Make a container so the aggregation can fill it if we wish.
 	 * If that failed we simply do not provide the extended state info.
 	 */
 	device_state_info = alloc_device_state_info();
 
-	state = ast_extension_state3(*hint_app, device_state_info);
+	ao2_lock(hint);
+	if (dev_state) {
+		/* Only the device that changed needs updating */
+		for (i = 0; i < AST_VECTOR_SIZE(&hint->device_states); i++) {
+			struct hint_device_state *device = AST_VECTOR_GET(&hint->device_states, i);
+
+			if (!strcasecmp(device->device, dev_state->device)) {
+				device->state = dev_state->state;
+			}
+		}
+	} else {
+		AST_VECTOR_RESET(&hint->device_states, ast_free);
+		AST_VECTOR_FREE(&hint->device_states);
+		hint->device_states = states;
+		hint->device_states_cached = 1;
+	}
+	state = hint_device_states_aggregate(&hint->device_states, device_state_info);
 	same_state = state == hint->laststate;
+	/* Device state changed since last check - record we saw the change */
+	hint->laststate = state;
+	ao2_unlock(hint);
+
 	if (same_state && (~state & AST_EXTENSION_RINGING)) {
 		ao2_cleanup(device_state_info);
 		return;
 	}
 
-	/* Device state changed since last check - notify the watchers. */
-	hint->laststate = state;	/* record we saw the change */
-
 	/* For general callbacks */
 	if (!same_state) {
 		cb_iter = ao2_iterator_init(statecbs, 0);
@@ -3551,7 +3865,7 @@ static int handle_hint_change_message_type(struct stasis_message *msg, enum ast_
 
 	switch (reason) {
 	case AST_HINT_UPDATE_DEVICE:
-		device_state_notify_callbacks(hint, &hint_app);
+		device_state_notify_callbacks(hint, &hint_app, NULL);
 		break;
 	case AST_HINT_UPDATE_PRESENCE:
 		{
@@ -3656,7 +3970,7 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 	if (dev_iter) {
 		for (; (device = ao2_iterator_next(dev_iter)); ao2_t_ref(device, -1, "Next device")) {
 			if (device->hint) {
-				device_state_notify_callbacks(device->hint, &hint_app);
+				device_state_notify_callbacks(device->hint, &hint_app, dev_state);
 			}
 		}
 		ao2_iterator_destroy(dev_iter);
@@ -3912,6 +4226,8 @@ static void destroy_hint(void *obj)
 		ast_free(device);
 	}
 	AST_VECTOR_FREE(&hint->devices);
+	AST_VECTOR_RESET(&hint->device_states, ast_free);
+	AST_VECTOR_FREE(&hint->device_states);
 	ast_free(hint->last_presence_subtype);
 	ast_free(hint->last_presence_message);
 }
@@ -3997,6 +4313,7 @@ static int ast_add_hint(struct ast_exten *e)
 		return -1;
 	}
 	AST_VECTOR_INIT(&hint_new->devices, 8);
+	AST_VECTOR_INIT(&hint_new->device_states, 0);
 
 	/* Initialize new hint. */
 	hint_new->callbacks = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX, 0, NULL, hint_id_cmp);
@@ -4010,7 +4327,16 @@ static int ast_add_hint(struct ast_exten *e)
 		hint_new->laststate = AST_DEVICE_INVALID;
 		hint_new->last_presence_state = AST_PRESENCE_INVALID;
 	} else {
-		hint_new->laststate = ast_extension_state2(e, NULL);
+		struct ast_str *hint_app = ast_str_thread_get(&extensionstate_buf, 32);
+
+		if (!hint_app) {
+			ao2_ref(hint_new, -1);
+			return -1;
+		}
+		ast_str_set(&hint_app, 0, "%s", ast_get_extension_app(e));
+		hint_device_states_load(hint_app, &hint_new->device_states);
+		hint_new->device_states_cached = 1;
+		hint_new->laststate = hint_device_states_aggregate(&hint_new->device_states, NULL);
 		if ((presence_state = extension_presence_state_helper(e, &subtype, &message)) > 0) {
 			hint_new->last_presence_state = presence_state;
 			hint_new->last_presence_subtype = subtype;
@@ -4115,7 +4441,8 @@ static int ast_change_hint(struct ast_exten *oe, struct ast_exten *ne)
 	/* Update the hint and put it back in the hints container. */
 	ao2_lock(hint);
 	hint->exten = ne;
-
+	/* The devices may have changed, they are looked up again when the change is published */
+	hint->device_states_cached = 0;
 	ao2_unlock(hint);
 
 	ao2_link(hints, hint);
@@ -4682,6 +5009,7 @@ static void destroy_exten(struct ast_exten *e)
 		ast_hashtab_destroy(e->peer_label_table, 0);
 	if (e->datad)
 		e->datad(e->data);
+	ao2_cleanup(e->cached_data);
 	ast_free(e);
 }
 
@@ -4778,6 +5106,7 @@ int pbx_set_extenpatternmatchnew(int newval)
 {
 	int oldval = extenpatternmatchnew;
 	extenpatternmatchnew = newval;
+	dialplan_changed();
 	return oldval;
 }
 
@@ -4791,6 +5120,7 @@ void pbx_set_overrideswitch(const char *newval)
 	} else {
 		overrideswitch = NULL;
 	}
+	dialplan_changed();
 }
 
 /*!
@@ -4862,6 +5192,7 @@ int ast_context_remove_include2(struct ast_context *con, const char *include, co
 	int idx;
 
 	ast_wrlock_context(con);
+	context_changed(con);
 
 	/* find our include */
 	for (idx = 0; idx < ast_context_includes_count(con); idx++) {
@@ -4881,7 +5212,7 @@ int ast_context_remove_include2(struct ast_context *con, const char *include, co
 		}
 	}
 
-	ast_unlock_context(con);
+	unlock_changed_context(con);
 
 	return ret;
 }
@@ -4919,6 +5250,7 @@ int ast_context_remove_switch2(struct ast_context *con, const char *sw, const ch
 	int ret = -1;
 
 	ast_wrlock_context(con);
+	context_changed(con);
 
 	/* walk switches */
 	for (idx = 0; idx < ast_context_switches_count(con); idx++) {
@@ -4939,7 +5271,7 @@ int ast_context_remove_switch2(struct ast_context *con, const char *sw, const ch
 		}
 	}
 
-	ast_unlock_context(con);
+	unlock_changed_context(con);
 
 	return ret;
 }
@@ -4993,6 +5325,7 @@ int ast_context_remove_extension_callerid2(struct ast_context *con, const char *
 
 	if (!already_locked)
 		ast_wrlock_context(con);
+	context_changed(con);
 
 #ifdef NEED_DEBUG
 	ast_verb(3,"Removing %s/%s/%d%s%s from trees, registrar=%s\n", con->name, extension, priority, matchcallerid ? "/" : "", matchcallerid ? callerid : "", registrar);
@@ -5095,7 +5428,7 @@ int ast_context_remove_extension_callerid2(struct ast_context *con, const char *
 	if (!exten) {
 		/* we can't find right extension */
 		if (!already_locked)
-			ast_unlock_context(con);
+			unlock_changed_context(con);
 		return -1;
 	}
 
@@ -5144,7 +5477,7 @@ int ast_context_remove_extension_callerid2(struct ast_context *con, const char *
 		}
 	}
 	if (!already_locked)
-		ast_unlock_context(con);
+		unlock_changed_context(con);
 	return found ? 0 : -1;
 }
 
@@ -6215,6 +6548,7 @@ struct ast_context *ast_context_find_or_create(struct ast_context **extcontexts,
 		tmp->next = *local_contexts;
 		*local_contexts = tmp;
 		ast_hashtab_insert_safe(contexts_table, tmp); /*put this context into the tree */
+		dialplan_changed();
 		ast_unlock_contexts();
 	} else {
 		tmp->next = *local_contexts;
@@ -6422,12 +6756,75 @@ static void context_merge(struct ast_context **extcontexts, struct ast_hashtab *
 }
 
 
+/*!
+ * \internal
+ * \brief Find out whether context_merge() has anything to carry over from an old context
+ *
+ * Runs without conlock, so lookups carry on while a large dialplan is scanned.
+ * The context is read locked while it is scanned and its change count is
+ * remembered, so merge_needed() can tell if it changed afterwards.
+ */
+static void merge_scan(struct ast_context *context, const char *registrar)
+{
+	struct ast_hashtab_iter *exten_iter;
+	struct ast_hashtab_iter *prio_iter;
+	struct ast_exten *exten_item, *prio_item;
+	int leftovers;
+	int idx;
+
+	ast_rdlock_context(context);
+	context->merge_changes = ast_atomic_fetchadd_int(&context->changes, 0);
+
+	leftovers = strcmp(context->registrar, registrar);
+	for (idx = 0; !leftovers && idx < ast_context_includes_count(context); idx++) {
+		leftovers = strcmp(ast_get_include_registrar(ast_context_includes_get(context, idx)), registrar);
+	}
+	for (idx = 0; !leftovers && idx < ast_context_switches_count(context); idx++) {
+		leftovers = strcmp(ast_get_switch_registrar(ast_context_switches_get(context, idx)), registrar);
+	}
+	for (idx = 0; !leftovers && idx < ast_context_ignorepats_count(context); idx++) {
+		leftovers = strcmp(ast_get_ignorepat_registrar(ast_context_ignorepats_get(context, idx)), registrar);
+	}
+	if (!leftovers && context->root_table) {
+		exten_iter = ast_hashtab_start_traversal(context->root_table);
+		while (!leftovers && (exten_item = ast_hashtab_next(exten_iter))) {
+			if (!exten_item->peer_table) {
+				continue;
+			}
+			prio_iter = ast_hashtab_start_traversal(exten_item->peer_table);
+			while (!leftovers && (prio_item = ast_hashtab_next(prio_iter))) {
+				leftovers = strcmp(prio_item->registrar, registrar);
+			}
+			ast_hashtab_end_traversal(prio_iter);
+		}
+		ast_hashtab_end_traversal(exten_iter);
+	}
+
+	context->merge_leftovers = leftovers ? 1 : 0;
+	context->merge_scanned = 1;
+	ast_unlock_context(context);
+}
+
+/*!
+ * \internal
+ * \brief Whether context_merge() must be run on an old context
+ *
+ * \note conlock must be held.  Contexts created or changed since merge_scan()
+ * looked at them are merged the full way.
+ */
+static int merge_needed(struct ast_context *context)
+{
+	return !context->merge_scanned || context->merge_leftovers || context->refcount > 1
+		|| context->merge_changes != ast_atomic_fetchadd_int(&context->changes, 0);
+}
+
 /* XXX this does not check that multiple contexts are merged */
 void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_hashtab *exttable, const char *registrar)
 {
 	double ft;
 	struct ast_context *tmp;
 	struct ast_context *oldcontextslist;
+	struct ast_context *deferred;
 	struct ast_hashtab *oldtable;
 	struct store_hints hints_stored = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
 	struct store_hints hints_removed = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
@@ -6439,8 +6836,13 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 	struct ast_hashtab_iter *iter;
 	struct ao2_iterator i;
 	int ctx_count = 0;
+	AST_VECTOR(, struct ast_context *) scan;
+	int idx;
 	struct timeval begintime;
+	struct timeval scantime;
+	struct timeval locktime;
 	struct timeval writelocktime;
+	struct timeval unlocktime;
 	struct timeval endlocktime;
 	struct timeval enddeltime;
 
@@ -6454,6 +6856,10 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 	 *
 	 * In addition, the locks _must_ be taken in this order, because
 	 * there are already other code paths that use this order
+	 *
+	 * Most old contexts usually have nothing to carry over, so
+	 * finding out which do is done first without conlock, to keep
+	 * the time lookups are held up short.
 	 */
 
 	begintime = ast_tvnow();
@@ -6467,15 +6873,40 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 		/* Well, that's odd. There are no contexts. */
 		contexts_table = exttable;
 		contexts = *extcontexts;
+		dialplan_changed();
 		ast_unlock_contexts();
 		ast_mutex_unlock(&context_merge_lock);
 		return;
 	}
 
+	AST_VECTOR_INIT(&scan, ast_hashtab_size(contexts_table));
+	iter = ast_hashtab_start_traversal(contexts_table);
+	while ((tmp = ast_hashtab_next(iter))) {
+		/* A context left out is merged the full way */
+		AST_VECTOR_APPEND(&scan, tmp);
+	}
+	ast_hashtab_end_traversal(iter);
+	merge_scanning = 1;
+	ast_unlock_contexts();
+
+	for (idx = 0; idx < AST_VECTOR_SIZE(&scan); idx++) {
+		merge_scan(AST_VECTOR_GET(&scan, idx), registrar);
+	}
+	AST_VECTOR_FREE(&scan);
+
+	scantime = ast_tvnow();
+	ast_wrlock_contexts();
+	locktime = ast_tvnow();
+	merge_scanning = 0;
+	deferred = merge_deferred;
+	merge_deferred = NULL;
+
 	iter = ast_hashtab_start_traversal(contexts_table);
 	while ((tmp = ast_hashtab_next(iter))) {
 		++ctx_count;
-		context_merge(extcontexts, exttable, tmp, registrar);
+		if (merge_needed(tmp)) {
+			context_merge(extcontexts, exttable, tmp, registrar);
+		}
 	}
 	ast_hashtab_end_traversal(iter);
 
@@ -6537,6 +6968,7 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 	/* move in the new table and list */
 	contexts_table = exttable;
 	contexts = *extcontexts;
+	dialplan_changed();
 
 	/*
 	 * Restore the watchers for hints that can be found; notify
@@ -6594,7 +7026,9 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 	context_table_create_autohints(contexts_table);
 
 	ao2_unlock(hints);
+	dialplan_changed();
 	ast_unlock_contexts();
+	unlocktime = ast_tvnow();
 
 	/*
 	 * Notify watchers of all removed hints with the same lock
@@ -6636,16 +7070,35 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 		__ast_internal_context_destroy(tmp);
 		tmp = next;
 	}
+	for (tmp = deferred; tmp; ) {
+		struct ast_context *next;	/* next starting point */
+
+		next = tmp->next;
+		__ast_internal_context_destroy(tmp);
+		tmp = next;
+	}
 	enddeltime = ast_tvnow();
 
-	ft = ast_tvdiff_us(writelocktime, begintime);
+	ft = ast_tvdiff_us(scantime, begintime);
+	ft /= 1000000.0;
+	ast_verb(5,"Time to scan old dialplan for leftovers: %8.6f sec\n", ft);
+
+	ft = ast_tvdiff_us(locktime, scantime);
 	ft /= 1000000.0;
-	ast_verb(5,"Time to scan old dialplan and merge leftovers back into the new: %8.6f sec\n", ft);
+	ast_verb(5,"Time waiting for the dialplan lock: %8.6f sec\n", ft);
 
-	ft = ast_tvdiff_us(endlocktime, writelocktime);
+	ft = ast_tvdiff_us(writelocktime, locktime);
+	ft /= 1000000.0;
+	ast_verb(5,"Time to merge leftovers back into the new dialplan: %8.6f sec\n", ft);
+
+	ft = ast_tvdiff_us(unlocktime, writelocktime);
 	ft /= 1000000.0;
 	ast_verb(5,"Time to restore hints and swap in new dialplan: %8.6f sec\n", ft);
 
+	ft = ast_tvdiff_us(unlocktime, locktime);
+	ft /= 1000000.0;
+	ast_verb(5,"Time the dialplan lock was held: %8.6f sec\n", ft);
+
 	ft = ast_tvdiff_us(enddeltime, endlocktime);
 	ft /= 1000000.0;
 	ast_verb(5,"Time to delete the old dialplan: %8.6f sec\n", ft);
@@ -6694,6 +7147,7 @@ int ast_context_add_include2(struct ast_context *con, const char *value,
 	}
 
 	ast_wrlock_context(con);
+	context_changed(con);
 
 	/* ... go to last include and check if context is already included too... */
 	for (idx = 0; idx < ast_context_includes_count(con); idx++) {
@@ -6701,7 +7155,7 @@ int ast_context_add_include2(struct ast_context *con, const char *value,
 
 		if (!strcasecmp(ast_get_include_name(i), ast_get_include_name(new_include))) {
 			include_free(new_include);
-			ast_unlock_context(con);
+			unlock_changed_context(con);
 			errno = EEXIST;
 			return -1;
 		}
@@ -6710,13 +7164,13 @@ int ast_context_add_include2(struct ast_context *con, const char *value,
 	/* ... include new context into context list, unlock, return */
 	if (AST_VECTOR_APPEND(&con->includes, new_include)) {
 		include_free(new_include);
-		ast_unlock_context(con);
+		unlock_changed_context(con);
 		return -1;
 	}
 	ast_debug(1, "Including context '%s' in context '%s'\n",
 		ast_get_include_name(new_include), ast_get_context_name(con));
 
-	ast_unlock_context(con);
+	unlock_changed_context(con);
 
 	return 0;
 }
@@ -6759,6 +7213,7 @@ int ast_context_add_switch2(struct ast_context *con, const char *value,
 
 	/* ... try to lock this context ... */
 	ast_wrlock_context(con);
+	context_changed(con);
 
 	/* ... go to last sw and check if context is already swd too... */
 	for (idx = 0; idx < ast_context_switches_count(con); idx++) {
@@ -6767,7 +7222,7 @@ int ast_context_add_switch2(struct ast_context *con, const char *value,
 		if (!strcasecmp(ast_get_switch_name(i), ast_get_switch_name(new_sw)) &&
 			!strcasecmp(ast_get_switch_data(i), ast_get_switch_data(new_sw))) {
 			sw_free(new_sw);
-			ast_unlock_context(con);
+			unlock_changed_context(con);
 			errno = EEXIST;
 			return -1;
 		}
@@ -6776,14 +7231,14 @@ int ast_context_add_switch2(struct ast_context *con, const char *value,
 	/* ... sw new context into context list, unlock, return */
 	if (AST_VECTOR_APPEND(&con->alts, new_sw)) {
 		sw_free(new_sw);
-		ast_unlock_context(con);
+		unlock_changed_context(con);
 		return -1;
 	}
 
 	ast_verb(3, "Including switch '%s/%s' in context '%s'\n",
 		ast_get_switch_name(new_sw), ast_get_switch_data(new_sw), ast_get_context_name(con));
 
-	ast_unlock_context(con);
+	unlock_changed_context(con);
 
 	return 0;
 }
@@ -6810,6 +7265,7 @@ int ast_context_remove_ignorepat2(struct ast_context *con, const char *ignorepat
 	int idx;
 
 	ast_wrlock_context(con);
+	context_changed(con);
 
 	for (idx = 0; idx < ast_context_ignorepats_count(con); idx++) {
 		struct ast_ignorepat *ip = AST_VECTOR_GET(&con->ignorepats, idx);
@@ -6855,6 +7311,7 @@ int ast_context_add_ignorepat2(struct ast_context *con, const char *value, const
 	}
 
 	ast_wrlock_context(con);
+	context_changed(con);
 	for (idx = 0; idx < ast_context_ignorepats_count(con); idx++) {
 		const struct ast_ignorepat *i = ast_context_ignorepats_get(con, idx);
 
@@ -7433,6 +7890,7 @@ static int ast_add_extension2_lockopt(struct ast_context *con,
 	if (lock_context) {
 		ast_wrlock_context(con);
 	}
+	context_changed(con);
 
 	if (con->pattern_tree) { /* usually, on initial load, the pattern_tree isn't formed until the first find_exten; so if we are adding
 								an extension, and the trie exists, then we need to incrementally add this pattern to it. */
@@ -7486,7 +7944,7 @@ static int ast_add_extension2_lockopt(struct ast_context *con,
 			ast_free(tmp);
 		}
 		if (lock_context) {
-			ast_unlock_context(con);
+			unlock_changed_context(con);
 		}
 		if (res < 0) {
 			errno = EEXIST;
@@ -7531,7 +7989,7 @@ static int ast_add_extension2_lockopt(struct ast_context *con,
 		ast_hashtab_insert_safe(con->root_table, tmp);
 
 		if (lock_context) {
-			ast_unlock_context(con);
+			unlock_changed_context(con);
 		}
 		if (tmp->priority == PRIORITY_HINT) {
 			ast_add_hint(tmp);
@@ -8053,6 +8511,17 @@ static void __ast_internal_context_destroy( struct ast_context *con)
 }
 
 
+/*! \brief Free a context removed from the dialplan, or defer it if a merge may look at it */
+static void context_free(struct ast_context *con)
+{
+	if (merge_scanning) {
+		con->next = merge_deferred;
+		merge_deferred = con;
+		return;
+	}
+	__ast_internal_context_destroy(con);
+}
+
 void __ast_context_destroy(struct ast_context *list, struct ast_hashtab *contexttab, struct ast_context *con, const char *registrar)
 {
 	struct ast_context *tmp, *tmpl=NULL;
@@ -8077,6 +8546,7 @@ void __ast_context_destroy(struct ast_context *list, struct ast_hashtab *context
 		if (!tmp)	/* not found, we are done */
 			break;
 		ast_wrlock_context(tmp);
+		context_changed(tmp);
 
 		if (registrar) {
 			/* then search thru and remove any extens that match registrar. */
@@ -8172,12 +8642,12 @@ void __ast_context_destroy(struct ast_context *list, struct ast_hashtab *context
 					contexts = next;
 				/* Okay, now we're safe to let it go -- in a sense, we were
 				   ready to let it go as soon as we locked it. */
-				ast_unlock_context(tmp);
-				__ast_internal_context_destroy(tmp);
+				unlock_changed_context(tmp);
+				context_free(tmp);
 			} else {
 				ast_debug(1,"Couldn't delete ctx %s/%s; refc=%d; tmp.root=%p\n", tmp->name, tmp->registrar,
 						  tmp->refcount, tmp->root);
-				ast_unlock_context(tmp);
+				unlock_changed_context(tmp);
 				next = tmp->next;
 				tmpl = tmp;
 			}
@@ -8193,8 +8663,8 @@ void __ast_context_destroy(struct ast_context *list, struct ast_hashtab *context
 				contexts = next;
 			/* Okay, now we're safe to let it go -- in a sense, we were
 			   ready to let it go as soon as we locked it. */
-			ast_unlock_context(tmp);
-			__ast_internal_context_destroy(tmp);
+			unlock_changed_context(tmp);
+			context_free(tmp);
 		}
 
 		/* if we have a specific match, we are done, otherwise continue */
@@ -8941,6 +9411,8 @@ static void pbx_shutdown(void)
 	if (contexts_table) {
 		ast_hashtab_destroy(contexts_table, NULL);
 	}
+	ao2_cleanup(find_cache);
+	find_cache = NULL;
 }
 
 static void print_hints_key(void *v_obj, void *where, ao2_prnt_fn *prnt)
@@ -9008,6 +9480,12 @@ int ast_pbx_init(void)
 	if (statecbs) {
 		ao2_container_register("statecbs", statecbs, print_statecbs_key);
 	}
+	find_extension_latency = ast_latency_histogram_get("pbx_find_extension",
+		"Time taken to look up an extension in the dialplan");
+	/* Not required, lookups just are not cached without it */
+	find_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK,
+		AO2_CONTAINER_ALLOC_OPT_DUPS_REPLACE, FIND_CACHE_BUCKETS,
+		find_cache_entry_hash_fn, NULL, find_cache_entry_cmp_fn);
 
 	ast_register_cleanup(pbx_shutdown);
 
@@ -53,6 +53,7 @@ struct ast_app {
 	);
 #ifdef AST_XML_DOCS
 	enum ast_doc_src docsrc;		/*!< Where the documentation come from. */
+	unsigned int docs_pending:1;		/*!< The XML documentation is built when first shown. */
 #endif
 	AST_RWLIST_ENTRY(ast_app) list;		/*!< Next app in list */
 	struct ast_module *module;		/*!< Module this app belongs to */
@@ -99,15 +100,58 @@ struct ast_app *pbx_findapp(const char *app)
 	return ret;
 }
 
+#ifdef AST_XML_DOCS
+/*! \brief Protects building the XML documentation of applications when first shown */
+AST_MUTEX_DEFINE_STATIC(app_docs_lock);
+
+static void app_build_xmldoc(struct ast_app *app)
+{
+	char *tmpxml;
+
+	/* load synopsis */
+	tmpxml = ast_xmldoc_build_synopsis("application", app->name, ast_module_name(app->module));
+	ast_string_field_set(app, synopsis, tmpxml);
+	ast_free(tmpxml);
+
+	/* load description */
+	tmpxml = ast_xmldoc_build_description("application", app->name, ast_module_name(app->module));
+	ast_string_field_set(app, description, tmpxml);
+	ast_free(tmpxml);
+
+	/* load syntax */
+	tmpxml = ast_xmldoc_build_syntax("application", app->name, ast_module_name(app->module));
+	ast_string_field_set(app, syntax, tmpxml);
+	ast_free(tmpxml);
+
+	/* load arguments */
+	tmpxml = ast_xmldoc_build_arguments("application", app->name, ast_module_name(app->module));
+	ast_string_field_set(app, arguments, tmpxml);
+	ast_free(tmpxml);
+
+	/* load seealso */
+	tmpxml = ast_xmldoc_build_seealso("application", app->name, ast_module_name(app->module));
+	ast_string_field_set(app, seealso, tmpxml);
+	ast_free(tmpxml);
+}
+
+/*! \brief Build the XML documentation of an application if it was deferred */
+static void app_load_xmldoc(struct ast_app *app)
+{
+	ast_mutex_lock(&app_docs_lock);
+	if (app->docs_pending) {
+		app_build_xmldoc(app);
+		app->docs_pending = 0;
+	}
+	ast_mutex_unlock(&app_docs_lock);
+}
+#endif
+
 /*! \brief Dynamically register a new dial plan application */
 int ast_register_application2(const char *app, int (*execute)(struct ast_channel *, const char *), const char *synopsis, const char *description, void *mod)
 {
 	struct ast_app *tmp;
 	struct ast_app *cur;
 	int length;
-#ifdef AST_XML_DOCS
-	char *tmpxml;
-#endif
 
 	AST_RWLIST_WRLOCK(&apps);
 	cur = pbx_findapp_nolock(app);
@@ -137,30 +181,11 @@ int ast_register_application2(const char *app, int (*execute)(struct ast_channel
 #ifdef AST_XML_DOCS
 	/* Try to lookup the docs in our XML documentation database */
 	if (ast_strlen_zero(synopsis) && ast_strlen_zero(description)) {
-		/* load synopsis */
-		tmpxml = ast_xmldoc_build_synopsis("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, synopsis, tmpxml);
-		ast_free(tmpxml);
-
-		/* load description */
-		tmpxml = ast_xmldoc_build_description("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, description, tmpxml);
-		ast_free(tmpxml);
-
-		/* load syntax */
-		tmpxml = ast_xmldoc_build_syntax("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, syntax, tmpxml);
-		ast_free(tmpxml);
-
-		/* load arguments */
-		tmpxml = ast_xmldoc_build_arguments("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, arguments, tmpxml);
-		ast_free(tmpxml);
-
-		/* load seealso */
-		tmpxml = ast_xmldoc_build_seealso("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, seealso, tmpxml);
-		ast_free(tmpxml);
+		if (ast_xmldoc_lazy()) {
+			tmp->docs_pending = 1;
+		} else {
+			app_build_xmldoc(tmp);
+		}
 		tmp->docsrc = AST_XML_DOC;
 	} else {
 #endif
@@ -193,6 +218,8 @@ static void print_app_docs(struct ast_app *aa, int fd)
 {
 #ifdef AST_XML_DOCS
 	char *synopsis = NULL, *description = NULL, *arguments = NULL, *seealso = NULL;
+
+	app_load_xmldoc(aa);
 	if (aa->docsrc == AST_XML_DOC) {
 		synopsis = ast_xmldoc_printable(S_OR(aa->synopsis, "Not available"), 1);
 		description = ast_xmldoc_printable(S_OR(aa->description, "Not available"), 1);
@@ -352,6 +379,9 @@ static char *handle_show_applications(struct ast_cli_entry *e, int cmd, struct a
 	AST_RWLIST_TRAVERSE(&apps, aa, list) {
 		int printapp = 0;
 		total_apps++;
+#ifdef AST_XML_DOCS
+		app_load_xmldoc(aa);
+#endif
 		if (like) {
 			if (strcasestr(aa->name, a->argv[4])) {
 				printapp = 1;
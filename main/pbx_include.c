@@ -71,6 +71,11 @@ int include_valid(const struct ast_include *inc)
 	return ast_check_timing(&(inc->timing));
 }
 
+int include_has_timing(const struct ast_include *inc)
+{
+	return inc->hastime;
+}
+
 struct ast_include *include_alloc(const char *value, const char *registrar)
 {
 	struct ast_include *new_include;
@@ -47,6 +47,8 @@ struct ast_include *include_alloc(const char *value, const char *registrar);
 /*! Free an ast_include and associated data. */
 void include_free(struct ast_include *inc);
 int include_valid(const struct ast_include *inc);
+/*! Whether an include only applies at certain times. */
+int include_has_timing(const struct ast_include *inc);
 const char *include_rname(const struct ast_include *inc);
 
 /*! pbx_sw.c */
@@ -65,6 +67,13 @@ struct ast_switch *pbx_findswitch(const char *sw);
 /*! pbx_app.c functions needed by pbx.c */
 const char *app_name(struct ast_app *app);
 
+/*! pbx_variables.c functions needed by pbx.c */
+struct pbx_substitution;
+/*! Split a string to substitute variables into once, for repeated substitution. */
+struct pbx_substitution *pbx_substitution_compile(const char *templ);
+/*! Substitute variables into a compiled string, like pbx_substitute_variables_helper(). */
+void pbx_substitution_apply(struct ast_channel *c, struct pbx_substitution *sub, char *cp2, int count);
+
 #define VAR_BUF_SIZE 4096
 
 #endif /* _PBX_PRIVATE_H */
@@ -367,11 +367,8 @@ const char *ast_str_retrieve_variable(struct ast_str **str, ssize_t maxlen, stru
 			continue;
 		if (places[i] == &globals)
 			ast_rwlock_rdlock(&globalslock);
-		AST_LIST_TRAVERSE(places[i], variables, entries) {
-			if (!strcmp(ast_var_name(variables), var)) {
-				s = ast_var_value(variables);
-				break;
-			}
+		if ((variables = ast_var_find_by_name(places[i], var))) {
+			s = ast_var_value(variables);
 		}
 		if (places[i] == &globals)
 			ast_rwlock_unlock(&globalslock);
@@ -667,6 +664,59 @@ AST_THREADSTORAGE(varsub_recurse_level);
 
 #define MAX_VARIABLE_SUB_RECURSE_DEPTH 15
 
+/*!
+ * \internal
+ * \brief Read the value of a variable or function being substituted
+ *
+ * \return The value, which may be in workspace, or NULL if there is none
+ */
+static char *substitute_value(struct ast_channel *c, struct varshead *headp, const char *vars, int isfunction,
+	char *workspace, const char *context, const char *exten, int pri)
+{
+	char *cp4 = NULL;
+
+	if (isfunction) {
+		/* Evaluate function */
+		if (c || !headp)
+			cp4 = ast_func_read(c, vars, workspace, VAR_BUF_SIZE) ? NULL : workspace;
+		else {
+			struct varshead old;
+			struct ast_channel *bogus;
+
+			bogus = ast_dummy_channel_alloc();
+			if (bogus) {
+				old = *ast_channel_varshead(bogus);
+				*ast_channel_varshead(bogus) = *headp;
+				cp4 = ast_func_read(bogus, vars, workspace, VAR_BUF_SIZE) ? NULL : workspace;
+				/* Don't deallocate the varshead that was passed in */
+				*ast_channel_varshead(bogus) = old;
+				ast_channel_unref(bogus);
+			} else {
+				ast_log(LOG_ERROR, "Unable to allocate bogus channel for function value substitution.\n");
+				cp4 = NULL;
+			}
+		}
+		ast_debug(2, "Function %s result is '%s'\n", vars, cp4 ? cp4 : "(null)");
+	} else {
+		/* Retrieve variable value */
+		/* For dialplan location, if we were told what to substitute explicitly, use that instead */
+		if (exten && !strcmp(vars, "EXTEN")) {
+			ast_copy_string(workspace, exten, VAR_BUF_SIZE);
+			cp4 = workspace;
+		} else if (context && !strcmp(vars, "CONTEXT")) {
+			ast_copy_string(workspace, context, VAR_BUF_SIZE);
+			cp4 = workspace;
+		} else if (pri && !strcmp(vars, "PRIORITY")) {
+			snprintf(workspace, VAR_BUF_SIZE, "%d", pri);
+			cp4 = workspace;
+		} else {
+			pbx_retrieve_variable(c, vars, &cp4, workspace, VAR_BUF_SIZE, headp);
+		}
+	}
+
+	return cp4;
+}
+
 void pbx_substitute_variables_helper_full_location(struct ast_channel *c, struct varshead *headp, const char *cp1, char *cp2, int count, size_t *used, const char *context, const char *exten, int pri)
 {
 	/* Substitutes variables into cp2, based on string cp1, cp2 NO LONGER NEEDS TO BE ZEROED OUT!!!!  */
@@ -793,44 +843,7 @@ void pbx_substitute_variables_helper_full_location(struct ast_channel *c, struct
 			}
 
 			parse_variable_name(vars, &offset, &offset2, &isfunction);
-			if (isfunction) {
-				/* Evaluate function */
-				if (c || !headp)
-					cp4 = ast_func_read(c, vars, workspace, VAR_BUF_SIZE) ? NULL : workspace;
-				else {
-					struct varshead old;
-					struct ast_channel *bogus;
-
-					bogus = ast_dummy_channel_alloc();
-					if (bogus) {
-						old = *ast_channel_varshead(bogus);
-						*ast_channel_varshead(bogus) = *headp;
-						cp4 = ast_func_read(bogus, vars, workspace, VAR_BUF_SIZE) ? NULL : workspace;
-						/* Don't deallocate the varshead that was passed in */
-						*ast_channel_varshead(bogus) = old;
-						ast_channel_unref(bogus);
-					} else {
-						ast_log(LOG_ERROR, "Unable to allocate bogus channel for function value substitution.\n");
-						cp4 = NULL;
-					}
-				}
-				ast_debug(2, "Function %s result is '%s'\n", vars, cp4 ? cp4 : "(null)");
-			} else {
-				/* Retrieve variable value */
-				/* For dialplan location, if we were told what to substitute explicitly, use that instead */
-				if (exten && !strcmp(vars, "EXTEN")) {
-					ast_copy_string(workspace, exten, VAR_BUF_SIZE);
-					cp4 = workspace;
-				} else if (context && !strcmp(vars, "CONTEXT")) {
-					ast_copy_string(workspace, context, VAR_BUF_SIZE);
-					cp4 = workspace;
-				} else if (pri && !strcmp(vars, "PRIORITY")) {
-					snprintf(workspace, VAR_BUF_SIZE, "%d", pri);
-					cp4 = workspace;
-				} else {
-					pbx_retrieve_variable(c, vars, &cp4, workspace, VAR_BUF_SIZE, headp);
-				}
-			}
+			cp4 = substitute_value(c, headp, vars, isfunction, workspace, context, exten, pri);
 			if (cp4) {
 				cp4 = substring(cp4, offset, offset2, workspace, VAR_BUF_SIZE);
 
@@ -913,6 +926,295 @@ void pbx_substitute_variables_varshead(struct varshead *headp, const char *cp1,
 	pbx_substitute_variables_helper_full(NULL, headp, cp1, cp2, count, NULL);
 }
 
+/*! \brief What a part of a compiled substitution is */
+enum substitution_part_type {
+	/*! \brief Text copied as is */
+	SUBSTITUTION_LITERAL,
+	/*! \brief A ${variable} or ${FUNCTION()} */
+	SUBSTITUTION_VARIABLE,
+	/*! \brief A $[expression] */
+	SUBSTITUTION_EXPRESSION,
+};
+
+/*! \brief A part of a compiled substitution */
+struct substitution_part {
+	enum substitution_part_type type;
+	/*! \brief The literal text, variable name or expression */
+	char *text;
+	/*! \brief Length of the literal text */
+	int len;
+	/*! \brief Substitutions inside the variable name or expression, NULL if there are none */
+	struct pbx_substitution *inner;
+	/*! \brief offset:length of a variable without inner, already split off its name */
+	int offset;
+	int length;
+	/*! \brief Whether a variable without inner is a function */
+	int isfunction;
+	/*! \brief Set if the closing bracket is missing */
+	unsigned int unterminated:1;
+};
+
+/*! \brief A string to substitute variables into, split into its parts */
+struct pbx_substitution {
+	AST_VECTOR(, struct substitution_part) parts;
+};
+
+static void substitution_destroy(void *obj)
+{
+	struct pbx_substitution *sub = obj;
+	int idx;
+
+	for (idx = 0; idx < AST_VECTOR_SIZE(&sub->parts); idx++) {
+		struct substitution_part *part = AST_VECTOR_GET_ADDR(&sub->parts, idx);
+
+		ast_free(part->text);
+		ao2_cleanup(part->inner);
+	}
+	AST_VECTOR_FREE(&sub->parts);
+}
+
+/*!
+ * \internal
+ * \brief Add text to a compiled substitution, joining it to literal text before it
+ */
+static int substitution_add_literal(struct pbx_substitution *sub, const char *text, int len)
+{
+	struct substitution_part part = { .type = SUBSTITUTION_LITERAL, };
+	struct substitution_part *last;
+	char *joined;
+
+	if (AST_VECTOR_SIZE(&sub->parts)) {
+		last = AST_VECTOR_GET_ADDR(&sub->parts, AST_VECTOR_SIZE(&sub->parts) - 1);
+		if (last->type == SUBSTITUTION_LITERAL) {
+			joined = ast_realloc(last->text, last->len + len + 1);
+			if (!joined) {
+				return -1;
+			}
+			memcpy(joined + last->len, text, len);
+			joined[last->len + len] = '\0';
+			last->text = joined;
+			last->len += len;
+			return 0;
+		}
+	}
+
+	part.text = ast_strndup(text, len);
+	part.len = len;
+	if (!part.text || AST_VECTOR_APPEND(&sub->parts, part)) {
+		ast_free(part.text);
+		return -1;
+	}
+
+	return 0;
+}
+
+struct pbx_substitution *pbx_substitution_compile(const char *templ)
+{
+	struct pbx_substitution *sub;
+	const char *whereweare = templ;
+
+	sub = ao2_alloc_options(sizeof(*sub), substitution_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!sub) {
+		return NULL;
+	}
+	if (AST_VECTOR_INIT(&sub->parts, 4)) {
+		ao2_ref(sub, -1);
+		return NULL;
+	}
+
+	/* This splits the string exactly as pbx_substitute_variables_helper_full_location() does */
+	while (*whereweare) {
+		struct substitution_part part = { 0, };
+		const char *nextthing;
+		const char *vare;
+		char open;
+		char close;
+		char other;
+		int brackets;
+		int needsub;
+		int pos;
+		int len;
+
+		nextthing = strchr(whereweare, '$');
+		if (!nextthing) {
+			if (substitution_add_literal(sub, whereweare, strlen(whereweare))) {
+				break;
+			}
+			return sub;
+		}
+
+		pos = nextthing - whereweare;
+		if (nextthing[1] == '{') {
+			part.type = SUBSTITUTION_VARIABLE;
+			open = '{';
+			close = '}';
+			other = '[';
+		} else if (nextthing[1] == '[') {
+			part.type = SUBSTITUTION_EXPRESSION;
+			open = '[';
+			close = ']';
+			other = '{';
+		} else {
+			/* '$' is not part of a substitution so include it too. */
+			if (substitution_add_literal(sub, whereweare, pos + 1)) {
+				break;
+			}
+			whereweare += pos + 1;
+			continue;
+		}
+
+		if (pos && substitution_add_literal(sub, whereweare, pos)) {
+			break;
+		}
+
+		/* Find the end of it */
+		vare = nextthing + 2;
+		brackets = 1;
+		needsub = 0;
+		while (brackets && *vare) {
+			if ((vare[0] == '$') && (vare[1] == open)) {
+				needsub++;
+				brackets++;
+				vare++;
+			} else if (vare[0] == open) {
+				brackets++;
+			} else if (vare[0] == close) {
+				brackets--;
+			} else if ((vare[0] == '$') && (vare[1] == other)) {
+				needsub++;
+				vare++;
+			}
+			vare++;
+		}
+		len = vare - (nextthing + 2);
+		if (brackets) {
+			part.unterminated = 1;
+		} else {
+			/* Don't count the closing bracket in the length. */
+			--len;
+		}
+		whereweare = vare;
+
+		part.text = ast_strndup(nextthing + 2, MIN(len, VAR_BUF_SIZE - 1));
+		if (!part.text) {
+			break;
+		}
+		if (needsub) {
+			part.inner = pbx_substitution_compile(part.text);
+			if (!part.inner) {
+				ast_free(part.text);
+				break;
+			}
+		} else if (part.type == SUBSTITUTION_VARIABLE) {
+			parse_variable_name(part.text, &part.offset, &part.length, &part.isfunction);
+		}
+		if (AST_VECTOR_APPEND(&sub->parts, part)) {
+			ast_free(part.text);
+			ao2_cleanup(part.inner);
+			break;
+		}
+	}
+
+	if (*whereweare) {
+		ao2_ref(sub, -1);
+		return NULL;
+	}
+
+	return sub;
+}
+
+/*!
+ * \internal
+ * \brief Substitute variables into a compiled string
+ *
+ * \return The length of the result
+ */
+static int substitution_apply(struct ast_channel *c, struct varshead *headp,
+	struct pbx_substitution *sub, char *cp2, int count)
+{
+	const char *orig_cp2 = cp2;
+	int *recurse_depth;
+	int idx;
+
+	*cp2 = 0;
+
+	recurse_depth = ast_threadstorage_get(&varsub_recurse_level, sizeof(*recurse_depth));
+	if (!recurse_depth) {
+		return 0;
+	}
+	if ((*recurse_depth)++ >= MAX_VARIABLE_SUB_RECURSE_DEPTH) {
+		ast_log(LOG_ERROR, "Exceeded maximum variable substitution recursion depth (%d) - possible infinite recursion in dialplan?\n", MAX_VARIABLE_SUB_RECURSE_DEPTH);
+		(*recurse_depth)--;
+		return 0;
+	}
+
+	for (idx = 0; idx < AST_VECTOR_SIZE(&sub->parts) && count; idx++) {
+		struct substitution_part *part = AST_VECTOR_GET_ADDR(&sub->parts, idx);
+		char ltmp[VAR_BUF_SIZE];
+		char *vars = part->text;
+		int offset = part->offset;
+		int offset2 = part->length;
+		int isfunction = part->isfunction;
+		int length;
+
+		if (part->type == SUBSTITUTION_LITERAL) {
+			length = MIN(part->len, count);
+			memcpy(cp2, part->text, length);
+			count -= length;
+			cp2 += length;
+			*cp2 = 0;
+			continue;
+		}
+
+		if (part->unterminated) {
+			ast_log(LOG_WARNING, "Error in extension logic (missing '%c')\n",
+				part->type == SUBSTITUTION_VARIABLE ? '}' : ']');
+		}
+		if (part->inner) {
+			substitution_apply(c, headp, part->inner, ltmp, VAR_BUF_SIZE - 1);
+			if (part->type == SUBSTITUTION_VARIABLE) {
+				parse_variable_name(ltmp, &offset, &offset2, &isfunction);
+			}
+			vars = ltmp;
+		}
+
+		if (part->type == SUBSTITUTION_VARIABLE) {
+			char workspace[VAR_BUF_SIZE] = "";
+			char *cp4;
+
+			cp4 = substitute_value(c, headp, vars, isfunction, workspace, NULL, NULL, 0);
+			if (cp4) {
+				cp4 = substring(cp4, offset, offset2, workspace, VAR_BUF_SIZE);
+
+				length = strlen(cp4);
+				if (length > count)
+					length = count;
+				memcpy(cp2, cp4, length);
+				count -= length;
+				cp2 += length;
+				*cp2 = 0;
+			}
+		} else {
+			length = ast_expr(vars, cp2, count, c);
+			if (length) {
+				ast_debug(1, "Expression result is '%s'\n", cp2);
+				count -= length;
+				cp2 += length;
+				*cp2 = 0;
+			}
+		}
+	}
+
+	(*recurse_depth)--;
+
+	return cp2 - orig_cp2;
+}
+
+void pbx_substitution_apply(struct ast_channel *c, struct pbx_substitution *sub, char *cp2, int count)
+{
+	substitution_apply(c, c ? ast_channel_varshead(c) : NULL, sub, cp2, count);
+}
+
 /*! \brief CLI support for listing global variables in a parseable way */
 static char *handle_show_globals(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
@@ -1134,11 +1436,8 @@ const char *pbx_builtin_getvar_helper(struct ast_channel *chan, const char *name
 			continue;
 		if (places[i] == &globals)
 			ast_rwlock_rdlock(&globalslock);
-		AST_LIST_TRAVERSE(places[i], variables, entries) {
-			if (!strcmp(name, ast_var_name(variables))) {
-				ret = ast_var_value(variables);
-				break;
-			}
+		if ((variables = ast_var_find_by_name(places[i], name))) {
+			ret = ast_var_value(variables);
 		}
 		if (places[i] == &globals)
 			ast_rwlock_unlock(&globalslock);
@@ -1190,6 +1489,7 @@ int pbx_builtin_setvar_helper(struct ast_channel *chan, const char *name, const
 	struct ast_var_t *newvariable;
 	struct varshead *headp;
 	const char *nametail = name;
+	unsigned int hash;
 	/*! True if the old value was not an empty string. */
 	int old_value_existed = 0;
 
@@ -1213,9 +1513,10 @@ int pbx_builtin_setvar_helper(struct ast_channel *chan, const char *name, const
 		if (*nametail == '_')
 			nametail++;
 	}
+	hash = ast_var_name_hash(nametail);
 
 	AST_LIST_TRAVERSE_SAFE_BEGIN(headp, newvariable, entries) {
-		if (strcmp(ast_var_name(newvariable), nametail) == 0) {
+		if (newvariable->hash == hash && strcmp(ast_var_name(newvariable), nametail) == 0) {
 			/* there is already such a variable, delete it */
 			AST_LIST_REMOVE_CURRENT(entries);
 			old_value_existed = !ast_strlen_zero(ast_var_value(newvariable));
@@ -276,6 +276,18 @@ static ast_rwlock_t static_RTP_PT_lock;
 /*! \brief \ref stasis topic for RTP related messages */
 static struct stasis_topic *rtp_topic;
 
+/*! \brief Number of buckets for the container of RTP instances */
+#define RTP_INSTANCE_BUCKETS 257
+
+/*! \brief Every RTP instance not yet destroyed, for sampling their statistics */
+static struct ao2_container *rtp_instances;
+
+/*! \brief Hashing function for the container of RTP instances */
+static int rtp_instance_hash_fn(const void *obj, const int flags)
+{
+	return (int) (((uintptr_t) obj >> 4) & INT_MAX);
+}
+
 
 /*!
  * \brief Set given json object into target with name
@@ -460,6 +472,9 @@ int ast_rtp_instance_destroy(struct ast_rtp_instance *instance)
 	if (!instance) {
 		return 0;
 	}
+	if (rtp_instances) {
+		ao2_unlink(rtp_instances, instance);
+	}
 	if (ast_debug_rtp_is_allowed) {
 		char buffer[4][512];
 		ast_debug_rtp(1, "%s:\n"
@@ -562,6 +577,10 @@ struct ast_rtp_instance *ast_rtp_instance_new(const char *engine_name,
 	}
 	ao2_unlock(instance);
 
+	if (rtp_instances) {
+		ao2_link(rtp_instances, instance);
+	}
+
 	ast_debug(1, "RTP instance '%p' is setup and ready to go\n", instance);
 
 	return instance;
@@ -2576,6 +2595,46 @@ int ast_rtp_instance_get_stats(struct ast_rtp_instance *instance, struct ast_rtp
 	return res;
 }
 
+int ast_rtp_instance_sample_stats(struct ast_rtp_instance *instance, struct ast_rtp_instance_stats *stats)
+{
+	if (!instance || !instance->engine || !stats) {
+		return -1;
+	}
+
+	if (!instance->engine->sample_stats) {
+		return ast_rtp_instance_get_stats(instance, stats, AST_RTP_INSTANCE_STAT_ALL);
+	}
+
+	return instance->engine->sample_stats(instance, stats);
+}
+
+void ast_rtp_instance_sample_stats_all(ast_rtp_instance_stats_cb cb, void *data)
+{
+	struct ao2_iterator *iter;
+	struct ast_rtp_instance *instance;
+	int stop = 0;
+
+	if (!rtp_instances) {
+		return;
+	}
+
+	/* Sample from a copy so creating and destroying instances is never held up */
+	iter = ao2_callback(rtp_instances, OBJ_MULTIPLE, NULL, NULL);
+	if (!iter) {
+		return;
+	}
+
+	while ((instance = ao2_iterator_next(iter))) {
+		struct ast_rtp_instance_stats stats = { 0, };
+
+		if (!stop && !ast_rtp_instance_sample_stats(instance, &stats)) {
+			stop = cb(instance, &stats, data);
+		}
+		ao2_ref(instance, -1);
+	}
+	ao2_iterator_destroy(iter);
+}
+
 char *ast_rtp_instance_get_quality(struct ast_rtp_instance *instance, enum ast_rtp_instance_stat_field field, char *buf, size_t size)
 {
 	struct ast_rtp_instance_stats stats = { 0, };
@@ -3737,6 +3796,8 @@ static void rtp_engine_shutdown(void)
 
 	ao2_cleanup(rtp_topic);
 	rtp_topic = NULL;
+	ao2_cleanup(rtp_instances);
+	rtp_instances = NULL;
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_rtp_rtcp_received_type);
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_rtp_rtcp_sent_type);
 
@@ -3785,6 +3846,11 @@ int ast_rtp_engine_init(void)
 	if (!rtp_topic) {
 		return -1;
 	}
+	rtp_instances = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+		RTP_INSTANCE_BUCKETS, rtp_instance_hash_fn, NULL, NULL);
+	if (!rtp_instances) {
+		return -1;
+	}
 	STASIS_MESSAGE_TYPE_INIT(ast_rtp_rtcp_sent_type);
 	STASIS_MESSAGE_TYPE_INIT(ast_rtp_rtcp_received_type);
 	ast_register_cleanup(rtp_engine_shutdown);
@@ -4205,7 +4271,7 @@ struct ast_json *ast_rtp_instance_get_stats_all_json(struct ast_rtp_instance *in
 {
 	struct ast_rtp_instance_stats stats = {0,};
 
-	if(ast_rtp_instance_get_stats(instance, &stats, AST_RTP_INSTANCE_STAT_ALL)) {
+	if(ast_rtp_instance_sample_stats(instance, &stats)) {
 		return NULL;
 	}
 
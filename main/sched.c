@@ -43,6 +43,7 @@
 #include "asterisk/lock.h"
 #include "asterisk/utils.h"
 #include "asterisk/heap.h"
+#include "asterisk/dlinkedlists.h"
 #include "asterisk/threadstorage.h"
 
 /*!
@@ -55,6 +56,16 @@
  */
 #define SCHED_MAX_CACHE 128
 
+/*! \brief Number of timing wheel levels */
+#define SCHED_WHEEL_LEVELS 4
+/*! \brief Number of tick bits covered by each timing wheel level */
+#define SCHED_WHEEL_BITS 8
+/*! \brief Number of slots on each timing wheel level */
+#define SCHED_WHEEL_SIZE (1 << SCHED_WHEEL_BITS)
+#define SCHED_WHEEL_MASK (SCHED_WHEEL_SIZE - 1)
+/*! \brief Number of words in a timing wheel level occupancy bitmap */
+#define SCHED_WHEEL_WORDS (SCHED_WHEEL_SIZE / 64)
+
 AST_THREADSTORAGE(last_del_id);
 
 /*!
@@ -78,19 +89,17 @@ struct sched {
 	/*! The ID that has been popped off the scheduler context's queue */
 	struct sched_id *sched_id;
 	struct timeval when;          /*!< Absolute time event should take place */
-	/*!
-	 * \brief Tie breaker in case the when is the same for multiple entries.
-	 *
-	 * \note The oldest expiring entry in the scheduler heap goes first.
-	 * This is possible when multiple events are scheduled to expire at
-	 * the same time by internal coding.
-	 */
-	unsigned int tie_breaker;
 	int resched;                  /*!< When to reschedule */
 	int variable;                 /*!< Use return value from callback to reschedule */
 	const void *data;             /*!< Data */
 	ast_sched_cb callback;        /*!< Callback */
 	ssize_t __heap_index;
+	/*! Timing wheel slot linkage */
+	AST_DLLIST_ENTRY(sched) wheel_list;
+	/*! Timing wheel level the entry is queued on */
+	unsigned char wheel_level;
+	/*! Timing wheel slot the entry is queued in */
+	unsigned char wheel_slot;
 	/*!
 	 * Used to synchronize between thread running a task and thread
 	 * attempting to delete a task
@@ -108,13 +117,41 @@ struct sched_thread {
 	unsigned int stop:1;
 };
 
+AST_DLLIST_HEAD_NOLOCK(sched_wheel_slot, sched);
+
+/*!
+ * \brief Hierarchical timing wheel
+ *
+ * Time is measured in one millisecond ticks.  Level 0 holds entries
+ * expiring within the next SCHED_WHEEL_SIZE ticks, one tick per slot.
+ * Each higher level covers SCHED_WHEEL_SIZE times the span of the
+ * level below it.  When the current tick reaches the start of a
+ * higher level slot its entries are cascaded down to lower levels.
+ * Tick arithmetic is modulo 2^32, which is comfortably larger than
+ * the longest interval ast_sched_add() accepts.
+ */
+struct sched_wheel {
+	/*! Time of tick 0 */
+	struct timeval base;
+	/*! Next tick to be processed */
+	unsigned int current;
+	/*! Number of entries on the wheel */
+	size_t count;
+	/*! Bitmap of the non-empty slots on each level */
+	uint64_t occupied[SCHED_WHEEL_LEVELS][SCHED_WHEEL_WORDS];
+	struct sched_wheel_slot slots[SCHED_WHEEL_LEVELS][SCHED_WHEEL_SIZE];
+};
+
 struct ast_sched_context {
 	ast_mutex_t lock;
 	unsigned int eventcnt;                  /*!< Number of events processed */
 	unsigned int highwater;					/*!< highest count so far */
-	/*! Next tie breaker in case events expire at the same time. */
-	unsigned int tie_breaker;
-	struct ast_heap *sched_heap;
+	/*! Entries expiring at the same time come off in the order they were added */
+	struct ast_timer_heap *sched_heap;
+	/*! Used instead of sched_heap by AST_SCHED_QUEUE_WHEEL contexts */
+	struct sched_wheel *sched_wheel;
+	/*! Queued tasks indexed by ID.  The executing task is not in the table. */
+	struct sched **id_table;
 	struct sched_thread *sched_thread;
 	/*! The scheduled task that is currently executing */
 	struct sched *currently_executing;
@@ -222,20 +259,293 @@ int ast_sched_start_thread(struct ast_sched_context *con)
 	return 0;
 }
 
-static int sched_time_cmp(void *va, void *vb)
+/*! \brief Convert an absolute time to a timing wheel tick */
+static unsigned int sched_wheel_tick(const struct sched_wheel *wheel, struct timeval tv)
+{
+	return (unsigned int) ((int64_t) (tv.tv_sec - wheel->base.tv_sec) * 1000 + tv.tv_usec / 1000);
+}
+
+static struct sched_wheel *sched_wheel_create(void)
+{
+	struct sched_wheel *wheel;
+
+	if (!(wheel = ast_calloc(1, sizeof(*wheel)))) {
+		return NULL;
+	}
+
+	wheel->base = ast_tv(ast_tvnow().tv_sec, 0);
+	wheel->current = sched_wheel_tick(wheel, ast_tvnow());
+
+	return wheel;
+}
+
+static void sched_wheel_insert(struct sched_wheel *wheel, struct sched *s)
 {
-	struct sched *a = va;
-	struct sched *b = vb;
-	int cmp;
+	unsigned int expires = sched_wheel_tick(wheel, s->when);
+	unsigned int delta;
+	int level;
 
-	cmp = ast_tvcmp(b->when, a->when);
-	if (!cmp) {
-		cmp = b->tie_breaker - a->tie_breaker;
+	if ((int) (expires - wheel->current) < 0) {
+		/* Already expired, run it on the next tick processed */
+		expires = wheel->current;
 	}
-	return cmp;
+	delta = expires - wheel->current;
+
+	for (level = 0; level < SCHED_WHEEL_LEVELS - 1; ++level) {
+		if (delta < (1U << ((level + 1) * SCHED_WHEEL_BITS))) {
+			break;
+		}
+	}
+
+	s->wheel_level = level;
+	s->wheel_slot = (expires >> (level * SCHED_WHEEL_BITS)) & SCHED_WHEEL_MASK;
+	AST_DLLIST_INSERT_TAIL(&wheel->slots[level][s->wheel_slot], s, wheel_list);
+	wheel->occupied[level][s->wheel_slot / 64] |= (uint64_t) 1 << (s->wheel_slot % 64);
+	++wheel->count;
 }
 
-struct ast_sched_context *ast_sched_context_create(void)
+static void sched_wheel_remove(struct sched_wheel *wheel, struct sched *s)
+{
+	struct sched_wheel_slot *slot = &wheel->slots[s->wheel_level][s->wheel_slot];
+
+	AST_DLLIST_REMOVE(slot, s, wheel_list);
+	if (AST_DLLIST_EMPTY(slot)) {
+		wheel->occupied[s->wheel_level][s->wheel_slot / 64] &= ~((uint64_t) 1 << (s->wheel_slot % 64));
+	}
+	--wheel->count;
+}
+
+/*!
+ * \internal
+ * \brief Find the first non-empty slot of a level at or after a slot
+ *
+ * \param occupied Occupancy bitmap of the level
+ * \param start Slot to start searching from, wrapping around the level
+ *
+ * \retval -1 if the level is empty
+ * \return the distance from start to the first non-empty slot
+ */
+static int sched_wheel_find(const uint64_t *occupied, unsigned int start)
+{
+	unsigned int word = start / 64;
+	uint64_t bits = occupied[word] & (~(uint64_t) 0 << (start % 64));
+	int i;
+
+	/* The start word is checked again in full after wrapping around */
+	for (i = 0; i <= SCHED_WHEEL_WORDS; ++i) {
+		if (bits) {
+			return (word * 64 + ffsll(bits) - 1 - start) & SCHED_WHEEL_MASK;
+		}
+		word = (word + 1) % SCHED_WHEEL_WORDS;
+		bits = occupied[word];
+	}
+
+	return -1;
+}
+
+/*!
+ * \internal
+ * \brief Find the next tick that needs processing
+ *
+ * This is either the expiration of the first entry on level 0 or
+ * the start of the first non-empty slot on a higher level, whichever
+ * comes first.
+ *
+ * \retval 0 if the wheel is empty
+ * \retval 1 if next was set
+ */
+static int sched_wheel_next(const struct sched_wheel *wheel, unsigned int *next)
+{
+	int found = 0;
+	int level;
+
+	for (level = 0; level < SCHED_WHEEL_LEVELS; ++level) {
+		unsigned int shift = level * SCHED_WHEEL_BITS;
+		unsigned int tick;
+		int distance;
+
+		if (!level) {
+			distance = sched_wheel_find(wheel->occupied[level], wheel->current & SCHED_WHEEL_MASK);
+			tick = wheel->current + distance;
+		} else {
+			/* The current slot of a higher level was cascaded on arrival */
+			distance = sched_wheel_find(wheel->occupied[level],
+				((wheel->current >> shift) + 1) & SCHED_WHEEL_MASK);
+			tick = ((wheel->current >> shift) + distance + 1) << shift;
+		}
+		if (distance < 0) {
+			continue;
+		}
+
+		if (!found || (int) (tick - *next) < 0) {
+			*next = tick;
+			found = 1;
+		}
+	}
+
+	return found;
+}
+
+/*!
+ * \internal
+ * \brief Move the wheel to a tick, cascading higher level slots that start at it
+ *
+ * \note Any slots skipped over must be empty.
+ */
+static void sched_wheel_advance(struct sched_wheel *wheel, unsigned int tick)
+{
+	int level;
+
+	wheel->current = tick;
+
+	for (level = 1; level < SCHED_WHEEL_LEVELS; ++level) {
+		unsigned int shift = level * SCHED_WHEEL_BITS;
+		struct sched_wheel_slot *slot;
+		struct sched *s;
+
+		if (tick & ((1U << shift) - 1)) {
+			break;
+		}
+
+		slot = &wheel->slots[level][(tick >> shift) & SCHED_WHEEL_MASK];
+		while ((s = AST_DLLIST_FIRST(slot))) {
+			sched_wheel_remove(wheel, s);
+			sched_wheel_insert(wheel, s);
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Remove the next entry expiring at or before a tick
+ *
+ * \retval NULL if no entries have expired
+ */
+static struct sched *sched_wheel_pop_expired(struct sched_wheel *wheel, unsigned int target)
+{
+	while ((int) (target - wheel->current) >= 0) {
+		struct sched *s;
+		unsigned int next;
+
+		s = AST_DLLIST_FIRST(&wheel->slots[0][wheel->current & SCHED_WHEEL_MASK]);
+		if (s) {
+			sched_wheel_remove(wheel, s);
+			return s;
+		}
+
+		if (!sched_wheel_next(wheel, &next) || (int) (next - target) > 0) {
+			sched_wheel_advance(wheel, target + 1);
+			break;
+		}
+		sched_wheel_advance(wheel, next);
+	}
+
+	return NULL;
+}
+
+/*! \brief Milliseconds until the wheel next needs processing, or -1 if empty */
+static int sched_wheel_wait(const struct sched_wheel *wheel)
+{
+	unsigned int next = wheel->current;
+	int ms;
+
+	if (!wheel->count) {
+		return -1;
+	}
+
+	if (AST_DLLIST_EMPTY(&wheel->slots[0][wheel->current & SCHED_WHEEL_MASK])) {
+		sched_wheel_next(wheel, &next);
+	}
+
+	ms = next - sched_wheel_tick(wheel, ast_tvnow());
+	return ms < 0 ? 0 : ms;
+}
+
+static size_t sched_queue_size(struct ast_sched_context *con)
+{
+	return con->sched_wheel ? con->sched_wheel->count : ast_timer_heap_size(con->sched_heap);
+}
+
+static void sched_queue_push(struct ast_sched_context *con, struct sched *s)
+{
+	if (con->sched_wheel) {
+		sched_wheel_insert(con->sched_wheel, s);
+	} else {
+		ast_timer_heap_push(con->sched_heap, s->when, s);
+	}
+	con->id_table[s->sched_id->id] = s;
+}
+
+/*!
+ * \internal
+ * \brief Remove a queued entry
+ *
+ * \retval 0 on success
+ * \retval -1 if the entry was not queued
+ */
+static int sched_queue_remove(struct ast_sched_context *con, struct sched *s)
+{
+	if (con->id_table[s->sched_id->id] != s) {
+		return -1;
+	}
+	con->id_table[s->sched_id->id] = NULL;
+
+	if (con->sched_wheel) {
+		sched_wheel_remove(con->sched_wheel, s);
+		return 0;
+	}
+	return ast_timer_heap_remove(con->sched_heap, s) ? 0 : -1;
+}
+
+/*!
+ * \internal
+ * \brief Remove the next queued entry expiring before a time
+ *
+ * \retval NULL if no entries expire before the time
+ */
+static struct sched *sched_queue_pop_expired(struct ast_sched_context *con, struct timeval when)
+{
+	struct sched *s;
+
+	if (con->sched_wheel) {
+		s = sched_wheel_pop_expired(con->sched_wheel, sched_wheel_tick(con->sched_wheel, when));
+	} else {
+		s = ast_timer_heap_pop_expired(con->sched_heap, when);
+	}
+
+	if (s) {
+		con->id_table[s->sched_id->id] = NULL;
+	}
+	return s;
+}
+
+/*! \brief Call a function on each queued entry.  The entries must not be removed. */
+static void sched_queue_traverse(struct ast_sched_context *con,
+	void (*cb)(struct sched *s, void *arg), void *arg)
+{
+	if (con->sched_wheel) {
+		int level;
+		int slot;
+		struct sched *s;
+
+		for (level = 0; level < SCHED_WHEEL_LEVELS; ++level) {
+			for (slot = 0; slot < SCHED_WHEEL_SIZE; ++slot) {
+				AST_DLLIST_TRAVERSE(&con->sched_wheel->slots[level][slot], s, wheel_list) {
+					cb(s, arg);
+				}
+			}
+		}
+	} else {
+		size_t heap_size = ast_timer_heap_size(con->sched_heap);
+		size_t x;
+
+		for (x = 1; x <= heap_size; x++) {
+			cb(ast_timer_heap_peek(con->sched_heap, x), arg);
+		}
+	}
+}
+
+struct ast_sched_context *ast_sched_context_create_with_queue(enum ast_sched_queue queue)
 {
 	struct ast_sched_context *tmp;
 
@@ -248,7 +558,12 @@ struct ast_sched_context *ast_sched_context_create(void)
 
 	AST_LIST_HEAD_INIT_NOLOCK(&tmp->id_queue);
 
-	if (!(tmp->sched_heap = ast_heap_create(8, sched_time_cmp,
+	if (queue == AST_SCHED_QUEUE_WHEEL) {
+		if (!(tmp->sched_wheel = sched_wheel_create())) {
+			ast_sched_context_destroy(tmp);
+			return NULL;
+		}
+	} else if (!(tmp->sched_heap = ast_timer_heap_create(256,
 			offsetof(struct sched, __heap_index)))) {
 		ast_sched_context_destroy(tmp);
 		return NULL;
@@ -257,6 +572,11 @@ struct ast_sched_context *ast_sched_context_create(void)
 	return tmp;
 }
 
+struct ast_sched_context *ast_sched_context_create(void)
+{
+	return ast_sched_context_create_with_queue(AST_SCHED_QUEUE_HEAP);
+}
+
 static void sched_free(struct sched *task)
 {
 	/* task->sched_id will be NULL most of the time, but when the
@@ -285,13 +605,30 @@ void ast_sched_context_destroy(struct ast_sched_context *con)
 #endif
 
 	if (con->sched_heap) {
-		while ((s = ast_heap_pop(con->sched_heap))) {
+		while ((s = ast_timer_heap_pop(con->sched_heap))) {
 			sched_free(s);
 		}
-		ast_heap_destroy(con->sched_heap);
+		ast_timer_heap_destroy(con->sched_heap);
 		con->sched_heap = NULL;
 	}
 
+	if (con->sched_wheel) {
+		int level;
+		int slot;
+
+		for (level = 0; level < SCHED_WHEEL_LEVELS; ++level) {
+			for (slot = 0; slot < SCHED_WHEEL_SIZE; ++slot) {
+				while ((s = AST_DLLIST_REMOVE_HEAD(&con->sched_wheel->slots[level][slot], wheel_list))) {
+					sched_free(s);
+				}
+			}
+		}
+		ast_free(con->sched_wheel);
+		con->sched_wheel = NULL;
+	}
+
+	ast_free(con->id_table);
+
 	while ((sid = AST_LIST_REMOVE_HEAD(&con->id_queue, list))) {
 		ast_free(sid);
 	}
@@ -314,6 +651,7 @@ static int add_ids(struct ast_sched_context *con)
 	int new_size;
 	int original_size;
 	int i;
+	struct sched **id_table;
 
 	original_size = con->id_queue_size;
 	/* So we don't go overboard with the mallocs here, we'll just up
@@ -325,6 +663,15 @@ static int add_ids(struct ast_sched_context *con)
 		/* Overflow. Cap it at INT_MAX. */
 		new_size = INT_MAX;
 	}
+
+	/* IDs start at 1 so the table has an unused slot 0 */
+	id_table = ast_realloc(con->id_table, ((size_t) new_size + 1) * sizeof(*id_table));
+	if (!id_table) {
+		return 0;
+	}
+	memset(id_table + original_size + 1, 0, (new_size - original_size) * sizeof(*id_table));
+	con->id_table = id_table;
+
 	for (i = original_size; i < new_size; ++i) {
 		struct sched_id *new_id;
 
@@ -412,13 +759,39 @@ void ast_sched_clean_by_callback(struct ast_sched_context *con, ast_sched_cb mat
 	struct sched *current;
 
 	ast_mutex_lock(&con->lock);
-	while ((current = ast_heap_peek(con->sched_heap, i))) {
+	if (con->sched_wheel) {
+		int level;
+
+		for (level = 0; level < SCHED_WHEEL_LEVELS; ++level) {
+			for (i = 0; i < SCHED_WHEEL_SIZE; ++i) {
+				current = AST_DLLIST_FIRST(&con->sched_wheel->slots[level][i]);
+				while (current) {
+					if (current->callback != match) {
+						current = AST_DLLIST_NEXT(current, wheel_list);
+						continue;
+					}
+
+					sched_queue_remove(con, current);
+
+					cleanup_cb(current->data);
+					sched_release(con, current);
+
+					/* The cleanup may have changed the slot so start over */
+					current = AST_DLLIST_FIRST(&con->sched_wheel->slots[level][i]);
+				}
+			}
+		}
+		ast_mutex_unlock(&con->lock);
+		return;
+	}
+
+	while ((current = ast_timer_heap_peek(con->sched_heap, i))) {
 		if (current->callback != match) {
 			i++;
 			continue;
 		}
 
-		ast_heap_remove(con->sched_heap, current);
+		sched_queue_remove(con, current);
 
 		cleanup_cb(current->data);
 		sched_release(con, current);
@@ -437,8 +810,15 @@ int ast_sched_wait(struct ast_sched_context *con)
 
 	DEBUG(ast_debug(1, "ast_sched_wait()\n"));
 
+	if (!con) {
+		/* A context that was never created has nothing scheduled */
+		return -1;
+	}
+
 	ast_mutex_lock(&con->lock);
-	if ((s = ast_heap_peek(con->sched_heap, 1))) {
+	if (con->sched_wheel) {
+		ms = sched_wheel_wait(con->sched_wheel);
+	} else if ((s = ast_timer_heap_peek(con->sched_heap, 1))) {
 		ms = ast_tvdiff_ms(s->when, ast_tvnow());
 		if (ms < 0) {
 			ms = 0;
@@ -461,26 +841,14 @@ static void schedule(struct ast_sched_context *con, struct sched *s)
 {
 	size_t size;
 
-	size = ast_heap_size(con->sched_heap);
+	size = sched_queue_size(con);
 
 	/* Record the largest the scheduler heap became for reporting purposes. */
 	if (con->highwater <= size) {
 		con->highwater = size + 1;
 	}
 
-	/* Determine the tie breaker value for the new entry. */
-	if (size) {
-		++con->tie_breaker;
-	} else {
-		/*
-		 * Restart the sequence for the first entry to make integer
-		 * roll over more unlikely.
-		 */
-		con->tie_breaker = 0;
-	}
-	s->tie_breaker = con->tie_breaker;
-
-	ast_heap_push(con->sched_heap, s);
+	sched_queue_push(con, s);
 }
 
 /*! \brief
@@ -571,19 +939,11 @@ int ast_sched_add(struct ast_sched_context *con, int when, ast_sched_cb callback
 
 static struct sched *sched_find(struct ast_sched_context *con, int id)
 {
-	int x;
-	size_t heap_size;
-
-	heap_size = ast_heap_size(con->sched_heap);
-	for (x = 1; x <= heap_size; x++) {
-		struct sched *cur = ast_heap_peek(con->sched_heap, x);
-
-		if (cur->sched_id->id == id) {
-			return cur;
-		}
+	if (id <= 0 || id > con->id_queue_size) {
+		return NULL;
 	}
 
-	return NULL;
+	return con->id_table[id];
 }
 
 const void *ast_sched_find_data(struct ast_sched_context *con, int id)
@@ -640,7 +1000,7 @@ int ast_sched_del_nonrunning(struct ast_sched_context *con, int id)
 
 	s = sched_find(con, id);
 	if (s) {
-		if (!ast_heap_remove(con->sched_heap, s)) {
+		if (sched_queue_remove(con, s)) {
 			ast_log(LOG_WARNING,"sched entry %d not in the sched heap?\n", s->sched_id->id);
 		}
 		sched_release(con, s);
@@ -702,34 +1062,39 @@ int ast_sched_del_nonrunning(struct ast_sched_context *con, int id)
 	return res;
 }
 
+struct sched_report_data {
+	struct ast_cb_names *cbnames;
+	int *countlist;
+};
+
+static void sched_report_cb(struct sched *cur, void *arg)
+{
+	struct sched_report_data *data = arg;
+	int i;
+
+	/* match the callback to the cblist */
+	for (i = 0; i < data->cbnames->numassocs; i++) {
+		if (cur->callback == data->cbnames->cblist[i]) {
+			break;
+		}
+	}
+	data->countlist[i]++;
+}
+
 void ast_sched_report(struct ast_sched_context *con, struct ast_str **buf, struct ast_cb_names *cbnames)
 {
-	int i, x;
-	struct sched *cur;
+	int i;
 	int countlist[cbnames->numassocs + 1];
-	size_t heap_size;
+	struct sched_report_data data = {
+		.cbnames = cbnames,
+		.countlist = countlist,
+	};
 
 	memset(countlist, 0, sizeof(countlist));
-	ast_str_set(buf, 0, " Highwater = %u\n schedcnt = %zu\n", con->highwater, ast_heap_size(con->sched_heap));
+	ast_str_set(buf, 0, " Highwater = %u\n schedcnt = %zu\n", con->highwater, sched_queue_size(con));
 
 	ast_mutex_lock(&con->lock);
-
-	heap_size = ast_heap_size(con->sched_heap);
-	for (x = 1; x <= heap_size; x++) {
-		cur = ast_heap_peek(con->sched_heap, x);
-		/* match the callback to the cblist */
-		for (i = 0; i < cbnames->numassocs; i++) {
-			if (cur->callback == cbnames->cblist[i]) {
-				break;
-			}
-		}
-		if (i < cbnames->numassocs) {
-			countlist[i]++;
-		} else {
-			countlist[cbnames->numassocs]++;
-		}
-	}
-
+	sched_queue_traverse(con, sched_report_cb, &data);
 	ast_mutex_unlock(&con->lock);
 
 	for (i = 0; i < cbnames->numassocs; i++) {
@@ -739,13 +1104,24 @@ void ast_sched_report(struct ast_sched_context *con, struct ast_str **buf, struc
 	ast_str_append(buf, 0, "   <unknown> : %d\n", countlist[cbnames->numassocs]);
 }
 
+static void sched_dump_cb(struct sched *q, void *arg)
+{
+	const struct timeval *when = arg;
+	struct timeval delta;
+
+	delta = ast_tvsub(q->when, *when);
+	ast_log(LOG_DEBUG, "|%.4d | %-15p | %-15p | %.6ld : %.6ld |\n",
+		q->sched_id->id,
+		q->callback,
+		q->data,
+		(long)delta.tv_sec,
+		(long int)delta.tv_usec);
+}
+
 /*! \brief Dump the contents of the scheduler to LOG_DEBUG */
 void ast_sched_dump(struct ast_sched_context *con)
 {
-	struct sched *q;
 	struct timeval when;
-	int x;
-	size_t heap_size;
 
 	if (!DEBUG_ATLEAST(1)) {
 		return;
@@ -754,28 +1130,17 @@ void ast_sched_dump(struct ast_sched_context *con)
 	when = ast_tvnow();
 #ifdef SCHED_MAX_CACHE
 	ast_log(LOG_DEBUG, "Asterisk Schedule Dump (%zu in Q, %u Total, %u Cache, %u high-water)\n",
-		ast_heap_size(con->sched_heap), con->eventcnt - 1, con->schedccnt, con->highwater);
+		sched_queue_size(con), con->eventcnt - 1, con->schedccnt, con->highwater);
 #else
 	ast_log(LOG_DEBUG, "Asterisk Schedule Dump (%zu in Q, %u Total, %u high-water)\n",
-		ast_heap_size(con->sched_heap), con->eventcnt - 1, con->highwater);
+		sched_queue_size(con), con->eventcnt - 1, con->highwater);
 #endif
 
 	ast_log(LOG_DEBUG, "=============================================================\n");
 	ast_log(LOG_DEBUG, "|ID    Callback          Data              Time  (sec:ms)   |\n");
 	ast_log(LOG_DEBUG, "+-----+-----------------+-----------------+-----------------+\n");
 	ast_mutex_lock(&con->lock);
-	heap_size = ast_heap_size(con->sched_heap);
-	for (x = 1; x <= heap_size; x++) {
-		struct timeval delta;
-		q = ast_heap_peek(con->sched_heap, x);
-		delta = ast_tvsub(q->when, when);
-		ast_log(LOG_DEBUG, "|%.4d | %-15p | %-15p | %.6ld : %.6ld |\n",
-			q->sched_id->id,
-			q->callback,
-			q->data,
-			(long)delta.tv_sec,
-			(long int)delta.tv_usec);
-	}
+	sched_queue_traverse(con, sched_dump_cb, &when);
 	ast_mutex_unlock(&con->lock);
 	ast_log(LOG_DEBUG, "=============================================================\n");
 }
@@ -792,20 +1157,19 @@ int ast_sched_runq(struct ast_sched_context *con)
 
 	DEBUG(ast_debug(1, "ast_sched_runq()\n"));
 
+	if (!con) {
+		return 0;
+	}
+
 	ast_mutex_lock(&con->lock);
 
 	when = ast_tvadd(ast_tvnow(), ast_tv(0, 1000));
-	for (numevents = 0; (current = ast_heap_peek(con->sched_heap, 1)); numevents++) {
-		/* schedule all events which are going to expire within 1ms.
-		 * We only care about millisecond accuracy anyway, so this will
-		 * help us get more than one event at one time if they are very
-		 * close together.
-		 */
-		if (ast_tvcmp(current->when, when) != -1) {
-			break;
-		}
-
-		current = ast_heap_pop(con->sched_heap);
+	/* schedule all events which are going to expire within 1ms.
+	 * We only care about millisecond accuracy anyway, so this will
+	 * help us get more than one event at one time if they are very
+	 * close together.
+	 */
+	for (numevents = 0; (current = sched_queue_pop_expired(con, when)); numevents++) {
 
 		/*
 		 * At this point, the schedule queue is still intact.  We
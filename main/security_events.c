@@ -358,6 +358,34 @@
 			</syntax>
 		</managerEventInstance>
 	</managerEvent>
+	<managerEvent language="en_US" name="SecurityEventSummary">
+		<managerEventInstance class="EVENT_FLAG_SECURITY">
+			<synopsis>Raised when a window of security events from one address closes with some of them not raised.</synopsis>
+			<syntax>
+				<parameter name="SecurityEvent">
+					<para>The name of the security event, such as InvalidAccountID.</para>
+				</parameter>
+				<xi:include xpointer="xpointer(/docs/managerEvent[@name='FailedACL']/managerEventInstance/syntax/parameter[@name='Service'])" />
+				<parameter name="RemoteAddress">
+					<para>The remote address the events came from, without the transport or port.</para>
+				</parameter>
+				<parameter name="Count">
+					<para>How many of the events happened in the window.</para>
+				</parameter>
+				<parameter name="Suppressed">
+					<para>How many of the events were not raised.</para>
+				</parameter>
+				<parameter name="Window">
+					<para>The length of the window in seconds.</para>
+				</parameter>
+			</syntax>
+			<description>
+				<para>Security events are only aggregated when
+				<literal>security_event_window</literal> is set in
+				<filename>asterisk.conf</filename>.</para>
+			</description>
+		</managerEventInstance>
+	</managerEvent>
  ***/
 
 #include "asterisk.h"
@@ -371,6 +399,8 @@
 #include "asterisk/stasis.h"
 #include "asterisk/json.h"
 #include "asterisk/astobj2.h"
+#include "asterisk/options.h"
+#include "asterisk/sched.h"
 
 static const size_t SECURITY_EVENT_BUF_INIT_LEN = 256;
 
@@ -467,17 +497,263 @@ static struct ast_manager_event_blob *security_event_to_ami(struct stasis_messag
 	return security_event_to_ami_blob(payload->json);
 }
 
+static struct ast_manager_event_blob *security_event_summary_to_ami(struct stasis_message *message)
+{
+	struct ast_json_payload *payload = stasis_message_data(message);
+	struct ast_json *json;
+
+	if (!payload) {
+		return NULL;
+	}
+	json = payload->json;
+
+	return ast_manager_event_blob_create(EVENT_FLAG_SECURITY, "SecurityEventSummary",
+		"SecurityEvent: %s\r\n"
+		"Service: %s\r\n"
+		"RemoteAddress: %s\r\n"
+		"Count: %jd\r\n"
+		"Suppressed: %jd\r\n"
+		"Window: %jd\r\n",
+		ast_json_string_get(ast_json_object_get(json, "SecurityEvent")),
+		ast_json_string_get(ast_json_object_get(json, "Service")),
+		ast_json_string_get(ast_json_object_get(json, "RemoteAddress")),
+		ast_json_integer_get(ast_json_object_get(json, "Count")),
+		ast_json_integer_get(ast_json_object_get(json, "Suppressed")),
+		ast_json_integer_get(ast_json_object_get(json, "Window")));
+}
+
 /*! \brief Message type for security events */
 STASIS_MESSAGE_TYPE_DEFN(ast_security_event_type,
 	.to_ami = security_event_to_ami,
 	);
 
+/*! \brief Message type for summaries of aggregated security events */
+STASIS_MESSAGE_TYPE_DEFN(ast_security_event_summary_type,
+	.to_ami = security_event_summary_to_ami,
+	);
+
+/*!
+ * \brief The events of one type from one remote address
+ *
+ * Created when such an event is reported, which is published at once.
+ * Until the window of ast_option_security_event_window seconds closes,
+ * only every ast_option_security_event_sample'th later event is
+ * published, and the rest are counted.  When the window closes with any
+ * counted a summary of them is published.  The window then opens again,
+ * and the source is forgotten once a window closes with no events.
+ */
+struct security_event_source {
+	/*! The address the events came from, the port is ignored */
+	struct ast_sockaddr addr;
+	enum ast_security_event_type event_type;
+	/*! How many events happened in this window */
+	unsigned int count;
+	/*! How many of them were not published */
+	unsigned int suppressed;
+	/*! The service of the first event */
+	char service[0];
+};
+
+/*! \brief What a \ref security_event_source is searched by */
+struct security_event_source_key {
+	const struct ast_sockaddr *addr;
+	enum ast_security_event_type event_type;
+};
+
+#define SECURITY_EVENT_SOURCE_BUCKETS 257
+static struct ao2_container *security_event_sources;
+static struct ast_sched_context *security_sched;
+
+static int security_event_source_hash_fn(const void *obj, const int flags)
+{
+	const struct security_event_source *source;
+	const struct security_event_source_key *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		return ast_sockaddr_hash(key->addr) + key->event_type;
+	case OBJ_SEARCH_OBJECT:
+		source = obj;
+		return ast_sockaddr_hash(&source->addr) + source->event_type;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+}
+
+static int security_event_source_cmp_fn(void *obj, void *arg, int flags)
+{
+	const struct security_event_source *source = obj;
+	const struct security_event_source *right;
+	const struct security_event_source_key *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = arg;
+		if (source->event_type == key->event_type
+			&& !ast_sockaddr_cmp_addr(&source->addr, key->addr)) {
+			return CMP_MATCH;
+		}
+		return 0;
+	case OBJ_SEARCH_OBJECT:
+		right = arg;
+		if (source->event_type == right->event_type
+			&& !ast_sockaddr_cmp_addr(&source->addr, &right->addr)) {
+			return CMP_MATCH;
+		}
+		return 0;
+	default:
+		return 0;
+	}
+}
+
+static void security_event_summary_publish(const struct security_event_source *source,
+	unsigned int count, unsigned int suppressed)
+{
+	struct ast_json *json;
+	struct ast_json_payload *payload;
+	struct stasis_message *msg;
+
+	json = ast_json_pack("{s: s, s: s, s: s, s: i, s: i, s: i}",
+		"SecurityEvent", ast_security_event_get_name(source->event_type),
+		"Service", source->service,
+		"RemoteAddress", ast_sockaddr_stringify_addr(&source->addr),
+		"Count", (ast_json_int_t) count,
+		"Suppressed", (ast_json_int_t) suppressed,
+		"Window", (ast_json_int_t) ast_option_security_event_window);
+	if (!json) {
+		return;
+	}
+
+	payload = ast_json_payload_create(json);
+	ast_json_unref(json);
+	if (!payload) {
+		return;
+	}
+
+	msg = stasis_message_create(ast_security_event_summary_type(), payload);
+	ao2_ref(payload, -1);
+	if (!msg) {
+		return;
+	}
+
+	stasis_publish(ast_security_topic(), msg);
+	ao2_ref(msg, -1);
+}
+
+/*!
+ * \internal
+ * \brief Publish the summary of a source when its window closes
+ *
+ * \retval non-zero to open another window
+ */
+static int security_event_window_closed(const void *data)
+{
+	struct security_event_source *source = (struct security_event_source *) data;
+	unsigned int count;
+	unsigned int suppressed;
+
+	ao2_lock(security_event_sources);
+	count = source->count;
+	suppressed = source->suppressed;
+	source->count = 0;
+	source->suppressed = 0;
+	if (!count) {
+		ao2_unlink_flags(security_event_sources, source, OBJ_NOLOCK);
+		ao2_unlock(security_event_sources);
+		/* The reference held by the scheduler */
+		ao2_ref(source, -1);
+		return 0;
+	}
+	ao2_unlock(security_event_sources);
+
+	if (suppressed) {
+		security_event_summary_publish(source, count, suppressed);
+	}
+
+	return 1;
+}
+
+static int security_event_window_cleanup(const void *data)
+{
+	ao2_ref((void *) data, -1);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Count an event against the window of its source
+ *
+ * \retval non-zero if the event is to be published
+ */
+static int security_event_sample(const struct ast_security_event_common *sec)
+{
+	struct security_event_source_key key = {
+		.addr = sec->remote_addr.addr,
+		.event_type = sec->event_type,
+	};
+	struct security_event_source *source;
+	int publish;
+
+	if (!security_sched || !key.addr
+		|| (!ast_sockaddr_is_ipv4(key.addr) && !ast_sockaddr_is_ipv6(key.addr))) {
+		return 1;
+	}
+
+	ao2_lock(security_event_sources);
+	source = ao2_find(security_event_sources, &key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (source) {
+		/* The first event of a window and every sample'th after it are published */
+		publish = !source->count++ || (ast_option_security_event_sample
+			&& !((source->count - 1) % ast_option_security_event_sample));
+		if (!publish) {
+			source->suppressed++;
+		}
+		ao2_unlock(security_event_sources);
+		ao2_ref(source, -1);
+		return publish;
+	}
+
+	source = ao2_alloc_options(sizeof(*source) + strlen(S_OR(sec->service, "")) + 1, NULL,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!source) {
+		ao2_unlock(security_event_sources);
+		return 1;
+	}
+	ast_sockaddr_copy(&source->addr, key.addr);
+	source->event_type = sec->event_type;
+	source->count = 1;
+	strcpy(source->service, S_OR(sec->service, "")); /* Safe */
+
+	if (ast_sched_add(security_sched, ast_option_security_event_window * 1000,
+			security_event_window_closed, ao2_bump(source)) < 0) {
+		ao2_ref(source, -1);
+	} else {
+		ao2_link_flags(security_event_sources, source, OBJ_NOLOCK);
+	}
+	ao2_unlock(security_event_sources);
+	ao2_ref(source, -1);
+
+	return 1;
+}
+
 static void security_stasis_cleanup(void)
 {
+	if (security_sched) {
+		ast_sched_clean_by_callback(security_sched, security_event_window_closed,
+			security_event_window_cleanup);
+		ast_sched_context_destroy(security_sched);
+		security_sched = NULL;
+	}
+	ao2_cleanup(security_event_sources);
+	security_event_sources = NULL;
+
 	ao2_cleanup(security_topic);
 	security_topic = NULL;
 
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_security_event_type);
+	STASIS_MESSAGE_TYPE_CLEANUP(ast_security_event_summary_type);
 }
 
 int ast_security_stasis_init(void)
@@ -493,6 +769,22 @@ int ast_security_stasis_init(void)
 		return -1;
 	}
 
+	if (STASIS_MESSAGE_TYPE_INIT(ast_security_event_summary_type)) {
+		return -1;
+	}
+
+	if (ast_option_security_event_window) {
+		security_event_sources = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+			SECURITY_EVENT_SOURCE_BUCKETS, security_event_source_hash_fn, NULL,
+			security_event_source_cmp_fn);
+		if (!security_event_sources) {
+			return -1;
+		}
+		security_sched = ast_sched_context_create();
+		if (!security_sched || ast_sched_start_thread(security_sched)) {
+			return -1;
+		}
+	}
 
 	return 0;
 }
@@ -1187,6 +1479,10 @@ int ast_security_event_report(const struct ast_security_event_common *sec)
 		return -1;
 	}
 
+	if (!security_event_sample(sec)) {
+		return 0;
+	}
+
 	if (handle_security_event(sec)) {
 		ast_log(LOG_ERROR, "Failed to issue security event of type %s.\n",
 				ast_security_event_get_name(sec->event_type));
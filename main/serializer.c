@@ -153,6 +153,24 @@ struct ast_taskprocessor *ast_serializer_pool_get(struct ast_serializer_pool *po
 	return res;
 }
 
+struct ast_taskprocessor *ast_serializer_pool_get_by_hash(struct ast_serializer_pool *pool,
+	unsigned int hash)
+{
+	struct ast_taskprocessor *res = NULL;
+
+	if (!pool) {
+		return NULL;
+	}
+
+	AST_VECTOR_RW_RDLOCK(&pool->serializers);
+	if (AST_VECTOR_SIZE(&pool->serializers)) {
+		res = AST_VECTOR_GET(&pool->serializers, hash % AST_VECTOR_SIZE(&pool->serializers));
+	}
+	AST_VECTOR_RW_UNLOCK(&pool->serializers);
+
+	return res;
+}
+
 int ast_serializer_pool_set_alerts(struct ast_serializer_pool *pool, long high, long low)
 {
 	size_t idx;
@@ -0,0 +1,192 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Signed linear buffer mixing
+ *
+ * Vector implementations of the saturating signed linear add and
+ * subtract operations used when mixing audio.  The best implementation
+ * the CPU supports is selected at startup, falling back to the scalar
+ * ast_slinear_saturated_add() and ast_slinear_saturated_subtract().
+ *
+ * The vector instructions saturate each sample pair the same way the
+ * scalar helpers do, so every implementation produces identical output.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+/* Needed for the intrinsics headers */
+#define ASTMM_LIBC ASTMM_IGNORE
+#include "asterisk.h"
+
+#include "asterisk/_private.h"
+#include "asterisk/utils.h"
+#include "asterisk/logger.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SLINEAR_MIX_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SLINEAR_MIX_NEON
+#include <arm_neon.h>
+#endif
+
+typedef void (*slinear_mix_fn)(short *input, const short *value, size_t samples);
+
+static void slinear_add_scalar(short *input, const short *value, size_t samples)
+{
+	size_t i;
+
+	for (i = 0; i < samples; ++i) {
+		ast_slinear_saturated_add(&input[i], (short *) &value[i]);
+	}
+}
+
+static void slinear_subtract_scalar(short *input, const short *value, size_t samples)
+{
+	size_t i;
+
+	for (i = 0; i < samples; ++i) {
+		ast_slinear_saturated_subtract(&input[i], (short *) &value[i]);
+	}
+}
+
+#ifdef SLINEAR_MIX_X86
+__attribute__((target("sse2")))
+static void slinear_add_sse2(short *input, const short *value, size_t samples)
+{
+	size_t i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (input + i));
+		__m128i b = _mm_loadu_si128((const __m128i *) (value + i));
+
+		_mm_storeu_si128((__m128i *) (input + i), _mm_adds_epi16(a, b));
+	}
+	slinear_add_scalar(input + i, value + i, samples - i);
+}
+
+__attribute__((target("sse2")))
+static void slinear_subtract_sse2(short *input, const short *value, size_t samples)
+{
+	size_t i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (input + i));
+		__m128i b = _mm_loadu_si128((const __m128i *) (value + i));
+
+		_mm_storeu_si128((__m128i *) (input + i), _mm_subs_epi16(a, b));
+	}
+	slinear_subtract_scalar(input + i, value + i, samples - i);
+}
+
+__attribute__((target("avx2")))
+static void slinear_add_avx2(short *input, const short *value, size_t samples)
+{
+	size_t i;
+
+	for (i = 0; i + 16 <= samples; i += 16) {
+		__m256i a = _mm256_loadu_si256((const __m256i *) (input + i));
+		__m256i b = _mm256_loadu_si256((const __m256i *) (value + i));
+
+		_mm256_storeu_si256((__m256i *) (input + i), _mm256_adds_epi16(a, b));
+	}
+	slinear_add_sse2(input + i, value + i, samples - i);
+}
+
+__attribute__((target("avx2")))
+static void slinear_subtract_avx2(short *input, const short *value, size_t samples)
+{
+	size_t i;
+
+	for (i = 0; i + 16 <= samples; i += 16) {
+		__m256i a = _mm256_loadu_si256((const __m256i *) (input + i));
+		__m256i b = _mm256_loadu_si256((const __m256i *) (value + i));
+
+		_mm256_storeu_si256((__m256i *) (input + i), _mm256_subs_epi16(a, b));
+	}
+	slinear_subtract_sse2(input + i, value + i, samples - i);
+}
+#endif
+
+#ifdef SLINEAR_MIX_NEON
+static void slinear_add_neon(short *input, const short *value, size_t samples)
+{
+	size_t i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		vst1q_s16(input + i, vqaddq_s16(vld1q_s16(input + i), vld1q_s16(value + i)));
+	}
+	slinear_add_scalar(input + i, value + i, samples - i);
+}
+
+static void slinear_subtract_neon(short *input, const short *value, size_t samples)
+{
+	size_t i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		vst1q_s16(input + i, vqsubq_s16(vld1q_s16(input + i), vld1q_s16(value + i)));
+	}
+	slinear_subtract_scalar(input + i, value + i, samples - i);
+}
+#endif
+
+/*! Name of the selected implementation */
+static const char *slinear_mix_name = "scalar";
+static slinear_mix_fn slinear_add = slinear_add_scalar;
+static slinear_mix_fn slinear_subtract = slinear_subtract_scalar;
+
+void ast_slinear_saturated_add_buf(short *input, const short *value, size_t samples)
+{
+	slinear_add(input, value, samples);
+}
+
+void ast_slinear_saturated_subtract_buf(short *input, const short *value, size_t samples)
+{
+	slinear_subtract(input, value, samples);
+}
+
+const char *ast_slinear_mix_implementation(void)
+{
+	return slinear_mix_name;
+}
+
+int ast_slinear_init(void)
+{
+#ifdef SLINEAR_MIX_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		slinear_mix_name = "avx2";
+		slinear_add = slinear_add_avx2;
+		slinear_subtract = slinear_subtract_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		slinear_mix_name = "sse2";
+		slinear_add = slinear_add_sse2;
+		slinear_subtract = slinear_subtract_sse2;
+	}
+#elif defined(SLINEAR_MIX_NEON)
+	slinear_mix_name = "neon";
+	slinear_add = slinear_add_neon;
+	slinear_subtract = slinear_subtract_neon;
+#endif
+
+	ast_debug(1, "Using %s signed linear mixing\n", slinear_mix_name);
+
+	return 0;
+}
@@ -39,14 +39,12 @@
 void ast_slinfactory_init(struct ast_slinfactory *sf)
 {
 	memset(sf, 0, sizeof(*sf));
-	sf->offset = sf->hold;
 	sf->output_format = ao2_bump(ast_format_slin);
 }
 
 int ast_slinfactory_init_with_format(struct ast_slinfactory *sf, struct ast_format *slin_out)
 {
 	memset(sf, 0, sizeof(*sf));
-	sf->offset = sf->hold;
 	if (!ast_format_cache_is_slinear(slin_out)) {
 		return -1;
 	}
@@ -57,16 +55,16 @@ int ast_slinfactory_init_with_format(struct ast_slinfactory *sf, struct ast_form
 
 void ast_slinfactory_destroy(struct ast_slinfactory *sf)
 {
-	struct ast_frame *f;
-
 	if (sf->trans) {
 		ast_translator_free_path(sf->trans);
 		sf->trans = NULL;
 	}
 
-	while ((f = AST_LIST_REMOVE_HEAD(&sf->queue, frame_list))) {
-		ast_frfree(f);
-	}
+	ao2_cleanup(sf->ring);
+	sf->ring = NULL;
+	sf->ring_size = 0;
+	sf->head = 0;
+	sf->size = 0;
 
 	ao2_cleanup(sf->output_format);
 	sf->output_format = NULL;
@@ -74,10 +72,76 @@ void ast_slinfactory_destroy(struct ast_slinfactory *sf)
 	sf->format = NULL;
 }
 
+/*!
+ * \internal
+ * \brief Make room in the ring for the given number of samples more
+ *
+ * Frames read from the factory may still be using the ring, in which case
+ * the audio is moved to a new one rather than the ring being written to.
+ */
+static int slinfactory_ring_reserve(struct ast_slinfactory *sf, size_t samples)
+{
+	size_t needed = sf->size + samples;
+	size_t new_size;
+	short *ring;
+	size_t first;
+
+	if (needed <= sf->ring_size && ao2_ref(sf->ring, 0) == 1) {
+		return 0;
+	}
+
+	for (new_size = MAX(sf->ring_size, AST_SLINFACTORY_MIN_RING); new_size < needed; new_size *= 2) {
+	}
+
+	if (!(ring = ao2_alloc_options(new_size * sizeof(*ring), NULL, AO2_ALLOC_OPT_LOCK_NOLOCK))) {
+		return -1;
+	}
+
+	/* Straighten out the audio at the start of the new ring */
+	first = MIN(sf->size, sf->ring_size - sf->head);
+	if (first) {
+		memcpy(ring, sf->ring + sf->head, first * sizeof(*ring));
+	}
+	if (sf->size > first) {
+		memcpy(ring + first, sf->ring, (sf->size - first) * sizeof(*ring));
+	}
+
+	ao2_cleanup(sf->ring);
+	sf->ring = ring;
+	sf->ring_size = new_size;
+	sf->head = 0;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Copy the audio of a signed linear frame into the ring
+ */
+static void slinfactory_ring_write(struct ast_slinfactory *sf, const struct ast_frame *f)
+{
+	const short *data = f->data.ptr;
+	size_t samples = f->samples;
+	size_t tail;
+	size_t first;
+
+	if (!data || !samples || slinfactory_ring_reserve(sf, samples)) {
+		return;
+	}
+
+	tail = (sf->head + sf->size) & (sf->ring_size - 1);
+	first = MIN(samples, sf->ring_size - tail);
+	memcpy(sf->ring + tail, data, first * sizeof(*data));
+	if (samples > first) {
+		memcpy(sf->ring, data + first, (samples - first) * sizeof(*data));
+	}
+	sf->size += samples;
+}
+
 int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f)
 {
-	struct ast_frame *begin_frame = f, *duped_frame = NULL, *frame_ptr;
-	unsigned int x = 0;
+	struct ast_frame *begin_frame = f, *frame_ptr;
+	unsigned int x = sf->size;
 
 	/* In some cases, we can be passed a frame which has no data in it, but
 	 * which has a positive number of samples defined. Once such situation is
@@ -110,33 +174,20 @@ int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f)
 		if (!(begin_frame = ast_translate(sf->trans, f, 0))) {
 			return 0;
 		}
-
-		if (!(duped_frame = ast_frisolate(begin_frame))) {
-			return 0;
-		}
-
-		if (duped_frame != begin_frame) {
-			ast_frfree(begin_frame);
-		}
-	} else {
-		if (sf->trans) {
-			ast_translator_free_path(sf->trans);
-			sf->trans = NULL;
-		}
-		if (!(duped_frame = ast_frdup(f)))
-			return 0;
-	}
-
-	AST_LIST_TRAVERSE(&sf->queue, frame_ptr, frame_list) {
-		x++;
+	} else if (sf->trans) {
+		ast_translator_free_path(sf->trans);
+		sf->trans = NULL;
 	}
 
 	/* if the frame was translated, the translator may have returned multiple
 	   frames, so process each of them
 	*/
-	for (begin_frame = duped_frame; begin_frame; begin_frame = AST_LIST_NEXT(begin_frame, frame_list)) {
-		AST_LIST_INSERT_TAIL(&sf->queue, begin_frame, frame_list);
-		sf->size += begin_frame->samples;
+	for (frame_ptr = begin_frame; frame_ptr; frame_ptr = AST_LIST_NEXT(frame_ptr, frame_list)) {
+		slinfactory_ring_write(sf, frame_ptr);
+	}
+
+	if (begin_frame != f) {
+		ast_frfree(begin_frame);
 	}
 
 	return x;
@@ -144,58 +195,61 @@ int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f)
 
 int ast_slinfactory_read(struct ast_slinfactory *sf, short *buf, size_t samples)
 {
-	struct ast_frame *frame_ptr;
-	unsigned int sofar = 0, ineed, remain;
-	short *frame_data, *offset = buf;
-
-	while (sofar < samples) {
-		ineed = samples - sofar;
-
-		if (sf->holdlen) {
-			if (sf->holdlen <= ineed) {
-				memcpy(offset, sf->offset, sf->holdlen * sizeof(*offset));
-				sofar += sf->holdlen;
-				offset += sf->holdlen;
-				sf->holdlen = 0;
-				sf->offset = sf->hold;
-			} else {
-				remain = sf->holdlen - ineed;
-				memcpy(offset, sf->offset, ineed * sizeof(*offset));
-				sofar += ineed;
-				sf->offset += ineed;
-				sf->holdlen = remain;
-			}
-			continue;
-		}
+	size_t sofar = MIN(samples, sf->size);
+	size_t first;
 
-		if ((frame_ptr = AST_LIST_REMOVE_HEAD(&sf->queue, frame_list))) {
-			frame_data = frame_ptr->data.ptr;
-
-			if (frame_ptr->samples <= ineed) {
-				memcpy(offset, frame_data, frame_ptr->samples * sizeof(*offset));
-				sofar += frame_ptr->samples;
-				offset += frame_ptr->samples;
-			} else {
-				remain = frame_ptr->samples - ineed;
-				memcpy(offset, frame_data, ineed * sizeof(*offset));
-				sofar += ineed;
-				frame_data += ineed;
-				if (remain > (AST_SLINFACTORY_MAX_HOLD - sf->holdlen)) {
-					remain = AST_SLINFACTORY_MAX_HOLD - sf->holdlen;
-				}
-				memcpy(sf->hold, frame_data, remain * sizeof(*offset));
-				sf->holdlen = remain;
-			}
-			ast_frfree(frame_ptr);
-		} else {
-			break;
-		}
+	if (!sofar) {
+		return 0;
+	}
+
+	first = MIN(sofar, sf->ring_size - sf->head);
+	memcpy(buf, sf->ring + sf->head, first * sizeof(*buf));
+	if (sofar > first) {
+		memcpy(buf + first, sf->ring, (sofar - first) * sizeof(*buf));
 	}
 
+	sf->head = (sf->head + sofar) & (sf->ring_size - 1);
 	sf->size -= sofar;
 	return sofar;
 }
 
+struct ast_frame *ast_slinfactory_read_frame(struct ast_slinfactory *sf, size_t samples)
+{
+	struct ast_frame frame = {
+		.frametype = AST_FRAME_VOICE,
+		.subclass.format = sf->output_format,
+		.datalen = samples * sizeof(short),
+		.samples = samples,
+	};
+	struct ast_frame *out;
+
+	if (!samples || sf->size < samples) {
+		return NULL;
+	}
+
+	if (sf->ring_size - sf->head < samples) {
+		/* The audio wraps around the end of the ring, so it has to be copied */
+		short buf[samples];
+
+		ast_slinfactory_read(sf, buf, samples);
+		frame.data.ptr = buf;
+		return ast_frdup(&frame);
+	}
+
+	/* The frame shares the ring, whatever is in front of the audio in it included */
+	frame.data.ptr = sf->ring + sf->head;
+	frame.offset = sf->head * sizeof(short);
+	frame.mallocd = AST_MALLOCD_SHARED;
+	out = ast_frshare(&frame);
+	if (!out) {
+		return NULL;
+	}
+
+	sf->head = (sf->head + samples) & (sf->ring_size - 1);
+	sf->size -= samples;
+	return out;
+}
+
 unsigned int ast_slinfactory_available(const struct ast_slinfactory *sf)
 {
 	return sf->size;
@@ -203,18 +257,14 @@ unsigned int ast_slinfactory_available(const struct ast_slinfactory *sf)
 
 void ast_slinfactory_flush(struct ast_slinfactory *sf)
 {
-	struct ast_frame *fr = NULL;
-
 	if (sf->trans) {
 		ast_translator_free_path(sf->trans);
 		sf->trans = NULL;
 	}
 
-	while ((fr = AST_LIST_REMOVE_HEAD(&sf->queue, frame_list)))
-		ast_frfree(fr);
-
-	sf->size = sf->holdlen = 0;
-	sf->offset = sf->hold;
+	/* The ring is kept for the audio to come */
+	sf->size = 0;
+	sf->head = 0;
 
 	return;
 }
@@ -40,6 +40,16 @@
 
 #define SMOOTHER_SIZE 8000
 
+/*!
+ * \brief A smoother
+ *
+ * The audio fed is copied once, into data, and frames read point at it
+ * there rather than having it copied out again.  Whatever is in front of
+ * the audio of a frame has been read already, so the space for a header
+ * the frame offers is free to write to.  The audio left over after a read
+ * stays where it is, and is only moved back to the front when there is no
+ * room left behind it for the next frame fed.
+ */
 struct ast_smoother {
 	int size;
 	struct ast_format *format;
@@ -48,8 +58,9 @@ struct ast_smoother {
 	unsigned int opt_needs_swap:1;
 	struct ast_frame f;
 	struct timeval delivery;
-	char data[SMOOTHER_SIZE];
-	char framedata[SMOOTHER_SIZE + AST_FRIENDLY_OFFSET];
+	/*! Where in data the audio not read yet begins, never before AST_FRIENDLY_OFFSET */
+	int head;
+	char data[AST_FRIENDLY_OFFSET + 2 * SMOOTHER_SIZE];
 	struct ast_frame *opt;
 	int len;
 };
@@ -62,10 +73,15 @@ static int smoother_frame_feed(struct ast_smoother *s, struct ast_frame *f, int
 			return 0;
 		}
 	}
+	if (s->head + s->len + f->datalen > sizeof(s->data)) {
+		/* Out of room behind the audio, move it back to the front */
+		memmove(s->data + AST_FRIENDLY_OFFSET, s->data + s->head, s->len);
+		s->head = AST_FRIENDLY_OFFSET;
+	}
 	if (swap) {
-		ast_swapcopy_samples(s->data + s->len, f->data.ptr, f->samples);
+		ast_swapcopy_samples(s->data + s->head + s->len, f->data.ptr, f->samples);
 	} else {
-		memcpy(s->data + s->len, f->data.ptr, f->datalen);
+		memcpy(s->data + s->head + s->len, f->data.ptr, f->datalen);
 	}
 	/* If either side is empty, reset the delivery time */
 	if (!s->len || ast_tvzero(f->delivery) || ast_tvzero(s->delivery)) {	/* XXX really ? */
@@ -81,6 +97,7 @@ void ast_smoother_reset(struct ast_smoother *s, int bytes)
 	ao2_cleanup(s->format);
 	memset(s, 0, sizeof(*s));
 	s->size = bytes;
+	s->head = AST_FRIENDLY_OFFSET;
 }
 
 void ast_smoother_reconfigure(struct ast_smoother *s, int bytes)
@@ -190,23 +207,23 @@ struct ast_frame *ast_smoother_read(struct ast_smoother *s)
 	len = s->size;
 	if (len > s->len)
 		len = s->len;
-	/* Make frame */
+	/* Make frame, pointing at the audio where it is */
 	s->f.frametype = AST_FRAME_VOICE;
 	s->f.subclass.format = s->format;
-	s->f.data.ptr = s->framedata + AST_FRIENDLY_OFFSET;
-	s->f.offset = AST_FRIENDLY_OFFSET;
+	s->f.data.ptr = s->data + s->head;
+	s->f.offset = s->head;
 	s->f.datalen = len;
 	/* Samples will be improper given VAD, but with VAD the concept really doesn't even exist */
 	s->f.samples = len * s->samplesperbyte;	/* XXX rounding */
 	s->f.delivery = s->delivery;
-	/* Fill Data */
-	memcpy(s->f.data.ptr, s->data, len);
 	s->len -= len;
-	/* Move remaining data to the front if applicable */
-	if (s->len) {
+	if (!s->len) {
+		/* Nothing is left, the next audio fed can go back at the front */
+		s->head = AST_FRIENDLY_OFFSET;
+	} else {
 		/* In principle this should all be fine because if we are sending
 		   G.729 VAD, the next timestamp will take over anyway */
-		memmove(s->data, s->data + len, s->len);
+		s->head += len;
 		if (!ast_tvzero(s->delivery)) {
 			/* If we have delivery time, increment it, otherwise, leave it at 0 */
 			s->delivery = ast_tvadd(s->delivery, ast_samp2tv(s->f.samples,
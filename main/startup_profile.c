@@ -0,0 +1,238 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Startup profiling
+ *
+ * When startup_profile is enabled in asterisk.conf the core records how
+ * long each phase of startup, each module load function, each
+ * configuration file and each realtime lookup took until Asterisk is
+ * fully booted.  The timeline is shown by 'core show startup', which can
+ * also print it in the Chrome trace event format.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/_private.h"
+#include "asterisk/cli.h"
+#include "asterisk/json.h"
+#include "asterisk/lock.h"
+#include "asterisk/options.h"
+#include "asterisk/utils.h"
+#include "asterisk/vector.h"
+
+/*! \brief Something that took time during startup */
+struct startup_event {
+	/*! What kind of thing it was, a string literal */
+	const char *category;
+	/*! When it started, in microseconds since Asterisk started */
+	int64_t start;
+	/*! How long it took, in microseconds */
+	int64_t duration;
+	/*! The thread it ran on */
+	int tid;
+	/*! What it was */
+	char name[0];
+};
+
+AST_VECTOR(startup_events, struct startup_event *);
+
+static struct startup_events events;
+AST_MUTEX_DEFINE_STATIC(events_lock);
+
+int ast_startup_profile_active(void)
+{
+	return ast_option_startup_profile && !ast_fully_booted;
+}
+
+void ast_startup_profile_record(const char *category, const char *name, struct timeval start)
+{
+	struct startup_event *event;
+	struct timeval end;
+
+	if (!ast_startup_profile_active()) {
+		return;
+	}
+
+	end = ast_tvnow();
+
+	event = ast_malloc(sizeof(*event) + strlen(name) + 1);
+	if (!event) {
+		return;
+	}
+	event->category = category;
+	event->start = ast_tvdiff_us(start, ast_startuptime);
+	event->duration = ast_tvdiff_us(end, start);
+	event->tid = ast_get_tid();
+	strcpy(event->name, name); /* Safe */
+
+	ast_mutex_lock(&events_lock);
+	if (AST_VECTOR_APPEND(&events, event)) {
+		ast_free(event);
+	}
+	ast_mutex_unlock(&events_lock);
+}
+
+static int startup_event_cmp(const void *left, const void *right)
+{
+	const struct startup_event *a = *(struct startup_event * const *) left;
+	const struct startup_event *b = *(struct startup_event * const *) right;
+
+	if (a->start != b->start) {
+		return a->start < b->start ? -1 : 1;
+	}
+
+	/* Whatever started first at the same time encloses the rest */
+	if (a->duration != b->duration) {
+		return a->duration > b->duration ? -1 : 1;
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Print the events as a Chrome trace, for chrome://tracing or Perfetto
+ *
+ * \pre events_lock is held
+ */
+static char *startup_profile_show_json(struct ast_cli_args *a)
+{
+	struct ast_json *trace;
+	struct ast_json *list;
+	char *str;
+	int i;
+
+	list = ast_json_array_create();
+	trace = ast_json_pack("{s: o, s: s}", "traceEvents", list, "displayTimeUnit", "ms");
+	if (!trace) {
+		return CLI_FAILURE;
+	}
+
+	for (i = 0; i < AST_VECTOR_SIZE(&events); i++) {
+		struct startup_event *event = AST_VECTOR_GET(&events, i);
+
+		if (ast_json_array_append(list, ast_json_pack("{s: s, s: s, s: s, s: I, s: I, s: i, s: i}",
+				"name", event->name,
+				"cat", event->category,
+				"ph", "X",
+				"ts", (ast_json_int_t)event->start,
+				"dur", (ast_json_int_t)event->duration,
+				"pid", 1,
+				"tid", event->tid))) {
+			ast_json_unref(trace);
+			return CLI_FAILURE;
+		}
+	}
+
+	str = ast_json_dump_string(trace);
+	ast_json_unref(trace);
+	if (!str) {
+		return CLI_FAILURE;
+	}
+	ast_cli(a->fd, "%s\n", str);
+	ast_json_free(str);
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_core_show_startup(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+#define FORMAT "%12s %12s  %-8s %s\n"
+#define FORMAT2 "%8" PRId64 ".%03" PRId64 " %8" PRId64 ".%03" PRId64 "  %-8s %s\n"
+	char *res = CLI_SUCCESS;
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show startup";
+		e->usage =
+			"Usage: core show startup [json]\n"
+			"       Shows how long each phase of startup, module load, configuration\n"
+			"       file and realtime lookup took, with when it started, in\n"
+			"       milliseconds since Asterisk started.  With 'json' the timeline\n"
+			"       is printed in the Chrome trace event format instead.\n"
+			"       Requires startup_profile to be enabled in asterisk.conf.\n";
+		return NULL;
+	case CLI_GENERATE:
+		if (a->pos == 3) {
+			return ast_cli_complete(a->word, (const char * const []){ "json", NULL }, a->n);
+		}
+		return NULL;
+	}
+
+	if (a->argc == 4 && strcasecmp(a->argv[3], "json")) {
+		return CLI_SHOWUSAGE;
+	} else if (a->argc != 3 && a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&events_lock);
+	if (!AST_VECTOR_SIZE(&events)) {
+		ast_mutex_unlock(&events_lock);
+		ast_cli(a->fd, "No startup profile was recorded.  Enable startup_profile in asterisk.conf.\n");
+		return CLI_SUCCESS;
+	}
+
+	AST_VECTOR_SORT(&events, startup_event_cmp);
+
+	if (a->argc == 4) {
+		res = startup_profile_show_json(a);
+		ast_mutex_unlock(&events_lock);
+		return res;
+	}
+
+	ast_cli(a->fd, FORMAT, "Start (ms)", "Took (ms)", "Category", "Name");
+	for (i = 0; i < AST_VECTOR_SIZE(&events); i++) {
+		struct startup_event *event = AST_VECTOR_GET(&events, i);
+
+		ast_cli(a->fd, FORMAT2, event->start / 1000, event->start % 1000,
+			event->duration / 1000, event->duration % 1000, event->category, event->name);
+	}
+	ast_cli(a->fd, "%d startup events recorded.\n", (int) AST_VECTOR_SIZE(&events));
+	ast_mutex_unlock(&events_lock);
+
+	return res;
+#undef FORMAT
+#undef FORMAT2
+}
+
+static struct ast_cli_entry cli_startup_profile[] = {
+	AST_CLI_DEFINE(handle_core_show_startup, "Show how long each part of startup took"),
+};
+
+static void startup_profile_shutdown(void)
+{
+	ast_cli_unregister_multiple(cli_startup_profile, ARRAY_LEN(cli_startup_profile));
+
+	ast_mutex_lock(&events_lock);
+	AST_VECTOR_RESET(&events, ast_free);
+	AST_VECTOR_FREE(&events);
+	ast_mutex_unlock(&events_lock);
+}
+
+int ast_startup_profile_init(void)
+{
+	ast_cli_register_multiple(cli_startup_profile, ARRAY_LEN(cli_startup_profile));
+	ast_register_cleanup(startup_profile_shutdown);
+
+	return 0;
+}
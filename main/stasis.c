@@ -34,6 +34,7 @@
 #include "asterisk/stasis.h"
 #include "asterisk/taskprocessor.h"
 #include "asterisk/threadpool.h"
+#include "asterisk/serializer.h"
 #include "asterisk/utils.h"
 #include "asterisk/uuid.h"
 #include "asterisk/vector.h"
@@ -75,6 +76,25 @@
 				<configOption name="max_size" default="50">
 					<synopsis>Maximum number of threads in the threadpool.</synopsis>
 				</configOption>
+				<configOption name="work_stealing" default="no">
+					<synopsis>Use per-worker task queues with work stealing.</synopsis>
+					<description>
+						<para>When enabled, tasks are spread across a queue per CPU
+						instead of a single shared queue.  Idle threads take tasks from
+						the queues of busy threads.  This reduces contention on systems
+						with many cores.</para>
+					</description>
+				</configOption>
+				<configOption name="serializer_pool_size" default="8">
+					<synopsis>Number of serializers shared by hashed pool subscriptions.</synopsis>
+					<description>
+						<para>Subscriptions made with <literal>stasis_subscribe_pool_hashed</literal>
+						are spread over this many serializers running on the Stasis
+						threadpool.  Messages for each subscription stay ordered while
+						idle subscriptions do not each need their own taskprocessor.
+						0 gives every such subscription its own serializer.</para>
+					</description>
+				</configOption>
 			</configObject>
 			<configObject name="declined_message_types">
 				<synopsis>Stasis message types for which to decline creation.</synopsis>
@@ -306,6 +326,9 @@
 /*! Thread pool for topics that don't want a dedicated taskprocessor */
 static struct ast_threadpool *threadpool;
 
+/*! Serializers shared by hashed pool subscriptions */
+static struct ast_serializer_pool *subscription_serializers;
+
 STASIS_MESSAGE_TYPE_DEFN(stasis_subscription_change_type);
 
 #if defined(LOW_MEMORY)
@@ -367,11 +390,32 @@ struct stasis_topic_statistics {
 };
 #endif
 
+/*! \internal */
+AST_VECTOR(stasis_subscription_vector, struct stasis_subscription *);
+
+/*!
+ * \internal
+ * \brief Incremented whenever the message filter of any subscription changes.
+ *
+ * Topics compare it against the version their dispatch index was built
+ * from to know when the index must be rebuilt.
+ */
+static int subscription_filter_version;
+
 /*! \internal */
 struct stasis_topic {
 	/*! Variable length array of the subscribers */
 	AST_VECTOR(, struct stasis_subscription *) subscribers;
 
+	/*! Subscribers indexed by the message type ids they select */
+	AST_VECTOR(, struct stasis_subscription_vector) subscribers_by_type;
+	/*! Subscribers without a message type filter, they see every message */
+	struct stasis_subscription_vector subscribers_unfiltered;
+	/*! subscription_filter_version the dispatch index was built from */
+	int index_version;
+	/*! TRUE if the dispatch index matches the subscribers */
+	unsigned int index_valid:1;
+
 	/*! Topics forwarding into this topic */
 	AST_VECTOR(, struct stasis_topic *) upstream_topics;
 
@@ -433,6 +477,7 @@ static int topic_remove_subscription(struct stasis_topic *topic, struct stasis_s
 static void topic_dtor(void *obj)
 {
 	struct stasis_topic *topic = obj;
+	size_t idx;
 #ifdef AST_DEVMODE
 	struct ao2_container *topic_stats;
 #endif
@@ -446,6 +491,11 @@ static void topic_dtor(void *obj)
 
 	AST_VECTOR_FREE(&topic->subscribers);
 	AST_VECTOR_FREE(&topic->upstream_topics);
+	for (idx = 0; idx < AST_VECTOR_SIZE(&topic->subscribers_by_type); ++idx) {
+		AST_VECTOR_FREE(AST_VECTOR_GET_ADDR(&topic->subscribers_by_type, idx));
+	}
+	AST_VECTOR_FREE(&topic->subscribers_by_type);
+	AST_VECTOR_FREE(&topic->subscribers_unfiltered);
 	ast_debug(1, "Topic '%s': %p destroyed\n", topic->name, topic);
 
 #ifdef AST_DEVMODE
@@ -591,6 +641,8 @@ struct stasis_topic *stasis_topic_create_with_detail(
 
 	res |= AST_VECTOR_INIT(&topic->subscribers, INITIAL_SUBSCRIBERS_MAX);
 	res |= AST_VECTOR_INIT(&topic->upstream_topics, 0);
+	res |= AST_VECTOR_INIT(&topic->subscribers_by_type, 0);
+	res |= AST_VECTOR_INIT(&topic->subscribers_unfiltered, INITIAL_SUBSCRIBERS_MAX);
 	if (res) {
 		ao2_ref(topic, -1);
 		return NULL;
@@ -676,6 +728,42 @@ struct stasis_subscription_statistics {
 };
 #endif
 
+/*! Most queued messages an overload task delivers before letting other tasks run */
+#define OVERLOAD_DRAIN_MAX 64
+
+struct sync_task_data;
+
+/*! \brief A message waiting in a subscription's overload queue */
+struct overload_entry {
+	/*! The message */
+	struct stasis_message *message;
+	/*! Publisher waiting on the message, NULL if published asynchronously */
+	struct sync_task_data *std;
+	AST_LIST_ENTRY(overload_entry) next;
+};
+
+/*! \brief Bounded message queue of a subscription with an overload policy */
+struct subscription_overload {
+	/*! Protects the rest of the structure */
+	ast_mutex_t lock;
+	/*! What to do when the queue is full */
+	enum stasis_subscription_overload_policy policy;
+	/*! Number of messages that may wait */
+	size_t max_queued;
+	/*! Returns the entity a message is about, for coalescing */
+	const char *(*id_fn)(struct stasis_message *message);
+	/*! Messages waiting, oldest first */
+	AST_LIST_HEAD_NOLOCK(, overload_entry) queue;
+	/*! Number of messages waiting */
+	size_t queued;
+	/*! Messages discarded by the policy */
+	unsigned int dropped;
+	/*! Messages replaced by a newer one */
+	unsigned int coalesced;
+	/*! TRUE if a task to deliver the queue is on the mailbox */
+	unsigned int scheduled:1;
+};
+
 /*! \internal */
 struct stasis_subscription {
 	/*! Unique ID for this subscription */
@@ -684,8 +772,14 @@ struct stasis_subscription {
 	struct stasis_topic *topic;
 	/*! Mailbox for processing incoming messages. */
 	struct ast_taskprocessor *mailbox;
+	/*! TRUE if the mailbox is shared with other subscriptions. */
+	unsigned int shared_mailbox:1;
 	/*! Callback function for incoming message processing. */
 	stasis_subscription_cb callback;
+	/*! Optional callback function for processing published batches. */
+	stasis_subscription_batch_cb batch_callback;
+	/*! Bounded message queue, NULL unless an overload policy was set. */
+	struct subscription_overload *overload;
 	/*! Data pointer to be handed to the callback. */
 	void *data;
 
@@ -734,6 +828,17 @@ static void subscription_dtor(void *obj)
 
 	AST_VECTOR_FREE(&sub->accepted_message_types);
 
+	if (sub->overload) {
+		struct overload_entry *entry;
+
+		while ((entry = AST_LIST_REMOVE_HEAD(&sub->overload->queue, next))) {
+			ao2_cleanup(entry->message);
+			ast_free(entry);
+		}
+		ast_mutex_destroy(&sub->overload->lock);
+		ast_free(sub->overload);
+	}
+
 #ifdef AST_DEVMODE
 	if (sub->statistics) {
 		subscription_stats = ao2_global_obj_ref(subscription_statistics);
@@ -853,12 +958,23 @@ static struct stasis_subscription_statistics *stasis_subscription_statistics_cre
 }
 #endif
 
-struct stasis_subscription *internal_stasis_subscribe(
+/*!
+ * \internal
+ * \brief Create a subscription.
+ *
+ * \param hashed Put the subscription on a serializer shared through
+ *  \ref subscription_serializers. Only relevant if \c use_thread_pool is
+ *  non-zero.
+ *
+ * See internal_stasis_subscribe() for the other parameters.
+ */
+static struct stasis_subscription *subscribe_internal(
 	struct stasis_topic *topic,
 	stasis_subscription_cb callback,
 	void *data,
 	int needs_mailbox,
 	int use_thread_pool,
+	int hashed,
 	const char *file,
 	int lineno,
 	const char *func)
@@ -891,7 +1007,23 @@ struct stasis_subscription *internal_stasis_subscribe(
 	}
 #endif
 
-	if (needs_mailbox) {
+	if (needs_mailbox && use_thread_pool && hashed && subscription_serializers) {
+		/*
+		 * The serializer is shared so it can't carry the subscription as
+		 * its local data.  Each task takes the subscription along instead.
+		 */
+		sub->mailbox = ast_serializer_pool_get_by_hash(subscription_serializers,
+			ast_str_hash(sub->uniqueid));
+		if (!sub->mailbox) {
+			ao2_ref(sub, -1);
+
+			return NULL;
+		}
+		ao2_bump(sub->mailbox);
+		sub->shared_mailbox = 1;
+		/* Queued cleanup task has a reference */
+		ao2_ref(sub, +1);
+	} else if (needs_mailbox) {
 		char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
 
 		/* Create name with seq number appended. */
@@ -939,6 +1071,20 @@ struct stasis_subscription *internal_stasis_subscribe(
 	return sub;
 }
 
+struct stasis_subscription *internal_stasis_subscribe(
+	struct stasis_topic *topic,
+	stasis_subscription_cb callback,
+	void *data,
+	int needs_mailbox,
+	int use_thread_pool,
+	const char *file,
+	int lineno,
+	const char *func)
+{
+	return subscribe_internal(topic, callback, data, needs_mailbox, use_thread_pool, 0,
+		file, lineno, func);
+}
+
 struct stasis_subscription *__stasis_subscribe(
 	struct stasis_topic *topic,
 	stasis_subscription_cb callback,
@@ -961,6 +1107,17 @@ struct stasis_subscription *__stasis_subscribe_pool(
 	return internal_stasis_subscribe(topic, callback, data, 1, 1, file, lineno, func);
 }
 
+struct stasis_subscription *__stasis_subscribe_pool_hashed(
+	struct stasis_topic *topic,
+	stasis_subscription_cb callback,
+	void *data,
+	const char *file,
+	int lineno,
+	const char *func)
+{
+	return subscribe_internal(topic, callback, data, 1, 1, 1, file, lineno, func);
+}
+
 static int sub_cleanup(void *data)
 {
 	struct stasis_subscription *sub = data;
@@ -1013,13 +1170,91 @@ int stasis_subscription_set_congestion_limits(struct stasis_subscription *subscr
 {
 	int res = -1;
 
-	if (subscription) {
+	/* A shared mailbox's limits belong to every subscription using it */
+	if (subscription && !subscription->shared_mailbox) {
 		res = ast_taskprocessor_alert_set_levels(subscription->mailbox,
 			low_water, high_water);
 	}
 	return res;
 }
 
+int stasis_subscription_set_batch_callback(struct stasis_subscription *subscription,
+	stasis_subscription_batch_cb callback)
+{
+	if (!subscription) {
+		return -1;
+	}
+
+	ao2_lock(subscription->topic);
+	subscription->batch_callback = callback;
+	ao2_unlock(subscription->topic);
+
+	return 0;
+}
+
+int stasis_subscription_set_overload_policy(struct stasis_subscription *subscription,
+	enum stasis_subscription_overload_policy policy, size_t max_queued,
+	const char *(*id_fn)(struct stasis_message *message))
+{
+	struct subscription_overload *overload;
+
+	if (!subscription || !subscription->mailbox) {
+		return -1;
+	}
+	if ((policy != STASIS_SUBSCRIPTION_OVERLOAD_NONE && !max_queued)
+		|| (policy == STASIS_SUBSCRIPTION_OVERLOAD_COALESCE && !id_fn)) {
+		return -1;
+	}
+
+	/* Dispatching reads the overload queue pointer under the topic lock */
+	ao2_lock(subscription->topic);
+	overload = subscription->overload;
+	if (!overload) {
+		overload = ast_calloc(1, sizeof(*overload));
+		if (!overload) {
+			ao2_unlock(subscription->topic);
+			return -1;
+		}
+		ast_mutex_init(&overload->lock);
+		AST_LIST_HEAD_INIT_NOLOCK(&overload->queue);
+		subscription->overload = overload;
+	}
+
+	ast_mutex_lock(&overload->lock);
+	overload->policy = policy;
+	overload->max_queued = max_queued;
+	overload->id_fn = id_fn;
+	ast_mutex_unlock(&overload->lock);
+	ao2_unlock(subscription->topic);
+
+	return 0;
+}
+
+int stasis_subscription_overload_statistics_get(struct stasis_subscription *subscription,
+	struct stasis_subscription_overload_statistics *statistics)
+{
+	struct subscription_overload *overload;
+
+	if (!subscription) {
+		return -1;
+	}
+
+	ao2_lock(subscription->topic);
+	overload = subscription->overload;
+	ao2_unlock(subscription->topic);
+	if (!overload) {
+		return -1;
+	}
+
+	ast_mutex_lock(&overload->lock);
+	statistics->dropped = overload->dropped;
+	statistics->coalesced = overload->coalesced;
+	statistics->queued = overload->queued;
+	ast_mutex_unlock(&overload->lock);
+
+	return 0;
+}
+
 int stasis_subscription_accept_message_type(struct stasis_subscription *subscription,
 	const struct stasis_message_type *type)
 {
@@ -1035,6 +1270,7 @@ int stasis_subscription_accept_message_type(struct stasis_subscription *subscrip
 		 * so force all messages through.
 		 */
 		subscription->filter = STASIS_SUBSCRIPTION_FILTER_FORCED_NONE;
+		ast_atomic_fetchadd_int(&subscription_filter_version, +1);
 		return 0;
 	}
 
@@ -1045,6 +1281,7 @@ int stasis_subscription_accept_message_type(struct stasis_subscription *subscrip
 		 */
 		subscription->filter = STASIS_SUBSCRIPTION_FILTER_FORCED_NONE;
 	}
+	ast_atomic_fetchadd_int(&subscription_filter_version, +1);
 	ao2_unlock(subscription->topic);
 
 	return 0;
@@ -1069,6 +1306,7 @@ int stasis_subscription_decline_message_type(struct stasis_subscription *subscri
 		/* The memory is already allocated so this can't fail */
 		AST_VECTOR_REPLACE(&subscription->accepted_message_types, stasis_message_type_id(type), 0);
 	}
+	ast_atomic_fetchadd_int(&subscription_filter_version, +1);
 	ao2_unlock(subscription->topic);
 
 	return 0;
@@ -1085,6 +1323,7 @@ int stasis_subscription_set_filter(struct stasis_subscription *subscription,
 	if (subscription->filter != STASIS_SUBSCRIPTION_FILTER_FORCED_NONE) {
 		subscription->filter = filter;
 	}
+	ast_atomic_fetchadd_int(&subscription_filter_version, +1);
 	ao2_unlock(subscription->topic);
 
 	return 0;
@@ -1097,6 +1336,7 @@ void stasis_subscription_accept_formatters(struct stasis_subscription *subscript
 
 	ao2_lock(subscription->topic);
 	subscription->accepted_formatters = formatters;
+	ast_atomic_fetchadd_int(&subscription_filter_version, +1);
 	ao2_unlock(subscription->topic);
 
 	return;
@@ -1210,6 +1450,7 @@ static int topic_add_subscription(struct stasis_topic *topic, struct stasis_subs
 	 * If we bumped the refcount here, the owner would have to unsubscribe
 	 * and cleanup, which is a bit awkward. */
 	AST_VECTOR_APPEND(&topic->subscribers, sub);
+	topic->index_valid = 0;
 
 	for (idx = 0; idx < AST_VECTOR_SIZE(&topic->upstream_topics); ++idx) {
 		topic_add_subscription(
@@ -1238,6 +1479,7 @@ static int topic_remove_subscription(struct stasis_topic *topic, struct stasis_s
 	}
 	res = AST_VECTOR_REMOVE_ELEM_UNORDERED(&topic->subscribers, sub,
 		AST_VECTOR_ELEM_CLEANUP_NOOP);
+	topic->index_valid = 0;
 
 #ifdef AST_DEVMODE
 	if (!res) {
@@ -1301,17 +1543,14 @@ static int dispatch_exec_sync(struct ast_taskprocessor_local *local)
 }
 
 /*!
- * \internal \brief Dispatch a message to a subscriber
- * \param sub The subscriber to dispatch to
- * \param message The message to send
- * \param synchronous If non-zero, synchronize on the subscriber receiving
- * the message
- * \retval 0 if message was not dispatched
- * \retval 1 if message was dispatched
+ * \internal \brief Determine if a subscriber's filters accept a message
+ * \param sub The subscriber to check
+ * \param message The message to check
+ * \retval 0 if message was filtered out
+ * \retval 1 if message is accepted
  */
-static unsigned int dispatch_message(struct stasis_subscription *sub,
-	struct stasis_message *message,
-	int synchronous)
+static int dispatch_message_accepted(struct stasis_subscription *sub,
+	struct stasis_message *message)
 {
 	int is_final = stasis_subscription_final_message(sub, message);
 
@@ -1369,14 +1608,337 @@ static unsigned int dispatch_message(struct stasis_subscription *sub,
 
 	} while (0);
 
-#ifdef AST_DEVMODE
-	ast_atomic_fetchadd_int(&sub->statistics->messages_passed, +1);
-#endif
+#ifdef AST_DEVMODE
+	ast_atomic_fetchadd_int(&sub->statistics->messages_passed, +1);
+#endif
+
+	return 1;
+}
+
+/*! \brief A task queued on a mailbox shared by several subscriptions */
+struct shared_mailbox_task {
+	/*! The subscription the task is for */
+	struct stasis_subscription *sub;
+	/*! Task to execute */
+	int (*task_exe)(struct ast_taskprocessor_local *local);
+	/*! Data for the task */
+	void *data;
+};
+
+static int shared_mailbox_task_exec(void *data)
+{
+	struct shared_mailbox_task *task = data;
+	struct ast_taskprocessor_local local = {
+		.local_data = task->sub,
+		.data = task->data,
+	};
+	int res;
+
+	res = task->task_exe(&local);
+	ast_free(task);
+
+	return res;
+}
+
+/*!
+ * \internal \brief Queue a task on a subscription's mailbox
+ * \param sub The subscription
+ * \param task_exe Task to execute, the subscription is its local data
+ * \param data Data for the task
+ * \retval 0 on success
+ * \retval -1 on error
+ */
+static int subscription_push(struct stasis_subscription *sub,
+	int (*task_exe)(struct ast_taskprocessor_local *local), void *data)
+{
+	struct shared_mailbox_task *task;
+
+	if (!sub->shared_mailbox) {
+		return ast_taskprocessor_push_local(sub->mailbox, task_exe, data);
+	}
+
+	/*
+	 * The subscription stays alive until its cleanup task, queued after
+	 * every message, runs so the task needs no reference of its own.
+	 */
+	task = ast_malloc(sizeof(*task));
+	if (!task) {
+		return -1;
+	}
+	task->sub = sub;
+	task->task_exe = task_exe;
+	task->data = data;
+
+	if (ast_taskprocessor_push(sub->mailbox, shared_mailbox_task_exec, task)) {
+		ast_free(task);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal \brief Determine if an overload policy may discard a queued message
+ */
+static int overload_entry_droppable(struct stasis_subscription *sub,
+	struct overload_entry *entry)
+{
+	return !entry->std && !stasis_subscription_final_message(sub, entry->message);
+}
+
+static void overload_entry_drop(struct subscription_overload *overload,
+	struct overload_entry *entry)
+{
+	ao2_ref(entry->message, -1);
+	ast_free(entry);
+	--overload->queued;
+	++overload->dropped;
+}
+
+/*!
+ * \internal \brief Replace a queued message about the same entity
+ * \note The overload lock is held.
+ * \retval 1 if the message replaced a queued one
+ * \retval 0 otherwise
+ */
+static int overload_coalesce(struct stasis_subscription *sub,
+	struct subscription_overload *overload, struct stasis_message *message)
+{
+	struct overload_entry *entry;
+	const char *id;
+
+	id = overload->id_fn(message);
+	if (!id) {
+		return 0;
+	}
+
+	AST_LIST_TRAVERSE(&overload->queue, entry, next) {
+		const char *queued_id;
+
+		if (stasis_message_type(entry->message) != stasis_message_type(message)
+			|| !overload_entry_droppable(sub, entry)) {
+			continue;
+		}
+
+		queued_id = overload->id_fn(entry->message);
+		if (queued_id && !strcmp(queued_id, id)) {
+			ao2_replace(entry->message, message);
+			++overload->coalesced;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal \brief Make room in a full overload queue
+ * \note The overload lock is held.
+ */
+static void overload_shed(struct stasis_subscription *sub,
+	struct subscription_overload *overload)
+{
+	struct overload_entry *entry;
+
+	if (overload->policy == STASIS_SUBSCRIPTION_OVERLOAD_SAMPLE) {
+		int keep = 1;
+
+		AST_LIST_TRAVERSE_SAFE_BEGIN(&overload->queue, entry, next) {
+			if (!overload_entry_droppable(sub, entry)) {
+				continue;
+			}
+			if (!keep) {
+				AST_LIST_REMOVE_CURRENT(next);
+				overload_entry_drop(overload, entry);
+			}
+			keep = !keep;
+		}
+		AST_LIST_TRAVERSE_SAFE_END;
+
+		if (overload->queued < overload->max_queued) {
+			return;
+		}
+	}
+
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&overload->queue, entry, next) {
+		if (overload_entry_droppable(sub, entry)) {
+			AST_LIST_REMOVE_CURRENT(next);
+			overload_entry_drop(overload, entry);
+			break;
+		}
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+}
+
+/*!
+ * \internal \brief Deliver the messages in a subscription's overload queue
+ * \param local \ref ast_taskprocessor_local object
+ * \return 0
+ */
+static int overload_exec(struct ast_taskprocessor_local *local)
+{
+	struct stasis_subscription *sub = local->local_data;
+	struct subscription_overload *overload = sub->overload;
+	struct overload_entry *entry;
+	int count;
+
+	for (count = 0; count < OVERLOAD_DRAIN_MAX; ++count) {
+		ast_mutex_lock(&overload->lock);
+		entry = AST_LIST_REMOVE_HEAD(&overload->queue, next);
+		if (!entry) {
+			overload->scheduled = 0;
+			ast_mutex_unlock(&overload->lock);
+
+			/* The reference taken when the task was pushed */
+			ao2_ref(sub, -1);
+			return 0;
+		}
+		--overload->queued;
+		ast_mutex_unlock(&overload->lock);
+
+		subscription_invoke(sub, entry->message);
+		ao2_ref(entry->message, -1);
+		if (entry->std) {
+			ast_mutex_lock(&entry->std->lock);
+			entry->std->complete = 1;
+			ast_cond_signal(&entry->std->cond);
+			ast_mutex_unlock(&entry->std->lock);
+		}
+		ast_free(entry);
+	}
+
+	/* Let other tasks on the mailbox run before delivering the rest */
+	if (subscription_push(sub, overload_exec, NULL)) {
+		ast_log(LOG_ERROR, "Unable to continue delivering queued messages of '%s'\n",
+			sub->uniqueid);
+		ast_mutex_lock(&overload->lock);
+		overload->scheduled = 0;
+		ast_mutex_unlock(&overload->lock);
+		ao2_ref(sub, -1);
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal \brief Queue a message on a subscription's overload queue
+ * \param sub The subscriber to dispatch to
+ * \param message The message to send
+ * \param std Set if the publisher waits for the message to be delivered
+ * \retval 0 if message was not dispatched
+ * \retval 1 if message was dispatched
+ */
+static unsigned int overload_enqueue(struct stasis_subscription *sub,
+	struct stasis_message *message, struct sync_task_data *std)
+{
+	struct subscription_overload *overload = sub->overload;
+	struct overload_entry *entry = NULL;
+	int push;
+
+	ast_mutex_lock(&overload->lock);
+	if (overload->policy == STASIS_SUBSCRIPTION_OVERLOAD_COALESCE && !std
+		&& !stasis_subscription_final_message(sub, message)
+		&& overload_coalesce(sub, overload, message)) {
+		/* A task is already scheduled for the message replaced */
+		ast_mutex_unlock(&overload->lock);
+		return 1;
+	}
+
+	if (overload->policy != STASIS_SUBSCRIPTION_OVERLOAD_NONE
+		&& overload->queued >= overload->max_queued) {
+		overload_shed(sub, overload);
+	}
+
+	entry = ast_malloc(sizeof(*entry));
+	if (!entry) {
+		ast_mutex_unlock(&overload->lock);
+		return 0;
+	}
+	entry->message = ao2_bump(message);
+	entry->std = std;
+	AST_LIST_INSERT_TAIL(&overload->queue, entry, next);
+	++overload->queued;
+
+	push = !overload->scheduled;
+	overload->scheduled = 1;
+	ast_mutex_unlock(&overload->lock);
+
+	if (!push) {
+		return 1;
+	}
+
+	/* The task keeps the subscription until the queue is empty */
+	ao2_ref(sub, +1);
+	if (subscription_push(sub, overload_exec, NULL)) {
+		ast_log(LOG_ERROR, "Dropping overload queue dispatch\n");
+		ao2_ref(sub, -1);
+
+		ast_mutex_lock(&overload->lock);
+		overload->scheduled = 0;
+		if (std) {
+			/* Nobody would deliver it, so don't leave the publisher waiting */
+			AST_LIST_REMOVE(&overload->queue, entry, next);
+			--overload->queued;
+			ao2_ref(entry->message, -1);
+			ast_free(entry);
+			ast_mutex_unlock(&overload->lock);
+			return 0;
+		}
+		ast_mutex_unlock(&overload->lock);
+	}
+
+	return 1;
+}
+
+/*!
+ * \internal \brief Dispatch a message to a subscriber
+ * \param sub The subscriber to dispatch to
+ * \param message The message to send
+ * \param synchronous If non-zero, synchronize on the subscriber receiving
+ * the message
+ * \retval 0 if message was not dispatched
+ * \retval 1 if message was dispatched
+ */
+static unsigned int dispatch_message(struct stasis_subscription *sub,
+	struct stasis_message *message,
+	int synchronous)
+{
+	if (!dispatch_message_accepted(sub, message)) {
+		return 0;
+	}
+
+	if (!sub->mailbox) {
+		/* Dispatch directly */
+		subscription_invoke(sub, message);
+		return 1;
+	}
+
+	if (sub->overload) {
+		struct sync_task_data std;
+		unsigned int dispatched;
+
+		if (!synchronous) {
+			return overload_enqueue(sub, message, NULL);
+		}
+
+		ast_mutex_init(&std.lock);
+		ast_cond_init(&std.cond, NULL);
+		std.complete = 0;
+		std.task_data = message;
+
+		dispatched = overload_enqueue(sub, message, &std);
+		if (dispatched) {
+			ast_mutex_lock(&std.lock);
+			while (!std.complete) {
+				ast_cond_wait(&std.cond, &std.lock);
+			}
+			ast_mutex_unlock(&std.lock);
+		}
+
+		ast_mutex_destroy(&std.lock);
+		ast_cond_destroy(&std.cond);
 
-	if (!sub->mailbox) {
-		/* Dispatch directly */
-		subscription_invoke(sub, message);
-		return 1;
+		return dispatched;
 	}
 
 	/* Bump the message for the taskprocessor push. This will get de-ref'd
@@ -1384,7 +1946,7 @@ static unsigned int dispatch_message(struct stasis_subscription *sub,
 	 */
 	ao2_bump(message);
 	if (!synchronous) {
-		if (ast_taskprocessor_push_local(sub->mailbox, dispatch_exec_async, message)) {
+		if (subscription_push(sub, dispatch_exec_async, message)) {
 			/* Push failed; ugh. */
 			ast_log(LOG_ERROR, "Dropping async dispatch\n");
 			ao2_cleanup(message);
@@ -1398,7 +1960,7 @@ static unsigned int dispatch_message(struct stasis_subscription *sub,
 		std.complete = 0;
 		std.task_data = message;
 
-		if (ast_taskprocessor_push_local(sub->mailbox, dispatch_exec_sync, &std)) {
+		if (subscription_push(sub, dispatch_exec_sync, &std)) {
 			/* Push failed; ugh. */
 			ast_log(LOG_ERROR, "Dropping sync dispatch\n");
 			ao2_cleanup(message);
@@ -1420,6 +1982,233 @@ static unsigned int dispatch_message(struct stasis_subscription *sub,
 	return 1;
 }
 
+/*!
+ * \brief Batch of messages queued to a subscriber as a single task.
+ */
+struct dispatch_batch {
+	/*! Number of messages in the batch */
+	size_t count;
+	/*! Messages in publish order (Each holds a reference) */
+	struct stasis_message *messages[0];
+};
+
+static void dispatch_batch_destroy(struct dispatch_batch *batch)
+{
+	while (batch->count) {
+		ao2_cleanup(batch->messages[--batch->count]);
+	}
+	ast_free(batch);
+}
+
+/*!
+ * \internal \brief Invoke the subscription's callbacks for a batch of messages.
+ * \param sub Subscription to invoke.
+ * \param messages Messages to send.
+ * \param count Number of messages.
+ *
+ * Final messages always go through subscription_invoke() so joining the
+ * subscription still works when it is unsubscribed in the middle of a batch.
+ */
+static void subscription_invoke_batch(struct stasis_subscription *sub,
+	struct stasis_message **messages, size_t count)
+{
+	size_t start = 0;
+	size_t i;
+
+	if (!sub->batch_callback) {
+		for (i = 0; i < count; ++i) {
+			subscription_invoke(sub, messages[i]);
+		}
+		return;
+	}
+
+	for (i = 0; i < count; ++i) {
+		if (!stasis_subscription_final_message(sub, messages[i])) {
+			continue;
+		}
+		if (start < i) {
+			sub->batch_callback(sub->data, sub, &messages[start], i - start);
+		}
+		subscription_invoke(sub, messages[i]);
+		start = i + 1;
+	}
+	if (start < count) {
+		sub->batch_callback(sub->data, sub, &messages[start], count - start);
+	}
+}
+
+/*!
+ * \internal \brief Dispatch a batch of messages to a subscriber asynchronously
+ * \param local \ref ast_taskprocessor_local object
+ * \return 0
+ */
+static int dispatch_exec_batch(struct ast_taskprocessor_local *local)
+{
+	struct stasis_subscription *sub = local->local_data;
+	struct dispatch_batch *batch = local->data;
+
+	subscription_invoke_batch(sub, batch->messages, batch->count);
+	dispatch_batch_destroy(batch);
+
+	return 0;
+}
+
+/*!
+ * \internal \brief Dispatch the messages of a batch a subscriber accepts
+ * \param sub The subscriber to dispatch to
+ * \param messages The messages to send
+ * \param count Number of messages
+ * \return Number of messages dispatched
+ */
+static size_t dispatch_batch(struct stasis_subscription *sub,
+	struct stasis_message **messages, size_t count)
+{
+	struct dispatch_batch *batch;
+	size_t i;
+
+	if (sub->overload && sub->mailbox) {
+		/* The messages go through the overload policy one by one */
+		size_t dispatched = 0;
+
+		for (i = 0; i < count; ++i) {
+			if (dispatch_message_accepted(sub, messages[i])) {
+				dispatched += overload_enqueue(sub, messages[i], NULL);
+			}
+		}
+
+		return dispatched;
+	}
+
+	batch = ast_malloc(sizeof(*batch) + count * sizeof(batch->messages[0]));
+	if (!batch) {
+		return 0;
+	}
+	batch->count = 0;
+
+	for (i = 0; i < count; ++i) {
+		if (dispatch_message_accepted(sub, messages[i])) {
+			batch->messages[batch->count++] = ao2_bump(messages[i]);
+		}
+	}
+	if (!batch->count) {
+		ast_free(batch);
+		return 0;
+	}
+
+	count = batch->count;
+	if (!sub->mailbox) {
+		/* Dispatch directly */
+		subscription_invoke_batch(sub, batch->messages, batch->count);
+		dispatch_batch_destroy(batch);
+		return count;
+	}
+
+	if (subscription_push(sub, dispatch_exec_batch, batch)) {
+		/* Push failed; ugh. */
+		ast_log(LOG_ERROR, "Dropping batch dispatch\n");
+		dispatch_batch_destroy(batch);
+		return 0;
+	}
+
+	return count;
+}
+
+#ifdef AST_DEVMODE
+/*!
+ * \internal \brief Count a published message in its message type statistics
+ * \param message The message being published
+ * \return The message type statistics
+ * \retval NULL on error
+ */
+static struct stasis_message_type_statistics *message_type_statistics_published(
+	struct stasis_message *message)
+{
+	int message_type_id = stasis_message_type_id(stasis_message_type(message));
+	struct stasis_message_type_statistics *statistics;
+
+	ast_mutex_lock(&message_type_statistics_lock);
+	if (message_type_id >= AST_VECTOR_SIZE(&message_type_statistics)) {
+		struct stasis_message_type_statistics new_statistics = {
+			.published = 0,
+		};
+		if (AST_VECTOR_REPLACE(&message_type_statistics, message_type_id, new_statistics)) {
+			ast_mutex_unlock(&message_type_statistics_lock);
+			return NULL;
+		}
+	}
+	statistics = AST_VECTOR_GET_ADDR(&message_type_statistics, message_type_id);
+	statistics->message_type = stasis_message_type(message);
+	ast_mutex_unlock(&message_type_statistics_lock);
+
+	ast_atomic_fetchadd_int(&statistics->published, +1);
+
+	return statistics;
+}
+#endif
+
+/*!
+ * \internal \brief Rebuild the topic's message type dispatch index if stale
+ * \param topic The topic to update, locked
+ *
+ * Subscribers that only select message types are listed under each type
+ * they accept.  Subscribers with no type filter, or with a formatter filter
+ * that may accept any type, are listed as unfiltered.
+ *
+ * \retval 0 if the index is valid
+ * \retval -1 on allocation failure, the index must not be used
+ */
+static int topic_index_update(struct stasis_topic *topic)
+{
+	int version = ast_atomic_fetchadd_int(&subscription_filter_version, 0);
+	size_t i;
+	size_t type_id;
+
+	if (topic->index_valid && topic->index_version == version) {
+		return 0;
+	}
+
+	for (i = 0; i < AST_VECTOR_SIZE(&topic->subscribers_by_type); ++i) {
+		AST_VECTOR_RESET(AST_VECTOR_GET_ADDR(&topic->subscribers_by_type, i),
+			AST_VECTOR_ELEM_CLEANUP_NOOP);
+	}
+	AST_VECTOR_RESET(&topic->subscribers_unfiltered, AST_VECTOR_ELEM_CLEANUP_NOOP);
+	topic->index_valid = 0;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&topic->subscribers); ++i) {
+		struct stasis_subscription *sub = AST_VECTOR_GET(&topic->subscribers, i);
+
+		if (!(sub->filter & STASIS_SUBSCRIPTION_FILTER_SELECTIVE)
+			|| sub->accepted_formatters != STASIS_SUBSCRIPTION_FORMATTER_NONE) {
+			if (AST_VECTOR_APPEND(&topic->subscribers_unfiltered, sub)) {
+				return -1;
+			}
+			continue;
+		}
+
+		for (type_id = 0; type_id < AST_VECTOR_SIZE(&sub->accepted_message_types); ++type_id) {
+			if (!AST_VECTOR_GET(&sub->accepted_message_types, type_id)) {
+				continue;
+			}
+			while (AST_VECTOR_SIZE(&topic->subscribers_by_type) <= type_id) {
+				struct stasis_subscription_vector empty;
+
+				AST_VECTOR_INIT(&empty, 0);
+				if (AST_VECTOR_APPEND(&topic->subscribers_by_type, empty)) {
+					return -1;
+				}
+			}
+			if (AST_VECTOR_APPEND(AST_VECTOR_GET_ADDR(&topic->subscribers_by_type, type_id), sub)) {
+				return -1;
+			}
+		}
+	}
+
+	topic->index_version = version;
+	topic->index_valid = 1;
+
+	return 0;
+}
+
 /*!
  * \internal \brief Publish a message to a topic's subscribers
  * \brief topic The topic to publish to
@@ -1433,7 +2222,6 @@ static void publish_msg(struct stasis_topic *topic,
 	size_t i;
 #ifdef AST_DEVMODE
 	unsigned int dispatched = 0;
-	int message_type_id = stasis_message_type_id(stasis_message_type(message));
 	struct stasis_message_type_statistics *statistics;
 	struct timeval start;
 	long elapsed;
@@ -1443,21 +2231,10 @@ static void publish_msg(struct stasis_topic *topic,
 	ast_assert(message != NULL);
 
 #ifdef AST_DEVMODE
-	ast_mutex_lock(&message_type_statistics_lock);
-	if (message_type_id >= AST_VECTOR_SIZE(&message_type_statistics)) {
-		struct stasis_message_type_statistics new_statistics = {
-			.published = 0,
-		};
-		if (AST_VECTOR_REPLACE(&message_type_statistics, message_type_id, new_statistics)) {
-			ast_mutex_unlock(&message_type_statistics_lock);
-			return;
-		}
+	statistics = message_type_statistics_published(message);
+	if (!statistics) {
+		return;
 	}
-	statistics = AST_VECTOR_GET_ADDR(&message_type_statistics, message_type_id);
-	statistics->message_type = stasis_message_type(message);
-	ast_mutex_unlock(&message_type_statistics_lock);
-
-	ast_atomic_fetchadd_int(&statistics->published, +1);
 #endif
 
 	/* If there are no subscribers don't bother */
@@ -1478,14 +2255,41 @@ static void publish_msg(struct stasis_topic *topic,
 	start = ast_tvnow();
 #endif
 	ao2_lock(topic);
-	for (i = 0; i < AST_VECTOR_SIZE(&topic->subscribers); ++i) {
-		struct stasis_subscription *sub = AST_VECTOR_GET(&topic->subscribers, i);
+	if (topic_index_update(topic)) {
+		/* No index, offer the message to every subscriber */
+		for (i = 0; i < AST_VECTOR_SIZE(&topic->subscribers); ++i) {
+			struct stasis_subscription *sub = AST_VECTOR_GET(&topic->subscribers, i);
 
-		ast_assert(sub != NULL);
+			ast_assert(sub != NULL);
 #ifdef AST_DEVMODE
-		dispatched +=
+			dispatched +=
+#endif
+				dispatch_message(sub, message, (sub == sync_sub));
+		}
+	} else {
+		int type_id = stasis_message_type_id(stasis_message_type(message));
+
+		for (i = 0; i < AST_VECTOR_SIZE(&topic->subscribers_unfiltered); ++i) {
+			struct stasis_subscription *sub = AST_VECTOR_GET(&topic->subscribers_unfiltered, i);
+
+#ifdef AST_DEVMODE
+			dispatched +=
+#endif
+				dispatch_message(sub, message, (sub == sync_sub));
+		}
+		if (type_id < AST_VECTOR_SIZE(&topic->subscribers_by_type)) {
+			struct stasis_subscription_vector *selected;
+
+			selected = AST_VECTOR_GET_ADDR(&topic->subscribers_by_type, type_id);
+			for (i = 0; i < AST_VECTOR_SIZE(selected); ++i) {
+				struct stasis_subscription *sub = AST_VECTOR_GET(selected, i);
+
+#ifdef AST_DEVMODE
+				dispatched +=
 #endif
-			dispatch_message(sub, message, (sub == sync_sub));
+					dispatch_message(sub, message, (sub == sync_sub));
+			}
+		}
 	}
 	ao2_unlock(topic);
 
@@ -1520,6 +2324,71 @@ void stasis_publish_sync(struct stasis_subscription *sub, struct stasis_message
 	publish_msg(sub->topic, message, sub);
 }
 
+void stasis_publish_batch(struct stasis_topic *topic, struct stasis_message **messages,
+	size_t count)
+{
+	size_t i;
+#ifdef AST_DEVMODE
+	size_t dispatched = 0;
+	struct timeval start;
+	long elapsed;
+#endif
+
+	ast_assert(topic != NULL);
+	ast_assert(messages != NULL || !count);
+
+#ifdef AST_DEVMODE
+	for (i = 0; i < count; ++i) {
+		message_type_statistics_published(messages[i]);
+	}
+#endif
+
+	/* If there are no subscribers don't bother */
+	if (!count || !stasis_topic_subscribers(topic)) {
+#ifdef AST_DEVMODE
+		ast_atomic_fetchadd_int(&topic->statistics->messages_not_dispatched, count);
+#endif
+		return;
+	}
+
+	/*
+	 * The topic may be unref'ed by the subscription invocation.
+	 * Make sure we hold onto a reference while dispatching.
+	 */
+	ao2_ref(topic, +1);
+#ifdef AST_DEVMODE
+	start = ast_tvnow();
+#endif
+	ao2_lock(topic);
+	for (i = 0; i < AST_VECTOR_SIZE(&topic->subscribers); ++i) {
+		struct stasis_subscription *sub = AST_VECTOR_GET(&topic->subscribers, i);
+
+		ast_assert(sub != NULL);
+#ifdef AST_DEVMODE
+		dispatched +=
+#endif
+			dispatch_batch(sub, messages, count);
+	}
+	ao2_unlock(topic);
+
+#ifdef AST_DEVMODE
+	elapsed = ast_tvdiff_ms(ast_tvnow(), start);
+	if (elapsed > topic->statistics->highest_time_dispatched) {
+		topic->statistics->highest_time_dispatched = elapsed;
+	}
+	if (elapsed < topic->statistics->lowest_time_dispatched) {
+		topic->statistics->lowest_time_dispatched = elapsed;
+	}
+	if (dispatched) {
+		ast_atomic_fetchadd_int(&topic->statistics->messages_dispatched, count);
+	} else {
+		ast_atomic_fetchadd_int(&topic->statistics->messages_not_dispatched, count);
+	}
+#endif
+
+	ao2_ref(topic, -1);
+}
+
 /*!
  * \brief Forwarding information
  *
@@ -2190,6 +3059,10 @@ struct stasis_threadpool_conf {
 	int idle_timeout_sec;
 	/*! Maximum number of thread to allow */
 	int max_size;
+	/*! Use per-worker task queues with work stealing */
+	int work_stealing;
+	/*! Number of serializers shared by hashed pool subscriptions */
+	int serializer_pool_size;
 };
 
 struct stasis_config {
@@ -2472,10 +3345,53 @@ static char *stasis_show_topic(struct ast_cli_entry *e, int cmd, struct ast_cli_
 	return CLI_SUCCESS;
 }
 
+/*!
+ * \internal
+ * \brief CLI command implementation for 'stasis show formatters'
+ */
+static char *stasis_show_formatters(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct stasis_message_formatter_statistics statistics;
+#define FMT_HEADERS		"%-8s %10s %10s %8s\n"
+#define FMT_FIELDS		"%-8s %10d %10d %7d%%\n"
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "stasis show formatters";
+		e->usage =
+		    "Usage: stasis show formatters\n"
+		    "       Show how often message representations were reused.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	stasis_message_formatter_statistics_get(&statistics);
+
+	ast_cli(a->fd, "\n" FMT_HEADERS, "Format", "Hits", "Misses", "Hit rate");
+	ast_cli(a->fd, FMT_FIELDS, "JSON", statistics.json_hits, statistics.json_misses,
+		statistics.json_hits ? (int) ((100LL * statistics.json_hits)
+			/ ((long long) statistics.json_hits + statistics.json_misses)) : 0);
+	ast_cli(a->fd, FMT_FIELDS, "AMI", statistics.ami_hits, statistics.ami_misses,
+		statistics.ami_hits ? (int) ((100LL * statistics.ami_hits)
+			/ ((long long) statistics.ami_hits + statistics.ami_misses)) : 0);
+	ast_cli(a->fd, "\n");
+
+#undef FMT_HEADERS
+#undef FMT_FIELDS
+
+	return CLI_SUCCESS;
+}
+
 
 static struct ast_cli_entry cli_stasis[] = {
 	AST_CLI_DEFINE(stasis_show_topics, "Show all topics"),
 	AST_CLI_DEFINE(stasis_show_topic, "Show topic"),
+	AST_CLI_DEFINE(stasis_show_formatters, "Show message representation reuse"),
 };
 
 
@@ -3050,6 +3966,8 @@ static void stasis_cleanup(void)
 	ast_cli_unregister_multiple(cli_stasis, ARRAY_LEN(cli_stasis));
 	ao2_cleanup(topic_all);
 	topic_all = NULL;
+	ast_serializer_pool_destroy(subscription_serializers);
+	subscription_serializers = NULL;
 	ast_threadpool_shutdown(threadpool);
 	threadpool = NULL;
 	STASIS_MESSAGE_TYPE_CLEANUP(stasis_subscription_change_type);
@@ -3089,6 +4007,13 @@ int stasis_init(void)
 		threadpool_options, "50", OPT_INT_T, PARSE_IN_RANGE,
 		FLDSET(struct stasis_threadpool_conf, max_size), 0,
 		INT_MAX);
+	aco_option_register(&cfg_info, "work_stealing", ACO_EXACT,
+		threadpool_options, "no", OPT_BOOL_T, 1,
+		FLDSET(struct stasis_threadpool_conf, work_stealing));
+	aco_option_register(&cfg_info, "serializer_pool_size", ACO_EXACT,
+		threadpool_options, "8", OPT_INT_T, PARSE_IN_RANGE,
+		FLDSET(struct stasis_threadpool_conf, serializer_pool_size), 0,
+		1024);
 
 	if (aco_process_config(&cfg_info, 0) == ACO_PROCESS_ERROR) {
 		struct stasis_config *default_cfg = stasis_config_alloc();
@@ -3128,14 +4053,27 @@ int stasis_init(void)
 	threadpool_opts.auto_increment = 1;
 	threadpool_opts.max_size = cfg->threadpool_options->max_size;
 	threadpool_opts.idle_timeout = cfg->threadpool_options->idle_timeout_sec;
+	threadpool_opts.work_stealing = cfg->threadpool_options->work_stealing;
 	threadpool = ast_threadpool_create("stasis", NULL, &threadpool_opts);
-	ao2_ref(cfg, -1);
 	if (!threadpool) {
+		ao2_ref(cfg, -1);
 		ast_log(LOG_ERROR, "Failed to create 'stasis-core' threadpool\n");
 
 		return -1;
 	}
 
+	if (cfg->threadpool_options->serializer_pool_size > 0) {
+		subscription_serializers = ast_serializer_pool_create("stasis/h",
+			cfg->threadpool_options->serializer_pool_size, threadpool, -1);
+		if (!subscription_serializers) {
+			ao2_ref(cfg, -1);
+			ast_log(LOG_ERROR, "Failed to create 'stasis/h' serializer pool\n");
+
+			return -1;
+		}
+	}
+	ao2_ref(cfg, -1);
+
 	cache_init = stasis_cache_init();
 	if (cache_init != 0) {
 		return -1;
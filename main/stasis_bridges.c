@@ -748,6 +748,51 @@ struct ast_json *ast_bridge_snapshot_to_json(
 	return json_bridge;
 }
 
+int ast_bridge_snapshot_to_json_writer(const struct ast_bridge_snapshot *snapshot,
+	const struct stasis_message_sanitizer *sanitize, struct ast_json_writer *writer)
+{
+	struct ao2_iterator it;
+	char *item;
+
+	if (snapshot == NULL) {
+		return -1;
+	}
+
+	ast_json_writer_object_start(writer);
+	ast_json_writer_member_string(writer, "id", snapshot->uniqueid);
+	ast_json_writer_member_string(writer, "technology", snapshot->technology);
+	ast_json_writer_member_string(writer, "bridge_type", capability2str(snapshot->capabilities));
+	ast_json_writer_member_string(writer, "bridge_class", snapshot->subclass);
+	ast_json_writer_member_string(writer, "creator", snapshot->creator);
+	ast_json_writer_member_string(writer, "name", snapshot->name);
+
+	ast_json_writer_key(writer, "channels");
+	ast_json_writer_array_start(writer);
+	for (it = ao2_iterator_init(snapshot->channels, 0);
+		(item = ao2_iterator_next(&it)); ao2_cleanup(item)) {
+		if (sanitize && sanitize->channel_id && sanitize->channel_id(item)) {
+			continue;
+		}
+		ast_json_writer_string(writer, item);
+	}
+	ao2_iterator_destroy(&it);
+	ast_json_writer_array_end(writer);
+
+	ast_json_writer_key(writer, "creationtime");
+	ast_json_writer_timeval(writer, snapshot->creationtime, NULL);
+	ast_json_writer_member_string(writer, "video_mode",
+		ast_bridge_video_mode_to_string(snapshot->video_mode));
+
+	if (snapshot->video_mode != AST_BRIDGE_VIDEO_MODE_NONE
+		&& !ast_strlen_zero(snapshot->video_source_id)) {
+		ast_json_writer_member_string(writer, "video_source_id", snapshot->video_source_id);
+	}
+
+	ast_json_writer_object_end(writer);
+
+	return 0;
+}
+
 /*!
  * \internal
  * \brief Allocate the fields of an \ref ast_bridge_channel_snapshot_pair.
@@ -38,13 +38,28 @@
 
 #ifdef LOW_MEMORY
 #define NUM_CACHE_BUCKETS 17
+#define NUM_CACHE_LOCKS 4
 #else
 #define NUM_CACHE_BUCKETS 563
+#define NUM_CACHE_LOCKS 32
 #endif
 
-/*! \internal */
+/*!
+ * \internal
+ *
+ * \details The entries container is sharded so lookups of different
+ * entities do not contend on one container lock.  Each entry has its own
+ * lock protecting its snapshots.  Updates of an entity are ordered by the
+ * entity lock picked from \a entity_locks by the entry hash, which also
+ * makes finding or creating the entry atomic.
+ *
+ * Lock order: entity lock, then container, then entry.  The entry lock is
+ * never held while calling into the container.
+ */
 struct stasis_cache {
 	struct ao2_container *entries;
+	/*! Serialize updates of the entities hashing to each lock */
+	ast_mutex_t entity_locks[NUM_CACHE_LOCKS];
 	snapshot_get_id id_fn;
 	cache_aggregate_calc_fn aggregate_calc_fn;
 	cache_aggregate_publish_fn aggregate_publish_fn;
@@ -221,8 +236,9 @@ static struct stasis_cache_entry *cache_entry_create(struct stasis_message_type
 		return NULL;
 	}
 
+	/* The entry lock protects the snapshots */
 	entry = ao2_alloc_options(sizeof(*entry), cache_entry_dtor,
-		AO2_ALLOC_OPT_LOCK_NOLOCK);
+		AO2_ALLOC_OPT_LOCK_MUTEX);
 	if (!entry) {
 		return NULL;
 	}
@@ -326,9 +342,14 @@ static int cache_entry_cmp(void *obj, void *arg, int flags)
 static void cache_dtor(void *obj)
 {
 	struct stasis_cache *cache = obj;
+	int idx;
 
 	ao2_cleanup(cache->entries);
 	cache->entries = NULL;
+
+	for (idx = 0; idx < NUM_CACHE_LOCKS; ++idx) {
+		ast_mutex_destroy(&cache->entity_locks[idx]);
+	}
 }
 
 struct stasis_cache *stasis_cache_create_full(snapshot_get_id id_fn,
@@ -336,6 +357,7 @@ struct stasis_cache *stasis_cache_create_full(snapshot_get_id id_fn,
 	cache_aggregate_publish_fn aggregate_publish_fn)
 {
 	struct stasis_cache *cache;
+	int idx;
 
 	cache = ao2_alloc_options(sizeof(*cache), cache_dtor,
 		AO2_ALLOC_OPT_LOCK_NOLOCK);
@@ -343,8 +365,13 @@ struct stasis_cache *stasis_cache_create_full(snapshot_get_id id_fn,
 		return NULL;
 	}
 
-	cache->entries = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
-		NUM_CACHE_BUCKETS, cache_entry_hash, NULL, cache_entry_cmp);
+	for (idx = 0; idx < NUM_CACHE_LOCKS; ++idx) {
+		ast_mutex_init(&cache->entity_locks[idx]);
+	}
+
+	cache->entries = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK,
+		AO2_CONTAINER_ALLOC_OPT_SHARDED, NUM_CACHE_BUCKETS, cache_entry_hash, NULL,
+		cache_entry_cmp);
 	if (!cache->entries) {
 		ao2_cleanup(cache);
 		return NULL;
@@ -401,7 +428,7 @@ static struct stasis_cache_entry *cache_find(struct ao2_container *entries, stru
 	search_key.type = type;
 	search_key.id = id;
 	cache_entry_compute_hash(&search_key);
-	entry = ao2_find(entries, &search_key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	entry = ao2_find(entries, &search_key, OBJ_SEARCH_KEY);
 
 	/* Ensure that what we looked for is what we found. */
 	ast_assert(!entry
@@ -410,19 +437,49 @@ static struct stasis_cache_entry *cache_find(struct ao2_container *entries, stru
 	return entry;
 }
 
+/*!
+ * \internal
+ * \brief Get the lock ordering updates of an entity.
+ */
+static ast_mutex_t *cache_entity_lock(struct stasis_cache *cache, struct stasis_message_type *type, const char *id)
+{
+	struct cache_entry_key key;
+
+	key.type = type;
+	key.id = id;
+	cache_entry_compute_hash(&key);
+
+	return &cache->entity_locks[key.hash % NUM_CACHE_LOCKS];
+}
+
+/*!
+ * \internal
+ * \brief Unlock a cache entry, unlinking it from the cache if it became empty.
+ *
+ * \note The entity lock of the entry is held.
+ */
+static void cache_entry_release(struct ao2_container *entries, struct stasis_cache_entry *cached_entry)
+{
+	int empty = !cached_entry->local && !AST_VECTOR_SIZE(&cached_entry->remote);
+
+	ao2_unlock(cached_entry);
+	if (empty) {
+		ao2_unlink(entries, cached_entry);
+	}
+}
+
 /*!
  * \internal
  * \brief Remove the stasis snapshot in the cache entry determined by eid.
  *
- * \param entries Container of cached entries.
  * \param cached_entry The entry to remove the snapshot from.
  * \param eid Which snapshot in the cached entry.
  *
- * \note The entries container is already locked.
+ * \note The cache entry is already locked.
  *
  * \return Previous stasis entry snapshot.
  */
-static struct stasis_message *cache_remove(struct ao2_container *entries, struct stasis_cache_entry *cached_entry, const struct ast_eid *eid)
+static struct stasis_message *cache_remove(struct stasis_cache_entry *cached_entry, const struct ast_eid *eid)
 {
 	struct stasis_message *old_snapshot;
 	int is_remote;
@@ -446,10 +503,6 @@ static struct stasis_message *cache_remove(struct ao2_container *entries, struct
 		}
 	}
 
-	if (!cached_entry->local && !AST_VECTOR_SIZE(&cached_entry->remote)) {
-		ao2_unlink_flags(entries, cached_entry, OBJ_NOLOCK);
-	}
-
 	return old_snapshot;
 }
 
@@ -461,6 +514,8 @@ static struct stasis_message *cache_remove(struct ao2_container *entries, struct
  * \param eid Which snapshot in the cached entry.
  * \param new_snapshot Snapshot to replace the old snapshot.
  *
+ * \note The cache entry is already locked.
+ *
  * \return Previous stasis entry snapshot.
  */
 static struct stasis_message *cache_update(struct stasis_cache_entry *cached_entry, const struct ast_eid *eid, struct stasis_message *new_snapshot)
@@ -508,6 +563,7 @@ static struct cache_put_snapshots cache_put(struct stasis_cache *cache,
 {
 	struct stasis_cache_entry *cached_entry;
 	struct cache_put_snapshots snapshots;
+	ast_mutex_t *entity_lock;
 
 	ast_assert(cache->entries != NULL);
 	ast_assert(eid != NULL);/* Aggregate snapshots not allowed to be put directly. */
@@ -516,7 +572,8 @@ static struct cache_put_snapshots cache_put(struct stasis_cache *cache,
 
 	memset(&snapshots, 0, sizeof(snapshots));
 
-	ao2_wrlock(cache->entries);
+	entity_lock = cache_entity_lock(cache, type, id);
+	ast_mutex_lock(entity_lock);
 
 	cached_entry = cache_find(cache->entries, type, id);
 
@@ -524,27 +581,34 @@ static struct cache_put_snapshots cache_put(struct stasis_cache *cache,
 	if (!new_snapshot) {
 		/* Remove snapshot from cache */
 		if (cached_entry) {
-			snapshots.old = cache_remove(cache->entries, cached_entry, eid);
+			ao2_lock(cached_entry);
+			snapshots.old = cache_remove(cached_entry, eid);
 		}
 	} else if (cached_entry) {
 		/* Update snapshot in cache */
+		ao2_lock(cached_entry);
 		snapshots.old = cache_update(cached_entry, eid, new_snapshot);
 	} else {
 		/* Insert into the cache */
 		cached_entry = cache_entry_create(type, id, new_snapshot);
 		if (cached_entry) {
-			ao2_link_flags(cache->entries, cached_entry, OBJ_NOLOCK);
+			ao2_link(cache->entries, cached_entry);
+			ao2_lock(cached_entry);
 		}
 	}
 
-	/* Update the aggregate snapshot. */
-	if (cache->aggregate_calc_fn && cached_entry) {
-		snapshots.aggregate_new = cache->aggregate_calc_fn(cached_entry, new_snapshot);
-		snapshots.aggregate_old = cached_entry->aggregate;
-		cached_entry->aggregate = ao2_bump(snapshots.aggregate_new);
+	if (cached_entry) {
+		/* Update the aggregate snapshot. */
+		if (cache->aggregate_calc_fn) {
+			snapshots.aggregate_new = cache->aggregate_calc_fn(cached_entry, new_snapshot);
+			snapshots.aggregate_old = cached_entry->aggregate;
+			cached_entry->aggregate = ao2_bump(snapshots.aggregate_new);
+		}
+
+		cache_entry_release(cache->entries, cached_entry);
 	}
 
-	ao2_unlock(cache->entries);
+	ast_mutex_unlock(entity_lock);
 
 	ao2_cleanup(cached_entry);
 	return snapshots;
@@ -602,16 +666,16 @@ struct ao2_container *stasis_cache_get_all(struct stasis_cache *cache, struct st
 		return NULL;
 	}
 
-	ao2_rdlock(cache->entries);
-
 	cached_entry = cache_find(cache->entries, type, id);
-	if (cached_entry && cache_entry_dump(found, cached_entry)) {
-		ao2_cleanup(found);
-		found = NULL;
+	if (cached_entry) {
+		ao2_lock(cached_entry);
+		if (cache_entry_dump(found, cached_entry)) {
+			ao2_cleanup(found);
+			found = NULL;
+		}
+		ao2_unlock(cached_entry);
 	}
 
-	ao2_unlock(cache->entries);
-
 	ao2_cleanup(cached_entry);
 	return found;
 }
@@ -669,16 +733,14 @@ struct stasis_message *stasis_cache_get_by_eid(struct stasis_cache *cache, struc
 		return NULL;
 	}
 
-	ao2_rdlock(cache->entries);
-
 	cached_entry = cache_find(cache->entries, type, id);
 	if (cached_entry) {
+		ao2_lock(cached_entry);
 		snapshot = cache_entry_by_eid(cached_entry, eid);
 		ao2_bump(snapshot);
+		ao2_unlock(cached_entry);
 	}
 
-	ao2_unlock(cache->entries);
-
 	ao2_cleanup(cached_entry);
 	return snapshot;
 }
@@ -702,14 +764,17 @@ static int cache_dump_by_eid_cb(void *obj, void *arg, int flags)
 	if (!cache_dump->type || entry->key.type == cache_dump->type) {
 		struct stasis_message *snapshot;
 
+		ao2_lock(entry);
 		snapshot = cache_entry_by_eid(entry, cache_dump->eid);
 		if (snapshot) {
 			if (!ao2_link(cache_dump->container, snapshot)) {
+				ao2_unlock(entry);
 				ao2_cleanup(cache_dump->container);
 				cache_dump->container = NULL;
 				return CMP_STOP;
 			}
 		}
+		ao2_unlock(entry);
 	}
 
 	return 0;
@@ -744,7 +809,12 @@ static int cache_dump_all_cb(void *obj, void *arg, int flags)
 	struct stasis_cache_entry *entry = obj;
 
 	if (!cache_dump->type || entry->key.type == cache_dump->type) {
-		if (cache_entry_dump(cache_dump->container, entry)) {
+		int err;
+
+		ao2_lock(entry);
+		err = cache_entry_dump(cache_dump->container, entry);
+		ao2_unlock(entry);
+		if (err) {
 			ao2_cleanup(cache_dump->container);
 			cache_dump->container = NULL;
 			return CMP_STOP;
@@ -863,15 +933,20 @@ static void caching_topic_exec(void *data, struct stasis_subscription *sub,
 		 * continue to grow unabated.
 		 */
 		if (strcmp(change->description, "Unsubscribe") == 0) {
+			struct stasis_cache *cache = caching_topic->cache;
 			struct stasis_cache_entry *cached_sub;
+			ast_mutex_t *entity_lock;
 
-			ao2_wrlock(caching_topic->cache->entries);
-			cached_sub = cache_find(caching_topic->cache->entries, stasis_subscription_change_type(), change->uniqueid);
+			entity_lock = cache_entity_lock(cache, stasis_subscription_change_type(), change->uniqueid);
+			ast_mutex_lock(entity_lock);
+			cached_sub = cache_find(cache->entries, stasis_subscription_change_type(), change->uniqueid);
 			if (cached_sub) {
-				ao2_cleanup(cache_remove(caching_topic->cache->entries, cached_sub, stasis_message_eid(message)));
+				ao2_lock(cached_sub);
+				ao2_cleanup(cache_remove(cached_sub, stasis_message_eid(message)));
+				cache_entry_release(cache->entries, cached_sub);
 				ao2_cleanup(cached_sub);
 			}
-			ao2_unlock(caching_topic->cache->entries);
+			ast_mutex_unlock(entity_lock);
 			ao2_cleanup(caching_topic_needs_unref);
 			return;
 		}
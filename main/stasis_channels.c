@@ -267,30 +267,44 @@ static void channel_snapshot_base_dtor(void *obj)
 static struct ast_channel_snapshot_base *channel_snapshot_base_create(struct ast_channel *chan)
 {
 	struct ast_channel_snapshot_base *snapshot;
+	const char *protocol_id = NULL;
+	size_t size;
 
-	snapshot = ao2_alloc_options(sizeof(*snapshot), channel_snapshot_base_dtor,
-		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (ast_channel_tech(chan)->get_pvt_uniqueid) {
+		protocol_id = ast_channel_tech(chan)->get_pvt_uniqueid(chan);
+	}
+
+	/* The strings all fit with the snapshot, the type and language are interned */
+	size = AST_STRING_FIELD_ROOM(strlen(ast_channel_name(chan)))
+		+ AST_STRING_FIELD_ROOM(strlen(ast_channel_accountcode(chan)))
+		+ AST_STRING_FIELD_ROOM(strlen(ast_channel_userfield(chan)))
+		+ AST_STRING_FIELD_ROOM(strlen(ast_channel_uniqueid(chan)))
+		+ AST_STRING_FIELD_ROOM(strlen(S_OR(protocol_id, "")));
+
+	snapshot = ao2_alloc_options(sizeof(*snapshot) + AST_STRING_FIELD_EMBEDDED_SIZE(size),
+		channel_snapshot_base_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!snapshot) {
 		return NULL;
 	}
 
-	if (ast_string_field_init(snapshot, 256) || ast_string_field_init_extended(snapshot, protocol_id)) {
+	if (ast_string_field_init_embedded(snapshot, size)
+		|| ast_string_field_init_extended(snapshot, protocol_id)) {
 		ao2_ref(snapshot, -1);
 		return NULL;
 	}
 
 	ast_string_field_set(snapshot, name, ast_channel_name(chan));
-	ast_string_field_set(snapshot, type, ast_channel_tech(chan)->type);
+	ast_string_field_set_interned(snapshot, type, ast_channel_tech(chan)->type);
 	ast_string_field_set(snapshot, accountcode, ast_channel_accountcode(chan));
 	ast_string_field_set(snapshot, userfield, ast_channel_userfield(chan));
 	ast_string_field_set(snapshot, uniqueid, ast_channel_uniqueid(chan));
-	ast_string_field_set(snapshot, language, ast_channel_language(chan));
+	ast_string_field_set_interned(snapshot, language, ast_channel_language(chan));
 
 	snapshot->creationtime = ast_channel_creationtime(chan);
 	snapshot->tech_properties = ast_channel_tech(chan)->properties;
 
-	if (ast_channel_tech(chan)->get_pvt_uniqueid) {
-		ast_string_field_set(snapshot, protocol_id, ast_channel_tech(chan)->get_pvt_uniqueid(chan));
+	if (protocol_id) {
+		ast_string_field_set(snapshot, protocol_id, protocol_id);
 	}
 
 	return snapshot;
@@ -360,6 +374,43 @@ static struct ast_channel_snapshot_caller *channel_snapshot_caller_create(struct
 	return snapshot;
 }
 
+/*!
+ * \internal
+ * \brief Whether a caller snapshot still has what the channel has
+ *
+ * Checked without allocating, so an unchanged caller is shared with the
+ * old snapshot rather than created again.
+ */
+static int channel_snapshot_caller_current(const struct ast_channel_snapshot_caller *snapshot,
+	struct ast_channel *chan)
+{
+	return snapshot->pres == ast_party_id_presentation(&ast_channel_caller(chan)->id)
+		&& !strcmp(snapshot->name,
+			S_COR(ast_channel_caller(chan)->id.name.valid, ast_channel_caller(chan)->id.name.str, ""))
+		&& !strcmp(snapshot->number,
+			S_COR(ast_channel_caller(chan)->id.number.valid, ast_channel_caller(chan)->id.number.str, ""))
+		&& !strcmp(snapshot->subaddr,
+			S_COR(ast_channel_caller(chan)->id.subaddress.valid, ast_channel_caller(chan)->id.subaddress.str, ""))
+		&& !strcmp(snapshot->ani,
+			S_COR(ast_channel_caller(chan)->ani.number.valid, ast_channel_caller(chan)->ani.number.str, ""))
+		&& !strcmp(snapshot->rdnis,
+			S_COR(ast_channel_redirecting(chan)->from.number.valid, ast_channel_redirecting(chan)->from.number.str, ""))
+		&& !strcmp(snapshot->dnid,
+			S_OR(ast_channel_dialed(chan)->number.str, ""))
+		&& !strcmp(snapshot->dialed_subaddr,
+			S_COR(ast_channel_dialed(chan)->subaddress.valid, ast_channel_dialed(chan)->subaddress.str, ""));
+}
+
+/*! \brief Whether a connected line snapshot still has what the channel has */
+static int channel_snapshot_connected_current(const struct ast_channel_snapshot_connected *snapshot,
+	struct ast_channel *chan)
+{
+	return !strcmp(snapshot->name,
+			S_COR(ast_channel_connected(chan)->id.name.valid, ast_channel_connected(chan)->id.name.str, ""))
+		&& !strcmp(snapshot->number,
+			S_COR(ast_channel_connected(chan)->id.number.valid, ast_channel_connected(chan)->id.number.str, ""));
+}
+
 static struct ast_channel_snapshot_connected *channel_snapshot_connected_create(struct ast_channel *chan)
 {
 	const char *name = S_COR(ast_channel_connected(chan)->id.name.valid, ast_channel_connected(chan)->id.name.str, "");
@@ -412,25 +463,30 @@ static void channel_snapshot_dialplan_dtor(void *obj)
 static struct ast_channel_snapshot_dialplan *channel_snapshot_dialplan_create(struct ast_channel *chan)
 {
 	struct ast_channel_snapshot_dialplan *snapshot;
+	size_t size;
 
-	snapshot = ao2_alloc_options(sizeof(*snapshot), channel_snapshot_dialplan_dtor,
-		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	/* The strings all fit with the snapshot, the application and context are interned */
+	size = AST_STRING_FIELD_ROOM(strlen(S_OR(ast_channel_data(chan), "")))
+		+ AST_STRING_FIELD_ROOM(strlen(ast_channel_exten(chan)));
+
+	snapshot = ao2_alloc_options(sizeof(*snapshot) + AST_STRING_FIELD_EMBEDDED_SIZE(size),
+		channel_snapshot_dialplan_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!snapshot) {
 		return NULL;
 	}
 
-	if (ast_string_field_init(snapshot, 256)) {
+	if (ast_string_field_init_embedded(snapshot, size)) {
 		ao2_ref(snapshot, -1);
 		return NULL;
 	}
 
 	if (ast_channel_appl(chan)) {
-		ast_string_field_set(snapshot, appl, ast_channel_appl(chan));
+		ast_string_field_set_interned(snapshot, appl, ast_channel_appl(chan));
 	}
 	if (ast_channel_data(chan)) {
 		ast_string_field_set(snapshot, data, ast_channel_data(chan));
 	}
-	ast_string_field_set(snapshot, context, ast_channel_context(chan));
+	ast_string_field_set_interned(snapshot, context, ast_channel_context(chan));
 	ast_string_field_set(snapshot, exten, ast_channel_exten(chan));
 	snapshot->priority = ast_channel_priority(chan);
 
@@ -501,18 +557,27 @@ struct ast_channel_snapshot *ast_channel_snapshot_create(struct ast_channel *cha
 	/* Unfortunately both caller and connected information do not have an enforced contract with
 	 * the channel API. This has allowed consumers to directly get the caller or connected structure
 	 * and manipulate it. Until such time as there is an enforced contract (which is being tracked under
-	 * ASTERISK-28164) they are each regenerated every time a channel snapshot is created.
+	 * ASTERISK-28164) they are each checked against the channel every time a channel snapshot is
+	 * created, and only regenerated if they changed.
 	 */
-	snapshot->caller = channel_snapshot_caller_create(chan);
-	if (!snapshot->caller) {
-		ao2_ref(snapshot, -1);
-		return NULL;
+	if (old_snapshot && channel_snapshot_caller_current(old_snapshot->caller, chan)) {
+		snapshot->caller = ao2_bump(old_snapshot->caller);
+	} else {
+		snapshot->caller = channel_snapshot_caller_create(chan);
+		if (!snapshot->caller) {
+			ao2_ref(snapshot, -1);
+			return NULL;
+		}
 	}
 
-	snapshot->connected = channel_snapshot_connected_create(chan);
-	if (!snapshot->connected) {
-		ao2_ref(snapshot, -1);
-		return NULL;
+	if (old_snapshot && channel_snapshot_connected_current(old_snapshot->connected, chan)) {
+		snapshot->connected = ao2_bump(old_snapshot->connected);
+	} else {
+		snapshot->connected = channel_snapshot_connected_create(chan);
+		if (!snapshot->connected) {
+			ao2_ref(snapshot, -1);
+			return NULL;
+		}
 	}
 
 	if (ast_test_flag(ast_channel_snapshot_segment_flags(chan), AST_CHANNEL_SNAPSHOT_INVALIDATE_BRIDGE)) {
@@ -568,6 +633,84 @@ static void channel_snapshot_update_dtor(void *obj)
 	ao2_cleanup(update->new_snapshot);
 }
 
+static int channel_snapshot_vars_equal(const struct varshead *old_vars,
+	const struct varshead *new_vars)
+{
+	const struct ast_var_t *old_var;
+	const struct ast_var_t *new_var;
+
+	if (!old_vars || !new_vars) {
+		return old_vars == new_vars;
+	}
+
+	new_var = AST_LIST_FIRST(new_vars);
+	AST_LIST_TRAVERSE(old_vars, old_var, entries) {
+		if (!new_var || strcmp(old_var->name, new_var->name)
+			|| strcmp(old_var->value, new_var->value)) {
+			return 0;
+		}
+		new_var = AST_LIST_NEXT(new_var, entries);
+	}
+
+	return !new_var;
+}
+
+/*!
+ * \internal
+ * \brief Determine the parts of a channel snapshot that changed.
+ *
+ * Segments that were not invalidated are shared with the old snapshot so
+ * comparing them is cheap.  The caller and connected parts are shared when
+ * unchanged too, but the variable parts are rebuilt for every snapshot and
+ * have to be compared by content.
+ */
+static unsigned int channel_snapshot_changes(const struct ast_channel_snapshot *old_snapshot,
+	const struct ast_channel_snapshot *new_snapshot)
+{
+	unsigned int changed = 0;
+
+	if (!old_snapshot) {
+		return AST_CHANNEL_SNAPSHOT_CHANGED_ALL;
+	}
+
+	if (old_snapshot->base != new_snapshot->base) {
+		changed |= AST_CHANNEL_SNAPSHOT_CHANGED_BASE;
+	}
+	if (old_snapshot->peer != new_snapshot->peer) {
+		changed |= AST_CHANNEL_SNAPSHOT_CHANGED_PEER;
+	}
+	if (old_snapshot->bridge != new_snapshot->bridge) {
+		changed |= AST_CHANNEL_SNAPSHOT_CHANGED_BRIDGE;
+	}
+	if (old_snapshot->dialplan != new_snapshot->dialplan) {
+		changed |= AST_CHANNEL_SNAPSHOT_CHANGED_DIALPLAN;
+	}
+	if (old_snapshot->hangup != new_snapshot->hangup) {
+		changed |= AST_CHANNEL_SNAPSHOT_CHANGED_HANGUP;
+	}
+	if (old_snapshot->caller != new_snapshot->caller
+		&& (old_snapshot->caller->pres != new_snapshot->caller->pres
+			|| ast_string_fields_cmp(old_snapshot->caller, new_snapshot->caller))) {
+		changed |= AST_CHANNEL_SNAPSHOT_CHANGED_CALLER;
+	}
+	if (old_snapshot->connected != new_snapshot->connected
+		&& !ast_channel_snapshot_connected_line_equal(old_snapshot, new_snapshot)) {
+		changed |= AST_CHANNEL_SNAPSHOT_CHANGED_CONNECTED;
+	}
+	if (old_snapshot->state != new_snapshot->state
+		|| old_snapshot->amaflags != new_snapshot->amaflags
+		|| old_snapshot->flags.flags != new_snapshot->flags.flags
+		|| old_snapshot->softhangup_flags.flags != new_snapshot->softhangup_flags.flags) {
+		changed |= AST_CHANNEL_SNAPSHOT_CHANGED_STATE;
+	}
+	if (!channel_snapshot_vars_equal(old_snapshot->manager_vars, new_snapshot->manager_vars)
+		|| !channel_snapshot_vars_equal(old_snapshot->ari_vars, new_snapshot->ari_vars)) {
+		changed |= AST_CHANNEL_SNAPSHOT_CHANGED_VARS;
+	}
+
+	return changed;
+}
+
 static struct ast_channel_snapshot_update *channel_snapshot_update_create(struct ast_channel *chan)
 {
 	struct ast_channel_snapshot_update *update;
@@ -584,6 +727,7 @@ static struct ast_channel_snapshot_update *channel_snapshot_update_create(struct
 		ao2_ref(update, -1);
 		return NULL;
 	}
+	update->changed = channel_snapshot_changes(update->old_snapshot, update->new_snapshot);
 
 	return update;
 }
@@ -1334,6 +1478,77 @@ struct ast_json *ast_channel_snapshot_to_json(
 	return json_chan;
 }
 
+int ast_channel_snapshot_to_json_writer(const struct ast_channel_snapshot *snapshot,
+	const struct stasis_message_sanitizer *sanitize, struct ast_json_writer *writer)
+{
+	if (snapshot == NULL
+		|| (sanitize
+			&& sanitize->channel_snapshot
+			&& sanitize->channel_snapshot(snapshot))) {
+		return -1;
+	}
+
+	ast_json_writer_object_start(writer);
+	ast_json_writer_member_string(writer, "id", snapshot->base->uniqueid);
+	ast_json_writer_member_string(writer, "name", snapshot->base->name);
+	ast_json_writer_member_string(writer, "state", ast_state2str(snapshot->state));
+	ast_json_writer_member_string(writer, "protocol_id", snapshot->base->protocol_id);
+
+	ast_json_writer_key(writer, "caller");
+	ast_json_writer_object_start(writer);
+	ast_json_writer_member_string(writer, "name", AST_JSON_UTF8_VALIDATE(snapshot->caller->name));
+	ast_json_writer_member_string(writer, "number", AST_JSON_UTF8_VALIDATE(snapshot->caller->number));
+	ast_json_writer_object_end(writer);
+
+	ast_json_writer_key(writer, "connected");
+	ast_json_writer_object_start(writer);
+	ast_json_writer_member_string(writer, "name", AST_JSON_UTF8_VALIDATE(snapshot->connected->name));
+	ast_json_writer_member_string(writer, "number", AST_JSON_UTF8_VALIDATE(snapshot->connected->number));
+	ast_json_writer_object_end(writer);
+
+	ast_json_writer_member_string(writer, "accountcode", snapshot->base->accountcode);
+
+	ast_json_writer_key(writer, "dialplan");
+	ast_json_writer_object_start(writer);
+	ast_json_writer_member_string(writer, "context", snapshot->dialplan->context);
+	ast_json_writer_member_string(writer, "exten", snapshot->dialplan->exten);
+	ast_json_writer_key(writer, "priority");
+	if (snapshot->dialplan->priority != -1) {
+		ast_json_writer_integer(writer, snapshot->dialplan->priority);
+	} else {
+		ast_json_writer_null(writer);
+	}
+	ast_json_writer_member_string(writer, "app_name", snapshot->dialplan->appl);
+	ast_json_writer_member_string(writer, "app_data", snapshot->dialplan->data);
+	ast_json_writer_object_end(writer);
+
+	ast_json_writer_key(writer, "creationtime");
+	ast_json_writer_timeval(writer, snapshot->base->creationtime, NULL);
+	ast_json_writer_member_string(writer, "language", snapshot->base->language);
+
+	if (!ast_strlen_zero(snapshot->caller->rdnis)) {
+		ast_json_writer_member_string(writer, "caller_rdnis", snapshot->caller->rdnis);
+	}
+
+	if (snapshot->ari_vars && !AST_LIST_EMPTY(snapshot->ari_vars)) {
+		struct ast_var_t *var;
+
+		ast_json_writer_key(writer, "channelvars");
+		ast_json_writer_object_start(writer);
+		AST_LIST_TRAVERSE(snapshot->ari_vars, var, entries) {
+			/* Values that are not UTF-8 are left out, as ast_json_channel_vars() does */
+			if (ast_json_utf8_check(var->value)) {
+				ast_json_writer_member_string(writer, var->name, var->value);
+			}
+		}
+		ast_json_writer_object_end(writer);
+	}
+
+	ast_json_writer_object_end(writer);
+
+	return 0;
+}
+
 int ast_channel_snapshot_cep_equal(
 	const struct ast_channel_snapshot *old_snapshot,
 	const struct ast_channel_snapshot *new_snapshot)
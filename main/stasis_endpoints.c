@@ -124,6 +124,7 @@ struct stasis_topic *ast_endpoint_topic_all_cached(void)
 }
 
 STASIS_MESSAGE_TYPE_DEFN(ast_endpoint_snapshot_type);
+STASIS_MESSAGE_TYPE_DEFN(ast_endpoint_channel_update_type);
 
 static struct ast_manager_event_blob *peerstatus_to_ami(struct stasis_message *msg)
 {
@@ -448,6 +449,7 @@ struct ast_json *ast_endpoint_snapshot_to_json(
 static void endpoints_stasis_cleanup(void)
 {
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_endpoint_snapshot_type);
+	STASIS_MESSAGE_TYPE_CLEANUP(ast_endpoint_channel_update_type);
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_endpoint_state_type);
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_endpoint_contact_state_type);
 
@@ -467,6 +469,7 @@ int ast_endpoint_stasis_init(void)
 	}
 
 	res |= STASIS_MESSAGE_TYPE_INIT(ast_endpoint_snapshot_type);
+	res |= STASIS_MESSAGE_TYPE_INIT(ast_endpoint_channel_update_type);
 	res |= STASIS_MESSAGE_TYPE_INIT(ast_endpoint_state_type);
 	res |= STASIS_MESSAGE_TYPE_INIT(ast_endpoint_contact_state_type);
 
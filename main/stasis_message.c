@@ -33,6 +33,9 @@
 #include "asterisk/stasis.h"
 #include "asterisk/utils.h"
 #include "asterisk/hashtab.h"
+#include "asterisk/json.h"
+#include "asterisk/lock.h"
+#include "asterisk/manager.h"
 
 /*! \internal */
 struct stasis_message_type {
@@ -117,6 +120,23 @@ enum stasis_subscription_message_formatters stasis_message_type_available_format
 	return type->available_formatters;
 }
 
+/*! Hit and miss counts of the memoized formatter results */
+static struct stasis_message_formatter_statistics formatter_statistics;
+
+/*! Serializes storing memoized formatter results into messages */
+AST_MUTEX_DEFINE_STATIC(formatter_cache_lock);
+
+/*!
+ * \internal
+ * \brief JSON representation memoized for the sanitizer it was built with.
+ */
+struct stasis_message_json_cache {
+	/*! Sanitizer the representation was built with */
+	struct stasis_message_sanitizer *sanitize;
+	/*! The representation, never handed out directly */
+	struct ast_json *json;
+};
+
 /*! \internal */
 struct stasis_message {
 	/*! Time the message was created */
@@ -129,12 +149,21 @@ struct stasis_message {
 	void *data;
 	/*! Where this message originated. */
 	struct ast_eid eid;
+	/*! JSON representation built on first use. */
+	struct stasis_message_json_cache *json_cache;
+	/*! AMI representation built on first use. */
+	struct ast_manager_event_blob *ami;
 };
 
 static void stasis_message_dtor(void *obj)
 {
 	struct stasis_message *message = obj;
 	ao2_cleanup(message->data);
+	if (message->json_cache) {
+		ast_json_unref(message->json_cache->json);
+		ast_free(message->json_cache);
+	}
+	ao2_cleanup(message->ami);
 }
 
 struct stasis_message *stasis_message_create_full(struct stasis_message_type *type, void *data, const struct ast_eid *eid)
@@ -221,16 +250,103 @@ const struct timeval *stasis_message_timestamp(const struct stasis_message *msg)
 		msg->type->vtable->fn(__VA_ARGS__);		\
 	})
 
+/*
+ * The formatter results are memoized in the message.  Messages are
+ * immutable once published, so the first result built is valid for every
+ * consumer.  Racing first users may each build one; only the first one
+ * stored is kept.  Readers do not take formatter_cache_lock.
+ */
+
 struct ast_manager_event_blob *stasis_message_to_ami(struct stasis_message *msg)
 {
-	return INVOKE_VIRTUAL(to_ami, msg);
+	struct ast_manager_event_blob *ami;
+
+	if (!msg) {
+		return NULL;
+	}
+
+	ami = ast_atomic_load_n(&msg->ami, __ATOMIC_ACQUIRE);
+	if (ami) {
+		ast_atomic_fetchadd_int(&formatter_statistics.ami_hits, +1);
+		return ao2_bump(ami);
+	}
+
+	ami = INVOKE_VIRTUAL(to_ami, msg);
+	ast_atomic_fetchadd_int(&formatter_statistics.ami_misses, +1);
+	if (!ami) {
+		return NULL;
+	}
+
+	/* The blob is immutable so it can be shared as it is */
+	ast_mutex_lock(&formatter_cache_lock);
+	if (!msg->ami) {
+		ast_atomic_store_n(&msg->ami, ao2_bump(ami), __ATOMIC_RELEASE);
+	}
+	ast_mutex_unlock(&formatter_cache_lock);
+
+	return ami;
 }
 
 struct ast_json *stasis_message_to_json(
 	struct stasis_message *msg,
 	struct stasis_message_sanitizer *sanitize)
 {
-	return INVOKE_VIRTUAL(to_json, msg, sanitize);
+	struct stasis_message_json_cache *cache;
+	struct ast_json *json;
+
+	if (!msg) {
+		return NULL;
+	}
+
+	/*
+	 * Consumers are allowed to modify the JSON they get, so each one
+	 * gets its own copy of the memoized representation.
+	 */
+	cache = ast_atomic_load_n(&msg->json_cache, __ATOMIC_ACQUIRE);
+	if (cache && cache->sanitize == sanitize) {
+		ast_atomic_fetchadd_int(&formatter_statistics.json_hits, +1);
+		return ast_json_deep_copy(cache->json);
+	}
+
+	json = INVOKE_VIRTUAL(to_json, msg, sanitize);
+	ast_atomic_fetchadd_int(&formatter_statistics.json_misses, +1);
+	if (!json || cache) {
+		/* Only the representation for the first sanitizer used is kept */
+		return json;
+	}
+
+	cache = ast_malloc(sizeof(*cache));
+	if (!cache) {
+		return json;
+	}
+	cache->sanitize = sanitize;
+	cache->json = ast_json_deep_copy(json);
+	if (!cache->json) {
+		ast_free(cache);
+		return json;
+	}
+
+	ast_mutex_lock(&formatter_cache_lock);
+	if (!msg->json_cache) {
+		ast_atomic_store_n(&msg->json_cache, cache, __ATOMIC_RELEASE);
+		cache = NULL;
+	}
+	ast_mutex_unlock(&formatter_cache_lock);
+
+	if (cache) {
+		ast_json_unref(cache->json);
+		ast_free(cache);
+	}
+
+	return json;
+}
+
+void stasis_message_formatter_statistics_get(struct stasis_message_formatter_statistics *statistics)
+{
+	statistics->json_hits = ast_atomic_fetchadd_int(&formatter_statistics.json_hits, 0);
+	statistics->json_misses = ast_atomic_fetchadd_int(&formatter_statistics.json_misses, 0);
+	statistics->ami_hits = ast_atomic_fetchadd_int(&formatter_statistics.ami_hits, 0);
+	statistics->ami_misses = ast_atomic_fetchadd_int(&formatter_statistics.ami_misses, 0);
 }
 
 struct ast_event *stasis_message_to_event(struct stasis_message *msg)
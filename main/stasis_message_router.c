@@ -125,6 +125,26 @@ static void route_table_dtor(struct route_table *table)
 	AST_VECTOR_FREE(table);
 }
 
+/*!
+ * \internal
+ * \brief The routes of a router indexed by message type id
+ *
+ * A table is never changed once built.  Changing the routes builds a new
+ * one, which the router picks up before dispatching its next message.
+ */
+struct route_dispatch {
+	/*! Route of last resort */
+	struct stasis_message_route default_route;
+	/*! How many message type ids each half of routes covers */
+	int size;
+	/*!
+	 * Routes by message type id, followed by the routes for
+	 * \ref stasis_cache_update messages by the id of the type
+	 * updated.  A route without a callback is no route.
+	 */
+	struct stasis_message_route routes[0];
+};
+
 /*! \internal */
 struct stasis_message_router {
 	/*! Subscription to the upstream topic */
@@ -135,6 +155,17 @@ struct stasis_message_router {
 	struct route_table cache_routes;
 	/*! Route of last resort */
 	struct stasis_message_route default_route;
+	/*! The routes above by message type id, NULL if they could not be indexed */
+	struct route_dispatch *dispatch;
+	/*! Incremented each time dispatch is replaced */
+	int dispatch_version;
+	/*!
+	 * The table messages are dispatched with, only used by the
+	 * subscription's mailbox, which dispatches one message at a time.
+	 */
+	struct route_dispatch *dispatching;
+	/*! The dispatch_version of dispatching */
+	int dispatching_version;
 };
 
 static void router_dtor(void *obj)
@@ -148,9 +179,82 @@ static void router_dtor(void *obj)
 
 	route_table_dtor(&router->routes);
 	route_table_dtor(&router->cache_routes);
+	ao2_cleanup(router->dispatch);
+	ao2_cleanup(router->dispatching);
 }
 
-static int find_route(
+/*!
+ * \internal
+ * \brief Index the routes of a router by message type id
+ *
+ * \note The router must be locked.
+ *
+ * \retval 0 on success
+ * \retval -1 if the table could not be built, routing then searches the
+ * route tables until it is
+ */
+static int route_dispatch_build(struct stasis_message_router *router)
+{
+	struct route_dispatch *dispatch;
+	struct stasis_message_route *route;
+	int size = 0;
+	size_t idx;
+
+	for (idx = 0; idx < AST_VECTOR_SIZE(&router->routes); ++idx) {
+		route = AST_VECTOR_GET_ADDR(&router->routes, idx);
+		size = MAX(size, stasis_message_type_id(route->message_type) + 1);
+	}
+	for (idx = 0; idx < AST_VECTOR_SIZE(&router->cache_routes); ++idx) {
+		route = AST_VECTOR_GET_ADDR(&router->cache_routes, idx);
+		size = MAX(size, stasis_message_type_id(route->message_type) + 1);
+	}
+
+	dispatch = ao2_alloc_options(sizeof(*dispatch) + 2 * size * sizeof(*dispatch->routes),
+		NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (dispatch) {
+		dispatch->default_route = router->default_route;
+		dispatch->size = size;
+		for (idx = 0; idx < AST_VECTOR_SIZE(&router->routes); ++idx) {
+			route = AST_VECTOR_GET_ADDR(&router->routes, idx);
+			dispatch->routes[stasis_message_type_id(route->message_type)] = *route;
+		}
+		for (idx = 0; idx < AST_VECTOR_SIZE(&router->cache_routes); ++idx) {
+			route = AST_VECTOR_GET_ADDR(&router->cache_routes, idx);
+			dispatch->routes[size + stasis_message_type_id(route->message_type)] = *route;
+		}
+	}
+
+	ao2_cleanup(router->dispatch);
+	router->dispatch = dispatch;
+	ast_atomic_fetch_add(&router->dispatch_version, 1, __ATOMIC_RELEASE);
+
+	return dispatch ? 0 : -1;
+}
+
+/*!
+ * \internal
+ * \brief Get the table to dispatch a message with
+ *
+ * The router is only locked when the routes have changed since the last
+ * message.
+ */
+static struct route_dispatch *route_dispatch_get(struct stasis_message_router *router)
+{
+	if (ast_atomic_load_n(&router->dispatch_version, __ATOMIC_ACQUIRE) != router->dispatching_version) {
+		ao2_lock(router);
+		ao2_replace(router->dispatching, router->dispatch);
+		router->dispatching_version = router->dispatch_version;
+		ao2_unlock(router);
+	}
+
+	return router->dispatching;
+}
+
+/*!
+ * \internal
+ * \brief Find a route by searching the route tables, for when they could not be indexed
+ */
+static int find_route_in_tables(
 	struct stasis_message_router *router,
 	struct stasis_message *message,
 	struct stasis_message_route *route_out)
@@ -159,8 +263,6 @@ static int find_route(
 	struct stasis_message_type *type = stasis_message_type(message);
 	SCOPED_AO2LOCK(lock, router);
 
-	ast_assert(route_out != NULL);
-
 	if (type == stasis_cache_update_type()) {
 		/* Find a cache route */
 		struct stasis_cache_update *update =
@@ -186,6 +288,49 @@ static int find_route(
 	return 0;
 }
 
+static int find_route(
+	struct stasis_message_router *router,
+	struct stasis_message *message,
+	struct stasis_message_route *route_out)
+{
+	struct route_dispatch *dispatch = route_dispatch_get(router);
+	struct stasis_message_type *type = stasis_message_type(message);
+	int id;
+
+	ast_assert(route_out != NULL);
+
+	if (!dispatch) {
+		return find_route_in_tables(router, message, route_out);
+	}
+
+	if (type == stasis_cache_update_type()) {
+		/* Find a cache route */
+		struct stasis_cache_update *update =
+			stasis_message_data(message);
+
+		id = stasis_message_type_id(update->type);
+		if (id < dispatch->size && dispatch->routes[dispatch->size + id].callback) {
+			*route_out = dispatch->routes[dispatch->size + id];
+			return 0;
+		}
+	}
+
+	/* Find a regular route */
+	id = stasis_message_type_id(type);
+	if (id < dispatch->size && dispatch->routes[id].callback) {
+		*route_out = dispatch->routes[id];
+		return 0;
+	}
+
+	if (dispatch->default_route.callback) {
+		/* Maybe the default route, then? */
+		*route_out = dispatch->default_route;
+		return 0;
+	}
+
+	return -1;
+}
+
 static void router_dispatch(void *data,
 			    struct stasis_subscription *sub,
 			    struct stasis_message *message)
@@ -217,6 +362,7 @@ static struct stasis_message_router *stasis_message_router_create_internal(
 	res = 0;
 	res |= AST_VECTOR_INIT(&router->routes, 0);
 	res |= AST_VECTOR_INIT(&router->cache_routes, 0);
+	res |= route_dispatch_build(router);
 	if (res) {
 		ao2_ref(router, -1);
 
@@ -319,6 +465,11 @@ int stasis_message_router_add(struct stasis_message_router *router,
 	}
 	ao2_lock(router);
 	res = route_table_add(&router->routes, message_type, callback, data);
+	if (!res && route_dispatch_build(router)) {
+		route_table_remove(&router->routes, message_type);
+		route_dispatch_build(router);
+		res = -1;
+	}
 	if (!res) {
 		stasis_subscription_accept_message_type(router->subscription, message_type);
 		/* Until a specific message type was added we would already drop the message, so being
@@ -345,6 +496,11 @@ int stasis_message_router_add_cache_update(struct stasis_message_router *router,
 	}
 	ao2_lock(router);
 	res = route_table_add(&router->cache_routes, message_type, callback, data);
+	if (!res && route_dispatch_build(router)) {
+		route_table_remove(&router->cache_routes, message_type);
+		route_dispatch_build(router);
+		res = -1;
+	}
 	if (!res) {
 		stasis_subscription_accept_message_type(router->subscription, stasis_cache_update_type());
 		stasis_subscription_set_filter(router->subscription, STASIS_SUBSCRIPTION_FILTER_SELECTIVE);
@@ -364,6 +520,7 @@ void stasis_message_router_remove(struct stasis_message_router *router,
 	}
 	ao2_lock(router);
 	route_table_remove(&router->routes, message_type);
+	route_dispatch_build(router);
 	ao2_unlock(router);
 }
 
@@ -379,6 +536,7 @@ void stasis_message_router_remove_cache_update(
 	}
 	ao2_lock(router);
 	route_table_remove(&router->cache_routes, message_type);
+	route_dispatch_build(router);
 	ao2_unlock(router);
 }
 
@@ -405,6 +563,7 @@ void stasis_message_router_set_formatters_default(struct stasis_message_router *
 	ao2_lock(router);
 	router->default_route.callback = callback;
 	router->default_route.data = data;
+	route_dispatch_build(router);
 	ao2_unlock(router);
 
 	if (formatters == STASIS_SUBSCRIPTION_FORMATTER_NONE) {
@@ -424,3 +583,31 @@ void stasis_message_router_accept_formatters(struct stasis_message_router *route
 
 	return;
 }
+
+void stasis_message_router_accept_message_type(struct stasis_message_router *router,
+	struct stasis_message_type *message_type)
+{
+	ast_assert(router != NULL);
+
+	if (!message_type) {
+		return;
+	}
+	ao2_lock(router);
+	stasis_subscription_accept_message_type(router->subscription, message_type);
+	stasis_subscription_set_filter(router->subscription, STASIS_SUBSCRIPTION_FILTER_SELECTIVE);
+	ao2_unlock(router);
+}
+
+void stasis_message_router_decline_message_type(struct stasis_message_router *router,
+	struct stasis_message_type *message_type)
+{
+	ast_assert(router != NULL);
+
+	if (!message_type) {
+		return;
+	}
+	ao2_lock(router);
+	ast_assert(route_table_find(&router->routes, message_type) == NULL);
+	stasis_subscription_decline_message_type(router->subscription, message_type);
+	ao2_unlock(router);
+}
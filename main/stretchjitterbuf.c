@@ -0,0 +1,637 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Time stretching jitterbuffer.
+ *
+ * The adaptive jitterbuffer estimates the delay and decides when to grow
+ * or shrink.  It shrinks by dropping a whole frame and grows by asking
+ * for a frame to be interpolated, both of which are audible.  This
+ * jitterbuffer plays the same frames, but for linear, u-law and a-law
+ * audio:
+ *
+ * \li a frame dropped to shrink is merged with the next frame into a
+ *     single frame with WSOLA (waveform similarity overlap-add), so the
+ *     audio is shortened without a gap.
+ * \li a frame to interpolate is concealed by repeating the last pitch
+ *     period of the audio played so far, fading out when several frames
+ *     in a row are missing, and cross-faded into the next frame.
+ *
+ * Finding the best overlap and pitch period is a search over normalized
+ * cross-correlations, whose dot products are computed with the widest
+ * vector instructions the CPU supports.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+/* Needed for the intrinsics headers */
+#define ASTMM_LIBC ASTMM_IGNORE
+#include "asterisk.h"
+
+#include <math.h>
+
+#include "asterisk/_private.h"
+#include "asterisk/frame.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/ulaw.h"
+#include "asterisk/alaw.h"
+#include "asterisk/utils.h"
+#include "asterisk/logger.h"
+#include "stretchjitterbuf.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STRETCH_DOT_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define STRETCH_DOT_NEON
+#include <arm_neon.h>
+#endif
+
+/*! \brief Highest sample rate audio is stretched at */
+#define STRETCH_MAX_RATE 48000
+/*! \brief Fewest samples a frame must have to be stretched */
+#define STRETCH_MIN_SAMPLES 16
+/*! \brief Shortest pitch period searched for, in microseconds */
+#define STRETCH_MIN_PERIOD_US 2500
+/*! \brief Longest pitch period searched for, in microseconds */
+#define STRETCH_MAX_PERIOD_US 15000
+/*! \brief Number of frames in a row after which concealment is silent */
+#define STRETCH_CONCEAL_FRAMES 5
+
+enum stretch_codec {
+	STRETCH_NONE,
+	STRETCH_SLIN,
+	STRETCH_ULAW,
+	STRETCH_ALAW,
+};
+
+/*! \brief private stretch_jb structure */
+struct stretch_jb {
+	/*! The adaptive jitterbuffer deciding when to grow and shrink */
+	jitterbuf *jb;
+	/*! Format of the audio the buffers hold, NULL until stretchable audio is played */
+	struct ast_format *format;
+	/*! How the audio is coded */
+	enum stretch_codec codec;
+	/*! Samples in a frame */
+	unsigned int samples;
+	/*! Samples over which two segments are cross-faded, a quarter of a frame */
+	unsigned int overlap;
+	/*! Pitch periods searched for, in samples */
+	unsigned int min_period;
+	unsigned int max_period;
+	/*! The audio played last, twice the longest pitch period */
+	float *history;
+	unsigned int history_len;
+	/*! Samples of history which have been played */
+	unsigned int history_filled;
+	/*! A frame dropped to shrink, to be merged with the next one */
+	float *stash;
+	long stash_ts;
+	long stash_len;
+	int stashed;
+	/*! Two frames of audio to work on */
+	float *work;
+	/*! A frame of output */
+	float *out;
+	/*! Continuation of the last concealment, to be cross-faded into the next frame */
+	float *tail;
+	int tailed;
+	/*! Rising half of a Hann window, overlap samples long */
+	float *fade;
+	/*! Frames concealed in a row */
+	unsigned int concealed;
+	/*! A frame of coded audio to build concealment frames from */
+	unsigned char *encoded;
+};
+
+typedef float (*stretch_dot_fn)(const float *a, const float *b, size_t samples);
+
+static float stretch_dot_scalar(const float *a, const float *b, size_t samples)
+{
+	float sum = 0;
+	size_t i;
+
+	for (i = 0; i < samples; ++i) {
+		sum += a[i] * b[i];
+	}
+
+	return sum;
+}
+
+#ifdef STRETCH_DOT_X86
+__attribute__((target("sse2")))
+static float stretch_dot_sse2(const float *a, const float *b, size_t samples)
+{
+	__m128 acc = _mm_setzero_ps();
+	float lanes[4];
+	size_t i;
+
+	for (i = 0; i + 4 <= samples; i += 4) {
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	}
+	_mm_storeu_ps(lanes, acc);
+
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3] + stretch_dot_scalar(a + i, b + i, samples - i);
+}
+
+__attribute__((target("avx")))
+static float stretch_dot_avx(const float *a, const float *b, size_t samples)
+{
+	__m256 acc = _mm256_setzero_ps();
+	__m128 sum;
+	float lanes[4];
+	size_t i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	}
+	sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+	_mm_storeu_ps(lanes, sum);
+
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3] + stretch_dot_scalar(a + i, b + i, samples - i);
+}
+#endif
+
+#ifdef STRETCH_DOT_NEON
+static float stretch_dot_neon(const float *a, const float *b, size_t samples)
+{
+	float32x4_t acc = vdupq_n_f32(0);
+	size_t i;
+
+	for (i = 0; i + 4 <= samples; i += 4) {
+		acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+	}
+
+	return vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1) + vgetq_lane_f32(acc, 2)
+		+ vgetq_lane_f32(acc, 3) + stretch_dot_scalar(a + i, b + i, samples - i);
+}
+#endif
+
+static stretch_dot_fn stretch_dot = stretch_dot_scalar;
+static const char *stretch_dot_name = "scalar";
+
+/*! \brief Normalized cross-correlation of two runs of samples, between -1 and 1 */
+static float stretch_ncc(const float *a, const float *b, size_t samples)
+{
+	float ab = stretch_dot(a, b, samples);
+	float aa = stretch_dot(a, a, samples);
+	float bb = stretch_dot(b, b, samples);
+
+	if (aa <= 0 || bb <= 0) {
+		return 0;
+	}
+
+	return ab / sqrtf(aa * bb);
+}
+
+/*! \brief Cross-fade from one run of samples into another */
+static void stretch_crossfade(const struct stretch_jb *jb, float *out, const float *from, const float *to)
+{
+	unsigned int i;
+
+	for (i = 0; i < jb->overlap; ++i) {
+		out[i] = from[i] * (1 - jb->fade[i]) + to[i] * jb->fade[i];
+	}
+}
+
+static enum stretch_codec stretch_codec_get(struct ast_format *format)
+{
+	if (ast_format_get_sample_rate(format) > STRETCH_MAX_RATE) {
+		return STRETCH_NONE;
+	} else if (ast_format_cache_is_slinear(format)) {
+		return STRETCH_SLIN;
+	} else if (ast_format_cmp(format, ast_format_ulaw) == AST_FORMAT_CMP_EQUAL) {
+		return STRETCH_ULAW;
+	} else if (ast_format_cmp(format, ast_format_alaw) == AST_FORMAT_CMP_EQUAL) {
+		return STRETCH_ALAW;
+	}
+
+	return STRETCH_NONE;
+}
+
+static void stretch_decode(const struct stretch_jb *jb, const void *data, float *out)
+{
+	unsigned int i;
+
+	switch (jb->codec) {
+	case STRETCH_SLIN:
+		for (i = 0; i < jb->samples; ++i) {
+			out[i] = ((const short *) data)[i];
+		}
+		break;
+	case STRETCH_ULAW:
+		for (i = 0; i < jb->samples; ++i) {
+			out[i] = AST_MULAW(((const unsigned char *) data)[i]);
+		}
+		break;
+	case STRETCH_ALAW:
+		for (i = 0; i < jb->samples; ++i) {
+			out[i] = AST_ALAW(((const unsigned char *) data)[i]);
+		}
+		break;
+	case STRETCH_NONE:
+		break;
+	}
+}
+
+static void stretch_encode(const struct stretch_jb *jb, const float *in, void *data)
+{
+	unsigned int i;
+
+	for (i = 0; i < jb->samples; ++i) {
+		float value = in[i] < -32768 ? -32768 : in[i] > 32767 ? 32767 : in[i];
+		short sample = (short) (value < 0 ? value - 0.5f : value + 0.5f);
+
+		switch (jb->codec) {
+		case STRETCH_SLIN:
+			((short *) data)[i] = sample;
+			break;
+		case STRETCH_ULAW:
+			((unsigned char *) data)[i] = AST_LIN2MU(sample);
+			break;
+		case STRETCH_ALAW:
+			((unsigned char *) data)[i] = AST_LIN2A(sample);
+			break;
+		case STRETCH_NONE:
+			break;
+		}
+	}
+}
+
+/*! \brief Forget the audio played so far */
+static void stretch_forget(struct stretch_jb *jb)
+{
+	jb->history_filled = 0;
+	jb->stashed = 0;
+	jb->tailed = 0;
+	jb->concealed = 0;
+}
+
+/*! \brief Release the buffers sized for a format and frame length */
+static void stretch_buffers_free(struct stretch_jb *jb)
+{
+	ao2_cleanup(jb->format);
+	jb->format = NULL;
+	jb->codec = STRETCH_NONE;
+	ast_free(jb->history);
+	jb->history = NULL;
+	ast_free(jb->encoded);
+	jb->encoded = NULL;
+	stretch_forget(jb);
+}
+
+/*!
+ * \brief Make the buffers ready for the audio of a frame
+ *
+ * \retval 0 if the frame can be stretched
+ * \retval -1 if it can not, in which case the audio played so far is forgotten
+ */
+static int stretch_setup(struct stretch_jb *jb, const struct ast_frame *frame)
+{
+	enum stretch_codec codec;
+	unsigned int rate;
+	unsigned int i;
+	size_t floats;
+
+	if (frame->frametype != AST_FRAME_VOICE || !frame->subclass.format
+		|| !frame->data.ptr || frame->samples < STRETCH_MIN_SAMPLES) {
+		stretch_forget(jb);
+		return -1;
+	}
+
+	if (jb->format && jb->samples == frame->samples
+		&& ast_format_cmp(jb->format, frame->subclass.format) == AST_FORMAT_CMP_EQUAL) {
+		return frame->datalen == jb->samples * (jb->codec == STRETCH_SLIN ? 2 : 1) ? 0 : -1;
+	}
+
+	stretch_buffers_free(jb);
+
+	codec = stretch_codec_get(frame->subclass.format);
+	if (codec == STRETCH_NONE
+		|| frame->datalen != frame->samples * (codec == STRETCH_SLIN ? 2 : 1)) {
+		return -1;
+	}
+
+	rate = ast_format_get_sample_rate(frame->subclass.format);
+	jb->samples = frame->samples;
+	jb->overlap = jb->samples / 4;
+	jb->min_period = (unsigned long) rate * STRETCH_MIN_PERIOD_US / 1000000;
+	jb->max_period = (unsigned long) rate * STRETCH_MAX_PERIOD_US / 1000000;
+	jb->history_len = 2 * jb->max_period;
+
+	floats = jb->history_len + 5 * jb->samples + 2 * jb->overlap;
+	jb->history = ast_malloc(floats * sizeof(float));
+	jb->encoded = ast_malloc(jb->samples * sizeof(short));
+	if (!jb->history || !jb->encoded) {
+		stretch_buffers_free(jb);
+		return -1;
+	}
+	jb->stash = jb->history + jb->history_len;
+	jb->work = jb->stash + jb->samples;
+	jb->out = jb->work + 2 * jb->samples;
+	jb->tail = jb->out + jb->samples;
+	jb->fade = jb->tail + jb->overlap;
+
+	for (i = 0; i < jb->overlap; ++i) {
+		jb->fade[i] = 0.5f - 0.5f * cosf(M_PI * (i + 0.5f) / jb->overlap);
+	}
+
+	jb->codec = codec;
+	jb->format = ao2_bump(frame->subclass.format);
+
+	return 0;
+}
+
+/*! \brief Append a frame of played audio to the history */
+static void stretch_history_push(struct stretch_jb *jb, const float *audio)
+{
+	unsigned int len = jb->history_len;
+
+	if (jb->samples >= len) {
+		memcpy(jb->history, audio + jb->samples - len, len * sizeof(float));
+	} else {
+		memmove(jb->history, jb->history + jb->samples, (len - jb->samples) * sizeof(float));
+		memcpy(jb->history + len - jb->samples, audio, jb->samples * sizeof(float));
+	}
+	jb->history_filled = MIN(len, jb->history_filled + jb->samples);
+}
+
+/*!
+ * \brief Compress two frames of audio into one with WSOLA
+ *
+ * The output starts with the start of the first frame and ends with the
+ * end of the second.  In between, a segment from around the middle is
+ * cross-faded in where it best continues the start and best leads into
+ * the end.
+ */
+static void stretch_compress(struct stretch_jb *jb, const float *in, float *out)
+{
+	unsigned int overlap = jb->overlap;
+	unsigned int last = jb->samples + 2 * overlap;
+	unsigned int best = 2 * overlap;
+	float best_score = -3;
+	unsigned int pos;
+
+	for (pos = overlap; pos <= 3 * overlap; ++pos) {
+		float score = stretch_ncc(in + pos, in + overlap, overlap)
+			+ stretch_ncc(in + pos + overlap, in + last, overlap);
+
+		if (score > best_score) {
+			best_score = score;
+			best = pos;
+		}
+	}
+
+	memcpy(out, in, overlap * sizeof(float));
+	stretch_crossfade(jb, out + overlap, in + overlap, in + best);
+	stretch_crossfade(jb, out + 2 * overlap, in + best + overlap, in + last);
+	memcpy(out + 3 * overlap, in + last + overlap, (jb->samples - 3 * overlap) * sizeof(float));
+}
+
+/*! \brief Gain of the concealment after some frames in a row */
+static float stretch_conceal_gain(unsigned int concealed)
+{
+	return concealed >= STRETCH_CONCEAL_FRAMES ? 0 : 1 - (float) concealed / STRETCH_CONCEAL_FRAMES;
+}
+
+/*!
+ * \brief Synthesize a frame and the overlap after it from the history
+ *
+ * The last pitch period of the history is repeated, the period being the
+ * lag at which the end of the history best matches the audio before it.
+ */
+static void stretch_conceal(struct stretch_jb *jb, float *out)
+{
+	const float *end = jb->history + jb->history_len;
+	unsigned int window = jb->max_period;
+	unsigned int best = jb->max_period;
+	float best_score = -2;
+	float from = stretch_conceal_gain(jb->concealed);
+	float to = stretch_conceal_gain(jb->concealed + 1);
+	unsigned int period;
+	unsigned int i;
+
+	for (period = jb->min_period; period <= jb->max_period; ++period) {
+		float score = stretch_ncc(end - window, end - window - period, window);
+
+		if (score > best_score) {
+			best_score = score;
+			best = period;
+		}
+	}
+
+	for (i = 0; i < jb->samples + jb->overlap; ++i) {
+		float gain = i < jb->samples ? from + (to - from) * i / jb->samples : to;
+
+		out[i] = end[(int) (i % best) - (int) best] * gain;
+	}
+}
+
+/*! \brief Keep the audio of a frame dropped to shrink */
+static void stretch_stash(struct stretch_jb *jb, const struct ast_frame *frame)
+{
+	if (stretch_setup(jb, frame)) {
+		return;
+	}
+
+	stretch_decode(jb, frame->data.ptr, jb->stash);
+	jb->stash_ts = frame->ts;
+	jb->stash_len = frame->len;
+	jb->stashed = 1;
+}
+
+/*! \brief Merge a frame to play with a dropped or concealed one before it */
+static void stretch_play(struct stretch_jb *jb, struct ast_frame *frame)
+{
+	float *audio;
+
+	if (stretch_setup(jb, frame)) {
+		return;
+	}
+
+	audio = jb->work + jb->samples;
+	stretch_decode(jb, frame->data.ptr, audio);
+
+	if (jb->stashed && frame->ts == jb->stash_ts + jb->stash_len) {
+		memcpy(jb->work, jb->stash, jb->samples * sizeof(float));
+		stretch_compress(jb, jb->work, jb->out);
+		audio = jb->out;
+	}
+	if (jb->tailed) {
+		stretch_crossfade(jb, audio, jb->tail, audio);
+	}
+	if (jb->stashed || jb->tailed) {
+		stretch_encode(jb, audio, frame->data.ptr);
+	}
+
+	stretch_history_push(jb, audio);
+	jb->stashed = 0;
+	jb->tailed = 0;
+	jb->concealed = 0;
+}
+
+/*!
+ * \brief Build a frame concealing a missing one
+ *
+ * \retval 0 if the frame was built
+ * \retval -1 if there is not enough audio to conceal it with
+ */
+static int stretch_conceal_frame(struct stretch_jb *jb, struct ast_frame **frame, long interpl)
+{
+	struct ast_frame concealment = { .frametype = AST_FRAME_VOICE, };
+
+	if (!jb->format || jb->history_filled < jb->history_len
+		|| ast_format_get_sample_rate(jb->format) * interpl != jb->samples * 1000) {
+		return -1;
+	}
+
+	stretch_conceal(jb, jb->work);
+	stretch_encode(jb, jb->work, jb->encoded);
+
+	concealment.subclass.format = jb->format;
+	concealment.data.ptr = jb->encoded;
+	concealment.datalen = jb->samples * (jb->codec == STRETCH_SLIN ? 2 : 1);
+	concealment.samples = jb->samples;
+	concealment.len = interpl;
+	concealment.src = "stretch_jb concealment";
+
+	*frame = ast_frdup(&concealment);
+	if (!*frame) {
+		return -1;
+	}
+
+	stretch_history_push(jb, jb->work);
+	memcpy(jb->tail, jb->work + jb->samples, jb->overlap * sizeof(float));
+	jb->tailed = 1;
+	jb->stashed = 0;
+	++jb->concealed;
+
+	return 0;
+}
+
+struct stretch_jb *stretch_jb_new(jb_conf *conf)
+{
+	struct stretch_jb *jb;
+
+	jb = ast_calloc(1, sizeof(*jb));
+	if (!jb) {
+		return NULL;
+	}
+
+	jb->jb = jb_new();
+	if (!jb->jb) {
+		ast_free(jb);
+		return NULL;
+	}
+	jb_setconf(jb->jb, conf);
+
+	return jb;
+}
+
+void stretch_jb_destroy(struct stretch_jb *jb)
+{
+	stretch_buffers_free(jb);
+	jb_destroy(jb->jb);
+	ast_free(jb);
+}
+
+enum jb_return_code stretch_jb_put(struct stretch_jb *jb, struct ast_frame *frame, long now)
+{
+	return jb_put(jb->jb, frame, JB_TYPE_VOICE, frame->len, frame->ts, now);
+}
+
+enum jb_return_code stretch_jb_get(struct stretch_jb *jb, struct ast_frame **frame, long now, long interpl)
+{
+	jb_frame jbframe = { .data = &ast_null_frame };
+	long dropped = jb->jb->info.frames_dropped;
+	enum jb_return_code res;
+
+	res = jb_get(jb->jb, &jbframe, now, interpl);
+	*frame = jbframe.data;
+
+	switch (res) {
+	case JB_OK:
+		stretch_play(jb, *frame);
+		break;
+	case JB_DROP:
+		/* Late frames are dropped too, but only shrinking counts as dropped */
+		if (jb->jb->info.frames_dropped != dropped) {
+			stretch_stash(jb, *frame);
+		}
+		break;
+	case JB_INTERP:
+		if (!stretch_conceal_frame(jb, frame, interpl)) {
+			res = JB_OK;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return res;
+}
+
+enum jb_return_code stretch_jb_remove(struct stretch_jb *jb, struct ast_frame **frame)
+{
+	jb_frame jbframe;
+	enum jb_return_code res;
+
+	res = jb_getall(jb->jb, &jbframe);
+	*frame = jbframe.data;
+
+	return res;
+}
+
+long stretch_jb_next(struct stretch_jb *jb)
+{
+	return jb_next(jb->jb);
+}
+
+void stretch_jb_reset(struct stretch_jb *jb)
+{
+	jb_reset(jb->jb);
+	stretch_forget(jb);
+}
+
+int stretch_jb_is_late(struct stretch_jb *jb, long ts)
+{
+	return jb_is_late(jb->jb, ts);
+}
+
+int ast_stretch_jb_init(void)
+{
+#ifdef STRETCH_DOT_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx")) {
+		stretch_dot_name = "avx";
+		stretch_dot = stretch_dot_avx;
+	} else if (__builtin_cpu_supports("sse2")) {
+		stretch_dot_name = "sse2";
+		stretch_dot = stretch_dot_sse2;
+	}
+#elif defined(STRETCH_DOT_NEON)
+	stretch_dot_name = "neon";
+	stretch_dot = stretch_dot_neon;
+#endif
+
+	ast_debug(1, "Using %s time stretching correlation\n", stretch_dot_name);
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Time stretching jitterbuffer.
+ *
+ */
+
+#ifndef _STRETCHJITTERBUF_H_
+#define _STRETCHJITTERBUF_H_
+
+#include "jitterbuf.h"
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+struct ast_frame;
+struct stretch_jb;
+
+/*!
+ * \brief Create a time stretching jitterbuffer
+ *
+ * \param conf The configuration of the underlying adaptive jitterbuffer
+ *
+ * \return The new jitterbuffer, or NULL on failure
+ */
+struct stretch_jb *stretch_jb_new(jb_conf *conf);
+
+/*! \brief Destroy a time stretching jitterbuffer, which must be empty */
+void stretch_jb_destroy(struct stretch_jb *jb);
+
+/*!
+ * \brief Put a frame in the jitterbuffer
+ *
+ * \return The return code of jb_put()
+ */
+enum jb_return_code stretch_jb_put(struct stretch_jb *jb, struct ast_frame *frame, long now);
+
+/*!
+ * \brief Get the frame to play at the given time
+ *
+ * Works like jb_get(), except that a frame of stretchable audio the
+ * adaptive jitterbuffer drops to shrink is merged into the next frame,
+ * and a frame it asks to interpolate is concealed with audio synthesized
+ * from the frames played before, in which cases a frame is returned
+ * with JB_OK.  A concealment frame has been allocated by the jitterbuffer.
+ *
+ * \param jb The jitterbuffer
+ * \param[out] frame The frame to play or drop
+ * \param now The current time
+ * \param interpl The length of the frame to interpolate, in milliseconds
+ *
+ * \return The return code of jb_get()
+ */
+enum jb_return_code stretch_jb_get(struct stretch_jb *jb, struct ast_frame **frame, long now, long interpl);
+
+/*! \brief Remove a frame from the jitterbuffer, as jb_getall() */
+enum jb_return_code stretch_jb_remove(struct stretch_jb *jb, struct ast_frame **frame);
+
+/*! \brief When the next frame should be retrieved, as jb_next() */
+long stretch_jb_next(struct stretch_jb *jb);
+
+/*! \brief Reset the jitterbuffer and forget the audio played so far */
+void stretch_jb_reset(struct stretch_jb *jb);
+
+/*! \brief Whether a frame with the given timestamp would be late, as jb_is_late() */
+int stretch_jb_is_late(struct stretch_jb *jb, long ts);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif /* _STRETCHJITTERBUF_H_ */
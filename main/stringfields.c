@@ -25,7 +25,9 @@
 
 #include "asterisk.h"
 
+#include "asterisk/lock.h"
 #include "asterisk/stringfields.h"
+#include "asterisk/strings.h"
 #include "asterisk/utils.h"
 
 /* this is a little complex... string fields are stored with their
@@ -42,6 +44,67 @@ static const struct {
 
 ast_string_field __ast_string_field_empty = __ast_string_field_empty_buffer.string;
 
+/*!
+ * \brief An interned string
+ *
+ * Like the empty string, it has an allocation of zero in front of it, so
+ * setting the field it is set to always takes new space from the pool.
+ */
+struct interned_string {
+	struct interned_string *next;
+	ast_string_field_allocation allocation;
+	char string[0];
+};
+
+/*! \brief The number of buckets interned strings are hashed over */
+#define INTERNED_BUCKETS 1021
+/*! \brief The most strings interned, as they are never freed */
+#define INTERNED_MAX 8192
+
+static struct interned_string *interned[INTERNED_BUCKETS];
+static unsigned int interned_count;
+AST_RWLOCK_DEFINE_STATIC(interned_lock);
+
+/*!
+ * \internal
+ * \brief Get the address of a field of a manager
+ *
+ * The declared fields are right in front of the manager, any extended
+ * ones follow in its vector.
+ */
+static const char **field_get(struct ast_string_field_mgr *mgr, size_t idx)
+{
+	if (idx < mgr->declared_fields) {
+		return (const char **) mgr - mgr->declared_fields + idx;
+	}
+
+	return AST_VECTOR_GET(&mgr->string_fields, idx - mgr->declared_fields);
+}
+
+static size_t field_count(struct ast_string_field_mgr *mgr)
+{
+	return mgr->declared_fields + AST_VECTOR_SIZE(&mgr->string_fields);
+}
+
+/*!
+ * \internal
+ * \brief Set up the fields of a manager, all empty
+ *
+ * The declared fields are counted rather than put in the vector, so it
+ * is only allocated for extended fields.
+ */
+static void fields_init(struct ast_string_field_mgr *mgr, struct ast_string_field_pool **pool_head)
+{
+	const char **p = (const char **) pool_head + 1;
+
+	AST_VECTOR_INIT(&mgr->string_fields, 0);
+	mgr->declared_fields = 0;
+	while ((struct ast_string_field_mgr *) p != mgr) {
+		*p++ = __ast_string_field_empty;
+		mgr->declared_fields++;
+	}
+}
+
 #define ALLOCATOR_OVERHEAD 48
 
 static size_t optimal_alloc_size(size_t size)
@@ -78,11 +141,6 @@ static int add_string_pool(struct ast_string_field_mgr *mgr, struct ast_string_f
 	return 0;
 }
 
-static void reset_field(const char **p)
-{
-	*p = __ast_string_field_empty;
-}
-
 /*!
  * \brief Internal cleanup function
  * \internal
@@ -106,9 +164,12 @@ int __ast_string_field_free_memory(struct ast_string_field_mgr *mgr,
 {
 	struct ast_string_field_pool *cur = NULL;
 	struct ast_string_field_pool *preserve = NULL;
+	size_t i;
 
 	/* reset all the fields regardless of cleanup type */
-	AST_VECTOR_CALLBACK_VOID(&mgr->string_fields, reset_field);
+	for (i = 0; i < field_count(mgr); i++) {
+		*field_get(mgr, i) = __ast_string_field_empty;
+	}
 
 	switch (cleanup_type) {
 	case AST_STRINGFIELD_DESTROY:
@@ -171,23 +232,13 @@ int __ast_string_field_free_memory(struct ast_string_field_mgr *mgr,
 int __ast_string_field_init(struct ast_string_field_mgr *mgr, struct ast_string_field_pool **pool_head,
 	int needed, const char *file, int lineno, const char *func)
 {
-	const char **p = (const char **) pool_head + 1;
-	size_t initial_vector_size = ((size_t) (((char *)mgr) - ((char *)p))) / sizeof(*p);
-
 	if (needed <= 0) {
 		return __ast_string_field_free_memory(mgr, pool_head, needed, file, lineno, func);
 	}
 
 	mgr->last_alloc = NULL;
 
-	if (AST_VECTOR_INIT(&mgr->string_fields, initial_vector_size)) {
-		return -1;
-	}
-
-	while ((struct ast_string_field_mgr *) p != mgr) {
-		AST_VECTOR_APPEND(&mgr->string_fields, p);
-		*p++ = __ast_string_field_empty;
-	}
+	fields_init(mgr, pool_head);
 
 	*pool_head = NULL;
 	mgr->embedded_pool = NULL;
@@ -199,6 +250,69 @@ int __ast_string_field_init(struct ast_string_field_mgr *mgr, struct ast_string_
 	return 0;
 }
 
+int __ast_string_field_init_embedded(struct ast_string_field_mgr *mgr,
+	struct ast_string_field_pool **pool_head, void *space, size_t size)
+{
+	struct ast_string_field_pool *pool = space;
+
+	mgr->last_alloc = NULL;
+
+	fields_init(mgr, pool_head);
+
+	pool->prev = NULL;
+	pool->size = size;
+	pool->used = pool->active = 0;
+	mgr->embedded_pool = pool;
+	*pool_head = pool;
+
+	return 0;
+}
+
+const char *ast_string_field_intern(const char *str)
+{
+	struct interned_string *entry;
+	unsigned int bucket;
+	size_t len;
+
+	if (ast_strlen_zero(str)) {
+		return __ast_string_field_empty;
+	}
+
+	bucket = (unsigned int) ast_str_hash(str) % INTERNED_BUCKETS;
+
+	ast_rwlock_rdlock(&interned_lock);
+	for (entry = interned[bucket]; entry; entry = entry->next) {
+		if (!strcmp(entry->string, str)) {
+			break;
+		}
+	}
+	ast_rwlock_unlock(&interned_lock);
+	if (entry) {
+		return entry->string;
+	}
+
+	ast_rwlock_wrlock(&interned_lock);
+	/* Another thread may have interned it in between */
+	for (entry = interned[bucket]; entry; entry = entry->next) {
+		if (!strcmp(entry->string, str)) {
+			break;
+		}
+	}
+	if (!entry && interned_count < INTERNED_MAX) {
+		len = strlen(str) + 1;
+		entry = ast_calloc(1, sizeof(*entry) + len);
+		if (entry) {
+			memcpy(entry->string, str, len);
+			entry->next = interned[bucket];
+			interned[bucket] = entry;
+			interned_count++;
+		}
+	}
+	ast_rwlock_unlock(&interned_lock);
+
+	return entry ? entry->string : NULL;
+}
+
 ast_string_field __ast_string_field_alloc_space(struct ast_string_field_mgr *mgr,
 	struct ast_string_field_pool **pool_head, size_t needed,
 	const char *file, int lineno, const char *func)
@@ -387,8 +501,6 @@ void *__ast_calloc_with_stringfields(unsigned int num_structs, size_t struct_siz
 	size_t pool_size_needed = sizeof(*pool) + pool_size;
 	size_t size_to_alloc = optimal_alloc_size(struct_size + pool_size_needed);
 	void *allocation;
-	const char **p;
-	size_t initial_vector_size;
 
 	ast_assert(num_structs == 1);
 
@@ -401,18 +513,8 @@ void *__ast_calloc_with_stringfields(unsigned int num_structs, size_t struct_siz
 
 	pool = allocation + struct_size;
 	pool_head = allocation + field_mgr_pool_offset;
-	p = (const char **) pool_head + 1;
-	initial_vector_size = ((size_t) (((char *)mgr) - ((char *)p))) / sizeof(*p);
 
-	if (AST_VECTOR_INIT(&mgr->string_fields, initial_vector_size)) {
-		ast_free(allocation);
-		return NULL;
-	}
-
-	while ((struct ast_string_field_mgr *) p != mgr) {
-		AST_VECTOR_APPEND(&mgr->string_fields, p);
-		*p++ = __ast_string_field_empty;
-	}
+	fields_init(mgr, pool_head);
 
 	mgr->embedded_pool = pool;
 	*pool_head = pool;
@@ -421,16 +523,16 @@ void *__ast_calloc_with_stringfields(unsigned int num_structs, size_t struct_siz
 	return allocation;
 }
 
-int __ast_string_fields_cmp(struct ast_string_field_vector *left,
-	struct ast_string_field_vector *right)
+int __ast_string_fields_cmp(struct ast_string_field_mgr *left,
+	struct ast_string_field_mgr *right)
 {
-	int i;
+	size_t i;
 	int res = 0;
 
-	ast_assert(AST_VECTOR_SIZE(left) == AST_VECTOR_SIZE(right));
+	ast_assert(field_count(left) == field_count(right));
 
-	for (i = 0; i < AST_VECTOR_SIZE(left); i++) {
-		if ((res = strcmp(*AST_VECTOR_GET(left, i), *AST_VECTOR_GET(right, i)))) {
+	for (i = 0; i < field_count(left); i++) {
+		if ((res = strcmp(*field_get(left, i), *field_get(right, i)))) {
 			return res;
 		}
 	}
@@ -442,20 +544,26 @@ int __ast_string_fields_copy(struct ast_string_field_pool *copy_pool,
 	struct ast_string_field_mgr *copy_mgr, struct ast_string_field_mgr *orig_mgr,
 	const char *file, int lineno, const char *func)
 {
-	int i;
-	struct ast_string_field_vector *dest = &(copy_mgr->string_fields);
-	struct ast_string_field_vector *src = &(orig_mgr->string_fields);
+	size_t i;
 
-	ast_assert(AST_VECTOR_SIZE(dest) == AST_VECTOR_SIZE(src));
+	ast_assert(field_count(copy_mgr) == field_count(orig_mgr));
 
-	for (i = 0; i < AST_VECTOR_SIZE(dest); i++) {
-		__ast_string_field_release_active(copy_pool, *AST_VECTOR_GET(dest, i));
-		*AST_VECTOR_GET(dest, i) = __ast_string_field_empty;
+	for (i = 0; i < field_count(copy_mgr); i++) {
+		__ast_string_field_release_active(copy_pool, *field_get(copy_mgr, i));
+		*field_get(copy_mgr, i) = __ast_string_field_empty;
 	}
 
-	for (i = 0; i < AST_VECTOR_SIZE(dest); i++) {
-		if (__ast_string_field_ptr_set_by_fields(copy_pool, *copy_mgr, AST_VECTOR_GET(dest, i),
-			*AST_VECTOR_GET(src, i), file, lineno, func)) {
+	for (i = 0; i < field_count(copy_mgr); i++) {
+		const char *value = *field_get(orig_mgr, i);
+
+		/* Interned strings, and the empty one, are shared rather than copied */
+		if (!AST_STRING_FIELD_ALLOCATION(value)) {
+			*field_get(copy_mgr, i) = value;
+			continue;
+		}
+
+		if (__ast_string_field_ptr_set_by_fields(copy_pool, *copy_mgr, field_get(copy_mgr, i),
+			value, file, lineno, func)) {
 			return -1;
 		}
 	}
@@ -30,12 +30,24 @@
 #include "asterisk.h"
 
 #include "asterisk/_private.h"
+#include "asterisk/affinity.h"
 #include "asterisk/module.h"
 #include "asterisk/time.h"
 #include "asterisk/astobj2.h"
 #include "asterisk/cli.h"
+#include "asterisk/latency.h"
 #include "asterisk/taskprocessor.h"
 #include "asterisk/sem.h"
+#include "asterisk/threadstorage.h"
+
+#include <sched.h>
+#ifdef HAVE_DLADDR
+#include <dlfcn.h>
+#endif
+
+#if (defined(LOW_MEMORY) || defined(MALLOC_DEBUG)) && !defined(NO_TPS_TASK_CACHE)
+#define NO_TPS_TASK_CACHE
+#endif
 
 /*!
  * \brief tps_task structure is queued to a taskprocessor
@@ -52,41 +64,86 @@ struct tps_task {
 	} callback;
 	/*! \brief The data pointer for the task execute() function */
 	void *datap;
-	/*! \brief AST_LIST_ENTRY overhead */
-	AST_LIST_ENTRY(tps_task) list;
+	/*! \brief Next (newer) task in the queue or task cache */
+	struct tps_task *next;
+	/*! \brief When the task was queued, in ns of the monotonic clock */
+	uint64_t queued;
 	unsigned int wants_local:1;
 };
 
+/*!
+ * \brief Intrusive multi-producer single-consumer task queue
+ *
+ * Producers append to the queue with a single atomic exchange of
+ * \ref back and never take a lock.  The consumer removes from \ref front
+ * and must be serialized by the caller (the taskprocessor lock is held
+ * while removing since a threadpool has many consumers of one queue).
+ *
+ * The queue always contains at least one node.  The embedded \ref stub
+ * takes that place whenever the last real task has to be removed.
+ */
+struct tps_queue {
+	/*! \brief Most recently pushed task.  Producers swap themselves in here. */
+	struct tps_task *back;
+	/*! \brief Oldest task in the queue.  Only touched by the consumer. */
+	struct tps_task *front;
+	/*! \brief Placeholder node so an empty queue needs no special casing by producers */
+	struct tps_task stub;
+};
+
 /*! \brief tps_taskprocessor_stats maintain statistics for a taskprocessor. */
 struct tps_taskprocessor_stats {
 	/*! \brief This is the maximum number of tasks queued at any one time */
 	unsigned long max_qsize;
 	/*! \brief This is the current number of tasks processed */
 	unsigned long _tasks_processed_count;
+	/*! \brief Moving average of the time tasks waited in the queue, in ns */
+	uint64_t wait_avg;
+	/*! \brief Moving average of the time tasks took to execute, in ns */
+	uint64_t exec_avg;
+	/*! \brief The longest time a task took to execute recently, in ns */
+	uint64_t slowest;
+	/*! \brief The function of the task that took the longest recently */
+	void *slowest_task;
+	/*! \brief When the task that took the longest recently finished */
+	uint64_t slowest_at;
 };
 
+/*! \brief The moving averages of taskprocessor statistics weigh each task by 1 / (1 << TPS_AVG_SHIFT) */
+#define TPS_AVG_SHIFT 3
+
+/*! \brief How long the slowest task of a taskprocessor is remembered, in ns */
+#define TPS_SLOWEST_WINDOW (UINT64_C(60) * 1000000000)
+
 /*! \brief A ast_taskprocessor structure is a singleton by name */
 struct ast_taskprocessor {
 	/*! \brief Taskprocessor statistics */
 	struct tps_taskprocessor_stats stats;
 	void *local_data;
-	/*! \brief Taskprocessor current queue size */
+	/*! \brief Taskprocessor current queue size (atomic) */
 	long tps_queue_size;
+	/*!
+	 * \brief Number of pushed tasks that have not finished executing (atomic)
+	 *
+	 * \note A pusher accounts for its task only after it is visible in the
+	 * queue so this can briefly go negative if the task is executed first.
+	 */
+	long tps_pending;
 	/*! \brief Taskprocessor low water clear alert level */
 	long tps_queue_low;
 	/*! \brief Taskprocessor high water alert trigger level */
 	long tps_queue_high;
 	/*! \brief Taskprocessor queue */
-	AST_LIST_HEAD_NOLOCK(tps_queue, tps_task) tps_queue;
+	struct tps_queue tps_queue;
 	struct ast_taskprocessor_listener *listener;
 	/*! Current thread executing the tasks */
 	pthread_t thread;
+	/*! Indicates that a high water alert is active on this taskprocessor (read without the lock) */
+	unsigned int high_water_alert;
 	/*! Indicates if the taskprocessor is currently executing a task */
 	unsigned int executing:1;
 	/*! Indicates that a high water warning has been issued on this task processor */
 	unsigned int high_water_warned:1;
-	/*! Indicates that a high water alert is active on this taskprocessor */
-	unsigned int high_water_alert:1;
 	/*! Indicates if the taskprocessor is currently suspended */
 	unsigned int suspended:1;
 	/*! \brief Anything before the first '/' in the name (if there is one) */
@@ -142,6 +199,9 @@ static ast_cond_t cli_ping_cond;
 /*! \brief CLI <example>taskprocessor ping &lt;blah&gt;</example> operation requires a ping condition lock */
 AST_MUTEX_DEFINE_STATIC(cli_ping_cond_lock);
 
+/*! \brief How long tasks wait in taskprocessor queues before they are executed */
+static struct ast_latency_histogram *tps_wait_latency;
+
 /*! \brief The astobj2 hash callback for taskprocessors */
 static int tps_hash_cb(const void *obj, const int flags);
 /*! \brief The astobj2 compare callback for taskprocessors */
@@ -201,6 +261,8 @@ static void *default_tps_processing_function(void *data)
 	int sem_value;
 	int res;
 
+	ast_thread_affinity_apply(AST_THREAD_AFFINITY_SIGNALING, -1);
+
 	while (!pvt->dead) {
 		res = ast_sem_wait(&pvt->sem);
 		if (res != 0 && errno != EINTR) {
@@ -382,6 +444,9 @@ int ast_tps_init(void)
 
 	ast_cond_init(&cli_ping_cond, NULL);
 
+	tps_wait_latency = ast_latency_histogram_get("taskprocessor_wait",
+		"Time tasks wait in taskprocessor queues");
+
 	ast_cli_register_multiple(taskprocessor_clis, ARRAY_LEN(taskprocessor_clis));
 
 	ast_register_cleanup(tps_shutdown);
@@ -389,6 +454,65 @@ int ast_tps_init(void)
 	return 0;
 }
 
+#if !defined(NO_TPS_TASK_CACHE)
+static void tps_task_cache_cleanup(void *data);
+
+/*! \brief A per-thread cache of free tps_task structures */
+AST_THREADSTORAGE_CUSTOM(tps_task_cache, NULL, tps_task_cache_cleanup);
+
+/*!
+ * \brief Maximum tps_task cache size
+ *
+ * Tasks are freed by the thread executing them which is frequently not the
+ * thread that pushed them.  Threads that mostly execute tasks would otherwise
+ * collect an unbounded number of free tasks so the cache is limited.
+ */
+#define TPS_TASK_CACHE_MAX_SIZE	64
+
+struct tps_task_cache {
+	struct tps_task *head;
+	size_t size;
+};
+
+static void tps_task_cache_cleanup(void *data)
+{
+	struct tps_task_cache *cache = data;
+	struct tps_task *t;
+
+	while ((t = cache->head)) {
+		cache->head = t->next;
+		ast_free(t);
+	}
+
+	ast_free(cache);
+}
+#endif
+
+/* get a zeroed task from the thread's cache or the heap */
+static struct tps_task *tps_task_new(void)
+{
+	struct tps_task *t;
+
+#if !defined(NO_TPS_TASK_CACHE)
+	struct tps_task_cache *cache;
+
+	if ((cache = ast_threadstorage_get(&tps_task_cache, sizeof(*cache)))
+		&& (t = cache->head)) {
+		cache->head = t->next;
+		cache->size--;
+		memset(t, 0, sizeof(*t));
+		return t;
+	}
+#endif
+
+	t = ast_calloc(1, sizeof(*t));
+	if (!t) {
+		ast_log(LOG_ERROR, "failed to allocate task!\n");
+	}
+
+	return t;
+}
+
 /* allocate resources for the task */
 static struct tps_task *tps_task_alloc(int (*task_exe)(void *datap), void *datap)
 {
@@ -398,9 +522,8 @@ static struct tps_task *tps_task_alloc(int (*task_exe)(void *datap), void *datap
 		return NULL;
 	}
 
-	t = ast_calloc(1, sizeof(*t));
+	t = tps_task_new();
 	if (!t) {
-		ast_log(LOG_ERROR, "failed to allocate task!\n");
 		return NULL;
 	}
 
@@ -418,9 +541,8 @@ static struct tps_task *tps_task_alloc_local(int (*task_exe)(struct ast_taskproc
 		return NULL;
 	}
 
-	t = ast_calloc(1, sizeof(*t));
+	t = tps_task_new();
 	if (!t) {
-		ast_log(LOG_ERROR, "failed to allocate task!\n");
 		return NULL;
 	}
 
@@ -434,10 +556,104 @@ static struct tps_task *tps_task_alloc_local(int (*task_exe)(struct ast_taskproc
 /* release task resources */
 static void *tps_task_free(struct tps_task *task)
 {
+#if !defined(NO_TPS_TASK_CACHE)
+	struct tps_task_cache *cache;
+
+	cache = ast_threadstorage_get(&tps_task_cache, sizeof(*cache));
+	if (cache && cache->size < TPS_TASK_CACHE_MAX_SIZE) {
+		task->next = cache->head;
+		cache->head = task;
+		cache->size++;
+		return NULL;
+	}
+#endif
+
 	ast_free(task);
 	return NULL;
 }
 
+static void tps_queue_init(struct tps_queue *queue)
+{
+	queue->stub.next = NULL;
+	queue->back = &queue->stub;
+	queue->front = &queue->stub;
+}
+
+/*!
+ * \internal
+ * \brief Append a task to the queue.
+ *
+ * \note Safe to call from any number of threads without locking.
+ */
+static void tps_queue_insert(struct tps_queue *queue, struct tps_task *task)
+{
+	struct tps_task *prev;
+
+	task->next = NULL;
+	prev = ast_atomic_exchange_n(&queue->back, task, __ATOMIC_ACQ_REL);
+	/*
+	 * Until the following store completes the task is unreachable
+	 * from the front of the queue.  The consumer waits it out.
+	 */
+	ast_atomic_store_n(&prev->next, task, __ATOMIC_RELEASE);
+}
+
+/*!
+ * \internal
+ * \brief Wait for a producer to finish linking the task following the given one.
+ *
+ * \pre The queue back is known to be newer than task.
+ */
+static struct tps_task *tps_queue_wait_next(struct tps_task *task)
+{
+	struct tps_task *next;
+
+	while (!(next = ast_atomic_load_n(&task->next, __ATOMIC_ACQUIRE))) {
+		/* The producer was preempted between its exchange and its link. */
+		sched_yield();
+	}
+
+	return next;
+}
+
+/*!
+ * \internal
+ * \brief Remove the oldest task from the queue.
+ *
+ * \note Only one thread at a time may remove from a queue.
+ *
+ * \retval NULL if the queue is empty.
+ */
+static struct tps_task *tps_queue_remove(struct tps_queue *queue)
+{
+	struct tps_task *front = queue->front;
+	struct tps_task *next = ast_atomic_load_n(&front->next, __ATOMIC_ACQUIRE);
+
+	if (front == &queue->stub) {
+		if (!next) {
+			if (ast_atomic_load_n(&queue->back, __ATOMIC_ACQUIRE) == &queue->stub) {
+				return NULL;
+			}
+			next = tps_queue_wait_next(front);
+		}
+		/* Skip over the stub */
+		queue->front = next;
+		front = next;
+		next = ast_atomic_load_n(&front->next, __ATOMIC_ACQUIRE);
+	}
+
+	if (!next) {
+		if (ast_atomic_load_n(&queue->back, __ATOMIC_ACQUIRE) == front) {
+			/* Last task in the queue.  Put the stub behind it so it can be detached. */
+			tps_queue_insert(queue, &queue->stub);
+		}
+		next = tps_queue_wait_next(front);
+	}
+
+	queue->front = next;
+	return front;
+}
+
 /* Taskprocessor tab completion.
  *
  * The caller of this function is responsible for argument
@@ -574,8 +790,41 @@ static int tps_sort_cb(const void *obj_left, const void *obj_right, int flags)
 	return cmp;
 }
 
-#define FMT_HEADERS		"%-70s %10s %10s %10s %10s %10s\n"
-#define FMT_FIELDS		"%-70s %10lu %10lu %10lu %10lu %10lu\n"
+#define FMT_HEADERS		"%-70s %10s %10s %10s %10s %10s %10s %10s %12s %s\n"
+#define FMT_FIELDS		"%-70s %10lu %10lu %10lu %10lu %10lu %10" PRIu64 " %10" PRIu64 " %12" PRIu64 " %s\n"
+
+/*!
+ * \internal
+ * \brief Name the function of a task
+ *
+ * Functions that are not exported are named by their offset in the
+ * library that holds them, for addr2line.
+ */
+static const char *tps_task_name(void *task, char *buf, size_t size)
+{
+#ifdef HAVE_DLADDR
+	Dl_info info;
+
+	if (task && dladdr(task, &info) && info.dli_fname) {
+		const char *lib = strrchr(info.dli_fname, '/');
+
+		lib = lib ? lib + 1 : info.dli_fname;
+		if (info.dli_sname && info.dli_saddr == task) {
+			snprintf(buf, size, "%s(%s)", lib, info.dli_sname);
+		} else {
+			snprintf(buf, size, "%s+%#lx", lib,
+				(unsigned long) ((char *) task - (char *) info.dli_fbase));
+		}
+		return buf;
+	}
+#endif
+
+	if (!task) {
+		return "";
+	}
+	snprintf(buf, size, "%p", task);
+	return buf;
+}
 
 /*!
  * \internal
@@ -587,9 +836,17 @@ static int tps_sort_cb(const void *obj_left, const void *obj_right, int flags)
  */
 static void tps_report_taskprocessor_list_helper(int fd, struct ast_taskprocessor *tps)
 {
-	ast_cli(fd, FMT_FIELDS, tps->name, tps->stats._tasks_processed_count,
-		tps->tps_queue_size, tps->stats.max_qsize, tps->tps_queue_low,
-		tps->tps_queue_high);
+	struct tps_taskprocessor_stats stats;
+	char task[256];
+
+	ao2_lock(tps);
+	stats = tps->stats;
+	ao2_unlock(tps);
+
+	ast_cli(fd, FMT_FIELDS, tps->name, stats._tasks_processed_count,
+		ast_taskprocessor_size(tps), stats.max_qsize, tps->tps_queue_low,
+		tps->tps_queue_high, stats.wait_avg / 1000, stats.exec_avg / 1000,
+		stats.slowest / 1000, tps_task_name(stats.slowest_task, task, sizeof(task)));
 }
 
 /*!
@@ -649,7 +906,10 @@ static char *cli_tps_report(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 		e->command = "core show taskprocessors [like]";
 		e->usage =
 			"Usage: core show taskprocessors [like keyword]\n"
-			"	Shows a list of instantiated task processors and their statistics\n";
+			"	Shows a list of instantiated task processors and their statistics\n"
+			"	Wait and Exec are moving averages of how long tasks waited in the\n"
+			"	queue and took to execute.  Slowest is the longest a task recently\n"
+			"	took to execute, and Slowest task its function.\n";
 		return NULL;
 	case CLI_GENERATE:
 		if (a->pos == e->args) {
@@ -667,7 +927,8 @@ static char *cli_tps_report(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 		return CLI_SHOWUSAGE;
 	}
 
-	ast_cli(a->fd, "\n" FMT_HEADERS, "Processor", "Processed", "In Queue", "Max Depth", "Low water", "High water");
+	ast_cli(a->fd, "\n" FMT_HEADERS, "Processor", "Processed", "In Queue", "Max Depth", "Low water", "High water",
+		"Wait (us)", "Exec (us)", "Slowest (us)", "Slowest task");
 	ast_cli(a->fd, "\n%d taskprocessors\n\n", tps_report_taskprocessor_list(a->fd, like));
 
 	return CLI_SUCCESS;
@@ -894,6 +1155,8 @@ unsigned int ast_taskprocessor_alert_get(void)
 
 int ast_taskprocessor_alert_set_levels(struct ast_taskprocessor *tps, long low_water, long high_water)
 {
+	long size;
+
 	if (!tps || high_water < 0 || high_water < low_water) {
 		return -1;
 	}
@@ -908,16 +1171,17 @@ int ast_taskprocessor_alert_set_levels(struct ast_taskprocessor *tps, long low_w
 	tps->tps_queue_low = low_water;
 	tps->tps_queue_high = high_water;
 
+	size = ast_taskprocessor_size(tps);
 	if (tps->high_water_alert) {
-		if (!tps->tps_queue_size || tps->tps_queue_size < low_water) {
+		if (!size || size < low_water) {
 			/* Update water mark alert immediately */
-			tps->high_water_alert = 0;
+			ast_atomic_store_n(&tps->high_water_alert, 0, __ATOMIC_RELAXED);
 			tps_alert_add(tps, -1);
 		}
 	} else {
-		if (high_water < tps->tps_queue_size) {
+		if (high_water < size) {
 			/* Update water mark alert immediately */
-			tps->high_water_alert = 1;
+			ast_atomic_store_n(&tps->high_water_alert, 1, __ATOMIC_RELAXED);
 			tps_alert_add(tps, +1);
 		}
 	}
@@ -933,10 +1197,11 @@ static void tps_taskprocessor_dtor(void *tps)
 	struct ast_taskprocessor *t = tps;
 	struct tps_task *task;
 
-	while ((task = AST_LIST_REMOVE_HEAD(&t->tps_queue, list))) {
+	while ((task = tps_queue_remove(&t->tps_queue))) {
 		tps_task_free(task);
 	}
 	t->tps_queue_size = 0;
+	t->tps_pending = 0;
 
 	if (t->high_water_alert) {
 		t->high_water_alert = 0;
@@ -947,15 +1212,21 @@ static void tps_taskprocessor_dtor(void *tps)
 	t->listener = NULL;
 }
 
-/* pop the front task and return it */
+/*!
+ * \internal
+ * \brief Pop the front task and return it
+ *
+ * \pre tps is locked
+ */
 static struct tps_task *tps_taskprocessor_pop(struct ast_taskprocessor *tps)
 {
 	struct tps_task *task;
+	long size;
 
-	if ((task = AST_LIST_REMOVE_HEAD(&tps->tps_queue, list))) {
-		--tps->tps_queue_size;
-		if (tps->high_water_alert && tps->tps_queue_size <= tps->tps_queue_low) {
-			tps->high_water_alert = 0;
+	if ((task = tps_queue_remove(&tps->tps_queue))) {
+		size = ast_atomic_sub_fetch(&tps->tps_queue_size, 1, __ATOMIC_RELAXED);
+		if (tps->high_water_alert && size <= tps->tps_queue_low) {
+			ast_atomic_store_n(&tps->high_water_alert, 0, __ATOMIC_RELAXED);
 			tps_alert_add(tps, -1);
 		}
 	}
@@ -964,7 +1235,7 @@ static struct tps_task *tps_taskprocessor_pop(struct ast_taskprocessor *tps)
 
 long ast_taskprocessor_size(struct ast_taskprocessor *tps)
 {
-	return (tps) ? tps->tps_queue_size : -1;
+	return (tps) ? ast_atomic_load_n(&tps->tps_queue_size, __ATOMIC_RELAXED) : -1;
 }
 
 /* taskprocessor name accessor */
@@ -1067,6 +1338,7 @@ static struct ast_taskprocessor *__allocate_taskprocessor(const char *name, stru
 	/* Set default congestion water level alert triggers. */
 	p->tps_queue_low = (AST_TASKPROCESSOR_HIGH_WATER_LEVEL * 9) / 10;
 	p->tps_queue_high = AST_TASKPROCESSOR_HIGH_WATER_LEVEL;
+	tps_queue_init(&p->tps_queue);
 
 	strcpy(p->name, name); /* Safe */
 	p->subsystem = p->name + name_length + 1;
@@ -1200,10 +1472,37 @@ void *ast_taskprocessor_unreference(struct ast_taskprocessor *tps)
 	return NULL;
 }
 
-/* push the task into the taskprocessor queue */
+/*!
+ * \internal
+ * \brief Raise the high water alert if the queue is still above the trigger level.
+ */
+static void tps_high_water_check(struct ast_taskprocessor *tps)
+{
+	long size;
+
+	ao2_lock(tps);
+	size = ast_taskprocessor_size(tps);
+	if (!tps->high_water_alert && tps->tps_queue_high <= size) {
+		ast_log(LOG_WARNING, "The '%s' task processor queue reached %ld scheduled tasks%s.\n",
+			tps->name, size, tps->high_water_warned ? " again" : "");
+		tps->high_water_warned = 1;
+		ast_atomic_store_n(&tps->high_water_alert, 1, __ATOMIC_RELAXED);
+		tps_alert_add(tps, +1);
+	}
+	ao2_unlock(tps);
+}
+
+/*!
+ * \internal
+ * \brief Push the task into the taskprocessor queue
+ *
+ * \note The taskprocessor lock is only taken here when the queue
+ * crosses the high water level.
+ */
 static int taskprocessor_push(struct ast_taskprocessor *tps, struct tps_task *t)
 {
-	int previous_size;
+	long size;
+	long previous_pending;
 	int was_empty;
 
 	if (!tps) {
@@ -1216,23 +1515,25 @@ static int taskprocessor_push(struct ast_taskprocessor *tps, struct tps_task *t)
 		return -1;
 	}
 
-	ao2_lock(tps);
-	AST_LIST_INSERT_TAIL(&tps->tps_queue, t, list);
-	previous_size = tps->tps_queue_size++;
-
-	if (tps->tps_queue_high <= tps->tps_queue_size) {
-		if (!tps->high_water_alert) {
-			ast_log(LOG_WARNING, "The '%s' task processor queue reached %ld scheduled tasks%s.\n",
-				tps->name, tps->tps_queue_size, tps->high_water_warned ? " again" : "");
-			tps->high_water_warned = 1;
-			tps->high_water_alert = 1;
-			tps_alert_add(tps, +1);
-		}
+	t->queued = ast_latency_now();
+
+	/* Account for the task before the consumer can see it so the size never goes negative. */
+	size = ast_atomic_add_fetch(&tps->tps_queue_size, 1, __ATOMIC_RELAXED);
+	tps_queue_insert(&tps->tps_queue, t);
+
+	if (tps->tps_queue_high <= size
+		&& !ast_atomic_load_n(&tps->high_water_alert, __ATOMIC_RELAXED)) {
+		tps_high_water_check(tps);
 	}
 
-	/* The currently executing task counts as still in queue */
-	was_empty = tps->executing ? 0 : previous_size == 0;
-	ao2_unlock(tps);
+	/*
+	 * The currently executing task counts as still pending.  This must
+	 * happen after the task is queued.  If it were counted first a consumer
+	 * could find the counter non-zero, fail to find the task and stop
+	 * without anyone being told the taskprocessor needs servicing.
+	 */
+	previous_pending = ast_atomic_fetch_add(&tps->tps_pending, 1, __ATOMIC_ACQ_REL);
+	was_empty = previous_pending == 0;
 	tps->listener->callbacks->task_pushed(tps->listener, was_empty);
 	return 0;
 }
@@ -1274,11 +1575,29 @@ int ast_taskprocessor_is_suspended(struct ast_taskprocessor *tps)
 	return tps ? tps->suspended : -1;
 }
 
+/*!
+ * \internal
+ * \brief Add a sample to a moving average of taskprocessor statistics
+ */
+static void tps_stats_average(uint64_t *avg, uint64_t sample)
+{
+	if (!*avg) {
+		*avg = sample;
+	} else {
+		*avg += ((int64_t) sample - (int64_t) *avg) / (1 << TPS_AVG_SHIFT);
+	}
+}
+
 int ast_taskprocessor_execute(struct ast_taskprocessor *tps)
 {
 	struct ast_taskprocessor_local local;
 	struct tps_task *t;
 	long size;
+	long pending;
+	uint64_t start;
+	uint64_t wait;
+	uint64_t exec;
+	void *task;
 
 	ao2_lock(tps);
 	t = tps_taskprocessor_pop(tps);
@@ -1296,12 +1615,21 @@ int ast_taskprocessor_execute(struct ast_taskprocessor *tps)
 	}
 	ao2_unlock(tps);
 
+	start = ast_latency_now();
+	wait = start - t->queued;
+	if (ast_option_latency_histograms) {
+		ast_latency_record(tps_wait_latency, wait);
+	}
+
 	if (t->wants_local) {
+		task = (void *) t->callback.execute_local;
 		t->callback.execute_local(&local);
 	} else {
+		task = (void *) t->callback.execute;
 		t->callback.execute(t->datap);
 	}
 	tps_task_free(t);
+	exec = ast_latency_now() - start;
 
 	ao2_lock(tps);
 	tps->thread = AST_PTHREADT_NULL;
@@ -1310,10 +1638,19 @@ int ast_taskprocessor_execute(struct ast_taskprocessor *tps)
 	 * after we pop an empty stack.
 	 */
 	tps->executing = 0;
+	pending = ast_atomic_sub_fetch(&tps->tps_pending, 1, __ATOMIC_ACQ_REL);
 	size = ast_taskprocessor_size(tps);
 
 	/* Update the stats */
 	++tps->stats._tasks_processed_count;
+	tps_stats_average(&tps->stats.wait_avg, wait);
+	tps_stats_average(&tps->stats.exec_avg, exec);
+	if (exec >= tps->stats.slowest
+		|| start + exec - tps->stats.slowest_at > TPS_SLOWEST_WINDOW) {
+		tps->stats.slowest = exec;
+		tps->stats.slowest_task = task;
+		tps->stats.slowest_at = start + exec;
+	}
 
 	/* Include the task we just executed as part of the queue size. */
 	if (size >= tps->stats.max_qsize) {
@@ -1321,11 +1658,15 @@ int ast_taskprocessor_execute(struct ast_taskprocessor *tps)
 	}
 	ao2_unlock(tps);
 
-	/* If we executed a task, check for the transition to empty */
-	if (size == 0 && tps->listener->callbacks->emptied) {
+	/*
+	 * If we executed a task, check for the transition to empty.  A pending
+	 * count at or below zero means any task still queued has a pusher that
+	 * has yet to account for it and will be told the queue was empty.
+	 */
+	if (pending <= 0 && tps->listener->callbacks->emptied) {
 		tps->listener->callbacks->emptied(tps->listener);
 	}
-	return size > 0;
+	return pending > 0;
 }
 
 int ast_taskprocessor_is_task(struct ast_taskprocessor *tps)
@@ -1383,11 +1724,35 @@ void ast_taskprocessor_build_name(char *buf, unsigned int size, const char *form
 	snprintf(buf + user_size, SEQ_STR_SIZE, "-%08x", ast_taskprocessor_seq_num());
 }
 
+void ast_taskprocessor_stats_foreach(ast_taskprocessor_stats_cb callback, void *data)
+{
+	struct ao2_iterator iter;
+	struct ast_taskprocessor *tps;
+
+	iter = ao2_iterator_init(tps_singletons, 0);
+	while ((tps = ao2_iterator_next(&iter))) {
+		struct ast_taskprocessor_stats stats = { .name = tps->name, };
+
+		ao2_lock(tps);
+		stats.processed = tps->stats._tasks_processed_count;
+		stats.max_depth = tps->stats.max_qsize;
+		stats.wait_avg = tps->stats.wait_avg;
+		stats.exec_avg = tps->stats.exec_avg;
+		stats.slowest = tps->stats.slowest;
+		stats.slowest_task = tps->stats.slowest_task;
+		ao2_unlock(tps);
+		stats.queued = ast_taskprocessor_size(tps);
+
+		callback(&stats, data);
+		ao2_ref(tps, -1);
+	}
+	ao2_iterator_destroy(&iter);
+}
+
 static void tps_reset_stats(struct ast_taskprocessor *tps)
 {
 	ao2_lock(tps);
-	tps->stats._tasks_processed_count = 0;
-	tps->stats.max_qsize = 0;
+	memset(&tps->stats, 0, sizeof(tps->stats));
 	ao2_unlock(tps);
 }
 
@@ -466,6 +466,17 @@ static int __ssl_setup(struct ast_tls_config *cfg, int client)
 
 	SSL_CTX_set_options(cfg->ssl_ctx, ssl_opts);
 
+	if (!client) {
+		/*
+		 * Let clients resume their sessions on new connections instead of
+		 * making a full handshake every time.  The session id context is
+		 * required for that once client certificates are verified.
+		 */
+		SSL_CTX_set_session_cache_mode(cfg->ssl_ctx, SSL_SESS_CACHE_SERVER);
+		SSL_CTX_set_session_id_context(cfg->ssl_ctx, (const unsigned char *) "asterisk",
+			strlen("asterisk"));
+	}
+
 	SSL_CTX_set_verify(cfg->ssl_ctx,
 		ast_test_flag(&cfg->flags, AST_SSL_VERIFY_CLIENT) ? SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT : SSL_VERIFY_NONE,
 		NULL);
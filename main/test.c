@@ -1320,11 +1320,343 @@ static char *test_cli_generate_results(struct ast_cli_entry *e, int cmd, struct
 	return CLI_SUCCESS;
 }
 
+/*! \brief A registered benchmark */
+struct ast_bench {
+	const struct ast_bench_info *info;
+	AST_LIST_ENTRY(ast_bench) entry;
+};
+
+static AST_LIST_HEAD_STATIC(benches, ast_bench);
+
+/*! \brief Iterations timed by benchmarks not asking for a number */
+#define BENCH_DEFAULT_ITERATIONS 10000
+
+/*! \brief The results of running a benchmark, in nanoseconds per operation */
+struct bench_result {
+	unsigned int iterations;
+	unsigned int batch;
+	double min;
+	double mean;
+	double p50;
+	double p90;
+	double p99;
+	double max;
+};
+
+int ast_bench_register(const struct ast_bench_info *info)
+{
+	struct ast_bench *bench;
+
+	if (ast_strlen_zero(info->name) || ast_strlen_zero(info->category) || !info->run) {
+		ast_log(LOG_ERROR, "A benchmark needs a name, a category and an operation to run\n");
+		return -1;
+	}
+
+	bench = ast_calloc(1, sizeof(*bench));
+	if (!bench) {
+		return -1;
+	}
+	bench->info = info;
+
+	AST_LIST_LOCK(&benches);
+	AST_LIST_INSERT_SORTALPHA(&benches, bench, entry, info->category);
+	AST_LIST_UNLOCK(&benches);
+
+	return 0;
+}
+
+int ast_bench_unregister(const struct ast_bench_info *info)
+{
+	struct ast_bench *bench;
+
+	AST_LIST_LOCK(&benches);
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&benches, bench, entry) {
+		if (bench->info == info) {
+			AST_LIST_REMOVE_CURRENT(entry);
+			break;
+		}
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+	AST_LIST_UNLOCK(&benches);
+
+	if (!bench) {
+		return -1;
+	}
+	ast_free(bench);
+
+	return 0;
+}
+
+static uint64_t bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int bench_sample_cmp(const void *a, const void *b)
+{
+	uint64_t left = *(const uint64_t *) a;
+	uint64_t right = *(const uint64_t *) b;
+
+	return left < right ? -1 : left > right;
+}
+
+/*!
+ * \internal
+ * \brief Run a benchmark
+ *
+ * \param info The benchmark
+ * \param iterations Iterations to time, zero for what the benchmark asks for
+ * \param[out] result How long the operation took
+ *
+ * \retval 0 success
+ * \retval -1 if the benchmark could not be set up
+ */
+static int bench_run(const struct ast_bench_info *info, unsigned int iterations,
+	struct bench_result *result)
+{
+	unsigned int batch = info->batch ?: 1;
+	unsigned int warmup;
+	uint64_t *samples;
+	uint64_t total = 0;
+	void *data = NULL;
+	unsigned int i;
+	unsigned int j;
+
+	if (!iterations) {
+		iterations = info->iterations ?: BENCH_DEFAULT_ITERATIONS;
+	}
+	warmup = info->warmup ?: iterations / 10;
+
+	samples = ast_malloc(sizeof(*samples) * iterations);
+	if (!samples) {
+		return -1;
+	}
+
+	if (info->setup && !(data = info->setup())) {
+		ast_free(samples);
+		return -1;
+	}
+
+	for (i = 0; i < warmup; i++) {
+		for (j = 0; j < batch; j++) {
+			info->run(data);
+		}
+	}
+
+	for (i = 0; i < iterations; i++) {
+		uint64_t start = bench_now_ns();
+
+		for (j = 0; j < batch; j++) {
+			info->run(data);
+		}
+		samples[i] = bench_now_ns() - start;
+		total += samples[i];
+	}
+
+	if (info->teardown) {
+		info->teardown(data);
+	}
+
+	qsort(samples, iterations, sizeof(*samples), bench_sample_cmp);
+
+	result->iterations = iterations;
+	result->batch = batch;
+	result->min = (double) samples[0] / batch;
+	result->mean = (double) total / iterations / batch;
+	result->p50 = (double) samples[(iterations - 1) * 50 / 100] / batch;
+	result->p90 = (double) samples[(iterations - 1) * 90 / 100] / batch;
+	result->p99 = (double) samples[(iterations - 1) * 99 / 100] / batch;
+	result->max = (double) samples[iterations - 1] / batch;
+
+	ast_free(samples);
+
+	return 0;
+}
+
+static char *complete_bench_category(const char *word)
+{
+	int wordlen = strlen(word);
+	struct ast_bench *bench;
+
+	AST_LIST_LOCK(&benches);
+	AST_LIST_TRAVERSE(&benches, bench, entry) {
+		if (!strncasecmp(word, bench->info->category, wordlen)) {
+			if (ast_cli_completion_add(ast_strdup(bench->info->category))) {
+				break;
+			}
+		}
+	}
+	AST_LIST_UNLOCK(&benches);
+
+	return NULL;
+}
+
+static char *test_cli_bench_show_registered(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+#define FORMAT_BENCH_SHOW "%-25.25s %-30.30s %-50.50s\n"
+	struct ast_bench *bench;
+	int count = 0;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "test bench show registered";
+		e->usage =
+			"Usage: test bench show registered\n"
+			"       Shows all registered benchmarks.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_cli(a->fd, FORMAT_BENCH_SHOW, "Category", "Name", "Summary");
+	ast_cli(a->fd, FORMAT_BENCH_SHOW, "--------", "----", "-------");
+	AST_LIST_LOCK(&benches);
+	AST_LIST_TRAVERSE(&benches, bench, entry) {
+		ast_cli(a->fd, FORMAT_BENCH_SHOW, bench->info->category, bench->info->name, S_OR(bench->info->summary, ""));
+		count++;
+	}
+	AST_LIST_UNLOCK(&benches);
+	ast_cli(a->fd, "\n%d Registered Benchmarks\n", count);
+
+	return CLI_SUCCESS;
+#undef FORMAT_BENCH_SHOW
+}
+
+static char *test_cli_bench_run(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+#define FORMAT_BENCH "%-25.25s %-25.25s %10s %10s %10s %10s %10s %10s %12s\n"
+#define FORMAT_BENCH_RES "%-25.25s %-25.25s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %12.0f\n"
+	static const char * const option1[] = { "all", "category", NULL };
+	static const char * const option2[] = { "name", "iterations", "json", NULL };
+	const char *category = NULL;
+	const char *name = NULL;
+	unsigned int iterations = 0;
+	int json = 0;
+	struct ast_json *results = NULL;
+	struct ast_bench *bench;
+	int count = 0;
+	int arg;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "test bench run";
+		e->usage =
+			"Usage: test bench run {all|category <category> [name <name>]} [iterations <count>] [json]\n"
+			"       Runs the registered benchmarks, all of them or those of a category, and\n"
+			"       shows the nanoseconds each operation took: the minimum, mean, median,\n"
+			"       90th and 99th percentiles and maximum, and the operations per second\n"
+			"       at the mean.  The iterations timed can be changed for all of them,\n"
+			"       and the results reported as JSON to compare between versions.\n";
+		return NULL;
+	case CLI_GENERATE:
+		if (a->pos == 3) {
+			return ast_cli_complete(a->word, option1, -1);
+		}
+		if (a->pos == 4 && !strcasecmp(a->argv[3], "category")) {
+			return complete_bench_category(a->word);
+		}
+		if (a->pos > 4) {
+			return ast_cli_complete(a->word, option2, -1);
+		}
+		return NULL;
+	}
+
+	if (a->argc < 4) {
+		return CLI_SHOWUSAGE;
+	}
+	if (!strcasecmp(a->argv[3], "all")) {
+		arg = 4;
+	} else if (!strcasecmp(a->argv[3], "category") && a->argc > 4) {
+		category = a->argv[4];
+		arg = 5;
+	} else {
+		return CLI_SHOWUSAGE;
+	}
+	for (; arg < a->argc; arg++) {
+		if (category && !name && !strcasecmp(a->argv[arg], "name") && arg + 1 < a->argc) {
+			name = a->argv[++arg];
+		} else if (!strcasecmp(a->argv[arg], "iterations") && arg + 1 < a->argc) {
+			if (sscanf(a->argv[++arg], "%30u", &iterations) != 1 || !iterations) {
+				return CLI_SHOWUSAGE;
+			}
+		} else if (!strcasecmp(a->argv[arg], "json")) {
+			json = 1;
+		} else {
+			return CLI_SHOWUSAGE;
+		}
+	}
+
+	if (json) {
+		results = ast_json_array_create();
+		if (!results) {
+			return CLI_FAILURE;
+		}
+	} else {
+		ast_cli(a->fd, FORMAT_BENCH, "Category", "Name", "Min (ns)", "Mean (ns)", "Median (ns)",
+			"P90 (ns)", "P99 (ns)", "Max (ns)", "Ops/sec");
+	}
+
+	AST_LIST_LOCK(&benches);
+	AST_LIST_TRAVERSE(&benches, bench, entry) {
+		const struct ast_bench_info *info = bench->info;
+		struct bench_result result;
+
+		if ((category && test_cat_cmp(info->category, category))
+			|| (name && strcmp(info->name, name))) {
+			continue;
+		}
+		count++;
+
+		if (bench_run(info, iterations, &result)) {
+			ast_cli(a->fd, "Benchmark %s%s could not be set up\n", info->category, info->name);
+			continue;
+		}
+
+		if (json) {
+			ast_json_array_append(results, ast_json_pack(
+				"{s: s, s: s, s: i, s: i, s: f, s: f, s: f, s: f, s: f, s: f, s: f}",
+				"category", info->category, "name", info->name,
+				"iterations", result.iterations, "batch", result.batch,
+				"min_ns", result.min, "mean_ns", result.mean, "p50_ns", result.p50,
+				"p90_ns", result.p90, "p99_ns", result.p99, "max_ns", result.max,
+				"ops_per_sec", result.mean > 0 ? 1000000000 / result.mean : 0.0));
+		} else {
+			ast_cli(a->fd, FORMAT_BENCH_RES, info->category, info->name, result.min, result.mean,
+				result.p50, result.p90, result.p99, result.max,
+				result.mean > 0 ? 1000000000 / result.mean : 0.0);
+		}
+	}
+	AST_LIST_UNLOCK(&benches);
+
+	if (json) {
+		char *str = ast_json_dump_string_format(results, AST_JSON_PRETTY);
+
+		ast_cli(a->fd, "%s\n", S_OR(str, "[]"));
+		ast_json_free(str);
+		ast_json_unref(results);
+	} else {
+		ast_cli(a->fd, "\n%d Benchmark(s) Run\n", count);
+	}
+
+	return CLI_SUCCESS;
+#undef FORMAT_BENCH
+#undef FORMAT_BENCH_RES
+}
+
 static struct ast_cli_entry test_cli[] = {
 	AST_CLI_DEFINE(test_cli_show_registered,           "show registered tests"),
 	AST_CLI_DEFINE(test_cli_execute_registered,        "execute registered tests"),
 	AST_CLI_DEFINE(test_cli_show_results,              "show last test results"),
 	AST_CLI_DEFINE(test_cli_generate_results,          "generate test results to file"),
+	AST_CLI_DEFINE(test_cli_bench_show_registered,     "show registered benchmarks"),
+	AST_CLI_DEFINE(test_cli_bench_run,                 "run registered benchmarks"),
 };
 
 struct stasis_topic *ast_test_suite_topic(void)
@@ -19,14 +19,47 @@
 
 #include "asterisk.h"
 
+#include "asterisk/affinity.h"
 #include "asterisk/threadpool.h"
 #include "asterisk/taskprocessor.h"
 #include "asterisk/astobj2.h"
 #include "asterisk/utils.h"
+#include "asterisk/threadstorage.h"
 
 /* Needs to stay prime if increased */
 #define THREAD_BUCKETS 89
 
+/*! Initial number of task slots in a work stealing queue */
+#define WS_DEQUE_INITIAL_SIZE 32
+
+/*!
+ * \brief A task waiting in a work stealing queue
+ */
+struct ws_task {
+	int (*task)(void *data);
+	void *data;
+};
+
+/*!
+ * \brief A work stealing task queue
+ *
+ * A growable ring buffer of tasks.  The worker threads that call this
+ * queue home take tasks from the front while other workers steal
+ * from the back.
+ */
+struct ws_deque {
+	/*! Protects the queue */
+	ast_mutex_t lock;
+	/*! Ring buffer of tasks */
+	struct ws_task *tasks;
+	/*! Number of slots in the ring buffer */
+	size_t size;
+	/*! Index of the first task in the ring buffer */
+	size_t first;
+	/*! Number of tasks in the ring buffer (read without the lock as a hint) */
+	size_t count;
+};
+
 /*!
  * \brief An opaque threadpool structure
  *
@@ -98,6 +131,26 @@ struct ast_threadpool {
 	int shutting_down;
 	/*! Threadpool-specific options */
 	struct ast_threadpool_options options;
+	/*!
+	 * \brief Work stealing task queues
+	 *
+	 * Only used if the work_stealing option is enabled.  Tasks then
+	 * bypass the main taskprocessor and are spread across these queues.
+	 */
+	struct ws_deque *deques;
+	/*! Number of work stealing task queues */
+	unsigned int num_deques;
+	/*! Round robin selector for tasks pushed from outside the pool */
+	int next_deque;
+	/*! Work stealing tasks that are queued (atomic) */
+	long ws_queued;
+	/*!
+	 * \brief Work stealing tasks that have been pushed but not completed (atomic)
+	 *
+	 * \note As with taskprocessors the pusher accounts for its task only
+	 * after it is queued so this can briefly go negative.
+	 */
+	long ws_pending;
 };
 
 /*!
@@ -157,8 +210,13 @@ struct worker_thread {
 	int wake_up;
 	/*! Options for this threadpool */
 	struct ast_threadpool_options options;
+	/*! Index of the work stealing queue this worker takes tasks from first */
+	unsigned int home;
 };
 
+/*! The worker_thread of the current thread if it is a threadpool worker */
+AST_THREADSTORAGE_RAW(current_worker);
+
 /* Worker thread forward declarations. See definitions for documentation */
 static int worker_thread_hash(const void *obj, int flags);
 static int worker_thread_cmp(void *obj, void *arg, int flags);
@@ -349,18 +407,184 @@ static void threadpool_idle_thread_dead(struct ast_threadpool *pool,
 	}
 }
 
+static int ws_deque_init(struct ws_deque *deque)
+{
+	deque->tasks = ast_calloc(WS_DEQUE_INITIAL_SIZE, sizeof(*deque->tasks));
+	if (!deque->tasks) {
+		return -1;
+	}
+	deque->size = WS_DEQUE_INITIAL_SIZE;
+	ast_mutex_init(&deque->lock);
+	return 0;
+}
+
+static void ws_deque_destroy(struct ws_deque *deque)
+{
+	ast_mutex_destroy(&deque->lock);
+	ast_free(deque->tasks);
+}
+
+/*!
+ * \brief Add a task to the back of a work stealing queue
+ *
+ * \pre deque is locked
+ *
+ * \retval 0 success
+ * \retval -1 failure
+ */
+static int ws_deque_push_back(struct ws_deque *deque, int (*task)(void *data), void *data)
+{
+	struct ws_task *slot;
+
+	if (deque->count == deque->size) {
+		size_t new_size = deque->size * 2;
+		struct ws_task *tasks;
+		size_t i;
+
+		tasks = ast_malloc(new_size * sizeof(*tasks));
+		if (!tasks) {
+			return -1;
+		}
+		for (i = 0; i < deque->count; ++i) {
+			tasks[i] = deque->tasks[(deque->first + i) % deque->size];
+		}
+		ast_free(deque->tasks);
+		deque->tasks = tasks;
+		deque->size = new_size;
+		deque->first = 0;
+	}
+
+	slot = &deque->tasks[(deque->first + deque->count) % deque->size];
+	slot->task = task;
+	slot->data = data;
+	ast_atomic_store_n(&deque->count, deque->count + 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+/*!
+ * \brief Remove the oldest task from a work stealing queue
+ *
+ * \pre deque is locked
+ *
+ * \retval 0 The queue is empty
+ * \retval 1 task was filled in
+ */
+static int ws_deque_pop_front(struct ws_deque *deque, struct ws_task *task)
+{
+	if (!deque->count) {
+		return 0;
+	}
+
+	*task = deque->tasks[deque->first];
+	deque->first = (deque->first + 1) % deque->size;
+	ast_atomic_store_n(&deque->count, deque->count - 1, __ATOMIC_RELAXED);
+	return 1;
+}
+
+/*!
+ * \brief Remove the newest task from a work stealing queue
+ *
+ * \pre deque is locked
+ *
+ * \retval 0 The queue is empty
+ * \retval 1 task was filled in
+ */
+static int ws_deque_pop_back(struct ws_deque *deque, struct ws_task *task)
+{
+	if (!deque->count) {
+		return 0;
+	}
+
+	*task = deque->tasks[(deque->first + deque->count - 1) % deque->size];
+	ast_atomic_store_n(&deque->count, deque->count - 1, __ATOMIC_RELAXED);
+	return 1;
+}
+
+/*!
+ * \brief Find a task for a worker to execute
+ *
+ * The worker's home queue is checked first.  If it is empty a task
+ * is stolen from one of the other queues.
+ *
+ * \param pool The threadpool
+ * \param home The worker's home queue
+ * \param[out] task The task found
+ *
+ * \retval 0 No task was found
+ * \retval 1 task was filled in
+ */
+static int threadpool_ws_take(struct ast_threadpool *pool, unsigned int home, struct ws_task *task)
+{
+	struct ws_deque *deque;
+	unsigned int i;
+	int found;
+
+	for (i = 0; i < pool->num_deques; ++i) {
+		deque = &pool->deques[(home + i) % pool->num_deques];
+		if (!ast_atomic_load_n(&deque->count, __ATOMIC_RELAXED)) {
+			continue;
+		}
+
+		ast_mutex_lock(&deque->lock);
+		/* Oldest task from our own queue, newest when stealing from another */
+		found = i ? ws_deque_pop_back(deque, task) : ws_deque_pop_front(deque, task);
+		ast_mutex_unlock(&deque->lock);
+		if (found) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void threadpool_emptied(struct ast_threadpool *pool);
+
+/*!
+ * \brief Execute a task from the work stealing queues
+ *
+ * \param worker The worker executing the task.
+ * \retval 0 Either the pool has been shut down or there are no tasks.
+ * \retval 1 There are still tasks remaining in the pool.
+ */
+static int threadpool_ws_execute(struct worker_thread *worker)
+{
+	struct ast_threadpool *pool = worker->pool;
+	struct ws_task task;
+	long remaining;
+
+	if (ast_atomic_load_n(&pool->shutting_down, __ATOMIC_RELAXED)
+		|| !threadpool_ws_take(pool, worker->home, &task)) {
+		return 0;
+	}
+	ast_atomic_fetch_sub(&pool->ws_queued, 1, __ATOMIC_RELAXED);
+
+	task.task(task.data);
+
+	remaining = ast_atomic_sub_fetch(&pool->ws_pending, 1, __ATOMIC_ACQ_REL);
+	if (remaining <= 0) {
+		threadpool_emptied(pool);
+	}
+	return remaining > 0;
+}
+
 /*!
  * \brief Execute a task in the threadpool
  *
  * This is the function that worker threads call in order to execute tasks
  * in the threadpool
  *
- * \param pool The pool to which the tasks belong.
+ * \param worker The worker executing the task.
  * \retval 0 Either the pool has been shut down or there are no tasks.
  * \retval 1 There are still tasks remaining in the pool.
  */
-static int threadpool_execute(struct ast_threadpool *pool)
+static int threadpool_execute(struct worker_thread *worker)
 {
+	struct ast_threadpool *pool = worker->pool;
+
+	if (pool->deques) {
+		return threadpool_ws_execute(worker);
+	}
+
 	ao2_lock(pool);
 	if (!pool->shutting_down) {
 		ao2_unlock(pool);
@@ -386,7 +610,15 @@ static int threadpool_execute(struct ast_threadpool *pool)
 static void threadpool_destructor(void *obj)
 {
 	struct ast_threadpool *pool = obj;
+	unsigned int i;
+
 	ao2_cleanup(pool->listener);
+
+	/* Any tasks still queued are discarded just like a taskprocessor does */
+	for (i = 0; i < pool->num_deques; ++i) {
+		ws_deque_destroy(&pool->deques[i]);
+	}
+	ast_free(pool->deques);
 }
 
 /*!
@@ -437,6 +669,24 @@ static struct ast_threadpool *threadpool_alloc(const char *name, const struct as
 	}
 	pool->options = *options;
 
+	if (options->work_stealing) {
+		long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		unsigned int num_deques = num_cpus > 0 ? num_cpus : 1;
+
+		if (options->max_size > 0 && options->max_size < num_deques) {
+			num_deques = options->max_size;
+		}
+		pool->deques = ast_calloc(num_deques, sizeof(*pool->deques));
+		if (!pool->deques) {
+			return NULL;
+		}
+		for (; pool->num_deques < num_deques; ++pool->num_deques) {
+			if (ws_deque_init(&pool->deques[pool->num_deques])) {
+				return NULL;
+			}
+		}
+	}
+
 	ao2_ref(pool, +1);
 	return pool;
 }
@@ -600,18 +850,13 @@ static int queued_task_pushed(void *data)
 }
 
 /*!
- * \brief Taskprocessor listener callback called when a task is added
+ * \brief Queue a task on the control taskprocessor announcing a task was pushed
  *
- * The threadpool uses this opportunity to queue a task on its control taskprocessor
- * in order to activate idle threads and notify the threadpool listener that the
- * task has been pushed.
- * \param listener The taskprocessor listener. The threadpool is the listener's private data
- * \param was_empty True if the taskprocessor was empty prior to the task being pushed
+ * \param pool The threadpool the task was pushed to
+ * \param was_empty True if the pool was empty prior to the task being pushed
  */
-static void threadpool_tps_task_pushed(struct ast_taskprocessor_listener *listener,
-		int was_empty)
+static void threadpool_task_pushed(struct ast_threadpool *pool, int was_empty)
 {
-	struct ast_threadpool *pool = ast_taskprocessor_listener_get_user_data(listener);
 	struct task_pushed_data *tpd;
 	SCOPED_AO2LOCK(lock, pool);
 
@@ -629,6 +874,71 @@ static void threadpool_tps_task_pushed(struct ast_taskprocessor_listener *listen
 	}
 }
 
+/*!
+ * \brief Taskprocessor listener callback called when a task is added
+ *
+ * The threadpool uses this opportunity to queue a task on its control taskprocessor
+ * in order to activate idle threads and notify the threadpool listener that the
+ * task has been pushed.
+ * \param listener The taskprocessor listener. The threadpool is the listener's private data
+ * \param was_empty True if the taskprocessor was empty prior to the task being pushed
+ */
+static void threadpool_tps_task_pushed(struct ast_taskprocessor_listener *listener,
+		int was_empty)
+{
+	threadpool_task_pushed(ast_taskprocessor_listener_get_user_data(listener), was_empty);
+}
+
+/*!
+ * \brief Push a task to one of the work stealing queues
+ *
+ * Tasks pushed by a worker of the pool go to that worker's home queue.
+ * Tasks from anywhere else are spread round robin across the queues.
+ *
+ * \retval 0 success
+ * \retval -1 failure
+ */
+static int threadpool_ws_push(struct ast_threadpool *pool, int (*task)(void *data), void *data)
+{
+	struct worker_thread *worker = ast_threadstorage_get_ptr(&current_worker);
+	struct ws_deque *deque;
+	unsigned int idx;
+	long previous_pending;
+	int res;
+
+	if (worker && worker->pool == pool) {
+		idx = worker->home;
+	} else {
+		idx = (unsigned int) ast_atomic_fetchadd_int(&pool->next_deque, 1) % pool->num_deques;
+	}
+	deque = &pool->deques[idx];
+
+	ast_mutex_lock(&deque->lock);
+	res = ws_deque_push_back(deque, task, data);
+	ast_mutex_unlock(&deque->lock);
+	if (res) {
+		return -1;
+	}
+
+	ast_atomic_fetch_add(&pool->ws_queued, 1, __ATOMIC_RELAXED);
+	previous_pending = ast_atomic_fetch_add(&pool->ws_pending, 1, __ATOMIC_ACQ_REL);
+
+	/*
+	 * Active workers keep taking tasks until the pending count reaches
+	 * zero.  The control taskprocessor only needs to hear about this
+	 * task if there may be an idle thread to wake or the pool may need
+	 * to grow.
+	 */
+	if (previous_pending == 0
+		|| ao2_container_count(pool->idle_threads)
+		|| (pool->options.auto_increment
+			&& previous_pending >= ao2_container_count(pool->active_threads))) {
+		threadpool_task_pushed(pool, previous_pending == 0);
+	}
+
+	return 0;
+}
+
 /*!
  * \brief Queued task that handles the case where the threadpool's taskprocessor is emptied
  *
@@ -654,7 +964,16 @@ static int queued_emptied(void *data)
  */
 static void threadpool_tps_emptied(struct ast_taskprocessor_listener *listener)
 {
-	struct ast_threadpool *pool = ast_taskprocessor_listener_get_user_data(listener);
+	threadpool_emptied(ast_taskprocessor_listener_get_user_data(listener));
+}
+
+/*!
+ * \brief Queue a task to tell the threadpool listener the pool has no tasks
+ *
+ * \param pool The threadpool that has become empty
+ */
+static void threadpool_emptied(struct ast_threadpool *pool)
+{
 	SCOPED_AO2LOCK(lock, pool);
 
 	if (pool->shutting_down) {
@@ -956,11 +1275,22 @@ struct ast_threadpool *ast_threadpool_create(const char *name,
 
 int ast_threadpool_push(struct ast_threadpool *pool, int (*task)(void *data), void *data)
 {
-	SCOPED_AO2LOCK(lock, pool);
+	int res = -1;
+
+	if (pool->deques) {
+		/* The pool lock is only needed if the control taskprocessor gets involved */
+		if (ast_atomic_load_n(&pool->shutting_down, __ATOMIC_RELAXED)) {
+			return -1;
+		}
+		return threadpool_ws_push(pool, task, data);
+	}
+
+	ao2_lock(pool);
 	if (!pool->shutting_down) {
-		return ast_taskprocessor_push(pool->tps, task, data);
+		res = ast_taskprocessor_push(pool->tps, task, data);
 	}
-	return -1;
+	ao2_unlock(pool);
+	return res;
 }
 
 void ast_threadpool_shutdown(struct ast_threadpool *pool)
@@ -1046,6 +1376,9 @@ static void *worker_start(void *arg)
 	struct worker_thread *worker = arg;
 	enum worker_state saved_state;
 
+	ast_threadstorage_set_ptr(&current_worker, worker);
+	ast_thread_affinity_apply(AST_THREAD_AFFINITY_SIGNALING, -1);
+
 	if (worker->options.thread_start) {
 		worker->options.thread_start();
 	}
@@ -1103,6 +1436,9 @@ static struct worker_thread *worker_thread_alloc(struct ast_threadpool *pool)
 	worker->thread = AST_PTHREADT_NULL;
 	worker->state = ALIVE;
 	worker->options = pool->options;
+	if (pool->num_deques) {
+		worker->home = (unsigned int) worker->id % pool->num_deques;
+	}
 	return worker;
 }
 
@@ -1134,7 +1470,7 @@ static void worker_active(struct worker_thread *worker)
 	 * optimize the code away.
 	 */
 	do {
-		alive = threadpool_execute(worker->pool);
+		alive = threadpool_execute(worker);
 	} while (alive);
 }
 
@@ -1432,5 +1768,8 @@ struct ast_taskprocessor *ast_threadpool_serializer(const char *name, struct ast
 
 long ast_threadpool_queue_size(struct ast_threadpool *pool)
 {
+	if (pool->deques) {
+		return ast_atomic_load_n(&pool->ws_queued, __ATOMIC_RELAXED);
+	}
 	return ast_taskprocessor_size(pool->tps);
 }
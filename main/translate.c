@@ -42,7 +42,10 @@
 #include "asterisk/cli.h"
 #include "asterisk/term.h"
 #include "asterisk/format.h"
+#include "asterisk/latency.h"
 #include "asterisk/linkedlists.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/vector.h"
 
 /*! \todo
  * TODO: sample frames for each supported input format.
@@ -473,7 +476,7 @@ static struct ast_frame *default_frameout(struct ast_trans_pvt *pvt)
 
 /* end of callback wrappers and helpers */
 
-void ast_translator_free_path(struct ast_trans_pvt *p)
+static void translator_chain_destroy(struct ast_trans_pvt *p)
 {
 	struct ast_trans_pvt *pn = p;
 	while ( (p = pn) ) {
@@ -482,21 +485,15 @@ void ast_translator_free_path(struct ast_trans_pvt *p)
 	}
 }
 
-/*! \brief Build a chain of translators based upon the given source and dest formats */
-struct ast_trans_pvt *ast_translator_build_path(struct ast_format *dst, struct ast_format *src)
+/*!
+ * \brief Build a chain of translators based upon the given source and dest format indexes
+ *
+ * \note The translators list must be locked.
+ */
+static struct ast_trans_pvt *translator_chain_build(struct ast_format *dst, struct ast_format *src,
+	int src_index, int dst_index)
 {
 	struct ast_trans_pvt *head = NULL, *tail = NULL;
-	int src_index, dst_index;
-
-	src_index = format2index(src);
-	dst_index = format2index(dst);
-
-	if (src_index < 0 || dst_index < 0) {
-		ast_log(LOG_WARNING, "No translator path: (%s codec is not valid)\n", src_index < 0 ? "starting" : "ending");
-		return NULL;
-	}
-
-	AST_RWLIST_RDLOCK(&translators);
 
 	while (src_index != dst_index) {
 		struct ast_trans_pvt *cur;
@@ -505,8 +502,7 @@ struct ast_trans_pvt *ast_translator_build_path(struct ast_format *dst, struct a
 		if (!t) {
 			ast_log(LOG_WARNING, "No translator path from %s to %s\n",
 				ast_format_get_name(src), ast_format_get_name(dst));
-			AST_RWLIST_UNLOCK(&translators);
-			ast_translator_free_path(head);
+			translator_chain_destroy(head);
 			return NULL;
 		}
 		if ((t->dst_codec.sample_rate == ast_format_get_sample_rate(dst)) && (t->dst_codec.type == ast_format_get_type(dst))) {
@@ -515,8 +511,7 @@ struct ast_trans_pvt *ast_translator_build_path(struct ast_format *dst, struct a
 		if (!(cur = newpvt(t, explicit_dst))) {
 			ast_log(LOG_WARNING, "Failed to build translator step from %s to %s\n",
 				ast_format_get_name(src), ast_format_get_name(dst));
-			ast_translator_free_path(head);
-			AST_RWLIST_UNLOCK(&translators);
+			translator_chain_destroy(head);
 			return NULL;
 		}
 		if (!head) {
@@ -530,7 +525,386 @@ struct ast_trans_pvt *ast_translator_build_path(struct ast_format *dst, struct a
 		src_index = cur->t->dst_fmt_index;
 	}
 
+	return head;
+}
+
+/*! Maximum number of idle translation paths kept for a pair of formats */
+#define POOL_MAX_PAIR_PATHS 4
+/*! Maximum number of idle translation paths kept in total */
+#define POOL_MAX_PATHS 128
+
+/*!
+ * \brief Idle translation paths between a pair of formats
+ *
+ * Paths in the pool do not hold references to the modules of their
+ * translators.  The pool is emptied whenever the translation matrix
+ * changes or a translator is unregistered, so a module can never be
+ * unloaded while a path using it is in the pool.
+ */
+struct translate_pool_entry {
+	/*! Index of the source format in the matrix table */
+	int src_index;
+	/*! Index of the destination format in the matrix table */
+	int dst_index;
+	/*! The source format the paths translate from */
+	struct ast_format *src;
+	/*! The destination format the paths were built for */
+	struct ast_format *dst;
+	/*! The idle paths */
+	AST_VECTOR(, struct ast_trans_pvt *) paths;
+	/*! Number of paths taken from the pool */
+	unsigned int hits;
+	/*! Number of paths that had to be built when requested */
+	unsigned int misses;
+	/*! Number of paths reset and returned to the pool after use */
+	unsigned int reused;
+	/*! Number of paths built in advance */
+	unsigned int prebuilt;
+	/*! Whether a path is being built in advance */
+	unsigned int refilling:1;
+	AST_LIST_ENTRY(translate_pool_entry) list;
+};
+
+/*! \brief The pool of idle translation paths */
+static AST_LIST_HEAD_STATIC(translate_pool, translate_pool_entry);
+
+/*! Number of idle paths in the pool */
+static unsigned int translate_pool_idle;
+
+/*! Builds translation paths in advance so they are ready for the next call */
+static struct ast_taskprocessor *translate_pool_tps;
+
+/*! How long frames take to translate */
+static struct ast_latency_histogram *translate_latency;
+
+static void translate_pool_entry_destroy(struct translate_pool_entry *entry)
+{
+	ao2_cleanup(entry->src);
+	ao2_cleanup(entry->dst);
+	AST_VECTOR_FREE(&entry->paths);
+	ast_free(entry);
+}
+
+/*!
+ * \brief Find the pool entry for a pair of formats
+ *
+ * \note The pool must be locked.
+ */
+static struct translate_pool_entry *translate_pool_find(int src_index, int dst_index,
+	struct ast_format *src, struct ast_format *dst, int create)
+{
+	struct translate_pool_entry *entry;
+
+	AST_LIST_TRAVERSE(&translate_pool, entry, list) {
+		if (entry->src_index == src_index && entry->dst_index == dst_index
+			&& (entry->dst == dst || ast_format_cmp(entry->dst, dst) == AST_FORMAT_CMP_EQUAL)) {
+			return entry;
+		}
+	}
+
+	if (!create || !(entry = ast_calloc(1, sizeof(*entry)))) {
+		return NULL;
+	}
+	entry->src_index = src_index;
+	entry->dst_index = dst_index;
+	entry->src = ao2_bump(src);
+	entry->dst = ao2_bump(dst);
+	if (AST_VECTOR_INIT(&entry->paths, POOL_MAX_PAIR_PATHS)) {
+		translate_pool_entry_destroy(entry);
+		return NULL;
+	}
+	AST_LIST_INSERT_TAIL(&translate_pool, entry, list);
+
+	return entry;
+}
+
+/*! \brief Free a pooled path, which holds no module references */
+static void translate_pool_path_free(struct ast_trans_pvt *p)
+{
+	struct ast_trans_pvt *pn = p;
+
+	while ((p = pn)) {
+		pn = p->next;
+		ast_module_ref(p->t->module);
+		destroy(p);
+	}
+}
+
+/*!
+ * \brief Empty the pool of idle translation paths
+ *
+ * \note The translators list must be write locked.
+ */
+static void translate_pool_flush(void)
+{
+	struct translate_pool_entry *entry;
+
+	AST_LIST_LOCK(&translate_pool);
+	AST_LIST_TRAVERSE(&translate_pool, entry, list) {
+		AST_VECTOR_CALLBACK_VOID(&entry->paths, translate_pool_path_free);
+		AST_VECTOR_RESET(&entry->paths, AST_VECTOR_ELEM_CLEANUP_NOOP);
+	}
+	translate_pool_idle = 0;
+	AST_LIST_UNLOCK(&translate_pool);
+}
+
+/*! \brief Whether every translator in a path can be returned to its initial state */
+static int translate_pool_path_resettable(struct ast_trans_pvt *p)
+{
+	for (; p; p = p->next) {
+		if (!p->t->reset && (p->t->newpvt || p->t->destroy || p->t->desc_size)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*! \brief Return a used path to the state ast_translator_build_path() left it in */
+static void translate_pool_path_reset(struct ast_trans_pvt *p)
+{
+	for (; p; p = p->next) {
+		if (p->t->reset) {
+			p->t->reset(p);
+		}
+		p->samples = 0;
+		p->datalen = 0;
+		p->nextin = p->nextout = ast_tv(0, 0);
+		p->interleaved_stereo = 0;
+		ast_clear_flag(&p->f, AST_FRFLAG_HAS_TIMING_INFO);
+		p->f.ts = 0;
+		p->f.len = 0;
+		p->f.seqno = 0;
+		p->f.samples = 0;
+		p->f.datalen = 0;
+		p->f.delivery = ast_tv(0, 0);
+		p->f.data.ptr = p->outbuf.c;
+	}
+}
+
+/*!
+ * \brief Whether a path is still the best path through the translation matrix
+ *
+ * \note The translators list must be locked.
+ */
+static int translate_pool_path_current(struct ast_trans_pvt *p, int src_index, int dst_index)
+{
+	while (src_index != dst_index) {
+		if (!p || p->t != matrix_get(src_index, dst_index)->step) {
+			return 0;
+		}
+		src_index = p->t->dst_fmt_index;
+		p = p->next;
+	}
+
+	return !p;
+}
+
+/*!
+ * \brief Add a path to the pool
+ *
+ * \param p The path
+ * \param prebuilt Whether the path was built in advance rather than used
+ *
+ * \note The translators list must be locked.
+ *
+ * \retval 0 the path is now owned by the pool
+ * \retval -1 the path was not added
+ */
+static int translate_pool_put(struct ast_trans_pvt *p, int prebuilt)
+{
+	struct translate_pool_entry *entry;
+	struct ast_trans_pvt *tail;
+	struct ast_trans_pvt *cur;
+	int src_index = p->t->src_fmt_index;
+	int res = -1;
+
+	for (tail = p; tail->next; tail = tail->next) {
+	}
+
+	/* Paths are keyed by the destination format they were built for */
+	if (!tail->explicit_dst || ast_shutting_down()
+		|| !translate_pool_path_current(p, src_index, tail->t->dst_fmt_index)
+		|| (!prebuilt && !translate_pool_path_resettable(p))) {
+		return -1;
+	}
+
+	AST_LIST_LOCK(&translate_pool);
+	entry = translate_pool_find(src_index, tail->t->dst_fmt_index, NULL, tail->explicit_dst, 0);
+	if (entry && prebuilt) {
+		entry->refilling = 0;
+	}
+	if (entry && translate_pool_idle < POOL_MAX_PATHS
+		&& AST_VECTOR_SIZE(&entry->paths) < POOL_MAX_PAIR_PATHS
+		&& !AST_VECTOR_APPEND(&entry->paths, p)) {
+		if (prebuilt) {
+			++entry->prebuilt;
+		} else {
+			translate_pool_path_reset(p);
+			++entry->reused;
+		}
+		++translate_pool_idle;
+		for (cur = p; cur; cur = cur->next) {
+			ast_module_unref(cur->t->module);
+		}
+		res = 0;
+	}
+	AST_LIST_UNLOCK(&translate_pool);
+
+	return res;
+}
+
+/*!
+ * \brief Take a path from the pool
+ *
+ * \param refill Set if a path should be built in advance for the next request
+ *
+ * \note The translators list must be locked.
+ */
+static struct ast_trans_pvt *translate_pool_get(struct ast_format *dst, struct ast_format *src,
+	int src_index, int dst_index, struct translate_pool_entry **refill)
+{
+	struct translate_pool_entry *entry;
+	struct ast_trans_pvt *p = NULL;
+	struct ast_trans_pvt *cur;
+
+	AST_LIST_LOCK(&translate_pool);
+	entry = translate_pool_find(src_index, dst_index, src, dst, 1);
+	if (!entry) {
+		AST_LIST_UNLOCK(&translate_pool);
+		return NULL;
+	}
+
+	if (AST_VECTOR_SIZE(&entry->paths)) {
+		p = AST_VECTOR_REMOVE(&entry->paths, AST_VECTOR_SIZE(&entry->paths) - 1, 0);
+		--translate_pool_idle;
+		++entry->hits;
+		for (cur = p; cur; cur = cur->next) {
+			ast_module_ref(cur->t->module);
+		}
+	} else {
+		++entry->misses;
+	}
+
+	if (!AST_VECTOR_SIZE(&entry->paths) && !entry->refilling
+		&& translate_pool_idle < POOL_MAX_PATHS && translate_pool_tps) {
+		entry->refilling = 1;
+		*refill = entry;
+	}
+	AST_LIST_UNLOCK(&translate_pool);
+
+	return p;
+}
+
+struct translate_pool_refill_data {
+	struct ast_format *src;
+	struct ast_format *dst;
+};
+
+static int translate_pool_refill(void *data)
+{
+	struct translate_pool_refill_data *refill = data;
+	struct translate_pool_entry *entry;
+	struct ast_trans_pvt *p = NULL;
+	int src_index = format2index(refill->src);
+	int dst_index = format2index(refill->dst);
+
+	if (src_index >= 0 && dst_index >= 0 && !ast_shutting_down()) {
+		AST_RWLIST_RDLOCK(&translators);
+		p = translator_chain_build(refill->dst, refill->src, src_index, dst_index);
+		if (p && translate_pool_put(p, 1)) {
+			translator_chain_destroy(p);
+			p = NULL;
+		}
+		AST_RWLIST_UNLOCK(&translators);
+	}
+
+	if (!p) {
+		AST_LIST_LOCK(&translate_pool);
+		entry = translate_pool_find(src_index, dst_index, NULL, refill->dst, 0);
+		if (entry) {
+			entry->refilling = 0;
+		}
+		AST_LIST_UNLOCK(&translate_pool);
+	}
+
+	ao2_ref(refill->src, -1);
+	ao2_ref(refill->dst, -1);
+	ast_free(refill);
+
+	return 0;
+}
+
+/*! \brief Queue building a path in advance for a pool entry */
+static void translate_pool_refill_push(struct translate_pool_entry *entry)
+{
+	struct translate_pool_refill_data *refill;
+
+	/* The entry can not be freed before shutdown, and is only read here */
+	refill = ast_malloc(sizeof(*refill));
+	if (refill) {
+		refill->src = ao2_bump(entry->src);
+		refill->dst = ao2_bump(entry->dst);
+		if (!ast_taskprocessor_push(translate_pool_tps, translate_pool_refill, refill)) {
+			return;
+		}
+		ao2_ref(refill->src, -1);
+		ao2_ref(refill->dst, -1);
+		ast_free(refill);
+	}
+
+	AST_LIST_LOCK(&translate_pool);
+	entry->refilling = 0;
+	AST_LIST_UNLOCK(&translate_pool);
+}
+
+void ast_translator_free_path(struct ast_trans_pvt *p)
+{
+	int pooled;
+
+	if (!p) {
+		return;
+	}
+
+	AST_RWLIST_RDLOCK(&translators);
+	pooled = !translate_pool_put(p, 0);
+	AST_RWLIST_UNLOCK(&translators);
+
+	if (!pooled) {
+		translator_chain_destroy(p);
+	}
+}
+
+/*! \brief Build a chain of translators based upon the given source and dest formats */
+struct ast_trans_pvt *ast_translator_build_path(struct ast_format *dst, struct ast_format *src)
+{
+	struct ast_trans_pvt *head;
+	struct translate_pool_entry *refill = NULL;
+	int src_index, dst_index;
+
+	src_index = format2index(src);
+	dst_index = format2index(dst);
+
+	if (src_index < 0 || dst_index < 0) {
+		ast_log(LOG_WARNING, "No translator path: (%s codec is not valid)\n", src_index < 0 ? "starting" : "ending");
+		return NULL;
+	}
+
+	if (src_index == dst_index) {
+		return NULL;
+	}
+
+	AST_RWLIST_RDLOCK(&translators);
+	head = translate_pool_get(dst, src, src_index, dst_index, &refill);
+	if (!head) {
+		head = translator_chain_build(dst, src, src_index, dst_index);
+	}
 	AST_RWLIST_UNLOCK(&translators);
+
+	if (refill) {
+		translate_pool_refill_push(refill);
+	}
+
 	return head;
 }
 
@@ -572,6 +946,7 @@ struct ast_frame *ast_translate(struct ast_trans_pvt *path, struct ast_frame *f,
 	long ts;
 	long len;
 	int seqno;
+	uint64_t start;
 
 	if (f->frametype == AST_FRAME_RTCP) {
 		/* Just pass the feedback to the right callback, if it exists.
@@ -612,6 +987,7 @@ struct ast_frame *ast_translate(struct ast_trans_pvt *path, struct ast_frame *f,
 			 f->samples, ast_format_get_sample_rate(f->subclass.format)));
 	}
 	delivery = f->delivery;
+	start = ast_latency_start();
 	for (out = f; out && p ; p = p->next) {
 		struct ast_frame *current = out;
 
@@ -624,6 +1000,7 @@ struct ast_frame *ast_translate(struct ast_trans_pvt *path, struct ast_frame *f,
 		}
 		out = p->t->frameout(p);
 	}
+	ast_latency_end(translate_latency, start);
 
 	if (!out) {
 		out = generate_interpolated_slin(path, f);
@@ -679,6 +1056,92 @@ struct ast_frame *ast_translate(struct ast_trans_pvt *path, struct ast_frame *f,
 	return out;
 }
 
+/*! \brief Append a frame, or list of frames, to a list of frames */
+static void frame_list_append(struct ast_frame **head, struct ast_frame **tail, struct ast_frame *f)
+{
+	if (!f || f == &ast_null_frame) {
+		return;
+	}
+	if (*tail) {
+		AST_LIST_NEXT(*tail, frame_list) = f;
+	} else {
+		*head = f;
+	}
+	for (*tail = f; AST_LIST_NEXT(*tail, frame_list); *tail = AST_LIST_NEXT(*tail, frame_list)) {
+	}
+}
+
+struct ast_frame *ast_translate_list(struct ast_trans_pvt *path, struct ast_frame *frames, int consume)
+{
+	struct ast_trans_pvt *p;
+	struct ast_frame *in;
+	struct ast_frame *cur;
+	struct ast_frame *head = NULL;
+	struct ast_frame *tail = NULL;
+
+	/* Timing prediction and interpolation are done a frame at a time */
+	for (in = frames; in; in = AST_LIST_NEXT(in, frame_list)) {
+		if (in->frametype != AST_FRAME_VOICE || !in->datalen || !ast_tvzero(in->delivery)) {
+			break;
+		}
+	}
+
+	if (in) {
+		for (in = frames; in; in = AST_LIST_NEXT(in, frame_list)) {
+			struct ast_frame *next = AST_LIST_NEXT(in, frame_list);
+
+			/* Keep ast_translate() from combining the rest of the list with this frame */
+			AST_LIST_NEXT(in, frame_list) = NULL;
+			cur = ast_translate(path, in, 0);
+			AST_LIST_NEXT(in, frame_list) = next;
+			frame_list_append(&head, &tail, cur);
+		}
+	} else {
+		uint64_t start = ast_latency_start();
+
+		in = frames;
+		for (p = path; p && in; p = p->next) {
+			head = tail = NULL;
+			for (cur = in; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+				struct ast_frame *out;
+
+				framein(p, cur);
+				out = p->t->frameout(p);
+				if (!out) {
+					continue;
+				}
+				/* Each output carries the timing of the input it came from */
+				out->delivery = ast_tv(0, 0);
+				ast_copy_flags(out, cur, AST_FRFLAG_HAS_TIMING_INFO);
+				if (ast_test_flag(cur, AST_FRFLAG_HAS_TIMING_INFO)) {
+					out->ts = cur->ts;
+					out->len = cur->len;
+					out->seqno = cur->seqno;
+				}
+				frame_list_append(&head, &tail, out);
+			}
+			if (in != frames) {
+				ast_frfree(in);
+			}
+			in = head;
+		}
+		ast_latency_end(translate_latency, start);
+
+		head = in != frames ? in : NULL;
+		for (cur = head; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+			/* Invalidate prediction if we're entering a silence period */
+			if (cur->frametype == AST_FRAME_CNG) {
+				path->nextout = ast_tv(0, 0);
+			}
+		}
+	}
+
+	if (consume) {
+		ast_frfree(frames);
+	}
+	return head;
+}
+
 /*!
  * \internal
  * \brief Compute the computational cost of a single translation step.
@@ -832,6 +1295,7 @@ static void matrix_rebuild(int samples)
 
 	ast_debug(1, "Resetting translation matrix\n");
 
+	translate_pool_flush();
 	matrix_clear();
 
 	/* first, compute all direct costs */
@@ -1172,6 +1636,32 @@ static char *handle_show_translation_path(struct ast_cli_args *a, const char *co
 	return CLI_SUCCESS;
 }
 
+static char *handle_show_translation_pool(struct ast_cli_args *a)
+{
+	struct translate_pool_entry *entry;
+	char src_buffer[64];
+	char dst_buffer[64];
+
+	AST_LIST_LOCK(&translate_pool);
+	ast_cli(a->fd, "\n--- Translation path pool (%u idle paths) ---\n", translate_pool_idle);
+	if (!AST_LIST_EMPTY(&translate_pool)) {
+		ast_cli(a->fd, "\t%-16.16s    %-16.16s  %5s %10s %10s %10s %10s\n",
+			"Source", "Destination", "Idle", "Hits", "Misses", "Reused", "Prebuilt");
+	}
+	AST_LIST_TRAVERSE(&translate_pool, entry, list) {
+		snprintf(src_buffer, sizeof(src_buffer), "%s:%u", ast_format_get_name(entry->src),
+			ast_format_get_sample_rate(entry->src));
+		snprintf(dst_buffer, sizeof(dst_buffer), "%s:%u", ast_format_get_name(entry->dst),
+			ast_format_get_sample_rate(entry->dst));
+		ast_cli(a->fd, "\t%-16.16s To %-16.16s: %5zu %10u %10u %10u %10u\n",
+			src_buffer, dst_buffer, AST_VECTOR_SIZE(&entry->paths),
+			entry->hits, entry->misses, entry->reused, entry->prebuilt);
+	}
+	AST_LIST_UNLOCK(&translate_pool);
+
+	return CLI_SUCCESS;
+}
+
 static char *handle_cli_core_show_translation(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	static const char * const option[] = { "recalc", "paths", "comp", NULL };
@@ -1195,7 +1685,9 @@ static char *handle_cli_core_show_translation(struct ast_cli_entry *e, int cmd,
 			"          with each conversion.  If the argument 'recalc' is supplied along\n"
 			"          with optional number of seconds to test a new test will be performed\n"
 			"          as the chart is being displayed. The resulting numbers in the table\n"
-			"          give the actual computational costs in microseconds.\n";
+			"          give the actual computational costs in microseconds.\n"
+			"       The table is followed by the use of the pool of idle translation\n"
+			"       paths for each pair of formats.\n";
 		return NULL;
 	case CLI_GENERATE:
 		if (a->pos == 3) {
@@ -1226,7 +1718,10 @@ static char *handle_cli_core_show_translation(struct ast_cli_entry *e, int cmd,
 		return CLI_SHOWUSAGE;
 	}
 
-	return handle_show_translation_table(a);
+	if (handle_show_translation_table(a) != CLI_SUCCESS) {
+		return CLI_FAILURE;
+	}
+	return handle_show_translation_pool(a);
 }
 
 static struct ast_cli_entry cli_translate[] = {
@@ -1366,6 +1861,9 @@ int ast_unregister_translator(struct ast_translator *t)
 	}
 	AST_RWLIST_TRAVERSE_SAFE_END;
 
+	if (found) {
+		translate_pool_flush();
+	}
 	if (found && !ast_shutting_down()) {
 		matrix_rebuild(0);
 	}
@@ -1657,9 +2155,21 @@ void ast_translate_available_formats(struct ast_format_cap *dest, struct ast_for
 
 static void translate_shutdown(void)
 {
+	struct translate_pool_entry *entry;
 	int x;
 	ast_cli_unregister_multiple(cli_translate, ARRAY_LEN(cli_translate));
 
+	ast_taskprocessor_unreference(translate_pool_tps);
+	translate_pool_tps = NULL;
+	AST_RWLIST_WRLOCK(&translators);
+	translate_pool_flush();
+	AST_RWLIST_UNLOCK(&translators);
+	AST_LIST_LOCK(&translate_pool);
+	while ((entry = AST_LIST_REMOVE_HEAD(&translate_pool, list))) {
+		translate_pool_entry_destroy(entry);
+	}
+	AST_LIST_UNLOCK(&translate_pool);
+
 	ast_rwlock_wrlock(&tablelock);
 	for (x = 0; x < index_size; x++) {
 		ast_free(__matrix[x]);
@@ -1677,6 +2187,12 @@ int ast_translate_init(void)
 	int res = 0;
 	ast_rwlock_init(&tablelock);
 	res = matrix_resize(1);
+	translate_pool_tps = ast_taskprocessor_get("translate_pool", TPS_REF_DEFAULT);
+	if (!translate_pool_tps) {
+		ast_log(LOG_WARNING, "Failed to create the translation path pool taskprocessor\n");
+	}
+	translate_latency = ast_latency_histogram_get("translate_frame",
+		"Time taken to translate a frame along a translation path");
 	res |= ast_cli_register_multiple(cli_translate, ARRAY_LEN(cli_translate));
 	ast_register_cleanup(translate_shutdown);
 	return res;
@@ -139,6 +139,10 @@ static struct ast_sockaddr udptldebugaddr;   /*!< Debug packets to/from this hos
 typedef struct {
 	int buf_len;
 	uint8_t buf[LOCAL_FAX_MAX_DATAGRAM];
+	/*! The IFP encoded as an open type, as sent in redundancy sets */
+	unsigned int enc_len;
+	/*! Room for the IFP and its length determinant, at most 2 octets for these sizes */
+	uint8_t enc[LOCAL_FAX_MAX_DATAGRAM + 2];
 } udptl_fec_tx_buffer_t;
 
 typedef struct {
@@ -376,6 +380,22 @@ static int encode_open_type(const struct ast_udptl *udptl, uint8_t *buf, unsigne
 }
 /*- End of function --------------------------------------------------------*/
 
+/*! \brief Append an IFP kept in the transmit buffer, already encoded as an open type */
+static int append_encoded_open_type(const struct ast_udptl *udptl, uint8_t *buf, unsigned int buflen,
+				    unsigned int *len, const udptl_fec_tx_buffer_t *tx)
+{
+	if (tx->enc_len + *len > buflen) {
+		ast_log(LOG_ERROR, "UDPTL (%s): Buffer overflow detected (%u + %u > %u)\n",
+			LOG_TAG(udptl), tx->enc_len, *len, buflen);
+		return -1;
+	}
+	memcpy(&buf[*len], tx->enc, tx->enc_len);
+	*len += tx->enc_len;
+
+	return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int udptl_rx_packet(struct ast_udptl *s, uint8_t *buf, unsigned int len)
 {
 	int stat1;
@@ -636,9 +656,15 @@ static int udptl_build_packet(struct ast_udptl *s, uint8_t *buf, unsigned int bu
 	entry = seq & UDPTL_BUF_MASK;
 
 	/* We save the message in a circular buffer, for generating FEC or
-	   redundancy sets later on. */
+	   redundancy sets later on. It is encoded once, the encoding being
+	   copied as is into the packet and into the redundancy sets of the
+	   packets that follow. */
 	s->tx[entry].buf_len = ifp_len;
 	memcpy(s->tx[entry].buf, ifp, ifp_len);
+	s->tx[entry].enc_len = 0;
+	if (encode_open_type(s, s->tx[entry].enc, sizeof(s->tx[entry].enc), &s->tx[entry].enc_len, ifp, ifp_len) < 0) {
+		return -1;
+	}
 
 	/* Build the UDPTLPacket */
 
@@ -648,7 +674,7 @@ static int udptl_build_packet(struct ast_udptl *s, uint8_t *buf, unsigned int bu
 	buf[len++] = seq & 0xFF;
 
 	/* Encode the primary IFP packet */
-	if (encode_open_type(s, buf, buflen, &len, ifp, ifp_len) < 0)
+	if (append_encoded_open_type(s, buf, buflen, &len, &s->tx[entry]) < 0)
 		return -1;
 
 	/* Encode the appropriate type of error recovery information */
@@ -674,7 +700,7 @@ static int udptl_build_packet(struct ast_udptl *s, uint8_t *buf, unsigned int bu
 		/* Encode the elements */
 		for (i = 0; i < entries; i++) {
 			j = (entry - i - 1) & UDPTL_BUF_MASK;
-			if (encode_open_type(s, buf, buflen, &len, s->tx[j].buf, s->tx[j].buf_len) < 0) {
+			if (append_encoded_open_type(s, buf, buflen, &len, &s->tx[j]) < 0) {
 				ast_debug(1, "UDPTL (%s): Encoding failed at i=%d, j=%d\n",
 					  LOG_TAG(s), i, j);
 				return -1;
@@ -1164,8 +1190,6 @@ int ast_udptl_write(struct ast_udptl *s, struct ast_frame *f)
 	const int bufsize = (s->far_max_datagram > 0) ? s->far_max_datagram : DEFAULT_FAX_MAX_DATAGRAM;
 	uint8_t buf[bufsize];
 
-	memset(buf, 0, sizeof(buf));
-
 	/* If we have no peer, return immediately */
 	if (ast_sockaddr_isnull(&s->them)) {
 		return 0;
@@ -31,15 +31,92 @@
 #include "asterisk/strings.h"
 #include "asterisk/logger.h"
 #include "asterisk/lock.h"
+#include "asterisk/threadstorage.h"
+#include "asterisk/time.h"
 
 AST_MUTEX_DEFINE_STATIC(uuid_lock);
 
 static int has_dev_urandom;
 
+/*! \brief /dev/urandom, kept open for the threads to refill their random bytes from */
+static int dev_urandom_fd = -1;
+
+/*! \brief How many random bytes each thread reads at once, enough for 256 UUIDs */
+#define UUID_RANDOM_BATCH 4096
+
+/*! \brief The random bytes a thread has left for the UUIDs it generates */
+struct uuid_random {
+	/*! How many bytes are left, at the end of the buffer */
+	size_t left;
+	unsigned char bytes[UUID_RANDOM_BATCH];
+};
+
+AST_THREADSTORAGE(uuid_random_storage);
+
 struct ast_uuid {
 	uuid_t uu;
 };
 
+/*!
+ * \internal
+ * \brief Take random bytes from those read by the thread
+ *
+ * Rather than every UUID reading /dev/urandom, or libuuid doing so, each
+ * thread reads a batch of bytes and takes from them without any locking.
+ *
+ * \retval 0 on success
+ * \retval -1 if /dev/urandom could not be read
+ */
+static int uuid_random_take(unsigned char *dst, size_t len)
+{
+	struct uuid_random *random;
+	unsigned char *src;
+
+	if (dev_urandom_fd < 0) {
+		return -1;
+	}
+
+	random = ast_threadstorage_get(&uuid_random_storage, sizeof(*random));
+	if (!random) {
+		return -1;
+	}
+
+	if (random->left < len) {
+		size_t filled = 0;
+
+		while (filled < sizeof(random->bytes)) {
+			ssize_t res = read(dev_urandom_fd, random->bytes + filled, sizeof(random->bytes) - filled);
+
+			if (res <= 0) {
+				if (res < 0 && errno == EINTR) {
+					continue;
+				}
+				return -1;
+			}
+			filled += res;
+		}
+		random->left = sizeof(random->bytes);
+	}
+
+	src = random->bytes + sizeof(random->bytes) - random->left;
+	memcpy(dst, src, len);
+	/* Bytes handed out are not kept around */
+	memset(src, 0, len);
+	random->left -= len;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Set the version and RFC 4122 variant of a UUID
+ */
+static void uuid_set_version(struct ast_uuid *uuid, unsigned char version)
+{
+	uuid->uu[6] = (uuid->uu[6] & 0x0f) | (version << 4);
+	uuid->uu[8] = (uuid->uu[8] & 0x3f) | 0x80;
+}
+
 /*!
  * \internal
  * \brief Generate a UUID.
@@ -107,6 +184,11 @@ static void generate_uuid(struct ast_uuid *uuid)
 	 * or /dev/urandom not existing on systems in this age is next to none.
 	 */
 
+	if (!uuid_random_take(uuid->uu, sizeof(uuid->uu))) {
+		uuid_set_version(uuid, 4);
+		return;
+	}
+
 	/* XXX Currently, we only protect this call if the user has no /dev/urandom on their system.
 	 * If it turns out that there are issues with UUID generation despite the presence of
 	 * /dev/urandom, then we may need to make the locking/unlocking unconditional.
@@ -133,9 +215,22 @@ struct ast_uuid *ast_uuid_generate(void)
 
 char *ast_uuid_to_str(struct ast_uuid *uuid, char *buf, size_t size)
 {
+	static const char hex[] = "0123456789abcdef";
+	char *pos = buf;
+	int i;
+
 	ast_assert(size >= AST_UUID_STR_LEN);
-	uuid_unparse(uuid->uu, buf);
-	return ast_str_to_lower(buf);
+
+	for (i = 0; i < sizeof(uuid->uu); i++) {
+		if (i == 4 || i == 6 || i == 8 || i == 10) {
+			*pos++ = '-';
+		}
+		*pos++ = hex[uuid->uu[i] >> 4];
+		*pos++ = hex[uuid->uu[i] & 0x0f];
+	}
+	*pos = '\0';
+
+	return buf;
 }
 
 char *ast_uuid_generate_str(char *buf, size_t size)
@@ -146,6 +241,27 @@ char *ast_uuid_generate_str(char *buf, size_t size)
 	return ast_uuid_to_str(&uuid, buf, size);
 }
 
+char *ast_uuid_generate_time_ordered_str(char *buf, size_t size)
+{
+	struct ast_uuid uuid;
+	struct timeval now = ast_tvnow();
+	uint64_t ms = now.tv_sec * 1000ULL + now.tv_usec / 1000;
+	int i;
+
+	if (uuid_random_take(uuid.uu + 6, sizeof(uuid.uu) - 6)) {
+		generate_uuid(&uuid);
+	}
+
+	/* A big endian count of milliseconds since the epoch leads, as RFC 9562 has it */
+	for (i = 5; i >= 0; i--) {
+		uuid.uu[i] = ms & 0xff;
+		ms >>= 8;
+	}
+	uuid_set_version(&uuid, 7);
+
+	return ast_uuid_to_str(&uuid, buf, size);
+}
+
 struct ast_uuid *ast_str_to_uuid(char *str)
 {
 	struct ast_uuid *uuid = ast_malloc(sizeof(*uuid));
@@ -209,7 +325,6 @@ void ast_uuid_init(void)
 	 * Think of this along the same lines as initializing a singleton.
 	 */
 	uuid_t uu;
-	int dev_urandom_fd;
 
 	dev_urandom_fd = open("/dev/urandom", O_RDONLY);
 	if (dev_urandom_fd < 0) {
@@ -221,7 +336,6 @@ void ast_uuid_init(void)
 				"system to have /dev/urandom\n");
 	} else {
 		has_dev_urandom = 1;
-		close(dev_urandom_fd);
 	}
 	uuid_generate_random(uu);
 
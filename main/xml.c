@@ -91,21 +91,16 @@ static int process_xincludes(xmlDoc *doc)
 	return res;
 }
 
-struct ast_xml_doc *ast_xml_open(char *filename)
+/*!
+ * \internal
+ * \brief Process the XML inclusions of a freshly read document and apply its stylesheet.
+ *
+ * \param doc the document to process, freed on error
+ *
+ * \return The processed document, NULL on error
+ */
+static xmlDoc *xml_doc_process(xmlDoc *doc)
 {
-	xmlDoc *doc;
-
-	if (!filename) {
-		return NULL;
-	}
-
-	xmlSubstituteEntitiesDefault(1);
-
-	doc = xmlReadFile(filename, NULL, XML_PARSE_RECOVER);
-	if (!doc) {
-		return NULL;
-	}
-
 	/* process xinclude elements. */
 	if (process_xincludes(doc) < 0) {
 		xmlFreeDoc(doc);
@@ -125,14 +120,52 @@ struct ast_xml_doc *ast_xml_open(char *filename)
 			doc = tmpdoc;
 		}
 	}
-#else /* no HAVE_LIBXSLT */
-	ast_log(LOG_NOTICE, "XSLT support not found. XML documentation may be incomplete.\n");
 #endif /* HAVE_LIBXSLT */
 
 	/* Optimize for XPath */
 	xmlXPathOrderDocElems(doc);
 
-	return (struct ast_xml_doc *) doc;
+	return doc;
+}
+
+struct ast_xml_doc *ast_xml_open(char *filename)
+{
+	xmlDoc *doc;
+
+	if (!filename) {
+		return NULL;
+	}
+
+	xmlSubstituteEntitiesDefault(1);
+
+	doc = xmlReadFile(filename, NULL, XML_PARSE_RECOVER);
+	if (!doc) {
+		return NULL;
+	}
+
+#ifndef HAVE_LIBXSLT
+	ast_log(LOG_NOTICE, "XSLT support not found. XML documentation may be incomplete.\n");
+#endif /* HAVE_LIBXSLT */
+
+	return (struct ast_xml_doc *) xml_doc_process(doc);
+}
+
+struct ast_xml_doc *ast_xml_open_memory(const char *buffer, size_t size, const char *filename)
+{
+	xmlDoc *doc;
+
+	if (!buffer) {
+		return NULL;
+	}
+
+	xmlSubstituteEntitiesDefault(1);
+
+	doc = xmlReadMemory(buffer, (int) size, filename, NULL, XML_PARSE_RECOVER);
+	if (!doc) {
+		return NULL;
+	}
+
+	return (struct ast_xml_doc *) xml_doc_process(doc);
 }
 
 struct ast_xml_doc *ast_xml_new(void)
@@ -29,6 +29,9 @@
 
 #include "asterisk.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+
 #include "asterisk/_private.h"
 #include "asterisk/paths.h"
 #include "asterisk/linkedlists.h"
@@ -50,10 +53,36 @@ static const int xmldoc_text_columns = 79;
 /*! \brief XML documentation language. */
 static char documentation_language[6];
 
+/*! \brief Parse the documentation as it is asked for rather than all of it at startup. */
+static int xmldoc_lazy;
+
+/*! \brief How many parsed elements no one holds on to are kept when loading lazily. */
+#define XMLDOC_LAZY_UNPINNED_MAX 32
+
+struct documentation_tree;
+
+/*! \brief An element under the root of a documentation file, indexed when loading lazily */
+struct documentation_entry {
+	char *type;					/*!< Element name, the type of documentation. */
+	char *name;					/*!< Its name attribute. */
+	char *language;					/*!< Its language attribute. */
+	char *module;					/*!< Its module attribute. */
+	size_t offset;					/*!< Where the element starts in the file. */
+	size_t length;					/*!< Length of the element in the file. */
+	struct documentation_tree *tree;		/*!< The file the element is in. */
+	struct ast_xml_doc *doc;			/*!< The element and those it includes, once parsed. */
+	unsigned int empty:1;				/*!< The element has no content. */
+	unsigned int pinned:1;				/*!< Nodes of doc were handed out, so it is kept. */
+};
+
+AST_VECTOR(documentation_entries, struct documentation_entry *);
+
 /*! \brief XML documentation tree */
 struct documentation_tree {
 	char *filename;					/*!< XML document filename. */
-	struct ast_xml_doc *doc;			/*!< Open document pointer. */
+	struct ast_xml_doc *doc;			/*!< Open document pointer, only once needed when loading lazily. */
+	char *prolog;					/*!< The file up to the root element's start tag, when loading lazily. */
+	struct documentation_entries entries;		/*!< Index of the elements under the root, when loading lazily. */
 	AST_RWLIST_ENTRY(documentation_tree) entry;
 };
 
@@ -73,6 +102,12 @@ static int xmldoc_parse_specialtags(struct ast_xml_node *fixnode, const char *ta
  */
 static AST_RWLIST_HEAD_STATIC(xmldoc_tree, documentation_tree);
 
+/*! \brief Protects parsing indexed elements, which happens with xmldoc_tree read locked */
+AST_MUTEX_DEFINE_STATIC(xmldoc_lazy_lock);
+
+/*! \brief How many indexed elements are parsed that no one holds on to */
+static unsigned int xmldoc_lazy_unpinned;
+
 static const struct strcolorized_tags {
 	const char *init;      /*!< Replace initial tag with this string. */
 	const char *end;       /*!< Replace end tag with this string. */
@@ -416,6 +451,574 @@ static int xmldoc_attribute_match(struct ast_xml_node *node, const char *attr, c
 	return match;
 }
 
+static void xmldoc_entry_free(struct documentation_entry *entry)
+{
+	ast_free(entry->type);
+	ast_free(entry->name);
+	ast_free(entry->language);
+	ast_free(entry->module);
+	ast_xml_close(entry->doc);
+	ast_free(entry);
+}
+
+/*!
+ * \internal
+ * \brief Find where the markup starting at the given '<' ends.
+ *
+ * \param tag The start of the markup
+ *
+ * \return The position just after the markup, NULL if it does not end
+ */
+static const char *xmldoc_markup_end(const char *tag)
+{
+	const char *end;
+	char quote = 0;
+	int subset = 0;
+
+	if (ast_begins_with(tag, "<!--")) {
+		end = strstr(tag + 4, "-->");
+		return end ? end + 3 : NULL;
+	}
+	if (ast_begins_with(tag, "<![CDATA[")) {
+		end = strstr(tag + 9, "]]>");
+		return end ? end + 3 : NULL;
+	}
+	if (ast_begins_with(tag, "<?")) {
+		end = strstr(tag + 2, "?>");
+		return end ? end + 2 : NULL;
+	}
+
+	/* Attribute values and a DOCTYPE's internal subset may hold a '>' */
+	for (end = tag + 1; *end; end++) {
+		if (quote) {
+			if (*end == quote) {
+				quote = 0;
+			}
+		} else if (*end == '"' || *end == '\'') {
+			quote = *end;
+		} else if (*end == '[') {
+			subset++;
+		} else if (*end == ']') {
+			subset--;
+		} else if (*end == '>' && subset <= 0) {
+			return end + 1;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Create the index entry of an element from its start tag.
+ *
+ * \param tag The start of the tag
+ * \param tag_end The position just after the tag
+ *
+ * \retval NULL on error.
+ * \return The entry, with only the element name and attributes set.
+ */
+static struct documentation_entry *xmldoc_entry_alloc(const char *tag, const char *tag_end)
+{
+	struct documentation_entry *entry;
+	const char *pos = tag + 1;
+	size_t len;
+
+	entry = ast_calloc(1, sizeof(*entry));
+	if (!entry) {
+		return NULL;
+	}
+
+	len = strcspn(pos, " \t\r\n/>");
+	entry->type = ast_strndup(pos, len);
+	if (!entry->type) {
+		xmldoc_entry_free(entry);
+		return NULL;
+	}
+
+	for (pos += len; pos < tag_end; pos++) {
+		const char *attr;
+		const char *value;
+		char quote;
+
+		pos += strspn(pos, " \t\r\n");
+		attr = pos;
+		len = strcspn(pos, " \t\r\n=/>");
+		pos += len;
+		pos += strspn(pos, " \t\r\n");
+		if (!len || *pos != '=') {
+			break;
+		}
+		pos += 1 + strspn(pos + 1, " \t\r\n");
+		quote = *pos;
+		if (quote != '"' && quote != '\'') {
+			break;
+		}
+		value = pos + 1;
+		pos = strchr(value, quote);
+		if (!pos || pos >= tag_end) {
+			break;
+		}
+
+		if (len == 4 && !strncmp(attr, "name", len)) {
+			entry->name = ast_strndup(value, pos - value);
+		} else if (len == 8 && !strncmp(attr, "language", len)) {
+			entry->language = ast_strndup(value, pos - value);
+		} else if (len == 6 && !strncmp(attr, "module", len)) {
+			entry->module = ast_strndup(value, pos - value);
+		}
+	}
+
+	return entry;
+}
+
+/*!
+ * \internal
+ * \brief Index the elements under the root of a documentation file.
+ *
+ * \param doctree The documentation tree to index
+ * \param text The text of the file
+ *
+ * \retval 0 on success.
+ * \retval -1 if the file is not well formed or on error.
+ */
+static int xmldoc_index_documentation(struct documentation_tree *doctree, const char *text)
+{
+	struct documentation_entry *current = NULL;
+	const char *content = NULL;
+	const char *pos = text;
+	int depth = -1;
+
+	while ((pos = strchr(pos, '<'))) {
+		const char *tag = pos;
+
+		pos = xmldoc_markup_end(tag);
+		if (!pos) {
+			break;
+		}
+
+		/* Comments, CDATA, declarations and processing instructions */
+		if (tag[1] == '!' || tag[1] == '?') {
+			continue;
+		}
+
+		if (tag[1] == '/') {
+			if (--depth < 0) {
+				/* The end of the root */
+				return 0;
+			}
+			if (!depth && current) {
+				current->length = pos - text - current->offset;
+				current->empty = tag == content;
+				if (AST_VECTOR_APPEND(&doctree->entries, current)) {
+					break;
+				}
+				current = NULL;
+			}
+			continue;
+		}
+
+		if (depth < 0) {
+			/* The root, which the elements are wrapped in again when parsed */
+			if (strncmp(tag, "<docs", 5) || !strchr(" \t\r\n>", tag[5])) {
+				break;
+			}
+			doctree->prolog = ast_strndup(text, pos - text);
+			if (!doctree->prolog) {
+				break;
+			}
+			depth = 0;
+			continue;
+		}
+
+		if (!depth) {
+			current = xmldoc_entry_alloc(tag, pos);
+			if (!current) {
+				break;
+			}
+			current->offset = tag - text;
+			current->tree = doctree;
+			content = pos;
+		}
+
+		if (pos[-2] == '/') {
+			/* An element without content */
+			if (!depth) {
+				current->length = pos - tag;
+				current->empty = 1;
+				if (AST_VECTOR_APPEND(&doctree->entries, current)) {
+					break;
+				}
+				current = NULL;
+			}
+			continue;
+		}
+
+		depth++;
+	}
+
+	if (current) {
+		xmldoc_entry_free(current);
+	}
+
+	return -1;
+}
+
+static void xmldoc_tree_free(struct documentation_tree *doctree)
+{
+	AST_VECTOR_CALLBACK_VOID(&doctree->entries, xmldoc_entry_free);
+	AST_VECTOR_FREE(&doctree->entries);
+	ast_free(doctree->prolog);
+	ast_free(doctree->filename);
+	ast_xml_close(doctree->doc);
+	ast_free(doctree);
+}
+
+/*!
+ * \internal
+ * \brief Index a documentation file rather than parse it.
+ *
+ * \param filename The documentation file
+ *
+ * \retval NULL on error.
+ * \return The documentation tree, with no document.
+ */
+static struct documentation_tree *xmldoc_index_file(const char *filename)
+{
+	struct documentation_tree *doctree;
+	struct stat st;
+	char *text;
+	FILE *f;
+	int res;
+
+	f = fopen(filename, "r");
+	if (!f) {
+		ast_log(LOG_ERROR, "Could not open XML documentation at '%s': %s\n", filename, strerror(errno));
+		return NULL;
+	}
+
+	if (fstat(fileno(f), &st) || !(text = ast_malloc(st.st_size + 1))) {
+		fclose(f);
+		return NULL;
+	}
+
+	res = fread(text, 1, st.st_size, f) != (size_t) st.st_size;
+	fclose(f);
+	if (res) {
+		ast_log(LOG_ERROR, "Could not read XML documentation at '%s'\n", filename);
+		ast_free(text);
+		return NULL;
+	}
+	text[st.st_size] = '\0';
+
+	doctree = ast_calloc(1, sizeof(*doctree));
+	if (!doctree || AST_VECTOR_INIT(&doctree->entries, 256)) {
+		ast_free(doctree);
+		ast_free(text);
+		return NULL;
+	}
+
+	doctree->filename = ast_strdup(filename);
+	if (!doctree->filename || xmldoc_index_documentation(doctree, text)) {
+		ast_log(LOG_ERROR, "Documentation file '%s' is not well formed!\n", filename);
+		xmldoc_tree_free(doctree);
+		doctree = NULL;
+	}
+	ast_free(text);
+
+	return doctree;
+}
+
+/*!
+ * \internal
+ * \brief Add the elements included by an element to those to parse with it.
+ *
+ * \param doctree The documentation tree the element is in
+ * \param text The text of the element
+ * \param parts The elements to parse, added to
+ */
+static void xmldoc_entry_includes(struct documentation_tree *doctree, const char *text,
+	struct documentation_entries *parts)
+{
+	const char *pos = text;
+	char type[64];
+	char name[128];
+	int idx;
+
+	while ((pos = strstr(pos, "xpointer("))) {
+		pos += strlen("xpointer(");
+		if (sscanf(pos + (*pos == '/'), "docs/%63[^[/][@name='%127[^']'", type, name) != 2) {
+			continue;
+		}
+
+		for (idx = 0; idx < AST_VECTOR_SIZE(&doctree->entries); idx++) {
+			struct documentation_entry *cur = AST_VECTOR_GET(&doctree->entries, idx);
+
+			if (strcmp(cur->type, type) || !cur->name || strcmp(cur->name, name)
+				|| AST_VECTOR_GET_CMP(parts, cur, AST_VECTOR_ELEM_DEFAULT_CMP)) {
+				continue;
+			}
+			AST_VECTOR_APPEND(parts, cur);
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Parse an indexed element along with the elements it includes.
+ *
+ * \param entry The indexed element
+ *
+ * \retval NULL on error.
+ * \return A document of the element, followed by the elements it includes.
+ */
+static struct ast_xml_doc *xmldoc_entry_parse(struct documentation_entry *entry)
+{
+	struct documentation_tree *doctree = entry->tree;
+	struct documentation_entries parts;
+	struct ast_xml_doc *doc = NULL;
+	struct ast_str *text;
+	int fd;
+	int idx;
+
+	fd = open(doctree->filename, O_RDONLY);
+	if (fd < 0) {
+		ast_log(LOG_ERROR, "Could not open XML documentation at '%s': %s\n", doctree->filename, strerror(errno));
+		return NULL;
+	}
+
+	text = ast_str_create(strlen(doctree->prolog) + entry->length + 16);
+	if (!text || AST_VECTOR_INIT(&parts, 8) || AST_VECTOR_APPEND(&parts, entry)) {
+		ast_free(text);
+		close(fd);
+		return NULL;
+	}
+	ast_str_set(&text, 0, "%s", doctree->prolog);
+
+	/* The elements added by the includes are looked at in turn for theirs */
+	for (idx = 0; idx < AST_VECTOR_SIZE(&parts); idx++) {
+		struct documentation_entry *part = AST_VECTOR_GET(&parts, idx);
+		size_t used = ast_str_strlen(text);
+
+		if (ast_str_make_space(&text, used + part->length + 1)
+			|| pread(fd, ast_str_buffer(text) + used, part->length, part->offset) != (ssize_t) part->length) {
+			break;
+		}
+		ast_str_buffer(text)[used + part->length] = '\0';
+		ast_str_update(text);
+
+		xmldoc_entry_includes(doctree, ast_str_buffer(text) + used, &parts);
+	}
+
+	if (idx == AST_VECTOR_SIZE(&parts)) {
+		ast_str_append(&text, 0, "\n</docs>\n");
+		doc = ast_xml_open_memory(ast_str_buffer(text), ast_str_strlen(text), doctree->filename);
+	}
+
+	AST_VECTOR_FREE(&parts);
+	ast_free(text);
+	close(fd);
+
+	return doc;
+}
+
+/*!
+ * \internal
+ * \brief Get the node of an indexed element, parsing the element if need be.
+ *
+ * \param entry The indexed element
+ * \param pin Non-zero to keep the parsed element until the documentation is reloaded
+ *
+ * \retval NULL on error.
+ * \return The node of the element.
+ *
+ * \note Must be called with a RDLOCK held on xmldoc_tree
+ */
+static struct ast_xml_node *xmldoc_entry_node(struct documentation_entry *entry, int pin)
+{
+	struct ast_xml_node *node;
+
+	ast_mutex_lock(&xmldoc_lazy_lock);
+	if (!entry->doc) {
+		entry->doc = xmldoc_entry_parse(entry);
+		if (!entry->doc) {
+			ast_mutex_unlock(&xmldoc_lazy_lock);
+			ast_log(LOG_ERROR, "Could not parse %s %s in XML documentation at '%s'\n",
+				entry->type, S_OR(entry->name, ""), entry->tree->filename);
+			return NULL;
+		}
+		if (!pin) {
+			xmldoc_lazy_unpinned++;
+		}
+	} else if (pin && !entry->pinned) {
+		xmldoc_lazy_unpinned--;
+	}
+	if (pin) {
+		entry->pinned = 1;
+	}
+	ast_mutex_unlock(&xmldoc_lazy_lock);
+
+	/* The element comes first, before those it includes */
+	node = ast_xml_node_get_children(ast_xml_get_root(entry->doc));
+	return ast_xml_find_element(node, entry->type, "name", entry->name);
+}
+
+/*!
+ * \internal
+ * \brief Get the whole of a documentation file, parsing it if it was only indexed.
+ *
+ * \note Once parsed, the file is kept until the documentation is reloaded.
+ * \note Must be called with a RDLOCK held on xmldoc_tree
+ */
+static struct ast_xml_doc *xmldoc_tree_doc(struct documentation_tree *doctree)
+{
+	struct ast_xml_doc *doc;
+
+	ast_mutex_lock(&xmldoc_lazy_lock);
+	if (!doctree->doc) {
+		doctree->doc = ast_xml_open(doctree->filename);
+		if (!doctree->doc) {
+			ast_log(LOG_ERROR, "Could not open XML documentation at '%s'\n", doctree->filename);
+		}
+	}
+	doc = doctree->doc;
+	ast_mutex_unlock(&xmldoc_lazy_lock);
+
+	return doc;
+}
+
+/*!
+ * \internal
+ * \brief Free the parsed elements no one holds on to, once there are too many of them.
+ */
+static void xmldoc_lazy_trim(void)
+{
+	struct documentation_tree *doctree;
+	int idx;
+
+	if (!xmldoc_lazy || xmldoc_lazy_unpinned <= XMLDOC_LAZY_UNPINNED_MAX) {
+		return;
+	}
+
+	/* No one is looking at any of them with the write lock held */
+	AST_RWLIST_WRLOCK(&xmldoc_tree);
+	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
+		for (idx = 0; idx < AST_VECTOR_SIZE(&doctree->entries); idx++) {
+			struct documentation_entry *cur = AST_VECTOR_GET(&doctree->entries, idx);
+
+			if (cur->doc && !cur->pinned) {
+				ast_xml_close(cur->doc);
+				cur->doc = NULL;
+			}
+		}
+	}
+	xmldoc_lazy_unpinned = 0;
+	AST_RWLIST_UNLOCK(&xmldoc_tree);
+}
+
+/*!
+ * \internal
+ * \brief Get the indexed element for 'name' of 'type', as xmldoc_get_node() does.
+ *
+ * \note Must be called with a RDLOCK held on xmldoc_tree
+ */
+static struct documentation_entry *xmldoc_get_entry(const char *type, const char *name, const char *module, const char *language)
+{
+	struct documentation_tree *doctree;
+	int idx;
+
+	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
+		struct documentation_entry *first_match = NULL;
+		struct documentation_entry *lang_match = NULL;
+
+		for (idx = 0; idx < AST_VECTOR_SIZE(&doctree->entries); idx++) {
+			struct documentation_entry *cur = AST_VECTOR_GET(&doctree->entries, idx);
+
+			/* ignore empty elements */
+			if (cur->empty || strcmp(cur->type, type) || !cur->name || strcmp(cur->name, name)) {
+				continue;
+			}
+
+			if (!first_match) {
+				first_match = cur;
+			}
+
+			if (!cur->language || strcmp(cur->language, language)) {
+				continue;
+			}
+
+			if (!lang_match) {
+				lang_match = cur;
+			}
+
+			if (ast_strlen_zero(module) || (cur->module && !strcmp(cur->module, module))) {
+				return cur;
+			}
+		}
+
+		if (lang_match) {
+			return lang_match;
+		}
+
+		if (first_match) {
+			return first_match;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Execute an XPath query on the indexed documentation.
+ *
+ * Queries for the elements with a given name are run on those elements
+ * alone, anything else on the whole of the files.
+ *
+ * \note Must be called with a RDLOCK held on xmldoc_tree
+ */
+static struct ast_xml_xpath_results *xmldoc_lazy_query(const char *xpath)
+{
+	struct ast_xml_xpath_results *results;
+	struct documentation_tree *doctree;
+	char type[64];
+	char name[128];
+	int idx;
+
+	if (sscanf(xpath, "/docs/%63[^[/][@name='%127[^']'", type, name) != 2) {
+		AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
+			struct ast_xml_doc *doc = xmldoc_tree_doc(doctree);
+
+			if (doc && (results = ast_xml_query(doc, xpath))) {
+				return results;
+			}
+		}
+		return NULL;
+	}
+
+	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
+		for (idx = 0; idx < AST_VECTOR_SIZE(&doctree->entries); idx++) {
+			struct documentation_entry *cur = AST_VECTOR_GET(&doctree->entries, idx);
+
+			if (strcmp(cur->type, type) || !cur->name || strcmp(cur->name, name)) {
+				continue;
+			}
+
+			/* The results point into the element for as long as whoever asked wants */
+			if (xmldoc_entry_node(cur, 1) && (results = ast_xml_query(cur->doc, xpath))) {
+				return results;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+int ast_xmldoc_lazy(void)
+{
+	return xmldoc_lazy;
+}
+
 /*!
  * \internal
  * \brief Get the application/function node for 'name' application/function with language 'language'
@@ -439,6 +1042,12 @@ static struct ast_xml_node *xmldoc_get_node(const char *type, const char *name,
 	struct ast_xml_node *lang_match = NULL;
 	struct documentation_tree *doctree;
 
+	if (xmldoc_lazy) {
+		struct documentation_entry *doc_entry = xmldoc_get_entry(type, name, module, language);
+
+		return doc_entry ? xmldoc_entry_node(doc_entry, 0) : NULL;
+	}
+
 	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
 		/* the core xml documents have priority over thirdparty document. */
 		node = ast_xml_get_root(doctree->doc);
@@ -1254,6 +1863,7 @@ char *ast_xmldoc_build_syntax(const char *type, const char *name, const char *mo
 	struct ast_xml_node *node;
 	char *syntax;
 
+	xmldoc_lazy_trim();
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
 	node = xmldoc_get_node(type, name, module, documentation_language);
 	if (!node) {
@@ -1708,6 +2318,8 @@ char *ast_xmldoc_build_seealso(const char *type, const char *name, const char *m
 		return NULL;
 	}
 
+	xmldoc_lazy_trim();
+
 	/* get the application/function root node. */
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
 	node = xmldoc_get_node(type, name, module, documentation_language);
@@ -2090,6 +2702,7 @@ char *ast_xmldoc_build_arguments(const char *type, const char *name, const char
 		return NULL;
 	}
 
+	xmldoc_lazy_trim();
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
 	node = xmldoc_get_node(type, name, module, documentation_language);
 
@@ -2211,6 +2824,7 @@ static char *xmldoc_build_field(const char *type, const char *name, const char *
 		return NULL;
 	}
 
+	xmldoc_lazy_trim();
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
 	node = xmldoc_get_node(type, name, module, documentation_language);
 
@@ -2490,6 +3104,7 @@ struct ast_xml_doc_item *ast_xmldoc_build_list_responses(const char *type, const
 		return NULL;
 	}
 
+	xmldoc_lazy_trim();
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
 	node = xmldoc_get_node(type, name, module, documentation_language);
 
@@ -2560,6 +3175,7 @@ struct ast_xml_doc_item *ast_xmldoc_build_final_response(const char *type, const
 		return NULL;
 	}
 
+	xmldoc_lazy_trim();
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
 	node = xmldoc_get_node(type, name, module, documentation_language);
 
@@ -2593,6 +3209,11 @@ struct ast_xml_xpath_results *__attribute__((format(printf, 1, 2))) ast_xmldoc_q
 	}
 
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
+	if (xmldoc_lazy) {
+		results = xmldoc_lazy_query(ast_str_buffer(xpath_str));
+		AST_RWLIST_UNLOCK(&xmldoc_tree);
+		return results;
+	}
 	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
 		if (!(results = ast_xml_query(doctree->doc, ast_str_buffer(xpath_str)))) {
 			continue;
@@ -2697,8 +3318,10 @@ struct ao2_container *ast_xmldoc_build_documentation(const char *type)
 
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
 	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
-		/* the core xml documents have priority over thirdparty document. */
-		node = ast_xml_get_root(doctree->doc);
+		/* the core xml documents have priority over thirdparty document.
+		 * Every item of the type is wanted, so lazily loaded files are
+		 * parsed whole rather than element by element. */
+		node = ast_xml_get_root(xmldoc_tree_doc(doctree));
 		if (!node) {
 			break;
 		}
@@ -2854,17 +3477,26 @@ static char *handle_dump_docs(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
 	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
-		struct ast_xml_node *root_node = ast_xml_get_root(doctree->doc);
+		/* Files only indexed are parsed for as long as it takes to copy them */
+		struct ast_xml_doc *doc = doctree->doc ? doctree->doc : ast_xml_open(doctree->filename);
+		struct ast_xml_node *root_node = ast_xml_get_root(doc);
 		struct ast_xml_node *kids = ast_xml_node_get_children(root_node);
 		struct ast_xml_node *kids_copy;
 
 		/* If there are no kids someone screwed up, but we check anyway. */
 		if (!kids) {
+			if (doc != doctree->doc) {
+				ast_xml_close(doc);
+			}
 			continue;
 		}
 
 		kids_copy = ast_xml_copy_node_list(kids);
+		if (doc != doctree->doc) {
+			ast_xml_close(doc);
+		}
 		if (!kids_copy) {
+			AST_RWLIST_UNLOCK(&xmldoc_tree);
 			ast_xml_close(dumpdoc);
 			ast_log(LOG_ERROR, "Could not create copy of XML node list\n");
 			return CLI_FAILURE;
@@ -2898,10 +3530,9 @@ static void xmldoc_purge_documentation(void)
 	struct documentation_tree *doctree;
 
 	while ((doctree = AST_RWLIST_REMOVE_HEAD(&xmldoc_tree, entry))) {
-		ast_free(doctree->filename);
-		ast_xml_close(doctree->doc);
-		ast_free(doctree);
+		xmldoc_tree_free(doctree);
 	}
+	xmldoc_lazy_unpinned = 0;
 }
 
 /*! \brief Close and unload XML documentation. */
@@ -2941,6 +3572,9 @@ static int xmldoc_load_documentation(int first_time)
 				if (!ast_strlen_zero(var->value)) {
 					snprintf(documentation_language, sizeof(documentation_language), "%s", var->value);
 				}
+			} else if (first_time && !strcasecmp(var->name, "lazy_documentation")) {
+				/* What registered items deferred depends on it, so it cannot change on reload */
+				xmldoc_lazy = ast_true(var->value);
 			}
 		}
 		ast_config_destroy(cfg);
@@ -3008,6 +3642,13 @@ static int xmldoc_load_documentation(int first_time)
 		 * (due to use of GLOB_NOCHECK in xml_pathmatch) */
 			continue;
 		}
+		if (xmldoc_lazy) {
+			doc_tree = xmldoc_index_file(globbuf.gl_pathv[i]);
+			if (doc_tree) {
+				AST_RWLIST_INSERT_TAIL(&xmldoc_tree, doc_tree, entry);
+			}
+			continue;
+		}
 		tmpdoc = NULL;
 		tmpdoc = ast_xml_open(globbuf.gl_pathv[i]);
 		if (!tmpdoc) {
@@ -95,6 +95,9 @@
 
 static const char config[] = "extensions.conf";
 static const char registrar[] = "pbx_config";
+
+/*! \brief The most threads contexts are filled on */
+#define MAX_BUILD_THREADS 64
 static char userscontext[AST_MAX_EXTENSION] = "default";
 
 static int static_config = 0;
@@ -102,6 +105,7 @@ static int write_protect_config = 1;
 static int autofallthrough_config = 1;
 static int clearglobalvars_config = 0;
 static int extenpatternmatchnew_config = 0;
+static int buildthreads_config = 0;
 static char *overrideswitch_config = NULL;
 
 static struct stasis_subscription *fully_booted_subscription;
@@ -1675,9 +1679,13 @@ static char *pbx_strsep(char **destructible, const char *delim)
 	return res;
 }
 
-static int pbx_load_config(const char *config_file)
+/*!
+ * \internal
+ * \brief Fill a context from one of the categories of the config
+ */
+static void pbx_load_context(struct ast_config *cfg, const char *cxt, struct ast_context *con,
+	const char *config_file)
 {
-	struct ast_config *cfg;
 	char *end;
 	char *label;
 #ifdef LOW_MEMORY
@@ -1685,14 +1693,350 @@ static int pbx_load_config(const char *config_file)
 #else
 	char realvalue[8192];
 #endif
-	int lastpri = -2;
+	int lastpri;
+	struct ast_variable *v;
+	char lastextension[256];
+
+	/* Reset continuation items at the beginning of each context */
+	lastextension[0] = '\0';
+	lastpri = -2;
+
+	for (v = ast_variable_browse(cfg, cxt); v; v = v->next) {
+		char *tc = NULL;
+		char realext[256] = "";
+		char *stringp, *ext;
+		const char *vfile;
+
+		/* get filename for error reporting from top level or an #include */
+		vfile = !*v->file ? config_file : v->file;
+
+		if (!strncasecmp(v->name, "same", 4)) {
+			if (ast_strlen_zero(lastextension)) {
+				ast_log(LOG_ERROR,
+					"No previous pattern in the first entry of context '%s' to match '%s' at line %d of %s!\n",
+					cxt, v->name, v->lineno, vfile);
+				continue;
+			}
+			if ((stringp = tc = ast_strdup(v->value))) {
+				ast_copy_string(realext, lastextension, sizeof(realext));
+				goto process_extension;
+			}
+		} else if (!strcasecmp(v->name, "exten")) {
+			int ipri;
+			char *plus;
+			char *pri, *appl, *data, *cidmatch;
+
+			if (!(stringp = tc = ast_strdup(v->value))) {
+				continue;
+			}
+
+			ext = S_OR(pbx_strsep(&stringp, ","), "");
+			pbx_substitute_variables_helper(NULL, ext, realext, sizeof(realext) - 1);
+			ast_copy_string(lastextension, realext, sizeof(lastextension));
+process_extension:
+			ipri = -2;
+			if ((cidmatch = strchr(realext, '/'))) {
+				*cidmatch++ = '\0';
+				ast_shrink_phone_number(cidmatch);
+			}
+			pri = ast_strip(S_OR(strsep(&stringp, ","), ""));
+			if ((label = strchr(pri, '('))) {
+				*label++ = '\0';
+				if ((end = strchr(label, ')'))) {
+					*end = '\0';
+				} else {
+					ast_log(LOG_WARNING,
+						"Label missing trailing ')' at line %d of %s\n",
+						v->lineno, vfile);
+					ast_free(tc);
+					continue;
+				}
+			}
+			if ((plus = strchr(pri, '+'))) {
+				*plus++ = '\0';
+			}
+			if (!strcmp(pri,"hint")) {
+				ipri = PRIORITY_HINT;
+			} else if (!strcmp(pri, "next") || !strcmp(pri, "n")) {
+				if (lastpri > -2) {
+					ipri = lastpri + 1;
+				} else {
+					ast_log(LOG_WARNING,
+						"Can't use 'next' priority on the first entry at line %d of %s!\n",
+						v->lineno, vfile);
+					ast_free(tc);
+					continue;
+				}
+			} else if (!strcmp(pri, "same") || !strcmp(pri, "s")) {
+				if (lastpri > -2) {
+					ipri = lastpri;
+				} else {
+					ast_log(LOG_WARNING,
+						"Can't use 'same' priority on the first entry at line %d of %s!\n",
+						v->lineno, vfile);
+					ast_free(tc);
+					continue;
+				}
+			} else if (sscanf(pri, "%30d", &ipri) != 1 &&
+				   (ipri = ast_findlabel_extension2(NULL, con, realext, pri, cidmatch)) < 1) {
+				ast_log(LOG_WARNING,
+					"Invalid priority/label '%s' at line %d of %s\n",
+					pri, v->lineno, vfile);
+				ipri = 0;
+				ast_free(tc);
+				continue;
+			} else if (ipri < 1) {
+				ast_log(LOG_WARNING, "Invalid priority '%s' at line %d of %s\n",
+					pri, v->lineno, vfile);
+				ast_free(tc);
+				continue;
+			}
+			appl = S_OR(stringp, "");
+			/* Find the first occurrence of '(' */
+			if (!strchr(appl, '(')) {
+				/* No arguments */
+				data = "";
+			} else {
+				char *orig_appl = ast_strdup(appl);
+
+				if (!orig_appl) {
+					ast_free(tc);
+					continue;
+				}
+
+				appl = strsep(&stringp, "(");
+
+				/* check if there are variables or expressions without an application, like: exten => 100,hint,DAHDI/g0/${GLOBAL(var)}  */
+				if (strstr(appl, "${") || strstr(appl, "$[")){
+					/* set appl to original one */
+					strcpy(appl, orig_appl);
+					/* set no data */
+					data = "";
+				/* no variable before application found -> go ahead */
+				} else {
+					data = S_OR(stringp, "");
+					if ((end = strrchr(data, ')'))) {
+						*end = '\0';
+					} else {
+						ast_log(LOG_WARNING,
+							"No closing parenthesis found? '%s(%s' at line %d of %s\n",
+							appl, data, v->lineno, vfile);
+					}
+				}
+				ast_free(orig_appl);
+			}
+
+			appl = ast_skip_blanks(appl);
+			if (ipri) {
+				const char *registrar_file;
+				if (plus) {
+					ipri += atoi(plus);
+				}
+				lastpri = ipri;
+				if (!ast_opt_dont_warn && (!strcmp(realext, "_.") || !strcmp(realext, "_!"))) {
+					ast_log(LOG_WARNING,
+						"The use of '%s' for an extension is strongly discouraged and can have unexpected behavior.  Please use '_X%c' instead at line %d of %s\n",
+						realext, realext[1], v->lineno, vfile);
+				}
+				/* Don't include full path if the configuration file includes slashes */
+				registrar_file = strrchr(vfile, '/');
+				if (!registrar_file) {
+					registrar_file = vfile;
+				} else {
+					registrar_file++; /* Skip past the end slash */
+				}
+				if (ast_add_extension2(con, 0, realext, ipri, label, cidmatch, appl, ast_strdup(data), ast_free_ptr, registrar, registrar_file, v->lineno)) {
+					ast_log(LOG_WARNING,
+						"Unable to register extension at line %d of %s\n",
+						v->lineno, vfile);
+				}
+			}
+			ast_free(tc);
+		} else if (!strcasecmp(v->name, "include")) {
+			pbx_substitute_variables_helper(NULL, v->value, realvalue, sizeof(realvalue) - 1);
+			if (ast_context_add_include2(con, realvalue, registrar)) {
+				switch (errno) {
+				case ENOMEM:
+					ast_log(LOG_WARNING, "Out of memory for context addition\n");
+					break;
+
+				case EBUSY:
+					ast_log(LOG_WARNING, "Failed to lock context(s) list, please try again later\n");
+					break;
+
+				case EEXIST:
+					ast_log(LOG_WARNING,
+						"Context '%s' already included in '%s' context on include at line %d of %s\n",
+						v->value, cxt, v->lineno, vfile);
+					break;
+
+				case ENOENT:
+				case EINVAL:
+					ast_log(LOG_WARNING,
+						"There is no existence of context '%s' included at line %d of %s\n",
+						errno == ENOENT ? v->value : cxt, v->lineno, vfile);
+					break;
+
+				default:
+					ast_log(LOG_WARNING,
+						"Failed to include '%s' in '%s' context at line %d of %s\n",
+						v->value, cxt, v->lineno, vfile);
+					break;
+				}
+			}
+		} else if (!strcasecmp(v->name, "ignorepat")) {
+			pbx_substitute_variables_helper(NULL, v->value, realvalue, sizeof(realvalue) - 1);
+			if (ast_context_add_ignorepat2(con, realvalue, registrar)) {
+				ast_log(LOG_WARNING,
+					"Unable to include ignorepat '%s' in context '%s' at line %d of %s\n",
+					v->value, cxt, v->lineno, vfile);
+			}
+		} else if (!strcasecmp(v->name, "switch") || !strcasecmp(v->name, "lswitch") || !strcasecmp(v->name, "eswitch")) {
+			char *appl, *data;
+			stringp = realvalue;
+
+			if (!strcasecmp(v->name, "switch")) {
+				pbx_substitute_variables_helper(NULL, v->value, realvalue, sizeof(realvalue) - 1);
+			} else {
+				ast_copy_string(realvalue, v->value, sizeof(realvalue));
+			}
+			appl = strsep(&stringp, "/");
+			data = S_OR(stringp, "");
+			if (ast_context_add_switch2(con, appl, data, !strcasecmp(v->name, "eswitch"), registrar)) {
+				ast_log(LOG_WARNING,
+					"Unable to include switch '%s' in context '%s' at line %d of %s\n",
+					v->value, cxt, v->lineno, vfile);
+			}
+		} else if (!strcasecmp(v->name, "autohints")) {
+			ast_context_set_autohints(con, ast_true(v->value));
+		} else {
+			ast_log(LOG_WARNING,
+				"==!!== Unknown directive: %s at line %d of %s -- IGNORING!!!\n",
+				v->name, v->lineno, vfile);
+		}
+	}
+}
+
+/*! \brief A context and a category of the config it is filled from */
+struct context_build {
+	const char *cxt;
+	struct ast_context *con;
+};
+
+AST_VECTOR(context_builds, struct context_build);
+
+/*! \brief A thread filling some of the contexts of the config */
+struct context_builder {
+	struct ast_config *cfg;
+	const char *config_file;
+	const struct context_builds *builds;
+	/*! The builder fills the contexts whose name hashes to this */
+	unsigned int index;
+	unsigned int count;
+	pthread_t thread;
+};
+
+static void *context_builder_thread(void *data)
+{
+	struct context_builder *builder = data;
+	int idx;
+
+	for (idx = 0; idx < AST_VECTOR_SIZE(builder->builds); idx++) {
+		const struct context_build *build = AST_VECTOR_GET_ADDR(builder->builds, idx);
+
+		if ((unsigned int) ast_str_case_hash(ast_get_context_name(build->con)) % builder->count == builder->index) {
+			pbx_load_context(builder->cfg, build->cxt, build->con, builder->config_file);
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Fill the contexts of the config on several threads
+ *
+ * The contexts are all created up front, in order.  Every category of the
+ * same context is then filled by the same thread, in order, so the result
+ * is the same as when they are filled one after the other.
+ */
+static void pbx_load_contexts_threaded(struct ast_config *cfg, const char *config_file)
+{
+	struct context_builds builds;
+	struct context_builder *builders;
+	struct ast_context *con;
+	const char *cxt;
+	int idx;
+
+	if (AST_VECTOR_INIT(&builds, 64)) {
+		return;
+	}
+
+	for (cxt = ast_category_browse(cfg, NULL);
+	     cxt;
+	     cxt = ast_category_browse(cfg, cxt)) {
+		struct context_build build;
+
+		if (!strcasecmp(cxt, "general") || !strcasecmp(cxt, "globals")) {
+			continue;
+		}
+		if (!(con = ast_context_find_or_create(&local_contexts, local_table, cxt, registrar))) {
+			continue;
+		}
+		build.cxt = cxt;
+		build.con = con;
+		if (AST_VECTOR_APPEND(&builds, build)) {
+			pbx_load_context(cfg, cxt, con, config_file);
+		}
+	}
+
+	builders = ast_calloc(buildthreads_config, sizeof(*builders));
+	if (!builders) {
+		for (idx = 0; idx < AST_VECTOR_SIZE(&builds); idx++) {
+			const struct context_build *build = AST_VECTOR_GET_ADDR(&builds, idx);
+
+			pbx_load_context(cfg, build->cxt, build->con, config_file);
+		}
+		AST_VECTOR_FREE(&builds);
+		return;
+	}
+
+	for (idx = 0; idx < buildthreads_config; idx++) {
+		builders[idx].cfg = cfg;
+		builders[idx].config_file = config_file;
+		builders[idx].builds = &builds;
+		builders[idx].index = idx;
+		builders[idx].count = buildthreads_config;
+		if (ast_pthread_create(&builders[idx].thread, NULL, context_builder_thread, &builders[idx])) {
+			builders[idx].thread = AST_PTHREADT_NULL;
+		}
+	}
+	for (idx = 0; idx < buildthreads_config; idx++) {
+		if (builders[idx].thread == AST_PTHREADT_NULL) {
+			context_builder_thread(&builders[idx]);
+		} else {
+			pthread_join(builders[idx].thread, NULL);
+		}
+	}
+
+	ast_free(builders);
+	AST_VECTOR_FREE(&builds);
+}
+
+static int pbx_load_config(const char *config_file)
+{
+	struct ast_config *cfg;
+#ifdef LOW_MEMORY
+	char realvalue[256];
+#else
+	char realvalue[8192];
+#endif
 	struct ast_context *con;
 	struct ast_variable *v;
 	const char *cxt;
 	const char *aft;
-	const char *newpm, *ovsw;
+	const char *newpm, *ovsw, *bt;
 	struct ast_flags config_flags = { 0 };
-	char lastextension[256];
 	cfg = ast_config_load(config_file, config_flags);
 	if (!cfg || cfg == CONFIG_STATUS_FILEINVALID)
 		return 0;
@@ -1705,6 +2049,13 @@ static int pbx_load_config(const char *config_file)
 	if ((newpm = ast_variable_retrieve(cfg, "general", "extenpatternmatchnew")))
 		extenpatternmatchnew_config = ast_true(newpm);
 	clearglobalvars_config = ast_true(ast_variable_retrieve(cfg, "general", "clearglobalvars"));
+	buildthreads_config = 0;
+	if ((bt = ast_variable_retrieve(cfg, "general", "buildthreads"))
+		&& (sscanf(bt, "%30d", &buildthreads_config) != 1
+			|| buildthreads_config < 0 || buildthreads_config > MAX_BUILD_THREADS)) {
+		ast_log(LOG_WARNING, "Invalid buildthreads '%s', building contexts on the loading thread\n", bt);
+		buildthreads_config = 0;
+	}
 	if ((ovsw = ast_variable_retrieve(cfg, "general", "overrideswitch"))) {
 		if (overrideswitch_config) {
 			ast_free(overrideswitch_config);
@@ -1732,6 +2083,12 @@ static int pbx_load_config(const char *config_file)
 		}
 	}
 
+	if (buildthreads_config > 1) {
+		pbx_load_contexts_threaded(cfg, config_file);
+		ast_config_destroy(cfg);
+		return 1;
+	}
+
 	for (cxt = ast_category_browse(cfg, NULL);
 	     cxt;
 	     cxt = ast_category_browse(cfg, cxt)) {
@@ -1743,224 +2100,7 @@ static int pbx_load_config(const char *config_file)
 			continue;
 		}
 
-		/* Reset continuation items at the beginning of each context */
-		lastextension[0] = '\0';
-		lastpri = -2;
-
-		for (v = ast_variable_browse(cfg, cxt); v; v = v->next) {
-			char *tc = NULL;
-			char realext[256] = "";
-			char *stringp, *ext;
-			const char *vfile;
-
-			/* get filename for error reporting from top level or an #include */
-			vfile = !*v->file ? config_file : v->file;
-
-			if (!strncasecmp(v->name, "same", 4)) {
-				if (ast_strlen_zero(lastextension)) {
-					ast_log(LOG_ERROR,
-						"No previous pattern in the first entry of context '%s' to match '%s' at line %d of %s!\n",
-						cxt, v->name, v->lineno, vfile);
-					continue;
-				}
-				if ((stringp = tc = ast_strdup(v->value))) {
-					ast_copy_string(realext, lastextension, sizeof(realext));
-					goto process_extension;
-				}
-			} else if (!strcasecmp(v->name, "exten")) {
-				int ipri;
-				char *plus;
-				char *pri, *appl, *data, *cidmatch;
-
-				if (!(stringp = tc = ast_strdup(v->value))) {
-					continue;
-				}
-
-				ext = S_OR(pbx_strsep(&stringp, ","), "");
-				pbx_substitute_variables_helper(NULL, ext, realext, sizeof(realext) - 1);
-				ast_copy_string(lastextension, realext, sizeof(lastextension));
-process_extension:
-				ipri = -2;
-				if ((cidmatch = strchr(realext, '/'))) {
-					*cidmatch++ = '\0';
-					ast_shrink_phone_number(cidmatch);
-				}
-				pri = ast_strip(S_OR(strsep(&stringp, ","), ""));
-				if ((label = strchr(pri, '('))) {
-					*label++ = '\0';
-					if ((end = strchr(label, ')'))) {
-						*end = '\0';
-					} else {
-						ast_log(LOG_WARNING,
-							"Label missing trailing ')' at line %d of %s\n",
-							v->lineno, vfile);
-						ast_free(tc);
-						continue;
-					}
-				}
-				if ((plus = strchr(pri, '+'))) {
-					*plus++ = '\0';
-				}
-				if (!strcmp(pri,"hint")) {
-					ipri = PRIORITY_HINT;
-				} else if (!strcmp(pri, "next") || !strcmp(pri, "n")) {
-					if (lastpri > -2) {
-						ipri = lastpri + 1;
-					} else {
-						ast_log(LOG_WARNING,
-							"Can't use 'next' priority on the first entry at line %d of %s!\n",
-							v->lineno, vfile);
-						ast_free(tc);
-						continue;
-					}
-				} else if (!strcmp(pri, "same") || !strcmp(pri, "s")) {
-					if (lastpri > -2) {
-						ipri = lastpri;
-					} else {
-						ast_log(LOG_WARNING,
-							"Can't use 'same' priority on the first entry at line %d of %s!\n",
-							v->lineno, vfile);
-						ast_free(tc);
-						continue;
-					}
-				} else if (sscanf(pri, "%30d", &ipri) != 1 &&
-					   (ipri = ast_findlabel_extension2(NULL, con, realext, pri, cidmatch)) < 1) {
-					ast_log(LOG_WARNING,
-						"Invalid priority/label '%s' at line %d of %s\n",
-						pri, v->lineno, vfile);
-					ipri = 0;
-					ast_free(tc);
-					continue;
-				} else if (ipri < 1) {
-					ast_log(LOG_WARNING, "Invalid priority '%s' at line %d of %s\n",
-						pri, v->lineno, vfile);
-					ast_free(tc);
-					continue;
-				}
-				appl = S_OR(stringp, "");
-				/* Find the first occurrence of '(' */
-				if (!strchr(appl, '(')) {
-					/* No arguments */
-					data = "";
-				} else {
-					char *orig_appl = ast_strdup(appl);
-
-					if (!orig_appl) {
-						ast_free(tc);
-						continue;
-					}
-
-					appl = strsep(&stringp, "(");
-
-					/* check if there are variables or expressions without an application, like: exten => 100,hint,DAHDI/g0/${GLOBAL(var)}  */
-					if (strstr(appl, "${") || strstr(appl, "$[")){
-						/* set appl to original one */
-						strcpy(appl, orig_appl);
-						/* set no data */
-						data = "";
-					/* no variable before application found -> go ahead */
-					} else {
-						data = S_OR(stringp, "");
-						if ((end = strrchr(data, ')'))) {
-							*end = '\0';
-						} else {
-							ast_log(LOG_WARNING,
-								"No closing parenthesis found? '%s(%s' at line %d of %s\n",
-								appl, data, v->lineno, vfile);
-						}
-					}
-					ast_free(orig_appl);
-				}
-
-				appl = ast_skip_blanks(appl);
-				if (ipri) {
-					const char *registrar_file;
-					if (plus) {
-						ipri += atoi(plus);
-					}
-					lastpri = ipri;
-					if (!ast_opt_dont_warn && (!strcmp(realext, "_.") || !strcmp(realext, "_!"))) {
-						ast_log(LOG_WARNING,
-							"The use of '%s' for an extension is strongly discouraged and can have unexpected behavior.  Please use '_X%c' instead at line %d of %s\n",
-							realext, realext[1], v->lineno, vfile);
-					}
-					/* Don't include full path if the configuration file includes slashes */
-					registrar_file = strrchr(vfile, '/');
-					if (!registrar_file) {
-						registrar_file = vfile;
-					} else {
-						registrar_file++; /* Skip past the end slash */
-					}
-					if (ast_add_extension2(con, 0, realext, ipri, label, cidmatch, appl, ast_strdup(data), ast_free_ptr, registrar, registrar_file, v->lineno)) {
-						ast_log(LOG_WARNING,
-							"Unable to register extension at line %d of %s\n",
-							v->lineno, vfile);
-					}
-				}
-				ast_free(tc);
-			} else if (!strcasecmp(v->name, "include")) {
-				pbx_substitute_variables_helper(NULL, v->value, realvalue, sizeof(realvalue) - 1);
-				if (ast_context_add_include2(con, realvalue, registrar)) {
-					switch (errno) {
-					case ENOMEM:
-						ast_log(LOG_WARNING, "Out of memory for context addition\n");
-						break;
-
-					case EBUSY:
-						ast_log(LOG_WARNING, "Failed to lock context(s) list, please try again later\n");
-						break;
-
-					case EEXIST:
-						ast_log(LOG_WARNING,
-							"Context '%s' already included in '%s' context on include at line %d of %s\n",
-							v->value, cxt, v->lineno, vfile);
-						break;
-
-					case ENOENT:
-					case EINVAL:
-						ast_log(LOG_WARNING,
-							"There is no existence of context '%s' included at line %d of %s\n",
-							errno == ENOENT ? v->value : cxt, v->lineno, vfile);
-						break;
-
-					default:
-						ast_log(LOG_WARNING,
-							"Failed to include '%s' in '%s' context at line %d of %s\n",
-							v->value, cxt, v->lineno, vfile);
-						break;
-					}
-				}
-			} else if (!strcasecmp(v->name, "ignorepat")) {
-				pbx_substitute_variables_helper(NULL, v->value, realvalue, sizeof(realvalue) - 1);
-				if (ast_context_add_ignorepat2(con, realvalue, registrar)) {
-					ast_log(LOG_WARNING,
-						"Unable to include ignorepat '%s' in context '%s' at line %d of %s\n",
-						v->value, cxt, v->lineno, vfile);
-				}
-			} else if (!strcasecmp(v->name, "switch") || !strcasecmp(v->name, "lswitch") || !strcasecmp(v->name, "eswitch")) {
-				char *appl, *data;
-				stringp = realvalue;
-
-				if (!strcasecmp(v->name, "switch")) {
-					pbx_substitute_variables_helper(NULL, v->value, realvalue, sizeof(realvalue) - 1);
-				} else {
-					ast_copy_string(realvalue, v->value, sizeof(realvalue));
-				}
-				appl = strsep(&stringp, "/");
-				data = S_OR(stringp, "");
-				if (ast_context_add_switch2(con, appl, data, !strcasecmp(v->name, "eswitch"), registrar)) {
-					ast_log(LOG_WARNING,
-						"Unable to include switch '%s' in context '%s' at line %d of %s\n",
-						v->value, cxt, v->lineno, vfile);
-				}
-			} else if (!strcasecmp(v->name, "autohints")) {
-				ast_context_set_autohints(con, ast_true(v->value));
-			} else {
-				ast_log(LOG_WARNING,
-					"==!!== Unknown directive: %s at line %d of %s -- IGNORING!!!\n",
-					v->name, v->lineno, vfile);
-			}
-		}
+		pbx_load_context(cfg, cxt, con, config_file);
 	}
 	ast_config_destroy(cfg);
 	return 1;
@@ -2106,8 +2246,10 @@ static void pbx_load_users(void)
 static int pbx_load_module(void)
 {
 	struct ast_context *con;
+	struct timeval begintime;
 
 	ast_mutex_lock(&reload_lock);
+	begintime = ast_tvnow();
 
 	if (!local_table) {
 		local_table = ast_hashtab_create(17, ast_hashtab_compare_contexts, ast_hashtab_resize_java, ast_hashtab_newsize_java, ast_hashtab_hash_contexts, 0);
@@ -2126,6 +2268,9 @@ static int pbx_load_module(void)
 
 	pbx_load_users();
 
+	ast_verb(5, "Time to build the dialplan of %s: %8.6f sec\n", config,
+		ast_tvdiff_us(ast_tvnow(), begintime) / 1000000.0);
+
 	ast_merge_contexts_and_delete(&local_contexts, local_table, registrar);
 	local_table = NULL; /* the local table has been moved into the global one. */
 	local_contexts = NULL;
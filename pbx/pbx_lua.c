@@ -40,6 +40,7 @@
 #include "asterisk/term.h"
 #include "asterisk/paths.h"
 #include "asterisk/hashtab.h"
+#include "asterisk/vector.h"
 
 #include <lua.h>
 #include <lauxlib.h>
@@ -60,10 +61,16 @@ static const char *registrar = "pbx_lua";
  * applications might return */
 #define LUA_GOTO_DETECTED 5
 
+/*! How many idle lua_States are kept for reuse */
+#define LUA_STATE_POOL_MAX 64
+
 static char *lua_read_extensions_file(lua_State *L, size_t *size, int *file_not_openable);
 static int lua_load_extensions(lua_State *L, struct ast_channel *chan);
 static int lua_reload_extensions(lua_State *L);
 static void lua_free_extensions(void);
+static char *lua_compile_extensions(lua_State *L, const char *data, size_t size, size_t *bytecode_size);
+static void lua_save_globals(lua_State *L);
+static void lua_reset_state(lua_State *L);
 static int lua_sort_extensions(lua_State *L);
 static int lua_register_switches(lua_State *L);
 static int lua_register_hints(lua_State *L);
@@ -97,6 +104,8 @@ static void lua_concat_args(lua_State *L, int start, int nargs);
 static void lua_state_destroy(void *data);
 static void lua_datastore_fixup(void *data, struct ast_channel *old_chan, struct ast_channel *new_chan);
 static lua_State *lua_get_state(struct ast_channel *chan);
+static void lua_release_state(lua_State *L);
+static void lua_flush_states(void);
 
 static int exists(struct ast_channel *chan, const char *context, const char *exten, int priority, const char *callerid, const char *data);
 static int canmatch(struct ast_channel *chan, const char *context, const char *exten, int priority, const char *callerid, const char *data);
@@ -104,8 +113,15 @@ static int matchmore(struct ast_channel *chan, const char *context, const char *
 static int exec(struct ast_channel *chan, const char *context, const char *exten, int priority, const char *callerid, const char *data);
 
 AST_MUTEX_DEFINE_STATIC(config_file_lock);
+/*! extensions.lua, precompiled to bytecode unless that failed */
 static char *config_file_data = NULL;
 static size_t config_file_size = 0;
+/*! Bumped each time extensions.lua is reloaded, so states loaded from an older one are not reused */
+static unsigned int config_file_generation = 0;
+
+AST_MUTEX_DEFINE_STATIC(state_pool_lock);
+/*! lua_States with extensions.lua loaded, reset and ready to be used again */
+static AST_VECTOR(, lua_State *) state_pool;
 
 static struct ast_context *local_contexts = NULL;
 static struct ast_hashtab *local_table = NULL;
@@ -123,7 +139,7 @@ static const struct ast_datastore_info lua_datastore = {
 static void lua_state_destroy(void *data)
 {
 	if (data)
-		lua_close(data);
+		lua_release_state(data);
 }
 
 /*!
@@ -1189,6 +1205,8 @@ static int lua_load_extensions(lua_State *L, struct ast_channel *chan)
 		ast_mutex_unlock(&config_file_lock);
 		return 1;
 	}
+	lua_pushinteger(L, config_file_generation);
+	lua_setfield(L, LUA_REGISTRYINDEX, "generation");
 	ast_mutex_unlock(&config_file_lock);
 
 	/* now we setup special tables and functions */
@@ -1202,9 +1220,165 @@ static int lua_load_extensions(lua_State *L, struct ast_channel *chan)
 	lua_create_autoservice_functions(L);
 	lua_create_hangup_function(L);
 
+	lua_save_globals(L);
+
+	return 0;
+}
+
+/*! \brief A growing buffer lua_dump() writes bytecode to */
+struct lua_bytecode {
+	char *data;
+	size_t size;
+	size_t len;
+};
+
+/*!
+ * \brief [lua_Writer] Append a piece of a dumped chunk to a lua_bytecode buffer
+ */
+static int lua_bytecode_writer(lua_State *L, const void *p, size_t size, void *ud)
+{
+	struct lua_bytecode *bytecode = ud;
+
+	if (bytecode->len + size > bytecode->size) {
+		size_t new_size = MAX(bytecode->size * 2, bytecode->len + size);
+		char *new_data = ast_realloc(bytecode->data, new_size);
+
+		if (!new_data) {
+			return 1;
+		}
+		bytecode->data = new_data;
+		bytecode->size = new_size;
+	}
+
+	memcpy(bytecode->data + bytecode->len, p, size);
+	bytecode->len += size;
 	return 0;
 }
 
+/*!
+ * \brief Precompile extensions.lua, so it is not parsed for every lua_State
+ *
+ * Debug information is kept so errors still name lines of extensions.lua.
+ *
+ * \param L the lua_State to use
+ * \param data the source of extensions.lua
+ * \param size the size of the source
+ * \param[out] bytecode_size the size of the bytecode
+ *
+ * \return the bytecode, which the caller must free
+ * \retval NULL on failure
+ */
+static char *lua_compile_extensions(lua_State *L, const char *data, size_t size, size_t *bytecode_size)
+{
+	struct lua_bytecode bytecode = { NULL, 0, 0 };
+	int res;
+
+	if (luaL_loadbuffer(L, data, size, "extensions.lua")) {
+		lua_pop(L, 1);
+		return NULL;
+	}
+#if LUA_VERSION_NUM < 503
+	res = lua_dump(L, &lua_bytecode_writer, &bytecode);
+#else
+	res = lua_dump(L, &lua_bytecode_writer, &bytecode, 0);
+#endif
+	lua_pop(L, 1);
+
+	if (res || !bytecode.len) {
+		ast_free(bytecode.data);
+		return NULL;
+	}
+
+	*bytecode_size = bytecode.len;
+	return bytecode.data;
+}
+
+/*!
+ * \brief Push the table of globals on the stack
+ */
+static void lua_push_globals(lua_State *L)
+{
+#if LUA_VERSION_NUM < 502
+	lua_pushvalue(L, LUA_GLOBALSINDEX);
+#else
+	lua_pushglobaltable(L);
+#endif
+}
+
+/*!
+ * \brief Remember the globals of a freshly loaded lua_State, so it can be reset
+ * to them by lua_reset_state()
+ */
+static void lua_save_globals(lua_State *L)
+{
+	int globals, saved;
+
+	lua_push_globals(L);
+	globals = lua_gettop(L);
+	lua_newtable(L);
+	saved = lua_gettop(L);
+
+	for (lua_pushnil(L); lua_next(L, globals); lua_pop(L, 1)) {
+		lua_pushvalue(L, -2);
+		lua_pushvalue(L, -2);
+		lua_rawset(L, saved);
+	}
+
+	lua_setfield(L, LUA_REGISTRYINDEX, "saved_globals");
+	lua_pop(L, 1);
+}
+
+/*!
+ * \brief Put a lua_State back the way lua_load_extensions() left it, so it can
+ * be used for another channel
+ *
+ * Globals the dialplan added are removed and those it replaced are put
+ * back.  Tables the dialplan changed in place are not restored.
+ */
+static void lua_reset_state(lua_State *L)
+{
+	int globals, saved;
+
+	lua_settop(L, 0);
+
+	lua_pushnil(L);
+	lua_setfield(L, LUA_REGISTRYINDEX, "channel");
+	lua_pushnil(L);
+	lua_setfield(L, LUA_REGISTRYINDEX, "context");
+	lua_pushnil(L);
+	lua_setfield(L, LUA_REGISTRYINDEX, "exten");
+	lua_pushnil(L);
+	lua_setfield(L, LUA_REGISTRYINDEX, "priority");
+	lua_pushboolean(L, 1);
+	lua_setfield(L, LUA_REGISTRYINDEX, "autoservice");
+
+	lua_push_globals(L);
+	globals = lua_gettop(L);
+	lua_getfield(L, LUA_REGISTRYINDEX, "saved_globals");
+	saved = lua_gettop(L);
+
+	/* Clearing fields while traversing a table is allowed */
+	for (lua_pushnil(L); lua_next(L, globals); lua_pop(L, 1)) {
+		lua_pushvalue(L, -2);
+		lua_rawget(L, saved);
+		if (lua_isnil(L, -1)) {
+			lua_pushvalue(L, -3);
+			lua_pushnil(L);
+			lua_rawset(L, globals);
+		}
+		lua_pop(L, 1);
+	}
+
+	for (lua_pushnil(L); lua_next(L, saved); lua_pop(L, 1)) {
+		lua_pushvalue(L, -2);
+		lua_pushvalue(L, -2);
+		lua_rawset(L, globals);
+	}
+
+	lua_pop(L, 2);
+	lua_gc(L, LUA_GCCOLLECT, 0);
+}
+
 /*!
  * \brief Reload the extensions file and update the internal buffers if it
  * loads correctly.
@@ -1219,6 +1393,8 @@ static int lua_reload_extensions(lua_State *L)
 {
 	size_t size = 0;
 	char *data = NULL;
+	char *bytecode;
+	size_t bytecode_size = 0;
 	int file_not_openable = 0;
 
 	luaL_openlibs(L);
@@ -1230,6 +1406,14 @@ static int lua_reload_extensions(lua_State *L)
 		return 1;
 	}
 
+	if ((bytecode = lua_compile_extensions(L, data, size, &bytecode_size))) {
+		ast_free(data);
+		data = bytecode;
+		size = bytecode_size;
+	} else {
+		ast_log(LOG_WARNING, "Unable to precompile extensions.lua, it will be parsed for every call\n");
+	}
+
 	ast_mutex_lock(&config_file_lock);
 
 	if (config_file_data)
@@ -1237,6 +1421,7 @@ static int lua_reload_extensions(lua_State *L)
 
 	config_file_data = data;
 	config_file_size = size;
+	config_file_generation++;
 
 	/* merge our new contexts */
 	ast_merge_contexts_and_delete(&local_contexts, local_table, registrar);
@@ -1248,6 +1433,9 @@ static int lua_reload_extensions(lua_State *L)
 	local_contexts = NULL;
 
 	ast_mutex_unlock(&config_file_lock);
+
+	/* States loaded from the old extensions.lua must not be handed out again */
+	lua_flush_states();
 	return 0;
 }
 
@@ -1262,75 +1450,159 @@ static void lua_free_extensions()
 	ast_mutex_unlock(&config_file_lock);
 }
 
+/*!
+ * \brief Which load of extensions.lua a lua_State was loaded from
+ */
+static unsigned int lua_state_generation(lua_State *L)
+{
+	unsigned int generation;
+
+	lua_getfield(L, LUA_REGISTRYINDEX, "generation");
+	generation = lua_tointeger(L, -1);
+	lua_pop(L, 1);
+
+	return generation;
+}
+
+/*!
+ * \brief Which load of extensions.lua is the current one
+ */
+static unsigned int lua_current_generation(void)
+{
+	unsigned int generation;
+
+	ast_mutex_lock(&config_file_lock);
+	generation = config_file_generation;
+	ast_mutex_unlock(&config_file_lock);
+
+	return generation;
+}
+
+/*!
+ * \brief Get a lua_State with extensions.lua loaded, reusing a pooled one if
+ * there is one
+ *
+ * \param chan the channel the state is for, may be NULL
+ *
+ * \return a lua_State
+ * \retval NULL on failure, the error has been logged
+ */
+static lua_State *lua_new_state(struct ast_channel *chan)
+{
+	lua_State *L = NULL;
+
+	ast_mutex_lock(&state_pool_lock);
+	if (AST_VECTOR_SIZE(&state_pool)) {
+		L = AST_VECTOR_REMOVE_UNORDERED(&state_pool, AST_VECTOR_SIZE(&state_pool) - 1);
+	}
+	ast_mutex_unlock(&state_pool_lock);
+
+	if (L && lua_state_generation(L) != lua_current_generation()) {
+		/* extensions.lua was reloaded since, and the pool not flushed yet */
+		lua_close(L);
+		L = NULL;
+	}
+
+	if (L) {
+		/* store a pointer to this channel */
+		lua_pushlightuserdata(L, chan);
+		lua_setfield(L, LUA_REGISTRYINDEX, "channel");
+		return L;
+	}
+
+	L = luaL_newstate();
+	if (!L) {
+		ast_log(LOG_ERROR, "Error allocating lua_State, no memory\n");
+		return NULL;
+	}
+
+	if (lua_load_extensions(L, chan)) {
+		const char *error = lua_tostring(L, -1);
+		ast_log(LOG_ERROR, "Error loading extensions.lua%s%s: %s\n",
+			chan ? " for " : "", chan ? ast_channel_name(chan) : "", error);
+		lua_close(L);
+		return NULL;
+	}
+
+	return L;
+}
+
+/*!
+ * \brief Be done with a lua_State, keeping it for reuse if it was loaded from
+ * the current extensions.lua and the pool is not full
+ */
+static void lua_release_state(lua_State *L)
+{
+	unsigned int generation = lua_state_generation(L);
+
+	lua_reset_state(L);
+
+	ast_mutex_lock(&config_file_lock);
+	ast_mutex_lock(&state_pool_lock);
+	if (generation == config_file_generation
+		&& AST_VECTOR_SIZE(&state_pool) < LUA_STATE_POOL_MAX
+		&& !AST_VECTOR_APPEND(&state_pool, L)) {
+		L = NULL;
+	}
+	ast_mutex_unlock(&state_pool_lock);
+	ast_mutex_unlock(&config_file_lock);
+
+	if (L) {
+		lua_close(L);
+	}
+}
+
+/*!
+ * \brief Close every pooled lua_State
+ */
+static void lua_flush_states(void)
+{
+	ast_mutex_lock(&state_pool_lock);
+	AST_VECTOR_RESET(&state_pool, lua_close);
+	ast_mutex_unlock(&state_pool_lock);
+}
+
 /*!
  * \brief Get the lua_State for this channel
  *
- * If no channel is passed then a new state is allocated.  States with no
- * channel assocatied with them should only be used for matching extensions.
- * If the channel does not yet have a lua state associated with it, one will be
- * created.
+ * If no channel is passed then a state is taken from the pool or allocated.
+ * States with no channel assocatied with them should only be used for
+ * matching extensions.  If the channel does not yet have a lua state
+ * associated with it, one will be taken from the pool or created.
  *
- * \note If no channel was passed then the caller is expected to free the state
- * using lua_close().
+ * \note If no channel was passed then the caller is expected to release the
+ * state using lua_release_state().
  *
  * \return a lua_State
  */
 static lua_State *lua_get_state(struct ast_channel *chan)
 {
 	struct ast_datastore *datastore = NULL;
-	lua_State *L;
 
 	if (!chan) {
-		L = luaL_newstate();
-		if (!L) {
-			ast_log(LOG_ERROR, "Error allocating lua_State, no memory\n");
-			return NULL;
-		}
-
-		if (lua_load_extensions(L, NULL)) {
-			const char *error = lua_tostring(L, -1);
-			ast_log(LOG_ERROR, "Error loading extensions.lua: %s\n", error);
-			lua_close(L);
-			return NULL;
-		}
-		return L;
+		return lua_new_state(NULL);
 	} else {
 		ast_channel_lock(chan);
 		datastore = ast_channel_datastore_find(chan, &lua_datastore, NULL);
 		ast_channel_unlock(chan);
 
 		if (!datastore) {
-			/* nothing found, allocate a new lua state */
+			/* nothing found, get a lua state */
 			datastore = ast_datastore_alloc(&lua_datastore, NULL);
 			if (!datastore) {
 				ast_log(LOG_ERROR, "Error allocation channel datastore for lua_State\n");
 				return NULL;
 			}
 
-			datastore->data = luaL_newstate();
+			datastore->data = lua_new_state(chan);
 			if (!datastore->data) {
 				ast_datastore_free(datastore);
-				ast_log(LOG_ERROR, "Error allocating lua_State, no memory\n");
 				return NULL;
 			}
 
 			ast_channel_lock(chan);
 			ast_channel_datastore_add(chan, datastore);
 			ast_channel_unlock(chan);
-
-			L = datastore->data;
-
-			if (lua_load_extensions(L, chan)) {
-				const char *error = lua_tostring(L, -1);
-				ast_log(LOG_ERROR, "Error loading extensions.lua for %s: %s\n", ast_channel_name(chan), error);
-
-				ast_channel_lock(chan);
-				ast_channel_datastore_remove(chan, datastore);
-				ast_channel_unlock(chan);
-
-				ast_datastore_free(datastore);
-				return NULL;
-			}
 		}
 
 		return datastore->data;
@@ -1355,7 +1627,7 @@ static int exists(struct ast_channel *chan, const char *context, const char *ext
 
 	res = lua_find_extension(L, context, exten, priority, &exists, 0);
 
-	if (!chan) lua_close(L);
+	if (!chan) lua_release_state(L);
 	ast_module_user_remove(u);
 	return res;
 }
@@ -1378,7 +1650,7 @@ static int canmatch(struct ast_channel *chan, const char *context, const char *e
 
 	res = lua_find_extension(L, context, exten, priority, &canmatch, 0);
 
-	if (!chan) lua_close(L);
+	if (!chan) lua_release_state(L);
 	ast_module_user_remove(u);
 	return res;
 }
@@ -1401,7 +1673,7 @@ static int matchmore(struct ast_channel *chan, const char *context, const char *
 
 	res = lua_find_extension(L, context, exten, priority, &matchmore, 0);
 
-	if (!chan) lua_close(L);
+	if (!chan) lua_release_state(L);
 	ast_module_user_remove(u);
 	return res;
 }
@@ -1430,7 +1702,7 @@ static int exec(struct ast_channel *chan, const char *context, const char *exten
 	if (!lua_find_extension(L, context, exten, priority, &exists, 1)) {
 		lua_pop(L, 1); /* pop the debug function */
 		ast_log(LOG_ERROR, "Could not find extension %s in context %s\n", exten, context);
-		if (!chan) lua_close(L);
+		if (!chan) lua_release_state(L);
 		ast_module_user_remove(u);
 		return -1;
 	}
@@ -1477,7 +1749,7 @@ static int exec(struct ast_channel *chan, const char *context, const char *exten
 	}
 	lua_pop(L, 1);
 
-	if (!chan) lua_close(L);
+	if (!chan) lua_release_state(L);
 	ast_module_user_remove(u);
 	return res;
 }
@@ -1675,6 +1947,8 @@ static int unload_module(void)
 	ast_context_destroy(NULL, registrar);
 	ast_unregister_switch(&lua_switch);
 	lua_free_extensions();
+	lua_flush_states();
+	AST_VECTOR_FREE(&state_pool);
 	return 0;
 }
 
@@ -1687,8 +1961,14 @@ static int load_module(void)
 {
 	int res;
 
-	if ((res = load_or_reload_lua_stuff()))
+	if (AST_VECTOR_INIT(&state_pool, LUA_STATE_POOL_MAX)) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	if ((res = load_or_reload_lua_stuff())) {
+		AST_VECTOR_FREE(&state_pool);
 		return res;
+	}
 
 	if (ast_register_switch(&lua_switch)) {
 		ast_log(LOG_ERROR, "Unable to register Lua PBX switch\n");
@@ -51,6 +51,7 @@
 #include "asterisk/app.h"
 #include "asterisk/astobj2.h"
 #include "asterisk/stasis_channels.h"
+#include "asterisk/vector.h"
 
 #define MODE_MATCH 		0
 #define MODE_MATCHMORE 	1
@@ -60,18 +61,49 @@
 
 enum option_flags {
 	OPTION_PATTERNS_DISABLED = (1 << 0),
+	OPTION_CACHE = (1 << 1),
+	OPTION_NEGATIVE_CACHE = (1 << 2),
+};
+
+enum option_args {
+	OPTION_ARG_CACHE,
+	OPTION_ARG_NEGATIVE_CACHE,
+	/* This must be the last element */
+	OPTION_ARG_ARRAY_SIZE,
 };
 
 AST_APP_OPTIONS(switch_opts, {
 	AST_APP_OPTION('p', OPTION_PATTERNS_DISABLED),
+	AST_APP_OPTION_ARG('c', OPTION_CACHE, OPTION_ARG_CACHE),
+	AST_APP_OPTION_ARG('n', OPTION_NEGATIVE_CACHE, OPTION_ARG_NEGATIVE_CACHE),
 });
 
-struct cache_entry {
-	struct timeval when;
-	struct ast_variable *var;
+/*! \brief Seconds lookups are cached for, unless the switch says otherwise */
+#define DEFAULT_CACHE_TIMEOUT 1
+
+/*! \brief A row of the realtime table */
+struct cache_row {
 	int priority;
-	char *context;
-	char exten[2];
+	/*! The extension or pattern, in vars */
+	const char *exten;
+	struct ast_variable *vars;
+};
+
+/*!
+ * \brief A cached lookup
+ *
+ * The rows of an extension, every priority of it, are looked up at once so
+ * that checking it exists and executing it, and moving on to the next
+ * priority, are a single query.  The patterns of a context are looked up
+ * at once too, whatever they are matched against.  Whether anything can
+ * match or match more is looked up on its own.
+ */
+struct cache_entry {
+	struct timeval expires;
+	/*! For a can match or match more lookup, whether anything did */
+	int found;
+	AST_VECTOR(, struct cache_row) rows;
+	char key[0];
 };
 
 struct ao2_container *cache;
@@ -80,45 +112,43 @@ pthread_t cleanup_thread = 0;
 static int cache_hash(const void *obj, const int flags)
 {
 	const struct cache_entry *e = obj;
-	return ast_str_case_hash(e->exten) + e->priority;
+	const char *key = obj;
+
+	if ((flags & OBJ_SEARCH_MASK) != OBJ_SEARCH_KEY) {
+		key = e->key;
+	}
+
+	return ast_str_case_hash(key);
 }
 
 static int cache_cmp(void *obj, void *arg, int flags)
 {
 	struct cache_entry *e = obj, *f = arg;
-	return e->priority != f->priority ? 0 :
-		strcmp(e->exten, f->exten) ? 0 :
-		strcmp(e->context, f->context) ? 0 :
-		CMP_MATCH;
-}
+	const char *key = arg;
 
-static struct ast_variable *dup_vars(struct ast_variable *v)
-{
-	struct ast_variable *new, *list = NULL;
-	for (; v; v = v->next) {
-		if (!(new = ast_variable_new(v->name, v->value, v->file))) {
-			ast_variables_destroy(list);
-			return NULL;
-		}
-		/* Reversed list in cache, but when we duplicate out of the cache,
-		 * it's back to correct order. */
-		new->next = list;
-		list = new;
+	if ((flags & OBJ_SEARCH_MASK) != OBJ_SEARCH_KEY) {
+		key = f->key;
 	}
-	return list;
+
+	return strcmp(e->key, key) ? 0 : CMP_MATCH;
 }
 
 static void free_entry(void *obj)
 {
 	struct cache_entry *e = obj;
-	ast_variables_destroy(e->var);
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&e->rows); i++) {
+		ast_variables_destroy(AST_VECTOR_GET(&e->rows, i).vars);
+	}
+	AST_VECTOR_FREE(&e->rows);
 }
 
 static int purge_old_fn(void *obj, void *arg, int flags)
 {
 	struct cache_entry *e = obj;
 	struct timeval *now = arg;
-	return ast_tvdiff_ms(*now, e->when) >= 1000 ? CMP_MATCH : 0;
+	return ast_tvcmp(e->expires, *now) <= 0 ? CMP_MATCH : 0;
 }
 
 static void *cleanup(void *unused)
@@ -141,12 +171,126 @@ static void *cleanup(void *unused)
 	return NULL;
 }
 
-static int extension_length_comparator(struct ast_category *p, struct ast_category *q)
+static int row_length_comparator(const void *a, const void *b)
+{
+	const struct cache_row *p = a, *q = b;
+
+	return strlen(q->exten) - strlen(p->exten);
+}
+
+/*!
+ * \internal
+ * \brief Look something up, through the cache
+ *
+ * \param key What is looked up, the key of its cache entry
+ * \param cfg The rows found, if the caller looked them up, or NULL
+ * \param found Whether anything was found, if the caller looked it up
+ * \param sort How to sort the rows found, or NULL
+ * \param flags The options of the switch
+ * \param opt_args The arguments of the options of the switch
+ *
+ * \return The entry, which must be unreferenced
+ * \retval NULL if the caller has to look it up, or on failure
+ */
+static struct cache_entry *cache_lookup(const char *key, struct ast_config *cfg, int found,
+	int (*sort)(const void *, const void *), struct ast_flags *flags, char **opt_args)
 {
-	const char *extenp = S_OR(ast_variable_find(p, "exten"), "");
-	const char *extenq = S_OR(ast_variable_find(q, "exten"), "");
+	struct cache_entry *ce;
+	struct ast_category *cat = NULL;
+	int timeout = DEFAULT_CACHE_TIMEOUT;
+
+	if (found < 0) {
+		return ao2_find(cache, key, OBJ_SEARCH_KEY);
+	}
 
-	return strlen(extenp) - strlen(extenq);
+	if (ast_test_flag(flags, OPTION_CACHE) && !ast_strlen_zero(opt_args[OPTION_ARG_CACHE])) {
+		timeout = atoi(opt_args[OPTION_ARG_CACHE]);
+	}
+	if (!found && ast_test_flag(flags, OPTION_NEGATIVE_CACHE)
+		&& !ast_strlen_zero(opt_args[OPTION_ARG_NEGATIVE_CACHE])) {
+		timeout = atoi(opt_args[OPTION_ARG_NEGATIVE_CACHE]);
+	}
+
+	if (!(ce = ao2_alloc(sizeof(*ce) + strlen(key) + 1, free_entry))) {
+		return NULL;
+	}
+	strcpy(ce->key, key); /* SAFE */
+	ce->found = found;
+	ce->expires = ast_tvadd(ast_tvnow(), ast_samp2tv(timeout, 1));
+	if (AST_VECTOR_INIT(&ce->rows, 0)) {
+		ao2_ref(ce, -1);
+		return NULL;
+	}
+
+	while (cfg && (cat = ast_category_browse_filtered(cfg, NULL, cat, NULL))) {
+		struct cache_row row = {
+			.priority = atoi(S_OR(ast_variable_find(cat, "priority"), "0")),
+			.vars = ast_category_detach_variables(cat),
+		};
+		struct ast_variable *v;
+
+		for (v = row.vars; v && strcasecmp(v->name, "exten"); v = v->next) {
+		}
+		row.exten = v ? v->value : "";
+		if (AST_VECTOR_APPEND(&ce->rows, row)) {
+			ast_variables_destroy(row.vars);
+		}
+	}
+
+	if (sort) {
+		AST_VECTOR_SORT(&ce->rows, sort);
+	}
+
+	if (timeout > 0) {
+		ao2_link(cache, ce);
+		pthread_kill(cleanup_thread, SIGURG);
+	}
+
+	return ce;
+}
+
+/*!
+ * \internal
+ * \brief Find the row of a priority in a cache entry
+ *
+ * \param ce The cache entry
+ * \param exten The extension the row is for, if the rows are patterns to match it against
+ * \param priority The priority
+ * \param mode How the patterns are matched
+ *
+ * \return A copy of the row, which must be destroyed
+ * \retval NULL if there is no such row
+ */
+static struct ast_variable *cache_find_row(struct cache_entry *ce, const char *exten, int priority, int mode)
+{
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&ce->rows); i++) {
+		const struct cache_row *row = AST_VECTOR_GET_ADDR(&ce->rows, i);
+		int match = 1;
+
+		if (row->priority != priority) {
+			continue;
+		}
+		if (exten) {
+			switch (mode) {
+			case MODE_MATCHMORE:
+				match = ast_extension_close(row->exten, exten, 1);
+				break;
+			case MODE_CANMATCH:
+				match = ast_extension_close(row->exten, exten, 0);
+				break;
+			case MODE_MATCH:
+			default:
+				match = ast_extension_match(row->exten, exten);
+			}
+		}
+		if (match) {
+			return ast_variables_dup(row->vars);
+		}
+	}
+
+	return NULL;
 }
 
 /* Realtime switch looks up extensions in the supplied realtime table.
@@ -160,23 +304,35 @@ static int extension_length_comparator(struct ast_category *p, struct ast_catego
 
 	The realtime table currently does not support callerid fields.
 
+	Options are:
+	  p             Do not look for patterns matching the extension.
+	  c(<seconds>)  How long lookups are cached for, 1 second by default.  Every
+	                priority of an extension is looked up and cached at once, as
+	                are the patterns of the context.
+	  n(<seconds>)  How long lookups that found nothing are cached for, by default
+	                as long as those that found something.
+
 */
 
 
-static struct ast_variable *realtime_switch_common(const char *table, const char *context, const char *exten, int priority, int mode, struct ast_flags flags)
+static struct ast_variable *realtime_switch_common(const char *table, const char *context, const char *exten, int priority, int mode, struct ast_flags flags, char **opt_args)
 {
-	struct ast_variable *var;
+	struct ast_variable *var = NULL;
 	struct ast_config *cfg;
+	struct cache_entry *ce;
+	struct ast_str *key;
 	char pri[20];
 	char *ematch;
 	char rexten[AST_MAX_EXTENSION + 20]="";
-	int match;
 	/* Optimization: since we don't support hints in realtime, it's silly to
 	 * query for a hint here, since we won't actually do anything with it.
 	 * This just wastes CPU time and resources. */
 	if (priority < 0) {
 		return NULL;
 	}
+	if (!(key = ast_str_create(128))) {
+		return NULL;
+	}
 	snprintf(pri, sizeof(pri), "%d", priority);
 	switch(mode) {
 	case MODE_MATCHMORE:
@@ -192,37 +348,51 @@ static struct ast_variable *realtime_switch_common(const char *table, const char
 		ematch = "exten";
 		ast_copy_string(rexten, exten, sizeof(rexten));
 	}
-	var = ast_load_realtime(table, ematch, rexten, "context", context, "priority", pri, SENTINEL);
-	if (!var && !ast_test_flag(&flags, OPTION_PATTERNS_DISABLED)) {
-		cfg = ast_load_realtime_multientry(table, "exten LIKE", "\\_%", "context", context, "priority", pri, SENTINEL);
-		if (cfg) {
-			char *cat = NULL;
 
-			/* Sort so that longer patterns are checked first */
-			ast_config_sort_categories(cfg, 1, extension_length_comparator);
-
-			while ((cat = ast_category_browse(cfg, cat))) {
-				const char *realtime_exten = ast_variable_retrieve(cfg, cat, "exten");
-
-				switch(mode) {
-				case MODE_MATCHMORE:
-					match = ast_extension_close(realtime_exten, exten, 1);
-					break;
-				case MODE_CANMATCH:
-					match = ast_extension_close(realtime_exten, exten, 0);
-					break;
-				case MODE_MATCH:
-				default:
-					match = ast_extension_match(realtime_exten, exten);
-				}
-				if (match) {
-					var = ast_category_detach_variables(ast_category_get(cfg, cat, NULL));
-					break;
-				}
+	if (mode == MODE_MATCH) {
+		/* Every priority of the extension at once */
+		ast_str_set(&key, 0, "e/%s/%s/%s", table, context, exten);
+		if (!(ce = cache_lookup(ast_str_buffer(key), NULL, -1, NULL, &flags, opt_args))) {
+			cfg = ast_load_realtime_multientry(table, ematch, rexten, "context", context, SENTINEL);
+			ce = cache_lookup(ast_str_buffer(key), cfg, cfg ? 1 : 0, NULL, &flags, opt_args);
+			ast_config_destroy(cfg);
+		}
+		if (ce) {
+			var = cache_find_row(ce, NULL, priority, mode);
+			ao2_ref(ce, -1);
+		}
+	} else {
+		ast_str_set(&key, 0, "%c/%s/%s/%s/%s", mode == MODE_CANMATCH ? 'c' : 'm', table, context, exten, pri);
+		if ((ce = cache_lookup(ast_str_buffer(key), NULL, -1, NULL, &flags, opt_args))) {
+			/* Only whether anything matched is of interest */
+			var = ce->found ? ast_variable_new("exten", rexten, "") : NULL;
+			ao2_ref(ce, -1);
+			if (var || ast_test_flag(&flags, OPTION_PATTERNS_DISABLED)) {
+				ast_free(key);
+				return var;
 			}
+		} else {
+			var = ast_load_realtime(table, ematch, rexten, "context", context, "priority", pri, SENTINEL);
+			ao2_cleanup(cache_lookup(ast_str_buffer(key), NULL, var ? 1 : 0, NULL, &flags, opt_args));
+		}
+	}
+
+	if (!var && !ast_test_flag(&flags, OPTION_PATTERNS_DISABLED)) {
+		/* Every pattern of the context at once */
+		ast_str_set(&key, 0, "p/%s/%s", table, context);
+		if (!(ce = cache_lookup(ast_str_buffer(key), NULL, -1, NULL, &flags, opt_args))) {
+			cfg = ast_load_realtime_multientry(table, "exten LIKE", "\\_%", "context", context, SENTINEL);
+			/* Sort so that longer patterns are checked first */
+			ce = cache_lookup(ast_str_buffer(key), cfg, cfg ? 1 : 0, row_length_comparator, &flags, opt_args);
 			ast_config_destroy(cfg);
 		}
+		if (ce) {
+			var = cache_find_row(ce, exten, priority, mode);
+			ao2_ref(ce, -1);
+		}
 	}
+	ast_free(key);
+
 	return var;
 }
 
@@ -230,13 +400,8 @@ static struct ast_variable *realtime_common(const char *context, const char *ext
 {
 	const char *ctx = NULL;
 	char *table;
-	struct ast_variable *var=NULL;
 	struct ast_flags flags = { 0, };
-	struct cache_entry *ce;
-	struct {
-		struct cache_entry ce;
-		char exten[AST_MAX_EXTENSION];
-	} cache_search = { { .priority = priority, .context = (char *) context }, };
+	char *opt_args[OPTION_ARG_ARRAY_SIZE] = { NULL, };
 	char *buf = ast_strdupa(data);
 	/* "Realtime" prefix is stripped off in the parent engine.  The
 	 * remaining string is: [[context@]table][/opts] */
@@ -251,39 +416,9 @@ static struct ast_variable *realtime_common(const char *context, const char *ext
 	ctx = S_OR(ctx, context);
 	table = S_OR(table, "extensions");
 	if (!ast_strlen_zero(opts)) {
-		ast_app_parse_options(switch_opts, &flags, NULL, opts);
-	}
-	ast_copy_string(cache_search.exten, exten, sizeof(cache_search.exten));
-	if (mode == MODE_MATCH && (ce = ao2_find(cache, &cache_search, OBJ_POINTER))) {
-		var = dup_vars(ce->var);
-		ao2_ref(ce, -1);
-	} else {
-		var = realtime_switch_common(table, ctx, exten, priority, mode, flags);
-		do {
-			struct ast_variable *new;
-			/* Only cache matches */
-			if (mode != MODE_MATCH) {
-				break;
-			}
-			if (!(new = dup_vars(var))) {
-				break;
-			}
-			if (!(ce = ao2_alloc(sizeof(*ce) + strlen(exten) + strlen(context), free_entry))) {
-				ast_variables_destroy(new);
-				break;
-			}
-			ce->context = ce->exten + strlen(exten) + 1;
-			strcpy(ce->exten, exten); /* SAFE */
-			strcpy(ce->context, context); /* SAFE */
-			ce->priority = priority;
-			ce->var = new;
-			ce->when = ast_tvnow();
-			ao2_link(cache, ce);
-			pthread_kill(cleanup_thread, SIGURG);
-			ao2_ref(ce, -1);
-		} while (0);
+		ast_app_parse_options(switch_opts, &flags, opt_args, opts);
 	}
-	return var;
+	return realtime_switch_common(table, ctx, exten, priority, mode, flags, opt_args);
 }
 
 static int realtime_exists(struct ast_channel *chan, const char *context, const char *exten, int priority, const char *callerid, const char *data)
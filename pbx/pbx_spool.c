@@ -53,6 +53,12 @@
 #include "asterisk/options.h"
 #include "asterisk/format.h"
 #include "asterisk/format_cache.h"
+#include "asterisk/config.h"
+#include "asterisk/heap.h"
+#include "asterisk/threadpool.h"
+#include "asterisk/time.h"
+#include "asterisk/astobj2.h"
+#include "asterisk/dlinkedlists.h"
 
 /*
  * pbx_spool is similar in spirit to qcall, but with substantially enhanced functionality...
@@ -74,6 +80,22 @@ enum {
 static char qdir[255];
 static char qdonedir[255];
 
+/*! \brief The default for how many call files are attempted at once */
+#define DEFAULT_MAXCALLS 100
+
+/*! \brief How many call files are attempted at once, 0 for no limit */
+static int maxcalls = DEFAULT_MAXCALLS;
+/*! \brief How many calls are attempted per second at most, 0 for no limit */
+static int maxcps;
+
+/*! \brief The threads call files are attempted with */
+static struct ast_threadpool *attempt_pool;
+
+/*! \brief Protects next_attempt */
+AST_MUTEX_DEFINE_STATIC(next_attempt_lock);
+/*! \brief When the next call may be attempted, when maxcps is set */
+static struct timeval next_attempt;
+
 struct outgoing {
 	int retries;                              /*!< Current number of retries */
 	int maxretries;                           /*!< Maximum number of retries permitted */
@@ -100,13 +122,24 @@ struct outgoing {
 };
 
 #if defined(HAVE_INOTIFY) || defined(HAVE_KQUEUE)
+/*! \brief A call file waiting to be looked at */
 struct direntry {
-	AST_LIST_ENTRY(direntry) list;
+	/*! When it is due */
 	time_t mtime;
+	/*! Its position in dirqueue */
+	ssize_t __heap_index;
 	char name[0];
 };
 
-static AST_LIST_HEAD_STATIC(dirlist, direntry);
+/*! \brief The buckets of dirnames */
+#define DIRNAMES_BUCKETS 1031
+
+/*! \brief Protects dirnames and dirqueue */
+AST_MUTEX_DEFINE_STATIC(dirlock);
+/*! \brief The call files waiting, by name */
+static struct ao2_container *dirnames;
+/*! \brief The call files waiting, the one due first on top */
+static struct ast_heap *dirqueue;
 
 static void queue_file(const char *filename, time_t when);
 #endif
@@ -381,16 +414,13 @@ static int remove_from_queue(struct outgoing *o, const char *status)
 	}
 
 #if defined(HAVE_INOTIFY) || defined(HAVE_KQUEUE)
-	AST_LIST_LOCK(&dirlist);
-	AST_LIST_TRAVERSE_SAFE_BEGIN(&dirlist, cur, list) {
-		if (!strcmp(cur->name, o->fn)) {
-			AST_LIST_REMOVE_CURRENT(list);
-			ast_free(cur);
-			break;
-		}
+	ast_mutex_lock(&dirlock);
+	cur = ao2_find(dirnames, o->fn, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NOLOCK);
+	if (cur) {
+		ast_heap_remove(dirqueue, cur);
+		ao2_ref(cur, -1);
 	}
-	AST_LIST_TRAVERSE_SAFE_END;
-	AST_LIST_UNLOCK(&dirlist);
+	ast_mutex_unlock(&dirlock);
 #endif
 
 	if (!ast_test_flag(&o->options, SPOOL_FLAG_ARCHIVE)) {
@@ -428,10 +458,38 @@ static int remove_from_queue(struct outgoing *o, const char *status)
 	return 0;
 }
 
-static void *attempt_thread(void *data)
+/*!
+ * \brief Wait until another call may be attempted, if maxcps is set
+ */
+static void wait_next_attempt(void)
+{
+	struct timeval now;
+	struct timeval when;
+	int64_t wait;
+
+	if (!maxcps) {
+		return;
+	}
+
+	ast_mutex_lock(&next_attempt_lock);
+	now = ast_tvnow();
+	when = ast_tvcmp(next_attempt, now) > 0 ? next_attempt : now;
+	next_attempt = ast_tvadd(when, ast_samp2tv(1, maxcps));
+	ast_mutex_unlock(&next_attempt_lock);
+
+	wait = ast_tvdiff_us(when, now);
+	if (wait > 0) {
+		usleep(wait);
+	}
+}
+
+static int attempt_call(void *data)
 {
 	struct outgoing *o = data;
 	int res, reason;
+
+	wait_next_attempt();
+
 	if (!ast_strlen_zero(o->app)) {
 		ast_verb(3, "Attempting call on %s/%s for application %s(%s) (Retry %d)\n", o->tech, o->dest, o->app, o->data, o->retries);
 		res = ast_pbx_outgoing_app(o->tech, o->capabilities, o->dest,
@@ -464,16 +522,14 @@ static void *attempt_thread(void *data)
 		remove_from_queue(o, "Completed");
 	}
 	free_outgoing(o);
-	return NULL;
+	return 0;
 }
 
 static void launch_service(struct outgoing *o)
 {
-	pthread_t t;
-	int ret;
-
-	if ((ret = ast_pthread_create_detached(&t, NULL, attempt_thread, o))) {
-		ast_log(LOG_WARNING, "Unable to create thread :( (returned error: %d)\n", ret);
+	/* The call waits for a thread of the pool if maxcalls are being attempted */
+	if (ast_threadpool_push(attempt_pool, attempt_call, o)) {
+		ast_log(LOG_WARNING, "Unable to queue the call in %s\n", o->fn);
 		free_outgoing(o);
 	}
 }
@@ -550,19 +606,57 @@ static int scan_service(const char *fn, time_t now)
 
 
 #if defined(HAVE_INOTIFY)
-/* Only one thread is accessing this list, so no lock is necessary */
-static AST_LIST_HEAD_NOLOCK_STATIC(createlist, direntry);
-static AST_LIST_HEAD_NOLOCK_STATIC(openlist, direntry);
+/*! \brief A call file that was created and is not known to be written yet */
+struct pending_file {
+	/*! Its entry in createlist, while it was not opened */
+	AST_DLLIST_ENTRY(pending_file) list;
+	/*! When it is taken to have been written, if it is not opened */
+	time_t mtime;
+	/*! Whether it was opened after it was created */
+	unsigned int opened:1;
+	char name[0];
+};
+
+/*! \brief The buckets of pending */
+#define PENDING_BUCKETS 1031
+
+/* Only the scan thread accesses these, so no lock is necessary */
+/*! \brief The call files created and not written yet, by name */
+static struct ao2_container *pending;
+/*! \brief The call files created and not opened, oldest first */
+static AST_DLLIST_HEAD_NOLOCK_STATIC(createlist, pending_file);
+
+AO2_STRING_FIELD_HASH_FN(pending_file, name);
+AO2_STRING_FIELD_CMP_FN(pending_file, name);
 #endif
 
 #if defined(HAVE_INOTIFY) || defined(HAVE_KQUEUE)
 
+AO2_STRING_FIELD_HASH_FN(direntry, name);
+AO2_STRING_FIELD_CMP_FN(direntry, name);
+
+static int direntry_cmp(void *a, void *b)
+{
+	const struct direntry *left = a;
+	const struct direntry *right = b;
+
+	/* The heap keeps the greatest on top, and the file due first is wanted */
+	return left->mtime < right->mtime ? 1 : left->mtime > right->mtime ? -1 : 0;
+}
+
+/*!
+ * \brief Queue a call file to be looked at when it is due
+ *
+ * \param filename The call file, in qdir if not a path
+ * \param when When it is due, 0 for the modification time of the file
+ *
+ * A call file already queued is only looked at once, when it is due the
+ * last time it was queued for.
+ */
 static void queue_file(const char *filename, time_t when)
 {
 	struct stat st;
-	struct direntry *cur, *new;
-	int res;
-	time_t now = time(NULL);
+	struct direntry *cur;
 
 	if (!strchr(filename, '/')) {
 		char *fn = ast_alloca(strlen(qdir) + strlen(filename) + 2);
@@ -583,107 +677,138 @@ static void queue_file(const char *filename, time_t when)
 		when = st.st_mtime;
 	}
 
-	/* Need to check the existing list in order to avoid duplicates. */
-	AST_LIST_LOCK(&dirlist);
-	AST_LIST_TRAVERSE(&dirlist, cur, list) {
-		if (cur->mtime == when && !strcmp(filename, cur->name)) {
-			AST_LIST_UNLOCK(&dirlist);
-			return;
+	ast_mutex_lock(&dirlock);
+	cur = ao2_find(dirnames, filename, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (cur) {
+		if (cur->mtime != when) {
+			ast_heap_remove(dirqueue, cur);
+			cur->mtime = when;
+			ast_heap_push(dirqueue, cur);
 		}
+		ao2_ref(cur, -1);
+		ast_mutex_unlock(&dirlock);
+		return;
 	}
 
-	if ((res = when) > now || (res = scan_service(filename, now)) > 0) {
-		if (!(new = ast_calloc(1, sizeof(*new) + strlen(filename) + 1))) {
-			AST_LIST_UNLOCK(&dirlist);
-			return;
-		}
-		new->mtime = res;
-		strcpy(new->name, filename);
-		/* List is ordered by mtime */
-		if (AST_LIST_EMPTY(&dirlist)) {
-			AST_LIST_INSERT_HEAD(&dirlist, new, list);
-		} else {
-			int found = 0;
-			AST_LIST_TRAVERSE_SAFE_BEGIN(&dirlist, cur, list) {
-				if (cur->mtime > new->mtime) {
-					AST_LIST_INSERT_BEFORE_CURRENT(new, list);
-					found = 1;
-					break;
-				}
-			}
-			AST_LIST_TRAVERSE_SAFE_END
-			if (!found) {
-				AST_LIST_INSERT_TAIL(&dirlist, new, list);
-			}
+	cur = ao2_alloc_options(sizeof(*cur) + strlen(filename) + 1, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!cur) {
+		ast_mutex_unlock(&dirlock);
+		return;
+	}
+	cur->mtime = when;
+	strcpy(cur->name, filename); /* SAFE */
+	if (ast_heap_push(dirqueue, cur)) {
+		ao2_ref(cur, -1);
+		ast_mutex_unlock(&dirlock);
+		return;
+	}
+	/* The container keeps the reference */
+	ao2_link_flags(dirnames, cur, OBJ_NOLOCK);
+	ao2_ref(cur, -1);
+	ast_mutex_unlock(&dirlock);
+}
+
+/*!
+ * \brief Look at all the queued call files that are due
+ *
+ * \param now The current time
+ *
+ * \return When the next queued call file is due
+ * \retval INT_MAX if none are queued
+ */
+static time_t service_queue(time_t now)
+{
+	struct direntry *cur;
+	time_t next;
+	int res;
+
+	ast_mutex_lock(&dirlock);
+	while ((cur = ast_heap_peek(dirqueue, 1)) && cur->mtime <= now) {
+		ast_heap_pop(dirqueue);
+		/* Takes the reference of the container */
+		cur = ao2_find(dirnames, cur, OBJ_SEARCH_OBJECT | OBJ_UNLINK | OBJ_NOLOCK);
+		ast_mutex_unlock(&dirlock);
+
+		if ((res = scan_service(cur->name, now)) > 0) {
+			queue_file(cur->name, res);
 		}
+		ao2_ref(cur, -1);
+
+		ast_mutex_lock(&dirlock);
 	}
-	AST_LIST_UNLOCK(&dirlist);
+	next = cur ? cur->mtime : INT_MAX;
+	ast_mutex_unlock(&dirlock);
+
+	return next;
 }
 
 #ifdef HAVE_INOTIFY
 static void queue_file_create(const char *filename)
 {
-	struct direntry *cur;
+	struct pending_file *cur;
 
-	AST_LIST_TRAVERSE(&createlist, cur, list) {
-		if (!strcmp(cur->name, filename)) {
-			return;
-		}
+	cur = ao2_find(pending, filename, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (cur) {
+		ao2_ref(cur, -1);
+		return;
 	}
 
-	if (!(cur = ast_calloc(1, sizeof(*cur) + strlen(filename) + 1))) {
+	cur = ao2_alloc_options(sizeof(*cur) + strlen(filename) + 1, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!cur) {
 		return;
 	}
-	strcpy(cur->name, filename);
+	strcpy(cur->name, filename); /* SAFE */
 	/* We'll handle this file unless an IN_OPEN event occurs within 2 seconds */
 	cur->mtime = time(NULL) + 2;
-	AST_LIST_INSERT_TAIL(&createlist, cur, list);
+	ao2_link_flags(pending, cur, OBJ_NOLOCK);
+	/* The list shares the reference of the container */
+	AST_DLLIST_INSERT_TAIL(&createlist, cur, list);
+	ao2_ref(cur, -1);
 }
 
 static void queue_file_open(const char *filename)
 {
-	struct direntry *cur;
+	struct pending_file *cur;
 
-	AST_LIST_TRAVERSE_SAFE_BEGIN(&createlist, cur, list) {
-		if (!strcmp(cur->name, filename)) {
-			AST_LIST_REMOVE_CURRENT(list);
-			AST_LIST_INSERT_TAIL(&openlist, cur, list);
-			break;
-		}
+	cur = ao2_find(pending, filename, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!cur) {
+		return;
+	}
+	if (!cur->opened) {
+		AST_DLLIST_REMOVE(&createlist, cur, list);
+		cur->opened = 1;
 	}
-	AST_LIST_TRAVERSE_SAFE_END
+	ao2_ref(cur, -1);
 }
 
 static void queue_created_files(void)
 {
-	struct direntry *cur;
+	struct pending_file *cur;
 	time_t now = time(NULL);
 
-	AST_LIST_TRAVERSE_SAFE_BEGIN(&createlist, cur, list) {
-		if (cur->mtime > now) {
-			break;
-		}
-
-		AST_LIST_REMOVE_CURRENT(list);
+	while ((cur = AST_DLLIST_FIRST(&createlist)) && cur->mtime <= now) {
+		AST_DLLIST_REMOVE_HEAD(&createlist, list);
+		/* Takes the reference of the container */
+		cur = ao2_find(pending, cur, OBJ_SEARCH_OBJECT | OBJ_UNLINK | OBJ_NOLOCK);
 		queue_file(cur->name, 0);
-		ast_free(cur);
+		ao2_ref(cur, -1);
 	}
-	AST_LIST_TRAVERSE_SAFE_END
 }
 
 static void queue_file_write(const char *filename)
 {
-	struct direntry *cur;
+	struct pending_file *cur;
+
 	/* Only queue entries where an IN_CREATE preceded the IN_CLOSE_WRITE */
-	AST_LIST_TRAVERSE_SAFE_BEGIN(&openlist, cur, list) {
-		if (!strcmp(cur->name, filename)) {
-			AST_LIST_REMOVE_CURRENT(list);
-			ast_free(cur);
-			queue_file(filename, 0);
-			break;
-		}
+	cur = ao2_find(pending, filename, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!cur) {
+		return;
+	}
+	if (cur->opened) {
+		ao2_unlink_flags(pending, cur, OBJ_NOLOCK);
+		queue_file(filename, 0);
 	}
-	AST_LIST_TRAVERSE_SAFE_END
+	ao2_ref(cur, -1);
 }
 #endif
 
@@ -705,7 +830,7 @@ static void *scan_thread(void *unused)
 	struct kevent kev;
 	struct kevent event;
 #endif
-	struct direntry *cur;
+	time_t next;
 
 	while (!ast_fully_booted) {
 		nanosleep(&ts, NULL);
@@ -738,7 +863,6 @@ static void *scan_thread(void *unused)
 		ast_log(LOG_ERROR, "Unable to watch directory %s: %s\n", qdir, strerror(errno));
 	}
 #endif
-	now = time(NULL);
 	while ((de = readdir(dir))) {
 		queue_file(de->d_name, 0);
 	}
@@ -750,7 +874,8 @@ static void *scan_thread(void *unused)
 
 	/* Wait for either a) next timestamp to occur, or b) a change to happen */
 	for (;/* ever */;) {
-		time_t next = AST_LIST_EMPTY(&dirlist) ? INT_MAX : AST_LIST_FIRST(&dirlist)->mtime;
+		/* Look at all the call files that are due, then wait for more */
+		next = service_queue(time(NULL));
 
 		time(&now);
 		if (next > now) {
@@ -802,7 +927,6 @@ static void *scan_thread(void *unused)
 			} else if (res < 0 && errno != EINTR && errno != EAGAIN) {
 				ast_debug(1, "Got an error back from %s(2): %s\n", stage ? "read" : "poll", strerror(errno));
 			}
-			time(&now);
 		}
 		queue_created_files();
 #else
@@ -827,18 +951,8 @@ static void *scan_thread(void *unused)
 					queue_file(de->d_name, 0);
 				}
 			}
-			time(&now);
 		}
 #endif
-
-		/* Empty the list of all entries ready to be processed */
-		AST_LIST_LOCK(&dirlist);
-		while (!AST_LIST_EMPTY(&dirlist) && AST_LIST_FIRST(&dirlist)->mtime <= now) {
-			cur = AST_LIST_REMOVE_HEAD(&dirlist, list);
-			queue_file(cur->name, cur->mtime);
-			ast_free(cur);
-		}
-		AST_LIST_UNLOCK(&dirlist);
 	}
 	return NULL;
 }
@@ -938,6 +1052,36 @@ static void *scan_thread(void *unused)
 }
 #endif
 
+static void load_config(void)
+{
+	struct ast_flags config_flags = { 0 };
+	struct ast_config *cfg;
+	struct ast_variable *var;
+
+	cfg = ast_config_load("pbx_spool.conf", config_flags);
+	if (!cfg || cfg == CONFIG_STATUS_FILEINVALID) {
+		return;
+	}
+
+	for (var = ast_variable_browse(cfg, "general"); var; var = var->next) {
+		if (!strcasecmp(var->name, "maxcalls")) {
+			if (ast_parse_arg(var->value, PARSE_INT32 | PARSE_IN_RANGE, &maxcalls, 0, INT_MAX)) {
+				ast_log(LOG_WARNING, "Invalid maxcalls '%s' at line %d of pbx_spool.conf\n",
+					var->value, var->lineno);
+				maxcalls = DEFAULT_MAXCALLS;
+			}
+		} else if (!strcasecmp(var->name, "maxcps")) {
+			if (ast_parse_arg(var->value, PARSE_INT32 | PARSE_IN_RANGE, &maxcps, 0, INT_MAX)) {
+				ast_log(LOG_WARNING, "Invalid maxcps '%s' at line %d of pbx_spool.conf\n",
+					var->value, var->lineno);
+				maxcps = 0;
+			}
+		}
+	}
+
+	ast_config_destroy(cfg);
+}
+
 static int unload_module(void)
 {
 	return -1;
@@ -945,6 +1089,12 @@ static int unload_module(void)
 
 static int load_module(void)
 {
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 60,
+		.auto_increment = 1,
+		.initial_size = 0,
+	};
 	pthread_t thread;
 	int ret;
 	snprintf(qdir, sizeof(qdir), "%s/%s", ast_config_AST_SPOOL_DIR, "outgoing");
@@ -954,6 +1104,30 @@ static int load_module(void)
 	}
 	snprintf(qdonedir, sizeof(qdir), "%s/%s", ast_config_AST_SPOOL_DIR, "outgoing_done");
 
+	load_config();
+
+	options.max_size = maxcalls;
+	attempt_pool = ast_threadpool_create("pbx_spool", NULL, &options);
+	if (!attempt_pool) {
+		return AST_MODULE_LOAD_FAILURE;
+	}
+
+#if defined(HAVE_INOTIFY) || defined(HAVE_KQUEUE)
+	dirnames = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, DIRNAMES_BUCKETS,
+		direntry_hash_fn, NULL, direntry_cmp_fn);
+	dirqueue = ast_heap_create(8, direntry_cmp, offsetof(struct direntry, __heap_index));
+	if (!dirnames || !dirqueue) {
+		return AST_MODULE_LOAD_FAILURE;
+	}
+#endif
+#if defined(HAVE_INOTIFY)
+	pending = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, PENDING_BUCKETS,
+		pending_file_hash_fn, NULL, pending_file_cmp_fn);
+	if (!pending) {
+		return AST_MODULE_LOAD_FAILURE;
+	}
+#endif
+
 	if ((ret = ast_pthread_create_detached_background(&thread, NULL, scan_thread, NULL))) {
 		ast_log(LOG_WARNING, "Unable to create thread :( (returned error: %d)\n", ret);
 		return AST_MODULE_LOAD_FAILURE;
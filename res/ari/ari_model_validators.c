@@ -5888,6 +5888,9 @@ int ast_ari_validate_event(struct ast_json *json)
 	if (strcmp("EndpointStateChange", discriminator) == 0) {
 		return ast_ari_validate_endpoint_state_change(json);
 	} else
+	if (strcmp("OperationCompleted", discriminator) == 0) {
+		return ast_ari_validate_operation_completed(json);
+	} else
 	if (strcmp("PeerStatusChange", discriminator) == 0) {
 		return ast_ari_validate_peer_status_change(json);
 	} else
@@ -6101,6 +6104,9 @@ int ast_ari_validate_message(struct ast_json *json)
 	if (strcmp("MissingParams", discriminator) == 0) {
 		return ast_ari_validate_missing_params(json);
 	} else
+	if (strcmp("OperationCompleted", discriminator) == 0) {
+		return ast_ari_validate_operation_completed(json);
+	} else
 	if (strcmp("PeerStatusChange", discriminator) == 0) {
 		return ast_ari_validate_peer_status_change(json);
 	} else
@@ -6242,6 +6248,126 @@ ari_validator ast_ari_validate_missing_params_fn(void)
 	return ast_ari_validate_missing_params;
 }
 
+int ast_ari_validate_operation_completed(struct ast_json *json)
+{
+	int res = 1;
+	struct ast_json_iter *iter;
+	int has_type = 0;
+	int has_application = 0;
+	int has_timestamp = 0;
+	int has_operation_id = 0;
+	int has_result = 0;
+
+	for (iter = ast_json_object_iter(json); iter; iter = ast_json_object_iter_next(json, iter)) {
+		if (strcmp("asterisk_id", ast_json_object_iter_key(iter)) == 0) {
+			int prop_is_valid;
+			prop_is_valid = ast_ari_validate_string(
+				ast_json_object_iter_value(iter));
+			if (!prop_is_valid) {
+				ast_log(LOG_ERROR, "ARI OperationCompleted field asterisk_id failed validation\n");
+				res = 0;
+			}
+		} else
+		if (strcmp("type", ast_json_object_iter_key(iter)) == 0) {
+			int prop_is_valid;
+			has_type = 1;
+			prop_is_valid = ast_ari_validate_string(
+				ast_json_object_iter_value(iter));
+			if (!prop_is_valid) {
+				ast_log(LOG_ERROR, "ARI OperationCompleted field type failed validation\n");
+				res = 0;
+			}
+		} else
+		if (strcmp("application", ast_json_object_iter_key(iter)) == 0) {
+			int prop_is_valid;
+			has_application = 1;
+			prop_is_valid = ast_ari_validate_string(
+				ast_json_object_iter_value(iter));
+			if (!prop_is_valid) {
+				ast_log(LOG_ERROR, "ARI OperationCompleted field application failed validation\n");
+				res = 0;
+			}
+		} else
+		if (strcmp("timestamp", ast_json_object_iter_key(iter)) == 0) {
+			int prop_is_valid;
+			has_timestamp = 1;
+			prop_is_valid = ast_ari_validate_date(
+				ast_json_object_iter_value(iter));
+			if (!prop_is_valid) {
+				ast_log(LOG_ERROR, "ARI OperationCompleted field timestamp failed validation\n");
+				res = 0;
+			}
+		} else
+		if (strcmp("operation_id", ast_json_object_iter_key(iter)) == 0) {
+			int prop_is_valid;
+			has_operation_id = 1;
+			prop_is_valid = ast_ari_validate_string(
+				ast_json_object_iter_value(iter));
+			if (!prop_is_valid) {
+				ast_log(LOG_ERROR, "ARI OperationCompleted field operation_id failed validation\n");
+				res = 0;
+			}
+		} else
+		if (strcmp("result", ast_json_object_iter_key(iter)) == 0) {
+			int prop_is_valid;
+			has_result = 1;
+			prop_is_valid = ast_ari_validate_string(
+				ast_json_object_iter_value(iter));
+			if (!prop_is_valid) {
+				ast_log(LOG_ERROR, "ARI OperationCompleted field result failed validation\n");
+				res = 0;
+			}
+		} else
+		if (strcmp("error", ast_json_object_iter_key(iter)) == 0) {
+			int prop_is_valid;
+			prop_is_valid = ast_ari_validate_string(
+				ast_json_object_iter_value(iter));
+			if (!prop_is_valid) {
+				ast_log(LOG_ERROR, "ARI OperationCompleted field error failed validation\n");
+				res = 0;
+			}
+		} else
+		{
+			ast_log(LOG_ERROR,
+				"ARI OperationCompleted has undocumented field %s\n",
+				ast_json_object_iter_key(iter));
+			res = 0;
+		}
+	}
+
+	if (!has_type) {
+		ast_log(LOG_ERROR, "ARI OperationCompleted missing required field type\n");
+		res = 0;
+	}
+
+	if (!has_application) {
+		ast_log(LOG_ERROR, "ARI OperationCompleted missing required field application\n");
+		res = 0;
+	}
+
+	if (!has_timestamp) {
+		ast_log(LOG_ERROR, "ARI OperationCompleted missing required field timestamp\n");
+		res = 0;
+	}
+
+	if (!has_operation_id) {
+		ast_log(LOG_ERROR, "ARI OperationCompleted missing required field operation_id\n");
+		res = 0;
+	}
+
+	if (!has_result) {
+		ast_log(LOG_ERROR, "ARI OperationCompleted missing required field result\n");
+		res = 0;
+	}
+
+	return res;
+}
+
+ari_validator ast_ari_validate_operation_completed_fn(void)
+{
+	return ast_ari_validate_operation_completed;
+}
+
 int ast_ari_validate_peer(struct ast_json *json)
 {
 	int res = 1;
@@ -1087,6 +1087,22 @@ int ast_ari_validate_missing_params(struct ast_json *json);
  */
 ari_validator ast_ari_validate_missing_params_fn(void);
 
+/*!
+ * \brief Validator for OperationCompleted.
+ *
+ * An operation given an operationId, such as adding channels to a bridge, has completed.
+ *
+ * \param json JSON object to validate.
+ * \retval True (non-zero) if valid.
+ * \retval False (zero) if invalid.
+ */
+int ast_ari_validate_operation_completed(struct ast_json *json);
+
+/*!
+ * \brief Function pointer to ast_ari_validate_operation_completed().
+ */
+ari_validator ast_ari_validate_operation_completed_fn(void);
+
 /*!
  * \brief Validator for Peer.
  *
@@ -1676,6 +1692,14 @@ ari_validator ast_ari_validate_application_fn(void);
  * - asterisk_id: string
  * - type: string (required)
  * - params: List[string] (required)
+ * OperationCompleted
+ * - asterisk_id: string
+ * - type: string (required)
+ * - application: string (required)
+ * - timestamp: Date (required)
+ * - operation_id: string (required)
+ * - result: string (required)
+ * - error: string
  * Peer
  * - address: string
  * - cause: string
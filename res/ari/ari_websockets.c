@@ -22,6 +22,7 @@
 #include "asterisk/astobj2.h"
 #include "asterisk/http_websocket.h"
 #include "asterisk/stasis_app.h"
+#include "asterisk/vector.h"
 #include "internal.h"
 
 /*! \file
@@ -30,15 +31,34 @@
  * \author David M. Lee, II <dlee@digium.com>
  */
 
+/*! Most messages waiting for a web socket before new ones are dropped */
+#define MESSAGES_QUEUE_MAX 10000
+
+/*! Messages encoded for a web socket */
+AST_VECTOR(ari_websocket_messages, char *);
+
 struct ast_ari_websocket_session {
 	struct ast_websocket *ws_session;
 	int (*validator)(struct ast_json *);
+	/*! Most messages sent in one frame, as a JSON array */
+	int batch_max;
+	/*! Set while a thread is writing the queued messages */
+	unsigned int writing:1;
+	/*! Messages waiting for the writing thread, protected by the session lock */
+	struct ari_websocket_messages queue;
+	/*! Messages being written, only used by the writing thread */
+	struct ari_websocket_messages writing_queue;
+	/*! Messages dropped because too many were waiting */
+	unsigned int dropped;
 };
 
 static void websocket_session_dtor(void *obj)
 {
 	struct ast_ari_websocket_session *session = obj;
 
+	AST_VECTOR_RESET(&session->queue, ast_json_free);
+	AST_VECTOR_FREE(&session->queue);
+	AST_VECTOR_FREE(&session->writing_queue);
 	ast_websocket_unref(session->ws_session);
 	session->ws_session = NULL;
 }
@@ -86,9 +106,14 @@ struct ast_ari_websocket_session *ast_ari_websocket_session_create(
 		return NULL;
 	}
 
+	if (AST_VECTOR_INIT(&session->queue, 8) || AST_VECTOR_INIT(&session->writing_queue, 8)) {
+		return NULL;
+	}
+
 	ao2_ref(ws_session, +1);
 	session->ws_session = ws_session;
 	session->validator = validator;
+	session->batch_max = config->general->batch_max;
 
 	ao2_ref(session, +1);
 	return session;
@@ -155,10 +180,51 @@ struct ast_json *ast_ari_websocket_session_read(
 	"  \"message\": \"Message validation failed\""	\
 	"}"
 
+/*!
+ * \internal
+ * \brief Write messages to a web socket, several to a frame when batching
+ *
+ * \retval 0 on success.
+ * \retval -1 if the web socket failed.
+ */
+static int websocket_session_write_messages(struct ast_ari_websocket_session *session,
+	struct ari_websocket_messages *messages)
+{
+	struct ast_str *batch = NULL;
+	size_t i = 0;
+	int res = 0;
+
+	while (!res && i < AST_VECTOR_SIZE(messages)) {
+		size_t count = MIN(AST_VECTOR_SIZE(messages) - i, MAX(session->batch_max, 1));
+		size_t j;
+
+		if (count == 1) {
+			res = ast_websocket_write_string(session->ws_session, AST_VECTOR_GET(messages, i));
+			++i;
+			continue;
+		}
+
+		if (!batch && !(batch = ast_str_create(4096))) {
+			res = -1;
+			break;
+		}
+		ast_str_set(&batch, 0, "[");
+		for (j = 0; j < count; ++j, ++i) {
+			ast_str_append(&batch, 0, "%s%s", j ? "," : "", AST_VECTOR_GET(messages, i));
+		}
+		ast_str_append(&batch, 0, "]");
+		res = ast_websocket_write_string(session->ws_session, ast_str_buffer(batch));
+	}
+	ast_free(batch);
+
+	return res;
+}
+
 int ast_ari_websocket_session_write(struct ast_ari_websocket_session *session,
 	struct ast_json *message)
 {
-	RAII_VAR(char *, str, NULL, ast_json_free);
+	char *str;
+	int res = 0;
 
 #ifdef AST_DEVMODE
 	if (!session->validator(message)) {
@@ -174,12 +240,55 @@ int ast_ari_websocket_session_write(struct ast_ari_websocket_session *session,
 		return -1;
 	}
 
-	if (ast_websocket_write_string(session->ws_session, str)) {
-		ast_log(LOG_NOTICE, "Problem occurred during websocket write to %s, websocket closed\n",
-			ast_sockaddr_stringify(ast_ari_websocket_session_get_remote_addr(session)));
+	/*
+	 * Messages sent while another thread writes to the web socket are
+	 * queued for that thread, which writes them all in a row.  A thread
+	 * sending a message for one application so no longer waits on a slow
+	 * client because of the messages of the others, and when batching, the
+	 * messages that piled up go out in as few frames as possible.
+	 */
+	ao2_lock(session);
+	if (AST_VECTOR_SIZE(&session->queue) >= MESSAGES_QUEUE_MAX) {
+		if (!(session->dropped++ % 1000)) {
+			ast_log(LOG_WARNING, "ARI web socket to %s is not keeping up, %u messages dropped so far\n",
+				ast_sockaddr_stringify(ast_ari_websocket_session_get_remote_addr(session)),
+				session->dropped);
+		}
+		ao2_unlock(session);
+		ast_json_free(str);
 		return -1;
 	}
-	return 0;
+	if (AST_VECTOR_APPEND(&session->queue, str)) {
+		ao2_unlock(session);
+		ast_json_free(str);
+		return -1;
+	}
+	if (session->writing) {
+		ao2_unlock(session);
+		return 0;
+	}
+	session->writing = 1;
+
+	while (AST_VECTOR_SIZE(&session->queue)) {
+		struct ari_websocket_messages messages = session->queue;
+
+		session->queue = session->writing_queue;
+		session->writing_queue = messages;
+		ao2_unlock(session);
+
+		if (!res && websocket_session_write_messages(session, &session->writing_queue)) {
+			ast_log(LOG_NOTICE, "Problem occurred during websocket write to %s, websocket closed\n",
+				ast_sockaddr_stringify(ast_ari_websocket_session_get_remote_addr(session)));
+			res = -1;
+		}
+		AST_VECTOR_RESET(&session->writing_queue, ast_json_free);
+
+		ao2_lock(session);
+	}
+	session->writing = 0;
+	ao2_unlock(session);
+
+	return res;
 }
 
 struct ast_sockaddr *ast_ari_websocket_session_get_remote_addr(
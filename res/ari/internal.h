@@ -67,6 +67,8 @@ struct ast_ari_conf_general {
 	int enabled;
 	/*! Write timeout for websocket connections */
 	int write_timeout;
+	/*! Most events sent in one websocket frame */
+	int batch_max;
 	/*! Encoding format used during output (default compact). */
 	enum ast_json_encoding_format format;
 	/*! Authentication realm */
@@ -188,6 +188,136 @@ static int check_add_remove_channel(struct ast_ari_response *response,
 	return 0;
 }
 
+/*! \brief Channels being added to or removed from a bridge without waiting */
+struct bridge_operation {
+	/*! The applications controlling the channels, told once it has completed */
+	struct ao2_container *apps;
+	/*! Why it failed, NULL while it has not */
+	char *error;
+	/*! What is done to the channels, for the error */
+	const char *action;
+	/*! Channels not done yet, plus one while they are still being queued */
+	int pending;
+	/*! The operationId given */
+	char id[0];
+};
+
+typedef int (*bridge_operation_fn)(struct stasis_app_control *control,
+	struct ast_bridge *bridge, stasis_app_command_done_cb done_fn, void *done_data);
+
+static void bridge_operation_dtor(void *obj)
+{
+	struct bridge_operation *operation = obj;
+
+	ao2_cleanup(operation->apps);
+	ast_free(operation->error);
+}
+
+static void bridge_operation_completed(struct bridge_operation *operation)
+{
+	struct ast_json *message;
+	struct ao2_iterator iter;
+	char *app_name;
+
+	message = ast_json_pack("{s: s, s: o, s: s, s: s}",
+		"type", "OperationCompleted",
+		"timestamp", ast_json_timeval(ast_tvnow(), NULL),
+		"operation_id", operation->id,
+		"result", operation->error ? "failure" : "success");
+	if (!message) {
+		return;
+	}
+	if (operation->error) {
+		ast_json_object_set(message, "error", ast_json_string_create(operation->error));
+	}
+
+	iter = ao2_iterator_init(operation->apps, 0);
+	while ((app_name = ao2_iterator_next(&iter))) {
+		stasis_app_send(app_name, message);
+		ao2_ref(app_name, -1);
+	}
+	ao2_iterator_destroy(&iter);
+
+	ast_json_unref(message);
+}
+
+/*! \brief Called as each channel is done with, and once all have been queued */
+static void bridge_operation_done(struct stasis_app_control *control, int result, void *data)
+{
+	struct bridge_operation *operation = data;
+	int pending;
+
+	ao2_lock(operation);
+	if (result && !operation->error) {
+		if (result == STASIS_APP_CHANNEL_RECORDING) {
+			ast_asprintf(&operation->error, "Channel %s currently recording",
+				stasis_app_control_get_channel_id(control));
+		} else {
+			ast_asprintf(&operation->error, "Channel %s could not be %s the bridge",
+				stasis_app_control_get_channel_id(control), operation->action);
+		}
+	}
+	pending = --operation->pending;
+	ao2_unlock(operation);
+
+	if (!pending) {
+		bridge_operation_completed(operation);
+	}
+}
+
+/*!
+ * \brief Queue adding or removing channels to or from a bridge under an operationId
+ *
+ * The response is given right away, the applications controlling the
+ * channels get an OperationCompleted event once they all are done with.
+ */
+static void bridge_operation_queue(struct ast_ari_response *response,
+	const char *operation_id, const char *action, struct ast_bridge *bridge,
+	struct control_list *list, bridge_operation_fn operation_fn)
+{
+	struct bridge_operation *operation;
+	size_t i;
+
+	operation = ao2_alloc(sizeof(*operation) + strlen(operation_id) + 1, bridge_operation_dtor);
+	if (!operation) {
+		ast_ari_response_alloc_failed(response);
+		return;
+	}
+	strcpy(operation->id, operation_id); /* Safe */
+	operation->action = action;
+	operation->pending = 1;
+
+	operation->apps = ast_str_container_alloc(1);
+	if (!operation->apps) {
+		ao2_ref(operation, -1);
+		ast_ari_response_alloc_failed(response);
+		return;
+	}
+	for (i = 0; i < list->count; ++i) {
+		struct stasis_app *app = stasis_app_control_get_app(list->controls[i]);
+
+		if (app) {
+			ast_str_container_add(operation->apps, stasis_app_name(app));
+			ao2_ref(app, -1);
+		}
+	}
+
+	for (i = 0; i < list->count; ++i) {
+		ao2_lock(operation);
+		++operation->pending;
+		ao2_unlock(operation);
+
+		if (operation_fn(list->controls[i], bridge, bridge_operation_done, operation)) {
+			/* Not queued, so it is done with now */
+			bridge_operation_done(list->controls[i], -1, operation);
+		}
+	}
+	bridge_operation_done(NULL, 0, operation);
+	ao2_ref(operation, -1);
+
+	ast_ari_response_no_content(response);
+}
+
 void ast_ari_bridges_add_channel(struct ast_variable *headers,
 	struct ast_ari_bridges_add_channel_args *args,
 	struct ast_ari_response *response)
@@ -225,6 +355,12 @@ void ast_ari_bridges_add_channel(struct ast_variable *headers,
 		}
 	}
 
+	if (!ast_strlen_zero(args->operation_id)) {
+		bridge_operation_queue(response, args->operation_id, "added to", bridge, list,
+			stasis_app_control_add_channel_to_bridge_async);
+		return;
+	}
+
 	for (i = 0; i < list->count; ++i) {
 		if ((has_error = check_add_remove_channel(response, list->controls[i],
 			     stasis_app_control_add_channel_to_bridge(
@@ -269,6 +405,12 @@ void ast_ari_bridges_remove_channel(struct ast_variable *headers,
 		}
 	}
 
+	if (!ast_strlen_zero(args->operation_id)) {
+		bridge_operation_queue(response, args->operation_id, "removed from", bridge, list,
+			stasis_app_control_remove_channel_from_bridge_async);
+		return;
+	}
+
 	/* Now actually remove it */
 	for (i = 0; i < list->count; ++i) {
 		stasis_app_control_remove_channel_from_bridge(list->controls[i],
@@ -892,6 +1034,53 @@ void ast_ari_bridges_destroy(struct ast_variable *headers,
 	ast_ari_response_no_content(response);
 }
 
+/*!
+ * \internal
+ * \brief Write the list of bridges straight into the response body
+ */
+static void bridges_list_write(struct ao2_container *bridges,
+	struct ast_ari_response *response)
+{
+	struct ast_str *body;
+	struct ast_json_writer writer;
+	struct ao2_iterator i;
+	struct ast_bridge *bridge;
+
+	body = ast_str_create(256 * (ao2_container_count(bridges) + 1));
+	if (!body) {
+		ast_ari_response_alloc_failed(response);
+		return;
+	}
+
+	ast_json_writer_init(&writer, &body);
+	ast_json_writer_array_start(&writer);
+	i = ao2_iterator_init(bridges, 0);
+	while ((bridge = ao2_iterator_next(&i))) {
+		struct ast_bridge_snapshot *snapshot = NULL;
+
+		/* Invisible bridges don't get shown externally and have no snapshot */
+		if (!ast_test_flag(&bridge->feature_flags, AST_BRIDGE_FLAG_INVISIBLE)) {
+			snapshot = ast_bridge_get_snapshot(bridge);
+		}
+		ao2_ref(bridge, -1);
+
+		if (snapshot) {
+			ast_bridge_snapshot_to_json_writer(snapshot, stasis_app_get_sanitizer(), &writer);
+			ao2_ref(snapshot, -1);
+		}
+	}
+	ao2_iterator_destroy(&i);
+	ast_json_writer_array_end(&writer);
+
+	if (ast_json_writer_finish(&writer)) {
+		ast_free(body);
+		ast_ari_response_alloc_failed(response);
+		return;
+	}
+
+	ast_ari_response_ok_body(response, body);
+}
+
 void ast_ari_bridges_list(struct ast_variable *headers,
 	struct ast_ari_bridges_list_args *args,
 	struct ast_ari_response *response)
@@ -907,6 +1096,11 @@ void ast_ari_bridges_list(struct ast_variable *headers,
 		return;
 	}
 
+	if (ast_ari_json_format() == AST_JSON_COMPACT) {
+		bridges_list_write(bridges, response);
+		return;
+	}
+
 	json = ast_json_array_create();
 	if (!json) {
 		ast_ari_response_alloc_failed(response);
@@ -156,6 +156,8 @@ struct ast_ari_bridges_add_channel_args {
 	int mute;
 	/*! Do not present the identity of the newly connected channel to other bridge members */
 	int inhibit_connected_line_updates;
+	/*! Add the channels without waiting for them to be added. An OperationCompleted event with this id is sent to the application once they all have been. */
+	const char *operation_id;
 };
 /*!
  * \brief Body parsing function for /bridges/{bridgeId}/addChannel.
@@ -186,6 +188,8 @@ struct ast_ari_bridges_remove_channel_args {
 	size_t channel_count;
 	/*! Parsing context for channel. */
 	char *channel_parse;
+	/*! Remove the channels without waiting for them to be removed. An OperationCompleted event with this id is sent to the application once they all have been. */
+	const char *operation_id;
 };
 /*!
  * \brief Body parsing function for /bridges/{bridgeId}/removeChannel.
@@ -953,6 +953,46 @@ void ast_ari_channels_hangup(struct ast_variable *headers,
 	ast_ari_response_no_content(response);
 }
 
+/*!
+ * \internal
+ * \brief Write the list of channels straight into the response body
+ *
+ * There can be thousands of channels, so rather than building a JSON
+ * value of each to encode them, they are written as they are encoded.
+ */
+static void channels_list_write(struct ao2_container *snapshots,
+	struct stasis_message_sanitizer *sanitize, struct ast_ari_response *response)
+{
+	struct ast_str *body;
+	struct ast_json_writer writer;
+	struct ao2_iterator i;
+	struct ast_channel_snapshot *snapshot;
+
+	body = ast_str_create(512 * (ao2_container_count(snapshots) + 1));
+	if (!body) {
+		ast_ari_response_alloc_failed(response);
+		return;
+	}
+
+	ast_json_writer_init(&writer, &body);
+	ast_json_writer_array_start(&writer);
+	i = ao2_iterator_init(snapshots, 0);
+	while ((snapshot = ao2_iterator_next(&i))) {
+		ast_channel_snapshot_to_json_writer(snapshot, sanitize, &writer);
+		ao2_ref(snapshot, -1);
+	}
+	ao2_iterator_destroy(&i);
+	ast_json_writer_array_end(&writer);
+
+	if (ast_json_writer_finish(&writer)) {
+		ast_free(body);
+		ast_ari_response_alloc_failed(response);
+		return;
+	}
+
+	ast_ari_response_ok_body(response, body);
+}
+
 void ast_ari_channels_list(struct ast_variable *headers,
 	struct ast_ari_channels_list_args *args,
 	struct ast_ari_response *response)
@@ -965,6 +1005,11 @@ void ast_ari_channels_list(struct ast_variable *headers,
 
 	snapshots = ast_channel_cache_all();
 
+	if (ast_ari_json_format() == AST_JSON_COMPACT) {
+		channels_list_write(snapshots, sanitize, response);
+		return;
+	}
+
 	json = ast_json_array_create();
 	if (!json) {
 		ast_ari_response_alloc_failed(response);
@@ -1060,7 +1105,17 @@ end:
 	return NULL;
 }
 
-static struct ast_channel *ari_channels_handle_originate_with_id(const char *args_endpoint,
+/*!
+ * \internal
+ * \brief Create the channel of an origination, ready to be dialed by ari_originate_dial()
+ *
+ * \param[out] snapshot The snapshot of the channel
+ * \param[out] response HTTP response if error
+ *
+ * \return The dial, with the origination as its user data
+ * \retval NULL on error
+ */
+static struct ast_dial *ari_channels_prepare_originate(const char *args_endpoint,
 	const char *args_extension,
 	const char *args_context,
 	long args_priority,
@@ -1074,6 +1129,7 @@ static struct ast_channel *ari_channels_handle_originate_with_id(const char *arg
 	const char *args_other_channel_id,
 	const char *args_originator,
 	const char *args_formats,
+	struct ast_channel_snapshot **snapshot,
 	struct ast_ari_response *response)
 {
 	char *dialtech;
@@ -1085,13 +1141,11 @@ static struct ast_channel *ari_channels_handle_originate_with_id(const char *arg
 	char *stuff;
 	struct ast_channel *other = NULL;
 	struct ast_channel *chan = NULL;
-	RAII_VAR(struct ast_channel_snapshot *, snapshot, NULL, ao2_cleanup);
 	struct ast_assigned_ids assignedids = {
 		.uniqueid = args_channel_id,
 		.uniqueid2 = args_other_channel_id,
 	};
 	struct ari_origination *origination;
-	pthread_t thread;
 	struct ast_format_cap *format_cap = NULL;
 
 	if ((assignedids.uniqueid && AST_MAX_PUBLIC_UNIQUEID < strlen(assignedids.uniqueid))
@@ -1339,18 +1393,50 @@ static struct ast_channel *ari_channels_handle_originate_with_id(const char *arg
 		}
 	}
 
-	snapshot = ast_channel_snapshot_get_latest(ast_channel_uniqueid(chan));
+	*snapshot = ast_channel_snapshot_get_latest(ast_channel_uniqueid(chan));
 	ast_channel_unlock(chan);
 
+	return dial;
+}
+
+static struct ast_channel *ari_channels_handle_originate_with_id(const char *args_endpoint,
+	const char *args_extension,
+	const char *args_context,
+	long args_priority,
+	const char *args_label,
+	const char *args_app,
+	const char *args_app_args,
+	const char *args_caller_id,
+	int args_timeout,
+	struct ast_variable *variables,
+	const char *args_channel_id,
+	const char *args_other_channel_id,
+	const char *args_originator,
+	const char *args_formats,
+	struct ast_ari_response *response)
+{
+	struct ast_dial *dial;
+	struct ast_channel *chan;
+	RAII_VAR(struct ast_channel_snapshot *, snapshot, NULL, ao2_cleanup);
+	pthread_t thread;
+
+	dial = ari_channels_prepare_originate(args_endpoint, args_extension, args_context,
+		args_priority, args_label, args_app, args_app_args, args_caller_id, args_timeout,
+		variables, args_channel_id, args_other_channel_id, args_originator, args_formats,
+		&snapshot, response);
+	if (!dial) {
+		return NULL;
+	}
+
 	/* Before starting the async dial bump the ref in case the dial quickly goes away and takes
 	 * the reference with it
 	 */
-	ast_channel_ref(chan);
+	chan = ast_channel_ref(ast_dial_get_channel(dial, 0));
 
 	if (ast_pthread_create_detached(&thread, NULL, ari_originate_dial, dial)) {
 		ast_ari_response_alloc_failed(response);
+		ast_free(ast_dial_get_user_data(dial));
 		ast_dial_destroy(dial);
-		ast_free(origination);
 	} else {
 		ast_ari_response_ok(response, ast_channel_snapshot_to_json(snapshot, NULL));
 	}
@@ -1469,6 +1555,133 @@ void ast_ari_channels_originate(struct ast_variable *headers,
 	ast_variables_destroy(variables);
 }
 
+/*! \brief The dials of a bulk origination, started by a dial batch */
+struct ari_bulk_origination {
+	AST_VECTOR(, struct ast_dial *) dials;
+};
+
+static void ari_bulk_origination_destroy(void *obj)
+{
+	struct ari_bulk_origination *bulk = obj;
+	int i;
+
+	/* Only the dials that were never started are left */
+	for (i = 0; i < AST_VECTOR_SIZE(&bulk->dials); i++) {
+		struct ast_dial *dial = AST_VECTOR_GET(&bulk->dials, i);
+
+		if (dial) {
+			ast_free(ast_dial_get_user_data(dial));
+			ast_dial_destroy(dial);
+		}
+	}
+	AST_VECTOR_FREE(&bulk->dials);
+}
+
+static void ari_bulk_originate_dial(void *data, size_t index)
+{
+	struct ari_bulk_origination *bulk = data;
+	struct ast_dial *dial = AST_VECTOR_GET(&bulk->dials, index);
+
+	/* Every dial is started once, by one thread, so no lock is needed */
+	AST_VECTOR_REPLACE(&bulk->dials, index, NULL);
+	ari_originate_dial(dial);
+}
+
+void ast_ari_channels_originate_bulk(struct ast_variable *headers,
+	struct ast_ari_channels_originate_bulk_args *args,
+	struct ast_ari_response *response)
+{
+	struct ast_variable *variables = NULL;
+	struct ari_bulk_origination *bulk = NULL;
+	struct ast_json *json = NULL;
+	size_t i;
+
+	/* Parse any query parameters out of the body parameter */
+	if (args->variables) {
+		struct ast_json *json_variables;
+
+		if (ast_ari_channels_originate_bulk_parse_body(args->variables, args)) {
+			ast_ari_response_alloc_failed(response);
+			return;
+		}
+		json_variables = ast_json_object_get(args->variables, "variables");
+		if (json_variables
+			&& json_to_ast_variables(response, json_variables, &variables)) {
+			return;
+		}
+	}
+
+	if (!args->endpoint_count) {
+		ast_ari_response_error(response, 400, "Bad Request",
+			"Endpoint must be specified");
+		goto cleanup;
+	}
+
+	if (args->cps < 0) {
+		ast_ari_response_error(response, 400, "Bad Request",
+			"cps must not be negative");
+		goto cleanup;
+	}
+
+	bulk = ao2_alloc_options(sizeof(*bulk), ari_bulk_origination_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	json = ast_json_array_create();
+	if (!bulk || !json || AST_VECTOR_INIT(&bulk->dials, args->endpoint_count)) {
+		ast_ari_response_alloc_failed(response);
+		goto cleanup;
+	}
+
+	for (i = 0; i < args->endpoint_count; i++) {
+		struct ast_channel_snapshot *snapshot = NULL;
+		struct ast_dial *dial;
+		int res;
+
+		dial = ari_channels_prepare_originate(
+			args->endpoint[i],
+			args->extension,
+			args->context,
+			args->priority,
+			args->label,
+			args->app,
+			args->app_args,
+			args->caller_id,
+			args->timeout,
+			variables,
+			NULL,
+			NULL,
+			args->originator,
+			args->formats,
+			&snapshot,
+			response);
+		if (!dial) {
+			/* The channels created so far are hung up with the dials */
+			goto cleanup;
+		}
+
+		/* The vector was sized up front so this cannot fail */
+		AST_VECTOR_APPEND(&bulk->dials, dial);
+
+		res = ast_json_array_append(json, ast_channel_snapshot_to_json(snapshot, NULL));
+		ao2_cleanup(snapshot);
+		if (res) {
+			ast_ari_response_alloc_failed(response);
+			goto cleanup;
+		}
+	}
+
+	if (ast_dial_batch_start(bulk, AST_VECTOR_SIZE(&bulk->dials), args->cps, ari_bulk_originate_dial)) {
+		ast_ari_response_alloc_failed(response);
+		goto cleanup;
+	}
+
+	ast_ari_response_ok(response, json);
+	json = NULL;
+
+cleanup:
+	ast_json_unref(json);
+	ao2_cleanup(bulk);
+	ast_variables_destroy(variables);
+}
+
 void ast_ari_channels_get_channel_var(struct ast_variable *headers,
 	struct ast_ari_channels_get_channel_var_args *args,
 	struct ast_ari_response *response)
@@ -140,6 +140,60 @@ int ast_ari_channels_create_parse_body(
  * \param[out] response HTTP response
  */
 void ast_ari_channels_create(struct ast_variable *headers, struct ast_ari_channels_create_args *args, struct ast_ari_response *response);
+/*! Argument struct for ast_ari_channels_originate_bulk() */
+struct ast_ari_channels_originate_bulk_args {
+	/*! Array of Endpoints to call. */
+	const char **endpoint;
+	/*! Length of endpoint array. */
+	size_t endpoint_count;
+	/*! Parsing context for endpoint. */
+	char *endpoint_parse;
+	/*! The extension to dial after an endpoint answers. Mutually exclusive with 'app'. */
+	const char *extension;
+	/*! The context to dial after an endpoint answers. If omitted, uses 'default'. Mutually exclusive with 'app'. */
+	const char *context;
+	/*! The priority to dial after an endpoint answers. If omitted, uses 1. Mutually exclusive with 'app'. */
+	long priority;
+	/*! The label to dial after an endpoint answers. Will supersede 'priority' if provided. Mutually exclusive with 'app'. */
+	const char *label;
+	/*! The application that is subscribed to the originated channels. When a channel is answered, it will be passed to this Stasis application. Mutually exclusive with 'context', 'extension', 'priority', and 'label'. */
+	const char *app;
+	/*! The application arguments to pass to the Stasis application provided by 'app'. Mutually exclusive with 'context', 'extension', 'priority', and 'label'. */
+	const char *app_args;
+	/*! CallerID to use when dialing the endpoints or extension. */
+	const char *caller_id;
+	/*! Timeout (in seconds) before giving up dialing an endpoint, or -1 for no timeout. */
+	int timeout;
+	/*! How many endpoints to start dialing a second, or 0 to dial them all at once. */
+	int cps;
+	/*! The "variables" key in the body object holds variable key/value pairs to set on every channel on creation. Other keys in the body object are interpreted as query parameters. Ex. { "endpoint": [ "PJSIP/Alice", "PJSIP/Bob" ], "variables": { "CALLERID(name)": "Campaign" } } */
+	struct ast_json *variables;
+	/*! The unique id of the channel which is originating these. */
+	const char *originator;
+	/*! The format name capability list to use if originator is not specified. Ex. "ulaw,slin16".  Format names can be found with "core show codecs". */
+	const char *formats;
+};
+/*!
+ * \brief Body parsing function for /channels/bulk.
+ * \param body The JSON body from which to parse parameters.
+ * \param[out] args The args structure to parse into.
+ * \retval zero on success
+ * \retval non-zero on failure
+ */
+int ast_ari_channels_originate_bulk_parse_body(
+	struct ast_json *body,
+	struct ast_ari_channels_originate_bulk_args *args);
+
+/*!
+ * \brief Create many new channels (originate).
+ *
+ * A channel is created immediately for every endpoint and snapshots of them returned, in the order the endpoints were given. The endpoints are then dialed, at most cps of them a second. If a Stasis application is provided it will be automatically subscribed to the originated channels for further events and updates.
+ *
+ * \param headers HTTP headers
+ * \param args Swagger parameters
+ * \param[out] response HTTP response
+ */
+void ast_ari_channels_originate_bulk(struct ast_variable *headers, struct ast_ari_channels_originate_bulk_args *args, struct ast_ari_response *response);
 /*! Argument struct for ast_ari_channels_get() */
 struct ast_ari_channels_get_args {
 	/*! Channel's id */
@@ -80,6 +80,7 @@ static void stasis_app_message_handler(
 		void *data, const char *app_name, struct ast_json *message)
 {
 	struct event_session *session = data;
+	struct ast_ari_websocket_session *ws_session = NULL;
 	const char *msg_type, *msg_application;
 	int app_debug_enabled;
 
@@ -132,10 +133,19 @@ static void stasis_app_message_handler(
 		}
 
 		/* We are ready to publish the message */
-		ast_ari_websocket_session_write(session->ws_session, message);
+		ws_session = ao2_bump(session->ws_session);
 	}
 
 	ao2_unlock(session);
+
+	/*
+	 * Written without the session locked so the messages of the other
+	 * applications can queue up on the websocket meanwhile.
+	 */
+	if (ws_session) {
+		ast_ari_websocket_session_write(ws_session, message);
+		ao2_ref(ws_session, -1);
+	}
 }
 
 /*!
@@ -179,7 +179,11 @@ static struct parked_user *generate_parked_user(struct parking_lot *lot, struct
 	}
 
 	/* Insert into the parking lot's parked user list. We can unlock the lot now. */
-	ao2_link(lot->parked_users, new_parked_user);
+	if (parking_lot_link_user(lot, new_parked_user)) {
+		ao2_ref(new_parked_user, -1);
+		ao2_unlock(lot);
+		return NULL;
+	}
 	ao2_unlock(lot);
 
 	return new_parked_user;
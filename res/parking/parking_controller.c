@@ -73,6 +73,11 @@ int parking_channel_set_roles(struct ast_channel *chan, struct parking_lot *lot,
 				return -1;
 			}
 		}
+		if (lot->cfg->parkedmusicshared) {
+			if (ast_channel_set_bridge_role_option(chan, "holding_participant", "moh_shared", "yes")) {
+				return -1;
+			}
+		}
 	}
 
 	return 0;
@@ -85,7 +90,7 @@ struct parking_limits_pvt {
 int unpark_parked_user(struct parked_user *pu)
 {
 	if (pu->lot) {
-		ao2_unlink(pu->lot->parked_users, pu);
+		parking_lot_unlink_user(pu->lot, pu);
 		parking_lot_remove_if_unused(pu->lot);
 		return 0;
 	}
@@ -93,76 +98,166 @@ int unpark_parked_user(struct parked_user *pu)
 	return -1;
 }
 
-int parking_lot_get_space(struct parking_lot *lot, int target_override)
+/*! \brief Spaces in a word of the occupied bitmap */
+#define SPACES_PER_WORD 64
+
+/*! \brief Round a space down to the start of its word of the occupied bitmap */
+static int space_word_start(int space)
 {
-	int original_target;
-	int current_target;
-	struct ao2_iterator i;
-	struct parked_user *user;
-	int wrap;
+	return space - ((space % SPACES_PER_WORD) + SPACES_PER_WORD) % SPACES_PER_WORD;
+}
 
-	if (lot->cfg->parkfindnext) {
-		/* Use next_space if the lot already has next_space set; otherwise use lot start. */
-		original_target = lot->next_space ? lot->next_space : lot->cfg->parking_start;
-	} else {
-		original_target = lot->cfg->parking_start;
+/*!
+ * \internal
+ * \brief Extend the space index of a lot to cover a space and the configured spaces
+ *
+ * \note The parked_users container must be write locked.
+ */
+static int space_index_grow(struct parking_lot *lot, int space)
+{
+	struct parked_user **spaces;
+	uint64_t *occupied;
+	int start = MIN(space, lot->cfg->parking_start);
+	int end = MAX(space, lot->cfg->parking_stop) + 1;
+	int len;
+
+	if (lot->spaces_len) {
+		start = MIN(start, lot->spaces_start);
+		end = MAX(end, lot->spaces_start + lot->spaces_len);
 	}
-
-	if (target_override >= lot->cfg->parking_start && target_override <= lot->cfg->parking_stop) {
-		original_target = target_override;
-	} else if (target_override > -1) {
-		ast_log(LOG_WARNING, "Preferred parking spot %d is out of bounds (%d-%d)\n", target_override, lot->cfg->parking_start, lot->cfg->parking_stop);
+	start = space_word_start(start);
+	len = space_word_start(end + SPACES_PER_WORD - 1) - start;
+
+	spaces = ast_calloc(len, sizeof(*spaces));
+	occupied = ast_calloc(len / SPACES_PER_WORD, sizeof(*occupied));
+	if (!spaces || !occupied) {
+		ast_free(spaces);
+		ast_free(occupied);
+		return -1;
 	}
 
-	current_target = original_target;
+	if (lot->spaces_len) {
+		int offset = lot->spaces_start - start;
 
-	wrap = lot->cfg->parking_start;
+		memcpy(spaces + offset, lot->spaces, lot->spaces_len * sizeof(*spaces));
+		memcpy(occupied + offset / SPACES_PER_WORD, lot->occupied,
+			lot->spaces_len / SPACES_PER_WORD * sizeof(*occupied));
+	}
+	ast_free(lot->spaces);
+	ast_free(lot->occupied);
+	lot->spaces = spaces;
+	lot->occupied = occupied;
+	lot->spaces_start = start;
+	lot->spaces_len = len;
 
-	i = ao2_iterator_init(lot->parked_users, 0);
-	while ((user = ao2_iterator_next(&i))) {
-		/* Increment the wrap on each pass until we find an empty space */
-		if (wrap == user->parking_space) {
-			wrap += 1;
-		}
+	return 0;
+}
 
-		if (user->parking_space < current_target) {
-			/* It's lower than the anticipated target, so we haven't reached the target yet. */
-			ao2_ref(user, -1);
-			continue;
-		}
+static int space_index_covers(struct parking_lot *lot, int space)
+{
+	return space >= lot->spaces_start && space - lot->spaces_start < lot->spaces_len;
+}
 
-		if (user->parking_space > current_target) {
-			/* The current target is usable because all items below have been read and the next target is higher than the one we want. */
-			ao2_ref(user, -1);
-			break;
-		}
+int parking_lot_link_user(struct parking_lot *lot, struct parked_user *user)
+{
+	int index;
 
-		/* We found one already parked here. */
-		current_target += 1;
-		ao2_ref(user, -1);
+	ao2_wrlock(lot->parked_users);
+	if (!space_index_covers(lot, user->parking_space)
+		&& space_index_grow(lot, user->parking_space)) {
+		ao2_unlock(lot->parked_users);
+		return -1;
 	}
-	ao2_iterator_destroy(&i);
+	if (!ao2_link_flags(lot->parked_users, user, OBJ_NOLOCK)) {
+		ao2_unlock(lot->parked_users);
+		return -1;
+	}
+	index = user->parking_space - lot->spaces_start;
+	lot->spaces[index] = user;
+	lot->occupied[index / SPACES_PER_WORD] |= (uint64_t) 1 << (index % SPACES_PER_WORD);
+	ao2_unlock(lot->parked_users);
+
+	return 0;
+}
 
-	if (current_target <= lot->cfg->parking_stop) {
-		return current_target;
+void parking_lot_unlink_user(struct parking_lot *lot, struct parked_user *user)
+{
+	int index;
+
+	ao2_wrlock(lot->parked_users);
+	if (!space_index_covers(lot, user->parking_space)
+		|| lot->spaces[user->parking_space - lot->spaces_start] != user) {
+		/* Already out of the lot */
+		ao2_unlock(lot->parked_users);
+		return;
 	}
+	index = user->parking_space - lot->spaces_start;
+	lot->spaces[index] = NULL;
+	lot->occupied[index / SPACES_PER_WORD] &= ~((uint64_t) 1 << (index % SPACES_PER_WORD));
+	ao2_unlink_flags(lot->parked_users, user, OBJ_NOLOCK);
+	ao2_unlock(lot->parked_users);
+}
+
+/*!
+ * \internal
+ * \brief Find the first space of a range no user is parked in
+ *
+ * \note The parked_users container must be locked.
+ *
+ * \retval -1 if every space of the range is occupied
+ */
+static int find_free_space(struct parking_lot *lot, int from, int to)
+{
+	int space = from;
+
+	while (space <= to) {
+		int index;
+		uint64_t free_spaces;
+
+		if (!space_index_covers(lot, space)) {
+			return space;
+		}
 
-	if (wrap <= lot->cfg->parking_stop) {
-		return wrap;
+		/* The free spaces of the word from this one on */
+		index = space - lot->spaces_start;
+		free_spaces = ~lot->occupied[index / SPACES_PER_WORD] & (~(uint64_t) 0 << (index % SPACES_PER_WORD));
+		if (free_spaces) {
+			space = lot->spaces_start + index - index % SPACES_PER_WORD + __builtin_ctzll(free_spaces);
+			return space <= to ? space : -1;
+		}
+		space = lot->spaces_start + index - index % SPACES_PER_WORD + SPACES_PER_WORD;
 	}
 
 	return -1;
 }
 
-static int retrieve_parked_user_targeted(void *obj, void *arg, int flags)
+int parking_lot_get_space(struct parking_lot *lot, int target_override)
 {
-	int *target = arg;
-	struct parked_user *user = obj;
-	if (user->parking_space == *target) {
-		return CMP_MATCH;
+	int original_target;
+	int space;
+
+	if (lot->cfg->parkfindnext) {
+		/* Use next_space if the lot already has next_space set; otherwise use lot start. */
+		original_target = lot->next_space ? lot->next_space : lot->cfg->parking_start;
+	} else {
+		original_target = lot->cfg->parking_start;
 	}
 
-	return 0;
+	if (target_override >= lot->cfg->parking_start && target_override <= lot->cfg->parking_stop) {
+		original_target = target_override;
+	} else if (target_override > -1) {
+		ast_log(LOG_WARNING, "Preferred parking spot %d is out of bounds (%d-%d)\n", target_override, lot->cfg->parking_start, lot->cfg->parking_stop);
+	}
+
+	/* The first free space from the target, wrapping around to the start of the lot */
+	ao2_rdlock(lot->parked_users);
+	space = find_free_space(lot, original_target, lot->cfg->parking_stop);
+	if (space == -1) {
+		space = find_free_space(lot, lot->cfg->parking_start, lot->cfg->parking_stop);
+	}
+	ao2_unlock(lot->parked_users);
+
+	return space;
 }
 
 struct parked_user *parking_lot_inspect_parked_user(struct parking_lot *lot, int target)
@@ -170,14 +265,12 @@ struct parked_user *parking_lot_inspect_parked_user(struct parking_lot *lot, int
 	struct parked_user *user;
 
 	if (target < 0) {
-		user = ao2_callback(lot->parked_users, 0, NULL, NULL);
-	} else {
-		user = ao2_callback(lot->parked_users, 0, retrieve_parked_user_targeted, &target);
+		return ao2_callback(lot->parked_users, 0, NULL, NULL);
 	}
 
-	if (!user) {
-		return NULL;
-	}
+	ao2_rdlock(lot->parked_users);
+	user = space_index_covers(lot, target) ? ao2_bump(lot->spaces[target - lot->spaces_start]) : NULL;
+	ao2_unlock(lot->parked_users);
 
 	return user;
 }
@@ -186,12 +279,7 @@ struct parked_user *parking_lot_retrieve_parked_user(struct parking_lot *lot, in
 {
 	RAII_VAR(struct parked_user *, user, NULL, ao2_cleanup);
 
-	if (target < 0) {
-		user = ao2_callback(lot->parked_users, 0, NULL, NULL);
-	} else {
-		user = ao2_callback(lot->parked_users, 0, retrieve_parked_user_targeted, &target);
-	}
-
+	user = parking_lot_inspect_parked_user(lot, target);
 	if (!user) {
 		return NULL;
 	}
@@ -203,7 +291,7 @@ struct parked_user *parking_lot_retrieve_parked_user(struct parking_lot *lot, in
 		return NULL;
 	}
 
-	ao2_unlink(lot->parked_users, user);
+	parking_lot_unlink_user(lot, user);
 	user->resolution = PARK_ANSWERED;
 	ao2_unlock(user);
 
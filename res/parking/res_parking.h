@@ -72,6 +72,7 @@ struct parking_lot_cfg {
 	unsigned int parkext_exclusive;           /*!< Analogous to parkext_exclusive config option */
 	unsigned int parkaddhints;                /*!< Analogous to parkaddhints config option */
 	unsigned int comebacktoorigin;            /*!< Analogous to comebacktoorigin config option */
+	unsigned int parkedmusicshared;           /*!< Analogous to parkedmusicshared config option */
 	int parkedplay;                           /*!< Analogous to parkedplay config option */
 	int parkedcalltransfers;                  /*!< Analogous to parkedcalltransfers config option */
 	int parkedcallreparking;                  /*!< Analogous to parkedcallreparking config option */
@@ -93,6 +94,10 @@ struct parking_lot {
 	int next_space;                           /*!< When using parkfindnext, which space we should start searching from next time we park */
 	struct ast_bridge *parking_bridge;        /*!< Bridged where parked calls will rest until they are answered or otherwise leave */
 	struct ao2_container *parked_users;       /*!< List of parked users rigidly ordered by their parking space */
+	struct parked_user **spaces;              /*!< Parked users by space less spaces_start, references held by parked_users */
+	uint64_t *occupied;                       /*!< Bitmap of the spaces with a parked user, indexed as spaces */
+	int spaces_start;                         /*!< First space indexed by spaces and occupied, a multiple of 64 */
+	int spaces_len;                           /*!< How many spaces are indexed, a multiple of 64 */
 	struct parking_lot_cfg *cfg;              /*!< Reference to configuration object for the parking lot */
 	enum parking_lot_modes mode;              /*!< Whether a parking lot is operational, being reconfigured, primed for deletion, or dynamically created. */
 	int disable_mark;                         /*!< On reload, disable this parking lot if it doesn't receive a new configuration. */
@@ -198,6 +203,28 @@ struct ast_bridge *parking_lot_get_bridge(struct parking_lot *lot);
  */
 int parking_lot_get_space(struct parking_lot *lot, int target_override);
 
+/*!
+ * \brief Add a parked user to a parking lot at its parking space
+ *
+ * \param lot Parking lot being added to
+ * \param user The parked user
+ *
+ * \note The lot keeps its parked users both in parked_users and indexed by
+ *       space, these keep them in step.
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+int parking_lot_link_user(struct parking_lot *lot, struct parked_user *user);
+
+/*!
+ * \brief Remove a parked user from a parking lot, if it is still in it
+ *
+ * \param lot Parking lot being removed from
+ * \param user The parked user
+ */
+void parking_lot_unlink_user(struct parking_lot *lot, struct parked_user *user);
+
 /*!
  * \brief Determine if there is a parked user in a parking space and return it if there is.
  *
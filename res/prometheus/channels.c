@@ -121,6 +121,59 @@ static struct prometheus_metric global_channel_metrics[] = {
 	),
 };
 
+/*!
+ * \internal
+ * \brief Output one channel dependent metric for every channel
+ *
+ * Each channel is rendered and flushed as it is reached, so that
+ * systems with many channels neither copy the channel cache nor build
+ * a metric for every channel before any of it can be sent.
+ *
+ * \param channels The channel snapshot cache
+ * \param def The metric to output
+ * \param eid_str The EID label of this Asterisk
+ * \param response The response to populate with formatted metrics
+ */
+static void channels_metric_to_string(struct ao2_container *channels,
+	const struct channel_metric_defs *def, const char *eid_str, struct ast_str **response)
+{
+	struct ao2_iterator it_chans;
+	struct ast_channel_snapshot *snapshot;
+	int first = 1;
+	struct prometheus_metric metric = PROMETHEUS_METRIC_STATIC_INITIALIZATION(
+		PROMETHEUS_METRIC_GAUGE,
+		"",
+		def->help,
+		NULL
+	);
+
+	ast_copy_string(metric.name, def->name, sizeof(metric.name));
+	PROMETHEUS_METRIC_SET_LABEL(&metric, 0, "eid", eid_str);
+
+	it_chans = ao2_iterator_init(channels, 0);
+	for (; (snapshot = ao2_iterator_next(&it_chans)); ao2_ref(snapshot, -1)) {
+		PROMETHEUS_METRIC_SET_LABEL(&metric, 1, "name", (snapshot->base->name));
+		PROMETHEUS_METRIC_SET_LABEL(&metric, 2, "id", (snapshot->base->uniqueid));
+		PROMETHEUS_METRIC_SET_LABEL(&metric, 3, "type", (snapshot->base->type));
+		if (snapshot->peer) {
+			PROMETHEUS_METRIC_SET_LABEL(&metric, 4, "linkedid", (snapshot->peer->linkedid));
+		} else {
+			metric.labels[4].name[0] = '\0';
+		}
+		def->get_value(&metric, snapshot);
+
+		/* Only the first channel is preceded by the help and type of the metric */
+		if (first) {
+			prometheus_metric_to_string(&metric, response);
+			first = 0;
+		} else {
+			prometheus_metric_sample_to_string(&metric, response);
+		}
+		prometheus_callback_output_flush(response);
+	}
+	ao2_iterator_destroy(&it_chans);
+}
+
 /*!
  * \internal
  * \brief Callback invoked when Prometheus scrapes the server
@@ -129,14 +182,10 @@ static struct prometheus_metric global_channel_metrics[] = {
  */
 static void channels_scrape_cb(struct ast_str **response)
 {
-	struct ao2_container *channel_cache;
 	struct ao2_container *channels;
-	struct ao2_iterator it_chans;
-	struct ast_channel_snapshot *snapshot;
-	struct prometheus_metric *channel_metrics;
 	char eid_str[32];
 	int num_channels;
-	int i, j;
+	int i;
 	struct prometheus_metric channel_count = PROMETHEUS_METRIC_STATIC_INITIALIZATION(
 		PROMETHEUS_METRIC_GAUGE,
 		"asterisk_channels_count",
@@ -146,13 +195,7 @@ static void channels_scrape_cb(struct ast_str **response)
 
 	ast_eid_to_str(eid_str, sizeof(eid_str), &ast_eid_default);
 
-	channel_cache = ast_channel_cache_all();
-	if (!channel_cache) {
-		return;
-	}
-
-	channels = ao2_container_clone(channel_cache, 0);
-	ao2_ref(channel_cache, -1);
+	channels = ast_channel_cache_all();
 	if (!channels) {
 		return;
 	}
@@ -171,47 +214,11 @@ static void channels_scrape_cb(struct ast_str **response)
 		prometheus_metric_to_string(&global_channel_metrics[i], response);
 	}
 
-	if (num_channels == 0) {
-		ao2_ref(channels, -1);
-		return;
-	}
-
 	/* Channel dependent values */
-	channel_metrics = ast_calloc(ARRAY_LEN(channel_metric_defs) * num_channels, sizeof(*channel_metrics));
-	if (!channel_metrics) {
-		ao2_ref(channels, -1);
-		return;
-	}
-
-	it_chans = ao2_iterator_init(channels, 0);
-	for (i = 0; (snapshot = ao2_iterator_next(&it_chans)); ao2_ref(snapshot, -1), i++) {
-		for (j = 0; j < ARRAY_LEN(channel_metric_defs); j++) {
-			int index = i * ARRAY_LEN(channel_metric_defs) + j;
-
-			channel_metrics[index].type = PROMETHEUS_METRIC_GAUGE;
-			ast_copy_string(channel_metrics[index].name, channel_metric_defs[j].name, sizeof(channel_metrics[index].name));
-			channel_metrics[index].help = channel_metric_defs[j].help;
-			PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 0, "eid", eid_str);
-			PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 1, "name", (snapshot->base->name));
-			PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 2, "id", (snapshot->base->uniqueid));
-			PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 3, "type", (snapshot->base->type));
-			if (snapshot->peer) {
-				PROMETHEUS_METRIC_SET_LABEL(&channel_metrics[index], 4, "linkedid", (snapshot->peer->linkedid));
-			}
-			channel_metric_defs[j].get_value(&channel_metrics[index], snapshot);
-
-			if (i > 0) {
-				AST_LIST_INSERT_TAIL(&channel_metrics[j].children, &channel_metrics[index], entry);
-			}
-		}
-	}
-	ao2_iterator_destroy(&it_chans);
-
-	for (j = 0; j < ARRAY_LEN(channel_metric_defs); j++) {
-		prometheus_metric_to_string(&channel_metrics[j], response);
+	for (i = 0; i < ARRAY_LEN(channel_metric_defs); i++) {
+		channels_metric_to_string(channels, &channel_metric_defs[i], eid_str, response);
 	}
 
-	ast_free(channel_metrics);
 	ao2_ref(channels, -1);
 }
 
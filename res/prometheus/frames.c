@@ -0,0 +1,180 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Prometheus Frame Cache Metrics
+ */
+
+#include "asterisk.h"
+
+#include <inttypes.h>
+
+#include "asterisk/frame.h"
+#include "asterisk/utils.h"
+#include "asterisk/res_prometheus.h"
+#include "prometheus_internal.h"
+
+#define FRAME_CACHE_HITS_HELP "Number of frame allocations taken from a per-thread frame cache."
+
+#define FRAME_CACHE_MISSES_HELP "Number of frame allocations made because the per-thread frame cache was empty."
+
+#define FRAME_CACHE_OVERFLOWS_HELP "Number of frames freed because the per-thread frame cache was full."
+
+#define FRAME_CACHE_CACHED_HELP "Number of frames currently held by the per-thread frame caches."
+
+/*!
+ * \internal
+ * \brief Helper struct for generating frame cache stats
+ */
+struct frame_cache_metric_defs {
+	/*!
+	 * \brief Type of the metric
+	 */
+	enum prometheus_metric_type type;
+	/*!
+	 * \brief Help text to display
+	 */
+	const char *help;
+	/*!
+	 * \brief Name of the metric
+	 */
+	const char *name;
+	/*!
+	 * \brief Offset of the value in struct ast_frame_cache_class_stats
+	 */
+	size_t offset;
+} frame_cache_metric_defs[] = {
+	{
+		.type = PROMETHEUS_METRIC_COUNTER,
+		.help = FRAME_CACHE_HITS_HELP,
+		.name = "asterisk_frame_cache_hits",
+		.offset = offsetof(struct ast_frame_cache_class_stats, hits),
+	},
+	{
+		.type = PROMETHEUS_METRIC_COUNTER,
+		.help = FRAME_CACHE_MISSES_HELP,
+		.name = "asterisk_frame_cache_misses",
+		.offset = offsetof(struct ast_frame_cache_class_stats, misses),
+	},
+	{
+		.type = PROMETHEUS_METRIC_COUNTER,
+		.help = FRAME_CACHE_OVERFLOWS_HELP,
+		.name = "asterisk_frame_cache_overflows",
+		.offset = offsetof(struct ast_frame_cache_class_stats, overflows),
+	},
+	{
+		.type = PROMETHEUS_METRIC_GAUGE,
+		.help = FRAME_CACHE_CACHED_HELP,
+		.name = "asterisk_frame_cache_cached",
+		.offset = offsetof(struct ast_frame_cache_class_stats, cached),
+	},
+};
+
+/*! \brief Number of metrics generated for each metric definition */
+#define FRAME_CACHE_METRIC_CHILDREN (AST_FRAME_CACHE_CLASSES * 2)
+
+/*!
+ * \internal
+ * \brief Callback invoked when Prometheus scrapes the server
+ *
+ * \param response The response to populate with formatted metrics
+ */
+static void frames_scrape_cb(struct ast_str **response)
+{
+	struct ast_frame_cache_stats stats;
+	struct prometheus_metric *metrics;
+	char eid_str[32];
+	char size[16];
+	int i, j;
+	struct prometheus_metric thread_count = PROMETHEUS_METRIC_STATIC_INITIALIZATION(
+		PROMETHEUS_METRIC_GAUGE,
+		"asterisk_frame_cache_threads",
+		"Number of threads with a frame cache.",
+		NULL
+	);
+
+	ast_eid_to_str(eid_str, sizeof(eid_str), &ast_eid_default);
+	ast_frame_cache_stats_get(&stats);
+
+	PROMETHEUS_METRIC_SET_LABEL(&thread_count, 0, "eid", eid_str);
+	snprintf(thread_count.value, sizeof(thread_count.value), "%u", stats.threads);
+	prometheus_metric_to_string(&thread_count, response);
+
+	metrics = ast_calloc(ARRAY_LEN(frame_cache_metric_defs) * FRAME_CACHE_METRIC_CHILDREN,
+		sizeof(*metrics));
+	if (!metrics) {
+		return;
+	}
+
+	for (j = 0; j < ARRAY_LEN(frame_cache_metric_defs); j++) {
+		struct prometheus_metric *parent = &metrics[j * FRAME_CACHE_METRIC_CHILDREN];
+
+		for (i = 0; i < FRAME_CACHE_METRIC_CHILDREN; i++) {
+			struct prometheus_metric *metric = &parent[i];
+			const struct ast_frame_cache_class_stats *class_stats = i < AST_FRAME_CACHE_CLASSES
+				? &stats.frames[i] : &stats.data[i - AST_FRAME_CACHE_CLASSES];
+
+			metric->type = frame_cache_metric_defs[j].type;
+			ast_copy_string(metric->name, frame_cache_metric_defs[j].name, sizeof(metric->name));
+			metric->help = frame_cache_metric_defs[j].help;
+			snprintf(size, sizeof(size), "%zu", class_stats->size);
+			PROMETHEUS_METRIC_SET_LABEL(metric, 0, "eid", eid_str);
+			PROMETHEUS_METRIC_SET_LABEL(metric, 1, "cache", i < AST_FRAME_CACHE_CLASSES ? "frames" : "data");
+			PROMETHEUS_METRIC_SET_LABEL(metric, 2, "size", size);
+			snprintf(metric->value, sizeof(metric->value), "%" PRIu64,
+				*(const uint64_t *) ((const char *) class_stats + frame_cache_metric_defs[j].offset));
+
+			if (i) {
+				AST_LIST_INSERT_TAIL(&parent->children, metric, entry);
+			}
+		}
+		prometheus_metric_to_string(parent, response);
+	}
+
+	ast_free(metrics);
+}
+
+struct prometheus_callback frames_callback = {
+	.name = "frames callback",
+	.callback_fn = frames_scrape_cb,
+};
+
+/*!
+ * \internal
+ * \brief Callback invoked when the core module is unloaded
+ */
+static void frame_metrics_unload_cb(void)
+{
+	prometheus_callback_unregister(&frames_callback);
+}
+
+/*!
+ * \internal
+ * \brief Metrics provider definition
+ */
+static struct prometheus_metrics_provider provider = {
+	.name = "frames",
+	.unload_cb = frame_metrics_unload_cb,
+};
+
+int frame_metrics_init(void)
+{
+	prometheus_metrics_provider_register(&provider);
+	prometheus_callback_register(&frames_callback);
+
+	return 0;
+}
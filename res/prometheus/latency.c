@@ -0,0 +1,141 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Prometheus Latency Histogram Metrics
+ */
+
+#include "asterisk.h"
+
+#include "asterisk/latency.h"
+#include "asterisk/utils.h"
+#include "asterisk/res_prometheus.h"
+#include "prometheus_internal.h"
+
+#define LATENCY_HELP "Internal latencies, in seconds. Only recorded when latency_histograms is enabled in asterisk.conf."
+
+/*! \brief The upper bounds of the buckets exported, in seconds */
+static const double latency_bounds[] = {
+	0.000001, 0.000005, 0.00001, 0.00005, 0.0001, 0.0005,
+	0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1,
+};
+
+/*! \brief What is needed to render each latency histogram */
+struct latency_scrape {
+	struct ast_str **response;
+	const char *eid_str;
+	int first;
+};
+
+/*!
+ * \internal
+ * \brief Render a latency histogram as a Prometheus histogram
+ *
+ * The fine grained buckets of the latency histogram are summed into the
+ * buckets of latency_bounds.
+ */
+static void latency_to_string(const struct ast_latency_snapshot *snapshot, void *data)
+{
+	struct latency_scrape *scrape = data;
+	uint64_t counts[ARRAY_LEN(latency_bounds) + 1];
+	uint64_t below = 0;
+	int i;
+	struct prometheus_histogram histogram = {
+		.bucket_count = ARRAY_LEN(latency_bounds),
+		.bounds = latency_bounds,
+		.counts = counts,
+		.sum = snapshot->sum / 1000000000.0,
+	};
+	struct prometheus_metric metric = {
+		.type = PROMETHEUS_METRIC_HISTOGRAM,
+		.allocation_strategy = PROMETHEUS_METRIC_ALLOCD,
+		.lock = AST_MUTEX_INIT_VALUE,
+		.name = "asterisk_latency_seconds",
+		.help = LATENCY_HELP,
+		.histogram = &histogram,
+		.children = AST_LIST_HEAD_NOLOCK_INIT_VALUE,
+	};
+
+	for (i = 0; i < ARRAY_LEN(latency_bounds); i++) {
+		uint64_t count = ast_latency_snapshot_count_le(snapshot, latency_bounds[i] * 1000000000.0);
+
+		counts[i] = count - below;
+		below = count;
+	}
+	counts[i] = snapshot->count - below;
+
+	PROMETHEUS_METRIC_SET_LABEL(&metric, 0, "eid", scrape->eid_str);
+	PROMETHEUS_METRIC_SET_LABEL(&metric, 1, "histogram", snapshot->name);
+
+	/* Only the first histogram is preceded by the help and type of the metric */
+	if (scrape->first) {
+		prometheus_metric_to_string(&metric, scrape->response);
+		scrape->first = 0;
+	} else {
+		prometheus_metric_sample_to_string(&metric, scrape->response);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Callback invoked when Prometheus scrapes the server
+ *
+ * \param response The response to populate with formatted metrics
+ */
+static void latency_scrape_cb(struct ast_str **response)
+{
+	char eid_str[32];
+	struct latency_scrape scrape = {
+		.response = response,
+		.eid_str = eid_str,
+		.first = 1,
+	};
+
+	ast_eid_to_str(eid_str, sizeof(eid_str), &ast_eid_default);
+	ast_latency_histograms_snapshot(latency_to_string, &scrape);
+}
+
+struct prometheus_callback latency_callback = {
+	.name = "latency callback",
+	.callback_fn = latency_scrape_cb,
+};
+
+/*!
+ * \internal
+ * \brief Callback invoked when the core module is unloaded
+ */
+static void latency_metrics_unload_cb(void)
+{
+	prometheus_callback_unregister(&latency_callback);
+}
+
+/*!
+ * \internal
+ * \brief Metrics provider definition
+ */
+static struct prometheus_metrics_provider provider = {
+	.name = "latency",
+	.unload_cb = latency_metrics_unload_cb,
+};
+
+int latency_metrics_init(void)
+{
+	prometheus_metrics_provider_register(&provider);
+	prometheus_callback_register(&latency_callback);
+
+	return 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Prometheus Lock Contention Metrics
+ */
+
+#include "asterisk.h"
+
+#include <inttypes.h>
+
+#include "asterisk/lock.h"
+#include "asterisk/utils.h"
+#include "asterisk/res_prometheus.h"
+#include "prometheus_internal.h"
+
+/*! \brief Only the places locks were waited for longest in total are exported */
+#define LOCK_CONTENTION_EXPORTED 50
+
+#define LOCK_CONTENTION_COUNT_HELP "Number of times the lock was waited for at least lock_contention_threshold at this place."
+
+#define LOCK_CONTENTION_SECONDS_HELP "Total time the lock was waited for at this place, in seconds."
+
+#define LOCK_CONTENTION_MAX_HELP "Longest time the lock was waited for at this place, in seconds."
+
+/*!
+ * \internal
+ * \brief Format a number of nanoseconds as seconds
+ */
+static void format_seconds(char *buf, size_t size, uint64_t ns)
+{
+	snprintf(buf, size, "%" PRIu64 ".%09" PRIu64, ns / 1000000000, ns % 1000000000);
+}
+
+static void get_count(struct prometheus_metric *metric, const struct ast_lock_contention *contention)
+{
+	snprintf(metric->value, sizeof(metric->value), "%" PRIu64, contention->count);
+}
+
+static void get_total(struct prometheus_metric *metric, const struct ast_lock_contention *contention)
+{
+	format_seconds(metric->value, sizeof(metric->value), contention->total);
+}
+
+static void get_max(struct prometheus_metric *metric, const struct ast_lock_contention *contention)
+{
+	format_seconds(metric->value, sizeof(metric->value), contention->max);
+}
+
+/*!
+ * \internal
+ * \brief Helper struct for generating individual lock contention stats
+ */
+struct lock_metric_defs {
+	/*!
+	 * \brief Type of the metric
+	 */
+	enum prometheus_metric_type type;
+	/*!
+	 * \brief Help text to display
+	 */
+	const char *help;
+	/*!
+	 * \brief Name of the metric
+	 */
+	const char *name;
+	/*!
+	 * \brief Callback function to generate a metric value for a given place
+	 */
+	void (* const get_value)(struct prometheus_metric *metric, const struct ast_lock_contention *contention);
+} lock_metric_defs[] = {
+	{
+		.type = PROMETHEUS_METRIC_COUNTER,
+		.help = LOCK_CONTENTION_COUNT_HELP,
+		.name = "asterisk_lock_contention_count",
+		.get_value = get_count,
+	},
+	{
+		.type = PROMETHEUS_METRIC_COUNTER,
+		.help = LOCK_CONTENTION_SECONDS_HELP,
+		.name = "asterisk_lock_contention_seconds_total",
+		.get_value = get_total,
+	},
+	{
+		.type = PROMETHEUS_METRIC_GAUGE,
+		.help = LOCK_CONTENTION_MAX_HELP,
+		.name = "asterisk_lock_contention_max_seconds",
+		.get_value = get_max,
+	},
+};
+
+/*! \brief What is needed to render a metric for each place */
+struct lock_scrape {
+	struct ast_str **response;
+	const struct lock_metric_defs *def;
+	struct prometheus_metric metric;
+	int exported;
+};
+
+static void lock_contention_to_string(const struct ast_lock_contention *contention, void *data)
+{
+	struct lock_scrape *scrape = data;
+	char line[16];
+
+	if (scrape->exported == LOCK_CONTENTION_EXPORTED) {
+		return;
+	}
+
+	snprintf(line, sizeof(line), "%d", contention->line);
+	PROMETHEUS_METRIC_SET_LABEL(&scrape->metric, 1, "file", contention->file);
+	PROMETHEUS_METRIC_SET_LABEL(&scrape->metric, 2, "line", line);
+	PROMETHEUS_METRIC_SET_LABEL(&scrape->metric, 3, "func", contention->func);
+	PROMETHEUS_METRIC_SET_LABEL(&scrape->metric, 4, "name", contention->name);
+	scrape->def->get_value(&scrape->metric, contention);
+
+	/* Only the first place is preceded by the help and type of the metric */
+	if (!scrape->exported++) {
+		prometheus_metric_to_string(&scrape->metric, scrape->response);
+	} else {
+		prometheus_metric_sample_to_string(&scrape->metric, scrape->response);
+	}
+	prometheus_callback_output_flush(scrape->response);
+}
+
+/*!
+ * \internal
+ * \brief Callback invoked when Prometheus scrapes the server
+ *
+ * \param response The response to populate with formatted metrics
+ */
+static void locks_scrape_cb(struct ast_str **response)
+{
+	char eid_str[32];
+	int i;
+
+	if (!ast_lock_contention_threshold) {
+		return;
+	}
+
+	ast_eid_to_str(eid_str, sizeof(eid_str), &ast_eid_default);
+
+	for (i = 0; i < ARRAY_LEN(lock_metric_defs); i++) {
+		struct lock_scrape scrape = {
+			.response = response,
+			.def = &lock_metric_defs[i],
+			.metric = PROMETHEUS_METRIC_STATIC_INITIALIZATION(
+				lock_metric_defs[i].type,
+				"",
+				lock_metric_defs[i].help,
+				NULL),
+		};
+
+		ast_copy_string(scrape.metric.name, lock_metric_defs[i].name, sizeof(scrape.metric.name));
+		PROMETHEUS_METRIC_SET_LABEL(&scrape.metric, 0, "eid", eid_str);
+		ast_lock_contention_foreach(lock_contention_to_string, &scrape);
+	}
+}
+
+struct prometheus_callback locks_callback = {
+	.name = "locks callback",
+	.callback_fn = locks_scrape_cb,
+};
+
+/*!
+ * \internal
+ * \brief Callback invoked when the core module is unloaded
+ */
+static void lock_metrics_unload_cb(void)
+{
+	prometheus_callback_unregister(&locks_callback);
+}
+
+/*!
+ * \internal
+ * \brief Metrics provider definition
+ */
+static struct prometheus_metrics_provider provider = {
+	.name = "locks",
+	.unload_cb = lock_metrics_unload_cb,
+};
+
+int lock_metrics_init(void)
+{
+	prometheus_metrics_provider_register(&provider);
+	prometheus_callback_register(&locks_callback);
+
+	return 0;
+}
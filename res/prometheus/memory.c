@@ -0,0 +1,167 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Prometheus Memory Accounting Metrics
+ */
+
+#include "asterisk.h"
+
+#include <inttypes.h>
+
+#include "asterisk/utils.h"
+#include "asterisk/res_prometheus.h"
+#include "prometheus_internal.h"
+
+/*! \brief Only the source files with the most bytes allocated are exported */
+#define MEMORY_ACCOUNT_EXPORTED 100
+
+#define MEMORY_ALLOCATIONS_HELP "Number of memory allocations outstanding made from this source file."
+
+#define MEMORY_BYTES_HELP "Number of bytes outstanding allocated from this source file."
+
+static void get_allocations(struct prometheus_metric *metric, const struct ast_mm_account *account)
+{
+	snprintf(metric->value, sizeof(metric->value), "%" PRId64, account->allocations);
+}
+
+static void get_bytes(struct prometheus_metric *metric, const struct ast_mm_account *account)
+{
+	snprintf(metric->value, sizeof(metric->value), "%" PRId64, account->bytes);
+}
+
+/*!
+ * \internal
+ * \brief Helper struct for generating individual memory accounting stats
+ */
+struct memory_metric_defs {
+	/*!
+	 * \brief Help text to display
+	 */
+	const char *help;
+	/*!
+	 * \brief Name of the metric
+	 */
+	const char *name;
+	/*!
+	 * \brief Callback function to generate a metric value for a given source file
+	 */
+	void (* const get_value)(struct prometheus_metric *metric, const struct ast_mm_account *account);
+} memory_metric_defs[] = {
+	{
+		.help = MEMORY_ALLOCATIONS_HELP,
+		.name = "asterisk_memory_allocations",
+		.get_value = get_allocations,
+	},
+	{
+		.help = MEMORY_BYTES_HELP,
+		.name = "asterisk_memory_bytes",
+		.get_value = get_bytes,
+	},
+};
+
+/*! \brief What is needed to render a metric for each source file */
+struct memory_scrape {
+	struct ast_str **response;
+	const struct memory_metric_defs *def;
+	struct prometheus_metric metric;
+	int exported;
+};
+
+static void memory_account_to_string(const struct ast_mm_account *account, void *data)
+{
+	struct memory_scrape *scrape = data;
+
+	if (scrape->exported == MEMORY_ACCOUNT_EXPORTED) {
+		return;
+	}
+
+	PROMETHEUS_METRIC_SET_LABEL(&scrape->metric, 1, "file", account->file);
+	scrape->def->get_value(&scrape->metric, account);
+
+	/* Only the first file is preceded by the help and type of the metric */
+	if (!scrape->exported++) {
+		prometheus_metric_to_string(&scrape->metric, scrape->response);
+	} else {
+		prometheus_metric_sample_to_string(&scrape->metric, scrape->response);
+	}
+	prometheus_callback_output_flush(scrape->response);
+}
+
+/*!
+ * \internal
+ * \brief Callback invoked when Prometheus scrapes the server
+ *
+ * \param response The response to populate with formatted metrics
+ */
+static void memory_scrape_cb(struct ast_str **response)
+{
+	char eid_str[32];
+	int i;
+
+	ast_eid_to_str(eid_str, sizeof(eid_str), &ast_eid_default);
+
+	for (i = 0; i < ARRAY_LEN(memory_metric_defs); i++) {
+		struct memory_scrape scrape = {
+			.response = response,
+			.def = &memory_metric_defs[i],
+			.metric = PROMETHEUS_METRIC_STATIC_INITIALIZATION(
+				PROMETHEUS_METRIC_GAUGE,
+				"",
+				memory_metric_defs[i].help,
+				NULL),
+		};
+
+		ast_copy_string(scrape.metric.name, memory_metric_defs[i].name, sizeof(scrape.metric.name));
+		PROMETHEUS_METRIC_SET_LABEL(&scrape.metric, 0, "eid", eid_str);
+		if (ast_mm_accounting_foreach(memory_account_to_string, &scrape) < 0) {
+			/* Not built with MALLOC_ACCOUNTING */
+			return;
+		}
+	}
+}
+
+struct prometheus_callback memory_callback = {
+	.name = "memory callback",
+	.callback_fn = memory_scrape_cb,
+};
+
+/*!
+ * \internal
+ * \brief Callback invoked when the core module is unloaded
+ */
+static void memory_metrics_unload_cb(void)
+{
+	prometheus_callback_unregister(&memory_callback);
+}
+
+/*!
+ * \internal
+ * \brief Metrics provider definition
+ */
+static struct prometheus_metrics_provider provider = {
+	.name = "memory",
+	.unload_cb = memory_metrics_unload_cb,
+};
+
+int memory_metrics_init(void)
+{
+	prometheus_metrics_provider_register(&provider);
+	prometheus_callback_register(&memory_callback);
+
+	return 0;
+}
@@ -91,6 +91,54 @@ int endpoint_metrics_init(void);
  */
 int bridge_metrics_init(void);
 
+/*!
+ * \brief Initialize frame cache metrics
+ *
+ * \retval 0 success
+ * \retval -1 error
+ */
+int frame_metrics_init(void);
+
+/*!
+ * \brief Initialize latency histogram metrics
+ *
+ * \retval 0 success
+ * \retval -1 error
+ */
+int latency_metrics_init(void);
+
+/*!
+ * \brief Initialize taskprocessor metrics
+ *
+ * \retval 0 success
+ * \retval -1 error
+ */
+int taskprocessor_metrics_init(void);
+
+/*!
+ * \brief Initialize lock contention metrics
+ *
+ * \retval 0 success
+ * \retval -1 error
+ */
+int lock_metrics_init(void);
+
+/*!
+ * \brief Initialize memory accounting metrics
+ *
+ * \retval 0 success
+ * \retval -1 error
+ */
+int memory_metrics_init(void);
+
+/*!
+ * \brief Initialize RTP metrics
+ *
+ * \retval 0 success
+ * \retval -1 error
+ */
+int rtp_metrics_init(void);
+
 /*!
  * \brief Initialize PJSIP outbound registration metrics
  *
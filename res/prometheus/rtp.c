@@ -0,0 +1,262 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Prometheus RTP Metrics
+ */
+
+#include "asterisk.h"
+
+#include "asterisk/rtp_engine.h"
+#include "asterisk/vector.h"
+#include "asterisk/res_prometheus.h"
+#include "prometheus_internal.h"
+
+#define RTP_RX_PACKETS_HELP "Number of RTP packets received by an RTP instance."
+
+#define RTP_TX_PACKETS_HELP "Number of RTP packets sent by an RTP instance."
+
+#define RTP_RX_OCTETS_HELP "Number of RTP payload octets received by an RTP instance."
+
+#define RTP_TX_OCTETS_HELP "Number of RTP payload octets sent by an RTP instance."
+
+#define RTP_RX_LOST_HELP "Number of RTP packets lost on the way to an RTP instance."
+
+#define RTP_TX_LOST_HELP "Number of RTP packets sent by an RTP instance that the remote side reported lost."
+
+#define RTP_RX_JITTER_HELP "Jitter of the RTP packets received by an RTP instance (in seconds)."
+
+#define RTP_TX_JITTER_HELP "Jitter of the RTP packets sent by an RTP instance as reported by the remote side (in seconds)."
+
+#define RTP_RTT_HELP "Round trip time to the remote side of an RTP instance (in seconds)."
+
+#define RTP_RX_MES_HELP "Media experience score of the RTP packets received by an RTP instance."
+
+/*!
+ * \internal
+ * \brief Helper struct for generating RTP instance stats
+ */
+struct rtp_metric_defs {
+	/*!
+	 * \brief Type of the metric
+	 */
+	enum prometheus_metric_type type;
+	/*!
+	 * \brief Help text to display
+	 */
+	const char *help;
+	/*!
+	 * \brief Name of the metric
+	 */
+	const char *name;
+	/*!
+	 * \brief Offset of the value in struct ast_rtp_instance_stats
+	 */
+	size_t offset;
+	/*!
+	 * \brief Whether the value is a double rather than an unsigned int
+	 */
+	int is_double;
+} rtp_metric_defs[] = {
+	{
+		.type = PROMETHEUS_METRIC_COUNTER,
+		.help = RTP_RX_PACKETS_HELP,
+		.name = "asterisk_rtp_rx_packets",
+		.offset = offsetof(struct ast_rtp_instance_stats, rxcount),
+	},
+	{
+		.type = PROMETHEUS_METRIC_COUNTER,
+		.help = RTP_TX_PACKETS_HELP,
+		.name = "asterisk_rtp_tx_packets",
+		.offset = offsetof(struct ast_rtp_instance_stats, txcount),
+	},
+	{
+		.type = PROMETHEUS_METRIC_COUNTER,
+		.help = RTP_RX_OCTETS_HELP,
+		.name = "asterisk_rtp_rx_octets",
+		.offset = offsetof(struct ast_rtp_instance_stats, rxoctetcount),
+	},
+	{
+		.type = PROMETHEUS_METRIC_COUNTER,
+		.help = RTP_TX_OCTETS_HELP,
+		.name = "asterisk_rtp_tx_octets",
+		.offset = offsetof(struct ast_rtp_instance_stats, txoctetcount),
+	},
+	{
+		.type = PROMETHEUS_METRIC_GAUGE,
+		.help = RTP_RX_LOST_HELP,
+		.name = "asterisk_rtp_rx_lost_packets",
+		.offset = offsetof(struct ast_rtp_instance_stats, rxploss),
+	},
+	{
+		.type = PROMETHEUS_METRIC_GAUGE,
+		.help = RTP_TX_LOST_HELP,
+		.name = "asterisk_rtp_tx_lost_packets",
+		.offset = offsetof(struct ast_rtp_instance_stats, txploss),
+	},
+	{
+		.type = PROMETHEUS_METRIC_GAUGE,
+		.help = RTP_RX_JITTER_HELP,
+		.name = "asterisk_rtp_rx_jitter_seconds",
+		.offset = offsetof(struct ast_rtp_instance_stats, rxjitter),
+		.is_double = 1,
+	},
+	{
+		.type = PROMETHEUS_METRIC_GAUGE,
+		.help = RTP_TX_JITTER_HELP,
+		.name = "asterisk_rtp_tx_jitter_seconds",
+		.offset = offsetof(struct ast_rtp_instance_stats, txjitter),
+		.is_double = 1,
+	},
+	{
+		.type = PROMETHEUS_METRIC_GAUGE,
+		.help = RTP_RTT_HELP,
+		.name = "asterisk_rtp_rtt_seconds",
+		.offset = offsetof(struct ast_rtp_instance_stats, rtt),
+		.is_double = 1,
+	},
+	{
+		.type = PROMETHEUS_METRIC_GAUGE,
+		.help = RTP_RX_MES_HELP,
+		.name = "asterisk_rtp_rx_mes",
+		.offset = offsetof(struct ast_rtp_instance_stats, rxmes),
+		.is_double = 1,
+	},
+};
+
+/*! \brief Statistics of every RTP instance, as sampled for a scrape */
+AST_VECTOR(rtp_samples, struct ast_rtp_instance_stats);
+
+/*!
+ * \internal
+ * \brief Collect the statistics of an RTP instance
+ */
+static int rtp_sample_cb(struct ast_rtp_instance *instance,
+	const struct ast_rtp_instance_stats *stats, void *data)
+{
+	struct rtp_samples *samples = data;
+
+	/* Running out of memory only leaves the remaining instances out */
+	return AST_VECTOR_APPEND(samples, *stats);
+}
+
+/*!
+ * \internal
+ * \brief Callback invoked when Prometheus scrapes the server
+ *
+ * \param response The response to populate with formatted metrics
+ */
+static void rtp_scrape_cb(struct ast_str **response)
+{
+	struct rtp_samples samples;
+	struct prometheus_metric *metrics;
+	char eid_str[32];
+	char ssrc[16];
+	size_t i, j;
+	struct prometheus_metric instance_count = PROMETHEUS_METRIC_STATIC_INITIALIZATION(
+		PROMETHEUS_METRIC_GAUGE,
+		"asterisk_rtp_instances_count",
+		"Current count of RTP instances with statistics.",
+		NULL
+	);
+
+	ast_eid_to_str(eid_str, sizeof(eid_str), &ast_eid_default);
+
+	if (AST_VECTOR_INIT(&samples, 64)) {
+		return;
+	}
+	ast_rtp_instance_sample_stats_all(rtp_sample_cb, &samples);
+
+	PROMETHEUS_METRIC_SET_LABEL(&instance_count, 0, "eid", eid_str);
+	snprintf(instance_count.value, sizeof(instance_count.value), "%zu", AST_VECTOR_SIZE(&samples));
+	prometheus_metric_to_string(&instance_count, response);
+
+	if (!AST_VECTOR_SIZE(&samples)) {
+		AST_VECTOR_FREE(&samples);
+		return;
+	}
+
+	metrics = ast_calloc(ARRAY_LEN(rtp_metric_defs) * AST_VECTOR_SIZE(&samples), sizeof(*metrics));
+	if (!metrics) {
+		AST_VECTOR_FREE(&samples);
+		return;
+	}
+
+	for (i = 0; i < AST_VECTOR_SIZE(&samples); i++) {
+		const struct ast_rtp_instance_stats *stats = AST_VECTOR_GET_ADDR(&samples, i);
+
+		snprintf(ssrc, sizeof(ssrc), "%u", stats->local_ssrc);
+		for (j = 0; j < ARRAY_LEN(rtp_metric_defs); j++) {
+			struct prometheus_metric *metric = &metrics[i * ARRAY_LEN(rtp_metric_defs) + j];
+			const void *value = (const char *) stats + rtp_metric_defs[j].offset;
+
+			metric->type = rtp_metric_defs[j].type;
+			ast_copy_string(metric->name, rtp_metric_defs[j].name, sizeof(metric->name));
+			metric->help = rtp_metric_defs[j].help;
+			PROMETHEUS_METRIC_SET_LABEL(metric, 0, "eid", eid_str);
+			PROMETHEUS_METRIC_SET_LABEL(metric, 1, "ssrc", ssrc);
+			PROMETHEUS_METRIC_SET_LABEL(metric, 2, "channel_id", stats->channel_uniqueid);
+			if (rtp_metric_defs[j].is_double) {
+				snprintf(metric->value, sizeof(metric->value), "%f", *(const double *) value);
+			} else {
+				snprintf(metric->value, sizeof(metric->value), "%u", *(const unsigned int *) value);
+			}
+
+			if (i > 0) {
+				AST_LIST_INSERT_TAIL(&metrics[j].children, metric, entry);
+			}
+		}
+	}
+
+	for (j = 0; j < ARRAY_LEN(rtp_metric_defs); j++) {
+		prometheus_metric_to_string(&metrics[j], response);
+	}
+
+	ast_free(metrics);
+	AST_VECTOR_FREE(&samples);
+}
+
+struct prometheus_callback rtp_callback = {
+	.name = "RTP callback",
+	.callback_fn = rtp_scrape_cb,
+};
+
+/*!
+ * \internal
+ * \brief Callback invoked when the core module is unloaded
+ */
+static void rtp_metrics_unload_cb(void)
+{
+	prometheus_callback_unregister(&rtp_callback);
+}
+
+/*!
+ * \internal
+ * \brief Metrics provider definition
+ */
+static struct prometheus_metrics_provider provider = {
+	.name = "rtp",
+	.unload_cb = rtp_metrics_unload_cb,
+};
+
+int rtp_metrics_init(void)
+{
+	prometheus_metrics_provider_register(&provider);
+	prometheus_callback_register(&rtp_callback);
+
+	return 0;
+}
@@ -0,0 +1,227 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Prometheus Taskprocessor Metrics
+ */
+
+#include "asterisk.h"
+
+#include <inttypes.h>
+
+#include "asterisk/taskprocessor.h"
+#include "asterisk/utils.h"
+#include "asterisk/res_prometheus.h"
+#include "prometheus_internal.h"
+
+#define TASKPROCESSORS_PROCESSED_HELP "Number of tasks executed by the taskprocessor."
+
+#define TASKPROCESSORS_QUEUED_HELP "Number of tasks queued on the taskprocessor."
+
+#define TASKPROCESSORS_MAX_DEPTH_HELP "Most tasks queued on the taskprocessor at once."
+
+#define TASKPROCESSORS_WAIT_HELP "Moving average of the time tasks waited in the queue of the taskprocessor, in seconds."
+
+#define TASKPROCESSORS_EXEC_HELP "Moving average of the time tasks of the taskprocessor took to execute, in seconds."
+
+#define TASKPROCESSORS_SLOWEST_HELP "Longest time a task of the taskprocessor recently took to execute, in seconds."
+
+/*!
+ * \internal
+ * \brief Format a number of nanoseconds as seconds
+ */
+static void format_seconds(char *buf, size_t size, uint64_t ns)
+{
+	snprintf(buf, size, "%" PRIu64 ".%09" PRIu64, ns / 1000000000, ns % 1000000000);
+}
+
+static void get_processed(struct prometheus_metric *metric, const struct ast_taskprocessor_stats *stats)
+{
+	snprintf(metric->value, sizeof(metric->value), "%lu", stats->processed);
+}
+
+static void get_queued(struct prometheus_metric *metric, const struct ast_taskprocessor_stats *stats)
+{
+	snprintf(metric->value, sizeof(metric->value), "%ld", stats->queued);
+}
+
+static void get_max_depth(struct prometheus_metric *metric, const struct ast_taskprocessor_stats *stats)
+{
+	snprintf(metric->value, sizeof(metric->value), "%lu", stats->max_depth);
+}
+
+static void get_wait(struct prometheus_metric *metric, const struct ast_taskprocessor_stats *stats)
+{
+	format_seconds(metric->value, sizeof(metric->value), stats->wait_avg);
+}
+
+static void get_exec(struct prometheus_metric *metric, const struct ast_taskprocessor_stats *stats)
+{
+	format_seconds(metric->value, sizeof(metric->value), stats->exec_avg);
+}
+
+static void get_slowest(struct prometheus_metric *metric, const struct ast_taskprocessor_stats *stats)
+{
+	format_seconds(metric->value, sizeof(metric->value), stats->slowest);
+}
+
+/*!
+ * \internal
+ * \brief Helper struct for generating individual taskprocessor stats
+ */
+struct taskprocessor_metric_defs {
+	/*!
+	 * \brief Type of the metric
+	 */
+	enum prometheus_metric_type type;
+	/*!
+	 * \brief Help text to display
+	 */
+	const char *help;
+	/*!
+	 * \brief Name of the metric
+	 */
+	const char *name;
+	/*!
+	 * \brief Callback function to generate a metric value for a given taskprocessor
+	 */
+	void (* const get_value)(struct prometheus_metric *metric, const struct ast_taskprocessor_stats *stats);
+} taskprocessor_metric_defs[] = {
+	{
+		.type = PROMETHEUS_METRIC_COUNTER,
+		.help = TASKPROCESSORS_PROCESSED_HELP,
+		.name = "asterisk_taskprocessors_processed",
+		.get_value = get_processed,
+	},
+	{
+		.type = PROMETHEUS_METRIC_GAUGE,
+		.help = TASKPROCESSORS_QUEUED_HELP,
+		.name = "asterisk_taskprocessors_queued",
+		.get_value = get_queued,
+	},
+	{
+		.type = PROMETHEUS_METRIC_GAUGE,
+		.help = TASKPROCESSORS_MAX_DEPTH_HELP,
+		.name = "asterisk_taskprocessors_max_depth",
+		.get_value = get_max_depth,
+	},
+	{
+		.type = PROMETHEUS_METRIC_GAUGE,
+		.help = TASKPROCESSORS_WAIT_HELP,
+		.name = "asterisk_taskprocessors_wait_seconds",
+		.get_value = get_wait,
+	},
+	{
+		.type = PROMETHEUS_METRIC_GAUGE,
+		.help = TASKPROCESSORS_EXEC_HELP,
+		.name = "asterisk_taskprocessors_exec_seconds",
+		.get_value = get_exec,
+	},
+	{
+		.type = PROMETHEUS_METRIC_GAUGE,
+		.help = TASKPROCESSORS_SLOWEST_HELP,
+		.name = "asterisk_taskprocessors_slowest_seconds",
+		.get_value = get_slowest,
+	},
+};
+
+/*! \brief What is needed to render a metric for each taskprocessor */
+struct taskprocessor_scrape {
+	struct ast_str **response;
+	const struct taskprocessor_metric_defs *def;
+	struct prometheus_metric metric;
+	int first;
+};
+
+static void taskprocessor_to_string(const struct ast_taskprocessor_stats *stats, void *data)
+{
+	struct taskprocessor_scrape *scrape = data;
+
+	PROMETHEUS_METRIC_SET_LABEL(&scrape->metric, 1, "name", stats->name);
+	scrape->def->get_value(&scrape->metric, stats);
+
+	/* Only the first taskprocessor is preceded by the help and type of the metric */
+	if (scrape->first) {
+		prometheus_metric_to_string(&scrape->metric, scrape->response);
+		scrape->first = 0;
+	} else {
+		prometheus_metric_sample_to_string(&scrape->metric, scrape->response);
+	}
+	prometheus_callback_output_flush(scrape->response);
+}
+
+/*!
+ * \internal
+ * \brief Callback invoked when Prometheus scrapes the server
+ *
+ * \param response The response to populate with formatted metrics
+ */
+static void taskprocessors_scrape_cb(struct ast_str **response)
+{
+	char eid_str[32];
+	int i;
+
+	ast_eid_to_str(eid_str, sizeof(eid_str), &ast_eid_default);
+
+	for (i = 0; i < ARRAY_LEN(taskprocessor_metric_defs); i++) {
+		struct taskprocessor_scrape scrape = {
+			.response = response,
+			.def = &taskprocessor_metric_defs[i],
+			.metric = PROMETHEUS_METRIC_STATIC_INITIALIZATION(
+				taskprocessor_metric_defs[i].type,
+				"",
+				taskprocessor_metric_defs[i].help,
+				NULL),
+			.first = 1,
+		};
+
+		ast_copy_string(scrape.metric.name, taskprocessor_metric_defs[i].name, sizeof(scrape.metric.name));
+		PROMETHEUS_METRIC_SET_LABEL(&scrape.metric, 0, "eid", eid_str);
+		ast_taskprocessor_stats_foreach(taskprocessor_to_string, &scrape);
+	}
+}
+
+struct prometheus_callback taskprocessors_callback = {
+	.name = "taskprocessors callback",
+	.callback_fn = taskprocessors_scrape_cb,
+};
+
+/*!
+ * \internal
+ * \brief Callback invoked when the core module is unloaded
+ */
+static void taskprocessor_metrics_unload_cb(void)
+{
+	prometheus_callback_unregister(&taskprocessors_callback);
+}
+
+/*!
+ * \internal
+ * \brief Metrics provider definition
+ */
+static struct prometheus_metrics_provider provider = {
+	.name = "taskprocessors",
+	.unload_cb = taskprocessor_metrics_unload_cb,
+};
+
+int taskprocessor_metrics_init(void)
+{
+	prometheus_metrics_provider_register(&provider);
+	prometheus_callback_register(&taskprocessors_callback);
+
+	return 0;
+}
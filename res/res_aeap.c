@@ -56,6 +56,15 @@
 					codecs configured on the endpoint.
 					</para></description>
 				</configOption>
+				<configOption name="multiplex" default="no">
+					<synopsis>Share a connection between the sessions of the client</synopsis>
+					<description><para>
+					If enabled, every session of the client shares a single connection to
+					the server rather than opening one of its own.  Each session is given
+					a unique id which the application protocol uses to tell the sessions
+					apart, so the server must support it.
+					</para></description>
+				</configOption>
 			</configObject>
 		</configFile>
 	</configInfo>
@@ -79,6 +88,8 @@ struct ast_aeap_client_config
 	);
 	/*! An optional list of codecs that will be used if provided */
 	struct ast_format_cap *codecs;
+	/*! Whether sessions share a connection to the server */
+	unsigned int multiplex;
 };
 
 static void client_config_destructor(void *obj)
@@ -385,6 +396,7 @@ static int load_module(void)
 	ast_sorcery_object_field_register(aeap_sorcery, AEAP_CONFIG_CLIENT, "url", "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct ast_aeap_client_config, url));
 	ast_sorcery_object_field_register(aeap_sorcery, AEAP_CONFIG_CLIENT, "protocol", "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct ast_aeap_client_config, protocol));
 	ast_sorcery_object_field_register(aeap_sorcery, AEAP_CONFIG_CLIENT, "codecs", "", OPT_CODEC_T, 1, FLDSET(struct ast_aeap_client_config, codecs));
+	ast_sorcery_object_field_register(aeap_sorcery, AEAP_CONFIG_CLIENT, "multiplex", "no", OPT_BOOL_T, 1, FLDSET(struct ast_aeap_client_config, multiplex));
 
 	ast_sorcery_load(aeap_sorcery);
 
@@ -94,6 +94,8 @@
 		<description>
 			<para>Interrupts expected flow of Async AGI commands and returns control to previous source
 			(typically, the PBX dialplan).</para>
+			<para>On a pooled FastAGI connection it ends the script, and the connection
+			is kept for the next script to the same server.</para>
 		</description>
 		<see-also>
 			<ref type="agi">hangup</ref>
@@ -1159,6 +1161,14 @@
 					example, if you specify the URI <literal>hagi://agi.example.com/foo.agi</literal>
 					the DNS query would be for <literal>_agi._tcp.agi.example.com</literal>. You
 					will need to make sure this resolves correctly.</para>
+					<para>If the <variable>AGIPOOL</variable> channel variable is set to
+					<literal>yes</literal>, the TCP connection is kept open once the script is
+					done and reused by a later FastAGI script to the same server, instead of
+					connecting anew.  Asterisk tells the server with
+					<literal>agi_network_pool: yes</literal> ahead of the environment, and the
+					server must then end each script with <literal>ASYNCAGI BREAK</literal> rather
+					than by closing the connection.  A FastAGI server may also send several
+					commands without waiting for their replies, which are sent in order.</para>
 				</enum>
 				<enum name="AsyncAGI">
 					<para>Use AMI to control the channel in AGI. AGI commands can be invoked
@@ -1401,6 +1411,29 @@ static int agidebug = 0;
 
 #define AGI_PORT 4573
 
+/*! How many idle FastAGI connections are kept for reuse */
+#define FASTAGI_POOL_MAX 128
+
+/*! How long an idle FastAGI connection is kept for reuse, in seconds */
+#define FASTAGI_POOL_IDLE_TIMEOUT 60
+
+/*! \brief An idle FastAGI connection kept for reuse */
+struct fastagi_conn {
+	/*! The connected socket */
+	int fd;
+	/*! The FastAGI server it is connected to */
+	struct ast_sockaddr addr;
+	/*! When it was returned to the pool */
+	struct timeval idle_since;
+	AST_LIST_ENTRY(fastagi_conn) list;
+};
+
+/*! \brief Idle FastAGI connections, the most recently used first */
+static AST_LIST_HEAD_STATIC(fastagi_pool, fastagi_conn);
+
+/*! \brief How many connections are in the pool */
+static int fastagi_pool_count;
+
 /*! Special return code for "asyncagi break" command. */
 #define ASYNC_AGI_BREAK	3
 
@@ -2043,9 +2076,95 @@ static int handle_connection(const char *agiurl, const struct ast_sockaddr addr,
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Take an idle connection to a FastAGI server from the pool
+ *
+ * \param addr The address of the server
+ *
+ * \return The connected socket
+ * \retval -1 if there is none
+ */
+static int fastagi_pool_get(const struct ast_sockaddr *addr)
+{
+	struct fastagi_conn *conn;
+	struct timeval now = ast_tvnow();
+	int fd = -1;
+
+	AST_LIST_LOCK(&fastagi_pool);
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&fastagi_pool, conn, list) {
+		if (ast_tvdiff_sec(now, conn->idle_since) < FASTAGI_POOL_IDLE_TIMEOUT) {
+			struct pollfd pfd = { .fd = conn->fd, .events = POLLIN, };
+
+			if (fd != -1 || ast_sockaddr_cmp(&conn->addr, addr)) {
+				continue;
+			}
+
+			/* An idle server has nothing to say, so anything readable means it closed */
+			if (!ast_poll(&pfd, 1, 0)) {
+				fd = conn->fd;
+			}
+		}
+
+		AST_LIST_REMOVE_CURRENT(list);
+		fastagi_pool_count--;
+		if (conn->fd != fd) {
+			close(conn->fd);
+		}
+		ast_free(conn);
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+	AST_LIST_UNLOCK(&fastagi_pool);
+
+	return fd;
+}
+
+/*!
+ * \internal
+ * \brief Keep a connection to a FastAGI server for reuse, closing it if it cannot be
+ */
+static void fastagi_pool_put(int fd)
+{
+	struct fastagi_conn *conn;
+
+	conn = ast_calloc(1, sizeof(*conn));
+	if (!conn || ast_getpeername(fd, &conn->addr)) {
+		ast_free(conn);
+		close(fd);
+		return;
+	}
+	conn->fd = fd;
+	conn->idle_since = ast_tvnow();
+
+	AST_LIST_LOCK(&fastagi_pool);
+	if (fastagi_pool_count >= FASTAGI_POOL_MAX) {
+		AST_LIST_UNLOCK(&fastagi_pool);
+		ast_free(conn);
+		close(fd);
+		return;
+	}
+	AST_LIST_INSERT_HEAD(&fastagi_pool, conn, list);
+	fastagi_pool_count++;
+	AST_LIST_UNLOCK(&fastagi_pool);
+}
+
+/*! \internal \brief Close every pooled FastAGI connection */
+static void fastagi_pool_empty(void)
+{
+	struct fastagi_conn *conn;
+
+	AST_LIST_LOCK(&fastagi_pool);
+	while ((conn = AST_LIST_REMOVE_HEAD(&fastagi_pool, list))) {
+		close(conn->fd);
+		ast_free(conn);
+	}
+	fastagi_pool_count = 0;
+	AST_LIST_UNLOCK(&fastagi_pool);
+}
+
 /* launch_netscript: The fastagi handler.
 	FastAGI defaults to port 4573 */
-static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
+static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds, int pool)
 {
 	int s = 0;
 	char *host, *script;
@@ -2072,6 +2191,11 @@ static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
 			ast_sockaddr_set_port(&addrs[i], AGI_PORT);
 		}
 
+		if (pool && (s = fastagi_pool_get(&addrs[i])) > -1) {
+			ast_debug(4, "Reusing FastAGI connection to %s\n", ast_sockaddr_stringify(&addrs[i]));
+			break;
+		}
+
 		if ((s = ast_socket_nonblock(addrs[i].ss.ss_family, SOCK_STREAM, IPPROTO_TCP)) < 0) {
 			ast_log(LOG_WARNING, "Unable to create socket: %s\n", strerror(errno));
 			continue;
@@ -2107,6 +2231,10 @@ static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
 		}
 	}
 
+	if (pool) {
+		ast_agi_send(s, NULL, "agi_network_pool: yes\n");
+	}
+
 	/* If we have a script parameter, relay it to the fastagi server */
 	/* Script parameters take the form of: AGI(agi://my.example.com/?extension=${EXTEN}) */
 	if (!ast_strlen_zero(script)) {
@@ -2125,6 +2253,7 @@ static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
  * \param agiurl The request URL as passed to Agi() in the dial plan
  * \param argv The parameters after the URL passed to Agi() in the dial plan
  * \param fds Input/output file descriptors
+ * \param pool Whether the connection may be taken from and returned to the pool
  *
  * Uses SRV lookups to try to connect to a list of FastAGI servers. The hostname in
  * the URI is prefixed with _agi._tcp. prior to the DNS resolution. For
@@ -2138,7 +2267,7 @@ static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
  *
  * \return the result of the AGI operation.
  */
-static enum agi_result launch_ha_netscript(char *agiurl, char *argv[], int *fds)
+static enum agi_result launch_ha_netscript(char *agiurl, char *argv[], int *fds, int pool)
 {
 	char *host, *script;
 	enum agi_result result;
@@ -2165,14 +2294,14 @@ static enum agi_result launch_ha_netscript(char *agiurl, char *argv[], int *fds)
 
 	if (strchr(host, ':')) {
 		ast_log(LOG_WARNING, "Specifying a port number disables SRV lookups: %s\n", agiurl);
-		return launch_netscript(agiurl + 1, argv, fds); /* +1 to strip off leading h from hagi:// */
+		return launch_netscript(agiurl + 1, argv, fds, pool); /* +1 to strip off leading h from hagi:// */
 	}
 
 	snprintf(service, sizeof(service), "%s%s", SRV_PREFIX, host);
 
 	while (!(srv_ret = ast_srv_lookup(&context, service, &srvhost, &srvport))) {
 		snprintf(resolved_uri, sizeof(resolved_uri), "agi://%s:%d/%s", srvhost, srvport, script);
-		result = launch_netscript(resolved_uri, argv, fds);
+		result = launch_netscript(resolved_uri, argv, fds, pool);
 		if (result == AGI_RESULT_FAILURE || result == AGI_RESULT_NOTFOUND) {
 			ast_log(LOG_WARNING, "AGI request failed for host '%s' (%s:%d)\n", host, srvhost, srvport);
 		} else {
@@ -2192,6 +2321,18 @@ static enum agi_result launch_ha_netscript(char *agiurl, char *argv[], int *fds)
 	return AGI_RESULT_FAILURE;
 }
 
+/*! \internal \brief Whether FastAGI connections of a channel are pooled */
+static int agi_pool_enabled(struct ast_channel *chan)
+{
+	int pool;
+
+	ast_channel_lock(chan);
+	pool = ast_true(pbx_builtin_getvar_helper(chan, "AGIPOOL"));
+	ast_channel_unlock(chan);
+
+	return pool;
+}
+
 static enum agi_result launch_script(struct ast_channel *chan, char *script, int argc, char *argv[], int *fds, int *efd, int *opid)
 {
 	char tmp[256];
@@ -2199,10 +2340,10 @@ static enum agi_result launch_script(struct ast_channel *chan, char *script, int
 	struct stat st;
 
 	if (!strncasecmp(script, "agi://", 6)) {
-		return (efd == NULL) ? launch_netscript(script, argv, fds) : AGI_RESULT_FAILURE;
+		return (efd == NULL) ? launch_netscript(script, argv, fds, agi_pool_enabled(chan)) : AGI_RESULT_FAILURE;
 	}
 	if (!strncasecmp(script, "hagi://", 7)) {
-		return (efd == NULL) ? launch_ha_netscript(script, argv, fds) : AGI_RESULT_FAILURE;
+		return (efd == NULL) ? launch_ha_netscript(script, argv, fds, agi_pool_enabled(chan)) : AGI_RESULT_FAILURE;
 	}
 	if (!strncasecmp(script, "agi:async", sizeof("agi:async") - 1)) {
 		return launch_asyncagi(chan, argc, argv, efd);
@@ -4141,6 +4282,59 @@ static enum agi_result agi_handle_command(struct ast_channel *chan, AGI *agi, ch
 	return AGI_RESULT_SUCCESS;
 }
 
+/*! \brief Commands read from a FastAGI server but not handled yet */
+struct fastagi_reader {
+	char buf[AGI_BUF_LEN];
+	size_t len;
+};
+
+/*!
+ * \internal
+ * \brief Read the next command from a FastAGI server
+ *
+ * A server may send several commands without waiting for their replies,
+ * so what was read past the first command is kept for the next call.
+ *
+ * \param fd The socket of the connection, which must be non-blocking
+ * \param reader What was read but not handled yet
+ * \param[out] line The command, with its newline
+ * \param size The size of \a line
+ *
+ * \retval 1 if a command was read
+ * \retval 0 if a command has not been read completely yet
+ * \retval -1 if the connection was closed
+ */
+static int fastagi_read_command(int fd, struct fastagi_reader *reader, char *line, size_t size)
+{
+	for (;;) {
+		char *end = memchr(reader->buf, '\n', reader->len);
+		size_t len;
+		ssize_t res;
+
+		if (end || reader->len == sizeof(reader->buf) - 1) {
+			/* A command that does not fit is handled in pieces, as it always was */
+			len = end ? end - reader->buf + 1 : reader->len;
+			len = MIN(len, size - 1);
+			memcpy(line, reader->buf, len);
+			line[len] = '\0';
+			reader->len -= len;
+			memmove(reader->buf, reader->buf + len, reader->len);
+			return 1;
+		}
+
+		res = read(fd, reader->buf + reader->len, sizeof(reader->buf) - 1 - reader->len);
+		if (res > 0) {
+			reader->len += res;
+		} else if (res < 0 && errno == EINTR) {
+			continue;
+		} else if (res < 0 && errno == EAGAIN) {
+			return 0;
+		} else {
+			return -1;
+		}
+	}
+}
+
 static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi, int pid, int *status, int dead, int argc, char *argv[])
 {
 	struct ast_channel *c;
@@ -4151,7 +4345,11 @@ static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi
 	struct ast_frame *f;
 	char buf[AGI_BUF_LEN];
 	char *res = NULL;
-	FILE *readf;
+	FILE *readf = NULL;
+	struct fastagi_reader reader = { .len = 0, };
+	/* Set when a pooled FastAGI server ends the script, leaving the connection reusable */
+	int pool_reuse = 0;
+	int pool;
 	/* how many times we'll retry if ast_waitfor_nandfs will return without either
 	  channel or file descriptor in case select is interrupted by a system call (EINTR) */
 	int retry = AGI_NANDFS_RETRY;
@@ -4168,16 +4366,20 @@ static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi
 	exit_on_hangup_str = pbx_builtin_getvar_helper(chan, "AGIEXITONHANGUP");
 	exit_on_hangup = ast_true(exit_on_hangup_str);
 	ast_channel_unlock(chan);
+	pool = agi->fast && agi_pool_enabled(chan);
+
+	/* FastAGI commands are read without stdio so pipelined ones are not left unseen in its buffer */
+	if (!agi->fast) {
+		if (!(readf = fdopen(agi->ctrl, "r"))) {
+			ast_log(LOG_WARNING, "Unable to fdopen file descriptor\n");
+			if (send_sighup && pid > -1)
+				kill(pid, SIGHUP);
+			close(agi->ctrl);
+			return AGI_RESULT_FAILURE;
+		}
 
-	if (!(readf = fdopen(agi->ctrl, "r"))) {
-		ast_log(LOG_WARNING, "Unable to fdopen file descriptor\n");
-		if (send_sighup && pid > -1)
-			kill(pid, SIGHUP);
-		close(agi->ctrl);
-		return AGI_RESULT_FAILURE;
+		setlinebuf(readf);
 	}
-
-	setlinebuf(readf);
 	setup_env(chan, request, agi->fd, (agi->audio > -1), argc, argv);
 	for (;;) {
 		if (needhup) {
@@ -4195,7 +4397,11 @@ static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi
 			}
 		}
 		ms = -1;
-		if (dead || in_intercept) {
+		if (memchr(reader.buf, '\n', reader.len)) {
+			/* Handle pipelined commands before waiting for more */
+			c = NULL;
+			outfd = agi->ctrl;
+		} else if (dead || in_intercept) {
 			c = ast_waitfor_nandfds(&chan, 0, &agi->ctrl, 1, NULL, &outfd, &ms);
 		} else if (!ast_check_hangup(chan)) {
 			c = ast_waitfor_nandfds(&chan, 1, &agi->ctrl, 1, NULL, &outfd, &ms);
@@ -4233,6 +4439,16 @@ static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi
 			retry = AGI_NANDFS_RETRY;
 			buf[0] = '\0';
 
+			if (agi->fast) {
+				int read_res = fastagi_read_command(agi->ctrl, &reader, buf, sizeof(buf));
+
+				if (!read_res) {
+					/* Wait for the rest of the command */
+					continue;
+				}
+				len = 0;
+			}
+
 			while (len > 1) {
 				res = fgets(buf + buflen, len, readf);
 				if (feof(readf))
@@ -4281,9 +4497,17 @@ static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi
 					returnstatus = AGI_RESULT_FAILURE;
 				}
 				break;
+			case AGI_RESULT_SUCCESS_ASYNC:
+				/* A pooled FastAGI server ends the script without closing the connection */
+				pool_reuse = pool;
+				break;
 			default:
 				break;
 			}
+			if (pool_reuse) {
+				ast_verb(3, "<%s>AGI Script %s completed, returning %d\n", ast_channel_name(chan), request, returnstatus);
+				break;
+			}
 		} else {
 			if (--retry <= 0) {
 				ast_log(LOG_WARNING, "No channel, no fd?\n");
@@ -4297,7 +4521,7 @@ static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi
 		ast_speech_destroy(agi->speech);
 	}
 	/* Notify process */
-	if (send_sighup) {
+	if (send_sighup && !pool_reuse) {
 		if (pid > -1) {
 			if (kill(pid, SIGHUP)) {
 				ast_log(LOG_WARNING, "unable to send SIGHUP to AGI process %d: %s\n", pid, strerror(errno));
@@ -4309,7 +4533,14 @@ static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi
 			ast_agi_send(agi->fd, chan, "HANGUP\n");
 		}
 	}
-	fclose(readf);
+	if (readf) {
+		fclose(readf);
+	} else if (pool_reuse && !reader.len) {
+		fastagi_pool_put(agi->ctrl);
+	} else {
+		/* Anything sent after the end of the script makes the connection unusable */
+		close(agi->ctrl);
+	}
 	return returnstatus;
 }
 
@@ -4708,6 +4939,7 @@ static int unload_module(void)
 	ast_manager_unregister("AGI");
 	ast_unregister_application(app);
 	AST_TEST_UNREGISTER(test_agi_null_docs);
+	fastagi_pool_empty();
 	return 0;
 }
 
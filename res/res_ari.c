@@ -104,6 +104,16 @@
 						Value is in milliseconds.</para>
 					</description>
 				</configOption>
+				<configOption name="websocket_batch_max" default="1">
+					<synopsis>The most events to send in one WebSocket frame.</synopsis>
+					<description>
+						<para>Events that wait for a WebSocket connection while earlier
+						events are written to it are sent together, up to this many in a
+						frame, as a JSON array of the events. Clients must then accept
+						arrays as well as single events. The default of 1 sends each event
+						in a frame of its own.</para>
+					</description>
+				</configOption>
 				<configOption name="pretty">
 					<synopsis>Responses from ARI are formatted to be human readable</synopsis>
 				</configOption>
@@ -168,6 +178,30 @@ static ast_mutex_t root_handler_lock;
 /*! Handler for root RESTful resource. */
 static struct stasis_rest_handlers *root_handler;
 
+/*! \brief A path segment leading from a handler to one of its children */
+struct ari_route {
+	const struct stasis_rest_handlers *parent;
+	/*! Path segment to match, or NULL for the wildcard child */
+	const char *path_segment;
+	struct stasis_rest_handlers *child;
+};
+
+/*!
+ * \brief Routes of the handler tree compiled into a hash table
+ *
+ * Rebuilt whenever a resource is added or removed, so a request is routed
+ * with a lookup per path segment instead of comparing it to every child.
+ */
+struct ari_routes {
+	struct stasis_rest_handlers *root;
+	/*! Size of the table less one, the size being a power of two */
+	size_t mask;
+	struct ari_route table[0];
+};
+
+/*! Routes of \ref root_handler, protected by \ref root_handler_lock */
+static struct ari_routes *routes;
+
 /*! Pre-defined message for allocation failures. */
 static struct ast_json *oom_json;
 
@@ -176,6 +210,123 @@ struct ast_json *ast_ari_oom_json(void)
 	return oom_json;
 }
 
+static unsigned int ari_route_hash(const struct stasis_rest_handlers *parent,
+	const char *path_segment)
+{
+	unsigned int hash = (unsigned int) ((uintptr_t) parent >> 4) * 2654435761u;
+
+	if (path_segment) {
+		hash ^= ast_str_hash(path_segment);
+	}
+	return hash;
+}
+
+static struct stasis_rest_handlers *ari_routes_find(const struct ari_routes *routes,
+	const struct stasis_rest_handlers *parent, const char *path_segment)
+{
+	size_t slot = ari_route_hash(parent, path_segment) & routes->mask;
+
+	for (; routes->table[slot].parent; slot = (slot + 1) & routes->mask) {
+		const struct ari_route *route = &routes->table[slot];
+
+		if (route->parent != parent) {
+			continue;
+		}
+		if (!path_segment ? !route->path_segment
+			: route->path_segment && !strcmp(route->path_segment, path_segment)) {
+			return route->child;
+		}
+	}
+	return NULL;
+}
+
+static size_t ari_routes_count(const struct stasis_rest_handlers *handler)
+{
+	size_t count = handler->num_children;
+	size_t i;
+
+	for (i = 0; i < handler->num_children; ++i) {
+		count += ari_routes_count(handler->children[i]);
+	}
+	return count;
+}
+
+static void ari_routes_insert(struct ari_routes *routes, const struct stasis_rest_handlers *handler)
+{
+	size_t i;
+
+	for (i = 0; i < handler->num_children; ++i) {
+		struct stasis_rest_handlers *child = handler->children[i];
+		const char *path_segment = child->is_wildcard ? NULL : child->path_segment;
+		size_t slot;
+
+		if (ari_routes_find(routes, handler, path_segment)) {
+			ast_log(LOG_WARNING, "Duplicate ARI route %s/%s ignored\n",
+				handler->path_segment, child->path_segment);
+			continue;
+		}
+
+		slot = ari_route_hash(handler, path_segment) & routes->mask;
+		while (routes->table[slot].parent) {
+			slot = (slot + 1) & routes->mask;
+		}
+		routes->table[slot].parent = handler;
+		routes->table[slot].path_segment = path_segment;
+		routes->table[slot].child = child;
+
+		ari_routes_insert(routes, child);
+	}
+}
+
+static void ari_routes_destroy(void *obj)
+{
+	struct ari_routes *routes = obj;
+
+	ao2_cleanup(routes->root);
+}
+
+/*! \brief Compile the routes of a handler tree */
+static struct ari_routes *ari_routes_build(struct stasis_rest_handlers *root)
+{
+	struct ari_routes *routes;
+	size_t size = 1;
+	size_t count;
+
+	/* Keep the table at most half full */
+	count = ari_routes_count(root);
+	while (size <= count * 2) {
+		size <<= 1;
+	}
+
+	routes = ao2_alloc_options(sizeof(*routes) + size * sizeof(routes->table[0]),
+		ari_routes_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!routes) {
+		return NULL;
+	}
+	routes->root = ao2_bump(root);
+	routes->mask = size - 1;
+	ari_routes_insert(routes, root);
+
+	return routes;
+}
+
+/*! \brief Make a new root handler the current one.  Called with \ref root_handler_lock held. */
+static int root_handler_replace(struct stasis_rest_handlers *new_handler)
+{
+	struct ari_routes *new_routes;
+
+	new_routes = ari_routes_build(new_handler);
+	if (!new_routes) {
+		return -1;
+	}
+
+	ao2_cleanup(routes);
+	routes = new_routes;
+	ao2_cleanup(root_handler);
+	root_handler = ao2_bump(new_handler);
+	return 0;
+}
+
 int ast_ari_add_handler(struct stasis_rest_handlers *handler)
 {
 	RAII_VAR(struct stasis_rest_handlers *, new_handler, NULL, ao2_cleanup);
@@ -193,10 +344,7 @@ int ast_ari_add_handler(struct stasis_rest_handlers *handler)
 	memcpy(new_handler, root_handler, old_size);
 	new_handler->children[new_handler->num_children++] = handler;
 
-	ao2_cleanup(root_handler);
-	ao2_ref(new_handler, +1);
-	root_handler = new_handler;
-	return 0;
+	return root_handler_replace(new_handler);
 }
 
 int ast_ari_remove_handler(struct stasis_rest_handlers *handler)
@@ -205,6 +353,7 @@ int ast_ari_remove_handler(struct stasis_rest_handlers *handler)
 	size_t size;
 	size_t i;
 	size_t j;
+	int res;
 
 	ast_assert(root_handler != NULL);
 
@@ -228,11 +377,11 @@ int ast_ari_remove_handler(struct stasis_rest_handlers *handler)
 	new_handler->num_children = j;
 
 	/* Replace the old root_handler with the new. */
-	ao2_cleanup(root_handler);
-	root_handler = new_handler;
+	res = root_handler_replace(new_handler);
+	ao2_ref(new_handler, -1);
 
 	ast_mutex_unlock(&root_handler_lock);
-	return 0;
+	return res;
 }
 
 static struct stasis_rest_handlers *get_root_handler(void)
@@ -242,6 +391,12 @@ static struct stasis_rest_handlers *get_root_handler(void)
 	return root_handler;
 }
 
+static struct ari_routes *get_routes(void)
+{
+	SCOPED_MUTEX(lock, &root_handler_lock);
+	return ao2_bump(routes);
+}
+
 static struct stasis_rest_handlers *root_handler_create(void)
 {
 	RAII_VAR(struct stasis_rest_handlers *, handler, NULL, ao2_cleanup);
@@ -269,6 +424,8 @@ void ast_ari_response_error(struct ast_ari_response *response,
 	va_end(ap);
 	response->message = ast_json_pack("{s: o}",
 					  "message", ast_json_ref(message));
+	ast_free(response->body);
+	response->body = NULL;
 	response->response_code = response_code;
 	response->response_text = response_text;
 }
@@ -281,6 +438,23 @@ void ast_ari_response_ok(struct ast_ari_response *response,
 	response->response_text = "OK";
 }
 
+void ast_ari_response_ok_body(struct ast_ari_response *response,
+			     struct ast_str *body)
+{
+#if defined(AST_DEVMODE)
+	/* Responses are validated against the models, which needs the message */
+	response->message = ast_json_load_str(body, NULL);
+	if (!response->message) {
+		response->message = ast_json_null();
+	}
+#else
+	response->message = ast_json_null();
+#endif
+	response->body = body;
+	response->response_code = 200;
+	response->response_text = "OK";
+}
+
 void ast_ari_response_no_content(struct ast_ari_response *response)
 {
 	response->message = ast_json_null();
@@ -493,52 +667,42 @@ void ast_ari_invoke(struct ast_tcptls_session_instance *ser,
 	struct ast_variable *get_params, struct ast_variable *headers,
 	struct ast_json *body, struct ast_ari_response *response)
 {
-	RAII_VAR(struct stasis_rest_handlers *, root, NULL, ao2_cleanup);
+	RAII_VAR(struct ari_routes *, routes, NULL, ao2_cleanup);
 	struct stasis_rest_handlers *handler;
-	struct stasis_rest_handlers *wildcard_handler = NULL;
 	RAII_VAR(struct ast_variable *, path_vars, NULL, ast_variables_destroy);
 	char *path = ast_strdupa(uri);
 	char *path_segment;
 	stasis_rest_callback callback;
 
-	root = handler = get_root_handler();
-	ast_assert(root != NULL);
+	routes = get_routes();
+	ast_assert(routes != NULL);
+	handler = routes->root;
 
 	ast_debug(3, "Finding handler for %s\n", path);
 
 	while ((path_segment = strsep(&path, "/")) && (strlen(path_segment) > 0)) {
-		struct stasis_rest_handlers *found_handler = NULL;
-		int i;
+		struct stasis_rest_handlers *found_handler;
 
 		ast_uri_decode(path_segment, ast_uri_http_legacy);
-		ast_debug(3, "  Finding handler for %s\n", path_segment);
-
-		for (i = 0; found_handler == NULL && i < handler->num_children; ++i) {
-			struct stasis_rest_handlers *child = handler->children[i];
 
-			if (child->is_wildcard) {
+		found_handler = ari_routes_find(routes, handler, path_segment);
+		if (found_handler) {
+			ast_debug(3, "  Explicit match of %s with %s\n", handler->path_segment, path_segment);
+		} else {
+			found_handler = ari_routes_find(routes, handler, NULL);
+			if (found_handler) {
 				/* Record the path variable */
-				struct ast_variable *path_var = ast_variable_new(child->path_segment, path_segment, __FILE__);
-				path_var->next = path_vars;
-				path_vars = path_var;
-				wildcard_handler = child;
-				ast_debug(3, "        Checking %s %s:  Matched wildcard.\n", handler->path_segment, child->path_segment);
-
-			} else if (strcmp(child->path_segment, path_segment) == 0) {
-				found_handler = child;
-				ast_debug(3, "        Checking %s %s:  Explicit match with %s\n", handler->path_segment, child->path_segment, path_segment);
-			} else {
-				ast_debug(3, "        Checking %s %s:  Didn't match %s\n", handler->path_segment, child->path_segment, path_segment);
+				struct ast_variable *path_var = ast_variable_new(found_handler->path_segment, path_segment, __FILE__);
+
+				if (path_var) {
+					path_var->next = path_vars;
+					path_vars = path_var;
+				}
+				ast_debug(3, "  No explicit handler found for %s.  Using wildcard %s.\n",
+					path_segment, found_handler->path_segment);
 			}
 		}
 
-		if (!found_handler && wildcard_handler) {
-			ast_debug(3, "  No explicit handler found for %s.  Using wildcard %s.\n",
-				path_segment, wildcard_handler->path_segment);
-			found_handler = wildcard_handler;
-			wildcard_handler = NULL;
-		}
-
 		if (found_handler == NULL) {
 			/* resource not found */
 			ast_debug(3, "  Handler not found for %s\n", path_segment);
@@ -1064,6 +1228,7 @@ static int ast_ari_callback(struct ast_tcptls_session_instance *ser,
 		/* The handler indicates no further response is necessary.
 		 * Probably because it already handled it */
 		ast_free(response.headers);
+		ast_free(response.body);
 		return 0;
 	}
 
@@ -1078,7 +1243,14 @@ request_failed:
 	/* response.message could be NULL, in which case the empty response_body
 	 * is correct
 	 */
-	if (response.message && !ast_json_is_null(response.message)) {
+	if (response.body) {
+		/* The handler encoded the message itself */
+		ast_str_append(&response.headers, 0,
+			       "Content-type: application/json\r\n");
+		ast_free(response_body);
+		response_body = response.body;
+		response.body = NULL;
+	} else if (response.message && !ast_json_is_null(response.message)) {
 		ast_str_append(&response.headers, 0,
 			       "Content-type: application/json\r\n");
 		if (ast_json_dump_str_format(response.message, &response_body,
@@ -1132,6 +1304,8 @@ static int unload_module(void)
 
 	ast_ari_config_destroy();
 
+	ao2_cleanup(routes);
+	routes = NULL;
 	ao2_cleanup(root_handler);
 	root_handler = NULL;
 	ast_mutex_destroy(&root_handler_lock);
@@ -1153,6 +1327,12 @@ static int load_module(void)
 	if (!root_handler) {
 		return AST_MODULE_LOAD_DECLINE;
 	}
+	if (!routes) {
+		routes = ari_routes_build(root_handler);
+	}
+	if (!routes) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
 
 	/* oom_json may have been built during a declined load */
 	if (!oom_json) {
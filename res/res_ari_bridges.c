@@ -454,6 +454,10 @@ int ast_ari_bridges_add_channel_parse_body(
 	if (field) {
 		args->inhibit_connected_line_updates = ast_json_is_true(field);
 	}
+	field = ast_json_object_get(body, "operationId");
+	if (field) {
+		args->operation_id = ast_json_string_get(field);
+	}
 	return 0;
 }
 
@@ -534,6 +538,9 @@ static void ast_ari_bridges_add_channel_cb(
 		if (strcmp(i->name, "inhibitConnectedLineUpdates") == 0) {
 			args.inhibit_connected_line_updates = ast_true(i->value);
 		} else
+		if (strcmp(i->name, "operationId") == 0) {
+			args.operation_id = (i->value);
+		} else
 		{}
 	}
 	for (i = path_vars; i; i = i->next) {
@@ -619,6 +626,10 @@ int ast_ari_bridges_remove_channel_parse_body(
 			args->channel[0] = ast_json_string_get(field);
 		}
 	}
+	field = ast_json_object_get(body, "operationId");
+	if (field) {
+		args->operation_id = ast_json_string_get(field);
+	}
 	return 0;
 }
 
@@ -687,6 +698,9 @@ static void ast_ari_bridges_remove_channel_cb(
 				args.channel[j] = (vals[j]);
 			}
 		} else
+		if (strcmp(i->name, "operationId") == 0) {
+			args.operation_id = (i->value);
+		} else
 		{}
 	}
 	for (i = path_vars; i; i = i->next) {
@@ -381,6 +381,224 @@ static void ast_ari_channels_create_cb(
 fin: __attribute__((unused))
 	return;
 }
+int ast_ari_channels_originate_bulk_parse_body(
+	struct ast_json *body,
+	struct ast_ari_channels_originate_bulk_args *args)
+{
+	struct ast_json *field;
+	/* Parse query parameters out of it */
+	field = ast_json_object_get(body, "endpoint");
+	if (field) {
+		/* If they were silly enough to both pass in a query param and a
+		 * JSON body, free up the query value.
+		 */
+		ast_free(args->endpoint);
+		if (ast_json_typeof(field) == AST_JSON_ARRAY) {
+			/* Multiple param passed as array */
+			size_t i;
+			args->endpoint_count = ast_json_array_size(field);
+			args->endpoint = ast_malloc(sizeof(*args->endpoint) * args->endpoint_count);
+
+			if (!args->endpoint) {
+				return -1;
+			}
+
+			for (i = 0; i < args->endpoint_count; ++i) {
+				args->endpoint[i] = ast_json_string_get(ast_json_array_get(field, i));
+			}
+		} else {
+			/* Multiple param passed as single value */
+			args->endpoint_count = 1;
+			args->endpoint = ast_malloc(sizeof(*args->endpoint) * args->endpoint_count);
+			if (!args->endpoint) {
+				return -1;
+			}
+			args->endpoint[0] = ast_json_string_get(field);
+		}
+	}
+	field = ast_json_object_get(body, "extension");
+	if (field) {
+		args->extension = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "context");
+	if (field) {
+		args->context = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "priority");
+	if (field) {
+		args->priority = ast_json_integer_get(field);
+	}
+	field = ast_json_object_get(body, "label");
+	if (field) {
+		args->label = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "app");
+	if (field) {
+		args->app = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "appArgs");
+	if (field) {
+		args->app_args = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "callerId");
+	if (field) {
+		args->caller_id = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "timeout");
+	if (field) {
+		args->timeout = ast_json_integer_get(field);
+	}
+	field = ast_json_object_get(body, "cps");
+	if (field) {
+		args->cps = ast_json_integer_get(field);
+	}
+	field = ast_json_object_get(body, "originator");
+	if (field) {
+		args->originator = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "formats");
+	if (field) {
+		args->formats = ast_json_string_get(field);
+	}
+	return 0;
+}
+
+/*!
+ * \brief Parameter parsing callback for /channels/bulk.
+ * \param ser TCP/TLS session object
+ * \param get_params GET parameters in the HTTP request.
+ * \param path_vars Path variables extracted from the request.
+ * \param headers HTTP headers.
+ * \param body
+ * \param[out] response Response to the HTTP request.
+ */
+static void ast_ari_channels_originate_bulk_cb(
+	struct ast_tcptls_session_instance *ser,
+	struct ast_variable *get_params, struct ast_variable *path_vars,
+	struct ast_variable *headers, struct ast_json *body, struct ast_ari_response *response)
+{
+	struct ast_ari_channels_originate_bulk_args args = {};
+	struct ast_variable *i;
+#if defined(AST_DEVMODE)
+	int is_valid;
+	int code;
+#endif /* AST_DEVMODE */
+
+	for (i = get_params; i; i = i->next) {
+		if (strcmp(i->name, "endpoint") == 0) {
+			/* Parse comma separated list */
+			char *vals[MAX_VALS];
+			size_t j;
+
+			args.endpoint_parse = ast_strdup(i->value);
+			if (!args.endpoint_parse) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (strlen(args.endpoint_parse) == 0) {
+				/* ast_app_separate_args can't handle "" */
+				args.endpoint_count = 1;
+				vals[0] = args.endpoint_parse;
+			} else {
+				args.endpoint_count = ast_app_separate_args(
+					args.endpoint_parse, ',', vals,
+					ARRAY_LEN(vals));
+			}
+
+			if (args.endpoint_count == 0) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (args.endpoint_count >= MAX_VALS) {
+				ast_ari_response_error(response, 400,
+					"Bad Request",
+					"Too many values for endpoint");
+				goto fin;
+			}
+
+			args.endpoint = ast_malloc(sizeof(*args.endpoint) * args.endpoint_count);
+			if (!args.endpoint) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			for (j = 0; j < args.endpoint_count; ++j) {
+				args.endpoint[j] = (vals[j]);
+			}
+		} else
+		if (strcmp(i->name, "extension") == 0) {
+			args.extension = (i->value);
+		} else
+		if (strcmp(i->name, "context") == 0) {
+			args.context = (i->value);
+		} else
+		if (strcmp(i->name, "priority") == 0) {
+			args.priority = atol(i->value);
+		} else
+		if (strcmp(i->name, "label") == 0) {
+			args.label = (i->value);
+		} else
+		if (strcmp(i->name, "app") == 0) {
+			args.app = (i->value);
+		} else
+		if (strcmp(i->name, "appArgs") == 0) {
+			args.app_args = (i->value);
+		} else
+		if (strcmp(i->name, "callerId") == 0) {
+			args.caller_id = (i->value);
+		} else
+		if (strcmp(i->name, "timeout") == 0) {
+			args.timeout = atoi(i->value);
+		} else
+		if (strcmp(i->name, "cps") == 0) {
+			args.cps = atoi(i->value);
+		} else
+		if (strcmp(i->name, "originator") == 0) {
+			args.originator = (i->value);
+		} else
+		if (strcmp(i->name, "formats") == 0) {
+			args.formats = (i->value);
+		} else
+		{}
+	}
+	args.variables = body;
+	ast_ari_channels_originate_bulk(headers, &args, response);
+#if defined(AST_DEVMODE)
+	code = response->response_code;
+
+	switch (code) {
+	case 0: /* Implementation is still a stub, or the code wasn't set */
+		is_valid = response->message == NULL;
+		break;
+	case 500: /* Internal Server Error */
+	case 501: /* Not Implemented */
+	case 400: /* Invalid parameters for originating a channel. */
+		is_valid = 1;
+		break;
+	default:
+		if (200 <= code && code <= 299) {
+			is_valid = ast_ari_validate_list(response->message,
+				ast_ari_validate_channel_fn());
+		} else {
+			ast_log(LOG_ERROR, "Invalid error response %d for /channels/bulk\n", code);
+			is_valid = 0;
+		}
+	}
+
+	if (!is_valid) {
+		ast_log(LOG_ERROR, "Response validation failed for /channels/bulk\n");
+		ast_ari_response_error(response, 500,
+			"Internal Server Error", "Response validation failed");
+	}
+#endif /* AST_DEVMODE */
+
+fin: __attribute__((unused))
+	ast_free(args.endpoint_parse);
+	ast_free(args.endpoint);
+	return;
+}
 /*!
  * \brief Parameter parsing callback for /channels/{channelId}.
  * \param ser TCP/TLS session object
@@ -3013,6 +3231,15 @@ static struct stasis_rest_handlers channels_create = {
 	.children = {  }
 };
 /*! \brief REST handler for /api-docs/channels.json */
+static struct stasis_rest_handlers channels_bulk = {
+	.path_segment = "bulk",
+	.callbacks = {
+		[AST_HTTP_POST] = ast_ari_channels_originate_bulk_cb,
+	},
+	.num_children = 0,
+	.children = {  }
+};
+/*! \brief REST handler for /api-docs/channels.json */
 static struct stasis_rest_handlers channels_channelId_continue = {
 	.path_segment = "continue",
 	.callbacks = {
@@ -3210,8 +3437,8 @@ static struct stasis_rest_handlers channels = {
 		[AST_HTTP_GET] = ast_ari_channels_list_cb,
 		[AST_HTTP_POST] = ast_ari_channels_originate_cb,
 	},
-	.num_children = 3,
-	.children = { &channels_create,&channels_channelId,&channels_externalMedia, }
+	.num_children = 4,
+	.children = { &channels_create,&channels_bulk,&channels_channelId,&channels_externalMedia, }
 };
 
 static int unload_module(void)
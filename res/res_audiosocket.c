@@ -30,19 +30,101 @@
 
 #include "asterisk.h"
 #include "errno.h"
+#include <sys/uio.h>
 #include <uuid/uuid.h>
 
 #include "asterisk/file.h"
 #include "asterisk/res_audiosocket.h"
+#include "asterisk/alertpipe.h"
+#include "asterisk/astobj2.h"
 #include "asterisk/channel.h"
+#include "asterisk/linkedlists.h"
 #include "asterisk/module.h"
 #include "asterisk/uuid.h"
 #include "asterisk/format_cache.h"
+#include "asterisk/utils.h"
 
 #define	MODULE_DESCRIPTION	"AudioSocket support functions for Asterisk"
 
 #define MAX_CONNECT_TIMEOUT_MSEC 2000
 
+/*! How long a write may wait for the server to take more data */
+#define MAX_WRITE_TIMEOUT_MSEC 1000
+
+/*! Message kinds */
+#define AUDIOSOCKET_KIND_HANGUP 0x00
+#define AUDIOSOCKET_KIND_UUID 0x01
+#define AUDIOSOCKET_KIND_AUDIO 0x10
+#define AUDIOSOCKET_KIND_ERROR 0xff
+/*! A message of one of the calls on a multiplexed connection, tagged with its UUID */
+#define AUDIOSOCKET_KIND_TAGGED 0x20
+
+/*! Length of the UUID and kind a tagged message starts with */
+#define AUDIOSOCKET_TAG_LEN (16 + 1)
+
+/*! Most payload a message can carry */
+#define AUDIOSOCKET_MAX_PAYLOAD 0xffff
+
+/*! Most frames received on a multiplexed connection held for a call */
+#define AUDIOSOCKET_MAX_QUEUED 50
+
+/*! Buckets of the sessions of a multiplexed connection */
+#define AUDIOSOCKET_SESSION_BUCKETS 61
+
+/*!
+ * \brief A connection carrying the audio of many calls
+ *
+ * Its thread reads the messages of every call and queues the frames of
+ * each for the session of the call.
+ */
+struct audiosocket_mux {
+	/*! The socket */
+	int fd;
+	/*! Serializes writes to the socket */
+	ast_mutex_t write_lock;
+	/*! The sessions on the connection, by UUID */
+	struct ao2_container *sessions;
+	/*! Set once the connection failed, new sessions do not join it */
+	int failed;
+	/*! The server, host:port */
+	char server[0];
+};
+
+/*! \brief An AudioSocket call */
+struct ast_audiosocket_session {
+	/*! The socket of the call, -1 if multiplexed */
+	int svc;
+	/*! The multiplexed connection of the call, NULL if it has its own */
+	struct audiosocket_mux *mux;
+	/*! The UUID of the call */
+	uuid_t uuid;
+	/*! The UUID of the call, as a string */
+	char id[AST_UUID_STR_LEN];
+	/*! Readable while frames are queued, if multiplexed */
+	int alert[2];
+	/*! Set while the alert pipe is readable */
+	int alerted;
+	/*! Set once the server ended the call or the connection failed */
+	int ended;
+	/*! The frames received, if multiplexed */
+	AST_LIST_HEAD_NOLOCK(, ast_frame) frames;
+	/*! How many frames are queued */
+	unsigned int queued;
+	/*! How much audio to send at once, in milliseconds, 0 for each frame as it comes */
+	unsigned int aggregate_ms;
+	/*! The audio waiting to be sent */
+	uint8_t *buf;
+	/*! How much audio is waiting, in bytes */
+	size_t buf_len;
+	/*! How much audio the buffer holds */
+	size_t buf_size;
+	/*! How much audio is waiting, in samples */
+	unsigned int buf_samples;
+};
+
+/*! \brief The multiplexed connections, by server */
+static struct ao2_container *muxes;
+
 /*!
  * \internal
  * \brief Attempt to complete the audiosocket connection.
@@ -206,26 +288,79 @@ const int ast_audiosocket_init(const int svc, const char *id)
 	return ret;
 }
 
-const int ast_audiosocket_send_frame(const int svc, const struct ast_frame *f)
+/*!
+ * \internal
+ * \brief Write all of an I/O vector to a socket
+ *
+ * The socket may be non-blocking, in which case this waits for it to take
+ * more for up to MAX_WRITE_TIMEOUT_MSEC at a time.
+ *
+ * \note The vector is modified.
+ *
+ * \retval 0 on success
+ * \retval -1 on error
+ */
+static int audiosocket_writev(int svc, struct iovec *iov, int iovcnt)
 {
-	int ret = 0;
-	uint8_t kind = 0x10;	/* always 16-bit, 8kHz signed linear mono, for now */
-	uint8_t *p;
-	uint8_t buf[3 + f->datalen];
+	while (iovcnt) {
+		ssize_t n = writev(svc, iov, iovcnt);
 
-	p = buf;
+		if (n < 0) {
+			struct pollfd pfd = { .fd = svc, .events = POLLOUT, };
+
+			if (errno == EINTR) {
+				continue;
+			}
+			if ((errno != EAGAIN && errno != EWOULDBLOCK)
+				|| ast_poll(&pfd, 1, MAX_WRITE_TIMEOUT_MSEC) != 1) {
+				return -1;
+			}
+			continue;
+		}
 
-	*(p++) = kind;
-	*(p++) = f->datalen >> 8;
-	*(p++) = f->datalen & 0xff;
-	memcpy(p, f->data.ptr, f->datalen);
+		/* Skip what was written */
+		while (iovcnt && n >= iov->iov_len) {
+			n -= iov->iov_len;
+			++iov;
+			--iovcnt;
+		}
+		if (iovcnt) {
+			iov->iov_base = (uint8_t *) iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Send a message on a connection of its own, header and payload at once
+ */
+static int audiosocket_send(int svc, uint8_t kind, const void *data, size_t len)
+{
+	uint8_t header[3] = { kind, len >> 8, len & 0xff, };
+	struct iovec iov[2] = {
+		{ .iov_base = header, .iov_len = sizeof(header), },
+		{ .iov_base = (void *) data, .iov_len = len, },
+	};
 
-	if (write(svc, buf, 3 + f->datalen) != 3 + f->datalen) {
+	if (len > AUDIOSOCKET_MAX_PAYLOAD) {
+		return -1;
+	}
+
+	return audiosocket_writev(svc, iov, len ? 2 : 1);
+}
+
+const int ast_audiosocket_send_frame(const int svc, const struct ast_frame *f)
+{
+	/* always 16-bit, 8kHz signed linear mono, for now */
+	if (audiosocket_send(svc, AUDIOSOCKET_KIND_AUDIO, f->data.ptr, f->datalen)) {
 		ast_log(LOG_WARNING, "Failed to write data to AudioSocket\n");
-		ret = -1;
+		return -1;
 	}
 
-	return ret;
+	return 0;
 }
 
 struct ast_frame *ast_audiosocket_receive_frame(const int svc)
@@ -324,15 +459,615 @@ struct ast_frame *ast_audiosocket_receive_frame(const int svc)
 	return ast_frisolate(&f);
 }
 
+/*!
+ * \internal
+ * \brief Read exactly len bytes from a blocking socket
+ *
+ * \retval 0 on success
+ * \retval -1 on error or if the server closed the connection
+ */
+static int audiosocket_read_all(int svc, void *buf, size_t len)
+{
+	size_t done = 0;
+
+	while (done < len) {
+		ssize_t n = read(svc, (uint8_t *) buf + done, len - done);
+
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return -1;
+		}
+		done += n;
+	}
+
+	return 0;
+}
+
+static int audiosocket_session_hash(const void *obj, const int flags)
+{
+	const uint8_t *uuid;
+	unsigned int hash = 0;
+	int i;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		uuid = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		uuid = ((const struct ast_audiosocket_session *) obj)->uuid;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	for (i = 0; i < 16; i++) {
+		hash = hash * 31 + uuid[i];
+	}
+
+	return hash & INT_MAX;
+}
+
+static int audiosocket_session_cmp(void *obj, void *arg, int flags)
+{
+	const struct ast_audiosocket_session *session = obj;
+	const uint8_t *uuid;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		uuid = arg;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		uuid = ((const struct ast_audiosocket_session *) arg)->uuid;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	return memcmp(session->uuid, uuid, 16) ? 0 : CMP_MATCH;
+}
+
+/*!
+ * \internal
+ * \brief Make the session of a call readable, for frames or for its end
+ *
+ * \pre session is locked
+ */
+static void audiosocket_session_alert(struct ast_audiosocket_session *session)
+{
+	if (!session->alerted) {
+		ast_alertpipe_write(session->alert);
+		session->alerted = 1;
+	}
+}
+
+static int audiosocket_session_end(void *obj, void *arg, int flags)
+{
+	struct ast_audiosocket_session *session = obj;
+
+	ao2_lock(session);
+	session->ended = 1;
+	audiosocket_session_alert(session);
+	ao2_unlock(session);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Hand a message received on a multiplexed connection to its call
+ */
+static void audiosocket_mux_deliver(struct audiosocket_mux *mux, const uint8_t *uuid, uint8_t kind,
+	uint8_t *data, size_t len)
+{
+	struct ast_audiosocket_session *session;
+	struct ast_frame *frame = NULL;
+
+	session = ao2_find(mux->sessions, uuid, OBJ_SEARCH_KEY);
+	if (!session) {
+		/* The call may just have ended */
+		ast_free(data);
+		return;
+	}
+
+	if (kind == AUDIOSOCKET_KIND_AUDIO && len) {
+		struct ast_frame f = {
+			.frametype = AST_FRAME_VOICE,
+			.subclass.format = ast_format_slin,
+			.src = "AudioSocket",
+			.mallocd = AST_MALLOCD_DATA,
+			.data.ptr = data,
+			.datalen = len,
+			.samples = len / 2,
+		};
+
+		/* The frame steals data, so it doesn't need to be freed here */
+		frame = ast_frisolate(&f);
+		data = NULL;
+	} else if (kind == AUDIOSOCKET_KIND_ERROR) {
+		ast_log(LOG_WARNING, "AudioSocket server '%s' reported an error for call %s\n",
+			mux->server, session->id);
+	} else if (kind != AUDIOSOCKET_KIND_HANGUP) {
+		ast_log(LOG_WARNING, "Received non-audio AudioSocket message\n");
+	}
+	ast_free(data);
+
+	ao2_lock(session);
+	if (kind == AUDIOSOCKET_KIND_HANGUP || kind == AUDIOSOCKET_KIND_ERROR) {
+		session->ended = 1;
+		audiosocket_session_alert(session);
+	} else if (frame && session->queued < AUDIOSOCKET_MAX_QUEUED) {
+		AST_LIST_INSERT_TAIL(&session->frames, frame, frame_list);
+		++session->queued;
+		frame = NULL;
+		audiosocket_session_alert(session);
+	}
+	ao2_unlock(session);
+
+	if (frame) {
+		ast_debug(1, "AudioSocket call %s is not reading, dropping frame\n", session->id);
+		ast_frfree(frame);
+	}
+	ao2_ref(session, -1);
+}
+
+/*! \brief Thread reading a multiplexed connection */
+static void *audiosocket_mux_thread(void *data)
+{
+	struct audiosocket_mux *mux = data;
+
+	for (;;) {
+		uint8_t header[3];
+		uint8_t tag[AUDIOSOCKET_TAG_LEN];
+		uint8_t *payload = NULL;
+		size_t len;
+
+		if (audiosocket_read_all(mux->fd, header, sizeof(header))) {
+			break;
+		}
+		len = (header[1] << 8) | header[2];
+
+		if (header[0] != AUDIOSOCKET_KIND_TAGGED || len < AUDIOSOCKET_TAG_LEN) {
+			if (header[0] == AUDIOSOCKET_KIND_HANGUP) {
+				/* The server ended every call */
+				break;
+			}
+			ast_log(LOG_WARNING, "Received untagged message on multiplexed AudioSocket connection to '%s'\n",
+				mux->server);
+			if (len && (!(payload = ast_malloc(len)) || audiosocket_read_all(mux->fd, payload, len))) {
+				ast_free(payload);
+				break;
+			}
+			ast_free(payload);
+			continue;
+		}
+
+		if (audiosocket_read_all(mux->fd, tag, sizeof(tag))) {
+			break;
+		}
+		len -= AUDIOSOCKET_TAG_LEN;
+		if (len && (!(payload = ast_malloc(len)) || audiosocket_read_all(mux->fd, payload, len))) {
+			ast_free(payload);
+			break;
+		}
+
+		audiosocket_mux_deliver(mux, tag, tag[16], payload, len);
+	}
+
+	ast_debug(1, "Multiplexed AudioSocket connection to '%s' closed\n", mux->server);
+	mux->failed = 1;
+	ao2_callback(mux->sessions, OBJ_NODATA | OBJ_MULTIPLE, audiosocket_session_end, NULL);
+	ao2_ref(mux, -1);
+
+	return NULL;
+}
+
+static void audiosocket_mux_destructor(void *obj)
+{
+	struct audiosocket_mux *mux = obj;
+
+	if (mux->fd > -1) {
+		close(mux->fd);
+	}
+	ao2_cleanup(mux->sessions);
+	ast_mutex_destroy(&mux->write_lock);
+}
+
+/*!
+ * \internal
+ * \brief Connect to a server for a multiplexed connection
+ */
+static struct audiosocket_mux *audiosocket_mux_create(const char *server, struct ast_channel *chan)
+{
+	struct audiosocket_mux *mux;
+	struct timeval timeout = { .tv_sec = MAX_WRITE_TIMEOUT_MSEC / 1000, };
+	pthread_t thread;
+
+	mux = ao2_alloc_options(sizeof(*mux) + strlen(server) + 1, audiosocket_mux_destructor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!mux) {
+		return NULL;
+	}
+	ast_mutex_init(&mux->write_lock);
+	strcpy(mux->server, server); /* Safe */
+
+	mux->sessions = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+		AUDIOSOCKET_SESSION_BUCKETS, audiosocket_session_hash, NULL, audiosocket_session_cmp);
+	mux->fd = ast_audiosocket_connect(server, chan);
+	if (!mux->sessions || mux->fd < 0) {
+		ao2_ref(mux, -1);
+		return NULL;
+	}
+
+	/* Only its thread reads the connection, and writes give up after a while */
+	ast_fd_clear_flags(mux->fd, O_NONBLOCK);
+	setsockopt(mux->fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	/* The thread holds a reference until the connection closes */
+	ao2_ref(mux, +1);
+	if (ast_pthread_create_detached_background(&thread, NULL, audiosocket_mux_thread, mux)) {
+		ast_log(LOG_ERROR, "Failed to start thread for multiplexed AudioSocket connection to '%s'\n", server);
+		ao2_ref(mux, -1);
+		ao2_ref(mux, -1);
+		return NULL;
+	}
+
+	return mux;
+}
+
+/*!
+ * \internal
+ * \brief Add a call to the multiplexed connection to its server, connecting if there is none
+ */
+static int audiosocket_mux_join(struct ast_audiosocket_session *session, const char *server,
+	struct ast_channel *chan)
+{
+	struct audiosocket_mux *mux;
+	struct audiosocket_mux *created = NULL;
+
+	for (;;) {
+		ao2_lock(muxes);
+		mux = ao2_find(muxes, server, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+		if (mux && mux->failed) {
+			ao2_unlink_flags(muxes, mux, OBJ_NOLOCK);
+			ao2_ref(mux, -1);
+			mux = NULL;
+		}
+		if (!mux && created) {
+			ao2_link_flags(muxes, created, OBJ_NOLOCK);
+			mux = created;
+			created = NULL;
+		}
+		if (mux) {
+			struct ast_audiosocket_session *existing;
+
+			existing = ao2_find(mux->sessions, session->uuid, OBJ_SEARCH_KEY);
+			if (existing) {
+				ast_log(LOG_ERROR, "AudioSocket call %s is already on the connection to '%s'\n",
+					session->id, server);
+				ao2_ref(existing, -1);
+				ao2_ref(mux, -1);
+				mux = NULL;
+			} else if (!ao2_link(mux->sessions, session)) {
+				ao2_ref(mux, -1);
+				mux = NULL;
+			}
+			ao2_unlock(muxes);
+			break;
+		}
+		ao2_unlock(muxes);
+
+		/* Connect without keeping others from joining existing connections */
+		created = audiosocket_mux_create(server, chan);
+		if (!created) {
+			return -1;
+		}
+	}
+
+	if (created) {
+		/* Another call connected first */
+		shutdown(created->fd, SHUT_RDWR);
+		ao2_ref(created, -1);
+	}
+
+	session->mux = mux;
+
+	return mux ? 0 : -1;
+}
+
+/*!
+ * \internal
+ * \brief Take a call off its multiplexed connection, closing the connection if it was the last
+ */
+static void audiosocket_mux_leave(struct ast_audiosocket_session *session)
+{
+	struct audiosocket_mux *mux = session->mux;
+
+	ao2_lock(muxes);
+	ao2_unlink(mux->sessions, session);
+	if (!ao2_container_count(mux->sessions)) {
+		ao2_unlink_flags(muxes, mux, OBJ_NOLOCK);
+		/* Its thread lets go of it once the read fails */
+		shutdown(mux->fd, SHUT_RDWR);
+	}
+	ao2_unlock(muxes);
+
+	ao2_ref(mux, -1);
+	session->mux = NULL;
+}
+
+/*!
+ * \internal
+ * \brief Send a message of a call, tagging it if its connection is multiplexed
+ */
+static int audiosocket_session_send(struct ast_audiosocket_session *session, uint8_t kind,
+	const void *data, size_t len)
+{
+	uint8_t header[3 + AUDIOSOCKET_TAG_LEN];
+	struct iovec iov[2];
+	int res;
+
+	if (!session->mux) {
+		return audiosocket_send(session->svc, kind, data, len);
+	}
+
+	if (len + AUDIOSOCKET_TAG_LEN > AUDIOSOCKET_MAX_PAYLOAD) {
+		return -1;
+	}
+	header[0] = AUDIOSOCKET_KIND_TAGGED;
+	header[1] = (len + AUDIOSOCKET_TAG_LEN) >> 8;
+	header[2] = (len + AUDIOSOCKET_TAG_LEN) & 0xff;
+	memcpy(header + 3, session->uuid, 16);
+	header[3 + 16] = kind;
+
+	iov[0].iov_base = header;
+	iov[0].iov_len = sizeof(header);
+	iov[1].iov_base = (void *) data;
+	iov[1].iov_len = len;
+
+	ast_mutex_lock(&session->mux->write_lock);
+	res = audiosocket_writev(session->mux->fd, iov, len ? 2 : 1);
+	ast_mutex_unlock(&session->mux->write_lock);
+
+	return res;
+}
+
+static void audiosocket_session_destructor(void *obj)
+{
+	struct ast_audiosocket_session *session = obj;
+	struct ast_frame *frame;
+
+	while ((frame = AST_LIST_REMOVE_HEAD(&session->frames, frame_list))) {
+		ast_frfree(frame);
+	}
+	ast_alertpipe_close(session->alert);
+	ast_free(session->buf);
+}
+
+struct ast_audiosocket_session *ast_audiosocket_session_open(const char *server, const char *id,
+	struct ast_channel *chan, int multiplex, unsigned int aggregate_ms)
+{
+	struct ast_audiosocket_session *session;
+
+	if (ast_strlen_zero(id)) {
+		ast_log(LOG_ERROR, "No UUID for AudioSocket\n");
+		return NULL;
+	}
+
+	session = ao2_alloc(sizeof(*session), audiosocket_session_destructor);
+	if (!session) {
+		return NULL;
+	}
+	session->svc = -1;
+	ast_alertpipe_clear(session->alert);
+	session->aggregate_ms = aggregate_ms;
+
+	if (uuid_parse(id, session->uuid)) {
+		ast_log(LOG_ERROR, "Failed to parse UUID '%s'\n", id);
+		ao2_ref(session, -1);
+		return NULL;
+	}
+	ast_copy_string(session->id, id, sizeof(session->id));
+
+	if (!multiplex) {
+		session->svc = ast_audiosocket_connect(server, chan);
+		if (session->svc < 0) {
+			ao2_ref(session, -1);
+			return NULL;
+		}
+		return session;
+	}
+
+	if (ast_strlen_zero(server)) {
+		ast_log(LOG_ERROR, "No AudioSocket server provided\n");
+		ao2_ref(session, -1);
+		return NULL;
+	}
+	if (ast_alertpipe_init(session->alert) || audiosocket_mux_join(session, server, chan)) {
+		ao2_ref(session, -1);
+		return NULL;
+	}
+
+	return session;
+}
+
+int ast_audiosocket_session_fd(struct ast_audiosocket_session *session)
+{
+	return session->mux ? ast_alertpipe_readfd(session->alert) : session->svc;
+}
+
+int ast_audiosocket_session_init(struct ast_audiosocket_session *session)
+{
+	if (audiosocket_session_send(session, AUDIOSOCKET_KIND_UUID, session->uuid, 16)) {
+		ast_log(LOG_WARNING, "Failed to write data to AudioSocket\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Send the audio gathered so far
+ */
+static int audiosocket_session_flush(struct ast_audiosocket_session *session)
+{
+	int res;
+
+	if (!session->buf_len) {
+		return 0;
+	}
+	res = audiosocket_session_send(session, AUDIOSOCKET_KIND_AUDIO, session->buf, session->buf_len);
+	session->buf_len = 0;
+	session->buf_samples = 0;
+
+	return res;
+}
+
+int ast_audiosocket_session_send_frame(struct ast_audiosocket_session *session, const struct ast_frame *f)
+{
+	unsigned int rate;
+	size_t max_len = AUDIOSOCKET_MAX_PAYLOAD - (session->mux ? AUDIOSOCKET_TAG_LEN : 0);
+
+	if (!session->aggregate_ms) {
+		/* always 16-bit, 8kHz signed linear mono, for now */
+		if (audiosocket_session_send(session, AUDIOSOCKET_KIND_AUDIO, f->data.ptr, f->datalen)) {
+			ast_log(LOG_WARNING, "Failed to write data to AudioSocket\n");
+			return -1;
+		}
+		return 0;
+	}
+
+	/* Gather frames until there is enough audio to send */
+	if (session->buf_len + f->datalen > max_len && audiosocket_session_flush(session)) {
+		ast_log(LOG_WARNING, "Failed to write data to AudioSocket\n");
+		return -1;
+	}
+	if (session->buf_len + f->datalen > session->buf_size) {
+		size_t size = MIN(MAX(session->buf_size * 2, session->buf_len + f->datalen), max_len);
+		uint8_t *buf = ast_realloc(session->buf, size);
+
+		if (!buf) {
+			return -1;
+		}
+		session->buf = buf;
+		session->buf_size = size;
+	}
+	memcpy(session->buf + session->buf_len, f->data.ptr, f->datalen);
+	session->buf_len += f->datalen;
+	session->buf_samples += f->samples;
+
+	rate = f->subclass.format ? ast_format_get_sample_rate(f->subclass.format) : 8000;
+	if ((uint64_t) session->buf_samples * 1000 >= (uint64_t) rate * session->aggregate_ms
+		&& audiosocket_session_flush(session)) {
+		ast_log(LOG_WARNING, "Failed to write data to AudioSocket\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+struct ast_frame *ast_audiosocket_session_receive_frame(struct ast_audiosocket_session *session)
+{
+	struct ast_frame *frame;
+
+	if (!session->mux) {
+		return ast_audiosocket_receive_frame(session->svc);
+	}
+
+	ao2_lock(session);
+	frame = AST_LIST_REMOVE_HEAD(&session->frames, frame_list);
+	if (frame) {
+		--session->queued;
+	} else if (session->ended) {
+		ao2_unlock(session);
+		return NULL;
+	}
+	if (!session->queued && !session->ended && session->alerted) {
+		ast_alertpipe_read(session->alert);
+		session->alerted = 0;
+	}
+	ao2_unlock(session);
+
+	return frame ?: &ast_null_frame;
+}
+
+void ast_audiosocket_session_close(struct ast_audiosocket_session *session)
+{
+	if (!session) {
+		return;
+	}
+
+	if (session->mux) {
+		/* Let the server know the call ended, the connection stays up for the others */
+		audiosocket_session_send(session, AUDIOSOCKET_KIND_HANGUP, NULL, 0);
+		audiosocket_mux_leave(session);
+	} else if (session->svc > -1) {
+		close(session->svc);
+		session->svc = -1;
+	}
+
+	ao2_ref(session, -1);
+}
+
+static int audiosocket_mux_hash(const void *obj, const int flags)
+{
+	const char *server;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		server = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		server = ((const struct audiosocket_mux *) obj)->server;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	return ast_str_hash(server);
+}
+
+static int audiosocket_mux_cmp(void *obj, void *arg, int flags)
+{
+	const struct audiosocket_mux *mux = obj;
+	const char *server;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		server = arg;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		server = ((const struct audiosocket_mux *) arg)->server;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	return strcmp(mux->server, server) ? 0 : CMP_MATCH;
+}
+
 static int load_module(void)
 {
 	ast_verb(5, "Loading AudioSocket Support module\n");
+	muxes = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, 17,
+		audiosocket_mux_hash, NULL, audiosocket_mux_cmp);
+	if (!muxes) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
 static int unload_module(void)
 {
 	ast_verb(5, "Unloading AudioSocket Support module\n");
+	ao2_cleanup(muxes);
+	muxes = NULL;
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
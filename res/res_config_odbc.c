@@ -103,27 +103,17 @@ static inline int is_text(const struct odbc_cache_columns *column)
 
 static SQLHSTMT custom_prepare(struct odbc_obj *obj, void *data)
 {
-	int res, x = 1, count = 0;
+	int x = 1, count = 0;
 	struct custom_prepare_struct *cps = data;
 	const struct ast_variable *field;
 	char encodebuf[1024];
 	SQLHSTMT stmt;
 
-	res = SQLAllocHandle(SQL_HANDLE_STMT, obj->con, &stmt);
-	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
-		ast_log(LOG_WARNING, "SQL Alloc Handle failed!\n");
-		return NULL;
-	}
-
 	ast_debug(1, "Skip: %llu; SQL: %s\n", cps->skip, cps->sql);
 
-	res = ast_odbc_prepare(obj, stmt, cps->sql);
-	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
-		if (res == SQL_ERROR) {
-			ast_odbc_print_errors(SQL_HANDLE_STMT, stmt, "SQL Prepare");
-		}
-		ast_log(LOG_WARNING, "SQL Prepare failed! [%s]\n", cps->sql);
-		SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+	/* The same lookups are done over and over, so reuse the statements prepared for them */
+	stmt = ast_odbc_prepare_cached(obj, cps->sql);
+	if (!stmt) {
 		return NULL;
 	}
 
@@ -230,20 +220,20 @@ static struct ast_variable *realtime_odbc(const char *database, const char *tabl
 	res = SQLNumResultCols(stmt, &colcount);
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
 		ast_log(LOG_WARNING, "SQL Column Count error! [%s]\n", ast_str_buffer(sql));
-		SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_stmt(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
 
 	res = SQLFetch(stmt);
 	if (res == SQL_NO_DATA) {
-		SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_stmt(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
 		ast_log(LOG_WARNING, "SQL Fetch error! [%s]\n", ast_str_buffer(sql));
-		SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_stmt(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
@@ -323,7 +313,7 @@ static struct ast_variable *realtime_odbc(const char *database, const char *tabl
 		}
 	}
 
-	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_stmt(obj, stmt);
 	ast_odbc_release_obj(obj);
 	return var;
 }
@@ -413,7 +403,7 @@ static struct ast_config *realtime_multi_odbc(const char *database, const char *
 	res = SQLNumResultCols(stmt, &colcount);
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
 		ast_log(LOG_WARNING, "SQL Column Count error! [%s]\n", ast_str_buffer(sql));
-		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_stmt(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
@@ -421,7 +411,7 @@ static struct ast_config *realtime_multi_odbc(const char *database, const char *
 	cfg = ast_config_new();
 	if (!cfg) {
 		ast_log(LOG_WARNING, "Out of memory!\n");
-		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_stmt(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
@@ -499,7 +489,7 @@ static struct ast_config *realtime_multi_odbc(const char *database, const char *
 next_sql_fetch:;
 	}
 
-	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_stmt(obj, stmt);
 	ast_odbc_release_obj(obj);
 	return cfg;
 }
@@ -584,7 +574,7 @@ static int update_odbc(const char *database, const char *table, const char *keyf
 	}
 
 	res = SQLRowCount(stmt, &rowcount);
-	SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_stmt(obj, stmt);
 	ast_odbc_release_obj(obj);
 
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
@@ -797,7 +787,7 @@ static int store_odbc(const char *database, const char *table, const struct ast_
 	}
 
 	res = SQLRowCount(stmt, &rowcount);
-	SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_stmt(obj, stmt);
 	ast_odbc_release_obj(obj);
 
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
@@ -867,7 +857,7 @@ static int destroy_odbc(const char *database, const char *table, const char *key
 	}
 
 	res = SQLRowCount(stmt, &rowcount);
-	SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_stmt(obj, stmt);
 	ast_odbc_release_obj(obj);
 
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
@@ -36,6 +36,11 @@
 #include "asterisk/module.h"
 #include "asterisk/cli.h"
 #include "asterisk/file.h"
+#include "asterisk/mod_format.h"
+#include "asterisk/translate.h"
+
+/*! \brief How many frames are read from the input file and translated at once */
+#define CONVERT_BATCH_FRAMES 50
 
 /*! \brief Split the filename to basename and extension */
 static int split_ext(char *filename, char **name, char **ext)
@@ -65,6 +70,7 @@ static char *handle_cli_file_convert(struct ast_cli_entry *e, int cmd, struct as
 {
 	char *ret = CLI_FAILURE;
 	struct ast_filestream *fs_in = NULL, *fs_out = NULL;
+	struct ast_trans_pvt *trans = NULL;
 	struct ast_frame *f;
 	struct timeval start;
 	int cost;
@@ -112,15 +118,52 @@ static char *handle_cli_file_convert(struct ast_cli_entry *e, int cmd, struct as
 		goto fail_out;
 	}
 
+	if (ast_format_cmp(fs_in->fmt->format, fs_out->fmt->format) == AST_FORMAT_CMP_NOT_EQUAL) {
+		trans = ast_translator_build_path(fs_out->fmt->format, fs_in->fmt->format);
+		if (!trans) {
+			ast_cli(a->fd, "Unable to translate from %s to %s\n",
+				ast_format_get_name(fs_in->fmt->format), ast_format_get_name(fs_out->fmt->format));
+			goto fail_out;
+		}
+	}
+
 	start = ast_tvnow();
 
-	while ((f = ast_readframe(fs_in))) {
-		if (ast_writestream(fs_out, f)) {
+	for (;;) {
+		struct ast_frame *frames = NULL;
+		struct ast_frame *tail = NULL;
+		int count = 0;
+
+		/* Each step of the translation path handles a batch of frames at once */
+		while (count < CONVERT_BATCH_FRAMES && (f = ast_readframe(fs_in))) {
+			if (tail) {
+				AST_LIST_NEXT(tail, frame_list) = f;
+			} else {
+				frames = f;
+			}
+			tail = f;
+			count++;
+		}
+		if (!frames) {
+			break;
+		}
+		if (trans) {
+			frames = ast_translate_list(trans, frames, 1);
+		}
+
+		while ((f = frames)) {
+			frames = AST_LIST_NEXT(f, frame_list);
+			AST_LIST_NEXT(f, frame_list) = NULL;
+			if (ast_writestream(fs_out, f)) {
+				ast_frfree(f);
+				if (frames) {
+					ast_frfree(frames);
+				}
+				ast_cli(a->fd, "Failed to convert %s.%s to %s.%s!\n", name_in, ext_in, name_out, ext_out);
+				goto fail_out;
+			}
 			ast_frfree(f);
-			ast_cli(a->fd, "Failed to convert %s.%s to %s.%s!\n", name_in, ext_in, name_out, ext_out);
-			goto fail_out;
 		}
-		ast_frfree(f);
 	}
 
 	cost = ast_tvdiff_ms(ast_tvnow(), start);
@@ -128,6 +171,10 @@ static char *handle_cli_file_convert(struct ast_cli_entry *e, int cmd, struct as
 	ret = CLI_SUCCESS;
 
 fail_out:
+	if (trans) {
+		ast_translator_free_path(trans);
+	}
+
 	if (fs_out) {
 		ast_closestream(fs_out);
 		if (ret != CLI_SUCCESS)
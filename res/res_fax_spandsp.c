@@ -62,6 +62,12 @@
 #include "asterisk/res_fax.h"
 #include "asterisk/channel.h"
 #include "asterisk/format_cache.h"
+#include "asterisk/affinity.h"
+#include "asterisk/alertpipe.h"
+#include "asterisk/config.h"
+#include "asterisk/poll-compat.h"
+#include "asterisk/time.h"
+#include "asterisk/vector.h"
 
 #define SPANDSP_EXPOSE_INTERNAL_STRUCTURES
 #include <spandsp.h>
@@ -70,6 +76,14 @@
 #define SPANDSP_FAX_SAMPLES 160
 #define SPANDSP_FAX_TIMER_RATE 8000 / SPANDSP_FAX_SAMPLES	/* 50 ticks per second, 20ms, 160 samples per second */
 #define SPANDSP_ENGAGE_UDPTL_NAT_RETRY 3
+/*! The most received audio a session keeps for its DSP worker, in samples */
+#define SPANDSP_DSP_RX_SAMPLES (SPANDSP_FAX_SAMPLES * 8)
+/*! How long a DSP worker waits for a tick before checking whether to stop */
+#define SPANDSP_DSP_WORKER_POLL_MS 100
+#define SPANDSP_MAX_DSP_WORKERS 128
+
+static unsigned int dspworkers; /*!< Number of threads running the modems of FAX sessions (set in res_fax.conf) */
+static int dspworker_affinity; /*!< Whether each DSP worker is pinned to a CPU (set in res_fax.conf) */
 
 static void *spandsp_fax_new(struct ast_fax_session *s, struct ast_fax_tech_token *token);
 static void spandsp_fax_destroy(struct ast_fax_session *s);
@@ -162,8 +176,69 @@ struct spandsp_pvt {
 
 	int v21_detected;
 	modem_connect_tones_rx_state_t *tone_state;
+
+	/*! The worker running the modem, NULL if the channel thread does */
+	struct spandsp_dsp_worker *worker;
+	AST_LIST_ENTRY(spandsp_pvt) worker_list;
+	/*! Protects the modem and read_frames while a worker runs the session */
+	ast_mutex_t lock;
+	/*! Readable while frames are queued or the session is done, if a worker runs the session */
+	int alert[2];
+	/*! Set while the alert pipe is readable */
+	unsigned int alerted:1;
+	/*! Set once the worker runs the session */
+	unsigned int dsp_running:1;
+	/*! Audio received, waiting for the worker */
+	int16_t rx[SPANDSP_DSP_RX_SAMPLES];
+	/*! How many samples of rx are waiting */
+	int rx_samples;
+	/*! How many times received audio was dropped, the worker falling behind */
+	unsigned int rx_overruns;
+	/*! Worker ticks spent on the session */
+	uint64_t dsp_ticks;
+	/*! Worker time spent on the session, in microseconds */
+	uint64_t dsp_time;
 };
 
+/*!
+ * \brief A thread running the modems of FAX sessions
+ *
+ * Every 20ms the worker runs the modems of all of its sessions in one go,
+ * handing them the audio their channels wrote since and queueing the
+ * audio and T.38 they send for their channels to read.  The channels only
+ * wake when there is something for them, rather than on a timer of their
+ * own, and the modem work of many sessions is spread over a few threads
+ * rather than over all of their channels.
+ */
+struct spandsp_dsp_worker {
+	/*! The thread */
+	pthread_t thread;
+	/*! Set when the thread should stop */
+	int stop;
+	/*! Which of the workers this is */
+	unsigned int index;
+	/*! Ticks every 20ms */
+	struct ast_timer *timer;
+	/*! How many sessions use the worker, protected by dsp_workers_lock */
+	unsigned int session_count;
+	/*! Protects sessions and the statistics */
+	ast_mutex_t lock;
+	/*! The sessions run every tick */
+	AST_LIST_HEAD_NOLOCK(, spandsp_pvt) sessions;
+	/*! Ticks run */
+	uint64_t ticks;
+	/*! Sessions run, over all ticks */
+	uint64_t session_ticks;
+	/*! Time spent running sessions, in microseconds */
+	uint64_t busy;
+	/*! The longest tick, in microseconds */
+	uint64_t busy_max;
+};
+
+/*! \brief The DSP workers, protected by dsp_workers_lock */
+static AST_VECTOR(, struct spandsp_dsp_worker *) dsp_workers;
+AST_MUTEX_DEFINE_STATIC(dsp_workers_lock);
+
 static int spandsp_v21_new(struct spandsp_pvt *p);
 static void session_destroy(struct spandsp_pvt *p);
 static int t38_tx_packet_handler(t38_core_state_t *t38_core_state, void *data, const uint8_t *buf, int len, int count);
@@ -208,8 +283,10 @@ static void session_destroy(struct spandsp_pvt *p)
 	t30_terminate(t30_to_terminate);
 	p->isdone = 1;
 
-	ast_timer_close(p->timer);
-	p->timer = NULL;
+	if (p->timer) {
+		ast_timer_close(p->timer);
+		p->timer = NULL;
+	}
 	fax_release(&p->fax_state);
 	t38_terminal_release(&p->t38_state);
 
@@ -253,7 +330,8 @@ static int t38_tx_packet_handler(t38_core_state_t *t38_core_state, void *data, c
 		}
 		ast_frfree(f);
 	} else {
-		/* no need to lock, this all runs in the same thread */
+		/* no need to lock, this all runs in the same thread, or with
+		 * p->lock held when a DSP worker runs the session */
 		AST_LIST_INSERT_TAIL(&p->read_frames, f, frame_list);
 		res = 0;
 	}
@@ -556,6 +634,298 @@ static int spandsp_modems(struct ast_fax_session_details *details)
 	return modems;
 }
 
+/*!
+ * \internal
+ * \brief Wake the channel of a session run by a worker if there is something for it
+ *
+ * \pre p->lock is held
+ */
+static void spandsp_dsp_alert(struct spandsp_pvt *p)
+{
+	if (!p->worker || p->alerted) {
+		return;
+	}
+
+	if (p->isdone || !AST_LIST_EMPTY(&p->read_frames)) {
+		ast_alertpipe_write(p->alert);
+		p->alerted = 1;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Run the modem of a session for a tick
+ *
+ * \pre p->lock is held
+ */
+static void spandsp_dsp_run(struct spandsp_pvt *p)
+{
+	uint8_t buffer[AST_FRIENDLY_OFFSET + SPANDSP_FAX_SAMPLES * sizeof(uint16_t)];
+	int16_t *buf = (int16_t *) (buffer + AST_FRIENDLY_OFFSET);
+	int samples;
+	struct ast_frame fax_frame = {
+		.frametype = AST_FRAME_VOICE,
+		.src = "res_fax_spandsp_g711",
+		.subclass.format = ast_format_slin,
+	};
+	struct ast_frame *f;
+
+	if (p->isdone) {
+		return;
+	}
+
+	if (p->ist38) {
+		t38_terminal_send_timeout(&p->t38_state, SPANDSP_FAX_SAMPLES);
+	} else {
+		if (p->rx_samples) {
+			fax_rx(&p->fax_state, p->rx, p->rx_samples);
+			p->rx_samples = 0;
+		}
+		if ((samples = fax_tx(&p->fax_state, buf, SPANDSP_FAX_SAMPLES)) > 0) {
+			fax_frame.samples = samples;
+			AST_FRAME_SET_BUFFER(&fax_frame, buffer, AST_FRIENDLY_OFFSET, samples * sizeof(int16_t));
+			if ((f = ast_frisolate(&fax_frame))) {
+				AST_LIST_INSERT_TAIL(&p->read_frames, f, frame_list);
+			}
+		}
+	}
+
+	spandsp_dsp_alert(p);
+}
+
+/*! \brief Thread which runs the modems of the sessions of a worker every 20ms */
+static void *spandsp_dsp_worker_thread(void *data)
+{
+	struct spandsp_dsp_worker *worker = data;
+	struct pollfd pfd = { .fd = ast_timer_fd(worker->timer), .events = POLLIN, };
+	struct spandsp_pvt *p;
+	struct timeval start;
+	struct timeval session_start;
+	int64_t elapsed;
+
+	/* Pinned workers are spread over the media CPUs of asterisk.conf */
+	ast_thread_affinity_apply(AST_THREAD_AFFINITY_MEDIA, dspworker_affinity ? (int) worker->index : -1);
+
+	while (!worker->stop) {
+		if (ast_poll(&pfd, 1, SPANDSP_DSP_WORKER_POLL_MS) <= 0) {
+			continue;
+		}
+		if (ast_timer_ack(worker->timer, 1) < 0) {
+			ast_log(LOG_ERROR, "Failed to acknowledge timer for FAX DSP worker %u\n", worker->index);
+			continue;
+		}
+
+		ast_mutex_lock(&worker->lock);
+		start = ast_tvnow();
+		AST_LIST_TRAVERSE(&worker->sessions, p, worker_list) {
+			session_start = ast_tvnow();
+			ast_mutex_lock(&p->lock);
+			spandsp_dsp_run(p);
+			p->dsp_time += ast_tvdiff_us(ast_tvnow(), session_start);
+			p->dsp_ticks++;
+			ast_mutex_unlock(&p->lock);
+			worker->session_ticks++;
+		}
+		elapsed = ast_tvdiff_us(ast_tvnow(), start);
+		worker->ticks++;
+		worker->busy += elapsed;
+		if (elapsed > worker->busy_max) {
+			worker->busy_max = elapsed;
+		}
+		ast_mutex_unlock(&worker->lock);
+	}
+
+	return NULL;
+}
+
+static void spandsp_dsp_worker_destroy(struct spandsp_dsp_worker *worker)
+{
+	if (worker->thread != AST_PTHREADT_NULL) {
+		worker->stop = 1;
+		pthread_join(worker->thread, NULL);
+	}
+	if (worker->timer) {
+		ast_timer_close(worker->timer);
+	}
+	ast_mutex_destroy(&worker->lock);
+	ast_free(worker);
+}
+
+static struct spandsp_dsp_worker *spandsp_dsp_worker_create(unsigned int index)
+{
+	struct spandsp_dsp_worker *worker;
+
+	worker = ast_calloc(1, sizeof(*worker));
+	if (!worker) {
+		return NULL;
+	}
+	worker->index = index;
+	worker->thread = AST_PTHREADT_NULL;
+	ast_mutex_init(&worker->lock);
+
+	if (!(worker->timer = ast_timer_open())) {
+		ast_log(LOG_ERROR, "FAX DSP worker %u failed to create timing source.\n", index);
+		spandsp_dsp_worker_destroy(worker);
+		return NULL;
+	}
+	if (ast_timer_set_rate(worker->timer, SPANDSP_FAX_TIMER_RATE)) {
+		ast_log(LOG_ERROR, "FAX DSP worker %u error setting rate on timing source.\n", index);
+		spandsp_dsp_worker_destroy(worker);
+		return NULL;
+	}
+
+	if (ast_pthread_create_background(&worker->thread, NULL, spandsp_dsp_worker_thread, worker)) {
+		worker->thread = AST_PTHREADT_NULL;
+		spandsp_dsp_worker_destroy(worker);
+		return NULL;
+	}
+
+	return worker;
+}
+
+/*!
+ * \internal
+ * \brief Have a DSP worker run the modem of a session
+ *
+ * The worker with the fewest sessions is used, unless fewer than
+ * configured have been started yet.  The worker only runs the session
+ * once it is started.
+ *
+ * \retval 0 on success
+ * \retval -1 on failure, the channel thread runs the modem then
+ */
+static int spandsp_dsp_worker_join(struct spandsp_pvt *p)
+{
+	struct spandsp_dsp_worker *worker = NULL;
+	int i;
+
+	if (!dspworkers) {
+		return -1;
+	}
+
+	if (ast_alertpipe_init(p->alert)) {
+		return -1;
+	}
+
+	ast_mutex_lock(&dsp_workers_lock);
+	for (i = 0; i < AST_VECTOR_SIZE(&dsp_workers) && i < dspworkers; ++i) {
+		struct spandsp_dsp_worker *candidate = AST_VECTOR_GET(&dsp_workers, i);
+
+		if (!worker || candidate->session_count < worker->session_count) {
+			worker = candidate;
+		}
+	}
+	if (i < dspworkers && (!worker || worker->session_count)) {
+		struct spandsp_dsp_worker *created = spandsp_dsp_worker_create(i);
+
+		if (created) {
+			if (AST_VECTOR_APPEND(&dsp_workers, created)) {
+				spandsp_dsp_worker_destroy(created);
+			} else {
+				worker = created;
+			}
+		}
+	}
+	if (!worker) {
+		ast_mutex_unlock(&dsp_workers_lock);
+		ast_alertpipe_close(p->alert);
+		return -1;
+	}
+	++worker->session_count;
+	ast_mutex_unlock(&dsp_workers_lock);
+
+	ast_mutex_init(&p->lock);
+	p->worker = worker;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Stop the DSP worker of a session running its modem
+ */
+static void spandsp_dsp_worker_leave(struct spandsp_pvt *p)
+{
+	struct spandsp_dsp_worker *worker = p->worker;
+
+	if (p->dsp_running) {
+		ast_mutex_lock(&worker->lock);
+		AST_LIST_REMOVE(&worker->sessions, p, worker_list);
+		ast_mutex_unlock(&worker->lock);
+		p->dsp_running = 0;
+	}
+
+	ast_mutex_lock(&dsp_workers_lock);
+	--worker->session_count;
+	ast_mutex_unlock(&dsp_workers_lock);
+
+	p->worker = NULL;
+	ast_mutex_destroy(&p->lock);
+	ast_alertpipe_close(p->alert);
+}
+
+/*!
+ * \internal
+ * \brief Read a frame queued by the DSP worker of a session
+ */
+static struct ast_frame *spandsp_dsp_read(struct ast_fax_session *s)
+{
+	struct spandsp_pvt *p = s->tech_pvt;
+	struct ast_frame *f;
+
+	ast_mutex_lock(&p->lock);
+	if (p->alerted) {
+		ast_alertpipe_read(p->alert);
+		p->alerted = 0;
+	}
+
+	if (p->isdone) {
+		ast_mutex_unlock(&p->lock);
+		s->state = AST_FAX_STATE_COMPLETE;
+		ast_debug(5, "FAX session '%u' is complete.\n", s->id);
+		return NULL;
+	}
+
+	f = AST_LIST_REMOVE_HEAD(&p->read_frames, frame_list);
+	spandsp_dsp_alert(p);
+	ast_mutex_unlock(&p->lock);
+
+	return f ? f : &ast_null_frame;
+}
+
+/*!
+ * \internal
+ * \brief Write a frame to a session run by a DSP worker
+ *
+ * Audio is kept for the worker to hand to the modem on its next tick.
+ * T.38 packets are handed to the T.38 stack right away, which is cheap
+ * and sends any response as soon as it can.
+ */
+static int spandsp_dsp_write(struct ast_fax_session *s, const struct ast_frame *f)
+{
+	struct spandsp_pvt *p = s->tech_pvt;
+	int samples;
+	int res = 0;
+
+	ast_mutex_lock(&p->lock);
+	if (p->ist38) {
+		res = t38_core_rx_ifp_packet(p->t38_core_state, f->data.ptr, f->datalen, f->seqno);
+		spandsp_dsp_alert(p);
+	} else {
+		samples = MIN(f->samples, SPANDSP_DSP_RX_SAMPLES - p->rx_samples);
+		if (samples < f->samples) {
+			p->rx_overruns++;
+		}
+		if (samples > 0) {
+			memcpy(p->rx + p->rx_samples, f->data.ptr, samples * sizeof(int16_t));
+			p->rx_samples += samples;
+		}
+	}
+	ast_mutex_unlock(&p->lock);
+
+	return res;
+}
+
 /*! \brief create an instance of the spandsp tech_pvt for a fax session */
 static void *spandsp_fax_new(struct ast_fax_session *s, struct ast_fax_tech_token *token)
 {
@@ -566,6 +936,7 @@ static void *spandsp_fax_new(struct ast_fax_session *s, struct ast_fax_tech_toke
 		ast_log(LOG_ERROR, "Cannot initialize the spandsp private FAX technology structure.\n");
 		goto e_return;
 	}
+	ast_alertpipe_clear(p->alert);
 
 	if (s->details->caps & AST_FAX_TECH_V21_DETECT) {
 		if (spandsp_v21_new(p)) {
@@ -592,13 +963,15 @@ static void *spandsp_fax_new(struct ast_fax_session *s, struct ast_fax_tech_toke
 		goto e_free;
 	}
 
-	if (!(p->timer = ast_timer_open())) {
+	if (!spandsp_dsp_worker_join(p)) {
+		s->fd = ast_alertpipe_readfd(p->alert);
+	} else if ((p->timer = ast_timer_open())) {
+		s->fd = ast_timer_fd(p->timer);
+	} else {
 		ast_log(LOG_ERROR, "Channel '%s' FAX session '%u' failed to create timing source.\n", s->channame, s->id);
 		goto e_free;
 	}
 
-	s->fd = ast_timer_fd(p->timer);
-
 	p->stats = &spandsp_global_stats.g711;
 
 	if (s->details->caps & (AST_FAX_TECH_T38 | AST_FAX_TECH_AUDIO)) {
@@ -644,6 +1017,9 @@ static void spandsp_fax_destroy(struct ast_fax_session *s)
 	} else if (s->details->caps & AST_FAX_TECH_V21_DETECT) {
 		spandsp_v21_cleanup(s);
 	} else {
+		if (p->worker) {
+			spandsp_dsp_worker_leave(p);
+		}
 		session_destroy(p);
 	}
 
@@ -668,6 +1044,10 @@ static struct ast_frame *spandsp_fax_read(struct ast_fax_session *s)
 	};
 	struct ast_frame *f = &fax_frame;
 
+	if (p->worker) {
+		return spandsp_dsp_read(s);
+	}
+
 	if (ast_timer_ack(p->timer, 1) < 0) {
 		ast_log(LOG_ERROR, "Failed to acknowledge timer for FAX session '%u'\n", s->id);
 		return NULL;
@@ -784,6 +1164,10 @@ static int spandsp_fax_write(struct ast_fax_session *s, const struct ast_frame *
 		return -1;
 	}
 
+	if (p->worker) {
+		return spandsp_dsp_write(s, f);
+	}
+
 	if (p->ist38) {
 		return t38_core_rx_ifp_packet(p->t38_core_state, f->data.ptr, f->datalen, f->seqno);
 	} else {
@@ -1026,8 +1410,16 @@ static int spandsp_fax_start(struct ast_fax_session *s)
 	}
 
 
-	/* start the timer */
-	if (ast_timer_set_rate(p->timer, SPANDSP_FAX_TIMER_RATE)) {
+	if (p->worker) {
+		/* have the worker run the session, unless it already does */
+		if (!p->dsp_running) {
+			ast_mutex_lock(&p->worker->lock);
+			AST_LIST_INSERT_TAIL(&p->worker->sessions, p, worker_list);
+			ast_mutex_unlock(&p->worker->lock);
+			p->dsp_running = 1;
+		}
+	} else if (ast_timer_set_rate(p->timer, SPANDSP_FAX_TIMER_RATE)) {
+		/* start the timer */
 		ast_log(LOG_ERROR, "FAX session '%u' error setting rate on timing source.\n", s->id);
 		return -1;
 	}
@@ -1047,8 +1439,15 @@ static int spandsp_fax_cancel(struct ast_fax_session *s)
 		return 0;
 	}
 
+	if (p->worker) {
+		ast_mutex_lock(&p->lock);
+	}
 	t30_terminate(p->t30_state);
 	p->isdone = 1;
+	if (p->worker) {
+		spandsp_dsp_alert(p);
+		ast_mutex_unlock(&p->lock);
+	}
 	return 0;
 }
 
@@ -1057,6 +1456,13 @@ static int spandsp_fax_switch_to_t38(struct ast_fax_session *s)
 {
 	struct spandsp_pvt *p = s->tech_pvt;
 
+	/* keep the worker off the modem while it is switched, the session
+	 * stays with the worker when started again */
+	if (p->worker) {
+		ast_mutex_lock(&p->lock);
+		p->rx_samples = 0;
+	}
+
 	/* prevent the phase E handler from running, this is not a real termination */
 	t30_set_phase_e_handler(p->t30_state, NULL, NULL);
 
@@ -1069,6 +1475,10 @@ static int spandsp_fax_switch_to_t38(struct ast_fax_session *s)
 	p->stats = &spandsp_global_stats.t38;
 	spandsp_fax_start(s);
 
+	if (p->worker) {
+		ast_mutex_unlock(&p->lock);
+	}
+
 	return 0;
 }
 
@@ -1131,6 +1541,17 @@ static char *spandsp_fax_cli_show_session(struct ast_fax_session *s, int fd)
 			ast_cli(fd, "%-22s : %d\n", "Longest Bad Line Run", stats.longest_bad_row_run);
 			ast_cli(fd, "%-22s : %d\n", "Total Bad Lines", stats.bad_rows);
 		}
+		if (p->worker) {
+			ast_mutex_lock(&p->lock);
+			ast_cli(fd, "\nDSP Statistics:\n");
+			ast_cli(fd, "%-22s : %u\n", "DSP Worker", p->worker->index);
+			ast_cli(fd, "%-22s : %" PRIu64 "\n", "DSP Ticks", p->dsp_ticks);
+			ast_cli(fd, "%-22s : %" PRIu64 "\n", "DSP Time (us)", p->dsp_time);
+			ast_cli(fd, "%-22s : %" PRIu64 "\n", "DSP Time/Tick (us)",
+				p->dsp_ticks ? p->dsp_time / p->dsp_ticks : 0);
+			ast_cli(fd, "%-22s : %u\n", "Audio Overruns", p->rx_overruns);
+			ast_mutex_unlock(&p->lock);
+		}
 	}
 	ao2_unlock(s);
 	ast_cli(fd, "\n\n");
@@ -1262,20 +1683,73 @@ static char *spandsp_fax_cli_show_stats(int fd)
 	ast_cli(fd, "%-20.20s : %d\n", "Unknown Error", spandsp_global_stats.t38.unknown_error);
 	ast_mutex_unlock(&spandsp_global_stats.lock);
 
+	ast_mutex_lock(&dsp_workers_lock);
+	if (AST_VECTOR_SIZE(&dsp_workers)) {
+		int i;
+
+		ast_cli(fd, "\n%-20.20s\n", "Spandsp DSP Workers");
+		ast_cli(fd, "%-6s %8s %12s %12s %12s %16s\n", "Worker", "Sessions", "Ticks",
+			"Avg Tick(us)", "Max Tick(us)", "Avg Session(us)");
+		for (i = 0; i < AST_VECTOR_SIZE(&dsp_workers); ++i) {
+			struct spandsp_dsp_worker *worker = AST_VECTOR_GET(&dsp_workers, i);
+
+			ast_mutex_lock(&worker->lock);
+			ast_cli(fd, "%-6u %8u %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %16" PRIu64 "\n",
+				worker->index, worker->session_count, worker->ticks,
+				worker->ticks ? worker->busy / worker->ticks : 0, worker->busy_max,
+				worker->session_ticks ? worker->busy / worker->session_ticks : 0);
+			ast_mutex_unlock(&worker->lock);
+		}
+	}
+	ast_mutex_unlock(&dsp_workers_lock);
+
 	return CLI_SUCCESS;
 }
 
 /*! \brief Show res_fax_spandsp settings */
 static char *spandsp_fax_cli_show_settings(int fd)
 {
-	/* no settings at the moment */
+	ast_cli(fd, "\tDSP Workers: %u%s\n", dspworkers,
+		dspworkers && dspworker_affinity ? " (pinned)" : "");
+	ast_cli(fd, "\n");
 	return CLI_SUCCESS;
 }
 
+/*! \brief Load the [spandsp] settings of res_fax.conf */
+static void spandsp_load_config(void)
+{
+	struct ast_flags config_flags = { 0 };
+	struct ast_config *cfg;
+	const char *value;
+
+	dspworkers = 0;
+	dspworker_affinity = 0;
+
+	cfg = ast_config_load2("res_fax.conf", "res_fax_spandsp", config_flags);
+	if (!cfg || cfg == CONFIG_STATUS_FILEINVALID) {
+		return;
+	}
+
+	if ((value = ast_variable_retrieve(cfg, "spandsp", "dspworkers"))) {
+		if (sscanf(value, "%30u", &dspworkers) != 1 || dspworkers > SPANDSP_MAX_DSP_WORKERS) {
+			ast_log(LOG_WARNING, "Invalid dspworkers '%s' in res_fax.conf, must be 0 to %d. Using 0.\n",
+				value, SPANDSP_MAX_DSP_WORKERS);
+			dspworkers = 0;
+		}
+	}
+	if ((value = ast_variable_retrieve(cfg, "spandsp", "dspworker_affinity"))) {
+		dspworker_affinity = ast_true(value);
+	}
+
+	ast_config_destroy(cfg);
+}
+
 /*! \brief unload res_fax_spandsp */
 static int unload_module(void)
 {
 	ast_fax_tech_unregister(&spandsp_fax_tech);
+	AST_VECTOR_CALLBACK_VOID(&dsp_workers, spandsp_dsp_worker_destroy);
+	AST_VECTOR_FREE(&dsp_workers);
 	ast_mutex_destroy(&spandsp_global_stats.lock);
 	return AST_MODULE_LOAD_SUCCESS;
 }
@@ -1284,9 +1758,16 @@ static int unload_module(void)
 static int load_module(void)
 {
 	ast_mutex_init(&spandsp_global_stats.lock);
+	spandsp_load_config();
+	if (AST_VECTOR_INIT(&dsp_workers, dspworkers)) {
+		ast_mutex_destroy(&spandsp_global_stats.lock);
+		return AST_MODULE_LOAD_DECLINE;
+	}
 	spandsp_fax_tech.module = ast_module_info->self;
 	if (ast_fax_tech_register(&spandsp_fax_tech) < 0) {
 		ast_log(LOG_ERROR, "failed to register FAX technology\n");
+		AST_VECTOR_FREE(&dsp_workers);
+		ast_mutex_destroy(&spandsp_global_stats.lock);
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
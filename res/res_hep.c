@@ -37,6 +37,7 @@
  */
 
 /*** MODULEINFO
+	<use type="external">zlib</use>
 	<support_level>extended</support_level>
  ***/
 
@@ -81,6 +82,29 @@
 				<configOption name="capture_name" default="">
 					<synopsis>The name for this capture agent.</synopsis>
 				</configOption>
+				<configOption name="compress" default="no">
+					<synopsis>Compress the payload of packets sent to Homer.</synopsis>
+					<description><para>
+						If enabled, payloads are compressed with zlib, and are only
+						sent compressed when that makes them smaller.  Requires
+						Asterisk to be built with zlib.
+					</para></description>
+				</configOption>
+				<configOption name="sip_sample_percent" default="100">
+					<synopsis>The percentage of calls whose SIP messages are sent to Homer.</synopsis>
+					<description><para>
+						Calls are sampled by their UUID, so either all the SIP messages
+						of a call are sent or none of them are.
+					</para></description>
+				</configOption>
+				<configOption name="rtcp_sample_percent" default="100">
+					<synopsis>The percentage of calls whose RTCP reports are sent to Homer.</synopsis>
+					<description><para>
+						Calls are sampled by their UUID, the same as
+						<replaceable>sip_sample_percent</replaceable>, so with equal
+						percentages the same calls are sampled for both.
+					</para></description>
+				</configOption>
 			</configObject>
 		</configFile>
 	</configInfo>
@@ -98,6 +122,12 @@
 #include <netinet/tcp.h>
 #include <netinet/udp.h>
 #include <netinet/ip6.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 /*! Generic vendor ID. Used for HEPv3 standard packets */
 #define GENERIC_VENDOR_ID 0x0000
@@ -243,6 +273,9 @@ struct hepv3_global_config {
 	unsigned int enabled;                    /*!< Whether or not sending is enabled */
 	unsigned int capture_id;                 /*!< Capture ID for this agent */
 	enum hep_uuid_type uuid_type;            /*!< The preferred type of the UUID */
+	unsigned int compress;                   /*!< Whether payloads are compressed */
+	unsigned int sip_sample_percent;         /*!< Percentage of calls whose SIP messages are sent */
+	unsigned int rtcp_sample_percent;        /*!< Percentage of calls whose RTCP reports are sent */
 	AST_DECLARE_STRING_FIELDS(
 		AST_STRING_FIELD(capture_address);   /*!< Address to send to */
 		AST_STRING_FIELD(capture_password);  /*!< Password for Homer server */
@@ -410,7 +443,9 @@ static void capture_info_dtor(void *obj)
 	struct hepv3_capture_info *info = obj;
 
 	ast_free(info->uuid);
-	ast_free(info->payload);
+	if (info->payload != info + 1) {
+		ast_free(info->payload);
+	}
 }
 
 enum hep_uuid_type hepv3_get_uuid_type(void)
@@ -436,16 +471,13 @@ struct hepv3_capture_info *hepv3_create_capture_info(const void *payload, size_t
 {
 	struct hepv3_capture_info *info;
 
-	info = ao2_alloc(sizeof(*info), capture_info_dtor);
+	/* The payload is kept with the capture info, so capturing is one allocation */
+	info = ao2_alloc_options(sizeof(*info) + len, capture_info_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!info) {
 		return NULL;
 	}
 
-	info->payload = ast_malloc(len);
-	if (!info->payload) {
-		ao2_ref(info, -1);
-		return NULL;
-	}
+	info->payload = info + 1;
 	memcpy(info->payload, payload, len);
 	info->len = len;
 
@@ -455,161 +487,331 @@ struct hepv3_capture_info *hepv3_create_capture_info(const void *payload, size_t
 	return info;
 }
 
-/*! \brief Callback function for the \ref hep_queue_tp taskprocessor */
-static int hep_queue_cb(void *data)
-{
-	RAII_VAR(struct module_config *, config, ao2_global_obj_ref(global_config), ao2_cleanup);
-	RAII_VAR(struct hepv3_runtime_data *, hepv3_data, ao2_global_obj_ref(global_data), ao2_cleanup);
-	RAII_VAR(struct hepv3_capture_info *, capture_info, data, ao2_cleanup);
-	struct hep_generic hg_pkt;
-	unsigned int packet_len = 0, sock_buffer_len;
-	struct hep_chunk_ip4 ipv4_src, ipv4_dst;
-	struct hep_chunk_ip6 ipv6_src, ipv6_dst;
-	struct hep_chunk auth_key, payload, uuid, capturename;
-	void *sock_buffer;
-	int res;
-
-	if (!capture_info || !config || !hepv3_data) {
-		return 0;
-	}
+/*! \brief The most packets sent by one system call */
+#define HEP_BATCH_SIZE 64
 
-	if (ast_sockaddr_is_ipv4(&capture_info->src_addr) != ast_sockaddr_is_ipv4(&capture_info->dst_addr)) {
-		ast_log(AST_LOG_NOTICE, "Unable to send packet: Address Family mismatch between source/destination\n");
-		return -1;
-	}
+/*! \brief The most packets waiting to be sent, those captured beyond it are dropped */
+#define HEP_QUEUE_MAX 8192
 
-	packet_len = sizeof(hg_pkt);
+/*! \brief Smallest payload worth compressing */
+#define HEP_COMPRESS_MIN 128
 
-	/* Build HEPv3 header, capture info, and calculate the total packet size */
-	memcpy(hg_pkt.header.id, "\x48\x45\x50\x33", 4);
+#ifdef MSG_WAITFORONE
+/*! sendmmsg() is available */
+#define USE_HEP_BATCH
+#endif
 
-	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt.ip_proto, CHUNK_TYPE_IP_PROTOCOL_ID, capture_info->protocol_id);
-	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt.src_port, CHUNK_TYPE_SRC_PORT, htons(ast_sockaddr_port(&capture_info->src_addr)));
-	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt.dst_port, CHUNK_TYPE_DST_PORT, htons(ast_sockaddr_port(&capture_info->dst_addr)));
-	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt.time_sec, CHUNK_TYPE_TIMESTAMP_SEC, htonl(capture_info->capture_time.tv_sec));
-	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt.time_usec, CHUNK_TYPE_TIMESTAMP_USEC, htonl(capture_info->capture_time.tv_usec));
-	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt.proto_t, CHUNK_TYPE_PROTOCOL_TYPE, capture_info->capture_type);
-	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt.capt_id, CHUNK_TYPE_CAPTURE_AGENT_ID, htonl(config->general->capture_id));
+/*!
+ * \brief A packet being sent
+ *
+ * The chunks of the packet are sent from where they are, the payload and
+ * strings where the capture info and configuration keep them, so that
+ * nothing is copied into a packet buffer.
+ */
+struct hep_packet {
+	struct hep_generic hg_pkt;
+	union {
+		struct {
+			struct hep_chunk_ip4 src;
+			struct hep_chunk_ip4 dst;
+		} ipv4;
+		struct {
+			struct hep_chunk_ip6 src;
+			struct hep_chunk_ip6 dst;
+		} ipv6;
+	} addrs;
+	struct hep_chunk auth_key;
+	struct hep_chunk uuid;
+	struct hep_chunk capturename;
+	struct hep_chunk payload;
+	struct iovec iov[11];
+	/*! The compressed payload, kept for the next packet sent from this slot */
+	unsigned char *zipped;
+	size_t zipped_size;
+};
 
-	if (ast_sockaddr_is_ipv4(&capture_info->src_addr)) {
-		INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt.ip_family,
-			CHUNK_TYPE_IP_PROTOCOL_FAMILY, AF_INET);
+/*! \brief A queue of captured packets */
+AST_VECTOR(hep_capture_queue, struct hepv3_capture_info *);
 
-		INITIALIZE_GENERIC_HEP_CHUNK(&ipv4_src, CHUNK_TYPE_IPV4_SRC_ADDR);
-		inet_pton(AF_INET, ast_sockaddr_stringify_addr(&capture_info->src_addr), &ipv4_src.data);
+/*! \brief Packets waiting for \ref hep_queue_tp to send them */
+static struct hep_capture_queue hep_queue;
+AST_MUTEX_DEFINE_STATIC(hep_queue_lock);
 
-		INITIALIZE_GENERIC_HEP_CHUNK(&ipv4_dst, CHUNK_TYPE_IPV4_DST_ADDR);
-		inet_pton(AF_INET, ast_sockaddr_stringify_addr(&capture_info->dst_addr), &ipv4_dst.data);
+/*! \brief Packets being sent, swapped with \ref hep_queue so both keep their storage */
+static struct hep_capture_queue hep_sending;
 
-		packet_len += (sizeof(ipv4_src) + sizeof(ipv4_dst));
-	} else {
-		INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt.ip_family,
-			CHUNK_TYPE_IP_PROTOCOL_FAMILY, AF_INET6);
+/*! \brief The packets sent by one system call, only used by \ref hep_queue_tp */
+static struct hep_packet hep_packets[HEP_BATCH_SIZE];
+
+#ifdef HAVE_ZLIB
+/*!
+ * \internal
+ * \brief Compress the payload of a packet into its slot
+ *
+ * \retval 0 if the payload was compressed
+ * \retval -1 if it is sent as is
+ */
+static int hep_packet_compress(struct hep_packet *pkt, const struct hepv3_capture_info *capture_info, uLongf *zipped_len)
+{
+	uLongf bound = compressBound(capture_info->len);
 
-		INITIALIZE_GENERIC_HEP_CHUNK(&ipv6_src, CHUNK_TYPE_IPV6_SRC_ADDR);
-		inet_pton(AF_INET6, ast_sockaddr_stringify_addr(&capture_info->src_addr), &ipv6_src.data);
+	if (capture_info->zipped || capture_info->len < HEP_COMPRESS_MIN) {
+		return -1;
+	}
 
-		INITIALIZE_GENERIC_HEP_CHUNK(&ipv6_dst, CHUNK_TYPE_IPV6_DST_ADDR);
-		inet_pton(AF_INET6, ast_sockaddr_stringify_addr(&capture_info->dst_addr), &ipv6_dst.data);
+	if (pkt->zipped_size < bound) {
+		unsigned char *zipped = ast_realloc(pkt->zipped, bound);
 
-		packet_len += (sizeof(ipv6_src) + sizeof(ipv6_dst));
+		if (!zipped) {
+			return -1;
+		}
+		pkt->zipped = zipped;
+		pkt->zipped_size = bound;
 	}
 
-	if (!ast_strlen_zero(config->general->capture_password))  {
-		INITIALIZE_GENERIC_HEP_IDS_VAR(&auth_key, CHUNK_TYPE_AUTH_KEY, strlen(config->general->capture_password));
-		packet_len += (sizeof(auth_key) + strlen(config->general->capture_password));
+	*zipped_len = pkt->zipped_size;
+	if (compress2(pkt->zipped, zipped_len, capture_info->payload, capture_info->len, Z_BEST_SPEED) != Z_OK
+		|| *zipped_len >= capture_info->len) {
+		return -1;
 	}
-	if (!ast_strlen_zero(config->general->capture_name))  {
-		INITIALIZE_GENERIC_HEP_IDS_VAR(&capturename, CHUNK_TYPE_CAPTURE_AGENT_NAME, strlen(config->general->capture_name));
-		packet_len += (sizeof(capturename) + strlen(config->general->capture_name));
+
+	return 0;
+}
+#endif
+
+/*!
+ * \internal
+ * \brief Lay out a packet to send
+ *
+ * \return The number of iovecs of the packet
+ * \retval 0 if it cannot be sent
+ */
+static int hep_packet_build(struct hep_packet *pkt, const struct hepv3_global_config *general,
+	const struct hepv3_capture_info *capture_info)
+{
+	struct hep_generic *hg_pkt = &pkt->hg_pkt;
+	const void *payload = capture_info->payload;
+	size_t payload_len = capture_info->len;
+	int zipped = capture_info->zipped;
+	unsigned int packet_len;
+	int iovcnt = 0;
+	int i;
+
+	if (ast_sockaddr_is_ipv4(&capture_info->src_addr) != ast_sockaddr_is_ipv4(&capture_info->dst_addr)) {
+		ast_log(AST_LOG_NOTICE, "Unable to send packet: Address Family mismatch between source/destination\n");
+		return 0;
 	}
-	INITIALIZE_GENERIC_HEP_IDS_VAR(&uuid, CHUNK_TYPE_UUID, strlen(capture_info->uuid));
-	packet_len += (sizeof(uuid) + strlen(capture_info->uuid));
-	INITIALIZE_GENERIC_HEP_IDS_VAR(&payload,
-		capture_info->zipped ? CHUNK_TYPE_PAYLOAD_ZIP : CHUNK_TYPE_PAYLOAD, capture_info->len);
-	packet_len += (sizeof(payload) + capture_info->len);
-	hg_pkt.header.length = htons(packet_len);
 
-	/* Build the buffer to send */
-	sock_buffer = ast_malloc(packet_len);
-	if (!sock_buffer) {
-		return -1;
+#ifdef HAVE_ZLIB
+	if (general->compress) {
+		uLongf zipped_len;
+
+		if (!hep_packet_compress(pkt, capture_info, &zipped_len)) {
+			payload = pkt->zipped;
+			payload_len = zipped_len;
+			zipped = 1;
+		}
 	}
+#endif
 
-	/* Copy in the header */
-	memcpy(sock_buffer, &hg_pkt, sizeof(hg_pkt));
-	sock_buffer_len = sizeof(hg_pkt);
+#define HEP_IOV(base, len) do { \
+	pkt->iov[iovcnt].iov_base = (void *) (base); \
+	pkt->iov[iovcnt].iov_len = (len); \
+	iovcnt++; \
+	} while (0)
+
+	/* Build HEPv3 header, capture info, and calculate the total packet size */
+	memcpy(hg_pkt->header.id, "\x48\x45\x50\x33", 4);
+
+	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt->ip_proto, CHUNK_TYPE_IP_PROTOCOL_ID, capture_info->protocol_id);
+	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt->src_port, CHUNK_TYPE_SRC_PORT, htons(ast_sockaddr_port(&capture_info->src_addr)));
+	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt->dst_port, CHUNK_TYPE_DST_PORT, htons(ast_sockaddr_port(&capture_info->dst_addr)));
+	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt->time_sec, CHUNK_TYPE_TIMESTAMP_SEC, htonl(capture_info->capture_time.tv_sec));
+	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt->time_usec, CHUNK_TYPE_TIMESTAMP_USEC, htonl(capture_info->capture_time.tv_usec));
+	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt->proto_t, CHUNK_TYPE_PROTOCOL_TYPE, capture_info->capture_type);
+	INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt->capt_id, CHUNK_TYPE_CAPTURE_AGENT_ID, htonl(general->capture_id));
+	HEP_IOV(hg_pkt, sizeof(*hg_pkt));
 
 	/* Addresses */
 	if (ast_sockaddr_is_ipv4(&capture_info->src_addr)) {
-		memcpy(sock_buffer + sock_buffer_len, &ipv4_src, sizeof(ipv4_src));
-		sock_buffer_len += sizeof(ipv4_src);
-		memcpy(sock_buffer + sock_buffer_len, &ipv4_dst, sizeof(ipv4_dst));
-		sock_buffer_len += sizeof(ipv4_dst);
+		struct sockaddr_in *src = (struct sockaddr_in *) &capture_info->src_addr.ss;
+		struct sockaddr_in *dst = (struct sockaddr_in *) &capture_info->dst_addr.ss;
+
+		INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt->ip_family,
+			CHUNK_TYPE_IP_PROTOCOL_FAMILY, AF_INET);
+
+		INITIALIZE_GENERIC_HEP_CHUNK_DATA(&pkt->addrs.ipv4.src, CHUNK_TYPE_IPV4_SRC_ADDR, src->sin_addr);
+		INITIALIZE_GENERIC_HEP_CHUNK_DATA(&pkt->addrs.ipv4.dst, CHUNK_TYPE_IPV4_DST_ADDR, dst->sin_addr);
+		HEP_IOV(&pkt->addrs.ipv4, sizeof(pkt->addrs.ipv4));
 	} else {
-		memcpy(sock_buffer + sock_buffer_len, &ipv6_src, sizeof(ipv6_src));
-		sock_buffer_len += sizeof(ipv6_src);
-		memcpy(sock_buffer + sock_buffer_len, &ipv6_dst, sizeof(ipv6_dst));
-		sock_buffer_len += sizeof(ipv6_dst);
+		struct sockaddr_in6 *src = (struct sockaddr_in6 *) &capture_info->src_addr.ss;
+		struct sockaddr_in6 *dst = (struct sockaddr_in6 *) &capture_info->dst_addr.ss;
+
+		INITIALIZE_GENERIC_HEP_CHUNK_DATA(&hg_pkt->ip_family,
+			CHUNK_TYPE_IP_PROTOCOL_FAMILY, AF_INET6);
+
+		INITIALIZE_GENERIC_HEP_CHUNK_DATA(&pkt->addrs.ipv6.src, CHUNK_TYPE_IPV6_SRC_ADDR, src->sin6_addr);
+		INITIALIZE_GENERIC_HEP_CHUNK_DATA(&pkt->addrs.ipv6.dst, CHUNK_TYPE_IPV6_DST_ADDR, dst->sin6_addr);
+		HEP_IOV(&pkt->addrs.ipv6, sizeof(pkt->addrs.ipv6));
 	}
 
 	/* Auth Key */
-	if (!ast_strlen_zero(config->general->capture_password)) {
-		memcpy(sock_buffer + sock_buffer_len, &auth_key, sizeof(auth_key));
-		sock_buffer_len += sizeof(auth_key);
-		memcpy(sock_buffer + sock_buffer_len, config->general->capture_password, strlen(config->general->capture_password));
-		sock_buffer_len += strlen(config->general->capture_password);
+	if (!ast_strlen_zero(general->capture_password)) {
+		INITIALIZE_GENERIC_HEP_IDS_VAR(&pkt->auth_key, CHUNK_TYPE_AUTH_KEY, strlen(general->capture_password));
+		HEP_IOV(&pkt->auth_key, sizeof(pkt->auth_key));
+		HEP_IOV(general->capture_password, strlen(general->capture_password));
 	}
 
 	/* UUID */
-	memcpy(sock_buffer + sock_buffer_len, &uuid, sizeof(uuid));
-	sock_buffer_len += sizeof(uuid);
-	memcpy(sock_buffer + sock_buffer_len, capture_info->uuid, strlen(capture_info->uuid));
-	sock_buffer_len += strlen(capture_info->uuid);
+	INITIALIZE_GENERIC_HEP_IDS_VAR(&pkt->uuid, CHUNK_TYPE_UUID, strlen(capture_info->uuid));
+	HEP_IOV(&pkt->uuid, sizeof(pkt->uuid));
+	HEP_IOV(capture_info->uuid, strlen(capture_info->uuid));
 
 	/* Capture Agent Name */
-	if (!ast_strlen_zero(config->general->capture_name)) {
-		memcpy(sock_buffer + sock_buffer_len, &capturename, sizeof(capturename));
-		sock_buffer_len += sizeof(capturename);
-		memcpy(sock_buffer + sock_buffer_len, config->general->capture_name, strlen(config->general->capture_name));
-		sock_buffer_len += strlen(config->general->capture_name);
+	if (!ast_strlen_zero(general->capture_name)) {
+		INITIALIZE_GENERIC_HEP_IDS_VAR(&pkt->capturename, CHUNK_TYPE_CAPTURE_AGENT_NAME, strlen(general->capture_name));
+		HEP_IOV(&pkt->capturename, sizeof(pkt->capturename));
+		HEP_IOV(general->capture_name, strlen(general->capture_name));
 	}
 
 	/* Packet! */
-	memcpy(sock_buffer + sock_buffer_len, &payload, sizeof(payload));
-	sock_buffer_len += sizeof(payload);
-	memcpy(sock_buffer + sock_buffer_len, capture_info->payload, capture_info->len);
-	sock_buffer_len += capture_info->len;
+	INITIALIZE_GENERIC_HEP_IDS_VAR(&pkt->payload,
+		zipped ? CHUNK_TYPE_PAYLOAD_ZIP : CHUNK_TYPE_PAYLOAD, payload_len);
+	HEP_IOV(&pkt->payload, sizeof(pkt->payload));
+	HEP_IOV(payload, payload_len);
 
-	ast_assert(sock_buffer_len == packet_len);
+#undef HEP_IOV
 
-	res = ast_sendto(hepv3_data->sockfd, sock_buffer, sock_buffer_len, 0, &hepv3_data->remote_addr);
-	if (res < 0) {
-		ast_log(AST_LOG_ERROR, "Error [%d] while sending packet to HEPv3 server: %s\n",
-			errno, strerror(errno));
-	} else if (res != sock_buffer_len) {
-		ast_log(AST_LOG_WARNING, "Failed to send complete packet to HEPv3 server: %d of %u sent\n",
-			res, sock_buffer_len);
-		res = -1;
+	for (i = 0, packet_len = 0; i < iovcnt; i++) {
+		packet_len += pkt->iov[i].iov_len;
 	}
+	hg_pkt->header.length = htons(packet_len);
 
-	ast_free(sock_buffer);
-	return res;
+	return iovcnt;
+}
+
+/*! \brief Callback function for the \ref hep_queue_tp taskprocessor */
+static int hep_queue_cb(void *data)
+{
+	RAII_VAR(struct module_config *, config, ao2_global_obj_ref(global_config), ao2_cleanup);
+	RAII_VAR(struct hepv3_runtime_data *, hepv3_data, ao2_global_obj_ref(global_data), ao2_cleanup);
+	struct msghdr msgs[HEP_BATCH_SIZE];
+#ifdef USE_HEP_BATCH
+	struct mmsghdr mmsgs[HEP_BATCH_SIZE];
+#endif
+	size_t next;
+
+	/*
+	 * Take everything queued so far, the next packet queued pushes another
+	 * task to send whatever is captured meanwhile.
+	 */
+	ast_mutex_lock(&hep_queue_lock);
+	SWAP(hep_queue, hep_sending);
+	ast_mutex_unlock(&hep_queue_lock);
+
+	for (next = 0; config && hepv3_data && next < AST_VECTOR_SIZE(&hep_sending); ) {
+		int count = 0;
+		int i;
+
+		while (count < HEP_BATCH_SIZE && next < AST_VECTOR_SIZE(&hep_sending)) {
+			struct hep_packet *pkt = &hep_packets[count];
+			int iovcnt = hep_packet_build(pkt, config->general, AST_VECTOR_GET(&hep_sending, next++));
+
+			if (!iovcnt) {
+				continue;
+			}
+			memset(&msgs[count], 0, sizeof(msgs[count]));
+			msgs[count].msg_name = &hepv3_data->remote_addr.ss;
+			msgs[count].msg_namelen = hepv3_data->remote_addr.len;
+			msgs[count].msg_iov = pkt->iov;
+			msgs[count].msg_iovlen = iovcnt;
+			count++;
+		}
+
+#ifdef USE_HEP_BATCH
+		for (i = 0; i < count; i++) {
+			mmsgs[i].msg_hdr = msgs[i];
+			mmsgs[i].msg_len = 0;
+		}
+		for (i = 0; i < count; ) {
+			int res = sendmmsg(hepv3_data->sockfd, &mmsgs[i], count - i, 0);
+
+			if (res < 0) {
+				ast_log(AST_LOG_ERROR, "Error [%d] while sending packet to HEPv3 server: %s\n",
+					errno, strerror(errno));
+				/* Skip the packet that failed and carry on with the rest */
+				res = 1;
+			}
+			i += res;
+		}
+#else
+		for (i = 0; i < count; i++) {
+			if (sendmsg(hepv3_data->sockfd, &msgs[i], 0) < 0) {
+				ast_log(AST_LOG_ERROR, "Error [%d] while sending packet to HEPv3 server: %s\n",
+					errno, strerror(errno));
+			}
+		}
+#endif
+	}
+
+	AST_VECTOR_RESET(&hep_sending, ao2_cleanup);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Whether a packet is sampled out
+ *
+ * Packets are sampled by their UUID, so that every packet of a call is sent
+ * or none of them are.
+ */
+static int hep_sampled_out(const struct hepv3_global_config *general, const struct hepv3_capture_info *capture_info)
+{
+	unsigned int percent;
+
+	switch (capture_info->capture_type) {
+	case HEPV3_CAPTURE_TYPE_SIP:
+		percent = general->sip_sample_percent;
+		break;
+	case HEPV3_CAPTURE_TYPE_RTCP:
+		percent = general->rtcp_sample_percent;
+		break;
+	default:
+		return 0;
+	}
+
+	if (percent >= 100) {
+		return 0;
+	}
+
+	return (unsigned int) ast_str_hash(S_OR(capture_info->uuid, "")) % 100 >= percent;
 }
 
 int hepv3_send_packet(struct hepv3_capture_info *capture_info)
 {
 	RAII_VAR(struct module_config *, config, ao2_global_obj_ref(global_config), ao2_cleanup);
-	int res;
+	int res = 0;
+	int idle;
 
-	if (!config || !config->general->enabled) {
+	if (!config || !config->general->enabled || hep_sampled_out(config->general, capture_info)) {
 		ao2_ref(capture_info, -1);
 		return 0;
 	}
 
-	res = ast_taskprocessor_push(hep_queue_tp, hep_queue_cb, capture_info);
-	if (res == -1) {
+	ast_mutex_lock(&hep_queue_lock);
+	idle = !AST_VECTOR_SIZE(&hep_queue);
+	if (AST_VECTOR_SIZE(&hep_queue) >= HEP_QUEUE_MAX || AST_VECTOR_APPEND(&hep_queue, capture_info)) {
+		ast_mutex_unlock(&hep_queue_lock);
+		ast_debug(3, "HEPv3 queue is full, dropping packet\n");
 		ao2_ref(capture_info, -1);
+		return -1;
+	}
+	ast_mutex_unlock(&hep_queue_lock);
+
+	/* Only the first packet queued needs to wake the taskprocessor up */
+	if (idle) {
+		res = ast_taskprocessor_push(hep_queue_tp, hep_queue_cb, NULL);
 	}
 
 	return res;
@@ -673,8 +875,22 @@ static int reload_module(void)
  */
 static int unload_module(void)
 {
+	int i;
+
 	hep_queue_tp = ast_taskprocessor_unreference(hep_queue_tp);
 
+	ast_mutex_lock(&hep_queue_lock);
+	AST_VECTOR_CALLBACK_VOID(&hep_queue, ao2_cleanup);
+	AST_VECTOR_FREE(&hep_queue);
+	ast_mutex_unlock(&hep_queue_lock);
+	AST_VECTOR_CALLBACK_VOID(&hep_sending, ao2_cleanup);
+	AST_VECTOR_FREE(&hep_sending);
+	for (i = 0; i < HEP_BATCH_SIZE; i++) {
+		ast_free(hep_packets[i].zipped);
+		hep_packets[i].zipped = NULL;
+		hep_packets[i].zipped_size = 0;
+	}
+
 	ao2_global_obj_release(global_config);
 	ao2_global_obj_release(global_data);
 	aco_info_destroy(&cfg_info);
@@ -702,6 +918,9 @@ static int load_module(void)
 	aco_option_register(&cfg_info, "capture_id", ACO_EXACT, global_options, "0", OPT_UINT_T, 0, STRFLDSET(struct hepv3_global_config, capture_id));
 	aco_option_register(&cfg_info, "capture_name", ACO_EXACT, global_options, "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct hepv3_global_config, capture_name));
 	aco_option_register_custom(&cfg_info, "uuid_type", ACO_EXACT, global_options, "call-id", uuid_type_handler, 0);
+	aco_option_register(&cfg_info, "compress", ACO_EXACT, global_options, "no", OPT_BOOL_T, 1, FLDSET(struct hepv3_global_config, compress));
+	aco_option_register(&cfg_info, "sip_sample_percent", ACO_EXACT, global_options, "100", OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct hepv3_global_config, sip_sample_percent), 0, 100);
+	aco_option_register(&cfg_info, "rtcp_sample_percent", ACO_EXACT, global_options, "100", OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct hepv3_global_config, rtcp_sample_percent), 0, 100);
 
 	if (aco_process_config(&cfg_info, 0) == ACO_PROCESS_ERROR) {
 		goto error;
@@ -85,6 +85,15 @@
 #endif
 #endif
 
+/*!
+ * \brief DNS lookups and TLS sessions shared by every request
+ *
+ * Connections are not shared, as requests run on several threads at once
+ * and libcurl does not support using shared connections that way.
+ */
+static CURLSH *curl_share;
+static ast_mutex_t curl_share_locks[CURL_LOCK_DATA_LAST];
+
 static int http_media_cache_config_pre_apply(void);
 
 /*! \brief General configuration options for http media cache. */
@@ -471,6 +480,48 @@ static int bucket_file_expired(struct ast_bucket_file *bucket_file)
 	return ast_tvcmp(current_time, expires) == -1 ? 0 : 1;
 }
 
+static void curl_share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+	ast_mutex_lock(&curl_share_locks[data]);
+}
+
+static void curl_share_unlock(CURL *handle, curl_lock_data data, void *userptr)
+{
+	ast_mutex_unlock(&curl_share_locks[data]);
+}
+
+static void curl_share_create(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(curl_share_locks); i++) {
+		ast_mutex_init(&curl_share_locks[i]);
+	}
+
+	curl_share = curl_share_init();
+	if (!curl_share) {
+		return;
+	}
+	curl_share_setopt(curl_share, CURLSHOPT_LOCKFUNC, curl_share_lock);
+	curl_share_setopt(curl_share, CURLSHOPT_UNLOCKFUNC, curl_share_unlock);
+	curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+static void curl_share_destroy(void)
+{
+	int i;
+
+	if (curl_share) {
+		curl_share_cleanup(curl_share);
+		curl_share = NULL;
+	}
+
+	for (i = 0; i < ARRAY_LEN(curl_share_locks); i++) {
+		ast_mutex_destroy(&curl_share_locks[i]);
+	}
+}
+
 /*!
  * \internal \brief Obtain a CURL handle with common setup options
  */
@@ -495,6 +546,11 @@ static CURL *get_curl_instance(struct curl_bucket_file_data *cb_data)
 	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, cfg->general->curl_followlocation ? 1 : 0);
 	curl_easy_setopt(curl, CURLOPT_MAXREDIRS, cfg->general->curl_maxredirs);
 
+	/* Requests to the same server skip its DNS lookup and resume its TLS session */
+	if (curl_share) {
+		curl_easy_setopt(curl, CURLOPT_SHARE, curl_share);
+	}
+
 	if (!ast_strlen_zero(cfg->general->curl_proxy)) {
 		curl_easy_setopt(curl, CURLOPT_PROXY, cfg->general->curl_proxy);
 	}
@@ -730,6 +786,7 @@ static int unload_module(void)
 {
 	aco_info_destroy(&cfg_info);
 	ao2_global_obj_release(confs);
+	curl_share_destroy();
 	return 0;
 }
 
@@ -795,6 +852,8 @@ static int load_module(void)
 		ao2_ref(cfg, -1);
 	}
 
+	curl_share_create();
+
 	if (ast_bucket_scheme_register("http", &http_bucket_wizard, &http_bucket_file_wizard,
 			NULL, NULL)) {
 		ast_log(LOG_ERROR, "Failed to register Bucket HTTP wizard scheme implementation\n");
@@ -24,11 +24,17 @@
  */
 
 /*** MODULEINFO
+	<use type="external">zlib</use>
 	<support_level>core</support_level>
  ***/
 
 #include "asterisk.h"
 
+#include <sys/uio.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #include "asterisk/module.h"
 #include "asterisk/http.h"
 #include "asterisk/astobj2.h"
@@ -84,6 +90,15 @@
 #define MAX_WS_HDR_SZ 14
 #define MIN_WS_HDR_SZ 2
 
+/*! \brief Bit of the first byte of a frame marking a compressed message (RSV1) */
+#define WS_COMPRESSED_BIT 0x40
+
+/*! \brief Smallest message worth compressing */
+#define MINIMUM_DEFLATE_SIZE 64
+
+/*! \brief Most a compressed message may grow to when decompressed */
+#define MAXIMUM_INFLATE_SIZE (16 * MAXIMUM_FRAME_SIZE)
+
 /*! \brief Structure definition for session */
 struct ast_websocket {
 	struct ast_iostream *stream;        /*!< iostream of the connection */
@@ -91,12 +106,20 @@ struct ast_websocket {
 	struct ast_sockaddr local_address;  /*!< Our local address */
 	enum ast_websocket_opcode opcode;   /*!< Cached opcode for multi-frame messages */
 	size_t payload_len;                 /*!< Length of the payload */
+	size_t payload_size;                /*!< Allocated size of the payload */
 	char *payload;                      /*!< Pointer to the payload */
 	size_t reconstruct;                 /*!< Number of bytes before a reconstructed payload will be returned and a new one started */
 	int timeout;                        /*!< The timeout for operations on the socket */
 	unsigned int secure:1;              /*!< Bit to indicate that the transport is secure */
 	unsigned int closing:1;             /*!< Bit to indicate that the session is in the process of being closed */
 	unsigned int close_sent:1;          /*!< Bit to indicate that the session close opcode has been sent and no further data will be sent */
+	unsigned int deflate:1;             /*!< Bit to indicate that permessage-deflate is in use */
+	unsigned int deflate_no_context:1;  /*!< Bit to indicate that each sent message is compressed on its own */
+	unsigned int compressed:1;          /*!< Bit to indicate that the message being received is compressed */
+#ifdef HAVE_ZLIB
+	z_stream deflater;                  /*!< Compressor of sent messages when permessage-deflate is in use */
+	z_stream inflater;                  /*!< Decompressor of received messages when permessage-deflate is in use */
+#endif
 	struct websocket_client *client;    /*!< Client object when connected as a client websocket */
 	char session_id[AST_UUID_STR_LEN];  /*!< The identifier for the websocket session */
 	uint16_t close_status_code;         /*!< Status code sent in a CLOSE frame upon shutdown */
@@ -186,6 +209,12 @@ static void session_destroy_fn(void *obj)
 
 	ao2_cleanup(session->client);
 	ast_free(session->payload);
+#ifdef HAVE_ZLIB
+	if (session->deflate) {
+		deflateEnd(&session->deflater);
+		inflateEnd(&session->inflater);
+	}
+#endif
 }
 
 struct ast_websocket_protocol *AST_OPTIONAL_API_NAME(ast_websocket_sub_protocol_alloc)(const char *name)
@@ -370,17 +399,236 @@ static const char *websocket_opcode2str(enum ast_websocket_opcode opcode)
 	}
 }
 
+#ifdef HAVE_ZLIB
+/*!
+ * \brief Compress a message for permessage-deflate (RFC 7692)
+ *
+ * \note The session must be locked, as messages must be sent in the order
+ *       they are compressed.
+ *
+ * \return The compressed message, which the caller must free, or NULL on error
+ */
+static char *websocket_deflate(struct ast_websocket *session, const char *payload, uint64_t payload_size, uint64_t *deflated_size)
+{
+	/* A sync flush adds at most a few bytes to what deflateBound() gives */
+	uLong size = deflateBound(&session->deflater, payload_size) + 16;
+	char *deflated;
+	int res;
+
+	deflated = ast_malloc(size);
+	if (!deflated) {
+		return NULL;
+	}
+
+	session->deflater.next_in = (Bytef *) payload;
+	session->deflater.avail_in = payload_size;
+	session->deflater.next_out = (Bytef *) deflated;
+	session->deflater.avail_out = size;
+	res = deflate(&session->deflater, Z_SYNC_FLUSH);
+	if (res != Z_OK || session->deflater.avail_in || !session->deflater.avail_out) {
+		ast_log(LOG_WARNING, "Failed to compress websocket message: %d\n", res);
+		ast_free(deflated);
+		return NULL;
+	}
+
+	*deflated_size = size - session->deflater.avail_out;
+	/* RFC 7692 7.2.1 - the empty block ending the flush is left out */
+	if (*deflated_size >= 4 && !memcmp(deflated + *deflated_size - 4, "\x00\x00\xff\xff", 4)) {
+		*deflated_size -= 4;
+	}
+
+	if (session->deflate_no_context) {
+		deflateReset(&session->deflater);
+	}
+
+	return deflated;
+}
+#endif
+
+/*!
+ * \brief Make sure the payload being put together can take more bytes
+ */
+static int websocket_payload_reserve(struct ast_websocket *session, size_t len)
+{
+	char *payload;
+	size_t size;
+
+	if (session->payload_size - session->payload_len >= len) {
+		return 0;
+	}
+
+	size = MAX(session->payload_len + len, session->payload_size * 2);
+	payload = ast_realloc(session->payload, size);
+	if (!payload) {
+		ast_log(LOG_WARNING, "Failed allocation: %p, %zu, %zu\n",
+			session->payload, session->payload_len, len);
+		return -1;
+	}
+	session->payload = payload;
+	session->payload_size = size;
+
+	return 0;
+}
+
+#ifdef HAVE_ZLIB
+/*!
+ * \brief Decompress a frame of a compressed message onto the payload being put together
+ *
+ * \param session The session
+ * \param data The frame payload
+ * \param len Length of the frame payload
+ * \param fin Whether this is the last frame of the message
+ */
+static int websocket_inflate(struct ast_websocket *session, const char *data, size_t len, int fin)
+{
+	/* RFC 7692 7.2.2 - the empty block the sender left out ends the message */
+	static const char tail[] = { 0x00, 0x00, 0xff, 0xff };
+	int pass;
+
+	for (pass = 0; pass < (fin ? 2 : 1); ++pass) {
+		session->inflater.next_in = (Bytef *) (pass ? tail : data);
+		session->inflater.avail_in = pass ? sizeof(tail) : len;
+
+		do {
+			int res;
+
+			if (session->payload_len + 1024 > MAXIMUM_INFLATE_SIZE) {
+				ast_log(LOG_WARNING, "Compressed websocket message is too large\n");
+				return -1;
+			}
+			if (websocket_payload_reserve(session, MAX(len * 4, 1024))) {
+				return -1;
+			}
+
+			session->inflater.next_out = (Bytef *) session->payload + session->payload_len;
+			session->inflater.avail_out = session->payload_size - session->payload_len;
+			res = inflate(&session->inflater, Z_SYNC_FLUSH);
+			session->payload_len = session->payload_size - session->inflater.avail_out;
+			if (res == Z_STREAM_END) {
+				inflateReset(&session->inflater);
+			} else if (res != Z_OK && res != Z_BUF_ERROR) {
+				ast_log(LOG_WARNING, "Failed to decompress websocket message: %d\n", res);
+				return -1;
+			}
+		} while (session->inflater.avail_in || !session->inflater.avail_out);
+	}
+
+	return 0;
+}
+
+/*!
+ * \brief Accept the first permessage-deflate offer that can be (RFC 7692)
+ *
+ * \param session The session
+ * \param offers The Sec-WebSocket-Extensions header of the request
+ * \param buf Buffer for the Sec-WebSocket-Extensions header of the response
+ * \param size Size of the buffer
+ */
+static void websocket_deflate_negotiate(struct ast_websocket *session, const char *offers, char *buf, size_t size)
+{
+	char *extensions = ast_strdupa(offers);
+	char *offer;
+
+	while ((offer = strsep(&extensions, ","))) {
+		char *param = strsep(&offer, ";");
+		int window_bits = 15;
+		int no_context = 0;
+		int valid = 1;
+
+		if (strcasecmp(ast_strip(param), "permessage-deflate")) {
+			continue;
+		}
+
+		while (valid && (param = strsep(&offer, ";"))) {
+			char *value = ast_strip(param);
+			char *name = ast_strip(strsep(&value, "="));
+			int bits = 15;
+
+			if (value) {
+				value = ast_strip_quoted(ast_strip(value), "\"", "\"");
+				if (sscanf(value, "%30d", &bits) != 1 || bits < 8 || bits > 15) {
+					valid = 0;
+					break;
+				}
+			}
+
+			if (!strcasecmp(name, "server_no_context_takeover") && !value) {
+				no_context = 1;
+			} else if (!strcasecmp(name, "server_max_window_bits") && value) {
+				/* zlib cannot compress with a window of 8 bits */
+				valid = bits > 8;
+				window_bits = bits;
+			} else if (!strcasecmp(name, "client_no_context_takeover") && !value) {
+				/* The decompressor keeps its context either way */
+			} else if (!strcasecmp(name, "client_max_window_bits")) {
+				/* The decompressor takes any window */
+			} else {
+				valid = 0;
+			}
+		}
+		if (!valid) {
+			continue;
+		}
+
+		if (deflateInit2(&session->deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -window_bits, 8,
+				Z_DEFAULT_STRATEGY) != Z_OK) {
+			return;
+		}
+		if (inflateInit2(&session->inflater, -15) != Z_OK) {
+			deflateEnd(&session->deflater);
+			return;
+		}
+		session->deflate = 1;
+		session->deflate_no_context = no_context;
+
+		if (window_bits != 15) {
+			snprintf(buf, size, "Sec-WebSocket-Extensions: permessage-deflate%s; server_max_window_bits=%d\r\n",
+				no_context ? "; server_no_context_takeover" : "", window_bits);
+		} else {
+			snprintf(buf, size, "Sec-WebSocket-Extensions: permessage-deflate%s\r\n",
+				no_context ? "; server_no_context_takeover" : "");
+		}
+		return;
+	}
+}
+#endif
+
 /*! \brief Write function for websocket traffic */
 int AST_OPTIONAL_API_NAME(ast_websocket_write)(struct ast_websocket *session, enum ast_websocket_opcode opcode, char *payload, uint64_t payload_size)
 {
 	size_t header_size = 2; /* The minimum size of a websocket frame is 2 bytes */
-	char *frame;
+	char header[MAX_WS_HDR_SZ] = { 0, };
+	struct iovec iov[2];
+	char *buffer = NULL;
 	uint64_t length;
-	uint64_t frame_size;
+	ssize_t res;
 
 	ast_debug(3, "Writing websocket %s frame, length %" PRIu64 "\n",
 			websocket_opcode2str(opcode), payload_size);
 
+	header[0] = opcode | 0x80;
+
+	ao2_lock(session);
+	if (session->closing) {
+		ao2_unlock(session);
+		return -1;
+	}
+
+#ifdef HAVE_ZLIB
+	if (session->deflate && payload_size >= MINIMUM_DEFLATE_SIZE
+		&& (opcode == AST_WEBSOCKET_OPCODE_TEXT || opcode == AST_WEBSOCKET_OPCODE_BINARY)) {
+		buffer = websocket_deflate(session, payload, payload_size, &payload_size);
+		if (!buffer) {
+			ao2_unlock(session);
+			/* The compressor lost track of what the client has seen */
+			ast_websocket_close(session, 1011);
+			return -1;
+		}
+		payload = buffer;
+		header[0] |= WS_COMPRESSED_BIT;
+	}
+#endif
+
 	if (payload_size < 126) {
 		length = payload_size;
 	} else if (payload_size < (1 << 16)) {
@@ -398,33 +646,39 @@ int AST_OPTIONAL_API_NAME(ast_websocket_write)(struct ast_websocket *session, en
 		header_size += 4;
 	}
 
-	frame_size = header_size + payload_size;
-
-	frame = ast_alloca(frame_size + 1);
-	memset(frame, 0, frame_size + 1);
-
-	frame[0] = opcode | 0x80;
-	frame[1] = length;
+	header[1] = length;
 
 	/* Use the additional available bytes to store the length */
 	if (length == 126) {
-		put_unaligned_uint16(&frame[2], htons(payload_size));
+		put_unaligned_uint16(&header[2], htons(payload_size));
 	} else if (length == 127) {
-		put_unaligned_uint64(&frame[2], htonll(payload_size));
+		put_unaligned_uint64(&header[2], htonll(payload_size));
 	}
 
-	memcpy(&frame[header_size], payload, payload_size);
-
-	websocket_mask_payload(session, frame, &frame[header_size], payload_size);
-
-	ao2_lock(session);
-	if (session->closing) {
-		ao2_unlock(session);
-		return -1;
+	if (session->client) {
+		/* The payload of the caller is not ours to mask in place */
+		if (!buffer) {
+			buffer = ast_malloc(payload_size + 1);
+			if (!buffer) {
+				ao2_unlock(session);
+				return -1;
+			}
+			memcpy(buffer, payload, payload_size);
+			payload = buffer;
+		}
+		websocket_mask_payload(session, header, payload, payload_size);
 	}
 
+	/* The header and the payload go out together without being copied */
+	iov[0].iov_base = header;
+	iov[0].iov_len = header_size;
+	iov[1].iov_base = payload;
+	iov[1].iov_len = payload_size;
+
 	ast_iostream_set_timeout_sequence(session->stream, ast_tvnow(), session->timeout);
-	if (ast_iostream_write(session->stream, frame, frame_size) != frame_size) {
+	res = ast_iostream_writev(session->stream, iov, ARRAY_LEN(iov));
+	ast_free(buffer);
+	if (res != header_size + payload_size) {
 		ao2_unlock(session);
 		/* 1011 - server terminating connection due to not being able to fulfill the request */
 		ast_debug(1, "Closing WS with 1011 because we can't fulfill a write request\n");
@@ -603,7 +857,7 @@ int AST_OPTIONAL_API_NAME(ast_websocket_read)(struct ast_websocket *session, cha
 {
 	int fin = 0;
 	int mask_present = 0;
-	char *mask = NULL, *new_payload = NULL;
+	char *mask = NULL;
 	size_t options_len = 0, frame_size = 0;
 
 	*payload = NULL;
@@ -697,21 +951,39 @@ int AST_OPTIONAL_API_NAME(ast_websocket_read)(struct ast_websocket *session, cha
 		}
 
 		/* Below this point we are handling TEXT, BINARY or CONTINUATION opcodes */
-		if (*payload_len) {
-			if (!(new_payload = ast_realloc(session->payload, (session->payload_len + *payload_len)))) {
-				ast_log(LOG_WARNING, "Failed allocation: %p, %zu, %"PRIu64"\n",
-					session->payload, session->payload_len, *payload_len);
+		if (*opcode != AST_WEBSOCKET_OPCODE_CONTINUATION) {
+			/* RFC 7692 6 - the first frame of a message tells whether it is compressed */
+			session->compressed = session->deflate && (session->buf[0] & WS_COMPRESSED_BIT);
+		}
+
+		if (session->compressed) {
+#ifdef HAVE_ZLIB
+			if (websocket_inflate(session, *payload, *payload_len, fin)) {
+				*payload_len = 0;
+				*payload = NULL;
+				ast_websocket_close(session, 1007);
+				return -1;
+			}
+#endif
+		} else if (!session->payload_len && (fin || !session->reconstruct)) {
+			/* Nothing to put together, so the frame is handed out from the read buffer as is */
+			if (*opcode == AST_WEBSOCKET_OPCODE_CONTINUATION) {
+				if (!fin) {
+					*fragmented = 1;
+				} else {
+					*opcode = session->opcode;
+				}
+			}
+			return 0;
+		} else if (*payload_len) {
+			if (websocket_payload_reserve(session, *payload_len)) {
 				*payload_len = 0;
 				ast_websocket_close(session, 1009);
 				return -1;
 			}
 
-			session->payload = new_payload;
 			memcpy((session->payload + session->payload_len), (*payload), (*payload_len));
 			session->payload_len += *payload_len;
-		} else if (!session->payload_len && session->payload) {
-			ast_free(session->payload);
-			session->payload = NULL;
 		}
 
 		if (!fin && session->reconstruct && (session->payload_len < session->reconstruct)) {
@@ -791,6 +1063,8 @@ int AST_OPTIONAL_API_NAME(ast_websocket_uri_cb)(struct ast_tcptls_session_instan
 {
 	struct ast_variable *v;
 	const char *upgrade = NULL, *key = NULL, *key1 = NULL, *key2 = NULL, *protos = NULL;
+	const char *extensions = NULL;
+	char extensions_response[128] = "";
 	char *requested_protocols = NULL, *protocol = NULL;
 	int version = 0, flags = 1;
 	struct ast_websocket_protocol *protocol_handler = NULL;
@@ -819,6 +1093,8 @@ int AST_OPTIONAL_API_NAME(ast_websocket_uri_cb)(struct ast_tcptls_session_instan
 			key2 = v->value;
 		} else if (!strcasecmp(v->name, "Sec-WebSocket-Protocol")) {
 			protos = v->value;
+		} else if (!strcasecmp(v->name, "Sec-WebSocket-Extensions")) {
+			extensions = v->value;
 		} else if (!strcasecmp(v->name, "Sec-WebSocket-Version")) {
 			if (sscanf(v->value, "%30d", &version) != 1) {
 				version = 0;
@@ -912,6 +1188,12 @@ int AST_OPTIONAL_API_NAME(ast_websocket_uri_cb)(struct ast_tcptls_session_instan
 			return 0;
 		}
 
+#ifdef HAVE_ZLIB
+		if (extensions) {
+			websocket_deflate_negotiate(session, extensions, extensions_response, sizeof(extensions_response));
+		}
+#endif
+
 		/* RFC 6455, Section 4.1:
 		 *
 		 * 6. If the response includes a |Sec-WebSocket-Protocol| header
@@ -927,18 +1209,22 @@ int AST_OPTIONAL_API_NAME(ast_websocket_uri_cb)(struct ast_tcptls_session_instan
 				"Upgrade: %s\r\n"
 				"Connection: Upgrade\r\n"
 				"Sec-WebSocket-Accept: %s\r\n"
-				"Sec-WebSocket-Protocol: %s\r\n\r\n",
+				"Sec-WebSocket-Protocol: %s\r\n"
+				"%s\r\n",
 				upgrade,
 				websocket_combine_key(key, base64, sizeof(base64)),
-				protocol);
+				protocol,
+				extensions_response);
 		} else {
 			ast_iostream_printf(ser->stream,
 				"HTTP/1.1 101 Switching Protocols\r\n"
 				"Upgrade: %s\r\n"
 				"Connection: Upgrade\r\n"
-				"Sec-WebSocket-Accept: %s\r\n\r\n",
+				"Sec-WebSocket-Accept: %s\r\n"
+				"%s\r\n",
 				upgrade,
-				websocket_combine_key(key, base64, sizeof(base64)));
+				websocket_combine_key(key, base64, sizeof(base64)),
+				extensions_response);
 		}
 	} else {
 
@@ -154,6 +154,7 @@ struct moh_files_state {
 #define MOH_PREFERCHANNELCLASS	(1 << 7)	/*!< Should queue moh override channel moh */
 
 #define MOH_LOOPLAST (1 << 8) /*!< Whether to loop the last file in the music class when we reach the end, rather than starting over */
+#define MOH_BROADCAST (1 << 9) /*!< Read the files once for every channel rather than once per channel */
 
 /* Custom astobj2 flag */
 #define MOH_NOTDELETED          (1 << 30)       /*!< Find only records that aren't deleted? */
@@ -194,6 +195,10 @@ struct mohclass {
 	unsigned int realtime:1;
 	unsigned int delete:1;
 	AST_LIST_HEAD_NOLOCK(, mohdata) members;
+	/*! Channels listening to a broadcast class */
+	AST_LIST_HEAD_NOLOCK(, moh_listener) listeners;
+	/*! Tells the broadcast thread to exit */
+	int broadcast_stop;
 	AST_LIST_ENTRY(mohclass) list;
 	/*!< Play the moh if the channel answered */
 	int answeredonly;
@@ -600,6 +605,449 @@ static struct ast_generator moh_file_stream = {
 	.write_format_change = moh_files_write_format_change,
 };
 
+/*! \brief Frames a broadcast listener may fall behind by before the oldest are dropped */
+#define MOH_BROADCAST_MAX_QUEUED 10
+/*! \brief How often the broadcast thread reads the files of its class */
+#define MOH_BROADCAST_MS 20
+
+/*! \brief A channel listening to a broadcast class */
+struct moh_listener {
+	/*! The format the channel writes without translating */
+	struct ast_format *format;
+	struct ast_format *origwfmt;
+	struct mohclass *parent;
+	/*! Frames for the channel to write, guarded by the class lock */
+	AST_LIST_HEAD_NOLOCK(, ast_frame) frames;
+	int queued;
+	AST_LIST_ENTRY(moh_listener) list;
+};
+
+/*! \brief A format the broadcast thread encodes the class's audio in */
+struct moh_broadcast_output {
+	struct ast_format *format;
+	/*! The format of the file being translated from */
+	struct ast_format *src;
+	/*! The translation path from src, NULL if the file is already in format */
+	struct ast_trans_pvt *trans;
+	/*! The current frame in format, its payload shared by every listener */
+	struct ast_frame *frame;
+	/*! Whether a listener still uses the format */
+	int used;
+};
+
+AST_VECTOR(moh_broadcast_outputs, struct moh_broadcast_output *);
+
+static void moh_broadcast_output_free(struct moh_broadcast_output *output)
+{
+	if (output->trans) {
+		ast_translator_free_path(output->trans);
+	}
+	ao2_cleanup(output->format);
+	ao2_cleanup(output->src);
+	ast_free(output);
+}
+
+static struct moh_broadcast_output *moh_broadcast_output_get(struct moh_broadcast_outputs *outputs,
+	struct ast_format *format)
+{
+	struct moh_broadcast_output *output;
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(outputs); ++i) {
+		output = AST_VECTOR_GET(outputs, i);
+		if (ast_format_cmp(output->format, format) == AST_FORMAT_CMP_EQUAL) {
+			return output;
+		}
+	}
+
+	output = ast_calloc(1, sizeof(*output));
+	if (!output) {
+		return NULL;
+	}
+	output->format = ao2_bump(format);
+	if (AST_VECTOR_APPEND(outputs, output)) {
+		moh_broadcast_output_free(output);
+		return NULL;
+	}
+
+	return output;
+}
+
+/*!
+ * \internal
+ * \brief Encode a frame once in every format listeners use
+ */
+static void moh_broadcast_encode(struct moh_broadcast_output *output, struct ast_frame *f)
+{
+	struct ast_frame *out = f;
+
+	output->frame = NULL;
+
+	if (ast_format_cmp(f->subclass.format, output->format) != AST_FORMAT_CMP_EQUAL) {
+		if (!output->trans || ast_format_cmp(f->subclass.format, output->src) != AST_FORMAT_CMP_EQUAL) {
+			if (output->trans) {
+				ast_translator_free_path(output->trans);
+			}
+			ao2_replace(output->src, f->subclass.format);
+			output->trans = ast_translator_build_path(output->format, f->subclass.format);
+			if (!output->trans) {
+				ast_log(LOG_WARNING, "Unable to translate music on hold from %s to %s\n",
+					ast_format_get_name(f->subclass.format), ast_format_get_name(output->format));
+				return;
+			}
+		}
+		out = ast_translate(output->trans, f, 0);
+		if (!out) {
+			/* The translator wants more audio first */
+			return;
+		}
+	}
+
+	output->frame = ast_frdup_shared(out);
+	if (out != f) {
+		ast_frfree(out);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Hand a frame read from the class's files to every listener
+ */
+static void moh_broadcast_frame(struct mohclass *class, struct moh_broadcast_outputs *outputs,
+	struct ast_frame *f)
+{
+	struct moh_listener *listener;
+	struct moh_broadcast_output *output;
+	int i;
+
+	/* Find the formats listeners use, so each is encoded once outside the class lock */
+	for (i = 0; i < AST_VECTOR_SIZE(outputs); ++i) {
+		AST_VECTOR_GET(outputs, i)->used = 0;
+	}
+	ao2_lock(class);
+	AST_LIST_TRAVERSE(&class->listeners, listener, list) {
+		output = moh_broadcast_output_get(outputs, listener->format);
+		if (output) {
+			output->used = 1;
+		}
+	}
+	ao2_unlock(class);
+
+	for (i = 0; i < AST_VECTOR_SIZE(outputs); ) {
+		output = AST_VECTOR_GET(outputs, i);
+		if (!output->used) {
+			AST_VECTOR_REMOVE_UNORDERED(outputs, i);
+			moh_broadcast_output_free(output);
+			continue;
+		}
+		moh_broadcast_encode(output, f);
+		++i;
+	}
+
+	ao2_lock(class);
+	AST_LIST_TRAVERSE(&class->listeners, listener, list) {
+		struct ast_frame *copy;
+
+		/* A listener that arrived since is given frames from the next one */
+		output = NULL;
+		for (i = 0; i < AST_VECTOR_SIZE(outputs); ++i) {
+			if (ast_format_cmp(AST_VECTOR_GET(outputs, i)->format, listener->format) == AST_FORMAT_CMP_EQUAL) {
+				output = AST_VECTOR_GET(outputs, i);
+				break;
+			}
+		}
+		if (!output || !output->frame || !(copy = ast_frshare(output->frame))) {
+			continue;
+		}
+
+		AST_LIST_INSERT_TAIL(&listener->frames, copy, frame_list);
+		if (++listener->queued > MOH_BROADCAST_MAX_QUEUED) {
+			ast_frfree(AST_LIST_REMOVE_HEAD(&listener->frames, frame_list));
+			--listener->queued;
+		}
+	}
+	ao2_unlock(class);
+
+	for (i = 0; i < AST_VECTOR_SIZE(outputs); ++i) {
+		output = AST_VECTOR_GET(outputs, i);
+		if (output->frame) {
+			ast_frfree(output->frame);
+			output->frame = NULL;
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Open the next file of a broadcast class
+ */
+static struct ast_filestream *moh_broadcast_next(struct mohclass *class, int *pos)
+{
+	struct ast_vector_string *files;
+	struct ast_filestream *stream;
+	size_t file_count;
+
+	ao2_lock(class);
+	files = ao2_bump(class->files);
+	ao2_unlock(class);
+
+	file_count = AST_VECTOR_SIZE(files);
+	if (!file_count) {
+		ao2_ref(files, -1);
+		return NULL;
+	}
+
+	if (ast_test_flag(class, MOH_SORTMODE) == MOH_RANDOMIZE) {
+		*pos = ast_random() % file_count;
+	} else if (*pos < 0 && ast_test_flag(class, MOH_RANDOMIZE)) {
+		*pos = ast_random() % file_count;
+	} else if (ast_test_flag(class, MOH_LOOPLAST)) {
+		*pos = MIN(file_count - 1, *pos + 1);
+	} else {
+		*pos = (*pos + 1) % file_count;
+	}
+
+	stream = ast_readfile_any(AST_VECTOR_GET(files, *pos), NULL);
+	if (!stream) {
+		ast_log(LOG_WARNING, "Unable to open file '%s' for music on hold class '%s'\n",
+			AST_VECTOR_GET(files, *pos), class->name);
+	} else {
+		ast_debug(1, "Music on hold class '%s' broadcasting file %d '%s'\n",
+			class->name, *pos, AST_VECTOR_GET(files, *pos));
+	}
+
+	ao2_ref(files, -1);
+	return stream;
+}
+
+/*!
+ * \internal
+ * \brief Read the files of a broadcast class once for all its listeners
+ *
+ * The thread does not hold a reference to the class.  The class destructor
+ * sets broadcast_stop and waits for the thread to exit.
+ */
+static void *moh_broadcast_thread(void *data)
+{
+	struct mohclass *class = data;
+	struct moh_broadcast_outputs outputs;
+	struct ast_filestream *stream = NULL;
+	int pos = -1;
+	int ms_due = 0;
+
+	if (AST_VECTOR_INIT(&outputs, 4)) {
+		return NULL;
+	}
+
+	while (!class->broadcast_stop) {
+		struct pollfd pfd = { .fd = ast_timer_fd(class->timer), .events = POLLIN | POLLPRI, };
+		int empty;
+
+		if (ast_poll(&pfd, 1, MOH_BROADCAST_MS * 5) <= 0) {
+			continue;
+		}
+		if (ast_timer_ack(class->timer, 1) < 0) {
+			ast_log(LOG_ERROR, "Failed to acknowledge timer for music on hold class '%s'\n", class->name);
+			break;
+		}
+
+		ao2_lock(class);
+		empty = AST_LIST_EMPTY(&class->listeners);
+		ao2_unlock(class);
+		if (empty) {
+			/* Nobody is listening, so the position is kept */
+			ms_due = 0;
+			continue;
+		}
+
+		ms_due += MOH_BROADCAST_MS;
+		while (ms_due > 0) {
+			struct ast_frame *f;
+			int opened = 0;
+
+			if (!stream) {
+				if (!(stream = moh_broadcast_next(class, &pos))) {
+					ms_due = 0;
+					break;
+				}
+				opened = 1;
+			}
+
+			f = ast_readframe(stream);
+			if (!f) {
+				ast_closestream(stream);
+				stream = NULL;
+				if (opened) {
+					/* An empty file, try the next one on the next tick */
+					ms_due = 0;
+					break;
+				}
+				continue;
+			}
+
+			if (f->frametype == AST_FRAME_VOICE && f->samples) {
+				ms_due -= f->samples * 1000 / ast_format_get_sample_rate(f->subclass.format);
+				moh_broadcast_frame(class, &outputs, f);
+			}
+			ast_frfree(f);
+		}
+	}
+
+	if (stream) {
+		ast_closestream(stream);
+	}
+	AST_VECTOR_CALLBACK_VOID(&outputs, moh_broadcast_output_free);
+	AST_VECTOR_FREE(&outputs);
+
+	return NULL;
+}
+
+static int init_broadcast_class(struct mohclass *class)
+{
+	if (!(class->timer = ast_timer_open())) {
+		ast_log(LOG_WARNING, "Unable to create timer: %s\n", strerror(errno));
+		return -1;
+	}
+	if (ast_timer_set_rate(class->timer, 1000 / MOH_BROADCAST_MS)) {
+		ast_log(LOG_WARNING, "Unable to set %dms frame rate: %s\n", MOH_BROADCAST_MS, strerror(errno));
+		ast_timer_close(class->timer);
+		class->timer = NULL;
+		return -1;
+	}
+
+	if (ast_pthread_create_background(&class->thread, NULL, moh_broadcast_thread, class)) {
+		ast_log(LOG_WARNING, "Unable to create moh thread...\n");
+		ast_timer_close(class->timer);
+		class->timer = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void moh_broadcast_release(struct ast_channel *chan, void *data)
+{
+	struct moh_listener *listener = data;
+	struct mohclass *class = listener->parent;
+	struct ast_format *oldwfmt;
+	struct ast_frame *f;
+
+	ao2_lock(class);
+	AST_LIST_REMOVE(&class->listeners, listener, list);
+	ao2_unlock(class);
+
+	while ((f = AST_LIST_REMOVE_HEAD(&listener->frames, frame_list))) {
+		ast_frfree(f);
+	}
+
+	oldwfmt = listener->origwfmt;
+	ao2_cleanup(listener->format);
+	mohclass_unref(class, "unreffing listener->parent upon deactivation of generator");
+	ast_free(listener);
+
+	if (chan) {
+		struct moh_files_state *state;
+
+		state = ast_channel_music_state(chan);
+		if (state && state->class) {
+			state->class = mohclass_unref(state->class, "Unreffing channel's music class upon deactivation of generator");
+		}
+		if (oldwfmt && ast_set_write_format(chan, oldwfmt)) {
+			ast_log(LOG_WARNING, "Unable to restore channel '%s' to format %s\n",
+					ast_channel_name(chan), ast_format_get_name(oldwfmt));
+		}
+
+		moh_post_stop(chan);
+	}
+
+	ao2_cleanup(oldwfmt);
+}
+
+static void *moh_broadcast_alloc(struct ast_channel *chan, void *params)
+{
+	struct moh_listener *listener;
+	struct mohclass *class = params;
+	struct moh_files_state *state;
+
+	/* Initiating music_state for current channel. Channel should know name of moh class */
+	state = ast_channel_music_state(chan);
+	if (!state && (state = ast_calloc(1, sizeof(*state)))) {
+		ast_channel_music_state_set(chan, state);
+		ast_module_ref(ast_module_info->self);
+	} else {
+		if (!state) {
+			return NULL;
+		}
+		if (state->class) {
+			mohclass_unref(state->class, "Uh Oh. Restarting MOH with an active class");
+			ast_log(LOG_WARNING, "Uh Oh. Restarting MOH with an active class\n");
+		}
+		ao2_cleanup(state->origwfmt);
+		ao2_cleanup(state->mohwfmt);
+		memset(state, 0, sizeof(*state));
+	}
+
+	if (!(listener = ast_calloc(1, sizeof(*listener)))) {
+		return NULL;
+	}
+
+	/* Listeners are sent frames in the format their channel writes, so nothing is translated per channel */
+	ast_channel_lock(chan);
+	listener->format = ao2_bump(ast_channel_rawwriteformat(chan));
+	listener->origwfmt = ao2_bump(ast_channel_writeformat(chan));
+	ast_channel_unlock(chan);
+	listener->parent = mohclass_ref(class, "Reffing music class for listener parent");
+
+	if (ast_set_write_format(chan, listener->format)) {
+		ast_log(LOG_WARNING, "Unable to set channel '%s' to format '%s'\n", ast_channel_name(chan),
+			ast_format_get_name(listener->format));
+		moh_broadcast_release(NULL, listener);
+		return NULL;
+	}
+
+	ao2_lock(class);
+	AST_LIST_INSERT_HEAD(&class->listeners, listener, list);
+	ao2_unlock(class);
+
+	state->class = mohclass_ref(class, "Placing reference into state container");
+	moh_post_start(chan, class->name);
+
+	return listener;
+}
+
+static int moh_broadcast_generate(struct ast_channel *chan, void *data, int len, int samples)
+{
+	struct moh_listener *listener = data;
+	struct ast_frame *frames;
+	struct ast_frame *f;
+	int res = 0;
+
+	ao2_lock(listener->parent);
+	frames = AST_LIST_FIRST(&listener->frames);
+	AST_LIST_HEAD_INIT_NOLOCK(&listener->frames);
+	listener->queued = 0;
+	ao2_unlock(listener->parent);
+
+	while ((f = frames)) {
+		frames = AST_LIST_NEXT(f, frame_list);
+		AST_LIST_NEXT(f, frame_list) = NULL;
+		if (!res && ast_write(chan, f) < 0) {
+			ast_log(LOG_WARNING, "Failed to write frame to '%s': %s\n", ast_channel_name(chan), strerror(errno));
+			res = -1;
+		}
+		ast_frfree(f);
+	}
+
+	return res;
+}
+
+static struct ast_generator moh_broadcast_stream = {
+	.alloc    = moh_broadcast_alloc,
+	.release  = moh_broadcast_release,
+	.generate = moh_broadcast_generate,
+	.digit    = moh_handle_digit,
+};
+
 static int spawn_mp3(struct mohclass *class)
 {
 	int fds[2];
@@ -1218,6 +1666,8 @@ static void moh_parse_options(struct ast_variable *var, struct mohclass *mohclas
 				ast_log(LOG_WARNING, "kill_method '%s' is invalid.  Setting to 'process_group'\n", var->value);
 				mohclass->kill_method = KILL_METHOD_PROCESS_GROUP;
 			}
+		} else if (!strcasecmp(var->name, "broadcast")) {
+			ast_set2_flag(mohclass, ast_true(var->value), MOH_BROADCAST);
 		} else if (!strcasecmp(var->name, "answeredonly")) {
 			mohclass->answeredonly = ast_true(var->value) ? 1: 0;
 		}
@@ -1463,6 +1913,12 @@ static int _moh_register(struct mohclass *moh, int reload, int unref, const char
 			}
 			return -1;
 		}
+		if (ast_test_flag(moh, MOH_BROADCAST) && init_broadcast_class(moh)) {
+			if (unref) {
+				moh = mohclass_unref(moh, "unreffing potential new moh class (init_broadcast_class failed)");
+			}
+			return -1;
+		}
 	} else if (!strcasecmp(moh->mode, "playlist")) {
 		size_t file_count;
 
@@ -1476,6 +1932,12 @@ static int _moh_register(struct mohclass *moh, int reload, int unref, const char
 			}
 			return -1;
 		}
+		if (ast_test_flag(moh, MOH_BROADCAST) && init_broadcast_class(moh)) {
+			if (unref) {
+				moh = mohclass_unref(moh, "unreffing potential new moh class (init_broadcast_class failed)");
+			}
+			return -1;
+		}
 	} else if (!strcasecmp(moh->mode, "mp3") || !strcasecmp(moh->mode, "mp3nb") ||
 			!strcasecmp(moh->mode, "quietmp3") || !strcasecmp(moh->mode, "quietmp3nb") ||
 			!strcasecmp(moh->mode, "httpmp3") || !strcasecmp(moh->mode, "custom")) {
@@ -1889,7 +2351,9 @@ static int local_ast_moh_start(struct ast_channel *chan, const char *mclass, con
 		file_count = AST_VECTOR_SIZE(mohclass->files);
 		ao2_unlock(mohclass);
 
-		if (file_count) {
+		if (file_count && ast_test_flag(mohclass, MOH_BROADCAST) && mohclass->timer) {
+			res = ast_activate_generator(chan, &moh_broadcast_stream, mohclass);
+		} else if (file_count) {
 			res = ast_activate_generator(chan, &moh_file_stream, mohclass);
 		} else {
 			res = ast_activate_generator(chan, &mohgen, mohclass);
@@ -1942,9 +2406,16 @@ static void moh_class_destructor(void *obj)
 	if (class->thread != AST_PTHREADT_NULL && class->thread != 0) {
 		tid = class->thread;
 		class->thread = AST_PTHREADT_NULL;
-		pthread_cancel(tid);
-		/* We'll collect the exit status later, after we ensure all the readers
-		 * are dead. */
+		if (ast_test_flag(class, MOH_BROADCAST)) {
+			/* The broadcast thread frees what it uses on the way out */
+			class->broadcast_stop = 1;
+			pthread_join(tid, NULL);
+			tid = 0;
+		} else {
+			pthread_cancel(tid);
+			/* We'll collect the exit status later, after we ensure all the readers
+			 * are dead. */
+		}
 	}
 
 	if (class->pid > 1) {
@@ -2207,6 +2678,9 @@ static char *handle_cli_moh_show_classes(struct ast_cli_entry *e, int cmd, struc
 		if (strcasecmp(class->mode, "files")) {
 			ast_cli(a->fd, "\tFormat: %s\n", ast_format_get_name(class->format));
 		}
+		if (ast_test_flag(class, MOH_BROADCAST)) {
+			ast_cli(a->fd, "\tBroadcast: yes\n");
+		}
 	}
 	ao2_iterator_destroy(&i);
 
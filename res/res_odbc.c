@@ -76,6 +76,7 @@ struct odbc_class
 	unsigned int isolation;              /*!< Flags for how the DB should deal with data in other, uncommitted transactions */
 	unsigned int conntimeout;            /*!< Maximum time the connection process should take */
 	unsigned int maxconnections;         /*!< Maximum number of allowed connections */
+	unsigned int maxstatements;          /*!< Maximum number of prepared statements kept per connection */
 	/*! When a connection fails, cache that failure for how long? */
 	struct timeval negative_connection_cache;
 	/*! When a connection fails, when did that last occur? */
@@ -102,6 +103,16 @@ struct odbc_class
 	unsigned int slowquerylimit;
 };
 
+/*! \brief A prepared statement kept on a connection for reuse */
+struct odbc_cached_stmt {
+	AST_LIST_ENTRY(odbc_cached_stmt) list;
+	SQLHSTMT stmt;
+	/*! Set while the statement is handed out */
+	unsigned int in_use:1;
+	/*! The SQL query the statement is prepared with */
+	char sql[0];
+};
+
 static struct ao2_container *class_container;
 
 static AST_RWLIST_HEAD_STATIC(odbc_tables, odbc_cache_tables);
@@ -422,7 +433,7 @@ SQLHSTMT ast_odbc_prepare_and_execute(struct odbc_obj *obj, SQLHSTMT (*prepare_c
 		}
 
 		ast_log(LOG_WARNING, "SQL Execute error %d!\n", res);
-		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_stmt(obj, stmt);
 		stmt = NULL;
 	} else if (obj->parent->logging) {
 		long execution_time = ast_tvdiff_ms(ast_tvnow(), start);
@@ -466,6 +477,95 @@ int ast_odbc_prepare(struct odbc_obj *obj, SQLHSTMT *stmt, const char *sql)
 	return SQLPrepare(stmt, (unsigned char *)sql, SQL_NTS);
 }
 
+SQLHSTMT ast_odbc_prepare_cached(struct odbc_obj *obj, const char *sql)
+{
+	struct odbc_cached_stmt *cached;
+	struct odbc_cached_stmt *idle = NULL;
+	SQLHSTMT stmt;
+	int res;
+
+	AST_LIST_TRAVERSE(&obj->statements, cached, list) {
+		if (cached->in_use) {
+			continue;
+		}
+		if (!strcmp(cached->sql, sql)) {
+			break;
+		}
+		idle = cached;
+	}
+
+	if (cached) {
+		AST_LIST_REMOVE(&obj->statements, cached, list);
+		AST_LIST_INSERT_HEAD(&obj->statements, cached, list);
+		cached->in_use = 1;
+		if (obj->parent->logging) {
+			ast_free(obj->sql_text);
+			obj->sql_text = ast_strdup(sql);
+		}
+		return cached->stmt;
+	}
+
+	res = SQLAllocHandle(SQL_HANDLE_STMT, obj->con, &stmt);
+	if (!SQL_SUCCEEDED(res)) {
+		ast_log(LOG_WARNING, "SQL Alloc Handle failed!\n");
+		return NULL;
+	}
+
+	res = ast_odbc_prepare(obj, stmt, sql);
+	if (!SQL_SUCCEEDED(res)) {
+		if (res == SQL_ERROR) {
+			ast_odbc_print_errors(SQL_HANDLE_STMT, stmt, "SQL Prepare");
+		}
+		ast_log(LOG_WARNING, "SQL Prepare failed! [%s]\n", sql);
+		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		return NULL;
+	}
+
+	if (!obj->parent->maxstatements) {
+		return stmt;
+	}
+
+	/* Make room by dropping the least recently used statement not handed out */
+	if (obj->statement_cnt >= obj->parent->maxstatements) {
+		if (!idle) {
+			return stmt;
+		}
+		AST_LIST_REMOVE(&obj->statements, idle, list);
+		SQLFreeHandle(SQL_HANDLE_STMT, idle->stmt);
+		ast_free(idle);
+		obj->statement_cnt--;
+	}
+
+	cached = ast_malloc(sizeof(*cached) + strlen(sql) + 1);
+	if (!cached) {
+		return stmt;
+	}
+	cached->stmt = stmt;
+	cached->in_use = 1;
+	strcpy(cached->sql, sql); /* Safe */
+	AST_LIST_INSERT_HEAD(&obj->statements, cached, list);
+	obj->statement_cnt++;
+
+	return stmt;
+}
+
+void ast_odbc_release_stmt(struct odbc_obj *obj, SQLHSTMT stmt)
+{
+	struct odbc_cached_stmt *cached;
+
+	AST_LIST_TRAVERSE(&obj->statements, cached, list) {
+		if (cached->stmt == stmt) {
+			SQLFreeStmt(stmt, SQL_CLOSE);
+			SQLFreeStmt(stmt, SQL_UNBIND);
+			SQLFreeStmt(stmt, SQL_RESET_PARAMS);
+			cached->in_use = 0;
+			return;
+		}
+	}
+
+	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+}
+
 SQLRETURN ast_odbc_execute_sql(struct odbc_obj *obj, SQLHSTMT *stmt, const char *sql)
 {
 	if (obj->parent->logging) {
@@ -559,7 +659,7 @@ static int load_odbc_config(void)
 	struct ast_variable *v;
 	char *cat;
 	const char *dsn, *username, *password, *sanitysql;
-	int enabled, bse, conntimeout, forcecommit, isolation, maxconnections, logging, slowquerylimit;
+	int enabled, bse, conntimeout, forcecommit, isolation, maxconnections, logging, slowquerylimit, maxstatements;
 	struct timeval ncache = { 0, 0 };
 	int preconnect = 0, res = 0;
 	struct ast_flags config_flags = { 0 };
@@ -587,6 +687,7 @@ static int load_odbc_config(void)
 			forcecommit = 0;
 			isolation = SQL_TXN_READ_COMMITTED;
 			maxconnections = 1;
+			maxstatements = 0;
 			logging = 0;
 			slowquerylimit = 5000;
 			for (v = ast_variable_browse(config, cat); v; v = v->next) {
@@ -637,6 +738,11 @@ static int load_odbc_config(void)
 						ast_log(LOG_WARNING, "max_connections must be a positive integer\n");
 						maxconnections = 1;
                                         }
+				} else if (!strcasecmp(v->name, "max_prepared_statements")) {
+					if (sscanf(v->value, "%30d", &maxstatements) != 1 || maxstatements < 0) {
+						ast_log(LOG_WARNING, "max_prepared_statements must be a non-negative integer\n");
+						maxstatements = 0;
+					}
 				} else if (!strcasecmp(v->name, "logging")) {
 					logging = ast_true(v->value);
 				} else if (!strcasecmp(v->name, "slow_query_limit")) {
@@ -670,6 +776,7 @@ static int load_odbc_config(void)
 				new->conntimeout = conntimeout;
 				new->negative_connection_cache = ncache;
 				new->maxconnections = maxconnections;
+				new->maxstatements = maxstatements;
 				new->logging = logging;
 				new->slowquerylimit = slowquerylimit;
 
@@ -758,6 +865,7 @@ static char *handle_cli_odbc_show(struct ast_cli_entry *e, int cmd, struct ast_c
 			}
 
 			ast_cli(a->fd, "    Number of active connections: %zd (out of %d)\n", class->connection_cnt, class->maxconnections);
+			ast_cli(a->fd, "    Prepared statements kept per connection: %u\n", class->maxstatements);
 			ast_cli(a->fd, "    Logging: %s\n", class->logging ? "Enabled" : "Disabled");
 			if (class->logging) {
 				ast_cli(a->fd, "    Number of prepares executed: %d\n", class->prepares_executed);
@@ -1013,12 +1121,19 @@ static odbc_status odbc_obj_disconnect(struct odbc_obj *obj)
 	short int mlen;
 	unsigned char msg[200], state[10];
 	SQLHDBC con;
+	struct odbc_cached_stmt *cached;
 
 	/* Nothing to disconnect */
 	if (!obj->con) {
 		return ODBC_SUCCESS;
 	}
 
+	while ((cached = AST_LIST_REMOVE_HEAD(&obj->statements, list))) {
+		SQLFreeHandle(SQL_HANDLE_STMT, cached->stmt);
+		ast_free(cached);
+	}
+	obj->statement_cnt = 0;
+
 	con = obj->con;
 	obj->con = NULL;
 	res = SQLDisconnect(con);
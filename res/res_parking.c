@@ -116,6 +116,16 @@
 				<configOption name="parkedmusicclass">
 					<synopsis>Which music class to use for parked calls. They will use the default if unspecified.</synopsis>
 				</configOption>
+				<configOption name="parkedmusicshared" default="no">
+					<synopsis>If yes, parked calls hearing the same music class share one music on hold stream.</synopsis>
+					<description>
+						<para>Rather than running music on hold for every parked call, the
+						music of a class is generated once for each format it is heard in
+						and sent to every parked call hearing it, in this or any other
+						parking lot sharing music.  Parked calls then hear the class from
+						the same point rather than from the start.</para>
+					</description>
+				</configOption>
 				<configOption name="comebacktoorigin" default="yes">
 					<synopsis>Determines what should be done with the parked channel if no one picks it up before it times out.</synopsis>
 					<description><para>Valid Options:</para>
@@ -631,6 +641,8 @@ static void parking_lot_destructor(void *obj)
 		ast_bridge_destroy(lot->parking_bridge, 0);
 	}
 	ao2_cleanup(lot->parked_users);
+	ast_free(lot->spaces);
+	ast_free(lot->occupied);
 	ao2_cleanup(lot->cfg);
 	ast_string_field_free_memory(lot);
 }
@@ -959,6 +971,7 @@ static struct parking_lot_cfg *clone_parkinglot_cfg(struct parking_lot_cfg *sour
 	cfg->parkext_exclusive = source->parkext_exclusive;
 	cfg->parkaddhints = source->parkaddhints;
 	cfg->comebacktoorigin = source->comebacktoorigin;
+	cfg->parkedmusicshared = source->parkedmusicshared;
 	cfg->parkedplay = source->parkedplay;
 	cfg->parkedcalltransfers = source->parkedcalltransfers;
 	cfg->parkedcallreparking = source->parkedcallreparking;
@@ -1230,6 +1243,7 @@ static int load_module(void)
 	aco_option_register(&cfg_info, "comebackcontext", ACO_EXACT, parking_lot_types, "parkedcallstimeout", OPT_STRINGFIELD_T, 0, STRFLDSET(struct parking_lot_cfg, comebackcontext));
 	aco_option_register(&cfg_info, "comebackdialtime", ACO_EXACT, parking_lot_types, "30", OPT_UINT_T, 0, FLDSET(struct parking_lot_cfg, comebackdialtime));
 	aco_option_register(&cfg_info, "parkedmusicclass", ACO_EXACT, parking_lot_types, "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct parking_lot_cfg, mohclass));
+	aco_option_register(&cfg_info, "parkedmusicshared", ACO_EXACT, parking_lot_types, "no", OPT_BOOL_T, 1, FLDSET(struct parking_lot_cfg, parkedmusicshared));
 	aco_option_register(&cfg_info, "parkext_exclusive", ACO_EXACT, parking_lot_types, "no", OPT_BOOL_T, 1, FLDSET(struct parking_lot_cfg, parkext_exclusive));
 	aco_option_register(&cfg_info, "parkinghints", ACO_EXACT, parking_lot_types, "no", OPT_BOOL_T, 1, FLDSET(struct parking_lot_cfg, parkaddhints));
 	aco_option_register(&cfg_info, "courtesytone", ACO_EXACT, parking_lot_types, "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct parking_lot_cfg, courtesytone));
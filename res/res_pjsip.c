@@ -45,6 +45,8 @@
 #include "asterisk/causes.h"
 #include "asterisk/cli.h"
 #include "asterisk/callerid.h"
+#include "asterisk/latency.h"
+#include "asterisk/affinity.h"
 #include "asterisk/res_pjsip_cli.h"
 #include "asterisk/test.h"
 #include "asterisk/res_pjsip_presence_xml.h"
@@ -71,6 +73,9 @@
 /*! Pool of serializers to use if not supplied. */
 static struct ast_serializer_pool *sip_serializer_pool;
 
+/*! How long pushing a task to a serializer takes */
+static struct ast_latency_histogram *push_task_latency;
+
 static pjsip_endpoint *ast_pjsip_endpoint;
 
 static struct ast_threadpool *sip_threadpool;
@@ -2098,11 +2103,17 @@ struct ast_taskprocessor *ast_sip_create_serializer(const char *name)
 
 int ast_sip_push_task(struct ast_taskprocessor *serializer, int (*sip_task)(void *), void *task_data)
 {
+	uint64_t start = ast_latency_start();
+	int res;
+
 	if (!serializer) {
 		serializer = ast_serializer_pool_get(sip_serializer_pool);
 	}
 
-	return ast_taskprocessor_push(serializer, sip_task, task_data);
+	res = ast_taskprocessor_push(serializer, sip_task, task_data);
+	ast_latency_end(push_task_latency, start);
+
+	return res;
 }
 
 struct sync_task_data {
@@ -2265,6 +2276,8 @@ static int monitor_continue;
 
 static void *monitor_thread_exec(void *endpt)
 {
+	ast_thread_affinity_apply(AST_THREAD_AFFINITY_SIGNALING, -1);
+
 	while (monitor_continue) {
 		const pj_time_val delay = {0, 10};
 		pjsip_endpt_handle_events(ast_pjsip_endpoint, &delay);
@@ -3831,6 +3844,7 @@ static int unload_pjsip(void *data)
 	ast_pjsip_endpoint = NULL;
 
 	if (caching_pool.lock) {
+		ast_sip_destroy_pool_cache();
 		ast_pjproject_caching_pool_destroy(&caching_pool);
 	}
 
@@ -3849,7 +3863,7 @@ static int load_pjsip(void)
 	 * if necessary.
 	 */
 	ast_pjproject_caching_pool_init(&caching_pool, NULL, 1024 * 1024);
-	if (pjsip_endpt_create(&caching_pool.factory, "SIP", &ast_pjsip_endpoint) != PJ_SUCCESS) {
+	if (pjsip_endpt_create(ast_sip_initialize_pool_cache(&caching_pool), "SIP", &ast_pjsip_endpoint) != PJ_SUCCESS) {
 		ast_log(LOG_ERROR, "Failed to create PJSIP endpoint structure. Aborting load\n");
 		goto error;
 	}
@@ -3966,6 +3980,9 @@ static int load_module(void)
 		goto error;
 	}
 
+	push_task_latency = ast_latency_histogram_get("pjsip_push_task",
+		"Time taken to dispatch a task to a PJSIP serializer");
+
 	sip_serializer_pool = ast_serializer_pool_create(
 		"pjsip/default", SERIALIZER_POOL_SIZE, sip_threadpool, -1);
 	if (!sip_serializer_pool) {
@@ -90,6 +90,32 @@ static int auth_type_to_str(const void *obj, const intptr_t *args, char **buf)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Hash the credentials of a userpass auth once rather than per request
+ *
+ * An auth without a realm is used with the default realm, so it is hashed
+ * for the one set now.  Should that change the password is used instead.
+ */
+static void auth_precompute_ha1(struct ast_sip_auth *auth)
+{
+	char realm[AST_SIP_AUTH_MAX_REALM_LENGTH + 1];
+	char *creds;
+
+	if (ast_strlen_zero(auth->realm)) {
+		ast_sip_get_default_realm(realm, sizeof(realm));
+	} else {
+		ast_copy_string(realm, auth->realm, sizeof(realm));
+	}
+
+	if (ast_asprintf(&creds, "%s:%s:%s", auth->auth_user, realm, auth->auth_pass) < 0) {
+		return;
+	}
+	ast_md5_hash(auth->ha1, creds);
+	ast_free(creds);
+	ast_string_field_set(auth, ha1_realm, realm);
+}
+
 static int auth_apply(const struct ast_sorcery *sorcery, void *obj)
 {
 	struct ast_sip_auth *auth = obj;
@@ -125,6 +151,8 @@ static int auth_apply(const struct ast_sorcery *sorcery, void *obj)
 		}
 		break;
 	case AST_SIP_AUTH_TYPE_USER_PASS:
+		auth_precompute_ha1(auth);
+		break;
 	case AST_SIP_AUTH_TYPE_ARTIFICIAL:
 		break;
 	}
@@ -350,14 +378,16 @@ static int cli_print_body(void *obj, void *arg, int flags)
 static struct ast_cli_entry cli_commands[] = {
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "List PJSIP Auths",
 		.command = "pjsip list auths",
-		.usage = "Usage: pjsip list auths [ like <pattern> ]\n"
+		.usage = "Usage: pjsip list auths [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 				"       List the configured PJSIP Auths\n"
-				"       Optional regular expression pattern is used to filter the list.\n"),
+				"       Optional regular expression pattern is used to filter the list.\n"
+				"       Optional limit and after list a page of the objects, sorted by id.\n"),
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "Show PJSIP Auths",
 		.command = "pjsip show auths",
-		.usage = "Usage: pjsip show auths [ like <pattern> ]\n"
+		.usage = "Usage: pjsip show auths [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 				"       Show the configured PJSIP Auths\n"
-				"       Optional regular expression pattern is used to filter the list.\n"),
+				"       Optional regular expression pattern is used to filter the list.\n"
+				"       Optional limit and after list a page of the objects, sorted by id.\n"),
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "Show PJSIP Auth",
 		.command = "pjsip show auth",
 		.usage = "Usage: pjsip show auth <id>\n"
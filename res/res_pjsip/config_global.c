@@ -45,6 +45,7 @@
 #define DEFAULT_UNIDENTIFIED_REQUEST_COUNT 5
 #define DEFAULT_UNIDENTIFIED_REQUEST_PERIOD 5
 #define DEFAULT_UNIDENTIFIED_REQUEST_PRUNE_INTERVAL 30
+#define DEFAULT_UNIDENTIFIED_REQUEST_REJECT_COUNT 0
 #define DEFAULT_MWI_TPS_QUEUE_HIGH AST_TASKPROCESSOR_HIGH_WATER_LEVEL
 #define DEFAULT_MWI_TPS_QUEUE_LOW -1
 #define DEFAULT_MWI_DISABLE_INITIAL_UNSOLICITED 0
@@ -55,6 +56,12 @@
 #define DEFAULT_TASKPROCESSOR_OVERLOAD_TRIGGER TASKPROCESSOR_OVERLOAD_TRIGGER_GLOBAL
 #define DEFAULT_NOREFERSUB 1
 #define DEFAULT_ALL_CODECS_ON_EMPTY_REINVITE 0
+#define DEFAULT_ENDPOINT_IDENTIFIER_CACHE_TTL 0
+#define DEFAULT_DEFER_CONTACT_REFRESH 0
+#define DEFAULT_EXTEN_STATE_COALESCE_INTERVAL 0
+#define DEFAULT_SUBSCRIPTION_PERSISTENCE_WRITE_DELAY 0
+#define DEFAULT_POOL_OUTBOUND_SESSION_SERIALIZERS 0
+#define DEFAULT_OUTBOUND_REGISTRATION_SERIALIZERS 0
 
 /*!
  * \brief Cached global config object
@@ -102,6 +109,8 @@ struct global_config {
 	unsigned int unidentified_request_period;
 	/*! Interval at which expired unidentified requests will be pruned */
 	unsigned int unidentified_request_prune_interval;
+	/*! The number of unidentified requests per source IP address after which further requests are rejected */
+	unsigned int unidentified_request_reject_count;
 	struct {
 		/*! Taskprocessor high water alert trigger level */
 		unsigned int tps_queue_high;
@@ -122,6 +131,18 @@ struct global_config {
 	unsigned int norefersub;
 	/*! Nonzero if we should return all codecs on empty re-INVITE */
 	unsigned int all_codecs_on_empty_reinvite;
+	/*! Milliseconds an endpoint identification is remembered, 0 to not remember */
+	unsigned int endpoint_identifier_cache_ttl;
+	/*! Nonzero if refreshes changing only the expiration of contacts are written later */
+	unsigned int defer_contact_refresh;
+	/*! Milliseconds extension state changes are gathered before notifying subscribers */
+	unsigned int exten_state_coalesce_interval;
+	/*! Milliseconds updates of subscription persistence are gathered before being written */
+	unsigned int subscription_persistence_write_delay;
+	/*! Nonzero if outbound sessions are hashed onto the distributor serializers */
+	unsigned int pool_outbound_session_serializers;
+	/*! Serializers outbound registrations are hashed onto, 0 for one per registration */
+	unsigned int outbound_registration_serializers;
 };
 
 static void global_destructor(void *obj)
@@ -555,6 +576,111 @@ unsigned int ast_sip_get_all_codecs_on_empty_reinvite(void)
 	return all_codecs_on_empty_reinvite;
 }
 
+unsigned int ast_sip_get_defer_contact_refresh(void)
+{
+	unsigned int defer_contact_refresh;
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		return DEFAULT_DEFER_CONTACT_REFRESH;
+	}
+
+	defer_contact_refresh = cfg->defer_contact_refresh;
+	ao2_ref(cfg, -1);
+	return defer_contact_refresh;
+}
+
+unsigned int ast_sip_get_exten_state_coalesce_interval(void)
+{
+	unsigned int interval;
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		return DEFAULT_EXTEN_STATE_COALESCE_INTERVAL;
+	}
+
+	interval = cfg->exten_state_coalesce_interval;
+	ao2_ref(cfg, -1);
+	return interval;
+}
+
+unsigned int ast_sip_get_subscription_persistence_write_delay(void)
+{
+	unsigned int delay;
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		return DEFAULT_SUBSCRIPTION_PERSISTENCE_WRITE_DELAY;
+	}
+
+	delay = cfg->subscription_persistence_write_delay;
+	ao2_ref(cfg, -1);
+	return delay;
+}
+
+unsigned int ast_sip_get_pool_outbound_session_serializers(void)
+{
+	unsigned int pool;
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		return DEFAULT_POOL_OUTBOUND_SESSION_SERIALIZERS;
+	}
+
+	pool = cfg->pool_outbound_session_serializers;
+	ao2_ref(cfg, -1);
+	return pool;
+}
+
+unsigned int ast_sip_get_outbound_registration_serializers(void)
+{
+	unsigned int serializers;
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		return DEFAULT_OUTBOUND_REGISTRATION_SERIALIZERS;
+	}
+
+	serializers = cfg->outbound_registration_serializers;
+	ao2_ref(cfg, -1);
+	return serializers;
+}
+
+unsigned int ast_sip_get_unidentified_request_reject_count(void)
+{
+	unsigned int reject_count;
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		return DEFAULT_UNIDENTIFIED_REQUEST_REJECT_COUNT;
+	}
+
+	reject_count = cfg->unidentified_request_reject_count;
+	ao2_ref(cfg, -1);
+	return reject_count;
+}
+
+unsigned int ast_sip_get_endpoint_identifier_cache_ttl(void)
+{
+	unsigned int endpoint_identifier_cache_ttl;
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		return DEFAULT_ENDPOINT_IDENTIFIER_CACHE_TTL;
+	}
+
+	endpoint_identifier_cache_ttl = cfg->endpoint_identifier_cache_ttl;
+	ao2_ref(cfg, -1);
+	return endpoint_identifier_cache_ttl;
+}
+
 static int overload_trigger_handler(const struct aco_option *opt,
 	struct ast_variable *var, void *obj)
 {
@@ -733,6 +859,9 @@ int ast_sip_initialize_sorcery_global(void)
 	ast_sorcery_object_field_register(sorcery, "global", "unidentified_request_prune_interval",
 		__stringify(DEFAULT_UNIDENTIFIED_REQUEST_PRUNE_INTERVAL),
 		OPT_UINT_T, 0, FLDSET(struct global_config, unidentified_request_prune_interval));
+	ast_sorcery_object_field_register(sorcery, "global", "unidentified_request_reject_count",
+		__stringify(DEFAULT_UNIDENTIFIED_REQUEST_REJECT_COUNT),
+		OPT_UINT_T, 0, FLDSET(struct global_config, unidentified_request_reject_count));
 	ast_sorcery_object_field_register(sorcery, "global", "default_realm", DEFAULT_REALM,
 		OPT_STRINGFIELD_T, 0, STRFLDSET(struct global_config, default_realm));
 	ast_sorcery_object_field_register(sorcery, "global", "mwi_tps_queue_high",
@@ -765,6 +894,24 @@ int ast_sip_initialize_sorcery_global(void)
 	ast_sorcery_object_field_register(sorcery, "global", "all_codecs_on_empty_reinvite",
 		DEFAULT_ALL_CODECS_ON_EMPTY_REINVITE ? "yes" : "no",
 		OPT_BOOL_T, 1, FLDSET(struct global_config, all_codecs_on_empty_reinvite));
+	ast_sorcery_object_field_register(sorcery, "global", "endpoint_identifier_cache_ttl",
+		__stringify(DEFAULT_ENDPOINT_IDENTIFIER_CACHE_TTL),
+		OPT_UINT_T, 0, FLDSET(struct global_config, endpoint_identifier_cache_ttl));
+	ast_sorcery_object_field_register(sorcery, "global", "defer_contact_refresh",
+		DEFAULT_DEFER_CONTACT_REFRESH ? "yes" : "no",
+		OPT_BOOL_T, 1, FLDSET(struct global_config, defer_contact_refresh));
+	ast_sorcery_object_field_register(sorcery, "global", "exten_state_coalesce_interval",
+		__stringify(DEFAULT_EXTEN_STATE_COALESCE_INTERVAL),
+		OPT_UINT_T, 0, FLDSET(struct global_config, exten_state_coalesce_interval));
+	ast_sorcery_object_field_register(sorcery, "global", "subscription_persistence_write_delay",
+		__stringify(DEFAULT_SUBSCRIPTION_PERSISTENCE_WRITE_DELAY),
+		OPT_UINT_T, 0, FLDSET(struct global_config, subscription_persistence_write_delay));
+	ast_sorcery_object_field_register(sorcery, "global", "pool_outbound_session_serializers",
+		DEFAULT_POOL_OUTBOUND_SESSION_SERIALIZERS ? "yes" : "no",
+		OPT_BOOL_T, 1, FLDSET(struct global_config, pool_outbound_session_serializers));
+	ast_sorcery_object_field_register(sorcery, "global", "outbound_registration_serializers",
+		__stringify(DEFAULT_OUTBOUND_REGISTRATION_SERIALIZERS),
+		OPT_UINT_T, 0, FLDSET(struct global_config, outbound_registration_serializers));
 
 	if (ast_sorcery_instance_observer_add(sorcery, &observer_callbacks_global)) {
 		return -1;
@@ -49,6 +49,8 @@ struct system_config {
 		int idle_timeout;
 		/*! Maxumum number of threads in the threadpool */
 		int max_size;
+		/*! Use per-worker task queues with work stealing */
+		int work_stealing;
 	} threadpool;
 	/*! Nonzero to disable switching from UDP to TCP transport */
 	unsigned int disable_tcp_switch;
@@ -129,6 +131,7 @@ static int system_apply(const struct ast_sorcery *sorcery, void *obj)
 	sip_threadpool_options.auto_increment = system->threadpool.auto_increment;
 	sip_threadpool_options.idle_timeout = system->threadpool.idle_timeout;
 	sip_threadpool_options.max_size = system->threadpool.max_size;
+	sip_threadpool_options.work_stealing = system->threadpool.work_stealing;
 
 	pjsip_cfg()->endpt.disable_tcp_switch =
 		system->disable_tcp_switch ? PJ_TRUE : PJ_FALSE;
@@ -207,6 +210,8 @@ int ast_sip_initialize_system(void)
 			OPT_UINT_T, 0, FLDSET(struct system_config, threadpool.idle_timeout));
 	ast_sorcery_object_field_register(system_sorcery, "system", "threadpool_max_size", "50",
 			OPT_UINT_T, 0, FLDSET(struct system_config, threadpool.max_size));
+	ast_sorcery_object_field_register(system_sorcery, "system", "threadpool_work_stealing", "no",
+			OPT_BOOL_T, 1, FLDSET(struct system_config, threadpool.work_stealing));
 	ast_sorcery_object_field_register(system_sorcery, "system", "disable_tcp_switch", "yes",
 			OPT_BOOL_T, 1, FLDSET(struct system_config, disable_tcp_switch));
 	ast_sorcery_object_field_register(system_sorcery, "system", "follow_early_media_fork", "yes",
@@ -425,6 +425,7 @@ static int destroy_sip_transport_state(void *data)
 	if (transport_state->external_media_address_refresher) {
 		ast_dnsmgr_release(transport_state->external_media_address_refresher);
 	}
+	ast_sip_udp_receivers_stop(transport_state);
 	if (transport_state->transport) {
 		pjsip_transport_shutdown(transport_state->transport);
 	}
@@ -788,18 +789,28 @@ static int transport_apply(const struct ast_sorcery *sorcery, void *obj)
 		perm_state->state->transport = NULL;
 		temp_state->state->factory = perm_state->state->factory;
 		perm_state->state->factory = NULL;
+		temp_state->state->udp_receivers = perm_state->state->udp_receivers;
+		perm_state->state->udp_receivers = NULL;
+		/* The listener carries on, and so do its handshake counts */
+		temp_state->state->tls_handshakes_incoming = perm_state->state->tls_handshakes_incoming;
+		temp_state->state->tls_handshakes_outgoing = perm_state->state->tls_handshakes_outgoing;
+		temp_state->state->tls_verify_failures = perm_state->state->tls_verify_failures;
 
 		res = PJ_SUCCESS;
 	} else if (transport->type == AST_TRANSPORT_UDP) {
 
 		for (i = 0; i < BIND_TRIES && res != PJ_SUCCESS; i++) {
 			if (perm_state && perm_state->state && perm_state->state->transport) {
+				ast_sip_udp_receivers_stop(perm_state->state);
 				pjsip_udp_transport_pause(perm_state->state->transport,
 					PJSIP_UDP_TRANSPORT_DESTROY_SOCKET);
 				usleep(BIND_DELAY_US);
 			}
 
-			if (temp_state->state->host.addr.sa_family == pj_AF_INET()) {
+			if (transport->udp_receive_threads > 1) {
+				res = ast_sip_udp_receivers_start(temp_state->state,
+					transport->async_operations, transport->udp_receive_threads);
+			} else if (temp_state->state->host.addr.sa_family == pj_AF_INET()) {
 				res = pjsip_udp_transport_start(ast_sip_get_pjsip_endpoint(),
 					&temp_state->state->host.ipv4, NULL, transport->async_operations,
 					&temp_state->state->transport);
@@ -1714,6 +1725,14 @@ static int cli_print_body(void *obj, void *arg, int flags)
 		|| (context->show_details_only_level_0 && context->indent_level == 0)) {
 		ast_str_append(&context->output_buffer, 0, "\n");
 		ast_sip_cli_print_sorcery_objectset(transport, context, 0);
+
+		if (transport->type == AST_TRANSPORT_TLS) {
+			ast_str_append(&context->output_buffer, 0,
+				"\nTLS handshakes: %d incoming, %d outgoing, %d failed verification\n",
+				ast_atomic_fetchadd_int(&state->tls_handshakes_incoming, 0),
+				ast_atomic_fetchadd_int(&state->tls_handshakes_outgoing, 0),
+				ast_atomic_fetchadd_int(&state->tls_verify_failures, 0));
+		}
 	}
 
 	return 0;
@@ -1725,14 +1744,16 @@ static struct ast_cli_entry cli_commands[] = {
 #endif
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "List PJSIP Transports",
 		.command = "pjsip list transports",
-		.usage = "Usage: pjsip list transports [ like <pattern> ]\n"
+		.usage = "Usage: pjsip list transports [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 				"       List the configured PJSIP Transports\n"
-				"       Optional regular expression pattern is used to filter the list.\n"),
+				"       Optional regular expression pattern is used to filter the list.\n"
+				"       Optional limit and after list a page of the objects, sorted by id.\n"),
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "Show PJSIP Transports",
 		.command = "pjsip show transports",
-		.usage = "Usage: pjsip show transports [ like <pattern> ]\n"
+		.usage = "Usage: pjsip show transports [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 				"       Show the configured PJSIP Transport\n"
-				"       Optional regular expression pattern is used to filter the list.\n"),
+				"       Optional regular expression pattern is used to filter the list.\n"
+				"       Optional limit and after list a page of the objects, sorted by id.\n"),
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "Show PJSIP Transport",
 		.command = "pjsip show transport",
 		.usage = "Usage: pjsip show transport <id>\n"
@@ -1848,6 +1869,7 @@ int ast_sip_initialize_sorcery_transport(void)
 	ast_sorcery_object_field_register(sorcery, "transport", "websocket_write_timeout", AST_DEFAULT_WEBSOCKET_WRITE_TIMEOUT_STR, OPT_INT_T, PARSE_IN_RANGE, FLDSET(struct ast_sip_transport, write_timeout), 1, INT_MAX);
 	ast_sorcery_object_field_register(sorcery, "transport", "allow_reload", "no", OPT_BOOL_T, 1, FLDSET(struct ast_sip_transport, allow_reload));
 	ast_sorcery_object_field_register(sorcery, "transport", "symmetric_transport", "no", OPT_BOOL_T, 1, FLDSET(struct ast_sip_transport, symmetric_transport));
+	ast_sorcery_object_field_register(sorcery, "transport", "udp_receive_threads", "0", OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct ast_sip_transport, udp_receive_threads), 0, 64);
 
 	ast_sip_register_endpoint_formatter(&endpoint_transport_formatter);
 
@@ -20,6 +20,7 @@
 struct ao2_container;
 struct ast_threadpool_options;
 struct ast_sip_cli_context;
+struct ast_sip_transport_state;
 
 /*!
  * \internal
@@ -156,6 +157,22 @@ int ast_sip_initialize_transport_events(void);
  */
 void ast_sip_destroy_transport_events(void);
 
+/*!
+ * \internal
+ * \brief Put a per-thread cache of pools in front of a caching pool.
+ *
+ * \param cp The caching pool
+ *
+ * \return The pool factory to create pools from
+ */
+pj_pool_factory *ast_sip_initialize_pool_cache(pj_caching_pool *cp);
+
+/*!
+ * \internal
+ * \brief Stop caching pools per thread, before the caching pool is destroyed.
+ */
+void ast_sip_destroy_pool_cache(void);
+
 /*!
  * \internal
  * \brief Initialize global type on a sorcery instance
@@ -394,6 +411,29 @@ int ast_sip_initialize_transport_management(void);
  */
 void ast_sip_destroy_transport_management(void);
 
+/*!
+ * \internal
+ * \brief Start a UDP transport receiving on several SO_REUSEPORT sockets
+ *
+ * \param state State of the transport. The transport is started on its host
+ *        address and stored in it.
+ * \param async_cnt Number of concurrent reads on the transport's own socket
+ * \param count Number of sockets sharing the address, the transport's own included
+ *
+ * \retval PJ_SUCCESS on success
+ * \retval PJLIB error code on failure
+ */
+int ast_sip_udp_receivers_start(struct ast_sip_transport_state *state,
+	unsigned int async_cnt, unsigned int count);
+
+/*!
+ * \internal
+ * \brief Close the additional sockets of a UDP transport and stop their threads
+ *
+ * \param state State of the transport
+ */
+void ast_sip_udp_receivers_stop(struct ast_sip_transport_state *state);
+
 /*!
  * \internal
  * \brief Add online persistent endpoints to the given regcontext
@@ -52,7 +52,7 @@ static void *aor_alloc(const char *name)
 	void *lock;
 	struct ast_sip_aor *aor;
 
-	lock = ast_named_lock_get(AST_NAMED_LOCK_TYPE_MUTEX, "aor", name);
+	lock = ast_named_lock_get_striped(AST_NAMED_LOCK_TYPE_MUTEX, "aor", name);
 	if (!lock) {
 		return NULL;
 	}
@@ -1293,14 +1293,16 @@ static int ami_show_aors(struct mansession *s, const struct message *m)
 static struct ast_cli_entry cli_commands[] = {
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "List PJSIP Aors",
 		.command = "pjsip list aors",
-		.usage = "Usage: pjsip list aors [ like <pattern> ]\n"
+		.usage = "Usage: pjsip list aors [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 				"       List the configured PJSIP Aors\n"
-				"       Optional regular expression pattern is used to filter the list.\n"),
+				"       Optional regular expression pattern is used to filter the list.\n"
+				"       Optional limit and after list a page of the objects, sorted by id.\n"),
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "Show PJSIP Aors",
 		.command = "pjsip show aors",
-		.usage = "Usage: pjsip show aors [ like <pattern> ]\n"
+		.usage = "Usage: pjsip show aors [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 				"       Show the configured PJSIP Aors\n"
-				"       Optional regular expression pattern is used to filter the list.\n"),
+				"       Optional regular expression pattern is used to filter the list.\n"
+				"       Optional limit and after list a page of the objects, sorted by id.\n"),
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "Show PJSIP Aor",
 		.command = "pjsip show aor",
 		.usage = "Usage: pjsip show aor <id>\n"
@@ -1308,14 +1310,16 @@ static struct ast_cli_entry cli_commands[] = {
 
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "List PJSIP Contacts",
 		.command = "pjsip list contacts",
-		.usage = "Usage: pjsip list contacts [ like <pattern> ]\n"
+		.usage = "Usage: pjsip list contacts [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 				"       List the configured PJSIP contacts\n"
-				"       Optional regular expression pattern is used to filter the list.\n"),
+				"       Optional regular expression pattern is used to filter the list.\n"
+				"       Optional limit and after list a page of the objects, sorted by id.\n"),
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "Show PJSIP Contacts",
 		.command = "pjsip show contacts",
-		.usage = "Usage: pjsip show contacts [ like <pattern> ]\n"
+		.usage = "Usage: pjsip show contacts [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 				"       Show the configured PJSIP contacts\n"
-				"       Optional regular expression pattern is used to filter the list.\n"),
+				"       Optional regular expression pattern is used to filter the list.\n"
+				"       Optional limit and after list a page of the objects, sorted by id.\n"),
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "Show PJSIP Contact",
 		.command = "pjsip show contact",
 		.usage = "Usage: pjsip show contact\n"
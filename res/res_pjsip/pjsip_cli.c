@@ -106,6 +106,18 @@ static void dump_str_and_free(int fd, struct ast_str *buf)
 	ast_free(buf);
 }
 
+/*! How much output is built up before a list writes it out */
+#define CLI_OUTPUT_FLUSH_SIZE 16384
+
+/*! \brief Write out the output built up so far once there is enough of it */
+static void flush_str(int fd, struct ast_str *buf)
+{
+	if (ast_str_strlen(buf) >= CLI_OUTPUT_FLUSH_SIZE) {
+		ast_cli(fd, "%s", ast_str_buffer(buf));
+		ast_str_reset(buf);
+	}
+}
+
 char *ast_sip_cli_traverse_objects(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	RAII_VAR(struct ao2_container *, container, NULL, ao2_cleanup);
@@ -117,6 +129,10 @@ char *ast_sip_cli_traverse_objects(struct ast_cli_entry *e, int cmd, struct ast_
 	const char *object_id;
 	char formatter_type[64];
 	const char *regex;
+	struct ast_cli_page page;
+	size_t limit = 0;
+	const char *after = NULL;
+	size_t i;
 
 	struct ast_sip_cli_context context = {
 		.indent_level = 0,
@@ -166,6 +182,11 @@ char *ast_sip_cli_traverse_objects(struct ast_cli_entry *e, int cmd, struct ast_
 		regex = "";
 	}
 
+	if (cmd != CLI_GENERATE && is_container
+		&& ast_cli_page_args(a, ast_strlen_zero(regex) ? 3 : 5, &limit, &after)) {
+		return CLI_SHOWUSAGE;
+	}
+
 	if (cmd == CLI_GENERATE
 		&& (is_container
 			|| a->argc > 4
@@ -212,8 +233,21 @@ char *ast_sip_cli_traverse_objects(struct ast_cli_entry *e, int cmd, struct ast_
 			ast_cli(a->fd, "No objects found.\n\n");
 			return CLI_SUCCESS;
 		}
-		ao2_callback(container, OBJ_NODATA, formatter_entry->print_body, &context);
+		if (ast_cli_page_take(&page, container, formatter_entry->get_id, after, limit)) {
+			ast_free(context.output_buffer);
+			return CLI_FAILURE;
+		}
+		/* The output is written as it goes rather than all of it built up first */
+		for (i = 0; i < page.count; i++) {
+			formatter_entry->print_body(page.objects[i], &context, 0);
+			flush_str(a->fd, context.output_buffer);
+		}
 		ast_str_append(&context.output_buffer, 0, "\nObjects found: %d\n", ao2_container_count(container));
+		if (page.remaining) {
+			ast_str_append(&context.output_buffer, 0, "%zu more, continue after %s\n",
+				page.remaining, formatter_entry->get_id(page.objects[page.count - 1]));
+		}
+		ast_cli_page_release(&page);
 
 	} else {
 		if (ast_strlen_zero(object_id)) {
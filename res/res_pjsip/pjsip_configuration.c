@@ -2075,14 +2075,16 @@ static int cli_endpoint_print_body(void *obj, void *arg, int flags)
 static struct ast_cli_entry cli_commands[] = {
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "List PJSIP Endpoints",
 		.command = "pjsip list endpoints",
-		.usage = "Usage: pjsip list endpoints [ like <pattern> ]\n"
+		.usage = "Usage: pjsip list endpoints [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 				"       List the configured PJSIP endpoints\n"
-				"       Optional regular expression pattern is used to filter the list.\n"),
+				"       Optional regular expression pattern is used to filter the list.\n"
+				"       Optional limit and after list a page of the objects, sorted by id.\n"),
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "Show PJSIP Endpoints",
 		.command = "pjsip show endpoints",
-		.usage = "Usage: pjsip show endpoints [ like <pattern> ]\n"
+		.usage = "Usage: pjsip show endpoints [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 				"       List(detailed) the configured PJSIP endpoints\n"
-				"       Optional regular expression pattern is used to filter the list.\n"),
+				"       Optional regular expression pattern is used to filter the list.\n"
+				"       Optional limit and after list a page of the objects, sorted by id.\n"),
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "Show PJSIP Endpoint",
 		.command = "pjsip show endpoint",
 		.usage = "Usage: pjsip show endpoint <id>\n"
@@ -56,6 +56,59 @@ struct unidentified_request{
 	char src_name[];
 };
 
+/*! Number of independently hashed rows of the unidentified request filter */
+#define UNID_FILTER_ROWS 4
+/*! Number of counters in each row of the unidentified request filter */
+#define UNID_FILTER_COLUMNS 4096
+
+/*! Unidentified requests from the sources hashing onto a counter in recent windows */
+struct unid_counter {
+	/*! The unidentified_period long window current counts requests in */
+	unsigned int window;
+	/*! Requests in the window */
+	unsigned int current;
+	/*! Requests in the window before */
+	unsigned int previous;
+};
+
+/*!
+ * Count-min sketch of unidentified requests by source address.  It has a fixed
+ * size and is only updated with atomic operations, so requests from a flooding
+ * source can be counted and rejected without any lock or allocation.
+ */
+static struct unid_counter unid_filter[UNID_FILTER_ROWS][UNID_FILTER_COLUMNS];
+/*! Unidentified requests within unidentified_period after which a source is rejected, 0 to never */
+static unsigned int unidentified_reject_count;
+
+#define IDENTIFY_CACHE_BUCKETS 1031
+
+/*! An endpoint identified for requests from a source with a From user and domain */
+struct identify_cache_entry {
+	/*! The endpoint identified */
+	struct ast_sip_endpoint *endpoint;
+	/*! When the entry stops being used */
+	struct timeval expires;
+	/*! Transport type, source address and port, From user and domain */
+	char key[];
+};
+
+/*! Endpoints recently identified, keyed by request source and From */
+static struct ao2_container *identify_cache;
+/*! Milliseconds an identification is cached, 0 if identifications are not cached */
+static unsigned int identify_cache_ttl;
+/*! Incremented whenever the cache is emptied */
+static unsigned int identify_cache_generation;
+
+/*! Statistics of the endpoint identification cache */
+static struct {
+	/*! Requests given a cached endpoint */
+	int hits;
+	/*! Requests that went through the endpoint identifiers */
+	int misses;
+	/*! Times the cache was emptied because of a configuration change */
+	int invalidations;
+} identify_cache_stats;
+
 /*! Number of serializers in pool if one not otherwise known.  (Best if prime number) */
 #define DISTRIBUTOR_POOL_SIZE		31
 
@@ -154,6 +207,8 @@ struct distributor_dialog_data {
 	struct ast_taskprocessor *serializer;
 	/*! Endpoint associated with this dialog */
 	struct ast_sip_endpoint *endpoint;
+	/*! TRUE once removed from dialog_associations */
+	unsigned int unlinked:1;
 };
 
 #define DIALOG_ASSOCIATIONS_BUCKETS 251
@@ -189,48 +244,73 @@ static int buf_hash_add(const char *pos, size_t len, int hash)
 
 /*!
  * \internal
- * \brief Compute a hash value on an arbitrary buffer.
- * \since 13.17.0
+ * \brief Compute a hash value on a pjlib string
+ * \since 13.10.0
  *
- * \param[in] pos The buffer to add to the hash
- * \param[in] len The buffer length to add to the hash
+ * \param[in] str The pjlib string to add to the hash
+ * \param[in] hash The hash value to add to
  *
  * \details
  * This version of the function is for when you need to compute a
- * hash of more than one buffer.
+ * string hash of more than one string.
  *
  * This famous hash algorithm was written by Dan Bernstein and is
  * commonly used.
  *
  * \sa http://www.cse.yorku.ca/~oz/hash.html
  */
-static int buf_hash(const char *pos, size_t len)
+static int pjstr_hash_add(pj_str_t *str, int hash)
+{
+	return buf_hash_add(pj_strbuf(str), pj_strlen(str), hash);
+}
+
+/*!
+ * \internal
+ * \brief Compute a hash value on a pjlib string
+ * \since 13.10.0
+ *
+ * \param[in] str The pjlib string to hash
+ *
+ * This famous hash algorithm was written by Dan Bernstein and is
+ * commonly used.
+ *
+ * http://www.cse.yorku.ca/~oz/hash.html
+ */
+static int pjstr_hash(pj_str_t *str)
+{
+	return pjstr_hash_add(str, 5381);
+}
+
+/*!
+ * \internal
+ * \brief Hash a dialog by its call-id and local tag.
+ *
+ * \note Unlike the remote tag, neither changes over the life of the dialog.
+ */
+static int dialog_hash(const pjsip_dialog *dlg)
 {
-	return buf_hash_add(pos, len, 5381);
+	int hash;
+
+	hash = pjstr_hash(&dlg->call_id->id);
+	hash = pjstr_hash_add(&dlg->local.info->tag, hash);
+	return ast_str_hash_restrict(hash);
 }
 
 static int dialog_associations_hash(const void *obj, int flags)
 {
 	const struct distributor_dialog_data *object;
-	union {
-		const pjsip_dialog *dlg;
-		const char buf[sizeof(pjsip_dialog *)];
-	} key;
 
 	switch (flags & OBJ_SEARCH_MASK) {
 	case OBJ_SEARCH_KEY:
-		key.dlg = obj;
-		break;
+		return dialog_hash(obj);
 	case OBJ_SEARCH_OBJECT:
 		object = obj;
-		key.dlg = object->dlg;
-		break;
+		return dialog_hash(object->dlg);
 	default:
 		/* Hash can only work on something with a full key. */
 		ast_assert(0);
 		return 0;
 	}
-	return ast_str_hash_restrict(buf_hash(key.buf, sizeof(key.buf)));
 }
 
 static int dialog_associations_cmp(void *obj, void *arg, int flags)
@@ -260,60 +340,95 @@ static int dialog_associations_cmp(void *obj, void *arg, int flags)
 	return cmp;
 }
 
-void ast_sip_dialog_set_serializer(pjsip_dialog *dlg, struct ast_taskprocessor *serializer)
+/*!
+ * \internal
+ * \brief Find the association of a dialog and lock it.
+ *
+ * \param dlg The SIP dialog
+ * \param create TRUE to create the association if the dialog has none
+ *
+ * \details
+ * The container is sharded so only the shard holding the dialog is
+ * locked while searching or linking.  Changes to an association are
+ * made under its own lock.  An association removed while waiting for
+ * its lock is marked unlinked and the search is repeated.
+ *
+ * \return Locked association with a reference.
+ * \retval NULL if there is none and create is FALSE, or on error.
+ */
+static struct distributor_dialog_data *dialog_association_lock(pjsip_dialog *dlg, int create)
 {
 	struct distributor_dialog_data *dist;
 
-	ao2_wrlock(dialog_associations);
-	dist = ao2_find(dialog_associations, dlg, OBJ_SEARCH_KEY | OBJ_NOLOCK);
-	if (!dist) {
-		if (serializer) {
-			dist = ao2_alloc(sizeof(*dist), NULL);
-			if (dist) {
-				dist->dlg = dlg;
-				dist->serializer = serializer;
-				ao2_link_flags(dialog_associations, dist, OBJ_NOLOCK);
-				ao2_ref(dist, -1);
+	for (;;) {
+		dist = ao2_find(dialog_associations, dlg, OBJ_SEARCH_KEY);
+		if (dist) {
+			ao2_lock(dist);
+			if (!dist->unlinked) {
+				return dist;
 			}
+			ao2_unlock(dist);
+			ao2_ref(dist, -1);
+			continue;
 		}
-	} else {
+
+		if (!create) {
+			return NULL;
+		}
+
+		dist = ao2_alloc(sizeof(*dist), NULL);
+		if (!dist) {
+			return NULL;
+		}
+		dist->dlg = dlg;
+
 		ao2_lock(dist);
-		dist->serializer = serializer;
-		if (!dist->serializer && !dist->endpoint) {
-			ao2_unlink_flags(dialog_associations, dist, OBJ_NOLOCK);
+		if (ao2_link(dialog_associations, dist)) {
+			return dist;
 		}
+
+		/* Another thread associated the dialog first. */
 		ao2_unlock(dist);
 		ao2_ref(dist, -1);
 	}
-	ao2_unlock(dialog_associations);
+}
+
+/*!
+ * \internal
+ * \brief Unlock a dialog association, removing it if it no longer associates anything.
+ *
+ * \param dist Association returned by dialog_association_lock()
+ */
+static void dialog_association_unlock(struct distributor_dialog_data *dist)
+{
+	if (!dist->serializer && !dist->endpoint) {
+		dist->unlinked = 1;
+		ao2_unlink(dialog_associations, dist);
+	}
+	ao2_unlock(dist);
+	ao2_ref(dist, -1);
+}
+
+void ast_sip_dialog_set_serializer(pjsip_dialog *dlg, struct ast_taskprocessor *serializer)
+{
+	struct distributor_dialog_data *dist;
+
+	dist = dialog_association_lock(dlg, serializer != NULL);
+	if (dist) {
+		dist->serializer = serializer;
+		dialog_association_unlock(dist);
+	}
 }
 
 void ast_sip_dialog_set_endpoint(pjsip_dialog *dlg, struct ast_sip_endpoint *endpoint)
 {
 	struct distributor_dialog_data *dist;
 
-	ao2_wrlock(dialog_associations);
-	dist = ao2_find(dialog_associations, dlg, OBJ_SEARCH_KEY | OBJ_NOLOCK);
-	if (!dist) {
-		if (endpoint) {
-			dist = ao2_alloc(sizeof(*dist), NULL);
-			if (dist) {
-				dist->dlg = dlg;
-				dist->endpoint = endpoint;
-				ao2_link_flags(dialog_associations, dist, OBJ_NOLOCK);
-				ao2_ref(dist, -1);
-			}
-		}
-	} else {
-		ao2_lock(dist);
+	dist = dialog_association_lock(dlg, endpoint != NULL);
+	if (dist) {
 		dist->endpoint = endpoint;
-		if (!dist->serializer && !dist->endpoint) {
-			ao2_unlink_flags(dialog_associations, dist, OBJ_NOLOCK);
-		}
-		ao2_unlock(dist);
-		ao2_ref(dist, -1);
+		dialog_association_unlock(dist);
 	}
-	ao2_unlock(dialog_associations);
 }
 
 struct ast_sip_endpoint *ast_sip_dialog_get_endpoint(pjsip_dialog *dlg)
@@ -403,43 +518,13 @@ static pjsip_dialog *find_dialog(pjsip_rx_data *rdata)
 	return dlg;
 }
 
-/*!
- * \internal
- * \brief Compute a hash value on a pjlib string
- * \since 13.10.0
- *
- * \param[in] str The pjlib string to add to the hash
- * \param[in] hash The hash value to add to
- *
- * \details
- * This version of the function is for when you need to compute a
- * string hash of more than one string.
- *
- * This famous hash algorithm was written by Dan Bernstein and is
- * commonly used.
- *
- * \sa http://www.cse.yorku.ca/~oz/hash.html
- */
-static int pjstr_hash_add(pj_str_t *str, int hash)
+struct ast_taskprocessor *ast_sip_get_distributor_serializer_by_call_id(const pj_str_t *call_id)
 {
-	return buf_hash_add(pj_strbuf(str), pj_strlen(str), hash);
-}
+	int hash;
 
-/*!
- * \internal
- * \brief Compute a hash value on a pjlib string
- * \since 13.10.0
- *
- * \param[in] str The pjlib string to hash
- *
- * This famous hash algorithm was written by Dan Bernstein and is
- * commonly used.
- *
- * http://www.cse.yorku.ca/~oz/hash.html
- */
-static int pjstr_hash(pj_str_t *str)
-{
-	return pjstr_hash_add(str, 5381);
+	hash = ast_str_hash_restrict(pjstr_hash((pj_str_t *) call_id));
+
+	return ao2_bump(distributor_pool[hash % ARRAY_LEN(distributor_pool)]);
 }
 
 struct ast_taskprocessor *ast_sip_get_distributor_serializer(pjsip_rx_data *rdata)
@@ -712,6 +797,322 @@ static void apply_acls(pjsip_rx_data *rdata)
 	}
 }
 
+static void identify_cache_entry_destroy(void *obj)
+{
+	struct identify_cache_entry *entry = obj;
+
+	ao2_cleanup(entry->endpoint);
+}
+
+static int identify_cache_hash(const void *obj, const int flags)
+{
+	const struct identify_cache_entry *object;
+	const char *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		object = obj;
+		key = object->key;
+		break;
+	default:
+		/* Hash can only work on something with a full key. */
+		ast_assert(0);
+		return 0;
+	}
+	return ast_str_hash(key);
+}
+
+static int identify_cache_cmp(void *obj, void *arg, int flags)
+{
+	const struct identify_cache_entry *object_left = obj;
+	const struct identify_cache_entry *object_right = arg;
+	const char *right_key = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = object_right->key;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		return strcmp(object_left->key, right_key) ? 0 : CMP_MATCH;
+	default:
+		/* There is no partial key for this container. */
+		ast_assert(0);
+		return 0;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Empty the endpoint identification cache.
+ */
+static void identify_cache_flush(void)
+{
+	ao2_wrlock(identify_cache);
+	++identify_cache_generation;
+	ao2_callback(identify_cache, OBJ_NOLOCK | OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA,
+		NULL, NULL);
+	ao2_unlock(identify_cache);
+}
+
+static void identify_cache_invalidate(void)
+{
+	ast_atomic_fetchadd_int(&identify_cache_stats.invalidations, +1);
+	identify_cache_flush();
+}
+
+static void identify_cache_object_changed(const void *object)
+{
+	identify_cache_invalidate();
+}
+
+static void identify_cache_type_loaded(const char *object_type)
+{
+	identify_cache_invalidate();
+}
+
+/*! \brief Observer which empties the identification cache when endpoints or identifies change */
+static const struct ast_sorcery_observer identify_cache_observer = {
+	.created = identify_cache_object_changed,
+	.updated = identify_cache_object_changed,
+	.deleted = identify_cache_object_changed,
+	.loaded = identify_cache_type_loaded,
+};
+
+/*!
+ * \internal
+ * \brief Observe identify objects once their type is registered by res_pjsip_endpoint_identifier_ip.
+ */
+static void identify_type_registered(const char *name, struct ast_sorcery *sorcery,
+	const char *object_type)
+{
+	if (!strcmp(object_type, "identify")) {
+		ast_sorcery_observer_add(sorcery, "identify", &identify_cache_observer);
+	}
+}
+
+static const struct ast_sorcery_instance_observer identify_cache_instance_observer = {
+	.object_type_registered = identify_type_registered,
+};
+
+/*!
+ * \internal
+ * \brief Build the identification cache key of a request.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the request can't be cached.
+ */
+static int identify_cache_key(pjsip_rx_data *rdata, char *buf, size_t size)
+{
+	pjsip_uri *from = rdata->msg_info.from->uri;
+	const pj_str_t *user;
+	const pj_str_t *host;
+	int res;
+
+	if (!ast_sip_is_allowed_uri(from)) {
+		return -1;
+	}
+	user = ast_sip_pjsip_uri_get_username(from);
+	host = ast_sip_pjsip_uri_get_hostname(from);
+
+	res = snprintf(buf, size, "%s/%s:%d/%.*s@%.*s",
+		rdata->tp_info.transport->type_name,
+		rdata->pkt_info.src_name, rdata->pkt_info.src_port,
+		(int) pj_strlen(user), pj_strbuf(user),
+		(int) pj_strlen(host), pj_strbuf(host));
+
+	return res < 0 || res >= size ? -1 : 0;
+}
+
+/*!
+ * \internal
+ * \brief Identify the endpoint of a request, reusing a recent identification if possible.
+ *
+ * \return Endpoint with a reference.
+ * \retval NULL if no endpoint was identified.
+ */
+static struct ast_sip_endpoint *identify_endpoint(pjsip_rx_data *rdata)
+{
+	char key[PJSIP_MAX_URL_SIZE];
+	struct identify_cache_entry *entry;
+	struct ast_sip_endpoint *endpoint;
+	unsigned int ttl = identify_cache_ttl;
+	unsigned int generation;
+
+	if (!ttl || identify_cache_key(rdata, key, sizeof(key))) {
+		return ast_sip_identify_endpoint(rdata);
+	}
+
+	entry = ao2_find(identify_cache, key, OBJ_SEARCH_KEY);
+	if (entry) {
+		if (ast_tvcmp(entry->expires, ast_tvnow()) > 0) {
+			endpoint = ao2_bump(entry->endpoint);
+			ao2_ref(entry, -1);
+			ast_atomic_fetchadd_int(&identify_cache_stats.hits, +1);
+			return endpoint;
+		}
+		ao2_unlink(identify_cache, entry);
+		ao2_ref(entry, -1);
+	}
+	ast_atomic_fetchadd_int(&identify_cache_stats.misses, +1);
+
+	generation = identify_cache_generation;
+	endpoint = ast_sip_identify_endpoint(rdata);
+	if (!endpoint) {
+		return NULL;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(key) + 1, identify_cache_entry_destroy,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return endpoint;
+	}
+	strcpy(entry->key, key); /* Safe */
+	entry->endpoint = ao2_bump(endpoint);
+	entry->expires = ast_tvadd(ast_tvnow(), ast_samp2tv(ttl, 1000));
+
+	ao2_wrlock(identify_cache);
+	/* Don't cache what was identified with the configuration before a change */
+	if (generation == identify_cache_generation) {
+		ao2_find(identify_cache, key, OBJ_SEARCH_KEY | OBJ_NOLOCK | OBJ_UNLINK | OBJ_NODATA);
+		ao2_link_flags(identify_cache, entry, OBJ_NOLOCK);
+	}
+	ao2_unlock(identify_cache);
+	ao2_ref(entry, -1);
+
+	return endpoint;
+}
+
+/*!
+ * \internal
+ * \brief Compute the counters of a source address in each row of the filter
+ */
+static void unid_filter_columns(const char *src_name, unsigned int columns[UNID_FILTER_ROWS])
+{
+	unsigned int hash = ast_str_hash(src_name);
+	/* An odd step never cycles back early since the number of columns is a power of 2 */
+	unsigned int step = ast_str_hash_add(src_name, hash) | 1;
+	int i;
+
+	for (i = 0; i < UNID_FILTER_ROWS; ++i) {
+		columns[i] = (hash + i * step) % UNID_FILTER_COLUMNS;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Get the current window and how much of it has elapsed, in thousandths
+ */
+static unsigned int unid_filter_window(unsigned int *elapsed)
+{
+	struct timeval now = ast_tvnow();
+	uint64_t period_ms = MAX(unidentified_period, 1) * 1000;
+	uint64_t now_ms = now.tv_sec * 1000ULL + now.tv_usec / 1000;
+
+	*elapsed = (now_ms % period_ms) * 1000 / period_ms;
+	return now_ms / period_ms;
+}
+
+/*!
+ * \internal
+ * \brief Estimate the unidentified requests of a source in the last unidentified_period
+ *
+ * The counts of the previous window are weighted by how much of it is still
+ * within the period.  Since other sources can share a counter, the estimate is
+ * the smallest over all rows and never less than the real count, save for
+ * increments lost while a counter moves on to a new window.
+ */
+static unsigned int unid_filter_estimate(const char *src_name)
+{
+	unsigned int columns[UNID_FILTER_ROWS];
+	unsigned int window;
+	unsigned int elapsed;
+	unsigned int estimate = UINT_MAX;
+	int i;
+
+	unid_filter_columns(src_name, columns);
+	window = unid_filter_window(&elapsed);
+
+	for (i = 0; i < UNID_FILTER_ROWS && estimate; ++i) {
+		struct unid_counter *counter = &unid_filter[i][columns[i]];
+		unsigned int counter_window = ast_atomic_load_n(&counter->window, __ATOMIC_RELAXED);
+		unsigned int current = ast_atomic_load_n(&counter->current, __ATOMIC_RELAXED);
+		unsigned int previous = ast_atomic_load_n(&counter->previous, __ATOMIC_RELAXED);
+		unsigned int count;
+
+		if (counter_window == window) {
+			count = current + (uint64_t) previous * (1000 - elapsed) / 1000;
+		} else if (counter_window + 1 == window) {
+			count = (uint64_t) current * (1000 - elapsed) / 1000;
+		} else {
+			count = 0;
+		}
+		estimate = MIN(estimate, count);
+	}
+
+	return estimate;
+}
+
+/*!
+ * \internal
+ * \brief Count an unidentified request from a source
+ */
+static void unid_filter_count(const char *src_name)
+{
+	unsigned int columns[UNID_FILTER_ROWS];
+	unsigned int window;
+	unsigned int elapsed;
+	int i;
+
+	unid_filter_columns(src_name, columns);
+	window = unid_filter_window(&elapsed);
+
+	for (i = 0; i < UNID_FILTER_ROWS; ++i) {
+		struct unid_counter *counter = &unid_filter[i][columns[i]];
+		unsigned int old_window;
+
+		if (ast_atomic_load_n(&counter->window, __ATOMIC_RELAXED) != window) {
+			/* Only the thread swapping in the new window moves the counts along */
+			old_window = ast_atomic_exchange_n(&counter->window, window, __ATOMIC_RELAXED);
+			if (old_window != window) {
+				unsigned int current = ast_atomic_exchange_n(&counter->current, 0, __ATOMIC_RELAXED);
+
+				ast_atomic_store_n(&counter->previous, old_window + 1 == window ? current : 0,
+					__ATOMIC_RELAXED);
+			}
+		}
+		ast_atomic_fetch_add(&counter->current, 1, __ATOMIC_RELAXED);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Reject a request from a source sending too many unidentified requests
+ *
+ * \retval 1 The request was rejected
+ * \retval 0 The request may go on to be identified
+ */
+static int unid_filter_reject(pjsip_rx_data *rdata, int is_ack)
+{
+	unsigned int reject_count = unidentified_reject_count;
+
+	if (!reject_count || unid_filter_estimate(rdata->pkt_info.src_name) < reject_count) {
+		return 0;
+	}
+
+	ast_debug(3, "Rejecting request from '%s' after too many unidentified requests\n",
+		rdata->pkt_info.src_name);
+
+	/* Answering spoofable datagrams would only make us part of the flood */
+	if (!is_ack && (rdata->tp_info.transport->flag & PJSIP_TRANSPORT_RELIABLE)) {
+		pjsip_endpt_respond_stateless(ast_sip_get_pjsip_endpoint(), rdata, 403, NULL, NULL, NULL);
+	}
+
+	return 1;
+}
+
 static pj_bool_t endpoint_lookup(pjsip_rx_data *rdata)
 {
 	struct ast_sip_endpoint *endpoint;
@@ -735,7 +1136,11 @@ static pj_bool_t endpoint_lookup(pjsip_rx_data *rdata)
 		return PJ_FALSE;
 	}
 
-	endpoint = ast_sip_identify_endpoint(rdata);
+	if (unid_filter_reject(rdata, is_ack)) {
+		return PJ_TRUE;
+	}
+
+	endpoint = identify_endpoint(rdata);
 	if (endpoint) {
 		unid = ao2_find(unidentified_requests, rdata->pkt_info.src_name, OBJ_SEARCH_KEY);
 		if (unid) {
@@ -764,6 +1169,10 @@ static pj_bool_t endpoint_lookup(pjsip_rx_data *rdata)
 			ast_copy_pj_str(name, ast_sip_pjsip_uri_get_username(from), sizeof(name));
 		}
 
+		if (unidentified_reject_count) {
+			unid_filter_count(rdata->pkt_info.src_name);
+		}
+
 		unid = ao2_find(unidentified_requests, rdata->pkt_info.src_name, OBJ_SEARCH_KEY);
 		if (unid) {
 			check_endpoint(rdata, unid, name);
@@ -1121,11 +1530,39 @@ static int cli_unid_print_body(void *obj, void *arg, int flags)
 	return 0;
 }
 
+static char *cli_show_identify_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "pjsip show identify_cache";
+		e->usage =
+			"Usage: pjsip show identify_cache\n"
+			"       Show the statistics of the PJSIP endpoint identification cache\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_cli(a->fd, "TTL:           %u ms%s\n", identify_cache_ttl,
+		identify_cache_ttl ? "" : " (disabled)");
+	ast_cli(a->fd, "Entries:       %d\n", ao2_container_count(identify_cache));
+	ast_cli(a->fd, "Hits:          %d\n", identify_cache_stats.hits);
+	ast_cli(a->fd, "Misses:        %d\n", identify_cache_stats.misses);
+	ast_cli(a->fd, "Invalidations: %d\n", identify_cache_stats.invalidations);
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_commands[] = {
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "Show PJSIP Unidentified Requests",
 		.command = "pjsip show unidentified_requests",
 		.usage = "Usage: pjsip show unidentified_requests\n"
 				"       Show the PJSIP Unidentified Requests\n"),
+	AST_CLI_DEFINE(cli_show_identify_cache, "Show PJSIP Endpoint Identification Cache"),
 };
 
 struct ast_sip_cli_formatter_entry *unid_formatter;
@@ -1143,13 +1580,23 @@ static int expire_requests(void *object, void *arg, int flags)
 	return 0;
 }
 
+static int expire_identifications(void *object, void *arg, int flags)
+{
+	struct identify_cache_entry *entry = object;
+	struct timeval *now = arg;
+
+	return ast_tvcmp(entry->expires, *now) <= 0 ? CMP_MATCH : 0;
+}
+
 static int prune_task(const void *data)
 {
 	unsigned int maxage;
+	struct timeval now = ast_tvnow();
 
 	ast_sip_get_unidentified_request_thresholds(&unidentified_count, &unidentified_period, &unidentified_prune_interval);
 	maxage = unidentified_period * 2;
 	ao2_callback(unidentified_requests, OBJ_MULTIPLE | OBJ_NODATA | OBJ_UNLINK, expire_requests, &maxage);
+	ao2_callback(identify_cache, OBJ_MULTIPLE | OBJ_NODATA | OBJ_UNLINK, expire_identifications, &now);
 
 	return unidentified_prune_interval * 1000;
 }
@@ -1197,8 +1644,13 @@ static void global_loaded(const char *object_type)
 
 	ast_sip_get_unidentified_request_thresholds(&unidentified_count, &unidentified_period, &unidentified_prune_interval);
 
+	unidentified_reject_count = ast_sip_get_unidentified_request_reject_count();
+
 	overload_trigger = ast_sip_get_taskprocessor_overload_trigger();
 
+	identify_cache_ttl = ast_sip_get_endpoint_identifier_cache_ttl();
+	identify_cache_flush();
+
 	/* Clean out the old task, if any */
 	ast_sched_clean_by_callback(prune_context, prune_task, clean_task);
 	/* Have to do something with the return value to shut up the stupid compiler. */
@@ -1260,7 +1712,15 @@ int ast_sip_initialize_distributor(void)
 		return -1;
 	}
 
-	dialog_associations = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+	identify_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+		IDENTIFY_CACHE_BUCKETS, identify_cache_hash, NULL, identify_cache_cmp);
+	if (!identify_cache) {
+		ast_sip_destroy_distributor();
+		return -1;
+	}
+
+	dialog_associations = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK,
+		AO2_CONTAINER_ALLOC_OPT_SHARDED | AO2_CONTAINER_ALLOC_OPT_DUPS_REJECT,
 		DIALOG_ASSOCIATIONS_BUCKETS, dialog_associations_hash, NULL,
 		dialog_associations_cmp);
 	if (!dialog_associations) {
@@ -1287,6 +1747,11 @@ int ast_sip_initialize_distributor(void)
 	ast_sorcery_observer_add(ast_sip_get_sorcery(), "global", &global_observer);
 	ast_sorcery_reload_object(ast_sip_get_sorcery(), "global");
 
+	ast_sorcery_observer_add(ast_sip_get_sorcery(), "endpoint", &identify_cache_observer);
+	/* The identify type may already be registered, or be registered later */
+	ast_sorcery_observer_add(ast_sip_get_sorcery(), "identify", &identify_cache_observer);
+	ast_sorcery_instance_observer_add(ast_sip_get_sorcery(), &identify_cache_instance_observer);
+
 	if (create_artificial_endpoint() || create_artificial_auth()) {
 		ast_sip_destroy_distributor();
 		return -1;
@@ -1339,6 +1804,9 @@ void ast_sip_destroy_distributor(void)
 	ao2_cleanup(artificial_endpoint);
 
 	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "global", &global_observer);
+	ast_sorcery_instance_observer_remove(ast_sip_get_sorcery(), &identify_cache_instance_observer);
+	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "identify", &identify_cache_observer);
+	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "endpoint", &identify_cache_observer);
 
 	if (prune_context) {
 		ast_sched_context_destroy(prune_context);
@@ -1347,5 +1815,6 @@ void ast_sip_destroy_distributor(void)
 	distributor_pool_shutdown();
 
 	ao2_cleanup(dialog_associations);
+	ao2_cleanup(identify_cache);
 	ao2_cleanup(unidentified_requests);
 }
@@ -212,6 +212,12 @@ static struct ao2_container *sip_options_endpoint_state_compositors;
  */
 static struct ast_taskprocessor *management_serializer;
 
+/*!
+ * \internal
+ * \brief Contact statuses waiting to be published, the latest of each contact
+ */
+static struct ao2_container *sip_options_contact_status_updates;
+
 static pj_status_t send_options_response(pjsip_rx_data *rdata, int code)
 {
 	pjsip_endpoint *endpt = ast_sip_get_pjsip_endpoint();
@@ -430,34 +436,63 @@ static void sip_options_publish_contact_state(const struct sip_options_aor *aor_
 }
 
 /*!
- * \brief Task to notify endpoints of a contact status change
+ * \brief Task to notify endpoints of the contact status changes waiting to be published
  * \note Run by management_serializer
  */
 static int contact_status_publish_update_task(void *obj)
 {
-	struct ast_sip_contact_status *contact_status = obj;
+	struct ao2_iterator *updates;
+	struct ast_sip_contact_status *contact_status;
 	struct sip_options_aor *aor_options;
 
-	aor_options = ao2_find(sip_options_aors, contact_status->aor, OBJ_SEARCH_KEY);
-	if (aor_options) {
-		sip_options_publish_contact_state(aor_options, contact_status);
-		ao2_ref(aor_options, -1);
+	if (!sip_options_contact_status_updates) {
+		return 0;
 	}
-	ao2_ref(contact_status, -1);
+
+	/* Updates made from now on need another task, which the empty container makes them push */
+	updates = ao2_callback(sip_options_contact_status_updates, OBJ_MULTIPLE | OBJ_UNLINK,
+		NULL, NULL);
+	if (!updates) {
+		return 0;
+	}
+
+	while ((contact_status = ao2_iterator_next(updates))) {
+		aor_options = ao2_find(sip_options_aors, contact_status->aor, OBJ_SEARCH_KEY);
+		if (aor_options) {
+			sip_options_publish_contact_state(aor_options, contact_status);
+			ao2_ref(aor_options, -1);
+		}
+		ao2_ref(contact_status, -1);
+	}
+	ao2_iterator_destroy(updates);
 
 	return 0;
 }
 
+/*!
+ * \brief Have a contact status change published to the endpoints
+ *
+ * The changes are published together by a single task.  Only the latest
+ * status of a contact that changed several times before the task ran is
+ * published, so a burst of qualify results does not queue a task each.
+ */
 static void sip_options_contact_status_update(struct ast_sip_contact_status *contact_status)
 {
 	struct ast_taskprocessor *mgmt_serializer = management_serializer;
+	int push;
 
-	if (mgmt_serializer) {
-		ao2_ref(contact_status, +1);
-		if (ast_sip_push_task(mgmt_serializer, contact_status_publish_update_task,
-			contact_status)) {
-			ao2_ref(contact_status, -1);
-		}
+	if (!mgmt_serializer || !sip_options_contact_status_updates) {
+		return;
+	}
+
+	ao2_lock(sip_options_contact_status_updates);
+	push = !ao2_container_count(sip_options_contact_status_updates);
+	ao2_link_flags(sip_options_contact_status_updates, contact_status, OBJ_NOLOCK);
+	ao2_unlock(sip_options_contact_status_updates);
+
+	if (push && ast_sip_push_task(mgmt_serializer, contact_status_publish_update_task, NULL)) {
+		ao2_callback(sip_options_contact_status_updates, OBJ_NODATA | OBJ_MULTIPLE | OBJ_UNLINK,
+			NULL, NULL);
 	}
 }
 
@@ -918,6 +953,37 @@ static int sip_options_qualify_contact(void *obj, void *arg, int flags)
 	return 0;
 }
 
+/*!
+ * \brief Determine when to next qualify the contacts of an AOR
+ *
+ * Every AOR is qualified at its own point in the qualify period, derived
+ * from its name and the wall clock.  AORs with the same qualify frequency
+ * are thus spread evenly over the period, whenever each was first
+ * qualified, and stay spread across restarts.  The next qualify is never
+ * sooner than half the frequency, which at worst lengthens the first
+ * period to one and a half times the frequency.
+ */
+static int sip_options_determine_next_qualify_time(const struct sip_options_aor *aor_options)
+{
+	int period = aor_options->qualify_frequency * 1000;
+	struct timeval now = ast_tvnow();
+	int64_t now_ms = (int64_t) now.tv_sec * 1000 + now.tv_usec / 1000;
+	int offset;
+	int delay;
+
+	if (period <= 0) {
+		return period;
+	}
+
+	offset = (unsigned int) ast_str_hash(aor_options->name) % period;
+	delay = (offset - (int) (now_ms % period) + period) % period;
+	if (delay < period / 2) {
+		delay += period;
+	}
+
+	return delay;
+}
+
 /*!
  * \brief Task to qualify contacts of an AOR
  * \note Run by aor_options->serializer
@@ -933,7 +999,7 @@ static int sip_options_qualify_aor(void *obj)
 		(struct sip_options_aor *) aor_options);
 
 	/* Always reschedule to the frequency we should go */
-	return aor_options->qualify_frequency * 1000;
+	return sip_options_determine_next_qualify_time(aor_options);
 }
 
 /*! \brief Forward declaration of this helpful function */
@@ -2456,6 +2522,14 @@ static int ami_show_contacts(struct mansession *s, const struct message *m)
 {
 	struct ast_sip_ami ami = { .s = s, .m = m, .action_id = astman_get_header(m, "ActionID"), };
 	struct ao2_container *contacts;
+	struct ast_cli_page page;
+	size_t limit;
+	const char *after;
+	size_t i;
+
+	if (astman_get_list_page(s, m, &limit, &after)) {
+		return 0;
+	}
 
 	contacts = get_all_contacts();
 	if (!contacts) {
@@ -2469,15 +2543,27 @@ static int ami_show_contacts(struct mansession *s, const struct message *m)
 		return 0;
 	}
 
+	if (ast_cli_page_take(&page, contacts, ast_sorcery_object_get_id, after, limit)) {
+		astman_send_error(s, m, "Could not get Contacts\n");
+		ao2_ref(contacts, -1);
+		return 0;
+	}
+	ao2_ref(contacts, -1);
+
 	astman_send_listack(s, m, "A listing of Contacts follows, presented as ContactList events",
 			"start");
 
-	ao2_callback(contacts, OBJ_NODATA, format_ami_contactlist_handler, &ami);
+	for (i = 0; i < page.count; i++) {
+		if (format_ami_contactlist_handler(page.objects[i], &ami, 0)) {
+			break;
+		}
+	}
 
 	astman_send_list_complete_start(s, m, "ContactListComplete", ami.count);
+	astman_append(s, "Remaining: %zu\r\n", page.remaining);
 	astman_send_list_complete_end(s);
 
-	ao2_ref(contacts, -1);
+	ast_cli_page_release(&page);
 
 	return 0;
 }
@@ -2876,6 +2962,8 @@ void ast_res_pjsip_cleanup_options_handling(void)
 	sip_options_aors = NULL;
 	ao2_cleanup(sip_options_contact_statuses);
 	sip_options_contact_statuses = NULL;
+	ao2_cleanup(sip_options_contact_status_updates);
+	sip_options_contact_status_updates = NULL;
 	ao2_cleanup(sip_options_endpoint_state_compositors);
 	sip_options_endpoint_state_compositors = NULL;
 
@@ -2956,6 +3044,11 @@ int ast_res_pjsip_init_options_handling(int reload)
 		ast_res_pjsip_cleanup_options_handling();
 		return -1;
 	}
+	sip_options_contact_status_updates = sip_options_contact_statuses_alloc();
+	if (!sip_options_contact_status_updates) {
+		ast_res_pjsip_cleanup_options_handling();
+		return -1;
+	}
 
 	mgmt_serializer = ast_sip_create_serializer("pjsip/options/manage");
 	if (!mgmt_serializer) {
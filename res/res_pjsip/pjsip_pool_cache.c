@@ -0,0 +1,325 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Per-thread cache of pjproject memory pools
+ *
+ * Every tdata, transaction and dialog gets a pool from the endpoint's pool
+ * factory and gives it back when done.  The caching pool behind it keeps
+ * released pools for reuse, but takes its lock for every pool created and
+ * released.  This puts a small cache of released pools in front of it in
+ * each thread, so most pools are created and released without the lock.
+ *
+ * Pools are cached by size class.  Pools asked for are rounded up to the
+ * size of their class, so any pool of the class can be reused for them.
+ * The classes cover the sizes pjsip asks for, from the 512 bytes of a
+ * transport to the 4000 of a tdata or rdata and the 8000 of an endpoint.
+ */
+
+#include "asterisk.h"
+
+#include <pjsip.h>
+
+#include "asterisk/res_pjsip.h"
+#include "asterisk/cli.h"
+#include "asterisk/options.h"
+#include "asterisk/threadstorage.h"
+#include "include/res_pjsip_private.h"
+
+/*! \brief The number of pool size classes */
+#define POOL_CACHE_CLASSES 7
+/*! \brief The size of the smallest class, each class being twice the size of the one before */
+#define POOL_CACHE_MIN_SIZE 256
+/*! \brief How many pools of each class a thread keeps */
+#define POOL_CACHE_DEPTH 8
+
+#define POOL_CACHE_CLASS_SIZE(idx) ((pj_size_t) POOL_CACHE_MIN_SIZE << (idx))
+
+/*! \brief The pools released by a thread, for it to create again */
+struct pool_thread_cache {
+	/*! \brief The generation of the pool cache the pools were cached in */
+	unsigned int generation;
+	/*! \brief How many pools of each class are cached */
+	unsigned int count[POOL_CACHE_CLASSES];
+	/*! \brief The pools of each class */
+	pj_pool_t *pools[POOL_CACHE_CLASSES][POOL_CACHE_DEPTH];
+};
+
+/*! \brief How pools of a size class were created and released */
+struct pool_cache_stats {
+	/*! \brief Pools created from a thread cache */
+	uint64_t hits;
+	/*! \brief Pools created by the caching pool */
+	uint64_t misses;
+	/*! \brief Pools released to a thread cache */
+	uint64_t cached;
+	/*! \brief Pools released to the caching pool, the thread cache being full */
+	uint64_t returned;
+};
+
+static struct pool_cache_stats pool_cache_stats[POOL_CACHE_CLASSES];
+
+/*! \brief The caching pool behind the thread caches */
+static pj_caching_pool *pool_cache_cp;
+/*! \brief The pool factory given to pjsip */
+static pj_pool_factory pool_cache_factory;
+/*! \brief Non-zero if pools are cached per thread */
+static int pool_cache_enabled;
+/*!
+ * \brief Changed when the caching pool goes away
+ *
+ * Pools cached by threads before are freed with the caching pool, so
+ * caches of an older generation are forgotten rather than used.
+ */
+static unsigned int pool_cache_generation;
+
+static void pool_thread_cache_release(struct pool_thread_cache *cache)
+{
+	int idx;
+
+	for (idx = 0; idx < POOL_CACHE_CLASSES; idx++) {
+		while (cache->count[idx]) {
+			pj_pool_t *pool = cache->pools[idx][--cache->count[idx]];
+
+			pool->factory = &pool_cache_cp->factory;
+			pool_cache_cp->factory.release_pool(&pool_cache_cp->factory, pool);
+		}
+	}
+}
+
+static void pool_thread_cache_destroy(void *data)
+{
+	struct pool_thread_cache *cache = data;
+
+	if (pool_cache_enabled && cache->generation == pool_cache_generation) {
+		pool_thread_cache_release(cache);
+	}
+	ast_free(cache);
+}
+
+AST_THREADSTORAGE_CUSTOM(pool_thread_cache_storage, NULL, pool_thread_cache_destroy);
+
+static struct pool_thread_cache *pool_thread_cache_get(void)
+{
+	struct pool_thread_cache *cache;
+
+	if (!pool_cache_enabled) {
+		return NULL;
+	}
+
+	cache = ast_threadstorage_get(&pool_thread_cache_storage, sizeof(*cache));
+	if (cache && cache->generation != pool_cache_generation) {
+		memset(cache->count, 0, sizeof(cache->count));
+		cache->generation = pool_cache_generation;
+	}
+
+	return cache;
+}
+
+/*! \brief The smallest class a pool of the given size fits in, -1 if none */
+static int pool_class_fit(pj_size_t size)
+{
+	int idx;
+
+	for (idx = 0; idx < POOL_CACHE_CLASSES; idx++) {
+		if (size <= POOL_CACHE_CLASS_SIZE(idx)) {
+			return idx;
+		}
+	}
+
+	return -1;
+}
+
+/*! \brief The largest class a pool of the given capacity can serve, -1 if none */
+static int pool_class_serve(pj_size_t capacity)
+{
+	int idx;
+
+	/* Larger pools are wasted on the largest class */
+	if (capacity > 2 * POOL_CACHE_CLASS_SIZE(POOL_CACHE_CLASSES - 1)) {
+		return -1;
+	}
+
+	for (idx = POOL_CACHE_CLASSES - 1; idx >= 0; idx--) {
+		if (capacity >= POOL_CACHE_CLASS_SIZE(idx)) {
+			return idx;
+		}
+	}
+
+	return -1;
+}
+
+static pj_pool_t *pool_cache_create_pool(pj_pool_factory *factory, const char *name,
+	pj_size_t initial_size, pj_size_t increment_size, pj_pool_callback *callback)
+{
+	struct pool_thread_cache *cache;
+	pj_pool_t *pool;
+	int idx;
+
+	idx = pool_class_fit(initial_size);
+	cache = idx < 0 ? NULL : pool_thread_cache_get();
+	if (!cache) {
+		/* Released straight back to the caching pool */
+		return pool_cache_cp->factory.create_pool(&pool_cache_cp->factory, name,
+			initial_size, increment_size, callback);
+	}
+
+	if (cache->count[idx]) {
+		pool = cache->pools[idx][--cache->count[idx]];
+		pj_pool_init_int(pool, name, increment_size, callback);
+		ast_atomic_fetch_add(&pool_cache_stats[idx].hits, 1, __ATOMIC_RELAXED);
+		return pool;
+	}
+
+	pool = pool_cache_cp->factory.create_pool(&pool_cache_cp->factory, name,
+		POOL_CACHE_CLASS_SIZE(idx), increment_size, callback);
+	if (pool) {
+		pool->factory = &pool_cache_factory;
+		ast_atomic_fetch_add(&pool_cache_stats[idx].misses, 1, __ATOMIC_RELAXED);
+	}
+
+	return pool;
+}
+
+static void pool_cache_release_pool(pj_pool_factory *factory, pj_pool_t *pool)
+{
+	struct pool_thread_cache *cache;
+	int idx;
+
+	/* Back to its first block, which is what decides its class */
+	pj_pool_reset(pool);
+
+	idx = pool_class_serve(pj_pool_get_capacity(pool));
+	cache = idx < 0 ? NULL : pool_thread_cache_get();
+	if (cache && cache->count[idx] < POOL_CACHE_DEPTH) {
+		cache->pools[idx][cache->count[idx]++] = pool;
+		ast_atomic_fetch_add(&pool_cache_stats[idx].cached, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	if (idx >= 0) {
+		ast_atomic_fetch_add(&pool_cache_stats[idx].returned, 1, __ATOMIC_RELAXED);
+	}
+	pool->factory = &pool_cache_cp->factory;
+	pool_cache_cp->factory.release_pool(&pool_cache_cp->factory, pool);
+}
+
+static void pool_cache_dump_status(pj_pool_factory *factory, pj_bool_t detail)
+{
+	pool_cache_cp->factory.dump_status(&pool_cache_cp->factory, detail);
+}
+
+static pj_bool_t pool_cache_on_block_alloc(pj_pool_factory *factory, pj_size_t size)
+{
+	/* Keep the caching pool's accounting of the memory used right */
+	if (pool_cache_cp->factory.on_block_alloc) {
+		return pool_cache_cp->factory.on_block_alloc(&pool_cache_cp->factory, size);
+	}
+
+	return PJ_TRUE;
+}
+
+static void pool_cache_on_block_free(pj_pool_factory *factory, pj_size_t size)
+{
+	if (pool_cache_cp->factory.on_block_free) {
+		pool_cache_cp->factory.on_block_free(&pool_cache_cp->factory, size);
+	}
+}
+
+static char *cli_show_pool_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+#define FORMAT "%-8" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 "\n"
+	int idx;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "pjsip show pool cache";
+		e->usage =
+			"Usage: pjsip show pool cache\n"
+			"       Show how the memory pools of each size class were created and\n"
+			"       released, from and to the cache of the thread or the caching\n"
+			"       pool, and how much memory the caching pool holds.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!pool_cache_cp) {
+		ast_cli(a->fd, "The pool cache is not initialized.\n");
+		return CLI_SUCCESS;
+	}
+
+	ast_cli(a->fd, "Pools are %scached per thread.\n\n", pool_cache_enabled ? "" : "not ");
+	ast_cli(a->fd, "%-8s %12s %12s %12s %12s\n", "Size", "Hits", "Misses", "Cached", "Returned");
+	for (idx = 0; idx < POOL_CACHE_CLASSES; idx++) {
+		ast_cli(a->fd, FORMAT, (uint64_t) POOL_CACHE_CLASS_SIZE(idx),
+			ast_atomic_fetch_add(&pool_cache_stats[idx].hits, 0, __ATOMIC_RELAXED),
+			ast_atomic_fetch_add(&pool_cache_stats[idx].misses, 0, __ATOMIC_RELAXED),
+			ast_atomic_fetch_add(&pool_cache_stats[idx].cached, 0, __ATOMIC_RELAXED),
+			ast_atomic_fetch_add(&pool_cache_stats[idx].returned, 0, __ATOMIC_RELAXED));
+	}
+
+	ast_cli(a->fd, "\nCaching pool: %u pools in use, %u bytes cached, %u bytes used, %u bytes peak\n",
+		(unsigned int) pool_cache_cp->used_count, (unsigned int) pool_cache_cp->capacity,
+		(unsigned int) pool_cache_cp->used_size, (unsigned int) pool_cache_cp->peak_used_size);
+
+	return CLI_SUCCESS;
+#undef FORMAT
+}
+
+static struct ast_cli_entry cli_commands[] = {
+	AST_CLI_DEFINE(cli_show_pool_cache, "Show pjsip memory pool cache statistics"),
+};
+
+pj_pool_factory *ast_sip_initialize_pool_cache(pj_caching_pool *cp)
+{
+	pool_cache_cp = cp;
+
+	pool_cache_factory.policy = cp->factory.policy;
+	pool_cache_factory.create_pool = pool_cache_create_pool;
+	pool_cache_factory.release_pool = pool_cache_release_pool;
+	pool_cache_factory.dump_status = pool_cache_dump_status;
+	pool_cache_factory.on_block_alloc = pool_cache_on_block_alloc;
+	pool_cache_factory.on_block_free = pool_cache_on_block_free;
+
+	ast_atomic_fetch_add(&pool_cache_generation, 1, __ATOMIC_RELAXED);
+	/* Pools are not cached at all when debugging pool memory */
+	pool_cache_enabled = ast_option_pjproject_cache_pools;
+
+	ast_cli_register_multiple(cli_commands, ARRAY_LEN(cli_commands));
+
+	return &pool_cache_factory;
+}
+
+void ast_sip_destroy_pool_cache(void)
+{
+	struct pool_thread_cache *cache;
+
+	ast_cli_unregister_multiple(cli_commands, ARRAY_LEN(cli_commands));
+
+	/* The pools cached by other threads go with the caching pool */
+	cache = pool_thread_cache_get();
+	if (cache) {
+		pool_thread_cache_release(cache);
+	}
+	pool_cache_enabled = 0;
+	ast_atomic_fetch_add(&pool_cache_generation, 1, __ATOMIC_RELAXED);
+}
@@ -277,6 +277,31 @@ static int transport_tls_verify(const pjsip_transport *transport,
 	return 1;
 }
 
+/*! \brief Count a TLS handshake on the transport it was made over */
+static void transport_tls_count(const pjsip_transport *transport, int verified)
+{
+	struct ast_sip_transport_state *state;
+
+	if (ast_strlen_zero(transport->factory->info)) {
+		return;
+	}
+
+	state = ast_sip_get_transport_state(transport->factory->info);
+	if (!state) {
+		return;
+	}
+
+	if (!verified) {
+		ast_atomic_fetchadd_int(&state->tls_verify_failures, 1);
+	} else if (transport->dir == PJSIP_TP_DIR_INCOMING) {
+		ast_atomic_fetchadd_int(&state->tls_handshakes_incoming, 1);
+	} else {
+		ast_atomic_fetchadd_int(&state->tls_handshakes_outgoing, 1);
+	}
+
+	ao2_ref(state, -1);
+}
+
 /*! \brief Callback invoked when transport state changes occur */
 static void transport_state_callback(pjsip_transport *transport,
 	pjsip_transport_state state, const pjsip_transport_state_info *info)
@@ -295,10 +320,13 @@ static void transport_state_callback(pjsip_transport *transport,
 			pj_atomic_get(transport->ref_cnt), transport_state2str(state));
 		switch (state) {
 		case PJSIP_TP_STATE_CONNECTED:
-			if (PJSIP_TRANSPORT_IS_SECURE(transport) &&
-				!transport_tls_verify(transport, info->ext_info)) {
-				pjsip_transport_shutdown(transport);
-				return;
+			if (PJSIP_TRANSPORT_IS_SECURE(transport)) {
+				if (!transport_tls_verify(transport, info->ext_info)) {
+					transport_tls_count(transport, 0);
+					pjsip_transport_shutdown(transport);
+					return;
+				}
+				transport_tls_count(transport, 1);
 			}
 
 			monitored = ao2_alloc_options(sizeof(*monitored),
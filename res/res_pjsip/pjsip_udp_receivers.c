@@ -0,0 +1,285 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief UDP transports receiving on several SO_REUSEPORT sockets
+ *
+ * The transport's own socket is read by the PJSIP monitor thread as usual.
+ * The other sockets bound to the same address are each read by a thread of
+ * their own, which parses the packets and hands them to the PJSIP transport
+ * manager, and from there to the distributor, as if they had arrived on the
+ * transport itself.  The kernel spreads the incoming traffic over the sockets
+ * by source address and port, so the packets of a flow stay in order.
+ */
+
+#include "asterisk.h"
+
+#include <pjsip.h>
+#include <pjlib.h>
+
+#include "asterisk/affinity.h"
+#include "asterisk/res_pjsip.h"
+#include "asterisk/utils.h"
+#include "asterisk/poll-compat.h"
+#include "include/res_pjsip_private.h"
+
+/*! \brief How often, in milliseconds, an idle receiver checks whether to stop */
+#define RECEIVER_POLL_MS 200
+
+/*! \brief A socket sharing a transport's address and the thread reading it */
+struct udp_receiver {
+	/*! \brief The receivers this one belongs to */
+	struct ast_sip_udp_receivers *receivers;
+	/*! \brief The socket */
+	pj_sock_t sock;
+	/*! \brief Pool the received packets are parsed into */
+	pj_pool_t *pool;
+	/*! \brief The thread reading the socket */
+	pthread_t thread;
+};
+
+/*! \brief Additional receive sockets of a UDP transport */
+struct ast_sip_udp_receivers {
+	/*! \brief The transport the packets are received for */
+	pjsip_transport *transport;
+	/*! \brief Set when the threads should stop */
+	int stop;
+	/*! \brief Number of receivers */
+	unsigned int count;
+	/*! \brief The receivers */
+	struct udp_receiver receiver[0];
+};
+
+/*!
+ * \internal
+ * \brief Create a UDP socket bound to an address shared with other sockets
+ */
+static pj_status_t reuseport_socket_create(const pj_sockaddr *host, pj_sock_t *sock)
+{
+#ifdef SO_REUSEPORT
+	int on = 1;
+	pj_status_t status;
+
+	status = pj_sock_socket(host->addr.sa_family, pj_SOCK_DGRAM(), 0, sock);
+	if (status != PJ_SUCCESS) {
+		return status;
+	}
+
+	status = pj_sock_setsockopt(*sock, pj_SOL_SOCKET(), SO_REUSEPORT, &on, sizeof(on));
+	if (status == PJ_SUCCESS) {
+		status = pj_sock_bind(*sock, host, pj_sockaddr_get_len(host));
+	}
+	if (status != PJ_SUCCESS) {
+		pj_sock_close(*sock);
+		*sock = PJ_INVALID_SOCKET;
+	}
+
+	return status;
+#else
+	ast_log(LOG_ERROR, "SO_REUSEPORT is not supported on this platform\n");
+	return PJ_ENOTSUP;
+#endif
+}
+
+/*!
+ * \internal
+ * \brief Allocate the structure a packet is received into
+ */
+static pjsip_rx_data *receiver_rdata_alloc(struct udp_receiver *receiver)
+{
+	pjsip_rx_data *rdata;
+
+	rdata = pj_pool_zalloc(receiver->pool, sizeof(*rdata));
+	rdata->tp_info.pool = receiver->pool;
+	rdata->tp_info.transport = receiver->receivers->transport;
+	rdata->tp_info.op_key.rdata = rdata;
+
+	return rdata;
+}
+
+/*! \brief Thread which reads one of the sockets of a transport */
+static void *receiver_thread(void *data)
+{
+	struct udp_receiver *receiver = data;
+	pjsip_transport *transport = receiver->receivers->transport;
+	pj_thread_desc desc = { 0 };
+	pj_thread_t *thread;
+	pjsip_rx_data *rdata;
+
+	ast_thread_affinity_apply(AST_THREAD_AFFINITY_SIGNALING, -1);
+
+	if (pj_thread_register("Asterisk UDP Receiver", desc, &thread) != PJ_SUCCESS) {
+		ast_log(LOG_ERROR, "Could not register UDP receive thread of transport '%s' with PJLIB\n",
+			transport->obj_name);
+		return NULL;
+	}
+
+	rdata = receiver_rdata_alloc(receiver);
+
+	while (!receiver->receivers->stop) {
+		struct pollfd pfd = { .fd = receiver->sock, .events = POLLIN };
+		pj_ssize_t len = sizeof(rdata->pkt_info.packet);
+
+		if (ast_poll(&pfd, 1, RECEIVER_POLL_MS) <= 0) {
+			continue;
+		}
+
+		rdata->pkt_info.src_addr_len = sizeof(rdata->pkt_info.src_addr);
+		if (pj_sock_recvfrom(receiver->sock, rdata->pkt_info.packet, &len, 0,
+				&rdata->pkt_info.src_addr, &rdata->pkt_info.src_addr_len) != PJ_SUCCESS
+			|| len <= 0) {
+			continue;
+		}
+
+		rdata->pkt_info.len = len;
+		rdata->pkt_info.zero = 0;
+		pj_gettimeofday(&rdata->pkt_info.timestamp);
+		pj_sockaddr_print(&rdata->pkt_info.src_addr, rdata->pkt_info.src_name,
+			sizeof(rdata->pkt_info.src_name), 0);
+		rdata->pkt_info.src_port = pj_sockaddr_get_port(&rdata->pkt_info.src_addr);
+
+		pjsip_tpmgr_receive_packet(transport->tpmgr, rdata);
+
+		/* Anything that outlives the packet was cloned out of the pool */
+		pj_pool_reset(receiver->pool);
+		rdata = receiver_rdata_alloc(receiver);
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Fill in the address a transport publishes from the address its socket is bound to
+ */
+static void published_name_get(pj_sock_t sock, pjsip_host_port *a_name, char *buf, size_t size)
+{
+	pj_sockaddr addr;
+	int addr_len = sizeof(addr);
+
+	pj_sock_getsockname(sock, &addr, &addr_len);
+	if (!pj_sockaddr_has_addr(&addr)) {
+		pj_sockaddr host_ip;
+
+		if (pj_gethostip(addr.addr.sa_family, &host_ip) == PJ_SUCCESS) {
+			pj_sockaddr_copy_addr(&addr, &host_ip);
+		}
+	}
+
+	pj_sockaddr_print(&addr, buf, size, 0);
+	pj_strset2(&a_name->host, buf);
+	a_name->port = pj_sockaddr_get_port(&addr);
+}
+
+int ast_sip_udp_receivers_start(struct ast_sip_transport_state *state,
+	unsigned int async_cnt, unsigned int count)
+{
+	struct ast_sip_udp_receivers *receivers;
+	pj_sock_t sock;
+	pjsip_host_port a_name;
+	char host[PJ_INET6_ADDRSTRLEN];
+	pj_status_t status;
+	unsigned int i;
+
+	ast_assert(count > 1);
+
+	/* The transport's own socket must also be in the group so it is created here */
+	status = reuseport_socket_create(&state->host, &sock);
+	if (status != PJ_SUCCESS) {
+		return status;
+	}
+
+	published_name_get(sock, &a_name, host, sizeof(host));
+	status = pjsip_udp_transport_attach2(ast_sip_get_pjsip_endpoint(),
+		state->host.addr.sa_family == pj_AF_INET6() ? PJSIP_TRANSPORT_UDP6 : PJSIP_TRANSPORT_UDP,
+		sock, &a_name, async_cnt, &state->transport);
+	if (status != PJ_SUCCESS) {
+		pj_sock_close(sock);
+		return status;
+	}
+
+	receivers = ast_calloc(1, sizeof(*receivers) + (count - 1) * sizeof(receivers->receiver[0]));
+	if (!receivers) {
+		pjsip_transport_shutdown(state->transport);
+		state->transport = NULL;
+		return PJ_ENOMEM;
+	}
+	receivers->transport = state->transport;
+	pjsip_transport_add_ref(receivers->transport);
+	state->udp_receivers = receivers;
+
+	for (i = 0; i < count - 1; ++i) {
+		struct udp_receiver *receiver = &receivers->receiver[i];
+
+		receiver->receivers = receivers;
+		receiver->thread = AST_PTHREADT_NULL;
+
+		status = reuseport_socket_create(&state->host, &receiver->sock);
+		if (status != PJ_SUCCESS) {
+			break;
+		}
+		++receivers->count;
+
+		receiver->pool = pjsip_endpt_create_pool(ast_sip_get_pjsip_endpoint(), "UDP Receiver",
+			PJSIP_POOL_RDATA_LEN, PJSIP_POOL_RDATA_INC);
+		if (!receiver->pool) {
+			status = PJ_ENOMEM;
+			break;
+		}
+
+		if (ast_pthread_create(&receiver->thread, NULL, receiver_thread, receiver)) {
+			receiver->thread = AST_PTHREADT_NULL;
+			status = PJ_ENOMEM;
+			break;
+		}
+	}
+
+	if (status != PJ_SUCCESS) {
+		ast_sip_udp_receivers_stop(state);
+		pjsip_transport_shutdown(state->transport);
+		state->transport = NULL;
+	}
+
+	return status;
+}
+
+void ast_sip_udp_receivers_stop(struct ast_sip_transport_state *state)
+{
+	struct ast_sip_udp_receivers *receivers = state->udp_receivers;
+	unsigned int i;
+
+	if (!receivers) {
+		return;
+	}
+
+	receivers->stop = 1;
+	for (i = 0; i < receivers->count; ++i) {
+		struct udp_receiver *receiver = &receivers->receiver[i];
+
+		if (receiver->thread != AST_PTHREADT_NULL) {
+			pthread_join(receiver->thread, NULL);
+		}
+		if (receiver->pool) {
+			pjsip_endpt_release_pool(ast_sip_get_pjsip_endpoint(), receiver->pool);
+		}
+		pj_sock_close(receiver->sock);
+	}
+
+	pjsip_transport_dec_ref(receivers->transport);
+	ast_free(receivers);
+	state->udp_receivers = NULL;
+}
@@ -22,6 +22,7 @@
 
 #include "asterisk/res_pjsip.h"
 #include "asterisk/logger.h"
+#include "asterisk/md5.h"
 #include "asterisk/module.h"
 #include "asterisk/strings.h"
 #include "asterisk/test.h"
@@ -172,6 +173,12 @@ static pj_status_t digest_lookup(pj_pool_t *pool, const pj_str_t *realm,
 
 	switch (auth->type) {
 	case AST_SIP_AUTH_TYPE_USER_PASS:
+		if (!pj_strcmp2(realm, auth->ha1_realm)) {
+			/* The credentials were already hashed for this realm */
+			pj_strdup2(pool, &info->data, auth->ha1);
+			info->data_type = PJSIP_CRED_DATA_DIGEST;
+			break;
+		}
 		pj_strdup2(pool, &info->data, auth->auth_pass);
 		info->data_type = PJSIP_CRED_DATA_PLAIN_PASSWD;
 		break;
@@ -186,16 +193,54 @@ static pj_status_t digest_lookup(pj_pool_t *pool, const pj_str_t *realm,
 }
 
 /*!
- * \brief Calculate a nonce
+ * \brief Calculate the hash of a nonce
  *
- * We use this in order to create authentication challenges. We also use this in order
- * to verify that an incoming request with credentials could be in response to one
- * of our challenges.
+ * The hash is of a timestamp, the source IP address, a unique ID for us,
+ * and the realm. This helps to ensure that the incoming request is from the
+ * same source that the nonce was calculated for. Including the realm ensures
+ * that multiple challenges to the same request have different nonces.
  *
- * The nonce is calculated from a timestamp, the source IP address, the source port, a
- * unique ID for us, and the realm. This helps to ensure that the incoming request
- * is from the same source that the nonce was calculated for. Including the realm
- * ensures that multiple challenges to the same request have different nonces.
+ * \param[out] hash The hash as a hex string
+ * \param timestamp A UNIX timestamp expressed as a string
+ * \param timestamp_len Length of the timestamp
+ * \param rdata The incoming request
+ * \param eid Our unique ID
+ * \param realm The realm for which authentication should occur
+ */
+static void nonce_hash(char hash[33], const char *timestamp, size_t timestamp_len,
+	const pjsip_rx_data *rdata, const char *eid, const char *realm)
+{
+	static const char hex[] = "0123456789abcdef";
+	struct MD5Context md5;
+	unsigned char digest[16];
+	int i;
+
+	/*
+	 * Note you may be tempted to think why not include the port. The reason
+	 * is that when using TCP the port can potentially differ from before.
+	 */
+	MD5Init(&md5);
+	MD5Update(&md5, (const unsigned char *) timestamp, timestamp_len);
+	MD5Update(&md5, (const unsigned char *) ":", 1);
+	MD5Update(&md5, (const unsigned char *) rdata->pkt_info.src_name, strlen(rdata->pkt_info.src_name));
+	MD5Update(&md5, (const unsigned char *) ":", 1);
+	MD5Update(&md5, (const unsigned char *) eid, strlen(eid));
+	MD5Update(&md5, (const unsigned char *) ":", 1);
+	MD5Update(&md5, (const unsigned char *) realm, strlen(realm));
+	MD5Final(digest, &md5);
+
+	for (i = 0; i < sizeof(digest); i++) {
+		hash[i * 2] = hex[digest[i] >> 4];
+		hash[i * 2 + 1] = hex[digest[i] & 0xf];
+	}
+	hash[32] = '\0';
+}
+
+/*!
+ * \brief Calculate a nonce
+ *
+ * We use this in order to create authentication challenges. The nonce is
+ * the timestamp followed by the hash from nonce_hash().
  *
  * \param nonce
  * \param timestamp A UNIX timestamp expressed as a string
@@ -204,20 +249,14 @@ static pj_status_t digest_lookup(pj_pool_t *pool, const pj_str_t *realm,
  */
 static int build_nonce(struct ast_str **nonce, const char *timestamp, const pjsip_rx_data *rdata, const char *realm)
 {
-	struct ast_str *str = ast_str_alloca(256);
 	RAII_VAR(char *, eid, ao2_global_obj_ref(entity_id), ao2_cleanup);
 	char hash[33];
 
-	/*
-	 * Note you may be tempted to think why not include the port. The reason
-	 * is that when using TCP the port can potentially differ from before.
-	 */
-	ast_str_append(&str, 0, "%s", timestamp);
-	ast_str_append(&str, 0, ":%s", rdata->pkt_info.src_name);
-	ast_str_append(&str, 0, ":%s", eid);
-	ast_str_append(&str, 0, ":%s", realm);
-	ast_md5_hash(hash, ast_str_buffer(str));
+	if (!eid) {
+		return -1;
+	}
 
+	nonce_hash(hash, timestamp, strlen(timestamp), rdata, eid, realm);
 	ast_str_append(nonce, 0, "%s/%s", timestamp, hash);
 	return 0;
 }
@@ -226,38 +265,44 @@ static int build_nonce(struct ast_str **nonce, const char *timestamp, const pjsi
  * \brief Ensure that a nonce on an incoming request is sane.
  *
  * The nonce in an incoming Authorization header needs to pass some scrutiny in order
- * for us to consider accepting it. What we do is re-build a nonce based on request
- * data and a realm and see if it matches the nonce they sent us.
+ * for us to consider accepting it. What we do is hash the timestamp in it with the
+ * request data and a realm and see if that matches the hash they sent us. This is
+ * done on the header as it is, nothing is copied.
  * \param candidate The nonce on an incoming request
  * \param rdata The incoming request
  * \param auth The auth credentials we are trying to match against.
+ * \param eid Our unique ID
  * \retval 0 Nonce does not pass validity checks
  * \retval 1 Nonce passes validity check
  */
-static int check_nonce(const char *candidate, const pjsip_rx_data *rdata, const struct ast_sip_auth *auth)
+static int check_nonce(const pj_str_t *candidate, const pjsip_rx_data *rdata,
+	const struct ast_sip_auth *auth, const char *eid)
 {
-	char *copy = ast_strdupa(candidate);
-	char *timestamp = strsep(&copy, "/");
-	int timestamp_int;
+	const char *timestamp = candidate->ptr;
+	size_t timestamp_len;
+	long timestamp_int = 0;
 	time_t now = time(NULL);
-	struct ast_str *calculated = ast_str_alloca(64);
+	char calculated[33];
 
-	if (!copy) {
-		/* Clearly a bad nonce! */
-		return 0;
+	/* We only ever send a decimal timestamp, a '/' and then the hash */
+	for (timestamp_len = 0; timestamp_len < candidate->slen && timestamp_len < 30
+		&& isdigit(timestamp[timestamp_len]); timestamp_len++) {
+		timestamp_int = timestamp_int * 10 + timestamp[timestamp_len] - '0';
 	}
-
-	if (sscanf(timestamp, "%30d", &timestamp_int) != 1) {
+	if (!timestamp_len || candidate->slen != timestamp_len + 1 + 32
+		|| timestamp[timestamp_len] != '/') {
+		/* Clearly a bad nonce! */
 		return 0;
 	}
 
-	if ((int) now - timestamp_int > auth->nonce_lifetime) {
+	if ((long) now - timestamp_int > auth->nonce_lifetime) {
 		return 0;
 	}
 
-	build_nonce(&calculated, timestamp, rdata, auth->realm);
-	ast_debug(3, "Calculated nonce %s. Actual nonce is %s\n", ast_str_buffer(calculated), candidate);
-	if (strcmp(ast_str_buffer(calculated), candidate)) {
+	nonce_hash(calculated, timestamp, timestamp_len, rdata, eid, auth->realm);
+	ast_debug(3, "Calculated nonce hash %s. Actual nonce is %.*s\n", calculated,
+		(int) candidate->slen, candidate->ptr);
+	if (memcmp(calculated, timestamp + timestamp_len + 1, 32)) {
 		return 0;
 	}
 	return 1;
@@ -266,12 +311,16 @@ static int check_nonce(const char *candidate, const pjsip_rx_data *rdata, const
 static int find_challenge(const pjsip_rx_data *rdata, const struct ast_sip_auth *auth)
 {
 	struct pjsip_authorization_hdr *auth_hdr = (pjsip_authorization_hdr *) &rdata->msg_info.msg->hdr;
+	RAII_VAR(char *, eid, ao2_global_obj_ref(entity_id), ao2_cleanup);
 	int challenge_found = 0;
-	char nonce[64];
+
+	if (!eid) {
+		return 0;
+	}
 
 	while ((auth_hdr = (pjsip_authorization_hdr *) pjsip_msg_find_hdr(rdata->msg_info.msg, PJSIP_H_AUTHORIZATION, auth_hdr->next))) {
-		ast_copy_pj_str(nonce, &auth_hdr->credential.digest.nonce, sizeof(nonce));
-		if (check_nonce(nonce, rdata, auth) && !pj_strcmp2(&auth_hdr->credential.digest.realm, auth->realm)) {
+		if (!pj_strcmp2(&auth_hdr->credential.digest.realm, auth->realm)
+			&& check_nonce(&auth_hdr->credential.digest.nonce, rdata, auth, eid)) {
 			challenge_found = 1;
 			break;
 		}
@@ -284,13 +284,31 @@ struct object_type_wizard {
 	struct ast_sorcery_wizard *wizard;
 	void *wizard_data;
 	struct ast_config *last_config;
+	/*! The wizard sections of last_config by name */
+	struct ao2_container *last_sections;
 	char object_type[];
 };
 static AST_VECTOR_RW(object_type_wizards, struct object_type_wizard *) object_type_wizards;
 
+/*! \brief A wizard section of the last config loaded */
+struct wizard_section {
+	/*! The name of the section, owned by the category */
+	const char *name;
+	/*! The section in the last config */
+	struct ast_category *category;
+	/*! A hash of the variables of the section */
+	unsigned int hash;
+};
+
+#define WIZARD_SECTION_BUCKETS 1021
+
+AO2_STRING_FIELD_HASH_FN(wizard_section, name);
+AO2_STRING_FIELD_CMP_FN(wizard_section, name);
+
 /*! \brief Callbacks for vector deletes */
 #define NOT_EQUALS(a, b) (a != b)
 #define OTW_DELETE_CB(otw) ({ \
+	ao2_cleanup(otw->last_sections); \
 	ast_config_destroy(otw->last_config); \
 	ast_free(otw); \
 })
@@ -1023,6 +1041,50 @@ static int wizard_apply_handler(const struct ast_sorcery *sorcery, struct object
 	return rc;
 }
 
+/*! \brief Hashes the variables of a wizard section, in order */
+static unsigned int wizard_section_hash(struct ast_category *category)
+{
+	struct ast_variable *var;
+	unsigned int hash = 0;
+
+	for (var = ast_category_first(category); var; var = var->next) {
+		hash = hash * 33 + (unsigned int) ast_str_hash(var->name);
+		hash = hash * 33 + (unsigned int) ast_str_hash(var->value);
+	}
+
+	return hash;
+}
+
+/*! \brief Indexes the wizard sections of a config by name */
+static struct ao2_container *wizard_sections_alloc(struct ast_config *cfg)
+{
+	struct ao2_container *sections;
+	struct ast_category *category = NULL;
+
+	sections = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, WIZARD_SECTION_BUCKETS,
+		wizard_section_hash_fn, NULL, wizard_section_cmp_fn);
+	if (!sections) {
+		return NULL;
+	}
+
+	while ((category = ast_category_browse_filtered(cfg, NULL, category, "type=^wizard$"))) {
+		struct wizard_section *section;
+
+		section = ao2_alloc_options(sizeof(*section), NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!section) {
+			ao2_ref(sections, -1);
+			return NULL;
+		}
+		section->name = ast_category_get_name(category);
+		section->category = category;
+		section->hash = wizard_section_hash(category);
+		ao2_link(sections, section);
+		ao2_ref(section, -1);
+	}
+
+	return sections;
+}
+
 /*
  * Everything below are the sorcery observers.
  */
@@ -1051,11 +1113,13 @@ struct ast_sorcery_instance_observer observer = {
 static void object_type_loaded_observer(const char *name,
 	const struct ast_sorcery *sorcery, const char *object_type, int reloaded)
 {
-	struct ast_category *category = NULL;
 	struct object_type_wizard *otw = NULL;
 	char *filename = "pjsip_wizard.conf";
 	struct ast_flags flags = { 0 };
 	struct ast_config *cfg;
+	struct ao2_container *sections;
+	struct ao2_iterator iter;
+	struct wizard_section *section;
 
 	if (!strstr("auth aor endpoint identify registration phoneprov", object_type)) {
 		/* Not interested. */
@@ -1085,50 +1149,65 @@ static void object_type_loaded_observer(const char *name,
 		return;
 	}
 
-	while ((category = ast_category_browse_filtered(cfg, NULL, category, "type=^wizard$"))) {
-		const char *id = ast_category_get_name(category);
-		struct ast_category *last_cat = NULL;
-		int changes = 0;
-
-		if (otw->last_config) {
-			last_cat = ast_category_get(otw->last_config, id, "type=^wizard$");
-			changes = !ast_variable_lists_match(ast_category_first(category), ast_category_first(last_cat), 1);
-			if (last_cat) {
-				ast_category_delete(otw->last_config, last_cat);
-			}
+	sections = wizard_sections_alloc(cfg);
+	if (!sections) {
+		ast_log(LOG_ERROR, "Unable to index the wizards of config file '%s'\n", filename);
+		ast_config_destroy(cfg);
+		return;
+	}
+
+	/* Only the sections whose variables differ from last time need their objects recreated.
+	 * The hashes rule out most sections without comparing their variables.
+	 */
+	iter = ao2_iterator_init(sections, 0);
+	for (; (section = ao2_iterator_next(&iter)); ao2_ref(section, -1)) {
+		const char *id = section->name;
+		struct wizard_section *last = NULL;
+		int changes = 1;
+
+		if (otw->last_sections) {
+			last = ao2_find(otw->last_sections, id, OBJ_SEARCH_KEY | OBJ_UNLINK);
+			changes = !last || last->hash != section->hash
+				|| !ast_variable_lists_match(ast_category_first(section->category),
+					ast_category_first(last->category), 1);
+			ao2_cleanup(last);
 		}
 
-		if (!last_cat || changes) {
+		if (changes) {
 			ast_debug(3, "%s: %s(s) for wizard '%s'\n", reloaded ? "Reload" : "Load", object_type, id);
-			if (wizard_apply_handler(sorcery, otw, category)) {
+			if (wizard_apply_handler(sorcery, otw, section->category)) {
 				ast_log(LOG_ERROR, "Unable to create objects for wizard '%s'\n", id);
 			}
 		}
 	}
+	ao2_iterator_destroy(&iter);
 
 	if (!otw->last_config) {
 		otw->last_config = cfg;
+		otw->last_sections = sections;
 		return;
 	}
 
-	/* Only wizards that weren't in the new config are left in last_config now so we need to delete
+	/* Only wizards that weren't in the new config are left in last_sections now so we need to delete
 	 * all objects belonging to them.
 	 */
-	category = NULL;
-	while ((category = ast_category_browse_filtered(otw->last_config, NULL, category, "type=^wizard$"))) {
-		const char *id = ast_category_get_name(category);
+	iter = ao2_iterator_init(otw->last_sections, 0);
+	for (; (section = ao2_iterator_next(&iter)); ao2_ref(section, -1)) {
+		const char *id = section->name;
 		struct ast_variable *search;
 		RAII_VAR(struct ao2_container *, existing,
 			ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, NULL, NULL), ao2_cleanup);
 
 		if (!existing) {
 			ast_log(LOG_ERROR, "Unable to allocate temporary container.\n");
+			ao2_ref(section, -1);
 			break;
 		}
 
 		search = ast_variable_new("@pjsip_wizard", id, "");
 		if (!search) {
 			ast_log(LOG_ERROR, "Unable to allocate memory for vaiable '@pjsip_wizard'.\n");
+			ao2_ref(section, -1);
 			break;
 		}
 		otw->wizard->retrieve_multiple(sorcery, otw->wizard_data, object_type, existing, search);
@@ -1141,7 +1220,10 @@ static void object_type_loaded_observer(const char *name,
 				delete_existing_cb, otw);
 		}
 	}
+	ao2_iterator_destroy(&iter);
 
+	ao2_ref(otw->last_sections, -1);
+	otw->last_sections = sections;
 	ast_config_destroy(otw->last_config);
 	otw->last_config = cfg;
 }
@@ -1169,6 +1251,7 @@ static void wizard_mapped_observer(const char *name, struct ast_sorcery *sorcery
 		otw->wizard = wizard;
 		otw->wizard_data = wizard_data;
 		otw->last_config = NULL;
+		otw->last_sections = NULL;
 		strcpy(otw->object_type, object_type); /* Safe */
 		AST_VECTOR_RW_WRLOCK(&object_type_wizards);
 		if (AST_VECTOR_APPEND(&object_type_wizards, otw)) {
@@ -353,14 +353,527 @@ static struct ast_sip_endpoint *common_identify(ao2_callback_fn *identify_match_
 	return endpoint;
 }
 
+/*!
+ * \brief A rule of an identify, in the node of its network
+ */
+struct identify_trie_rule {
+	/*! \brief Position of the identify in the trie's identifies */
+	unsigned int identify;
+	/*! \brief Position of the rule among the rules of its identify */
+	unsigned int index;
+	/*! \brief The port the rule is limited to, 0 for any */
+	uint16_t port;
+	/*! \brief AST_SENSE_DENY if addresses matching the rule match the identify */
+	enum ast_acl_sense sense;
+	struct identify_trie_rule *next;
+};
+
+/*!
+ * \brief A node of a path compressed binary trie of networks
+ *
+ * A node is only created where rules are or where two networks branch,
+ * so a lookup visits at most one node per bit of the address.
+ */
+struct identify_trie_node {
+	struct identify_trie_node *child[2];
+	/*! \brief The rules whose network is the prefix of this node */
+	struct identify_trie_rule *rules;
+	/*! \brief How many bits of the prefix are significant */
+	unsigned int bits;
+	/*! \brief The network, in network byte order */
+	uint8_t prefix[16];
+};
+
+/*!
+ * \brief The match networks of every identify, for longest prefix lookups
+ *
+ * Rebuilt whenever identifies change, and replaced as a whole so lookups
+ * never need to lock it.
+ */
+struct identify_trie {
+	/*! \brief Roots of the IPv4 and IPv6 tries */
+	struct identify_trie_node *roots[2];
+	/*! \brief The identifies matching by address, holding their references */
+	AST_VECTOR(, struct ip_identify_match *) identifies;
+	/*! \brief Identifies with netmasks that are not prefixes, checked one by one */
+	AST_VECTOR(, struct ip_identify_match *) unindexed;
+};
+
+/*! \brief The current identify trie, NULL to check every identify instead */
+static AO2_GLOBAL_OBJ_STATIC(current_identify_trie);
+
+/*!
+ * \internal
+ * \brief Get the bytes of an address to look up in a trie
+ *
+ * \return 32 for IPv4 or 128 for IPv6 addresses, 0 otherwise
+ */
+static unsigned int identify_trie_key(const struct ast_sockaddr *addr, uint8_t *key)
+{
+	if (ast_sockaddr_is_ipv4(addr)) {
+		memcpy(key, &((const struct sockaddr_in *) &addr->ss)->sin_addr, 4);
+		return 32;
+	}
+
+	if (ast_sockaddr_is_ipv6(addr)) {
+		memcpy(key, &((const struct sockaddr_in6 *) &addr->ss)->sin6_addr, 16);
+		return 128;
+	}
+
+	return 0;
+}
+
+static int identify_trie_bit(const uint8_t *key, unsigned int bit)
+{
+	return (key[bit / 8] >> (7 - bit % 8)) & 1;
+}
+
+/*! \brief How many leading bits, up to max, two keys have in common */
+static unsigned int identify_trie_common_bits(const uint8_t *a, const uint8_t *b, unsigned int max)
+{
+	unsigned int bits = 0;
+
+	while (bits < max) {
+		uint8_t diff = a[bits / 8] ^ b[bits / 8];
+
+		if (!diff) {
+			bits += 8;
+			continue;
+		}
+		while (!(diff & 0x80)) {
+			diff <<= 1;
+			bits++;
+		}
+		break;
+	}
+
+	return MIN(bits, max);
+}
+
+/*!
+ * \internal
+ * \brief Get the prefix length of a netmask
+ *
+ * \retval -1 if the netmask is not a prefix
+ */
+static int identify_trie_netmask_bits(const struct ast_sockaddr *netmask)
+{
+	uint8_t key[16];
+	unsigned int len = identify_trie_key(netmask, key);
+	unsigned int bits = 0;
+	unsigned int i;
+
+	if (!len) {
+		return -1;
+	}
+
+	while (bits < len && identify_trie_bit(key, bits)) {
+		bits++;
+	}
+	for (i = bits; i < len; i++) {
+		if (identify_trie_bit(key, i)) {
+			return -1;
+		}
+	}
+
+	return bits;
+}
+
+/*!
+ * \internal
+ * \brief Find the node of a network in a trie, adding it if there is none
+ */
+static struct identify_trie_node *identify_trie_insert(struct identify_trie_node **slot,
+	const uint8_t *prefix, unsigned int bits)
+{
+	struct identify_trie_node *node;
+	struct identify_trie_node *split;
+	struct identify_trie_node *leaf;
+	unsigned int common;
+
+	for (;;) {
+		node = *slot;
+		if (!node) {
+			leaf = ast_calloc(1, sizeof(*leaf));
+			if (!leaf) {
+				return NULL;
+			}
+			memcpy(leaf->prefix, prefix, sizeof(leaf->prefix));
+			leaf->bits = bits;
+			*slot = leaf;
+			return leaf;
+		}
+
+		common = identify_trie_common_bits(node->prefix, prefix, MIN(node->bits, bits));
+		if (common == node->bits) {
+			if (bits == node->bits) {
+				return node;
+			}
+			slot = &node->child[identify_trie_bit(prefix, node->bits)];
+			continue;
+		}
+
+		/* The network branches off within this node, so split it where it does */
+		split = ast_calloc(1, sizeof(*split));
+		if (!split) {
+			return NULL;
+		}
+		memcpy(split->prefix, prefix, sizeof(split->prefix));
+		split->bits = common;
+		split->child[identify_trie_bit(node->prefix, common)] = node;
+
+		if (common == bits) {
+			*slot = split;
+			return split;
+		}
+
+		leaf = ast_calloc(1, sizeof(*leaf));
+		if (!leaf) {
+			ast_free(split);
+			return NULL;
+		}
+		memcpy(leaf->prefix, prefix, sizeof(leaf->prefix));
+		leaf->bits = bits;
+		split->child[identify_trie_bit(prefix, common)] = leaf;
+		*slot = split;
+		return leaf;
+	}
+}
+
+static void identify_trie_node_free(struct identify_trie_node *node)
+{
+	struct identify_trie_rule *rule;
+
+	if (!node) {
+		return;
+	}
+
+	identify_trie_node_free(node->child[0]);
+	identify_trie_node_free(node->child[1]);
+	while ((rule = node->rules)) {
+		node->rules = rule->next;
+		ast_free(rule);
+	}
+	ast_free(node);
+}
+
+static void identify_trie_destroy(void *obj)
+{
+	struct identify_trie *trie = obj;
+
+	identify_trie_node_free(trie->roots[0]);
+	identify_trie_node_free(trie->roots[1]);
+	AST_VECTOR_CALLBACK_VOID(&trie->identifies, ao2_cleanup);
+	AST_VECTOR_FREE(&trie->identifies);
+	AST_VECTOR_CALLBACK_VOID(&trie->unindexed, ao2_cleanup);
+	AST_VECTOR_FREE(&trie->unindexed);
+}
+
+/*! \brief Whether every rule of an identify is a network that can go in a trie */
+static int identify_trie_indexable(const struct ip_identify_match *identify)
+{
+	const struct ast_ha *ha;
+
+	for (ha = identify->matches; ha; ha = ha->next) {
+		if (identify_trie_netmask_bits(&ha->netmask) < 0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*!
+ * \internal
+ * \brief Add the rules of an identify to a trie
+ */
+static int identify_trie_add(struct identify_trie *trie, struct ip_identify_match *identify)
+{
+	const struct ast_ha *ha;
+	unsigned int position = AST_VECTOR_SIZE(&trie->identifies);
+	unsigned int index = 0;
+
+	if (AST_VECTOR_APPEND(&trie->identifies, ao2_bump(identify))) {
+		ao2_ref(identify, -1);
+		return -1;
+	}
+
+	for (ha = identify->matches; ha; ha = ha->next, index++) {
+		struct identify_trie_node *node;
+		struct identify_trie_rule *rule;
+		struct identify_trie_rule **tail;
+		uint8_t prefix[16] = { 0, };
+		unsigned int len = identify_trie_key(&ha->addr, prefix);
+
+		node = identify_trie_insert(&trie->roots[len == 32 ? 0 : 1], prefix,
+			identify_trie_netmask_bits(&ha->netmask));
+		rule = ast_calloc(1, sizeof(*rule));
+		if (!node || !rule) {
+			ast_free(rule);
+			return -1;
+		}
+		rule->identify = position;
+		rule->index = index;
+		rule->port = ast_sockaddr_port(&ha->addr);
+		rule->sense = ha->sense;
+
+		/* Keep the rules of a node in the order of the identifies */
+		for (tail = &node->rules; *tail; tail = &(*tail)->next) {
+		}
+		*tail = rule;
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Build a trie of the match networks of some identifies
+ */
+static struct identify_trie *identify_trie_build(struct ao2_container *identifies)
+{
+	struct identify_trie *trie;
+	struct ip_identify_match *identify;
+	struct ao2_iterator it;
+	int res = 0;
+
+	trie = ao2_alloc_options(sizeof(*trie), identify_trie_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!trie) {
+		return NULL;
+	}
+	if (AST_VECTOR_INIT(&trie->identifies, ao2_container_count(identifies))
+		|| AST_VECTOR_INIT(&trie->unindexed, 0)) {
+		ao2_ref(trie, -1);
+		return NULL;
+	}
+
+	it = ao2_iterator_init(identifies, 0);
+	for (; !res && (identify = ao2_iterator_next(&it)); ao2_ref(identify, -1)) {
+		if (!identify->matches) {
+			continue;
+		}
+		if (!identify_trie_indexable(identify)) {
+			if (AST_VECTOR_APPEND(&trie->unindexed, ao2_bump(identify))) {
+				ao2_ref(identify, -1);
+				res = -1;
+			}
+			continue;
+		}
+		res = identify_trie_add(trie, identify);
+	}
+	ao2_iterator_destroy(&it);
+
+	if (res) {
+		ao2_ref(trie, -1);
+		return NULL;
+	}
+
+	return trie;
+}
+
+/*! \brief The deciding rule of an identify, for an address being looked up */
+struct identify_trie_hit {
+	unsigned int identify;
+	unsigned int index;
+	unsigned int bits;
+	enum ast_acl_sense sense;
+};
+
+/*!
+ * \internal
+ * \brief Find the identify an address matches the longest network of
+ *
+ * As with ast_apply_ha(), the last rule of an identify that an address
+ * matches decides whether the identify matches.  Of the identifies that
+ * match, the one whose deciding network is longest wins, and of those
+ * equally long the first.  Identifies whose netmasks are not prefixes are
+ * only checked if none in the trie match.
+ *
+ * \return The identify, with a reference, or NULL if none matches
+ */
+static struct ip_identify_match *identify_trie_find(struct identify_trie *trie,
+	const struct ast_sockaddr *addr)
+{
+	AST_VECTOR(, struct identify_trie_hit) hits;
+	struct identify_trie_hit *best = NULL;
+	struct identify_trie_node *node;
+	struct ast_sockaddr mapped;
+	struct ip_identify_match *identify = NULL;
+	uint16_t port = ast_sockaddr_port(addr);
+	uint8_t key[16];
+	unsigned int len;
+	int i;
+
+	if (ast_sockaddr_is_ipv4_mapped(addr) && ast_sockaddr_ipv4_mapped(addr, &mapped)) {
+		/* IPv4 rules apply to IPv4-mapped addresses, and only they do */
+		addr = &mapped;
+	}
+
+	len = identify_trie_key(addr, key);
+	if (!len || AST_VECTOR_INIT(&hits, 8)) {
+		return NULL;
+	}
+
+	for (node = trie->roots[len == 32 ? 0 : 1]; node; node = node->child[identify_trie_bit(key, node->bits)]) {
+		struct identify_trie_rule *rule;
+
+		if (identify_trie_common_bits(node->prefix, key, node->bits) < node->bits) {
+			break;
+		}
+
+		for (rule = node->rules; rule; rule = rule->next) {
+			struct identify_trie_hit hit = {
+				.identify = rule->identify,
+				.index = rule->index,
+				.bits = node->bits,
+				.sense = rule->sense,
+			};
+
+			if (rule->port && rule->port != port) {
+				continue;
+			}
+
+			for (i = 0; i < AST_VECTOR_SIZE(&hits); i++) {
+				if (AST_VECTOR_GET(&hits, i).identify == rule->identify) {
+					break;
+				}
+			}
+			if (i == AST_VECTOR_SIZE(&hits)) {
+				AST_VECTOR_APPEND(&hits, hit);
+			} else if (AST_VECTOR_GET(&hits, i).index < rule->index) {
+				AST_VECTOR_REPLACE(&hits, i, hit);
+			}
+		}
+
+		if (node->bits == len) {
+			break;
+		}
+	}
+
+	for (i = 0; i < AST_VECTOR_SIZE(&hits); i++) {
+		struct identify_trie_hit *hit = AST_VECTOR_GET_ADDR(&hits, i);
+
+		if (hit->sense == AST_SENSE_ALLOW) {
+			continue;
+		}
+		if (!best || hit->bits > best->bits
+			|| (hit->bits == best->bits && hit->identify < best->identify)) {
+			best = hit;
+		}
+	}
+	if (best) {
+		identify = ao2_bump(AST_VECTOR_GET(&trie->identifies, best->identify));
+	}
+	AST_VECTOR_FREE(&hits);
+
+	for (i = 0; !identify && i < AST_VECTOR_SIZE(&trie->unindexed); i++) {
+		if (ip_identify_match_check(AST_VECTOR_GET(&trie->unindexed, i), (void *) addr, 0)) {
+			identify = ao2_bump(AST_VECTOR_GET(&trie->unindexed, i));
+		}
+	}
+
+	if (identify) {
+		ast_debug(3, "Source address %s matches identify '%s'\n",
+			ast_sockaddr_stringify(addr), ast_sorcery_object_get_id(identify));
+	}
+
+	return identify;
+}
+
+/*!
+ * \internal
+ * \brief Rebuild the identify trie from the current identifies
+ *
+ * Identifies are only known to have changed when they come from a wizard
+ * that tells observers about changes, so for any other every identify is
+ * checked on each request as before.
+ */
+static void identify_trie_rebuild(void)
+{
+	struct ao2_container *identifies;
+	struct identify_trie *trie = NULL;
+	int count = ast_sorcery_get_wizard_mapping_count(ast_sip_get_sorcery(), "identify");
+	int i;
+
+	for (i = 0; i < count; i++) {
+		struct ast_sorcery_wizard *wizard;
+		int observed;
+
+		if (ast_sorcery_get_wizard_mapping(ast_sip_get_sorcery(), "identify", i, &wizard, NULL)) {
+			ao2_global_obj_release(current_identify_trie);
+			return;
+		}
+		observed = !strcmp(wizard->name, "config") || !strcmp(wizard->name, "memory");
+		ao2_ref(wizard, -1);
+		if (!observed) {
+			ao2_global_obj_release(current_identify_trie);
+			return;
+		}
+	}
+
+	identifies = ast_sorcery_retrieve_by_fields(ast_sip_get_sorcery(), "identify",
+		AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL);
+	if (identifies) {
+		trie = identify_trie_build(identifies);
+		ao2_ref(identifies, -1);
+	}
+
+	/* Without a trie every identify is checked, so nothing is missed */
+	ao2_global_obj_replace_unref(current_identify_trie, trie);
+	ao2_cleanup(trie);
+}
+
+static void identify_observer_changed(const void *object)
+{
+	identify_trie_rebuild();
+}
+
+static void identify_observer_loaded(const char *object_type)
+{
+	identify_trie_rebuild();
+}
+
+/*! \brief Observer keeping the identify trie up to date */
+static const struct ast_sorcery_observer identify_observer = {
+	.created = identify_observer_changed,
+	.updated = identify_observer_changed,
+	.deleted = identify_observer_changed,
+	.loaded = identify_observer_loaded,
+};
+
 static struct ast_sip_endpoint *ip_identify(pjsip_rx_data *rdata)
 {
 	struct ast_sockaddr addr = { { 0, } };
+	struct identify_trie *trie;
+	struct ip_identify_match *match;
+	struct ast_sip_endpoint *endpoint;
 
 	ast_sockaddr_parse(&addr, rdata->pkt_info.src_name, PARSE_PORT_FORBID);
 	ast_sockaddr_set_port(&addr, rdata->pkt_info.src_port);
 
-	return common_identify(ip_identify_match_check, &addr);
+	trie = ao2_global_obj_ref(current_identify_trie);
+	if (!trie) {
+		return common_identify(ip_identify_match_check, &addr);
+	}
+
+	match = identify_trie_find(trie, &addr);
+	ao2_ref(trie, -1);
+	if (!match) {
+		return NULL;
+	}
+
+	endpoint = ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "endpoint",
+		match->endpoint_name);
+	if (endpoint) {
+		ast_debug(3, "Identify '%s' SIP message matched to endpoint %s\n",
+			ast_sorcery_object_get_id(match), match->endpoint_name);
+	} else {
+		ast_log(LOG_WARNING, "Identify '%s' points to endpoint '%s' but endpoint could not be found\n",
+			ast_sorcery_object_get_id(match), match->endpoint_name);
+	}
+
+	ao2_ref(match, -1);
+	return endpoint;
 }
 
 static struct ast_sip_endpoint_identifier ip_identifier = {
@@ -923,14 +1436,16 @@ static char *my_cli_traverse_objects(struct ast_cli_entry *e, int cmd,
 static struct ast_cli_entry cli_identify[] = {
 AST_CLI_DEFINE(my_cli_traverse_objects, "List PJSIP Identifies",
 	.command = "pjsip list identifies",
-	.usage = "Usage: pjsip list identifies [ like <pattern> ]\n"
+	.usage = "Usage: pjsip list identifies [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 	"       List the configured PJSIP Identifies\n"
-	"       Optional regular expression pattern is used to filter the list.\n"),
+	"       Optional regular expression pattern is used to filter the list.\n"
+	"       Optional limit and after list a page of the objects, sorted by id.\n"),
 AST_CLI_DEFINE(my_cli_traverse_objects, "Show PJSIP Identifies",
 	.command = "pjsip show identifies",
-	.usage = "Usage: pjsip show identifies [ like <pattern> ]\n"
+	.usage = "Usage: pjsip show identifies [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 	"       Show the configured PJSIP Identifies\n"
-	"       Optional regular expression pattern is used to filter the list.\n"),
+	"       Optional regular expression pattern is used to filter the list.\n"
+	"       Optional limit and after list a page of the objects, sorted by id.\n"),
 AST_CLI_DEFINE(my_cli_traverse_objects, "Show PJSIP Identify",
 	.command = "pjsip show identify",
 	.usage = "Usage: pjsip show identify <id>\n"
@@ -954,6 +1469,7 @@ static int load_module(void)
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "identify", "match_header", "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct ip_identify_match, match_header));
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "identify", "match_request_uri", "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct ip_identify_match, match_request_uri));
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "identify", "srv_lookups", "yes", OPT_BOOL_T, 1, FLDSET(struct ip_identify_match, srv_lookups));
+	ast_sorcery_observer_add(ast_sip_get_sorcery(), "identify", &identify_observer);
 	ast_sorcery_load_object(ast_sip_get_sorcery(), "identify");
 
 	ast_sip_register_endpoint_identifier_with_name(&ip_identifier, "ip");
@@ -995,6 +1511,8 @@ static int unload_module(void)
 	ast_sip_unregister_endpoint_identifier(&header_identifier);
 	ast_sip_unregister_endpoint_identifier(&request_identifier);
 	ast_sip_unregister_endpoint_identifier(&ip_identifier);
+	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "identify", &identify_observer);
+	ao2_global_obj_release(current_identify_trie);
 
 	return 0;
 }
@@ -83,6 +83,8 @@ struct exten_state_subscription {
 	enum ast_extension_states last_exten_state;
 	/*! The last known presence state */
 	enum ast_presence_state last_presence_state;
+	/*! The state change waiting to be sent, protected by the object lock */
+	struct notify_task_data *pending;
 };
 
 /*!
@@ -288,14 +290,31 @@ static struct notify_task_data *alloc_notify_task_data(const char *exten,
 	return task_data;
 }
 
+/*!
+ * \internal
+ * \brief Send the state change waiting for the subscription, if any.
+ *
+ * Runs in the subscription's serializer.  State changes arriving before
+ * it runs replace the one waiting, so only the latest is sent.
+ */
 static int notify_task(void *obj)
 {
-	RAII_VAR(struct notify_task_data *, task_data, obj, ao2_cleanup);
+	struct exten_state_subscription *exten_state_sub = obj;
+	RAII_VAR(struct notify_task_data *, task_data, NULL, ao2_cleanup);
 	struct ast_sip_body_data data = {
 		.body_type = AST_SIP_EXTEN_STATE_DATA,
-		.body_data = &task_data->exten_state_data,
 	};
 
+	ao2_lock(exten_state_sub);
+	task_data = exten_state_sub->pending;
+	exten_state_sub->pending = NULL;
+	ao2_unlock(exten_state_sub);
+
+	if (!task_data) {
+		return 0;
+	}
+	data.body_data = &task_data->exten_state_data;
+
 	/* The subscription was terminated while notify_task was in queue.
 	   Terminated subscriptions are no longer associated with a valid tree, and sending
 	 * NOTIFY messages on a subscription which has already been terminated won't work.
@@ -328,6 +347,68 @@ static int notify_task(void *obj)
 	return 0;
 }
 
+/*! \brief notify_task, pushed with a reference to the subscription */
+static int notify_pushed_task(void *obj)
+{
+	int res = notify_task(obj);
+
+	ao2_ref(obj, -1);
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Have notify_task send the state change.
+ *
+ * If a state change is already waiting it is replaced, as its task has
+ * been queued.  Otherwise the task is queued, to run after the global
+ * exten_state_coalesce_interval.
+ *
+ * \note Steals the reference to task_data
+ */
+static int queue_notify(struct exten_state_subscription *exten_state_sub,
+	struct notify_task_data *task_data)
+{
+	struct notify_task_data *replaced;
+	struct ast_sip_sched_task *sched_task;
+	unsigned int interval;
+
+	ao2_lock(exten_state_sub);
+	replaced = exten_state_sub->pending;
+	exten_state_sub->pending = task_data;
+	if (replaced) {
+		/* A state change ending the subscription must not be lost */
+		task_data->terminate |= replaced->terminate;
+		ao2_unlock(exten_state_sub);
+		ao2_ref(replaced, -1);
+		return 0;
+	}
+	ao2_unlock(exten_state_sub);
+
+	interval = ast_sip_get_exten_state_coalesce_interval();
+	ao2_ref(exten_state_sub, +1);
+	if (interval) {
+		sched_task = ast_sip_schedule_task(exten_state_sub->serializer, interval,
+			notify_task, NULL, exten_state_sub, AST_SIP_SCHED_TASK_ONESHOT
+			| AST_SIP_SCHED_TASK_DATA_AO2 | AST_SIP_SCHED_TASK_DATA_FREE);
+		if (sched_task) {
+			ao2_ref(sched_task, -1);
+			return 0;
+		}
+	} else if (!ast_sip_push_task(exten_state_sub->serializer, notify_pushed_task,
+		exten_state_sub)) {
+		return 0;
+	}
+	ao2_ref(exten_state_sub, -1);
+
+	ao2_lock(exten_state_sub);
+	task_data = exten_state_sub->pending;
+	exten_state_sub->pending = NULL;
+	ao2_unlock(exten_state_sub);
+	ao2_cleanup(task_data);
+	return -1;
+}
+
 /*!
  * \internal
  * \brief Callback for exten/device state changes.
@@ -351,14 +432,9 @@ static int state_changed(const char *context, const char *exten,
 		return -1;
 	}
 
-	/* safe to push this async since we copy the data from info and
+	/* safe to send this async since we copy the data from info and
 	   add a ref for the device state info */
-	if (ast_sip_push_task(task_data->exten_state_sub->serializer, notify_task,
-		task_data)) {
-		ao2_cleanup(task_data);
-		return -1;
-	}
-	return 0;
+	return queue_notify(exten_state_sub, task_data);
 }
 
 static void state_changed_destroy(int id, void *data)
@@ -416,6 +492,11 @@ static void subscription_shutdown(struct ast_sip_subscription *sub)
 
 	ast_extension_state_del(exten_state_sub->id, state_changed);
 	ast_sip_subscription_remove_datastore(exten_state_sub->sip_sub, ds_name);
+	/* The waiting state change refers back to the subscription */
+	ao2_lock(exten_state_sub);
+	ao2_cleanup(exten_state_sub->pending);
+	exten_state_sub->pending = NULL;
+	ao2_unlock(exten_state_sub);
 	/* remove data store reference */
 	ao2_cleanup(exten_state_sub);
 }
@@ -307,6 +307,27 @@ struct hdr_list_entry {
 };
 AST_LIST_HEAD_NOLOCK(hdr_list, hdr_list_entry);
 
+/*! \brief A copy of a received message whose headers have not been parsed yet */
+struct hdr_raw_msg {
+	char *buf;
+	pj_size_t len;
+	AST_LIST_ENTRY(hdr_raw_msg) nextptr;
+};
+
+/*!
+ * \brief The headers saved on a session
+ *
+ * Most calls never read the headers they receive, so the messages are only
+ * copied when received and their headers parsed into the list the first
+ * time anything needs it.
+ */
+struct hdr_view {
+	/*! Messages received, oldest first, whose headers are not in the list yet */
+	AST_LIST_HEAD_NOLOCK(, hdr_raw_msg) unparsed;
+	/*! The headers */
+	struct hdr_list list;
+};
+
 /*! \brief Datastore for saving headers */
 static const struct ast_datastore_info header_datastore = {
 	.type = "header_datastore",
@@ -349,32 +370,111 @@ static int insert_headers(pj_pool_t * pool, struct hdr_list *list, pjsip_msg * m
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Get the headers of a session, parsing the messages received since last time
+ *
+ * The messages are parsed in the dialog pool, so their headers are put in
+ * the list as they are without being cloned.
+ */
+static struct hdr_list *header_view_list(pj_pool_t *pool, struct hdr_view *view)
+{
+	struct hdr_raw_msg *raw;
+
+	while ((raw = AST_LIST_REMOVE_HEAD(&view->unparsed, nextptr))) {
+		pjsip_msg *msg = pjsip_parse_msg(pool, raw->buf, raw->len, NULL);
+		pjsip_hdr *hdr;
+
+		if (!msg) {
+			ast_log(AST_LOG_WARNING, "Unable to parse the headers of a received message.\n");
+			continue;
+		}
+
+		for (hdr = msg->hdr.next; hdr != &msg->hdr; hdr = hdr->next) {
+			struct hdr_list_entry *le = pj_pool_zalloc(pool, sizeof(struct hdr_list_entry));
+
+			le->hdr = hdr;
+			AST_LIST_INSERT_TAIL(&view->list, le, nextptr);
+		}
+	}
+
+	return &view->list;
+}
+
+/*!
+ * \internal
+ * \brief Get the header view of a session, creating it if asked
+ */
+static struct hdr_view *header_view_get(struct ast_sip_session *session,
+	const struct ast_datastore_info *info, int create)
+{
+	pj_pool_t *pool = session->inv_session->dlg->pool;
+	RAII_VAR(struct ast_datastore *, datastore,
+			 ast_sip_session_get_datastore(session, info->type), ao2_cleanup);
+	struct hdr_view *view;
+
+	if (datastore) {
+		return datastore->data;
+	}
+	if (!create) {
+		return NULL;
+	}
+
+	if (!(datastore = ast_sip_session_alloc_datastore(info, info->type))
+		|| !(view = pj_pool_zalloc(pool, sizeof(*view)))) {
+		ast_log(AST_LOG_ERROR, "Unable to create datastore for header functions.\n");
+		return NULL;
+	}
+	AST_LIST_HEAD_INIT_NOLOCK(&view->unparsed);
+	AST_LIST_HEAD_INIT_NOLOCK(&view->list);
+	datastore->data = view;
+	if (ast_sip_session_add_datastore(session, datastore)) {
+		ast_log(AST_LOG_ERROR, "Unable to create datastore for header functions.\n");
+		return NULL;
+	}
+
+	return view;
+}
+
+/*!
+ * \internal
+ * \brief Save the headers of a received message in the view
+ *
+ * The message is copied to be parsed when the headers are first needed.
+ * A message without its text at hand has its headers cloned now.
+ */
+static void header_view_add(pj_pool_t *pool, struct hdr_view *view, pjsip_rx_data *rdata)
+{
+	struct hdr_raw_msg *raw;
+
+	if (!rdata->msg_info.msg_buf || rdata->msg_info.len <= 0) {
+		insert_headers(pool, header_view_list(pool, view), rdata->msg_info.msg);
+		return;
+	}
+
+	raw = pj_pool_alloc(pool, sizeof(*raw));
+	raw->len = rdata->msg_info.len;
+	/* The parser needs the message NUL terminated */
+	raw->buf = pj_pool_alloc(pool, raw->len + 1);
+	memcpy(raw->buf, rdata->msg_info.msg_buf, raw->len);
+	raw->buf[raw->len] = '\0';
+	AST_LIST_INSERT_TAIL(&view->unparsed, raw, nextptr);
+}
+
 /*!
  * \internal
  * \brief Session supplement callback on an incoming INVITE request
  *
  * Retrieve the header_datastore from the session or create one if it doesn't exist.
- * Create and initialize the list if needed.
- * Insert the headers.
+ * Save the message to have its headers read later.
  */
 static int incoming_request(struct ast_sip_session *session, pjsip_rx_data * rdata)
 {
-	pj_pool_t *pool = session->inv_session->dlg->pool;
-	RAII_VAR(struct ast_datastore *, datastore,
-			 ast_sip_session_get_datastore(session, header_datastore.type), ao2_cleanup);
+	struct hdr_view *view = header_view_get(session, &header_datastore, 1);
 
-	if (!datastore) {
-		if (!(datastore =
-			  ast_sip_session_alloc_datastore(&header_datastore, header_datastore.type))
-			||
-			!(datastore->data = pj_pool_alloc(pool, sizeof(struct hdr_list))) ||
-			ast_sip_session_add_datastore(session, datastore)) {
-			ast_log(AST_LOG_ERROR, "Unable to create datastore for header functions.\n");
-			return 0;
-		}
-		AST_LIST_HEAD_INIT_NOLOCK((struct hdr_list *) datastore->data);
+	if (view) {
+		header_view_add(session->inv_session->dlg->pool, view, rdata);
 	}
-	insert_headers(pool, (struct hdr_list *) datastore->data, rdata->msg_info.msg);
 
 	return 0;
 }
@@ -384,35 +484,22 @@ static int incoming_request(struct ast_sip_session *session, pjsip_rx_data * rda
  * \brief Session supplement callback on an incoming INVITE response
  *
  * Retrieve the response_header_datastore from the session or create one if it doesn't exist.
- * Create and initialize the list if needed.
- * Insert the headers.
+ * Save the message to have its headers read later.
  */
 static void incoming_response(struct ast_sip_session *session, pjsip_rx_data * rdata)
 {
-	pj_pool_t *pool = session->inv_session->dlg->pool;
-	RAII_VAR(struct ast_datastore *, datastore,
-			 ast_sip_session_get_datastore(session, response_header_datastore.type), ao2_cleanup);
 	pjsip_status_line status = rdata->msg_info.msg->line.status;
+	struct hdr_view *view;
 
 	/* Skip responses different of 200 OK, when 2xx is received. */
 	if (session->inv_session->state != PJSIP_INV_STATE_CONNECTING || status.code!=200) {
 		return;
 	}
 
-	if (!datastore) {
-		if (!(datastore =
-			  ast_sip_session_alloc_datastore(&response_header_datastore, response_header_datastore.type))
-			||
-			!(datastore->data = pj_pool_alloc(pool, sizeof(struct hdr_list))) ||
-			ast_sip_session_add_datastore(session, datastore)) {
-			ast_log(AST_LOG_ERROR, "Unable to create datastore for header functions.\n");
-			return;
-		}
-		AST_LIST_HEAD_INIT_NOLOCK((struct hdr_list *) datastore->data);
+	view = header_view_get(session, &response_header_datastore, 1);
+	if (view) {
+		header_view_add(session->inv_session->dlg->pool, view, rdata);
 	}
-	insert_headers(pool, (struct hdr_list *) datastore->data, rdata->msg_info.msg);
-
-	return;
 }
 
 /*!
@@ -462,17 +549,14 @@ static int read_headers(void *obj)
 	size_t plen, wlen = 0;
 	struct hdr_list_entry *le;
 	struct hdr_list *list;
+	struct hdr_view *view = header_view_get(data->channel->session, data->header_datastore, 0);
 
-	RAII_VAR(struct ast_datastore *, datastore,
-			 ast_sip_session_get_datastore(data->channel->session, data->header_datastore->type),
-			 ao2_cleanup);
-
-	if (!datastore || !datastore->data) {
+	if (!view) {
 		ast_debug(1, "There was no datastore from which to read headers.\n");
 		return -1;
 	}
 
-	list = datastore->data;
+	list = header_view_list(data->channel->session->inv_session->dlg->pool, view);
 	pj_hdr_string = ast_alloca(data->len);
 	AST_LIST_TRAVERSE(list, le, nextptr) {
 		if (!len || pj_strnicmp2(&le->hdr->name, data->header_name, len) == 0) {
@@ -553,16 +637,14 @@ static int read_header(void *obj)
 	struct hdr_list_entry *le;
 	struct hdr_list *list;
 	int i = 1;
-	RAII_VAR(struct ast_datastore *, datastore,
-			 ast_sip_session_get_datastore(data->channel->session, data->header_datastore->type),
-			 ao2_cleanup);
+	struct hdr_view *view = header_view_get(data->channel->session, data->header_datastore, 0);
 
-	if (!datastore || !datastore->data) {
+	if (!view) {
 		ast_debug(1, "There was no datastore from which to read headers.\n");
 		return -1;
 	}
 
-	list = datastore->data;
+	list = header_view_list(data->channel->session->inv_session->dlg->pool, view);
 	AST_LIST_TRAVERSE(list, le, nextptr) {
 		if (data->header_name[len - 1] == '*') {
 			if (pj_strnicmp2(&le->hdr->name, data->header_name, len - 1) == 0 && i++ == data->header_number) {
@@ -633,19 +715,10 @@ static int add_header(void *obj)
 	pj_str_t pj_header_value;
 	struct hdr_list_entry *le;
 	struct hdr_list *list;
+	struct hdr_view *view = header_view_get(session, data->header_datastore, 1);
 
-	RAII_VAR(struct ast_datastore *, datastore,
-			 ast_sip_session_get_datastore(session, data->header_datastore->type), ao2_cleanup);
-
-	if (!datastore) {
-		if (!(datastore = ast_sip_session_alloc_datastore(data->header_datastore,
-														data->header_datastore->type))
-			|| !(datastore->data = pj_pool_alloc(pool, sizeof(struct hdr_list)))
-			|| ast_sip_session_add_datastore(session, datastore)) {
-			ast_log(AST_LOG_ERROR, "Unable to create datastore for header functions.\n");
-			return -1;
-		}
-		AST_LIST_HEAD_INIT_NOLOCK((struct hdr_list *) datastore->data);
+	if (!view) {
+		return -1;
 	}
 
 	ast_debug(1, "Adding header %s with value %s\n", data->header_name,
@@ -656,7 +729,7 @@ static int add_header(void *obj)
 	le = pj_pool_zalloc(pool, sizeof(struct hdr_list_entry));
 	le->hdr = (pjsip_hdr *) pjsip_generic_string_hdr_create(pool, &pj_header_name,
 															&pj_header_value);
-	list = datastore->data;
+	list = header_view_list(pool, view);
 
 	AST_LIST_INSERT_TAIL(list, le, nextptr);
 
@@ -678,16 +751,14 @@ static int update_header(void *obj)
 	struct header_data *data = obj;
 	pj_pool_t *pool = data->channel->session->inv_session->dlg->pool;
 	pjsip_hdr *hdr = NULL;
-	RAII_VAR(struct ast_datastore *, datastore,
-			 ast_sip_session_get_datastore(data->channel->session, data->header_datastore->type),
-			 ao2_cleanup);
+	struct hdr_view *view = header_view_get(data->channel->session, data->header_datastore, 0);
 
-	if (!datastore || !datastore->data) {
+	if (!view) {
 		ast_log(AST_LOG_ERROR, "No headers had been previously added to this session.\n");
 		return -1;
 	}
 
-	hdr = find_header((struct hdr_list *) datastore->data, data->header_name,
+	hdr = find_header(header_view_list(pool, view), data->header_name,
 					  data->header_number);
 
 	if (!hdr) {
@@ -715,16 +786,14 @@ static int remove_header(void *obj)
 	struct hdr_list *list;
 	struct hdr_list_entry *le;
 	int removed_count = 0;
-	RAII_VAR(struct ast_datastore *, datastore,
-			 ast_sip_session_get_datastore(data->channel->session, data->header_datastore->type),
-			 ao2_cleanup);
+	struct hdr_view *view = header_view_get(data->channel->session, data->header_datastore, 0);
 
-	if (!datastore || !datastore->data) {
+	if (!view) {
 		ast_log(AST_LOG_ERROR, "No headers had been previously added to this session.\n");
 		return -1;
 	}
 
-	list = datastore->data;
+	list = header_view_list(data->channel->session->inv_session->dlg->pool, view);
 	AST_LIST_TRAVERSE_SAFE_BEGIN(list, le, nextptr) {
 		if (data->header_name[len - 1] == '*') {
 			if (pj_strnicmp2(&le->hdr->name, data->header_name, len - 1) == 0) {
@@ -1029,7 +1098,7 @@ static void outgoing_request(struct ast_sip_session *session, pjsip_tx_data * td
 		return;
 	}
 
-	list = datastore->data;
+	list = header_view_list(session->inv_session->dlg->pool, datastore->data);
 	AST_LIST_TRAVERSE(list, le, nextptr) {
 		pjsip_msg_add_hdr(tdata->msg, (pjsip_hdr *) pjsip_hdr_clone(tdata->pool, le->hdr));
 	}
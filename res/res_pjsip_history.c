@@ -32,6 +32,8 @@
 
 #include "asterisk.h"
 
+#include <netinet/in.h>	/* For IPPROTO_UDP and in6_addr */
+
 #include <pjsip.h>
 #include <regex.h>
 
@@ -46,6 +48,72 @@
 
 #define HISTORY_INITIAL_SIZE 256
 
+/*! \brief How many packets are kept, older ones are overwritten */
+#define HISTORY_RING_SIZE 8192
+
+/*! \brief PCAP Header */
+struct pcap_header {
+	uint32_t magic_number; 	/*! \brief PCAP file format magic number */
+	uint16_t version_major;	/*! \brief Major version number of the file format */
+	uint16_t version_minor;	/*! \brief Minor version number of the file format */
+	int32_t thiszone;	/*! \brief GMT to local correction */
+	uint32_t sigfigs;	/*! \brief Accuracy of timestamps */
+	uint32_t snaplen;	/*! \brief The maximum size that can be recorded in the file */
+	uint32_t network;	/*! \brief Type of packets held within the file */
+};
+
+/*! \brief PCAP Packet Record Header */
+struct pcap_record_header {
+	uint32_t ts_sec;	/*! \brief When the record was created */
+	uint32_t ts_usec;	/*! \brief When the record was created */
+	uint32_t incl_len;	/*! \brief Length of packet as saved in the file */
+	uint32_t orig_len;	/*! \brief Length of packet as sent over network */
+};
+
+/*! \brief PCAP Ethernet Header */
+struct pcap_ethernet_header {
+	uint8_t dst[6];	/*! \brief Destination MAC address */
+	uint8_t src[6];	/*! \brief Source MAD address */
+	uint16_t type;	/*! \brief The type of packet contained within */
+} __attribute__((__packed__));
+
+/*! \brief PCAP IPv4 Header */
+struct pcap_ipv4_header {
+	uint8_t ver_ihl;	/*! \brief IP header version and other bits */
+	uint8_t ip_tos;		/*! \brief Type of service details */
+	uint16_t ip_len;	/*! \brief Total length of the packet (including IPv4 header) */
+	uint16_t ip_id;		/*! \brief Identification value */
+	uint16_t ip_off;	/*! \brief Fragment offset */
+	uint8_t ip_ttl;		/*! \brief Time to live for the packet */
+	uint8_t ip_protocol;	/*! \brief Protocol of the data held within the packet (always UDP) */
+	uint16_t ip_sum;	/*! \brief Checksum (not calculated for our purposes */
+	uint32_t ip_src;	/*! \brief Source IP address */
+	uint32_t ip_dst;	/*! \brief Destination IP address */
+};
+
+/*! \brief PCAP IPv6 Header */
+struct pcap_ipv6_header {
+   union {
+      struct ip6_hdrctl {
+         uint32_t ip6_un1_flow; /*! \brief Version, traffic class, flow label */
+         uint16_t ip6_un1_plen; /*! \brief Length of the packet (not including IPv6 header) */
+         uint8_t ip6_un1_nxt; 	/*! \brief Next header field */
+         uint8_t ip6_un1_hlim;	/*! \brief Hop Limit */
+      } ip6_un1;
+      uint8_t ip6_un2_vfc;	/*! \brief Version, traffic class */
+   } ip6_ctlun;
+   struct in6_addr ip6_src; /*! \brief Source IP address */
+   struct in6_addr ip6_dst; /*! \brief Destination IP address */
+};
+
+/*! \brief PCAP UDP Header */
+struct pcap_udp_header {
+	uint16_t src;		/*! \brief Source IP port */
+	uint16_t dst;		/*! \brief Destination IP port */
+	uint16_t length;	/*! \brief Length of the UDP header plus UDP packet */
+	uint16_t checksum;	/*! \brief Packet checksum, left uncalculated for our purposes */
+};
+
 /*! \brief Pool factory used by pjlib to allocate memory. */
 static pj_caching_pool cachingpool;
 
@@ -55,7 +123,39 @@ static int enabled;
 /*! \brief Packet count */
 static int packet_number;
 
-/*! \brief An item in the history */
+/*!
+ * \brief A packet as it was captured
+ *
+ * Packets are kept as they were sent or received and only parsed when the
+ * history is looked at, so capturing them is cheap.
+ */
+struct pjsip_history_packet {
+	/*! \brief Packet number */
+	int number;
+	/*! \brief Whether or not we transmitted the packet */
+	int transmitted;
+	/*! \brief Time the packet was transmitted/received */
+	struct timeval timestamp;
+	/*! \brief Source address */
+	pj_sockaddr src;
+	/*! \brief Destination address */
+	pj_sockaddr dst;
+	/*! \brief Length of the packet */
+	size_t len;
+	/*! \brief The packet itself */
+	char data[];
+};
+
+/*!
+ * \brief The captured packets
+ *
+ * Packet number \c n is kept in slot \c n % \c HISTORY_RING_SIZE until a
+ * newer packet overwrites it.  Slots are only ever swapped atomically, so
+ * capturing a packet never waits on a lock.
+ */
+static struct pjsip_history_packet *history_ring[HISTORY_RING_SIZE];
+
+/*! \brief A parsed packet of the history */
 struct pjsip_history_entry {
 	/*! \brief Packet number */
 	int number;
@@ -73,9 +173,6 @@ struct pjsip_history_entry {
 	pjsip_msg *msg;
 };
 
-/*! \brief Mutex that protects \c vector_history */
-AST_MUTEX_DEFINE_STATIC(history_lock);
-
 struct expression_token;
 
 /*! \brief An operator that we understand in an expression */
@@ -158,8 +255,11 @@ struct expression_token {
 /*! \brief Log level for history output */
 static int log_level = -1;
 
-/*! \brief The one and only history that we've captured */
-static AST_VECTOR(vector_history_t, struct pjsip_history_entry *) vector_history;
+/*! \brief A history, parsed */
+AST_VECTOR(vector_history_t, struct pjsip_history_entry *);
+
+/*! \brief Captured packets */
+AST_VECTOR(vector_packets_t, struct pjsip_history_packet *);
 
 /*!
  * \brief Operator callback for determining equality
@@ -618,24 +718,30 @@ static void pjsip_history_entry_dtor(void *obj)
 }
 
 /*!
- * \brief Create a \c pjsip_history_entry AO2 object
+ * \brief Create a \c pjsip_history_entry AO2 object by parsing a captured packet
+ *
+ * This must be called from a registered PJSIP thread
  *
- * \param msg The PJSIP message that this history entry wraps
+ * \param packet The captured packet
  *
  * \retval An AO2 \c pjsip_history_entry object on success
  * \retval NULL on failure
  */
-static struct pjsip_history_entry *pjsip_history_entry_alloc(pjsip_msg *msg)
+static struct pjsip_history_entry *pjsip_history_entry_alloc(struct pjsip_history_packet *packet)
 {
 	struct pjsip_history_entry *entry;
+	char *buf;
 
 	entry = ao2_alloc_options(sizeof(*entry), pjsip_history_entry_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!entry) {
 		return NULL;
 	}
-	entry->number = ast_atomic_fetchadd_int(&packet_number, 1);
-	entry->timestamp = ast_tvnow();
+	entry->number = packet->number;
+	entry->transmitted = packet->transmitted;
+	entry->timestamp = packet->timestamp;
 	entry->timestamp.tv_usec = 0;
+	pj_sockaddr_cp(&entry->src, &packet->src);
+	pj_sockaddr_cp(&entry->dst, &packet->dst);
 
 	entry->pool = pj_pool_create(&cachingpool.factory, NULL, PJSIP_POOL_RDATA_LEN,
 	                             PJSIP_POOL_RDATA_INC, NULL);
@@ -644,8 +750,14 @@ static struct pjsip_history_entry *pjsip_history_entry_alloc(pjsip_msg *msg)
 		return NULL;
 	}
 
-	entry->msg = pjsip_msg_clone(entry->pool, msg);
+	/* The parsed message points into what it was parsed from */
+	buf = pj_pool_alloc(entry->pool, packet->len + 1);
+	memcpy(buf, packet->data, packet->len);
+	buf[packet->len] = '\0';
+
+	entry->msg = pjsip_parse_msg(entry->pool, buf, packet->len, NULL);
 	if (!entry->msg) {
+		ast_log(LOG_WARNING, "Unable to parse SIP message %d\n", packet->number);
 		ao2_ref(entry, -1);
 		return NULL;
 	}
@@ -690,44 +802,136 @@ static void sprint_list_entry(struct pjsip_history_entry *entry, char *line, int
 	}
 }
 
-/*! \brief PJSIP callback when a SIP message is transmitted */
-static pj_status_t history_on_tx_msg(pjsip_tx_data *tdata)
+/*!
+ * \brief Capture a packet
+ *
+ * \param transmitted Whether or not we transmitted the packet
+ * \param data The packet
+ * \param len Length of the packet
+ *
+ * \retval An AO2 \c pjsip_history_packet object, to fill in the addresses of
+ * \retval NULL on failure
+ */
+static struct pjsip_history_packet *pjsip_history_packet_alloc(int transmitted, const char *data, size_t len)
 {
-	struct pjsip_history_entry *entry;
+	struct pjsip_history_packet *packet;
 
-	if (!enabled) {
-		return PJ_SUCCESS;
+	packet = ao2_alloc_options(sizeof(*packet) + len, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!packet) {
+		return NULL;
 	}
+	packet->transmitted = transmitted;
+	packet->timestamp = ast_tvnow();
+	packet->len = len;
+	memcpy(packet->data, data, len);
 
-	entry = pjsip_history_entry_alloc(tdata->msg);
-	if (!entry) {
-		return PJ_SUCCESS;
+	return packet;
+}
+
+/*!
+ * \brief Put a packet in a slot of \c history_ring
+ *
+ * If another packet is swapped into the slot meanwhile, the newer of the
+ * two stays in it.
+ *
+ * \param slot The slot
+ * \param packet The packet, whose reference is given to the slot
+ */
+static void history_ring_put(struct pjsip_history_packet **slot, struct pjsip_history_packet *packet)
+{
+	struct pjsip_history_packet *displaced;
+
+	while ((displaced = ast_atomic_exchange_n(slot, packet, __ATOMIC_ACQ_REL))) {
+		if (displaced->number < packet->number) {
+			ao2_ref(displaced, -1);
+			return;
+		}
+		/* We displaced a newer packet, put it back */
+		packet = displaced;
 	}
-	entry->transmitted = 1;
-	pj_sockaddr_cp(&entry->src, &tdata->tp_info.transport->local_addr);
-	pj_sockaddr_cp(&entry->dst, &tdata->tp_info.dst_addr);
+}
 
-	ast_mutex_lock(&history_lock);
-	if (AST_VECTOR_APPEND(&vector_history, entry)) {
-		ao2_ref(entry, -1);
-		entry = NULL;
+/*!
+ * \brief Get a packet from \c history_ring
+ *
+ * The slot is briefly emptied while the packet is referenced, so that a
+ * packet capture overwriting it cannot release it meanwhile.
+ *
+ * \param number The packet number
+ *
+ * \retval The packet, with a reference for the caller
+ * \retval NULL if it is no longer in the history
+ */
+static struct pjsip_history_packet *history_ring_get(int number)
+{
+	struct pjsip_history_packet **slot = &history_ring[number % HISTORY_RING_SIZE];
+	struct pjsip_history_packet *packet;
+
+	packet = ast_atomic_exchange_n(slot, NULL, __ATOMIC_ACQ_REL);
+	if (!packet) {
+		return NULL;
 	}
-	ast_mutex_unlock(&history_lock);
+	ao2_ref(packet, +1);
+	history_ring_put(slot, packet);
+
+	if (packet->number != number) {
+		ao2_ref(packet, -1);
+		return NULL;
+	}
+
+	return packet;
+}
 
-	if (log_level != -1 && entry) {
+/*! \brief Capture a packet into the history, and log it if history logging is on */
+static void history_capture(struct pjsip_history_packet *packet, pjsip_msg *msg)
+{
+	packet->number = ast_atomic_fetchadd_int(&packet_number, 1);
+	ao2_ref(packet, +1);
+	history_ring_put(&history_ring[packet->number % HISTORY_RING_SIZE], packet);
+
+	if (log_level != -1) {
+		struct pjsip_history_entry entry = {
+			.number = packet->number,
+			.transmitted = packet->transmitted,
+			.timestamp = packet->timestamp,
+			.src = packet->src,
+			.dst = packet->dst,
+			.msg = msg,
+		};
 		char line[256];
 
-		sprint_list_entry(entry, line, sizeof(line));
+		sprint_list_entry(&entry, line, sizeof(line));
 		ast_log_dynamic_level(log_level, "%s\n", line);
 	}
 
+	ao2_ref(packet, -1);
+}
+
+/*! \brief PJSIP callback when a SIP message is transmitted */
+static pj_status_t history_on_tx_msg(pjsip_tx_data *tdata)
+{
+	struct pjsip_history_packet *packet;
+
+	if (!enabled) {
+		return PJ_SUCCESS;
+	}
+
+	packet = pjsip_history_packet_alloc(1, tdata->buf.start, tdata->buf.cur - tdata->buf.start);
+	if (!packet) {
+		return PJ_SUCCESS;
+	}
+	pj_sockaddr_cp(&packet->src, &tdata->tp_info.transport->local_addr);
+	pj_sockaddr_cp(&packet->dst, &tdata->tp_info.dst_addr);
+
+	history_capture(packet, tdata->msg);
+
 	return PJ_SUCCESS;
 }
 
 /*! \brief PJSIP callback when a SIP message is received */
 static pj_bool_t history_on_rx_msg(pjsip_rx_data *rdata)
 {
-	struct pjsip_history_entry *entry;
+	struct pjsip_history_packet *packet;
 
 	if (!enabled) {
 		return PJ_FALSE;
@@ -737,32 +941,20 @@ static pj_bool_t history_on_rx_msg(pjsip_rx_data *rdata)
 		return PJ_FALSE;
 	}
 
-	entry = pjsip_history_entry_alloc(rdata->msg_info.msg);
-	if (!entry) {
+	packet = pjsip_history_packet_alloc(0, rdata->msg_info.msg_buf, rdata->msg_info.len);
+	if (!packet) {
 		return PJ_FALSE;
 	}
 
 	if (rdata->tp_info.transport->addr_len) {
-		pj_sockaddr_cp(&entry->dst, &rdata->tp_info.transport->local_addr);
+		pj_sockaddr_cp(&packet->dst, &rdata->tp_info.transport->local_addr);
 	}
 
 	if (rdata->pkt_info.src_addr_len) {
-		pj_sockaddr_cp(&entry->src, &rdata->pkt_info.src_addr);
-	}
-
-	ast_mutex_lock(&history_lock);
-	if (AST_VECTOR_APPEND(&vector_history, entry)) {
-		ao2_ref(entry, -1);
-		entry = NULL;
+		pj_sockaddr_cp(&packet->src, &rdata->pkt_info.src_addr);
 	}
-	ast_mutex_unlock(&history_lock);
-
-	if (log_level != -1 && entry) {
-		char line[256];
 
-		sprint_list_entry(entry, line, sizeof(line));
-		ast_log_dynamic_level(log_level, "%s\n", line);
-	}
+	history_capture(packet, rdata->msg_info.msg);
 
 	return PJ_FALSE;
 }
@@ -773,21 +965,117 @@ static void clear_history_entry_cb(struct pjsip_history_entry *entry)
 	ao2_ref(entry, -1);
 }
 
+/*! \brief Remove all packets from \c history_ring */
+static void clear_history_entries(void)
+{
+	int i;
+
+	packet_number = 0;
+	for (i = 0; i < HISTORY_RING_SIZE; i++) {
+		ao2_cleanup(ast_atomic_exchange_n(&history_ring[i], NULL, __ATOMIC_ACQ_REL));
+	}
+}
+
 /*!
- * \brief Remove all entries from \c vector_history
+ * \brief Get the packets in \c history_ring, oldest first
+ *
+ * \param packets The vector to add them to
+ */
+static void history_packets(struct vector_packets_t *packets)
+{
+	int last = ast_atomic_fetchadd_int(&packet_number, 0);
+	int number;
+
+	for (number = MAX(last - HISTORY_RING_SIZE, 0); number < last; number++) {
+		struct pjsip_history_packet *packet = history_ring_get(number);
+
+		if (packet && AST_VECTOR_APPEND(packets, packet)) {
+			ao2_ref(packet, -1);
+		}
+	}
+}
+
+/*! \brief Packets to parse into a history */
+struct history_parse_data {
+	/*! \brief The packets */
+	struct vector_packets_t packets;
+	/*! \brief The history they are parsed into */
+	struct vector_history_t *history;
+};
+
+/*!
+ * \brief Parse captured packets into a history
  *
  * This must be called from a registered PJSIP thread
  */
-static int clear_history_entries(void *obj)
+static int parse_history_packets(void *obj)
 {
-	ast_mutex_lock(&history_lock);
-	AST_VECTOR_RESET(&vector_history, clear_history_entry_cb);
-	packet_number = 0;
-	ast_mutex_unlock(&history_lock);
+	struct history_parse_data *data = obj;
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&data->packets); i++) {
+		struct pjsip_history_entry *entry;
+
+		entry = pjsip_history_entry_alloc(AST_VECTOR_GET(&data->packets, i));
+		if (entry && AST_VECTOR_APPEND(data->history, entry)) {
+			ao2_ref(entry, -1);
+		}
+	}
+
+	return 0;
+}
+
+/*! \brief Cleanup routine for a history vector, serviced on a registered PJSIP thread */
+static int safe_vector_cleanup(void *obj)
+{
+	struct vector_history_t *vec = obj;
+
+	AST_VECTOR_RESET(vec, clear_history_entry_cb);
+	AST_VECTOR_FREE(vec);
+	ast_free(vec);
 
 	return 0;
 }
 
+/*!
+ * \brief Parse the captured packets into a history
+ *
+ * \param number The number of the one packet to parse, or -1 to parse them all
+ *
+ * \retval NULL on error
+ * \retval The history on success, to release with \c safe_vector_cleanup
+ */
+static struct vector_history_t *load_history(int number)
+{
+	struct history_parse_data data;
+	struct pjsip_history_packet *packet;
+
+	data.history = ast_malloc(sizeof(*data.history));
+	if (!data.history) {
+		return NULL;
+	}
+
+	if (AST_VECTOR_INIT(data.history, HISTORY_INITIAL_SIZE)
+		|| AST_VECTOR_INIT(&data.packets, HISTORY_INITIAL_SIZE)) {
+		AST_VECTOR_FREE(data.history);
+		ast_free(data.history);
+		return NULL;
+	}
+
+	if (number < 0) {
+		history_packets(&data.packets);
+	} else if ((packet = history_ring_get(number)) && AST_VECTOR_APPEND(&data.packets, packet)) {
+		ao2_ref(packet, -1);
+	}
+
+	ast_sip_push_task_wait_servant(NULL, parse_history_packets, &data);
+
+	AST_VECTOR_RESET(&data.packets, ao2_cleanup);
+	AST_VECTOR_FREE(&data.packets);
+
+	return data.history;
+}
+
 /*!
  * \brief Build a reverse polish notation expression queue
  *
@@ -1098,6 +1386,7 @@ error:
  */
 static struct vector_history_t *filter_history(struct ast_cli_args *a)
 {
+	struct vector_history_t *history;
 	struct vector_history_t *output;
 	struct expression_token *queue;
 	int i;
@@ -1118,20 +1407,25 @@ static struct vector_history_t *filter_history(struct ast_cli_args *a)
 		return NULL;
 	}
 
-	ast_mutex_lock(&history_lock);
-	for (i = 0; i < AST_VECTOR_SIZE(&vector_history); i++) {
-		struct pjsip_history_entry *entry = AST_VECTOR_GET(&vector_history, i);
+	history = load_history(-1);
+	if (!history) {
+		AST_VECTOR_PTR_FREE(output);
+		expression_token_free(queue);
+		return NULL;
+	}
+
+	for (i = 0; i < AST_VECTOR_SIZE(history); i++) {
+		struct pjsip_history_entry *entry = AST_VECTOR_GET(history, i);
 		int res;
 
 		res = evaluate_history_entry(entry, queue);
 		if (res == -1) {
 			/* Error in expression evaluation; bail */
-			ast_mutex_unlock(&history_lock);
 			AST_VECTOR_RESET(output, clear_history_entry_cb);
 			AST_VECTOR_FREE(output);
 			ast_free(output);
-			expression_token_free(queue);
-			return NULL;
+			output = NULL;
+			break;
 		} else if (!res) {
 			continue;
 		} else {
@@ -1141,8 +1435,8 @@ static struct vector_history_t *filter_history(struct ast_cli_args *a)
 			}
 		}
 	}
-	ast_mutex_unlock(&history_lock);
 
+	ast_sip_push_task(NULL, safe_vector_cleanup, history);
 	expression_token_free(queue);
 
 	return output;
@@ -1205,21 +1499,9 @@ static void display_entry_list(struct ast_cli_args *a, struct vector_history_t *
 	}
 }
 
-/*! \brief Cleanup routine for a history vector, serviced on a registered PJSIP thread */
-static int safe_vector_cleanup(void *obj)
-{
-	struct vector_history_t *vec = obj;
-
-	AST_VECTOR_RESET(vec, clear_history_entry_cb);
-	AST_VECTOR_FREE(vec);
-	ast_free(vec);
-
-	return 0;
-}
-
 static char *pjsip_show_history(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
-	struct vector_history_t *vec = &vector_history;
+	struct vector_history_t *vec;
 	struct pjsip_history_entry *entry = NULL;
 
 	if (cmd == CLI_INIT) {
@@ -1227,7 +1509,8 @@ static char *pjsip_show_history(struct ast_cli_entry *e, int cmd, struct ast_cli
 		e->usage =
 			"Usage: pjsip show history [entry <num>|where [...]]\n"
 			"       Displays the currently collected history or an\n"
-			"       entry within the history.\n\n"
+			"       entry within the history.  Only the last 8192\n"
+			"       packets are kept.\n\n"
 			"       * Running the command with no options will display\n"
 			"         the entire history.\n"
 			"       * Providing 'entry <num>' will display the full\n"
@@ -1260,55 +1543,177 @@ static char *pjsip_show_history(struct ast_cli_entry *e, int cmd, struct ast_cli
 				return CLI_FAILURE;
 			}
 
-			/* Get the entry at the provided position */
-			ast_mutex_lock(&history_lock);
-			if (num >= AST_VECTOR_SIZE(&vector_history) || num < 0) {
+			/* Get the entry with the provided number */
+			vec = num < 0 ? NULL : load_history(num);
+			if (vec && !AST_VECTOR_SIZE(vec)) {
 				ast_cli(a->fd, "Entry '%d' does not exist\n", num);
-				ast_mutex_unlock(&history_lock);
+				ast_sip_push_task(NULL, safe_vector_cleanup, vec);
 				return CLI_FAILURE;
 			}
-			entry = ao2_bump(AST_VECTOR_GET(&vector_history, num));
-			ast_mutex_unlock(&history_lock);
 		} else if (!strcasecmp(a->argv[3], "where")) {
 			vec = filter_history(a);
-			if (!vec) {
-				return CLI_FAILURE;
-			}
 		} else {
 			return CLI_SHOWUSAGE;
 		}
+	} else {
+		vec = load_history(-1);
+	}
+
+	if (!vec) {
+		return CLI_FAILURE;
 	}
 
 	if (AST_VECTOR_SIZE(vec) == 1) {
-		if (vec == &vector_history) {
-			ast_mutex_lock(&history_lock);
-		}
 		entry = ao2_bump(AST_VECTOR_GET(vec, 0));
-		if (vec == &vector_history) {
-			ast_mutex_unlock(&history_lock);
-		}
 	}
 
 	if (entry) {
 		display_single_entry(a, entry);
 	} else {
-		if (vec == &vector_history) {
-			ast_mutex_lock(&history_lock);
-		}
-
 		display_entry_list(a, vec);
+	}
 
-		if (vec == &vector_history) {
-			ast_mutex_unlock(&history_lock);
+	ast_sip_push_task(NULL, safe_vector_cleanup, vec);
+	ao2_cleanup(entry);
+
+	return CLI_SUCCESS;
+}
+
+/*! \brief Write a packet of the history to a pcap file */
+static int write_packet_to_pcap(FILE *pcap_file, struct pjsip_history_packet *packet)
+{
+	struct pcap_record_header pcap_record_header = {
+		.ts_sec = packet->timestamp.tv_sec,
+		.ts_usec = packet->timestamp.tv_usec,
+	};
+	struct pcap_ethernet_header pcap_ethernet_header = {
+		.type = 0,
+	};
+	struct pcap_ipv4_header pcap_ipv4_header = {
+		.ver_ihl = 0x45, /* IPv4 + 20 bytes of header */
+		.ip_ttl = 128, /* We always put a TTL of 128 to keep Wireshark less blue */
+	};
+	struct pcap_ipv6_header pcap_ipv6_header = {
+		.ip6_ctlun.ip6_un2_vfc = 0x60,
+	};
+	void *pcap_ip_header;
+	size_t pcap_ip_header_len;
+	struct pcap_udp_header pcap_udp_header = {
+		.length = htons(sizeof(struct pcap_udp_header) + packet->len),
+	};
+
+	/* An address that was not known is left zeroed */
+	if (packet->src.addr.sa_family == pj_AF_INET() || packet->src.addr.sa_family == pj_AF_INET6()) {
+		pcap_udp_header.src = htons(pj_sockaddr_get_port(&packet->src));
+	}
+	if (packet->dst.addr.sa_family == pj_AF_INET() || packet->dst.addr.sa_family == pj_AF_INET6()) {
+		pcap_udp_header.dst = htons(pj_sockaddr_get_port(&packet->dst));
+	}
+
+	/* Packets are always stored as UDP, whatever transport they were sent over */
+	if (packet->src.addr.sa_family == pj_AF_INET() || packet->dst.addr.sa_family == pj_AF_INET()) {
+		pcap_ethernet_header.type = htons(0x0800); /* We are providing an IPv4 packet */
+		pcap_ip_header = &pcap_ipv4_header;
+		pcap_ip_header_len = sizeof(struct pcap_ipv4_header);
+		if (packet->src.addr.sa_family == pj_AF_INET()) {
+			memcpy(&pcap_ipv4_header.ip_src, pj_sockaddr_get_addr(&packet->src), pj_sockaddr_get_addr_len(&packet->src));
+		}
+		if (packet->dst.addr.sa_family == pj_AF_INET()) {
+			memcpy(&pcap_ipv4_header.ip_dst, pj_sockaddr_get_addr(&packet->dst), pj_sockaddr_get_addr_len(&packet->dst));
+		}
+		pcap_ipv4_header.ip_len = htons(sizeof(struct pcap_udp_header) + sizeof(struct pcap_ipv4_header) + packet->len);
+		pcap_ipv4_header.ip_protocol = IPPROTO_UDP;
+	} else {
+		pcap_ethernet_header.type = htons(0x86DD); /* We are providing an IPv6 packet */
+		pcap_ip_header = &pcap_ipv6_header;
+		pcap_ip_header_len = sizeof(struct pcap_ipv6_header);
+		if (packet->src.addr.sa_family == pj_AF_INET6()) {
+			memcpy(&pcap_ipv6_header.ip6_src, pj_sockaddr_get_addr(&packet->src), pj_sockaddr_get_addr_len(&packet->src));
+		}
+		if (packet->dst.addr.sa_family == pj_AF_INET6()) {
+			memcpy(&pcap_ipv6_header.ip6_dst, pj_sockaddr_get_addr(&packet->dst), pj_sockaddr_get_addr_len(&packet->dst));
 		}
+		pcap_ipv6_header.ip6_ctlun.ip6_un1.ip6_un1_plen = htons(sizeof(struct pcap_udp_header) + packet->len);
+		pcap_ipv6_header.ip6_ctlun.ip6_un1.ip6_un1_nxt = IPPROTO_UDP;
 	}
 
-	if (vec != &vector_history) {
-		ast_sip_push_task(NULL, safe_vector_cleanup, vec);
+	/* Add up all the sizes for this record */
+	pcap_record_header.incl_len = pcap_record_header.orig_len = sizeof(pcap_ethernet_header) + pcap_ip_header_len + sizeof(pcap_udp_header) + packet->len;
+
+	if (fwrite(&pcap_record_header, sizeof(struct pcap_record_header), 1, pcap_file) != 1
+		|| fwrite(&pcap_ethernet_header, sizeof(struct pcap_ethernet_header), 1, pcap_file) != 1
+		|| fwrite(pcap_ip_header, pcap_ip_header_len, 1, pcap_file) != 1
+		|| fwrite(&pcap_udp_header, sizeof(struct pcap_udp_header), 1, pcap_file) != 1
+		|| fwrite(packet->data, packet->len, 1, pcap_file) != 1) {
+		return -1;
 	}
-	ao2_cleanup(entry);
 
-	return CLI_SUCCESS;
+	return 0;
+}
+
+static char *pjsip_export_history(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct pcap_header pcap_header = {
+		.magic_number = 0xa1b2c3d4,
+		.version_major = 2,
+		.version_minor = 4,
+		.snaplen = 65535,
+		.network = 1, /* We always use ethernet so we can combine IPv4 and IPv6 in same pcap */
+	};
+	struct vector_packets_t packets;
+	FILE *pcap_file;
+	int res = 0;
+	int i;
+
+	if (cmd == CLI_INIT) {
+		e->command = "pjsip export history";
+		e->usage =
+			"Usage: pjsip export history <filename>\n"
+			"       Writes the currently collected history to a pcap file.\n"
+			"       Packets are written as UDP, whatever transport they\n"
+			"       were sent or received over.\n";
+		return NULL;
+	} else if (cmd == CLI_GENERATE) {
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (AST_VECTOR_INIT(&packets, HISTORY_INITIAL_SIZE)) {
+		return CLI_FAILURE;
+	}
+
+	pcap_file = fopen(a->argv[3], "wb");
+	if (!pcap_file) {
+		ast_cli(a->fd, "Failed to open file '%s' for pcap writing: %s\n", a->argv[3], strerror(errno));
+		AST_VECTOR_FREE(&packets);
+		return CLI_FAILURE;
+	}
+
+	history_packets(&packets);
+
+	if (fwrite(&pcap_header, sizeof(struct pcap_header), 1, pcap_file) != 1) {
+		res = -1;
+	}
+	for (i = 0; !res && i < AST_VECTOR_SIZE(&packets); i++) {
+		res = write_packet_to_pcap(pcap_file, AST_VECTOR_GET(&packets, i));
+	}
+	if (fclose(pcap_file)) {
+		res = -1;
+	}
+
+	if (res) {
+		ast_cli(a->fd, "Failed writing pcap file '%s': %s\n", a->argv[3], strerror(errno));
+	} else {
+		ast_cli(a->fd, "Exported %d packets to '%s'\n", (int) AST_VECTOR_SIZE(&packets), a->argv[3]);
+	}
+
+	AST_VECTOR_RESET(&packets, ao2_cleanup);
+	AST_VECTOR_FREE(&packets);
+
+	return res ? CLI_FAILURE : CLI_SUCCESS;
 }
 
 static char *pjsip_set_history(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
@@ -1324,9 +1729,9 @@ static char *pjsip_set_history(struct ast_cli_entry *e, int cmd, struct ast_cli_
 			"       packets. Disabling the history will stop recording, but keep\n"
 			"       the already received packets. Clearing the history will wipe\n"
 			"       the received packets from memory.\n\n"
-			"       As the PJSIP history is maintained in memory, and includes\n"
-			"       all received/transmitted requests and responses, it should\n"
-			"       only be enabled for debugging purposes, and cleared when done.\n";
+			"       The PJSIP history is kept in memory as the packets were\n"
+			"       received/transmitted, and only the last 8192 packets are\n"
+			"       kept, so it can be left enabled.\n";
 		return NULL;
 	} else if (cmd == CLI_GENERATE) {
 		return NULL;
@@ -1344,7 +1749,7 @@ static char *pjsip_set_history(struct ast_cli_entry *e, int cmd, struct ast_cli_
 			ast_cli(a->fd, "PJSIP History disabled\n");
 			return CLI_SUCCESS;
 		} else if (!strcasecmp(what, "clear")) {
-			ast_sip_push_task(NULL, clear_history_entries, NULL);
+			clear_history_entries();
 			ast_cli(a->fd, "PJSIP History cleared\n");
 			return CLI_SUCCESS;
 		}
@@ -1365,6 +1770,7 @@ static pjsip_module logging_module = {
 static struct ast_cli_entry cli_pjsip[] = {
 	AST_CLI_DEFINE(pjsip_set_history, "Enable/Disable PJSIP History"),
 	AST_CLI_DEFINE(pjsip_show_history, "Display PJSIP History"),
+	AST_CLI_DEFINE(pjsip_export_history, "Export PJSIP History to a pcap file"),
 };
 
 static int load_module(void)
@@ -1376,8 +1782,6 @@ static int load_module(void)
 
 	ast_pjproject_caching_pool_init(&cachingpool, &pj_pool_factory_default_policy, 0);
 
-	AST_VECTOR_INIT(&vector_history, HISTORY_INITIAL_SIZE);
-
 	ast_sip_register_service(&logging_module);
 	ast_cli_register_multiple(cli_pjsip, ARRAY_LEN(cli_pjsip));
 
@@ -1389,8 +1793,7 @@ static int unload_module(void)
 	ast_cli_unregister_multiple(cli_pjsip, ARRAY_LEN(cli_pjsip));
 	ast_sip_unregister_service(&logging_module);
 
-	ast_sip_push_task_wait_servant(NULL, clear_history_entries, NULL);
-	AST_VECTOR_FREE(&vector_history);
+	clear_history_entries();
 
 	ast_pjproject_caching_pool_destroy(&cachingpool);
 
@@ -127,6 +127,8 @@ struct mwi_subscription {
 	unsigned int is_solicited;
 	/*! True if this subscription is to be terminated */
 	unsigned int terminate;
+	/*! Set while a NOTIFY is queued, which will carry the counts of any later change too */
+	int notify_queued;
 	/*! Identifier for the subscription.
 	 * The identifier is the same as the corresponding endpoint's stasis ID.
 	 * Used as a hash key
@@ -366,6 +368,10 @@ struct unsolicited_mwi_data {
 	struct ast_sip_endpoint *endpoint;
 	pjsip_evsub_state state;
 	struct ast_sip_message_accumulator *counter;
+	/*! The body last generated, shared by the contacts it is the same for */
+	struct ast_str *body_text;
+	/*! The Message-Account the body was generated with */
+	char body_account[PJSIP_MAX_URL_SIZE];
 };
 
 static int send_unsolicited_mwi_notify_to_contact(void *obj, void *arg, int flags)
@@ -383,7 +389,6 @@ static int send_unsolicited_mwi_notify_to_contact(void *obj, void *arg, int flag
 	pjsip_sip_uri *from_uri;
 	const pjsip_hdr *allow_events = pjsip_evsub_get_allow_events_hdr(NULL);
 	struct ast_sip_body body;
-	struct ast_str *body_text;
 	struct ast_sip_body_data body_data = {
 		.body_type = AST_SIP_MESSAGE_ACCUMULATOR,
 		.body_data = mwi_data->counter,
@@ -396,11 +401,6 @@ static int send_unsolicited_mwi_notify_to_contact(void *obj, void *arg, int flag
 
 	body.type = MWI_TYPE;
 	body.subtype = MWI_SUBTYPE;
-	body_text = ast_str_create(64);
-	if (!body_text) {
-		pjsip_tx_data_dec_ref(tdata);
-		return 0;
-	}
 
 	from = PJSIP_MSG_FROM_HDR(tdata->msg);
 	from_uri = pjsip_uri_get_uri(from->uri);
@@ -411,14 +411,21 @@ static int send_unsolicited_mwi_notify_to_contact(void *obj, void *arg, int flag
 
 	set_voicemail_extension(tdata->pool, from_uri, mwi_data->counter, endpoint->subscription.mwi.voicemail_extension);
 
-	if (ast_sip_pubsub_generate_body_content(body.type, body.subtype, &body_data, &body_text)) {
-		ast_log(LOG_WARNING, "Unable to generate SIP MWI NOTIFY body.\n");
-		ast_free(body_text);
-		pjsip_tx_data_dec_ref(tdata);
-		return 0;
+	/* The body only differs between contacts if their Message-Account does */
+	if (!ast_str_strlen(mwi_data->body_text)
+		|| strcmp(mwi_data->body_account, mwi_data->counter->message_account)) {
+		ast_str_reset(mwi_data->body_text);
+		if (ast_sip_pubsub_generate_body_content(body.type, body.subtype, &body_data, &mwi_data->body_text)) {
+			ast_log(LOG_WARNING, "Unable to generate SIP MWI NOTIFY body.\n");
+			ast_str_reset(mwi_data->body_text);
+			pjsip_tx_data_dec_ref(tdata);
+			return 0;
+		}
+		ast_copy_string(mwi_data->body_account, mwi_data->counter->message_account,
+			sizeof(mwi_data->body_account));
 	}
 
-	body.body_text = ast_str_buffer(body_text);
+	body.body_text = ast_str_buffer(mwi_data->body_text);
 
 	switch (state) {
 	case PJSIP_EVSUB_STATE_ACTIVE:
@@ -442,8 +449,6 @@ static int send_unsolicited_mwi_notify_to_contact(void *obj, void *arg, int flag
 	ast_sip_add_body(tdata, &body);
 	ast_sip_send_request(tdata, NULL, endpoint, NULL, NULL);
 
-	ast_free(body_text);
-
 	return 0;
 }
 
@@ -494,6 +499,7 @@ static void send_unsolicited_mwi_notify(struct mwi_subscription *sub,
 				"endpoint", sub->id), ao2_cleanup);
 	char *endpoint_aors;
 	char *aor_name;
+	struct ast_str *body_text;
 
 	if (!endpoint) {
 		ast_log(LOG_WARNING, "Unable to send unsolicited MWI to %s because endpoint does not exist\n",
@@ -506,6 +512,11 @@ static void send_unsolicited_mwi_notify(struct mwi_subscription *sub,
 		return;
 	}
 
+	body_text = ast_str_create(64);
+	if (!body_text) {
+		return;
+	}
+
 	endpoint_aors = ast_strdupa(endpoint->aors);
 
 	ast_debug(5, "Sending unsolicited MWI NOTIFY to endpoint %s, new messages: %d, old messages: %d\n",
@@ -518,6 +529,7 @@ static void send_unsolicited_mwi_notify(struct mwi_subscription *sub,
 			.sub = sub,
 			.endpoint = endpoint,
 			.counter = counter,
+			.body_text = body_text,
 		};
 
 		if (!aor) {
@@ -532,7 +544,10 @@ static void send_unsolicited_mwi_notify(struct mwi_subscription *sub,
 		}
 
 		ao2_callback(contacts, OBJ_NODATA, send_unsolicited_mwi_notify_to_contact, &mwi_data);
+		body_text = mwi_data.body_text;
 	}
+
+	ast_free(body_text);
 }
 
 static void send_mwi_notify(struct mwi_subscription *sub)
@@ -1119,6 +1134,8 @@ static int serialized_notify(void *userdata)
 {
 	struct mwi_subscription *mwi_sub = userdata;
 
+	/* Changes from here on need a NOTIFY of their own */
+	ast_atomic_fetch_and(&mwi_sub->notify_queued, 0, __ATOMIC_SEQ_CST);
 	send_mwi_notify(mwi_sub);
 	ao2_ref(mwi_sub, -1);
 	return 0;
@@ -1142,11 +1159,19 @@ static int serialized_cleanup(void *userdata)
 static int send_notify(void *obj, void *arg, int flags)
 {
 	struct mwi_subscription *mwi_sub = obj;
-	struct ast_taskprocessor *serializer = mwi_sub->is_solicited
+	struct ast_taskprocessor *serializer;
+
+	/* The NOTIFY already queued reads the counts when it is sent */
+	if (ast_atomic_fetch_or(&mwi_sub->notify_queued, 1, __ATOMIC_SEQ_CST)) {
+		return 0;
+	}
+
+	serializer = mwi_sub->is_solicited
 		? ast_sip_subscription_get_serializer(mwi_sub->sip_sub)
 		: ast_serializer_pool_get(mwi_serializer_pool);
 
 	if (ast_sip_push_task(serializer, serialized_notify, ao2_bump(mwi_sub))) {
+		mwi_sub->notify_queued = 0;
 		ao2_ref(mwi_sub, -1);
 	}
 
@@ -134,6 +134,15 @@
 						or larger value to have fine grained control over the size of this random delay.</para>
 					</description>
 				</configOption>
+				<configOption name="refresh_jitter" default="0">
+					<synopsis>Maximum interval in seconds for which a refresh may be randomly sent early</synopsis>
+					<description>
+						<para>Registrations made at the same time, such as when Asterisk starts, otherwise
+						keep being refreshed at the same time.  Sending each refresh up to this many
+						seconds early, picked at random, spreads them out.</para>
+						<para>At most half of the expiration granted by the server is taken off.</para>
+					</description>
+				</configOption>
 				<configOption name="retry_interval" default="60">
 					<synopsis>Interval in seconds between retries if outbound registration is unsuccessful</synopsis>
 				</configOption>
@@ -351,6 +360,8 @@ struct sip_outbound_registration {
 	unsigned int expiration;
 	/*! \brief Maximum random initial delay interval for initial registrations */
 	unsigned int max_random_initial_delay;
+	/*! \brief Maximum random interval refreshes are sent early */
+	unsigned int refresh_jitter;
 	/*! \brief Interval at which retries should occur for temporal responses */
 	unsigned int retry_interval;
 	/*! \brief Interval at which retries should occur for permanent responses */
@@ -408,6 +419,8 @@ struct sip_outbound_registration_client_state {
 	unsigned int forbidden_retry_interval;
 	/*! \brief Interval at which retries should occur for all permanent responses */
 	unsigned int fatal_retry_interval;
+	/*! \brief Maximum random interval refreshes are sent early */
+	unsigned int refresh_jitter;
 	/*! \brief Treat authentication challenges that we cannot handle as permanent failures */
 	unsigned int auth_rejection_permanent;
 	/*! \brief Determines whether SIP Path support should be advertised */
@@ -457,7 +470,11 @@ struct sip_outbound_registration_state {
 static struct ast_serializer_shutdown_group *shutdown_group;
 
 /*! \brief Default number of state container buckets */
-#define DEFAULT_STATE_BUCKETS 53
+#define DEFAULT_STATE_BUCKETS 1021
+
+/*! \brief Serializers registrations are hashed onto when outbound_registration_serializers is set */
+static AST_VECTOR(, struct ast_taskprocessor *) shared_serializers;
+AST_MUTEX_DEFINE_STATIC(shared_serializers_lock);
 static AO2_GLOBAL_OBJ_STATIC(current_states);
 
 /*! subscription id for network change events */
@@ -1361,6 +1378,11 @@ static int handle_registration_response(void *data)
 			update_client_state_status(response->client_state, SIP_REGISTRATION_REGISTERED);
 			response->client_state->retries = 0;
 			next_registration_round = response->expiration - REREGISTER_BUFFER_TIME;
+			if (response->client_state->refresh_jitter && next_registration_round > 0) {
+				/* Spread out refreshes, but leave at least half of the expiration */
+				next_registration_round -= ast_random() %
+					(MIN(response->client_state->refresh_jitter, (unsigned int) response->expiration / 2) + 1);
+			}
 			if (next_registration_round < 0) {
 				/* Re-register immediately. */
 				next_registration_round = 0;
@@ -1554,11 +1576,49 @@ static void sip_outbound_registration_client_state_destroy(void *obj)
 	}
 }
 
+/*!
+ * \internal
+ * \brief Get the shared serializer a registration is hashed onto
+ *
+ * \param name The name of the registration
+ * \param count How many serializers are shared
+ *
+ * \return The serializer, with a reference
+ * \retval NULL on failure
+ */
+static struct ast_taskprocessor *shared_serializer_get(const char *name, unsigned int count)
+{
+	struct ast_taskprocessor *serializer = NULL;
+
+	ast_mutex_lock(&shared_serializers_lock);
+	while (AST_VECTOR_SIZE(&shared_serializers) < count) {
+		char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+
+		ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "pjsip/outreg/shared");
+		serializer = ast_sip_create_serializer_group(tps_name, shutdown_group);
+		if (!serializer) {
+			break;
+		}
+		if (AST_VECTOR_APPEND(&shared_serializers, serializer)) {
+			ast_taskprocessor_unreference(serializer);
+			break;
+		}
+	}
+
+	/* The count may have been lowered by a reload, or not all of them created */
+	count = MIN(count, AST_VECTOR_SIZE(&shared_serializers));
+	serializer = count ? ao2_bump(AST_VECTOR_GET(&shared_serializers, ast_str_hash(name) % count)) : NULL;
+	ast_mutex_unlock(&shared_serializers_lock);
+
+	return serializer;
+}
+
 /*! \brief Allocator function for registration state */
 static struct sip_outbound_registration_state *sip_outbound_registration_state_alloc(struct sip_outbound_registration *registration)
 {
 	struct sip_outbound_registration_state *state;
 	char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+	unsigned int shared;
 
 	state = ao2_alloc(sizeof(*state), sip_outbound_registration_state_destroy);
 	if (!state) {
@@ -1589,12 +1649,18 @@ static struct sip_outbound_registration_state *sip_outbound_registration_state_a
 		return NULL;
 	}
 
-	/* Create name with seq number appended. */
-	ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "pjsip/outreg/%s",
-		ast_sorcery_object_get_id(registration));
+	shared = ast_sip_get_outbound_registration_serializers();
+	if (shared) {
+		state->client_state->serializer = shared_serializer_get(
+			ast_sorcery_object_get_id(registration), shared);
+	} else {
+		/* Create name with seq number appended. */
+		ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "pjsip/outreg/%s",
+			ast_sorcery_object_get_id(registration));
 
-	state->client_state->serializer = ast_sip_create_serializer_group(tps_name,
-		shutdown_group);
+		state->client_state->serializer = ast_sip_create_serializer_group(tps_name,
+			shutdown_group);
+	}
 	if (!state->client_state->serializer) {
 		ao2_cleanup(state);
 		return NULL;
@@ -1964,6 +2030,7 @@ static int sip_outbound_registration_perform(void *data)
 	state->client_state->retry_interval = registration->retry_interval;
 	state->client_state->forbidden_retry_interval = registration->forbidden_retry_interval;
 	state->client_state->fatal_retry_interval = registration->fatal_retry_interval;
+	state->client_state->refresh_jitter = registration->refresh_jitter;
 	state->client_state->max_retries = registration->max_retries;
 	state->client_state->retries = 0;
 	state->client_state->support_path = registration->support_path;
@@ -2593,14 +2660,16 @@ static struct ast_cli_entry cli_outbound_registration[] = {
 	AST_CLI_DEFINE(cli_register, "Registers an outbound registration target"),
 	AST_CLI_DEFINE(my_cli_traverse_objects, "List PJSIP Registrations",
 		.command = "pjsip list registrations",
-		.usage = "Usage: pjsip list registrations [ like <pattern> ]\n"
+		.usage = "Usage: pjsip list registrations [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 				"       List the configured PJSIP Registrations\n"
-				"       Optional regular expression pattern is used to filter the list.\n"),
+				"       Optional regular expression pattern is used to filter the list.\n"
+				"       Optional limit and after list a page of the objects, sorted by id.\n"),
 	AST_CLI_DEFINE(my_cli_traverse_objects, "Show PJSIP Registrations",
 		.command = "pjsip show registrations",
-		.usage = "Usage: pjsip show registrations [ like <pattern> ]\n"
+		.usage = "Usage: pjsip show registrations [ like <pattern> ] [ limit <n> ] [ after <id> ]\n"
 				"       Show the configured PJSIP Registrations\n"
-				"       Optional regular expression pattern is used to filter the list.\n"),
+				"       Optional regular expression pattern is used to filter the list.\n"
+				"       Optional limit and after list a page of the objects, sorted by id.\n"),
 	AST_CLI_DEFINE(my_cli_traverse_objects, "Show PJSIP Registration",
 		.command = "pjsip show registration",
 		.usage = "Usage: pjsip show registration <id>\n"
@@ -2761,6 +2830,12 @@ static int unload_module(void)
 
 	ast_sip_transport_monitor_unregister_all(registration_transport_shutdown_cb, NULL, NULL);
 
+	/* The shared serializers go once the registrations on them are gone */
+	ast_mutex_lock(&shared_serializers_lock);
+	AST_VECTOR_RESET(&shared_serializers, ast_taskprocessor_unreference);
+	AST_VECTOR_FREE(&shared_serializers);
+	ast_mutex_unlock(&shared_serializers_lock);
+
 	/* Wait for registration serializers to get destroyed. */
 	ast_debug(2, "Waiting for registration transactions to complete for unload.\n");
 	remaining = ast_serializer_shutdown_group_join(shutdown_group, MAX_UNLOAD_TIMEOUT_TIME);
@@ -2823,6 +2898,7 @@ static int load_module(void)
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "outbound_proxy", "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct sip_outbound_registration, outbound_proxy));
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "expiration", "3600", OPT_UINT_T, 0, FLDSET(struct sip_outbound_registration, expiration));
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "max_random_initial_delay", "10", OPT_UINT_T, 0, FLDSET(struct sip_outbound_registration, max_random_initial_delay));
+	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "refresh_jitter", "0", OPT_UINT_T, 0, FLDSET(struct sip_outbound_registration, refresh_jitter));
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "retry_interval", "60", OPT_UINT_T, 0, FLDSET(struct sip_outbound_registration, retry_interval));
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "forbidden_retry_interval", "0", OPT_UINT_T, 0, FLDSET(struct sip_outbound_registration, forbidden_retry_interval));
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "fatal_retry_interval", "0", OPT_UINT_T, 0, FLDSET(struct sip_outbound_registration, fatal_retry_interval));
@@ -45,6 +45,7 @@
 #include "asterisk/manager.h"
 #include "asterisk/cli.h"
 #include "asterisk/test.h"
+#include "asterisk/sem.h"
 #include "res_pjsip/include/res_pjsip_private.h"
 #include "asterisk/res_pjsip_presence_xml.h"
 
@@ -479,6 +480,8 @@ struct sip_subscription_tree {
 	 * Used to refresh modified RLS.
 	 */
 	unsigned int generate_initial_notify;
+	/*! Indicator the tree is in persistence_writes, protected by its lock */
+	unsigned int persistence_queued;
 };
 
 /*!
@@ -550,6 +553,11 @@ enum sip_persistence_update_type {
 
 AST_RWLIST_HEAD_STATIC(subscriptions, sip_subscription_tree);
 
+/*! Subscription trees whose persistence has updates waiting to be written */
+static struct ao2_container *persistence_writes;
+/*! The task writing persistence_writes, protected by its lock */
+static struct ast_sip_sched_task *persistence_flush_task;
+
 AST_RWLIST_HEAD_STATIC(body_generators, ast_sip_pubsub_body_generator);
 AST_RWLIST_HEAD_STATIC(body_supplements, ast_sip_pubsub_body_supplement);
 
@@ -673,6 +681,118 @@ static struct subscription_persistence *subscription_persistence_create(struct s
 	return persistence;
 }
 
+/*!
+ * \internal
+ * \brief Write the persistence of a subscription tree to sorcery.
+ *
+ * Runs in the serializer of the tree, like the updates of its persistence.
+ */
+static int subscription_persistence_write_task(void *obj)
+{
+	struct sip_subscription_tree *sub_tree = obj;
+
+	/* The subscription may have been removed while the write was waiting */
+	if (sub_tree->persistence) {
+		ast_sorcery_update(ast_sip_get_sorcery(), sub_tree->persistence);
+	}
+	return 0;
+}
+
+/*! \brief subscription_persistence_write_task, pushed with a reference to the tree */
+static int subscription_persistence_write_pushed(void *obj)
+{
+	subscription_persistence_write_task(obj);
+	ao2_ref(obj, -1);
+	return 0;
+}
+
+static int persistence_writes_dequeue(void *obj, void *arg, int flags)
+{
+	struct sip_subscription_tree *sub_tree = obj;
+
+	sub_tree->persistence_queued = 0;
+	return CMP_MATCH;
+}
+
+/*!
+ * \internal
+ * \brief Write the persistence of the trees waiting in persistence_writes.
+ *
+ * \param wait Whether to wait for the writes to be done
+ */
+static void persistence_writes_flush(int wait)
+{
+	struct ao2_iterator *iter;
+	struct sip_subscription_tree *sub_tree;
+
+	ao2_lock(persistence_writes);
+	ao2_cleanup(persistence_flush_task);
+	persistence_flush_task = NULL;
+	iter = ao2_callback(persistence_writes, OBJ_MULTIPLE | OBJ_UNLINK | OBJ_NOLOCK,
+		persistence_writes_dequeue, NULL);
+	ao2_unlock(persistence_writes);
+	if (!iter) {
+		return;
+	}
+
+	while ((sub_tree = ao2_iterator_next(iter))) {
+		if (wait) {
+			ast_sip_push_task_wait_serializer(sub_tree->serializer,
+				subscription_persistence_write_task, sub_tree);
+		} else if (ast_sip_push_task(sub_tree->serializer,
+			subscription_persistence_write_pushed, sub_tree)) {
+			ast_log(LOG_WARNING, "Could not write persistence of subscription '%s->%s'\n",
+				ast_sorcery_object_get_id(sub_tree->endpoint), sub_tree->root->resource);
+		} else {
+			/* The task owns the reference now */
+			continue;
+		}
+		ao2_ref(sub_tree, -1);
+	}
+	ao2_iterator_destroy(iter);
+}
+
+static int persistence_writes_flush_task(void *data)
+{
+	persistence_writes_flush(0);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Write the persistence of a subscription tree, now or with the next batch.
+ *
+ * With the global subscription_persistence_write_delay set, the tree waits
+ * in persistence_writes for the write of the batch it joined, so all the
+ * updates made to it in the meantime cost a single write.
+ */
+static void subscription_persistence_write(struct sip_subscription_tree *sub_tree)
+{
+	unsigned int delay = ast_sip_get_subscription_persistence_write_delay();
+	int queued = 0;
+
+	if (delay && persistence_writes) {
+		ao2_lock(persistence_writes);
+		if (!persistence_flush_task) {
+			persistence_flush_task = ast_sip_schedule_task(NULL, delay,
+				persistence_writes_flush_task, "pjsip/pubsub/persistence", NULL,
+				AST_SIP_SCHED_TASK_ONESHOT);
+		}
+		if (sub_tree->persistence_queued) {
+			queued = 1;
+		} else if (persistence_flush_task
+			&& ao2_link_flags(persistence_writes, sub_tree, OBJ_NOLOCK)) {
+			sub_tree->persistence_queued = 1;
+			queued = 1;
+		}
+		ao2_unlock(persistence_writes);
+	}
+
+	if (!queued) {
+		ast_sorcery_update(ast_sip_get_sorcery(), sub_tree->persistence);
+	}
+}
+
 /*! \brief Function which updates persistence information of a subscription in sorcery */
 static void subscription_persistence_update(struct sip_subscription_tree *sub_tree,
 	pjsip_rx_data *rdata, enum sip_persistence_update_type type)
@@ -754,7 +874,7 @@ static void subscription_persistence_update(struct sip_subscription_tree *sub_tr
 		sub_tree->persistence->local_port = rdata->tp_info.transport->local_name.port;
 	}
 
-	ast_sorcery_update(ast_sip_get_sorcery(), sub_tree->persistence);
+	subscription_persistence_write(sub_tree);
 }
 
 /*! \brief Function which removes persistence of a subscription from sorcery */
@@ -938,19 +1058,14 @@ static struct resource_list *retrieve_resource_list(const char *resource, const
 /*!
  * \brief Allocate a tree node
  *
- * In addition to allocating and initializing the tree node, the node is also added
- * to the vector of visited resources. See \ref build_resource_tree for more information
- * on the visited resources.
- *
  * \param resource The name of the resource for this tree node.
- * \param visited The vector of resources that have been visited.
  * \param full_state if allocating a list, indicate whether full state is requested in notifications.
  * \param display_name the display name to include with this tree node.
  *
  * \retval NULL Allocation failure.
  * \retval non-NULL The newly-allocated tree_node
  */
-static struct tree_node *tree_node_alloc(const char *resource, struct resources *visited, unsigned int full_state, const char *display_name)
+static struct tree_node *tree_node_alloc(const char *resource, unsigned int full_state, const char *display_name)
 {
 	struct tree_node *node;
 
@@ -967,9 +1082,6 @@ static struct tree_node *tree_node_alloc(const char *resource, struct resources
 	node->full_state = full_state;
 	node->display_name = ast_strdup(display_name);
 
-	if (visited) {
-		AST_VECTOR_APPEND(visited, resource);
-	}
 	return node;
 }
 
@@ -1018,17 +1130,256 @@ static int have_visited(const char *resource, struct resources *visited)
 	return 0;
 }
 
+/*!
+ * \brief A node of a list template
+ *
+ * A list template is a resource list with the lists it refers to expanded
+ * into a tree, leaving out loops and duplicate resources.  It is built once
+ * from sorcery and shared by all the subscriptions to the list, see
+ * \ref build_resource_tree.
+ */
+struct list_template_node {
+	AST_VECTOR(, struct list_template_node *) children;
+	/*! The resource list, NULL if the node is a resource subscribed to through the handler */
+	struct resource_list *list;
+	char resource[0];
+};
+
+/*!
+ * \brief A list template
+ *
+ * Immutable once built.  Stored in list_templates by the event of the list
+ * and its name.
+ */
+struct list_template {
+	struct list_template_node *root;
+	/*! The event of the list, a colon and the name of the list */
+	char key[0];
+};
+
+/*! List templates built so far */
+static struct ao2_container *list_templates;
+
+AO2_STRING_FIELD_HASH_FN(list_template, key);
+AO2_STRING_FIELD_CMP_FN(list_template, key);
+
+static struct list_template_node *list_template_node_alloc(const char *resource,
+	struct resource_list *list, struct resources *visited)
+{
+	struct list_template_node *node;
+
+	node = ast_calloc(1, sizeof(*node) + strlen(resource) + 1);
+	if (!node) {
+		return NULL;
+	}
+
+	strcpy(node->resource, resource);
+	if (AST_VECTOR_INIT(&node->children, list ? AST_VECTOR_SIZE(&list->items) : 0)) {
+		ast_free(node);
+		return NULL;
+	}
+	node->list = ao2_bump(list);
+
+	AST_VECTOR_APPEND(visited, node->resource);
+	return node;
+}
+
+static void list_template_node_destroy(struct list_template_node *node)
+{
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&node->children); ++i) {
+		list_template_node_destroy(AST_VECTOR_GET(&node->children, i));
+	}
+	AST_VECTOR_FREE(&node->children);
+	ao2_cleanup(node->list);
+	ast_free(node);
+}
+
+/*!
+ * \brief Add the resources of a list to its node of a list template.
+ *
+ * Resources that are lists themselves are added with their own resources.
+ * Resources visited before are left out, avoiding duplicates and loops.
+ */
+static void list_template_build_children(struct list_template_node *parent, struct resources *visited)
+{
+	struct resource_list *list = parent->list;
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&list->items); ++i) {
+		struct list_template_node *current;
+		struct resource_list *child_list;
+		const char *resource = AST_VECTOR_GET(&list->items, i);
+
+		if (have_visited(resource, visited)) {
+			ast_debug(1, "Already visited resource %s. Avoiding duplicate resource or potential loop.\n", resource);
+			continue;
+		}
+
+		child_list = retrieve_resource_list(resource, list->event);
+		current = list_template_node_alloc(resource, child_list, visited);
+		if (!current) {
+			ao2_cleanup(child_list);
+			continue;
+		}
+		if (child_list) {
+			ast_debug(2, "Resource %s (child of %s) is a list\n", resource, parent->resource);
+			list_template_build_children(current, visited);
+			ao2_ref(child_list, -1);
+		}
+		if (AST_VECTOR_APPEND(&parent->children, current)) {
+			list_template_node_destroy(current);
+		}
+	}
+}
+
+static void list_template_destructor(void *obj)
+{
+	struct list_template *template = obj;
+
+	if (template->root) {
+		list_template_node_destroy(template->root);
+	}
+}
+
+/*!
+ * \brief Build the list template of a resource list
+ *
+ * \param list The resource list
+ * \param key The key of the template
+ */
+static struct list_template *list_template_alloc(struct resource_list *list, const char *key)
+{
+	struct list_template *template;
+	struct resources visited;
+
+	template = ao2_alloc_options(sizeof(*template) + strlen(key) + 1, list_template_destructor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!template) {
+		return NULL;
+	}
+	strcpy(template->key, key); /* Safe */
+
+	if (AST_VECTOR_INIT(&visited, AST_VECTOR_SIZE(&list->items))) {
+		ao2_ref(template, -1);
+		return NULL;
+	}
+
+	template->root = list_template_node_alloc(ast_sorcery_object_get_id(list), list, &visited);
+	if (template->root) {
+		list_template_build_children(template->root, &visited);
+	}
+	AST_VECTOR_FREE(&visited);
+
+	if (!template->root) {
+		ao2_ref(template, -1);
+		return NULL;
+	}
+	return template;
+}
+
+/*!
+ * \brief Determine if the lists of a list template are still the ones configured
+ *
+ * Resource lists are replaced in sorcery when they change, so comparing
+ * the list objects finds whether any was changed, deleted or reloaded.
+ */
+static int list_template_node_is_current(const struct list_template_node *node)
+{
+	struct resource_list *list;
+	int i;
+
+	if (!node->list) {
+		return 1;
+	}
+
+	list = ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "resource_list", node->resource);
+	ao2_cleanup(list);
+	if (list != node->list) {
+		return 0;
+	}
+
+	for (i = 0; i < AST_VECTOR_SIZE(&node->children); ++i) {
+		if (!list_template_node_is_current(AST_VECTOR_GET(&node->children, i))) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*!
+ * \brief Get the list template of a resource list
+ *
+ * The template built earlier is used as long as its lists are still the
+ * ones configured.  Otherwise the template is built from sorcery again.
+ *
+ * \param resource The name of the resource list
+ * \param event The event of the subscription
+ *
+ * \retval NULL The resource is not a list for the event
+ * \retval non-NULL The list template, which must be unreferenced
+ */
+static struct list_template *list_template_get(const char *resource, const char *event)
+{
+	char key[strlen(event) + strlen(resource) + 2];
+	struct list_template *template;
+	struct resource_list *list;
+
+	sprintf(key, "%s:%s", event, resource); /* Safe */
+
+	template = list_templates ? ao2_find(list_templates, key, OBJ_SEARCH_KEY) : NULL;
+	if (template) {
+		if (list_template_node_is_current(template->root)) {
+			return template;
+		}
+		ast_debug(2, "Resource list %s has changed, building its template again\n", resource);
+		ao2_ref(template, -1);
+	}
+
+	list = retrieve_resource_list(resource, event);
+	if (!list) {
+		if (list_templates) {
+			ao2_find(list_templates, key, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+		}
+		return NULL;
+	}
+
+	template = list_template_alloc(list, key);
+	ao2_ref(list, -1);
+	if (template && list_templates) {
+		ao2_lock(list_templates);
+		ao2_find(list_templates, key, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+		ao2_link_flags(list_templates, template, OBJ_NOLOCK);
+		ao2_unlock(list_templates);
+	}
+
+	return template;
+}
+
+/*! \brief Forget the list templates of the resource lists that were reloaded */
+static void list_templates_loaded(const char *object_type)
+{
+	if (list_templates) {
+		ao2_callback(list_templates, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	}
+}
+
+static const struct ast_sorcery_observer list_template_observer = {
+	.loaded = list_templates_loaded,
+};
+
 #define NEW_SUBSCRIBE(notifier, endpoint, resource, rdata) notifier->new_subscribe_with_rdata ? notifier->new_subscribe_with_rdata(endpoint, resource, rdata) : notifier->new_subscribe(endpoint, resource)
 
 /*!
  * \brief Build child nodes for a given parent.
  *
- * This iterates through the items on a resource list and creates tree nodes for each one. The
- * tree nodes created are children of the supplied parent node. If an item in the resource
- * list is itself a list, then this function is called recursively to provide children for
- * the new node.
+ * This iterates through the resources of a node of a list template and creates tree
+ * nodes for each one. The tree nodes created are children of the supplied parent node.
+ * If a resource is itself a list, then this function is called recursively to provide
+ * children for the new node.
  *
- * If an item in a resource list is not a list, then the supplied subscription handler is
+ * If a resource is not a list, then the supplied subscription handler is
  * called into as if a new SUBSCRIBE for the list item were presented. The handler's response
  * is used to determine if the node can be added to the tree or not.
  *
@@ -1037,34 +1388,27 @@ static int have_visited(const char *resource, struct resources *visited)
  *
  * \param endpoint The endpoint that sent the inbound SUBSCRIBE.
  * \param handler The subscription handler for leaf nodes in the tree.
- * \param list The configured resource list from which the child node is being built.
+ * \param list The node of the list template from which the child nodes are being built.
  * \param parent The parent node for these children.
- * \param visited The resources that have already been visited.
  */
 static void build_node_children(struct ast_sip_endpoint *endpoint, const struct ast_sip_subscription_handler *handler,
-		struct resource_list *list, struct tree_node *parent, struct resources *visited, pjsip_rx_data *rdata)
+		const struct list_template_node *list, struct tree_node *parent, pjsip_rx_data *rdata)
 {
 	int i;
 
-	for (i = 0; i < AST_VECTOR_SIZE(&list->items); ++i) {
+	for (i = 0; i < AST_VECTOR_SIZE(&list->children); ++i) {
 		struct tree_node *current;
-		struct resource_list *child_list;
-		const char *resource = AST_VECTOR_GET(&list->items, i);
-
-		if (have_visited(resource, visited)) {
-			ast_debug(1, "Already visited resource %s. Avoiding duplicate resource or potential loop.\n", resource);
-			continue;
-		}
+		const struct list_template_node *child = AST_VECTOR_GET(&list->children, i);
+		const char *resource = child->resource;
 
-		child_list = retrieve_resource_list(resource, list->event);
-		if (!child_list) {
+		if (!child->list) {
 			int resp = NEW_SUBSCRIBE(handler->notifier, endpoint, resource, rdata);
 			if (PJSIP_IS_STATUS_IN_CLASS(resp, 200)) {
 				char display_name[AST_MAX_EXTENSION] = "";
-				if (list->resource_display_name && handler->notifier->get_resource_display_name) {
+				if (list->list->resource_display_name && handler->notifier->get_resource_display_name) {
 					handler->notifier->get_resource_display_name(endpoint, resource, display_name, sizeof(display_name));
 				}
-				current = tree_node_alloc(resource, visited, 0, ast_strlen_zero(display_name) ? NULL : display_name);
+				current = tree_node_alloc(resource, 0, ast_strlen_zero(display_name) ? NULL : display_name);
 				if (!current) {
 					ast_debug(1,
 						"Subscription to leaf resource %s was successful, but encountered allocation error afterwards\n",
@@ -1082,23 +1426,22 @@ static void build_node_children(struct ast_sip_endpoint *endpoint, const struct
 			}
 		} else {
 			ast_debug(2, "Resource %s (child of %s) is a list\n", resource, parent->resource);
-			current = tree_node_alloc(resource, visited, child_list->full_state, NULL);
+			current = tree_node_alloc(resource, child->list->full_state, NULL);
 			if (!current) {
 				ast_debug(1, "Cannot build children of resource %s due to allocation failure\n", resource);
 				continue;
 			}
-			build_node_children(endpoint, handler, child_list, current, visited, rdata);
+			build_node_children(endpoint, handler, child, current, rdata);
 			if (AST_VECTOR_SIZE(&current->children) > 0) {
-				ast_debug(1, "List %s had no successful children.\n", resource);
+				ast_debug(2, "List %s had successful children. Adding to parent %s\n",
+						resource, parent->resource);
 				if (AST_VECTOR_APPEND(&parent->children, current)) {
 					tree_node_destroy(current);
 				}
 			} else {
-				ast_debug(2, "List %s had successful children. Adding to parent %s\n",
-						resource, parent->resource);
+				ast_debug(1, "List %s had no successful children.\n", resource);
 				tree_node_destroy(current);
 			}
-			ao2_cleanup(child_list);
 		}
 	}
 }
@@ -1145,10 +1488,12 @@ static void resource_tree_destroy(struct resource_tree *tree)
  *
  * This function builds a resource tree based on the requested resource in a SUBSCRIBE request.
  *
- * This function also creates a container that has all resources that have been visited during
- * creation of the tree, whether those resources resulted in a tree node being created or not.
- * Keeping this container of visited resources allows for misconfigurations such as loops in
- * the tree or duplicated resources to be detected.
+ * The resources of a list are taken from its list template.  While building the
+ * template, all resources that have been visited are kept, whether they turn into
+ * a tree node or not.  Keeping the visited resources allows for misconfigurations
+ * such as loops in the tree or duplicated resources to be detected.  The template
+ * is shared by all the subscriptions to the list, and only built again when the
+ * lists it was built from change.
  *
  * \param endpoint The endpoint that sent the SUBSCRIBE request.
  * \param handler The subscription handler for leaf nodes in the tree.
@@ -1162,15 +1507,15 @@ static void resource_tree_destroy(struct resource_tree *tree)
 static int build_resource_tree(struct ast_sip_endpoint *endpoint, const struct ast_sip_subscription_handler *handler,
 		const char *resource, struct resource_tree *tree, int has_eventlist_support, pjsip_rx_data *rdata)
 {
-	RAII_VAR(struct resource_list *, list, NULL, ao2_cleanup);
-	struct resources visited;
+	RAII_VAR(struct list_template *, template, NULL, ao2_cleanup);
+	struct resource_list *list;
 
 	int not_eventlist_but_needs_children = !strcmp(handler->body_type, AST_SIP_DEVICE_FEATURE_SYNC_DATA);
 
-	if ((!has_eventlist_support && !not_eventlist_but_needs_children) || !(list = retrieve_resource_list(resource, handler->event_name))) {
+	if ((!has_eventlist_support && !not_eventlist_but_needs_children) || !(template = list_template_get(resource, handler->event_name))) {
 		ast_debug(2, "Subscription '%s->%s' is not to a list\n",
 			ast_sorcery_object_get_id(endpoint), resource);
-		tree->root = tree_node_alloc(resource, NULL, 0, NULL);
+		tree->root = tree_node_alloc(resource, 0, NULL);
 		if (!tree->root) {
 			return 500;
 		}
@@ -1179,20 +1524,16 @@ static int build_resource_tree(struct ast_sip_endpoint *endpoint, const struct a
 
 	ast_debug(2, "Subscription '%s->%s' is a list\n",
 		ast_sorcery_object_get_id(endpoint), resource);
-	if (AST_VECTOR_INIT(&visited, AST_VECTOR_SIZE(&list->items))) {
-		return 500;
-	}
+	list = template->root->list;
 
-	tree->root = tree_node_alloc(resource, &visited, list->full_state, NULL);
+	tree->root = tree_node_alloc(resource, list->full_state, NULL);
 	if (!tree->root) {
-		AST_VECTOR_FREE(&visited);
 		return 500;
 	}
 
 	tree->notification_batch_interval = list->notification_batch_interval;
 
-	build_node_children(endpoint, handler, list, tree->root, &visited, rdata);
-	AST_VECTOR_FREE(&visited);
+	build_node_children(endpoint, handler, template->root, tree->root, rdata);
 
 	if (AST_VECTOR_SIZE(&tree->root->children) > 0) {
 		return 200;
@@ -1580,12 +1921,26 @@ struct initial_notify_data {
 static int initial_notify_task(void *obj);
 static int send_notify(struct sip_subscription_tree *sub_tree, unsigned int force_full_state);
 
+/*! The most persistent subscriptions recreated at once */
+#define PERSISTENCE_RECREATE_MAX 32
+
 /*! Persistent subscription recreation continuation under distributor serializer data */
 struct persistence_recreate_data {
 	struct subscription_persistence *persistence;
-	pjsip_rx_data *rdata;
+	/*! The request that created the subscription, allocated from pool */
+	pjsip_rx_data rdata;
+	pj_pool_t *pool;
+	/*! Posted once the subscription has been recreated */
+	struct ast_sem *sem;
 };
 
+static void persistence_recreate_data_free(struct persistence_recreate_data *recreate_data)
+{
+	ao2_cleanup(recreate_data->persistence);
+	pjsip_endpt_release_pool(ast_sip_get_pjsip_endpoint(), recreate_data->pool);
+	ast_free(recreate_data);
+}
+
 /*!
  * \internal
  * \brief subscription_persistence_recreate continuation under distributor serializer.
@@ -1598,7 +1953,7 @@ static int sub_persistence_recreate(void *obj)
 {
 	struct persistence_recreate_data *recreate_data = obj;
 	struct subscription_persistence *persistence = recreate_data->persistence;
-	pjsip_rx_data *rdata = recreate_data->rdata;
+	pjsip_rx_data *rdata = &recreate_data->rdata;
 	struct ast_sip_endpoint *endpoint;
 	struct sip_subscription_tree *sub_tree;
 	struct ast_sip_pubsub_body_generator *generator;
@@ -1721,14 +2076,26 @@ error:
 	return 0;
 }
 
+/*! \brief sub_persistence_recreate, letting the next subscription be recreated */
+static int sub_persistence_recreate_task(void *obj)
+{
+	struct persistence_recreate_data *recreate_data = obj;
+	struct ast_sem *sem = recreate_data->sem;
+
+	sub_persistence_recreate(recreate_data);
+	persistence_recreate_data_free(recreate_data);
+	ast_sem_post(sem);
+
+	return 0;
+}
+
 /*! \brief Callback function to perform the actual recreation of a subscription */
 static int subscription_persistence_recreate(void *obj, void *arg, int flags)
 {
 	struct subscription_persistence *persistence = obj;
-	pj_pool_t *pool = arg;
+	struct ast_sem *sem = arg;
 	struct ast_taskprocessor *serializer;
-	pjsip_rx_data rdata;
-	struct persistence_recreate_data recreate_data;
+	struct persistence_recreate_data *recreate_data;
 
 	/* If this subscription used a reliable transport it can't be reestablished so remove it */
 	if (persistence->prune_on_boot) {
@@ -1746,41 +2113,58 @@ static int subscription_persistence_recreate(void *obj, void *arg, int flags)
 		return 0;
 	}
 
-	memset(&rdata, 0, sizeof(rdata));
-	pj_pool_reset(pool);
-	rdata.tp_info.pool = pool;
+	recreate_data = ast_calloc(1, sizeof(*recreate_data));
+	if (!recreate_data) {
+		return 0;
+	}
+	recreate_data->pool = pjsip_endpt_create_pool(ast_sip_get_pjsip_endpoint(), "rtd%p",
+		PJSIP_POOL_RDATA_LEN, PJSIP_POOL_RDATA_INC);
+	if (!recreate_data->pool) {
+		ast_log(LOG_WARNING, "Failed recreating '%s' subscription: Could not create a memory pool\n",
+			persistence->endpoint);
+		ast_free(recreate_data);
+		return 0;
+	}
+	recreate_data->rdata.tp_info.pool = recreate_data->pool;
 
-	if (ast_sip_create_rdata_with_contact(&rdata, persistence->packet, persistence->src_name,
+	if (ast_sip_create_rdata_with_contact(&recreate_data->rdata, persistence->packet, persistence->src_name,
 		persistence->src_port, persistence->transport_type, persistence->local_name,
 		persistence->local_port, persistence->contact_uri)) {
 		ast_log(LOG_WARNING, "Failed recreating '%s' subscription: The message could not be parsed\n",
 			persistence->endpoint);
 		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
+		persistence_recreate_data_free(recreate_data);
 		return 0;
 	}
 
-	if (rdata.msg_info.msg->type != PJSIP_REQUEST_MSG) {
+	if (recreate_data->rdata.msg_info.msg->type != PJSIP_REQUEST_MSG) {
 		ast_log(LOG_NOTICE, "Failed recreating '%s' subscription: Stored a SIP response instead of a request.\n",
 			persistence->endpoint);
 		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
+		persistence_recreate_data_free(recreate_data);
 		return 0;
 	}
 
 	/* Continue the remainder in the distributor serializer */
-	serializer = ast_sip_get_distributor_serializer(&rdata);
+	serializer = ast_sip_get_distributor_serializer(&recreate_data->rdata);
 	if (!serializer) {
 		ast_log(LOG_WARNING, "Failed recreating '%s' subscription: Could not get distributor serializer.\n",
 			persistence->endpoint);
 		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
+		persistence_recreate_data_free(recreate_data);
 		return 0;
 	}
-	recreate_data.persistence = persistence;
-	recreate_data.rdata = &rdata;
-	if (ast_sip_push_task_wait_serializer(serializer, sub_persistence_recreate,
-		&recreate_data)) {
+	recreate_data->persistence = ao2_bump(persistence);
+	recreate_data->sem = sem;
+
+	/* Subscriptions are recreated on many serializers at once, up to PERSISTENCE_RECREATE_MAX */
+	ast_sem_wait(sem);
+	if (ast_sip_push_task(serializer, sub_persistence_recreate_task, recreate_data)) {
+		ast_sem_post(sem);
 		ast_log(LOG_WARNING, "Failed recreating '%s' subscription: Could not continue under distributor serializer.\n",
 			persistence->endpoint);
 		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
+		persistence_recreate_data_free(recreate_data);
 	}
 	ast_taskprocessor_unreference(serializer);
 
@@ -1792,18 +2176,26 @@ static int subscription_persistence_load(void *data)
 {
 	struct ao2_container *persisted_subscriptions = ast_sorcery_retrieve_by_fields(ast_sip_get_sorcery(),
 		"subscription_persistence", AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL);
-	pj_pool_t *pool;
+	struct ast_sem sem;
+	int i;
+
+	if (!persisted_subscriptions) {
+		return 0;
+	}
 
-	pool = pjsip_endpt_create_pool(ast_sip_get_pjsip_endpoint(), "rtd%p", PJSIP_POOL_RDATA_LEN,
-		PJSIP_POOL_RDATA_INC);
-	if (!pool) {
-		ast_log(LOG_WARNING, "Could not create a memory pool for recreating SIP subscriptions\n");
+	if (ast_sem_init(&sem, 0, PERSISTENCE_RECREATE_MAX)) {
+		ast_log(LOG_WARNING, "Could not create a semaphore for recreating SIP subscriptions\n");
+		ao2_ref(persisted_subscriptions, -1);
 		return 0;
 	}
 
-	ao2_callback(persisted_subscriptions, OBJ_NODATA, subscription_persistence_recreate, pool);
+	ao2_callback(persisted_subscriptions, OBJ_NODATA, subscription_persistence_recreate, &sem);
 
-	pjsip_endpt_release_pool(ast_sip_get_pjsip_endpoint(), pool);
+	/* Wait for the last subscriptions to be recreated */
+	for (i = 0; i < PERSISTENCE_RECREATE_MAX; ++i) {
+		ast_sem_wait(&sem);
+	}
+	ast_sem_destroy(&sem);
 
 	ao2_ref(persisted_subscriptions, -1);
 	return 0;
@@ -5893,6 +6285,21 @@ static int load_module(void)
 
 	pjsip_media_type_init2(&rlmi_media_type, "application", "rlmi+xml");
 
+	list_templates = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, 31,
+		list_template_hash_fn, NULL, list_template_cmp_fn);
+	if (list_templates) {
+		ast_sorcery_observer_add(sorcery, "resource_list", &list_template_observer);
+	} else {
+		ast_log(LOG_WARNING, "Could not create container for resource list templates, "
+			"resource lists will be read for every subscription\n");
+	}
+
+	persistence_writes = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX, 0, NULL, NULL);
+	if (!persistence_writes) {
+		ast_log(LOG_WARNING, "Could not create container for subscription persistence writes, "
+			"they will not be delayed\n");
+	}
+
 	pjsip_endpt_add_capability(ast_sip_get_pjsip_endpoint(), NULL, PJSIP_H_ALLOW, NULL, 1, &str_PUBLISH);
 
 	if (ast_test_flag(&ast_options, AST_OPT_FLAG_FULLY_BOOTED)) {
@@ -5943,6 +6350,23 @@ static int unload_module(void)
 	ast_manager_unregister(AMI_SHOW_SUBSCRIPTIONS_INBOUND);
 	ast_manager_unregister("PJSIPShowResourceLists");
 
+	if (persistence_writes) {
+		ao2_lock(persistence_writes);
+		if (persistence_flush_task) {
+			ast_sip_sched_task_cancel(persistence_flush_task);
+		}
+		ao2_unlock(persistence_writes);
+		persistence_writes_flush(1);
+		ao2_ref(persistence_writes, -1);
+		persistence_writes = NULL;
+	}
+
+	if (list_templates) {
+		ast_sorcery_observer_remove(ast_sip_get_sorcery(), "resource_list", &list_template_observer);
+		ao2_ref(list_templates, -1);
+		list_templates = NULL;
+	}
+
 	ast_sip_unregister_service(&pubsub_module);
 	if (sched) {
 		ast_sched_context_destroy(sched);
@@ -399,6 +399,173 @@ static void register_contact_transport_shutdown_cb(void *data)
 }
 
 
+/*! \brief The global interval at which to check for contact expiration */
+static unsigned int check_interval;
+
+/*! \brief Whether refreshes that change only the expiration of contacts are written later */
+static unsigned int defer_refresh;
+
+/*! \brief A refresh of a contact not written to sorcery yet */
+struct registrar_refresh {
+	/*! When the contact expires now */
+	struct timeval expiration_time;
+	/*! The AOR of the contact */
+	char *aor;
+	/*! The id of the contact */
+	char id[0];
+};
+
+/*! \brief The refreshes not written yet, by contact id */
+static struct ao2_container *pending_refreshes;
+
+AO2_STRING_FIELD_HASH_FN(registrar_refresh, id);
+AO2_STRING_FIELD_CMP_FN(registrar_refresh, id);
+
+/*!
+ * \internal
+ * \brief Whether a refresh may be kept in memory rather than written
+ *
+ * \param contact The contact as stored
+ * \param contact_update The refreshed contact
+ *
+ * \pre The AOR of the contact is locked.
+ */
+static int registrar_refresh_deferrable(const struct ast_sip_contact *contact,
+	const struct ast_sip_contact *contact_update)
+{
+	struct ast_variable *changes = NULL;
+	int res;
+
+	if (!defer_refresh || !check_interval || !pending_refreshes) {
+		return 0;
+	}
+
+	/* The stored expiration has to last until the check after next can write the new one */
+	if (ast_tvdiff_ms(contact->expiration_time, ast_tvnow()) <= check_interval * 2000LL) {
+		return 0;
+	}
+
+	if (ast_sorcery_diff(ast_sip_get_sorcery(), contact, contact_update, &changes)) {
+		return 0;
+	}
+	res = !changes || (!changes->next && !strcmp(changes->name, "expiration_time"));
+	ast_variables_destroy(changes);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Keep the refreshed expiration of a contact to write it later
+ *
+ * \pre The AOR of the contact is locked.
+ */
+static int registrar_refresh_defer(const struct ast_sip_contact *contact_update, const char *aor_name)
+{
+	const char *id = ast_sorcery_object_get_id(contact_update);
+	size_t id_len = strlen(id) + 1;
+	struct registrar_refresh *refresh;
+
+	refresh = ao2_alloc_options(sizeof(*refresh) + id_len + strlen(aor_name) + 1, NULL,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!refresh) {
+		return -1;
+	}
+	refresh->expiration_time = contact_update->expiration_time;
+	strcpy(refresh->id, id); /* Safe */
+	refresh->aor = refresh->id + id_len;
+	strcpy(refresh->aor, aor_name); /* Safe */
+
+	ao2_lock(pending_refreshes);
+	ao2_find(pending_refreshes, id, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+	ao2_link_flags(pending_refreshes, refresh, OBJ_NOLOCK);
+	ao2_unlock(pending_refreshes);
+	ao2_ref(refresh, -1);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Forget a refresh not written yet, as the contact was written or deleted
+ *
+ * \pre The AOR of the contact is locked.
+ */
+static void registrar_refresh_forget(const struct ast_sip_contact *contact)
+{
+	if (pending_refreshes) {
+		ao2_find(pending_refreshes, ast_sorcery_object_get_id(contact),
+			OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Write a refresh kept in memory if the stored expiration runs out before the deadline
+ */
+static void registrar_refresh_write(struct registrar_refresh *refresh, const struct timeval *deadline)
+{
+	struct ast_named_lock *lock;
+	struct ast_sip_contact *contact;
+	struct ast_sip_contact *contact_update;
+
+	lock = ast_named_lock_get_striped(AST_NAMED_LOCK_TYPE_MUTEX, "aor", refresh->aor);
+	if (!lock) {
+		return;
+	}
+
+	ao2_lock(lock);
+	contact = ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "contact", refresh->id);
+	if (!contact || ast_tvcmp(contact->expiration_time, refresh->expiration_time) >= 0) {
+		/* The contact is gone or was written since */
+		ao2_unlink(pending_refreshes, refresh);
+	} else if (!deadline || ast_tvcmp(contact->expiration_time, *deadline) <= 0) {
+		contact_update = ast_sorcery_copy(ast_sip_get_sorcery(), contact);
+		if (contact_update) {
+			contact_update->expiration_time = refresh->expiration_time;
+			if (ast_sip_location_update_contact(contact_update)) {
+				ast_log(LOG_ERROR, "Failed to write the refreshed expiration of contact '%s'\n",
+					contact->uri);
+			} else {
+				ast_debug(3, "Wrote the refreshed expiration of contact '%s' on AOR '%s'\n",
+					contact->uri, refresh->aor);
+			}
+			ao2_ref(contact_update, -1);
+		}
+		ao2_unlink(pending_refreshes, refresh);
+	}
+	ao2_unlock(lock);
+	ast_named_lock_put(lock);
+	ao2_cleanup(contact);
+}
+
+/*!
+ * \internal
+ * \brief Write the refreshes kept in memory whose stored expiration runs out before the deadline
+ *
+ * \param deadline Write them all if NULL
+ */
+static void registrar_refresh_write_all(const struct timeval *deadline)
+{
+	struct ao2_iterator *refreshes;
+	struct registrar_refresh *refresh;
+
+	if (!pending_refreshes || !ao2_container_count(pending_refreshes)) {
+		return;
+	}
+
+	/* The AOR lock is taken before the container's, so go through a snapshot */
+	refreshes = ao2_callback(pending_refreshes, OBJ_MULTIPLE, NULL, NULL);
+	if (!refreshes) {
+		return;
+	}
+	while ((refresh = ao2_iterator_next(refreshes))) {
+		registrar_refresh_write(refresh, deadline);
+		ao2_ref(refresh, -1);
+	}
+	ao2_iterator_destroy(refreshes);
+}
+
 static int registrar_contact_delete(enum contact_delete_type type, pjsip_transport *transport,
 	struct ast_sip_contact *contact, const char *aor_name)
 {
@@ -435,6 +602,7 @@ static int registrar_contact_delete(enum contact_delete_type type, pjsip_transpo
 	}
 
 	ast_sip_location_delete_contact(contact);
+	registrar_refresh_forget(contact);
 
 	if (aor_size) {
 		if (VERBOSITY_ATLEAST(3)) {
@@ -923,15 +1091,21 @@ static void register_aor_core(pjsip_rx_data *rdata,
 				ast_string_field_set(contact_update, reg_server, ast_config_AST_SYSTEM_NAME);
 			}
 
-			if (ast_sip_location_update_contact(contact_update)) {
+			if (registrar_refresh_deferrable(contact, contact_update)
+				&& !registrar_refresh_defer(contact_update, aor_name)) {
+				ast_debug(3, "Refreshed contact '%s' on AOR '%s' with new expiration of %d seconds, written later\n",
+					contact_uri, aor_name, expiration);
+			} else if (ast_sip_location_update_contact(contact_update)) {
 				ast_log(LOG_ERROR, "Failed to update contact '%s' expiration time to %d seconds.\n",
 					contact->uri, expiration);
 				registrar_contact_delete(CONTACT_DELETE_ERROR, rdata->tp_info.transport,
 					contact, aor_name);
 				continue;
+			} else {
+				registrar_refresh_forget(contact_update);
+				ast_debug(3, "Refreshed contact '%s' on AOR '%s' with new expiration of %d seconds\n",
+					contact_uri, aor_name, expiration);
 			}
-			ast_debug(3, "Refreshed contact '%s' on AOR '%s' with new expiration of %d seconds\n",
-				contact_uri, aor_name, expiration);
 			ast_test_suite_event_notify("AOR_CONTACT_REFRESHED",
 					"Contact: %s\r\n"
 					"AOR: %s\r\n"
@@ -1333,16 +1507,13 @@ static pjsip_module registrar_module = {
 /*! \brief Thread keeping things alive */
 static pthread_t check_thread = AST_PTHREADT_NULL;
 
-/*! \brief The global interval at which to check for contact expiration */
-static unsigned int check_interval;
-
 /*! \brief Callback function which deletes a contact */
 static int expire_contact(void *obj, void *arg, int flags)
 {
 	struct ast_sip_contact *contact = obj;
 	struct ast_named_lock *lock;
 
-	lock = ast_named_lock_get(AST_NAMED_LOCK_TYPE_MUTEX, "aor", contact->aor);
+	lock = ast_named_lock_get_striped(AST_NAMED_LOCK_TYPE_MUTEX, "aor", contact->aor);
 	if (!lock) {
 		return 0;
 	}
@@ -1366,10 +1537,15 @@ static void *check_expiration_thread(void *data)
 	struct ao2_container *contacts;
 	struct ast_variable *var;
 	char time[AST_TIME_T_LEN];
+	struct timeval deadline;
 
 	while (check_interval) {
 		sleep(check_interval);
 
+		/* Write the refreshes whose stored expiration would run out before the next check */
+		deadline = ast_tvadd(ast_tvnow(), ast_samp2tv(check_interval * 2, 1));
+		registrar_refresh_write_all(&deadline);
+
 		ast_time_t_to_string(ast_tvnow().tv_sec, time, sizeof(time));
 
 		var = ast_variable_new("expiration_time <=", time, "");
@@ -1393,6 +1569,7 @@ static void *check_expiration_thread(void *data)
 static void expiration_global_loaded(const char *object_type)
 {
 	check_interval = ast_sip_get_contact_expiration_check_interval();
+	defer_refresh = ast_sip_get_defer_contact_refresh();
 
 	/* Observer calls are serialized so this is safe without it's own lock */
 	if (check_interval) {
@@ -1410,6 +1587,8 @@ static void expiration_global_loaded(const char *object_type)
 			check_thread = AST_PTHREADT_NULL;
 			ast_debug(3, "Interval = 0, shutting thread down\n");
 		}
+		/* Nothing would write them anymore */
+		registrar_refresh_write_all(NULL);
 	}
 }
 
@@ -1426,12 +1605,22 @@ static int load_module(void)
 	/* As of pjproject 2.4.5, PJSIP_MAX_URL_SIZE isn't exposed yet but we try anyway. */
 	ast_pjproject_get_buildopt("PJSIP_MAX_URL_SIZE", "%d", &pjsip_max_url_size);
 
+	pending_refreshes = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, 257,
+		registrar_refresh_hash_fn, NULL, registrar_refresh_cmp_fn);
+	if (!pending_refreshes) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	if (ast_sip_register_service(&registrar_module)) {
+		ao2_cleanup(pending_refreshes);
+		pending_refreshes = NULL;
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
 	if (pjsip_endpt_add_capability(ast_sip_get_pjsip_endpoint(), NULL, PJSIP_H_ALLOW, NULL, 1, &STR_REGISTER) != PJ_SUCCESS) {
 		ast_sip_unregister_service(&registrar_module);
+		ao2_cleanup(pending_refreshes);
+		pending_refreshes = NULL;
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
@@ -1462,6 +1651,11 @@ static int unload_module(void)
 	ast_manager_unregister(AMI_SHOW_REGISTRATION_CONTACT_STATUSES);
 	ast_sip_unregister_service(&registrar_module);
 	ast_sip_transport_monitor_unregister_all(register_contact_transport_shutdown_cb, NULL, NULL);
+
+	/* No more REGISTERs are handled, so write what they refreshed */
+	registrar_refresh_write_all(NULL);
+	ao2_cleanup(pending_refreshes);
+	pending_refreshes = NULL;
 	return 0;
 }
 
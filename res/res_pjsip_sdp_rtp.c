@@ -68,6 +68,28 @@ static struct ast_sockaddr address_rtp;
 static const char STR_AUDIO[] = "audio";
 static const char STR_VIDEO[] = "video";
 
+/*! \brief The most formats kept in fmtp_formats */
+#define FMTP_FORMATS_MAX 256
+
+/*! \brief A format parsed from the parameters of an fmtp attribute */
+struct fmtp_format {
+	/*! The parsed format */
+	struct ast_format *format;
+	/*! The name of the format the parameters were parsed for, a space and the parameters */
+	char key[0];
+};
+
+/*!
+ * \brief Formats parsed from fmtp attributes
+ *
+ * Offers from the same peers carry the same fmtp parameters over and over,
+ * so formats, which are immutable, are parsed once and then shared.
+ */
+static struct ao2_container *fmtp_formats;
+
+AO2_STRING_FIELD_HASH_FN(fmtp_format, key);
+AO2_STRING_FIELD_CMP_FN(fmtp_format, key);
+
 static int send_keepalive(const void *data)
 {
 	struct ast_sip_session_media *session_media = (struct ast_sip_session_media *) data;
@@ -309,6 +331,54 @@ static int create_rtp(struct ast_sip_session *session, struct ast_sip_session_me
 	return 0;
 }
 
+static void fmtp_format_destructor(void *obj)
+{
+	struct fmtp_format *entry = obj;
+
+	ao2_cleanup(entry->format);
+}
+
+/*!
+ * \brief Parse the parameters of an fmtp attribute for a format
+ *
+ * Works like ast_format_parse_sdp_fmtp(), except that the format parsed from
+ * the same parameters before is returned if there is one.
+ *
+ * \return The parsed format, which must be unreferenced, or NULL on failure
+ */
+static struct ast_format *parse_sdp_fmtp(struct ast_format *format, const char *fmt_param)
+{
+	const char *name = ast_format_get_name(format);
+	char key[strlen(name) + strlen(fmt_param) + 2];
+	struct fmtp_format *entry;
+	struct ast_format *parsed;
+
+	sprintf(key, "%s %s", name, fmt_param); /* Safe */
+
+	entry = ao2_find(fmtp_formats, key, OBJ_SEARCH_KEY);
+	if (entry) {
+		parsed = ao2_bump(entry->format);
+		ao2_ref(entry, -1);
+		return parsed;
+	}
+
+	parsed = ast_format_parse_sdp_fmtp(format, fmt_param);
+	if (!parsed || ao2_container_count(fmtp_formats) >= FMTP_FORMATS_MAX) {
+		return parsed;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(key) + 1, fmtp_format_destructor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (entry) {
+		strcpy(entry->key, key); /* Safe */
+		entry->format = ao2_bump(parsed);
+		ao2_link(fmtp_formats, entry);
+		ao2_ref(entry, -1);
+	}
+
+	return parsed;
+}
+
 static void get_codecs(struct ast_sip_session *session, const struct pjmedia_sdp_media *stream, struct ast_rtp_codecs *codecs,
 	struct ast_sip_session_media *session_media, struct ast_format_cap *astformats)
 {
@@ -366,7 +436,7 @@ static void get_codecs(struct ast_sip_session *session, const struct pjmedia_sdp
 
 				ast_copy_pj_str(fmt_param, &fmtp.fmt_param, sizeof(fmt_param));
 
-				format_parsed = ast_format_parse_sdp_fmtp(format, fmt_param);
+				format_parsed = parse_sdp_fmtp(format, fmt_param);
 				if (format_parsed) {
 					ast_rtp_codecs_payload_replace_format(codecs, num, format_parsed);
 					ao2_ref(format_parsed, -1);
@@ -2453,6 +2523,9 @@ static int unload_module(void)
 		ast_sched_context_destroy(sched);
 	}
 
+	ao2_cleanup(fmtp_formats);
+	fmtp_formats = NULL;
+
 	return 0;
 }
 
@@ -2484,6 +2557,13 @@ static int load_module(void)
 		goto end;
 	}
 
+	fmtp_formats = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0, 61,
+		fmtp_format_hash_fn, NULL, fmtp_format_cmp_fn);
+	if (!fmtp_formats) {
+		ast_log(LOG_ERROR, "Unable to create container for parsed formats.\n");
+		goto end;
+	}
+
 	if (ast_sip_session_register_sdp_handler(&audio_sdp_handler, STR_AUDIO)) {
 		ast_log(LOG_ERROR, "Unable to register SDP handler for %s stream type\n", STR_AUDIO);
 		goto end;
@@ -3014,7 +3014,8 @@ struct ast_sip_session *ast_sip_session_alloc(struct ast_sip_endpoint *endpoint,
 	struct ast_sip_session *ret_session;
 	int dsp_features = 0;
 
-	session = ao2_alloc(sizeof(*session), session_destructor);
+	session = ao2_alloc_options(sizeof(*session), session_destructor,
+		AO2_ALLOC_OPT_LOCK_MUTEX | AO2_ALLOC_OPT_LOCK_ADAPTIVE);
 	if (!session) {
 		return NULL;
 	}
@@ -3070,6 +3071,9 @@ struct ast_sip_session *ast_sip_session_alloc(struct ast_sip_endpoint *endpoint,
 		 * sequencing problems.
 		 */
 		session->serializer = ast_sip_get_distributor_serializer(rdata);
+	} else if (ast_sip_get_pool_outbound_session_serializers()) {
+		session->serializer = ast_sip_get_distributor_serializer_by_call_id(
+			&inv_session->dlg->call_id->id);
 	} else {
 		char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
 
@@ -29,6 +29,12 @@
 
 #include "asterisk.h"
 
+#ifdef __linux__
+/*! \brief WebSocket connections are read by a few shared event loops */
+#define USE_WS_LOOPS
+#include <sys/epoll.h>
+#endif
+
 #include <pjsip.h>
 #include <pjsip_ua.h>
 
@@ -371,13 +377,297 @@ static struct ast_taskprocessor *create_websocket_serializer(void)
 	return ast_sip_create_serializer(tps_name);
 }
 
+/*!
+ * \brief Read a WebSocket connection on the thread that accepted it, until it closes
+ */
+static void websocket_read_loop(struct ast_websocket *session, struct ast_taskprocessor *serializer,
+	struct ws_transport *transport)
+{
+	struct transport_read_data read_data;
+
+	read_data.transport = transport;
+
+	pjsip_transport_add_ref(&transport->transport);
+	while (ast_websocket_wait_for_input(session, -1) > 0) {
+		enum ast_websocket_opcode opcode;
+		int fragmented;
+
+		if (ast_websocket_read(session, &read_data.payload, &read_data.payload_len, &opcode, &fragmented)) {
+			break;
+		}
+
+		if (opcode == AST_WEBSOCKET_OPCODE_TEXT || opcode == AST_WEBSOCKET_OPCODE_BINARY) {
+			if (read_data.payload_len) {
+				ast_sip_push_task_wait_serializer(serializer, transport_read, &read_data);
+			}
+		} else if (opcode == AST_WEBSOCKET_OPCODE_CLOSE) {
+			break;
+		}
+	}
+	pjsip_transport_dec_ref(&transport->transport);
+
+	ast_sip_push_task_wait_serializer(serializer, transport_shutdown, transport);
+}
+
+#ifdef USE_WS_LOOPS
+/*! \brief How many event loops read WebSocket connections */
+#define WS_LOOPS 4
+/*! \brief How many events an event loop handles per wait */
+#define WS_LOOP_EVENTS 64
+/*! \brief How often, in milliseconds, an event loop checks whether it should stop */
+#define WS_LOOP_POLL_MS 500
+
+/*!
+ * \brief An event loop reading WebSocket connections
+ */
+struct ws_loop {
+	/*! \brief The epoll instance the connections are registered with */
+	int epfd;
+	/*! \brief Set when the loop should stop */
+	int stop;
+	/*! \brief The thread running the loop */
+	pthread_t thread;
+};
+
+/*!
+ * \brief A WebSocket connection read by an event loop
+ */
+struct ws_connection {
+	struct ast_websocket *session;
+	struct ast_taskprocessor *serializer;
+	struct ws_transport *transport;
+	/*! \brief The loop reading the connection */
+	struct ws_loop *loop;
+};
+
+static struct ws_loop ws_loops[WS_LOOPS];
+/*! \brief How many of the event loops are running */
+static int ws_loops_running;
+/*! \brief Used to spread connections over the event loops */
+static unsigned int ws_loop_next;
+/*! \brief The connections read by the event loops, each holding a reference */
+static struct ao2_container *ws_connections;
+
+static void ws_connection_dtor(void *obj)
+{
+	struct ws_connection *conn = obj;
+
+	pjsip_transport_dec_ref(&conn->transport->transport);
+
+	ast_sip_push_task_wait_serializer(conn->serializer, transport_shutdown, conn->transport);
+
+	ast_taskprocessor_unreference(conn->serializer);
+	ast_websocket_unref(conn->session);
+}
+
+/*!
+ * \brief Stop reading a connection, shutting down its transport
+ *
+ * \note Only called by the loop reading the connection, or once the loops have stopped.
+ */
+static void ws_connection_close(struct ws_connection *conn)
+{
+	epoll_ctl(conn->loop->epfd, EPOLL_CTL_DEL, ast_websocket_fd(conn->session), NULL);
+	ao2_unlink(ws_connections, conn);
+}
+
+/*!
+ * \brief Pass WebSocket data copied by an event loop into pjsip transport manager.
+ */
+static int transport_read_copy(void *data)
+{
+	struct transport_read_data *read_data = data;
+
+	transport_read(read_data);
+	ast_free(read_data);
+
+	return 0;
+}
+
+/*!
+ * \brief Read what a connection has for us
+ *
+ * The messages read are copied and handed to the serializer of the connection,
+ * so the loop never waits on the messages being handled.
+ *
+ * \retval 0 if the connection is still open
+ * \retval -1 if it closed
+ */
+static int ws_connection_read(struct ws_connection *conn)
+{
+	do {
+		struct transport_read_data *read_data;
+		enum ast_websocket_opcode opcode;
+		char *payload;
+		uint64_t payload_len;
+		int fragmented;
+
+		if (ast_websocket_read(conn->session, &payload, &payload_len, &opcode, &fragmented)) {
+			return -1;
+		}
+
+		if (opcode == AST_WEBSOCKET_OPCODE_CLOSE) {
+			return -1;
+		}
+
+		if ((opcode != AST_WEBSOCKET_OPCODE_TEXT && opcode != AST_WEBSOCKET_OPCODE_BINARY)
+			|| !payload_len) {
+			continue;
+		}
+
+		read_data = ast_malloc(sizeof(*read_data) + payload_len);
+		if (!read_data) {
+			continue;
+		}
+		read_data->transport = conn->transport;
+		read_data->payload = (char *) (read_data + 1);
+		read_data->payload_len = payload_len;
+		memcpy(read_data->payload, payload, payload_len);
+
+		/* The transport outlives this, its shutdown is queued behind it */
+		if (ast_sip_push_task(conn->serializer, transport_read_copy, read_data)) {
+			ast_free(read_data);
+		}
+		/* TLS may have decrypted more than the message read, which epoll cannot see */
+	} while (ast_websocket_wait_for_input(conn->session, 0) > 0);
+
+	return 0;
+}
+
+static void *ws_loop_thread(void *data)
+{
+	struct ws_loop *loop = data;
+	struct epoll_event events[WS_LOOP_EVENTS];
+
+	while (!loop->stop) {
+		int count;
+		int i;
+
+		count = epoll_wait(loop->epfd, events, ARRAY_LEN(events), WS_LOOP_POLL_MS);
+		for (i = 0; i < count; i++) {
+			struct ws_connection *conn = events[i].data.ptr;
+
+			if (ws_connection_read(conn)) {
+				ws_connection_close(conn);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \brief Hand a new connection to an event loop
+ *
+ * \retval 0 if an event loop reads the connection from now on
+ * \retval -1 if it must be read the old way
+ */
+static int ws_connection_start(struct ast_websocket *session, struct ast_taskprocessor *serializer,
+	struct ws_transport *transport)
+{
+	struct ws_connection *conn;
+	struct epoll_event event = { .events = EPOLLIN, };
+
+	if (!ws_loops_running) {
+		return -1;
+	}
+
+	conn = ao2_alloc_options(sizeof(*conn), ws_connection_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!conn) {
+		return -1;
+	}
+
+	conn->session = session;
+	ast_websocket_ref(session);
+	conn->serializer = serializer;
+	ao2_bump(serializer);
+	conn->transport = transport;
+	pjsip_transport_add_ref(&transport->transport);
+	conn->loop = &ws_loops[ast_atomic_fetch_add(&ws_loop_next, 1, __ATOMIC_RELAXED) % ws_loops_running];
+
+	ao2_link(ws_connections, conn);
+
+	event.data.ptr = conn;
+	if (epoll_ctl(conn->loop->epfd, EPOLL_CTL_ADD, ast_websocket_fd(session), &event)) {
+		ast_log(LOG_WARNING, "Could not add WebSocket connection to an event loop: %s\n",
+			strerror(errno));
+		/* Unlinking shuts the transport down, so there is nothing left to read */
+		ao2_unlink(ws_connections, conn);
+	}
+	/* The loop may already have closed the connection, taking the reference of the container */
+	ao2_ref(conn, -1);
+
+	return 0;
+}
+
+static void ws_loops_stop(void)
+{
+	struct ao2_iterator iter;
+	struct ws_connection *conn;
+	int i;
+
+	for (i = 0; i < ws_loops_running; i++) {
+		ws_loops[i].stop = 1;
+		pthread_join(ws_loops[i].thread, NULL);
+	}
+
+	if (ws_connections) {
+		iter = ao2_iterator_init(ws_connections, 0);
+		while ((conn = ao2_iterator_next(&iter))) {
+			ws_connection_close(conn);
+			ao2_ref(conn, -1);
+		}
+		ao2_iterator_destroy(&iter);
+		ao2_ref(ws_connections, -1);
+		ws_connections = NULL;
+	}
+
+	for (i = 0; i < ws_loops_running; i++) {
+		close(ws_loops[i].epfd);
+	}
+	ws_loops_running = 0;
+}
+
+/*!
+ * \brief Start the event loops
+ *
+ * Connections are read the old way, by the thread that accepted them, if none can be started.
+ */
+static void ws_loops_start(void)
+{
+	int i;
+
+	ws_connections = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX, 0, NULL, NULL);
+	if (!ws_connections) {
+		return;
+	}
+
+	for (i = 0; i < WS_LOOPS; i++) {
+		struct ws_loop *loop = &ws_loops[i];
+
+		loop->stop = 0;
+		loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+		if (loop->epfd < 0) {
+			break;
+		}
+		if (ast_pthread_create_background(&loop->thread, NULL, ws_loop_thread, loop)) {
+			close(loop->epfd);
+			break;
+		}
+		ws_loops_running++;
+	}
+
+	if (!ws_loops_running) {
+		ast_log(LOG_WARNING, "Could not start WebSocket event loops, each connection will be read by its own thread.\n");
+	}
+}
+#endif
+
 /*! \brief WebSocket connection handler. */
 static void websocket_cb(struct ast_websocket *session, struct ast_variable *parameters, struct ast_variable *headers)
 {
 	struct ast_taskprocessor *serializer;
 	struct transport_create_data create_data;
-	struct ws_transport *transport;
-	struct transport_read_data read_data;
 
 	if (ast_websocket_set_nonblock(session)) {
 		ast_websocket_unref(session);
@@ -404,29 +694,16 @@ static void websocket_cb(struct ast_websocket *session, struct ast_variable *par
 		return;
 	}
 
-	transport = create_data.transport;
-	read_data.transport = transport;
-
-	pjsip_transport_add_ref(&transport->transport);
-	while (ast_websocket_wait_for_input(session, -1) > 0) {
-		enum ast_websocket_opcode opcode;
-		int fragmented;
-
-		if (ast_websocket_read(session, &read_data.payload, &read_data.payload_len, &opcode, &fragmented)) {
-			break;
-		}
-
-		if (opcode == AST_WEBSOCKET_OPCODE_TEXT || opcode == AST_WEBSOCKET_OPCODE_BINARY) {
-			if (read_data.payload_len) {
-				ast_sip_push_task_wait_serializer(serializer, transport_read, &read_data);
-			}
-		} else if (opcode == AST_WEBSOCKET_OPCODE_CLOSE) {
-			break;
-		}
+#ifdef USE_WS_LOOPS
+	if (!ws_connection_start(session, serializer, create_data.transport)) {
+		/* An event loop reads the connection from now on */
+		ast_taskprocessor_unreference(serializer);
+		ast_websocket_unref(session);
+		return;
 	}
-	pjsip_transport_dec_ref(&transport->transport);
+#endif
 
-	ast_sip_push_task_wait_serializer(serializer, transport_shutdown, transport);
+	websocket_read_loop(session, serializer, create_data.transport);
 
 	ast_taskprocessor_unreference(serializer);
 	ast_websocket_unref(session);
@@ -555,7 +832,14 @@ static int load_module(void)
 
 	ast_sip_session_register_supplement(&websocket_supplement);
 
+#ifdef USE_WS_LOOPS
+	ws_loops_start();
+#endif
+
 	if (ast_websocket_add_protocol("sip", websocket_cb)) {
+#ifdef USE_WS_LOOPS
+		ws_loops_stop();
+#endif
 		ast_sip_session_unregister_supplement(&websocket_supplement);
 		ast_sip_unregister_service(&websocket_module);
 		return AST_MODULE_LOAD_DECLINE;
@@ -569,6 +853,9 @@ static int unload_module(void)
 	ast_sip_unregister_service(&websocket_module);
 	ast_sip_session_unregister_supplement(&websocket_supplement);
 	ast_websocket_remove_protocol("sip", websocket_cb);
+#ifdef USE_WS_LOOPS
+	ws_loops_stop();
+#endif
 
 	return 0;
 }
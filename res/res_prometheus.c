@@ -74,6 +74,23 @@
 						</enumlist>
 					</description>
 				</configOption>
+				<configOption name="min_refresh_interval" default="0">
+					<synopsis>How long, in milliseconds, to reuse the metrics of each provider.</synopsis>
+					<description>
+						<para>
+						When set, what each provider of metrics (channels, endpoints,
+						bridges and so on) outputs is kept and reused by scrapes until it
+						is this many milliseconds old. On systems with a lot of channels
+						this bounds how often they are all walked, however many
+						Prometheus servers scrape Asterisk or however often they do it.
+						Metrics that are registered rather than provided are always
+						current.
+						</para>
+						<para>
+						A value of 0 disables this, so every scrape is current.
+						</para>
+					</description>
+				</configOption>
 				<configOption name="uri" default="metrics">
 					<synopsis>The HTTP URI to serve metrics up on.</synopsis>
 				</configOption>
@@ -138,12 +155,38 @@ AST_MUTEX_DEFINE_STATIC(scrape_lock);
 
 AST_VECTOR(, struct prometheus_metric *) metrics;
 
-AST_VECTOR(, struct prometheus_callback *) callbacks;
+/*! \brief A registered callback, with what it last output if that is being reused */
+struct scrape_callback {
+	struct prometheus_callback *callback;
+	/*! \brief What the callback output the last time it was called */
+	struct ast_str *cache;
+	/*! \brief When the callback was last called */
+	struct timeval cached;
+};
+
+AST_VECTOR(, struct scrape_callback) callbacks;
 
 AST_VECTOR(, const struct prometheus_metrics_provider *) providers;
 
 static struct timeval last_scrape;
 
+/*! \brief How much output builds up before it is sent to the Prometheus server */
+#define SCRAPE_CHUNK_SIZE 16384
+
+/*!
+ * \brief The HTTP connection of the scrape in progress, if any
+ *
+ * \note Protected by the scrape_lock
+ */
+static struct ast_tcptls_session_instance *scrape_stream;
+
+/*!
+ * \brief Whether writing to the HTTP connection of the scrape in progress failed
+ *
+ * \note Protected by the scrape_lock
+ */
+static int scrape_stream_failed;
+
 /*! \brief The actual module config */
 struct module_config {
 	/*! \brief General settings */
@@ -186,6 +229,8 @@ CONFIG_INFO_STANDARD(cfg_info, global_config, module_config_alloc,
 
 #define CORE_METRICS_SCRAPE_TIME_HELP "Total time taken to collect metrics, in milliseconds"
 
+#define CORE_METRICS_SCRAPE_DURATION_HELP "Time taken to collect and send metrics, in seconds."
+
 static void get_core_uptime_cb(struct prometheus_metric *metric)
 {
 	struct timeval now = ast_tvnow();
@@ -218,6 +263,36 @@ static struct prometheus_metric core_scrape_metric =
 		CORE_METRICS_SCRAPE_TIME_HELP,
 		NULL);
 
+static const double core_scrape_duration_bounds[] = {
+	0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10,
+};
+
+static uint64_t core_scrape_duration_counts[ARRAY_LEN(core_scrape_duration_bounds) + 1];
+
+static struct prometheus_histogram core_scrape_duration_histogram = {
+	.bucket_count = ARRAY_LEN(core_scrape_duration_bounds),
+	.bounds = core_scrape_duration_bounds,
+	.counts = core_scrape_duration_counts,
+};
+
+/*!
+ * \brief The scrape duration histogram
+ *
+ * \details
+ * Like \c core_scrape_metric this is never registered. Each scrape
+ * outputs the scrapes before it, as it can not know how long it will
+ * take itself until it has been sent.
+ */
+static struct prometheus_metric core_scrape_duration_metric = {
+	.type = PROMETHEUS_METRIC_HISTOGRAM,
+	.allocation_strategy = PROMETHEUS_METRIC_ALLOCD,
+	.lock = AST_MUTEX_INIT_VALUE,
+	.name = "asterisk_core_scrape_duration_seconds",
+	.help = CORE_METRICS_SCRAPE_DURATION_HELP,
+	.histogram = &core_scrape_duration_histogram,
+	.children = AST_LIST_HEAD_NOLOCK_INIT_VALUE,
+};
+
 #define METRIC_CORE_PROPS_ARRAY_INDEX 0
 /*!
  * \brief Core metrics to scrape
@@ -462,6 +537,52 @@ struct prometheus_metric *prometheus_counter_create(const char *name, const char
 	return metric;
 }
 
+struct prometheus_metric *prometheus_histogram_create(const char *name, const char *help,
+	const double *bounds, size_t bucket_count)
+{
+	struct prometheus_metric *metric;
+	struct prometheus_histogram *histogram;
+
+	/* The histogram and its counts live in the same allocation as the metric */
+	metric = ast_calloc(1, sizeof(*metric) + sizeof(*histogram)
+		+ (bucket_count + 1) * sizeof(*histogram->counts));
+	if (!metric) {
+		return NULL;
+	}
+	metric->allocation_strategy = PROMETHEUS_METRIC_MALLOCD;
+	ast_mutex_init(&metric->lock);
+
+	ast_copy_string(metric->name, name, sizeof(metric->name));
+	metric->help = help;
+	metric->type = PROMETHEUS_METRIC_HISTOGRAM;
+
+	histogram = (struct prometheus_histogram *) (metric + 1);
+	histogram->bucket_count = bucket_count;
+	histogram->bounds = bounds;
+	histogram->counts = (uint64_t *) (histogram + 1);
+	metric->histogram = histogram;
+
+	return metric;
+}
+
+void prometheus_histogram_observe(struct prometheus_metric *metric, double value)
+{
+	struct prometheus_histogram *histogram = metric->histogram;
+	size_t i;
+
+	ast_assert(metric->type == PROMETHEUS_METRIC_HISTOGRAM && histogram != NULL);
+
+	ast_mutex_lock(&metric->lock);
+	for (i = 0; i < histogram->bucket_count; i++) {
+		if (value <= histogram->bounds[i]) {
+			break;
+		}
+	}
+	histogram->counts[i]++;
+	histogram->sum += value;
+	ast_mutex_unlock(&metric->lock);
+}
+
 static const char *prometheus_metric_type_to_string(enum prometheus_metric_type type)
 {
 	switch (type) {
@@ -469,6 +590,8 @@ static const char *prometheus_metric_type_to_string(enum prometheus_metric_type
 		return "counter";
 	case PROMETHEUS_METRIC_GAUGE:
 		return "gauge";
+	case PROMETHEUS_METRIC_HISTOGRAM:
+		return "histogram";
 	default:
 		ast_assert(0);
 		return "unknown";
@@ -477,18 +600,20 @@ static const char *prometheus_metric_type_to_string(enum prometheus_metric_type
 
 /*!
  * \internal
- * \brief Render a metric to text
+ * \brief Render the name and labels of a metric to text
  *
  * \param metric The metric to render
+ * \param suffix Appended to the name, for the series of histograms
+ * \param le The upper bound label of a histogram bucket, or NULL
  * \param output The string buffer to append the text to
  */
-static void prometheus_metric_full_to_string(struct prometheus_metric *metric,
-	struct ast_str **output)
+static void prometheus_metric_series_to_string(struct prometheus_metric *metric,
+	const char *suffix, const char *le, struct ast_str **output)
 {
 	int i;
 	int labels_exist = 0;
 
-	ast_str_append(output, 0, "%s", metric->name);
+	ast_str_append(output, 0, "%s%s", metric->name, suffix);
 
 	for (i = 0; i < PROMETHEUS_MAX_LABELS; i++) {
 		if (!ast_strlen_zero(metric->labels[i].name)) {
@@ -504,9 +629,61 @@ static void prometheus_metric_full_to_string(struct prometheus_metric *metric,
 		}
 	}
 
+	if (le) {
+		ast_str_append(output, 0, "%sle=\"%s\"", labels_exist ? "," : "{", le);
+		labels_exist = 1;
+	}
+
 	if (labels_exist) {
 		ast_str_append(output, 0, "%s", "}");
 	}
+}
+
+/*!
+ * \internal
+ * \brief Render the buckets, sum and count of a histogram to text
+ *
+ * \param metric The histogram to render
+ * \param output The string buffer to append the text to
+ */
+static void prometheus_histogram_to_string(struct prometheus_metric *metric,
+	struct ast_str **output)
+{
+	struct prometheus_histogram *histogram = metric->histogram;
+	uint64_t count = 0;
+	char le[32];
+	size_t i;
+
+	if (!histogram) {
+		return;
+	}
+
+	/* Buckets count everything at or below their bound, not just what fell into them */
+	for (i = 0; i < histogram->bucket_count; i++) {
+		count += histogram->counts[i];
+		snprintf(le, sizeof(le), "%.15g", histogram->bounds[i]);
+		prometheus_metric_series_to_string(metric, "_bucket", le, output);
+		ast_str_append(output, 0, " %" PRIu64 "\n", count);
+	}
+	count += histogram->counts[i];
+	prometheus_metric_series_to_string(metric, "_bucket", "+Inf", output);
+	ast_str_append(output, 0, " %" PRIu64 "\n", count);
+
+	prometheus_metric_series_to_string(metric, "_sum", NULL, output);
+	ast_str_append(output, 0, " %.15g\n", histogram->sum);
+	prometheus_metric_series_to_string(metric, "_count", NULL, output);
+	ast_str_append(output, 0, " %" PRIu64 "\n", count);
+}
+
+void prometheus_metric_sample_to_string(struct prometheus_metric *metric,
+	struct ast_str **output)
+{
+	if (metric->type == PROMETHEUS_METRIC_HISTOGRAM) {
+		prometheus_histogram_to_string(metric, output);
+		return;
+	}
+
+	prometheus_metric_series_to_string(metric, "", NULL, output);
 
 	/*
 	 * If no value exists, put in a 0. That ensures we don't anger Prometheus.
@@ -526,21 +703,22 @@ void prometheus_metric_to_string(struct prometheus_metric *metric,
 	ast_str_append(output, 0, "# HELP %s %s\n", metric->name, metric->help);
 	ast_str_append(output, 0, "# TYPE %s %s\n", metric->name,
 		prometheus_metric_type_to_string(metric->type));
-	prometheus_metric_full_to_string(metric, output);
+	prometheus_metric_sample_to_string(metric, output);
 	AST_LIST_TRAVERSE(&metric->children, child, entry) {
-		prometheus_metric_full_to_string(child, output);
+		prometheus_metric_sample_to_string(child, output);
 	}
 }
 
 int prometheus_callback_register(struct prometheus_callback *callback)
 {
 	SCOPED_MUTEX(lock, &scrape_lock);
+	struct scrape_callback entry = { .callback = callback, };
 
 	if (!callback || !callback->callback_fn || ast_strlen_zero(callback->name)) {
 		return -1;
 	}
 
-	AST_VECTOR_APPEND(&callbacks, callback);
+	AST_VECTOR_APPEND(&callbacks, entry);
 
 	return 0;
 }
@@ -551,27 +729,116 @@ void prometheus_callback_unregister(struct prometheus_callback *callback)
 	int i;
 
 	for (i = 0; i < AST_VECTOR_SIZE(&callbacks); i++) {
-		struct prometheus_callback *entry = AST_VECTOR_GET(&callbacks, i);
+		struct scrape_callback *entry = AST_VECTOR_GET_ADDR(&callbacks, i);
 
-		if (!strcmp(callback->name, entry->name)) {
+		if (!strcmp(callback->name, entry->callback->name)) {
+			ast_free(entry->cache);
 			AST_VECTOR_REMOVE(&callbacks, i, 1);
 			return;
 		}
 	}
 }
 
-static void scrape_metrics(struct ast_str **response)
+/*!
+ * \internal
+ * \brief Forget what every callback output, so they are all called by the next scrape
+ *
+ * \pre scrape_lock is held
+ */
+static void scrape_callbacks_cache_clear(void)
 {
 	int i;
 
 	for (i = 0; i < AST_VECTOR_SIZE(&callbacks); i++) {
-		struct prometheus_callback *callback = AST_VECTOR_GET(&callbacks, i);
+		struct scrape_callback *entry = AST_VECTOR_GET_ADDR(&callbacks, i);
 
-		if (!callback) {
-			continue;
+		ast_free(entry->cache);
+		entry->cache = NULL;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Send the output of a scrape to the Prometheus server
+ *
+ * Once writing fails the output is thrown away, so that it does not build
+ * up for the rest of the scrape.
+ *
+ * \pre scrape_lock is held and a scrape is being streamed
+ */
+static void scrape_stream_write(const char *data, size_t len)
+{
+	if (!scrape_stream_failed && ast_http_send_chunk(scrape_stream, data, len)) {
+		scrape_stream_failed = 1;
+	}
+}
+
+void prometheus_callback_output_flush(struct ast_str **output)
+{
+	/* The scrape_lock is held by whatever is calling the callback */
+	if (!scrape_stream || ast_str_strlen(*output) < SCRAPE_CHUNK_SIZE) {
+		return;
+	}
+
+	scrape_stream_write(ast_str_buffer(*output), ast_str_strlen(*output));
+	ast_str_reset(*output);
+}
+
+/*!
+ * \internal
+ * \brief Output what a callback output, calling it again first if it is too old
+ *
+ * \pre scrape_lock is held
+ */
+static void scrape_callback_cached(struct scrape_callback *entry, unsigned int min_refresh_interval,
+	struct timeval now, struct ast_str **response)
+{
+	if (!entry->cache || ast_tvdiff_ms(now, entry->cached) >= min_refresh_interval) {
+		struct ast_tcptls_session_instance *stream = scrape_stream;
+
+		if (!entry->cache) {
+			entry->cache = ast_str_create(512);
+			if (!entry->cache) {
+				entry->callback->callback_fn(response);
+				return;
+			}
+		} else {
+			ast_str_reset(entry->cache);
 		}
 
-		callback->callback_fn(response);
+		/* Everything the callback outputs has to be kept, so none of it can be sent early */
+		scrape_stream = NULL;
+		entry->callback->callback_fn(&entry->cache);
+		scrape_stream = stream;
+		entry->cached = now;
+	}
+
+	if (scrape_stream) {
+		/* Send it straight from the cache rather than copying it */
+		scrape_stream_write(ast_str_buffer(*response), ast_str_strlen(*response));
+		ast_str_reset(*response);
+		scrape_stream_write(ast_str_buffer(entry->cache), ast_str_strlen(entry->cache));
+	} else {
+		ast_str_append(response, 0, "%s", ast_str_buffer(entry->cache));
+	}
+}
+
+static void scrape_metrics(struct ast_str **response)
+{
+	RAII_VAR(struct module_config *, mod_cfg, ao2_global_obj_ref(global_config), ao2_cleanup);
+	unsigned int min_refresh_interval = mod_cfg ? mod_cfg->general->min_refresh_interval : 0;
+	struct timeval now = ast_tvnow();
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&callbacks); i++) {
+		struct scrape_callback *entry = AST_VECTOR_GET_ADDR(&callbacks, i);
+
+		if (min_refresh_interval) {
+			scrape_callback_cached(entry, min_refresh_interval, now, response);
+		} else {
+			entry->callback->callback_fn(response);
+		}
+		prometheus_callback_output_flush(response);
 	}
 
 	for (i = 0; i < AST_VECTOR_SIZE(&metrics); i++) {
@@ -587,6 +854,7 @@ static void scrape_metrics(struct ast_str **response)
 		}
 		prometheus_metric_to_string(metric, response);
 		ast_mutex_unlock(&metric->lock);
+		prometheus_callback_output_flush(response);
 	}
 }
 
@@ -636,6 +904,16 @@ static int http_callback(struct ast_tcptls_session_instance *ser,
 
 	ast_mutex_lock(&scrape_lock);
 
+	if (ast_http_send_chunked_start(ser, method, 200, "OK", NULL, 0)) {
+		ast_mutex_unlock(&scrape_lock);
+		ast_free(response);
+		return 0;
+	}
+
+	/* What is output is sent as it builds up, rather than all at once at the end */
+	scrape_stream = ser;
+	scrape_stream_failed = 0;
+
 	last_scrape = start;
 	scrape_metrics(&response);
 
@@ -649,10 +927,23 @@ static int http_callback(struct ast_tcptls_session_instance *ser,
 			"%" PRIu64,
 			duration);
 		prometheus_metric_to_string(&core_scrape_metric, &response);
+
+		ast_mutex_lock(&core_scrape_duration_metric.lock);
+		prometheus_metric_to_string(&core_scrape_duration_metric, &response);
+		ast_mutex_unlock(&core_scrape_duration_metric.lock);
+	}
+
+	scrape_stream_write(ast_str_buffer(response), ast_str_strlen(response));
+	scrape_stream = NULL;
+	ast_http_send_chunked_end(ser);
+
+	if (mod_cfg->general->core_metrics_enabled) {
+		prometheus_histogram_observe(&core_scrape_duration_metric,
+			ast_tvdiff_us(ast_tvnow(), start) / 1000000.0);
 	}
 	ast_mutex_unlock(&scrape_lock);
 
-	ast_http_send(ser, method, 200, "OK", NULL, response, 0, 0);
+	ast_free(response);
 
 	return 0;
 
@@ -897,6 +1188,7 @@ static int unload_module(void)
 	}
 	AST_VECTOR_FREE(&metrics);
 
+	scrape_callbacks_cache_clear();
 	AST_VECTOR_FREE(&callbacks);
 
 	AST_VECTOR_FREE(&providers);
@@ -917,6 +1209,9 @@ static int reload_module(void) {
 		return -1;
 	}
 
+	/* What the callbacks output may have been made with the old config */
+	scrape_callbacks_cache_clear();
+
 	/* Our config should be all reloaded now */
 	general_config = prometheus_general_config_get();
 	for (i = 0; i < AST_VECTOR_SIZE(&providers); i++) {
@@ -963,6 +1258,7 @@ static int load_module(void)
 	}
 	aco_option_register(&cfg_info, "enabled", ACO_EXACT, global_options, "no", OPT_BOOL_T, 1, FLDSET(struct prometheus_general_config, enabled));
 	aco_option_register(&cfg_info, "core_metrics_enabled", ACO_EXACT, global_options, "yes", OPT_BOOL_T, 1, FLDSET(struct prometheus_general_config, core_metrics_enabled));
+	aco_option_register(&cfg_info, "min_refresh_interval", ACO_EXACT, global_options, "0", OPT_UINT_T, 0, FLDSET(struct prometheus_general_config, min_refresh_interval));
 	aco_option_register(&cfg_info, "uri", ACO_EXACT, global_options, "", OPT_STRINGFIELD_T, 1, STRFLDSET(struct prometheus_general_config, uri));
 	aco_option_register(&cfg_info, "auth_username", ACO_EXACT, global_options, "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct prometheus_general_config, auth_username));
 	aco_option_register(&cfg_info, "auth_password", ACO_EXACT, global_options, "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct prometheus_general_config, auth_password));
@@ -974,7 +1270,13 @@ static int load_module(void)
 	if (cli_init()
 		|| channel_metrics_init()
 		|| endpoint_metrics_init()
-		|| bridge_metrics_init()) {
+		|| bridge_metrics_init()
+		|| frame_metrics_init()
+		|| latency_metrics_init()
+		|| taskprocessor_metrics_init()
+		|| lock_metrics_init()
+		|| memory_metrics_init()
+		|| rtp_metrics_init()) {
 		goto cleanup;
 	}
 
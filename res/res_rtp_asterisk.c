@@ -42,6 +42,7 @@
 #include "asterisk/dns_recurring.h"
 
 #include <sys/time.h>
+#include <sys/stat.h>
 #include <signal.h>
 #include <fcntl.h>
 #include <math.h>
@@ -53,6 +54,7 @@
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include <openssl/bio.h>
+#include <openssl/rand.h>
 #if !defined(OPENSSL_NO_ECDH) && (OPENSSL_VERSION_NUMBER >= 0x10000000L)
 #include <openssl/bn.h>
 #endif
@@ -69,6 +71,7 @@
 #include <ifaddrs.h>
 #endif
 
+#include "asterisk/affinity.h"
 #include "asterisk/conversions.h"
 #include "asterisk/options.h"
 #include "asterisk/logger_category.h"
@@ -78,6 +81,7 @@
 #include "asterisk/format_cache.h"
 #include "asterisk/channel.h"
 #include "asterisk/acl.h"
+#include "asterisk/app.h"
 #include "asterisk/config.h"
 #include "asterisk/lock.h"
 #include "asterisk/utils.h"
@@ -90,6 +94,10 @@
 #include "asterisk/uuid.h"
 #include "asterisk/test.h"
 #include "asterisk/data_buffer.h"
+#include "asterisk/alertpipe.h"
+#include "asterisk/poll-compat.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/threadpool.h"
 #ifdef HAVE_PJPROJECT
 #include "asterisk/res_pjproject.h"
 #include "asterisk/security_events.h"
@@ -162,6 +170,15 @@
 #define SRTP_MASTER_KEY_LEN 16
 #define SRTP_MASTER_SALT_LEN 14
 #define SRTP_MASTER_LEN (SRTP_MASTER_KEY_LEN + SRTP_MASTER_SALT_LEN)
+#define SRTP_GCM_MASTER_SALT_LEN 12
+
+#if defined(HAVE_SRTP_GCM) && defined(ENABLE_SRTP_AES_GCM) && defined(SRTP_AEAD_AES_128_GCM)
+/*! DTLS-SRTP offers AES-GCM, a single pass over the packet instead of AES-CM and HMAC-SHA1 */
+#define USE_DTLS_SRTP_GCM
+#define DTLS_SRTP_GCM_PROFILES "SRTP_AEAD_AES_128_GCM:"
+#else
+#define DTLS_SRTP_GCM_PROFILES ""
+#endif
 
 #define RTP_DTLS_ESTABLISHED -37
 
@@ -188,9 +205,35 @@ enum strict_rtp_mode {
 
 #define DEFAULT_STRICT_RTP STRICT_RTP_YES	/*!< Enabled by default */
 #define DEFAULT_SRTP_REPLAY_PROTECTION 1
+#define DEFAULT_IO_BATCH 1
+#define DEFAULT_SHARED_SOCKETS 0
+#define MAXIMUM_SHARED_SOCKETS 64	/*!< Most sockets instances share per local address */
+#define MAXIMUM_SHARED_QUEUE 64		/*!< Most packets held for an instance on a shared socket */
+#define SHARED_SOCKET_POLL_MS 200	/*!< How often an idle shared socket thread checks whether to stop */
+#define MAXIMUM_IO_BATCH 32	/*!< Most packets moved by one system call */
+#define IO_BATCH_SLOT_SIZE 2048	/*!< Room for a packet held in a batch, enough for anything MTU sized */
+
+#ifdef MSG_WAITFORONE
+/*! recvmmsg() and sendmmsg() are available */
+#define USE_IO_BATCH
+#endif
+
+#define DEFAULT_MEDIA_WORKERS 0
+#define DEFAULT_BRIDGE_MEDIA_WORKERS 0
+#define MAXIMUM_MEDIA_WORKERS 64
+#define MAXIMUM_MEDIA_QUEUE 50		/*!< Most frames a media worker holds for an instance */
+#define MEDIA_WORKER_POLL_MS 200	/*!< How often an idle media worker checks whether to stop */
+
+#ifdef __linux__
+/*! Media workers wait on epoll */
+#define USE_MEDIA_WORKERS
+#include <sys/epoll.h>
+#endif
 #define DEFAULT_ICESUPPORT 1
 #define DEFAULT_STUN_SOFTWARE_ATTRIBUTE 1
 #define DEFAULT_DTLS_MTU 1200
+#define DEFAULT_DTLS_THREADS 0
+#define MAXIMUM_DTLS_THREADS 64
 
 /*!
  * Because both ends usually don't start sending RTP
@@ -222,8 +265,15 @@ static int strictrtp = DEFAULT_STRICT_RTP; /*!< Only accept RTP frames from a de
 static int learning_min_sequential = DEFAULT_LEARNING_MIN_SEQUENTIAL; /*!< Number of sequential RTP frames needed from a single source during learning mode to accept new source. */
 static int learning_min_duration = DEFAULT_LEARNING_MIN_DURATION; /*!< Lowest acceptable timeout between the first and the last sequential RTP frame. */
 static int srtp_replay_protection = DEFAULT_SRTP_REPLAY_PROTECTION;
+static unsigned int iobatch = DEFAULT_IO_BATCH; /*!< Packets read or sent with one system call (set in rtp.conf) */
+static unsigned int sharedsockets = DEFAULT_SHARED_SOCKETS; /*!< Sockets instances share per local address, 0 for a socket each (set in rtp.conf) */
+static unsigned int mediaworkers = DEFAULT_MEDIA_WORKERS; /*!< Threads reading RTP for instances, 0 for the channel threads (set in rtp.conf) */
+static int mediaworker_affinity; /*!< Whether each media worker is pinned to a CPU (set in rtp.conf) */
+static unsigned int bridgemediaworkers = DEFAULT_BRIDGE_MEDIA_WORKERS; /*!< Threads reading RTP for locally bridged instances only, when mediaworkers is 0 (set in rtp.conf) */
+static char relaycommand[PATH_MAX]; /*!< Command installing forwarding between locally bridged instances (set in rtp.conf) */
 #if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
 static int dtls_mtu = DEFAULT_DTLS_MTU;
+static unsigned int dtls_threads = DEFAULT_DTLS_THREADS; /*!< Threads handling DTLS packets, 0 for the channel threads (set in rtp.conf) */
 #endif
 #ifdef HAVE_PJPROJECT
 static int icesupport = DEFAULT_ICESUPPORT;
@@ -377,6 +427,158 @@ struct rtp_transport_wide_cc_statistics {
 	int schedid;
 };
 
+/*! \brief A packet held in an I/O batch */
+struct rtp_io_slot {
+	/*! The address the packet came from or is going to */
+	struct ast_sockaddr addr;
+	/*! The length of the packet */
+	size_t len;
+	/*! The packet */
+	unsigned char buf[IO_BATCH_SLOT_SIZE];
+};
+
+/*! \brief Packets moved to or from a socket with one system call */
+struct rtp_io_batch {
+	/*! The socket queued packets are to be sent on */
+	int fd;
+	/*! How many slots there are */
+	unsigned int size;
+	/*! How many slots hold a packet */
+	unsigned int count;
+	/*! The next received packet to hand out */
+	unsigned int next;
+	/*! The packets */
+	struct rtp_io_slot slot[0];
+};
+
+/*! \brief The components a shared socket carries */
+enum rtp_shared_component {
+	SHARED_RTP = 0,
+	SHARED_RTCP,
+	SHARED_COMPONENTS,
+};
+
+/*! \brief A packet read from a shared socket for an instance */
+struct rtp_shared_packet {
+	AST_LIST_ENTRY(rtp_shared_packet) next;
+	/*! The address the packet came from */
+	struct ast_sockaddr addr;
+	/*! The length of the packet */
+	size_t len;
+	/*! The packet */
+	unsigned char buf[0];
+};
+
+/*!
+ * \brief A pair of sockets, for RTP and RTCP, shared by many instances
+ *
+ * A thread reads the sockets and hands each packet to the instance it is
+ * from, found by the address the remote sends RTP from or, failing that, by
+ * its SSRC.
+ */
+struct rtp_shared_socket {
+	/*! The RTP and RTCP sockets */
+	int s[SHARED_COMPONENTS];
+	/*! The address the RTP socket is bound to */
+	struct ast_sockaddr address;
+	/*! The instances by the remote address they expect RTP from */
+	struct ao2_container *by_remote;
+	/*! The instances by the SSRC of the remote */
+	struct ao2_container *by_ssrc;
+	/*! How many instances use the sockets, protected by shared_sockets_lock */
+	unsigned int members;
+	/*! The thread reading the sockets */
+	pthread_t thread;
+	/*! Set when the thread should stop */
+	int stop;
+};
+
+/*! \brief An instance receiving from a shared socket */
+struct rtp_shared_member {
+	/*! The sockets */
+	struct rtp_shared_socket *shared;
+	/*! The address the remote is expected to send RTP from */
+	struct ast_sockaddr remote;
+	/*! The SSRC of the remote */
+	unsigned int ssrc;
+	/*! Set if the SSRC of the remote is known */
+	unsigned int ssrc_valid;
+	/*! Readable while packets are queued for the component */
+	int alert[SHARED_COMPONENTS][2];
+	/*! The packets waiting to be read */
+	AST_LIST_HEAD_NOLOCK(, rtp_shared_packet) queue[SHARED_COMPONENTS];
+	/*! How many packets are waiting */
+	unsigned int queued[SHARED_COMPONENTS];
+};
+
+/*!
+ * \brief A thread reading the RTP sockets of many instances
+ *
+ * The worker handles each packet as the channel thread would have, under the
+ * instance lock, and queues whatever frames result for the channel. Packets
+ * that need nothing from the channel, like those forwarded between locally
+ * bridged instances, never wake it.
+ */
+struct rtp_media_worker {
+	/*! The epoll set of the sockets, each registration owns a binding reference */
+	int epfd;
+	/*! The thread */
+	pthread_t thread;
+	/*! Set when the thread should stop */
+	int stop;
+	/*! Which of the workers this is */
+	unsigned int index;
+	/*! The CPU the worker is pinned to, -1 if it is not */
+	int cpu;
+	/*! How many instances use the worker, protected by media_workers_lock */
+	unsigned int bindings;
+	/*! Protects released */
+	ast_mutex_t lock;
+	/*! Bindings removed from the epoll set, released once no event can name them */
+	AST_VECTOR(, struct rtp_media_binding *) released;
+};
+
+/*!
+ * \brief How a media worker gets to an instance
+ *
+ * This is a weak proxy of the instance, so the worker can never keep an
+ * instance alive that its owner has let go of.
+ */
+struct rtp_media_binding {
+	AO2_WEAKPROXY();
+	/*! The worker reading the socket, NULL while it is not */
+	struct rtp_media_worker *worker;
+	/*! Readable while frames are queued */
+	int alert[2];
+	/*! The frames queued for the channel */
+	AST_LIST_HEAD_NOLOCK(, ast_frame) frames;
+	/*! How many frames are queued */
+	unsigned int queued;
+	/*! Set if reading the socket failed */
+	unsigned int failed;
+	/*! Set while the alert pipe is readable */
+	unsigned int alerted;
+};
+
+/*!
+ * \brief Forwarding between two locally bridged instances done outside of Asterisk
+ *
+ * The relay command installs the forwarding, typically as packet filter rules
+ * in the kernel, and removes it again. Both run on the relay taskprocessor so
+ * they happen in order without holding up the bridge.
+ */
+struct rtp_kernel_relay {
+	/*! Set once the relay command installed the forwarding, only changed by the taskprocessor */
+	unsigned int active;
+	/*! Set once removal has been queued */
+	unsigned int removed;
+	/*! The relay command */
+	const char *command;
+	/*! The addresses of both instances, quoted for the shell */
+	const char *args;
+	char buf[0];
+};
+
 typedef struct {
 	unsigned int ts;
 	unsigned char is_set;
@@ -409,6 +611,8 @@ struct ast_rtp {
 	unsigned int rxoctetcount;      /*!< How many octets have we received? should be rxcount *160*/
 	unsigned int txcount;           /*!< How many packets have we sent? */
 	unsigned int txoctetcount;      /*!< How many octets have we sent? (txcount*160)*/
+	unsigned int stats_seq;         /*!< Odd while stats_sample is being published, 0 before it ever was */
+	struct ast_rtp_instance_stats stats_sample; /*!< Statistics as of the last RTCP report sent or received */
 	unsigned int cycles;            /*!< Shifted count of sequence number cycles */
 	struct ast_format *lasttxformat;
 	struct ast_format *lastrxformat;
@@ -476,6 +680,14 @@ struct ast_rtp {
 	struct ast_data_buffer *send_buffer;		/*!< Buffer for storing sent packets for retransmission */
 	struct ast_data_buffer *recv_buffer;		/*!< Buffer for storing received packets for retransmission */
 
+	struct rtp_io_batch *rx_batch;	/*!< Packets read along with an earlier one that are still to be handled */
+	struct rtp_io_batch *tx_batch;	/*!< Packets waiting to be sent together */
+	unsigned int tx_batching;	/*!< Set while sent packets are queued on the tx batch */
+	struct rtp_shared_member *shared;	/*!< Set if we receive from a shared socket */
+	struct rtp_media_binding *media;	/*!< Set if a media worker has read for us */
+	unsigned int media_bridged;	/*!< Set if a media worker reads for us only while we are locally bridged */
+	struct rtp_kernel_relay *relay;	/*!< Set while packets between us and the bridged instance are relayed */
+
 	struct rtp_transport_wide_cc_statistics transport_wide_cc; /*!< Transport-cc statistics information */
 
 #ifdef HAVE_PJPROJECT
@@ -520,6 +732,8 @@ struct ast_rtp {
 	unsigned int rekey; /*!< Interval at which to renegotiate and rekey */
 	int rekeyid; /*!< Scheduled item id for rekeying */
 	struct dtls_details dtls; /*!< DTLS state information */
+	struct ast_taskprocessor *dtls_serializer; /*!< Handles our DTLS packets on the handshake threadpool */
+	unsigned int dtls_failed:1; /*!< Set if the handshake threadpool failed DTLS for us */
 #endif
 };
 
@@ -650,6 +864,8 @@ static void ast_rtp_update_source(struct ast_rtp_instance *instance);
 static void ast_rtp_change_source(struct ast_rtp_instance *instance);
 static int ast_rtp_write(struct ast_rtp_instance *instance, struct ast_frame *frame);
 static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtcp);
+static struct ast_frame *rtp_read(struct ast_rtp_instance *instance, int rtcp);
+static void rtp_frames_isolate(struct frame_list *frames, struct ast_frame *frame);
 static void ast_rtp_prop_set(struct ast_rtp_instance *instance, enum ast_rtp_property property, int value);
 static int ast_rtp_fd(struct ast_rtp_instance *instance, int rtcp);
 static void ast_rtp_remote_address_set(struct ast_rtp_instance *instance, struct ast_sockaddr *addr);
@@ -657,6 +873,8 @@ static int rtp_red_init(struct ast_rtp_instance *instance, int buffer_time, int
 static int rtp_red_buffer(struct ast_rtp_instance *instance, struct ast_frame *frame);
 static int ast_rtp_local_bridge(struct ast_rtp_instance *instance0, struct ast_rtp_instance *instance1);
 static int ast_rtp_get_stat(struct ast_rtp_instance *instance, struct ast_rtp_instance_stats *stats, enum ast_rtp_instance_stat stat);
+static int ast_rtp_sample_stats(struct ast_rtp_instance *instance, struct ast_rtp_instance_stats *stats);
+static void rtp_stats_publish(struct ast_rtp_instance *instance);
 static int ast_rtp_dtmf_compatible(struct ast_channel *chan0, struct ast_rtp_instance *instance0, struct ast_channel *chan1, struct ast_rtp_instance *instance1);
 static void ast_rtp_stun_request(struct ast_rtp_instance *instance, struct ast_sockaddr *suggestion, const char *username);
 static void ast_rtp_stop(struct ast_rtp_instance *instance);
@@ -692,6 +910,17 @@ static BIO_METHOD dtls_bio_methods = {
 #else
 static BIO_METHOD *dtls_bio_methods;
 #endif
+
+/*! \brief Handles DTLS packets in place of the channel threads, if configured */
+static struct ast_threadpool *dtls_threadpool;
+
+/*! \brief Certificates loaded from files, keyed by the files */
+static struct ao2_container *dtls_certificates;
+
+#ifdef SSL_CTRL_SET_TLSEXT_TICKET_KEYS
+/*! \brief Protects the session tickets of every instance, so peers can resume on any of them */
+static unsigned char dtls_ticket_keys[80];
+#endif
 #endif
 
 static int __rtp_sendto(struct ast_rtp_instance *instance, void *buf, size_t size, int flags, struct ast_sockaddr *sa, int rtcp, int *via_ice, int use_srtp);
@@ -2207,11 +2436,145 @@ static int load_dtls_certificate(struct ast_rtp_instance *instance,
 	}
 }
 
+/*!
+ * \internal
+ * \brief Produce the fingerprint of a certificate as used in SDP
+ *
+ * \retval 0 on success
+ */
+static int dtls_fingerprint(X509 *certificate, enum ast_rtp_dtls_hash hash, char *buf)
+{
+	const EVP_MD *type;
+	unsigned int size, i;
+	unsigned char fingerprint[EVP_MAX_MD_SIZE];
+
+	if (hash == AST_RTP_DTLS_HASH_SHA1) {
+		type = EVP_sha1();
+	} else if (hash == AST_RTP_DTLS_HASH_SHA256) {
+		type = EVP_sha256();
+	} else {
+		return -1;
+	}
+
+	if (!X509_digest(certificate, type, fingerprint, &size) || !size) {
+		return -1;
+	}
+
+	for (i = 0; i < size; i++) {
+		sprintf(buf, "%02hhX:", fingerprint[i]);
+		buf += 3;
+	}
+
+	*(buf - 1) = 0;
+
+	return 0;
+}
+
+/*! \brief A certificate loaded from files along with its fingerprints */
+struct dtls_certificate {
+	/*! The certificate */
+	X509 *certificate;
+	/*! Its private key */
+	EVP_PKEY *private_key;
+	/*! When the certificate file was last modified */
+	time_t certificate_mtime;
+	/*! When the private key file was last modified */
+	time_t private_key_mtime;
+	/*! The fingerprints, indexed by hash */
+	char fingerprint[AST_RTP_DTLS_HASH_SHA1 + 1][160];
+	/*! The certificate and private key files */
+	char files[0];
+};
+
+static void dtls_certificate_destructor(void *obj)
+{
+	struct dtls_certificate *cert = obj;
+
+	X509_free(cert->certificate);
+	EVP_PKEY_free(cert->private_key);
+}
+
+AO2_STRING_FIELD_HASH_FN(dtls_certificate, files);
+AO2_STRING_FIELD_CMP_FN(dtls_certificate, files);
+
+/*!
+ * \internal
+ * \brief Get the certificate of a configuration from the files, loading them only if they changed
+ *
+ * \return The certificate, or NULL if it could not be loaded
+ */
+static struct dtls_certificate *dtls_certificate_get(struct ast_rtp_instance *instance,
+	const struct ast_rtp_dtls_cfg *dtls_cfg)
+{
+	const char *private_key_file = S_OR(dtls_cfg->pvtfile, dtls_cfg->certfile);
+	struct dtls_cert_info cert_info;
+	struct dtls_certificate *cert;
+	struct stat certificate_st;
+	struct stat private_key_st;
+	char *files;
+
+	if (stat(dtls_cfg->certfile, &certificate_st) || stat(private_key_file, &private_key_st)) {
+		ast_log(LOG_ERROR, "Failed to read certificate '%s' or private key '%s': %s\n",
+			dtls_cfg->certfile, private_key_file, strerror(errno));
+		return NULL;
+	}
+
+	files = ast_alloca(strlen(dtls_cfg->certfile) + strlen(private_key_file) + 2);
+	sprintf(files, "%s:%s", dtls_cfg->certfile, private_key_file); /* Safe */
+
+	ao2_lock(dtls_certificates);
+	cert = ao2_find(dtls_certificates, files, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (cert && cert->certificate_mtime == certificate_st.st_mtime
+		&& cert->private_key_mtime == private_key_st.st_mtime) {
+		ao2_unlock(dtls_certificates);
+		return cert;
+	}
+	if (cert) {
+		ao2_unlink_flags(dtls_certificates, cert, OBJ_NOLOCK);
+		ao2_ref(cert, -1);
+	}
+
+	if (create_certificate_from_file(instance, dtls_cfg, &cert_info)) {
+		ao2_unlock(dtls_certificates);
+		return NULL;
+	}
+
+	cert = ao2_alloc_options(sizeof(*cert) + strlen(files) + 1, dtls_certificate_destructor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!cert) {
+		ao2_unlock(dtls_certificates);
+		X509_free(cert_info.certificate);
+		EVP_PKEY_free(cert_info.private_key);
+		return NULL;
+	}
+	cert->certificate = cert_info.certificate;
+	cert->private_key = cert_info.private_key;
+	cert->certificate_mtime = certificate_st.st_mtime;
+	cert->private_key_mtime = private_key_st.st_mtime;
+	strcpy(cert->files, files); /* Safe */
+
+	if (dtls_fingerprint(cert->certificate, AST_RTP_DTLS_HASH_SHA1, cert->fingerprint[AST_RTP_DTLS_HASH_SHA1])
+		|| dtls_fingerprint(cert->certificate, AST_RTP_DTLS_HASH_SHA256, cert->fingerprint[AST_RTP_DTLS_HASH_SHA256])) {
+		ast_log(LOG_ERROR, "Could not produce fingerprint from certificate '%s'\n", dtls_cfg->certfile);
+		ao2_unlock(dtls_certificates);
+		ao2_ref(cert, -1);
+		return NULL;
+	}
+
+	ao2_link_flags(dtls_certificates, cert, OBJ_NOLOCK);
+	ao2_unlock(dtls_certificates);
+
+	return cert;
+}
+
 /*! \pre instance is locked */
 static int ast_rtp_dtls_set_configuration(struct ast_rtp_instance *instance, const struct ast_rtp_dtls_cfg *dtls_cfg)
 {
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
 	struct dtls_cert_info cert_info = { 0 };
+#ifdef SSL_CTRL_SET_TLSEXT_TICKET_KEYS
+	long ticket_keys_len;
+#endif
 	int res;
 
 	if (!dtls_cfg->enabled) {
@@ -2244,10 +2607,11 @@ static int ast_rtp_dtls_set_configuration(struct ast_rtp_instance *instance, con
 		SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT : SSL_VERIFY_NONE, !(rtp->dtls_verify & AST_RTP_DTLS_VERIFY_CERTIFICATE) ?
 		dtls_verify_callback : NULL);
 
+	/* AES-GCM is preferred over the configured suite where the peer supports it */
 	if (dtls_cfg->suite == AST_AES_CM_128_HMAC_SHA1_80) {
-		SSL_CTX_set_tlsext_use_srtp(rtp->ssl_ctx, "SRTP_AES128_CM_SHA1_80");
+		SSL_CTX_set_tlsext_use_srtp(rtp->ssl_ctx, DTLS_SRTP_GCM_PROFILES "SRTP_AES128_CM_SHA1_80");
 	} else if (dtls_cfg->suite == AST_AES_CM_128_HMAC_SHA1_32) {
-		SSL_CTX_set_tlsext_use_srtp(rtp->ssl_ctx, "SRTP_AES128_CM_SHA1_32");
+		SSL_CTX_set_tlsext_use_srtp(rtp->ssl_ctx, DTLS_SRTP_GCM_PROFILES "SRTP_AES128_CM_SHA1_32");
 	} else {
 		ast_log(LOG_ERROR, "Unsupported suite specified for DTLS-SRTP on RTP instance '%p'\n", instance);
 		return -1;
@@ -2255,12 +2619,39 @@ static int ast_rtp_dtls_set_configuration(struct ast_rtp_instance *instance, con
 
 	rtp->local_hash = dtls_cfg->hash;
 
-	if (!load_dtls_certificate(instance, dtls_cfg, &cert_info)) {
-		const EVP_MD *type;
-		unsigned int size, i;
-		unsigned char fingerprint[EVP_MAX_MD_SIZE];
-		char *local_fingerprint = rtp->local_fingerprint;
+	if ((dtls_cfg->ephemeral_cert || !ast_strlen_zero(dtls_cfg->certfile))
+		&& rtp->local_hash != AST_RTP_DTLS_HASH_SHA1 && rtp->local_hash != AST_RTP_DTLS_HASH_SHA256) {
+		ast_log(LOG_ERROR, "Unsupported fingerprint hash type on RTP instance '%p'\n",
+			instance);
+		return -1;
+	}
+
+#ifdef SSL_CTRL_SET_TLSEXT_TICKET_KEYS
+	/* Tickets issued by any instance let a returning peer skip the full handshake */
+	ticket_keys_len = SSL_CTX_get_tlsext_ticket_keys(rtp->ssl_ctx, NULL, 0);
+	if (ticket_keys_len > 0 && ticket_keys_len <= (long) sizeof(dtls_ticket_keys)) {
+		SSL_CTX_set_tlsext_ticket_keys(rtp->ssl_ctx, dtls_ticket_keys, ticket_keys_len);
+	}
+#endif
 
+	if (!dtls_cfg->ephemeral_cert && !ast_strlen_zero(dtls_cfg->certfile)) {
+		/* Certificates from files are shared, along with their fingerprints */
+		struct dtls_certificate *cert = dtls_certificate_get(instance, dtls_cfg);
+
+		if (cert) {
+			res = !SSL_CTX_use_certificate(rtp->ssl_ctx, cert->certificate)
+				|| !SSL_CTX_use_PrivateKey(rtp->ssl_ctx, cert->private_key)
+				|| !SSL_CTX_check_private_key(rtp->ssl_ctx);
+			ast_copy_string(rtp->local_fingerprint, cert->fingerprint[rtp->local_hash],
+				sizeof(rtp->local_fingerprint));
+			ao2_ref(cert, -1);
+			if (res) {
+				ast_log(LOG_ERROR, "Specified certificate or private key for RTP instance '%p' could not be used\n",
+					instance);
+				return -1;
+			}
+		}
+	} else if (!load_dtls_certificate(instance, dtls_cfg, &cert_info)) {
 		if (!SSL_CTX_use_certificate(rtp->ssl_ctx, cert_info.certificate)) {
 			ast_log(LOG_ERROR, "Specified certificate for RTP instance '%p' could not be used\n",
 					instance);
@@ -2274,29 +2665,12 @@ static int ast_rtp_dtls_set_configuration(struct ast_rtp_instance *instance, con
 			return -1;
 		}
 
-		if (rtp->local_hash == AST_RTP_DTLS_HASH_SHA1) {
-			type = EVP_sha1();
-		} else if (rtp->local_hash == AST_RTP_DTLS_HASH_SHA256) {
-			type = EVP_sha256();
-		} else {
-			ast_log(LOG_ERROR, "Unsupported fingerprint hash type on RTP instance '%p'\n",
-				instance);
-			return -1;
-		}
-
-		if (!X509_digest(cert_info.certificate, type, fingerprint, &size) || !size) {
+		if (dtls_fingerprint(cert_info.certificate, rtp->local_hash, rtp->local_fingerprint)) {
 			ast_log(LOG_ERROR, "Could not produce fingerprint from certificate for RTP instance '%p'\n",
 					instance);
 			return -1;
 		}
 
-		for (i = 0; i < size; i++) {
-			sprintf(local_fingerprint, "%02hhX:", fingerprint[i]);
-			local_fingerprint += 3;
-		}
-
-		*(local_fingerprint - 1) = 0;
-
 		EVP_PKEY_free(cert_info.private_key);
 		X509_free(cert_info.certificate);
 	}
@@ -2603,6 +2977,7 @@ static struct ast_rtp_engine asterisk_rtp_engine = {
 	.set_remote_ssrc = ast_rtp_set_remote_ssrc,
 	.set_stream_num = ast_rtp_set_stream_num,
 	.extension_enable = ast_rtp_extension_enable,
+	.sample_stats = ast_rtp_sample_stats,
 	.bundle = ast_rtp_bundle,
 #ifdef TEST_FRAMEWORK
 	.test = &ast_rtp_test,
@@ -2975,12 +3350,22 @@ static int dtls_srtp_add_local_ssrc(struct ast_rtp *rtp, struct ast_rtp_instance
 	struct ast_srtp_policy *local_policy, *remote_policy = NULL;
 	int res = -1;
 	struct dtls_details *dtls = !rtcp ? &rtp->dtls : &rtp->rtcp->dtls;
+	enum ast_srtp_suite suite = rtp->suite;
+	int salt_len = SRTP_MASTER_SALT_LEN;
+#ifdef USE_DTLS_SRTP_GCM
+	const SRTP_PROTECTION_PROFILE *profile = SSL_get_selected_srtp_profile(dtls->ssl);
+
+	if (profile && profile->id == SRTP_AEAD_AES_128_GCM) {
+		suite = AST_AES_GCM_128;
+		salt_len = SRTP_GCM_MASTER_SALT_LEN;
+	}
+#endif
 
 	ast_debug_dtls(3, "(%p) DTLS srtp - add local ssrc - rtcp=%d, set_remote_policy=%d'\n",
 				   instance, rtcp, set_remote_policy);
 
 	/* Produce key information and set up SRTP */
-	if (!SSL_export_keying_material(dtls->ssl, material, SRTP_MASTER_LEN * 2, "EXTRACTOR-dtls_srtp", 19, NULL, 0, 0)) {
+	if (!SSL_export_keying_material(dtls->ssl, material, (SRTP_MASTER_KEY_LEN + salt_len) * 2, "EXTRACTOR-dtls_srtp", 19, NULL, 0, 0)) {
 		ast_log(LOG_WARNING, "Unable to extract SRTP keying material from DTLS-SRTP negotiation on RTP instance '%p'\n",
 			instance);
 		return -1;
@@ -2991,25 +3376,25 @@ static int dtls_srtp_add_local_ssrc(struct ast_rtp *rtp, struct ast_rtp_instance
 		local_key = material;
 		remote_key = local_key + SRTP_MASTER_KEY_LEN;
 		local_salt = remote_key + SRTP_MASTER_KEY_LEN;
-		remote_salt = local_salt + SRTP_MASTER_SALT_LEN;
+		remote_salt = local_salt + salt_len;
 	} else {
 		remote_key = material;
 		local_key = remote_key + SRTP_MASTER_KEY_LEN;
 		remote_salt = local_key + SRTP_MASTER_KEY_LEN;
-		local_salt = remote_salt + SRTP_MASTER_SALT_LEN;
+		local_salt = remote_salt + salt_len;
 	}
 
 	if (!(local_policy = res_srtp_policy->alloc())) {
 		return -1;
 	}
 
-	if (res_srtp_policy->set_master_key(local_policy, local_key, SRTP_MASTER_KEY_LEN, local_salt, SRTP_MASTER_SALT_LEN) < 0) {
+	if (res_srtp_policy->set_master_key(local_policy, local_key, SRTP_MASTER_KEY_LEN, local_salt, salt_len) < 0) {
 		ast_log(LOG_WARNING, "Could not set key/salt information on local policy of '%p' when setting up DTLS-SRTP\n", rtp);
 		goto error;
 	}
 
-	if (res_srtp_policy->set_suite(local_policy, rtp->suite)) {
-		ast_log(LOG_WARNING, "Could not set suite to '%u' on local policy of '%p' when setting up DTLS-SRTP\n", rtp->suite, rtp);
+	if (res_srtp_policy->set_suite(local_policy, suite)) {
+		ast_log(LOG_WARNING, "Could not set suite to '%u' on local policy of '%p' when setting up DTLS-SRTP\n", suite, rtp);
 		goto error;
 	}
 
@@ -3020,13 +3405,13 @@ static int dtls_srtp_add_local_ssrc(struct ast_rtp *rtp, struct ast_rtp_instance
 			goto error;
 		}
 
-		if (res_srtp_policy->set_master_key(remote_policy, remote_key, SRTP_MASTER_KEY_LEN, remote_salt, SRTP_MASTER_SALT_LEN) < 0) {
+		if (res_srtp_policy->set_master_key(remote_policy, remote_key, SRTP_MASTER_KEY_LEN, remote_salt, salt_len) < 0) {
 			ast_log(LOG_WARNING, "Could not set key/salt information on remote policy of '%p' when setting up DTLS-SRTP\n", rtp);
 			goto error;
 		}
 
-		if (res_srtp_policy->set_suite(remote_policy, rtp->suite)) {
-			ast_log(LOG_WARNING, "Could not set suite to '%u' on remote policy of '%p' when setting up DTLS-SRTP\n", rtp->suite, rtp);
+		if (res_srtp_policy->set_suite(remote_policy, suite)) {
+			ast_log(LOG_WARNING, "Could not set suite to '%u' on remote policy of '%p' when setting up DTLS-SRTP\n", suite, rtp);
 			goto error;
 		}
 
@@ -3165,159 +3550,529 @@ static int rtcp_mux(struct ast_rtp *rtp, const unsigned char *packet)
 	return 0;
 }
 
-/*! \pre instance is locked */
-static int __rtp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t size, int flags, struct ast_sockaddr *sa, int rtcp)
+#ifdef USE_IO_BATCH
+static struct rtp_io_batch *rtp_io_batch_alloc(unsigned int size)
 {
-	int len;
-	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
-#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
-	char *in = buf;
-#endif
-#ifdef HAVE_PJPROJECT
-	struct ast_sockaddr *loop = rtcp ? &rtp->rtcp_loop : &rtp->rtp_loop;
-#endif
-#ifdef TEST_FRAMEWORK
-	struct ast_rtp_engine_test *test = ast_rtp_instance_get_test(instance);
-#endif
+	struct rtp_io_batch *batch;
 
-	if ((len = ast_recvfrom(rtcp ? rtp->rtcp->s : rtp->s, buf, size, flags, sa)) < 0) {
-		return len;
+	batch = ast_calloc(1, sizeof(*batch) + size * sizeof(batch->slot[0]));
+	if (batch) {
+		batch->fd = -1;
+		batch->size = size;
 	}
 
-#ifdef TEST_FRAMEWORK
-	if (test && test->packets_to_drop > 0) {
-		test->packets_to_drop--;
-		return 0;
-	}
+	return batch;
+}
 #endif
 
-#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
-	/* If this is an SSL packet pass it to OpenSSL for processing. RFC section for first byte value:
-	 * https://tools.ietf.org/html/rfc5764#section-5.1.2 */
-	if ((*in >= 20) && (*in <= 63)) {
-		struct dtls_details *dtls = !rtcp ? &rtp->dtls : &rtp->rtcp->dtls;
-		int res = 0;
-
-		/* If no SSL session actually exists terminate things */
-		if (!dtls->ssl) {
-			ast_log(LOG_ERROR, "Received SSL traffic on RTP instance '%p' without an SSL session\n",
-				instance);
-			return -1;
-		}
-
-		ast_debug_dtls(3, "(%p) DTLS - __rtp_recvfrom rtp=%p - Got SSL packet '%d'\n", instance, rtp, *in);
-
-		/*
-		 * If ICE is in use, we can prevent a possible DOS attack
-		 * by allowing DTLS protocol messages (client hello, etc)
-		 * only from sources that are in the active remote
-		 * candidates list.
-		 */
+/*!
+ * \internal
+ * \brief Take the next packet queued for an instance on a shared socket
+ *
+ * \pre instance is locked
+ */
+static int shared_member_recvfrom(struct rtp_shared_member *member, enum rtp_shared_component component,
+	void *buf, size_t size, struct ast_sockaddr *sa)
+{
+	struct rtp_shared_packet *packet;
+	size_t len;
 
-#ifdef HAVE_PJPROJECT
-		if (rtp->ice) {
-			int pass_src_check = 0;
-			int ix = 0;
+	ao2_lock(member);
+	packet = AST_LIST_REMOVE_HEAD(&member->queue[component], next);
+	if (!packet) {
+		ao2_unlock(member);
+		errno = EAGAIN;
+		return -1;
+	}
+	if (!--member->queued[component]) {
+		ast_alertpipe_read(member->alert[component]);
+	}
+	ao2_unlock(member);
 
-			/*
-			 * You'd think that this check would cause a "deadlock"
-			 * because ast_rtp_ice_start_media calls dtls_perform_handshake
-			 * before it sets ice_media_started = 1 so how can we do a
-			 * handshake if we're dropping packets before we send them
-			 * to openssl.  Fortunately, dtls_perform_handshake just sets
-			 * up openssl to do the handshake and doesn't actually perform it
-			 * itself and the locking prevents __rtp_recvfrom from
-			 * running before the ice_media_started flag is set.  So only
-			 * unexpected DTLS packets can get dropped here.
-			 */
-			if (!rtp->ice_media_started) {
-				ast_log(LOG_WARNING, "%s: DTLS packet from %s dropped. ICE not completed yet.\n",
-					ast_rtp_instance_get_channel_id(instance),
-					ast_sockaddr_stringify(sa));
-				return 0;
-			}
+	len = MIN(packet->len, size);
+	memcpy(buf, packet->buf, len);
+	ast_sockaddr_copy(sa, &packet->addr);
+	ast_free(packet);
 
-			/*
-			 * If we got this far, then there have to be candidates.
-			 * We have to use pjproject's rcands because they may have
-			 * peer reflexive candidates that our ice_active_remote_candidates
-			 * won't.
-			 */
-			for (ix = 0; ix < rtp->ice->real_ice->rcand_cnt; ix++) {
-				pj_ice_sess_cand *rcand = &rtp->ice->real_ice->rcand[ix];
-				if (ast_sockaddr_pj_sockaddr_cmp(sa, &rcand->addr) == 0) {
-					pass_src_check = 1;
-					break;
-				}
-			}
+	return len;
+}
 
-			if (!pass_src_check) {
-				ast_log(LOG_WARNING, "%s: DTLS packet from %s dropped. Source not in ICE active candidate list.\n",
-					ast_rtp_instance_get_channel_id(instance),
-					ast_sockaddr_stringify(sa));
-				return 0;
-			}
-		}
+/*!
+ * \internal
+ * \brief Read a packet from the RTP socket along with any others waiting on it
+ *
+ * The first packet is read straight into the buffer given. Those read along
+ * with it are kept in the receive batch and handed out by the next calls,
+ * without touching the socket again.
+ *
+ * \pre instance is locked
+ */
+static int rtp_socket_recvfrom(struct ast_rtp *rtp, void *buf, size_t size, int flags, struct ast_sockaddr *sa)
+{
+#ifdef USE_IO_BATCH
+	struct rtp_io_batch *batch = rtp->rx_batch;
+	struct mmsghdr msgs[MAXIMUM_IO_BATCH];
+	struct iovec iov[MAXIMUM_IO_BATCH];
+	unsigned int i;
+	int res;
 #endif
 
-		/*
-		 * A race condition is prevented between dtls_perform_handshake()
-		 * and this function because both functions have to get the
-		 * instance lock before they can do anything.  The
-		 * dtls_perform_handshake() function needs to start the timer
-		 * before we stop it below.
-		 */
+	if (rtp->shared) {
+		return shared_member_recvfrom(rtp->shared, SHARED_RTP, buf, size, sa);
+	}
 
-		/* Before we feed data into OpenSSL ensure that the timeout timer is either stopped or completed */
-		ao2_unlock(instance);
-		dtls_srtp_stop_timeout_timer(instance, rtp, rtcp);
-		ao2_lock(instance);
+#ifdef USE_IO_BATCH
+	while (batch && batch->next < batch->count) {
+		struct rtp_io_slot *slot = &batch->slot[batch->next++];
 
-		/* If we don't yet know if we are active or passive and we receive a packet... we are obviously passive */
-		if (dtls->dtls_setup == AST_RTP_DTLS_SETUP_ACTPASS) {
-			dtls->dtls_setup = AST_RTP_DTLS_SETUP_PASSIVE;
-			SSL_set_accept_state(dtls->ssl);
+		if (!slot->len) {
+			continue;
 		}
+		memcpy(buf, slot->buf, MIN(slot->len, size));
+		ast_sockaddr_copy(sa, &slot->addr);
+		return MIN(slot->len, size);
+	}
 
-		BIO_write(dtls->read_bio, buf, len);
+	if (iobatch > 1 && (!batch || batch->size != iobatch - 1)) {
+		ast_free(batch);
+		batch = rtp->rx_batch = rtp_io_batch_alloc(iobatch - 1);
+	}
+	if (iobatch <= 1 || !batch) {
+		return ast_recvfrom(rtp->s, buf, size, flags, sa);
+	}
 
-		len = SSL_read(dtls->ssl, buf, len);
+	batch->count = 0;
+	batch->next = 0;
 
-		if ((len < 0) && (SSL_get_error(dtls->ssl, len) == SSL_ERROR_SSL)) {
-			unsigned long error = ERR_get_error();
-			ast_log(LOG_ERROR, "DTLS failure occurred on RTP instance '%p' due to reason '%s', terminating\n",
-				instance, ERR_reason_error_string(error));
-			return -1;
-		}
+	memset(msgs, 0, sizeof(msgs[0]) * (batch->size + 1));
+	iov[0].iov_base = buf;
+	iov[0].iov_len = size;
+	msgs[0].msg_hdr.msg_name = &sa->ss;
+	msgs[0].msg_hdr.msg_namelen = sizeof(sa->ss);
+	for (i = 1; i <= batch->size; ++i) {
+		iov[i].iov_base = batch->slot[i - 1].buf;
+		iov[i].iov_len = sizeof(batch->slot[i - 1].buf);
+		msgs[i].msg_hdr.msg_name = &batch->slot[i - 1].addr.ss;
+		msgs[i].msg_hdr.msg_namelen = sizeof(batch->slot[i - 1].addr.ss);
+	}
+	for (i = 0; i <= batch->size; ++i) {
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
 
-		if (SSL_is_init_finished(dtls->ssl)) {
-			/* Any further connections will be existing since this is now established */
-			dtls->connection = AST_RTP_DTLS_CONNECTION_EXISTING;
-			/* Use the keying material to set up key/salt information */
-			if ((res = dtls_srtp_setup(rtp, instance, rtcp))) {
-				return res;
-			}
-			/* Notify that dtls has been established */
-			res = RTP_DTLS_ESTABLISHED;
+	res = recvmmsg(rtp->s, msgs, batch->size + 1, flags | MSG_DONTWAIT, NULL);
+	if (res <= 0) {
+		return res;
+	}
 
-			ast_debug_dtls(3, "(%p) DTLS - __rtp_recvfrom rtp=%p - established'\n", instance, rtp);
-		} else {
-			/* Since we've sent additional traffic start the timeout timer for retransmission */
-			dtls_srtp_start_timeout_timer(instance, rtp, rtcp);
-		}
+	sa->len = msgs[0].msg_hdr.msg_namelen;
+	for (i = 1; i < res; ++i) {
+		struct rtp_io_slot *slot = &batch->slot[i - 1];
 
-		return res;
+		slot->addr.len = msgs[i].msg_hdr.msg_namelen;
+		slot->len = msgs[i].msg_len;
+		if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+			ast_debug_rtp(1, "(%p) RTP dropping packet from %s too large for the read batch\n",
+				rtp, ast_sockaddr_stringify(&slot->addr));
+			slot->len = 0;
+		}
 	}
+	batch->count = res - 1;
+
+	return msgs[0].msg_len;
+#else
+	return ast_recvfrom(rtp->s, buf, size, flags, sa);
 #endif
+}
 
-#ifdef HAVE_PJPROJECT
-	if (!ast_sockaddr_isnull(loop) && !ast_sockaddr_cmp(loop, sa)) {
-		/* ICE traffic will have been handled in the TURN callback, so skip it but update the address
-		 * so it reflects the actual source and not the loopback
-		 */
-		if (rtcp) {
-			ast_sockaddr_copy(sa, &rtp->rtcp->them);
-		} else {
+/*! \brief Whether packets read along with an earlier one are still to be handled */
+static int rtp_rx_batch_pending(struct ast_rtp *rtp)
+{
+	return rtp->rx_batch && rtp->rx_batch->next < rtp->rx_batch->count;
+}
+
+/*!
+ * \internal
+ * \brief Send the packets queued on the send batch
+ *
+ * \retval 0 on success
+ * \retval -1 if not all of the packets could be sent
+ */
+static int rtp_tx_batch_flush(struct ast_rtp *rtp)
+{
+#ifdef USE_IO_BATCH
+	struct rtp_io_batch *batch = rtp->tx_batch;
+	struct mmsghdr msgs[MAXIMUM_IO_BATCH];
+	struct iovec iov[MAXIMUM_IO_BATCH];
+	unsigned int i, sent = 0;
+	int res = 0;
+
+	if (!batch || !batch->count) {
+		return 0;
+	}
+
+	memset(msgs, 0, sizeof(msgs[0]) * batch->count);
+	for (i = 0; i < batch->count; ++i) {
+		iov[i].iov_base = batch->slot[i].buf;
+		iov[i].iov_len = batch->slot[i].len;
+		msgs[i].msg_hdr.msg_name = &batch->slot[i].addr.ss;
+		msgs[i].msg_hdr.msg_namelen = batch->slot[i].addr.len;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while (sent < batch->count) {
+		res = sendmmsg(batch->fd, msgs + sent, batch->count - sent, 0);
+		if (res <= 0) {
+			res = -1;
+			break;
+		}
+		sent += res;
+	}
+	batch->count = 0;
+
+	return res < 0 ? -1 : 0;
+#else
+	return 0;
+#endif
+}
+
+/*!
+ * \internal
+ * \brief Queue a packet on the send batch
+ *
+ * \retval 0 if the packet was queued
+ * \retval -1 if it has to be sent right away
+ */
+static int rtp_tx_batch_queue(struct ast_rtp *rtp, int fd, const void *buf, size_t len, const struct ast_sockaddr *sa)
+{
+#ifdef USE_IO_BATCH
+	struct rtp_io_batch *batch = rtp->tx_batch;
+	struct rtp_io_slot *slot;
+
+	if (batch && (batch->fd != fd || batch->count == batch->size || len > sizeof(slot->buf))) {
+		/* Anything already queued has to go out first to keep the order */
+		rtp_tx_batch_flush(rtp);
+	}
+	if (len > sizeof(slot->buf)) {
+		return -1;
+	}
+
+	if (!batch || batch->size != iobatch) {
+		ast_free(batch);
+		batch = rtp->tx_batch = rtp_io_batch_alloc(iobatch);
+		if (!batch) {
+			return -1;
+		}
+	}
+
+	batch->fd = fd;
+	slot = &batch->slot[batch->count++];
+	memcpy(slot->buf, buf, len);
+	slot->len = len;
+	ast_sockaddr_copy(&slot->addr, sa);
+
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+/*!
+ * \internal
+ * \brief Start queuing the packets sent on an instance so they go out together
+ *
+ * \note Only packets sent directly on our own socket are queued, those sent
+ * through ICE go out right away.
+ */
+static void rtp_tx_batch_start(struct ast_rtp *rtp)
+{
+	rtp->tx_batching = iobatch > 1;
+}
+
+/*!
+ * \internal
+ * \brief Send the packets queued since rtp_tx_batch_start()
+ *
+ * \retval 0 on success
+ * \retval -1 if not all of the packets could be sent
+ */
+static int rtp_tx_batch_end(struct ast_rtp *rtp)
+{
+	rtp->tx_batching = 0;
+	return rtp_tx_batch_flush(rtp);
+}
+
+/*! \pre instance is locked */
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+/*!
+ * \internal
+ * \brief Feed a received DTLS packet to OpenSSL
+ *
+ * \pre instance is locked
+ *
+ * \retval RTP_DTLS_ESTABLISHED if the handshake completed
+ * \retval -1 if DTLS failed
+ */
+static int dtls_srtp_handle_packet(struct ast_rtp_instance *instance, int rtcp, void *buf, int len)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	struct dtls_details *dtls = !rtcp ? &rtp->dtls : &rtp->rtcp->dtls;
+	int res = 0;
+
+	/*
+	 * A race condition is prevented between dtls_perform_handshake()
+	 * and this function because both functions have to get the
+	 * instance lock before they can do anything.  The
+	 * dtls_perform_handshake() function needs to start the timer
+	 * before we stop it below.
+	 */
+
+	/* Before we feed data into OpenSSL ensure that the timeout timer is either stopped or completed */
+	ao2_unlock(instance);
+	dtls_srtp_stop_timeout_timer(instance, rtp, rtcp);
+	ao2_lock(instance);
+
+	/* If we don't yet know if we are active or passive and we receive a packet... we are obviously passive */
+	if (dtls->dtls_setup == AST_RTP_DTLS_SETUP_ACTPASS) {
+		dtls->dtls_setup = AST_RTP_DTLS_SETUP_PASSIVE;
+		SSL_set_accept_state(dtls->ssl);
+	}
+
+	BIO_write(dtls->read_bio, buf, len);
+
+	len = SSL_read(dtls->ssl, buf, len);
+
+	if ((len < 0) && (SSL_get_error(dtls->ssl, len) == SSL_ERROR_SSL)) {
+		unsigned long error = ERR_get_error();
+		ast_log(LOG_ERROR, "DTLS failure occurred on RTP instance '%p' due to reason '%s', terminating\n",
+			instance, ERR_reason_error_string(error));
+		return -1;
+	}
+
+	if (SSL_is_init_finished(dtls->ssl)) {
+		/* Any further connections will be existing since this is now established */
+		dtls->connection = AST_RTP_DTLS_CONNECTION_EXISTING;
+		/* Use the keying material to set up key/salt information */
+		if ((res = dtls_srtp_setup(rtp, instance, rtcp))) {
+			return res;
+		}
+		/* Notify that dtls has been established */
+		res = RTP_DTLS_ESTABLISHED;
+
+		ast_debug_dtls(3, "(%p) DTLS - __rtp_recvfrom rtp=%p - established'\n", instance, rtp);
+	} else {
+		/* Since we've sent additional traffic start the timeout timer for retransmission */
+		dtls_srtp_start_timeout_timer(instance, rtp, rtcp);
+	}
+
+	return res;
+}
+
+/*! \brief A DTLS packet waiting for the handshake threadpool */
+struct dtls_srtp_packet {
+	struct ast_rtp_instance *instance;
+	int rtcp;
+	int len;
+	unsigned char buf[0];
+};
+
+/*! \brief Handshake threadpool task handling a DTLS packet */
+static int dtls_srtp_packet_task(void *data)
+{
+	struct dtls_srtp_packet *packet = data;
+	struct ast_rtp_instance *instance = packet->instance;
+	struct ast_rtp *rtp;
+	struct ast_channel *chan;
+	int res = 0;
+
+	ao2_lock(instance);
+	rtp = ast_rtp_instance_get_data(instance);
+	/* The session may have gone away while the packet waited */
+	if ((!packet->rtcp ? rtp->dtls.ssl : rtp->rtcp ? rtp->rtcp->dtls.ssl : NULL)) {
+		res = dtls_srtp_handle_packet(instance, packet->rtcp, packet->buf, packet->len);
+		if (res < 0 && res != RTP_DTLS_ESTABLISHED) {
+			/* The next read hangs up, as it would have had it handled the packet itself */
+			rtp->dtls_failed = 1;
+		}
+	}
+	ao2_unlock(instance);
+
+	if (res == RTP_DTLS_ESTABLISHED
+		&& (chan = ast_channel_get_by_name(ast_rtp_instance_get_channel_id(instance)))) {
+		ast_queue_control(chan, AST_CONTROL_SRCCHANGE);
+		ast_channel_unref(chan);
+	}
+
+	ao2_ref(instance, -1);
+	ast_free(packet);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Have the handshake threadpool handle a received DTLS packet
+ *
+ * \pre instance is locked
+ */
+static int dtls_srtp_queue_packet(struct ast_rtp_instance *instance, struct ast_rtp *rtp, int rtcp, void *buf, int len)
+{
+	struct dtls_srtp_packet *packet;
+
+	if (!rtp->dtls_serializer) {
+		char name[AST_TASKPROCESSOR_MAX_NAME + 1];
+
+		ast_taskprocessor_build_name(name, sizeof(name), "rtp-dtls");
+		rtp->dtls_serializer = ast_threadpool_serializer(name, dtls_threadpool);
+		if (!rtp->dtls_serializer) {
+			return dtls_srtp_handle_packet(instance, rtcp, buf, len);
+		}
+	}
+
+	packet = ast_malloc(sizeof(*packet) + len);
+	if (!packet) {
+		return 0;
+	}
+	packet->instance = ao2_bump(instance);
+	packet->rtcp = rtcp;
+	packet->len = len;
+	memcpy(packet->buf, buf, len);
+
+	if (ast_taskprocessor_push(rtp->dtls_serializer, dtls_srtp_packet_task, packet)) {
+		ao2_ref(instance, -1);
+		ast_free(packet);
+	}
+
+	/* Nothing for the reader, the handshake carries on in the threadpool */
+	return 0;
+}
+#endif
+
+static int __rtp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t size, int flags, struct ast_sockaddr *sa, int rtcp)
+{
+	int len;
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+	char *in = buf;
+#endif
+#ifdef HAVE_PJPROJECT
+	struct ast_sockaddr *loop = rtcp ? &rtp->rtcp_loop : &rtp->rtp_loop;
+#endif
+#ifdef TEST_FRAMEWORK
+	struct ast_rtp_engine_test *test = ast_rtp_instance_get_test(instance);
+#endif
+
+	if (!rtcp) {
+		len = rtp_socket_recvfrom(rtp, buf, size, flags, sa);
+	} else if (rtp->shared && rtp->rtcp->s != rtp->s) {
+		len = shared_member_recvfrom(rtp->shared, SHARED_RTCP, buf, size, sa);
+	} else {
+		len = ast_recvfrom(rtp->rtcp->s, buf, size, flags, sa);
+	}
+	if (len < 0) {
+		return len;
+	}
+
+#ifdef TEST_FRAMEWORK
+	if (test && test->packets_to_drop > 0) {
+		test->packets_to_drop--;
+		return 0;
+	}
+#endif
+
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+	/* If this is an SSL packet pass it to OpenSSL for processing. RFC section for first byte value:
+	 * https://tools.ietf.org/html/rfc5764#section-5.1.2 */
+	if (rtp->dtls_failed) {
+		return -1;
+	}
+	if ((*in >= 20) && (*in <= 63)) {
+		struct dtls_details *dtls = !rtcp ? &rtp->dtls : &rtp->rtcp->dtls;
+
+		/* If no SSL session actually exists terminate things */
+		if (!dtls->ssl) {
+			ast_log(LOG_ERROR, "Received SSL traffic on RTP instance '%p' without an SSL session\n",
+				instance);
+			return -1;
+		}
+
+		ast_debug_dtls(3, "(%p) DTLS - __rtp_recvfrom rtp=%p - Got SSL packet '%d'\n", instance, rtp, *in);
+
+		/*
+		 * If ICE is in use, we can prevent a possible DOS attack
+		 * by allowing DTLS protocol messages (client hello, etc)
+		 * only from sources that are in the active remote
+		 * candidates list.
+		 */
+
+#ifdef HAVE_PJPROJECT
+		if (rtp->ice) {
+			int pass_src_check = 0;
+			int ix = 0;
+
+			/*
+			 * You'd think that this check would cause a "deadlock"
+			 * because ast_rtp_ice_start_media calls dtls_perform_handshake
+			 * before it sets ice_media_started = 1 so how can we do a
+			 * handshake if we're dropping packets before we send them
+			 * to openssl.  Fortunately, dtls_perform_handshake just sets
+			 * up openssl to do the handshake and doesn't actually perform it
+			 * itself and the locking prevents __rtp_recvfrom from
+			 * running before the ice_media_started flag is set.  So only
+			 * unexpected DTLS packets can get dropped here.
+			 */
+			if (!rtp->ice_media_started) {
+				ast_log(LOG_WARNING, "%s: DTLS packet from %s dropped. ICE not completed yet.\n",
+					ast_rtp_instance_get_channel_id(instance),
+					ast_sockaddr_stringify(sa));
+				return 0;
+			}
+
+			/*
+			 * If we got this far, then there have to be candidates.
+			 * We have to use pjproject's rcands because they may have
+			 * peer reflexive candidates that our ice_active_remote_candidates
+			 * won't.
+			 */
+			for (ix = 0; ix < rtp->ice->real_ice->rcand_cnt; ix++) {
+				pj_ice_sess_cand *rcand = &rtp->ice->real_ice->rcand[ix];
+				if (ast_sockaddr_pj_sockaddr_cmp(sa, &rcand->addr) == 0) {
+					pass_src_check = 1;
+					break;
+				}
+			}
+
+			if (!pass_src_check) {
+				ast_log(LOG_WARNING, "%s: DTLS packet from %s dropped. Source not in ICE active candidate list.\n",
+					ast_rtp_instance_get_channel_id(instance),
+					ast_sockaddr_stringify(sa));
+				return 0;
+			}
+		}
+#endif
+
+		if (rtp->dtls_serializer || (dtls_threadpool && dtls_threads)) {
+			return dtls_srtp_queue_packet(instance, rtp, rtcp, buf, len);
+		}
+
+		return dtls_srtp_handle_packet(instance, rtcp, buf, len);
+	}
+
+	/* Media racing ahead of a handshake still in the threadpool can not be decrypted yet */
+	if (rtp->dtls_serializer && (*in & 0xC0) == 0x80 && !ast_rtp_instance_get_srtp(instance, rtcp)) {
+		return 0;
+	}
+#endif
+
+#ifdef HAVE_PJPROJECT
+	if (!ast_sockaddr_isnull(loop) && !ast_sockaddr_cmp(loop, sa)) {
+		/* ICE traffic will have been handled in the TURN callback, so skip it but update the address
+		 * so it reflects the actual source and not the loopback
+		 */
+		if (rtcp) {
+			ast_sockaddr_copy(sa, &rtp->rtcp->them);
+		} else {
 			ast_rtp_instance_get_remote_address(instance, sa);
 		}
 	} else if (rtp->ice) {
@@ -3390,6 +4145,7 @@ static int __rtp_sendto(struct ast_rtp_instance *instance, void *buf, size_t siz
 	struct ast_rtp_instance *transport = rtp->bundled ? rtp->bundled : instance;
 	struct ast_rtp *transport_rtp = ast_rtp_instance_get_data(transport);
 	struct ast_srtp *srtp = ast_rtp_instance_get_srtp(transport, rtcp);
+	int fd;
 	int res;
 
 	*via_ice = 0;
@@ -3429,7 +4185,12 @@ static int __rtp_sendto(struct ast_rtp_instance *instance, void *buf, size_t siz
 	}
 #endif
 
-	res = ast_sendto(rtcp ? transport_rtp->rtcp->s : transport_rtp->s, temp, len, flags, sa);
+	fd = rtcp ? transport_rtp->rtcp->s : transport_rtp->s;
+	if (rtp->tx_batching && !rtp_tx_batch_queue(rtp, fd, temp, len, sa)) {
+		res = len;
+	} else {
+		res = ast_sendto(fd, temp, len, flags, sa);
+	}
 	if (res > 0) {
 		ast_rtp_instance_set_last_tx(instance, time(NULL));
 	}
@@ -3915,54 +4676,989 @@ static int ice_create(struct ast_rtp_instance *instance, struct ast_sockaddr *ad
 		stun_config.software_name = pj_str(NULL);
 	}
 
-	ufrag = pj_str(rtp->local_ufrag);
-	passwd = pj_str(rtp->local_passwd);
+	ufrag = pj_str(rtp->local_ufrag);
+	passwd = pj_str(rtp->local_passwd);
+
+	/* Release the instance lock to avoid deadlock with PJPROJECT group lock */
+	ao2_unlock(instance);
+	/* Create an ICE session for ICE negotiation */
+	status = pj_ice_sess_create(&stun_config, NULL, PJ_ICE_SESS_ROLE_UNKNOWN,
+		rtp->ice_num_components, &ast_rtp_ice_sess_cb, &ufrag, &passwd, NULL, &real_ice);
+	ao2_lock(instance);
+	if (status == PJ_SUCCESS) {
+		/* Safely complete linking the ICE session into the instance */
+		real_ice->user_data = instance;
+		ice->real_ice = real_ice;
+		ice_old = rtp->ice;
+		rtp->ice = ice;
+		if (ice_old) {
+			ao2_unlock(instance);
+			ao2_ref(ice_old, -1);
+			ao2_lock(instance);
+		}
+
+		/* Add all of the available candidates to the ICE session */
+		rtp_add_candidates_to_ice(instance, rtp, addr, port, AST_RTP_ICE_COMPONENT_RTP,
+			TRANSPORT_SOCKET_RTP);
+
+		/* Only add the RTCP candidates to ICE when replacing the session and if
+		 * the ICE session contains more than just an RTP component. New sessions
+		 * handle this in a separate part of the setup phase */
+		if (replace && rtp->rtcp && rtp->ice_num_components > 1) {
+			rtp_add_candidates_to_ice(instance, rtp, &rtp->rtcp->us,
+				ast_sockaddr_port(&rtp->rtcp->us), AST_RTP_ICE_COMPONENT_RTCP,
+				TRANSPORT_SOCKET_RTCP);
+		}
+
+		return 0;
+	}
+
+	/*
+	 * It is safe to unref this while instance is locked here.
+	 * It was not initialized with a real_ice pointer.
+	 */
+	ao2_ref(ice, -1);
+
+	ast_rtp_ice_stop(instance);
+	return -1;
+
+}
+#endif
+
+/*! \brief Sockets shared by instances, protected by shared_sockets_lock */
+static AST_VECTOR(, struct rtp_shared_socket *) shared_sockets;
+AST_MUTEX_DEFINE_STATIC(shared_sockets_lock);
+
+static int shared_member_remote_hash_fn(const void *obj, const int flags)
+{
+	const struct rtp_shared_member *member;
+	const struct ast_sockaddr *addr;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		addr = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		member = obj;
+		addr = &member->remote;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	return ast_sockaddr_hash(addr) + ast_sockaddr_port(addr);
+}
+
+static int shared_member_remote_cmp_fn(void *obj, void *arg, int flags)
+{
+	const struct rtp_shared_member *member = obj;
+	const struct ast_sockaddr *addr = arg;
+
+	if ((flags & OBJ_SEARCH_MASK) == OBJ_SEARCH_OBJECT) {
+		addr = &((const struct rtp_shared_member *) arg)->remote;
+	}
+
+	return ast_sockaddr_cmp(&member->remote, addr) ? 0 : CMP_MATCH;
+}
+
+static int shared_member_ssrc_hash_fn(const void *obj, const int flags)
+{
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		return *(const unsigned int *) obj & INT_MAX;
+	case OBJ_SEARCH_OBJECT:
+		return ((const struct rtp_shared_member *) obj)->ssrc & INT_MAX;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+}
+
+static int shared_member_ssrc_cmp_fn(void *obj, void *arg, int flags)
+{
+	const struct rtp_shared_member *member = obj;
+	unsigned int ssrc;
+
+	if ((flags & OBJ_SEARCH_MASK) == OBJ_SEARCH_OBJECT) {
+		ssrc = ((const struct rtp_shared_member *) arg)->ssrc;
+	} else {
+		ssrc = *(const unsigned int *) arg;
+	}
+
+	return member->ssrc == ssrc ? CMP_MATCH : 0;
+}
+
+static void shared_member_destructor(void *obj)
+{
+	struct rtp_shared_member *member = obj;
+	struct rtp_shared_packet *packet;
+	int component;
+
+	for (component = 0; component < SHARED_COMPONENTS; ++component) {
+		while ((packet = AST_LIST_REMOVE_HEAD(&member->queue[component], next))) {
+			ast_free(packet);
+		}
+		ast_alertpipe_close(member->alert[component]);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Find the instance a packet read from a shared socket is for
+ *
+ * \return The member with a reference, or NULL
+ */
+static struct rtp_shared_member *shared_member_find(struct rtp_shared_socket *shared,
+	enum rtp_shared_component component, const unsigned char *buf, size_t len, const struct ast_sockaddr *addr)
+{
+	struct rtp_shared_member *member;
+	struct ast_sockaddr remote;
+	unsigned int ssrc;
+
+	/* RTCP is expected from the port after the one RTP comes from */
+	ast_sockaddr_copy(&remote, addr);
+	if (component == SHARED_RTCP) {
+		ast_sockaddr_set_port(&remote, ast_sockaddr_port(addr) - 1);
+	}
+	member = ao2_find(shared->by_remote, &remote, OBJ_SEARCH_KEY);
+	if (member || len < 12 || (buf[0] & 0xC0) != 0x80) {
+		return member;
+	}
+
+	/* The sender SSRC of RTCP comes before where RTP has it */
+	if (component == SHARED_RTCP || ((buf[1] & 0x7F) >= 64 && (buf[1] & 0x7F) <= 95)) {
+		ssrc = ntohl(get_unaligned_uint32(buf + 4));
+	} else {
+		ssrc = ntohl(get_unaligned_uint32(buf + 8));
+	}
+
+	return ao2_find(shared->by_ssrc, &ssrc, OBJ_SEARCH_KEY);
+}
+
+/*! \brief Thread which reads a pair of shared sockets */
+static void *shared_socket_thread(void *data)
+{
+	struct rtp_shared_socket *shared = data;
+	struct pollfd pfds[SHARED_COMPONENTS];
+	unsigned char buf[8192];
+	int component;
+
+	for (component = 0; component < SHARED_COMPONENTS; ++component) {
+		pfds[component].fd = shared->s[component];
+		pfds[component].events = POLLIN;
+	}
+
+	while (!shared->stop) {
+		if (ast_poll(pfds, SHARED_COMPONENTS, SHARED_SOCKET_POLL_MS) <= 0) {
+			continue;
+		}
+
+		for (component = 0; component < SHARED_COMPONENTS; ++component) {
+			struct ast_sockaddr addr;
+			struct rtp_shared_member *member;
+			struct rtp_shared_packet *packet;
+			int len;
+
+			if (!(pfds[component].revents & POLLIN)
+				|| (len = ast_recvfrom(shared->s[component], buf, sizeof(buf), 0, &addr)) < 0) {
+				continue;
+			}
+
+			member = shared_member_find(shared, component, buf, len, &addr);
+			if (!member) {
+				ast_debug_rtp(3, "(%p) RTP shared socket %s dropping packet from unknown source %s\n",
+					shared, ast_sockaddr_stringify(&shared->address), ast_sockaddr_stringify(&addr));
+				continue;
+			}
+
+			ao2_lock(member);
+			if (member->queued[component] < MAXIMUM_SHARED_QUEUE
+				&& (packet = ast_malloc(sizeof(*packet) + len))) {
+				ast_sockaddr_copy(&packet->addr, &addr);
+				packet->len = len;
+				memcpy(packet->buf, buf, len);
+				AST_LIST_INSERT_TAIL(&member->queue[component], packet, next);
+				if (!member->queued[component]++) {
+					ast_alertpipe_write(member->alert[component]);
+				}
+			}
+			ao2_unlock(member);
+			ao2_ref(member, -1);
+		}
+	}
+
+	return NULL;
+}
+
+static void shared_socket_destroy(struct rtp_shared_socket *shared)
+{
+	int component;
+
+	if (shared->thread != AST_PTHREADT_NULL) {
+		shared->stop = 1;
+		pthread_join(shared->thread, NULL);
+	}
+	for (component = 0; component < SHARED_COMPONENTS; ++component) {
+		if (shared->s[component] > -1) {
+			close(shared->s[component]);
+		}
+	}
+	ao2_cleanup(shared->by_remote);
+	ao2_cleanup(shared->by_ssrc);
+	ast_free(shared);
+}
+
+/*!
+ * \internal
+ * \brief Create a pair of sockets, on consecutive ports of the RTP range, to share
+ *
+ * \pre shared_sockets_lock is held
+ */
+static struct rtp_shared_socket *shared_socket_create(const struct ast_sockaddr *bind_address)
+{
+	struct rtp_shared_socket *shared;
+	int af = ast_sockaddr_is_ipv4(bind_address) ? AF_INET : ast_sockaddr_is_ipv6(bind_address) ? AF_INET6 : -1;
+	int x, startplace, i, maxloops;
+
+	shared = ast_calloc(1, sizeof(*shared));
+	if (!shared) {
+		return NULL;
+	}
+	shared->s[SHARED_RTP] = shared->s[SHARED_RTCP] = -1;
+	shared->thread = AST_PTHREADT_NULL;
+
+	shared->by_remote = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0, 257,
+		shared_member_remote_hash_fn, NULL, shared_member_remote_cmp_fn);
+	shared->by_ssrc = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0, 257,
+		shared_member_ssrc_hash_fn, NULL, shared_member_ssrc_cmp_fn);
+	if (!shared->by_remote || !shared->by_ssrc
+		|| (shared->s[SHARED_RTP] = create_new_socket("RTP", af)) < 0
+		|| (shared->s[SHARED_RTCP] = create_new_socket("RTCP", af)) < 0) {
+		shared_socket_destroy(shared);
+		return NULL;
+	}
+
+	x = (ast_random() % (rtpend - rtpstart)) + rtpstart;
+	x = x & ~1;
+	startplace = x;
+	maxloops = rtpend - rtpstart;
+	ast_sockaddr_copy(&shared->address, bind_address);
+	for (i = 0; i <= maxloops; i++) {
+		struct ast_sockaddr rtcp_address;
+
+		ast_sockaddr_set_port(&shared->address, x);
+		ast_sockaddr_copy(&rtcp_address, &shared->address);
+		ast_sockaddr_set_port(&rtcp_address, x + 1);
+		if (!ast_bind(shared->s[SHARED_RTP], &shared->address)) {
+			if (!ast_bind(shared->s[SHARED_RTCP], &rtcp_address)) {
+				break;
+			}
+			/* A bound socket cannot be bound again */
+			close(shared->s[SHARED_RTP]);
+			if ((shared->s[SHARED_RTP] = create_new_socket("RTP", af)) < 0) {
+				shared_socket_destroy(shared);
+				return NULL;
+			}
+		}
+
+		x += 2;
+		if (x > rtpend) {
+			x = (rtpstart + 1) & ~1;
+		}
+		if (x == startplace || (errno != EADDRINUSE && errno != EACCES)) {
+			ast_log(LOG_ERROR, "Could not allocate ports for a shared RTP socket on %s\n",
+				ast_sockaddr_stringify_addr(bind_address));
+			shared_socket_destroy(shared);
+			return NULL;
+		}
+	}
+
+	if (ast_pthread_create_background(&shared->thread, NULL, shared_socket_thread, shared)) {
+		shared->thread = AST_PTHREADT_NULL;
+		shared_socket_destroy(shared);
+		return NULL;
+	}
+
+	ast_debug_rtp(1, "(%p) RTP shared socket created on %s\n", shared,
+		ast_sockaddr_stringify(&shared->address));
+
+	return shared;
+}
+
+/*!
+ * \internal
+ * \brief Receive the packets for an instance from a shared socket
+ *
+ * The sockets for the local address with the fewest instances are used,
+ * unless fewer than configured exist yet.
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int shared_socket_join(struct ast_rtp_instance *instance, struct ast_rtp *rtp)
+{
+	struct rtp_shared_socket *shared = NULL;
+	struct rtp_shared_member *member;
+	unsigned int found = 0;
+	int component;
+	int i;
+
+	member = ao2_alloc(sizeof(*member), shared_member_destructor);
+	if (!member) {
+		return -1;
+	}
+	for (component = 0; component < SHARED_COMPONENTS; ++component) {
+		ast_alertpipe_clear(member->alert[component]);
+	}
+	for (component = 0; component < SHARED_COMPONENTS; ++component) {
+		if (ast_alertpipe_init(member->alert[component])) {
+			ao2_ref(member, -1);
+			return -1;
+		}
+	}
+
+	ast_mutex_lock(&shared_sockets_lock);
+	for (i = 0; i < AST_VECTOR_SIZE(&shared_sockets) && found < sharedsockets; ++i) {
+		struct rtp_shared_socket *candidate = AST_VECTOR_GET(&shared_sockets, i);
+
+		if (ast_sockaddr_cmp_addr(&candidate->address, &rtp->bind_address)) {
+			continue;
+		}
+		++found;
+		if (!shared || candidate->members < shared->members) {
+			shared = candidate;
+		}
+	}
+	if (found < sharedsockets && (!shared || shared->members)) {
+		struct rtp_shared_socket *created = shared_socket_create(&rtp->bind_address);
+
+		if (created) {
+			if (AST_VECTOR_APPEND(&shared_sockets, created)) {
+				shared_socket_destroy(created);
+			} else {
+				shared = created;
+			}
+		}
+	}
+	if (!shared) {
+		ast_mutex_unlock(&shared_sockets_lock);
+		ao2_ref(member, -1);
+		return -1;
+	}
+	++shared->members;
+	ast_mutex_unlock(&shared_sockets_lock);
+
+	member->shared = shared;
+	rtp->shared = member;
+	rtp->s = shared->s[SHARED_RTP];
+	ast_sockaddr_copy(&rtp->bind_address, &shared->address);
+	ast_debug_rtp(1, "(%p) RTP using shared port %d\n", instance, ast_sockaddr_port(&shared->address));
+	ast_rtp_instance_set_local_address(instance, &rtp->bind_address);
+
+	return 0;
+}
+
+/*! \brief Stop receiving from a shared socket */
+static void shared_socket_leave(struct ast_rtp *rtp)
+{
+	struct rtp_shared_member *member = rtp->shared;
+	struct rtp_shared_socket *shared = member->shared;
+
+	ao2_unlink(shared->by_remote, member);
+	ao2_unlink(shared->by_ssrc, member);
+
+	ast_mutex_lock(&shared_sockets_lock);
+	--shared->members;
+	ast_mutex_unlock(&shared_sockets_lock);
+
+	ao2_ref(member, -1);
+	rtp->shared = NULL;
+	rtp->s = -1;
+}
+
+/*! \brief Set the address the remote of an instance on a shared socket sends RTP from */
+static void shared_member_set_remote(struct rtp_shared_member *member, const struct ast_sockaddr *addr)
+{
+	struct ao2_container *by_remote = member->shared->by_remote;
+
+	ao2_wrlock(by_remote);
+	if (!ast_sockaddr_isnull(&member->remote)) {
+		ao2_unlink_flags(by_remote, member, OBJ_NOLOCK);
+	}
+	ast_sockaddr_copy(&member->remote, addr);
+	if (!ast_sockaddr_isnull(&member->remote)) {
+		ao2_link_flags(by_remote, member, OBJ_NOLOCK);
+	}
+	ao2_unlock(by_remote);
+}
+
+/*! \brief Set the SSRC of the remote of an instance on a shared socket */
+static void shared_member_set_ssrc(struct rtp_shared_member *member, unsigned int ssrc)
+{
+	struct ao2_container *by_ssrc = member->shared->by_ssrc;
+
+	ao2_wrlock(by_ssrc);
+	if (member->ssrc_valid) {
+		ao2_unlink_flags(by_ssrc, member, OBJ_NOLOCK);
+	}
+	member->ssrc = ssrc;
+	member->ssrc_valid = 1;
+	ao2_link_flags(by_ssrc, member, OBJ_NOLOCK);
+	ao2_unlock(by_ssrc);
+}
+
+/*! \brief The media workers, protected by media_workers_lock */
+static AST_VECTOR(, struct rtp_media_worker *) media_workers;
+AST_MUTEX_DEFINE_STATIC(media_workers_lock);
+
+/*!
+ * \internal
+ * \brief Release the bindings taken out of the epoll set of a worker
+ *
+ * \note Only called by the worker itself, between waits, when none of the
+ * events it has been given can still name them.
+ */
+static void media_worker_release(struct rtp_media_worker *worker)
+{
+	ast_mutex_lock(&worker->lock);
+	AST_VECTOR_CALLBACK_VOID(&worker->released, ao2_ref, -1);
+	AST_VECTOR_RESET(&worker->released, AST_VECTOR_ELEM_CLEANUP_NOOP);
+	ast_mutex_unlock(&worker->lock);
+}
+
+#ifdef USE_MEDIA_WORKERS
+/*! \brief Handle a packet waiting on the socket of an instance */
+static void media_worker_read(struct rtp_media_worker *worker, struct rtp_media_binding *binding)
+{
+	struct ast_rtp_instance *instance;
+	struct ast_rtp *rtp;
+	struct frame_list frames;
+	struct ast_frame *frame;
+
+	instance = ao2_weakproxy_get_object(binding, 0);
+	if (!instance) {
+		return;
+	}
+
+	ao2_lock(instance);
+	rtp = ast_rtp_instance_get_data(instance);
+	if (rtp->media != binding || binding->worker != worker || binding->failed) {
+		ao2_unlock(instance);
+		ao2_ref(instance, -1);
+		return;
+	}
+
+	frame = rtp_read(instance, 0);
+	if (!frame) {
+		/* Let the channel find out, and stop hearing about the socket */
+		binding->failed = 1;
+		epoll_ctl(worker->epfd, EPOLL_CTL_DEL, rtp->s, NULL);
+	}
+
+	AST_LIST_HEAD_INIT_NOLOCK(&frames);
+	rtp_frames_isolate(&frames, frame);
+	while ((frame = AST_LIST_REMOVE_HEAD(&frames, frame_list))) {
+		if (binding->queued >= MAXIMUM_MEDIA_QUEUE) {
+			ast_debug_rtp(1, "(%p) RTP media worker queue full, dropping frame\n", instance);
+			ast_frfree(frame);
+			continue;
+		}
+		AST_LIST_INSERT_TAIL(&binding->frames, frame, frame_list);
+		++binding->queued;
+	}
+	if ((binding->queued || binding->failed) && !binding->alerted) {
+		ast_alertpipe_write(binding->alert);
+		binding->alerted = 1;
+	}
+
+	ao2_unlock(instance);
+	ao2_ref(instance, -1);
+}
+
+/*! \brief Thread which reads the sockets of the instances bound to a worker */
+static void *media_worker_thread(void *data)
+{
+	struct rtp_media_worker *worker = data;
+	struct epoll_event events[64];
+	int count, i;
+
+	/* Pinned workers are spread over the media CPUs of asterisk.conf */
+	ast_thread_affinity_apply(AST_THREAD_AFFINITY_MEDIA, mediaworker_affinity ? (int) worker->index : -1);
+
+	while (!worker->stop) {
+		media_worker_release(worker);
+
+		count = epoll_wait(worker->epfd, events, ARRAY_LEN(events), MEDIA_WORKER_POLL_MS);
+		for (i = 0; i < count; ++i) {
+			media_worker_read(worker, events[i].data.ptr);
+		}
+	}
+	media_worker_release(worker);
+
+	return NULL;
+}
+#endif
+
+static void media_worker_destroy(struct rtp_media_worker *worker)
+{
+	if (worker->thread != AST_PTHREADT_NULL) {
+		worker->stop = 1;
+		pthread_join(worker->thread, NULL);
+	}
+	media_worker_release(worker);
+	AST_VECTOR_FREE(&worker->released);
+	ast_mutex_destroy(&worker->lock);
+	if (worker->epfd > -1) {
+		close(worker->epfd);
+	}
+	ast_free(worker);
+}
+
+static struct rtp_media_worker *media_worker_create(unsigned int index)
+{
+#ifdef USE_MEDIA_WORKERS
+	struct rtp_media_worker *worker;
+
+	worker = ast_calloc(1, sizeof(*worker));
+	if (!worker) {
+		return NULL;
+	}
+	worker->index = index;
+	worker->cpu = mediaworker_affinity ? ast_thread_affinity_cpu(AST_THREAD_AFFINITY_MEDIA, index) : -1;
+	worker->thread = AST_PTHREADT_NULL;
+	ast_mutex_init(&worker->lock);
+	AST_VECTOR_INIT(&worker->released, 0);
+
+	worker->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (worker->epfd < 0) {
+		ast_log(LOG_ERROR, "Could not create epoll set for RTP media worker: %s\n", strerror(errno));
+		media_worker_destroy(worker);
+		return NULL;
+	}
+
+	if (ast_pthread_create_background(&worker->thread, NULL, media_worker_thread, worker)) {
+		worker->thread = AST_PTHREADT_NULL;
+		media_worker_destroy(worker);
+		return NULL;
+	}
+
+	return worker;
+#else
+	return NULL;
+#endif
+}
+
+static void media_binding_destructor(void *obj)
+{
+	struct rtp_media_binding *binding = obj;
+	struct ast_frame *frame;
+
+	while ((frame = AST_LIST_REMOVE_HEAD(&binding->frames, frame_list))) {
+		ast_frfree(frame);
+	}
+	ast_alertpipe_close(binding->alert);
+}
+
+/*!
+ * \internal
+ * \brief Have a media worker read the RTP socket of an instance
+ *
+ * The worker with the fewest instances is used, unless fewer than
+ * allowed have been started yet.
+ *
+ * \param instance The instance
+ * \param rtp The RTP of the instance
+ * \param workers How many workers may be used
+ *
+ * \retval 0 on success
+ * \retval -1 on failure, the channel thread reads the socket then
+ */
+static int media_worker_join(struct ast_rtp_instance *instance, struct ast_rtp *rtp, unsigned int workers)
+{
+#ifdef USE_MEDIA_WORKERS
+	struct rtp_media_worker *worker = NULL;
+	struct rtp_media_worker *local = NULL;
+	struct epoll_event event = { .events = EPOLLIN, };
+	int rx_cpu = -1;
+	int i;
+
+	if (!rtp->media) {
+		/* The binding lives as long as the instance, as an instance can only be proxied once */
+		rtp->media = ao2_weakproxy_alloc(sizeof(*rtp->media), media_binding_destructor);
+		if (!rtp->media) {
+			return -1;
+		}
+		ast_alertpipe_clear(rtp->media->alert);
+		if (ast_alertpipe_init(rtp->media->alert)
+			|| ao2_weakproxy_set_object(rtp->media, instance, 0)) {
+			ao2_ref(rtp->media, -1);
+			rtp->media = NULL;
+			return -1;
+		}
+	}
+
+#ifdef SO_INCOMING_CPU
+	if (mediaworker_affinity) {
+		socklen_t len = sizeof(rx_cpu);
+
+		/* The CPU the kernel last received packets of the socket on */
+		if (getsockopt(rtp->s, SOL_SOCKET, SO_INCOMING_CPU, &rx_cpu, &len)) {
+			rx_cpu = -1;
+		}
+	}
+#endif
+
+	ast_mutex_lock(&media_workers_lock);
+	for (i = 0; i < AST_VECTOR_SIZE(&media_workers) && i < workers; ++i) {
+		struct rtp_media_worker *candidate = AST_VECTOR_GET(&media_workers, i);
+
+		if (!worker || candidate->bindings < worker->bindings) {
+			worker = candidate;
+		}
+		if (rx_cpu >= 0 && candidate->cpu == rx_cpu
+			&& (!local || candidate->bindings < local->bindings)) {
+			local = candidate;
+		}
+	}
+	if (local && local->bindings <= worker->bindings * 2 + 1) {
+		/*
+		 * A worker on the CPU receiving the packets reads them while they are
+		 * still in its cache, unless it already carries far more than others.
+		 */
+		worker = local;
+	} else if (i < workers && (!worker || worker->bindings)) {
+		struct rtp_media_worker *created = media_worker_create(i);
+
+		if (created) {
+			if (AST_VECTOR_APPEND(&media_workers, created)) {
+				media_worker_destroy(created);
+			} else {
+				worker = created;
+			}
+		}
+	}
+	if (!worker) {
+		ast_mutex_unlock(&media_workers_lock);
+		return -1;
+	}
+	++worker->bindings;
+	ast_mutex_unlock(&media_workers_lock);
+
+	event.data.ptr = ao2_bump(rtp->media);
+	if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, rtp->s, &event)) {
+		ast_log(LOG_WARNING, "Could not add RTP instance '%p' to media worker: %s\n",
+			instance, strerror(errno));
+		ao2_ref(rtp->media, -1);
+		ast_mutex_lock(&media_workers_lock);
+		--worker->bindings;
+		ast_mutex_unlock(&media_workers_lock);
+		return -1;
+	}
+	rtp->media->worker = worker;
+	rtp->media->failed = 0;
+
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+/*!
+ * \internal
+ * \brief Stop a media worker reading the RTP socket of an instance
+ *
+ * \pre instance is locked
+ */
+static void media_worker_leave(struct ast_rtp *rtp)
+{
+#ifdef USE_MEDIA_WORKERS
+	struct rtp_media_worker *worker = rtp->media->worker;
+
+	epoll_ctl(worker->epfd, EPOLL_CTL_DEL, rtp->s, NULL);
+	rtp->media->worker = NULL;
+
+	/* The worker may yet be handed an event naming the binding */
+	ast_mutex_lock(&worker->lock);
+	if (AST_VECTOR_APPEND(&worker->released, rtp->media)) {
+		/* Leaking a reference beats the worker using a freed binding */
+		ast_log(LOG_ERROR, "Could not release RTP media worker binding\n");
+	}
+	ast_mutex_unlock(&worker->lock);
+
+	ast_mutex_lock(&media_workers_lock);
+	--worker->bindings;
+	ast_mutex_unlock(&media_workers_lock);
+#endif
+}
+
+/*! \brief The taskprocessor the relay command is run on */
+static struct ast_taskprocessor *relay_tps;
+
+/*!
+ * \internal
+ * \brief Run the relay command for a relay
+ *
+ * \retval 0 if the command succeeded
+ */
+static int rtp_relay_run(struct rtp_kernel_relay *relay, const char *action)
+{
+	char *command;
+	int res;
+
+	if (ast_asprintf(&command, "%s %s%s", relay->command, action, relay->args) < 0) {
+		return -1;
+	}
+	res = ast_safe_system(command);
+	ast_free(command);
+
+	return res;
+}
+
+/*! \brief Relay taskprocessor task installing the forwarding */
+static int rtp_relay_install(void *data)
+{
+	struct rtp_kernel_relay *relay = data;
+
+	if (!rtp_relay_run(relay, "add")) {
+		relay->active = 1;
+		ast_debug_rtp(1, "Relaying packets between%s\n", relay->args);
+	} else {
+		ast_log(LOG_WARNING, "Relay command could not forward packets between%s, forwarding them ourselves\n",
+			relay->args);
+	}
+	ao2_ref(relay, -1);
+
+	return 0;
+}
+
+/*! \brief Relay taskprocessor task removing the forwarding */
+static int rtp_relay_uninstall(void *data)
+{
+	struct rtp_kernel_relay *relay = data;
+
+	if (relay->active) {
+		relay->active = 0;
+		if (rtp_relay_run(relay, "del")) {
+			ast_log(LOG_WARNING, "Relay command could not stop forwarding packets between%s\n",
+				relay->args);
+		}
+	}
+	ao2_ref(relay, -1);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Queue removal of the forwarding of a relay, unless the other instance already did
+ *
+ * \note Steals the reference to the relay
+ */
+static void rtp_relay_remove(struct rtp_kernel_relay *relay)
+{
+	int queue;
+
+	ao2_lock(relay);
+	queue = !relay->removed;
+	relay->removed = 1;
+	ao2_unlock(relay);
+
+	if (queue && !ast_taskprocessor_push(relay_tps, rtp_relay_uninstall, relay)) {
+		return;
+	}
+	ao2_ref(relay, -1);
+}
+
+/*!
+ * \internal
+ * \brief Add the addresses of an instance to the arguments of the relay command
+ *
+ * \pre instance is locked
+ *
+ * \retval 0 if the packets of the instance can be relayed
+ */
+static int rtp_relay_describe(struct ast_rtp_instance *instance, struct ast_str **args)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	struct ast_sockaddr local;
+	struct ast_sockaddr remote;
+
+	/* Only plain packets on sockets of our own can be forwarded as they are */
+	if (rtp->s < 0 || rtp->relay || rtp->shared || rtp->bundled
+		|| ast_rtp_instance_get_srtp(instance, 0)
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+		|| rtp->dtls.ssl
+#endif
+#ifdef HAVE_PJPROJECT
+		|| rtp->ice
+#endif
+		) {
+		return -1;
+	}
+
+	ast_rtp_instance_get_local_address(instance, &local);
+	ast_rtp_instance_get_remote_address(instance, &remote);
+	if (ast_sockaddr_isnull(&local) || ast_sockaddr_isnull(&remote)) {
+		return -1;
+	}
+
+	ast_str_append(args, 0, " '%s'", ast_sockaddr_stringify(&local));
+	ast_str_append(args, 0, " '%s'", ast_sockaddr_stringify(&remote));
+	if (rtp->rtcp && rtp->rtcp->type == AST_RTP_INSTANCE_RTCP_STANDARD
+		&& !ast_sockaddr_isnull(&rtp->rtcp->them)) {
+		ast_str_append(args, 0, " '%s'", ast_sockaddr_stringify(&rtp->rtcp->us));
+		ast_str_append(args, 0, " '%s'", ast_sockaddr_stringify(&rtp->rtcp->them));
+	} else {
+		ast_str_append(args, 0, " - -");
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Determine if every payload received on one instance goes out unchanged on the other
+ *
+ * Local bridging rewrites the payload type of packets where the two differ,
+ * which forwarding outside of Asterisk can not.
+ */
+static int rtp_relay_payloads_match(struct ast_rtp_codecs *codecs0, struct ast_rtp_codecs *codecs1)
+{
+	int payload;
+
+	for (payload = 0; payload < AST_RTP_MAX_PT; ++payload) {
+		struct ast_rtp_payload_type *type = ast_rtp_codecs_get_payload(codecs0, payload);
+		int match;
+
+		if (!type) {
+			continue;
+		}
+		match = ast_rtp_codecs_payload_code_tx(codecs1, type->asterisk_format, type->format,
+			type->rtp_code) == payload;
+		ao2_ref(type, -1);
+		if (!match) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*!
+ * \internal
+ * \brief Have the relay command forward packets between two locally bridged instances
+ *
+ * \note Neither instance may be locked
+ */
+static void rtp_relay_start(struct ast_rtp_instance *instance0, struct ast_rtp_instance *instance1)
+{
+	struct ast_rtp *rtp0 = ast_rtp_instance_get_data(instance0);
+	struct ast_rtp *rtp1 = ast_rtp_instance_get_data(instance1);
+	struct ast_str *args = ast_str_create(256);
+	struct rtp_kernel_relay *relay;
+	size_t command_len;
+	int res;
+
+	if (!args) {
+		return;
+	}
+
+	ao2_lock(instance0);
+	res = rtp_relay_describe(instance0, &args);
+	ao2_unlock(instance0);
+	if (!res) {
+		ao2_lock(instance1);
+		res = rtp_relay_describe(instance1, &args);
+		ao2_unlock(instance1);
+	}
+	if (res || !rtp_relay_payloads_match(ast_rtp_instance_get_codecs(instance0), ast_rtp_instance_get_codecs(instance1))
+		|| !rtp_relay_payloads_match(ast_rtp_instance_get_codecs(instance1), ast_rtp_instance_get_codecs(instance0))) {
+		ast_free(args);
+		return;
+	}
+
+	command_len = strlen(relaycommand) + 1;
+	relay = ao2_alloc(sizeof(*relay) + command_len + ast_str_strlen(args) + 1, NULL);
+	if (!relay) {
+		ast_free(args);
+		return;
+	}
+	relay->command = strcpy(relay->buf, relaycommand);
+	relay->args = strcpy(relay->buf + command_len, ast_str_buffer(args));
+	ast_free(args);
+
+	ao2_lock(instance0);
+	rtp0->relay = ao2_bump(relay);
+	ao2_unlock(instance0);
+	ao2_lock(instance1);
+	rtp1->relay = ao2_bump(relay);
+	ao2_unlock(instance1);
+
+	if (ast_taskprocessor_push(relay_tps, rtp_relay_install, relay)) {
+		ao2_ref(relay, -1);
+	}
+}
 
-	/* Release the instance lock to avoid deadlock with PJPROJECT group lock */
-	ao2_unlock(instance);
-	/* Create an ICE session for ICE negotiation */
-	status = pj_ice_sess_create(&stun_config, NULL, PJ_ICE_SESS_ROLE_UNKNOWN,
-		rtp->ice_num_components, &ast_rtp_ice_sess_cb, &ufrag, &passwd, NULL, &real_ice);
-	ao2_lock(instance);
-	if (status == PJ_SUCCESS) {
-		/* Safely complete linking the ICE session into the instance */
-		real_ice->user_data = instance;
-		ice->real_ice = real_ice;
-		ice_old = rtp->ice;
-		rtp->ice = ice;
-		if (ice_old) {
-			ao2_unlock(instance);
-			ao2_ref(ice_old, -1);
-			ao2_lock(instance);
-		}
+/*!
+ * \internal
+ * \brief Stop relaying packets of an instance
+ *
+ * \pre instance is locked
+ */
+static void rtp_relay_stop(struct ast_rtp *rtp)
+{
+	if (rtp->relay) {
+		rtp_relay_remove(rtp->relay);
+		rtp->relay = NULL;
+	}
+}
 
-		/* Add all of the available candidates to the ICE session */
-		rtp_add_candidates_to_ice(instance, rtp, addr, port, AST_RTP_ICE_COMPONENT_RTP,
-			TRANSPORT_SOCKET_RTP);
+/*!
+ * \internal
+ * \brief Hand the channel the frames a media worker read for it
+ *
+ * \pre instance is locked
+ */
+static struct ast_frame *media_worker_frames(struct ast_rtp *rtp)
+{
+	struct rtp_media_binding *binding = rtp->media;
+	struct ast_frame *frame = AST_LIST_FIRST(&binding->frames);
 
-		/* Only add the RTCP candidates to ICE when replacing the session and if
-		 * the ICE session contains more than just an RTP component. New sessions
-		 * handle this in a separate part of the setup phase */
-		if (replace && rtp->rtcp && rtp->ice_num_components > 1) {
-			rtp_add_candidates_to_ice(instance, rtp, &rtp->rtcp->us,
-				ast_sockaddr_port(&rtp->rtcp->us), AST_RTP_ICE_COMPONENT_RTCP,
-				TRANSPORT_SOCKET_RTCP);
-		}
+	AST_LIST_HEAD_INIT_NOLOCK(&binding->frames);
+	binding->queued = 0;
+	if (binding->alerted) {
+		ast_alertpipe_read(binding->alert);
+		binding->alerted = 0;
+	}
 
-		return 0;
+	if (binding->failed) {
+		ast_frfree(frame);
+		return NULL;
 	}
 
-	/*
-	 * It is safe to unref this while instance is locked here.
-	 * It was not initialized with a real_ice pointer.
-	 */
-	ao2_ref(ice, -1);
+	return frame ?: &ast_null_frame;
+}
 
-	ast_rtp_ice_stop(instance);
-	return -1;
+/*!
+ * \internal
+ * \brief Drop the frames a media worker read that the channel has not taken
+ *
+ * \pre instance is locked
+ */
+static void media_worker_flush(struct rtp_media_binding *binding)
+{
+	struct ast_frame *frame;
 
+	while ((frame = AST_LIST_REMOVE_HEAD(&binding->frames, frame_list))) {
+		ast_frfree(frame);
+	}
+	binding->queued = 0;
+	if (binding->alerted) {
+		ast_alertpipe_read(binding->alert);
+		binding->alerted = 0;
+	}
 }
-#endif
 
 static int rtp_allocate_transport(struct ast_rtp_instance *instance, struct ast_rtp *rtp)
 {
@@ -3970,45 +5666,54 @@ static int rtp_allocate_transport(struct ast_rtp_instance *instance, struct ast_
 
 	rtp->strict_rtp_state = (strictrtp ? STRICT_RTP_CLOSED : STRICT_RTP_OPEN);
 
-	/* Create a new socket for us to listen on and use */
-	if ((rtp->s =
-	     create_new_socket("RTP",
-			       ast_sockaddr_is_ipv4(&rtp->bind_address) ? AF_INET  :
-			       ast_sockaddr_is_ipv6(&rtp->bind_address) ? AF_INET6 : -1)) < 0) {
-		ast_log(LOG_WARNING, "Failed to create a new socket for RTP instance '%p'\n", instance);
-		return -1;
-	}
+	if (sharedsockets && !shared_socket_join(instance, rtp)) {
+		x = ast_sockaddr_port(&rtp->bind_address);
+	} else {
+		/* Create a new socket for us to listen on and use */
+		if ((rtp->s =
+		     create_new_socket("RTP",
+				       ast_sockaddr_is_ipv4(&rtp->bind_address) ? AF_INET  :
+				       ast_sockaddr_is_ipv6(&rtp->bind_address) ? AF_INET6 : -1)) < 0) {
+			ast_log(LOG_WARNING, "Failed to create a new socket for RTP instance '%p'\n", instance);
+			return -1;
+		}
 
-	/* Now actually find a free RTP port to use */
-	x = (ast_random() % (rtpend - rtpstart)) + rtpstart;
-	x = x & ~1;
-	startplace = x;
+		/* Now actually find a free RTP port to use */
+		x = (ast_random() % (rtpend - rtpstart)) + rtpstart;
+		x = x & ~1;
+		startplace = x;
+
+		/* Protection against infinite loops in the case there is a potential case where the loop is not broken such as an odd
+		   start port sneaking in (even though this condition is checked at load.) */
+		maxloops = rtpend - rtpstart;
+		for (i = 0; i <= maxloops; i++) {
+			ast_sockaddr_set_port(&rtp->bind_address, x);
+			/* Try to bind, this will tell us whether the port is available or not */
+			if (!ast_bind(rtp->s, &rtp->bind_address)) {
+				ast_debug_rtp(1, "(%p) RTP allocated port %d\n", instance, x);
+				ast_rtp_instance_set_local_address(instance, &rtp->bind_address);
+				ast_test_suite_event_notify("RTP_PORT_ALLOCATED", "Port: %d", x);
+				break;
+			}
 
-	/* Protection against infinite loops in the case there is a potential case where the loop is not broken such as an odd
-	   start port sneaking in (even though this condition is checked at load.) */
-	maxloops = rtpend - rtpstart;
-	for (i = 0; i <= maxloops; i++) {
-		ast_sockaddr_set_port(&rtp->bind_address, x);
-		/* Try to bind, this will tell us whether the port is available or not */
-		if (!ast_bind(rtp->s, &rtp->bind_address)) {
-			ast_debug_rtp(1, "(%p) RTP allocated port %d\n", instance, x);
-			ast_rtp_instance_set_local_address(instance, &rtp->bind_address);
-			ast_test_suite_event_notify("RTP_PORT_ALLOCATED", "Port: %d", x);
-			break;
-		}
+			x += 2;
+			if (x > rtpend) {
+				x = (rtpstart + 1) & ~1;
+			}
 
-		x += 2;
-		if (x > rtpend) {
-			x = (rtpstart + 1) & ~1;
+			/* See if we ran out of ports or if the bind actually failed because of something other than the address being in use */
+			if (x == startplace || (errno != EADDRINUSE && errno != EACCES)) {
+				ast_log(LOG_ERROR, "Oh dear... we couldn't allocate a port for RTP instance '%p'\n", instance);
+				close(rtp->s);
+				rtp->s = -1;
+				return -1;
+			}
 		}
+	}
 
-		/* See if we ran out of ports or if the bind actually failed because of something other than the address being in use */
-		if (x == startplace || (errno != EADDRINUSE && errno != EACCES)) {
-			ast_log(LOG_ERROR, "Oh dear... we couldn't allocate a port for RTP instance '%p'\n", instance);
-			close(rtp->s);
-			rtp->s = -1;
-			return -1;
-		}
+	/* The socket of a shared one is already read by a thread of its own */
+	if (mediaworkers && !rtp->shared && !media_worker_join(instance, rtp, mediaworkers)) {
+		ast_debug_rtp(1, "(%p) RTP socket read by media worker %u\n", instance, rtp->media->worker->index);
 	}
 
 #ifdef HAVE_PJPROJECT
@@ -4018,8 +5723,8 @@ static int rtp_allocate_transport(struct ast_rtp_instance *instance, struct ast_
 	generate_random_string(rtp->local_ufrag, sizeof(rtp->local_ufrag));
 	generate_random_string(rtp->local_passwd, sizeof(rtp->local_passwd));
 
-	/* Create an ICE session for ICE negotiation */
-	if (icesupport) {
+	/* Create an ICE session for ICE negotiation, it needs a socket of our own */
+	if (icesupport && !rtp->shared) {
 		rtp->ice_num_components = 2;
 		ast_debug_ice(2, "(%p) ICE creating session %s (%d)\n", instance,
 			ast_sockaddr_stringify(&rtp->bind_address), x);
@@ -4043,6 +5748,7 @@ static int rtp_allocate_transport(struct ast_rtp_instance *instance, struct ast_
 static void rtp_deallocate_transport(struct ast_rtp_instance *instance, struct ast_rtp *rtp)
 {
 	int saved_rtp_s = rtp->s;
+	int shared = rtp->shared != NULL;
 #ifdef HAVE_PJPROJECT
 	struct timeval wait = ast_tvadd(ast_tvnow(), ast_samp2tv(TURN_STATE_WAIT_TIME, 1000));
 	struct timespec ts = { .tv_sec = wait.tv_sec, .tv_nsec = wait.tv_usec * 1000, };
@@ -4052,15 +5758,32 @@ static void rtp_deallocate_transport(struct ast_rtp_instance *instance, struct a
 	ast_rtp_dtls_stop(instance);
 #endif
 
+	if (rtp->media && rtp->media->worker) {
+		media_worker_leave(rtp);
+	}
+	rtp->media_bridged = 0;
+
+	rtp_relay_stop(rtp);
+
 	/* Close our own socket so we no longer get packets */
-	if (rtp->s > -1) {
+	if (rtp->shared) {
+		shared_socket_leave(rtp);
+	} else if (rtp->s > -1) {
 		close(rtp->s);
 		rtp->s = -1;
 	}
 
+	/* Nor handle, or send, ones that were meant for it */
+	if (rtp->rx_batch) {
+		rtp->rx_batch->count = 0;
+	}
+	if (rtp->tx_batch) {
+		rtp->tx_batch->count = 0;
+	}
+
 	/* Destroy RTCP if it was being used */
 	if (rtp->rtcp && rtp->rtcp->s > -1) {
-		if (saved_rtp_s != rtp->rtcp->s) {
+		if (saved_rtp_s != rtp->rtcp->s && !shared) {
 			close(rtp->rtcp->s);
 		}
 		rtp->rtcp->s = -1;
@@ -4248,6 +5971,13 @@ static int ast_rtp_destroy(struct ast_rtp_instance *instance)
 		ast_data_buffer_free(rtp->recv_buffer);
 	}
 
+	ast_free(rtp->rx_batch);
+	ast_free(rtp->tx_batch);
+	ao2_cleanup(rtp->media);
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+	ast_taskprocessor_unreference(rtp->dtls_serializer);
+#endif
+
 	AST_VECTOR_FREE(&rtp->transport_wide_cc.packet_statistics);
 
 	ao2_cleanup(rtp->lasttxformat);
@@ -4469,6 +6199,7 @@ static int ast_rtp_dtmf_end_with_duration(struct ast_rtp_instance *instance, cha
 	rtpheader[3] |= htonl((1 << 23));
 
 	/* Send it 3 times, that's the magical number */
+	rtp_tx_batch_start(rtp);
 	for (i = 0; i < 3; i++) {
 		int ice;
 
@@ -4491,6 +6222,11 @@ static int ast_rtp_dtmf_end_with_duration(struct ast_rtp_instance *instance, cha
 
 		rtp->seqno++;
 	}
+	if (rtp_tx_batch_end(rtp)) {
+		ast_log(LOG_ERROR, "RTP Transmission error to %s: %s\n",
+			ast_sockaddr_stringify(&remote_address),
+			strerror(errno));
+	}
 	res = 0;
 
 	/* Oh and we can't forget to turn off the stuff that says we are sending DTMF */
@@ -5012,6 +6748,17 @@ static int ast_rtcp_write(const void *data)
 	}
 
 	ao2_lock(instance);
+
+	/*
+	 * While relayed the endpoints exchange their own reports and none of
+	 * their packets reach us, so there is nothing to report nor to time out.
+	 */
+	if (rtp->relay && rtp->relay->active) {
+		ast_rtp_instance_set_last_rx(instance, time(NULL));
+		res = 1;
+		goto cleanup;
+	}
+
 	rtcpheader = bdata;
 	rtcp_report = ast_rtp_rtcp_report_alloc(rtp->themssrc_valid ? 1 : 0);
 	res = ast_rtcp_generate_compound_prefix(instance, rtcpheader, rtcp_report, &sr);
@@ -5037,6 +6784,7 @@ static int ast_rtcp_write(const void *data)
 		res = 0;
 	} else {
 		ast_rtcp_calculate_sr_rr_statistics(instance, rtcp_report, remote_address, ice, sr);
+		rtp_stats_publish(instance);
 	}
 
 cleanup:
@@ -5573,7 +7321,8 @@ static int ast_rtp_write(struct ast_rtp_instance *instance, struct ast_frame *fr
 		int hdrlen = 12;
 		struct ast_frame *f = NULL;
 
-		if (frame->offset < hdrlen) {
+		/* The RTP header is written in front of the data, which a shared payload can't allow */
+		if (frame->offset < hdrlen || ast_frame_is_shared(frame)) {
 			f = ast_frdup(frame);
 		} else {
 			f = frame;
@@ -6470,6 +8219,9 @@ static int ast_rtp_rtcp_handle_nack(struct ast_rtp_instance *instance, unsigned
 
 	ast_rtp_instance_get_remote_address(instance, &remote_address);
 
+	/* The retransmissions go out together once all of them have been found */
+	rtp_tx_batch_start(rtp);
+
 	/*
 	 * We use index 3 because with feedback messages, the FCI (Feedback Control Information)
 	 * does not begin until after the version, packet SSRC, and media SSRC words.
@@ -6521,6 +8273,11 @@ static int ast_rtp_rtcp_handle_nack(struct ast_rtp_instance *instance, unsigned
 		}
 	}
 
+	if (rtp_tx_batch_end(rtp)) {
+		ast_log(LOG_WARNING, "RTP retransmission to %s failed: %s\n",
+			ast_sockaddr_stringify(&remote_address), strerror(errno));
+	}
+
 	if (packets_not_found) {
 		/* Grow the send buffer based on how many packets were not found in the buffer, but
 		 * enforce a maximum.
@@ -6925,6 +8682,7 @@ static struct ast_frame *ast_rtcp_interpret(struct ast_rtp_instance *instance, s
 				 * update_lost_stats.
 				 */
 				update_reported_mes_stats(rtp);
+				rtp_stats_publish(instance);
 
 				if (rtcp_debug_test_addr(addr)) {
 					int rate = ast_rtp_get_rate(rtp->f.subclass.format);
@@ -7799,6 +9557,9 @@ static struct ast_frame *ast_rtp_interpret(struct ast_rtp_instance *instance, st
 			}
 		}
 
+		if (rtp->shared && (!rtp->themssrc_valid || rtp->themssrc != ssrc)) {
+			shared_member_set_ssrc(rtp->shared, ssrc);
+		}
 		rtp->themssrc = ssrc; /* Record their SSRC to put in future RR */
 		rtp->themssrc_valid = 1;
 	}
@@ -8131,7 +9892,7 @@ static int should_drop_packets(struct ast_sockaddr *addr)
 #endif
 
 /*! \pre instance is locked */
-static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtcp)
+static struct ast_frame *rtp_read_packet(struct ast_rtp_instance *instance, int rtcp)
 {
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
 	struct ast_srtp *srtp;
@@ -8797,6 +10558,71 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 	return &ast_null_frame;
 }
 
+/*!
+ * \internal
+ * \brief Move the frames of a packet onto a list, copying any that point into our buffers
+ */
+static void rtp_frames_isolate(struct frame_list *frames, struct ast_frame *frame)
+{
+	struct ast_frame *next;
+
+	for (; frame; frame = next) {
+		next = AST_LIST_NEXT(frame, frame_list);
+		AST_LIST_NEXT(frame, frame_list) = NULL;
+
+		if (frame->frametype == AST_FRAME_NULL) {
+			ast_frfree(frame);
+			continue;
+		}
+		frame = ast_frisolate(frame);
+		if (frame) {
+			AST_LIST_INSERT_TAIL(frames, frame, frame_list);
+		}
+	}
+}
+
+/*! \pre instance is locked */
+static struct ast_frame *rtp_read(struct ast_rtp_instance *instance, int rtcp)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	struct frame_list frames;
+	struct ast_frame *frame;
+
+	frame = rtp_read_packet(instance, rtcp);
+	if (rtcp || !frame || !rtp_rx_batch_pending(rtp)) {
+		return frame;
+	}
+
+	/*
+	 * The socket will not wake us for packets that were read along with this
+	 * one, so they are handled now. Each packet is read over the frames of the
+	 * one before, which are copied out first.
+	 */
+	AST_LIST_HEAD_INIT_NOLOCK(&frames);
+	rtp_frames_isolate(&frames, frame);
+	while (rtp_rx_batch_pending(rtp)) {
+		frame = rtp_read_packet(instance, 0);
+		if (!frame) {
+			break;
+		}
+		rtp_frames_isolate(&frames, frame);
+	}
+
+	return AST_LIST_FIRST(&frames) ?: &ast_null_frame;
+}
+
+/*! \pre instance is locked */
+static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtcp)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+
+	if (!rtcp && rtp->media && rtp->media->worker) {
+		return media_worker_frames(rtp);
+	}
+
+	return rtp_read(instance, rtcp);
+}
+
 /*! \pre instance is locked */
 static void ast_rtp_prop_set(struct ast_rtp_instance *instance, enum ast_rtp_property property, int value)
 {
@@ -8821,6 +10647,7 @@ static void ast_rtp_prop_set(struct ast_rtp_instance *instance, enum ast_rtp_pro
 				rtp->rtcp->dtls.timeout_timer = -1;
 #endif
 				rtp->rtcp->schedid = -1;
+				rtp_stats_publish(instance);
 			}
 
 			rtp->rtcp->type = value;
@@ -8853,7 +10680,10 @@ static void ast_rtp_prop_set(struct ast_rtp_instance *instance, enum ast_rtp_pro
 				 * switching from MUX. Either way, we won't have
 				 * a socket set up, and we need to set it up
 				 */
-				if ((rtp->rtcp->s =
+				if (rtp->shared) {
+					/* The port after a shared RTP socket's is always ours */
+					rtp->rtcp->s = rtp->shared->shared->s[SHARED_RTCP];
+				} else if ((rtp->rtcp->s =
 				     create_new_socket("RTCP",
 						       ast_sockaddr_is_ipv4(&rtp->rtcp->us) ?
 						       AF_INET :
@@ -8867,7 +10697,7 @@ static void ast_rtp_prop_set(struct ast_rtp_instance *instance, enum ast_rtp_pro
 				}
 
 				/* Try to actually bind to the IP address and port we are going to use for RTCP, if this fails we have to bail out */
-				if (ast_bind(rtp->rtcp->s, &rtp->rtcp->us)) {
+				if (!rtp->shared && ast_bind(rtp->rtcp->s, &rtp->rtcp->us)) {
 					ast_debug_rtcp(1, "(%p) RTCP failed to setup RTP instance\n", instance);
 					close(rtp->rtcp->s);
 					ast_free(rtp->rtcp->local_addr_str);
@@ -8894,7 +10724,7 @@ static void ast_rtp_prop_set(struct ast_rtp_instance *instance, enum ast_rtp_pro
 				 * to activating RTP. It is not until RTP is activated that timers start for RTCP
 				 * transmission
 				 */
-				if (rtp->rtcp->s > -1 && rtp->rtcp->s != rtp->s) {
+				if (rtp->rtcp->s > -1 && rtp->rtcp->s != rtp->s && !rtp->shared) {
 					close(rtp->rtcp->s);
 				}
 				rtp->rtcp->s = rtp->s;
@@ -8938,7 +10768,7 @@ static void ast_rtp_prop_set(struct ast_rtp_instance *instance, enum ast_rtp_pro
 					ao2_lock(instance);
 					rtp->transport_wide_cc.schedid = -1;
 				}
-				if (rtp->rtcp->s > -1 && rtp->rtcp->s != rtp->s) {
+				if (rtp->rtcp->s > -1 && rtp->rtcp->s != rtp->s && !rtp->shared) {
 					close(rtp->rtcp->s);
 				}
 #if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
@@ -8991,6 +10821,22 @@ static int ast_rtp_fd(struct ast_rtp_instance *instance, int rtcp)
 {
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
 
+	if (!rtcp && rtp->media && rtp->media->worker) {
+		/* The frames a media worker read are waited for on its alert pipe */
+		return ast_alertpipe_readfd(rtp->media->alert);
+	}
+
+	if (rtp->shared) {
+		/* The packets of a shared socket are waited for on our alert pipes */
+		if (!rtcp) {
+			return ast_alertpipe_readfd(rtp->shared->alert[SHARED_RTP]);
+		}
+		if (!rtp->rtcp || rtp->rtcp->s < 0) {
+			return -1;
+		}
+		return ast_alertpipe_readfd(rtp->shared->alert[rtp->rtcp->s == rtp->s ? SHARED_RTP : SHARED_RTCP]);
+	}
+
 	return rtcp ? (rtp->rtcp ? rtp->rtcp->s : -1) : rtp->s;
 }
 
@@ -9035,6 +10881,14 @@ static void ast_rtp_remote_address_set(struct ast_rtp_instance *instance, struct
 		ast_rtp_instance_set_remote_address(mapping->instance, addr);
 	}
 
+	/* Packets read from a shared socket are told apart by where they come from */
+	if (rtp->shared) {
+		shared_member_set_remote(rtp->shared, addr);
+	}
+
+	/* The relay forwards to the old address, so take the packets back until bridged again */
+	rtp_relay_stop(rtp);
+
 	/* Need to reset the DTMF last sequence number and the timestamp of the last END packet */
 	rtp->last_seqno = 0;
 	rtp->last_end_timestamp.ts = 0;
@@ -9144,6 +10998,7 @@ static int rtp_red_buffer(struct ast_rtp_instance *instance, struct ast_frame *f
 static int ast_rtp_local_bridge(struct ast_rtp_instance *instance0, struct ast_rtp_instance *instance1)
 {
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance0);
+	int relay = 0;
 
 	ao2_lock(instance0);
 	ast_set_flag(rtp, FLAG_NEED_MARKER_BIT | FLAG_REQ_LOCAL_BRIDGE_BIT);
@@ -9163,8 +11018,36 @@ static int ast_rtp_local_bridge(struct ast_rtp_instance *instance0, struct ast_r
 		rtp->ssrc_saved = 1;
 	}
 
+	/*
+	 * Have a media worker forward the packets of a locally bridged instance,
+	 * so they no longer wake the channel, and hand them back once the bridge
+	 * ends.  The channel picks up the change with ast_rtp_instance_fd().
+	 */
+	if (instance1 && bridgemediaworkers && !rtp->shared && rtp->s > -1
+		&& !(rtp->media && rtp->media->worker)) {
+		if (!media_worker_join(instance0, rtp, bridgemediaworkers)) {
+			rtp->media_bridged = 1;
+			ast_debug_rtp(1, "(%p) RTP socket read by media worker %u while locally bridged\n",
+				instance0, rtp->media->worker->index);
+		}
+	} else if (!instance1 && rtp->media_bridged) {
+		media_worker_leave(rtp);
+		media_worker_flush(rtp->media);
+		rtp->media_bridged = 0;
+	}
+
+	/* Both instances are told of the bridge, the relay is set up for them once */
+	if (!instance1 || !rtp->relay || rtp->relay != ((struct ast_rtp *)ast_rtp_instance_get_data(instance1))->relay) {
+		rtp_relay_stop(rtp);
+		relay = instance1 && !ast_strlen_zero(relaycommand);
+	}
+
 	ao2_unlock(instance0);
 
+	if (relay) {
+		rtp_relay_start(instance0, instance1);
+	}
+
 	return 0;
 }
 
@@ -9233,6 +11116,62 @@ static int ast_rtp_get_stat(struct ast_rtp_instance *instance, struct ast_rtp_in
 	return 0;
 }
 
+/*!
+ * \brief Publish the current statistics for ast_rtp_sample_stats
+ *
+ * \pre instance is locked
+ */
+static void rtp_stats_publish(struct ast_rtp_instance *instance)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	struct ast_rtp_instance_stats stats = { 0, };
+
+	if (ast_rtp_get_stat(instance, &stats, AST_RTP_INSTANCE_STAT_ALL)) {
+		return;
+	}
+
+	/* Only ever written with the instance locked, readers retry if it changes under them */
+	ast_atomic_fetch_add(&rtp->stats_seq, 1, __ATOMIC_SEQ_CST);
+	memcpy(&rtp->stats_sample, &stats, sizeof(stats));
+	ast_atomic_fetch_add(&rtp->stats_seq, 1, __ATOMIC_SEQ_CST);
+}
+
+/*! \pre instance is NOT locked */
+static int ast_rtp_sample_stats(struct ast_rtp_instance *instance, struct ast_rtp_instance_stats *stats)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	unsigned int seq;
+
+	if (!rtp) {
+		return -1;
+	}
+
+	for (;;) {
+		seq = ast_atomic_load_n(&rtp->stats_seq, __ATOMIC_ACQUIRE);
+		if (!seq) {
+			/* RTCP was never set up, so there is nothing to report */
+			return -1;
+		}
+		if (seq & 1) {
+			sched_yield();
+			continue;
+		}
+		memcpy(stats, &rtp->stats_sample, sizeof(*stats));
+		if (ast_atomic_fetch_add(&rtp->stats_seq, 0, __ATOMIC_SEQ_CST) == seq) {
+			break;
+		}
+	}
+
+	/* The counters change with every packet so they are read as they are */
+	stats->txcount = ast_atomic_load_n(&rtp->txcount, __ATOMIC_RELAXED);
+	stats->rxcount = ast_atomic_load_n(&rtp->rxcount, __ATOMIC_RELAXED);
+	stats->txoctetcount = ast_atomic_load_n(&rtp->txoctetcount, __ATOMIC_RELAXED);
+	stats->rxoctetcount = ast_atomic_load_n(&rtp->rxoctetcount, __ATOMIC_RELAXED);
+	stats->remote_ssrc = ast_atomic_load_n(&rtp->themssrc, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
 /*! \pre Neither instance0 nor instance1 are locked */
 static int ast_rtp_dtmf_compatible(struct ast_channel *chan0, struct ast_rtp_instance *instance0, struct ast_channel *chan1, struct ast_rtp_instance *instance1)
 {
@@ -9405,6 +11344,10 @@ static void ast_rtp_set_remote_ssrc(struct ast_rtp_instance *instance, unsigned
 	rtp->themssrc = ssrc;
 	rtp->themssrc_valid = 1;
 
+	if (rtp->shared) {
+		shared_member_set_ssrc(rtp->shared, ssrc);
+	}
+
 	/* If this is bundled we need to update the SSRC mapping */
 	if (rtp->bundled) {
 		struct ast_rtp *bundled_rtp;
@@ -9722,6 +11665,18 @@ static char *handle_cli_rtp_settings(struct ast_cli_entry *e, int cmd, struct as
 	}
 
 	ast_cli(a->fd, "  Replay Protect:  %s\n", AST_CLI_YESNO(srtp_replay_protection));
+	ast_cli(a->fd, "  I/O Batch:       %u packets\n", iobatch);
+	ast_cli(a->fd, "  Shared Sockets:  %u\n", sharedsockets);
+	ast_cli(a->fd, "  Media Workers:   %u%s\n", mediaworkers,
+		mediaworkers && mediaworker_affinity ? " (pinned)" : "");
+	if (!mediaworkers) {
+		ast_cli(a->fd, "  Bridge Workers:  %u%s\n", bridgemediaworkers,
+			bridgemediaworkers && mediaworker_affinity ? " (pinned)" : "");
+	}
+	ast_cli(a->fd, "  Relay command:   %s\n", S_OR(relaycommand, "(none)"));
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+	ast_cli(a->fd, "  DTLS threads:    %u\n", dtls_threads);
+#endif
 #ifdef HAVE_PJPROJECT
 	ast_cli(a->fd, "  ICE support:     %s\n", AST_CLI_YESNO(icesupport));
 
@@ -9964,6 +11919,12 @@ static int rtp_reload(int reload, int by_external_config)
 	learning_min_sequential = DEFAULT_LEARNING_MIN_SEQUENTIAL;
 	learning_min_duration = DEFAULT_LEARNING_MIN_DURATION;
 	srtp_replay_protection = DEFAULT_SRTP_REPLAY_PROTECTION;
+	iobatch = DEFAULT_IO_BATCH;
+	sharedsockets = DEFAULT_SHARED_SOCKETS;
+	mediaworkers = DEFAULT_MEDIA_WORKERS;
+	mediaworker_affinity = 0;
+	bridgemediaworkers = DEFAULT_BRIDGE_MEDIA_WORKERS;
+	relaycommand[0] = '\0';
 
 	/** This resource is not "reloaded" so much as unloaded and loaded again.
 	 * In the case of the TURN related variables, the memory referenced by a
@@ -9986,6 +11947,7 @@ static int rtp_reload(int reload, int by_external_config)
 
 #if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
 	dtls_mtu = DEFAULT_DTLS_MTU;
+	dtls_threads = DEFAULT_DTLS_THREADS;
 #endif
 
 	if ((s = ast_variable_retrieve(cfg, "general", "rtpstart"))) {
@@ -10047,6 +12009,58 @@ static int rtp_reload(int reload, int by_external_config)
 	if ((s = ast_variable_retrieve(cfg, "general", "srtpreplayprotection"))) {
 		srtp_replay_protection = ast_true(s);
 	}
+	if ((s = ast_variable_retrieve(cfg, "general", "iobatch"))) {
+		if ((sscanf(s, "%u", &iobatch) != 1) || !iobatch || iobatch > MAXIMUM_IO_BATCH) {
+			ast_log(LOG_WARNING, "Value for 'iobatch' must be between 1 and %d, using default of '%d' instead\n",
+				MAXIMUM_IO_BATCH, DEFAULT_IO_BATCH);
+			iobatch = DEFAULT_IO_BATCH;
+		}
+#ifndef USE_IO_BATCH
+		if (iobatch > 1) {
+			ast_log(LOG_WARNING, "Batched RTP I/O is not supported on this platform, ignoring 'iobatch'\n");
+			iobatch = DEFAULT_IO_BATCH;
+		}
+#endif
+	}
+	if ((s = ast_variable_retrieve(cfg, "general", "sharedsockets"))) {
+		if ((sscanf(s, "%u", &sharedsockets) != 1) || sharedsockets > MAXIMUM_SHARED_SOCKETS) {
+			ast_log(LOG_WARNING, "Value for 'sharedsockets' must be between 0 and %d, using default of '%d' instead\n",
+				MAXIMUM_SHARED_SOCKETS, DEFAULT_SHARED_SOCKETS);
+			sharedsockets = DEFAULT_SHARED_SOCKETS;
+		}
+	}
+	if ((s = ast_variable_retrieve(cfg, "general", "mediaworkers"))) {
+		if ((sscanf(s, "%u", &mediaworkers) != 1) || mediaworkers > MAXIMUM_MEDIA_WORKERS) {
+			ast_log(LOG_WARNING, "Value for 'mediaworkers' must be between 0 and %d, using default of '%d' instead\n",
+				MAXIMUM_MEDIA_WORKERS, DEFAULT_MEDIA_WORKERS);
+			mediaworkers = DEFAULT_MEDIA_WORKERS;
+		}
+#ifndef USE_MEDIA_WORKERS
+		if (mediaworkers) {
+			ast_log(LOG_WARNING, "RTP media workers are not supported on this platform, ignoring 'mediaworkers'\n");
+			mediaworkers = DEFAULT_MEDIA_WORKERS;
+		}
+#endif
+	}
+	if ((s = ast_variable_retrieve(cfg, "general", "bridgemediaworkers"))) {
+		if ((sscanf(s, "%u", &bridgemediaworkers) != 1) || bridgemediaworkers > MAXIMUM_MEDIA_WORKERS) {
+			ast_log(LOG_WARNING, "Value for 'bridgemediaworkers' must be between 0 and %d, using default of '%d' instead\n",
+				MAXIMUM_MEDIA_WORKERS, DEFAULT_BRIDGE_MEDIA_WORKERS);
+			bridgemediaworkers = DEFAULT_BRIDGE_MEDIA_WORKERS;
+		}
+#ifndef USE_MEDIA_WORKERS
+		if (bridgemediaworkers) {
+			ast_log(LOG_WARNING, "RTP media workers are not supported on this platform, ignoring 'bridgemediaworkers'\n");
+			bridgemediaworkers = DEFAULT_BRIDGE_MEDIA_WORKERS;
+		}
+#endif
+	}
+	if ((s = ast_variable_retrieve(cfg, "general", "mediaworker_affinity"))) {
+		mediaworker_affinity = ast_true(s);
+	}
+	if ((s = ast_variable_retrieve(cfg, "general", "relaycommand"))) {
+		ast_copy_string(relaycommand, s, sizeof(relaycommand));
+	}
 #ifdef HAVE_PJPROJECT
 	if ((s = ast_variable_retrieve(cfg, "general", "icesupport"))) {
 		icesupport = ast_true(s);
@@ -10194,6 +12208,29 @@ static int rtp_reload(int reload, int by_external_config)
 			dtls_mtu = DEFAULT_DTLS_MTU;
 		}
 	}
+	if ((s = ast_variable_retrieve(cfg, "general", "dtls_threads"))) {
+		if ((sscanf(s, "%u", &dtls_threads) != 1) || dtls_threads > MAXIMUM_DTLS_THREADS) {
+			ast_log(LOG_WARNING, "Value for 'dtls_threads' could not be read or is above %d, using default of '%d' instead\n",
+				MAXIMUM_DTLS_THREADS, DEFAULT_DTLS_THREADS);
+			dtls_threads = DEFAULT_DTLS_THREADS;
+		}
+	}
+	if (dtls_threads && !dtls_threadpool) {
+		struct ast_threadpool_options options = {
+			.version = AST_THREADPOOL_OPTIONS_VERSION,
+			.idle_timeout = 0,
+			.auto_increment = 0,
+			.initial_size = dtls_threads,
+			.max_size = dtls_threads,
+		};
+
+		dtls_threadpool = ast_threadpool_create("rtp_dtls", NULL, &options);
+		if (!dtls_threadpool) {
+			ast_log(LOG_WARNING, "Could not create the DTLS threads, handling DTLS packets on the channel threads\n");
+		}
+	} else if (dtls_threads) {
+		ast_threadpool_set_size(dtls_threadpool, dtls_threads);
+	}
 #endif
 
 	ast_config_destroy(cfg);
@@ -10305,7 +12342,29 @@ static int load_module(void)
 	BIO_meth_set_destroy(dtls_bio_methods, dtls_bio_free);
 #endif
 
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+	dtls_certificates = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, 7,
+		dtls_certificate_hash_fn, NULL, dtls_certificate_cmp_fn);
+	if (!dtls_certificates) {
+#ifdef HAVE_OPENSSL_BIO_METHOD
+		BIO_meth_free(dtls_bio_methods);
+#endif
+#ifdef HAVE_PJPROJECT
+		rtp_terminate_pjproject();
+#endif
+		return AST_MODULE_LOAD_DECLINE;
+	}
+#ifdef SSL_CTRL_SET_TLSEXT_TICKET_KEYS
+	if (RAND_bytes(dtls_ticket_keys, sizeof(dtls_ticket_keys)) != 1) {
+		ast_log(LOG_WARNING, "Could not generate DTLS session ticket keys, tickets will not be shared\n");
+	}
+#endif
+#endif
+
 	if (ast_rtp_engine_register(&asterisk_rtp_engine)) {
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+		ao2_ref(dtls_certificates, -1);
+#endif
 #if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP) && defined(HAVE_OPENSSL_BIO_METHOD)
 		BIO_meth_free(dtls_bio_methods);
 #endif
@@ -10316,6 +12375,9 @@ static int load_module(void)
 	}
 
 	if (ast_cli_register_multiple(cli_rtp, ARRAY_LEN(cli_rtp))) {
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+		ao2_ref(dtls_certificates, -1);
+#endif
 #if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP) && defined(HAVE_OPENSSL_BIO_METHOD)
 		BIO_meth_free(dtls_bio_methods);
 #endif
@@ -10326,6 +12388,8 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	relay_tps = ast_taskprocessor_get("rtp_relay", TPS_REF_DEFAULT);
+
 	rtp_reload(0, 0);
 
 	return AST_MODULE_LOAD_SUCCESS;
@@ -10336,6 +12400,21 @@ static int unload_module(void)
 	ast_rtp_engine_unregister(&asterisk_rtp_engine);
 	ast_cli_unregister_multiple(cli_rtp, ARRAY_LEN(cli_rtp));
 
+	AST_VECTOR_CALLBACK_VOID(&shared_sockets, shared_socket_destroy);
+	AST_VECTOR_FREE(&shared_sockets);
+	AST_VECTOR_CALLBACK_VOID(&media_workers, media_worker_destroy);
+	AST_VECTOR_FREE(&media_workers);
+	relay_tps = ast_taskprocessor_unreference(relay_tps);
+
+#if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP)
+	if (dtls_threadpool) {
+		ast_threadpool_shutdown(dtls_threadpool);
+		dtls_threadpool = NULL;
+	}
+	ao2_cleanup(dtls_certificates);
+	dtls_certificates = NULL;
+#endif
+
 #if defined(HAVE_OPENSSL) && (OPENSSL_VERSION_NUMBER >= 0x10001000L) && !defined(OPENSSL_NO_SRTP) && defined(HAVE_OPENSSL_BIO_METHOD)
 	if (dtls_bio_methods) {
 		BIO_meth_free(dtls_bio_methods);
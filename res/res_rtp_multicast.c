@@ -518,8 +518,9 @@ static int multicast_rtp_write(struct ast_rtp_instance *instance, struct ast_fra
 	} else {
 		int hdrlen = 12;
 
-		/* If we do not have space to construct an RTP header duplicate the frame so we get some */
-		if (frame->offset < hdrlen) {
+		/* If we do not have space to construct an RTP header, or the space belongs to a
+		 * payload shared with other frames, duplicate the frame so we get some */
+		if (frame->offset < hdrlen || ast_frame_is_shared(frame)) {
 			f = ast_frdup(frame);
 		} else {
 			f = frame;
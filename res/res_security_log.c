@@ -114,20 +114,32 @@ static void security_event_stasis_cb(struct ast_json *json)
 	ast_log_dynamic_level(LOG_SECURITY, "%s\n", ast_str_buffer(str));
 }
 
+static void security_event_summary_stasis_cb(struct ast_json *json)
+{
+	ast_log_dynamic_level(LOG_SECURITY,
+		"SecurityEventSummary=\"%s\",Service=\"%s\",RemoteAddress=\"%s\",Count=\"%jd\",Suppressed=\"%jd\",Window=\"%jd\"\n",
+		ast_json_string_get(ast_json_object_get(json, "SecurityEvent")),
+		ast_json_string_get(ast_json_object_get(json, "Service")),
+		ast_json_string_get(ast_json_object_get(json, "RemoteAddress")),
+		ast_json_integer_get(ast_json_object_get(json, "Count")),
+		ast_json_integer_get(ast_json_object_get(json, "Suppressed")),
+		ast_json_integer_get(ast_json_object_get(json, "Window")));
+}
+
 static void security_stasis_cb(void *data, struct stasis_subscription *sub,
 	struct stasis_message *message)
 {
 	struct ast_json_payload *payload = stasis_message_data(message);
 
-	if (stasis_message_type(message) != ast_security_event_type()) {
-		return;
-	}
-
 	if (!payload) {
 		return;
 	}
 
-	security_event_stasis_cb(payload->json);
+	if (stasis_message_type(message) == ast_security_event_type()) {
+		security_event_stasis_cb(payload->json);
+	} else if (stasis_message_type(message) == ast_security_event_summary_type()) {
+		security_event_summary_stasis_cb(payload->json);
+	}
 }
 
 static int load_module(void)
@@ -142,6 +154,7 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 	stasis_subscription_accept_message_type(security_stasis_sub, ast_security_event_type());
+	stasis_subscription_accept_message_type(security_stasis_sub, ast_security_event_summary_type());
 	stasis_subscription_set_filter(security_stasis_sub, STASIS_SUBSCRIPTION_FILTER_SELECTIVE);
 
 	ast_verb(3, "Security Logging Enabled\n");
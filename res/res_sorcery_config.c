@@ -47,6 +47,9 @@ struct sorcery_config {
 	/*! \brief Objects retrieved from the configuration file */
 	struct ao2_global_obj objects;
 
+	/*! \brief Read-copy-update holder used for the objects instead, if enabled */
+	struct ao2_rcu_container *rcu;
+
 	/*! \brief Any specific variable criteria for considering a defined category for this object */
 	struct ast_variable *criteria;
 
@@ -97,6 +100,12 @@ static void *sorcery_config_open(const char *data);
 static void sorcery_config_load(void *data, const struct ast_sorcery *sorcery, const char *type);
 static void sorcery_config_reload(void *data, const struct ast_sorcery *sorcery, const char *type);
 static void *sorcery_config_retrieve_id(const struct ast_sorcery *sorcery, void *data, const char *type, const char *id);
+/*! \brief Get a reference to the objects currently loaded from the configuration file */
+static struct ao2_container *sorcery_config_objects(struct sorcery_config *config)
+{
+	return config->rcu ? ao2_rcu_container_ref(config->rcu) : ao2_global_obj_ref(config->objects);
+}
+
 static void *sorcery_config_retrieve_fields(const struct ast_sorcery *sorcery, void *data, const char *type, const struct ast_variable *fields);
 static void sorcery_config_retrieve_multiple(const struct ast_sorcery *sorcery, void *data, const char *type, struct ao2_container *objects,
 					     const struct ast_variable *fields);
@@ -125,6 +134,7 @@ static void sorcery_config_destructor(void *obj)
 
 	ao2_global_obj_release(config->objects);
 	ast_rwlock_destroy(&config->objects.lock);
+	ao2_cleanup(config->rcu);
 	ast_variables_destroy(config->criteria);
 	ast_free(config->explicit_name);
 }
@@ -170,7 +180,7 @@ static int sorcery_config_fields_cmp(void *obj, void *arg, int flags)
 static void *sorcery_config_retrieve_fields(const struct ast_sorcery *sorcery, void *data, const char *type, const struct ast_variable *fields)
 {
 	struct sorcery_config *config = data;
-	RAII_VAR(struct ao2_container *, objects, ao2_global_obj_ref(config->objects), ao2_cleanup);
+	RAII_VAR(struct ao2_container *, objects, sorcery_config_objects(config), ao2_cleanup);
 	struct sorcery_config_fields_cmp_params params = {
 		.sorcery = sorcery,
 		.fields = fields,
@@ -188,15 +198,20 @@ static void *sorcery_config_retrieve_fields(const struct ast_sorcery *sorcery, v
 static void *sorcery_config_retrieve_id(const struct ast_sorcery *sorcery, void *data, const char *type, const char *id)
 {
 	struct sorcery_config *config = data;
-	RAII_VAR(struct ao2_container *, objects, ao2_global_obj_ref(config->objects), ao2_cleanup);
+	RAII_VAR(struct ao2_container *, objects, NULL, ao2_cleanup);
+
+	if (config->rcu) {
+		return ao2_rcu_find(config->rcu, id, OBJ_SEARCH_KEY);
+	}
 
+	objects = ao2_global_obj_ref(config->objects);
 	return objects ? ao2_find(objects, id, OBJ_SEARCH_KEY) : NULL;
 }
 
 static void sorcery_config_retrieve_multiple(const struct ast_sorcery *sorcery, void *data, const char *type, struct ao2_container *objects, const struct ast_variable *fields)
 {
 	struct sorcery_config *config = data;
-	RAII_VAR(struct ao2_container *, config_objects, ao2_global_obj_ref(config->objects), ao2_cleanup);
+	RAII_VAR(struct ao2_container *, config_objects, sorcery_config_objects(config), ao2_cleanup);
 	struct sorcery_config_fields_cmp_params params = {
 		.sorcery = sorcery,
 		.fields = fields,
@@ -213,7 +228,7 @@ static void sorcery_config_retrieve_multiple(const struct ast_sorcery *sorcery,
 static void sorcery_config_retrieve_regex(const struct ast_sorcery *sorcery, void *data, const char *type, struct ao2_container *objects, const char *regex)
 {
 	struct sorcery_config *config = data;
-	RAII_VAR(struct ao2_container *, config_objects, ao2_global_obj_ref(config->objects), ao2_cleanup);
+	RAII_VAR(struct ao2_container *, config_objects, sorcery_config_objects(config), ao2_cleanup);
 	regex_t expression;
 	struct sorcery_config_fields_cmp_params params = {
 		.sorcery = sorcery,
@@ -236,7 +251,7 @@ static void sorcery_config_retrieve_regex(const struct ast_sorcery *sorcery, voi
 static void sorcery_config_retrieve_prefix(const struct ast_sorcery *sorcery, void *data, const char *type, struct ao2_container *objects, const char *prefix, const size_t prefix_len)
 {
 	struct sorcery_config *config = data;
-	RAII_VAR(struct ao2_container *, config_objects, ao2_global_obj_ref(config->objects), ao2_cleanup);
+	RAII_VAR(struct ao2_container *, config_objects, sorcery_config_objects(config), ao2_cleanup);
 	struct sorcery_config_fields_cmp_params params = {
 		.sorcery = sorcery,
 		.container = objects,
@@ -443,7 +458,11 @@ static void sorcery_config_internal_load(void *data, const struct ast_sorcery *s
 	}
 
 	config->has_dynamic_contents = has_dynamic_contents;
-	ao2_global_obj_replace_unref(config->objects, objects);
+	if (config->rcu) {
+		ao2_rcu_container_publish(config->rcu, objects);
+	} else {
+		ao2_global_obj_replace_unref(config->objects, objects);
+	}
 	ast_config_destroy(cfg);
 }
 
@@ -529,6 +548,13 @@ static void *sorcery_config_open(const char *data)
 				return NULL;
 			}
 			config->single_object = ast_true(value);
+		} else if (!strcasecmp(name, "rcu")) {
+			if (ast_true(value) && !config->rcu && !(config->rcu = ao2_rcu_container_alloc(NULL))) {
+				ast_log(LOG_ERROR, "Could not create read-copy-update holder for configuration file '%s'\n",
+					filename);
+				ao2_ref(config, -1);
+				return NULL;
+			}
 		} else {
 			ast_log(LOG_ERROR, "Unsupported option '%s' used for configuration file '%s'\n", name, filename);
 		}
@@ -35,10 +35,20 @@
 #include "asterisk/module.h"
 #include "asterisk/sorcery.h"
 #include "asterisk/astobj2.h"
+#include "asterisk/test.h"
 
 /*! \brief Number of buckets for sorcery objects */
 #define OBJECT_BUCKETS 53
 
+/*! \brief Structure for storing in-memory objects */
+struct sorcery_memory {
+	/*! \brief Objects, when they are not kept in read-copy-update snapshots */
+	struct ao2_container *objects;
+
+	/*! \brief Read-copy-update holder for the objects, if enabled */
+	struct ao2_rcu_container *rcu;
+};
+
 static void *sorcery_memory_open(const char *data);
 static int sorcery_memory_create(const struct ast_sorcery *sorcery, void *data, void *object);
 static void *sorcery_memory_retrieve_id(const struct ast_sorcery *sorcery, void *data, const char *type, const char *id);
@@ -102,26 +112,75 @@ static int sorcery_memory_cmp(void *obj, void *arg, int flags)
 	return !strcmp(ast_sorcery_object_get_id(obj), flags & OBJ_KEY ? id : ast_sorcery_object_get_id(arg)) ? CMP_MATCH | CMP_STOP : 0;
 }
 
+/*!
+ * \brief Copy the current snapshot so it can be modified and published
+ *
+ * \note The read-copy-update holder must be locked.
+ */
+static struct ao2_container *sorcery_memory_snapshot_copy(struct sorcery_memory *memory)
+{
+	RAII_VAR(struct ao2_container *, current, ao2_rcu_container_ref(memory->rcu), ao2_cleanup);
+
+	return ao2_container_clone(current, 0);
+}
+
+/*! \brief Create an object in the read-copy-update snapshot */
+static int sorcery_memory_rcu_create(struct sorcery_memory *memory, void *object)
+{
+	RAII_VAR(void *, existing, NULL, ao2_cleanup);
+	RAII_VAR(struct ao2_container *, copy, NULL, ao2_cleanup);
+
+	ao2_lock(memory->rcu);
+
+	existing = ao2_rcu_find(memory->rcu, ast_sorcery_object_get_id(object), OBJ_KEY);
+	if (existing || !(copy = sorcery_memory_snapshot_copy(memory)) || ao2_link(copy, object) == 0) {
+		ao2_unlock(memory->rcu);
+		return -1;
+	}
+
+	ao2_rcu_container_publish(memory->rcu, copy);
+
+	ao2_unlock(memory->rcu);
+
+	return 0;
+}
+
 static int sorcery_memory_create(const struct ast_sorcery *sorcery, void *data, void *object)
 {
+	struct sorcery_memory *memory = data;
 	void *existing;
 
-	ao2_lock(data);
+	if (memory->rcu) {
+		return sorcery_memory_rcu_create(memory, object);
+	}
+
+	ao2_lock(memory->objects);
 
-	existing = ao2_find(data, ast_sorcery_object_get_id(object), OBJ_KEY | OBJ_NOLOCK);
+	existing = ao2_find(memory->objects, ast_sorcery_object_get_id(object), OBJ_KEY | OBJ_NOLOCK);
 	if (existing) {
 		ao2_ref(existing, -1);
-		ao2_unlock(data);
+		ao2_unlock(memory->objects);
 		return -1;
 	}
 
-	ao2_link_flags(data, object, OBJ_NOLOCK);
+	ao2_link_flags(memory->objects, object, OBJ_NOLOCK);
 
-	ao2_unlock(data);
+	ao2_unlock(memory->objects);
 
 	return 0;
 }
 
+/*! \brief Search the objects using the given callback */
+static void *sorcery_memory_callback(struct sorcery_memory *memory, enum search_flags flags,
+	ao2_callback_fn *cb_fn, void *arg)
+{
+	if (memory->rcu) {
+		return ao2_rcu_callback(memory->rcu, flags, cb_fn, arg);
+	}
+
+	return ao2_callback(memory->objects, flags, cb_fn, arg);
+}
+
 static int sorcery_memory_fields_cmp(void *obj, void *arg, int flags)
 {
 	const struct sorcery_memory_fields_cmp_params *params = arg;
@@ -171,12 +230,18 @@ static void *sorcery_memory_retrieve_fields(const struct ast_sorcery *sorcery, v
 		return NULL;
 	}
 
-	return ao2_callback(data, 0, sorcery_memory_fields_cmp, &params);
+	return sorcery_memory_callback(data, 0, sorcery_memory_fields_cmp, &params);
 }
 
 static void *sorcery_memory_retrieve_id(const struct ast_sorcery *sorcery, void *data, const char *type, const char *id)
 {
-	return ao2_find(data, id, OBJ_KEY);
+	struct sorcery_memory *memory = data;
+
+	if (memory->rcu) {
+		return ao2_rcu_find(memory->rcu, id, OBJ_KEY);
+	}
+
+	return ao2_find(memory->objects, id, OBJ_KEY);
 }
 
 static void sorcery_memory_retrieve_multiple(const struct ast_sorcery *sorcery, void *data, const char *type, struct ao2_container *objects, const struct ast_variable *fields)
@@ -187,7 +252,7 @@ static void sorcery_memory_retrieve_multiple(const struct ast_sorcery *sorcery,
 		.container = objects,
 	};
 
-	ao2_callback(data, 0, sorcery_memory_fields_cmp, &params);
+	sorcery_memory_callback(data, 0, sorcery_memory_fields_cmp, &params);
 }
 
 static void sorcery_memory_retrieve_regex(const struct ast_sorcery *sorcery, void *data, const char *type, struct ao2_container *objects, const char *regex)
@@ -207,7 +272,7 @@ static void sorcery_memory_retrieve_regex(const struct ast_sorcery *sorcery, voi
 		return;
 	}
 
-	ao2_callback(data, 0, sorcery_memory_fields_cmp, &params);
+	sorcery_memory_callback(data, 0, sorcery_memory_fields_cmp, &params);
 	regfree(&expression);
 }
 
@@ -220,38 +285,127 @@ static void sorcery_memory_retrieve_prefix(const struct ast_sorcery *sorcery, vo
 		.prefix_len = prefix_len,
 	};
 
-	ao2_callback(data, 0, sorcery_memory_fields_cmp, &params);
+	sorcery_memory_callback(data, 0, sorcery_memory_fields_cmp, &params);
+}
+
+/*!
+ * \brief Replace or remove an object in the read-copy-update snapshot
+ *
+ * \param memory The in-memory objects
+ * \param object The object to replace or remove
+ * \param replace Non-zero to link the object in place of the existing one
+ */
+static int sorcery_memory_rcu_replace(struct sorcery_memory *memory, void *object, int replace)
+{
+	RAII_VAR(void *, existing, NULL, ao2_cleanup);
+	RAII_VAR(struct ao2_container *, copy, NULL, ao2_cleanup);
+
+	ao2_lock(memory->rcu);
+
+	if (!(copy = sorcery_memory_snapshot_copy(memory))
+		|| !(existing = ao2_find(copy, ast_sorcery_object_get_id(object), OBJ_KEY | OBJ_UNLINK))
+		|| (replace && ao2_link(copy, object) == 0)) {
+		ao2_unlock(memory->rcu);
+		return -1;
+	}
+
+	ao2_rcu_container_publish(memory->rcu, copy);
+
+	ao2_unlock(memory->rcu);
+
+	return 0;
 }
 
 static int sorcery_memory_update(const struct ast_sorcery *sorcery, void *data, void *object)
 {
+	struct sorcery_memory *memory = data;
 	RAII_VAR(void *, existing, NULL, ao2_cleanup);
 
-	ao2_lock(data);
+	if (memory->rcu) {
+		return sorcery_memory_rcu_replace(memory, object, 1);
+	}
+
+	ao2_lock(memory->objects);
 
-	if (!(existing = ao2_find(data, ast_sorcery_object_get_id(object), OBJ_KEY | OBJ_UNLINK))) {
-		ao2_unlock(data);
+	if (!(existing = ao2_find(memory->objects, ast_sorcery_object_get_id(object), OBJ_KEY | OBJ_UNLINK))) {
+		ao2_unlock(memory->objects);
 		return -1;
 	}
 
-	ao2_link(data, object);
+	ao2_link(memory->objects, object);
 
-	ao2_unlock(data);
+	ao2_unlock(memory->objects);
 
 	return 0;
 }
 
 static int sorcery_memory_delete(const struct ast_sorcery *sorcery, void *data, void *object)
 {
-	RAII_VAR(void *, existing, ao2_find(data, ast_sorcery_object_get_id(object), OBJ_KEY | OBJ_UNLINK), ao2_cleanup);
+	struct sorcery_memory *memory = data;
+	RAII_VAR(void *, existing, NULL, ao2_cleanup);
+
+	if (memory->rcu) {
+		return sorcery_memory_rcu_replace(memory, object, 0);
+	}
+
+	existing = ao2_find(memory->objects, ast_sorcery_object_get_id(object), OBJ_KEY | OBJ_UNLINK);
 
 	return existing ? 0 : -1;
 }
 
+static void sorcery_memory_destructor(void *obj)
+{
+	struct sorcery_memory *memory = obj;
+
+	ao2_cleanup(memory->objects);
+	ao2_cleanup(memory->rcu);
+}
+
 static void *sorcery_memory_open(const char *data)
 {
-	return ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, OBJECT_BUCKETS,
-		sorcery_memory_hash, NULL, sorcery_memory_cmp);
+	struct sorcery_memory *memory;
+	struct ao2_container *objects;
+	char *options = ast_strdupa(S_OR(data, ""));
+	char *option;
+	int rcu = 0;
+
+	/*
+	 * Callers such as the PJSIP config wizard pass their own name as the data
+	 * of the wizards they map, so anything not understood is ignored.
+	 */
+	while ((option = ast_strsep(&options, ',', AST_STRSEP_STRIP))) {
+		if (!strcasecmp(option, "rcu")) {
+			rcu = 1;
+		} else if (!ast_strlen_zero(option)) {
+			ast_debug(3, "Ignoring option '%s' of in-memory objects\n", option);
+		}
+	}
+
+	memory = ao2_alloc_options(sizeof(*memory), sorcery_memory_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!memory) {
+		return NULL;
+	}
+
+	/* Published snapshots are never modified so they need no lock */
+	objects = ao2_container_alloc_hash(rcu ? AO2_ALLOC_OPT_LOCK_NOLOCK : AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+		OBJECT_BUCKETS, sorcery_memory_hash, NULL, sorcery_memory_cmp);
+	if (!objects) {
+		ao2_ref(memory, -1);
+		return NULL;
+	}
+
+	if (rcu) {
+		memory->rcu = ao2_rcu_container_alloc(objects);
+		ao2_ref(objects, -1);
+		if (!memory->rcu) {
+			ao2_ref(memory, -1);
+			return NULL;
+		}
+	} else {
+		memory->objects = objects;
+	}
+
+	return memory;
 }
 
 static void sorcery_memory_close(void *data)
@@ -259,17 +413,125 @@ static void sorcery_memory_close(void *data)
 	ao2_ref(data, -1);
 }
 
+#ifdef TEST_FRAMEWORK
+
+/*! \brief Dummy sorcery object */
+struct test_sorcery_object {
+	SORCERY_OBJECT(details);
+};
+
+/*!
+ * \internal
+ * \brief Allocator for test object
+ *
+ * \param id The identifier for the object
+ *
+ * \retval non-NULL success
+ * \retval NULL failure
+ */
+static void *test_sorcery_object_alloc(const char *id)
+{
+	return ast_sorcery_generic_alloc(sizeof(struct test_sorcery_object), NULL);
+}
+
+AST_TEST_DEFINE(open_with_unknown_options)
+{
+	int res = AST_TEST_FAIL;
+	struct ast_sorcery *sorcery = NULL;
+	struct sorcery_memory *memory = NULL;
+	void *object = NULL;
+	void *retrieved = NULL;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "open_with_unknown_options";
+		info->category = "/res/res_sorcery_memory/";
+		info->summary = "Open in-memory objects with data they do not understand";
+		info->description = "This test performs the following:\n"
+			"\t* Opens in-memory objects with the data the PJSIP config wizard passes\n"
+			"\t  followed by rcu, and verifies they are kept in read-copy-update snapshots\n"
+			"\t* Creates an object and retrieves it from the snapshot\n"
+			"\t* Opens in-memory objects with only the unknown data and verifies they\n"
+			"\t  are kept in a plain container";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	memory = sorcery_memory_open("pjsip_wizard,rcu");
+	if (!memory) {
+		ast_test_status_update(test, "Failed to open in-memory objects with 'pjsip_wizard,rcu'\n");
+		goto cleanup;
+	}
+	if (!memory->rcu || memory->objects) {
+		ast_test_status_update(test, "Opened in-memory objects with 'pjsip_wizard,rcu' but they are not kept in snapshots\n");
+		goto cleanup;
+	}
+
+	if (!(sorcery = ast_sorcery_open())) {
+		ast_test_status_update(test, "Failed to open a sorcery instance\n");
+		goto cleanup;
+	}
+	if ((ast_sorcery_apply_default(sorcery, "test", "memory", NULL) != AST_SORCERY_APPLY_SUCCESS) ||
+		ast_sorcery_internal_object_register(sorcery, "test", test_sorcery_object_alloc, NULL, NULL)) {
+		ast_test_status_update(test, "Failed to register the test object type\n");
+		goto cleanup;
+	}
+	if (!(object = ast_sorcery_alloc(sorcery, "test", "blah"))) {
+		ast_test_status_update(test, "Failed to allocate a test object\n");
+		goto cleanup;
+	}
+	if (sorcery_memory_create(sorcery, memory, object)) {
+		ast_test_status_update(test, "Failed to create a test object in the snapshot\n");
+		goto cleanup;
+	}
+	retrieved = sorcery_memory_retrieve_id(sorcery, memory, "test", "blah");
+	if (retrieved != object) {
+		ast_test_status_update(test, "Failed to retrieve the test object from the snapshot\n");
+		goto cleanup;
+	}
+	sorcery_memory_close(memory);
+
+	memory = sorcery_memory_open("pjsip_wizard");
+	if (!memory) {
+		ast_test_status_update(test, "Failed to open in-memory objects with 'pjsip_wizard'\n");
+		goto cleanup;
+	}
+	if (memory->rcu || !memory->objects) {
+		ast_test_status_update(test, "Opened in-memory objects with 'pjsip_wizard' but they are kept in snapshots\n");
+		goto cleanup;
+	}
+
+	res = AST_TEST_PASS;
+
+cleanup:
+	if (memory) {
+		sorcery_memory_close(memory);
+	}
+	ao2_cleanup(retrieved);
+	ao2_cleanup(object);
+	ast_sorcery_unref(sorcery);
+
+	return res;
+}
+
+#endif
+
 static int load_module(void)
 {
 	if (ast_sorcery_wizard_register(&memory_object_wizard)) {
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	AST_TEST_REGISTER(open_with_unknown_options);
+
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
 static int unload_module(void)
 {
+	AST_TEST_UNREGISTER(open_with_unknown_options);
+
 	ast_sorcery_wizard_unregister(&memory_object_wizard);
 	return 0;
 }
@@ -135,6 +135,18 @@ struct sorcery_memory_cache {
 	unsigned int object_lifetime_maximum;
 	/*! \brief The amount of time (in seconds) before an object is marked as stale, 0 if disabled */
 	unsigned int object_lifetime_stale;
+	/*! \brief The amount of time (in seconds) before expiring in which retrieved objects are refreshed, 0 if disabled */
+	unsigned int object_lifetime_prefetch;
+	/*! \brief The number of object refreshes queued and not yet done */
+	int refreshes_pending;
+	/*! \brief The number of retrievals by id that found the object in the cache */
+	int hits;
+	/*! \brief The number of retrievals by id that did not find the object in the cache */
+	int misses;
+	/*! \brief The number of retrievals that found a stale object */
+	int stale_hits;
+	/*! \brief The number of retrievals that refreshed an object ahead of its expiration */
+	int prefetches;
 	/*! \brief Whether all objects are expired when the object type is reloaded, 0 if disabled */
 	unsigned int expire_on_reload;
 	/*! \brief Whether this is a cache of the entire backend, 0 if disabled */
@@ -173,6 +185,8 @@ struct sorcery_memory_cached_object {
 	ssize_t __heap_index;
 	/*! \brief scheduler id of stale update task */
 	int stale_update_sched_id;
+	/*! \brief How long (in milliseconds) after creation a retrieval refreshes the object, 0 if never */
+	int64_t prefetch_after;
 	/*! \brief Cached objectset for field and regex retrieval */
 	struct ast_variable *objectset;
 };
@@ -237,6 +251,9 @@ static struct ast_sorcery_wizard memory_cache_object_wizard = {
 /*! \brief Height of heap for cache object heap. Allows 31 initial objects */
 #define CACHE_HEAP_INIT_HEIGHT 5
 
+/*! \brief The number of object refreshes queued past which objects are no longer prefetched */
+#define CACHE_PREFETCH_MAXIMUM_PENDING 16
+
 /*! \brief Container of created caches */
 static struct ao2_container *caches;
 
@@ -413,6 +430,40 @@ static int sorcery_memory_cached_object_cmp(void *obj, void *arg, int flags)
 	return cmp ? 0 : CMP_MATCH;
 }
 
+/*!
+ * \internal
+ * \brief Sort function for the container holding the objects of a full backend cache
+ *
+ * \param obj_left A cached object
+ * \param obj_right A cached object, or id or id prefix of one
+ * \param flags Sort flags
+ *
+ * \retval <0 if obj_left sorts before obj_right
+ * \retval 0 if the ids are the same, or the id of obj_left starts with the prefix
+ * \retval >0 if obj_left sorts after obj_right
+ */
+static int sorcery_memory_cached_object_sort(const void *obj_left, const void *obj_right, int flags)
+{
+	const struct sorcery_memory_cached_object *left = obj_left;
+	const struct sorcery_memory_cached_object *right = obj_right;
+	const char *right_name = obj_right;
+	int cmp;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	default:
+	case OBJ_SEARCH_OBJECT:
+		right_name = ast_sorcery_object_get_id(right->object);
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		cmp = strcmp(ast_sorcery_object_get_id(left->object), right_name);
+		break;
+	case OBJ_SEARCH_PARTIAL_KEY:
+		cmp = strncmp(ast_sorcery_object_get_id(left->object), right_name, strlen(right_name));
+		break;
+	}
+	return cmp;
+}
+
 /*!
  * \internal
  * \brief Destructor function for a sorcery memory cache
@@ -777,6 +828,16 @@ static struct sorcery_memory_cached_object *sorcery_memory_cached_object_alloc(c
 	cached->created = ast_tvnow();
 	cached->stale_update_sched_id = -1;
 
+	if (cache->object_lifetime_prefetch && cache->object_lifetime_maximum) {
+		int64_t window = MIN(cache->object_lifetime_prefetch, cache->object_lifetime_maximum) * 1000;
+
+		/* The point in the window at which each object is refreshed is picked at random so
+		 * objects cached together are not all refreshed together.
+		 */
+		cached->prefetch_after = cache->object_lifetime_maximum * 1000 - window
+			+ ast_random() % (window / 2 + 1);
+	}
+
 	if (cache->full_backend_cache) {
 		/* A cached objectset allows us to easily perform all retrieval operations in a
 		 * minimal of time.
@@ -1015,6 +1076,7 @@ static int stale_item_update(const void *data)
 		task_data->cache->name, ast_sorcery_object_get_type(task_data->object),
 		ast_sorcery_object_get_id(task_data->object));
 
+	ast_atomic_fetchadd_int(&task_data->cache->refreshes_pending, -1);
 	ao2_ref(task_data, -1);
 	end_passthru_update();
 
@@ -1135,10 +1197,14 @@ static void memory_cache_stale_update_object(const struct ast_sorcery *sorcery,
 		if (task_data) {
 			ast_debug(1, "Cached sorcery object type '%s' ID '%s' is stale. Refreshing\n",
 				ast_sorcery_object_get_type(cached->object), ast_sorcery_object_get_id(cached->object));
+			ast_atomic_fetchadd_int(&cache->refreshes_pending, +1);
 			cached->stale_update_sched_id = ast_sched_add(sched, 1,
 				stale_item_update, task_data);
 		}
 		if (cached->stale_update_sched_id < 0) {
+			if (task_data) {
+				ast_atomic_fetchadd_int(&cache->refreshes_pending, -1);
+			}
 			ao2_cleanup(task_data);
 			ast_log(LOG_ERROR, "Unable to update stale cached object type '%s', ID '%s'.\n",
 				ast_sorcery_object_get_type(cached->object), ast_sorcery_object_get_id(cached->object));
@@ -1149,7 +1215,12 @@ static void memory_cache_stale_update_object(const struct ast_sorcery *sorcery,
 
 /*!
  * \internal
- * \brief Check whether an object (or cache) is stale and queue an update
+ * \brief Check whether an object (or cache) is stale or about to expire and queue an update
+ *
+ * An object retrieved shortly before it expires is in use, so it is refreshed in the
+ * background while the cached one is still returned, instead of having the next
+ * retrieval after it expires wait on the backend.  These refreshes are skipped while
+ * many are already queued.
  *
  * \param sorcery The sorcery instance
  * \param cache The sorcery memory cache
@@ -1158,16 +1229,21 @@ static void memory_cache_stale_update_object(const struct ast_sorcery *sorcery,
 static void memory_cache_stale_check_object(const struct ast_sorcery *sorcery, struct sorcery_memory_cache *cache,
 	struct sorcery_memory_cached_object *cached)
 {
-	struct timeval elapsed;
+	int64_t elapsed;
 
-	if (!cache->object_lifetime_stale) {
+	if (!cache->object_lifetime_stale && !cached->prefetch_after) {
 		return;
 	}
 
 	/* For a full cache as every object has the same expiration/staleness we can do the same check */
-	elapsed = ast_tvsub(ast_tvnow(), cached->created);
+	elapsed = ast_tvdiff_ms(ast_tvnow(), cached->created);
 
-	if (elapsed.tv_sec < cache->object_lifetime_stale) {
+	if (cache->object_lifetime_stale && elapsed >= cache->object_lifetime_stale * 1000) {
+		ast_atomic_fetchadd_int(&cache->stale_hits, +1);
+	} else if (cached->prefetch_after && elapsed >= cached->prefetch_after
+		&& cache->refreshes_pending < CACHE_PREFETCH_MAXIMUM_PENDING) {
+		ast_atomic_fetchadd_int(&cache->prefetches, +1);
+	} else {
 		return;
 	}
 
@@ -1230,8 +1306,10 @@ static void *sorcery_memory_cache_retrieve_id(const struct ast_sorcery *sorcery,
 
 	cached = ao2_find(cache->objects, id, OBJ_SEARCH_KEY);
 	if (!cached) {
+		ast_atomic_fetchadd_int(&cache->misses, +1);
 		return NULL;
 	}
+	ast_atomic_fetchadd_int(&cache->hits, +1);
 
 	ast_assert(!strcmp(ast_sorcery_object_get_id(cached->object), id));
 
@@ -1323,6 +1401,52 @@ static void *sorcery_memory_cache_retrieve_fields(const struct ast_sorcery *sorc
 	return object;
 }
 
+/*!
+ * \internal
+ * \brief AO2 callback function for comparing a retrieval request on an id prefix range
+ *
+ * \param obj The cached object
+ * \param arg The id prefix the range was searched with
+ * \param data The comparison parameters
+ * \param flags Unused flags
+ */
+static int sorcery_memory_cache_fields_cmp_range(void *obj, void *arg, void *data, int flags)
+{
+	return sorcery_memory_cache_fields_cmp(obj, data, flags);
+}
+
+/*!
+ * \internal
+ * \brief Get the literal text every id matched by a regular expression starts with
+ *
+ * \param regex The extended regular expression
+ *
+ * \return The literal prefix, an empty string if the expression is not anchored to one
+ */
+static char *regex_literal_prefix(const char *regex)
+{
+	char *prefix;
+	size_t len;
+
+	/* An alternation may apply to the anchor itself */
+	if (regex[0] != '^' || strchr(regex, '|')) {
+		return ast_strdup("");
+	}
+
+	++regex;
+	len = strcspn(regex, ".[]()*+?{}\\^$");
+	/* A repetition applies to the character before it, which may then not be there */
+	if (len && strchr("*?{", regex[len])) {
+		--len;
+	}
+
+	prefix = ast_malloc(len + 1);
+	if (prefix) {
+		ast_copy_string(prefix, regex, len + 1);
+	}
+	return prefix;
+}
+
 /*!
  * \internal
  * \brief Callback function to retrieve multiple objects from a memory cache
@@ -1371,6 +1495,7 @@ static void sorcery_memory_cache_retrieve_regex(const struct ast_sorcery *sorcer
 {
 	struct sorcery_memory_cache *cache = data;
 	regex_t expression;
+	char *prefix;
 	struct sorcery_memory_cache_fields_cmp_params params = {
 		.sorcery = sorcery,
 		.cache = cache,
@@ -1378,13 +1503,25 @@ static void sorcery_memory_cache_retrieve_regex(const struct ast_sorcery *sorcer
 		.regex = &expression,
 	};
 
-	if (is_passthru_update() || !cache->full_backend_cache || regcomp(&expression, regex, REG_EXTENDED | REG_NOSUB)) {
+	if (is_passthru_update() || !cache->full_backend_cache) {
+		return;
+	}
+
+	prefix = regex_literal_prefix(regex);
+	if (!prefix) {
+		return;
+	}
+	if (regcomp(&expression, regex, REG_EXTENDED | REG_NOSUB)) {
+		ast_free(prefix);
 		return;
 	}
 
 	memory_cache_full_update(sorcery, type, cache);
-	ao2_callback(cache->objects, 0, sorcery_memory_cache_fields_cmp, &params);
+	/* Only the ids starting with the literal the expression is anchored to can match */
+	ao2_callback_data(cache->objects, OBJ_SEARCH_PARTIAL_KEY | OBJ_NODATA | OBJ_MULTIPLE,
+		sorcery_memory_cache_fields_cmp_range, prefix, &params);
 	regfree(&expression);
+	ast_free(prefix);
 
 	if (ao2_container_count(objects)) {
 		memory_cache_stale_check(sorcery, cache);
@@ -1412,13 +1549,18 @@ static void sorcery_memory_cache_retrieve_prefix(const struct ast_sorcery *sorce
 		.prefix = prefix,
 		.prefix_len = prefix_len,
 	};
+	char *key;
 
 	if (is_passthru_update() || !cache->full_backend_cache) {
 		return;
 	}
 
+	key = ast_alloca(prefix_len + 1);
+	ast_copy_string(key, prefix, prefix_len + 1);
+
 	memory_cache_full_update(sorcery, type, cache);
-	ao2_callback(cache->objects, 0, sorcery_memory_cache_fields_cmp, &params);
+	ao2_callback_data(cache->objects, OBJ_SEARCH_PARTIAL_KEY | OBJ_NODATA | OBJ_MULTIPLE,
+		sorcery_memory_cache_fields_cmp_range, key, &params);
 
 	if (ao2_container_count(objects)) {
 		memory_cache_stale_check(sorcery, cache);
@@ -1549,6 +1691,12 @@ static void *sorcery_memory_cache_open(const char *data)
 					value);
 				return NULL;
 			}
+		} else if (!strcasecmp(name, "object_lifetime_prefetch")) {
+			if (configuration_parse_unsigned_integer(value, &cache->object_lifetime_prefetch) != 1) {
+				ast_log(LOG_ERROR, "Unsupported object prefetch lifetime value of '%s' used for memory cache\n",
+					value);
+				return NULL;
+			}
 		} else if (!strcasecmp(name, "expire_on_reload")) {
 			cache->expire_on_reload = ast_true(value);
 		} else if (!strcasecmp(name, "full_backend_cache")) {
@@ -1559,9 +1707,17 @@ static void *sorcery_memory_cache_open(const char *data)
 		}
 	}
 
-	cache->objects = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
-		cache->maximum_objects ? cache->maximum_objects : CACHE_CONTAINER_BUCKET_SIZE,
-		sorcery_memory_cached_object_hash, NULL, sorcery_memory_cached_object_cmp);
+	/* A full backend cache answers prefix and regex retrievals, which are served
+	 * from a range of ids when they are kept in order.
+	 */
+	if (cache->full_backend_cache) {
+		cache->objects = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+			sorcery_memory_cached_object_sort, sorcery_memory_cached_object_cmp);
+	} else {
+		cache->objects = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+			cache->maximum_objects ? cache->maximum_objects : CACHE_CONTAINER_BUCKET_SIZE,
+			sorcery_memory_cached_object_hash, NULL, sorcery_memory_cached_object_cmp);
+	}
 	if (!cache->objects) {
 		ast_log(LOG_ERROR, "Could not create a container to hold cached objects for memory cache\n");
 		return NULL;
@@ -1722,7 +1878,17 @@ static char *sorcery_memory_cache_show(struct ast_cli_entry *e, int cmd, struct
 	} else {
 		ast_cli(a->fd, "Object staleness is not enabled - cached objects will not go stale\n");
 	}
+	if (cache->object_lifetime_prefetch && cache->object_lifetime_maximum) {
+		ast_cli(a->fd, "Number of seconds before expiring in which retrieved objects are refreshed: %d\n",
+			cache->object_lifetime_prefetch);
+	} else {
+		ast_cli(a->fd, "Object prefetch is not enabled - cached objects will not be refreshed before expiring\n");
+	}
 	ast_cli(a->fd, "Expire all objects on reload: %s\n", AST_CLI_ONOFF(cache->expire_on_reload));
+	ast_cli(a->fd, "Retrievals by id found in cache: %d\n", cache->hits);
+	ast_cli(a->fd, "Retrievals by id not found in cache: %d\n", cache->misses);
+	ast_cli(a->fd, "Retrievals of stale objects: %d\n", cache->stale_hits);
+	ast_cli(a->fd, "Objects refreshed before expiring: %d\n", cache->prefetches);
 
 	ao2_ref(cache, -1);
 
@@ -33,9 +33,12 @@
 #include "asterisk/format.h"
 #include "asterisk/format_cap.h"
 #include "asterisk/json.h"
+#include "asterisk/linkedlists.h"
 #include "asterisk/module.h"
 #include "asterisk/speech.h"
 #include "asterisk/sorcery.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/uuid.h"
 
 #include "asterisk/res_aeap.h"
 #include "asterisk/res_aeap_message.h"
@@ -45,9 +48,60 @@
 
 #define CONNECTION_TIMEOUT 2000
 
+/*! Audio waiting to be sent beyond this many writes is dropped */
+#define WRITE_BACKLOG_MAX 100
+
+#define CONNECTION_BUCKETS 31
+
 #define log_error(obj, fmt, ...) \
 	ast_log(LOG_ERROR, "AEAP speech (%p): " fmt "\n", obj, ##__VA_ARGS__)
 
+struct speech_aeap_session;
+
+/*!
+ * \brief A connection to an external application
+ *
+ * Sessions of a client configured to multiplex share a connection, and
+ * are then told apart by their session ids.  Otherwise each session has
+ * a connection of its own.
+ */
+struct speech_aeap_connection {
+	/*! The external application */
+	struct ast_aeap *aeap;
+	/*! Sends audio, so that writing it never waits on the network */
+	struct ast_taskprocessor *writer;
+	/*! The sessions sharing a multiplexed connection */
+	AST_LIST_HEAD_NOLOCK(, speech_aeap_session) sessions;
+	/*! The name of the engine */
+	char name[0];
+};
+
+/*! \brief The engine data of a speech object */
+struct speech_aeap_session {
+	/*! The connection of the session */
+	struct speech_aeap_connection *connection;
+	/*! The speech object of the session */
+	struct ast_speech *speech;
+	AST_LIST_ENTRY(speech_aeap_session) list;
+	/*! The id of the session on a multiplexed connection, empty otherwise */
+	char id[AST_UUID_STR_LEN];
+};
+
+/*! \brief Audio waiting to be sent */
+struct speech_aeap_audio {
+	/*! The external application to send it to */
+	struct ast_aeap *aeap;
+	/*! The size of the audio, including any session id before it */
+	size_t size;
+	char buf[0];
+};
+
+/*! \brief The multiplexed connections, by engine name */
+static struct ao2_container *connections;
+
+AO2_STRING_FIELD_HASH_FN(speech_aeap_connection, name);
+AO2_STRING_FIELD_CMP_FN(speech_aeap_connection, name);
+
 static struct ast_json *custom_fields_to_params(const struct ast_variable *variables)
 {
 	const struct ast_variable *i;
@@ -80,14 +134,14 @@ static struct ast_json *custom_fields_to_params(const struct ast_variable *varia
  * receiving a response the returned result is guaranteed to be pass/fail based upon
  * a response handler's result.
  *
- * \param aeap Pointer to an Asterisk external application object
+ * \param session The session the request is for
  * \param name The name of the request to send
  * \param json The core json request data
  * \param data Optional user data to associate with request/response
  *
  * \returns 0 on success, -1 on error
  */
-static int speech_aeap_send_request(struct ast_aeap *aeap, const char *name,
+static int speech_aeap_send_request(struct speech_aeap_session *session, const char *name,
 	struct ast_json *json, void *data)
 {
 	/*
@@ -100,6 +154,11 @@ static int speech_aeap_send_request(struct ast_aeap *aeap, const char *name,
 		.obj = data,
 	};
 
+	if (json && !ast_strlen_zero(session->id)) {
+		/* Tell the server which of the sessions sharing the connection this is for */
+		ast_json_object_set(json, "session", ast_json_string_create(session->id));
+	}
+
 	/* "steals" the json ref */
 	tsx_params.msg = ast_aeap_message_create_request(
 		ast_aeap_message_type_json, name, NULL, json);
@@ -108,7 +167,7 @@ static int speech_aeap_send_request(struct ast_aeap *aeap, const char *name,
 	}
 
 	/* Send "steals" the json msg ref */
-	return ast_aeap_send_msg_tsx(aeap, &tsx_params);
+	return ast_aeap_send_msg_tsx(session->connection->aeap, &tsx_params);
 }
 
 /*!
@@ -319,7 +378,9 @@ static int handle_request_set(struct ast_aeap *aeap, struct ast_aeap_message *me
 	if (!iter) {
 		error_msg = "no parameter(s) requested";
 	} else if (!strcmp(ast_json_object_iter_key(iter), "results")) {
-		struct ast_speech *speech = ast_aeap_user_data_object_by_id(aeap, "speech");
+		/* On a multiplexed connection the server says which session the results are for */
+		const char *session_id = ast_json_object_string_get(ast_aeap_message_data(message), "session");
+		struct ast_speech *speech = ast_aeap_user_data_object_by_id(aeap, S_OR(session_id, "speech"));
 
 		if (!speech) {
 			error_msg = "no associated speech object";
@@ -356,15 +417,41 @@ static const struct ast_aeap_message_handler request_handlers[] = {
  *
  * \param aeap Pointer to an Asterisk external application object
  */
+static int connection_has_aeap(void *obj, void *arg, int flags)
+{
+	struct speech_aeap_connection *connection = obj;
+
+	return connection->aeap == arg ? CMP_MATCH | CMP_STOP : 0;
+}
+
 static void ast_aeap_speech_on_error(struct ast_aeap *aeap)
 {
+	struct speech_aeap_connection *connection;
+	struct speech_aeap_session *session;
 	struct ast_speech *speech = ast_aeap_user_data_object_by_id(aeap, "speech");
-	if (!speech) {
+
+	if (speech) {
+		ast_speech_change_state(speech, AST_SPEECH_STATE_DONE);
+		return;
+	}
+
+	/*
+	 * A multiplexed connection failed, so every session sharing it is done. New
+	 * sessions should not share it any more, they make a new connection instead.
+	 */
+	connection = ao2_callback(connections, OBJ_UNLINK, connection_has_aeap, aeap);
+	if (!connection) {
 		ast_log(LOG_ERROR, "aeap generated error with no associated speech object");
 		return;
 	}
 
-	ast_speech_change_state(speech, AST_SPEECH_STATE_DONE);
+	ao2_lock(connection);
+	AST_LIST_TRAVERSE(&connection->sessions, session, list) {
+		ast_speech_change_state(session->speech, AST_SPEECH_STATE_DONE);
+	}
+	ao2_unlock(connection);
+
+	ao2_ref(connection, -1);
 }
 
 static struct ast_aeap_params speech_aeap_params = {
@@ -375,6 +462,101 @@ static struct ast_aeap_params speech_aeap_params = {
 	.on_error = ast_aeap_speech_on_error,
 };
 
+static void connection_destructor(void *obj)
+{
+	struct speech_aeap_connection *connection = obj;
+
+	/* Audio still waiting is sent before the writer goes */
+	ast_taskprocessor_unreference(connection->writer);
+	ao2_cleanup(connection->aeap);
+}
+
+/*!
+ * \internal
+ * \brief Create, and connect, a connection to the external application of an engine
+ */
+static struct speech_aeap_connection *connection_create(const char *name)
+{
+	static int seq;
+	struct speech_aeap_connection *connection;
+	char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+
+	connection = ao2_alloc(sizeof(*connection) + strlen(name) + 1, connection_destructor);
+	if (!connection) {
+		return NULL;
+	}
+	strcpy(connection->name, name); /* safe */
+
+	ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "speech_aeap/%s-%08x",
+		name, (unsigned int) ast_atomic_fetchadd_int(&seq, +1));
+	connection->writer = ast_taskprocessor_get(tps_name, TPS_REF_DEFAULT);
+	if (!connection->writer) {
+		ao2_ref(connection, -1);
+		return NULL;
+	}
+
+	connection->aeap = ast_aeap_create_and_connect_by_id(
+		name, &speech_aeap_params, CONNECTION_TIMEOUT);
+	if (!connection->aeap) {
+		ao2_ref(connection, -1);
+		return NULL;
+	}
+
+	return connection;
+}
+
+/*!
+ * \internal
+ * \brief Get the multiplexed connection of an engine, connecting it if there is none
+ */
+static struct speech_aeap_connection *connection_get_multiplexed(const char *name)
+{
+	struct speech_aeap_connection *connection;
+
+	/* Keep the container locked while connecting so only one connection is made */
+	ao2_lock(connections);
+	connection = ao2_find(connections, name, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!connection) {
+		connection = connection_create(name);
+		if (connection) {
+			ao2_link_flags(connections, connection, OBJ_NOLOCK);
+		}
+	}
+	ao2_unlock(connections);
+
+	return connection;
+}
+
+/*!
+ * \internal
+ * \brief Take a session off its connection and free it
+ */
+static void session_destroy(struct speech_aeap_session *session)
+{
+	struct speech_aeap_connection *connection = session->connection;
+
+	if (connection) {
+		if (!ast_strlen_zero(session->id)) {
+			ast_aeap_user_data_unregister(connection->aeap, session->id);
+
+			ao2_lock(connection);
+			AST_LIST_REMOVE(&connection->sessions, session, list);
+			ao2_unlock(connection);
+
+			/* The last session gone from a multiplexed connection closes it */
+			ao2_lock(connections);
+			if (ao2_ref(connection, 0) == 2) {
+				ao2_unlink_flags(connections, connection, OBJ_NOLOCK);
+			}
+			ao2_unlock(connections);
+		}
+
+		ao2_ref(connection, -1);
+	}
+
+	ast_free(session);
+}
+
 /*!
  * \internal
  * \brief Create, and connect to an external application and send initial setup
@@ -402,22 +584,32 @@ static struct ast_aeap_params speech_aeap_params = {
  */
 static int speech_aeap_engine_create(struct ast_speech *speech, struct ast_format *format)
 {
-	struct ast_aeap *aeap;
+	struct speech_aeap_session *session;
 	struct ast_variable *vars;
 	struct ast_json *json;
+	int multiplex;
+
+	vars = ast_aeap_custom_fields_get(speech->engine->name);
+	multiplex = ast_true(ast_variable_find_in_list(vars, "multiplex"));
 
-	aeap = ast_aeap_create_and_connect_by_id(
-		speech->engine->name, &speech_aeap_params, CONNECTION_TIMEOUT);
-	if (!aeap) {
+	session = ast_calloc(1, sizeof(*session));
+	if (!session) {
+		ast_variables_destroy(vars);
 		return -1;
 	}
+	session->speech = speech;
 
-	speech->data = aeap;
-
-	/* Don't allow unloading of this module while an external application is in use */
-	ast_module_ref(ast_module_info->self);
-
-	vars = ast_aeap_custom_fields_get(speech->engine->name);
+	if (multiplex) {
+		ast_uuid_generate_str(session->id, sizeof(session->id));
+		session->connection = connection_get_multiplexed(speech->engine->name);
+	} else {
+		session->connection = connection_create(speech->engine->name);
+	}
+	if (!session->connection) {
+		ast_variables_destroy(vars);
+		session_destroy(session);
+		return -1;
+	}
 
 	/* While the protocol allows sending of codec attributes, for now don't */
 	json = ast_json_pack("{s:s,s:[{s:s}],s:o*}", "version", SPEECH_AEAP_VERSION, "codecs",
@@ -425,17 +617,30 @@ static int speech_aeap_engine_create(struct ast_speech *speech, struct ast_forma
 
 	ast_variables_destroy(vars);
 
-	if (ast_aeap_user_data_register(aeap, "speech", speech, NULL)) {
-		ast_module_unref(ast_module_info->self);
+	if (ast_aeap_user_data_register(session->connection->aeap,
+			S_OR(session->id, "speech"), speech, NULL)) {
+		ast_json_unref(json);
+		session_destroy(session);
 		return -1;
 	}
 
+	if (multiplex) {
+		ao2_lock(session->connection);
+		AST_LIST_INSERT_TAIL(&session->connection->sessions, session, list);
+		ao2_unlock(session->connection);
+	}
+
 	/* send_request handles json ref */
-	if (speech_aeap_send_request(speech->data, "setup", json, format)) {
-		ast_module_unref(ast_module_info->self);
+	if (speech_aeap_send_request(session, "setup", json, format)) {
+		session_destroy(session);
 		return -1;
 	}
 
+	speech->data = session;
+
+	/* Don't allow unloading of this module while an external application is in use */
+	ast_module_ref(ast_module_info->self);
+
 	/*
 	 * Add a reference to the engine here, so if it happens to get unregistered
 	 * while executing it won't disappear.
@@ -448,16 +653,62 @@ static int speech_aeap_engine_create(struct ast_speech *speech, struct ast_forma
 static int speech_aeap_engine_destroy(struct ast_speech *speech)
 {
 	ao2_ref(speech->engine, -1);
-	ao2_cleanup(speech->data);
+	session_destroy(speech->data);
 
 	ast_module_unref(ast_module_info->self);
 
 	return 0;
 }
 
+static int speech_aeap_audio_send(void *data)
+{
+	struct speech_aeap_audio *audio = data;
+
+	ast_aeap_send_binary(audio->aeap, audio->buf, audio->size);
+
+	ao2_ref(audio->aeap, -1);
+	ast_free(audio);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Queue audio to be sent to the external application
+ *
+ * Audio is handed to the writer of the connection, so that a slow server
+ * never holds up the channel.  On a multiplexed connection it is preceded
+ * by the id of the session.
+ */
 static int speech_aeap_engine_write(struct ast_speech *speech, void *data, int len)
 {
-	return ast_aeap_send_binary(speech->data, data, len);
+	struct speech_aeap_session *session = speech->data;
+	struct speech_aeap_audio *audio;
+	size_t id_len = strlen(session->id);
+
+	if (ast_taskprocessor_size(session->connection->writer) >= WRITE_BACKLOG_MAX) {
+		ast_debug(3, "AEAP speech (%p): server is not keeping up, dropping %d bytes of audio\n",
+			session->connection->aeap, len);
+		return 0;
+	}
+
+	audio = ast_malloc(sizeof(*audio) + id_len + len);
+	if (!audio) {
+		return -1;
+	}
+
+	audio->aeap = ao2_bump(session->connection->aeap);
+	audio->size = id_len + len;
+	memcpy(audio->buf, session->id, id_len);
+	memcpy(audio->buf + id_len, data, len);
+
+	if (ast_taskprocessor_push(session->connection->writer, speech_aeap_audio_send, audio)) {
+		ao2_ref(audio->aeap, -1);
+		ast_free(audio);
+		return -1;
+	}
+
+	return 0;
 }
 
 static int speech_aeap_engine_dtmf(struct ast_speech *speech, const char *dtmf)
@@ -711,6 +962,9 @@ static int unload_module(void)
 {
 	struct ao2_container *container;
 
+	ao2_cleanup(connections);
+	connections = NULL;
+
 #ifdef TEST_FRAMEWORK
 	ao2_cleanup(ast_speech_unregister2("_aeap_test_speech_"));
 #endif
@@ -732,6 +986,12 @@ static int load_module(void)
 
 	speech_aeap_params.msg_type = ast_aeap_message_type_json;
 
+	connections = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, CONNECTION_BUCKETS,
+		speech_aeap_connection_hash_fn, NULL, speech_aeap_connection_cmp_fn);
+	if (!connections) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	container = ast_aeap_client_configs_get(SPEECH_PROTOCOL);
 	if (container) {
 		ao2_callback(container, 0, load_engine, NULL);
@@ -76,6 +76,8 @@ struct ast_srtp {
 
 struct ast_srtp_policy {
 	srtp_policy_t sp;
+	/*! Length of the master key and salt */
+	size_t key_len;
 };
 
 /*! Tracks whether or not we've initialized the libsrtp library */
@@ -186,6 +188,18 @@ static struct ast_srtp_policy *find_policy(struct ast_srtp *srtp, const srtp_pol
 	return ao2_t_find(srtp->policies, &tmp, flags, "Looking for policy");
 }
 
+/*!
+ * \internal
+ * \brief Determine if two policies protect with the same keys the same way
+ */
+static int policy_same_keys(const struct ast_srtp_policy *one, const struct ast_srtp_policy *two)
+{
+	return one->sp.key && two->sp.key && one->key_len == two->key_len
+		&& !memcmp(one->sp.key, two->sp.key, one->key_len)
+		&& !memcmp(&one->sp.rtp, &two->sp.rtp, sizeof(one->sp.rtp))
+		&& !memcmp(&one->sp.rtcp, &two->sp.rtcp, sizeof(one->sp.rtcp));
+}
+
 static struct ast_srtp *res_srtp_new(void)
 {
 	struct ast_srtp *srtp;
@@ -332,6 +346,7 @@ static int ast_srtp_policy_set_master_key(struct ast_srtp_policy *policy, const
 	if (policy->sp.key) {
 		ast_free(policy->sp.key);
 		policy->sp.key = NULL;
+		policy->key_len = 0;
 	}
 
 	if (!(master_key = ast_calloc(1, size))) {
@@ -342,6 +357,7 @@ static int ast_srtp_policy_set_master_key(struct ast_srtp_policy *policy, const
 	memcpy(master_key + key_len, salt, salt_len);
 
 	policy->sp.key = master_key;
+	policy->key_len = size;
 
 	return 0;
 }
@@ -545,8 +561,24 @@ static int ast_srtp_create(struct ast_srtp **srtp, struct ast_rtp_instance *rtp,
 static int ast_srtp_replace(struct ast_srtp **srtp, struct ast_rtp_instance *rtp, struct ast_srtp_policy *policy)
 {
 	struct ast_srtp *old = *srtp;
-	int res = ast_srtp_create(srtp, rtp, policy);
+	struct ast_srtp_policy *match;
+	int res;
 
+	/*
+	 * A renegotiation that keeps the keys keeps the session, sparing the key
+	 * derivation and keeping the rollover and replay state of its streams.
+	 */
+	if (old && old->session && (match = find_policy(old, &policy->sp, OBJ_POINTER))) {
+		int same = policy_same_keys(match, policy);
+
+		ao2_t_ref(match, -1, "Unreffing policy compared for replacement");
+		if (same) {
+			ast_debug(3, "Keeping srtp (%p) on rtp instance (%p) as its keys are unchanged\n", old, rtp);
+			return 0;
+		}
+	}
+
+	res = ast_srtp_create(srtp, rtp, policy);
 	if (!res && old) {
 		ast_srtp_destroy(old);
 	}
@@ -578,7 +610,11 @@ static int ast_srtp_add_stream(struct ast_srtp *srtp, struct ast_srtp_policy *po
 
 	/* For existing streams, replace if its an SSRC stream, or bail if its a wildcard */
 	if ((match = find_policy(srtp, &policy->sp, OBJ_POINTER))) {
-		if (policy->sp.ssrc.type != ssrc_specific) {
+		if (policy_same_keys(match, policy)) {
+			/* Nothing changed, so the stream carries on as it is */
+			ao2_t_ref(match, -1, "Unreffing already existing policy");
+			return 0;
+		} else if (policy->sp.ssrc.type != ssrc_specific) {
 			ast_log(AST_LOG_WARNING, "Cannot replace an existing wildcard policy\n");
 			ao2_t_ref(match, -1, "Unreffing already existing policy");
 			return -1;
@@ -182,6 +182,16 @@ static struct ast_json *stasis_start_to_json(struct stasis_message *message,
 STASIS_MESSAGE_TYPE_DEFN_LOCAL(start_message_type,
 	.to_json = stasis_start_to_json);
 
+struct stasis_message_type *app_start_message_type(void)
+{
+	return start_message_type();
+}
+
+struct stasis_message_type *app_end_message_type(void)
+{
+	return end_message_type();
+}
+
 /*! AO2 hash function for \ref app */
 static int app_hash(const void *obj, const int flags)
 {
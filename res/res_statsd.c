@@ -62,6 +62,24 @@
 					<synopsis>Enable/disable the non-standard StatsD Meter type,
 					if disabled falls back to counter and will append a "_meter" suffix to the metric name</synopsis>
 				</configOption>
+				<configOption name="flush_interval" default="0">
+					<synopsis>How often, in milliseconds, metrics are sent to the StatsD server</synopsis>
+					<description>
+						<para>If zero, every metric is sent in its own datagram as
+						soon as it is logged.</para>
+						<para>Otherwise unsampled counters and gauges are aggregated,
+						so that each is sent once per interval, and all other
+						metrics are queued. Metrics are packed into datagrams of
+						up to <replaceable>max_packet_size</replaceable> bytes.</para>
+					</description>
+				</configOption>
+				<configOption name="max_packet_size" default="1432">
+					<synopsis>The largest datagram sent when metrics are flushed on an interval</synopsis>
+					<description>
+						<para>Should fit the MTU of the path to the StatsD server,
+						the default fits a 1500 byte MTU.</para>
+					</description>
+				</configOption>
 			</configObject>
 		</configFile>
 	</configInfo>
@@ -69,9 +87,13 @@
 
 #include "asterisk.h"
 
+#include "asterisk/astobj2.h"
 #include "asterisk/config_options.h"
+#include "asterisk/lock.h"
 #include "asterisk/module.h"
 #include "asterisk/netsock2.h"
+#include "asterisk/sched.h"
+#include "asterisk/threadstorage.h"
 
 #define AST_API_MODULE
 #include "asterisk/statsd.h"
@@ -80,6 +102,12 @@
 
 #define MAX_PREFIX 40
 
+/*! The number of shards metrics are aggregated in */
+#define STATSD_SHARDS 16
+
+/*! The number of buckets of each shard's metrics */
+#define STATSD_SHARD_BUCKETS 53
+
 /*! Socket for sending statd messages */
 static int socket_fd = -1;
 
@@ -95,6 +123,10 @@ struct conf_global_options {
 	char prefix[MAX_PREFIX + 1];
 	/*! Enabled support for non-standard Meter type by default, falls back to counter if disabled */
 	int meter_support;
+	/*! How often metrics are flushed, in milliseconds, 0 to send them right away */
+	unsigned int flush_interval;
+	/*! The largest datagram sent when flushing */
+	unsigned int max_packet_size;
 };
 
 /*! \brief All configuration options for statsd client. */
@@ -106,6 +138,52 @@ struct conf {
 /*! \brief Locking container for safe configuration access. */
 static AO2_GLOBAL_OBJ_STATIC(confs);
 
+/*! \brief An aggregated counter or gauge */
+struct statsd_metric {
+	/*! The counter's total, or what the gauge changed by */
+	double value;
+	/*! The gauge's value, if it was set */
+	double gauge;
+	/*! Whether the gauge was set */
+	unsigned int gauge_set:1;
+	/*! Length of the name at the start of \c key */
+	size_t name_len;
+	/*! The metric's name and type, as "name|type" */
+	char key[];
+};
+
+/*! \brief Counters and gauges aggregated by some of the threads */
+struct statsd_shard {
+	ast_mutex_t lock;
+	/*! The metrics logged since they were last flushed */
+	struct ao2_container *metrics;
+};
+
+/*! Shards that threads are spread over, so that they seldom contend */
+static struct statsd_shard shards[STATSD_SHARDS];
+
+/*! The shard a thread aggregates in, plus one */
+AST_THREADSTORAGE(statsd_shard_index);
+
+/*! The next shard handed out to a thread */
+static unsigned int next_shard;
+
+/*! Metrics that are not aggregated, waiting to be flushed */
+static struct ast_str *pending;
+AST_MUTEX_DEFINE_STATIC(pending_lock);
+
+/*! Scheduler flushing the metrics */
+static struct ast_sched_context *sched;
+
+/*! The scheduled flush, protected by \c flush_lock */
+static int flush_id = -1;
+AST_MUTEX_DEFINE_STATIC(flush_lock);
+
+AST_THREADSTORAGE(statsd_line_buf);
+
+AO2_STRING_FIELD_HASH_FN(statsd_metric, key);
+AO2_STRING_FIELD_CMP_FN(statsd_metric, key);
+
 static void conf_server(const struct conf *cfg, struct ast_sockaddr *addr)
 {
 	*addr = cfg->global->statsd_server;
@@ -114,6 +192,219 @@ static void conf_server(const struct conf *cfg, struct ast_sockaddr *addr)
 	}
 }
 
+static struct ao2_container *statsd_metrics_alloc(void)
+{
+	return ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, STATSD_SHARD_BUCKETS,
+		statsd_metric_hash_fn, NULL, statsd_metric_cmp_fn);
+}
+
+/*! \brief Send a datagram of metrics to the StatsD server */
+static void statsd_packet_send(const struct conf *cfg, struct ast_str **packet)
+{
+	struct ast_sockaddr statsd_server;
+
+	if (!ast_str_strlen(*packet)) {
+		return;
+	}
+
+	if (cfg->global->add_newline) {
+		ast_str_append(packet, 0, "\n");
+	}
+
+	conf_server(cfg, &statsd_server);
+	ast_debug(6, "Sending statistics %s to StatsD server\n", ast_str_buffer(*packet));
+	ast_sendto(socket_fd, ast_str_buffer(*packet), ast_str_strlen(*packet), 0, &statsd_server);
+
+	ast_str_reset(*packet);
+}
+
+/*! \brief Add a metric to a datagram, sending the datagram first if the metric does not fit */
+static void statsd_packet_add(const struct conf *cfg, struct ast_str **packet, const char *line)
+{
+	size_t len = ast_str_strlen(*packet);
+
+	if (len && len + 1 + strlen(line) + cfg->global->add_newline > cfg->global->max_packet_size) {
+		statsd_packet_send(cfg, packet);
+		len = 0;
+	}
+
+	ast_str_append(packet, 0, "%s%s", len ? "\n" : "", line);
+}
+
+/*! \brief Add an aggregated metric to a datagram */
+static void statsd_metric_add(const struct conf *cfg, struct ast_str **packet,
+	const struct statsd_metric *metric)
+{
+	const char *type = metric->key + metric->name_len + 1;
+	int name_len = metric->name_len;
+	struct ast_str *line;
+
+	line = ast_str_thread_get(&statsd_line_buf, 128);
+	if (!line) {
+		return;
+	}
+
+	if (!strcmp(type, AST_STATSD_COUNTER)) {
+		ast_str_set(&line, 0, "%.*s:%.15g|%s", name_len, metric->key, metric->value, type);
+	} else if (metric->gauge_set) {
+		double gauge = metric->gauge + metric->value;
+
+		if (gauge < 0) {
+			/* A gauge can only be set to a negative value by decrementing it */
+			ast_str_set(&line, 0, "%.*s:0|%s", name_len, metric->key, type);
+			statsd_packet_add(cfg, packet, ast_str_buffer(line));
+		}
+		ast_str_set(&line, 0, "%.*s:%.15g|%s", name_len, metric->key, gauge, type);
+	} else if (metric->value) {
+		ast_str_set(&line, 0, "%.*s:%+.15g|%s", name_len, metric->key, metric->value, type);
+	} else {
+		return;
+	}
+
+	statsd_packet_add(cfg, packet, ast_str_buffer(line));
+}
+
+/*!
+ * \brief Aggregate a counter or gauge in the calling thread's shard
+ *
+ * \retval 0 if the metric was aggregated
+ * \retval -1 if it cannot be, and is to be sent as it is
+ */
+static int statsd_aggregate(const char *name, const char *metric_type, const char *value)
+{
+	unsigned int *index;
+	struct statsd_shard *shard;
+	struct statsd_metric *metric;
+	struct ast_str *key;
+	int relative = (*value == '+' || *value == '-');
+	char *end;
+	double number;
+
+	number = strtod(value, &end);
+	if (end == value || *end) {
+		return -1;
+	}
+
+	index = ast_threadstorage_get(&statsd_shard_index, sizeof(*index));
+	key = ast_str_thread_get(&statsd_line_buf, 128);
+	if (!index || !key) {
+		return -1;
+	}
+	if (!*index) {
+		*index = ast_atomic_fetch_add(&next_shard, 1, __ATOMIC_RELAXED) % STATSD_SHARDS + 1;
+	}
+	shard = &shards[*index - 1];
+
+	ast_str_set(&key, 0, "%s|%s", name, metric_type);
+
+	ast_mutex_lock(&shard->lock);
+	metric = ao2_find(shard->metrics, ast_str_buffer(key), OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!metric) {
+		metric = ao2_alloc_options(sizeof(*metric) + ast_str_strlen(key) + 1, NULL,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!metric) {
+			ast_mutex_unlock(&shard->lock);
+			return -1;
+		}
+		metric->name_len = strlen(name);
+		strcpy(metric->key, ast_str_buffer(key)); /* Safe */
+		ao2_link_flags(shard->metrics, metric, OBJ_NOLOCK);
+	}
+
+	if (!strcmp(metric_type, AST_STATSD_GAUGE) && !relative) {
+		metric->gauge = number;
+		metric->gauge_set = 1;
+		metric->value = 0;
+	} else {
+		metric->value += number;
+	}
+	ast_mutex_unlock(&shard->lock);
+
+	ao2_ref(metric, -1);
+	return 0;
+}
+
+/*! \brief Queue a metric to be sent when metrics are next flushed */
+static void statsd_queue(const struct conf *cfg, const char *line)
+{
+	ast_mutex_lock(&pending_lock);
+	if (pending) {
+		statsd_packet_add(cfg, &pending, line);
+	}
+	ast_mutex_unlock(&pending_lock);
+}
+
+/*! \brief Send every aggregated and queued metric to the StatsD server */
+static void statsd_flush(void)
+{
+	RAII_VAR(struct conf *, cfg, ao2_global_obj_ref(confs), ao2_cleanup);
+	struct ast_str *packet;
+	int i;
+
+	packet = ast_str_create(1500);
+	if (!cfg || !packet) {
+		ast_free(packet);
+		return;
+	}
+
+	for (i = 0; i < STATSD_SHARDS; i++) {
+		struct ao2_container *metrics = statsd_metrics_alloc();
+		struct ao2_iterator iter;
+		struct statsd_metric *metric;
+
+		if (!metrics) {
+			continue;
+		}
+
+		/* Swap the shard's metrics out so threads are not kept waiting */
+		ast_mutex_lock(&shards[i].lock);
+		SWAP(shards[i].metrics, metrics);
+		ast_mutex_unlock(&shards[i].lock);
+
+		if (socket_fd != -1) {
+			iter = ao2_iterator_init(metrics, AO2_ITERATOR_DONTLOCK);
+			for (; (metric = ao2_iterator_next(&iter)); ao2_ref(metric, -1)) {
+				statsd_metric_add(cfg, &packet, metric);
+			}
+			ao2_iterator_destroy(&iter);
+		}
+		ao2_ref(metrics, -1);
+	}
+
+	if (socket_fd != -1) {
+		statsd_packet_send(cfg, &packet);
+	}
+
+	ast_mutex_lock(&pending_lock);
+	if (pending && socket_fd != -1) {
+		statsd_packet_send(cfg, &pending);
+	}
+	if (pending) {
+		ast_str_reset(pending);
+	}
+	ast_mutex_unlock(&pending_lock);
+
+	ast_free(packet);
+}
+
+/*! \brief Scheduler callback flushing the metrics */
+static int statsd_flush_cb(const void *data)
+{
+	RAII_VAR(struct conf *, cfg, ao2_global_obj_ref(confs), ao2_cleanup);
+	int interval;
+
+	statsd_flush();
+
+	ast_mutex_lock(&flush_lock);
+	interval = cfg && socket_fd != -1 ? cfg->global->flush_interval : 0;
+	if (!interval) {
+		flush_id = -1;
+	}
+	ast_mutex_unlock(&flush_lock);
+
+	return interval;
+}
+
 void AST_OPTIONAL_API_NAME(ast_statsd_log_string)(const char *metric_name,
 	const char *metric_type, const char *value, double sample_rate)
 {
@@ -149,15 +440,33 @@ void AST_OPTIONAL_API_NAME(ast_statsd_log_string)(const char *metric_name,
 	}
 
 	if (!cfg->global->meter_support && strcmp(metric_type, AST_STATSD_METER)) {
-		ast_str_append(&msg, 0, "%s_meter:%s|%s", metric_name, value, AST_STATSD_COUNTER);
+		ast_str_append(&msg, 0, "%s_meter", metric_name);
+		metric_type = AST_STATSD_COUNTER;
 	} else {
-		ast_str_append(&msg, 0, "%s:%s|%s", metric_name, value, metric_type);
+		ast_str_append(&msg, 0, "%s", metric_name);
 	}
 
+	if (cfg->global->flush_interval && sample_rate >= 1.0
+		&& (!strcmp(metric_type, AST_STATSD_COUNTER) || !strcmp(metric_type, AST_STATSD_GAUGE))
+		&& !statsd_aggregate(ast_str_buffer(msg), metric_type, value)) {
+		ao2_cleanup(cfg);
+		ast_free(msg);
+		return;
+	}
+
+	ast_str_append(&msg, 0, ":%s|%s", value, metric_type);
+
 	if (sample_rate < 1.0) {
 		ast_str_append(&msg, 0, "|@%.2f", sample_rate);
 	}
 
+	if (cfg->global->flush_interval) {
+		statsd_queue(cfg, ast_str_buffer(msg));
+		ao2_cleanup(cfg);
+		ast_free(msg);
+		return;
+	}
+
 	if (cfg->global->add_newline) {
 		ast_str_append(&msg, 0, "\n");
 	}
@@ -326,6 +635,13 @@ static int statsd_init(void)
 	ast_debug(3, "  StatsD server = %s.\n", server);
 	ast_debug(3, "  add newline = %s\n", AST_YESNO(cfg->global->add_newline));
 	ast_debug(3, "  prefix = %s\n", cfg->global->prefix);
+	ast_debug(3, "  flush interval = %u\n", cfg->global->flush_interval);
+
+	ast_mutex_lock(&flush_lock);
+	if (cfg->global->flush_interval && flush_id == -1) {
+		flush_id = ast_sched_add_variable(sched, cfg->global->flush_interval, statsd_flush_cb, NULL, 1);
+	}
+	ast_mutex_unlock(&flush_lock);
 
 	return 0;
 }
@@ -341,16 +657,56 @@ static void statsd_shutdown(void)
 
 static int unload_module(void)
 {
+	int i;
+
+	if (sched) {
+		ast_sched_context_destroy(sched);
+		sched = NULL;
+	}
+	flush_id = -1;
+
+	/* Send whatever was aggregated since the last flush */
+	statsd_flush();
+
 	statsd_shutdown();
 	aco_info_destroy(&cfg_info);
 	ao2_global_obj_release(confs);
+
+	for (i = 0; i < STATSD_SHARDS; i++) {
+		ao2_cleanup(shards[i].metrics);
+		shards[i].metrics = NULL;
+		ast_mutex_destroy(&shards[i].lock);
+	}
+	ast_free(pending);
+	pending = NULL;
+
 	return 0;
 }
 
 static int load_module(void)
 {
+	int i;
+
+	for (i = 0; i < STATSD_SHARDS; i++) {
+		ast_mutex_init(&shards[i].lock);
+	}
+	for (i = 0; i < STATSD_SHARDS; i++) {
+		shards[i].metrics = statsd_metrics_alloc();
+		if (!shards[i].metrics) {
+			unload_module();
+			return AST_MODULE_LOAD_DECLINE;
+		}
+	}
+
+	pending = ast_str_create(1500);
+	sched = ast_sched_context_create();
+	if (!pending || !sched || ast_sched_start_thread(sched)) {
+		unload_module();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	if (aco_info_init(&cfg_info)) {
-		aco_info_destroy(&cfg_info);
+		unload_module();
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
@@ -374,6 +730,14 @@ static int load_module(void)
 		"yes", OPT_BOOL_T, 1,
 		FLDSET(struct conf_global_options, meter_support));
 
+	aco_option_register(&cfg_info, "flush_interval", ACO_EXACT, global_options,
+		"0", OPT_UINT_T, 0,
+		FLDSET(struct conf_global_options, flush_interval));
+
+	aco_option_register(&cfg_info, "max_packet_size", ACO_EXACT, global_options,
+		"1432", OPT_UINT_T, PARSE_IN_RANGE,
+		FLDSET(struct conf_global_options, max_packet_size), 64, 65507);
+
 	if (aco_process_config(&cfg_info, 0) == ACO_PROCESS_ERROR) {
 		struct conf *cfg;
 
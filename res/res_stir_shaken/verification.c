@@ -41,13 +41,61 @@
 #include "asterisk/localtime.h"
 #include "asterisk/crypto.h"
 #include "asterisk/json.h"
+#include "asterisk/dlinkedlists.h"
 
 #include "stir_shaken.h"
 
 #define AST_DB_FAMILY "STIR_SHAKEN"
 
+#define CERT_CACHE_BUCKETS 257
+
 static regex_t url_match_regex;
 
+/*!
+ * \brief A certificate kept in memory once retrieved and checked
+ *
+ * Only whether a profile's trust store trusts the certificate and whether
+ * it was valid when an attestation was made differ between calls, so the
+ * rest of the checks are not repeated and astdb and the cached file are
+ * not read again until the certificate expires.
+ */
+struct cert_cache_entry {
+	AST_DECLARE_STRING_FIELDS(
+		AST_STRING_FIELD(cert_cn);
+		AST_STRING_FIELD(cert_spc);
+		AST_STRING_FIELD(expiration);
+	);
+	/*! The certificate, NULL while it is being retrieved */
+	X509 *xcert;
+	/*! The raw public key of the certificate */
+	unsigned char *raw_key;
+	long raw_key_len;
+	/*! When the certificate has to be retrieved again */
+	time_t expires;
+	/*! The trust store that last trusted the certificate */
+	struct crypto_cert_store *trusted_by;
+	/*! Whether the certificate is being retrieved, by the first call that needed it */
+	int retrieving;
+	/*! Least recently used order */
+	AST_DLLIST_ENTRY(cert_cache_entry) list;
+	char public_url[0];
+};
+
+/*!
+ * \brief Certificates by URL, and in least recently used order
+ *
+ * Both are protected by cert_cache_lock, which calls waiting for a
+ * certificate another is retrieving wait on with cert_cache_cond.
+ */
+static struct ao2_container *cert_cache;
+static AST_DLLIST_HEAD_NOLOCK_STATIC(cert_cache_lru, cert_cache_entry);
+static int cert_cache_count;
+AST_MUTEX_DEFINE_STATIC(cert_cache_lock);
+static ast_cond_t cert_cache_cond;
+
+AO2_STRING_FIELD_HASH_FN(cert_cache_entry, public_url);
+AO2_STRING_FIELD_CMP_FN(cert_cache_entry, public_url);
+
 /* Certificates should begin with this */
 #define BEGIN_CERTIFICATE_STR "-----BEGIN CERTIFICATE-----"
 
@@ -572,11 +620,220 @@ static enum ast_stir_shaken_vs_response_code ctx_populate(
 	return AST_STIR_SHAKEN_VS_SUCCESS;
 }
 
+static void cert_cache_entry_destructor(void *obj)
+{
+	struct cert_cache_entry *entry = obj;
+
+	X509_free(entry->xcert);
+	ast_free(entry->raw_key);
+	ao2_cleanup(entry->trusted_by);
+	ast_string_field_free_memory(entry);
+}
+
+/*! \pre cert_cache_lock is held */
+static void cert_cache_unlink(struct cert_cache_entry *entry)
+{
+	AST_DLLIST_REMOVE(&cert_cache_lru, entry, list);
+	cert_cache_count--;
+	ao2_unlink_flags(cert_cache, entry, OBJ_NOLOCK);
+}
+
+/*!
+ * \internal
+ * \brief Add a certificate that is about to be retrieved
+ *
+ * The least recently used certificates are forgotten to keep to
+ * max_cache_size.
+ *
+ * \pre cert_cache_lock is held
+ */
+static struct cert_cache_entry *cert_cache_add(const char *public_url, unsigned int max_size)
+{
+	struct cert_cache_entry *entry;
+	struct cert_cache_entry *oldest;
+
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(public_url) + 1,
+		cert_cache_entry_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry || ast_string_field_init(entry, 128)) {
+		ao2_cleanup(entry);
+		return NULL;
+	}
+	strcpy(entry->public_url, public_url); /* SAFE */
+	entry->retrieving = 1;
+
+	AST_DLLIST_TRAVERSE_BACKWARDS_SAFE_BEGIN(&cert_cache_lru, oldest, list) {
+		if (cert_cache_count < max_size) {
+			break;
+		}
+		if (!oldest->retrieving) {
+			cert_cache_unlink(oldest);
+		}
+	}
+	AST_DLLIST_TRAVERSE_BACKWARDS_SAFE_END;
+
+	ao2_link_flags(cert_cache, entry, OBJ_NOLOCK);
+	AST_DLLIST_INSERT_HEAD(&cert_cache_lru, entry, list);
+	cert_cache_count++;
+
+	return entry;
+}
+
+/*!
+ * \internal
+ * \brief Get a certificate from memory
+ *
+ * If another call is retrieving the certificate this waits for it. If
+ * nothing is, \a retrieving is set to a new entry for the certificate,
+ * which others will wait for until cert_cache_retrieved() is called.
+ */
 static enum ast_stir_shaken_vs_response_code
-	retrieve_verification_cert(struct ast_stir_shaken_vs_ctx *ctx)
+	retrieve_cert_from_memory(struct ast_stir_shaken_vs_ctx *ctx,
+	struct cert_cache_entry **retrieving)
+{
+	RAII_VAR(struct verification_cfg *, cfg, vs_get_cfg(), ao2_cleanup);
+	struct crypto_cert_store *tcs = ctx->eprofile->vcfg_common.tcs;
+	struct cert_cache_entry *entry;
+	const char *err_msg;
+	int trusted;
+	SCOPE_ENTER(2, "%s: Attempting to retrieve cert '%s' from memory\n",
+		ctx->tag, ctx->public_url);
+
+	*retrieving = NULL;
+	if (!cert_cache || !cfg || !cfg->vcfg_common.max_cache_size) {
+		SCOPE_EXIT_RTN_VALUE(AST_STIR_SHAKEN_VS_CERT_CACHE_MISS,
+			"%s: Certs are not kept in memory\n", ctx->tag);
+	}
+
+	ast_mutex_lock(&cert_cache_lock);
+	while ((entry = ao2_find(cert_cache, ctx->public_url, OBJ_SEARCH_KEY | OBJ_NOLOCK))
+		&& entry->retrieving) {
+		ao2_ref(entry, -1);
+		ast_cond_wait(&cert_cache_cond, &cert_cache_lock);
+	}
+
+	if (entry && entry->expires <= time(NULL)) {
+		cert_cache_unlink(entry);
+		ao2_ref(entry, -1);
+		entry = NULL;
+	}
+
+	if (!entry) {
+		*retrieving = cert_cache_add(ctx->public_url, cfg->vcfg_common.max_cache_size);
+		ast_mutex_unlock(&cert_cache_lock);
+		SCOPE_EXIT_RTN_VALUE(AST_STIR_SHAKEN_VS_CERT_CACHE_MISS,
+			"%s: No cert in memory for '%s'\n", ctx->tag, ctx->public_url);
+	}
+
+	AST_DLLIST_REMOVE(&cert_cache_lru, entry, list);
+	AST_DLLIST_INSERT_HEAD(&cert_cache_lru, entry, list);
+	trusted = entry->trusted_by == tcs;
+	ast_mutex_unlock(&cert_cache_lock);
+
+	/* What is set once the certificate has been retrieved does not change */
+	if (!trusted) {
+		ast_trace(3, "%s: Checking cert '%s' against CA ctx\n", ctx->tag, ctx->public_url);
+		if (!crypto_is_cert_trusted(tcs, entry->xcert, &err_msg)) {
+			ao2_ref(entry, -1);
+			SCOPE_EXIT_LOG_RTN_VALUE(AST_STIR_SHAKEN_VS_CERT_NOT_TRUSTED,
+				LOG_ERROR, "%s: Cert '%s' not trusted: %s\n",
+				ctx->tag, ctx->public_url, err_msg);
+		}
+
+		ast_mutex_lock(&cert_cache_lock);
+		ao2_replace(entry->trusted_by, tcs);
+		ast_mutex_unlock(&cert_cache_lock);
+	}
+
+	if (!crypto_is_cert_time_valid(entry->xcert, ctx->validity_check_time)) {
+		ao2_ref(entry, -1);
+		SCOPE_EXIT_LOG_RTN_VALUE(AST_STIR_SHAKEN_VS_CERT_DATE_INVALID,
+			LOG_ERROR, "%s: Cert '%s' dates not valid\n",
+			ctx->tag, ctx->public_url);
+	}
+
+	ctx->raw_key = ast_malloc(entry->raw_key_len);
+	if (!ctx->raw_key
+		|| ast_string_field_set(ctx, cert_cn, entry->cert_cn)
+		|| ast_string_field_set(ctx, cert_spc, entry->cert_spc)) {
+		ast_free(ctx->raw_key);
+		ctx->raw_key = NULL;
+		ao2_ref(entry, -1);
+		SCOPE_EXIT_RTN_VALUE(AST_STIR_SHAKEN_VS_INTERNAL_ERROR);
+	}
+	memcpy(ctx->raw_key, entry->raw_key, entry->raw_key_len);
+	ctx->raw_key_len = entry->raw_key_len;
+	ast_copy_string(ctx->expiration, entry->expiration, sizeof(ctx->expiration));
+	X509_up_ref(entry->xcert);
+	ctx->xcert = entry->xcert;
+	ao2_ref(entry, -1);
+
+	SCOPE_EXIT_RTN_VALUE(AST_STIR_SHAKEN_VS_SUCCESS,
+		"%s: Cert '%s' successfully retrieved from memory\n",
+		ctx->tag, ctx->public_url);
+}
+
+/*!
+ * \internal
+ * \brief Keep a certificate retrieved for an entry from retrieve_cert_from_memory()
+ *
+ * The calls waiting for it are woken, and the entry is released.
+ */
+static void cert_cache_retrieved(struct cert_cache_entry *entry,
+	struct ast_stir_shaken_vs_ctx *ctx, enum ast_stir_shaken_vs_response_code rc)
+{
+	unsigned long expires;
+
+	if (!entry) {
+		return;
+	}
+
+	if (rc == AST_STIR_SHAKEN_VS_SUCCESS
+		&& !ast_str_to_ulong(ctx->expiration, &expires)
+		&& !ast_string_field_set(entry, cert_cn, ctx->cert_cn)
+		&& !ast_string_field_set(entry, cert_spc, ctx->cert_spc)
+		&& !ast_string_field_set(entry, expiration, ctx->expiration)
+		&& (entry->raw_key = ast_malloc(ctx->raw_key_len))) {
+		memcpy(entry->raw_key, ctx->raw_key, ctx->raw_key_len);
+		entry->raw_key_len = ctx->raw_key_len;
+		entry->expires = expires;
+		X509_up_ref(ctx->xcert);
+		entry->xcert = ctx->xcert;
+		entry->trusted_by = ao2_bump(ctx->eprofile->vcfg_common.tcs);
+	}
+
+	ast_mutex_lock(&cert_cache_lock);
+	entry->retrieving = 0;
+	if (!entry->xcert) {
+		/* Those waiting retrieve it themselves */
+		cert_cache_unlink(entry);
+	}
+	ast_cond_broadcast(&cert_cache_cond);
+	ast_mutex_unlock(&cert_cache_lock);
+
+	ao2_ref(entry, -1);
+}
+
+/*! \brief Forget every certificate kept in memory */
+static void cert_cache_flush(void)
+{
+	struct cert_cache_entry *entry;
+
+	ast_mutex_lock(&cert_cache_lock);
+	AST_DLLIST_TRAVERSE_SAFE_BEGIN(&cert_cache_lru, entry, list) {
+		/* Certificates being retrieved are forgotten once they are */
+		if (!entry->retrieving) {
+			cert_cache_unlink(entry);
+		}
+	}
+	AST_DLLIST_TRAVERSE_SAFE_END;
+	ast_mutex_unlock(&cert_cache_lock);
+}
+
+static enum ast_stir_shaken_vs_response_code
+	retrieve_cert_from_storage(struct ast_stir_shaken_vs_ctx *ctx)
 {
 	enum ast_stir_shaken_vs_response_code rc = AST_STIR_SHAKEN_VS_SUCCESS;
-	SCOPE_ENTER(3, "%s: Retrieving cert '%s'\n", ctx->tag, ctx->public_url);
+	SCOPE_ENTER(3, "%s: Retrieving cert '%s' from cache or internet\n", ctx->tag, ctx->public_url);
 
 	ast_trace(1, "%s: Checking cache for cert '%s'\n", ctx->tag, ctx->public_url);
 	rc = retrieve_cert_from_cache(ctx);
@@ -601,6 +858,27 @@ static enum ast_stir_shaken_vs_response_code
 		ctx->tag, ctx->public_url);
 }
 
+static enum ast_stir_shaken_vs_response_code
+	retrieve_verification_cert(struct ast_stir_shaken_vs_ctx *ctx)
+{
+	enum ast_stir_shaken_vs_response_code rc = AST_STIR_SHAKEN_VS_SUCCESS;
+	struct cert_cache_entry *retrieving;
+	SCOPE_ENTER(3, "%s: Retrieving cert '%s'\n", ctx->tag, ctx->public_url);
+
+	ast_trace(1, "%s: Checking memory for cert '%s'\n", ctx->tag, ctx->public_url);
+	rc = retrieve_cert_from_memory(ctx, &retrieving);
+	if (rc != AST_STIR_SHAKEN_VS_CERT_CACHE_MISS) {
+		SCOPE_EXIT_RTN_VALUE(rc, "%s: Cert '%s' was in memory\n",
+			ctx->tag, ctx->public_url);
+	}
+
+	rc = retrieve_cert_from_storage(ctx);
+	cert_cache_retrieved(retrieving, ctx, rc);
+
+	SCOPE_EXIT_RTN_VALUE(rc, "%s: Done retrieving cert '%s'\n",
+		ctx->tag, ctx->public_url);
+}
+
 enum ast_stir_shaken_vs_response_code
 	ast_stir_shaken_vs_ctx_add_identity_hdr(
 	struct ast_stir_shaken_vs_ctx * ctx, const char *identity_hdr)
@@ -1084,6 +1362,9 @@ int vs_reload()
 {
 	vs_config_reload();
 
+	/* Trust stores and cache settings may have changed */
+	cert_cache_flush();
+
 	return 0;
 }
 
@@ -1094,6 +1375,13 @@ int vs_unload()
 		regfree(&url_match_regex);
 	}
 
+	if (cert_cache) {
+		cert_cache_flush();
+		ao2_ref(cert_cache, -1);
+		cert_cache = NULL;
+		ast_cond_destroy(&cert_cache_cond);
+	}
+
 	return 0;
 }
 
@@ -1105,6 +1393,14 @@ int vs_load()
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	cert_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0,
+		CERT_CACHE_BUCKETS, cert_cache_entry_hash_fn, NULL, cert_cache_entry_cmp_fn);
+	if (!cert_cache) {
+		vs_unload();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+	ast_cond_init(&cert_cache_cond, NULL);
+
 	rc = regcomp(&url_match_regex, FULL_URL_REGEX, REG_EXTENDED);
 	if (rc) {
 		char regex_error[512];
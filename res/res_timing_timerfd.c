@@ -36,6 +36,7 @@
 #include "asterisk/astobj2.h"
 #include "asterisk/timing.h"
 #include "asterisk/logger.h"
+#include "asterisk/options.h"
 #include "asterisk/utils.h"
 #include "asterisk/time.h"
 
@@ -73,6 +74,35 @@ struct timerfd_timer {
 	unsigned int is_continuous:1;
 };
 
+/*!
+ * \brief Arm a timer with its saved setting
+ *
+ * With align_timers set, a periodic timer is started on the next multiple of
+ * its period, so all timers of the same rate expire together.
+ */
+static int timerfd_timer_arm(struct timerfd_timer *timer)
+{
+	struct itimerspec aligned;
+	struct timespec now;
+	uint64_t interval;
+	uint64_t next;
+
+	interval = (uint64_t) timer->saved_timer.it_interval.tv_sec * 1000000000
+		+ timer->saved_timer.it_interval.tv_nsec;
+	if (!ast_option_align_timers || !interval) {
+		return timerfd_settime(timer->fd, 0, &timer->saved_timer, NULL);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	next = ((uint64_t) now.tv_sec * 1000000000 + now.tv_nsec) / interval * interval + interval;
+
+	aligned.it_interval = timer->saved_timer.it_interval;
+	aligned.it_value.tv_sec = next / 1000000000;
+	aligned.it_value.tv_nsec = next % 1000000000;
+
+	return timerfd_settime(timer->fd, TFD_TIMER_ABSTIME, &aligned, NULL);
+}
+
 static void timer_destroy(void *obj)
 {
 	struct timerfd_timer *timer = obj;
@@ -116,7 +146,7 @@ static int timerfd_timer_set_rate(void *data, unsigned int rate)
 	timer->saved_timer.it_interval.tv_nsec = timer->saved_timer.it_value.tv_nsec;
 
 	if (!timer->is_continuous) {
-		res = timerfd_settime(timer->fd, 0, &timer->saved_timer, NULL);
+		res = timerfd_timer_arm(timer);
 	}
 
 	ao2_unlock(timer);
@@ -210,7 +240,7 @@ static int timerfd_timer_disable_continuous(void *data)
 		return 0;
 	}
 
-	res = timerfd_settime(timer->fd, 0, &timer->saved_timer, NULL);
+	res = timerfd_timer_arm(timer);
 	timer->is_continuous = 0;
 	memset(&timer->saved_timer, 0, sizeof(timer->saved_timer));
 	ao2_unlock(timer);
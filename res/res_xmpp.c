@@ -425,11 +425,11 @@ enum {
 /*! \brief Number of buckets for client connections */
 #define CLIENT_BUCKETS 53
 
-/*! \brief Number of buckets for buddies (per client) */
-#define BUDDY_BUCKETS 53
+/*! \brief Number of buckets for buddies (per client), presence looks one up per stanza */
+#define BUDDY_BUCKETS 563
 
-/*! \brief Number of buckets for resources (per buddy) */
-#define RESOURCE_BUCKETS 53
+/*! \brief Number of buckets for resources (per buddy), walked on every presence */
+#define RESOURCE_BUCKETS 7
 
 /*! \brief Namespace for TLS support */
 #define XMPP_TLS_NS "urn:ietf:params:xml:ns:xmpp-tls"
@@ -566,6 +566,9 @@ static void xmpp_client_destructor(void *obj)
 		iks_stack_delete(client->stack);
 	}
 
+	AST_VECTOR_CALLBACK_VOID(&client->devstate_queue, ao2_ref, -1);
+	AST_VECTOR_FREE(&client->devstate_queue);
+
 	ao2_cleanup(client->buddies);
 
 	while ((message = AST_LIST_REMOVE_HEAD(&client->messages, list))) {
@@ -618,6 +621,11 @@ static struct ast_xmpp_client *xmpp_client_alloc(const char *name)
 	AST_LIST_HEAD_INIT(&client->messages);
 	client->thread = AST_PTHREADT_NULL;
 
+	if (AST_VECTOR_INIT(&client->devstate_queue, 0)) {
+		ao2_ref(client, -1);
+		return NULL;
+	}
+
 	client->endpoint = ast_endpoint_create("XMPP", name);
 	if (!client->endpoint) {
 		ao2_ref(client, -1);
@@ -2179,6 +2187,7 @@ static struct ast_xmpp_buddy *xmpp_client_create_buddy(struct ao2_container *con
 
 	/* Assume we need to subscribe to get their presence until proven otherwise */
 	buddy->subscribe = 1;
+	buddy->devstate = -1;
 
 	ao2_link(container, buddy);
 
@@ -3381,13 +3390,51 @@ static int xmpp_pak_presence(struct ast_xmpp_client *client, struct ast_xmpp_cli
 
 	ao2_unlock(buddy->resources);
 
-	ao2_ref(buddy, -1);
-
-	ast_devstate_changed(state, AST_DEVSTATE_CACHABLE, "XMPP/%s/%s", client->name, pak->from->partial);
+	/*
+	 * Rather than publishing the device state for every presence, queue the
+	 * buddy.  Each buddy is published once, with its latest state, when the
+	 * client has read everything waiting, see xmpp_client_devstate_flush().
+	 */
+	buddy->devstate_new = state;
+	if (buddy->devstate_queued) {
+		ao2_ref(buddy, -1);
+	} else if (!AST_VECTOR_APPEND(&client->devstate_queue, buddy)) {
+		/* The queue keeps the reference */
+		buddy->devstate_queued = 1;
+	} else {
+		buddy->devstate = state;
+		ast_devstate_changed(state, AST_DEVSTATE_CACHABLE, "XMPP/%s/%s", client->name, buddy->id);
+		ao2_ref(buddy, -1);
+	}
 
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Publish the device states of the buddies whose presence changed
+ *
+ * Only called from the client thread, which is the only one queueing them.
+ * A buddy whose presence changed back to the state last published is skipped.
+ */
+static void xmpp_client_devstate_flush(struct ast_xmpp_client *client)
+{
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&client->devstate_queue); i++) {
+		struct ast_xmpp_buddy *buddy = AST_VECTOR_GET(&client->devstate_queue, i);
+
+		buddy->devstate_queued = 0;
+		if (buddy->devstate != buddy->devstate_new) {
+			buddy->devstate = buddy->devstate_new;
+			ast_devstate_changed(buddy->devstate, AST_DEVSTATE_CACHABLE, "XMPP/%s/%s",
+				client->name, buddy->id);
+		}
+		ao2_ref(buddy, -1);
+	}
+	AST_VECTOR_RESET(&client->devstate_queue, AST_VECTOR_ELEM_CLEANUP_NOOP);
+}
+
 /*! \brief Internal function called when a subscription message is received */
 static int xmpp_pak_s10n(struct ast_xmpp_client *client, struct ast_xmpp_client_config *cfg,iks *node, ikspak *pak)
 {
@@ -3610,6 +3657,25 @@ static int xmpp_client_reconnect(struct ast_xmpp_client *client)
 	return 0;
 }
 
+/*! \brief Helper function which returns whether data is waiting to be read from an XMPP client connection */
+static int xmpp_io_waiting(struct ast_xmpp_client *client)
+{
+	struct pollfd pfd = { .events = POLLIN };
+
+#ifdef HAVE_OPENSSL
+	if (xmpp_is_secure(client)) {
+		/* Data already decrypted is not seen by poll */
+		if (SSL_pending(client->ssl_session) > 0) {
+			return 1;
+		}
+		pfd.fd = SSL_get_fd(client->ssl_session);
+	} else
+#endif /* HAVE_OPENSSL */
+		pfd.fd = iks_fd(client->parser);
+
+	return pfd.fd >= 0 && ast_poll(&pfd, 1, 0) > 0;
+}
+
 /*! \brief Internal function which polls on an XMPP client and receives data */
 static int xmpp_io_recv(struct ast_xmpp_client *client, char *buffer, size_t buf_len, int timeout)
 {
@@ -3653,6 +3719,11 @@ static int xmpp_client_receive(struct ast_xmpp_client *client, unsigned int time
 	unsigned char c;
 
 	while (1) {
+		/* Presence read in a burst is published once the burst is over */
+		if (AST_VECTOR_SIZE(&client->devstate_queue) && !xmpp_io_waiting(client)) {
+			xmpp_client_devstate_flush(client);
+		}
+
 		len = xmpp_io_recv(client, buf, NET_IO_BUF_SIZE - 2, timeout);
 		if (len < 0) return IKS_NET_RWERR;
 		if (len == 0) return IKS_NET_EXPIRED;
@@ -3750,6 +3821,7 @@ static void *xmpp_client_thread(void *data)
 		}
 
 		res = xmpp_client_receive(client, 1);
+		xmpp_client_devstate_flush(client);
 
 		/* Decrease timeout if no data received, and delete
 		 * old messages globally */
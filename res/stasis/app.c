@@ -45,6 +45,7 @@
 int global_debug;
 
 static int unsubscribe(struct stasis_app *app, const char *kind, const char *id, int terminate);
+static int app_event_type_allowed(struct stasis_app *app, const char *type);
 
 struct stasis_app {
 	/*! Aggregation topic for this application. */
@@ -315,6 +316,81 @@ static void app_dtor(void *obj)
 
 }
 
+/*! \brief The message an ARI event is converted from */
+struct app_event_source {
+	/*! The type of the event */
+	const char *event_type;
+	/*! The type of the message, NULL if it is one routed to a handler */
+	struct stasis_message_type *(*message_type)(void);
+	/*! Set if the message is needed even when the event is not */
+	unsigned int always:1;
+};
+
+/*!
+ * \brief The events known to be converted from a particular message
+ *
+ * Messages of the types given are only converted for the events an app
+ * wants, and if an app only wants events listed here the messages of the
+ * others are not even received.  Each event must only be converted from
+ * the message given here.
+ */
+static const struct app_event_source app_event_sources[] = {
+	{ "ChannelCreated", NULL },
+	{ "ChannelDestroyed", NULL },
+	{ "ChannelStateChange", NULL },
+	{ "ChannelDialplan", NULL },
+	{ "ChannelCallerId", NULL },
+	{ "ChannelConnectedLine", NULL },
+	{ "BridgeCreated", NULL },
+	{ "BridgeDestroyed", NULL },
+	{ "BridgeVideoSourceChanged", NULL },
+	{ "EndpointStateChange", NULL },
+	{ "StasisStart", app_start_message_type },
+	{ "StasisEnd", app_end_message_type },
+	/* Dial messages are how forwarded calls get subscribed to */
+	{ "Dial", ast_channel_dial_type, .always = 1 },
+	{ "ChannelDtmfReceived", ast_channel_dtmf_end_type },
+	{ "ChannelHangupRequest", ast_channel_hangup_request_type },
+	{ "ChannelVarset", ast_channel_varset_type },
+	{ "ChannelUserevent", ast_multi_user_event_type },
+	{ "ChannelHold", ast_channel_hold_type },
+	{ "ChannelUnhold", ast_channel_unhold_type },
+	{ "ChannelTalkingStarted", ast_channel_talking_start },
+	{ "ChannelTalkingFinished", ast_channel_talking_stop },
+	{ "ChannelEnteredBridge", ast_channel_entered_bridge_type },
+	{ "ChannelLeftBridge", ast_channel_left_bridge_type },
+	{ "BridgeMerged", ast_bridge_merge_message_type },
+	{ "BridgeBlindTransfer", ast_blind_transfer_type },
+	{ "BridgeAttendedTransfer", ast_attended_transfer_type },
+};
+
+static const struct app_event_source *app_event_source_find(struct stasis_message_type *type)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(app_event_sources); ++i) {
+		if (app_event_sources[i].message_type
+			&& app_event_sources[i].message_type() == type) {
+			return &app_event_sources[i];
+		}
+	}
+
+	return NULL;
+}
+
+static int app_event_source_known(const char *event_type)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(app_event_sources); ++i) {
+		if (ast_strings_equal(app_event_sources[i].event_type, event_type)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
 static void call_forwarded_handler(struct stasis_app *app, struct stasis_message *message)
 {
 	struct ast_multi_channel_blob *payload = stasis_message_data(message);
@@ -348,6 +424,7 @@ static void sub_default_handler(void *data, struct stasis_subscription *sub,
 	struct stasis_message *message)
 {
 	struct stasis_app *app = data;
+	const struct app_event_source *source;
 	struct ast_json *json;
 
 	/* The dial type can be converted to JSON so it will always be passed
@@ -357,6 +434,12 @@ static void sub_default_handler(void *data, struct stasis_subscription *sub,
 		call_forwarded_handler(app, message);
 	}
 
+	/* Don't bother converting it if the app doesn't want the event */
+	source = app_event_source_find(stasis_message_type(message));
+	if (source && !app_event_type_allowed(app, source->event_type)) {
+		return;
+	}
+
 	/* By default, send any message that has a JSON representation */
 	json = stasis_message_to_json(message, stasis_app_get_sanitizer());
 	if (!json) {
@@ -533,13 +616,33 @@ static struct ast_json *channel_connected_line(
 		"channel", json_channel);
 }
 
-static channel_snapshot_monitor channel_monitors[] = {
-	channel_state,
-	channel_dialplan,
-	channel_callerid,
-	channel_connected_line,
+/*! \brief A channel snapshot monitor and the events it makes */
+struct channel_monitor {
+	channel_snapshot_monitor monitor;
+	/*! The types of the events, NULL terminated */
+	const char *event_types[4];
+};
+
+static const struct channel_monitor channel_monitors[] = {
+	{ channel_state, { "ChannelCreated", "ChannelDestroyed", "ChannelStateChange", NULL } },
+	{ channel_dialplan, { "ChannelDialplan", NULL } },
+	{ channel_callerid, { "ChannelCallerId", NULL } },
+	{ channel_connected_line, { "ChannelConnectedLine", NULL } },
 };
 
+static int channel_monitor_allowed(struct stasis_app *app, const struct channel_monitor *monitor)
+{
+	int i;
+
+	for (i = 0; monitor->event_types[i]; ++i) {
+		if (app_event_type_allowed(app, monitor->event_types[i])) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
 static void sub_channel_update_handler(void *data,
 	struct stasis_subscription *sub,
 	struct stasis_message *message)
@@ -551,7 +654,11 @@ static void sub_channel_update_handler(void *data,
 	for (i = 0; i < ARRAY_LEN(channel_monitors); ++i) {
 		struct ast_json *msg;
 
-		msg = channel_monitors[i](update->old_snapshot, update->new_snapshot,
+		if (!channel_monitor_allowed(app, &channel_monitors[i])) {
+			continue;
+		}
+
+		msg = channel_monitors[i].monitor(update->old_snapshot, update->new_snapshot,
 			stasis_message_timestamp(message));
 		if (msg) {
 			app_send(app, msg);
@@ -644,7 +751,7 @@ static void sub_endpoint_update_handler(void *data,
 	new_snapshot = stasis_message_data(update->new_snapshot);
 	old_snapshot = stasis_message_data(update->old_snapshot);
 
-	if (new_snapshot) {
+	if (new_snapshot && app_event_type_allowed(app, "EndpointStateChange")) {
 		struct ast_json *json;
 
 		tv = stasis_message_timestamp(update->new_snapshot);
@@ -693,11 +800,16 @@ static void sub_bridge_update_handler(void *data,
 	tv = stasis_message_timestamp(message);
 
 	if (!update->new_snapshot) {
-		json = simple_bridge_event("BridgeDestroyed", update->old_snapshot, tv);
+		if (app_event_type_allowed(app, "BridgeDestroyed")) {
+			json = simple_bridge_event("BridgeDestroyed", update->old_snapshot, tv);
+		}
 	} else if (!update->old_snapshot) {
-		json = simple_bridge_event("BridgeCreated", update->new_snapshot, tv);
+		if (app_event_type_allowed(app, "BridgeCreated")) {
+			json = simple_bridge_event("BridgeCreated", update->new_snapshot, tv);
+		}
 	} else if (update->new_snapshot && update->old_snapshot
-		&& strcmp(update->new_snapshot->video_source_id, update->old_snapshot->video_source_id)) {
+		&& strcmp(update->new_snapshot->video_source_id, update->old_snapshot->video_source_id)
+		&& app_event_type_allowed(app, "BridgeVideoSourceChanged")) {
 		json = simple_bridge_event("BridgeVideoSourceChanged", update->new_snapshot, tv);
 		if (json && !ast_strlen_zero(update->old_snapshot->video_source_id)) {
 			ast_json_object_set(json, "old_video_source_id",
@@ -736,6 +848,10 @@ static void bridge_merge_handler(void *data, struct stasis_subscription *sub,
 	struct stasis_app *app = data;
 	struct ast_bridge_merge_message *merge;
 
+	if (!app_event_type_allowed(app, "BridgeMerged")) {
+		return;
+	}
+
 	merge = stasis_message_data(message);
 
 	/* Find out if we're subscribed to either bridge */
@@ -777,6 +893,10 @@ static void bridge_blind_transfer_handler(void *data, struct stasis_subscription
 	struct ast_blind_transfer_message *transfer_msg = stasis_message_data(message);
 	struct ast_bridge_snapshot *bridge = transfer_msg->bridge;
 
+	if (!app_event_type_allowed(app, "BridgeBlindTransfer")) {
+		return;
+	}
+
 	if (bridge_app_subscribed(app, transfer_msg->transferer->base->uniqueid) ||
 		(bridge && bridge_app_subscribed_involved(app, bridge))) {
 		stasis_publish(app->topic, message);
@@ -790,6 +910,10 @@ static void bridge_attended_transfer_handler(void *data, struct stasis_subscript
 	struct ast_attended_transfer_message *transfer_msg = stasis_message_data(message);
 	int subscribed = 0;
 
+	if (!app_event_type_allowed(app, "BridgeAttendedTransfer")) {
+		return;
+	}
+
 	subscribed = bridge_app_subscribed(app, transfer_msg->to_transferee.channel_snapshot->base->uniqueid);
 	if (!subscribed) {
 		subscribed = bridge_app_subscribed(app, transfer_msg->to_transfer_target.channel_snapshot->base->uniqueid);
@@ -1705,12 +1829,7 @@ static int app_events_disallowed_set(struct stasis_app *app, struct ast_json *fi
 	return app_event_filter_set(app, &app->events_disallowed, filter, "disallowed");
 }
 
-int stasis_app_event_filter_set(struct stasis_app *app, struct ast_json *filter)
-{
-	return app_events_disallowed_set(app, filter) || app_events_allowed_set(app, filter);
-}
-
-static int app_event_filter_matched(struct ast_json *array, struct ast_json *event, int empty)
+static int app_event_filter_matched(struct ast_json *array, const char *type, int empty)
 {
 	struct ast_json *obj;
 	int i;
@@ -1722,8 +1841,7 @@ static int app_event_filter_matched(struct ast_json *array, struct ast_json *eve
 	for (i = 0; i < ast_json_array_size(array) &&
 			(obj = ast_json_array_get(array, i)); ++i) {
 
-		if (ast_strings_equal(ast_json_object_string_get(obj, "type"),
-				ast_json_object_string_get(event, "type"))) {
+		if (ast_strings_equal(ast_json_object_string_get(obj, "type"), type)) {
 			return 1;
 		}
 	}
@@ -1731,6 +1849,84 @@ static int app_event_filter_matched(struct ast_json *array, struct ast_json *eve
 	return 0;
 }
 
+/*! \pre app is locked */
+static int app_event_type_allowed_nolock(struct stasis_app *app, const char *type)
+{
+	return !app_event_filter_matched(app->events_disallowed, type, 0) &&
+		app_event_filter_matched(app->events_allowed, type, 1);
+}
+
+/*!
+ * \brief Whether the app wants events of a type
+ *
+ * Checked before converting a message, so those of unwanted events
+ * are not converted only to be dropped when sent.
+ */
+static int app_event_type_allowed(struct stasis_app *app, const char *type)
+{
+	int res;
+
+	ao2_lock(app);
+	res = app_event_type_allowed_nolock(app, type);
+	ao2_unlock(app);
+
+	return res;
+}
+
+/*!
+ * \brief Have the app's router only receive the messages of events the app wants
+ *
+ * This is only possible if the app lists the events it allows and they
+ * are all known to be converted from particular messages.  Otherwise any
+ * message might be converted to an event it wants, so they are received
+ * and only filtered before being converted.
+ */
+static void app_message_filter_update(struct stasis_app *app)
+{
+	struct ast_json *obj;
+	int selective;
+	int i;
+
+	ao2_lock(app);
+	selective = app->events_allowed && ast_json_array_size(app->events_allowed);
+	for (i = 0; selective && i < ast_json_array_size(app->events_allowed) &&
+			(obj = ast_json_array_get(app->events_allowed, i)); ++i) {
+		selective = app_event_source_known(ast_json_object_string_get(obj, "type"));
+	}
+
+	if (!selective) {
+		stasis_message_router_accept_formatters(app->router,
+			STASIS_SUBSCRIPTION_FORMATTER_JSON);
+		ao2_unlock(app);
+		return;
+	}
+
+	for (i = 0; i < ARRAY_LEN(app_event_sources); ++i) {
+		const struct app_event_source *source = &app_event_sources[i];
+
+		if (!source->message_type) {
+			continue;
+		}
+		if (source->always || app_event_type_allowed_nolock(app, source->event_type)) {
+			stasis_message_router_accept_message_type(app->router, source->message_type());
+		} else {
+			stasis_message_router_decline_message_type(app->router, source->message_type());
+		}
+	}
+	stasis_message_router_accept_formatters(app->router, STASIS_SUBSCRIPTION_FORMATTER_NONE);
+	ao2_unlock(app);
+}
+
+int stasis_app_event_filter_set(struct stasis_app *app, struct ast_json *filter)
+{
+	int res;
+
+	res = app_events_disallowed_set(app, filter) || app_events_allowed_set(app, filter);
+	app_message_filter_update(app);
+
+	return res;
+}
+
 int stasis_app_event_allowed(const char *app_name, struct ast_json *event)
 {
 	struct stasis_app *app = stasis_app_get_by_name(app_name);
@@ -1740,10 +1936,7 @@ int stasis_app_event_allowed(const char *app_name, struct ast_json *event)
 		return 0;
 	}
 
-	ao2_lock(app);
-	res = !app_event_filter_matched(app->events_disallowed, event, 0) &&
-		app_event_filter_matched(app->events_allowed, event, 1);
-	ao2_unlock(app);
+	res = app_event_type_allowed(app, ast_json_object_string_get(event, "type"));
 	ao2_ref(app, -1);
 
 	return res;
@@ -282,4 +282,14 @@ char *app_get_replace_channel_app(struct ast_channel *chan);
  */
 int app_send_end_msg(struct stasis_app *app, struct ast_channel *chan);
 
+/*!
+ * \brief The type of the message StasisStart events are converted from
+ */
+struct stasis_message_type *app_start_message_type(void);
+
+/*!
+ * \brief The type of the message StasisEnd events are converted from
+ */
+struct stasis_message_type *app_end_message_type(void);
+
 #endif /* _ASTERISK_RES_STASIS_APP_H */
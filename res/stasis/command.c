@@ -36,6 +36,10 @@ struct stasis_app_command {
 	stasis_app_command_cb callback;
 	void *data;
 	command_data_destructor_fn data_destructor;
+	/*! Called once the command has completed, if set */
+	stasis_app_command_done_cb done_fn;
+	/*! ao2 object passed to done_fn */
+	void *done_data;
 	int retval;
 	unsigned int is_done:1;
 };
@@ -47,6 +51,7 @@ static void command_dtor(void *obj)
 	if (command->data_destructor) {
 		command->data_destructor(command->data);
 	}
+	ao2_cleanup(command->done_data);
 
 	ast_mutex_destroy(&command->lock);
 	ast_cond_destroy(&command->condition);
@@ -74,13 +79,30 @@ struct stasis_app_command *command_create(
 	return command;
 }
 
-void command_complete(struct stasis_app_command *command, int retval)
+void command_set_done(struct stasis_app_command *command,
+	stasis_app_command_done_cb done_fn, void *done_data)
 {
+	command->done_fn = done_fn;
+	command->done_data = ao2_bump(done_data);
+}
+
+void command_complete(struct stasis_app_command *command,
+	struct stasis_app_control *control, int retval)
+{
+	stasis_app_command_done_cb done_fn;
+
 	ast_mutex_lock(&command->lock);
 	command->is_done = 1;
 	command->retval = retval;
 	ast_cond_signal(&command->condition);
+	done_fn = command->done_fn;
+	command->done_fn = NULL;
 	ast_mutex_unlock(&command->lock);
+
+	/* Nobody waits for an async command, so this is how it is reported */
+	if (done_fn) {
+		done_fn(control, retval, command->done_data);
+	}
 }
 
 int command_join(struct stasis_app_command *command)
@@ -106,7 +128,7 @@ void command_invoke(struct stasis_app_command *command,
 		command->data_destructor(command->data);
 		command->data_destructor = NULL;
 	}
-	command_complete(command, retval);
+	command_complete(command, control, retval);
 }
 
 static void command_queue_prestart_destroy(void *obj)
@@ -35,7 +35,20 @@ struct stasis_app_command *command_create(
 	stasis_app_command_cb callback, void *data,
 	command_data_destructor_fn data_destructor);
 
-void command_complete(struct stasis_app_command *command, int retval);
+/*!
+ * \brief Have a function called when a command completes
+ *
+ * \note Must be called before the command is queued.
+ *
+ * \param command The command
+ * \param done_fn The function to call, with the control and result of the command
+ * \param done_data ao2 object to pass to done_fn, the command holds a reference to it
+ */
+void command_set_done(struct stasis_app_command *command,
+	stasis_app_command_done_cb done_fn, void *done_data);
+
+void command_complete(struct stasis_app_command *command,
+	struct stasis_app_control *control, int retval);
 
 void command_invoke(struct stasis_app_command *command,
 	struct stasis_app_control *control, struct ast_channel *chan);
@@ -98,6 +98,11 @@ struct stasis_app_control {
 	 * The thread currently blocking on the channel.
 	 */
 	pthread_t control_thread;
+	/*!
+	 * Set once control_thread has been woken up, so commands queued
+	 * before it gets to them do not wake it up again.
+	 */
+	int wakeup_pending;
 	/*!
 	 * The list of arguments to pass to StasisStart when moving to another app.
 	 */
@@ -197,6 +202,7 @@ void control_set_thread(struct stasis_app_control *control, pthread_t threadid)
 {
 	ao2_lock(control->command_queue);
 	control->control_thread = threadid;
+	control->wakeup_pending = 0;
 	ao2_unlock(control->command_queue);
 }
 
@@ -282,7 +288,8 @@ typedef int (*app_command_can_exec_cb)(struct stasis_app_control *control);
 static struct stasis_app_command *exec_command_on_condition(
 	struct stasis_app_control *control, stasis_app_command_cb command_fn,
 	void *data, command_data_destructor_fn data_destructor,
-	app_command_can_exec_cb can_exec_fn)
+	app_command_can_exec_cb can_exec_fn,
+	stasis_app_command_done_cb done_fn, void *done_data)
 {
 	int retval;
 	struct stasis_app_command *command;
@@ -293,6 +300,9 @@ static struct stasis_app_command *exec_command_on_condition(
 	if (!command) {
 		return NULL;
 	}
+	if (done_fn) {
+		command_set_done(command, done_fn, done_data);
+	}
 
 	ao2_lock(control->command_queue);
 	if (control->is_done) {
@@ -302,17 +312,24 @@ static struct stasis_app_command *exec_command_on_condition(
 	}
 	if (can_exec_fn && (retval = can_exec_fn(control))) {
 		ao2_unlock(control->command_queue);
-		command_complete(command, retval);
+		command_complete(command, control, retval);
 		return command;
 	}
 
+	/*
+	 * The thread dispatches every command queued by the time it gets to
+	 * them, so it only needs waking up for the first one.
+	 */
+	if (ao2_container_count(control->command_queue) == 0) {
+		ast_cond_signal(&control->wait_cond);
+	}
 	ao2_link_flags(control->command_queue, command, OBJ_NOLOCK);
-	ast_cond_signal(&control->wait_cond);
 
-	if (control->control_thread != AST_PTHREADT_NULL) {
+	if (control->control_thread != AST_PTHREADT_NULL && !control->wakeup_pending) {
 		/* if the control thread is waiting on the channel, send the SIGURG
 		   to let it know there is a new command */
 		pthread_kill(control->control_thread, SIGURG);
+		control->wakeup_pending = 1;
 	}
 
 	ao2_unlock(control->command_queue);
@@ -324,7 +341,7 @@ static struct stasis_app_command *exec_command(
 	struct stasis_app_control *control, stasis_app_command_cb command_fn,
 	void *data, command_data_destructor_fn data_destructor)
 {
-	return exec_command_on_condition(control, command_fn, data, data_destructor, NULL);
+	return exec_command_on_condition(control, command_fn, data, data_destructor, NULL, NULL, NULL);
 }
 
 static int app_control_add_role(struct stasis_app_control *control,
@@ -906,7 +923,7 @@ static int app_send_command_on_condition(struct stasis_app_control *control,
 	}
 
 	command = exec_command_on_condition(
-		control, command_fn, data, data_destructor, can_exec_fn);
+		control, command_fn, data, data_destructor, can_exec_fn, NULL, NULL);
 	if (!command) {
 		return -1;
 	}
@@ -917,6 +934,31 @@ static int app_send_command_on_condition(struct stasis_app_control *control,
 	return ret;
 }
 
+static int app_send_command_on_condition_async(struct stasis_app_control *control,
+	stasis_app_command_cb command_fn, void *data,
+	command_data_destructor_fn data_destructor,
+	app_command_can_exec_cb can_exec_fn,
+	stasis_app_command_done_cb done_fn, void *done_data)
+{
+	struct stasis_app_command *command;
+
+	if (control == NULL || control->is_done) {
+		if (data_destructor) {
+			data_destructor(data);
+		}
+		return -1;
+	}
+
+	command = exec_command_on_condition(
+		control, command_fn, data, data_destructor, can_exec_fn, done_fn, done_data);
+	if (!command) {
+		return -1;
+	}
+	ao2_ref(command, -1);
+
+	return 0;
+}
+
 int stasis_app_send_command(struct stasis_app_control *control,
 	stasis_app_command_cb command_fn, void *data, command_data_destructor_fn data_destructor)
 {
@@ -1413,6 +1455,19 @@ int stasis_app_control_add_channel_to_bridge(
 		app_control_can_add_channel_to_bridge);
 }
 
+int stasis_app_control_add_channel_to_bridge_async(
+	struct stasis_app_control *control, struct ast_bridge *bridge,
+	stasis_app_command_done_cb done_fn, void *done_data)
+{
+	ast_debug(3, "%s: Queueing channel add_to_bridge command\n",
+			stasis_app_control_get_channel_id(control));
+
+	/* Nobody waits on the command, so it needs its own reference */
+	return app_send_command_on_condition_async(
+		control, control_add_channel_to_bridge, ao2_bump(bridge), __ao2_cleanup,
+		app_control_can_add_channel_to_bridge, done_fn, done_data);
+}
+
 static int app_control_remove_channel_from_bridge(
 	struct stasis_app_control *control,
 	struct ast_channel *chan, void *data)
@@ -1449,6 +1504,28 @@ int stasis_app_control_remove_channel_from_bridge(
 		app_control_can_remove_channel_from_bridge);
 }
 
+int stasis_app_control_remove_channel_from_bridge_async(
+	struct stasis_app_control *control, struct ast_bridge *bridge,
+	stasis_app_command_done_cb done_fn, void *done_data)
+{
+	ast_debug(3, "%s: Queueing channel remove_from_bridge command\n",
+			stasis_app_control_get_channel_id(control));
+	return app_send_command_on_condition_async(
+		control, app_control_remove_channel_from_bridge, ao2_bump(bridge), __ao2_cleanup,
+		app_control_can_remove_channel_from_bridge, done_fn, done_data);
+}
+
+struct stasis_app *stasis_app_control_get_app(struct stasis_app_control *control)
+{
+	struct stasis_app *app;
+
+	ao2_lock(control);
+	app = ao2_bump(control->app);
+	ao2_unlock(control);
+
+	return app;
+}
+
 const char *stasis_app_control_get_channel_id(
 	const struct stasis_app_control *control)
 {
@@ -1508,7 +1585,7 @@ void control_flush_queue(struct stasis_app_control *control)
 
 	iter = ao2_iterator_init(control->command_queue, AO2_ITERATOR_UNLINK);
 	while ((command = ao2_iterator_next(&iter))) {
-		command_complete(command, -1);
+		command_complete(command, control, -1);
 		ao2_ref(command, -1);
 	}
 	ao2_iterator_destroy(&iter);
@@ -1518,18 +1595,30 @@ int control_dispatch_all(struct stasis_app_control *control,
 	struct ast_channel *chan)
 {
 	int count = 0;
-	struct ao2_iterator iter;
+	struct ao2_iterator *iter;
 	struct stasis_app_command *command;
 
 	ast_assert(control->channel == chan);
 
-	iter = ao2_iterator_init(control->command_queue, AO2_ITERATOR_UNLINK);
-	while ((command = ao2_iterator_next(&iter))) {
+	if (!ao2_container_count(control->command_queue)) {
+		return 0;
+	}
+
+	/*
+	 * Take everything queued so far in one go rather than locking the
+	 * queue for each command, so queueing more is not held up while
+	 * they run.  Those are dispatched on the next wakeup.
+	 */
+	iter = ao2_callback(control->command_queue, OBJ_MULTIPLE | OBJ_UNLINK, NULL, NULL);
+	if (!iter) {
+		return 0;
+	}
+	while ((command = ao2_iterator_next(iter))) {
 		command_invoke(command, control, chan);
 		ao2_ref(command, -1);
 		++count;
 	}
-	ao2_iterator_destroy(&iter);
+	ao2_iterator_destroy(iter);
 
 	return count;
 }
@@ -1712,8 +1801,10 @@ void stasis_app_control_shutdown(void)
 
 void control_set_app(struct stasis_app_control *control, struct stasis_app *app)
 {
+	ao2_lock(control);
 	ao2_cleanup(control->app);
 	control->app = ao2_bump(app);
+	ao2_unlock(control);
 }
 
 char *control_next_app(struct stasis_app_control *control)
@@ -530,6 +530,16 @@ test_put_overflow(AST_JB_FIXED, "fixed", 12)
 
 test_put_out_of_order(AST_JB_FIXED, "fixed", DEFAULT_CONFIG_RESYNC_THRESHOLD)
 
+test_create_nominal(AST_JB_STRETCH, "stretch")
+
+test_put_first(AST_JB_STRETCH, "stretch")
+
+test_put(AST_JB_STRETCH, "stretch")
+
+test_put_overflow(AST_JB_STRETCH, "stretch", 10)
+
+test_put_out_of_order(AST_JB_STRETCH, "stretch", DEFAULT_FRAME_MS * 2)
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_ADAPTIVE, create));
@@ -544,6 +554,12 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_FIXED, put_overflow));
 	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_FIXED, put_out_of_order));
 
+	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_STRETCH, create));
+	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_STRETCH, put_first));
+	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_STRETCH, put));
+	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_STRETCH, put_overflow));
+	AST_TEST_UNREGISTER(TEST_NAME(AST_JB_STRETCH, put_out_of_order));
+
 	return 0;
 }
 
@@ -561,6 +577,12 @@ static int load_module(void)
 	AST_TEST_REGISTER(TEST_NAME(AST_JB_FIXED, put_overflow));
 	AST_TEST_REGISTER(TEST_NAME(AST_JB_FIXED, put_out_of_order));
 
+	AST_TEST_REGISTER(TEST_NAME(AST_JB_STRETCH, create));
+	AST_TEST_REGISTER(TEST_NAME(AST_JB_STRETCH, put_first));
+	AST_TEST_REGISTER(TEST_NAME(AST_JB_STRETCH, put));
+	AST_TEST_REGISTER(TEST_NAME(AST_JB_STRETCH, put_overflow));
+	AST_TEST_REGISTER(TEST_NAME(AST_JB_STRETCH, put_out_of_order));
+
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
@@ -36,6 +36,8 @@
 #include "asterisk/module.h"
 #include "asterisk/netsock2.h"
 #include "asterisk/config.h"
+#include "asterisk/time.h"
+#include "asterisk/utils.h"
 
 AST_TEST_DEFINE(invalid_acl)
 {
@@ -433,10 +435,191 @@ acl_cleanup:
 	return res;
 }
 
+/*!
+ * \internal
+ * \brief Make a random address, close enough to the others that rules overlap
+ *
+ * \param buf Where to put the address
+ * \param len The size of buf
+ * \param ipv6 Whether the address is an IPv6 one
+ */
+static void random_address(char *buf, size_t len, int ipv6)
+{
+	if (ipv6) {
+		snprintf(buf, len, "2001:db8:%x::%x:%x", (int) (ast_random() % 4),
+			(int) (ast_random() % 4), (int) (ast_random() % 0x10000));
+	} else {
+		snprintf(buf, len, "10.%d.%d.%d", (int) (ast_random() % 4),
+			(int) (ast_random() % 256), (int) (ast_random() % 256));
+	}
+}
+
+/*!
+ * \internal
+ * \brief Make a list of random rules, both IPv4 and IPv6
+ */
+static struct ast_ha *random_ha(int rules)
+{
+	struct ast_ha *ha = NULL;
+	int i;
+
+	for (i = 0; i < rules; i++) {
+		char address[64];
+		char rule[80];
+		int ipv6 = !(ast_random() % 4);
+		int error = 0;
+
+		random_address(address, sizeof(address), ipv6);
+		snprintf(rule, sizeof(rule), "%s/%d", address,
+			ipv6 ? (int) (80 + ast_random() % 49) : (int) (8 + ast_random() % 25));
+		ha = ast_append_ha(ast_random() % 2 ? "permit" : "deny", rule, ha, &error);
+		if (!ha || error) {
+			ast_free_ha(ha);
+			return NULL;
+		}
+	}
+
+	return ha;
+}
+
+/*!
+ * \internal
+ * \brief Make a random address to check against random rules
+ */
+static void random_sockaddr(struct ast_sockaddr *addr)
+{
+	char address[64];
+	int kind = ast_random() % 3;
+
+	random_address(address + 7, sizeof(address) - 7, kind == 2);
+	if (kind == 1) {
+		/* An IPv4-mapped address, which the IPv4 rules apply to */
+		memcpy(address, "::ffff:", 7);
+		ast_sockaddr_parse(addr, address, PARSE_PORT_FORBID);
+	} else {
+		ast_sockaddr_parse(addr, address + 7, PARSE_PORT_FORBID);
+	}
+}
+
+AST_TEST_DEFINE(compiled_acl)
+{
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int round;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "compiled_acl";
+		info->category = "/main/acl/";
+		info->summary = "Compiled ACL test";
+		info->description =
+			"Compiles random lists of rules and checks the compiled rules\n"
+			"allow and deny the same addresses the rules do.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (round = 0; round < 50 && res == AST_TEST_PASS; round++) {
+		struct ast_ha *ha = random_ha(1 + ast_random() % 40);
+		struct ast_ha_table *table = ast_ha_compile(ha);
+
+		if (!ha || !table) {
+			ast_test_status_update(test, "Failed to create compiled rules\n");
+			ast_free_ha(ha);
+			ast_ha_table_free(table);
+			return AST_TEST_FAIL;
+		}
+
+		for (i = 0; i < 1000; i++) {
+			struct ast_sockaddr addr;
+
+			random_sockaddr(&addr);
+			if (ast_ha_table_apply(table, &addr) != ast_apply_ha(ha, &addr)) {
+				ast_test_status_update(test, "Compiled rules do not agree with the rules on %s\n",
+					ast_sockaddr_stringify_addr(&addr));
+				res = AST_TEST_FAIL;
+				break;
+			}
+		}
+
+		ast_free_ha(ha);
+		ast_ha_table_free(table);
+	}
+
+	return res;
+}
+
+AST_TEST_DEFINE(compiled_acl_performance)
+{
+#define RULES 500
+#define LOOKUPS 20000
+	struct ast_ha *ha;
+	struct ast_ha_table *table;
+	struct ast_sockaddr *addrs;
+	struct timeval start;
+	int64_t walked;
+	int64_t compiled;
+	int denied[2] = { 0, 0 };
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "compiled_acl_performance";
+		info->category = "/main/acl/";
+		info->summary = "Compiled ACL performance test";
+		info->description =
+			"Applies a long list of rules to many addresses, both compiled\n"
+			"and not, and reports how long each took.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ha = random_ha(RULES);
+	table = ast_ha_compile(ha);
+	addrs = ast_calloc(LOOKUPS, sizeof(*addrs));
+	if (!ha || !table || !addrs) {
+		ast_free_ha(ha);
+		ast_ha_table_free(table);
+		ast_free(addrs);
+		return AST_TEST_FAIL;
+	}
+
+	for (i = 0; i < LOOKUPS; i++) {
+		random_sockaddr(&addrs[i]);
+	}
+
+	start = ast_tvnow();
+	for (i = 0; i < LOOKUPS; i++) {
+		denied[0] += ast_apply_ha(ha, &addrs[i]) == AST_SENSE_DENY;
+	}
+	walked = ast_tvdiff_us(ast_tvnow(), start);
+
+	start = ast_tvnow();
+	for (i = 0; i < LOOKUPS; i++) {
+		denied[1] += ast_ha_table_apply(table, &addrs[i]) == AST_SENSE_DENY;
+	}
+	compiled = ast_tvdiff_us(ast_tvnow(), start);
+
+	ast_test_status_update(test, "Applying %d rules to %d addresses took %" PRId64
+		"us, and %" PRId64 "us compiled\n", RULES, LOOKUPS, walked, compiled);
+
+	ast_free_ha(ha);
+	ast_ha_table_free(table);
+	ast_free(addrs);
+
+	return denied[0] == denied[1] ? AST_TEST_PASS : AST_TEST_FAIL;
+#undef RULES
+#undef LOOKUPS
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(invalid_acl);
 	AST_TEST_UNREGISTER(acl);
+	AST_TEST_UNREGISTER(compiled_acl);
+	AST_TEST_UNREGISTER(compiled_acl_performance);
 	return 0;
 }
 
@@ -444,6 +627,8 @@ static int load_module(void)
 {
 	AST_TEST_REGISTER(invalid_acl);
 	AST_TEST_REGISTER(acl);
+	AST_TEST_REGISTER(compiled_acl);
+	AST_TEST_REGISTER(compiled_acl_performance);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
@@ -42,6 +42,7 @@ enum test_container_type {
 	TEST_CONTAINER_LIST,
 	TEST_CONTAINER_HASH,
 	TEST_CONTAINER_RBTREE,
+	TEST_CONTAINER_OPEN_HASH,
 };
 
 /*!
@@ -68,6 +69,9 @@ static const char *test_container2str(enum test_container_type type)
 	case TEST_CONTAINER_RBTREE:
 		c_type = "RBTree";
 		break;
+	case TEST_CONTAINER_OPEN_HASH:
+		c_type = "OpenHash";
+		break;
 	}
 	return c_type;
 }
@@ -453,6 +457,12 @@ static int astobj2_test_1_helper(int tst_num, enum test_container_type type, int
 		c1 = ao2_t_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
 			test_sort_cb, test_cmp_cb, "test");
 		break;
+	case TEST_CONTAINER_OPEN_HASH:
+		/* Start small so the slots are grown while linking. */
+		n_buckets = 1;
+		c1 = ao2_t_container_alloc_open_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, n_buckets,
+			test_hash_cb, use_sort ? test_sort_cb : NULL, test_cmp_cb, "test");
+		break;
 	}
 	c2 = ao2_t_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX, 0, NULL, NULL, "test");
 
@@ -682,6 +692,14 @@ AST_TEST_DEFINE(astobj2_test_1)
 		return res;
 	}
 
+	if ((res = astobj2_test_1_helper(5, TEST_CONTAINER_OPEN_HASH, 0, 1000, test)) == AST_TEST_FAIL) {
+		return res;
+	}
+
+	if ((res = astobj2_test_1_helper(6, TEST_CONTAINER_OPEN_HASH, 1, 1000, test)) == AST_TEST_FAIL) {
+		return res;
+	}
+
 	return res;
 }
 
@@ -979,6 +997,10 @@ static struct ao2_container *test_make_nonsorted(enum test_container_type type,
 	case TEST_CONTAINER_RBTREE:
 		/* Container type must be sorted. */
 		break;
+	case TEST_CONTAINER_OPEN_HASH:
+		container = ao2_container_alloc_open_hash(AO2_ALLOC_OPT_LOCK_MUTEX, options, 5,
+			test_hash_cb, NULL, test_cmp_cb);
+		break;
 	}
 
 	return container;
@@ -1013,6 +1035,9 @@ static struct ao2_container *test_make_sorted(enum test_container_type type, int
 		container = ao2_t_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_MUTEX, options,
 			test_sort_cb, test_cmp_cb, "test");
 		break;
+	case TEST_CONTAINER_OPEN_HASH:
+		/* Container type is not sorted. */
+		break;
 	}
 
 	return container;
@@ -1416,6 +1441,8 @@ static int test_traversal_nonsorted(int res, int tst_num, enum test_container_ty
 	/* Check container iteration directions */
 	switch (type) {
 	case TEST_CONTAINER_LIST:
+	case TEST_CONTAINER_OPEN_HASH:
+		/* Open hash containers iterate in insertion order like lists. */
 		res = test_ao2_iteration(res, c1, 0,
 			test_initial, ARRAY_LEN(test_initial),
 			"Iteration (ascending, insert end)", test);
@@ -1452,6 +1479,7 @@ static int test_traversal_nonsorted(int res, int tst_num, enum test_container_ty
 	/* Check container traversal directions */
 	switch (type) {
 	case TEST_CONTAINER_LIST:
+	case TEST_CONTAINER_OPEN_HASH:
 		res = test_ao2_callback_traversal(res, c1, OBJ_ORDER_ASCENDING, NULL, NULL,
 			test_initial, ARRAY_LEN(test_initial),
 			"Traversal (ascending, insert end)", test);
@@ -1490,6 +1518,7 @@ static int test_traversal_nonsorted(int res, int tst_num, enum test_container_ty
 	partial_key_match_range = 1;
 	switch (type) {
 	case TEST_CONTAINER_LIST:
+	case TEST_CONTAINER_OPEN_HASH:
 		res = test_ao2_callback_traversal(res, c1, OBJ_PARTIAL_KEY | OBJ_ORDER_ASCENDING,
 			test_cmp_cb, &partial,
 			test_list_partial_forward, ARRAY_LEN(test_list_partial_forward),
@@ -1665,6 +1694,9 @@ static int test_traversal_sorted(int res, int tst_num, enum test_container_type
 			test_hash_backward, ARRAY_LEN(test_hash_backward),
 			"Iteration (descending)", test);
 		break;
+	case TEST_CONTAINER_OPEN_HASH:
+		/* Container type is not sorted. */
+		break;
 	}
 
 	/* Check container traversal directions */
@@ -1686,6 +1718,9 @@ static int test_traversal_sorted(int res, int tst_num, enum test_container_type
 			test_hash_backward, ARRAY_LEN(test_hash_backward),
 			"Traversal (descending)", test);
 		break;
+	case TEST_CONTAINER_OPEN_HASH:
+		/* Container type is not sorted. */
+		break;
 	}
 
 	/* Check traversal with OBJ_PARTIAL_KEY search range. */
@@ -1713,6 +1748,9 @@ static int test_traversal_sorted(int res, int tst_num, enum test_container_type
 			test_hash_partial_backward, ARRAY_LEN(test_hash_partial_backward),
 			"Traversal OBJ_PARTIAL_KEY (descending)", test);
 		break;
+	case TEST_CONTAINER_OPEN_HASH:
+		/* Container type is not sorted. */
+		break;
 	}
 
 	/* Add duplicates to initial containers that allow duplicates */
@@ -1912,6 +1950,7 @@ AST_TEST_DEFINE(astobj2_test_4)
 
 	res = test_traversal_nonsorted(res, 1, TEST_CONTAINER_LIST, test);
 	res = test_traversal_nonsorted(res, 2, TEST_CONTAINER_HASH, test);
+	res = test_traversal_nonsorted(res, 6, TEST_CONTAINER_OPEN_HASH, test);
 
 	res = test_traversal_sorted(res, 3, TEST_CONTAINER_LIST, test);
 	res = test_traversal_sorted(res, 4, TEST_CONTAINER_HASH, test);
@@ -1920,6 +1959,121 @@ AST_TEST_DEFINE(astobj2_test_4)
 	return res;
 }
 
+AST_TEST_DEFINE(astobj2_test_rcu)
+{
+/*!
+ * \brief The number of objects in each snapshot.
+ */
+#define RCU_OBJS 10
+	int res = AST_TEST_PASS;
+	int destructor_count = 0;
+	struct ao2_rcu_container *rcu = NULL;
+	struct ao2_container *first = NULL;
+	struct ao2_container *second = NULL;
+	struct ao2_container *snapshot = NULL;
+	struct test_obj *obj;
+	int count;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "astobj2_test_rcu";
+		info->category = "/main/astobj2/";
+		info->summary = "Test read-copy-update container snapshots";
+		info->description =
+			"Publishes container snapshots in a read-copy-update holder and\n"
+			"checks lookups see the current snapshot while references to a\n"
+			"replaced snapshot stay intact.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	first = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, 17,
+		test_hash_cb, NULL, test_cmp_cb);
+	if (!first || !(rcu = ao2_rcu_container_alloc(first))) {
+		ast_test_status_update(test, "Read-copy-update holder creation failed.\n");
+		res = AST_TEST_FAIL;
+		goto test_cleanup;
+	}
+
+	for (i = 0; i < RCU_OBJS; i++) {
+		obj = ao2_alloc(sizeof(*obj), test_obj_destructor);
+		if (!obj) {
+			ast_test_status_update(test, "test object creation failed.\n");
+			res = AST_TEST_FAIL;
+			goto test_cleanup;
+		}
+		obj->destructor_count = &destructor_count;
+		obj->i = i;
+		++destructor_count;
+		ao2_link(first, obj);
+		ao2_ref(obj, -1);
+	}
+
+	for (i = 0; i < RCU_OBJS; i++) {
+		if (!(obj = ao2_rcu_find(rcu, &i, OBJ_KEY))) {
+			ast_test_status_update(test, "Should have found object %d in snapshot.\n", i);
+			res = AST_TEST_FAIL;
+			goto test_cleanup;
+		}
+		ao2_ref(obj, -1);
+	}
+
+	/* Publish a copy without the first object while holding the old snapshot */
+	snapshot = ao2_rcu_container_ref(rcu);
+	if (snapshot != first) {
+		ast_test_status_update(test, "Snapshot is not the published container.\n");
+		res = AST_TEST_FAIL;
+		goto test_cleanup;
+	}
+	ao2_lock(rcu);
+	second = ao2_container_clone(snapshot, 0);
+	i = 0;
+	if (second) {
+		ao2_find(second, &i, OBJ_KEY | OBJ_UNLINK | OBJ_NODATA);
+		ao2_rcu_container_publish(rcu, second);
+	}
+	ao2_unlock(rcu);
+	if (!second) {
+		ast_test_status_update(test, "Snapshot copy failed.\n");
+		res = AST_TEST_FAIL;
+		goto test_cleanup;
+	}
+
+	if ((obj = ao2_rcu_find(rcu, &i, OBJ_KEY))) {
+		ast_test_status_update(test, "Unlinked object found in the published snapshot.\n");
+		ao2_ref(obj, -1);
+		res = AST_TEST_FAIL;
+	}
+	if (!(obj = ao2_find(snapshot, &i, OBJ_KEY))) {
+		ast_test_status_update(test, "Object missing from the replaced snapshot.\n");
+		res = AST_TEST_FAIL;
+	} else {
+		ao2_ref(obj, -1);
+	}
+
+	count = 0;
+	ao2_rcu_callback(rcu, OBJ_NODATA | OBJ_MULTIPLE, increment_cb, &count);
+	if (count != RCU_OBJS - 1) {
+		ast_test_status_update(test, "Snapshot callback visited %d objects, expected %d.\n",
+			count, RCU_OBJS - 1);
+		res = AST_TEST_FAIL;
+	}
+
+test_cleanup:
+	ao2_cleanup(snapshot);
+	ao2_cleanup(second);
+	ao2_cleanup(first);
+	ao2_cleanup(rcu);
+	if (destructor_count) {
+		ast_test_status_update(test, "%d objects were not destroyed.\n", destructor_count);
+		res = AST_TEST_FAIL;
+	}
+
+	return res;
+}
+
 static enum ast_test_result_state test_performance(struct ast_test *test,
 	enum test_container_type type, unsigned int copt)
 {
@@ -1946,6 +2100,10 @@ static enum ast_test_result_state test_performance(struct ast_test *test,
 		c1 = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_MUTEX, copt,
 			test_sort_cb, test_cmp_cb);
 		break;
+	case TEST_CONTAINER_OPEN_HASH:
+		c1 = ao2_container_alloc_open_hash(AO2_ALLOC_OPT_LOCK_MUTEX, copt, 17,
+			test_hash_cb, NULL, test_cmp_cb);
+		break;
 	}
 
 	for (i = 0; i < OBJS; i++) {
@@ -2045,16 +2203,74 @@ AST_TEST_DEFINE(astobj2_test_perf)
 		return res;
 	}
 	res = testloop(test, TEST_CONTAINER_RBTREE, 0, ITERATIONS);
+	if (!res) {
+		return res;
+	}
+	res = testloop(test, TEST_CONTAINER_OPEN_HASH, 0, ITERATIONS);
 
 	return res;
 }
 
+/*! Objects in the container of the find benchmark */
+#define BENCH_FIND_OBJECTS 1000
+
+/*! The key found next by the find benchmark */
+static int bench_find_key;
+
+static void *bench_find_setup(void)
+{
+	struct ao2_container *c;
+	int i;
+
+	c = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, 127, test_hash_cb, NULL, test_cmp_cb);
+	if (!c) {
+		return NULL;
+	}
+
+	for (i = 0; i < BENCH_FIND_OBJECTS; i++) {
+		struct test_obj *obj = ao2_alloc(sizeof(*obj), test_obj_destructor);
+
+		if (!obj) {
+			ao2_ref(c, -1);
+			return NULL;
+		}
+		obj->i = i;
+		ao2_link(c, obj);
+		ao2_ref(obj, -1);
+	}
+
+	return c;
+}
+
+static void bench_find_run(void *data)
+{
+	ao2_cleanup(ao2_find(data, &bench_find_key, OBJ_SEARCH_KEY));
+	bench_find_key = (bench_find_key + 1) % BENCH_FIND_OBJECTS;
+}
+
+static void bench_find_teardown(void *data)
+{
+	ao2_cleanup(data);
+}
+
+static struct ast_bench_info bench_find = {
+	.name = "find",
+	.category = "/main/astobj2/",
+	.summary = "Find objects by key in a hash container",
+	.setup = bench_find_setup,
+	.run = bench_find_run,
+	.teardown = bench_find_teardown,
+	.batch = 100,
+};
+
 static int unload_module(void)
 {
+	AST_BENCH_UNREGISTER(&bench_find);
 	AST_TEST_UNREGISTER(astobj2_test_1);
 	AST_TEST_UNREGISTER(astobj2_test_2);
 	AST_TEST_UNREGISTER(astobj2_test_3);
 	AST_TEST_UNREGISTER(astobj2_test_4);
+	AST_TEST_UNREGISTER(astobj2_test_rcu);
 	AST_TEST_UNREGISTER(astobj2_test_perf);
 	return 0;
 }
@@ -2065,7 +2281,9 @@ static int load_module(void)
 	AST_TEST_REGISTER(astobj2_test_2);
 	AST_TEST_REGISTER(astobj2_test_3);
 	AST_TEST_REGISTER(astobj2_test_4);
+	AST_TEST_REGISTER(astobj2_test_rcu);
 	AST_TEST_REGISTER(astobj2_test_perf);
+	AST_BENCH_REGISTER(&bench_find);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
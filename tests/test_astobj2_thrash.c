@@ -244,30 +244,29 @@ static int compare_strings(void *lhs, void *rhs, int flags)
 	}
 }
 
-AST_TEST_DEFINE(hash_test)
+/*!
+ * \internal
+ * \brief Thrash a hash container created with the given options
+ *
+ * \param test Test being executed
+ * \param ao2_options Lock options for the container
+ * \param container_options Container behaviour options
+ */
+static enum ast_test_result_state hash_test_run(struct ast_test *test,
+	unsigned int ao2_options, unsigned int container_options)
 {
 	enum ast_test_result_state res = AST_TEST_PASS;
 	struct hash_test data = {};
 	pthread_t grow_thread, count_thread, lookup_thread, shrink_thread;
 	void *thread_results;
+	struct timeval start;
 	int i;
 
-	switch (cmd) {
-	case TEST_INIT:
-		info->name = "thrash";
-		info->category = "/main/astobj2/";
-		info->summary = "Testing astobj2 container concurrency";
-		info->description = "Test astobj2 container concurrency correctness.";
-		return AST_TEST_NOT_RUN;
-	case TEST_EXECUTE:
-		break;
-	}
-
 	ast_test_status_update(test, "Executing hash concurrency test...\n");
 	data.preload = MAX_HASH_ENTRIES / 2;
 	data.max_grow = MAX_HASH_ENTRIES - data.preload;
 	data.deadline = ast_tvadd(ast_tvnow(), ast_tv(MAX_TEST_SECONDS, 0));
-	data.to_be_thrashed = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+	data.to_be_thrashed = ao2_container_alloc_hash(ao2_options, container_options,
 		HASH_BUCKETS, hash_string, NULL, compare_strings);
 
 	if (data.to_be_thrashed == NULL) {
@@ -288,6 +287,7 @@ AST_TEST_DEFINE(hash_test)
 		ao2_ref(ht, -1);
 	}
 
+	start = ast_tvnow();
 	/* add data.max_grow entries to the ao2 container */
 	ast_pthread_create(&grow_thread, NULL, hash_test_grow, &data);
 	/* continually count the keys added by the grow thread */
@@ -325,6 +325,8 @@ AST_TEST_DEFINE(hash_test)
 		res = AST_TEST_FAIL;
 	}
 
+	ast_test_status_update(test, "Thrashing took %" PRIi64 " us\n", ast_tvdiff_us(ast_tvnow(), start));
+
 	if (ao2_container_count(data.to_be_thrashed) != data.max_grow) {
 		ast_test_status_update(test,
 			"Invalid ao2 container size. Expected: %d, Actual: %d\n",
@@ -344,15 +346,178 @@ AST_TEST_DEFINE(hash_test)
 	return res;
 }
 
+AST_TEST_DEFINE(hash_test)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "thrash";
+		info->category = "/main/astobj2/";
+		info->summary = "Testing astobj2 container concurrency";
+		info->description = "Test astobj2 container concurrency correctness.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	return hash_test_run(test, AO2_ALLOC_OPT_LOCK_MUTEX, 0);
+}
+
+AST_TEST_DEFINE(hash_test_sharded)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "thrash_sharded";
+		info->category = "/main/astobj2/";
+		info->summary = "Testing sharded astobj2 container concurrency";
+		info->description =
+			"Test concurrency correctness of a read-write locked hash container\n"
+			"whose buckets are protected by per-shard locks.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	return hash_test_run(test, AO2_ALLOC_OPT_LOCK_RWLOCK, AO2_CONTAINER_ALLOC_OPT_SHARDED);
+}
+
+AST_TEST_DEFINE(hash_test_adaptive)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "thrash_adaptive";
+		info->category = "/main/astobj2/";
+		info->summary = "Testing adaptive locked astobj2 container concurrency";
+		info->description =
+			"Test concurrency correctness of a hash container locked by an\n"
+			"adaptive lock rather than a mutex.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	return hash_test_run(test, AO2_ALLOC_OPT_LOCK_MUTEX | AO2_ALLOC_OPT_LOCK_ADAPTIVE, 0);
+}
+
+/*! Threads locking the same object in the lock benchmark */
+#define LOCK_BENCHMARK_THREADS 4
+/*! Times each thread locks the object */
+#define LOCK_BENCHMARK_LOCKS 1000000
+
+struct lock_benchmark {
+	/*! The object locked */
+	void *obj;
+	/*! Incremented with the object locked */
+	int count;
+};
+
+static void *lock_benchmark_thread(void *d)
+{
+	struct lock_benchmark *data = d;
+	int i;
+
+	for (i = 0; i < LOCK_BENCHMARK_LOCKS; i++) {
+		ao2_lock(data->obj);
+		/* Locked again, as object locks are recursive */
+		if (!(i % 16)) {
+			ao2_lock(data->obj);
+			ao2_unlock(data->obj);
+		}
+		data->count++;
+		ao2_unlock(data->obj);
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Have threads lock an object with the given lock many times
+ *
+ * \return How long it took in microseconds, -1 if the object was not kept consistent
+ */
+static int64_t lock_benchmark_run(struct ast_test *test, unsigned int ao2_options)
+{
+	struct lock_benchmark data = { 0, };
+	pthread_t threads[LOCK_BENCHMARK_THREADS];
+	struct timeval start;
+	int64_t elapsed;
+	int i;
+
+	data.obj = ao2_alloc_options(1, NULL, ao2_options);
+	if (!data.obj) {
+		return -1;
+	}
+
+	start = ast_tvnow();
+	for (i = 0; i < LOCK_BENCHMARK_THREADS; i++) {
+		ast_pthread_create(&threads[i], NULL, lock_benchmark_thread, &data);
+	}
+	for (i = 0; i < LOCK_BENCHMARK_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	elapsed = ast_tvdiff_us(ast_tvnow(), start);
+
+	ao2_ref(data.obj, -1);
+
+	if (data.count != LOCK_BENCHMARK_THREADS * LOCK_BENCHMARK_LOCKS) {
+		ast_test_status_update(test, "Counted %d with the object locked, expected %d\n",
+			data.count, LOCK_BENCHMARK_THREADS * LOCK_BENCHMARK_LOCKS);
+		return -1;
+	}
+
+	return elapsed;
+}
+
+AST_TEST_DEFINE(lock_benchmark)
+{
+	int64_t mutex_us;
+	int64_t adaptive_us;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "lock_benchmark";
+		info->category = "/main/astobj2/";
+		info->summary = "astobj2 object lock benchmark";
+		info->description =
+			"Has several threads lock the same object for a moment many times,\n"
+			"with a mutex and with an adaptive lock.  Checks the object was only\n"
+			"ever held by one thread and reports how long each lock took.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	mutex_us = lock_benchmark_run(test, AO2_ALLOC_OPT_LOCK_MUTEX);
+	if (mutex_us < 0) {
+		return AST_TEST_FAIL;
+	}
+	adaptive_us = lock_benchmark_run(test, AO2_ALLOC_OPT_LOCK_MUTEX | AO2_ALLOC_OPT_LOCK_ADAPTIVE);
+	if (adaptive_us < 0) {
+		return AST_TEST_FAIL;
+	}
+
+	ast_test_status_update(test, "%d threads locking %d times took %" PRIi64 " us with a mutex, %"
+		PRIi64 " us with an adaptive lock\n", LOCK_BENCHMARK_THREADS, LOCK_BENCHMARK_LOCKS,
+		mutex_us, adaptive_us);
+
+	return AST_TEST_PASS;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(hash_test);
+	AST_TEST_UNREGISTER(hash_test_sharded);
+	AST_TEST_UNREGISTER(hash_test_adaptive);
+	AST_TEST_UNREGISTER(lock_benchmark);
 	return 0;
 }
 
 static int load_module(void)
 {
 	AST_TEST_REGISTER(hash_test);
+	AST_TEST_REGISTER(hash_test_sharded);
+	AST_TEST_REGISTER(hash_test_adaptive);
+	AST_TEST_REGISTER(lock_benchmark);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
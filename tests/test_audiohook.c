@@ -0,0 +1,203 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Audiohook unit tests
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/module.h"
+#include "asterisk/test.h"
+#include "asterisk/audiohook.h"
+#include "asterisk/channel.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/frame.h"
+#include "asterisk/time.h"
+
+/*! How many spies are put on the channel */
+#define SPIES 100
+/*! How many 20ms frames the channel reads, kept short of what a spy may queue */
+#define FRAMES 20
+/*! Samples of a 20ms frame at 16kHz */
+#define FRAME_SAMPLES 320
+/*! Samples the spies read back at 8kHz, 300ms worth */
+#define READ_SAMPLES 2400
+
+/*!
+ * \internal
+ * \brief Have a channel read a number of frames of signed linear at 16kHz
+ *
+ * \return How long writing them to the audiohooks took, in microseconds
+ */
+static int64_t channel_read_frames(struct ast_channel *chan)
+{
+	int16_t buf[FRAME_SAMPLES];
+	struct timeval start;
+	int64_t elapsed = 0;
+	int i;
+	int j;
+
+	for (i = 0; i < FRAMES; i++) {
+		struct ast_frame frame = {
+			.frametype = AST_FRAME_VOICE,
+			.subclass.format = ast_format_slin16,
+			.data.ptr = buf,
+			.datalen = sizeof(buf),
+			.samples = FRAME_SAMPLES,
+			.src = __FUNCTION__,
+		};
+		struct ast_frame *out;
+
+		for (j = 0; j < FRAME_SAMPLES; j++) {
+			/* A 500Hz square wave, which survives resampling */
+			buf[j] = ((i * FRAME_SAMPLES + j) / 16) % 2 ? 8000 : -8000;
+		}
+
+		ast_channel_lock(chan);
+		start = ast_tvnow();
+		out = ast_audiohook_write_list(chan, ast_channel_audiohooks(chan),
+			AST_AUDIOHOOK_DIRECTION_READ, &frame);
+		elapsed += ast_tvdiff_us(ast_tvnow(), start);
+		ast_channel_unlock(chan);
+
+		if (out != &frame) {
+			ast_frfree(out);
+		}
+	}
+
+	return elapsed;
+}
+
+AST_TEST_DEFINE(many_spies)
+{
+	struct ast_channel *chan;
+	struct ast_audiohook *spies;
+	struct ast_frame *reference = NULL;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int64_t one_spy;
+	int64_t all_spies;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "many_spies";
+		info->category = "/main/audiohook/";
+		info->summary = "Many spies on a channel get the same audio";
+		info->description =
+			"Puts many spies reading at 8kHz on a channel reading audio at\n"
+			"16kHz, and checks every one of them gets the same audio, which\n"
+			"is resampled once for all of them.  How long feeding one spy and\n"
+			"feeding all of them took is reported.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	spies = ast_calloc(SPIES, sizeof(*spies));
+	if (!spies) {
+		return AST_TEST_FAIL;
+	}
+	for (i = 0; i < SPIES; i++) {
+		ast_audiohook_init(&spies[i], AST_AUDIOHOOK_TYPE_SPY, "many_spies", 0);
+	}
+
+	chan = ast_channel_alloc(0, AST_STATE_DOWN, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, "TestChannel");
+	ast_test_validate_cleanup(test, chan, res, done);
+	ast_channel_unlock(chan);
+
+	ast_test_validate_cleanup(test, !ast_audiohook_attach(chan, &spies[0]), res, done);
+	one_spy = channel_read_frames(chan);
+
+	/* Start everyone off with nothing so they can be compared */
+	ast_audiohook_lock(&spies[0]);
+	ast_slinfactory_flush(&spies[0].read_factory);
+	ast_slinfactory_flush(&spies[0].write_factory);
+	ast_audiohook_unlock(&spies[0]);
+
+	for (i = 1; i < SPIES; i++) {
+		ast_test_validate_cleanup(test, !ast_audiohook_attach(chan, &spies[i]), res, done);
+	}
+	all_spies = channel_read_frames(chan);
+
+	ast_test_status_update(test, "Feeding %d frames took %" PRId64 "us for one spy and %" PRId64
+		"us for %d spies\n", FRAMES, one_spy, all_spies, SPIES);
+
+	for (i = 0; i < SPIES; i++) {
+		struct ast_frame *frame;
+
+		ast_audiohook_lock(&spies[i]);
+		frame = ast_audiohook_read_frame(&spies[i], READ_SAMPLES, AST_AUDIOHOOK_DIRECTION_READ,
+			ast_format_slin);
+		ast_audiohook_unlock(&spies[i]);
+
+		if (!frame) {
+			ast_test_status_update(test, "Spy %d has no audio\n", i);
+			res = AST_TEST_FAIL;
+			break;
+		}
+
+		if (!reference) {
+			reference = frame;
+			continue;
+		}
+
+		if (frame->datalen != reference->datalen
+			|| memcmp(frame->data.ptr, reference->data.ptr, frame->datalen)) {
+			ast_test_status_update(test, "Spy %d got different audio than the first\n", i);
+			res = AST_TEST_FAIL;
+		}
+		ast_frfree(frame);
+		if (res != AST_TEST_PASS) {
+			break;
+		}
+	}
+
+done:
+	if (reference) {
+		ast_frfree(reference);
+	}
+	if (chan) {
+		/* Hanging up takes the spies off the channel */
+		ast_hangup(chan);
+	}
+	for (i = 0; i < SPIES; i++) {
+		ast_audiohook_destroy(&spies[i]);
+	}
+	ast_free(spies);
+
+	return res;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(many_spies);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(many_spies);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Audiohook tests");
@@ -31,6 +31,8 @@
 
 #include "asterisk.h"
 
+#include <inttypes.h>
+
 #include "asterisk/module.h"
 #include "asterisk/test.h"
 #include "asterisk/channel.h"
@@ -102,10 +104,276 @@ done:
 	return res;
 }
 
+AST_TEST_DEFINE(lookup)
+{
+	struct ast_assigned_ids ids[] = {
+		{ .uniqueid = "test-lookup-1000.1" },
+		{ .uniqueid = "test-lookup-1000.2" },
+		{ .uniqueid = "test-lookup-2000.1" },
+	};
+	const char *names[] = {
+		"TestLookup/alpha-1",
+		"TestLookup/alpha-2",
+		"TestLookup/beta-1",
+	};
+	struct ast_channel *mock_channels[ARRAY_LEN(ids)] = { NULL, };
+	struct ast_channel_iterator *iter;
+	struct ast_channel *chan;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int count;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "lookup";
+		info->category = "/main/channel/";
+		info->summary = "channel lookup by name and uniqueid test";
+		info->description =
+			"Test that channels are found by their whole name, a name prefix, their\n"
+			"uniqueid and a uniqueid prefix, and by their new name after a rename";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (i = 0; i < ARRAY_LEN(ids); i++) {
+		mock_channels[i] = ast_channel_alloc(0, AST_STATE_DOWN, NULL, NULL, NULL, NULL, NULL,
+			&ids[i], NULL, 0, "%s", names[i]);
+		ast_test_validate_cleanup(test, mock_channels[i], res, done);
+		ast_channel_unlock(mock_channels[i]);
+	}
+
+	chan = ast_channel_get_by_name("testlookup/ALPHA-2");
+	ast_test_validate_cleanup(test, chan == mock_channels[1], res, done);
+	ast_channel_cleanup(chan);
+
+	chan = ast_channel_get_by_name_prefix("TestLookup/beta-1;junk", strlen("TestLookup/beta"));
+	ast_test_validate_cleanup(test, chan == mock_channels[2], res, done);
+	ast_channel_cleanup(chan);
+
+	chan = ast_channel_get_by_name("test-lookup-1000.1");
+	ast_test_validate_cleanup(test, chan == mock_channels[0], res, done);
+	ast_channel_cleanup(chan);
+
+	chan = ast_channel_get_by_name_prefix("test-lookup-2000", strlen("test-lookup-2000"));
+	ast_test_validate_cleanup(test, chan == mock_channels[2], res, done);
+	ast_channel_cleanup(chan);
+
+	chan = ast_channel_get_by_name("TestLookup/alpha");
+	ast_test_validate_cleanup(test, !chan, res, done);
+
+	iter = ast_channel_iterator_by_name_new("TestLookup/alpha-", strlen("TestLookup/alpha-"));
+	ast_test_validate_cleanup(test, iter, res, done);
+	for (count = 0; (chan = ast_channel_iterator_next(iter)); ast_channel_unref(chan)) {
+		ast_test_validate_cleanup(test, chan == mock_channels[0] || chan == mock_channels[1], res, done);
+		count++;
+	}
+	ast_channel_iterator_destroy(iter);
+	ast_test_validate_cleanup(test, count == 2, res, done);
+
+	ast_change_name(mock_channels[0], "TestLookup/gamma-1");
+	chan = ast_channel_get_by_name("TestLookup/alpha-1");
+	ast_test_validate_cleanup(test, !chan, res, done);
+	chan = ast_channel_get_by_name("TestLookup/gamma-1");
+	ast_test_validate_cleanup(test, chan == mock_channels[0], res, done);
+	ast_channel_cleanup(chan);
+
+done:
+	for (i = 0; i < ARRAY_LEN(mock_channels); i++) {
+		if (mock_channels[i]) {
+			ast_hangup(mock_channels[i]);
+		}
+	}
+
+	return res;
+}
+
+/*! Number of channels allocated and freed by the benchmark */
+#define ALLOC_BENCHMARK_CHANNELS 2000
+
+AST_TEST_DEFINE(alloc_benchmark)
+{
+	struct ast_channel *mock_channel;
+	struct timeval start;
+	int64_t elapsed_us;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "alloc_benchmark";
+		info->category = "/main/channel/";
+		info->summary = "channel allocation benchmark";
+		info->description =
+			"Allocates and hangs up many channels one after another and reports\n"
+			"how many it manages each second";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	start = ast_tvnow();
+	for (i = 0; i < ALLOC_BENCHMARK_CHANNELS; i++) {
+		mock_channel = ast_channel_alloc(0, AST_STATE_DOWN, "100", "Benchmark", NULL, "s", "default",
+			NULL, NULL, 0, "TestBenchmark/%d", i);
+		if (!mock_channel) {
+			ast_test_status_update(test, "Failed to allocate channel %d\n", i);
+			return AST_TEST_FAIL;
+		}
+		ast_channel_unlock(mock_channel);
+		ast_hangup(mock_channel);
+	}
+	elapsed_us = ast_tvdiff_us(ast_tvnow(), start);
+
+	ast_test_status_update(test, "%d channels allocated and hung up in %" PRIi64 " us, %" PRIi64 " per second\n",
+		ALLOC_BENCHMARK_CHANNELS, elapsed_us,
+		elapsed_us ? (int64_t) ALLOC_BENCHMARK_CHANNELS * 1000000 / elapsed_us : 0);
+
+	return AST_TEST_PASS;
+}
+
+/*! Number of outgoing channels rung at once by the ring group benchmark */
+#define RING_GROUP_LEGS 50
+/*! Number of times every leg of the ring group has input */
+#define RING_GROUP_ROUNDS 200
+
+/*!
+ * \internal
+ * \brief Read the input of every channel of a ring group, one wait for each
+ *
+ * \return The number of waits, -1 on error
+ */
+static int ring_group_read_each(struct ast_channel **legs, int count)
+{
+	struct ast_channel *winner;
+	struct ast_frame *f;
+	int waits = 0;
+	int pending;
+	int ms;
+
+	for (pending = count; pending; pending--) {
+		ms = 1000;
+		winner = ast_waitfor_n(legs, count, &ms);
+		if (!winner || !(f = ast_read(winner))) {
+			return -1;
+		}
+		ast_frfree(f);
+		waits++;
+	}
+
+	return waits;
+}
+
+/*!
+ * \internal
+ * \brief Read the input of every channel of a ring group after each wait for all with input
+ *
+ * \return The number of waits, -1 on error
+ */
+static int ring_group_read_ready(struct ast_channel **legs, int count)
+{
+	int ready[RING_GROUP_LEGS + 1];
+	struct ast_frame *f;
+	int waits = 0;
+	int pending = count;
+	int nready;
+	int ms;
+	int i;
+
+	while (pending) {
+		ms = 1000;
+		nready = ast_waitfor_n_ready(legs, count, &ms, ready);
+		if (!nready) {
+			return -1;
+		}
+		for (i = 0; i < nready; i++) {
+			if (!(f = ast_read(legs[ready[i]]))) {
+				return -1;
+			}
+			ast_frfree(f);
+		}
+		pending -= nready;
+		waits++;
+	}
+
+	return waits;
+}
+
+AST_TEST_DEFINE(ring_group_benchmark)
+{
+	struct ast_channel *legs[RING_GROUP_LEGS + 1] = { NULL, };
+	enum ast_test_result_state res = AST_TEST_PASS;
+	struct timeval start;
+	int64_t each_us = 0;
+	int64_t ready_us = 0;
+	int64_t each_waits = 0;
+	int64_t ready_waits = 0;
+	int waits;
+	int round;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "ring_group_benchmark";
+		info->category = "/main/channel/";
+		info->summary = "ring group wait benchmark";
+		info->description =
+			"Has every outgoing channel of a large ring group, and its caller,\n"
+			"get input at once and reads it all, waiting for one channel with\n"
+			"input at a time and waiting for all channels with input.  Checks\n"
+			"a single wait finds them all and reports how long both took.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (i = 0; i < ARRAY_LEN(legs); i++) {
+		legs[i] = ast_channel_alloc(0, AST_STATE_DOWN, NULL, NULL, NULL, NULL, NULL,
+			NULL, NULL, 0, "TestRingGroup/%d", i);
+		ast_test_validate_cleanup(test, legs[i], res, done);
+		ast_channel_unlock(legs[i]);
+	}
+
+	for (round = 0; round < RING_GROUP_ROUNDS; round++) {
+		for (i = 0; i < ARRAY_LEN(legs); i++) {
+			ast_queue_frame(legs[i], &ast_null_frame);
+		}
+		start = ast_tvnow();
+		waits = ring_group_read_each(legs, ARRAY_LEN(legs));
+		each_us += ast_tvdiff_us(ast_tvnow(), start);
+		ast_test_validate_cleanup(test, waits == ARRAY_LEN(legs), res, done);
+		each_waits += waits;
+
+		for (i = 0; i < ARRAY_LEN(legs); i++) {
+			ast_queue_frame(legs[i], &ast_null_frame);
+		}
+		start = ast_tvnow();
+		waits = ring_group_read_ready(legs, ARRAY_LEN(legs));
+		ready_us += ast_tvdiff_us(ast_tvnow(), start);
+		ast_test_validate_cleanup(test, waits == 1, res, done);
+		ready_waits += waits;
+	}
+
+	ast_test_status_update(test, "%d rounds of input on %d channels: %" PRIi64 " waits in %" PRIi64
+		" us one at a time, %" PRIi64 " waits in %" PRIi64 " us all at once\n",
+		RING_GROUP_ROUNDS, (int) ARRAY_LEN(legs), each_waits, each_us, ready_waits, ready_us);
+
+done:
+	for (i = 0; i < ARRAY_LEN(legs); i++) {
+		if (legs[i]) {
+			ast_hangup(legs[i]);
+		}
+	}
+
+	return res;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(set_fd_grow);
 	AST_TEST_UNREGISTER(add_fd);
+	AST_TEST_UNREGISTER(lookup);
+	AST_TEST_UNREGISTER(alloc_benchmark);
+	AST_TEST_UNREGISTER(ring_group_benchmark);
 	return 0;
 }
 
@@ -113,6 +381,9 @@ static int load_module(void)
 {
 	AST_TEST_REGISTER(set_fd_grow);
 	AST_TEST_REGISTER(add_fd);
+	AST_TEST_REGISTER(lookup);
+	AST_TEST_REGISTER(alloc_benchmark);
+	AST_TEST_REGISTER(ring_group_benchmark);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
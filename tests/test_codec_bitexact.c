@@ -0,0 +1,293 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Codec bit-exactness tests
+ *
+ * Runs a fixed signal through the G.722 and GSM translators and checks
+ * what comes out of the encoders and decoders against checksums taken
+ * from the reference scalar implementations, so the vector versions of
+ * their filters and searches cannot drift from them.
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <inttypes.h>
+
+#include "asterisk/translate.h"
+#include "asterisk/frame.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/utils.h"
+#include "asterisk/test.h"
+#include "asterisk/module.h"
+
+/*! The signal is made of sections of each kind, this many ms long */
+#define SECTION_MS 200
+/*! Length of the signal */
+#define SIGNAL_MS 2000
+/*! Length of the frames it is translated in */
+#define FRAME_MS 20
+
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME 16777619U
+
+/*!
+ * \internal
+ * \brief Generate a signal exercising loud, quiet and noisy input
+ *
+ * Only integer arithmetic is used so the signal, and with it the
+ * checksums, are the same everywhere.
+ */
+static void signal_generate(int16_t *out, int samples, int section_samples)
+{
+	uint32_t seed = 12345;
+	int phase = 0;
+	int step = 40;
+	int i;
+
+	for (i = 0; i < samples; i++) {
+		int triangle;
+		int noise;
+		int value;
+
+		/* A triangle wave sweeping up in pitch */
+		if (!(i % 64)) {
+			step += 3;
+		}
+		phase = (phase + step) & 0xffff;
+		triangle = phase < 0x8000 ? phase - 0x4000 : 0xc000 - phase;
+
+		seed = seed * 1103515245 + 12345;
+		noise = (int) ((seed >> 16) & 0x3fff) - 0x2000;
+
+		switch ((i / section_samples) % 4) {
+		case 0:
+			value = triangle * 2;
+			break;
+		case 1:
+			value = triangle / 8 + noise / 16;
+			break;
+		case 2:
+			value = noise * 4;
+			break;
+		default:
+			value = noise / 256;
+			break;
+		}
+		out[i] = MAX(MIN(value, 32767), -32768);
+	}
+}
+
+static uint32_t checksum_bytes(uint32_t checksum, const uint8_t *data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		checksum = (checksum ^ data[i]) * FNV_PRIME;
+	}
+	return checksum;
+}
+
+/*! \brief Checksum samples a byte at a time, least significant first, whatever the byte order */
+static uint32_t checksum_samples(uint32_t checksum, const int16_t *data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		checksum = (checksum ^ (data[i] & 0xff)) * FNV_PRIME;
+		checksum = (checksum ^ ((data[i] >> 8) & 0xff)) * FNV_PRIME;
+	}
+	return checksum;
+}
+
+/*!
+ * \internal
+ * \brief Translate a buffer frame by frame, appending what comes out to another
+ *
+ * \return The number of bytes written to out, or -1 on failure
+ */
+static int translate_buffer(struct ast_test *test, struct ast_format *src, struct ast_format *dst,
+	const uint8_t *in, size_t in_len, size_t frame_len, int frame_samples,
+	uint8_t *out, size_t out_size)
+{
+	struct ast_trans_pvt *path;
+	size_t offset;
+	size_t out_len = 0;
+
+	path = ast_translator_build_path(dst, src);
+	if (!path) {
+		ast_test_status_update(test, "No translation path from %s to %s\n",
+			ast_format_get_name(src), ast_format_get_name(dst));
+		return -1;
+	}
+
+	for (offset = 0; offset + frame_len <= in_len; offset += frame_len) {
+		struct ast_frame frame = {
+			.frametype = AST_FRAME_VOICE,
+			.subclass.format = src,
+			.data.ptr = (void *) (in + offset),
+			.datalen = frame_len,
+			.samples = frame_samples,
+			.src = __FUNCTION__,
+		};
+		struct ast_frame *translated;
+		struct ast_frame *cur;
+
+		translated = ast_translate(path, &frame, 0);
+		for (cur = translated; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+			if (out_len + cur->datalen > out_size) {
+				ast_test_status_update(test, "Translating from %s to %s gave too much\n",
+					ast_format_get_name(src), ast_format_get_name(dst));
+				ast_frfree(translated);
+				ast_translator_free_path(path);
+				return -1;
+			}
+			memcpy(out + out_len, cur->data.ptr, cur->datalen);
+			out_len += cur->datalen;
+		}
+		if (translated) {
+			ast_frfree(translated);
+		}
+	}
+	ast_translator_free_path(path);
+
+	return out_len;
+}
+
+/*!
+ * \internal
+ * \brief Encode the signal, decode it again and check both against the reference
+ */
+static enum ast_test_result_state codec_bitexact(struct ast_test *test, struct ast_format *slin,
+	struct ast_format *codec, size_t codec_frame_len, uint32_t expected_encoded, uint32_t expected_decoded)
+{
+	int rate = ast_format_get_sample_rate(slin);
+	int samples = rate * SIGNAL_MS / 1000;
+	int frame_samples = rate * FRAME_MS / 1000;
+	enum ast_test_result_state res = AST_TEST_FAIL;
+	int16_t *signal;
+	uint8_t *encoded;
+	int16_t *decoded;
+	int encoded_len;
+	int decoded_len;
+	uint32_t checksum;
+
+	signal = ast_malloc(samples * sizeof(*signal));
+	encoded = ast_malloc(samples * sizeof(*signal));
+	decoded = ast_malloc(samples * sizeof(*decoded));
+	if (!signal || !encoded || !decoded) {
+		goto cleanup;
+	}
+
+	signal_generate(signal, samples, rate * SECTION_MS / 1000);
+
+	encoded_len = translate_buffer(test, slin, codec, (uint8_t *) signal, samples * sizeof(*signal),
+		frame_samples * sizeof(*signal), frame_samples, encoded, samples * sizeof(*signal));
+	if (encoded_len < 0) {
+		goto cleanup;
+	}
+	checksum = checksum_bytes(FNV_OFFSET_BASIS, encoded, encoded_len);
+	ast_test_status_update(test, "%s encoded to %d bytes with checksum %08" PRIx32 "\n",
+		ast_format_get_name(codec), encoded_len, checksum);
+	if (checksum != expected_encoded) {
+		ast_test_status_update(test, "Expected checksum %08" PRIx32 "\n", expected_encoded);
+		goto cleanup;
+	}
+
+	decoded_len = translate_buffer(test, codec, slin, encoded, encoded_len,
+		codec_frame_len, frame_samples, (uint8_t *) decoded, samples * sizeof(*decoded));
+	if (decoded_len < 0) {
+		goto cleanup;
+	}
+	checksum = checksum_samples(FNV_OFFSET_BASIS, decoded, decoded_len / sizeof(*decoded));
+	ast_test_status_update(test, "%s decoded to %d samples with checksum %08" PRIx32 "\n",
+		ast_format_get_name(codec), (int) (decoded_len / sizeof(*decoded)), checksum);
+	if (checksum != expected_decoded) {
+		ast_test_status_update(test, "Expected checksum %08" PRIx32 "\n", expected_decoded);
+		goto cleanup;
+	}
+
+	res = AST_TEST_PASS;
+
+cleanup:
+	ast_free(signal);
+	ast_free(encoded);
+	ast_free(decoded);
+
+	return res;
+}
+
+AST_TEST_DEFINE(g722_bitexact)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "g722_bitexact";
+		info->category = "/main/codec/bitexact/";
+		info->summary = "Check G.722 encodes and decodes exactly as the reference does";
+		info->description =
+			"Encodes a signal from signed linear at 16kHz to G.722, decodes\n"
+			"it again and checks the results against checksums taken from\n"
+			"the scalar implementation of the codec.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	/* 20ms of G.722 at 64kbps is 160 bytes */
+	return codec_bitexact(test, ast_format_slin16, ast_format_g722, 160, 0xdefdf509, 0x68d42f03);
+}
+
+AST_TEST_DEFINE(gsm_bitexact)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "gsm_bitexact";
+		info->category = "/main/codec/bitexact/";
+		info->summary = "Check GSM encodes and decodes exactly as the reference does";
+		info->description =
+			"Encodes a signal from signed linear to GSM, decodes it again\n"
+			"and checks the results against checksums taken from the scalar\n"
+			"implementation of the codec.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	/* 20ms of GSM is a single 33 byte frame */
+	return codec_bitexact(test, ast_format_slin, ast_format_gsm, 33, 0x4ea772d0, 0x5957bda2);
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(g722_bitexact);
+	AST_TEST_UNREGISTER(gsm_bitexact);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(g722_bitexact);
+	AST_TEST_REGISTER(gsm_bitexact);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Codec bit-exactness tests");
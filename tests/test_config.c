@@ -1044,6 +1044,148 @@ out:
 	return res;
 }
 
+/*!
+ * \brief Write a config file in the config directory
+ */
+static int write_file(const char *name, const char *contents)
+{
+	FILE *config_file;
+	char filename[PATH_MAX];
+
+	snprintf(filename, sizeof(filename), "%s/%s", ast_config_AST_CONFIG_DIR, name);
+	config_file = fopen(filename, "w");
+	if (!config_file) {
+		return -1;
+	}
+	fputs(contents, config_file);
+	fclose(config_file);
+
+	return 0;
+}
+
+AST_TEST_DEFINE(config_parsed_cache)
+{
+	enum ast_test_result_state res = AST_TEST_FAIL;
+	struct ast_flags config_flags = { 0 };
+	struct ast_flags reload_flags = { CONFIG_FLAG_FILEUNCHANGED };
+	struct ast_config *first = NULL;
+	struct ast_config *second = NULL;
+	struct ast_config *reloaded;
+	struct ast_category *cat;
+	struct ast_str *templates;
+	const char *value;
+	char filename[PATH_MAX];
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "config_parsed_cache";
+		info->category = "/main/config/";
+		info->summary = "Test sharing parsed config files";
+		info->description =
+			"Loads a config file with a template and an include from two\n"
+			"modules and checks both get the same independent config, that\n"
+			"the second still finds it unchanged on reload and that changing\n"
+			"the include, even without changing its size, is noticed.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (write_file(CONFIG_FILE,
+			"[base](!)\n"
+			"shared = yes\n"
+			"\n"
+			"[first](base)\n"
+			"value = one\n"
+			"\n"
+			"#include " CONFIG_INCLUDE_FILE "\n")
+		|| write_file(CONFIG_INCLUDE_FILE,
+			"[second](base)\n"
+			"value = aaa\n")) {
+		ast_test_status_update(test, "Could not write the config files\n");
+		goto out;
+	}
+
+	first = ast_config_load2(CONFIG_FILE, "test_parsed_first", config_flags);
+	second = ast_config_load2(CONFIG_FILE, "test_parsed_second", config_flags);
+	if (!first || !second) {
+		ast_test_status_update(test, "Could not load the config file\n");
+		goto out;
+	}
+
+	value = ast_variable_retrieve(second, "second", "value");
+	if (!value || strcmp(value, "aaa")) {
+		ast_test_status_update(test, "Included value is '%s' instead of 'aaa'\n", S_OR(value, ""));
+		goto out;
+	}
+	value = ast_variable_retrieve(second, "second", "shared");
+	if (!value || strcmp(value, "yes")) {
+		ast_test_status_update(test, "Inherited value is '%s' instead of 'yes'\n", S_OR(value, ""));
+		goto out;
+	}
+
+	cat = ast_category_get(second, "base", "TEMPLATES=restrict");
+	if (!cat || !ast_category_is_template(cat)) {
+		ast_test_status_update(test, "Template is missing\n");
+		goto out;
+	}
+	cat = ast_category_get(second, "first", NULL);
+	templates = cat ? ast_category_get_templates(cat) : NULL;
+	if (!templates || strcmp(ast_str_buffer(templates), "base")) {
+		ast_test_status_update(test, "Category does not inherit from the template\n");
+		ast_free(templates);
+		goto out;
+	}
+	ast_free(templates);
+
+	/* Each load gets a config of its own */
+	if (ast_variable_update(ast_category_get(first, "first", NULL), "value", "changed", NULL, 0)) {
+		ast_test_status_update(test, "Could not change the first config\n");
+		goto out;
+	}
+	value = ast_variable_retrieve(second, "first", "value");
+	if (!value || strcmp(value, "one")) {
+		ast_test_status_update(test, "Changing one config changed the other\n");
+		goto out;
+	}
+
+	reloaded = ast_config_load2(CONFIG_FILE, "test_parsed_second", reload_flags);
+	if (reloaded != CONFIG_STATUS_FILEUNCHANGED) {
+		ast_test_status_update(test, "Config file is not unchanged for the second module\n");
+		if (reloaded != CONFIG_STATUS_FILEINVALID) {
+			ast_config_destroy(reloaded);
+		}
+		goto out;
+	}
+
+	if (write_file(CONFIG_INCLUDE_FILE,
+			"[second](base)\n"
+			"value = bbb\n")) {
+		ast_test_status_update(test, "Could not rewrite the include file\n");
+		goto out;
+	}
+
+	ast_config_destroy(second);
+	second = ast_config_load2(CONFIG_FILE, "test_parsed_second", config_flags);
+	value = second ? ast_variable_retrieve(second, "second", "value") : NULL;
+	if (!value || strcmp(value, "bbb")) {
+		ast_test_status_update(test, "Included value is '%s' instead of 'bbb'\n", S_OR(value, ""));
+		goto out;
+	}
+
+	res = AST_TEST_PASS;
+
+out:
+	ast_config_destroy(first);
+	ast_config_destroy(second);
+	snprintf(filename, sizeof(filename), "%s/%s", ast_config_AST_CONFIG_DIR, CONFIG_FILE);
+	unlink(filename);
+	snprintf(filename, sizeof(filename), "%s/%s", ast_config_AST_CONFIG_DIR, CONFIG_INCLUDE_FILE);
+	unlink(filename);
+
+	return res;
+}
+
 enum {
 	EXPECT_FAIL = 0,
 	EXPECT_SUCCEED,
@@ -1980,6 +2122,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(config_template_ops);
 	AST_TEST_UNREGISTER(copy_config);
 	AST_TEST_UNREGISTER(config_hook);
+	AST_TEST_UNREGISTER(config_parsed_cache);
 	AST_TEST_UNREGISTER(ast_parse_arg_test);
 	AST_TEST_UNREGISTER(config_options_test);
 	AST_TEST_UNREGISTER(config_dialplan_function);
@@ -1997,6 +2140,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(config_template_ops);
 	AST_TEST_REGISTER(copy_config);
 	AST_TEST_REGISTER(config_hook);
+	AST_TEST_REGISTER(config_parsed_cache);
 	AST_TEST_REGISTER(ast_parse_arg_test);
 	AST_TEST_REGISTER(config_options_test);
 	AST_TEST_REGISTER(config_dialplan_function);
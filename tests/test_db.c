@@ -35,6 +35,9 @@
 #include "asterisk/module.h"
 #include "asterisk/astdb.h"
 #include "asterisk/logger.h"
+#include "asterisk/options.h"
+#include "asterisk/time.h"
+#include "asterisk/utils.h"
 
 enum {
 	FAMILY = 0,
@@ -231,6 +234,130 @@ AST_TEST_DEFINE(perftest)
 	return res;
 }
 
+/*! Keys the concurrent benchmark reads */
+#define CONCURRENT_KEYS 1000
+/*! Threads reading during the concurrent benchmark */
+#define CONCURRENT_READERS 8
+/*! Reads each thread performs */
+#define CONCURRENT_READS 20000
+/*! Writes performed during the concurrent benchmark */
+#define CONCURRENT_WRITES 2000
+
+struct concurrent_data {
+	/*! Reads that did not find the key */
+	int read_failures;
+	/*! Writes not seen by a read right after */
+	int write_failures;
+};
+
+static void *concurrent_read(void *obj)
+{
+	struct concurrent_data *data = obj;
+	char key[16];
+	char buf[16];
+	int i;
+
+	for (i = 0; i < CONCURRENT_READS; i++) {
+		snprintf(key, sizeof(key), "%d", (int) (ast_random() % CONCURRENT_KEYS));
+		if (ast_db_get("astdbtest", key, buf, sizeof(buf))) {
+			ast_atomic_fetchadd_int(&data->read_failures, 1);
+		}
+	}
+
+	return NULL;
+}
+
+static void *concurrent_write(void *obj)
+{
+	struct concurrent_data *data = obj;
+	char value[16];
+	char buf[16];
+	int i;
+
+	for (i = 0; i < CONCURRENT_WRITES; i++) {
+		snprintf(value, sizeof(value), "%d", i);
+		if (ast_db_put("astdbtest_writes", "key", value)
+			|| ast_db_get("astdbtest_writes", "key", buf, sizeof(buf))
+			|| strcmp(value, buf)) {
+			ast_atomic_fetchadd_int(&data->write_failures, 1);
+		}
+	}
+
+	return NULL;
+}
+
+AST_TEST_DEFINE(perftest_concurrent)
+{
+	int res = AST_TEST_PASS;
+	struct concurrent_data data = { 0, };
+	pthread_t readers[CONCURRENT_READERS];
+	pthread_t writer = AST_PTHREADT_NULL;
+	struct timeval start;
+	int64_t elapsed;
+	char buf[16];
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "perftest_concurrent";
+		info->category = "/main/astdb/";
+		info->summary = "astdb concurrent performance unit test";
+		info->description =
+			"Measure astdb performance with several threads reading while\n"
+			"another writes, and ensure every write is read back right away.\n"
+			"Set astdb_read_connections in asterisk.conf to compare the modes.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (i = 0; i < CONCURRENT_KEYS; i++) {
+		sprintf(buf, "%d", i);
+		ast_db_put("astdbtest", buf, buf);
+	}
+
+	start = ast_tvnow();
+	if (ast_pthread_create(&writer, NULL, concurrent_write, &data)) {
+		writer = AST_PTHREADT_NULL;
+		res = AST_TEST_FAIL;
+	}
+	for (i = 0; i < CONCURRENT_READERS; i++) {
+		if (ast_pthread_create(&readers[i], NULL, concurrent_read, &data)) {
+			readers[i] = AST_PTHREADT_NULL;
+			res = AST_TEST_FAIL;
+		}
+	}
+	for (i = 0; i < CONCURRENT_READERS; i++) {
+		if (readers[i] != AST_PTHREADT_NULL) {
+			pthread_join(readers[i], NULL);
+		}
+	}
+	if (writer != AST_PTHREADT_NULL) {
+		pthread_join(writer, NULL);
+	}
+	elapsed = MAX(ast_tvdiff_ms(ast_tvnow(), start), 1);
+
+	ast_test_status_update(test, "%d reads and %d writes with %u read connections in %" PRId64 " ms"
+		" (%" PRId64 " reads/s, %" PRId64 " writes/s)\n",
+		CONCURRENT_READERS * CONCURRENT_READS, CONCURRENT_WRITES, ast_option_astdb_read_connections,
+		elapsed, (int64_t) CONCURRENT_READERS * CONCURRENT_READS * 1000 / elapsed,
+		(int64_t) CONCURRENT_WRITES * 1000 / elapsed);
+
+	if (data.read_failures) {
+		ast_test_status_update(test, "%d reads failed\n", data.read_failures);
+		res = AST_TEST_FAIL;
+	}
+	if (data.write_failures) {
+		ast_test_status_update(test, "%d writes were not read back\n", data.write_failures);
+		res = AST_TEST_FAIL;
+	}
+
+	ast_db_deltree("astdbtest", NULL);
+	ast_db_deltree("astdbtest_writes", NULL);
+
+	return res;
+}
+
 AST_TEST_DEFINE(put_get_long)
 {
 	int res = AST_TEST_PASS;
@@ -293,6 +420,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(put_get_del);
 	AST_TEST_UNREGISTER(gettree_deltree);
 	AST_TEST_UNREGISTER(perftest);
+	AST_TEST_UNREGISTER(perftest_concurrent);
 	AST_TEST_UNREGISTER(put_get_long);
 	return 0;
 }
@@ -302,6 +430,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(put_get_del);
 	AST_TEST_REGISTER(gettree_deltree);
 	AST_TEST_REGISTER(perftest);
+	AST_TEST_REGISTER(perftest_concurrent);
 	AST_TEST_REGISTER(put_get_long);
 	return AST_MODULE_LOAD_SUCCESS;
 }
@@ -1296,6 +1296,190 @@ cleanup:
 	return res;
 }
 
+/*! \brief How many times the caching mock resolver's resolve() method has been called */
+static int cache_resolves;
+
+/*!
+ * \brief Thread spawned by the caching mock resolver
+ *
+ * Waits a little, so that other queries for the same name arrive while
+ * this one is being resolved, and then answers names starting with "nx."
+ * with NXDOMAIN and everything else with an A record.
+ *
+ * \param dns_query The ast_dns_query that is being resolved
+ * \return NULL
+ */
+static void *cache_resolution_thread(void *dns_query)
+{
+	struct ast_dns_query *query = dns_query;
+	struct in_addr addr;
+
+	usleep(100000);
+
+	if (!strncmp(ast_dns_query_get_name(query), "nx.", 3)) {
+		ast_dns_resolver_set_result(query, 0, 0, NXDOMAIN, ast_dns_query_get_name(query), NULL, 0);
+	} else {
+		ast_dns_resolver_set_result(query, 0, 0, NOERROR, ast_dns_query_get_name(query), DNS_ANSWER, DNS_ANSWER_SIZE);
+		inet_pton(AF_INET, "127.0.0.1", &addr);
+		ast_dns_resolver_add_record(query, T_A, C_IN, 60, (const char *) &addr, sizeof(addr));
+	}
+
+	ast_dns_resolver_completed(query);
+	ao2_ref(query, -1);
+
+	return NULL;
+}
+
+static int cache_resolve(struct ast_dns_query *query)
+{
+	pthread_t resolver_thread;
+
+	ast_atomic_fetchadd_int(&cache_resolves, +1);
+	return ast_pthread_create_detached(&resolver_thread, NULL, cache_resolution_thread, ao2_bump(query));
+}
+
+/*! \brief A mock resolver whose answers the core caches */
+static struct ast_dns_resolver cache_resolver = {
+	.name = "test_cache",
+	.priority = 0,
+	.resolve = cache_resolve,
+	.cancel = stub_cancel,
+	.cache = 1,
+};
+
+AST_TEST_DEFINE(resolver_cache)
+{
+#define QUERIES 5
+	struct async_resolution_data *async_data[QUERIES] = { NULL, };
+	struct ast_dns_query_active *active[QUERIES] = { NULL, };
+	struct ast_dns_result *result = NULL;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	struct timespec timeout;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "resolver_cache";
+		info->category = "/main/dns/";
+		info->summary = "Test caching answers from a resolver";
+		info->description =
+			"This test resolves a domain with several queries at once using a resolver\n"
+			"whose answers are cached, and ensures that the resolver is only asked once\n"
+			"and every query gets its answer. It then ensures that resolving the domain\n"
+			"again is answered from the cache, and that a domain that does not exist is\n"
+			"only resolved once as well.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (ast_dns_resolver_register(&cache_resolver)) {
+		ast_test_status_update(test, "Unable to register test resolver\n");
+		return AST_TEST_FAIL;
+	}
+
+	cache_resolves = 0;
+
+	for (i = 0; i < QUERIES; i++) {
+		async_data[i] = async_data_alloc();
+		if (!async_data[i]) {
+			ast_test_status_update(test, "Failed to allocate asynchronous data\n");
+			res = AST_TEST_FAIL;
+			goto cleanup;
+		}
+
+		active[i] = ast_dns_resolve_async("cache.asterisk.org", T_A, C_IN, async_callback, async_data[i]);
+		if (!active[i]) {
+			ast_test_status_update(test, "Asynchronous resolution of address failed\n");
+			res = AST_TEST_FAIL;
+			goto cleanup;
+		}
+	}
+
+	timeout = ast_tsnow();
+	timeout.tv_sec += 10;
+	for (i = 0; i < QUERIES; i++) {
+		ast_mutex_lock(&async_data[i]->lock);
+		while (!async_data[i]->complete) {
+			if (ast_cond_timedwait(&async_data[i]->cond, &async_data[i]->lock, &timeout) == ETIMEDOUT) {
+				break;
+			}
+		}
+		ast_mutex_unlock(&async_data[i]->lock);
+
+		if (!async_data[i]->complete) {
+			ast_test_status_update(test, "Asynchronous resolution timed out\n");
+			res = AST_TEST_FAIL;
+			goto cleanup;
+		}
+
+		if (!ast_dns_query_get_result(active[i]->query)
+			|| !ast_dns_result_get_records(ast_dns_query_get_result(active[i]->query))) {
+			ast_test_status_update(test, "Asynchronous resolution %d had no records\n", i);
+			res = AST_TEST_FAIL;
+			goto cleanup;
+		}
+	}
+
+	if (cache_resolves != 1) {
+		ast_test_status_update(test, "Resolver was asked %d times for queries resolved at once\n", cache_resolves);
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	if (ast_dns_resolve("CACHE.asterisk.org", T_A, C_IN, &result)) {
+		ast_test_status_update(test, "Resolution of cached address failed\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	if (cache_resolves != 1) {
+		ast_test_status_update(test, "Resolver was asked for an address that was cached\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	if (!ast_dns_result_get_records(result) || ast_dns_record_get_ttl(ast_dns_result_get_records(result)) > 60) {
+		ast_test_status_update(test, "Cached address did not have the record with what is left of its TTL\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+	ast_dns_result_free(result);
+	result = NULL;
+
+	for (i = 0; i < 2; i++) {
+		if (ast_dns_resolve("nx.asterisk.org", T_A, C_IN, &result)) {
+			ast_test_status_update(test, "Resolution of nonexistent address failed\n");
+			res = AST_TEST_FAIL;
+			goto cleanup;
+		}
+
+		if (ast_dns_result_get_rcode(result) != NXDOMAIN || ast_dns_result_get_records(result)) {
+			ast_test_status_update(test, "Nonexistent address was not answered with NXDOMAIN\n");
+			res = AST_TEST_FAIL;
+			goto cleanup;
+		}
+		ast_dns_result_free(result);
+		result = NULL;
+	}
+
+	if (cache_resolves != 2) {
+		ast_test_status_update(test, "Resolver was asked %d times for a nonexistent address\n", cache_resolves - 1);
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+cleanup:
+	ast_dns_result_free(result);
+	for (i = 0; i < QUERIES; i++) {
+		ao2_cleanup(active[i]);
+		ao2_cleanup(async_data[i]);
+	}
+	ast_dns_resolver_unregister(&cache_resolver);
+	return res;
+#undef QUERIES
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(resolver_register_unregister);
@@ -1311,6 +1495,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(resolver_resolve_async);
 	AST_TEST_UNREGISTER(resolver_resolve_async_off_nominal);
 	AST_TEST_UNREGISTER(resolver_resolve_async_cancel);
+	AST_TEST_UNREGISTER(resolver_cache);
 
 	return 0;
 }
@@ -1330,6 +1515,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(resolver_resolve_async);
 	AST_TEST_REGISTER(resolver_resolve_async_off_nominal);
 	AST_TEST_REGISTER(resolver_resolve_async_cancel);
+	AST_TEST_REGISTER(resolver_cache);
 
 	return AST_MODULE_LOAD_SUCCESS;
 }
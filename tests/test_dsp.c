@@ -0,0 +1,245 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief DSP digit detection benchmarks
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <math.h>
+#include <inttypes.h>
+
+#include "asterisk/dsp.h"
+#include "asterisk/frame.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/utils.h"
+#include "asterisk/test.h"
+#include "asterisk/module.h"
+
+#define SAMPLE_RATE 8000
+/*! Samples in a 20ms frame */
+#define FRAME_SAMPLES 160
+/*! Number of detectors fed the same audio, as if they were separate channels */
+#define DETECTORS 200
+/*! Frames of each part of the signal: a digit, then line noise, then talk */
+#define DIGIT_FRAMES 5
+#define NOISE_FRAMES 10
+#define TALK_FRAMES 10
+
+/*! The digits and their tone pairs */
+struct test_digit {
+	char digit;
+	int f1;
+	int f2;
+};
+
+static const struct test_digit dtmf_digits[] = {
+	{ '1', 697, 1209 },
+	{ '5', 770, 1336 },
+	{ '9', 852, 1477 },
+	{ '#', 941, 1477 },
+};
+
+static const struct test_digit mf_digits[] = {
+	{ '1', 700, 900 },
+	{ '2', 700, 1100 },
+	{ '3', 900, 1100 },
+	{ '6', 1100, 1300 },
+};
+
+/*!
+ * \internal
+ * \brief Generate the audio of a digit followed by line noise and talk
+ */
+static short *signal_generate(const struct test_digit *digits, size_t count, short amplitude, size_t *samples)
+{
+	size_t per_digit = (DIGIT_FRAMES + NOISE_FRAMES + TALK_FRAMES) * FRAME_SAMPLES;
+	short *signal;
+	size_t d;
+	size_t i;
+
+	signal = ast_malloc(per_digit * count * sizeof(*signal));
+	if (!signal) {
+		return NULL;
+	}
+
+	for (d = 0; d < count; ++d) {
+		short *out = signal + d * per_digit;
+
+		for (i = 0; i < DIGIT_FRAMES * FRAME_SAMPLES; ++i) {
+			*out++ = amplitude * sin(2.0 * M_PI * digits[d].f1 * i / SAMPLE_RATE)
+				+ amplitude * sin(2.0 * M_PI * digits[d].f2 * i / SAMPLE_RATE);
+		}
+		/* A quiet line between digits */
+		for (i = 0; i < NOISE_FRAMES * FRAME_SAMPLES; ++i) {
+			*out++ = (short) (ast_random() % 16) - 8;
+		}
+		/* Loud broadband noise standing in for someone talking */
+		for (i = 0; i < TALK_FRAMES * FRAME_SAMPLES; ++i) {
+			*out++ = (short) (ast_random() % 8192) - 4096;
+		}
+	}
+
+	*samples = per_digit * count;
+	return signal;
+}
+
+/*!
+ * \internal
+ * \brief Run the signal through many detectors and check each finds the digits
+ */
+static enum ast_test_result_state digit_benchmark(struct ast_test *test, int digitmode,
+	const struct test_digit *digits, size_t count, short amplitude)
+{
+	struct ast_dsp *dsps[DETECTORS] = { NULL, };
+	char found[DETECTORS][ARRAY_LEN(dtmf_digits) + 1] = { { 0, }, };
+	enum ast_test_result_state res = AST_TEST_PASS;
+	struct timeval start;
+	int64_t elapsed_us;
+	short *signal;
+	size_t samples;
+	size_t offset;
+	size_t i;
+	int d;
+
+	signal = signal_generate(digits, count, amplitude, &samples);
+	if (!signal) {
+		return AST_TEST_FAIL;
+	}
+
+	for (d = 0; d < DETECTORS; ++d) {
+		dsps[d] = ast_dsp_new_with_rate(SAMPLE_RATE);
+		if (!dsps[d]) {
+			res = AST_TEST_FAIL;
+			goto cleanup;
+		}
+		ast_dsp_set_features(dsps[d], DSP_FEATURE_DIGIT_DETECT);
+		/* Squelching would change the audio the next detector is fed */
+		ast_dsp_set_digitmode(dsps[d], digitmode | DSP_DIGITMODE_NOQUELCH);
+	}
+
+	start = ast_tvnow();
+	for (offset = 0; offset < samples; offset += FRAME_SAMPLES) {
+		for (d = 0; d < DETECTORS; ++d) {
+			struct ast_frame frame = {
+				.frametype = AST_FRAME_VOICE,
+				.subclass.format = ast_format_slin,
+				.data.ptr = signal + offset,
+				.datalen = FRAME_SAMPLES * sizeof(short),
+				.samples = FRAME_SAMPLES,
+			};
+			struct ast_frame *out;
+
+			out = ast_dsp_process(NULL, dsps[d], &frame);
+			if (out && out != &frame) {
+				if (out->frametype == AST_FRAME_DTMF_BEGIN) {
+					i = strlen(found[d]);
+					if (i < ARRAY_LEN(found[d]) - 1) {
+						found[d][i] = out->subclass.integer;
+					}
+				}
+				ast_frfree(out);
+			}
+		}
+	}
+	elapsed_us = ast_tvdiff_us(ast_tvnow(), start);
+
+	ast_test_status_update(test, "%d detectors, %zu ms of audio each: %" PRIi64
+		" us using %s goertzel banks\n", DETECTORS, samples * 1000 / SAMPLE_RATE,
+		elapsed_us, ast_dsp_goertzel_implementation());
+
+	for (d = 0; d < DETECTORS; ++d) {
+		for (i = 0; i < count; ++i) {
+			if (found[d][i] != digits[i].digit) {
+				ast_test_status_update(test, "Detector %d found '%s' instead of the digits\n",
+					d, found[d]);
+				res = AST_TEST_FAIL;
+				goto cleanup;
+			}
+		}
+	}
+
+cleanup:
+	for (d = 0; d < DETECTORS; ++d) {
+		if (dsps[d]) {
+			ast_dsp_free(dsps[d]);
+		}
+	}
+	ast_free(signal);
+
+	return res;
+}
+
+AST_TEST_DEFINE(dtmf_benchmark)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "dtmf_benchmark";
+		info->category = "/main/dsp/";
+		info->summary = "Benchmark DTMF detection on many channels";
+		info->description =
+			"Runs DTMF digits, a quiet line and loud talk through the DTMF\n"
+			"detectors of many channels, reports the time it takes and\n"
+			"checks every detector found the digits.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	return digit_benchmark(test, DSP_DIGITMODE_DTMF, dtmf_digits, ARRAY_LEN(dtmf_digits), 4000);
+}
+
+AST_TEST_DEFINE(mf_benchmark)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "mf_benchmark";
+		info->category = "/main/dsp/";
+		info->summary = "Benchmark MF detection on many channels";
+		info->description =
+			"Runs MF digits, a quiet line and loud talk through the MF\n"
+			"detectors of many channels, reports the time it takes and\n"
+			"checks every detector found the digits.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	return digit_benchmark(test, DSP_DIGITMODE_MF, mf_digits, ARRAY_LEN(mf_digits), 8000);
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(dtmf_benchmark);
+	AST_TEST_UNREGISTER(mf_benchmark);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(dtmf_benchmark);
+	AST_TEST_REGISTER(mf_benchmark);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "DSP digit detection benchmark module");
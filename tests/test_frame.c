@@ -0,0 +1,252 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Frame duplication tests
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/frame.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/test.h"
+#include "asterisk/module.h"
+#include "asterisk/slinfactory.h"
+
+/*! 20ms of 8kHz signed linear audio */
+#define FRAME_SAMPLES 160
+
+AST_TEST_DEFINE(frame_shared_payload)
+{
+	short samples[FRAME_SAMPLES];
+	struct ast_frame frame = {
+		.frametype = AST_FRAME_VOICE,
+		.subclass.format = ast_format_slin,
+		.data.ptr = samples,
+		.datalen = sizeof(samples),
+		.samples = FRAME_SAMPLES,
+		.src = "test_frame",
+	};
+	struct ast_frame *shared = NULL;
+	struct ast_frame *copy = NULL;
+	struct ast_frame *isolated;
+	enum ast_test_result_state res = AST_TEST_FAIL;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "shared_payload";
+		info->category = "/main/frame/";
+		info->summary = "Frames can share a reference counted payload";
+		info->description =
+			"Creates a frame with a shared payload and checks that copies made\n"
+			"with ast_frshare() reference the same data, that the data is copied\n"
+			"before it is modified, and that isolating a copy keeps the payload.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (i = 0; i < FRAME_SAMPLES; ++i) {
+		samples[i] = i;
+	}
+
+	if (!(shared = ast_frdup_shared(&frame))) {
+		ast_test_status_update(test, "Failed to create a frame with a shared payload\n");
+		goto cleanup;
+	}
+	if (ast_frame_is_shared(shared)) {
+		ast_test_status_update(test, "A payload with a single frame should not be shared\n");
+		goto cleanup;
+	}
+
+	if (!(copy = ast_frshare(shared))) {
+		ast_test_status_update(test, "Failed to share the payload\n");
+		goto cleanup;
+	}
+	if (copy->data.ptr != shared->data.ptr || !ast_frame_is_shared(copy)
+		|| !ast_frame_is_shared(shared)) {
+		ast_test_status_update(test, "The copy does not share the payload\n");
+		goto cleanup;
+	}
+	if (strcmp(copy->src, "test_frame") || copy->samples != FRAME_SAMPLES) {
+		ast_test_status_update(test, "The copy does not match the original frame\n");
+		goto cleanup;
+	}
+
+	/* Modifying the copy must leave the other frame alone */
+	if (ast_frame_adjust_volume(copy, 2)) {
+		ast_test_status_update(test, "Failed to adjust the volume of the copy\n");
+		goto cleanup;
+	}
+	if (copy->data.ptr == shared->data.ptr || ast_frame_is_shared(shared)) {
+		ast_test_status_update(test, "The modified copy still shares the payload\n");
+		goto cleanup;
+	}
+	if (memcmp(shared->data.ptr, samples, sizeof(samples))
+		|| ((short *) copy->data.ptr)[1] != 2) {
+		ast_test_status_update(test, "The modification was not made to the copy alone\n");
+		goto cleanup;
+	}
+	ast_frfree(copy);
+
+	if (!(copy = ast_frshare(shared))) {
+		ast_test_status_update(test, "Failed to share the payload\n");
+		goto cleanup;
+	}
+	/* Isolating an already shared payload should not copy it */
+	isolated = ast_frisolate(copy);
+	if (!isolated) {
+		ast_test_status_update(test, "Failed to isolate the copy\n");
+		goto cleanup;
+	}
+	copy = isolated;
+	if (copy->data.ptr != shared->data.ptr) {
+		ast_test_status_update(test, "Isolating the copy duplicated the payload\n");
+		goto cleanup;
+	}
+	ast_frfree(copy);
+	copy = NULL;
+
+	if (ast_frame_is_shared(shared) || memcmp(shared->data.ptr, samples, sizeof(samples))) {
+		ast_test_status_update(test, "The payload was not kept intact\n");
+		goto cleanup;
+	}
+
+	res = AST_TEST_PASS;
+
+cleanup:
+	ast_frfree(copy);
+	ast_frfree(shared);
+	return res;
+}
+
+AST_TEST_DEFINE(frame_slinfactory_shared)
+{
+	short samples[FRAME_SAMPLES];
+	struct ast_frame frame = {
+		.frametype = AST_FRAME_VOICE,
+		.subclass.format = ast_format_slin,
+		.data.ptr = samples,
+		.datalen = sizeof(samples),
+		.samples = FRAME_SAMPLES,
+		.src = "test_frame",
+	};
+	struct ast_slinfactory sf;
+	struct ast_frame *first = NULL;
+	struct ast_frame *second = NULL;
+	enum ast_test_result_state res = AST_TEST_FAIL;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "slinfactory_shared";
+		info->category = "/main/frame/";
+		info->summary = "Frames read from a slinfactory share its audio";
+		info->description =
+			"Reads frames from a slinfactory and checks that they share the\n"
+			"audio in it, and that feeding the factory while they are held\n"
+			"leaves their audio intact.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_slinfactory_init(&sf);
+
+	for (i = 0; i < FRAME_SAMPLES; ++i) {
+		samples[i] = i;
+	}
+	ast_slinfactory_feed(&sf, &frame);
+
+	if (!(first = ast_slinfactory_read_frame(&sf, FRAME_SAMPLES / 2))
+		|| !(second = ast_slinfactory_read_frame(&sf, FRAME_SAMPLES / 2))) {
+		ast_test_status_update(test, "Failed to read frames from the factory\n");
+		goto cleanup;
+	}
+	if (!ast_frame_is_shared(first) || !ast_frame_is_shared(second)
+		|| (short *) second->data.ptr != (short *) first->data.ptr + FRAME_SAMPLES / 2) {
+		ast_test_status_update(test, "The frames do not share the audio in the factory\n");
+		goto cleanup;
+	}
+	if (ast_slinfactory_read_frame(&sf, 1)) {
+		ast_test_status_update(test, "Read a frame from an empty factory\n");
+		goto cleanup;
+	}
+
+	/* Feeding different audio must not change the frames still held */
+	for (i = 0; i < FRAME_SAMPLES; ++i) {
+		samples[i] = -i;
+	}
+	ast_slinfactory_feed(&sf, &frame);
+
+	if (((short *) first->data.ptr)[1] != 1
+		|| ((short *) second->data.ptr)[1] != FRAME_SAMPLES / 2 + 1) {
+		ast_test_status_update(test, "Feeding the factory changed the frames read from it\n");
+		goto cleanup;
+	}
+
+	/* A frame sharing the audio keeps its offset when shared again */
+	ast_frfree(first);
+	if (!(first = ast_frshare(second))) {
+		ast_test_status_update(test, "Failed to share a frame read from the factory\n");
+		goto cleanup;
+	}
+	if (first->data.ptr != second->data.ptr || first->offset != second->offset) {
+		ast_test_status_update(test, "Sharing the frame did not keep its data\n");
+		goto cleanup;
+	}
+	ast_frfree(first);
+	ast_frfree(second);
+	first = second = NULL;
+
+	if (ast_slinfactory_available(&sf) != FRAME_SAMPLES
+		|| !(first = ast_slinfactory_read_frame(&sf, FRAME_SAMPLES))
+		|| memcmp(first->data.ptr, samples, sizeof(samples))) {
+		ast_test_status_update(test, "The factory did not keep the audio fed to it\n");
+		goto cleanup;
+	}
+
+	res = AST_TEST_PASS;
+
+cleanup:
+	ast_frfree(first);
+	ast_frfree(second);
+	ast_slinfactory_destroy(&sf);
+	return res;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(frame_shared_payload);
+	AST_TEST_UNREGISTER(frame_slinfactory_shared);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(frame_shared_payload);
+	AST_TEST_REGISTER(frame_slinfactory_shared);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Frame test module");
@@ -285,11 +285,229 @@ return_cleanup:
 	return res;
 }
 
+struct timer {
+	struct timeval when;
+	ssize_t index;
+};
+
+static int timer_cmp(void *_t1, void *_t2)
+{
+	struct timer *t1 = _t1;
+	struct timer *t2 = _t2;
+
+	/* The earliest on top of a max heap */
+	return ast_tvcmp(t2->when, t1->when);
+}
+
+AST_TEST_DEFINE(timer_heap_test)
+{
+	struct ast_timer_heap *h = NULL;
+	struct timer *timers = NULL;
+	struct timer *timer;
+	struct timer *expired[64];
+	struct timeval *whens = NULL;
+	void **elms = NULL;
+	static const unsigned int test_size = 100000;
+	struct timeval base = ast_tv(1000000, 0);
+	struct timeval last = ast_tv(0, 0);
+	unsigned int i;
+	size_t popped;
+	enum ast_test_result_state res = AST_TEST_FAIL;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "timer_heap_test";
+		info->category = "/main/heap/";
+		info->summary = "timer heap ordering test";
+		info->description =
+			"Push a hundred thousand timers, half of them in bulk, on to "
+			"a timer heap, randomly remove and re-add some of them, and "
+			"ensure they come off in the order they expire, both one at "
+			"a time and all expired at once.  Then ensure timers with the "
+			"same time come off in the order they were pushed.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	timers = ast_calloc(test_size, sizeof(*timers));
+	whens = ast_calloc(test_size / 2, sizeof(*whens));
+	elms = ast_calloc(test_size / 2, sizeof(*elms));
+	h = ast_timer_heap_create(0, offsetof(struct timer, index));
+	if (!timers || !whens || !elms || !h) {
+		ast_test_status_update(test, "memory allocation failure\n");
+		goto return_cleanup;
+	}
+
+	/* Few distinct times, so many timers tie */
+	for (i = 0; i < test_size; i++) {
+		timers[i].when = ast_tvadd(base, ast_tv(0, (ast_random() % 1000) * 1000));
+	}
+
+	/* In bulk onto an empty heap, which rebuilds it, then one at a time */
+	for (i = 0; i < test_size / 2; i++) {
+		whens[i] = timers[i].when;
+		elms[i] = &timers[i];
+	}
+	ast_test_validate_cleanup(test, !ast_timer_heap_push_bulk(h, whens, elms, test_size / 2),
+		res, return_cleanup);
+	for (; i < test_size; i++) {
+		ast_test_validate_cleanup(test, !ast_timer_heap_push(h, timers[i].when, &timers[i]),
+			res, return_cleanup);
+	}
+	ast_test_validate_cleanup(test, ast_timer_heap_size(h) == test_size, res, return_cleanup);
+	ast_test_validate_cleanup(test, !ast_timer_heap_verify(h), res, return_cleanup);
+
+	for (i = 0; i < test_size / 10; i++) {
+		timer = &timers[ast_random() % test_size];
+		ast_test_validate_cleanup(test, ast_timer_heap_remove(h, timer) == timer, res, return_cleanup);
+		ast_test_validate_cleanup(test, !ast_timer_heap_remove(h, timer), res, return_cleanup);
+		ast_timer_heap_push(h, timer->when, timer);
+	}
+	ast_test_validate_cleanup(test, !ast_timer_heap_verify(h), res, return_cleanup);
+
+	/* The first half of the times one at a time, the rest all at once */
+	i = 0;
+	while ((timer = ast_timer_heap_pop_expired(h, ast_tvadd(base, ast_tv(0, 500000))))) {
+		if (ast_tvcmp(timer->when, last) < 0) {
+			ast_test_status_update(test, "Timer %u came off out of order\n", i);
+			goto return_cleanup;
+		}
+		last = timer->when;
+		i++;
+	}
+	while ((popped = ast_timer_heap_pop_all_expired(h, ast_tvadd(base, ast_tv(1, 0)),
+			(void **) expired, ARRAY_LEN(expired)))) {
+		size_t j;
+
+		for (j = 0; j < popped; j++) {
+			timer = expired[j];
+			if (ast_tvcmp(timer->when, last) < 0) {
+				ast_test_status_update(test, "Timer %u came off out of order\n", i);
+				goto return_cleanup;
+			}
+			last = timer->when;
+			i++;
+		}
+	}
+
+	if (i != test_size || ast_timer_heap_size(h)) {
+		ast_test_status_update(test, "Only %u timers came off\n", i);
+		goto return_cleanup;
+	}
+
+	/* Ties, pushed between later timers onto the now empty heap */
+	for (i = 0; i < 500; i++) {
+		timers[i].when = base;
+		ast_timer_heap_push(h, ast_tvadd(base, ast_tv(0, i + 1)), &timers[500 + i]);
+		ast_timer_heap_push(h, base, &timers[i]);
+	}
+	for (i = 0; i < 500; i++) {
+		timer = ast_timer_heap_pop(h);
+		if (timer != &timers[i]) {
+			ast_test_status_update(test, "Tied timer %u came off out of order\n", i);
+			goto return_cleanup;
+		}
+	}
+
+	res = AST_TEST_PASS;
+
+return_cleanup:
+	ast_timer_heap_destroy(h);
+	ast_free(elms);
+	ast_free(whens);
+	ast_free(timers);
+
+	return res;
+}
+
+AST_TEST_DEFINE(timer_heap_performance)
+{
+#define TIMERS 200000
+	struct ast_heap *heap = NULL;
+	struct ast_timer_heap *timer_heap = NULL;
+	struct timer *timers;
+	struct timeval start;
+	struct timeval now;
+	int64_t binary;
+	int64_t four_ary;
+	unsigned int i;
+	unsigned int popped[2] = { 0, 0 };
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "timer_heap_performance";
+		info->category = "/main/heap/";
+		info->summary = "timer heap performance test";
+		info->description =
+			"Pushes two hundred thousand timers on to a heap and a timer heap,\n"
+			"removes and re-adds a tenth of them, pops them all and reports\n"
+			"how long each took.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	timers = ast_calloc(TIMERS, sizeof(*timers));
+	heap = ast_heap_create(8, timer_cmp, offsetof(struct timer, index));
+	timer_heap = ast_timer_heap_create(0, offsetof(struct timer, index));
+	if (!timers || !heap || !timer_heap) {
+		ast_heap_destroy(heap);
+		ast_timer_heap_destroy(timer_heap);
+		ast_free(timers);
+		return AST_TEST_FAIL;
+	}
+
+	now = ast_tvnow();
+	for (i = 0; i < TIMERS; i++) {
+		timers[i].when = ast_tvadd(now, ast_tv(0, ast_random() % 100000000));
+	}
+	now = ast_tvadd(now, ast_tv(100, 0));
+
+	start = ast_tvnow();
+	for (i = 0; i < TIMERS; i++) {
+		ast_heap_push(heap, &timers[i]);
+	}
+	for (i = 0; i < TIMERS / 10; i++) {
+		ast_heap_remove(heap, &timers[i * 10]);
+		ast_heap_push(heap, &timers[i * 10]);
+	}
+	while (ast_heap_pop(heap)) {
+		popped[0]++;
+	}
+	binary = ast_tvdiff_us(ast_tvnow(), start);
+
+	start = ast_tvnow();
+	for (i = 0; i < TIMERS; i++) {
+		ast_timer_heap_push(timer_heap, timers[i].when, &timers[i]);
+	}
+	for (i = 0; i < TIMERS / 10; i++) {
+		ast_timer_heap_remove(timer_heap, &timers[i * 10]);
+		ast_timer_heap_push(timer_heap, timers[i * 10].when, &timers[i * 10]);
+	}
+	while (ast_timer_heap_pop_expired(timer_heap, now)) {
+		popped[1]++;
+	}
+	four_ary = ast_tvdiff_us(ast_tvnow(), start);
+
+	ast_test_status_update(test, "%d timers took %" PRId64 "us on a heap, and %" PRId64
+		"us on a timer heap\n", TIMERS, binary, four_ary);
+
+	ast_heap_destroy(heap);
+	ast_timer_heap_destroy(timer_heap);
+	ast_free(timers);
+
+	return popped[0] == TIMERS && popped[1] == TIMERS ? AST_TEST_PASS : AST_TEST_FAIL;
+#undef TIMERS
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(heap_test_1);
 	AST_TEST_UNREGISTER(heap_test_2);
 	AST_TEST_UNREGISTER(heap_test_3);
+	AST_TEST_UNREGISTER(timer_heap_test);
+	AST_TEST_UNREGISTER(timer_heap_performance);
 
 	return 0;
 }
@@ -299,6 +517,8 @@ static int load_module(void)
 	AST_TEST_REGISTER(heap_test_1);
 	AST_TEST_REGISTER(heap_test_2);
 	AST_TEST_REGISTER(heap_test_3);
+	AST_TEST_REGISTER(timer_heap_test);
+	AST_TEST_REGISTER(timer_heap_performance);
 
 	return AST_MODULE_LOAD_SUCCESS;
 }
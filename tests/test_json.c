@@ -1743,6 +1743,95 @@ AST_TEST_DEFINE(json_test_cep)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(json_test_writer)
+{
+	RAII_VAR(struct ast_json *, expected, NULL, ast_json_unref);
+	RAII_VAR(char *, expected_str, NULL, ast_json_free);
+	RAII_VAR(struct ast_str *, buf, NULL, ast_free);
+	RAII_VAR(struct ast_json *, embedded, NULL, ast_json_unref);
+	struct ast_json_writer writer;
+	struct timeval tv = { .tv_sec = 1360251154, .tv_usec = 314159 };
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "writer";
+		info->category = CATEGORY;
+		info->summary = "Writing JSON without building values.";
+		info->description = "Test JSON abstraction library.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	buf = ast_str_create(16);
+	ast_test_validate(test, NULL != buf);
+	embedded = ast_json_pack("{s: [i, s]}", "inner", 1, "two");
+	ast_test_validate(test, NULL != embedded);
+
+	expected = ast_json_pack("{s: s, s: s, s: I, s: [b, b, o, {}, []], s: o, s: o, s: o}",
+		"plain", "caf\xc3\xa9 /path",
+		"escaped", "\"q\" \\ \b\f\n\r\t \x01\x1f",
+		"integer", (ast_json_int_t) -9007199254740993LL,
+		"array", 1, 0, ast_json_null(),
+		"null", ast_json_null(),
+		"timeval", ast_json_timeval(tv, "America/Chicago"),
+		"embedded", ast_json_ref(embedded));
+	expected_str = ast_json_dump_string(expected);
+	ast_test_validate(test, NULL != expected_str);
+
+	ast_json_writer_init(&writer, &buf);
+	ast_json_writer_object_start(&writer);
+	ast_json_writer_member_string(&writer, "plain", "caf\xc3\xa9 /path");
+	ast_json_writer_member_string(&writer, "escaped", "\"q\" \\ \b\f\n\r\t \x01\x1f");
+	ast_json_writer_key(&writer, "integer");
+	ast_json_writer_integer(&writer, -9007199254740993LL);
+	ast_json_writer_key(&writer, "array");
+	ast_json_writer_array_start(&writer);
+	ast_json_writer_boolean(&writer, 1);
+	ast_json_writer_boolean(&writer, 0);
+	ast_json_writer_string(&writer, NULL);
+	ast_json_writer_object_start(&writer);
+	ast_json_writer_object_end(&writer);
+	ast_json_writer_array_start(&writer);
+	ast_json_writer_array_end(&writer);
+	ast_json_writer_array_end(&writer);
+	ast_json_writer_key(&writer, "null");
+	ast_json_writer_null(&writer);
+	ast_json_writer_key(&writer, "timeval");
+	ast_json_writer_timeval(&writer, tv, "America/Chicago");
+	ast_json_writer_key(&writer, "embedded");
+	ast_json_writer_json(&writer, embedded);
+	ast_json_writer_object_end(&writer);
+	ast_test_validate(test, 0 == ast_json_writer_finish(&writer));
+	ast_test_validate(test, 0 == strcmp(expected_str, ast_str_buffer(buf)));
+
+	/* Anything that is not a single complete value is an error */
+	ast_str_reset(buf);
+	ast_json_writer_init(&writer, &buf);
+	ast_test_validate(test, -1 == ast_json_writer_finish(&writer));
+	ast_json_writer_array_start(&writer);
+	ast_test_validate(test, -1 == ast_json_writer_finish(&writer));
+	ast_json_writer_object_end(&writer);
+	ast_test_validate(test, -1 == ast_json_writer_finish(&writer));
+
+	ast_json_writer_init(&writer, &buf);
+	ast_json_writer_object_start(&writer);
+	ast_json_writer_string(&writer, "no key");
+	ast_test_validate(test, -1 == ast_json_writer_finish(&writer));
+
+	ast_json_writer_init(&writer, &buf);
+	ast_json_writer_string(&writer, "\xc3\x28");
+	ast_test_validate(test, -1 == ast_json_writer_finish(&writer));
+
+	ast_json_writer_init(&writer, &buf);
+	ast_json_writer_null(&writer);
+	ast_test_validate(test, 0 == ast_json_writer_finish(&writer));
+	ast_json_writer_null(&writer);
+	ast_test_validate(test, -1 == ast_json_writer_finish(&writer));
+
+	return AST_TEST_PASS;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(json_test_false);
@@ -1797,6 +1886,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(json_test_name_number);
 	AST_TEST_UNREGISTER(json_test_timeval);
 	AST_TEST_UNREGISTER(json_test_cep);
+	AST_TEST_UNREGISTER(json_test_writer);
 	return 0;
 }
 
@@ -1854,6 +1944,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(json_test_name_number);
 	AST_TEST_REGISTER(json_test_timeval);
 	AST_TEST_REGISTER(json_test_cep);
+	AST_TEST_REGISTER(json_test_writer);
 
 	ast_test_register_init(CATEGORY, json_test_init);
 	ast_test_register_cleanup(CATEGORY, json_test_cleanup);
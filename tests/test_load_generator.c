@@ -0,0 +1,795 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Synthetic call load generator
+ *
+ * Places a number of Local channel calls inside Asterisk and sends media
+ * on them, so how much a system can take is measured without an outside
+ * SIP load generator.  The far end of each call is the ;2 half of a Local
+ * channel, which either runs a dialplan workload or joins a bridge.  The
+ * ;1 halves are driven by a few generator threads, each of which writes a
+ * frame to every one of its calls each packetization interval and reads
+ * what comes back.
+ *
+ * Frames written carry the time they were sent as their delivery time,
+ * which frames relayed by a two party bridge or echoed by the dialplan
+ * keep, so how long they took to come back is known.  Mixed frames are
+ * new frames and are counted, but have no latency.
+ *
+ * The CPU time of the process less that of the generator threads is
+ * reported per call, along with the backlog of the taskprocessors.
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <sys/resource.h>
+
+#include "asterisk/module.h"
+#include "asterisk/bridge.h"
+#include "asterisk/channel.h"
+#include "asterisk/cli.h"
+#include "asterisk/core_local.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/frame.h"
+#include "asterisk/lock.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/time.h"
+#include "asterisk/translate.h"
+#include "asterisk/utils.h"
+
+/*! How many calls each generator thread drives */
+#define LOAD_CALLS_PER_WORKER 100
+/*! How often, in milliseconds, a generator thread samples its CPU time */
+#define LOAD_CPU_SAMPLE_MS 1000
+
+enum load_topology {
+	/*! Calls are bridged in pairs, natively when the channels allow it */
+	LOAD_TOPOLOGY_SIMPLE,
+	/*! Calls are put in mixing bridges of a number of calls */
+	LOAD_TOPOLOGY_SOFTMIX,
+	/*! Calls run an extension of the dialplan */
+	LOAD_TOPOLOGY_DIALPLAN,
+};
+
+/*! \brief How the calls of a generator thread went */
+struct load_stats {
+	/*! Frames written */
+	uint64_t sent;
+	/*! Voice frames read */
+	uint64_t received;
+	/*! Voice frames read which had a delivery time */
+	uint64_t timed;
+	/*! The total latency of the timed frames, in microseconds */
+	uint64_t latency;
+	/*! The longest latency, in microseconds */
+	uint64_t latency_max;
+	/*! Calls which hung up before being stopped */
+	uint64_t hungup;
+	/*! CPU time used by the generator thread, in microseconds */
+	uint64_t cpu;
+};
+
+struct load_worker {
+	/*! The media written on every call */
+	const struct ast_frame *media;
+	/*! The packetization interval, in milliseconds */
+	unsigned int ptime;
+	/*! The calls still up, the ;1 halves of their Local channels */
+	struct ast_channel **chans;
+	/*! How many calls are still up */
+	int count;
+	/*! Where channels with input are put by ast_waitfor_n_ready() */
+	int *ready;
+	/*! Set to stop the thread */
+	int stop;
+	struct load_stats stats;
+	pthread_t thread;
+};
+
+struct load_generator {
+	/*! Every call placed, the ;1 halves of their Local channels */
+	AST_VECTOR(, struct ast_channel *) calls;
+	/*! The bridges the calls are in */
+	AST_VECTOR(, struct ast_bridge *) bridges;
+	/*! The generator threads, which each have a slice of the calls */
+	AST_VECTOR(, struct load_worker *) workers;
+	/*! The media written on every call */
+	struct ast_frame *media;
+	struct ast_format *format;
+	unsigned int ptime;
+	enum load_topology topology;
+	/*! Calls per bridge of the softmix topology */
+	unsigned int size;
+	/*! The extension of the dialplan topology */
+	char destination[AST_MAX_EXTENSION + AST_MAX_CONTEXT + 2];
+	/*! When the calls were placed */
+	struct timeval started;
+	/*! CPU time of the process when the calls were placed, in microseconds */
+	uint64_t cpu_started;
+};
+
+/*! Protects load */
+AST_MUTEX_DEFINE_STATIC(load_lock);
+/*! The load running, NULL if none is */
+static struct load_generator *load;
+
+static uint64_t load_cpu_usage(int who)
+{
+	struct rusage usage;
+
+	if (getrusage(who, &usage)) {
+		return 0;
+	}
+
+	return (uint64_t) ast_tvdiff_us(usage.ru_utime, ast_tv(0, 0))
+		+ (uint64_t) ast_tvdiff_us(usage.ru_stime, ast_tv(0, 0));
+}
+
+/*! \brief The CPU time used by the calling thread, 0 where it cannot be known */
+static uint64_t load_thread_cpu_usage(void)
+{
+#ifdef RUSAGE_THREAD
+	return load_cpu_usage(RUSAGE_THREAD);
+#else
+	return 0;
+#endif
+}
+
+/*!
+ * \internal
+ * \brief Encode a frame of media of a format
+ *
+ * A 500Hz square wave is encoded once, and the frame the encoder gives
+ * back is written on every call, as a recording would be.  Its number of
+ * samples, not the packetization asked for, is what decides how often it
+ * is written since some codecs have a fixed frame size.
+ */
+static struct ast_frame *load_media_frame(struct ast_format *format, unsigned int ptime)
+{
+	unsigned int rate = ast_format_get_sample_rate(format);
+	unsigned int samples = rate / 1000 * ptime;
+	struct ast_format *slin;
+	struct ast_trans_pvt *path;
+	struct ast_frame *out = NULL;
+	struct ast_frame *media = NULL;
+	int16_t *buf;
+	int tries;
+	int i;
+
+	slin = ast_format_cache_get_slin_by_rate(rate);
+	buf = ast_calloc(samples, sizeof(*buf));
+	if (!buf) {
+		return NULL;
+	}
+	for (i = 0; i < samples; i++) {
+		buf[i] = (i * 1000 / rate) % 2 ? 8000 : -8000;
+	}
+
+	{
+		struct ast_frame frame = {
+			.frametype = AST_FRAME_VOICE,
+			.subclass.format = slin,
+			.data.ptr = buf,
+			.datalen = samples * sizeof(*buf),
+			.samples = samples,
+			.src = "test_load_generator",
+		};
+
+		if (ast_format_cmp(format, slin) == AST_FORMAT_CMP_EQUAL) {
+			media = ast_frdup(&frame);
+		} else if ((path = ast_translator_build_path(format, slin))) {
+			/* Encoders which buffer a few frames give nothing for the first */
+			for (tries = 0; !out && tries < 10; tries++) {
+				out = ast_translate(path, &frame, 0);
+				if (out && out->frametype != AST_FRAME_VOICE) {
+					out = NULL;
+				}
+			}
+			if (out) {
+				media = ast_frdup(out);
+				ast_frfree(out);
+			}
+			ast_translator_free_path(path);
+		}
+	}
+
+	ast_free(buf);
+	return media;
+}
+
+/*!
+ * \internal
+ * \brief Read the frames of a call which has input
+ *
+ * \retval 0 the call is still up
+ * \retval -1 the call hung up
+ */
+static int load_worker_read(struct load_worker *worker, struct ast_channel *chan)
+{
+	struct ast_frame *frame;
+	struct timeval now;
+	uint64_t latency;
+
+	frame = ast_read(chan);
+	if (!frame) {
+		return -1;
+	}
+
+	if (frame->frametype == AST_FRAME_VOICE) {
+		ast_atomic_fetch_add(&worker->stats.received, 1, __ATOMIC_RELAXED);
+		if (!ast_tvzero(frame->delivery)) {
+			now = ast_tvnow();
+			latency = ast_tvdiff_us(now, frame->delivery);
+			ast_atomic_fetch_add(&worker->stats.timed, 1, __ATOMIC_RELAXED);
+			ast_atomic_fetch_add(&worker->stats.latency, latency, __ATOMIC_RELAXED);
+			if (latency > worker->stats.latency_max) {
+				worker->stats.latency_max = latency;
+			}
+		}
+	} else if (frame->frametype == AST_FRAME_CONTROL
+		&& frame->subclass.integer == AST_CONTROL_HANGUP) {
+		ast_frfree(frame);
+		return -1;
+	}
+
+	ast_frfree(frame);
+	return 0;
+}
+
+/*! \brief Write media on every call of a generator thread, and read what comes back */
+static void *load_worker_thread(void *data)
+{
+	struct load_worker *worker = data;
+	struct ast_frame frame = *worker->media;
+	struct timeval next = ast_tvnow();
+	struct timeval sampled = next;
+	uint64_t cpu_started = load_thread_cpu_usage();
+	int ready;
+	int ms;
+	int i;
+
+	/* The media is shared by every thread, only the header is written */
+	frame.mallocd = 0;
+
+	while (!worker->stop) {
+		ms = ast_remaining_ms(next, 0);
+		if (ms > 0) {
+			if (!worker->count) {
+				/* Every call hung up, there is nothing but the time to wait for */
+				usleep(ms * 1000);
+				continue;
+			}
+			ready = ast_waitfor_n_ready(worker->chans, worker->count, &ms, worker->ready);
+			/* From the last so hung up calls can be taken out as they are found */
+			for (i = ready - 1; i >= 0; i--) {
+				int idx = worker->ready[i];
+
+				if (load_worker_read(worker, worker->chans[idx])) {
+					ast_atomic_fetch_add(&worker->stats.hungup, 1, __ATOMIC_RELAXED);
+					worker->chans[idx] = worker->chans[--worker->count];
+				}
+			}
+			continue;
+		}
+
+		/* Frames are sent in time rather than catching up with those missed */
+		next = ast_tvadd(ast_tvnow(), ast_samp2tv(worker->ptime, 1000));
+		frame.delivery = ast_tvnow();
+		for (i = 0; i < worker->count; i++) {
+			frame.seqno++;
+			frame.ts += frame.samples;
+			if (!ast_write(worker->chans[i], &frame)) {
+				ast_atomic_fetch_add(&worker->stats.sent, 1, __ATOMIC_RELAXED);
+			}
+		}
+
+		if (ast_tvdiff_ms(ast_tvnow(), sampled) >= LOAD_CPU_SAMPLE_MS) {
+			sampled = ast_tvnow();
+			worker->stats.cpu = load_thread_cpu_usage() - cpu_started;
+		}
+	}
+
+	return NULL;
+}
+
+static void load_worker_destroy(struct load_worker *worker)
+{
+	ast_free(worker->chans);
+	ast_free(worker->ready);
+	ast_free(worker);
+}
+
+/*!
+ * \internal
+ * \brief Stop the generator threads, hang up the calls and tear down the bridges
+ */
+static void load_generator_destroy(struct load_generator *generator)
+{
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&generator->workers); i++) {
+		struct load_worker *worker = AST_VECTOR_GET(&generator->workers, i);
+
+		worker->stop = 1;
+		if (worker->thread != AST_PTHREADT_NULL) {
+			pthread_join(worker->thread, NULL);
+		}
+		load_worker_destroy(worker);
+	}
+	AST_VECTOR_FREE(&generator->workers);
+
+	AST_VECTOR_CALLBACK_VOID(&generator->calls, ast_hangup);
+	AST_VECTOR_FREE(&generator->calls);
+
+	for (i = 0; i < AST_VECTOR_SIZE(&generator->bridges); i++) {
+		ast_bridge_destroy(AST_VECTOR_GET(&generator->bridges, i), 0);
+	}
+	AST_VECTOR_FREE(&generator->bridges);
+
+	if (generator->media) {
+		ast_frfree(generator->media);
+	}
+	ao2_cleanup(generator->format);
+	ast_free(generator);
+}
+
+/*! \brief The bridge the next call of a topology joins, NULL if it joins none */
+static struct ast_bridge *load_bridge_next(struct load_generator *generator, int call)
+{
+	unsigned int size = generator->topology == LOAD_TOPOLOGY_SIMPLE ? 2 : generator->size;
+	struct ast_bridge *bridge;
+	char name[32];
+
+	if (generator->topology == LOAD_TOPOLOGY_DIALPLAN) {
+		return NULL;
+	}
+
+	if (call % size) {
+		return AST_VECTOR_GET(&generator->bridges, AST_VECTOR_SIZE(&generator->bridges) - 1);
+	}
+
+	snprintf(name, sizeof(name), "load-%d", call / size);
+	if (generator->topology == LOAD_TOPOLOGY_SIMPLE) {
+		bridge = ast_bridge_base_new(AST_BRIDGE_CAPABILITY_1TO1MIX | AST_BRIDGE_CAPABILITY_NATIVE,
+			AST_BRIDGE_FLAG_MERGE_INHIBIT_TO | AST_BRIDGE_FLAG_MERGE_INHIBIT_FROM,
+			"test_load_generator", name, NULL);
+	} else {
+		bridge = ast_bridge_base_new(AST_BRIDGE_CAPABILITY_MULTIMIX,
+			AST_BRIDGE_FLAG_MERGE_INHIBIT_TO | AST_BRIDGE_FLAG_MERGE_INHIBIT_FROM,
+			"test_load_generator", name, NULL);
+	}
+	if (!bridge) {
+		return NULL;
+	}
+	if (AST_VECTOR_APPEND(&generator->bridges, bridge)) {
+		ast_bridge_destroy(bridge, 0);
+		return NULL;
+	}
+
+	return bridge;
+}
+
+/*!
+ * \internal
+ * \brief Place a call of the load
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int load_call_place(struct load_generator *generator, int call, struct ast_format_cap *caps)
+{
+	const char *destination = generator->topology == LOAD_TOPOLOGY_DIALPLAN
+		? generator->destination : "load@test_load_generator";
+	struct ast_bridge *bridge = NULL;
+	struct ast_channel *chan;
+	int cause;
+
+	if (generator->topology != LOAD_TOPOLOGY_DIALPLAN) {
+		bridge = load_bridge_next(generator, call);
+		if (!bridge) {
+			return -1;
+		}
+	}
+
+	chan = ast_request("Local", caps, NULL, NULL, destination, &cause);
+	if (!chan) {
+		return -1;
+	}
+
+	/* Media goes out and comes back in the format of the call, untranslated */
+	if (ast_set_write_format(chan, generator->format)
+		|| ast_set_read_format(chan, generator->format)
+		|| (bridge && ast_local_setup_bridge(chan, bridge, NULL, NULL))
+		|| ast_call(chan, destination, 0)) {
+		ast_hangup(chan);
+		return -1;
+	}
+
+	if (AST_VECTOR_APPEND(&generator->calls, chan)) {
+		ast_hangup(chan);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Start the generator threads, each with a slice of the calls
+ */
+static int load_workers_start(struct load_generator *generator)
+{
+	int calls = AST_VECTOR_SIZE(&generator->calls);
+	int first;
+
+	for (first = 0; first < calls; first += LOAD_CALLS_PER_WORKER) {
+		int count = MIN(LOAD_CALLS_PER_WORKER, calls - first);
+		struct load_worker *worker;
+
+		worker = ast_calloc(1, sizeof(*worker));
+		if (!worker) {
+			return -1;
+		}
+		worker->thread = AST_PTHREADT_NULL;
+		worker->media = generator->media;
+		worker->ptime = generator->ptime;
+		worker->chans = ast_malloc(count * sizeof(*worker->chans));
+		worker->ready = ast_malloc(count * sizeof(*worker->ready));
+		if (!worker->chans || !worker->ready || AST_VECTOR_APPEND(&generator->workers, worker)) {
+			load_worker_destroy(worker);
+			return -1;
+		}
+		memcpy(worker->chans, AST_VECTOR_GET_ADDR(&generator->calls, first), count * sizeof(*worker->chans));
+		worker->count = count;
+
+		if (ast_pthread_create(&worker->thread, NULL, load_worker_thread, worker)) {
+			worker->thread = AST_PTHREADT_NULL;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static const char *load_topology_describe(struct load_generator *generator, char *buf, size_t size)
+{
+	switch (generator->topology) {
+	case LOAD_TOPOLOGY_SIMPLE:
+		return "two party bridges";
+	case LOAD_TOPOLOGY_SOFTMIX:
+		snprintf(buf, size, "mixing bridges of %u", generator->size);
+		return buf;
+	case LOAD_TOPOLOGY_DIALPLAN:
+		snprintf(buf, size, "dialplan %s", generator->destination);
+		return buf;
+	}
+
+	return "";
+}
+
+static char *handle_load_start(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct load_generator *generator;
+	struct ast_format_cap *caps;
+	char *codec = "ulaw";
+	unsigned int calls;
+	int placed;
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "test load start";
+		e->usage =
+			"Usage: test load start <calls> [codec <codec>] [ptime <ms>]\n"
+			"       [simple|softmix <size>|dialplan <exten>@<context>]\n"
+			"       Places a number of Local channel calls and sends media on them\n"
+			"       in a codec, ulaw unless given, one frame every ptime\n"
+			"       milliseconds, 20 unless given.  The calls are bridged in pairs\n"
+			"       unless they are put in mixing bridges of size calls, which\n"
+			"       needs bridge_softmix, or run an extension of the dialplan.\n"
+			"       Bridging in pairs is done natively when the channels allow it.\n"
+			"       Use 'test load show' to see how the system is keeping up, and\n"
+			"       'test load stop' to hang the calls up.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc < 4 || sscanf(a->argv[3], "%30u", &calls) != 1 || !calls) {
+		return CLI_SHOWUSAGE;
+	}
+
+	generator = ast_calloc(1, sizeof(*generator));
+	if (!generator) {
+		return CLI_FAILURE;
+	}
+	generator->ptime = 20;
+	generator->topology = LOAD_TOPOLOGY_SIMPLE;
+
+	for (i = 4; i < a->argc; i++) {
+		if (!strcasecmp(a->argv[i], "codec") && i + 1 < a->argc) {
+			codec = (char *) a->argv[++i];
+		} else if (!strcasecmp(a->argv[i], "ptime") && i + 1 < a->argc) {
+			if (sscanf(a->argv[++i], "%30u", &generator->ptime) != 1
+				|| generator->ptime < 10 || generator->ptime > 200) {
+				ast_free(generator);
+				return CLI_SHOWUSAGE;
+			}
+		} else if (!strcasecmp(a->argv[i], "simple")) {
+			generator->topology = LOAD_TOPOLOGY_SIMPLE;
+		} else if (!strcasecmp(a->argv[i], "softmix") && i + 1 < a->argc) {
+			generator->topology = LOAD_TOPOLOGY_SOFTMIX;
+			if (sscanf(a->argv[++i], "%30u", &generator->size) != 1 || generator->size < 2) {
+				ast_free(generator);
+				return CLI_SHOWUSAGE;
+			}
+		} else if (!strcasecmp(a->argv[i], "dialplan") && i + 1 < a->argc
+			&& strchr(a->argv[i + 1], '@')) {
+			generator->topology = LOAD_TOPOLOGY_DIALPLAN;
+			ast_copy_string(generator->destination, a->argv[++i], sizeof(generator->destination));
+		} else {
+			ast_free(generator);
+			return CLI_SHOWUSAGE;
+		}
+	}
+
+	ast_mutex_lock(&load_lock);
+	if (load) {
+		ast_mutex_unlock(&load_lock);
+		ast_free(generator);
+		ast_cli(a->fd, "A load is already running, stop it first.\n");
+		return CLI_SUCCESS;
+	}
+
+	generator->format = ast_format_cache_get(codec);
+	if (!generator->format) {
+		ast_mutex_unlock(&load_lock);
+		ast_free(generator);
+		ast_cli(a->fd, "No codec named '%s'.\n", codec);
+		return CLI_SUCCESS;
+	}
+
+	generator->media = load_media_frame(generator->format, generator->ptime);
+	if (!generator->media) {
+		ast_mutex_unlock(&load_lock);
+		ast_cli(a->fd, "Cannot encode media in '%s'.\n", codec);
+		load_generator_destroy(generator);
+		return CLI_SUCCESS;
+	}
+	generator->ptime = MAX(1, generator->media->samples * 1000 / ast_format_get_sample_rate(generator->format));
+
+	caps = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+	if (!caps || ast_format_cap_append(caps, generator->format, 0)
+		|| AST_VECTOR_INIT(&generator->calls, calls)
+		|| AST_VECTOR_INIT(&generator->bridges, 0)
+		|| AST_VECTOR_INIT(&generator->workers, 0)) {
+		ast_mutex_unlock(&load_lock);
+		ao2_cleanup(caps);
+		load_generator_destroy(generator);
+		return CLI_FAILURE;
+	}
+
+	for (placed = 0; placed < calls; placed++) {
+		if (load_call_place(generator, placed, caps)) {
+			break;
+		}
+	}
+	ao2_ref(caps, -1);
+
+	if (placed < calls) {
+		ast_mutex_unlock(&load_lock);
+		ast_cli(a->fd, "Only %d of %u calls could be placed, not starting.\n", placed, calls);
+		load_generator_destroy(generator);
+		return CLI_SUCCESS;
+	}
+
+	generator->started = ast_tvnow();
+	generator->cpu_started = load_cpu_usage(RUSAGE_SELF);
+	if (load_workers_start(generator)) {
+		ast_mutex_unlock(&load_lock);
+		ast_cli(a->fd, "Cannot start the generator threads.\n");
+		load_generator_destroy(generator);
+		return CLI_FAILURE;
+	}
+	load = generator;
+	ast_mutex_unlock(&load_lock);
+
+	{
+		char topology[AST_MAX_EXTENSION + AST_MAX_CONTEXT + 32];
+
+		ast_cli(a->fd, "Placed %u calls in %s, %s every %ums, with %d generator threads.\n",
+			calls, load_topology_describe(generator, topology, sizeof(topology)),
+			ast_format_get_name(generator->format), generator->ptime,
+			(int) AST_VECTOR_SIZE(&generator->workers));
+	}
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_load_stop(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct load_generator *generator;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "test load stop";
+		e->usage =
+			"Usage: test load stop\n"
+			"       Hangs up the calls placed by 'test load start'.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&load_lock);
+	generator = load;
+	load = NULL;
+	ast_mutex_unlock(&load_lock);
+
+	if (!generator) {
+		ast_cli(a->fd, "No load is running.\n");
+		return CLI_SUCCESS;
+	}
+
+	load_generator_destroy(generator);
+	ast_cli(a->fd, "Load stopped.\n");
+
+	return CLI_SUCCESS;
+}
+
+/*! \brief The total backlog of the taskprocessors, and the deepest of them */
+struct load_backlog {
+	long queued;
+	long deepest;
+	char name[80];
+};
+
+static void load_backlog_add(const struct ast_taskprocessor_stats *stats, void *data)
+{
+	struct load_backlog *backlog = data;
+
+	backlog->queued += stats->queued;
+	if (stats->queued > backlog->deepest) {
+		backlog->deepest = stats->queued;
+		ast_copy_string(backlog->name, stats->name, sizeof(backlog->name));
+	}
+}
+
+static char *handle_load_show(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	char topology[AST_MAX_EXTENSION + AST_MAX_CONTEXT + 32];
+	struct load_stats total = { 0, };
+	struct load_backlog backlog = { 0, };
+	uint64_t elapsed;
+	uint64_t cpu;
+	int calls;
+	int up;
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "test load show";
+		e->usage =
+			"Usage: test load show\n"
+			"       Shows how the calls placed by 'test load start' are going: the\n"
+			"       frames sent and received, how long frames sent took to come\n"
+			"       back, the CPU used per call less what generating the load\n"
+			"       took, and the backlog of the taskprocessors.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&load_lock);
+	if (!load) {
+		ast_mutex_unlock(&load_lock);
+		ast_cli(a->fd, "No load is running.\n");
+		return CLI_SUCCESS;
+	}
+
+	for (i = 0; i < AST_VECTOR_SIZE(&load->workers); i++) {
+		struct load_worker *worker = AST_VECTOR_GET(&load->workers, i);
+
+		total.sent += ast_atomic_fetch_add(&worker->stats.sent, 0, __ATOMIC_RELAXED);
+		total.received += ast_atomic_fetch_add(&worker->stats.received, 0, __ATOMIC_RELAXED);
+		total.timed += ast_atomic_fetch_add(&worker->stats.timed, 0, __ATOMIC_RELAXED);
+		total.latency += ast_atomic_fetch_add(&worker->stats.latency, 0, __ATOMIC_RELAXED);
+		total.hungup += ast_atomic_fetch_add(&worker->stats.hungup, 0, __ATOMIC_RELAXED);
+		total.latency_max = MAX(total.latency_max, worker->stats.latency_max);
+		total.cpu += worker->stats.cpu;
+	}
+	calls = AST_VECTOR_SIZE(&load->calls);
+	up = calls - total.hungup;
+	elapsed = MAX(1, ast_tvdiff_us(ast_tvnow(), load->started));
+	cpu = load_cpu_usage(RUSAGE_SELF) - load->cpu_started;
+
+	ast_cli(a->fd, "%d calls in %s, %s every %ums, running for %" PRIu64 "s\n",
+		calls, load_topology_describe(load, topology, sizeof(topology)),
+		ast_format_get_name(load->format), load->ptime, elapsed / 1000000);
+	ast_mutex_unlock(&load_lock);
+
+	ast_cli(a->fd, "Calls:        %d up, %" PRIu64 " hung up\n", up, total.hungup);
+	ast_cli(a->fd, "Frames:       %" PRIu64 " sent, %" PRIu64 " received\n", total.sent, total.received);
+	if (total.timed) {
+		ast_cli(a->fd, "Latency:      %" PRIu64 "us average, %" PRIu64 "us longest, of %" PRIu64 " frames\n",
+			total.latency / total.timed, total.latency_max, total.timed);
+	} else {
+		ast_cli(a->fd, "Latency:      not known, no frame sent came back\n");
+	}
+
+	ast_cli(a->fd, "CPU:          %.1f%% for the process, %.1f%% generating the load\n",
+		100.0 * cpu / elapsed, 100.0 * total.cpu / elapsed);
+	if (up > 0 && cpu > total.cpu) {
+		ast_cli(a->fd, "CPU per call: %.3f%%, %" PRIu64 "us every second\n",
+			100.0 * (cpu - total.cpu) / elapsed / up, (cpu - total.cpu) * 1000000 / elapsed / up);
+	}
+#ifndef RUSAGE_THREAD
+	ast_cli(a->fd, "              The CPU used generating the load is not known here, and is included.\n");
+#endif
+
+	ast_taskprocessor_stats_foreach(load_backlog_add, &backlog);
+	if (backlog.deepest) {
+		ast_cli(a->fd, "Backlog:      %ld tasks queued, %ld of them on %s\n",
+			backlog.queued, backlog.deepest, backlog.name);
+	} else {
+		ast_cli(a->fd, "Backlog:      no tasks queued\n");
+	}
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_load[] = {
+	AST_CLI_DEFINE(handle_load_start, "Place synthetic calls to measure capacity"),
+	AST_CLI_DEFINE(handle_load_stop, "Hang up the synthetic calls"),
+	AST_CLI_DEFINE(handle_load_show, "Show how the synthetic calls are going"),
+};
+
+static int unload_module(void)
+{
+	ast_cli_unregister_multiple(cli_load, ARRAY_LEN(cli_load));
+
+	ast_mutex_lock(&load_lock);
+	if (load) {
+		load_generator_destroy(load);
+		load = NULL;
+	}
+	ast_mutex_unlock(&load_lock);
+
+	return 0;
+}
+
+static int load_module(void)
+{
+	ast_cli_register_multiple(cli_load, ARRAY_LEN(cli_load));
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Synthetic call load generator");
@@ -135,16 +135,53 @@ fail:
 	return res;
 }
 
+AST_TEST_DEFINE(named_lock_striped_test)
+{
+	struct ast_named_lock *lock1;
+	struct ast_named_lock *lock2;
+	struct ast_named_lock *rwlock;
+	int same;
+
+	switch(cmd) {
+	case TEST_INIT:
+		info->name = "named_lock_striped_test";
+		info->category = "/main/lock/";
+		info->summary = "Striped named lock test";
+		info->description =
+			"Tests that a name always gets the same striped lock, of the type asked for";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	lock1 = ast_named_lock_get_striped(AST_NAMED_LOCK_TYPE_MUTEX, "lock_test", "lock_1");
+	lock2 = ast_named_lock_get_striped(AST_NAMED_LOCK_TYPE_MUTEX, "lock_test", "lock_1");
+	rwlock = ast_named_lock_get_striped(AST_NAMED_LOCK_TYPE_RWLOCK, "lock_test", "lock_1");
+	same = lock1 == lock2;
+
+	ast_named_lock_put(lock1);
+	ast_named_lock_put(lock2);
+	ast_named_lock_put(rwlock);
+
+	ast_test_validate(test, same);
+	ast_test_validate(test, (ao2_options_get(lock1) & AO2_ALLOC_OPT_LOCK_MASK) == AO2_ALLOC_OPT_LOCK_MUTEX);
+	ast_test_validate(test, (ao2_options_get(rwlock) & AO2_ALLOC_OPT_LOCK_MASK) == AO2_ALLOC_OPT_LOCK_RWLOCK);
+
+	return AST_TEST_PASS;
+}
+
 
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(named_lock_test);
+	AST_TEST_UNREGISTER(named_lock_striped_test);
 	return 0;
 }
 
 static int load_module(void)
 {
 	AST_TEST_REGISTER(named_lock_test);
+	AST_TEST_REGISTER(named_lock_striped_test);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
@@ -323,6 +323,58 @@ cleanup:
 	return res;
 }
 
+AST_TEST_DEFINE(lookup_cache_test)
+{
+	static const char registrar[] = "test_pbx_cache";
+	static const char OUTER[] = "test_cache_outer";
+	static const char INNER[] = "test_cache_inner";
+	enum ast_test_result_state res = AST_TEST_PASS;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "lookup_cache_test";
+		info->category = "/main/pbx/";
+		info->summary = "Test extension lookups follow dialplan changes";
+		info->description = "Repeat lookups through an include while adding and removing\n"
+			"extensions and includes, making sure no stale result is returned.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!ast_context_find_or_create(NULL, NULL, OUTER, registrar)
+		|| !ast_context_find_or_create(NULL, NULL, INNER, registrar)) {
+		ast_test_status_update(test, "Failed to create contexts\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	ast_test_validate_cleanup(test, !ast_exists_extension(NULL, OUTER, "100", 1, NULL), res, cleanup);
+
+	ast_test_validate_cleanup(test, !ast_add_extension(INNER, 0, "100", 1, NULL, NULL,
+		"Noop", NULL, NULL, registrar), res, cleanup);
+	ast_test_validate_cleanup(test, !ast_exists_extension(NULL, OUTER, "100", 1, NULL), res, cleanup);
+
+	ast_test_validate_cleanup(test, !ast_context_add_include(OUTER, INNER, registrar), res, cleanup);
+	ast_test_validate_cleanup(test, ast_exists_extension(NULL, OUTER, "100", 1, NULL), res, cleanup);
+	ast_test_validate_cleanup(test, ast_exists_extension(NULL, OUTER, "100", 1, NULL), res, cleanup);
+
+	ast_test_validate_cleanup(test, !ast_context_remove_extension(INNER, "100", 1, registrar), res, cleanup);
+	ast_test_validate_cleanup(test, !ast_exists_extension(NULL, OUTER, "100", 1, NULL), res, cleanup);
+
+	ast_test_validate_cleanup(test, !ast_add_extension(INNER, 0, "_1XX", 1, NULL, NULL,
+		"Noop", NULL, NULL, registrar), res, cleanup);
+	ast_test_validate_cleanup(test, ast_exists_extension(NULL, OUTER, "100", 1, NULL), res, cleanup);
+
+	ast_test_validate_cleanup(test, !ast_context_remove_include(OUTER, INNER, registrar), res, cleanup);
+	ast_test_validate_cleanup(test, !ast_exists_extension(NULL, OUTER, "100", 1, NULL), res, cleanup);
+
+cleanup:
+	ast_context_destroy(NULL, registrar);
+
+	return res;
+}
+
 AST_TEST_DEFINE(segv)
 {
 	switch (cmd) {
@@ -429,12 +481,14 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(call_assert);
 	AST_TEST_UNREGISTER(segv);
 	AST_TEST_UNREGISTER(pattern_match_test);
+	AST_TEST_UNREGISTER(lookup_cache_test);
 	return 0;
 }
 
 static int load_module(void)
 {
 	AST_TEST_REGISTER(pattern_match_test);
+	AST_TEST_REGISTER(lookup_cache_test);
 	AST_TEST_REGISTER(segv);
 	AST_TEST_REGISTER(call_assert);
 	AST_TEST_REGISTER(call_backtrace);
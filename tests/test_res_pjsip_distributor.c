@@ -0,0 +1,212 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief res_pjsip distributor tests
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<depend>pjproject</depend>
+	<depend>res_pjsip</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <pjsip.h>
+#include <pjsip_ua.h>
+#include "asterisk/test.h"
+#include "asterisk/module.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/res_pjsip.h"
+#include "asterisk/utils.h"
+
+#define CATEGORY "/res/res_pjsip/distributor/"
+
+/*! Number of dialogs the threads fight over */
+#define THRASH_DIALOGS 64
+/*! Number of threads changing and looking up associations */
+#define THRASH_THREADS 8
+/*! Number of operations each thread performs */
+#define THRASH_ITERATIONS 100000
+
+struct thrash_data {
+	/*! The dialogs */
+	pjsip_dialog *dlgs[THRASH_DIALOGS];
+	/*! The only serializer associated with the dialogs */
+	struct ast_taskprocessor *serializer;
+	/*! The only endpoint associated with the dialogs */
+	struct ast_sip_endpoint *endpoint;
+	/*! Set if a thread looked up something it never associated */
+	int failed;
+};
+
+static int create_dialogs(void *obj)
+{
+	struct thrash_data *data = obj;
+	pj_str_t local_uri;
+	pj_str_t remote_uri;
+	int i;
+
+	pj_cstr(&local_uri, "sip:local@127.0.0.1");
+	pj_cstr(&remote_uri, "sip:remote@127.0.0.1");
+
+	for (i = 0; i < THRASH_DIALOGS; ++i) {
+		if (pjsip_dlg_create_uac(pjsip_ua_instance(), &local_uri, NULL, &remote_uri,
+				NULL, &data->dlgs[i]) != PJ_SUCCESS) {
+			data->dlgs[i] = NULL;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int destroy_dialogs(void *obj)
+{
+	struct thrash_data *data = obj;
+	int i;
+
+	for (i = 0; i < THRASH_DIALOGS; ++i) {
+		if (data->dlgs[i]) {
+			ast_sip_dialog_set_serializer(data->dlgs[i], NULL);
+			ast_sip_dialog_set_endpoint(data->dlgs[i], NULL);
+			pjsip_dlg_terminate(data->dlgs[i]);
+			data->dlgs[i] = NULL;
+		}
+	}
+
+	return 0;
+}
+
+static void *thrash_associations(void *obj)
+{
+	struct thrash_data *data = obj;
+	int i;
+
+	for (i = 0; i < THRASH_ITERATIONS && !data->failed; ++i) {
+		pjsip_dialog *dlg = data->dlgs[ast_random() % THRASH_DIALOGS];
+		struct ast_sip_endpoint *endpoint;
+
+		switch (ast_random() % 5) {
+		case 0:
+			ast_sip_dialog_set_serializer(dlg, data->serializer);
+			break;
+		case 1:
+			ast_sip_dialog_set_serializer(dlg, NULL);
+			break;
+		case 2:
+			ast_sip_dialog_set_endpoint(dlg, data->endpoint);
+			break;
+		case 3:
+			ast_sip_dialog_set_endpoint(dlg, NULL);
+			break;
+		default:
+			endpoint = ast_sip_dialog_get_endpoint(dlg);
+			if (endpoint && endpoint != data->endpoint) {
+				data->failed = 1;
+			}
+			ao2_cleanup(endpoint);
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+AST_TEST_DEFINE(dialog_associations_thrash)
+{
+	struct thrash_data data = { { NULL, }, };
+	pthread_t threads[THRASH_THREADS];
+	struct ast_sip_endpoint *endpoint;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = CATEGORY;
+		info->summary = "Thrash the dialog associations of the distributor";
+		info->description =
+			"Several threads concurrently associate and disassociate a serializer\n"
+			"and an endpoint with a set of dialogs while looking them up.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	data.serializer = ast_sip_create_serializer("test-distributor");
+	ast_test_validate_cleanup(test, data.serializer != NULL, res, cleanup);
+	data.endpoint = ast_sorcery_alloc(ast_sip_get_sorcery(), "endpoint", "test-distributor");
+	ast_test_validate_cleanup(test, data.endpoint != NULL, res, cleanup);
+	ast_test_validate_cleanup(test, !ast_sip_push_task_wait_servant(NULL, create_dialogs, &data),
+		res, cleanup);
+
+	for (i = 0; i < THRASH_THREADS; ++i) {
+		if (ast_pthread_create(&threads[i], NULL, thrash_associations, &data)) {
+			threads[i] = AST_PTHREADT_NULL;
+			data.failed = 1;
+		}
+	}
+	for (i = 0; i < THRASH_THREADS; ++i) {
+		if (threads[i] != AST_PTHREADT_NULL) {
+			pthread_join(threads[i], NULL);
+		}
+	}
+	ast_test_validate_cleanup(test, !data.failed, res, cleanup);
+
+	/* Every dialog must still report exactly what was last set on it. */
+	for (i = 0; i < THRASH_DIALOGS; ++i) {
+		ast_sip_dialog_set_serializer(data.dlgs[i], NULL);
+		ast_sip_dialog_set_endpoint(data.dlgs[i], data.endpoint);
+		endpoint = ast_sip_dialog_get_endpoint(data.dlgs[i]);
+		ao2_cleanup(endpoint);
+		ast_test_validate_cleanup(test, endpoint == data.endpoint, res, cleanup);
+
+		ast_sip_dialog_set_endpoint(data.dlgs[i], NULL);
+		endpoint = ast_sip_dialog_get_endpoint(data.dlgs[i]);
+		ao2_cleanup(endpoint);
+		ast_test_validate_cleanup(test, endpoint == NULL, res, cleanup);
+	}
+
+cleanup:
+	ast_sip_push_task_wait_servant(NULL, destroy_dialogs, &data);
+	ao2_cleanup(data.endpoint);
+	ast_taskprocessor_unreference(data.serializer);
+
+	return res;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(dialog_associations_thrash);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(dialog_associations_thrash);
+	return 0;
+}
+
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_DEFAULT, "res_pjsip distributor test module",
+	.support_level = AST_MODULE_SUPPORT_CORE,
+	.load = load_module,
+	.unload = unload_module,
+	.requires = "res_pjsip",
+);
@@ -518,6 +518,53 @@ AST_TEST_DEFINE(gauge_create)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(histogram_to_string)
+{
+	static const double bounds[] = { 0.1, 1 };
+	RAII_VAR(struct prometheus_metric *, metric, NULL, prometheus_metric_free_wrapper);
+	RAII_VAR(struct ast_str *, buffer, NULL, ast_free);
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = CATEGORY;
+		info->summary = "Test creation and formatting of histograms";
+		info->description =
+			"This test covers creating a histogram, observing values\n"
+			"with it and the formatting of its cumulative buckets.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	buffer = ast_str_create(128);
+	if (!buffer) {
+		return AST_TEST_FAIL;
+	}
+
+	metric = prometheus_histogram_create("test_histogram", "A test histogram", bounds, ARRAY_LEN(bounds));
+	ast_test_validate(test, metric != NULL);
+	ast_test_validate(test, metric->type == PROMETHEUS_METRIC_HISTOGRAM);
+	ast_test_validate(test, metric->histogram != NULL);
+
+	PROMETHEUS_METRIC_SET_LABEL(metric, 0, "key_one", "value_one");
+	prometheus_histogram_observe(metric, 0.05);
+	prometheus_histogram_observe(metric, 0.5);
+	prometheus_histogram_observe(metric, 2);
+
+	prometheus_metric_to_string(metric, &buffer);
+	ast_test_validate(test, strcmp(ast_str_buffer(buffer),
+		"# HELP test_histogram A test histogram\n"
+		"# TYPE test_histogram histogram\n"
+		"test_histogram_bucket{key_one=\"value_one\",le=\"0.1\"} 1\n"
+		"test_histogram_bucket{key_one=\"value_one\",le=\"1\"} 2\n"
+		"test_histogram_bucket{key_one=\"value_one\",le=\"+Inf\"} 3\n"
+		"test_histogram_sum{key_one=\"value_one\"} 2.55\n"
+		"test_histogram_count{key_one=\"value_one\"} 3\n") == 0);
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(config_general_basic_auth)
 {
 	RAII_VAR(CURL *, curl, NULL, curl_free_wrapper);
@@ -852,6 +899,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(counter_create);
 	AST_TEST_UNREGISTER(gauge_to_string);
 	AST_TEST_UNREGISTER(gauge_create);
+	AST_TEST_UNREGISTER(histogram_to_string);
 
 	AST_TEST_UNREGISTER(config_general_enabled);
 	AST_TEST_UNREGISTER(config_general_basic_auth);
@@ -876,6 +924,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(counter_create);
 	AST_TEST_REGISTER(gauge_to_string);
 	AST_TEST_REGISTER(gauge_create);
+	AST_TEST_REGISTER(histogram_to_string);
 
 	AST_TEST_REGISTER(config_general_enabled);
 	AST_TEST_REGISTER(config_general_basic_auth);
@@ -472,6 +472,93 @@ AST_TEST_DEFINE(lost_packet_stats_nominal)
 	return AST_TEST_PASS;
 }
 
+struct sample_search {
+	struct ast_rtp_instance *instance;
+	struct ast_rtp_instance_stats stats;
+	int found;
+};
+
+static int sample_instance_cb(struct ast_rtp_instance *instance,
+	const struct ast_rtp_instance_stats *stats, void *data)
+{
+	struct sample_search *search = data;
+
+	if (instance != search->instance) {
+		return 0;
+	}
+	search->stats = *stats;
+	search->found = 1;
+	return 1;
+}
+
+AST_TEST_DEFINE(sampled_stats)
+{
+	RAII_VAR(struct ast_rtp_instance *, instance1, NULL, ast_rtp_instance_destroy);
+	RAII_VAR(struct ast_rtp_instance *, instance2, NULL, ast_rtp_instance_destroy);
+	RAII_VAR(struct ast_sched_context *, test_sched, NULL, ast_sched_context_destroy_wrapper);
+	struct ast_rtp_instance_stats stats = { 0, };
+	struct ast_rtp_instance_stats sample = { 0, };
+	struct sample_search search = { 0, };
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "sampled_stats";
+		info->category = "/res/res_rtp/";
+		info->summary = "sampled statistics unit test";
+		info->description =
+			"Tests that statistics sampled without locking the instance "
+			"match those retrieved with the instance locked once a report "
+			"was sent, and that sampling all instances finds them";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	test_sched = ast_sched_context_create();
+
+	if ((test_init_rtp_instances(&instance1, &instance2, test_sched, TEST_TYPE_NONE)) < 0) {
+		ast_log(LOG_ERROR, "Failed to initialize test!\n");
+		return AST_TEST_FAIL;
+	}
+
+	/* Lose 5 packets and send a report so the loss is calculated */
+	test_write_and_read_frames(instance1, instance2, 1000, 10);
+	test_write_and_read_frames(instance1, instance2, 1015, 5);
+	ast_rtp_instance_queue_report(instance1);
+	test_write_frames(instance2, 1000, 1);
+
+	ast_test_validate(test, !ast_rtp_instance_get_stats(instance2, &stats, AST_RTP_INSTANCE_STAT_ALL));
+	ast_test_validate(test, !ast_rtp_instance_sample_stats(instance2, &sample));
+	ast_test_validate(test, sample.rxploss == 5 && sample.local_minrxploss == 5 &&
+		sample.local_maxrxploss == 5, "Sampled loss does not match the 5 lost packets");
+	ast_test_validate(test, sample.rxcount == stats.rxcount && sample.txcount == stats.txcount &&
+		sample.rxoctetcount == stats.rxoctetcount && sample.txoctetcount == stats.txoctetcount,
+		"Sampled packet counts do not match");
+	ast_test_validate(test, sample.local_ssrc == stats.local_ssrc &&
+		sample.remote_ssrc == stats.remote_ssrc, "Sampled SSRCs do not match");
+
+	/* Counts are current even without another report */
+	test_write_and_read_frames(instance1, instance2, 1020, 5);
+	ast_test_validate(test, !ast_rtp_instance_sample_stats(instance2, &sample));
+	ast_test_validate(test, sample.rxcount == stats.rxcount + 5, "Sampled receive count is stale");
+	ast_test_validate(test, sample.rxploss == 5, "Sampled loss changed without a report");
+
+	search.instance = instance2;
+	ast_rtp_instance_sample_stats_all(sample_instance_cb, &search);
+	ast_test_validate(test, search.found && search.stats.rxcount == sample.rxcount,
+		"Sampling all instances did not find the instance");
+
+	/* A destroyed instance is no longer sampled */
+	search.instance = instance1;
+	search.found = 0;
+	ast_rtp_instance_destroy(instance1);
+	ast_rtp_instance_sample_stats_all(sample_instance_cb, &search);
+	instance1 = NULL;
+	ast_test_validate(test, !search.found, "Sampling all instances found a destroyed instance");
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(remb_nominal)
 {
 	RAII_VAR(struct ast_rtp_instance *, instance1, NULL, ast_rtp_instance_destroy);
@@ -697,6 +784,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(nack_nominal);
 	AST_TEST_UNREGISTER(nack_overflow);
 	AST_TEST_UNREGISTER(lost_packet_stats_nominal);
+	AST_TEST_UNREGISTER(sampled_stats);
 	AST_TEST_UNREGISTER(remb_nominal);
 	AST_TEST_UNREGISTER(sr_rr_nominal);
 	AST_TEST_UNREGISTER(fir_nominal);
@@ -709,6 +797,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(nack_nominal);
 	AST_TEST_REGISTER(nack_overflow);
 	AST_TEST_REGISTER(lost_packet_stats_nominal);
+	AST_TEST_REGISTER(sampled_stats);
 	AST_TEST_REGISTER(remb_nominal);
 	AST_TEST_REGISTER(sr_rr_nominal);
 	AST_TEST_REGISTER(fir_nominal);
@@ -105,26 +105,14 @@ static int sched_order_8_cb(const void *data)
 	return 0;
 }
 
-AST_TEST_DEFINE(sched_test_order)
+static enum ast_test_result_state sched_test_order_run(struct ast_test *test,
+	enum ast_sched_queue queue)
 {
 	struct ast_sched_context *con;
 	enum ast_test_result_state res = AST_TEST_FAIL;
 	int id1, id2, id3, wait;
 
-	switch (cmd) {
-	case TEST_INIT:
-		info->name = "sched_test_order";
-		info->category = "/main/sched/";
-		info->summary = "Test ordering of events in the scheduler API";
-		info->description =
-			"This test ensures that events are properly ordered by the "
-			"time they are scheduled to execute in the scheduler API.";
-		return AST_TEST_NOT_RUN;
-	case TEST_EXECUTE:
-		break;
-	}
-
-	if (!(con = ast_sched_context_create())) {
+	if (!(con = ast_sched_context_create_with_queue(queue))) {
 		ast_test_status_update(test,
 				"Test failed - could not create scheduler context\n");
 		return AST_TEST_FAIL;
@@ -263,77 +251,161 @@ return_cleanup:
 	return res;
 }
 
-static char *handle_cli_sched_bench(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+AST_TEST_DEFINE(sched_test_order)
 {
-	struct ast_sched_context *con;
-	struct timeval start;
-	unsigned int num, i;
-	int *sched_ids = NULL;
-
 	switch (cmd) {
-	case CLI_INIT:
-		e->command = "sched benchmark";
-		e->usage = ""
-			"Usage: sched benchmark <num>\n"
-			"";
-		return NULL;
-	case CLI_GENERATE:
-		return NULL;
+	case TEST_INIT:
+		info->name = "sched_test_order";
+		info->category = "/main/sched/";
+		info->summary = "Test ordering of events in the scheduler API";
+		info->description =
+			"This test ensures that events are properly ordered by the "
+			"time they are scheduled to execute in the scheduler API.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
 	}
 
-	if (a->argc != e->args + 1) {
-		return CLI_SHOWUSAGE;
-	}
+	return sched_test_order_run(test, AST_SCHED_QUEUE_HEAP);
+}
 
-	if (sscanf(a->argv[e->args], "%u", &num) != 1) {
-		return CLI_SHOWUSAGE;
+AST_TEST_DEFINE(sched_test_order_wheel)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "sched_test_order_wheel";
+		info->category = "/main/sched/";
+		info->summary = "Test ordering of events in a timing wheel scheduler";
+		info->description =
+			"This test ensures that events are properly ordered by the "
+			"time they are scheduled to execute in a scheduler context "
+			"using the timing wheel queue.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
 	}
 
-	if (!(con = ast_sched_context_create())) {
-		ast_cli(a->fd, "Test failed - could not create scheduler context\n");
-		return CLI_FAILURE;
-	}
+	return sched_test_order_run(test, AST_SCHED_QUEUE_WHEEL);
+}
 
-	if (!(sched_ids = ast_malloc(sizeof(*sched_ids) * num))) {
-		ast_cli(a->fd, "Test failed - memory allocation failure\n");
-		goto return_cleanup;
+static unsigned int sched_bench_count;
+
+static int sched_bench_cb(const void *data)
+{
+	++sched_bench_count;
+	return 0;
+}
+
+static int sched_bench(int fd, enum ast_sched_queue queue, const char *name,
+	unsigned int num, int *sched_ids)
+{
+	struct ast_sched_context *con;
+	struct timeval start;
+	unsigned int i;
+	int res = -1;
+
+	if (!(con = ast_sched_context_create_with_queue(queue))) {
+		ast_cli(fd, "Test failed - could not create scheduler context\n");
+		return -1;
 	}
 
-	ast_cli(a->fd, "Testing ast_sched_add() performance - timing how long it takes "
-			"to add %u entries at random time intervals from 0 to 60 seconds\n", num);
+	ast_cli(fd, "Testing %s ast_sched_add() performance - timing how long it takes "
+			"to add %u entries at random time intervals from 0 to 60 seconds\n", name, num);
 
 	start = ast_tvnow();
 
 	for (i = 0; i < num; i++) {
 		long when = labs(ast_random()) % 60000;
 		if ((sched_ids[i] = ast_sched_add(con, when, sched_cb, NULL)) == -1) {
-			ast_cli(a->fd, "Test failed - sched_add returned -1\n");
+			ast_cli(fd, "Test failed - sched_add returned -1\n");
 			goto return_cleanup;
 		}
 	}
 
-	ast_cli(a->fd, "Test complete - %" PRIi64 " us\n", ast_tvdiff_us(ast_tvnow(), start));
+	ast_cli(fd, "Test complete - %" PRIi64 " us\n", ast_tvdiff_us(ast_tvnow(), start));
 
-	ast_cli(a->fd, "Testing ast_sched_del() performance - timing how long it takes "
-			"to delete %u entries with random time intervals from 0 to 60 seconds\n", num);
+	ast_cli(fd, "Testing %s ast_sched_del() performance - timing how long it takes "
+			"to delete %u entries with random time intervals from 0 to 60 seconds\n", name, num);
 
 	start = ast_tvnow();
 
 	for (i = 0; i < num; i++) {
 		if (ast_sched_del(con, sched_ids[i]) == -1) {
-			ast_cli(a->fd, "Test failed - sched_del returned -1\n");
+			ast_cli(fd, "Test failed - sched_del returned -1\n");
+			goto return_cleanup;
+		}
+	}
+
+	ast_cli(fd, "Test complete - %" PRIi64 " us\n", ast_tvdiff_us(ast_tvnow(), start));
+
+	ast_cli(fd, "Testing %s ast_sched_runq() performance - timing how long it takes "
+			"to add and run %u entries at random time intervals from 0 to 20 ms\n", name, num);
+
+	sched_bench_count = 0;
+	start = ast_tvnow();
+
+	for (i = 0; i < num; i++) {
+		long when = labs(ast_random()) % 20;
+		if (ast_sched_add(con, when, sched_bench_cb, NULL) == -1) {
+			ast_cli(fd, "Test failed - sched_add returned -1\n");
 			goto return_cleanup;
 		}
 	}
 
-	ast_cli(a->fd, "Test complete - %" PRIi64 " us\n", ast_tvdiff_us(ast_tvnow(), start));
+	while (sched_bench_count < num) {
+		int wait = ast_sched_wait(con);
+
+		if (wait > 0) {
+			usleep(wait * 1000);
+		}
+		ast_sched_runq(con);
+	}
+
+	ast_cli(fd, "Test complete - %" PRIi64 " us\n", ast_tvdiff_us(ast_tvnow(), start));
+	res = 0;
 
 return_cleanup:
 	ast_sched_context_destroy(con);
-	if (sched_ids) {
-		ast_free(sched_ids);
+
+	return res;
+}
+
+static char *handle_cli_sched_bench(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	unsigned int num;
+	int *sched_ids = NULL;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "sched benchmark";
+		e->usage = ""
+			"Usage: sched benchmark <num>\n"
+			"       Compare the heap and timing wheel scheduler queues.\n"
+			"";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args + 1) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (sscanf(a->argv[e->args], "%u", &num) != 1) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!(sched_ids = ast_malloc(sizeof(*sched_ids) * num))) {
+		ast_cli(a->fd, "Test failed - memory allocation failure\n");
+		return CLI_FAILURE;
 	}
 
+	if (!sched_bench(a->fd, AST_SCHED_QUEUE_HEAP, "heap", num, sched_ids)) {
+		sched_bench(a->fd, AST_SCHED_QUEUE_WHEEL, "timing wheel", num, sched_ids);
+	}
+
+	ast_free(sched_ids);
+
 	return CLI_SUCCESS;
 }
 
@@ -463,6 +535,33 @@ AST_TEST_DEFINE(sched_test_freebird)
 	return res;
 }
 
+static void *bench_add_del_setup(void)
+{
+	return ast_sched_context_create();
+}
+
+static void bench_add_del_run(void *data)
+{
+	int id = ast_sched_add(data, 60000, sched_cb, NULL);
+
+	AST_SCHED_DEL(data, id);
+}
+
+static void bench_add_del_teardown(void *data)
+{
+	ast_sched_context_destroy(data);
+}
+
+static struct ast_bench_info bench_add_del = {
+	.name = "add_del",
+	.category = "/main/sched/",
+	.summary = "Schedule an entry and remove it again",
+	.setup = bench_add_del_setup,
+	.run = bench_add_del_run,
+	.teardown = bench_add_del_teardown,
+	.batch = 100,
+};
+
 static struct ast_cli_entry cli_sched[] = {
 	AST_CLI_DEFINE(handle_cli_sched_bench, "Benchmark ast_sched add/del performance"),
 };
@@ -470,16 +569,20 @@ static struct ast_cli_entry cli_sched[] = {
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(sched_test_order);
+	AST_TEST_UNREGISTER(sched_test_order_wheel);
 	AST_TEST_UNREGISTER(sched_test_freebird);
 	ast_cli_unregister_multiple(cli_sched, ARRAY_LEN(cli_sched));
+	AST_BENCH_UNREGISTER(&bench_add_del);
 	return 0;
 }
 
 static int load_module(void)
 {
 	AST_TEST_REGISTER(sched_test_order);
+	AST_TEST_REGISTER(sched_test_order_wheel);
 	AST_TEST_REGISTER(sched_test_freebird);
 	ast_cli_register_multiple(cli_sched, ARRAY_LEN(cli_sched));
+	AST_BENCH_REGISTER(&bench_add_del);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
@@ -0,0 +1,204 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Signed linear buffer mixing tests
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <inttypes.h>
+
+#include "asterisk/utils.h"
+#include "asterisk/test.h"
+#include "asterisk/module.h"
+
+/*! 20ms of 48kHz audio, plus some to exercise the unaligned tail */
+#define MIX_SAMPLES (960 + 7)
+/*! Number of participants mixed by the benchmark */
+#define MIX_PARTICIPANTS 200
+/*! Number of 20ms mixing intervals run by the benchmark */
+#define MIX_ITERATIONS 250
+
+static void fill_random(short *buf, size_t samples)
+{
+	size_t i;
+
+	for (i = 0; i < samples; ++i) {
+		buf[i] = (short) ast_random();
+	}
+}
+
+AST_TEST_DEFINE(slinear_mix_saturation)
+{
+	short input[MIX_SAMPLES];
+	short value[MIX_SAMPLES];
+	short expected[MIX_SAMPLES];
+	size_t samples;
+	size_t i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "mix_saturation";
+		info->category = "/main/slinear/";
+		info->summary = "Buffer mixing matches the scalar saturating helpers";
+		info->description =
+			"Adds and subtracts random signed linear buffers of various lengths and\n"
+			"checks ast_slinear_saturated_add_buf() and ast_slinear_saturated_subtract_buf()\n"
+			"produce the same samples as the per-sample saturating helpers.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_test_status_update(test, "Using %s mixing\n", ast_slinear_mix_implementation());
+
+	for (samples = 0; samples <= MIX_SAMPLES; samples += 1 + samples / 4) {
+		fill_random(input, samples);
+		fill_random(value, samples);
+		/* Include the extremes so saturation is exercised */
+		if (samples > 2) {
+			input[0] = value[0] = 32767;
+			input[1] = value[1] = -32768;
+		}
+
+		memcpy(expected, input, sizeof(expected));
+		for (i = 0; i < samples; ++i) {
+			ast_slinear_saturated_add(&expected[i], &value[i]);
+		}
+		ast_slinear_saturated_add_buf(input, value, samples);
+		if (memcmp(input, expected, samples * sizeof(*input))) {
+			ast_test_status_update(test, "Add of %zu samples does not match\n", samples);
+			return AST_TEST_FAIL;
+		}
+
+		for (i = 0; i < samples; ++i) {
+			ast_slinear_saturated_subtract(&expected[i], &value[i]);
+		}
+		ast_slinear_saturated_subtract_buf(input, value, samples);
+		if (memcmp(input, expected, samples * sizeof(*input))) {
+			ast_test_status_update(test, "Subtract of %zu samples does not match\n", samples);
+			return AST_TEST_FAIL;
+		}
+	}
+
+	return AST_TEST_PASS;
+}
+
+AST_TEST_DEFINE(slinear_mix_benchmark)
+{
+	short (*participants)[MIX_SAMPLES];
+	short mix[MIX_SAMPLES];
+	short expected[MIX_SAMPLES];
+	short out[MIX_SAMPLES];
+	struct timeval start;
+	int64_t scalar_us;
+	int64_t buf_us;
+	int iteration;
+	int p;
+	size_t i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "mix_benchmark";
+		info->category = "/main/slinear/";
+		info->summary = "Benchmark mixing a large conference";
+		info->description =
+			"Mixes a large number of participants the way bridge_softmix does,\n"
+			"summing everyone and then removing each participant's own audio,\n"
+			"using the scalar helpers and the buffer functions and reports the\n"
+			"time each takes.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	participants = ast_malloc(sizeof(*participants) * MIX_PARTICIPANTS);
+	if (!participants) {
+		return AST_TEST_FAIL;
+	}
+	for (p = 0; p < MIX_PARTICIPANTS; ++p) {
+		/* Keep the levels low enough to resemble speech rather than constant clipping */
+		for (i = 0; i < MIX_SAMPLES; ++i) {
+			participants[p][i] = (short) (ast_random() % 2048) - 1024;
+		}
+	}
+
+	start = ast_tvnow();
+	for (iteration = 0; iteration < MIX_ITERATIONS; ++iteration) {
+		memset(expected, 0, sizeof(expected));
+		for (p = 0; p < MIX_PARTICIPANTS; ++p) {
+			for (i = 0; i < MIX_SAMPLES; ++i) {
+				ast_slinear_saturated_add(&expected[i], &participants[p][i]);
+			}
+		}
+		for (p = 0; p < MIX_PARTICIPANTS; ++p) {
+			memcpy(out, expected, sizeof(out));
+			for (i = 0; i < MIX_SAMPLES; ++i) {
+				ast_slinear_saturated_subtract(&out[i], &participants[p][i]);
+			}
+		}
+	}
+	scalar_us = ast_tvdiff_us(ast_tvnow(), start);
+
+	start = ast_tvnow();
+	for (iteration = 0; iteration < MIX_ITERATIONS; ++iteration) {
+		memset(mix, 0, sizeof(mix));
+		for (p = 0; p < MIX_PARTICIPANTS; ++p) {
+			ast_slinear_saturated_add_buf(mix, participants[p], MIX_SAMPLES);
+		}
+		for (p = 0; p < MIX_PARTICIPANTS; ++p) {
+			memcpy(out, mix, sizeof(out));
+			ast_slinear_saturated_subtract_buf(out, participants[p], MIX_SAMPLES);
+		}
+	}
+	buf_us = ast_tvdiff_us(ast_tvnow(), start);
+
+	ast_free(participants);
+
+	ast_test_status_update(test, "%d participants, %d intervals: scalar %" PRIi64
+		" us, %s %" PRIi64 " us\n", MIX_PARTICIPANTS, MIX_ITERATIONS, scalar_us,
+		ast_slinear_mix_implementation(), buf_us);
+
+	if (memcmp(mix, expected, sizeof(mix))) {
+		ast_test_status_update(test, "Mixed audio does not match\n");
+		return AST_TEST_FAIL;
+	}
+
+	return AST_TEST_PASS;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(slinear_mix_saturation);
+	AST_TEST_UNREGISTER(slinear_mix_benchmark);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(slinear_mix_saturation);
+	AST_TEST_REGISTER(slinear_mix_benchmark);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Signed linear mixing test module");
@@ -73,6 +73,8 @@ struct sorcery_memory_cache_thrash {
 	unsigned int retrieve_threads;
 	/*! \brief The average execution time of sorcery retrieve operations */
 	unsigned int average_retrieve_execution_time;
+	/*! \brief Set when the retrieving threads should retrieve by id prefix */
+	unsigned int retrieve_prefix;
 	/*! \brief Threads which are updating or reading from the cache */
 	AST_VECTOR(, struct sorcery_memory_cache_thrash_thread *) threads;
 };
@@ -109,6 +111,37 @@ static void *mock_retrieve_id(const struct ast_sorcery *sorcery, void *data,
 	return ast_sorcery_alloc(sorcery, type, id);
 }
 
+/*! \brief The number of unique objects the mock backend holds */
+static unsigned int mock_unique_objects;
+
+/*!
+ * \brief Callback for retrieving all the sorcery objects of the backend
+ *
+ * \param sorcery The sorcery instance
+ * \param data Unused
+ * \param type The object type. Will always be "test".
+ * \param objects Container to place the objects into
+ * \param fields Unused, a full backend cache retrieves all objects
+ */
+static void mock_retrieve_multiple(const struct ast_sorcery *sorcery, void *data,
+	const char *type, struct ao2_container *objects, const struct ast_variable *fields)
+{
+	char object_id_str[AST_UUID_STR_LEN];
+	unsigned int object_id;
+	void *object;
+
+	for (object_id = 0; object_id < mock_unique_objects; ++object_id) {
+		snprintf(object_id_str, sizeof(object_id_str), "%u", object_id);
+
+		object = ast_sorcery_alloc(sorcery, type, object_id_str);
+		if (!object) {
+			return;
+		}
+		ao2_link(objects, object);
+		ao2_ref(object, -1);
+	}
+}
+
 /*!
  * \brief Callback for updating a sorcery object
  *
@@ -129,6 +162,7 @@ static int mock_update(const struct ast_sorcery *sorcery, void *data,
 static struct ast_sorcery_wizard mock_wizard = {
 	.name = "mock",
 	.retrieve_id = mock_retrieve_id,
+	.retrieve_multiple = mock_retrieve_multiple,
 	.update = mock_update,
 };
 
@@ -185,6 +219,7 @@ static struct sorcery_memory_cache_thrash *sorcery_memory_cache_thrash_create(co
 
 	thrash->update_threads = update_threads;
 	thrash->retrieve_threads = retrieve_threads;
+	mock_unique_objects = unique_objects;
 
 	ast_sorcery_wizard_register(&mock_wizard);
 
@@ -287,6 +322,37 @@ static void *sorcery_memory_cache_thrash_retrieve(void *data)
 	return NULL;
 }
 
+/*!
+ * \internal
+ * \brief Thrashing cache retrieve by id prefix thread
+ *
+ * \param data The sorcery memory cache thrash thread
+ */
+static void *sorcery_memory_cache_thrash_retrieve_prefix(void *data)
+{
+	struct sorcery_memory_cache_thrash_thread *thread = data;
+	struct timeval start;
+	unsigned int object_id;
+	char object_id_str[AST_UUID_STR_LEN];
+	size_t prefix_len;
+	struct ao2_container *objects;
+
+	while (!thread->stop) {
+		object_id = ast_random() % thread->unique_objects;
+		snprintf(object_id_str, sizeof(object_id_str), "%u", object_id);
+		prefix_len = 1 + ast_random() % strlen(object_id_str);
+
+		start = ast_tvnow();
+		objects = ast_sorcery_retrieve_by_prefix(thread->sorcery, "test", object_id_str, prefix_len);
+		thread->average_execution_time = (thread->average_execution_time + ast_tvdiff_ms(ast_tvnow(), start)) / 2;
+		ast_assert(objects != NULL);
+
+		ao2_cleanup(objects);
+	}
+
+	return NULL;
+}
+
 /*!
  * \internal
  * \brief Stop thrashing against a sorcery memory cache
@@ -348,11 +414,19 @@ static int sorcery_memory_cache_thrash_start(struct sorcery_memory_cache_thrash
 
 	for (idx = 0; idx < AST_VECTOR_SIZE(&thrash->threads); ++idx) {
 		struct sorcery_memory_cache_thrash_thread *thread;
+		void *(*thread_fn)(void *);
 
 		thread = AST_VECTOR_GET(&thrash->threads, idx);
 
-		if (ast_pthread_create(&thread->thread, NULL, idx < thrash->update_threads ?
-			sorcery_memory_cache_thrash_update : sorcery_memory_cache_thrash_retrieve, thread)) {
+		if (idx < thrash->update_threads) {
+			thread_fn = sorcery_memory_cache_thrash_update;
+		} else if (thrash->retrieve_prefix) {
+			thread_fn = sorcery_memory_cache_thrash_retrieve_prefix;
+		} else {
+			thread_fn = sorcery_memory_cache_thrash_retrieve;
+		}
+
+		if (ast_pthread_create(&thread->thread, NULL, thread_fn, thread)) {
 			sorcery_memory_cache_thrash_stop(thrash);
 			return -1;
 		}
@@ -464,6 +538,41 @@ static enum ast_test_result_state nominal_thrash(struct ast_test *test, const ch
 	return AST_TEST_PASS;
 }
 
+/*!
+ * \internal
+ * \brief Unit test for thrashing a full backend cache with retrievals by id prefix
+ *
+ * \param test The unit test being run
+ * \param cache_configuration The underlying cache configuration
+ * \param thrash_time How long (in seconds) to thrash the cache for
+ * \param unique_objects The number of unique objects
+ * \param retrieve_threads The number of threads constantly doing a retrieve by prefix
+ * \param update_threads The number of threads constantly doing an update
+ *
+ * \retval AST_TEST_PASS success
+ * \retval AST_TEST_FAIL failure
+ */
+static enum ast_test_result_state prefix_thrash(struct ast_test *test, const char *cache_configuration,
+	unsigned int thrash_time, unsigned int unique_objects, unsigned int retrieve_threads,
+	unsigned int update_threads)
+{
+	struct sorcery_memory_cache_thrash *thrash;
+
+	thrash = sorcery_memory_cache_thrash_create(cache_configuration, update_threads, retrieve_threads, unique_objects);
+	if (!thrash) {
+		return AST_TEST_FAIL;
+	}
+	thrash->retrieve_prefix = 1;
+
+	sorcery_memory_cache_thrash_start(thrash);
+	while ((thrash_time = sleep(thrash_time)));
+	sorcery_memory_cache_thrash_stop(thrash);
+
+	ao2_ref(thrash, -1);
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(low_unique_object_count_immediately_stale)
 {
 	switch (cmd) {
@@ -600,6 +709,45 @@ AST_TEST_DEFINE(high_object_count_without_expiration)
 	return nominal_thrash(test, "default", TEST_THRASH_TIME, 5000, TEST_THRASH_RETRIEVERS, 0);
 }
 
+AST_TEST_DEFINE(prefix_retrieval_high_object_count)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "prefix_retrieval_high_object_count";
+		info->category = "/res/res_sorcery_memory_cache/thrash/";
+		info->summary = "Thrash a full backend cache with retrievals by id prefix";
+		info->description = "This test creates a full backend cache with a large number of objects.\n"
+			"A large number of threads are created which constantly retrieve the objects whose\n"
+			"id starts with a prefix, from a single object to a fifth of the cache. This test\n"
+			"confirms that the large number of retrieves do not cause a problem.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	return prefix_thrash(test, "full_backend_cache=yes", TEST_THRASH_TIME, 5000, TEST_THRASH_RETRIEVERS, 0);
+}
+
+AST_TEST_DEFINE(prefix_retrieval_concurrent_updates_and_stale)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "prefix_retrieval_concurrent_updates_and_stale";
+		info->category = "/res/res_sorcery_memory_cache/thrash/";
+		info->summary = "Thrash a full backend cache going stale with updates and retrievals by id prefix";
+		info->description = "This test creates a full backend cache whose objects go stale, and\n"
+			"threads which constantly update objects or retrieve the objects whose id starts\n"
+			"with a prefix. This test confirms that the retrievals by prefix do not conflict\n"
+			"with the updates and the refreshes of the whole cache.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	return prefix_thrash(test, "full_backend_cache=yes,object_lifetime_stale=1", TEST_THRASH_TIME * 2, 1000,
+		TEST_THRASH_RETRIEVERS, TEST_THRASH_UPDATERS);
+}
+
 static int unload_module(void)
 {
 	ast_cli_unregister_multiple(cli_memory_cache_thrash, ARRAY_LEN(cli_memory_cache_thrash));
@@ -610,6 +758,8 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(unique_objects_exceeding_maximum_with_expire_and_stale);
 	AST_TEST_UNREGISTER(conflicting_expire_and_stale);
 	AST_TEST_UNREGISTER(high_object_count_without_expiration);
+	AST_TEST_UNREGISTER(prefix_retrieval_high_object_count);
+	AST_TEST_UNREGISTER(prefix_retrieval_concurrent_updates_and_stale);
 
 	return 0;
 }
@@ -624,6 +774,8 @@ static int load_module(void)
 	AST_TEST_REGISTER(unique_objects_exceeding_maximum_with_expire_and_stale);
 	AST_TEST_REGISTER(conflicting_expire_and_stale);
 	AST_TEST_REGISTER(high_object_count_without_expiration);
+	AST_TEST_REGISTER(prefix_retrieval_high_object_count);
+	AST_TEST_REGISTER(prefix_retrieval_concurrent_updates_and_stale);
 
 	return AST_MODULE_LOAD_SUCCESS;
 }
@@ -163,6 +163,7 @@ struct consumer {
 	ast_cond_t out;
 	struct stasis_message **messages_rxed;
 	size_t messages_rxed_len;
+	int batches_rxed;
 	int ignore_subscriptions;
 	int complete;
 };
@@ -223,6 +224,25 @@ static void consumer_exec(void *data, struct stasis_subscription *sub, struct st
 	ast_cond_signal(&consumer->out);
 }
 
+static void consumer_exec_batch(void *data, struct stasis_subscription *sub,
+	struct stasis_message **messages, size_t count)
+{
+	struct consumer *consumer = data;
+	size_t i;
+	SCOPED_AO2LOCK(lock, consumer);
+
+	++consumer->batches_rxed;
+	for (i = 0; i < count; ++i) {
+		++consumer->messages_rxed_len;
+		consumer->messages_rxed = ast_realloc(consumer->messages_rxed, sizeof(*consumer->messages_rxed) * consumer->messages_rxed_len);
+		ast_assert(consumer->messages_rxed != NULL);
+		consumer->messages_rxed[consumer->messages_rxed_len - 1] = messages[i];
+		ao2_ref(messages[i], +1);
+	}
+
+	ast_cond_signal(&consumer->out);
+}
+
 static void consumer_exec_sync(void *data, struct stasis_subscription *sub, struct stasis_message *message)
 {
 	struct consumer *consumer = data;
@@ -468,6 +488,74 @@ AST_TEST_DEFINE(publish)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(publish_batch)
+{
+	RAII_VAR(struct stasis_topic *, topic, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_subscription *, uut1, NULL, stasis_unsubscribe);
+	RAII_VAR(struct stasis_subscription *, uut2, NULL, stasis_unsubscribe);
+	RAII_VAR(char *, test_data, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message_type *, test_message_type, NULL, ao2_cleanup);
+	RAII_VAR(struct consumer *, consumer1, NULL, ao2_cleanup);
+	RAII_VAR(struct consumer *, consumer2, NULL, ao2_cleanup);
+	struct stasis_message *messages[3] = { NULL, };
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int actual_len;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = test_category;
+		info->summary = "Test publishing a batch of messages";
+		info->description = "Test publishing a batch of messages to subscribers\n"
+			"with and without a batch callback";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	topic = stasis_topic_create("TestTopic");
+	ast_test_validate(test, NULL != topic);
+
+	consumer1 = consumer_create(1);
+	ast_test_validate(test, NULL != consumer1);
+	consumer2 = consumer_create(1);
+	ast_test_validate(test, NULL != consumer2);
+
+	uut1 = stasis_subscribe(topic, consumer_exec, consumer1);
+	ast_test_validate(test, NULL != uut1);
+	ao2_ref(consumer1, +1);
+	uut2 = stasis_subscribe(topic, consumer_exec, consumer2);
+	ast_test_validate(test, NULL != uut2);
+	ao2_ref(consumer2, +1);
+	ast_test_validate(test, 0 == stasis_subscription_set_batch_callback(uut2, consumer_exec_batch));
+
+	test_data = ao2_alloc(1, NULL);
+	ast_test_validate(test, NULL != test_data);
+	ast_test_validate(test, stasis_message_type_create("TestMessage", NULL, &test_message_type) == STASIS_MESSAGE_TYPE_SUCCESS);
+	for (i = 0; i < ARRAY_LEN(messages); ++i) {
+		messages[i] = stasis_message_create(test_message_type, test_data);
+	}
+
+	stasis_publish_batch(topic, messages, ARRAY_LEN(messages));
+
+	actual_len = consumer_wait_for(consumer1, ARRAY_LEN(messages));
+	ast_test_validate_cleanup(test, ARRAY_LEN(messages) == actual_len, res, cleanup);
+	actual_len = consumer_wait_for(consumer2, ARRAY_LEN(messages));
+	ast_test_validate_cleanup(test, ARRAY_LEN(messages) == actual_len, res, cleanup);
+	ast_test_validate_cleanup(test, 1 == consumer2->batches_rxed, res, cleanup);
+	for (i = 0; i < ARRAY_LEN(messages); ++i) {
+		ast_test_validate_cleanup(test, messages[i] == consumer1->messages_rxed[i], res, cleanup);
+		ast_test_validate_cleanup(test, messages[i] == consumer2->messages_rxed[i], res, cleanup);
+	}
+
+cleanup:
+	for (i = 0; i < ARRAY_LEN(messages); ++i) {
+		ao2_cleanup(messages[i]);
+	}
+	return res;
+}
+
 AST_TEST_DEFINE(publish_sync)
 {
 	RAII_VAR(struct stasis_topic *, topic, NULL, ao2_cleanup);
@@ -564,6 +652,217 @@ AST_TEST_DEFINE(publish_pool)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(publish_pool_hashed)
+{
+	RAII_VAR(struct stasis_topic *, topic, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message_type *, test_message_type, NULL, ao2_cleanup);
+	struct stasis_subscription *uut[4] = { NULL, };
+	struct consumer *consumers[ARRAY_LEN(uut)] = { NULL, };
+	char *test_data[3] = { NULL, };
+	struct stasis_message *test_message;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int actual_len;
+	int i;
+	int j;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = test_category;
+		info->summary = "Test publishing with shared serializers";
+		info->description = "Test publishing to subscribers hashed onto\n"
+			"a pool of shared serializers. Each subscriber must receive\n"
+			"its messages in order and unsubscribing must complete.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	topic = stasis_topic_create("TestTopic");
+	ast_test_validate(test, NULL != topic);
+	ast_test_validate(test, stasis_message_type_create("TestMessage", NULL, &test_message_type) == STASIS_MESSAGE_TYPE_SUCCESS);
+
+	for (i = 0; i < ARRAY_LEN(uut); ++i) {
+		consumers[i] = consumer_create(1);
+		ast_test_validate_cleanup(test, NULL != consumers[i], res, cleanup);
+		uut[i] = stasis_subscribe_pool_hashed(topic, consumer_exec, consumers[i]);
+		ast_test_validate_cleanup(test, NULL != uut[i], res, cleanup);
+		ao2_ref(consumers[i], +1);
+	}
+
+	/* The serializer is shared so its alert levels can't be changed */
+	ast_test_validate_cleanup(test, stasis_subscription_set_congestion_limits(uut[0], -1, 10) == -1, res, cleanup);
+
+	for (j = 0; j < ARRAY_LEN(test_data); ++j) {
+		test_data[j] = ao2_alloc(1, NULL);
+		ast_test_validate_cleanup(test, NULL != test_data[j], res, cleanup);
+		test_message = stasis_message_create(test_message_type, test_data[j]);
+		ast_test_validate_cleanup(test, NULL != test_message, res, cleanup);
+		stasis_publish(topic, test_message);
+		ao2_ref(test_message, -1);
+	}
+
+	for (i = 0; i < ARRAY_LEN(uut); ++i) {
+		actual_len = consumer_wait_for(consumers[i], ARRAY_LEN(test_data));
+		ast_test_validate_cleanup(test, ARRAY_LEN(test_data) == actual_len, res, cleanup);
+		for (j = 0; j < ARRAY_LEN(test_data); ++j) {
+			ast_test_validate_cleanup(test,
+				test_data[j] == stasis_message_data(consumers[i]->messages_rxed[j]), res, cleanup);
+		}
+
+		uut[i] = stasis_unsubscribe_and_join(uut[i]);
+		ast_test_validate_cleanup(test, 1 == consumers[i]->complete, res, cleanup);
+	}
+
+cleanup:
+	for (i = 0; i < ARRAY_LEN(uut); ++i) {
+		stasis_unsubscribe(uut[i]);
+		ao2_cleanup(consumers[i]);
+	}
+	for (j = 0; j < ARRAY_LEN(test_data); ++j) {
+		ao2_cleanup(test_data[j]);
+	}
+
+	return res;
+}
+
+/*! Held by a test to keep a subscriber from consuming its messages */
+AST_MUTEX_DEFINE_STATIC(overload_gate);
+
+static void overload_consumer_exec(void *data, struct stasis_subscription *sub, struct stasis_message *message)
+{
+	ast_mutex_lock(&overload_gate);
+	ast_mutex_unlock(&overload_gate);
+
+	consumer_exec(data, sub, message);
+}
+
+static const char *overload_id(struct stasis_message *message)
+{
+	return stasis_message_data(message);
+}
+
+/*!
+ * \internal
+ * \brief Publish messages with the given ids to a stalled subscriber and
+ * check what the overload policy leaves it.
+ */
+static enum ast_test_result_state overload_check(struct ast_test *test,
+	enum stasis_subscription_overload_policy policy, size_t max_queued,
+	const char **ids, size_t count, const int *expected, size_t expected_count,
+	unsigned int dropped, unsigned int coalesced)
+{
+	struct stasis_topic *topic = NULL;
+	struct stasis_message_type *test_message_type = NULL;
+	struct stasis_subscription *uut = NULL;
+	struct consumer *consumer = NULL;
+	struct stasis_message **published;
+	struct stasis_subscription_overload_statistics stats;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int gated = 0;
+	size_t i;
+
+	published = ast_calloc(count, sizeof(*published));
+	ast_test_validate(test, NULL != published);
+
+	topic = stasis_topic_create("TestTopic");
+	ast_test_validate_cleanup(test, NULL != topic, res, cleanup);
+	ast_test_validate_cleanup(test, stasis_message_type_create("TestMessage", NULL, &test_message_type) == STASIS_MESSAGE_TYPE_SUCCESS, res, cleanup);
+
+	consumer = consumer_create(1);
+	ast_test_validate_cleanup(test, NULL != consumer, res, cleanup);
+
+	/* The subscribe message stalls the subscriber until the gate opens */
+	ast_mutex_lock(&overload_gate);
+	gated = 1;
+	uut = stasis_subscribe(topic, overload_consumer_exec, consumer);
+	ast_test_validate_cleanup(test, NULL != uut, res, cleanup);
+	ao2_ref(consumer, +1);
+	ast_test_validate_cleanup(test, 0 == stasis_subscription_set_overload_policy(uut, policy, max_queued, overload_id), res, cleanup);
+
+	for (i = 0; i < count; ++i) {
+		char *id = ao2_alloc(strlen(ids[i]) + 1, NULL);
+
+		ast_test_validate_cleanup(test, NULL != id, res, cleanup);
+		strcpy(id, ids[i]); /* Safe */
+		published[i] = stasis_message_create(test_message_type, id);
+		ao2_ref(id, -1);
+		ast_test_validate_cleanup(test, NULL != published[i], res, cleanup);
+		stasis_publish(topic, published[i]);
+	}
+
+	ast_test_validate_cleanup(test, 0 == stasis_subscription_overload_statistics_get(uut, &stats), res, cleanup);
+	ast_test_validate_cleanup(test, dropped == stats.dropped, res, cleanup);
+	ast_test_validate_cleanup(test, coalesced == stats.coalesced, res, cleanup);
+	ast_test_validate_cleanup(test, expected_count == stats.queued, res, cleanup);
+
+	ast_mutex_unlock(&overload_gate);
+	gated = 0;
+
+	ast_test_validate_cleanup(test, expected_count == consumer_wait_for(consumer, expected_count), res, cleanup);
+	for (i = 0; i < expected_count; ++i) {
+		ast_test_validate_cleanup(test, published[expected[i]] == consumer->messages_rxed[i], res, cleanup);
+	}
+
+	uut = stasis_unsubscribe_and_join(uut);
+	ast_test_validate_cleanup(test, 1 == consumer->complete, res, cleanup);
+
+cleanup:
+	if (gated) {
+		ast_mutex_unlock(&overload_gate);
+	}
+	stasis_unsubscribe(uut);
+	ao2_cleanup(consumer);
+	for (i = 0; i < count; ++i) {
+		ao2_cleanup(published[i]);
+	}
+	ast_free(published);
+	ao2_cleanup(test_message_type);
+	ao2_cleanup(topic);
+
+	return res;
+}
+
+AST_TEST_DEFINE(subscription_overload)
+{
+	static const char *ids[] = { "a", "b", "a", "c", "a", "b" };
+	static const int drop_oldest[] = { 4, 5 };
+	static const int coalesce[] = { 4, 5, 3 };
+	static const int sample[] = { 0, 2, 4, 5 };
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = test_category;
+		info->summary = "Test overload policies of subscriptions";
+		info->description = "Test that the messages queued for a stalled\n"
+			"subscriber stay bounded by its overload policy.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_test_status_update(test, "Testing drop oldest\n");
+	if (overload_check(test, STASIS_SUBSCRIPTION_OVERLOAD_DROP_OLDEST, 2, ids, ARRAY_LEN(ids),
+			drop_oldest, ARRAY_LEN(drop_oldest), 4, 0) != AST_TEST_PASS) {
+		return AST_TEST_FAIL;
+	}
+
+	ast_test_status_update(test, "Testing coalesce\n");
+	if (overload_check(test, STASIS_SUBSCRIPTION_OVERLOAD_COALESCE, 10, ids, ARRAY_LEN(ids),
+			coalesce, ARRAY_LEN(coalesce), 0, 3) != AST_TEST_PASS) {
+		return AST_TEST_FAIL;
+	}
+
+	ast_test_status_update(test, "Testing sample\n");
+	if (overload_check(test, STASIS_SUBSCRIPTION_OVERLOAD_SAMPLE, 4, ids, ARRAY_LEN(ids),
+			sample, ARRAY_LEN(sample), 2, 0) != AST_TEST_PASS) {
+		return AST_TEST_FAIL;
+	}
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(unsubscribe_stops_messages)
 {
 	RAII_VAR(struct stasis_topic *, topic, NULL, ao2_cleanup);
@@ -1861,6 +2160,7 @@ AST_TEST_DEFINE(to_json)
 	RAII_VAR(struct stasis_message *, uut, NULL, ao2_cleanup);
 	RAII_VAR(char *, data, NULL, ao2_cleanup);
 	RAII_VAR(struct ast_json *, actual, NULL, ast_json_unref);
+	RAII_VAR(struct ast_json *, again, NULL, ast_json_unref);
 	const char *expected_text = "SomeData";
 	RAII_VAR(struct ast_json *, expected, NULL, ast_json_unref);
 
@@ -1886,6 +2186,11 @@ AST_TEST_DEFINE(to_json)
 	actual = stasis_message_to_json(uut, NULL);
 	ast_test_validate(test, ast_json_equal(expected, actual));
 
+	/* The memoized representation is handed out as a private copy */
+	again = stasis_message_to_json(uut, NULL);
+	ast_test_validate(test, ast_json_equal(expected, again));
+	ast_test_validate(test, actual != again);
+
 	return AST_TEST_PASS;
 }
 
@@ -1932,6 +2237,7 @@ AST_TEST_DEFINE(to_ami)
 	RAII_VAR(struct stasis_message *, uut, NULL, ao2_cleanup);
 	RAII_VAR(char *, data, NULL, ao2_cleanup);
 	RAII_VAR(struct ast_manager_event_blob *, actual, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_manager_event_blob *, again, NULL, ao2_cleanup);
 	const char *expected_text = "SomeData";
 	const char *expected = "Message: SomeData\r\n";
 
@@ -1956,6 +2262,10 @@ AST_TEST_DEFINE(to_ami)
 	actual = stasis_message_to_ami(uut);
 	ast_test_validate(test, strcmp(expected, actual->extra_fields) == 0);
 
+	/* The memoized representation is shared */
+	again = stasis_message_to_ami(uut);
+	ast_test_validate(test, actual == again);
+
 	return AST_TEST_PASS;
 }
 
@@ -2440,8 +2750,11 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(subscription_messages);
 	AST_TEST_UNREGISTER(subscription_pool_messages);
 	AST_TEST_UNREGISTER(publish);
+	AST_TEST_UNREGISTER(publish_batch);
 	AST_TEST_UNREGISTER(publish_sync);
 	AST_TEST_UNREGISTER(publish_pool);
+	AST_TEST_UNREGISTER(publish_pool_hashed);
+	AST_TEST_UNREGISTER(subscription_overload);
 	AST_TEST_UNREGISTER(unsubscribe_stops_messages);
 	AST_TEST_UNREGISTER(forward);
 	AST_TEST_UNREGISTER(cache_filter);
@@ -2472,8 +2785,11 @@ static int load_module(void)
 	AST_TEST_REGISTER(subscription_messages);
 	AST_TEST_REGISTER(subscription_pool_messages);
 	AST_TEST_REGISTER(publish);
+	AST_TEST_REGISTER(publish_batch);
 	AST_TEST_REGISTER(publish_sync);
 	AST_TEST_REGISTER(publish_pool);
+	AST_TEST_REGISTER(publish_pool_hashed);
+	AST_TEST_REGISTER(subscription_overload);
 	AST_TEST_REGISTER(unsubscribe_stops_messages);
 	AST_TEST_REGISTER(forward);
 	AST_TEST_REGISTER(cache_filter);
@@ -250,6 +250,9 @@ AST_TEST_DEFINE(channel_snapshot_json)
 	RAII_VAR(struct ast_channel_snapshot *, snapshot, NULL, ao2_cleanup);
 	RAII_VAR(struct ast_json *, expected, NULL, ast_json_unref);
 	RAII_VAR(struct ast_json *, actual, NULL, ast_json_unref);
+	RAII_VAR(struct ast_json *, written, NULL, ast_json_unref);
+	RAII_VAR(struct ast_str *, buf, NULL, ast_free);
+	struct ast_json_writer writer;
 
 	switch (cmd) {
 	case TEST_INIT:
@@ -264,6 +267,11 @@ AST_TEST_DEFINE(channel_snapshot_json)
 
 	ast_test_validate(test, NULL == ast_channel_snapshot_to_json(NULL, NULL));
 
+	buf = ast_str_create(64);
+	ast_test_validate(test, NULL != buf);
+	ast_json_writer_init(&writer, &buf);
+	ast_test_validate(test, -1 == ast_channel_snapshot_to_json_writer(NULL, NULL, &writer));
+
 	chan = ast_channel_alloc(0, AST_STATE_DOWN, "cid_num", "cid_name", "acctcode", "exten", "context", NULL, NULL, 0, "TEST/name");
 	ast_channel_unlock(chan);
 	ast_test_validate(test, NULL != chan);
@@ -304,6 +312,11 @@ AST_TEST_DEFINE(channel_snapshot_json)
 
 	ast_test_validate(test, ast_json_equal(expected, actual));
 
+	ast_test_validate(test, 0 == ast_channel_snapshot_to_json_writer(snapshot, NULL, &writer));
+	ast_test_validate(test, 0 == ast_json_writer_finish(&writer));
+	written = ast_json_load_str(buf, NULL);
+	ast_test_validate(test, ast_json_equal(expected, written));
+
 	return AST_TEST_PASS;
 }
 
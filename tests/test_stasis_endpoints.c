@@ -212,10 +212,12 @@ AST_TEST_DEFINE(channel_messages)
 	struct stasis_message *msg;
 	struct stasis_message_type *type;
 	struct ast_endpoint_snapshot *actual_snapshot;
+	struct ast_endpoint_channel_update *actual_update;
 	int expected_count;
 	int actual_count;
 	int i;
 	int channel_index = -1;
+	int update_index = -1;
 	int endpoint_index = -1;
 
 	switch (cmd) {
@@ -246,12 +248,21 @@ AST_TEST_DEFINE(channel_messages)
 
 	ast_endpoint_add_channel(uut, chan);
 
-	actual_count = stasis_message_sink_wait_for_count(sink, 1,
+	/* The channel update is followed by a snapshot with the channel */
+	actual_count = stasis_message_sink_wait_for_count(sink, 2,
 		STASIS_SINK_DEFAULT_WAIT);
-	ast_test_validate(test, 1 == actual_count);
+	ast_test_validate(test, 2 == actual_count);
 
 	msg = sink->messages[0];
 	type = stasis_message_type(msg);
+	ast_test_validate(test, ast_endpoint_channel_update_type() == type);
+	actual_update = stasis_message_data(msg);
+	ast_test_validate(test, actual_update->added);
+	ast_test_validate(test, 1 == actual_update->num_channels);
+	ast_test_validate(test, 0 == strcmp(ast_channel_uniqueid(chan), actual_update->channel_id));
+
+	msg = sink->messages[1];
+	type = stasis_message_type(msg);
 	ast_test_validate(test, ast_endpoint_snapshot_type() == type);
 	actual_snapshot = stasis_message_data(msg);
 	ast_test_validate(test, 1 == actual_snapshot->num_channels);
@@ -259,22 +270,29 @@ AST_TEST_DEFINE(channel_messages)
 	ast_hangup(chan);
 	chan = NULL;
 
-	expected_count = 3;
+	expected_count = 5;
 	actual_count = stasis_message_sink_wait_for_count(sink, expected_count,
 		STASIS_SINK_DEFAULT_WAIT);
 	ast_test_validate(test, expected_count == actual_count);
 
-	for (i = 0; i < expected_count; i++) {
+	for (i = 2; i < expected_count; i++) {
 		msg = sink->messages[i];
 		type = stasis_message_type(msg);
 		if (type == ast_channel_snapshot_type()) {
 			channel_index = i;
 		}
+		if (type == ast_endpoint_channel_update_type()) {
+			update_index = i;
+		}
 		if (type == ast_endpoint_snapshot_type()) {
 			endpoint_index = i;
 		}
 	}
-	ast_test_validate(test, channel_index >= 0 && endpoint_index >= 0);
+	ast_test_validate(test, channel_index >= 0 && update_index >= 0 && endpoint_index >= 0);
+	ast_test_validate(test, update_index < endpoint_index);
+	actual_update = stasis_message_data(sink->messages[update_index]);
+	ast_test_validate(test, !actual_update->added);
+	ast_test_validate(test, 0 == actual_update->num_channels);
 	actual_snapshot = stasis_message_data(sink->messages[endpoint_index]);
 	ast_test_validate(test, 0 == actual_snapshot->num_channels);
 
@@ -513,9 +513,85 @@ error:
 	return res;
 }
 
+AST_TEST_DEFINE(string_field_compact_test)
+{
+	enum ast_test_result_state res = AST_TEST_PASS;
+	struct test_struct *inst1;
+	struct test_struct *inst2 = NULL;
+	size_t size = AST_STRING_FIELD_ROOM(strlen("embedded"));
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "string_field_compact_test";
+		info->category = "/main/utils/";
+		info->summary = "Test stringfield embedded pools and interned strings";
+		info->description =
+			"This tests pools embedded after a structure allocated by the caller,\n"
+			"and fields set to interned strings.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	inst1 = ast_calloc(1, sizeof(*inst1) + AST_STRING_FIELD_EMBEDDED_SIZE(size));
+	if (!inst1 || ast_string_field_init_embedded(inst1, size)
+		|| ast_string_field_init_extended(inst1, string2)) {
+		ast_free(inst1);
+		return AST_TEST_FAIL;
+	}
+
+	inst2 = ast_calloc_with_stringfields(1, struct test_struct, 32);
+	if (!inst2 || ast_string_field_init_extended(inst2, string2)) {
+		res = AST_TEST_FAIL;
+		goto error;
+	}
+
+	ast_string_field_set(inst1, string1, "embedded");
+	if (inst1->__field_mgr_pool != inst1->__field_mgr.embedded_pool
+		|| inst1->__field_mgr_pool != (void *) (inst1 + 1)
+		|| strcmp(inst1->string1, "embedded")) {
+		ast_test_status_update(test, "The field did not fit in the embedded pool\n");
+		res = AST_TEST_FAIL;
+		goto error;
+	}
+
+	ast_string_field_set_interned(inst1, string2, "interned");
+	ast_string_field_set_interned(inst2, string2, "interned");
+	if (inst1->string2 != inst2->string2 || strcmp(inst1->string2, "interned")
+		|| inst1->__field_mgr_pool->prev) {
+		ast_test_status_update(test, "The interned string was not shared\n");
+		res = AST_TEST_FAIL;
+		goto error;
+	}
+
+	/* Setting a field set to an interned string must not write over it */
+	ast_string_field_set(inst2, string2, "overwritten");
+	if (strcmp(inst1->string2, "interned") || strcmp(inst2->string2, "overwritten")) {
+		ast_test_status_update(test, "Setting the field changed the interned string\n");
+		res = AST_TEST_FAIL;
+		goto error;
+	}
+
+	ast_string_field_set_interned(inst2, string2, "interned");
+	if (ast_string_fields_copy(inst2, inst1) || ast_string_fields_cmp(inst1, inst2)
+		|| inst1->string2 != inst2->string2) {
+		ast_test_status_update(test, "The copy did not share the interned string\n");
+		res = AST_TEST_FAIL;
+	}
+
+error:
+	ast_string_field_free_memory(inst1);
+	ast_free(inst1);
+	ast_string_field_free_memory(inst2);
+	ast_free(inst2);
+
+	return res;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(string_field_aggregate_test);
+	AST_TEST_UNREGISTER(string_field_compact_test);
 	AST_TEST_UNREGISTER(string_field_test);
 	return 0;
 }
@@ -524,6 +600,7 @@ static int load_module(void)
 {
 	AST_TEST_REGISTER(string_field_test);
 	AST_TEST_REGISTER(string_field_aggregate_test);
+	AST_TEST_REGISTER(string_field_compact_test);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
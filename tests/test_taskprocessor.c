@@ -427,6 +427,162 @@ test_end:
 	return res;
 }
 
+#define NUM_PRODUCERS 8
+#define NUM_PRODUCER_TASKS 5000
+
+/*!
+ * \brief Relevant data associated with the multiple producer load test
+ */
+static struct producer_load_data {
+	/*! Condition used to indicate all tasks have completed executing */
+	ast_cond_t cond;
+	/*! Lock used to protect the condition */
+	ast_mutex_t lock;
+	/*! The taskprocessor the producers push to */
+	struct ast_taskprocessor *tps;
+	/*! Counter of the number of completed tasks */
+	int tasks_completed;
+	/*! Counter of the tasks executed out of order for their producer */
+	int out_of_order;
+	/*! Last sequence number executed for each producer */
+	int last_seq[NUM_PRODUCERS];
+	/*! Task data.  The producer and its sequence number encoded as one value */
+	int task_data[NUM_PRODUCERS][NUM_PRODUCER_TASKS];
+} producer_load_results;
+
+static int producer_load_task(void *data)
+{
+	int value = *(int *) data;
+	int producer = value / NUM_PRODUCER_TASKS;
+	int seq = value % NUM_PRODUCER_TASKS;
+
+	/* Only the taskprocessor thread touches last_seq */
+	if (producer_load_results.last_seq[producer] + 1 != seq) {
+		++producer_load_results.out_of_order;
+	}
+	producer_load_results.last_seq[producer] = seq;
+
+	ast_mutex_lock(&producer_load_results.lock);
+	if (++producer_load_results.tasks_completed == NUM_PRODUCERS * NUM_PRODUCER_TASKS) {
+		ast_cond_signal(&producer_load_results.cond);
+	}
+	ast_mutex_unlock(&producer_load_results.lock);
+	return 0;
+}
+
+static void *producer_thread(void *data)
+{
+	int producer = (intptr_t) data;
+	int i;
+
+	for (i = 0; i < NUM_PRODUCER_TASKS; ++i) {
+		producer_load_results.task_data[producer][i] = producer * NUM_PRODUCER_TASKS + i;
+		if (ast_taskprocessor_push(producer_load_results.tps, producer_load_task,
+			&producer_load_results.task_data[producer][i])) {
+			return (void *) -1;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \brief Load test for taskprocessor with many threads pushing at once
+ *
+ * The taskprocessor queue is pushed to without holding the taskprocessor
+ * lock.  This ensures no tasks are lost when many threads push
+ * concurrently and that each thread's tasks are run in the order pushed.
+ */
+AST_TEST_DEFINE(default_taskprocessor_producers)
+{
+	pthread_t producers[NUM_PRODUCERS];
+	struct timeval start;
+	struct timespec ts;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	void *thread_res;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "default_taskprocessor_producers";
+		info->category = "/main/taskprocessor/";
+		info->summary = "Multiple producer load test of default taskprocessor";
+		info->description =
+			"Ensure that tasks queued concurrently by many threads are all executed\n"
+			"and that each thread's tasks are executed in the order queued.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	producer_load_results.tps = ast_taskprocessor_get("test_producers", TPS_REF_DEFAULT);
+	if (!producer_load_results.tps) {
+		ast_test_status_update(test, "Unable to create test taskprocessor\n");
+		return AST_TEST_FAIL;
+	}
+
+	ast_cond_init(&producer_load_results.cond, NULL);
+	ast_mutex_init(&producer_load_results.lock);
+	producer_load_results.tasks_completed = 0;
+	producer_load_results.out_of_order = 0;
+	for (i = 0; i < NUM_PRODUCERS; ++i) {
+		producer_load_results.last_seq[i] = -1;
+	}
+
+	for (i = 0; i < NUM_PRODUCERS; ++i) {
+		if (ast_pthread_create(&producers[i], NULL, producer_thread, (void *) (intptr_t) i)) {
+			ast_test_status_update(test, "Failed to start producer thread\n");
+			producers[i] = AST_PTHREADT_NULL;
+			res = AST_TEST_FAIL;
+		}
+	}
+
+	for (i = 0; i < NUM_PRODUCERS; ++i) {
+		if (producers[i] == AST_PTHREADT_NULL) {
+			continue;
+		}
+		pthread_join(producers[i], &thread_res);
+		if (thread_res) {
+			ast_test_status_update(test, "Failed to queue task\n");
+			res = AST_TEST_FAIL;
+		}
+	}
+	if (res == AST_TEST_FAIL) {
+		goto test_end;
+	}
+
+	start = ast_tvnow();
+	ts.tv_sec = start.tv_sec + 60;
+	ts.tv_nsec = start.tv_usec * 1000;
+
+	ast_mutex_lock(&producer_load_results.lock);
+	while (producer_load_results.tasks_completed < NUM_PRODUCERS * NUM_PRODUCER_TASKS) {
+		if (ast_cond_timedwait(&producer_load_results.cond, &producer_load_results.lock, &ts) == ETIMEDOUT) {
+			break;
+		}
+	}
+	ast_mutex_unlock(&producer_load_results.lock);
+
+	if (producer_load_results.tasks_completed != NUM_PRODUCERS * NUM_PRODUCER_TASKS) {
+		ast_test_status_update(test, "Unexpected number of tasks executed. Expected %d but got %d\n",
+			NUM_PRODUCERS * NUM_PRODUCER_TASKS, producer_load_results.tasks_completed);
+		res = AST_TEST_FAIL;
+		goto test_end;
+	}
+
+	if (producer_load_results.out_of_order) {
+		ast_test_status_update(test, "%d queued tasks did not execute in order\n",
+			producer_load_results.out_of_order);
+		res = AST_TEST_FAIL;
+	}
+
+test_end:
+	producer_load_results.tps = ast_taskprocessor_unreference(producer_load_results.tps);
+	ast_mutex_destroy(&producer_load_results.lock);
+	ast_cond_destroy(&producer_load_results.cond);
+	return res;
+}
+
 /*!
  * \brief Private data for the test taskprocessor listener
  */
@@ -967,6 +1123,7 @@ static int unload_module(void)
 {
 	ast_test_unregister(default_taskprocessor);
 	ast_test_unregister(default_taskprocessor_load);
+	ast_test_unregister(default_taskprocessor_producers);
 	ast_test_unregister(subsystem_alert);
 	ast_test_unregister(taskprocessor_listener);
 	ast_test_unregister(taskprocessor_shutdown);
@@ -979,6 +1136,7 @@ static int load_module(void)
 {
 	ast_test_register(default_taskprocessor);
 	ast_test_register(default_taskprocessor_load);
+	ast_test_register(default_taskprocessor_producers);
 	ast_test_register(subsystem_alert);
 	ast_test_register(taskprocessor_listener);
 	ast_test_register(taskprocessor_shutdown);
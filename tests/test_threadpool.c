@@ -174,6 +174,35 @@ static enum ast_test_result_state wait_until_thread_state(struct ast_test *test,
 	return res;
 }
 
+/*!
+ * \brief Wait for every thread of a pool to go idle
+ *
+ * Unlike wait_until_thread_state(), this does not expect a number of idle
+ * threads, for pools which grow by however much their load demands.
+ */
+static enum ast_test_result_state wait_until_no_active_threads(struct ast_test *test, struct test_listener_data *tld)
+{
+	struct timeval start = ast_tvnow();
+	struct timespec end = {
+		.tv_sec = start.tv_sec + 5,
+		.tv_nsec = start.tv_usec * 1000
+	};
+	SCOPED_MUTEX(lock, &tld->lock);
+
+	while (tld->num_active) {
+		if (ast_cond_timedwait(&tld->cond, &tld->lock, &end) == ETIMEDOUT) {
+			break;
+		}
+	}
+
+	if (tld->num_active) {
+		ast_test_status_update(test, "Expected no active threads but got %d\n", tld->num_active);
+		return AST_TEST_FAIL;
+	}
+
+	return AST_TEST_PASS;
+}
+
 static void wait_for_task_pushed(struct ast_threadpool_listener *listener)
 {
 	struct test_listener_data *tld = ast_threadpool_listener_get_user_data(listener);
@@ -1114,6 +1143,143 @@ end:
 	return res;
 }
 
+#define WS_NUM_TASKS 1000
+
+struct ws_task_data {
+	/*! Pool the tasks are run in */
+	struct ast_threadpool *pool;
+	/*! Number of tasks that have executed */
+	int num_executed;
+	ast_mutex_t lock;
+	ast_cond_t cond;
+};
+
+static int ws_child_task(void *data)
+{
+	struct ws_task_data *wtd = data;
+	SCOPED_MUTEX(lock, &wtd->lock);
+
+	if (++wtd->num_executed == WS_NUM_TASKS * 2) {
+		ast_cond_signal(&wtd->cond);
+	}
+	return 0;
+}
+
+static int ws_parent_task(void *data)
+{
+	struct ws_task_data *wtd = data;
+
+	/* Pushed from within the pool so this stays on the worker's own queue */
+	if (ast_threadpool_push(wtd->pool, ws_child_task, wtd)) {
+		ast_log(LOG_WARNING, "Failed to push child task\n");
+	}
+	return ws_child_task(wtd);
+}
+
+AST_TEST_DEFINE(threadpool_work_stealing)
+{
+	struct ast_threadpool *pool = NULL;
+	struct ast_threadpool_listener *listener = NULL;
+	struct ws_task_data wtd = { 0, };
+	enum ast_test_result_state res = AST_TEST_FAIL;
+	struct test_listener_data *tld = NULL;
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 0,
+		.auto_increment = 3,
+		.initial_size = 0,
+		.max_size = 0,
+		.work_stealing = 1,
+	};
+	struct timeval start;
+	struct timespec end;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "work_stealing";
+		info->category = "/main/threadpool/";
+		info->summary = "Test a threadpool using work stealing task queues";
+		info->description =
+			"Create an empty work stealing threadpool and push many tasks to it\n"
+			"from outside the pool. Each task pushes another task from within the\n"
+			"pool. The pool should grow, run every task, notify the listener that\n"
+			"it is empty and its threads should then go idle.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	tld = test_alloc();
+	if (!tld) {
+		return AST_TEST_FAIL;
+	}
+	ast_mutex_init(&wtd.lock);
+	ast_cond_init(&wtd.cond, NULL);
+
+	listener = ast_threadpool_listener_alloc(&test_callbacks, tld);
+	if (!listener) {
+		goto end;
+	}
+
+	pool = ast_threadpool_create(info->name, listener, &options);
+	if (!pool) {
+		goto end;
+	}
+	wtd.pool = pool;
+
+	for (i = 0; i < WS_NUM_TASKS; ++i) {
+		if (ast_threadpool_push(pool, ws_parent_task, &wtd)) {
+			goto end;
+		}
+	}
+
+	start = ast_tvnow();
+	end.tv_sec = start.tv_sec + 10;
+	end.tv_nsec = start.tv_usec * 1000;
+
+	ast_mutex_lock(&wtd.lock);
+	while (wtd.num_executed < WS_NUM_TASKS * 2) {
+		if (ast_cond_timedwait(&wtd.cond, &wtd.lock, &end) == ETIMEDOUT) {
+			break;
+		}
+	}
+	i = wtd.num_executed;
+	ast_mutex_unlock(&wtd.lock);
+
+	if (i != WS_NUM_TASKS * 2) {
+		ast_test_status_update(test, "Expected %d tasks to execute but %d did\n",
+			WS_NUM_TASKS * 2, i);
+		goto end;
+	}
+
+	res = wait_for_empty_notice(test, tld);
+	if (res == AST_TEST_FAIL) {
+		goto end;
+	}
+
+	/* Tasks pushed from within the pool grow it too, so how many threads
+	 * end up idle depends on how the tasks were scheduled */
+	res = wait_until_no_active_threads(test, tld);
+	if (res == AST_TEST_FAIL) {
+		goto end;
+	}
+
+	if (ast_threadpool_queue_size(pool)) {
+		ast_test_status_update(test, "Expected an empty pool but %ld tasks are queued\n",
+			ast_threadpool_queue_size(pool));
+		res = AST_TEST_FAIL;
+	}
+
+end:
+	ast_threadpool_shutdown(pool);
+	ao2_cleanup(listener);
+	ast_mutex_destroy(&wtd.lock);
+	ast_cond_destroy(&wtd.cond);
+	ast_free(tld);
+	return res;
+}
+
 AST_TEST_DEFINE(threadpool_max_size)
 {
 	struct ast_threadpool *pool = NULL;
@@ -1811,6 +1977,7 @@ static int unload_module(void)
 	ast_test_unregister(threadpool_one_thread_multiple_tasks);
 	ast_test_unregister(threadpool_auto_increment);
 	ast_test_unregister(threadpool_max_size);
+	ast_test_unregister(threadpool_work_stealing);
 	ast_test_unregister(threadpool_reactivation);
 	ast_test_unregister(threadpool_task_distribution);
 	ast_test_unregister(threadpool_more_destruction);
@@ -1832,6 +1999,7 @@ static int load_module(void)
 	ast_test_register(threadpool_one_thread_multiple_tasks);
 	ast_test_register(threadpool_auto_increment);
 	ast_test_register(threadpool_max_size);
+	ast_test_register(threadpool_work_stealing);
 	ast_test_register(threadpool_reactivation);
 	ast_test_register(threadpool_task_distribution);
 	ast_test_register(threadpool_more_destruction);
@@ -0,0 +1,168 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Translation path tests
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/translate.h"
+#include "asterisk/frame.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/utils.h"
+#include "asterisk/test.h"
+#include "asterisk/module.h"
+
+/*! How many frames are translated as a list */
+#define LIST_FRAMES 10
+/*! Samples in each 20ms frame of 8kHz ulaw */
+#define FRAME_SAMPLES 160
+
+AST_TEST_DEFINE(translate_list)
+{
+	uint8_t data[LIST_FRAMES][FRAME_SAMPLES];
+	struct ast_frame frames[LIST_FRAMES];
+	struct ast_trans_pvt *list_path = NULL;
+	struct ast_trans_pvt *frame_path = NULL;
+	struct ast_frame *translated = NULL;
+	struct ast_frame *cur;
+	enum ast_test_result_state res = AST_TEST_FAIL;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "translate_list";
+		info->category = "/main/translate/";
+		info->summary = "Translate a list of frames over several steps";
+		info->description =
+			"Translates a list of ulaw frames to signed linear at 16kHz,\n"
+			"which takes more than one step, and checks each frame comes\n"
+			"out separately, with the timing of the frame it came from and\n"
+			"the same audio ast_translate() gives a frame at a time.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (ast_translate_path_steps(ast_format_slin16, ast_format_ulaw) < 2) {
+		ast_test_status_update(test, "No translation path of several steps from ulaw to slin16\n");
+		return AST_TEST_NOT_RUN;
+	}
+
+	list_path = ast_translator_build_path(ast_format_slin16, ast_format_ulaw);
+	frame_path = ast_translator_build_path(ast_format_slin16, ast_format_ulaw);
+	if (!list_path || !frame_path) {
+		ast_test_status_update(test, "Could not build translation paths\n");
+		goto cleanup;
+	}
+
+	memset(frames, 0, sizeof(frames));
+	for (i = 0; i < LIST_FRAMES; i++) {
+		int j;
+
+		for (j = 0; j < FRAME_SAMPLES; j++) {
+			data[i][j] = (i * FRAME_SAMPLES + j) * 37;
+		}
+		frames[i].frametype = AST_FRAME_VOICE;
+		frames[i].subclass.format = ast_format_ulaw;
+		frames[i].data.ptr = data[i];
+		frames[i].datalen = FRAME_SAMPLES;
+		frames[i].samples = FRAME_SAMPLES;
+		frames[i].src = __FUNCTION__;
+		ast_set_flag(&frames[i], AST_FRFLAG_HAS_TIMING_INFO);
+		frames[i].ts = i * 20;
+		frames[i].len = 20;
+		frames[i].seqno = 1000 + i;
+		if (i) {
+			AST_LIST_NEXT(&frames[i - 1], frame_list) = &frames[i];
+		}
+	}
+
+	translated = ast_translate_list(list_path, frames, 0);
+
+	for (i = 0, cur = translated; i < LIST_FRAMES; i++, cur = AST_LIST_NEXT(cur, frame_list)) {
+		struct ast_frame *expected;
+		struct ast_frame *next = AST_LIST_NEXT(&frames[i], frame_list);
+
+		if (!cur) {
+			ast_test_status_update(test, "Only %d of %d frames came out\n", i, LIST_FRAMES);
+			goto cleanup;
+		}
+		if (cur->samples != FRAME_SAMPLES * 2) {
+			ast_test_status_update(test, "Frame %d has %d samples rather than %d\n",
+				i, cur->samples, FRAME_SAMPLES * 2);
+			goto cleanup;
+		}
+		if (!ast_test_flag(cur, AST_FRFLAG_HAS_TIMING_INFO)
+			|| cur->ts != frames[i].ts || cur->len != frames[i].len || cur->seqno != frames[i].seqno) {
+			ast_test_status_update(test, "Frame %d lost the timing of its input\n", i);
+			goto cleanup;
+		}
+
+		/* The same frame on its own through the other path */
+		AST_LIST_NEXT(&frames[i], frame_list) = NULL;
+		expected = ast_translate(frame_path, &frames[i], 0);
+		AST_LIST_NEXT(&frames[i], frame_list) = next;
+		if (!expected || expected->datalen != cur->datalen
+			|| memcmp(expected->data.ptr, cur->data.ptr, cur->datalen)) {
+			ast_test_status_update(test, "Frame %d differs from what ast_translate() gives\n", i);
+			if (expected) {
+				ast_frfree(expected);
+			}
+			goto cleanup;
+		}
+		ast_frfree(expected);
+	}
+	if (cur) {
+		ast_test_status_update(test, "More than %d frames came out\n", LIST_FRAMES);
+		goto cleanup;
+	}
+
+	res = AST_TEST_PASS;
+
+cleanup:
+	if (translated) {
+		ast_frfree(translated);
+	}
+	if (list_path) {
+		ast_translator_free_path(list_path);
+	}
+	if (frame_path) {
+		ast_translator_free_path(frame_path);
+	}
+	return res;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(translate_list);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(translate_list);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Translation path tests");
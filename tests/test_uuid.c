@@ -29,6 +29,8 @@
 #include "asterisk/test.h"
 #include "asterisk/uuid.h"
 #include "asterisk/module.h"
+#include "asterisk/time.h"
+#include "asterisk/utils.h"
 
 AST_TEST_DEFINE(uuid)
 {
@@ -137,15 +139,129 @@ end:
 	return res;
 }
 
+/*! \brief Whether a UUID string has the version given and the RFC 4122 variant */
+static int uuid_str_is_version(const char *str, char version)
+{
+	return strlen(str) == AST_UUID_STR_LEN - 1 && str[14] == version && strchr("89ab", str[19]);
+}
+
+AST_TEST_DEFINE(uuid_versions)
+{
+	char uuid_str[AST_UUID_STR_LEN];
+	char earlier[AST_UUID_STR_LEN];
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "uuid_versions";
+		info->category = "/main/uuid/";
+		info->summary = "UUID version test";
+		info->description =
+			"Tests generated UUIDs are random version 4 UUIDs, and that time\n"
+			"ordered ones are version 7 UUIDs sorting after earlier ones.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	/* Enough to go through the random bytes a thread reads at once */
+	for (i = 0; i < 1000; i++) {
+		ast_uuid_generate_str(uuid_str, sizeof(uuid_str));
+		if (!uuid_str_is_version(uuid_str, '4')) {
+			ast_test_status_update(test, "Generated UUID %s is not a version 4 UUID\n", uuid_str);
+			return AST_TEST_FAIL;
+		}
+	}
+
+	ast_uuid_generate_time_ordered_str(earlier, sizeof(earlier));
+	usleep(2000);
+	ast_uuid_generate_time_ordered_str(uuid_str, sizeof(uuid_str));
+	if (!uuid_str_is_version(uuid_str, '7')) {
+		ast_test_status_update(test, "Generated UUID %s is not a version 7 UUID\n", uuid_str);
+		return AST_TEST_FAIL;
+	}
+	if (strcmp(earlier, uuid_str) >= 0) {
+		ast_test_status_update(test, "UUID %s does not sort after the earlier %s\n", uuid_str, earlier);
+		return AST_TEST_FAIL;
+	}
+
+	return AST_TEST_PASS;
+}
+
+/*! \brief How many UUIDs each thread of the benchmark generates */
+#define BENCHMARK_UUIDS 100000
+
+static void *uuid_benchmark_thread(void *data)
+{
+	char uuid_str[AST_UUID_STR_LEN];
+	int i;
+
+	for (i = 0; i < BENCHMARK_UUIDS; i++) {
+		ast_uuid_generate_str(uuid_str, sizeof(uuid_str));
+	}
+
+	return NULL;
+}
+
+AST_TEST_DEFINE(uuid_benchmark)
+{
+	pthread_t threads[8];
+	int thread_count;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "uuid_benchmark";
+		info->category = "/main/uuid/";
+		info->summary = "UUID generation benchmark";
+		info->description =
+			"Has 1, 2, 4 and 8 threads generate UUID strings at once, and reports\n"
+			"how many were generated per second.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (thread_count = 1; thread_count <= ARRAY_LEN(threads); thread_count *= 2) {
+		struct timeval start = ast_tvnow();
+		int64_t elapsed;
+
+		for (i = 0; i < thread_count; i++) {
+			if (ast_pthread_create(&threads[i], NULL, uuid_benchmark_thread, NULL)) {
+				ast_test_status_update(test, "Unable to start a benchmark thread\n");
+				thread_count = i;
+				break;
+			}
+		}
+		for (i = 0; i < thread_count; i++) {
+			pthread_join(threads[i], NULL);
+		}
+		elapsed = MAX(ast_tvdiff_us(ast_tvnow(), start), 1);
+
+		ast_test_status_update(test, "%d threads generated %d UUIDs in %" PRId64 "us, %" PRId64 " per second\n",
+			thread_count, thread_count * BENCHMARK_UUIDS, elapsed,
+			(int64_t) thread_count * BENCHMARK_UUIDS * 1000000 / elapsed);
+		if (!thread_count) {
+			return AST_TEST_FAIL;
+		}
+	}
+
+	return AST_TEST_PASS;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(uuid);
+	AST_TEST_UNREGISTER(uuid_versions);
+	AST_TEST_UNREGISTER(uuid_benchmark);
 	return 0;
 }
 
 static int load_module(void)
 {
 	AST_TEST_REGISTER(uuid);
+	AST_TEST_REGISTER(uuid_versions);
+	AST_TEST_REGISTER(uuid_benchmark);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
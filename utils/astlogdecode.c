@@ -0,0 +1,282 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Sangoma Technologies Corporation
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ *
+ * \brief Decode the files written by binary log channels
+ *
+ * Prints the messages in the files given on the command line as the
+ * 'plain' log formatter would, oldest file first.  The files of a ring
+ * are named after the channel followed by a number, so
+ *
+ * \verbatim
+   astlogdecode /var/log/asterisk/trace.*
+   \endverbatim
+ *
+ * prints everything the binary:trace channel has kept.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <inttypes.h>
+
+#include "asterisk/logger_binary.h"
+
+/*! \brief A file given on the command line */
+struct log_file {
+	const char *name;
+	const char *map;
+	size_t size;
+	uint64_t sequence;
+};
+
+/*! \brief A location read from the file being decoded */
+struct log_location {
+	int line;
+	char *file;
+	char *function;
+};
+
+static int log_file_compare(const void *a, const void *b)
+{
+	const struct log_file *left = a;
+	const struct log_file *right = b;
+
+	if (left->sequence == right->sequence) {
+		return 0;
+	}
+	return left->sequence < right->sequence ? -1 : 1;
+}
+
+static int log_file_map(struct log_file *file)
+{
+	const struct ast_log_binary_header *header;
+	struct stat st;
+	int fd;
+
+	fd = open(file->name, O_RDONLY);
+	if (fd < 0) {
+		perror(file->name);
+		return -1;
+	}
+	if (fstat(fd, &st) || st.st_size < sizeof(*header)) {
+		fprintf(stderr, "%s: Not a binary log\n", file->name);
+		close(fd);
+		return -1;
+	}
+
+	file->size = st.st_size;
+	file->map = mmap(NULL, file->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (file->map == MAP_FAILED) {
+		perror(file->name);
+		return -1;
+	}
+
+	header = (const struct ast_log_binary_header *) file->map;
+	if (strncmp(header->magic, AST_LOG_BINARY_MAGIC, sizeof(header->magic))
+		|| header->version != AST_LOG_BINARY_VERSION
+		|| header->header_size > file->size) {
+		fprintf(stderr, "%s: Not a binary log, or one of another version or byte order\n", file->name);
+		munmap((void *) file->map, file->size);
+		return -1;
+	}
+	file->sequence = header->sequence;
+
+	return 0;
+}
+
+static char *copy_string(const char *str, size_t length)
+{
+	char *copy = malloc(length + 1);
+
+	if (copy) {
+		memcpy(copy, str, length);
+		copy[length] = '\0';
+	}
+	return copy;
+}
+
+static void print_message(const struct ast_log_binary_message *message,
+	char *levels[], const struct log_location *locations, uint32_t location_count)
+{
+	const struct log_location *location = NULL;
+	char date[64];
+	char callid[16] = "";
+	time_t sec = message->time / 1000000;
+	struct tm tm;
+
+	localtime_r(&sec, &tm);
+	strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+
+	if (message->callid) {
+		snprintf(callid, sizeof(callid), "[C-%08x]", message->callid);
+	}
+	if (message->location < location_count) {
+		location = &locations[message->location];
+	}
+
+	printf("[%s.%06" PRIu64 "] %s[%d]%s: %s:%d %s: %.*s\n",
+		date, message->time % 1000000,
+		message->level < 32 && levels[message->level] ? levels[message->level] : "UNKNOWN",
+		message->lwp, callid,
+		location ? location->file : "?", location ? location->line : 0,
+		location ? location->function : "?",
+		(int) message->message_length, message->message);
+}
+
+static int decode_file(const struct log_file *file)
+{
+	const struct ast_log_binary_header *header = (const struct ast_log_binary_header *) file->map;
+	const char *pos = file->map + header->header_size;
+	const char *end = pos + header->used;
+	struct log_location *locations = NULL;
+	uint32_t location_count = 0;
+	char *levels[32] = { NULL, };
+	int res = 0;
+	uint32_t i;
+
+	if (end > file->map + file->size) {
+		end = file->map + file->size;
+	}
+
+	while (pos + sizeof(struct ast_log_binary_record) <= end) {
+		const struct ast_log_binary_record *record = (const struct ast_log_binary_record *) pos;
+
+		if (record->length < sizeof(*record) || pos + record->length > end) {
+			fprintf(stderr, "%s: Truncated record at offset %ld\n", file->name, (long) (pos - file->map));
+			res = -1;
+			break;
+		}
+
+		switch (record->type) {
+		case AST_LOG_BINARY_LEVEL:
+			{
+				const struct ast_log_binary_level *level = (const struct ast_log_binary_level *) record;
+
+				if (level->level < 32 && sizeof(*level) + level->name_length <= record->length) {
+					free(levels[level->level]);
+					levels[level->level] = copy_string(level->name, level->name_length);
+				}
+			}
+			break;
+		case AST_LOG_BINARY_LOCATION:
+			{
+				const struct ast_log_binary_location *location = (const struct ast_log_binary_location *) record;
+				struct log_location *grown;
+
+				if (sizeof(*location) + location->file_length + location->function_length > record->length) {
+					break;
+				}
+				if (location->id >= location_count) {
+					grown = realloc(locations, (location->id + 1) * sizeof(*locations));
+					if (!grown) {
+						res = -1;
+						goto cleanup;
+					}
+					memset(grown + location_count, 0, (location->id + 1 - location_count) * sizeof(*locations));
+					locations = grown;
+					location_count = location->id + 1;
+				}
+				free(locations[location->id].file);
+				free(locations[location->id].function);
+				locations[location->id].line = location->line;
+				locations[location->id].file = copy_string(location->strings, location->file_length);
+				locations[location->id].function = copy_string(location->strings + location->file_length,
+					location->function_length);
+			}
+			break;
+		case AST_LOG_BINARY_MESSAGE:
+			{
+				const struct ast_log_binary_message *message = (const struct ast_log_binary_message *) record;
+
+				if (sizeof(*message) + message->message_length <= record->length) {
+					print_message(message, levels, locations, location_count);
+				}
+			}
+			break;
+		default:
+			/* Records of later versions are skipped */
+			break;
+		}
+
+		pos += record->length;
+	}
+
+cleanup:
+	for (i = 0; i < location_count; i++) {
+		free(locations[i].file);
+		free(locations[i].function);
+	}
+	free(locations);
+	for (i = 0; i < 32; i++) {
+		free(levels[i]);
+	}
+
+	return res;
+}
+
+int main(int argc, char *argv[])
+{
+	struct log_file *files;
+	int count = 0;
+	int res = 0;
+	int i;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s FILE...\n", argv[0]);
+		fprintf(stderr, "Prints the messages in the files of a binary log channel, oldest first.\n");
+		return 1;
+	}
+
+	files = calloc(argc - 1, sizeof(*files));
+	if (!files) {
+		return 1;
+	}
+
+	for (i = 1; i < argc; i++) {
+		files[count].name = argv[i];
+		if (log_file_map(&files[count])) {
+			res = 1;
+			continue;
+		}
+		count++;
+	}
+
+	qsort(files, count, sizeof(*files), log_file_compare);
+
+	for (i = 0; i < count; i++) {
+		if (decode_file(&files[i])) {
+			res = 1;
+		}
+		munmap((void *) files[i].map, files[i].size);
+	}
+	free(files);
+
+	return res;
+}